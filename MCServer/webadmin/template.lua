@@ -148,6 +148,7 @@ function ShowPage(WebAdmin, TemplateRequest)
 			Output("<br>\n");
 		end
 	end
+	Output("<div><a href='" .. BaseURL .. "chunkcosts' class='usercp_nav_item usercp_nav_pmfolder'>Chunk tick costs</a></div>\n");
 
 	
 	Output([[
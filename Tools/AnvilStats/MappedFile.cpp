@@ -0,0 +1,129 @@
+
+// MappedFile.cpp
+
+// Implements the cMappedFile class representing a read-only memory-mapped file
+
+#include "Globals.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+
+
+
+cMappedFile::cMappedFile(void) :
+	m_Data(nullptr),
+	m_Size(0)
+	#ifdef _WIN32
+		,
+		m_File(INVALID_HANDLE_VALUE),
+		m_Mapping(nullptr)
+	#endif
+{
+}
+
+
+
+
+
+cMappedFile::~cMappedFile()
+{
+	Close();
+}
+
+
+
+
+
+bool cMappedFile::Open(const AString & a_FileName)
+{
+	Close();
+
+	#ifdef _WIN32
+		m_File = CreateFileA(a_FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER Size;
+		if (!GetFileSizeEx(m_File, &Size) || (Size.QuadPart == 0))
+		{
+			Close();
+			return false;
+		}
+		m_Mapping = CreateFileMapping(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping == nullptr)
+		{
+			Close();
+			return false;
+		}
+		m_Data = reinterpret_cast<const char *>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_Data == nullptr)
+		{
+			Close();
+			return false;
+		}
+		m_Size = static_cast<size_t>(Size.QuadPart);
+	#else
+		int File = open(a_FileName.c_str(), O_RDONLY);
+		if (File < 0)
+		{
+			return false;
+		}
+		struct stat Stat;
+		if ((fstat(File, &Stat) != 0) || (Stat.st_size == 0))
+		{
+			close(File);
+			return false;
+		}
+		void * Data = mmap(nullptr, static_cast<size_t>(Stat.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+		close(File);  // The mapping keeps its own reference to the file
+		if (Data == MAP_FAILED)
+		{
+			return false;
+		}
+		m_Data = reinterpret_cast<const char *>(Data);
+		m_Size = static_cast<size_t>(Stat.st_size);
+	#endif
+	return true;
+}
+
+
+
+
+
+void cMappedFile::Close(void)
+{
+	#ifdef _WIN32
+		if (m_Data != nullptr)
+		{
+			UnmapViewOfFile(m_Data);
+		}
+		if (m_Mapping != nullptr)
+		{
+			CloseHandle(m_Mapping);
+			m_Mapping = nullptr;
+		}
+		if (m_File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_File);
+			m_File = INVALID_HANDLE_VALUE;
+		}
+	#else
+		if (m_Data != nullptr)
+		{
+			munmap(const_cast<char *>(m_Data), m_Size);
+		}
+	#endif
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+
+
+
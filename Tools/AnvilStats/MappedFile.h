@@ -0,0 +1,49 @@
+
+// MappedFile.h
+
+// Interfaces to the cMappedFile class representing a read-only memory-mapped file
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** A file mapped into memory for reading.
+The region files are mapped instead of being read into a buffer, so that the OS pages in only the sectors that are
+actually used and the processor doesn't need a buffer as large as the biggest region file. */
+class cMappedFile
+{
+public:
+	cMappedFile(void);
+	~cMappedFile();
+
+	/** Maps the whole file into memory, unmapping any previously mapped file. Returns true on success.
+	Empty files cannot be mapped and return false. */
+	bool Open(const AString & a_FileName);
+
+	/** Unmaps the file, if mapped. */
+	void Close(void);
+
+	bool IsOpen(void) const { return (m_Data != nullptr); }
+
+	const char * GetData(void) const { return m_Data; }
+	size_t GetSize(void) const { return m_Size; }
+
+protected:
+	const char * m_Data;
+	size_t m_Size;
+
+	#ifdef _WIN32
+		HANDLE m_File;
+		HANDLE m_Mapping;
+	#endif
+} ;
+
+
+
+
@@ -7,7 +7,7 @@
 #include "Processor.h"
 #include "Callback.h"
 #include "../../src/WorldStorage/FastNBT.h"
-#include "zlib/zlib.h"
+#include "MappedFile.h"
 #include "Utils.h"
 
 
@@ -26,8 +26,10 @@ const int CHUNK_INFLATE_MAX = 1 MiB;
 cProcessor::cThread::cThread(cCallback & a_Callback, cProcessor & a_ParentProcessor) :
 	super("cProcessor::cThread"),
 	m_Callback(a_Callback),
-	m_ParentProcessor(a_ParentProcessor)
+	m_ParentProcessor(a_ParentProcessor),
+	m_Decompressed(CHUNK_INFLATE_MAX)
 {
+	memset(&m_Inflate, 0, sizeof(m_Inflate));
 	LOG("Created a new thread: %p", this);
 	super::Start();
 }
@@ -49,6 +51,7 @@ void cProcessor::cThread::Execute(void)
 {
 	LOG("Started a new thread: %p, ID %d", this, cIsThread::GetCurrentID());
 	
+	inflateInit(&m_Inflate);
 	m_HasStarted.Set();
 	
 	for (;;)
@@ -61,6 +64,7 @@ void cProcessor::cThread::Execute(void)
 		}
 		ProcessFile(FileName);
 	}  // for-ever
+	inflateEnd(&m_Inflate);
 	
 	LOG("Thread %p (ID %d) terminated", this, cIsThread::GetCurrentID());
 }
@@ -92,22 +96,20 @@ void cProcessor::cThread::ProcessFile(const AString & a_FileName)
 		return;
 	}
 	
-	cFile f;
-	if (!f.Open(a_FileName, cFile::fmRead))
+	// Map the file instead of reading it whole, only the sectors of the chunks that the callback wants get paged in:
+	cMappedFile File;
+	if (!File.Open(a_FileName))
 	{
 		LOG("Cannot open file \"%s\", skipping file.", a_FileName.c_str());
 		return;
 	}
-	
-	AString FileContents;
-	f.ReadRestOfFile(FileContents);
-	if (FileContents.size() < sizeof(8 KiB))
+	if (File.GetSize() < 8 KiB)
 	{
 		LOG("Cannot read header in file \"%s\", skipping file.", a_FileName.c_str());
 		return;
 	}
 	
-	ProcessFileData(FileContents.data(), FileContents.size(), RegionX * 32, RegionZ * 32);
+	ProcessFileData(File.GetData(), File.GetSize(), RegionX * 32, RegionZ * 32);
 	
 	m_Callback.OnRegionFinished(RegionX, RegionZ);
 }
@@ -133,7 +135,7 @@ void cProcessor::cThread::ProcessFileData(const char * a_FileData, size_t a_Size
 			((Location == 0) && (Timestamp == 0)) || // Official docs' "not present"
 			(Location >> 8 < 2)                   || // Logical - no chunk can start inside the header
 			((Location & 0xff) == 0)              || // Logical - no chunk can be zero bytes
-			((Location >> 8) * 4096 > a_Size)        // Logical - no chunk can start at beyond the file end
+			((Location >> 8) * 4096 + 5 > a_Size)    // Logical - no chunk can start at beyond the file end
 		)
 		{
 			// Chunk not present in the file
@@ -145,7 +147,7 @@ void cProcessor::cThread::ProcessFileData(const char * a_FileData, size_t a_Size
 		{
 			continue;
 		}
-		ProcessChunk(a_FileData, ChunkX, ChunkZ, Location >> 8, Location & 0xff, Timestamp);
+		ProcessChunk(a_FileData, a_Size, ChunkX, ChunkZ, Location >> 8, Location & 0xff, Timestamp);
 	}  // for i - chunk index
 }
 
@@ -153,7 +155,7 @@ void cProcessor::cThread::ProcessFileData(const char * a_FileData, size_t a_Size
 
 
 
-void cProcessor::cThread::ProcessChunk(const char * a_FileData, int a_ChunkX, int a_ChunkZ, unsigned a_SectorStart, unsigned a_SectorSize, unsigned a_TimeStamp)
+void cProcessor::cThread::ProcessChunk(const char * a_FileData, size_t a_FileSize, int a_ChunkX, int a_ChunkZ, unsigned a_SectorStart, unsigned a_SectorSize, unsigned a_TimeStamp)
 {
 	if (m_Callback.OnHeader(a_SectorStart * 4096, a_SectorSize, a_TimeStamp))
 	{
@@ -162,6 +164,15 @@ void cProcessor::cThread::ProcessChunk(const char * a_FileData, int a_ChunkX, in
 	
 	const char * ChunkStart = a_FileData + a_SectorStart * 4096;
 	int ByteSize = ntohl(*(int *)ChunkStart);
+	if (
+		(ByteSize <= 1) ||
+		(static_cast<unsigned>(ByteSize) + 4 > a_SectorSize * 4096) ||  // The data must fit the chunk's sectors...
+		(a_SectorStart * 4096 + 4 + static_cast<size_t>(ByteSize) > a_FileSize)  // ... and the mapped file
+	)
+	{
+		LOG("Bad chunk size, skipping chunk [%d, %d]", a_ChunkX, a_ChunkZ);
+		return;
+	}
 	char CompressionMethod = ChunkStart[4];
 	
 	if (m_Callback.OnCompressedDataSizePos(ByteSize, a_SectorStart * 4096 + 5, CompressionMethod))
@@ -178,31 +189,26 @@ void cProcessor::cThread::ProcessChunk(const char * a_FileData, int a_ChunkX, in
 
 void cProcessor::cThread::ProcessCompressedChunkData(int a_ChunkX, int a_ChunkZ, const char * a_CompressedData, int a_CompressedSize)
 {
-	char Decompressed[CHUNK_INFLATE_MAX];
-	z_stream strm;
-	strm.zalloc = (alloc_func)NULL;
-	strm.zfree = (free_func)NULL;
-	strm.opaque = NULL;
-	inflateInit(&strm);
-	strm.next_out  = (Bytef *)Decompressed;
-	strm.avail_out = sizeof(Decompressed);
-	strm.next_in   = (Bytef *)a_CompressedData;
-	strm.avail_in  = a_CompressedSize;
-	int res = inflate(&strm, Z_FINISH);
-	inflateEnd(&strm);
+	char * Decompressed = m_Decompressed.data();
+	inflateReset(&m_Inflate);
+	m_Inflate.next_out  = (Bytef *)Decompressed;
+	m_Inflate.avail_out = static_cast<uInt>(m_Decompressed.size());
+	m_Inflate.next_in   = (Bytef *)a_CompressedData;
+	m_Inflate.avail_in  = a_CompressedSize - 1;  // The size includes the compression method byte
+	int res = inflate(&m_Inflate, Z_FINISH);
 	if (res != Z_STREAM_END)
 	{
 		LOG("Decompression failed, skipping chunk [%d, %d]", a_ChunkX, a_ChunkZ);
 		return;
 	}
 	
-	if (m_Callback.OnDecompressedData(Decompressed, strm.total_out))
+	if (m_Callback.OnDecompressedData(Decompressed, m_Inflate.total_out))
 	{
 		return;
 	}
 
 	// Parse the NBT data:
-	cParsedNBT NBT(Decompressed, strm.total_out);
+	cParsedNBT NBT(Decompressed, m_Inflate.total_out, m_NBTTags);
 	if (!NBT.IsValid())
 	{
 		LOG("NBT Parsing failed, skipping chunk [%d, %d]", a_ChunkX, a_ChunkZ);
@@ -563,15 +569,24 @@ void cProcessor::PopulateFileQueue(const AString & a_WorldFolder)
 		Path.push_back(cFile::PathSeparator);
 	}
 	AStringVector AllFiles = cFile::GetFolderContents(Path.c_str());
+	std::vector<std::pair<int, AString>> Files;
 	for (AStringVector::iterator itr = AllFiles.begin(), end = AllFiles.end(); itr != end; ++itr)
 	{
-		if (itr->rfind(".mca") != itr->length() - 4)
+		if ((itr->length() < 4) || (itr->rfind(".mca") != itr->length() - 4))
 		{
 			// Not a .mca file
 			continue;
 		}
-		m_FileQueue.push_back(Path + *itr);
+		AString FileName = Path + *itr;
+		Files.push_back(std::make_pair(cFile::GetSize(FileName), FileName));
 	}  // for itr - AllFiles[]
+
+	// GetOneFileName() takes the files from the back, sort so that the largest is there:
+	std::sort(Files.begin(), Files.end());
+	for (auto & File: Files)
+	{
+		m_FileQueue.push_back(File.second);
+	}
 }
 
 
@@ -12,10 +12,16 @@
 
 
 
+#include "../../src/WorldStorage/FastNBT.h"
+#include "zlib/zlib.h"
+
+
+
+
+
 // fwd:
 class cCallback;
 class cCallbackFactory;
-class cParsedNBT;
 
 
 
@@ -31,13 +37,22 @@ class cProcessor
 		cCallback &  m_Callback;
 		cProcessor & m_ParentProcessor;
 		cEvent m_HasStarted;
+
+		/** The NBT tag storage reused for all the chunks processed by this thread. */
+		cFastNBTTags m_NBTTags;
+
+		/** The decompressor reused for all the chunks processed by this thread. Initialized in Execute(). */
+		z_stream m_Inflate;
+
+		/** The buffer for the decompressed chunk data, reused for all the chunks processed by this thread. */
+		std::vector<char> m_Decompressed;
 		
 		// cIsThread override:
 		virtual void Execute(void) override;
 		
 		void ProcessFile(const AString & a_FileName);
 		void ProcessFileData(const char * a_FileData, size_t a_Size, int a_ChunkBaseX, int a_ChunkBaseZ);
-		void ProcessChunk(const char * a_FileData, int a_ChunkX, int a_ChunkZ, unsigned a_SectorStart, unsigned a_SectorSize, unsigned a_TimeStamp);
+		void ProcessChunk(const char * a_FileData, size_t a_FileSize, int a_ChunkX, int a_ChunkZ, unsigned a_SectorStart, unsigned a_SectorSize, unsigned a_TimeStamp);
 		void ProcessCompressedChunkData(int a_ChunkX, int a_ChunkZ, const char * a_CompressedData, int a_CompressedSize);
 		void ProcessParsedChunkData(int a_ChunkX, int a_ChunkZ, cParsedNBT & a_NBT);
 		
@@ -71,10 +86,12 @@ protected:
 	cThreads m_Threads;
 
 
-	/** Populates m_FileQueue with Anvil files from the specified folder. */
+	/** Populates m_FileQueue with Anvil files from the specified folder.
+	The files are queued so that the largest ones are processed first; the smaller files then fill the threads' idle time
+	at the end, instead of a single thread crunching a large file while the others have nothing to do. */
 	void PopulateFileQueue(const AString & a_WorldFolder);
 	
-	/** Returns one filename from m_FileQueue, and removes the name from the queue. */
+	/** Returns one filename from m_FileQueue, the largest file remaining, and removes the name from the queue. */
 	AString GetOneFileName(void);
 } ;
 
@@ -0,0 +1,753 @@
+
+// Bot.cpp
+
+// Implements the cBot class representing a single headless client connected to the server
+
+#include "Globals.h"
+#include "Bot.h"
+#include "ByteBuffer.h"
+#include "Logger.h"
+
+
+
+
+
+/** The protocol version that the bots speak (1.8). */
+static const UInt32 PROTOCOL_VERSION = 47;
+
+/** The maximum number of bytes of each packet that are decompressed and parsed.
+The bots only read the fields at the start of the packets, so there's no need to inflate the whole chunk data. */
+static const size_t MAX_PACKET_HEAD = 2 KiB;
+
+/** The movement speed for the walk action, in blocks per second (vanilla walking speed). */
+static const double WALK_SPEED = 4.317;
+
+/** The movement speed for the fly action, in blocks per second (vanilla creative flying speed). */
+static const double FLY_SPEED = 10.89;
+
+/** The minimum time over which the server's tick rate is measured. The server sends the time updates every two seconds. */
+static const std::chrono::seconds TPS_MEASURE_TIME(5);
+
+
+
+
+
+/** Converts the hex digit into its value, returns -1 if the character is not a hex digit. */
+static int HexDigitValue(char a_Digit)
+{
+	if ((a_Digit >= '0') && (a_Digit <= '9'))
+	{
+		return a_Digit - '0';
+	}
+	if ((a_Digit >= 'a') && (a_Digit <= 'f'))
+	{
+		return a_Digit - 'a' + 10;
+	}
+	if ((a_Digit >= 'A') && (a_Digit <= 'F'))
+	{
+		return a_Digit - 'A' + 10;
+	}
+	return -1;
+}
+
+
+
+
+
+cBot::cBot(const AString & a_Name, const cBotScript & a_Script, int a_ViewDistance) :
+	m_Name(a_Name),
+	m_Script(a_Script),
+	m_ViewDistance(a_ViewDistance),
+	m_Socket(INVALID_SOCKET),
+	m_State(stLogin),
+	m_CompressionThreshold(-1),
+	m_HasSpawned(false),
+	m_PosX(0),
+	m_PosY(0),
+	m_PosZ(0),
+	m_ActionIdx(0),
+	m_IsFlying(false),
+	m_Ping(-1),
+	m_TPS(-1),
+	m_TPSWorldAge(0),
+	m_NumChunks(0),
+	m_NumBytesReceived(0)
+{
+	memset(m_UUID, 0, sizeof(m_UUID));
+	memset(&m_Inflate, 0, sizeof(m_Inflate));
+	inflateInit(&m_Inflate);
+}
+
+
+
+
+
+cBot::~cBot()
+{
+	Disconnect();
+	inflateEnd(&m_Inflate);
+}
+
+
+
+
+
+bool cBot::Connect(const sockaddr_in & a_Address)
+{
+	ASSERT(!IsConnected());
+	m_ConnectTime = cClock::now();
+	m_Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_Socket == INVALID_SOCKET)
+	{
+		LOGWARNING("%s: Cannot create a socket: %d", m_Name.c_str(), SocketError);
+		return false;
+	}
+	if (connect(m_Socket, reinterpret_cast<const sockaddr *>(&a_Address), sizeof(a_Address)) != 0)
+	{
+		LOGWARNING("%s: Connection to the server failed: %d", m_Name.c_str(), SocketError);
+		Disconnect();
+		return false;
+	}
+
+	// Send the handshake, switching to the login state, and the login start:
+	cByteBuffer Handshake(512);
+	Handshake.WriteVarInt32(PROTOCOL_VERSION);
+	Handshake.WriteVarUTF8String(inet_ntoa(a_Address.sin_addr));
+	Handshake.WriteBEUInt16(ntohs(a_Address.sin_port));
+	Handshake.WriteVarInt32(2);
+	cByteBuffer LoginStart(64);
+	LoginStart.WriteVarUTF8String(m_Name);
+	return SendPacket(0x00, Handshake) && SendPacket(0x00, LoginStart);
+}
+
+
+
+
+
+bool cBot::ReceiveData(void)
+{
+	char Buffer[64 KiB];
+	int NumBytes = static_cast<int>(recv(m_Socket, Buffer, sizeof(Buffer), 0));
+	if (NumBytes <= 0)
+	{
+		if ((NumBytes < 0) || m_KickReason.empty())
+		{
+			LOGWARNING("%s: The connection has been closed: %d", m_Name.c_str(), (NumBytes < 0) ? SocketError : 0);
+		}
+		Disconnect();
+		return false;
+	}
+	m_NumBytesReceived += static_cast<UInt64>(NumBytes);
+	m_ReceivedData.append(Buffer, static_cast<size_t>(NumBytes));
+	if (!ProcessReceivedData())
+	{
+		Disconnect();
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+bool cBot::Tick(cClock::time_point a_Now)
+{
+	if (!m_HasSpawned || !IsConnected())
+	{
+		return IsConnected();
+	}
+
+	double Elapsed = ToMsec(a_Now - m_LastTick) / 1000;
+	m_LastTick = a_Now;
+	const cBotScript::sAction & Action = m_Script.GetActions()[m_ActionIdx];
+	switch (Action.m_Type)
+	{
+		case cBotScript::atWalk:
+		{
+			double Length = sqrt(Action.m_X * Action.m_X + Action.m_Z * Action.m_Z);
+			if (Length > 0)
+			{
+				m_PosX += Action.m_X / Length * WALK_SPEED * Elapsed;
+				m_PosZ += Action.m_Z / Length * WALK_SPEED * Elapsed;
+			}
+			break;
+		}
+		case cBotScript::atFly:
+		{
+			double Length = sqrt(Action.m_X * Action.m_X + Action.m_Y * Action.m_Y + Action.m_Z * Action.m_Z);
+			if (Length > 0)
+			{
+				m_PosX += Action.m_X / Length * FLY_SPEED * Elapsed;
+				m_PosY += Action.m_Y / Length * FLY_SPEED * Elapsed;
+				m_PosZ += Action.m_Z / Length * FLY_SPEED * Elapsed;
+			}
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+	if (a_Now - m_ActionStart >= std::chrono::duration<double>(Action.m_Duration))
+	{
+		m_ActionIdx = (m_ActionIdx + 1) % m_Script.GetActions().size();
+		if (!StartAction(a_Now))
+		{
+			return false;
+		}
+	}
+	return SendPosition();
+}
+
+
+
+
+
+void cBot::Disconnect(void)
+{
+	if (m_Socket != INVALID_SOCKET)
+	{
+		closesocket(m_Socket);
+		m_Socket = INVALID_SOCKET;
+	}
+}
+
+
+
+
+
+double cBot::GetJoinTime(void) const
+{
+	return m_HasSpawned ? ToMsec(m_JoinTime - m_ConnectTime) : -1;
+}
+
+
+
+
+
+double cBot::GetFirstChunkTime(void) const
+{
+	return (m_NumChunks > 0) ? ToMsec(m_FirstChunkTime - m_ConnectTime) : -1;
+}
+
+
+
+
+
+double cBot::GetAllChunksTime(void) const
+{
+	return (m_AllChunksTime != cClock::time_point()) ? ToMsec(m_AllChunksTime - m_ConnectTime) : -1;
+}
+
+
+
+
+
+bool cBot::ProcessReceivedData(void)
+{
+	const Byte * Data = reinterpret_cast<const Byte *>(m_ReceivedData.data());
+	size_t Size = m_ReceivedData.size();
+	size_t Pos = 0;
+	while (Pos < Size)
+	{
+		UInt32 PacketLength;
+		size_t LengthSize = cByteBuffer::DecodeVarInt32(Data + Pos, Size - Pos, PacketLength);
+		if (LengthSize == 0)
+		{
+			if (Size - Pos >= cByteBuffer::MAX_VARINT32_SIZE)
+			{
+				LOGWARNING("%s: Received an invalid packet length", m_Name.c_str());
+				return false;
+			}
+			break;
+		}
+		if (Size - Pos - LengthSize < PacketLength)
+		{
+			// The packet hasn't been received whole yet
+			break;
+		}
+		const Byte * Packet = Data + Pos + LengthSize;
+		Pos += LengthSize + PacketLength;
+
+		// Skip the uncompressed data length, if compression is enabled:
+		UInt32 DataLength = 0;
+		if (m_CompressionThreshold >= 0)
+		{
+			size_t DataLengthSize = cByteBuffer::DecodeVarInt32(Packet, PacketLength, DataLength);
+			if (DataLengthSize == 0)
+			{
+				LOGWARNING("%s: Received an invalid compressed packet", m_Name.c_str());
+				return false;
+			}
+			Packet += DataLengthSize;
+			PacketLength -= static_cast<UInt32>(DataLengthSize);
+		}
+
+		// Inflate the head of the compressed packets:
+		Byte Head[MAX_PACKET_HEAD];
+		size_t HeadSize = std::min<size_t>(PacketLength, MAX_PACKET_HEAD);
+		if (DataLength > 0)
+		{
+			inflateReset(&m_Inflate);
+			m_Inflate.next_in = const_cast<Bytef *>(Packet);
+			m_Inflate.avail_in = PacketLength;
+			m_Inflate.next_out = Head;
+			m_Inflate.avail_out = static_cast<uInt>(std::min<size_t>(DataLength, MAX_PACKET_HEAD));
+			int res = inflate(&m_Inflate, Z_SYNC_FLUSH);
+			if ((res != Z_OK) && (res != Z_STREAM_END) && (res != Z_BUF_ERROR))
+			{
+				LOGWARNING("%s: Cannot decompress a packet: %d", m_Name.c_str(), res);
+				return false;
+			}
+			Packet = Head;
+			HeadSize = static_cast<size_t>(m_Inflate.total_out);
+		}
+
+		cByteBuffer PacketData(HeadSize + 1);
+		PacketData.Write(Packet, HeadSize);
+		if (!HandlePacket(PacketData))
+		{
+			return false;
+		}
+	}
+	m_ReceivedData.erase(0, Pos);
+	return true;
+}
+
+
+
+
+
+bool cBot::HandlePacket(cByteBuffer & a_Packet)
+{
+	UInt32 PacketType;
+	if (!a_Packet.ReadVarInt32(PacketType))
+	{
+		LOGWARNING("%s: Received an empty packet", m_Name.c_str());
+		return false;
+	}
+	switch (m_State)
+	{
+		case stLogin: return HandleLoginPacket(PacketType, a_Packet);
+		case stPlay:  return HandlePlayPacket(PacketType, a_Packet);
+	}
+	ASSERT(!"Unhandled bot state");
+	return false;
+}
+
+
+
+
+
+bool cBot::HandleLoginPacket(UInt32 a_PacketType, cByteBuffer & a_Packet)
+{
+	switch (a_PacketType)
+	{
+		case 0x00:  // Disconnect
+		{
+			a_Packet.ReadVarUTF8String(m_KickReason);
+			LOGWARNING("%s: Login refused by the server: %s", m_Name.c_str(), m_KickReason.c_str());
+			return false;
+		}
+		case 0x01:  // Encryption request
+		{
+			m_KickReason = "The server requires encryption";
+			LOGWARNING("%s: The server requires encryption, which the bots don't support. Turn the authentication off in the server's settings.ini.", m_Name.c_str());
+			return false;
+		}
+		case 0x02:  // Login success
+		{
+			AString UUID;
+			a_Packet.ReadVarUTF8String(UUID);
+			size_t Idx = 0;
+			for (size_t i = 0; (i + 1 < UUID.size()) && (Idx < ARRAYCOUNT(m_UUID)); i++)
+			{
+				int Hi = HexDigitValue(UUID[i]);
+				int Lo = HexDigitValue(UUID[i + 1]);
+				if ((Hi < 0) || (Lo < 0))
+				{
+					// Skip the dashes
+					continue;
+				}
+				m_UUID[Idx++] = static_cast<Byte>((Hi << 4) | Lo);
+				i++;
+			}
+			m_State = stPlay;
+
+			// Send the client settings, so that the server streams the requested view distance:
+			cByteBuffer Settings(64);
+			Settings.WriteVarUTF8String("en_US");
+			Settings.WriteBEUInt8(static_cast<UInt8>(m_ViewDistance));
+			Settings.WriteBEUInt8(0);     // Chat: enabled
+			Settings.WriteBool(false);    // Chat colors
+			Settings.WriteBEUInt8(0x7f);  // Displayed skin parts
+			return SendPacket(0x15, Settings);
+		}
+		case 0x03:  // Set compression
+		{
+			UInt32 Threshold;
+			if (!a_Packet.ReadVarInt32(Threshold))
+			{
+				return false;
+			}
+			m_CompressionThreshold = static_cast<int>(Threshold);
+			return true;
+		}
+	}
+	LOGWARNING("%s: Received an unknown login packet 0x%02x", m_Name.c_str(), a_PacketType);
+	return false;
+}
+
+
+
+
+
+bool cBot::HandlePlayPacket(UInt32 a_PacketType, cByteBuffer & a_Packet)
+{
+	switch (a_PacketType)
+	{
+		case 0x00:  // Keep alive
+		{
+			UInt32 KeepAliveID;
+			if (!a_Packet.ReadVarInt32(KeepAliveID))
+			{
+				return false;
+			}
+			cByteBuffer Response(8);
+			Response.WriteVarInt32(KeepAliveID);
+			return SendPacket(0x00, Response);
+		}
+		case 0x03:  // Time update
+		{
+			HandleTimeUpdate(a_Packet);
+			return true;
+		}
+		case 0x06:  // Update health
+		{
+			float Health;
+			if (a_Packet.ReadBEFloat(Health) && (Health <= 0))
+			{
+				// Respawn:
+				cByteBuffer Status(1);
+				Status.WriteBEUInt8(0);
+				return SendPacket(0x16, Status);
+			}
+			return true;
+		}
+		case 0x08:  // Player position and look
+		{
+			double X, Y, Z;
+			float Yaw, Pitch;
+			UInt8 Flags;
+			if (
+				!a_Packet.ReadBEDouble(X) || !a_Packet.ReadBEDouble(Y) || !a_Packet.ReadBEDouble(Z) ||
+				!a_Packet.ReadBEFloat(Yaw) || !a_Packet.ReadBEFloat(Pitch) || !a_Packet.ReadBEUInt8(Flags)
+			)
+			{
+				return false;
+			}
+			m_PosX = ((Flags & 0x01) != 0) ? (m_PosX + X) : X;
+			m_PosY = ((Flags & 0x02) != 0) ? (m_PosY + Y) : Y;
+			m_PosZ = ((Flags & 0x04) != 0) ? (m_PosZ + Z) : Z;
+			if (!m_HasSpawned)
+			{
+				m_HasSpawned = true;
+				m_JoinTime = cClock::now();
+				m_LastTick = m_JoinTime;
+				m_ActionIdx = 0;
+				if (!StartAction(m_JoinTime))
+				{
+					return false;
+				}
+			}
+			return SendPosition();
+		}
+		case 0x21:  // Chunk data
+		{
+			Int32 ChunkX, ChunkZ;
+			bool IsGroundUp;
+			UInt16 BitMask;
+			if (
+				a_Packet.ReadBEInt32(ChunkX) && a_Packet.ReadBEInt32(ChunkZ) &&
+				a_Packet.ReadBool(IsGroundUp) && a_Packet.ReadBEUInt16(BitMask) &&
+				(BitMask != 0)  // The empty bitmask unloads the chunk
+			)
+			{
+				HandleChunks(1);
+			}
+			return true;
+		}
+		case 0x26:  // Map chunk bulk
+		{
+			bool HasSkyLight;
+			UInt32 NumChunks;
+			if (a_Packet.ReadBool(HasSkyLight) && a_Packet.ReadVarInt32(NumChunks))
+			{
+				HandleChunks(NumChunks);
+			}
+			return true;
+		}
+		case 0x38:  // Player list item
+		{
+			HandlePlayerListItem(a_Packet);
+			return true;
+		}
+		case 0x40:  // Disconnect
+		{
+			a_Packet.ReadVarUTF8String(m_KickReason);
+			LOGWARNING("%s: Kicked by the server: %s", m_Name.c_str(), m_KickReason.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+void cBot::HandleChunks(UInt64 a_NumChunks)
+{
+	cClock::time_point Now = cClock::now();
+	if (m_NumChunks == 0)
+	{
+		m_FirstChunkTime = Now;
+	}
+	m_NumChunks += a_NumChunks;
+	UInt64 NumInitialChunks = static_cast<UInt64>((2 * m_ViewDistance + 1) * (2 * m_ViewDistance + 1));
+	if ((m_AllChunksTime == cClock::time_point()) && (m_NumChunks >= NumInitialChunks))
+	{
+		m_AllChunksTime = Now;
+	}
+}
+
+
+
+
+
+void cBot::HandlePlayerListItem(cByteBuffer & a_Packet)
+{
+	UInt32 Action, NumPlayers;
+	if (!a_Packet.ReadVarInt32(Action) || (Action != 2) || !a_Packet.ReadVarInt32(NumPlayers))
+	{
+		// Not a latency update
+		return;
+	}
+	for (UInt32 i = 0; i < NumPlayers; i++)
+	{
+		Byte UUID[16];
+		UInt32 Ping;
+		if (!a_Packet.ReadBuf(UUID, sizeof(UUID)) || !a_Packet.ReadVarInt32(Ping))
+		{
+			return;
+		}
+		if (memcmp(UUID, m_UUID, sizeof(UUID)) == 0)
+		{
+			m_Ping = static_cast<int>(Ping);
+		}
+	}
+}
+
+
+
+
+
+void cBot::HandleTimeUpdate(cByteBuffer & a_Packet)
+{
+	Int64 WorldAge;
+	if (!a_Packet.ReadBEInt64(WorldAge))
+	{
+		return;
+	}
+	cClock::time_point Now = cClock::now();
+	if (m_TPSTime == cClock::time_point())
+	{
+		m_TPSWorldAge = WorldAge;
+		m_TPSTime = Now;
+		return;
+	}
+	if (Now - m_TPSTime < TPS_MEASURE_TIME)
+	{
+		return;
+	}
+	m_TPS = static_cast<double>(WorldAge - m_TPSWorldAge) * 1000 / ToMsec(Now - m_TPSTime);
+	m_TPSWorldAge = WorldAge;
+	m_TPSTime = Now;
+}
+
+
+
+
+
+bool cBot::SendPacket(UInt32 a_PacketType, cByteBuffer & a_Payload)
+{
+	if (!IsConnected())
+	{
+		return false;
+	}
+
+	AString Payload;
+	a_Payload.ReadAll(Payload);
+	a_Payload.CommitRead();
+	Byte Header[3 * cByteBuffer::MAX_VARINT32_SIZE];
+	Byte Type[cByteBuffer::MAX_VARINT32_SIZE];
+	size_t TypeSize = cByteBuffer::EncodeVarInt32(a_PacketType, Type);
+	size_t HeaderSize;
+	if (m_CompressionThreshold >= 0)
+	{
+		// The data length of 0 marks the packet as uncompressed:
+		HeaderSize = cByteBuffer::EncodeVarInt32(static_cast<UInt32>(1 + TypeSize + Payload.size()), Header);
+		Header[HeaderSize++] = 0;
+	}
+	else
+	{
+		HeaderSize = cByteBuffer::EncodeVarInt32(static_cast<UInt32>(TypeSize + Payload.size()), Header);
+	}
+	memcpy(Header + HeaderSize, Type, TypeSize);
+	HeaderSize += TypeSize;
+	Payload.insert(0, reinterpret_cast<const char *>(Header), HeaderSize);
+
+	// The packets are small, the blocking socket sends them whole:
+	int NumSent = static_cast<int>(send(m_Socket, Payload.data(), Payload.size(), 0));
+	if (NumSent != static_cast<int>(Payload.size()))
+	{
+		LOGWARNING("%s: Cannot send data to the server: %d", m_Name.c_str(), SocketError);
+		Disconnect();
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+bool cBot::StartAction(cClock::time_point a_Now)
+{
+	const cBotScript::cActions & Actions = m_Script.GetActions();
+
+	// Perform the instant actions, up to the next one that takes time (at most one loop over the script):
+	for (size_t i = 0; i < Actions.size(); i++)
+	{
+		const cBotScript::sAction & Action = Actions[m_ActionIdx];
+		m_ActionStart = a_Now;
+		switch (Action.m_Type)
+		{
+			case cBotScript::atWait:
+			{
+				return true;
+			}
+			case cBotScript::atWalk:
+			{
+				if (m_IsFlying)
+				{
+					return SendAbilities(false);
+				}
+				return true;
+			}
+			case cBotScript::atFly:
+			{
+				if (!m_IsFlying)
+				{
+					return SendAbilities(true);
+				}
+				return true;
+			}
+			case cBotScript::atDig:
+			{
+				if (!SendDig(
+					static_cast<int>(floor(m_PosX + Action.m_X)),
+					static_cast<int>(floor(m_PosY + Action.m_Y)),
+					static_cast<int>(floor(m_PosZ + Action.m_Z))
+				))
+				{
+					return false;
+				}
+				break;
+			}
+			case cBotScript::atChat:
+			{
+				AString Message = Action.m_Text;
+				ReplaceString(Message, "%name%", m_Name);
+				if (!SendChat(Message))
+				{
+					return false;
+				}
+				break;
+			}
+		}
+		m_ActionIdx = (m_ActionIdx + 1) % Actions.size();
+	}
+	return true;
+}
+
+
+
+
+
+bool cBot::SendPosition(void)
+{
+	cByteBuffer Position(32);
+	Position.WriteBEDouble(m_PosX);
+	Position.WriteBEDouble(m_PosY);
+	Position.WriteBEDouble(m_PosZ);
+	Position.WriteBool(!m_IsFlying);
+	return SendPacket(0x04, Position);
+}
+
+
+
+
+
+bool cBot::SendAbilities(bool a_IsFlying)
+{
+	m_IsFlying = a_IsFlying;
+	cByteBuffer Abilities(16);
+	Abilities.WriteBEUInt8(a_IsFlying ? 0x02 : 0x00);
+	Abilities.WriteBEFloat(0.05f);  // Flying speed
+	Abilities.WriteBEFloat(0.1f);   // Walking speed
+	return SendPacket(0x13, Abilities);
+}
+
+
+
+
+
+bool cBot::SendDig(int a_BlockX, int a_BlockY, int a_BlockZ)
+{
+	// Send both the start and the finish, the server checks the digging time itself:
+	cByteBuffer StartDig(16);
+	StartDig.WriteBEUInt8(0);
+	StartDig.WritePosition64(a_BlockX, a_BlockY, a_BlockZ);
+	StartDig.WriteBEUInt8(1);  // Face: top
+	cByteBuffer FinishDig(16);
+	FinishDig.WriteBEUInt8(2);
+	FinishDig.WritePosition64(a_BlockX, a_BlockY, a_BlockZ);
+	FinishDig.WriteBEUInt8(1);
+	return SendPacket(0x07, StartDig) && SendPacket(0x07, FinishDig);
+}
+
+
+
+
+
+bool cBot::SendChat(const AString & a_Message)
+{
+	cByteBuffer Chat(128);
+	Chat.WriteVarUTF8String(a_Message.substr(0, 100));  // The vanilla limit
+	return SendPacket(0x01, Chat);
+}
+
+
+
+
+
+double cBot::ToMsec(cClock::duration a_Duration)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(a_Duration).count() / 1000.0;
+}
+
+
+
+
@@ -0,0 +1,176 @@
+
+// Bot.h
+
+// Declares the cBot class representing a single headless client connected to the server
+
+#pragma once
+
+#include "BotScript.h"
+#include "zlib/zlib.h"
+
+
+
+
+
+class cByteBuffer;
+
+
+
+
+
+/** A single bot connected to the server over the 1.8 protocol (47).
+The bot logs in without encryption, so the server needs to run with the authentication turned off. After spawning, it
+performs the actions of the script over and over, sending its position each tick the way the vanilla client does.
+There's no physics simulation; the server is trusted to clamp the movement it doesn't like.
+The bot measures its join time, the arrival of its initial chunks, keeps the keep-alive ping that the server broadcasts
+in the player list and the server's tick rate derived from the time updates.
+The bots don't own any thread, the caller is expected to select() on their sockets and call ReceiveData() and Tick(). */
+class cBot
+{
+public:
+	typedef std::chrono::steady_clock cClock;
+
+
+	cBot(const AString & a_Name, const cBotScript & a_Script, int a_ViewDistance);
+	~cBot();
+
+	/** Connects to the server at the address (blocking) and sends the login packets.
+	Returns false and logs the reason if the connection fails. */
+	bool Connect(const sockaddr_in & a_Address);
+
+	/** Reads the data waiting on the socket and processes all the complete packets in it.
+	Returns false if the connection has been closed, either by the server or because of a protocol error. */
+	bool ReceiveData(void);
+
+	/** Performs the current script action and sends the position update. Does nothing until the bot has spawned.
+	Returns false if the connection has been closed. */
+	bool Tick(cClock::time_point a_Now);
+
+	/** Closes the connection, if still open. */
+	void Disconnect(void);
+
+	const AString & GetName(void) const { return m_Name; }
+	SOCKET GetSocket(void) const { return m_Socket; }
+	bool IsConnected(void) const { return (m_Socket != INVALID_SOCKET); }
+	bool HasSpawned(void) const { return m_HasSpawned; }
+
+	/** Returns the time between connecting and receiving the spawn position, in milliseconds, or -1 if not spawned yet. */
+	double GetJoinTime(void) const;
+
+	/** Returns the time between connecting and receiving the first chunk, in milliseconds, or -1 if no chunk has arrived yet. */
+	double GetFirstChunkTime(void) const;
+
+	/** Returns the time between connecting and receiving all the chunks within the view distance, in milliseconds,
+	or -1 if they haven't all arrived yet. */
+	double GetAllChunksTime(void) const;
+
+	/** Returns the bot's keep-alive round trip time as measured by the server, in milliseconds, or -1 if not known yet. */
+	int GetPing(void) const { return m_Ping; }
+
+	/** Returns the server's ticks per second averaged over the last few time updates, or -1 if not known yet. */
+	double GetTPS(void) const { return m_TPS; }
+
+	/** Returns the number of chunks received so far. */
+	UInt64 GetNumChunks(void) const { return m_NumChunks; }
+
+	/** Returns the number of bytes received so far. */
+	UInt64 GetNumBytesReceived(void) const { return m_NumBytesReceived; }
+
+	/** Returns the reason of the disconnect sent by the server, or empty if the server hasn't kicked the bot. */
+	const AString & GetKickReason(void) const { return m_KickReason; }
+
+protected:
+	enum eState
+	{
+		stLogin,
+		stPlay,
+	} ;
+
+
+	AString m_Name;
+
+	const cBotScript & m_Script;
+
+	int m_ViewDistance;
+
+	SOCKET m_Socket;
+
+	eState m_State;
+
+	/** The compression threshold received from the server, or -1 if the compression is disabled. */
+	int m_CompressionThreshold;
+
+	/** The data received from the server that doesn't form a complete packet yet. */
+	AString m_ReceivedData;
+
+	/** The decompressor reused for all the compressed packets. */
+	z_stream m_Inflate;
+
+	/** The bot's UUID received in the login success packet, in the binary form used by the player list packets. */
+	Byte m_UUID[16];
+
+	bool m_HasSpawned;
+
+	/** The bot's position (feet). */
+	double m_PosX, m_PosY, m_PosZ;
+
+	/** Index of the script action currently being performed. */
+	size_t m_ActionIdx;
+
+	/** When the current script action has started. */
+	cClock::time_point m_ActionStart;
+
+	/** When the last tick has been performed, for the movement speed calculation. */
+	cClock::time_point m_LastTick;
+
+	bool m_IsFlying;
+
+	cClock::time_point m_ConnectTime;
+	cClock::time_point m_JoinTime;
+	cClock::time_point m_FirstChunkTime;
+	cClock::time_point m_AllChunksTime;
+
+	int m_Ping;
+
+	double m_TPS;
+
+	/** The world age and the time of arrival of the time update that the TPS is measured from. */
+	Int64 m_TPSWorldAge;
+	cClock::time_point m_TPSTime;
+
+	UInt64 m_NumChunks;
+	UInt64 m_NumBytesReceived;
+
+	AString m_KickReason;
+
+
+	/** Processes all the complete packets in m_ReceivedData. Returns false on a protocol error. */
+	bool ProcessReceivedData(void);
+
+	/** Handles a single packet; a_Packet holds its head (at least the packet ID and the fields that the bot reads). */
+	bool HandlePacket(cByteBuffer & a_Packet);
+
+	bool HandleLoginPacket(UInt32 a_PacketType, cByteBuffer & a_Packet);
+	bool HandlePlayPacket(UInt32 a_PacketType, cByteBuffer & a_Packet);
+
+	void HandleChunks(UInt64 a_NumChunks);
+	void HandlePlayerListItem(cByteBuffer & a_Packet);
+	void HandleTimeUpdate(cByteBuffer & a_Packet);
+
+	/** Sends the packet, framing it according to the current compression state (the bots never compress). */
+	bool SendPacket(UInt32 a_PacketType, cByteBuffer & a_Payload);
+
+	/** Starts the script action at m_ActionIdx, performing it immediately if it is instant. */
+	bool StartAction(cClock::time_point a_Now);
+
+	bool SendPosition(void);
+	bool SendAbilities(bool a_IsFlying);
+	bool SendDig(int a_BlockX, int a_BlockY, int a_BlockZ);
+	bool SendChat(const AString & a_Message);
+
+	static double ToMsec(cClock::duration a_Duration);
+} ;
+
+
+
+
@@ -0,0 +1,404 @@
+
+// BotLoad.cpp
+
+// Implements the main app entrypoint: spawns the bots, runs their network loop and reports the measured stats
+
+#include "Globals.h"
+#include "Bot.h"
+#include "BotScript.h"
+#include "Logger.h"
+#include "LoggerListeners.h"
+
+
+
+
+
+/** The interval at which the bots tick, same as the server's tick. */
+static const std::chrono::milliseconds TICK_INTERVAL(50);
+
+/** The interval at which the running stats are reported. */
+static const std::chrono::seconds REPORT_INTERVAL(5);
+
+
+
+
+
+/** The parameters of the run, as given on the commandline. */
+struct sOptions
+{
+	AString m_Host;
+	int m_Port;
+	int m_NumBots;
+	double m_SpawnRate;
+	int m_Duration;
+	AString m_ScriptFile;
+	int m_ViewDistance;
+	AString m_NamePrefix;
+
+	sOptions(void) :
+		m_Host("localhost"),
+		m_Port(25565),
+		m_NumBots(100),
+		m_SpawnRate(10),
+		m_Duration(60),
+		m_ViewDistance(4),
+		m_NamePrefix("Bot")
+	{
+	}
+} ;
+
+typedef std::vector<std::unique_ptr<cBot>> cBots;
+
+
+
+
+
+static double ToSeconds(cBot::cClock::duration a_Duration)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(a_Duration).count() / 1000000.0;
+}
+
+
+
+
+
+static void PrintUsage(void)
+{
+	printf("Usage: BotLoad [options]\n");
+	printf("  -host <name>      The server to connect to (default: localhost)\n");
+	printf("  -port <number>    The server's port (default: 25565)\n");
+	printf("  -bots <number>    The number of bots to spawn (default: 100)\n");
+	printf("  -rate <number>    The number of bots spawned per second (default: 10)\n");
+	printf("  -time <seconds>   How long to run, counted from the start (default: 60)\n");
+	printf("  -script <file>    The script for the bots to perform (default: the built-in script)\n");
+	printf("  -view <chunks>    The view distance that the bots request (default: 4)\n");
+	printf("  -prefix <text>    The prefix of the bots' names (default: Bot)\n");
+}
+
+
+
+
+
+/** Parses the commandline into a_Options. Returns false if the commandline is invalid. */
+static bool ParseCommandLine(int argc, char ** argv, sOptions & a_Options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 >= argc)
+		{
+			return false;
+		}
+		AString Option = argv[i];
+		AString Value = argv[++i];
+		if (NoCaseCompare(Option, "-host") == 0)
+		{
+			a_Options.m_Host = Value;
+		}
+		else if (NoCaseCompare(Option, "-port") == 0)
+		{
+			a_Options.m_Port = atoi(Value.c_str());
+		}
+		else if (NoCaseCompare(Option, "-bots") == 0)
+		{
+			a_Options.m_NumBots = atoi(Value.c_str());
+		}
+		else if (NoCaseCompare(Option, "-rate") == 0)
+		{
+			a_Options.m_SpawnRate = atof(Value.c_str());
+		}
+		else if (NoCaseCompare(Option, "-time") == 0)
+		{
+			a_Options.m_Duration = atoi(Value.c_str());
+		}
+		else if (NoCaseCompare(Option, "-script") == 0)
+		{
+			a_Options.m_ScriptFile = Value;
+		}
+		else if (NoCaseCompare(Option, "-view") == 0)
+		{
+			a_Options.m_ViewDistance = atoi(Value.c_str());
+		}
+		else if (NoCaseCompare(Option, "-prefix") == 0)
+		{
+			a_Options.m_NamePrefix = Value;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return (
+		(a_Options.m_Port > 0) && (a_Options.m_Port < 65536) &&
+		(a_Options.m_NumBots > 0) && (a_Options.m_SpawnRate > 0) && (a_Options.m_Duration > 0) &&
+		(a_Options.m_ViewDistance > 0) && (a_Options.m_ViewDistance < 128)
+	);
+}
+
+
+
+
+
+/** Prints the min / avg / median / 95th percentile / max of the values, ignoring the negative ones (not measured). */
+static void PrintDistribution(const char * a_Name, const char * a_Unit, std::vector<double> a_Values)
+{
+	a_Values.erase(std::remove_if(a_Values.begin(), a_Values.end(), [](double a_Value) { return (a_Value < 0); }), a_Values.end());
+	if (a_Values.empty())
+	{
+		printf("  %-20s not measured\n", a_Name);
+		return;
+	}
+	std::sort(a_Values.begin(), a_Values.end());
+	double Sum = 0;
+	for (auto Value: a_Values)
+	{
+		Sum += Value;
+	}
+	size_t Count = a_Values.size();
+	printf("  %-20s min %9.2f, avg %9.2f, median %9.2f, p95 %9.2f, max %9.2f %s (%u bots)\n",
+		a_Name, a_Values.front(), Sum / Count, a_Values[Count / 2], a_Values[(Count * 95) / 100], a_Values.back(),
+		a_Unit, static_cast<unsigned>(Count)
+	);
+}
+
+
+
+
+
+/** Returns the median of the non-negative values, or -1 if there are none. */
+static double GetMedian(std::vector<double> a_Values)
+{
+	a_Values.erase(std::remove_if(a_Values.begin(), a_Values.end(), [](double a_Value) { return (a_Value < 0); }), a_Values.end());
+	if (a_Values.empty())
+	{
+		return -1;
+	}
+	std::nth_element(a_Values.begin(), a_Values.begin() + a_Values.size() / 2, a_Values.end());
+	return a_Values[a_Values.size() / 2];
+}
+
+
+
+
+
+/** Prints the running stats; a_LastNumChunks and a_LastNumBytes hold the totals from the previous report and are updated. */
+static void PrintReport(const cBots & a_Bots, double a_Elapsed, double a_Interval, UInt64 & a_LastNumChunks, UInt64 & a_LastNumBytes)
+{
+	unsigned NumConnected = 0, NumSpawned = 0, NumPings = 0;
+	UInt64 NumChunks = 0, NumBytes = 0;
+	double PingSum = 0;
+	std::vector<double> TPS;
+	for (const auto & Bot: a_Bots)
+	{
+		NumChunks += Bot->GetNumChunks();
+		NumBytes += Bot->GetNumBytesReceived();
+		if (!Bot->IsConnected())
+		{
+			continue;
+		}
+		NumConnected += 1;
+		if (Bot->HasSpawned())
+		{
+			NumSpawned += 1;
+		}
+		if (Bot->GetPing() >= 0)
+		{
+			PingSum += Bot->GetPing();
+			NumPings += 1;
+		}
+		TPS.push_back(Bot->GetTPS());
+	}
+	printf("[%6.1f s] %u bots connected, %u spawned; %.1f chunks/s, %.1f KiB/s received; avg ping %.1f ms; median TPS %.2f\n",
+		a_Elapsed, NumConnected, NumSpawned,
+		(NumChunks - a_LastNumChunks) / a_Interval, (NumBytes - a_LastNumBytes) / a_Interval / 1024,
+		(NumPings > 0) ? (PingSum / NumPings) : -1.0,
+		GetMedian(TPS)
+	);
+	a_LastNumChunks = NumChunks;
+	a_LastNumBytes = NumBytes;
+}
+
+
+
+
+
+static void PrintSummary(const cBots & a_Bots, double a_Elapsed)
+{
+	std::vector<double> JoinTimes, FirstChunkTimes, AllChunksTimes, Pings, TPS;
+	unsigned NumConnected = 0, NumKicked = 0;
+	UInt64 NumChunks = 0, NumBytes = 0;
+	for (const auto & Bot: a_Bots)
+	{
+		JoinTimes.push_back(Bot->GetJoinTime());
+		FirstChunkTimes.push_back(Bot->GetFirstChunkTime());
+		AllChunksTimes.push_back(Bot->GetAllChunksTime());
+		Pings.push_back(Bot->GetPing());
+		TPS.push_back(Bot->GetTPS());
+		NumChunks += Bot->GetNumChunks();
+		NumBytes += Bot->GetNumBytesReceived();
+		if (Bot->IsConnected())
+		{
+			NumConnected += 1;
+		}
+		else if (!Bot->GetKickReason().empty())
+		{
+			NumKicked += 1;
+		}
+	}
+	printf("\nSummary after %.1f s: %u bots spawned, %u still connected, %u kicked by the server\n",
+		a_Elapsed, static_cast<unsigned>(a_Bots.size()), NumConnected, NumKicked
+	);
+	printf("  %llu chunks and %.1f MiB received in total\n",
+		static_cast<unsigned long long>(NumChunks), static_cast<double>(NumBytes) / (1024 * 1024)
+	);
+	PrintDistribution("Join time", "ms", JoinTimes);
+	PrintDistribution("First chunk", "ms", FirstChunkTimes);
+	PrintDistribution("All initial chunks", "ms", AllChunksTimes);
+	PrintDistribution("Keep-alive RTT", "ms", Pings);
+	PrintDistribution("Server TPS", "", TPS);
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	// Initialize logging subsystem:
+	cLogger::InitiateMultithreading();
+	auto consoleLogListener = MakeConsoleListener();
+	cLogger::GetInstance().AttachListener(consoleLogListener);
+
+	sOptions Options;
+	if (!ParseCommandLine(argc, argv, Options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// select() can only handle a limited number of sockets:
+	if (Options.m_NumBots > FD_SETSIZE - 16)
+	{
+		LOGWARNING("Too many bots requested, limiting to %d", FD_SETSIZE - 16);
+		Options.m_NumBots = FD_SETSIZE - 16;
+	}
+
+	cBotScript Script;
+	if (!Options.m_ScriptFile.empty() && !Script.Load(Options.m_ScriptFile))
+	{
+		return 2;
+	}
+
+	#ifdef _WIN32
+		WSADATA wsa;
+		int res = WSAStartup(0x0202, &wsa);
+		if (res != 0)
+		{
+			LOGERROR("Cannot initialize WinSock: %d", res);
+			return 3;
+		}
+	#endif  // _WIN32
+
+	hostent * Host = gethostbyname(Options.m_Host.c_str());
+	if ((Host == nullptr) || (Host->h_addrtype != AF_INET))
+	{
+		LOGERROR("Cannot resolve the server address \"%s\"", Options.m_Host.c_str());
+		return 4;
+	}
+	sockaddr_in Address;
+	memset(&Address, 0, sizeof(Address));
+	Address.sin_family = AF_INET;
+	Address.sin_port = htons(static_cast<u_short>(Options.m_Port));
+	memcpy(&Address.sin_addr, Host->h_addr_list[0], sizeof(Address.sin_addr));
+	printf("Spawning %d bots at %s:%d, %.1f bots per second, running for %d seconds.\n",
+		Options.m_NumBots, Options.m_Host.c_str(), Options.m_Port, Options.m_SpawnRate, Options.m_Duration
+	);
+
+	cBots Bots;
+	Bots.reserve(static_cast<size_t>(Options.m_NumBots));
+	cBot::cClock::time_point Start = cBot::cClock::now();
+	cBot::cClock::time_point End = Start + std::chrono::seconds(Options.m_Duration);
+	cBot::cClock::time_point NextTick = Start + TICK_INTERVAL;
+	cBot::cClock::time_point NextReport = Start + REPORT_INTERVAL;
+	cBot::cClock::duration SpawnInterval = std::chrono::duration_cast<cBot::cClock::duration>(std::chrono::duration<double>(1 / Options.m_SpawnRate));
+	UInt64 LastNumChunks = 0, LastNumBytes = 0;
+	for (;;)
+	{
+		cBot::cClock::time_point Now = cBot::cClock::now();
+		if (Now >= End)
+		{
+			break;
+		}
+
+		// Spawn the bots that are due:
+		while ((Bots.size() < static_cast<size_t>(Options.m_NumBots)) && (Start + SpawnInterval * static_cast<int>(Bots.size()) <= Now))
+		{
+			std::unique_ptr<cBot> Bot(new cBot(Printf("%s%d", Options.m_NamePrefix.c_str(), static_cast<int>(Bots.size())), Script, Options.m_ViewDistance));
+			Bot->Connect(Address);
+			Bots.push_back(std::move(Bot));
+		}
+
+		// Wait for the data from the server, up to the next tick:
+		fd_set ReadFDs;
+		FD_ZERO(&ReadFDs);
+		SOCKET MaxSocket = 0;
+		for (const auto & Bot: Bots)
+		{
+			if (Bot->IsConnected())
+			{
+				FD_SET(Bot->GetSocket(), &ReadFDs);
+				MaxSocket = std::max(MaxSocket, Bot->GetSocket());
+			}
+		}
+		long long WaitUsec = std::max<long long>(0, std::chrono::duration_cast<std::chrono::microseconds>(NextTick - Now).count());
+		timeval Timeout;
+		Timeout.tv_sec = 0;
+		Timeout.tv_usec = static_cast<long>(WaitUsec);
+		if (MaxSocket == 0)
+		{
+			// No sockets to wait on (select() on Windows fails with an empty set)
+			std::this_thread::sleep_for(std::chrono::microseconds(WaitUsec));
+		}
+		else if (select(static_cast<int>(MaxSocket + 1), &ReadFDs, nullptr, nullptr, &Timeout) > 0)
+		{
+			for (const auto & Bot: Bots)
+			{
+				if (Bot->IsConnected() && FD_ISSET(Bot->GetSocket(), &ReadFDs))
+				{
+					Bot->ReceiveData();
+				}
+			}
+		}
+
+		// Tick the bots, skipping the ticks that the loop is late for:
+		Now = cBot::cClock::now();
+		if (Now >= NextTick)
+		{
+			for (const auto & Bot: Bots)
+			{
+				Bot->Tick(Now);
+			}
+			NextTick += TICK_INTERVAL;
+			if (NextTick < Now)
+			{
+				NextTick = Now + TICK_INTERVAL;
+			}
+		}
+
+		if (Now >= NextReport)
+		{
+			PrintReport(Bots, ToSeconds(Now - Start), ToSeconds(REPORT_INTERVAL), LastNumChunks, LastNumBytes);
+			NextReport += REPORT_INTERVAL;
+		}
+	}
+
+	PrintSummary(Bots, ToSeconds(cBot::cClock::now() - Start));
+	for (const auto & Bot: Bots)
+	{
+		Bot->Disconnect();
+	}
+	return 0;
+}
+
+
+
+
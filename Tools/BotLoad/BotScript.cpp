@@ -0,0 +1,174 @@
+
+// BotScript.cpp
+
+// Implements the cBotScript class representing the list of actions that each bot repeats
+
+#include "Globals.h"
+#include "BotScript.h"
+#include "Logger.h"
+
+
+
+
+
+/** Parses a_Text as a floating point number into a_Value. Returns false if the text is not a number. */
+static bool ParseNumber(const AString & a_Text, double & a_Value)
+{
+	if (a_Text.empty())
+	{
+		return false;
+	}
+	char * End = nullptr;
+	a_Value = strtod(a_Text.c_str(), &End);
+	return (*End == 0);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cBotScript::sAction:
+
+cBotScript::sAction::sAction(eActionType a_Type, double a_X, double a_Y, double a_Z, double a_Duration, const AString & a_Text) :
+	m_Type(a_Type),
+	m_X(a_X),
+	m_Y(a_Y),
+	m_Z(a_Z),
+	m_Duration(a_Duration),
+	m_Text(a_Text)
+{
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cBotScript:
+
+cBotScript::cBotScript(void)
+{
+	m_Actions.push_back(sAction(atWalk,  1, 0,  0, 4));
+	m_Actions.push_back(sAction(atChat,  0, 0,  0, 0, "Hello from %name%"));
+	m_Actions.push_back(sAction(atWalk,  0, 0,  1, 4));
+	m_Actions.push_back(sAction(atDig,   0, -1, 0, 0));
+	m_Actions.push_back(sAction(atWalk, -1, 0,  0, 4));
+	m_Actions.push_back(sAction(atFly,   0, 1,  0, 2));
+	m_Actions.push_back(sAction(atWait,  0, 0,  0, 1));
+	m_Actions.push_back(sAction(atFly,   0, -1, 0, 2));
+	m_Actions.push_back(sAction(atWalk,  0, 0, -1, 4));
+	m_Actions.push_back(sAction(atWait,  0, 0,  0, 2));
+}
+
+
+
+
+
+bool cBotScript::Load(const AString & a_FileName)
+{
+	if (!cFile::IsFile(a_FileName))
+	{
+		LOGERROR("Cannot open the script file \"%s\".", a_FileName.c_str());
+		return false;
+	}
+	AStringVector Lines = StringSplit(cFile::ReadWholeFile(a_FileName), "\n");
+	cActions Actions;
+	int LineNum = 0;
+	for (AStringVector::const_iterator itr = Lines.begin(), end = Lines.end(); itr != end; ++itr)
+	{
+		LineNum += 1;
+		AString Line = TrimString(*itr);
+		if (Line.empty() || (Line[0] == '#'))
+		{
+			continue;
+		}
+		if (!ParseLine(Line, Actions))
+		{
+			LOGERROR("Invalid action in the script file \"%s\", line %d: \"%s\"", a_FileName.c_str(), LineNum, Line.c_str());
+			return false;
+		}
+	}
+	if (Actions.empty())
+	{
+		LOGERROR("The script file \"%s\" contains no actions.", a_FileName.c_str());
+		return false;
+	}
+	std::swap(m_Actions, Actions);
+	return true;
+}
+
+
+
+
+
+bool cBotScript::ParseLine(const AString & a_Line, cActions & a_Actions)
+{
+	AStringVector Split = StringSplitAndTrim(a_Line, " \t");
+	Split.erase(std::remove(Split.begin(), Split.end(), AString()), Split.end());
+	const AString & Action = Split[0];
+
+	if (NoCaseCompare(Action, "chat") == 0)
+	{
+		AString Message = TrimString(a_Line.substr(Action.size()));
+		if (Message.empty())
+		{
+			return false;
+		}
+		a_Actions.push_back(sAction(atChat, 0, 0, 0, 0, Message));
+		return true;
+	}
+
+	// All the other actions take only numbers as their parameters:
+	std::vector<double> Params;
+	for (size_t i = 1; i < Split.size(); i++)
+	{
+		double Value;
+		if (!ParseNumber(Split[i], Value))
+		{
+			return false;
+		}
+		Params.push_back(Value);
+	}
+	if (NoCaseCompare(Action, "wait") == 0)
+	{
+		if ((Params.size() != 1) || (Params[0] < 0))
+		{
+			return false;
+		}
+		a_Actions.push_back(sAction(atWait, 0, 0, 0, Params[0]));
+		return true;
+	}
+	if (NoCaseCompare(Action, "walk") == 0)
+	{
+		if ((Params.size() != 3) || (Params[2] < 0))
+		{
+			return false;
+		}
+		a_Actions.push_back(sAction(atWalk, Params[0], 0, Params[1], Params[2]));
+		return true;
+	}
+	if (NoCaseCompare(Action, "fly") == 0)
+	{
+		if ((Params.size() != 4) || (Params[3] < 0))
+		{
+			return false;
+		}
+		a_Actions.push_back(sAction(atFly, Params[0], Params[1], Params[2], Params[3]));
+		return true;
+	}
+	if (NoCaseCompare(Action, "dig") == 0)
+	{
+		if (Params.size() != 3)
+		{
+			return false;
+		}
+		a_Actions.push_back(sAction(atDig, Params[0], Params[1], Params[2], 0));
+		return true;
+	}
+	return false;
+}
+
+
+
+
@@ -0,0 +1,74 @@
+
+// BotScript.h
+
+// Declares the cBotScript class representing the list of actions that each bot repeats
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** The actions that the bots perform, in order, over and over again.
+The script is loaded from a text file with one action per line; empty lines and lines starting with a '#' are ignored:
+	wait <seconds>                 - does nothing for the specified time
+	walk <dx> <dz> <seconds>       - walks in the specified direction at the walking speed
+	fly <dx> <dy> <dz> <seconds>   - flies in the specified direction at the flying speed
+	dig <dx> <dy> <dz>             - breaks the block at the specified offset from the bot's feet
+	chat <message>                 - sends the chat message; "%name%" is replaced with the bot's name
+*/
+class cBotScript
+{
+public:
+	enum eActionType
+	{
+		atWait,
+		atWalk,
+		atFly,
+		atDig,
+		atChat,
+	} ;
+
+	struct sAction
+	{
+		eActionType m_Type;
+
+		/** The direction of the movement, or the offset of the dug block. */
+		double m_X, m_Y, m_Z;
+
+		/** How long the action lasts, in seconds. */
+		double m_Duration;
+
+		/** The chat message. */
+		AString m_Text;
+
+		sAction(eActionType a_Type, double a_X, double a_Y, double a_Z, double a_Duration, const AString & a_Text = AString());
+	} ;
+
+	typedef std::vector<sAction> cActions;
+
+
+	/** Creates the default script: walks around in a square, chats, digs and flies up and down. */
+	cBotScript(void);
+
+	/** Replaces the actions with the ones loaded from the specified file.
+	Returns false and logs the reason if the file cannot be read or contains an invalid line, keeping the previous actions. */
+	bool Load(const AString & a_FileName);
+
+	const cActions & GetActions(void) const { return m_Actions; }
+
+protected:
+	cActions m_Actions;
+
+
+	/** Parses a single non-empty line of the script into a_Actions. Returns false if the line is invalid. */
+	static bool ParseLine(const AString & a_Line, cActions & a_Actions);
+} ;
+
+
+
+
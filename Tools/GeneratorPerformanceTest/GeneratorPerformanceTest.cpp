@@ -1,7 +1,222 @@
 
+// GeneratorPerformanceTest.cpp
+
+// Implements the main app entrypoint of the generator benchmark
+// Generates a square of chunks using the generator settings from a world.ini and reports the generator speed,
+// the time spent in the individual generator stages, and a checksum of the generated blocks, so that the performance
+// changes can be checked not to change the generated terrain.
+
 #include "Globals.h"
 #include "ChunkGenerator.h"
+#include "ChunkDesc.h"
+#include "IniFile.h"
+#include "LoggerListeners.h"
+
+
+
+
+
+/** The plugin interface that doesn't call any plugins. */
+class cNoPluginInterface :
+	public cChunkGenerator::cPluginInterface
+{
+	virtual void CallHookChunkGenerating(cChunkDesc & a_ChunkDesc) override {}
+	virtual void CallHookChunkGenerated (cChunkDesc & a_ChunkDesc) override {}
+} ;
+
+
+
+
+
+/** The chunk sink that only checksums the generated chunks and counts them. */
+class cChecksumChunkSink :
+	public cChunkGenerator::cChunkSink
+{
+public:
+	cChecksumChunkSink(int a_NumChunks) :
+		m_NumChunksLeft(a_NumChunks),
+		m_Checksum(0)
+	{
+	}
+
+
+	/** Waits until all the chunks have been generated. */
+	void WaitForAllChunks(void)
+	{
+		for (;;)
+		{
+			{
+				cCSLock Lock(m_CS);
+				if (m_NumChunksLeft <= 0)
+				{
+					return;
+				}
+			}
+			m_evtFinished.Wait(1000);
+		}
+	}
+
+
+	/** Returns the checksum of all the chunks generated so far. */
+	UInt64 GetChecksum(void)
+	{
+		cCSLock Lock(m_CS);
+		return m_Checksum;
+	}
+
+protected:
+	cCriticalSection m_CS;
+
+	/** Number of chunks still to be generated. Protected by m_CS. */
+	int m_NumChunksLeft;
+
+	/** Sum of the checksums of the individual chunks. A sum doesn't depend on the order in which the worker threads
+	finish the chunks, so it is the same regardless of the number of threads. Protected by m_CS. */
+	UInt64 m_Checksum;
+
+	/** Set when the last chunk has been generated. */
+	cEvent m_evtFinished;
+
+
+	// cChunkGenerator::cChunkSink overrides:
+	virtual void OnChunkGenerated(cChunkDesc & a_ChunkDesc) override
+	{
+		// FNV-1a over the chunk coords and the block types:
+		UInt64 Checksum = 14695981039346656037ULL;
+		Int32 Coords[2] = { a_ChunkDesc.GetChunkX(), a_ChunkDesc.GetChunkZ() };
+		const Byte * Data = reinterpret_cast<const Byte *>(Coords);
+		for (size_t i = 0; i < sizeof(Coords); i++)
+		{
+			Checksum = (Checksum ^ Data[i]) * 1099511628211ULL;
+		}
+		const cChunkDef::BlockTypes & BlockTypes = a_ChunkDesc.GetBlockTypes();
+		for (size_t i = 0; i < ARRAYCOUNT(BlockTypes); i++)
+		{
+			Checksum = (Checksum ^ BlockTypes[i]) * 1099511628211ULL;
+		}
+
+		cCSLock Lock(m_CS);
+		m_Checksum += Checksum;
+		m_NumChunksLeft -= 1;
+		if (m_NumChunksLeft <= 0)
+		{
+			m_evtFinished.Set();
+		}
+	}
 
-int main(int argc, char * argv[]) {
-	cChunkGenerator Generator = cChunkGenerator();
+	virtual bool IsChunkValid(int a_ChunkX, int a_ChunkZ) override
+	{
+		return false;
+	}
+
+	virtual int GetChunkPriority(int a_ChunkX, int a_ChunkZ) override
+	{
+		// All the chunks are needed, never let the generator skip any:
+		return 0;
+	}
+
+	virtual void OnChunkSkipped(int a_ChunkX, int a_ChunkZ) override
+	{
+	}
+
+	virtual bool IsChunkQueued(int a_ChunkX, int a_ChunkZ) override
+	{
+		return true;
+	}
+} ;
+
+
+
+
+
+static void ShowUsage(void)
+{
+	LOG("Usage: GeneratorPerformanceTest [<world.ini> [<gridsize> [<numthreads>]]]");
+	LOG("  Generates <gridsize> x <gridsize> chunks (default 32) centered around chunk [0, 0],");
+	LOG("  using the [Generator] settings in <world.ini> (default \"world.ini\")");
+	LOG("  in <numthreads> generator threads (default [Generator] NumThreads in the ini file, 0 = one per CPU core).");
+}
+
+
+
+
+
+int main(int argc, char * argv[])
+{
+	cLogger::cListener * consoleLogListener = MakeConsoleListener();
+	cLogger::GetInstance().AttachListener(consoleLogListener);
+	cLogger::InitiateMultithreading();
+
+	// Parse the commandline:
+	AString IniFileName = (argc > 1) ? argv[1] : "world.ini";
+	int GridSize = 32;
+	if ((argc > 2) && (!StringToInteger(argv[2], GridSize) || (GridSize <= 0)))
+	{
+		ShowUsage();
+		return 1;
+	}
+	cIniFile IniFile;
+	if (!IniFile.ReadFile(IniFileName, false))
+	{
+		LOGWARNING("Cannot read the generator settings from \"%s\"", IniFileName.c_str());
+		ShowUsage();
+		return 1;
+	}
+	if (argc > 3)
+	{
+		int NumThreads = 0;
+		if (!StringToInteger(argv[3], NumThreads) || (NumThreads < 0))
+		{
+			ShowUsage();
+			return 1;
+		}
+		IniFile.SetValueI("Generator", "NumThreads", NumThreads);
+	}
+
+	// Generate the chunks:
+	int NumChunks = GridSize * GridSize;
+	cNoPluginInterface PluginInterface;
+	cChecksumChunkSink ChunkSink(NumChunks);
+	cChunkGenerator Generator;
+	if (!Generator.Start(PluginInterface, ChunkSink, IniFile))
+	{
+		LOGWARNING("Cannot start the generator");
+		return 1;
+	}
+	LOG("Generating %d x %d chunks using the generator settings from \"%s\"...", GridSize, GridSize, IniFileName.c_str());
+	auto StartTime = std::chrono::steady_clock::now();
+	int MinChunk = -GridSize / 2;
+	for (int z = 0; z < GridSize; z++)
+	{
+		for (int x = 0; x < GridSize; x++)
+		{
+			Generator.QueueGenerateChunk(MinChunk + x, MinChunk + z, true);
+		}
+	}
+	ChunkSink.WaitForAllChunks();
+	auto Millisec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+
+	// Report the results:
+	AStringVector StatsLines;
+	cChunkGenerator::cStats Stats;
+	Generator.GetStats(Stats);
+	Stats.GetReport(StatsLines);
+	Generator.Stop();
+	LOG("Generated %d chunks in %.03f sec, %.02f chunks / sec",
+		NumChunks, static_cast<double>(Millisec) / 1000, static_cast<double>(NumChunks) * 1000 / std::max<Int64>(Millisec, 1)
+	);
+	LOG("Generator stages:");
+	for (const auto & Line : StatsLines)
+	{
+		LOG("%s", Line.c_str());
+	}
+	LOG("Block types checksum: %016llx", static_cast<unsigned long long>(ChunkSink.GetChecksum()));
+
+	cLogger::GetInstance().DetachListener(consoleLogListener);
+	delete consoleLogListener;
+	return 0;
 }
+
+
+
+
@@ -0,0 +1,156 @@
+
+// AllocationCounter.cpp
+
+// Implements the cAllocationCounter class that counts the heap allocations made by each thread
+
+#include "Globals.h"
+#include "AllocationCounter.h"
+
+
+
+
+
+#ifdef ENABLE_ALLOC_STATS
+
+#ifdef _MSC_VER
+	// MSVC 2013 doesn't support thread_local, but it has an equivalent:
+	#define thread_local __declspec(thread)
+#endif
+
+// Plain integers, so that they need no dynamic initialization; the allocations may come before main() and after the thread's objects are gone:
+static thread_local UInt64 t_NumAllocations = 0;
+static thread_local UInt64 t_NumBytes = 0;
+
+
+
+
+
+/** Allocates the memory for the replaced operators new, counting the allocation for the calling thread.
+Follows the standard operator new semantics: calls the new-handler until the allocation succeeds, throws if there's none. */
+static void * CountedAlloc(size_t a_Size)
+{
+	t_NumAllocations += 1;
+	t_NumBytes += a_Size;
+	if (a_Size == 0)
+	{
+		a_Size = 1;  // Each allocation needs to return a distinct pointer
+	}
+	for (;;)
+	{
+		void * res = malloc(a_Size);
+		if (res != nullptr)
+		{
+			return res;
+		}
+		std::new_handler Handler = std::get_new_handler();
+		if (Handler == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		Handler();
+	}
+}
+
+
+
+
+
+cAllocationCounter::sCounts cAllocationCounter::GetThreadCounts(void)
+{
+	return sCounts(t_NumAllocations, t_NumBytes);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// The replaced global allocation functions; the deallocation ones need replacing too, so that they match the malloc() above:
+
+void * operator new(size_t a_Size)
+{
+	return CountedAlloc(a_Size);
+}
+
+
+
+
+
+void * operator new[](size_t a_Size)
+{
+	return CountedAlloc(a_Size);
+}
+
+
+
+
+
+void * operator new(size_t a_Size, const std::nothrow_t &) throw()
+{
+	try
+	{
+		return CountedAlloc(a_Size);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return nullptr;
+	}
+}
+
+
+
+
+
+void * operator new[](size_t a_Size, const std::nothrow_t &) throw()
+{
+	try
+	{
+		return CountedAlloc(a_Size);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return nullptr;
+	}
+}
+
+
+
+
+
+void operator delete(void * a_Ptr) throw()
+{
+	free(a_Ptr);
+}
+
+
+
+
+
+void operator delete[](void * a_Ptr) throw()
+{
+	free(a_Ptr);
+}
+
+
+
+
+
+void operator delete(void * a_Ptr, const std::nothrow_t &) throw()
+{
+	free(a_Ptr);
+}
+
+
+
+
+
+void operator delete[](void * a_Ptr, const std::nothrow_t &) throw()
+{
+	free(a_Ptr);
+}
+
+#endif  // ENABLE_ALLOC_STATS
+
+
+
+
@@ -0,0 +1,64 @@
+
+// AllocationCounter.h
+
+// Declares the cAllocationCounter class that counts the heap allocations made by each thread
+
+// The counting replaces the global operator new, so it is only compiled in when enabled (cmake -DALLOC_STATS=1)
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** Counts the number of heap allocations (through operator new) and their bytes, separately for each thread, so that
+the allocation bursts can be attributed to the code running in the thread, such as the phases of a world's tick.
+The counters are thread-local and never reset; the callers sample them before and after the measured code.
+Without ENABLE_ALLOC_STATS nothing is counted and all the counts are zero, at no cost. */
+class cAllocationCounter
+{
+public:
+	/** The allocation counts of a single thread. */
+	struct sCounts
+	{
+		UInt64 m_NumAllocations;
+		UInt64 m_NumBytes;
+
+		sCounts(void) :
+			m_NumAllocations(0),
+			m_NumBytes(0)
+		{
+		}
+
+		sCounts(UInt64 a_NumAllocations, UInt64 a_NumBytes) :
+			m_NumAllocations(a_NumAllocations),
+			m_NumBytes(a_NumBytes)
+		{
+		}
+
+		sCounts operator -(const sCounts & a_Other) const
+		{
+			return sCounts(m_NumAllocations - a_Other.m_NumAllocations, m_NumBytes - a_Other.m_NumBytes);
+		}
+	} ;
+
+
+	#ifdef ENABLE_ALLOC_STATS
+		/** Returns true if the allocations are being counted. */
+		static bool IsEnabled(void) { return true; }
+
+		/** Returns the counts of all the allocations made by the calling thread so far. */
+		static sCounts GetThreadCounts(void);
+	#else
+		static bool IsEnabled(void) { return false; }
+		static sCounts GetThreadCounts(void) { return sCounts(); }
+	#endif
+} ;
+
+
+
+
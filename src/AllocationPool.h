@@ -1,7 +1,28 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <vector>
+
+#include "OSSupport/CriticalSection.h"
+
+#ifdef __linux__
+	#include <sys/mman.h>
+#endif
+
+
+
+
+
+/** The kind of the memory pages backing the slabs of a cSlabAllocationPool. */
+enum eSlabPages
+{
+	spNormal,           ///< The slabs are malloc-ed
+	spTransparentHuge,  ///< The slabs are mapped in whole huge pages and marked for the transparent huge pages (Linux only)
+	spExplicitHuge,     ///< The slabs are mapped from the explicit huge pages (MAP_HUGETLB), transparent ones if there are none left (Linux only)
+} ;
 
 template <class T>
 class cAllocationPool
@@ -32,62 +53,236 @@ public:
 	virtual void Free(T * a_ptr) = 0;
 };
 
-/** Allocates memory storing unused elements in a linked list. Keeps at least NumElementsInReserve
-elements in the list unless malloc fails so that the program has a reserve to handle OOM.**/
-template <class T, size_t NumElementsInReserve>
-class cListAllocationPool : public cAllocationPool<T>
+/** Hands out small indices to the threads using the cSlabAllocationPool thread caches, shared by all the pools.
+When a thread exits, its cache in each of the live pools is flushed back to the pool's shared free list,
+and its index is given to the next new thread, so that the number of indices in use stays bounded by the number of live threads.
+On MSVC 2013, which doesn't run destructors of thread-local objects, the indices are never reused. */
+class cAllocationPoolThreads
+{
+public:
+	/** The interface of the pools whose thread caches are flushed when a thread exits. */
+	class cThreadCacheOwner
+	{
+	public:
+		virtual ~cThreadCacheOwner() {}
+
+		/** Moves all the elements of the specified thread's cache back to the shared free list. */
+		virtual void FlushThreadCache(size_t a_ThreadIndex) = 0;
+	};
+
+	/** Value returned by GetThreadIndex() for a thread that has no index, because it is exiting. */
+	static const size_t NoIndex = static_cast<size_t>(-1);
+
+
+	/** Returns the calling thread's index, assigning one on the first call in a thread. */
+	static size_t GetThreadIndex(void)
+	{
+		#if defined(_MSC_VER) && (_MSC_VER < 1900)
+			static __declspec(thread) size_t Index = 0;
+			if (Index == 0)
+			{
+				// Index is 1-based, so that zero-initialization marks it as not yet assigned:
+				Index = Get().AcquireIndex() + 1;
+			}
+			return Index - 1;
+		#else
+			// The guard releases the index when the thread exits; a thread-local object with a destructor
+			// is constructed on its first use, so the threads that never allocate don't take an index:
+			static thread_local sThreadIndexGuard Guard;
+			if (IsExiting())
+			{
+				return NoIndex;
+			}
+			return Guard.m_Index;
+		#endif
+	}
+
+	/** Adds the pool to the pools whose thread caches are flushed on thread exit. */
+	static void RegisterOwner(cThreadCacheOwner & a_Owner)
+	{
+		cAllocationPoolThreads & Threads = Get();
+		cCSLock Lock(Threads.m_CS);
+		Threads.m_Owners.push_back(&a_Owner);
+	}
+
+	/** Removes the pool from the pools whose thread caches are flushed on thread exit. */
+	static void UnregisterOwner(cThreadCacheOwner & a_Owner)
+	{
+		cAllocationPoolThreads & Threads = Get();
+		cCSLock Lock(Threads.m_CS);
+		Threads.m_Owners.erase(std::remove(Threads.m_Owners.begin(), Threads.m_Owners.end(), &a_Owner), Threads.m_Owners.end());
+	}
+
+private:
+	/** Holds the thread's index for the thread's lifetime, flushes the caches and releases the index on thread exit. */
+	struct sThreadIndexGuard
+	{
+		size_t m_Index;
+
+		sThreadIndexGuard(void) :
+			m_Index(Get().AcquireIndex())
+		{
+		}
+
+		~sThreadIndexGuard()
+		{
+			// Any allocation from here on, such as from the destructors of other thread-local objects, uses the shared free list:
+			IsExiting() = true;
+			Get().ReleaseIndex(m_Index);
+		}
+	};
+
+	/** Protects m_Owners, m_FreeIndices and m_NextIndex. */
+	cCriticalSection m_CS;
+
+	/** The live pools. */
+	std::vector<cThreadCacheOwner *> m_Owners;
+
+	/** The indices released by the exited threads, reused before m_NextIndex. */
+	std::vector<size_t> m_FreeIndices;
+
+	/** The lowest index that has never been assigned. */
+	size_t m_NextIndex;
+
+
+	cAllocationPoolThreads(void) :
+		m_NextIndex(0)
+	{
+	}
+
+	/** Returns the single instance, shared by all the pools. */
+	static cAllocationPoolThreads & Get(void)
+	{
+		static cAllocationPoolThreads Instance;
+		return Instance;
+	}
+
+	/** Returns the flag set for the calling thread once its index has been released. */
+	static bool & IsExiting(void)
+	{
+		#ifdef _WIN32
+			static __declspec(thread) bool Flag = false;
+		#else
+			static thread_local bool Flag = false;
+		#endif
+		return Flag;
+	}
+
+	size_t AcquireIndex(void)
+	{
+		cCSLock Lock(m_CS);
+		if (m_FreeIndices.empty())
+		{
+			return m_NextIndex++;
+		}
+		size_t Index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+		return Index;
+	}
+
+	void ReleaseIndex(size_t a_Index)
+	{
+		// The lock is held during the flush, so that no pool can be destroyed meanwhile:
+		cCSLock Lock(m_CS);
+		for (auto Owner: m_Owners)
+		{
+			Owner->FlushThreadCache(a_Index);
+		}
+		m_FreeIndices.push_back(a_Index);
+	}
+} ;
+
+
+
+
+
+/** Allocates memory in slabs of ElementsPerSlab elements and hands them out through per-thread free-list caches.
+The common path of Allocate() and Free() only touches the calling thread's cache and needs no locking;
+the caches exchange elements with the shared free list in batches of BatchSize elements.
+The caches of the exited threads are flushed back to the shared free list, see cAllocationPoolThreads.
+Keeps at least NumElementsInReserve elements in the shared free list, unless malloc fails,
+so that the program has a reserve to handle OOM.
+The slabs can be backed by huge pages (see eSlabPages), so that the pooled elements don't cost as many TLB entries;
+such slabs are rounded up to whole huge pages and hold more than ElementsPerSlab elements. On other than Linux the slabs are always malloc-ed. */
+template <class T, size_t NumElementsInReserve, size_t ElementsPerSlab = 256, size_t BatchSize = 32>
+class cSlabAllocationPool :
+	public cAllocationPool<T>,
+	public cAllocationPoolThreads::cThreadCacheOwner
 {
 	public:
-		
-		cListAllocationPool(std::auto_ptr<typename cAllocationPool<T>::cStarvationCallbacks> a_Callbacks) :
-			m_Callbacks(a_Callbacks)
+
+		cSlabAllocationPool(std::unique_ptr<typename cAllocationPool<T>::cStarvationCallbacks> a_Callbacks, eSlabPages a_SlabPages = spNormal) :
+			m_Callbacks(std::move(a_Callbacks)),
+			m_SlabPages(a_SlabPages),
+			m_SharedFree(nullptr),
+			m_NumSharedFree(0),
+			m_IsUsingReserve(false),
+			m_NumAllocated(0),
+			m_NumFree(0)
 		{
-			for (size_t i = 0; i < NumElementsInReserve; i++)
+			static_assert(sizeof(T) >= sizeof(sFreeNode), "The pooled type is too small to hold a free-list node");
+			for (size_t i = 0; i < MaxThreadCaches; i++)
 			{
-				void * space = malloc(sizeof(T));
-				if (space == nullptr)
+				m_ThreadCaches[i].m_Head = nullptr;
+				m_ThreadCaches[i].m_Count = 0;
+			}
+
+			{
+				cCSLock Lock(m_CSShared);
+				while (m_NumSharedFree < NumElementsInReserve)
 				{
-					m_Callbacks->OnStartUsingReserve();
-					break;
+					if (!AddSlab())
+					{
+						m_IsUsingReserve = true;
+						m_Callbacks->OnStartUsingReserve();
+						break;
+					}
 				}
-				m_FreeList.push_front(space);
 			}
+			cAllocationPoolThreads::RegisterOwner(*this);
 		}
-		
-		virtual ~cListAllocationPool()
+
+		virtual ~cSlabAllocationPool()
 		{
-			while (!m_FreeList.empty())
+			cAllocationPoolThreads::UnregisterOwner(*this);
+			for (const auto & Slab: m_Slabs)
 			{
-				free (m_FreeList.front());
-				m_FreeList.pop_front();
+				#ifdef __linux__
+					if (Slab.m_IsMapped)
+					{
+						munmap(Slab.m_Memory, Slab.m_Size);
+						continue;
+					}
+				#endif
+				free(Slab.m_Memory);
 			}
 		}
-		
+
 		virtual T * Allocate() override
 		{
-			if (m_FreeList.size() <= NumElementsInReserve)
+			sThreadCache * Cache = GetThreadCache();
+			if ((Cache != nullptr) && (Cache->m_Head == nullptr))
 			{
-				void * space = malloc(sizeof(T));
-				if (space != nullptr)
-				{
-					return new(space) T;
-				}
-				else if (m_FreeList.size() == NumElementsInReserve)
-				{
-					m_Callbacks->OnStartUsingReserve();
-				}
-				else if (m_FreeList.empty())
-				{
-					m_Callbacks->OnOutOfReserve();
-					// Try again until the memory is avalable
-					return Allocate();
-				}
+				Refill(*Cache);
 			}
+			sFreeNode * Node;
+			if ((Cache != nullptr) && (Cache->m_Head != nullptr))
+			{
+				Node = Cache->m_Head;
+				Cache->m_Head = Node->m_Next;
+				Cache->m_Count -= 1;
+			}
+			else
+			{
+				// No thread cache available, take the element directly from the shared list:
+				Node = AllocateShared();
+			}
+			m_NumAllocated++;
+			m_NumFree--;
 			// placement new, used to initalize the object
-			T * ret = new (m_FreeList.front()) T;
-			m_FreeList.pop_front();
-			return ret;
+			return new(Node) T;
 		}
+
 		virtual void Free(T * a_ptr) override
 		{
 			if (a_ptr == nullptr)
@@ -96,16 +291,300 @@ class cListAllocationPool : public cAllocationPool<T>
 			}
 			// placement destruct.
 			a_ptr->~T();
-			m_FreeList.push_front(a_ptr);
-			if (m_FreeList.size() == NumElementsInReserve)
+			sFreeNode * Node = reinterpret_cast<sFreeNode *>(a_ptr);
+			m_NumAllocated--;
+			m_NumFree++;
+
+			sThreadCache * Cache = GetThreadCache();
+			if (Cache == nullptr)
 			{
-				m_Callbacks->OnEndUsingReserve();
+				cCSLock Lock(m_CSShared);
+				PushShared(Node, Node, 1);
+				return;
+			}
+			Node->m_Next = Cache->m_Head;
+			Cache->m_Head = Node;
+			Cache->m_Count += 1;
+			if (Cache->m_Count >= 2 * BatchSize)
+			{
+				Flush(*Cache, BatchSize);
 			}
 		}
-		
+
+		/** Returns the number of elements currently handed out by the pool. */
+		size_t GetNumAllocated(void) const { return m_NumAllocated; }
+
+		/** Returns the number of elements that are allocated from the system but currently unused,
+		both in the thread caches and in the shared free list. */
+		size_t GetNumFree(void) const { return m_NumFree; }
+
+		/** Returns the number of reserve elements that have been handed out because malloc failed; 0 if the reserve is intact. */
+		size_t GetNumReserveInUse(void) const
+		{
+			cCSLock Lock(m_CSShared);
+			if (!m_IsUsingReserve)
+			{
+				return 0;
+			}
+			return (m_NumSharedFree < NumElementsInReserve) ? (NumElementsInReserve - m_NumSharedFree) : 0;
+		}
+
+		// cAllocationPoolThreads::cThreadCacheOwner override:
+		virtual void FlushThreadCache(size_t a_ThreadIndex) override
+		{
+			if (a_ThreadIndex < MaxThreadCaches)
+			{
+				Flush(m_ThreadCaches[a_ThreadIndex], m_ThreadCaches[a_ThreadIndex].m_Count);
+			}
+		}
+
+		/** Allocates new slabs in the calling thread until the shared free list holds at least ElementsPerSlab elements above the reserve.
+		The OS places the memory on the NUMA node of the thread that touches it first, and AddSlab() touches the whole slab,
+		so calling this periodically from the thread that uses the elements the most keeps them on that thread's node. */
+		void ReplenishSpare(void)
+		{
+			cCSLock Lock(m_CSShared);
+			while (m_NumSharedFree < NumElementsInReserve + ElementsPerSlab)
+			{
+				if (!AddSlab())
+				{
+					return;
+				}
+			}
+		}
+
 	private:
-		std::list<void *> m_FreeList;
-		std::auto_ptr<typename cAllocationPool<T>::cStarvationCallbacks> m_Callbacks;
+
+		/** The number of per-thread caches. The threads whose index is beyond this count use the shared free list directly;
+		the indices of the exited threads are reused, so this only limits the number of threads alive at the same time. */
+		static const size_t MaxThreadCaches = 64;
+
+		/** The size of the huge pages that the slabs are rounded up to, when backed by huge pages. */
+		static const size_t HugePageSize = 2 * 1024 * 1024;
+
+		/** Overlay for the unused elements, linking them into free lists. */
+		struct sFreeNode
+		{
+			sFreeNode * m_Next;
+		};
+
+		/** The free list owned by a single thread. Padded to a cache line to avoid false sharing between threads. */
+		struct sThreadCache
+		{
+			sFreeNode * m_Head;
+			size_t m_Count;
+			char m_Padding[64 - sizeof(sFreeNode *) - sizeof(size_t)];
+		};
+
+		/** A block of memory allocated from the system, carved into the elements. */
+		struct sSlab
+		{
+			char * m_Memory;
+			size_t m_Size;      ///< The size of the memory, in bytes
+			bool m_IsMapped;    ///< True if the memory is mmap-ed, false if malloc-ed
+		};
+
+		std::unique_ptr<typename cAllocationPool<T>::cStarvationCallbacks> m_Callbacks;
+
+		/** The kind of the pages backing the slabs. */
+		eSlabPages m_SlabPages;
+
+		/** The per-thread caches, indexed by cAllocationPoolThreads::GetThreadIndex(). Each is only ever accessed by its own thread,
+		except when the exiting thread's cache is flushed. */
+		sThreadCache m_ThreadCaches[MaxThreadCaches];
+
+		/** Protects m_SharedFree, m_NumSharedFree, m_IsUsingReserve and m_Slabs. */
+		mutable cCriticalSection m_CSShared;
+
+		/** The shared free list, from which the thread caches are refilled. */
+		sFreeNode * m_SharedFree;
+
+		/** Number of elements in m_SharedFree. */
+		size_t m_NumSharedFree;
+
+		/** Set while elements of the reserve are handed out. */
+		bool m_IsUsingReserve;
+
+		/** All the slabs allocated from the system, freed on destruction. */
+		std::vector<sSlab> m_Slabs;
+
+		/** Number of elements currently handed out. */
+		std::atomic<size_t> m_NumAllocated;
+
+		/** Number of elements allocated from the system that are not handed out. */
+		std::atomic<size_t> m_NumFree;
+
+
+		/** Returns the calling thread's cache, or nullptr if the thread doesn't have one. */
+		sThreadCache * GetThreadCache(void)
+		{
+			size_t Idx = cAllocationPoolThreads::GetThreadIndex();
+			return (Idx < MaxThreadCaches) ? &m_ThreadCaches[Idx] : nullptr;
+		}
+
+		/** Moves up to BatchSize elements from the shared free list into a_Cache, allocating a new slab if needed. */
+		void Refill(sThreadCache & a_Cache)
+		{
+			cCSLock Lock(m_CSShared);
+			if (m_NumSharedFree <= NumElementsInReserve)
+			{
+				AddSlab();
+			}
+			if (m_NumSharedFree <= NumElementsInReserve)
+			{
+				// Couldn't get any new memory, leave the reserve to AllocateShared()
+				return;
+			}
+			size_t NumToMove = std::min(BatchSize, m_NumSharedFree - NumElementsInReserve);
+			for (size_t i = 0; i < NumToMove; i++)
+			{
+				sFreeNode * Node = m_SharedFree;
+				m_SharedFree = Node->m_Next;
+				Node->m_Next = a_Cache.m_Head;
+				a_Cache.m_Head = Node;
+			}
+			m_NumSharedFree -= NumToMove;
+			a_Cache.m_Count += NumToMove;
+		}
+
+		/** Moves a_Count elements from a_Cache back to the shared free list. */
+		void Flush(sThreadCache & a_Cache, size_t a_Count)
+		{
+			ASSERT(a_Count <= a_Cache.m_Count);
+			if (a_Count == 0)
+			{
+				return;
+			}
+			sFreeNode * First = a_Cache.m_Head;
+			sFreeNode * Last = First;
+			for (size_t i = 1; i < a_Count; i++)
+			{
+				Last = Last->m_Next;
+			}
+			a_Cache.m_Head = Last->m_Next;
+			a_Cache.m_Count -= a_Count;
+
+			cCSLock Lock(m_CSShared);
+			PushShared(First, Last, a_Count);
+		}
+
+		/** Takes a single element from the shared list, using the reserve if no new memory can be had.
+		Blocks until memory is available. */
+		sFreeNode * AllocateShared(void)
+		{
+			for (;;)
+			{
+				cCSLock Lock(m_CSShared);
+				if (m_NumSharedFree <= NumElementsInReserve)
+				{
+					if (!AddSlab() && !m_IsUsingReserve && (m_NumSharedFree > 0))
+					{
+						m_IsUsingReserve = true;
+						m_Callbacks->OnStartUsingReserve();
+					}
+				}
+				if (m_SharedFree != nullptr)
+				{
+					sFreeNode * Node = m_SharedFree;
+					m_SharedFree = Node->m_Next;
+					m_NumSharedFree -= 1;
+					return Node;
+				}
+				m_Callbacks->OnOutOfReserve();
+				// Try again until the memory is avalable
+			}
+		}
+
+		/** Pushes the linked chain a_First .. a_Last of a_Count elements onto the shared free list.
+		Assumes m_CSShared is locked. */
+		void PushShared(sFreeNode * a_First, sFreeNode * a_Last, size_t a_Count)
+		{
+			a_Last->m_Next = m_SharedFree;
+			m_SharedFree = a_First;
+			m_NumSharedFree += a_Count;
+			if (m_IsUsingReserve && (m_NumSharedFree >= NumElementsInReserve))
+			{
+				m_IsUsingReserve = false;
+				m_Callbacks->OnEndUsingReserve();
+			}
+		}
+
+		/** Allocates a new slab from the system and puts its elements to the shared free list.
+		Returns false if the system is out of memory. Assumes m_CSShared is locked. */
+		bool AddSlab(void)
+		{
+			sSlab Slab;
+			if (!AllocateSlab(Slab))
+			{
+				return false;
+			}
+			m_Slabs.push_back(Slab);
+			size_t NumElements = Slab.m_Size / sizeof(T);
+			for (size_t i = 0; i < NumElements; i++)
+			{
+				sFreeNode * Node = reinterpret_cast<sFreeNode *>(Slab.m_Memory + i * sizeof(T));
+				Node->m_Next = m_SharedFree;
+				m_SharedFree = Node;
+			}
+			m_NumSharedFree += NumElements;
+			m_NumFree += NumElements;
+			return true;
+		}
+
+		/** Allocates the memory for a new slab, backed by the pages specified in m_SlabPages.
+		Returns false if the system is out of memory. */
+		bool AllocateSlab(sSlab & a_Slab)
+		{
+			#ifdef __linux__
+				if (m_SlabPages != spNormal)
+				{
+					size_t Size = (sizeof(T) * ElementsPerSlab + HugePageSize - 1) / HugePageSize * HugePageSize;
+					#ifdef MAP_HUGETLB
+						if (m_SlabPages == spExplicitHuge)
+						{
+							void * Memory = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+							if (Memory != MAP_FAILED)
+							{
+								a_Slab.m_Memory = reinterpret_cast<char *>(Memory);
+								a_Slab.m_Size = Size;
+								a_Slab.m_IsMapped = true;
+								return true;
+							}
+						}
+					#endif
+
+					// The transparent huge pages only back the aligned parts of a mapping, map an extra huge page and trim it to alignment:
+					void * Mapping = mmap(nullptr, Size + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+					if (Mapping == MAP_FAILED)
+					{
+						return false;
+					}
+					char * Start = reinterpret_cast<char *>(Mapping);
+					char * Aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(Start) + HugePageSize - 1) / HugePageSize * HugePageSize);
+					if (Aligned != Start)
+					{
+						munmap(Start, static_cast<size_t>(Aligned - Start));
+					}
+					size_t Tail = HugePageSize - static_cast<size_t>(Aligned - Start);
+					if (Tail > 0)
+					{
+						munmap(Aligned + Size, Tail);
+					}
+					#ifdef MADV_HUGEPAGE
+						madvise(Aligned, Size, MADV_HUGEPAGE);
+					#endif
+					a_Slab.m_Memory = Aligned;
+					a_Slab.m_Size = Size;
+					a_Slab.m_IsMapped = true;
+					return true;
+				}
+			#endif
+
+			a_Slab.m_Memory = reinterpret_cast<char *>(malloc(sizeof(T) * ElementsPerSlab));
+			a_Slab.m_Size = sizeof(T) * ElementsPerSlab;
+			a_Slab.m_IsMapped = false;
+			return (a_Slab.m_Memory != nullptr);
+		}
 };
 
 
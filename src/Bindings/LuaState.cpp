@@ -5,6 +5,7 @@
 
 #include "Globals.h"
 #include "LuaState.h"
+#include "../OSSupport/SamplingProfiler.h"
 
 extern "C"
 {
@@ -38,6 +39,12 @@ extern "C"
 
 const cLuaState::cRet cLuaState::Return = {};
 
+/** Name of the registry value that stores the cLuaState owning the lua_State, for the watchdog hook. */
+static const char g_WatchdogRegistryName[] = "_MCServerInternal_WatchdogLuaState";
+
+/** Number of Lua instructions between the watchdog's checks of the call duration. */
+static const int WATCHDOG_INSTRUCTION_COUNT = 10000;
+
 
 
 
@@ -49,7 +56,12 @@ cLuaState::cLuaState(const AString & a_SubsystemName) :
 	m_LuaState(nullptr),
 	m_IsOwned(false),
 	m_SubsystemName(a_SubsystemName),
-	m_NumCurrentFunctionArgs(-1)
+	m_NumCurrentFunctionArgs(-1),
+	m_WatchdogWarnMSec(0),
+	m_WatchdogAbortMSec(0),
+	m_IsWatchdogRunning(false),
+	m_HasWatchdogWarned(false),
+	m_HasWatchdogAborted(false)
 {
 }
 
@@ -61,7 +73,12 @@ cLuaState::cLuaState(lua_State * a_AttachState) :
 	m_LuaState(a_AttachState),
 	m_IsOwned(false),
 	m_SubsystemName("<attached>"),
-	m_NumCurrentFunctionArgs(-1)
+	m_NumCurrentFunctionArgs(-1),
+	m_WatchdogWarnMSec(0),
+	m_WatchdogAbortMSec(0),
+	m_IsWatchdogRunning(false),
+	m_HasWatchdogWarned(false),
+	m_HasWatchdogAborted(false)
 {
 }
 
@@ -117,6 +134,16 @@ void cLuaState::RegisterAPILibs(void)
 
 
 
+void cLuaState::RegisterWorkerLibs(void)
+{
+	luaopen_lsqlite3(m_LuaState);
+	luaopen_lxp(m_LuaState);
+}
+
+
+
+
+
 void cLuaState::Close(void)
 {
 	if (m_LuaState == nullptr)
@@ -136,6 +163,12 @@ void cLuaState::Close(void)
 	lua_close(m_LuaState);
 	m_LuaState = nullptr;
 	m_IsOwned = false;
+	m_UserTypeRefs.clear();
+
+	// The watchdog needs to be set up again for the next state:
+	m_WatchdogWarnMSec = 0;
+	m_WatchdogAbortMSec = 0;
+	m_OnWatchdogAbort = nullptr;
 }
 
 
@@ -386,11 +419,37 @@ void cLuaState::Push(const AStringVector & a_Vector)
 
 
 
+void cLuaState::Push(const cPluginManager::cPlayerMoves & a_Moves)
+{
+	ASSERT(IsValid());
+
+	// An array-table of {Player = ..., OldPosition = ..., NewPosition = ...} tables:
+	lua_createtable(m_LuaState, static_cast<int>(a_Moves.size()), 0);
+	int newTable = lua_gettop(m_LuaState);
+	int index = 1;
+	for (cPluginManager::cPlayerMoves::const_iterator itr = a_Moves.begin(), end = a_Moves.end(); itr != end; ++itr, ++index)
+	{
+		lua_createtable(m_LuaState, 0, 3);
+		RawPushUserType(itr->m_Player, "cPlayer");
+		lua_setfield(m_LuaState, -2, "Player");
+		RawPushUserType((void *)&(itr->m_OldPosition), "Vector3<double>");
+		lua_setfield(m_LuaState, -2, "OldPosition");
+		RawPushUserType((void *)&(itr->m_NewPosition), "Vector3<double>");
+		lua_setfield(m_LuaState, -2, "NewPosition");
+		lua_rawseti(m_LuaState, newTable, index);
+	}
+	m_NumCurrentFunctionArgs += 1;
+}
+
+
+
+
+
 void cLuaState::Push(const cCraftingGrid * a_Grid)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Grid, "cCraftingGrid");
+	RawPushUserType((void *)a_Grid, "cCraftingGrid");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -402,7 +461,7 @@ void cLuaState::Push(const cCraftingRecipe * a_Recipe)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Recipe, "cCraftingRecipe");
+	RawPushUserType((void *)a_Recipe, "cCraftingRecipe");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -426,7 +485,7 @@ void cLuaState::Push(const cItems & a_Items)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)&a_Items, "cItems");
+	RawPushUserType((void *)&a_Items, "cItems");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -438,7 +497,7 @@ void cLuaState::Push(const cPlayer * a_Player)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Player, "cPlayer");
+	RawPushUserType((void *)a_Player, "cPlayer");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -450,7 +509,7 @@ void cLuaState::Push(const HTTPRequest * a_Request)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Request, "HTTPRequest");
+	RawPushUserType((void *)a_Request, "HTTPRequest");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -462,7 +521,7 @@ void cLuaState::Push(const HTTPTemplateRequest * a_Request)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Request, "HTTPTemplateRequest");
+	RawPushUserType((void *)a_Request, "HTTPTemplateRequest");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -474,7 +533,7 @@ void cLuaState::Push(const Vector3d & a_Vector)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)&a_Vector, "Vector3<double>");
+	RawPushUserType((void *)&a_Vector, "Vector3<double>");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -486,7 +545,7 @@ void cLuaState::Push(const Vector3d * a_Vector)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Vector, "Vector3<double>");
+	RawPushUserType((void *)a_Vector, "Vector3<double>");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -498,7 +557,7 @@ void cLuaState::Push(const Vector3i & a_Vector)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)&a_Vector, "Vector3<int>");
+	RawPushUserType((void *)&a_Vector, "Vector3<int>");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -510,7 +569,7 @@ void cLuaState::Push(const Vector3i * a_Vector)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, (void *)a_Vector, "Vector3<int>");
+	RawPushUserType((void *)a_Vector, "Vector3<int>");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -534,7 +593,7 @@ void cLuaState::Push(cBlockEntity * a_BlockEntity)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_BlockEntity, (a_BlockEntity == nullptr) ? "cBlockEntity" : a_BlockEntity->GetClass());
+	RawPushUserType(a_BlockEntity, (a_BlockEntity == nullptr) ? "cBlockEntity" : a_BlockEntity->GetClass());
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -546,7 +605,7 @@ void cLuaState::Push(cChunkDesc * a_ChunkDesc)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_ChunkDesc, "cChunkDesc");
+	RawPushUserType(a_ChunkDesc, "cChunkDesc");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -558,7 +617,7 @@ void cLuaState::Push(cClientHandle * a_Client)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Client, "cClientHandle");
+	RawPushUserType(a_Client, "cClientHandle");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -581,32 +640,32 @@ void cLuaState::Push(cEntity * a_Entity)
 			case cEntity::etMonster:
 			{
 				// Don't push specific mob types, as those are not exported in the API:
-				tolua_pushusertype(m_LuaState, a_Entity, "cMonster");
+				RawPushUserType(a_Entity, "cMonster");
 				break;
 			}
 			case cEntity::etPlayer:
 			{
-				tolua_pushusertype(m_LuaState, a_Entity, "cPlayer");
+				RawPushUserType(a_Entity, "cPlayer");
 				break;
 			}
 			case cEntity::etPickup:
 			{
-				tolua_pushusertype(m_LuaState, a_Entity, "cPickup");
+				RawPushUserType(a_Entity, "cPickup");
 				break;
 			}
 			case cEntity::etTNT:
 			{
-				tolua_pushusertype(m_LuaState, a_Entity, "cTNTEntity");
+				RawPushUserType(a_Entity, "cTNTEntity");
 				break;
 			}
 			case cEntity::etProjectile:
 			{
-				tolua_pushusertype(m_LuaState, a_Entity, a_Entity->GetClass());
+				RawPushUserType(a_Entity, a_Entity->GetClass());
 				break;
 			}
 			case cEntity::etFloater:
 			{
-				tolua_pushusertype(m_LuaState, a_Entity, "cFloater");
+				RawPushUserType(a_Entity, "cFloater");
 				break;
 			}
 
@@ -620,7 +679,7 @@ void cLuaState::Push(cEntity * a_Entity)
 			case cEntity::etPainting:
 			{
 				// Push the generic entity class type:
-				tolua_pushusertype(m_LuaState, a_Entity, "cEntity");
+				RawPushUserType(a_Entity, "cEntity");
 			}
 		}  // switch (EntityType)
 	}
@@ -636,7 +695,7 @@ void cLuaState::Push(cHopperEntity * a_Hopper)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Hopper, "cHopperEntity");
+	RawPushUserType(a_Hopper, "cHopperEntity");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -648,7 +707,7 @@ void cLuaState::Push(cItem * a_Item)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Item, "cItem");
+	RawPushUserType(a_Item, "cItem");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -660,7 +719,7 @@ void cLuaState::Push(cItems * a_Items)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Items, "cItems");
+	RawPushUserType(a_Items, "cItems");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -672,7 +731,7 @@ void cLuaState::Push(cLuaServerHandle * a_ServerHandle)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_ServerHandle, "cServerHandle");
+	RawPushUserType(a_ServerHandle, "cServerHandle");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -684,7 +743,7 @@ void cLuaState::Push(cLuaTCPLink * a_TCPLink)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_TCPLink, "cTCPLink");
+	RawPushUserType(a_TCPLink, "cTCPLink");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -696,7 +755,7 @@ void cLuaState::Push(cLuaUDPEndpoint * a_UDPEndpoint)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_UDPEndpoint, "cUDPEndpoint");
+	RawPushUserType(a_UDPEndpoint, "cUDPEndpoint");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -708,7 +767,7 @@ void cLuaState::Push(cMonster * a_Monster)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Monster, "cMonster");
+	RawPushUserType(a_Monster, "cMonster");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -720,7 +779,7 @@ void cLuaState::Push(cPickup * a_Pickup)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Pickup, "cPickup");
+	RawPushUserType(a_Pickup, "cPickup");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -732,7 +791,7 @@ void cLuaState::Push(cPlayer * a_Player)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Player, "cPlayer");
+	RawPushUserType(a_Player, "cPlayer");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -744,7 +803,7 @@ void cLuaState::Push(cPlugin * a_Plugin)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Plugin, "cPlugin");
+	RawPushUserType(a_Plugin, "cPlugin");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -756,7 +815,7 @@ void cLuaState::Push(cPluginLua * a_Plugin)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Plugin, "cPluginLua");
+	RawPushUserType(a_Plugin, "cPluginLua");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -768,7 +827,7 @@ void cLuaState::Push(cProjectileEntity * a_ProjectileEntity)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_ProjectileEntity, "cProjectileEntity");
+	RawPushUserType(a_ProjectileEntity, "cProjectileEntity");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -780,7 +839,7 @@ void cLuaState::Push(cTNTEntity * a_TNTEntity)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_TNTEntity, "cTNTEntity");
+	RawPushUserType(a_TNTEntity, "cTNTEntity");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -792,7 +851,7 @@ void cLuaState::Push(cWebAdmin * a_WebAdmin)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_WebAdmin, "cWebAdmin");
+	RawPushUserType(a_WebAdmin, "cWebAdmin");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -804,7 +863,7 @@ void cLuaState::Push(cWindow * a_Window)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Window, "cWindow");
+	RawPushUserType(a_Window, "cWindow");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -816,7 +875,7 @@ void cLuaState::Push(cWorld * a_World)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_World, "cWorld");
+	RawPushUserType(a_World, "cWorld");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -852,7 +911,7 @@ void cLuaState::Push(TakeDamageInfo * a_TDI)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_TDI, "TakeDamageInfo");
+	RawPushUserType(a_TDI, "TakeDamageInfo");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -864,7 +923,7 @@ void cLuaState::Push(Vector3d * a_Vector)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Vector, "Vector3<double>");
+	RawPushUserType(a_Vector, "Vector3<double>");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -876,7 +935,7 @@ void cLuaState::Push(Vector3i * a_Vector)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Vector, "Vector3<int>");
+	RawPushUserType(a_Vector, "Vector3<int>");
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -915,7 +974,7 @@ void cLuaState::PushUserType(void * a_Object, const char * a_Type)
 {
 	ASSERT(IsValid());
 
-	tolua_pushusertype(m_LuaState, a_Object, a_Type);
+	RawPushUserType(a_Object, a_Type);
 	m_NumCurrentFunctionArgs += 1;
 }
 
@@ -923,6 +982,103 @@ void cLuaState::PushUserType(void * a_Object, const char * a_Type)
 
 
 
+void cLuaState::RawPushUserType(void * a_Object, const char * a_Type)
+{
+	// This is a replica of tolua_pushusertype() that keeps references to the type's tables instead of looking them up by name on each push.
+	// The references are only kept for the owned states; an attached state is usually a short-lived wrapper that would leak them.
+	if (!m_IsOwned || (a_Object == nullptr))
+	{
+		tolua_pushusertype(m_LuaState, a_Object, a_Type);
+		return;
+	}
+
+	// Look up the type's metatable and ubox (the table of the userdata already pushed, by their pointers) on first use:
+	auto itr = m_UserTypeRefs.find(a_Type);
+	if (itr == m_UserTypeRefs.end())
+	{
+		luaL_getmetatable(m_LuaState, a_Type);
+		if (lua_isnil(m_LuaState, -1))
+		{
+			// Leave the nil on the stack in place of the object
+			ASSERT(!"Unknown usertype");
+			LOGWARNING("%s: Cannot push an object of an unknown usertype %s", __FUNCTION__, a_Type);
+			return;
+		}
+		lua_pushstring(m_LuaState, "tolua_ubox");
+		lua_rawget(m_LuaState, -2);
+		if (lua_isnil(m_LuaState, -1))
+		{
+			lua_pop(m_LuaState, 1);
+			lua_pushstring(m_LuaState, "tolua_ubox");
+			lua_rawget(m_LuaState, LUA_REGISTRYINDEX);
+		}
+		sUserTypeRefs Refs;
+		Refs.m_UBox = luaL_ref(m_LuaState, LUA_REGISTRYINDEX);
+		Refs.m_Metatable = luaL_ref(m_LuaState, LUA_REGISTRYINDEX);
+		itr = m_UserTypeRefs.insert(std::make_pair(a_Type, Refs)).first;
+	}
+
+	lua_rawgeti(m_LuaState, LUA_REGISTRYINDEX, itr->second.m_Metatable);  // Stack: mt
+	lua_rawgeti(m_LuaState, LUA_REGISTRYINDEX, itr->second.m_UBox);       // Stack: mt ubox
+	lua_pushlightuserdata(m_LuaState, a_Object);
+	lua_rawget(m_LuaState, -2);                                            // Stack: mt ubox ubox[u]
+	if (lua_isnil(m_LuaState, -1))
+	{
+		// Not pushed before (or already collected), create a new userdata and store it in the ubox:
+		lua_pop(m_LuaState, 1);                                              // Stack: mt ubox
+		*reinterpret_cast<void **>(lua_newuserdata(m_LuaState, sizeof(void *))) = a_Object;  // Stack: mt ubox ud
+		lua_pushlightuserdata(m_LuaState, a_Object);
+		lua_pushvalue(m_LuaState, -2);
+		lua_rawset(m_LuaState, -4);                                          // Stack: mt ubox ud
+		lua_pushvalue(m_LuaState, -3);
+		lua_setmetatable(m_LuaState, -2);
+		lua_pushvalue(m_LuaState, TOLUA_NOPEER);
+		lua_setfenv(m_LuaState, -2);
+		lua_replace(m_LuaState, -3);                                         // Stack: ud ubox
+		lua_pop(m_LuaState, 1);                                              // Stack: ud
+		return;
+	}
+
+	// Reusing the userdata, update its metatable if it has been pushed as a less specialized class before:
+	lua_remove(m_LuaState, -2);                                            // Stack: mt ud
+	if (lua_getmetatable(m_LuaState, -1) == 0)
+	{
+		// No metatable, the object of any type can be used as-is
+	}
+	else if (lua_rawequal(m_LuaState, -1, -3))
+	{
+		// Pushed as the same class before, the common case
+		lua_pop(m_LuaState, 1);                                              // Stack: mt ud
+	}
+	else
+	{
+		// Stack: mt ud udmt
+		lua_pushstring(m_LuaState, "tolua_super");
+		lua_rawget(m_LuaState, LUA_REGISTRYINDEX);
+		lua_insert(m_LuaState, -2);
+		lua_rawget(m_LuaState, -2);                                          // Stack: mt ud super super[udmt]
+		bool IsAlreadySpecialized = false;
+		if (lua_istable(m_LuaState, -1))
+		{
+			lua_pushstring(m_LuaState, a_Type);
+			lua_rawget(m_LuaState, -2);
+			IsAlreadySpecialized = (lua_toboolean(m_LuaState, -1) != 0);
+			lua_pop(m_LuaState, 1);
+		}
+		lua_pop(m_LuaState, 2);                                              // Stack: mt ud
+		if (!IsAlreadySpecialized)
+		{
+			lua_pushvalue(m_LuaState, -2);
+			lua_setmetatable(m_LuaState, -2);
+		}
+	}
+	lua_remove(m_LuaState, -2);                                            // Stack: ud
+}
+
+
+
+
+
 void cLuaState::GetStackValue(int a_StackPos, AString & a_Value)
 {
 	size_t len = 0;
@@ -1186,8 +1342,41 @@ bool cLuaState::CallFunction(int a_NumResults)
 	int NumArgs = m_NumCurrentFunctionArgs;
 	m_NumCurrentFunctionArgs = -1;
 	
+	// Start the watchdog, unless it is already measuring an outer call:
+	bool ShouldStopWatchdog = false;
+	if (((m_WatchdogWarnMSec > 0) || (m_WatchdogAbortMSec > 0)) && !m_IsWatchdogRunning)
+	{
+		m_IsWatchdogRunning = true;
+		m_HasWatchdogWarned = false;
+		m_HasWatchdogAborted = false;
+		m_WatchdogCallStart = std::chrono::steady_clock::now();
+		lua_sethook(m_LuaState, WatchdogHook, LUA_MASKCOUNT, WATCHDOG_INSTRUCTION_COUNT);
+		ShouldStopWatchdog = true;
+	}
+
+	// Let the sampling profiler know which plugin function is running:
+	std::unique_ptr<cSamplingProfiler::cLuaFrame> ProfilerFrame;
+	if (cSamplingProfiler::IsRunning())
+	{
+		AString FrameName = CurrentFunctionName;
+		if (FrameName.empty() || (FrameName[0] == '<'))
+		{
+			// A callback, name it by its definition place:
+			lua_Debug entry;
+			lua_pushvalue(m_LuaState, -NumArgs - 1);
+			lua_getinfo(m_LuaState, ">S", &entry);
+			Printf(FrameName, "%s:%d", entry.short_src, entry.linedefined);
+		}
+		ProfilerFrame.reset(new cSamplingProfiler::cLuaFrame(m_SubsystemName + ": " + FrameName));
+	}
+
 	// Call the function:
 	int s = lua_pcall(m_LuaState, NumArgs, a_NumResults, -NumArgs - 2);
+	if (ShouldStopWatchdog)
+	{
+		lua_sethook(m_LuaState, nullptr, 0, 0);
+		m_IsWatchdogRunning = false;
+	}
 	if (s != 0)
 	{
 		// The error has already been printed together with the stacktrace
@@ -1515,6 +1704,64 @@ void cLuaState::LogStackTrace(int a_StartingDepth)
 
 
 
+void cLuaState::SetWatchdog(int a_WarnMSec, int a_AbortMSec, std::function<void(void)> a_OnAbort)
+{
+	ASSERT(IsValid());
+	ASSERT(!m_IsWatchdogRunning);
+
+	m_WatchdogWarnMSec = std::max(a_WarnMSec, 0);
+	m_WatchdogAbortMSec = std::max(a_AbortMSec, 0);
+	m_OnWatchdogAbort = a_OnAbort;
+
+	// Store the pointer to this object for the hook, which only receives the lua_State:
+	lua_pushlightuserdata(m_LuaState, this);
+	lua_setfield(m_LuaState, LUA_REGISTRYINDEX, g_WatchdogRegistryName);
+}
+
+
+
+
+
+void cLuaState::WatchdogHook(lua_State * a_LuaState, lua_Debug * a_Debug)
+{
+	UNUSED(a_Debug);
+
+	lua_getfield(a_LuaState, LUA_REGISTRYINDEX, g_WatchdogRegistryName);
+	cLuaState * Self = reinterpret_cast<cLuaState *>(lua_touserdata(a_LuaState, -1));
+	lua_pop(a_LuaState, 1);
+	if ((Self == nullptr) || !Self->m_IsWatchdogRunning)
+	{
+		// A coroutine that has inherited the hook, running outside of a watched call
+		return;
+	}
+
+	int MSec = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Self->m_WatchdogCallStart).count());
+	if ((Self->m_WatchdogAbortMSec > 0) && (MSec >= Self->m_WatchdogAbortMSec))
+	{
+		// Keep raising the error until the call returns, so that a pcall() in the script cannot swallow the abort:
+		if (!Self->m_HasWatchdogAborted)
+		{
+			Self->m_HasWatchdogAborted = true;
+			if (Self->m_OnWatchdogAbort)
+			{
+				Self->m_OnWatchdogAbort();
+			}
+		}
+		luaL_error(a_LuaState, "The call has been aborted by the watchdog after %d msec", MSec);
+		return;
+	}
+	if ((Self->m_WatchdogWarnMSec > 0) && (MSec >= Self->m_WatchdogWarnMSec) && !Self->m_HasWatchdogWarned)
+	{
+		Self->m_HasWatchdogWarned = true;
+		LOGWARNING("%s: A call has been running for %d msec so far.", Self->m_SubsystemName.c_str(), MSec);
+		LogStackTrace(a_LuaState);
+	}
+}
+
+
+
+
+
 void cLuaState::LogStackTrace(lua_State * a_LuaState, int a_StartingDepth)
 {
 	LOGWARNING("Stack trace:");
@@ -30,6 +30,9 @@ extern "C"
 	#include "lua/src/lauxlib.h"
 }
 
+#include <functional>
+#include <unordered_map>
+
 #include "../Vector3.h"
 #include "../Defines.h"
 #include "PluginManager.h"
@@ -172,6 +175,10 @@ public:
 	
 	/** Registers all the API libraries that MCS provides into m_LuaState. */
 	void RegisterAPILibs(void);
+
+	/** Registers the libraries that are safe to use off the server threads (sqlite and Expat) into m_LuaState.
+	Used for the plugins' worker states, which cannot use the rest of the API. */
+	void RegisterWorkerLibs(void);
 	
 	/** Closes the m_LuaState, if not closed already */
 	void Close(void);
@@ -206,6 +213,7 @@ public:
 	void Push(const cCraftingRecipe * a_Recipe);
 	void Push(const char * a_Value);
 	void Push(const cItems & a_Items);
+	void Push(const cPluginManager::cPlayerMoves & a_Moves);
 	void Push(const cPlayer * a_Player);
 	void Push(const HTTPRequest * a_Request);
 	void Push(const HTTPTemplateRequest * a_Request);
@@ -326,6 +334,13 @@ public:
 	
 	/** Logs all items in the current stack trace to the server console */
 	static void LogStackTrace(lua_State * a_LuaState, int a_StartingDepth = 0);
+
+	/** Sets the limits on the duration of the calls into Lua made through CallFunction(), checked by a Lua count hook.
+	A call running longer than a_WarnMSec logs a warning with the Lua stack trace (once per call).
+	A call running longer than a_AbortMSec is aborted with a Lua error and a_OnAbort is called, from within the aborted call.
+	0 disables the respective limit. Only the outermost call is measured, nested calls count towards its duration.
+	Long-running C++ API functions cannot be interrupted, the limits are only checked while executing Lua code. */
+	void SetWatchdog(int a_WarnMSec, int a_AbortMSec, std::function<void(void)> a_OnAbort = nullptr);
 	
 	/** Returns the type of the item on the specified position in the stack */
 	AString GetTypeText(int a_StackPos);
@@ -373,6 +388,34 @@ protected:
 	/** Number of arguments currently pushed (for the Push / Call chain) */
 	int m_NumCurrentFunctionArgs;
 
+	/** The watchdog's limits on the call duration, in milliseconds; 0 = no limit. See SetWatchdog(). */
+	int m_WatchdogWarnMSec;
+	int m_WatchdogAbortMSec;
+
+	/** Called by the watchdog when it aborts a call. */
+	std::function<void(void)> m_OnWatchdogAbort;
+
+	/** True while the watchdog is measuring an outermost call. */
+	bool m_IsWatchdogRunning;
+
+	/** Whether the watchdog has already logged a warning / aborted the current call. */
+	bool m_HasWatchdogWarned;
+	bool m_HasWatchdogAborted;
+
+	/** The time when the outermost watched call started. */
+	std::chrono::steady_clock::time_point m_WatchdogCallStart;
+
+	/** Registry references to the tolua++ tables of a single usertype, used by RawPushUserType(). */
+	struct sUserTypeRefs
+	{
+		int m_Metatable;
+		int m_UBox;
+	} ;
+
+	/** The references to the tables of the usertypes pushed so far, by the type name's pointer.
+	Only used for the owned states, cleared when the state is closed. */
+	std::unordered_map<const char *, sUserTypeRefs> m_UserTypeRefs;
+
 	/** Variadic template terminator: If there's nothing more to push / pop, just call the function.
 	Note that there are no return values either, because those are prefixed by a cRet value, so the arg list is never empty. */
 	bool PushCallPop(void)
@@ -440,9 +483,15 @@ protected:
 	*/
 	bool PushFunction(const cTableRef & a_TableRef);
 	
-	/** Pushes a usertype of the specified class type onto the stack */
+	/** Pushes a usertype of the specified class type onto the stack.
+	a_Type must have a static storage duration (a string literal), its address is used for caching the type lookup. */
 	void PushUserType(void * a_Object, const char * a_Type);
 
+	/** Pushes a usertype of the specified class type onto the stack, without counting it as a function arg.
+	Same as tolua_pushusertype(), but with the type's tables cached in m_UserTypeRefs.
+	a_Type must have a static storage duration (a string literal), its address is used as the cache key. */
+	void RawPushUserType(void * a_Object, const char * a_Type);
+
 	/**
 	Calls the function that has been pushed onto the stack by PushFunction(),
 	with arguments pushed by PushXXX().
@@ -452,6 +501,9 @@ protected:
 	
 	/** Used as the error reporting function for function calls */
 	static int ReportFnCallErrors(lua_State * a_LuaState);
+
+	/** The Lua count hook that enforces the watchdog limits on a running call. */
+	static void WatchdogHook(lua_State * a_LuaState, lua_Debug * a_Debug);
 } ;
 
 
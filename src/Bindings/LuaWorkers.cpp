@@ -0,0 +1,353 @@
+
+// LuaWorkers.cpp
+
+// Implements the cLuaWorkers class representing the worker Lua states that run the jobs of a plugin off the server threads
+
+#include "Globals.h"
+#include "LuaWorkers.h"
+#include "../Root.h"
+
+
+
+
+
+/** Maximum number of jobs of a single plugin running at the same time, each in its own worker state.
+Keeps a single plugin from occupying the whole thread pool. */
+static const int MAX_WORKERS = 2;
+
+/** Maximum nesting of the tables passed between the states. Deeper tables are most likely cyclic. */
+static const int MAX_TABLE_DEPTH = 16;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cLuaWorkerValue:
+
+cLuaWorkerValue::cLuaWorkerValue(void) :
+	m_Type(LUA_TNIL),
+	m_Number(0)
+{
+}
+
+
+
+
+
+bool cLuaWorkerValue::Read(lua_State * a_LuaState, int a_StackPos, AString & a_Error)
+{
+	// Make the position absolute, the table traversal pushes onto the stack:
+	if ((a_StackPos < 0) && (a_StackPos > LUA_REGISTRYINDEX))
+	{
+		a_StackPos = lua_gettop(a_LuaState) + a_StackPos + 1;
+	}
+	return ReadNested(a_LuaState, a_StackPos, a_Error, 0);
+}
+
+
+
+
+
+bool cLuaWorkerValue::ReadNested(lua_State * a_LuaState, int a_StackPos, AString & a_Error, int a_Depth)
+{
+	m_Type = lua_type(a_LuaState, a_StackPos);
+	switch (m_Type)
+	{
+		case LUA_TNIL:
+		{
+			return true;
+		}
+		case LUA_TBOOLEAN:
+		{
+			m_Number = lua_toboolean(a_LuaState, a_StackPos) ? 1 : 0;
+			return true;
+		}
+		case LUA_TNUMBER:
+		{
+			m_Number = lua_tonumber(a_LuaState, a_StackPos);
+			return true;
+		}
+		case LUA_TSTRING:
+		{
+			size_t Len = 0;
+			const char * Str = lua_tolstring(a_LuaState, a_StackPos, &Len);
+			m_String.assign(Str, Len);
+			return true;
+		}
+		case LUA_TTABLE:
+		{
+			if (a_Depth >= MAX_TABLE_DEPTH)
+			{
+				a_Error = "The tables are nested too deep, or contain a cycle";
+				return false;
+			}
+			lua_pushnil(a_LuaState);
+			while (lua_next(a_LuaState, a_StackPos) != 0)
+			{
+				// Stack: ..., key, value
+				int Top = lua_gettop(a_LuaState);
+				m_TableItems.emplace_back();
+				m_TableItems.emplace_back();
+				if (
+					!m_TableItems[m_TableItems.size() - 2].ReadNested(a_LuaState, Top - 1, a_Error, a_Depth + 1) ||
+					!m_TableItems[m_TableItems.size() - 1].ReadNested(a_LuaState, Top, a_Error, a_Depth + 1)
+				)
+				{
+					lua_pop(a_LuaState, 2);
+					return false;
+				}
+				lua_pop(a_LuaState, 1);
+			}
+			return true;
+		}
+	}
+	a_Error = Printf("Values of type %s cannot be passed between Lua states", lua_typename(a_LuaState, m_Type));
+	return false;
+}
+
+
+
+
+
+void cLuaWorkerValue::Push(lua_State * a_LuaState) const
+{
+	switch (m_Type)
+	{
+		case LUA_TBOOLEAN: lua_pushboolean(a_LuaState, (m_Number != 0) ? 1 : 0);            break;
+		case LUA_TNUMBER:  lua_pushnumber(a_LuaState, m_Number);                              break;
+		case LUA_TSTRING:  lua_pushlstring(a_LuaState, m_String.data(), m_String.size());    break;
+		case LUA_TTABLE:
+		{
+			lua_createtable(a_LuaState, 0, static_cast<int>(m_TableItems.size() / 2));
+			for (size_t i = 0; i + 1 < m_TableItems.size(); i += 2)
+			{
+				m_TableItems[i].Push(a_LuaState);
+				m_TableItems[i + 1].Push(a_LuaState);
+				lua_rawset(a_LuaState, -3);
+			}
+			break;
+		}
+		default:
+		{
+			lua_pushnil(a_LuaState);
+			break;
+		}
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cLuaWorkers:
+
+cLuaWorkers::cLuaWorkers(cPluginLua & a_Plugin) :
+	super(a_Plugin),
+	m_PluginName(a_Plugin.GetName()),
+	m_PluginFolder(a_Plugin.GetLocalFolder()),
+	m_NumRunning(0)
+{
+}
+
+
+
+
+
+cLuaWorkers::~cLuaWorkers()
+{
+	// The thread pool tasks hold a shared pointer to this object, so none can be running:
+	ASSERT(m_NumRunning == 0);
+}
+
+
+
+
+
+void cLuaWorkers::QueueJob(const AString & a_FileName, const AString & a_FunctionName, cLuaWorkerValues && a_Args, int a_CallbackRef)
+{
+	sJob Job;
+	Job.m_FileName = a_FileName;
+	Job.m_FunctionName = a_FunctionName;
+	Job.m_Args = std::move(a_Args);
+	Job.m_CallbackRef = a_CallbackRef;
+
+	{
+		cCSLock Lock(m_CS);
+		m_Jobs.push_back(std::move(Job));
+		if (m_NumRunning >= MAX_WORKERS)
+		{
+			// A running task will pick the job up
+			return;
+		}
+		m_NumRunning += 1;
+	}
+	auto Self = shared_from_this();
+	cRoot::Get()->GetThreadPool().Submit([Self]() { Self->RunJobs(); }, cThreadPool::tpLow);
+}
+
+
+
+
+
+void cLuaWorkers::Reset(void)
+{
+	super::Reset();
+
+	// Drop the jobs not started yet, their callbacks cannot be called anymore:
+	cCSLock Lock(m_CS);
+	m_Jobs.clear();
+}
+
+
+
+
+
+void cLuaWorkers::RunJobs(void)
+{
+	sWorkerPtr Worker;
+	for (;;)
+	{
+		sJob Job;
+		{
+			cCSLock Lock(m_CS);
+			if (m_Jobs.empty())
+			{
+				if (Worker != nullptr)
+				{
+					m_IdleWorkers.push_back(std::move(Worker));
+				}
+				m_NumRunning -= 1;
+				return;
+			}
+			Job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+			if ((Worker == nullptr) && !m_IdleWorkers.empty())
+			{
+				Worker = std::move(m_IdleWorkers.back());
+				m_IdleWorkers.pop_back();
+			}
+		}
+
+		if (Worker == nullptr)
+		{
+			Worker.reset(new sWorker(Printf("plugin %s worker", m_PluginName.c_str())));
+			Worker->m_LuaState.Create();
+			Worker->m_LuaState.RegisterWorkerLibs();
+		}
+		RunJob(*Worker, Job);
+	}
+}
+
+
+
+
+
+void cLuaWorkers::RunJob(sWorker & a_Worker, sJob & a_Job)
+{
+	cLuaWorkerValues Results;
+	AString Error;
+
+	// Load the file with the job's function, if not loaded in this worker yet:
+	if (a_Worker.m_LoadedFiles.find(a_Job.m_FileName) == a_Worker.m_LoadedFiles.end())
+	{
+		if (!a_Worker.m_LuaState.LoadFile(m_PluginFolder + "/" + a_Job.m_FileName))
+		{
+			DeliverResults(a_Job, false, Results, Printf("Cannot load file %s", a_Job.m_FileName.c_str()));
+			return;
+		}
+		a_Worker.m_LoadedFiles.insert(a_Job.m_FileName);
+	}
+
+	// Call the function:
+	lua_State * L = a_Worker.m_LuaState;
+	int Top = lua_gettop(L);
+	lua_getglobal(L, a_Job.m_FunctionName.c_str());
+	if (!lua_isfunction(L, -1))
+	{
+		lua_settop(L, Top);
+		DeliverResults(a_Job, false, Results, Printf("Function %s() not found in file %s", a_Job.m_FunctionName.c_str(), a_Job.m_FileName.c_str()));
+		return;
+	}
+	for (const auto & Arg: a_Job.m_Args)
+	{
+		Arg.Push(L);
+	}
+	if (lua_pcall(L, static_cast<int>(a_Job.m_Args.size()), LUA_MULTRET, 0) != 0)
+	{
+		const char * Msg = lua_tostring(L, -1);
+		Error = (Msg != nullptr) ? Msg : "Unknown error";
+		lua_settop(L, Top);
+		DeliverResults(a_Job, false, Results, Error);
+		return;
+	}
+
+	// Copy the results out of the worker state:
+	int NumResults = lua_gettop(L) - Top;
+	Results.resize(static_cast<size_t>(NumResults));
+	for (int i = 0; i < NumResults; i++)
+	{
+		if (!Results[static_cast<size_t>(i)].Read(L, Top + 1 + i, Error))
+		{
+			lua_settop(L, Top);
+			DeliverResults(a_Job, false, cLuaWorkerValues(), Error);
+			return;
+		}
+	}
+	lua_settop(L, Top);
+	DeliverResults(a_Job, true, Results, Error);
+}
+
+
+
+
+
+void cLuaWorkers::DeliverResults(const sJob & a_Job, bool a_IsSuccess, const cLuaWorkerValues & a_Results, const AString & a_Error)
+{
+	cCSLock Lock(m_CSPlugin);
+	if (m_Plugin == nullptr)
+	{
+		// The plugin has unloaded, together with the callback
+		return;
+	}
+	if (!a_IsSuccess)
+	{
+		LOGWARNING("Plugin %s: Worker job %s() failed: %s", m_PluginName.c_str(), a_Job.m_FunctionName.c_str(), a_Error.c_str());
+	}
+	if (a_Job.m_CallbackRef == LUA_REFNIL)
+	{
+		return;
+	}
+
+	// Call the callback with (true, results...) or (false, error):
+	cPluginLua::cOperation Op(*m_Plugin);
+	lua_State * L = Op();
+	int Top = lua_gettop(L);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, a_Job.m_CallbackRef);
+	luaL_unref(L, LUA_REGISTRYINDEX, a_Job.m_CallbackRef);
+	lua_pushboolean(L, a_IsSuccess ? 1 : 0);
+	int NumArgs = 1;
+	if (a_IsSuccess)
+	{
+		for (const auto & Result: a_Results)
+		{
+			Result.Push(L);
+		}
+		NumArgs += static_cast<int>(a_Results.size());
+	}
+	else
+	{
+		lua_pushlstring(L, a_Error.data(), a_Error.size());
+		NumArgs += 1;
+	}
+	if (cLuaState::ReportErrors(L, lua_pcall(L, NumArgs, 0, 0)))
+	{
+		LOGWARNING("Plugin %s: The callback of worker job %s() failed", m_PluginName.c_str(), a_Job.m_FunctionName.c_str());
+	}
+	lua_settop(L, Top);
+}
+
+
+
+
@@ -0,0 +1,135 @@
+
+// LuaWorkers.h
+
+// Declares the cLuaWorkers class representing the worker Lua states that run the jobs of a plugin off the server threads
+
+
+
+
+
+#pragma once
+
+#include "PluginLua.h"
+
+
+
+
+
+/** A Lua value copied out of a Lua state, so that it can be passed to another state, possibly in another thread.
+Only nil, booleans, numbers, strings and tables of these are supported. */
+class cLuaWorkerValue
+{
+public:
+	cLuaWorkerValue(void);
+
+	/** Copies the value at the specified stack position.
+	Returns false and sets a_Error if the value (or any value in the table) is of an unsupported type. */
+	bool Read(lua_State * a_LuaState, int a_StackPos, AString & a_Error);
+
+	/** Pushes a copy of the value onto the stack of the specified state. */
+	void Push(lua_State * a_LuaState) const;
+
+protected:
+	/** The Lua type of the value, LUA_TXXX. */
+	int m_Type;
+
+	/** The value of a number, or a boolean (0 or 1). */
+	lua_Number m_Number;
+
+	/** The value of a string. */
+	AString m_String;
+
+	/** The items of a table, as {key, value} pairs stored one after another. */
+	std::vector<cLuaWorkerValue> m_TableItems;
+
+
+	/** Implements Read(), a_Depth is the nesting level of the table being read, used for detecting cycles. */
+	bool ReadNested(lua_State * a_LuaState, int a_StackPos, AString & a_Error, int a_Depth);
+} ;
+
+typedef std::vector<cLuaWorkerValue> cLuaWorkerValues;
+
+
+
+
+
+/** The worker Lua states of a single plugin, running the jobs queued by the plugin on the server's thread pool.
+A job calls a function from a Lua file in the plugin's folder, the file is loaded into each worker state the first time
+the state runs a job from it. The worker states have the standard Lua libraries, sqlite and Expat, but not the server API,
+which isn't thread-safe. The args and the results are copied between the states, see cLuaWorkerValue.
+The results are passed to the job's callback in the plugin's main state. The callback is called in the thread pool's thread,
+with the plugin locked, the same way as the network callbacks are.
+Registered as the plugin's cResettable, so that the queued jobs are dropped and no callbacks are made once the plugin unloads. */
+class cLuaWorkers :
+	public cPluginLua::cResettable,
+	public std::enable_shared_from_this<cLuaWorkers>
+{
+	typedef cPluginLua::cResettable super;
+
+public:
+	cLuaWorkers(cPluginLua & a_Plugin);
+
+	virtual ~cLuaWorkers();
+
+	/** Queues a job calling the specified function from the specified file (relative to the plugin folder) with the specified args.
+	a_CallbackRef is the registry reference of the function in the plugin's main state that receives the results,
+	or LUA_REFNIL for no callback. The callback reference is released once the callback has been called. */
+	void QueueJob(const AString & a_FileName, const AString & a_FunctionName, cLuaWorkerValues && a_Args, int a_CallbackRef);
+
+	// cPluginLua::cResettable override:
+	virtual void Reset(void) override;
+
+protected:
+	/** A single job queued by the plugin. */
+	struct sJob
+	{
+		AString m_FileName;
+		AString m_FunctionName;
+		cLuaWorkerValues m_Args;
+		int m_CallbackRef;
+	} ;
+
+	/** A single worker Lua state, together with the files it has loaded. */
+	struct sWorker
+	{
+		cLuaState m_LuaState;
+		std::set<AString> m_LoadedFiles;
+
+		sWorker(const AString & a_SubsystemName) : m_LuaState(a_SubsystemName) {}
+	} ;
+
+	typedef std::unique_ptr<sWorker> sWorkerPtr;
+
+
+	/** The plugin's name, for the worker states' error messages. */
+	AString m_PluginName;
+
+	/** The plugin's folder, from which the job files are loaded. */
+	AString m_PluginFolder;
+
+	/** Protects the job queue and the workers against multithreaded access. */
+	cCriticalSection m_CS;
+
+	/** The jobs not yet started. */
+	std::deque<sJob> m_Jobs;
+
+	/** The worker states not running any job. */
+	std::vector<sWorkerPtr> m_IdleWorkers;
+
+	/** Number of the thread pool tasks currently running the jobs, at most MAX_WORKERS. */
+	int m_NumRunning;
+
+
+	/** Runs the queued jobs until there are none left. Executed as a thread pool task. */
+	void RunJobs(void);
+
+	/** Runs a single job in the specified worker state and delivers its results to the job's callback. */
+	void RunJob(sWorker & a_Worker, sJob & a_Job);
+
+	/** Calls the job's callback in the plugin's main state with the results, unless the plugin has unloaded since. */
+	void DeliverResults(const sJob & a_Job, bool a_IsSuccess, const cLuaWorkerValues & a_Results, const AString & a_Error);
+} ;
+
+
+
+
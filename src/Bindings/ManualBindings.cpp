@@ -13,12 +13,14 @@
 #include "PluginManager.h"
 #include "LuaWindow.h"
 #include "LuaChunkStay.h"
+#include "LuaWorkers.h"
 #include "../Root.h"
 #include "../World.h"
 #include "../Entities/Player.h"
 #include "../WebAdmin.h"
 #include "../ClientHandle.h"
 #include "../BlockArea.h"
+#include "../Cuboid.h"
 #include "../BlockEntities/BeaconEntity.h"
 #include "../BlockEntities/ChestEntity.h"
 #include "../BlockEntities/CommandBlockEntity.h"
@@ -1413,6 +1415,182 @@ static int tolua_cWorld_ScheduleTask(lua_State * tolua_S)
 
 
 
+static int tolua_cWorld_GetEntitiesInBox(lua_State * tolua_S)
+{
+	// Function signature:
+	// cWorld:GetEntitiesInBox(BoundingBox) -> {{ID = ..., EntityType = ..., Class = ..., PosX = ..., PosY = ..., PosZ = ...}, ...}
+	// Unlike ForEachEntityInBox(), the list is collected in a single call; the entities can be accessed later by their ID
+
+	// Check params:
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamUserType(1, "cWorld") ||
+		!L.CheckParamUserType(2, "cBoundingBox") ||
+		!L.CheckParamEnd(3)
+	)
+	{
+		return 0;
+	}
+	cWorld * World = nullptr;
+	cBoundingBox * Box = nullptr;
+	L.GetStackValues(1, World, Box);
+	if ((World == nullptr) || (Box == nullptr))
+	{
+		return lua_do_error(tolua_S, "Error in function call '#funcname#': Invalid world or bounding box");
+	}
+
+	// Collect the entities' info into a Lua array-table:
+	class cCallback :
+		public cEntityCallback
+	{
+	public:
+		cCallback(lua_State * a_LuaState) :
+			m_LuaState(a_LuaState),
+			m_Index(1)
+		{
+		}
+
+	protected:
+		lua_State * m_LuaState;
+		int m_Index;
+
+		virtual bool Item(cEntity * a_Entity) override
+		{
+			lua_createtable(m_LuaState, 0, 6);
+			lua_pushnumber(m_LuaState, a_Entity->GetUniqueID());
+			lua_setfield(m_LuaState, -2, "ID");
+			lua_pushnumber(m_LuaState, a_Entity->GetEntityType());
+			lua_setfield(m_LuaState, -2, "EntityType");
+			lua_pushstring(m_LuaState, a_Entity->GetClass());
+			lua_setfield(m_LuaState, -2, "Class");
+			lua_pushnumber(m_LuaState, a_Entity->GetPosX());
+			lua_setfield(m_LuaState, -2, "PosX");
+			lua_pushnumber(m_LuaState, a_Entity->GetPosY());
+			lua_setfield(m_LuaState, -2, "PosY");
+			lua_pushnumber(m_LuaState, a_Entity->GetPosZ());
+			lua_setfield(m_LuaState, -2, "PosZ");
+			lua_rawseti(m_LuaState, -2, m_Index);
+			m_Index += 1;
+			return false;
+		}
+	} Callback(tolua_S);
+	lua_newtable(tolua_S);
+	World->ForEachEntityInBox(*Box, Callback);
+	return 1;
+}
+
+
+
+
+
+/** Reads a block area on the thread pool and hands it over to the plugin's callback. */
+class cLuaBlockAreaReader :
+	public cPluginLua::cResettable
+{
+public:
+	cLuaBlockAreaReader(cPluginLua & a_Plugin, int a_FnRef) :
+		cPluginLua::cResettable(a_Plugin),
+		m_FnRef(a_FnRef)
+	{
+	}
+
+	/** Reads the area from the world and calls the callback with it, unless the plugin has unloaded since. */
+	void Run(cWorld & a_World, const cCuboid & a_Bounds, int a_DataTypes)
+	{
+		std::unique_ptr<cBlockArea> Area(new cBlockArea);
+		if (!Area->Read(&a_World, a_Bounds, a_DataTypes))
+		{
+			// The area is outside the world's height, pass an empty area to the callback
+			Area->Clear();
+		}
+
+		cCSLock Lock(m_CSPlugin);
+		if (m_Plugin == nullptr)
+		{
+			return;
+		}
+		cPluginLua::cOperation Op(*m_Plugin);
+		lua_State * L = Op();
+		int Top = lua_gettop(L);
+		lua_rawgeti(L, LUA_REGISTRYINDEX, m_FnRef);
+		luaL_unref(L, LUA_REGISTRYINDEX, m_FnRef);
+		tolua_pushusertype(L, &a_World, "cWorld");
+		tolua_pushusertype_and_takeownership(L, Area.release(), "cBlockArea");  // Lua now owns the area
+		if (cLuaState::ReportErrors(L, lua_pcall(L, 2, 0, 0)))
+		{
+			LOGWARNING("Plugin %s: The callback of cWorld:QueueReadBlockArea() failed", m_Plugin->GetName().c_str());
+		}
+		lua_settop(L, Top);
+	}
+
+protected:
+	int m_FnRef;
+} ;
+
+
+
+
+
+static int tolua_cWorld_QueueReadBlockArea(lua_State * tolua_S)
+{
+	// Function signature:
+	// cWorld:QueueReadBlockArea(MinX, MaxX, MinY, MaxY, MinZ, MaxZ, DataTypes, Callback)
+	// Reads the area on the thread pool, then calls Callback(World, BlockArea) with the plugin locked, in the pool's thread.
+	// The chunks that are not loaded are read as air, the same way as with cBlockArea:Read().
+
+	cPluginLua * Plugin = GetLuaPlugin(tolua_S);
+	if (Plugin == nullptr)
+	{
+		return 0;
+	}
+
+	// Check params:
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamUserType(1, "cWorld") ||
+		!L.CheckParamNumber  (2, 8) ||
+		!L.CheckParamFunction(9) ||
+		!L.CheckParamEnd     (10)
+	)
+	{
+		return 0;
+	}
+	cWorld * World = nullptr;
+	int MinX, MaxX, MinY, MaxY, MinZ, MaxZ, DataTypes;
+	L.GetStackValues(1, World, MinX, MaxX, MinY, MaxY, MinZ, MaxZ, DataTypes);
+	if (World == nullptr)
+	{
+		return lua_do_error(tolua_S, "Error in function call '#funcname#': Not called on an object instance");
+	}
+	if ((DataTypes & ~(cBlockArea::baTypes | cBlockArea::baMetas | cBlockArea::baLight | cBlockArea::baSkyLight)) != 0)
+	{
+		return lua_do_error(tolua_S, "Error in function call '#funcname#': Invalid DataTypes");
+	}
+
+	// Create a reference to the callback:
+	lua_pushvalue(tolua_S, 9);
+	int FnRef = luaL_ref(tolua_S, LUA_REGISTRYINDEX);
+	if (FnRef == LUA_REFNIL)
+	{
+		return lua_do_error(tolua_S, "Error in function call '#funcname#': Could not get function reference of parameter #8");
+	}
+
+	auto Reader = std::make_shared<cLuaBlockAreaReader>(*Plugin, FnRef);
+	Plugin->AddResettable(Reader);
+	cCuboid Bounds(MinX, MinY, MinZ, MaxX, MaxY, MaxZ);
+	cRoot::Get()->GetThreadPool().Submit([Reader, World, Bounds, DataTypes]()
+		{
+			Reader->Run(*World, Bounds, DataTypes);
+		},
+		cThreadPool::tpLow
+	);
+	return 0;
+}
+
+
+
+
+
 static int tolua_cPluginManager_GetAllPlugins(lua_State * tolua_S)
 {
 	// API function no longer available:
@@ -1466,6 +1644,63 @@ static int tolua_cPluginManager_LogStackTrace(lua_State * S)
 
 
 
+static int tolua_cPluginManager_QueueWorkerJob(lua_State * tolua_S)
+{
+	/*
+	Function signature:
+	cPluginManager:QueueWorkerJob("FileName", "FunctionName", CallbackFn, args...)
+	Calls FunctionName(args...) from the plugin's FileName in a worker Lua state on the thread pool,
+	then calls CallbackFn(true, results...) or CallbackFn(false, ErrorMsg) in the plugin's main state. CallbackFn may be nil.
+	*/
+
+	// Check the params:
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamUserTable(1, "cPluginManager") ||
+		!L.CheckParamString(2, 3) ||
+		!L.CheckParamFunctionOrNil(4)
+	)
+	{
+		return 0;
+	}
+	cPluginLua * Plugin = GetLuaPlugin(L);
+	if (Plugin == nullptr)
+	{
+		return 0;
+	}
+	AString FileName, FunctionName;
+	L.ToString(2, FileName);
+	L.ToString(3, FunctionName);
+
+	// Copy the args, only plain values can be passed to the worker state:
+	cLuaWorkerValues Args;
+	int Top = lua_gettop(L);
+	for (int i = 5; i <= Top; i++)
+	{
+		AString Error;
+		Args.emplace_back();
+		if (!Args.back().Read(L, i, Error))
+		{
+			return lua_do_error(tolua_S, "Error in function call '#funcname#': Cannot pass parameter #%d to the worker: %s", i - 1, Error.c_str());
+		}
+	}
+
+	// Create a reference to the callback:
+	int CallbackRef = LUA_REFNIL;
+	if (lua_isfunction(L, 4))
+	{
+		lua_pushvalue(L, 4);
+		CallbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+
+	Plugin->GetWorkers()->QueueJob(FileName, FunctionName, std::move(Args), CallbackRef);
+	return 0;
+}
+
+
+
+
+
 static int tolua_cPluginManager_AddHook_FnRef(cPluginManager * a_PluginManager, cLuaState & S, int a_ParamIdx)
 {
 	// Helper function for cPluginmanager:AddHook() binding
@@ -2409,12 +2644,21 @@ static int tolua_cPluginLua_AddWebTab(lua_State * tolua_S)
 
 	std::string Title = "";
 	int Reference = LUA_REFNIL;
+	int UploadReference = LUA_REFNIL;
 
 	if (
 		tolua_isstring(tolua_S, 2, 0, &tolua_err) &&
-		lua_isfunction(tolua_S, 3)
+		lua_isfunction(tolua_S, 3) &&
+		(lua_isnoneornil(tolua_S, 4) || lua_isfunction(tolua_S, 4))
 	)
 	{
+		// The optional 4th param is the handler for the file uploads to the tab:
+		if (lua_isfunction(tolua_S, 4))
+		{
+			lua_settop(tolua_S, 4);
+			UploadReference = luaL_ref(tolua_S, LUA_REGISTRYINDEX);
+		}
+		lua_settop(tolua_S, 3);
 		Reference = luaL_ref(tolua_S, LUA_REGISTRYINDEX);
 		Title = ((std::string)tolua_tocppstring(tolua_S, 2, 0));
 	}
@@ -2425,9 +2669,10 @@ static int tolua_cPluginLua_AddWebTab(lua_State * tolua_S)
 
 	if (Reference != LUA_REFNIL)
 	{
-		if (!self->AddWebTab(Title.c_str(), tolua_S, Reference))
+		if (!self->AddWebTab(Title.c_str(), tolua_S, Reference, UploadReference))
 		{
 			luaL_unref(tolua_S, LUA_REGISTRYINDEX, Reference);
+			luaL_unref(tolua_S, LUA_REGISTRYINDEX, UploadReference);
 		}
 	}
 	else
@@ -3167,6 +3412,45 @@ static int tolua_cLineBlockTracer_Trace(lua_State * tolua_S)
 
 
 
+static int tolua_cLineBlockTracer_LineOfSightTrace(lua_State * tolua_S)
+{
+	/* Supported function signatures:
+	cLineBlockTracer:LineOfSightTrace(World, StartX, StartY, StartZ, EndX, EndY, EndZ)  // Canonical
+	cLineBlockTracer.LineOfSightTrace(World, StartX, StartY, StartZ, EndX, EndY, EndZ)
+	*/
+	
+	// If the first param is the cLineBlockTracer class, shift param index by one:
+	int idx = 1;
+	tolua_Error err;
+	if (tolua_isusertable(tolua_S, 1, "cLineBlockTracer", 0, &err))
+	{
+		idx = 2;
+	}
+	
+	// Check params:
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamUserType(idx, "cWorld") ||
+		!L.CheckParamNumber  (idx + 1, idx + 6) ||
+		!L.CheckParamEnd     (idx + 7)
+	)
+	{
+		return 0;
+	}
+
+	// Trace:
+	cWorld * World = (cWorld *)tolua_tousertype(L, idx, nullptr);
+	Vector3d Start(tolua_tonumber(L, idx + 1, 0), tolua_tonumber(L, idx + 2, 0), tolua_tonumber(L, idx + 3, 0));
+	Vector3d End  (tolua_tonumber(L, idx + 4, 0), tolua_tonumber(L, idx + 5, 0), tolua_tonumber(L, idx + 6, 0));
+	bool res = cLineBlockTracer::LineOfSightTrace(*World, Start, End);
+	tolua_pushboolean(L, res ? 1 : 0);
+	return 1;
+}
+
+
+
+
+
 static int tolua_cRoot_GetFurnaceRecipe(lua_State * tolua_S)
 {
 	cLuaState L(tolua_S);
@@ -3247,6 +3531,74 @@ static int tolua_cHopperEntity_GetOutputBlockPos(lua_State * tolua_S)
 
 
 
+static int tolua_cBlockArea_GetBlockMetasString(lua_State * tolua_S)
+{
+	// function cBlockArea:GetBlockMetasString()
+	// Returns the metas of all the blocks packed in a string, one byte per block, in the same order as the block types
+	// Exported manually so that the plugins can process the whole area without a Lua / C++ call for each block
+
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamUserType(1, "cBlockArea") ||
+		!L.CheckParamEnd     (2)
+	)
+	{
+		return 0;
+	}
+	cBlockArea * self = (cBlockArea *)tolua_tousertype(tolua_S, 1, nullptr);
+	if (self == nullptr)
+	{
+		tolua_error(tolua_S, "invalid 'self' in function 'cBlockArea:GetBlockMetasString'", nullptr);
+		return 0;
+	}
+	if (self->GetBlockMetas() == nullptr)
+	{
+		// The area doesn't hold the metas
+		lua_pushnil(tolua_S);
+		return 1;
+	}
+	lua_pushlstring(tolua_S, reinterpret_cast<const char *>(self->GetBlockMetas()), self->GetBlockCount());
+	return 1;
+}
+
+
+
+
+
+static int tolua_cBlockArea_GetBlockTypesString(lua_State * tolua_S)
+{
+	// function cBlockArea:GetBlockTypesString()
+	// Returns the types of all the blocks packed in a string, one byte per block, indexed by (x + z * SizeX + y * SizeX * SizeZ)
+	// Exported manually so that the plugins can process the whole area without a Lua / C++ call for each block
+
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamUserType(1, "cBlockArea") ||
+		!L.CheckParamEnd     (2)
+	)
+	{
+		return 0;
+	}
+	cBlockArea * self = (cBlockArea *)tolua_tousertype(tolua_S, 1, nullptr);
+	if (self == nullptr)
+	{
+		tolua_error(tolua_S, "invalid 'self' in function 'cBlockArea:GetBlockTypesString'", nullptr);
+		return 0;
+	}
+	if (self->GetBlockTypes() == nullptr)
+	{
+		// The area doesn't hold the block types
+		lua_pushnil(tolua_S);
+		return 1;
+	}
+	lua_pushlstring(tolua_S, reinterpret_cast<const char *>(self->GetBlockTypes()), self->GetBlockCount());
+	return 1;
+}
+
+
+
+
+
 static int tolua_cBlockArea_GetBlockTypeMeta(lua_State * tolua_S)
 {
 	// function cBlockArea::GetBlockTypeMeta()
@@ -3849,7 +4201,9 @@ void ManualBindings::Bind(lua_State * tolua_S)
 		tolua_endmodule(tolua_S);
 		
 		tolua_beginmodule(tolua_S, "cBlockArea");
+			tolua_function(tolua_S, "GetBlockMetasString",     tolua_cBlockArea_GetBlockMetasString);
 			tolua_function(tolua_S, "GetBlockTypeMeta",        tolua_cBlockArea_GetBlockTypeMeta);
+			tolua_function(tolua_S, "GetBlockTypesString",     tolua_cBlockArea_GetBlockTypesString);
 			tolua_function(tolua_S, "GetCoordRange",           tolua_cBlockArea_GetCoordRange);
 			tolua_function(tolua_S, "GetOrigin",               tolua_cBlockArea_GetOrigin);
 			tolua_function(tolua_S, "GetNonAirCropRelCoords",  tolua_cBlockArea_GetNonAirCropRelCoords);
@@ -3876,7 +4230,8 @@ void ManualBindings::Bind(lua_State * tolua_S)
 		tolua_endmodule(tolua_S);
 		
 		tolua_beginmodule(tolua_S, "cLineBlockTracer");
-			tolua_function(tolua_S, "Trace", tolua_cLineBlockTracer_Trace);
+			tolua_function(tolua_S, "LineOfSightTrace", tolua_cLineBlockTracer_LineOfSightTrace);
+			tolua_function(tolua_S, "Trace",            tolua_cLineBlockTracer_Trace);
 		tolua_endmodule(tolua_S);
 		
 		tolua_beginmodule(tolua_S, "cRoot");
@@ -3914,8 +4269,10 @@ void ManualBindings::Bind(lua_State * tolua_S)
 			tolua_function(tolua_S, "ForEachPlayer",             tolua_ForEach<       cWorld, cPlayer,        &cWorld::ForEachPlayer>);
 			tolua_function(tolua_S, "GetBlockInfo",              tolua_cWorld_GetBlockInfo);
 			tolua_function(tolua_S, "GetBlockTypeMeta",          tolua_cWorld_GetBlockTypeMeta);
+			tolua_function(tolua_S, "GetEntitiesInBox",          tolua_cWorld_GetEntitiesInBox);
 			tolua_function(tolua_S, "GetSignLines",              tolua_cWorld_GetSignLines);
 			tolua_function(tolua_S, "PrepareChunk",              tolua_cWorld_PrepareChunk);
+			tolua_function(tolua_S, "QueueReadBlockArea",        tolua_cWorld_QueueReadBlockArea);
 			tolua_function(tolua_S, "QueueTask",                 tolua_cWorld_QueueTask);
 			tolua_function(tolua_S, "ScheduleTask",              tolua_cWorld_ScheduleTask);
 			tolua_function(tolua_S, "SetSignLines",              tolua_cWorld_SetSignLines);
@@ -3951,6 +4308,7 @@ void ManualBindings::Bind(lua_State * tolua_S)
 			tolua_function(tolua_S, "GetCurrentPlugin",      tolua_cPluginManager_GetCurrentPlugin);
 			tolua_function(tolua_S, "GetPlugin",             tolua_cPluginManager_GetPlugin);
 			tolua_function(tolua_S, "LogStackTrace",         tolua_cPluginManager_LogStackTrace);
+			tolua_function(tolua_S, "QueueWorkerJob",        tolua_cPluginManager_QueueWorkerJob);
 		tolua_endmodule(tolua_S);
 		
 		tolua_beginmodule(tolua_S, "cPlayer");
@@ -60,3 +60,47 @@ void cPlugin::SetLoadError(const AString & a_LoadError)
 
 
 
+
+////////////////////////////////////////////////////////////////////////////////
+// cPlugin::sCallStats:
+
+cPlugin::sCallStats::sCallStats(void) :
+	m_NumCalls(0),
+	m_TotalMicrosec(0),
+	m_MaxMicrosec(0)
+{
+	std::fill(m_Histogram, m_Histogram + NUM_BUCKETS, 0);
+}
+
+
+
+
+
+void cPlugin::sCallStats::Add(UInt64 a_Microsec)
+{
+	m_NumCalls += 1;
+	m_TotalMicrosec += a_Microsec;
+	m_MaxMicrosec = std::max(m_MaxMicrosec, a_Microsec);
+	int Bucket = 0;
+	for (UInt64 Limit = 10; (Bucket < NUM_BUCKETS - 1) && (a_Microsec >= Limit); Limit *= 10)
+	{
+		Bucket += 1;
+	}
+	m_Histogram[Bucket] += 1;
+}
+
+
+
+
+
+const char * cPlugin::sCallStats::GetBucketName(int a_Bucket)
+{
+	static const char * BucketNames[] = { "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms" };
+	static_assert(ARRAYCOUNT(BucketNames) == NUM_BUCKETS, "The bucket names don't match the number of buckets");
+	ASSERT((a_Bucket >= 0) && (a_Bucket < NUM_BUCKETS));
+	return BucketNames[a_Bucket];
+}
+
+
+
+
@@ -75,6 +75,7 @@ public:
 	virtual bool OnPlayerJoined             (cPlayer & a_Player) = 0;
 	virtual bool OnPlayerLeftClick          (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, char a_Status) = 0;
 	virtual bool OnPlayerMoving             (cPlayer & a_Player, const Vector3d & a_OldPosition, const Vector3d & a_NewPosition) = 0;
+	virtual bool OnPlayersMoved             (cWorld & a_World, const cPluginManager::cPlayerMoves & a_Moves) = 0;
 	virtual bool OnPlayerPlacedBlock        (cPlayer & a_Player, const sSetBlock & a_BlockChange) = 0;
 	virtual bool OnPlayerPlacingBlock       (cPlayer & a_Player, const sSetBlock & a_BlockChange) = 0;
 	virtual bool OnPlayerRightClick         (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, int a_CursorX, int a_CursorY, int a_CursorZ) = 0;
@@ -119,6 +120,38 @@ public:
 	
 	/** All bound console commands are to be removed, do any language-dependent cleanup here */
 	virtual void ClearConsoleCommands(void) {}
+
+	/** Timing statistics of the calls of a single kind into the plugin, such as a single hook or a single command. */
+	struct sCallStats
+	{
+		/** Number of the histogram buckets. Bucket i counts the calls shorter than 10^(i + 1) microseconds,
+		the last bucket counts all the longer calls. */
+		static const int NUM_BUCKETS = 6;
+
+		UInt64 m_NumCalls;
+		UInt64 m_TotalMicrosec;
+		UInt64 m_MaxMicrosec;
+		UInt64 m_Histogram[NUM_BUCKETS];
+
+		sCallStats(void);
+
+		/** Adds a single call of the specified duration. */
+		void Add(UInt64 a_Microsec);
+
+		/** Returns the human-readable duration range of the specified histogram bucket, such as "<1ms". */
+		static const char * GetBucketName(int a_Bucket);
+	} ;
+
+	/** Maps the hook or command name to its call stats. */
+	typedef std::map<AString, sCallStats> cCallStatsMap;
+
+	/** Fills a_Calls with the stats of the calls into the plugin since it was loaded or since the last ResetStats(),
+	and sets a_MemoryUsed to the number of bytes allocated by the plugin's scripting engine (0 if unknown).
+	The default implementation, for the plugins that don't keep any stats, reports nothing. */
+	virtual void GetStats(cCallStatsMap & a_Calls, size_t & a_MemoryUsed) { a_MemoryUsed = 0; }
+
+	/** Clears the call stats. */
+	virtual void ResetStats(void) {}
 	
 	// tolua_begin
 	const AString & GetName(void) const  { return m_Name; }
@@ -12,6 +12,7 @@
 #endif
 
 #include "PluginLua.h"
+#include "LuaWorkers.h"
 #include "../CommandOutput.h"
 #include "PluginManager.h"
 #include "../Item.h"
@@ -33,8 +34,10 @@ extern "C"
 
 cPluginLua::cPluginLua(const AString & a_PluginDirectory) :
 	cPlugin(a_PluginDirectory),
-	m_LuaState(Printf("plugin %s", a_PluginDirectory.c_str()))
+	m_LuaState(Printf("plugin %s", a_PluginDirectory.c_str())),
+	m_NumWatchdogAborts(0)
 {
+	m_CriticalSection.SetName("cPluginLua::m_CriticalSection");
 }
 
 
@@ -79,6 +82,7 @@ void cPluginLua::Close(void)
 		}
 		m_Resettables.clear();
 	}  // cCSUnlock (m_CriticalSection)
+	m_Workers.reset();
 
 	// Release all the references in the hook map:
 	for (cHookMap::iterator itrH = m_HookMap.begin(), endH = m_HookMap.end(); itrH != endH; ++itrH)
@@ -195,6 +199,11 @@ bool cPluginLua::Load(void)
 		return false;
 	}
 
+	// Watch the callbacks from now on; Initialize() itself is allowed to take long:
+	cPluginManager * PluginManager = cPluginManager::Get();
+	m_NumWatchdogAborts = 0;
+	m_LuaState.SetWatchdog(PluginManager->GetWatchdogWarnMSec(), PluginManager->GetWatchdogAbortMSec(), [this]() { OnWatchdogAbort(); });
+
 	m_Status = cPluginManager::psLoaded;
 	return true;
 }
@@ -203,6 +212,26 @@ bool cPluginLua::Load(void)
 
 
 
+void cPluginLua::OnWatchdogAbort(void)
+{
+	// Called from within the aborted callback, m_CriticalSection is already locked
+	m_NumWatchdogAborts += 1;
+	int MaxAborts = cPluginManager::Get()->GetWatchdogMaxAborts();
+	LOGWARNING("Plugin %s: A callback has exceeded the time limit of %d msec and has been aborted.",
+		GetName().c_str(), cPluginManager::Get()->GetWatchdogAbortMSec()
+	);
+	if (m_NumWatchdogAborts == MaxAborts)
+	{
+		// The unloading is queued, because the plugin is in the middle of a call:
+		LOGWARNING("Plugin %s: %d callbacks have been aborted, the plugin is being disabled.", GetName().c_str(), MaxAborts);
+		cPluginManager::Get()->UnloadPlugin(GetFolderName());
+	}
+}
+
+
+
+
+
 void cPluginLua::Unload(void)
 {
 	ClearTabs();
@@ -236,6 +265,12 @@ void cPluginLua::Tick(float a_Dt)
 		return;
 	}
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_TICK];
+	if (Refs.empty())
+	{
+		// Don't count the ticks of plugins that don't hook them
+		return;
+	}
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_TICK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), a_Dt);
@@ -246,6 +281,44 @@ void cPluginLua::Tick(float a_Dt)
 
 
 
+void cPluginLua::GetStats(cCallStatsMap & a_Calls, size_t & a_MemoryUsed)
+{
+	cCSLock Lock(m_CriticalSection);
+	for (int i = 0; i < cPluginManager::HOOK_NUM_HOOKS; i++)
+	{
+		if (m_HookStats[i].m_NumCalls > 0)
+		{
+			a_Calls[GetHookFnName(i)] = m_HookStats[i];
+		}
+	}
+	for (const auto & Command: m_CommandStats)
+	{
+		a_Calls[Command.first] = Command.second;
+	}
+
+	a_MemoryUsed = 0;
+	if (m_LuaState.IsValid())
+	{
+		// LUA_GCCOUNT is in KiB, LUA_GCCOUNTB is the remainder in bytes:
+		a_MemoryUsed = static_cast<size_t>(lua_gc(m_LuaState, LUA_GCCOUNT, 0)) * 1024 + static_cast<size_t>(lua_gc(m_LuaState, LUA_GCCOUNTB, 0));
+	}
+}
+
+
+
+
+
+void cPluginLua::ResetStats(void)
+{
+	cCSLock Lock(m_CriticalSection);
+	std::fill(m_HookStats, m_HookStats + cPluginManager::HOOK_NUM_HOOKS, sCallStats());
+	m_CommandStats.clear();
+}
+
+
+
+
+
 bool cPluginLua::OnBlockSpread(cWorld & a_World, int a_BlockX, int a_BlockY, int a_BlockZ, eSpreadSource a_Source)
 {
 	cCSLock Lock(m_CriticalSection);
@@ -255,6 +328,7 @@ bool cPluginLua::OnBlockSpread(cWorld & a_World, int a_BlockX, int a_BlockY, int
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_BLOCK_SPREAD];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_BLOCK_SPREAD]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_BlockX, a_BlockY, a_BlockZ, a_Source, cLuaState::Return, res);
@@ -279,6 +353,7 @@ bool cPluginLua::OnBlockToPickups(cWorld & a_World, cEntity * a_Digger, int a_Bl
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_BLOCK_TO_PICKUPS];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_BLOCK_TO_PICKUPS]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_Digger, a_BlockX, a_BlockY, a_BlockZ, a_BlockType, a_BlockMeta, &a_Pickups, cLuaState::Return, res);
@@ -303,6 +378,7 @@ bool cPluginLua::OnChat(cPlayer & a_Player, AString & a_Message)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CHAT];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CHAT]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_Message, cLuaState::Return, res, a_Message);
@@ -327,6 +403,7 @@ bool cPluginLua::OnChunkAvailable(cWorld & a_World, int a_ChunkX, int a_ChunkZ)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CHUNK_AVAILABLE];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CHUNK_AVAILABLE]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_ChunkX, a_ChunkZ, cLuaState::Return, res);
@@ -351,6 +428,7 @@ bool cPluginLua::OnChunkGenerated(cWorld & a_World, int a_ChunkX, int a_ChunkZ,
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CHUNK_GENERATED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CHUNK_GENERATED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_ChunkX, a_ChunkZ, a_ChunkDesc, cLuaState::Return, res);
@@ -375,6 +453,7 @@ bool cPluginLua::OnChunkGenerating(cWorld & a_World, int a_ChunkX, int a_ChunkZ,
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CHUNK_GENERATING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CHUNK_GENERATING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_ChunkX, a_ChunkZ, a_ChunkDesc, cLuaState::Return, res);
@@ -399,6 +478,7 @@ bool cPluginLua::OnChunkUnloaded(cWorld & a_World, int a_ChunkX, int a_ChunkZ)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CHUNK_UNLOADED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CHUNK_UNLOADED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_ChunkX, a_ChunkZ, cLuaState::Return, res);
@@ -423,6 +503,7 @@ bool cPluginLua::OnChunkUnloading(cWorld & a_World, int a_ChunkX, int a_ChunkZ)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CHUNK_UNLOADING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CHUNK_UNLOADING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_ChunkX, a_ChunkZ, cLuaState::Return, res);
@@ -447,6 +528,7 @@ bool cPluginLua::OnCollectingPickup(cPlayer & a_Player, cPickup & a_Pickup)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_COLLECTING_PICKUP];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_COLLECTING_PICKUP]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, &a_Pickup, cLuaState::Return, res);
@@ -471,6 +553,7 @@ bool cPluginLua::OnCraftingNoRecipe(cPlayer & a_Player, cCraftingGrid & a_Grid,
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_CRAFTING_NO_RECIPE];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_CRAFTING_NO_RECIPE]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, &a_Grid, &a_Recipe, cLuaState::Return, res);
@@ -495,6 +578,7 @@ bool cPluginLua::OnDisconnect(cClientHandle & a_Client, const AString & a_Reason
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_DISCONNECT];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_DISCONNECT]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Client, a_Reason, cLuaState::Return, res);
@@ -519,6 +603,7 @@ bool cPluginLua::OnEntityAddEffect(cEntity & a_Entity, int a_EffectType, int a_E
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_ENTITY_ADD_EFFECT];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_ENTITY_ADD_EFFECT]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Entity, a_EffectType, a_EffectDurationTicks, a_EffectIntensity, a_DistanceModifier, cLuaState::Return, res);
@@ -543,6 +628,7 @@ bool cPluginLua::OnExecuteCommand(cPlayer * a_Player, const AStringVector & a_Sp
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_EXECUTE_COMMAND];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_EXECUTE_COMMAND]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), a_Player, a_Split, a_EntireCommand, cLuaState::Return, res, a_Result);
@@ -567,6 +653,7 @@ bool cPluginLua::OnExploded(cWorld & a_World, double a_ExplosionSize, bool a_Can
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_EXPLODED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_EXPLODED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		switch (a_Source)
@@ -608,6 +695,7 @@ bool cPluginLua::OnExploding(cWorld & a_World, double & a_ExplosionSize, bool &
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_EXPLODING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_EXPLODING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		switch (a_Source)
@@ -649,6 +737,7 @@ bool cPluginLua::OnHandshake(cClientHandle & a_Client, const AString & a_Usernam
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_HANDSHAKE];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_HANDSHAKE]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Client, a_Username, cLuaState::Return, res);
@@ -673,6 +762,7 @@ bool cPluginLua::OnHopperPullingItem(cWorld & a_World, cHopperEntity & a_Hopper,
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_HOPPER_PULLING_ITEM];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_HOPPER_PULLING_ITEM]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, &a_Hopper, a_DstSlotNum, &a_SrcEntity, a_SrcSlotNum, cLuaState::Return, res);
@@ -697,6 +787,7 @@ bool cPluginLua::OnHopperPushingItem(cWorld & a_World, cHopperEntity & a_Hopper,
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_HOPPER_PUSHING_ITEM];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_HOPPER_PUSHING_ITEM]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, &a_Hopper, a_SrcSlotNum, &a_DstEntity, a_DstSlotNum, cLuaState::Return, res);
@@ -721,6 +812,7 @@ bool cPluginLua::OnKilling(cEntity & a_Victim, cEntity * a_Killer, TakeDamageInf
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_KILLING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_KILLING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Victim, a_Killer, &a_TDI, cLuaState::Return, res);
@@ -745,6 +837,7 @@ bool cPluginLua::OnLogin(cClientHandle & a_Client, int a_ProtocolVersion, const
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_LOGIN];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_LOGIN]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Client, a_ProtocolVersion, a_Username, cLuaState::Return, res);
@@ -769,6 +862,7 @@ bool cPluginLua::OnPlayerAnimation(cPlayer & a_Player, int a_Animation)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_ANIMATION];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_ANIMATION]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_Animation, cLuaState::Return, res);
@@ -793,6 +887,7 @@ bool cPluginLua::OnPlayerBreakingBlock(cPlayer & a_Player, int a_BlockX, int a_B
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_BREAKING_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_BREAKING_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_BlockType, a_BlockMeta, cLuaState::Return, res);
@@ -817,6 +912,7 @@ bool cPluginLua::OnPlayerBrokenBlock(cPlayer & a_Player, int a_BlockX, int a_Blo
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_BROKEN_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_BROKEN_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_BlockType, a_BlockMeta, cLuaState::Return, res);
@@ -841,6 +937,7 @@ bool cPluginLua::OnPlayerDestroyed(cPlayer & a_Player)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_DESTROYED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_DESTROYED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, cLuaState::Return, res);
@@ -865,6 +962,7 @@ bool cPluginLua::OnPlayerEating(cPlayer & a_Player)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_EATING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_EATING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, cLuaState::Return, res);
@@ -889,6 +987,7 @@ bool cPluginLua::OnPlayerFoodLevelChange(cPlayer & a_Player, int a_NewFoodLevel)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_FOOD_LEVEL_CHANGE];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_FOOD_LEVEL_CHANGE]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_NewFoodLevel, cLuaState::Return, res);
@@ -913,6 +1012,7 @@ bool cPluginLua::OnPlayerFished(cPlayer & a_Player, const cItems & a_Reward)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_FISHED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_FISHED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_Reward, cLuaState::Return, res);
@@ -937,6 +1037,7 @@ bool cPluginLua::OnPlayerFishing(cPlayer & a_Player, cItems & a_Reward)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_FISHING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_FISHING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, &a_Reward, cLuaState::Return, res);
@@ -961,6 +1062,7 @@ bool cPluginLua::OnPlayerJoined(cPlayer & a_Player)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_JOINED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_JOINED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, cLuaState::Return, res);
@@ -985,6 +1087,7 @@ bool cPluginLua::OnPlayerLeftClick(cPlayer & a_Player, int a_BlockX, int a_Block
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_LEFT_CLICK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_LEFT_CLICK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_Status, cLuaState::Return, res);
@@ -1009,6 +1112,7 @@ bool cPluginLua::OnPlayerMoving(cPlayer & a_Player, const Vector3d & a_OldPositi
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_MOVING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_MOVING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_OldPosition, a_NewPosition, cLuaState::Return, res);
@@ -1024,6 +1128,31 @@ bool cPluginLua::OnPlayerMoving(cPlayer & a_Player, const Vector3d & a_OldPositi
 
 
 
+bool cPluginLua::OnPlayersMoved(cWorld & a_World, const cPluginManager::cPlayerMoves & a_Moves)
+{
+	cCSLock Lock(m_CriticalSection);
+	if (!m_LuaState.IsValid())
+	{
+		return false;
+	}
+	bool res = false;
+	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYERS_MOVED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYERS_MOVED]);
+	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
+	{
+		m_LuaState.Call((int)(**itr), &a_World, a_Moves, cLuaState::Return, res);
+		if (res)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+
 bool cPluginLua::OnEntityTeleport(cEntity & a_Entity, const Vector3d & a_OldPosition, const Vector3d & a_NewPosition)
 {
 	cCSLock Lock(m_CriticalSection);
@@ -1033,6 +1162,7 @@ bool cPluginLua::OnEntityTeleport(cEntity & a_Entity, const Vector3d & a_OldPosi
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_ENTITY_TELEPORT];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_ENTITY_TELEPORT]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Entity, a_OldPosition, a_NewPosition, cLuaState::Return, res);
@@ -1057,6 +1187,7 @@ bool cPluginLua::OnPlayerPlacedBlock(cPlayer & a_Player, const sSetBlock & a_Blo
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_PLACED_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_PLACED_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player,
@@ -1086,6 +1217,7 @@ bool cPluginLua::OnPlayerPlacingBlock(cPlayer & a_Player, const sSetBlock & a_Bl
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_PLACING_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_PLACING_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player,
@@ -1115,6 +1247,7 @@ bool cPluginLua::OnPlayerRightClick(cPlayer & a_Player, int a_BlockX, int a_Bloc
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_RIGHT_CLICK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_RIGHT_CLICK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, cLuaState::Return, res);
@@ -1139,6 +1272,7 @@ bool cPluginLua::OnPlayerRightClickingEntity(cPlayer & a_Player, cEntity & a_Ent
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_RIGHT_CLICKING_ENTITY];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_RIGHT_CLICKING_ENTITY]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, &a_Entity, cLuaState::Return, res);
@@ -1163,6 +1297,7 @@ bool cPluginLua::OnPlayerShooting(cPlayer & a_Player)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_SHOOTING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_SHOOTING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, cLuaState::Return, res);
@@ -1187,6 +1322,7 @@ bool cPluginLua::OnPlayerSpawned(cPlayer & a_Player)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_SPAWNED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_SPAWNED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, cLuaState::Return, res);
@@ -1211,6 +1347,7 @@ bool cPluginLua::OnPlayerTossingItem(cPlayer & a_Player)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_TOSSING_ITEM];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_TOSSING_ITEM]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, cLuaState::Return, res);
@@ -1235,6 +1372,7 @@ bool cPluginLua::OnPlayerUsedBlock(cPlayer & a_Player, int a_BlockX, int a_Block
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_USED_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_USED_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, a_BlockType, a_BlockMeta, cLuaState::Return, res);
@@ -1259,6 +1397,7 @@ bool cPluginLua::OnPlayerUsedItem(cPlayer & a_Player, int a_BlockX, int a_BlockY
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_USED_ITEM];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_USED_ITEM]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, cLuaState::Return, res);
@@ -1283,6 +1422,7 @@ bool cPluginLua::OnPlayerUsingBlock(cPlayer & a_Player, int a_BlockX, int a_Bloc
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_USING_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_USING_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, a_BlockType, a_BlockMeta, cLuaState::Return, res);
@@ -1307,6 +1447,7 @@ bool cPluginLua::OnPlayerUsingItem(cPlayer & a_Player, int a_BlockX, int a_Block
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLAYER_USING_ITEM];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLAYER_USING_ITEM]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, cLuaState::Return, res);
@@ -1331,6 +1472,7 @@ bool cPluginLua::OnPluginMessage(cClientHandle & a_Client, const AString & a_Cha
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLUGIN_MESSAGE];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLUGIN_MESSAGE]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Client, a_Channel, a_Message, cLuaState::Return, res);
@@ -1355,6 +1497,7 @@ bool cPluginLua::OnPluginsLoaded(void)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PLUGINS_LOADED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PLUGINS_LOADED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		bool ret = false;
@@ -1377,6 +1520,7 @@ bool cPluginLua::OnPostCrafting(cPlayer & a_Player, cCraftingGrid & a_Grid, cCra
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_POST_CRAFTING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_POST_CRAFTING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, &a_Grid, &a_Recipe, cLuaState::Return, res);
@@ -1401,6 +1545,7 @@ bool cPluginLua::OnPreCrafting(cPlayer & a_Player, cCraftingGrid & a_Grid, cCraf
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PRE_CRAFTING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PRE_CRAFTING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Player, &a_Grid, &a_Recipe, cLuaState::Return, res);
@@ -1425,6 +1570,7 @@ bool cPluginLua::OnProjectileHitBlock(cProjectileEntity & a_Projectile, int a_Bl
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PROJECTILE_HIT_BLOCK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PROJECTILE_HIT_BLOCK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Projectile, a_BlockX, a_BlockY, a_BlockZ, a_Face, a_BlockHitPos, cLuaState::Return, res);
@@ -1449,6 +1595,7 @@ bool cPluginLua::OnProjectileHitEntity(cProjectileEntity & a_Projectile, cEntity
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_PROJECTILE_HIT_ENTITY];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_PROJECTILE_HIT_ENTITY]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Projectile, &a_HitEntity, cLuaState::Return, res);
@@ -1473,6 +1620,7 @@ bool cPluginLua::OnServerPing(cClientHandle & a_ClientHandle, AString & a_Server
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_SERVER_PING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_SERVER_PING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_ClientHandle, a_ServerDescription, a_OnlinePlayersCount, a_MaxPlayersCount, a_Favicon, cLuaState::Return, res, a_ServerDescription, a_OnlinePlayersCount, a_MaxPlayersCount, a_Favicon);
@@ -1497,6 +1645,7 @@ bool cPluginLua::OnSpawnedEntity(cWorld & a_World, cEntity & a_Entity)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_SPAWNED_ENTITY];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_SPAWNED_ENTITY]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, &a_Entity, cLuaState::Return, res);
@@ -1521,6 +1670,7 @@ bool cPluginLua::OnSpawnedMonster(cWorld & a_World, cMonster & a_Monster)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_SPAWNED_MONSTER];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_SPAWNED_MONSTER]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, &a_Monster, cLuaState::Return, res);
@@ -1545,6 +1695,7 @@ bool cPluginLua::OnSpawningEntity(cWorld & a_World, cEntity & a_Entity)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_SPAWNING_ENTITY];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_SPAWNING_ENTITY]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, &a_Entity, cLuaState::Return, res);
@@ -1569,6 +1720,7 @@ bool cPluginLua::OnSpawningMonster(cWorld & a_World, cMonster & a_Monster)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_SPAWNING_MONSTER];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_SPAWNING_MONSTER]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, &a_Monster, cLuaState::Return, res);
@@ -1593,6 +1745,7 @@ bool cPluginLua::OnTakeDamage(cEntity & a_Receiver, TakeDamageInfo & a_TDI)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_TAKE_DAMAGE];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_TAKE_DAMAGE]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_Receiver, &a_TDI, cLuaState::Return, res);
@@ -1622,6 +1775,7 @@ bool cPluginLua::OnUpdatedSign(
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_UPDATED_SIGN];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_UPDATED_SIGN]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_BlockX, a_BlockY, a_BlockZ, a_Line1, a_Line2, a_Line3, a_Line4, a_Player, cLuaState::Return, res);
@@ -1651,6 +1805,7 @@ bool cPluginLua::OnUpdatingSign(
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_UPDATING_SIGN];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_UPDATING_SIGN]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_BlockX, a_BlockY, a_BlockZ, a_Line1, a_Line2, a_Line3, a_Line4, a_Player, cLuaState::Return, res, a_Line1, a_Line2, a_Line3, a_Line4);
@@ -1675,6 +1830,7 @@ bool cPluginLua::OnWeatherChanged(cWorld & a_World)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_WEATHER_CHANGED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_WEATHER_CHANGED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, cLuaState::Return, res);
@@ -1699,6 +1855,7 @@ bool cPluginLua::OnWeatherChanging(cWorld & a_World, eWeather & a_NewWeather)
 	}
 	bool res = false;
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_WEATHER_CHANGING];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_WEATHER_CHANGING]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_NewWeather, cLuaState::Return, res, a_NewWeather);
@@ -1722,6 +1879,7 @@ bool cPluginLua::OnWorldStarted(cWorld & a_World)
 		return false;
 	}
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_WORLD_STARTED];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_WORLD_STARTED]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World);
@@ -1741,6 +1899,7 @@ bool cPluginLua::OnWorldTick(cWorld & a_World, std::chrono::milliseconds a_Dt, s
 		return false;
 	}
 	cLuaRefs & Refs = m_HookMap[cPluginManager::HOOK_WORLD_TICK];
+	cCallTimer Timer(m_HookStats[cPluginManager::HOOK_WORLD_TICK]);
 	for (cLuaRefs::iterator itr = Refs.begin(), end = Refs.end(); itr != end; ++itr)
 	{
 		m_LuaState.Call((int)(**itr), &a_World, a_Dt, a_LastTickDurationMSec);
@@ -1763,6 +1922,7 @@ bool cPluginLua::HandleCommand(const AStringVector & a_Split, cPlayer & a_Player
 	}
 	
 	cCSLock Lock(m_CriticalSection);
+	cCallTimer Timer(m_CommandStats[a_Split[0]]);
 	bool res = false;
 	m_LuaState.Call(cmd->second, a_Split, &a_Player, a_FullCommand, cLuaState::Return, res);
 	return res;
@@ -1785,6 +1945,7 @@ bool cPluginLua::HandleConsoleCommand(const AStringVector & a_Split, cCommandOut
 	}
 	
 	cCSLock Lock(m_CriticalSection);
+	cCallTimer Timer(m_CommandStats[a_Split[0]]);
 	bool res = false;
 	AString str;
 	m_LuaState.Call(cmd->second, a_Split, a_FullCommand, cLuaState::Return, res, str);
@@ -1906,6 +2067,7 @@ const char * cPluginLua::GetHookFnName(int a_HookType)
 		case cPluginManager::HOOK_PLAYER_USED_ITEM:             return "OnPlayerUsedItem";
 		case cPluginManager::HOOK_PLAYER_USING_BLOCK:           return "OnPlayerUsingBlock";
 		case cPluginManager::HOOK_PLAYER_USING_ITEM:            return "OnPlayerUsingItem";
+		case cPluginManager::HOOK_PLAYERS_MOVED:                return "OnPlayersMoved";
 		case cPluginManager::HOOK_PLUGIN_MESSAGE:               return "OnPluginMessage";
 		case cPluginManager::HOOK_PLUGINS_LOADED:               return "OnPluginsLoaded";
 		case cPluginManager::HOOK_POST_CRAFTING:                return "OnPostCrafting";
@@ -2006,6 +2168,21 @@ void cPluginLua::AddResettable(cPluginLua::cResettablePtr a_Resettable)
 
 
 
+SharedPtr<cLuaWorkers> cPluginLua::GetWorkers(void)
+{
+	cCSLock Lock(m_CriticalSection);
+	if (m_Workers == nullptr)
+	{
+		m_Workers = std::make_shared<cLuaWorkers>(*this);
+		m_Resettables.push_back(m_Workers);
+	}
+	return m_Workers;
+}
+
+
+
+
+
 AString cPluginLua::HandleWebRequest(const HTTPRequest & a_Request)
 {
 	// Find the tab to use for the request:
@@ -2035,7 +2212,38 @@ AString cPluginLua::HandleWebRequest(const HTTPRequest & a_Request)
 
 
 
-bool cPluginLua::AddWebTab(const AString & a_Title, lua_State * a_LuaState, int a_FunctionReference)
+bool cPluginLua::HandleWebUpload(
+	const HTTPRequest & a_Request, const AString & a_FieldName, const AString & a_FileName,
+	const char * a_Data, size_t a_Size, bool a_IsLast
+)
+{
+	// Find the tab to which the file is uploaded:
+	AString SafeTabTitle = GetTabNameForRequest(a_Request).second;
+	if (SafeTabTitle.empty())
+	{
+		return false;
+	}
+	auto Tab = GetTabBySafeTitle(SafeTabTitle);
+	if ((Tab == nullptr) || (Tab->m_UploadUserData == 0))
+	{
+		return false;
+	}
+
+	// Pass the piece of the file to the plugin; it has to return true to receive more:
+	cCSLock Lock(m_CriticalSection);
+	bool ShouldContinue = false;
+	if (!m_LuaState.Call(Tab->m_UploadUserData, &a_Request, a_FieldName, a_FileName, AString(a_Data, a_Size), a_IsLast, cLuaState::Return, ShouldContinue))
+	{
+		return false;
+	}
+	return ShouldContinue;
+}
+
+
+
+
+
+bool cPluginLua::AddWebTab(const AString & a_Title, lua_State * a_LuaState, int a_FunctionReference, int a_UploadFunctionReference)
 {
 	cCSLock Lock(m_CriticalSection);
 	if (a_LuaState != m_LuaState)
@@ -2043,7 +2251,8 @@ bool cPluginLua::AddWebTab(const AString & a_Title, lua_State * a_LuaState, int
 		LOGERROR("Only allowed to add a tab to a WebPlugin of your own Plugin!");
 		return false;
 	}
-	AddNewWebTab(a_Title, a_FunctionReference);
+	// Lua references are always positive, LUA_REFNIL maps to the tab's "no uploads" value:
+	AddNewWebTab(a_Title, a_FunctionReference, (a_UploadFunctionReference == LUA_REFNIL) ? 0 : a_UploadFunctionReference);
 	return true;
 }
 
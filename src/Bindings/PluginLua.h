@@ -23,6 +23,9 @@
 // fwd: "UI/Window.h"
 class cWindow;
 
+// fwd: "LuaWorkers.h"
+class cLuaWorkers;
+
 
 
 
@@ -102,6 +105,8 @@ public:
 	virtual void Unload(void) override;
 
 	virtual void Tick(float a_Dt) override;
+	virtual void GetStats(cCallStatsMap & a_Calls, size_t & a_MemoryUsed) override;
+	virtual void ResetStats(void) override;
 
 	virtual bool OnBlockSpread              (cWorld & a_World, int a_BlockX, int a_BlockY, int a_BlockZ, eSpreadSource a_Source) override;
 	virtual bool OnBlockToPickups           (cWorld & a_World, cEntity * a_Digger, int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, cItems & a_Pickups) override;
@@ -134,6 +139,7 @@ public:
 	virtual bool OnPlayerJoined             (cPlayer & a_Player) override;
 	virtual bool OnPlayerLeftClick          (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, char a_Status) override;
 	virtual bool OnPlayerMoving             (cPlayer & a_Player, const Vector3d & a_OldPosition, const Vector3d & a_NewPosition) override;
+	virtual bool OnPlayersMoved             (cWorld & a_World, const cPluginManager::cPlayerMoves & a_Moves) override;
 	virtual bool OnPlayerPlacedBlock        (cPlayer & a_Player, const sSetBlock & a_BlockChange) override;
 	virtual bool OnPlayerPlacingBlock       (cPlayer & a_Player, const sSetBlock & a_BlockChange) override;
 	virtual bool OnPlayerRightClick         (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, int a_CursorX, int a_CursorY, int a_CursorZ) override;
@@ -179,10 +185,16 @@ public:
 	// cWebPlugin overrides
 	virtual const AString GetWebTitle(void) const {return GetName(); }
 	virtual AString HandleWebRequest(const HTTPRequest & a_Request) override;
+	virtual bool HandleWebUpload(
+		const HTTPRequest & a_Request, const AString & a_FieldName, const AString & a_FileName,
+		const char * a_Data, size_t a_Size, bool a_IsLast
+	) override;
 
 	/** Adds a new web tab to webadmin.
 	Displaying the tab calls the referenced function. */
-	bool AddWebTab(const AString & a_Title, lua_State * a_LuaState, int a_FunctionReference);  // Exported in ManualBindings.cpp
+	/** Adds a webadmin tab handled by the specified Lua function.
+	a_UploadFunctionReference is the Lua function receiving the file uploads to the tab, LUA_REFNIL if the tab doesn't accept uploads. */
+	bool AddWebTab(const AString & a_Title, lua_State * a_LuaState, int a_FunctionReference, int a_UploadFunctionReference = LUA_REFNIL);  // Exported in ManualBindings.cpp
 	
 	/** Binds the command to call the function specified by a Lua function reference. Simply adds to CommandMap. */
 	void BindCommand(const AString & a_Command, int a_FnRef);
@@ -233,6 +245,9 @@ public:
 	/** Adds the specified cResettable instance to m_Resettables, so that it is notified when the plugin is being closed. */
 	void AddResettable(cResettablePtr a_Resettable);
 
+	/** Returns the plugin's worker Lua states, creating them on first use. */
+	SharedPtr<cLuaWorkers> GetWorkers(void);
+
 protected:
 	/** Maps command name into Lua function reference */
 	typedef std::map<AString, int> CommandMap;
@@ -242,6 +257,28 @@ protected:
 	
 	/** Maps hook types into arrays of Lua function references to call for each hook type */
 	typedef std::map<int, cLuaRefs> cHookMap;
+
+	/** Adds the time spent in its scope to the specified call stats.
+	Must be declared after the lock of m_CriticalSection, so that the stats are updated while still locked. */
+	class cCallTimer
+	{
+	public:
+		cCallTimer(sCallStats & a_Stats) :
+			m_Stats(a_Stats),
+			m_StartTime(std::chrono::steady_clock::now())
+		{
+		}
+
+		~cCallTimer()
+		{
+			auto Duration = std::chrono::steady_clock::now() - m_StartTime;
+			m_Stats.Add(static_cast<UInt64>(std::chrono::duration_cast<std::chrono::microseconds>(Duration).count()));
+		}
+
+	protected:
+		sCallStats & m_Stats;
+		std::chrono::steady_clock::time_point m_StartTime;
+	} ;
 	
 
 	/** The mutex protecting m_LuaState and each of the m_Resettables[] against multithreaded use. */
@@ -261,10 +298,25 @@ protected:
 	
 	/** Hooks that the plugin has registered. */
 	cHookMap m_HookMap;
+
+	/** The stats of the hook calls, indexed by the hook type. Protected by m_CriticalSection. */
+	sCallStats m_HookStats[cPluginManager::HOOK_NUM_HOOKS];
+
+	/** The stats of the command and console command calls, by the command name. Protected by m_CriticalSection. */
+	cCallStatsMap m_CommandStats;
+
+	/** Number of callbacks aborted by the watchdog since the plugin was loaded. Protected by m_CriticalSection. */
+	int m_NumWatchdogAborts;
+
+	/** The worker Lua states running the plugin's jobs, nullptr until the first job is queued. Also stored in m_Resettables. */
+	SharedPtr<cLuaWorkers> m_Workers;
 	
 
 	/** Releases all Lua references, notifies and removes all m_Resettables[] and closes the m_LuaState. */
 	void Close(void);
+
+	/** Called by the LuaState's watchdog when it aborts a callback. Queues the plugin for unloading once it has been aborted too often. */
+	void OnWatchdogAbort(void);
 } ;  // tolua_export
 
 
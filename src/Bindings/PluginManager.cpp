@@ -12,9 +12,9 @@
 #include "../IniFile.h"
 #include "../Entities/Player.h"
 
-#define FIND_HOOK(a_HookName) HookMap::iterator Plugins = m_Hooks.find(a_HookName);
+#define FIND_HOOK(a_HookName) const PluginList & Plugins = m_Hooks[a_HookName];
 #define VERIFY_HOOK \
-	if (Plugins == m_Hooks.end()) \
+	if (Plugins.empty()) \
 	{ \
 		return false; \
 	}
@@ -33,8 +33,12 @@ cPluginManager * cPluginManager::Get(void)
 
 
 cPluginManager::cPluginManager(void) :
-	m_bReloadPlugins(false)
+	m_bReloadPlugins(false),
+	m_WatchdogWarnMSec(0),
+	m_WatchdogAbortMSec(0),
+	m_WatchdogMaxAborts(0)
 {
+	m_CSPluginsToUnload.SetName("cPluginManager::m_CSPluginsToUnload");
 }
 
 
@@ -129,6 +133,11 @@ void cPluginManager::ReloadPluginsNow(cIniFile & a_SettingsIni)
 	// Refresh the list of plugins to load new ones from disk / remove the deleted ones:
 	RefreshPluginList();
 
+	// Read the limits on the plugin callbacks' duration, the plugins pick them up when loading:
+	m_WatchdogWarnMSec  = a_SettingsIni.GetValueSetI("PluginWatchdog", "WarnMSec",  100);
+	m_WatchdogAbortMSec = a_SettingsIni.GetValueSetI("PluginWatchdog", "AbortMSec", 0);
+	m_WatchdogMaxAborts = a_SettingsIni.GetValueSetI("PluginWatchdog", "MaxAborts", 0);
+
 	// Load the plugins:
 	AStringVector ToLoad = GetFoldersToLoad(a_SettingsIni);
 	for (auto & pluginFolder: ToLoad)
@@ -214,11 +223,11 @@ void cPluginManager::Tick(float a_Dt)
 	}
 
 	FIND_HOOK(HOOK_TICK);
-	if (Plugins != m_Hooks.end())
+	if (!Plugins.empty())
 	{
-		for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+		for (size_t i = 0; i < Plugins.size(); i++)
 		{
-			(*itr)->Tick(a_Dt);
+			Plugins[i]->Tick(a_Dt);
 		}
 	}
 }
@@ -232,9 +241,9 @@ bool cPluginManager::CallHookBlockSpread(cWorld & a_World, int a_BlockX, int a_B
 	FIND_HOOK(HOOK_BLOCK_SPREAD);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnBlockSpread(a_World, a_BlockX, a_BlockY, a_BlockZ, a_Source))
+		if (Plugins[i]->OnBlockSpread(a_World, a_BlockX, a_BlockY, a_BlockZ, a_Source))
 		{
 			return true;
 		}
@@ -255,9 +264,9 @@ bool cPluginManager::CallHookBlockToPickups(
 	FIND_HOOK(HOOK_BLOCK_TO_PICKUPS);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnBlockToPickups(a_World, a_Digger, a_BlockX, a_BlockY, a_BlockZ, a_BlockType, a_BlockMeta, a_Pickups))
+		if (Plugins[i]->OnBlockToPickups(a_World, a_Digger, a_BlockX, a_BlockY, a_BlockZ, a_BlockType, a_BlockMeta, a_Pickups))
 		{
 			return true;
 		}
@@ -321,9 +330,9 @@ bool cPluginManager::CallHookChat(cPlayer & a_Player, AString & a_Message)
 	FIND_HOOK(HOOK_CHAT);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnChat(a_Player, a_Message))
+		if (Plugins[i]->OnChat(a_Player, a_Message))
 		{
 			return true;
 		}
@@ -341,9 +350,9 @@ bool cPluginManager::CallHookChunkAvailable(cWorld & a_World, int a_ChunkX, int
 	FIND_HOOK(HOOK_CHUNK_AVAILABLE);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnChunkAvailable(a_World, a_ChunkX, a_ChunkZ))
+		if (Plugins[i]->OnChunkAvailable(a_World, a_ChunkX, a_ChunkZ))
 		{
 			return true;
 		}
@@ -360,9 +369,9 @@ bool cPluginManager::CallHookChunkGenerated(cWorld & a_World, int a_ChunkX, int
 	FIND_HOOK(HOOK_CHUNK_GENERATED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnChunkGenerated(a_World, a_ChunkX, a_ChunkZ, a_ChunkDesc))
+		if (Plugins[i]->OnChunkGenerated(a_World, a_ChunkX, a_ChunkZ, a_ChunkDesc))
 		{
 			return true;
 		}
@@ -379,9 +388,9 @@ bool cPluginManager::CallHookChunkGenerating(cWorld & a_World, int a_ChunkX, int
 	FIND_HOOK(HOOK_CHUNK_GENERATING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnChunkGenerating(a_World, a_ChunkX, a_ChunkZ, a_ChunkDesc))
+		if (Plugins[i]->OnChunkGenerating(a_World, a_ChunkX, a_ChunkZ, a_ChunkDesc))
 		{
 			return true;
 		}
@@ -398,9 +407,9 @@ bool cPluginManager::CallHookChunkUnloaded(cWorld & a_World, int a_ChunkX, int a
 	FIND_HOOK(HOOK_CHUNK_UNLOADED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnChunkUnloaded(a_World, a_ChunkX, a_ChunkZ))
+		if (Plugins[i]->OnChunkUnloaded(a_World, a_ChunkX, a_ChunkZ))
 		{
 			return true;
 		}
@@ -417,9 +426,9 @@ bool cPluginManager::CallHookChunkUnloading(cWorld & a_World, int a_ChunkX, int
 	FIND_HOOK(HOOK_CHUNK_UNLOADING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnChunkUnloading(a_World, a_ChunkX, a_ChunkZ))
+		if (Plugins[i]->OnChunkUnloading(a_World, a_ChunkX, a_ChunkZ))
 		{
 			return true;
 		}
@@ -436,9 +445,9 @@ bool cPluginManager::CallHookCollectingPickup(cPlayer & a_Player, cPickup & a_Pi
 	FIND_HOOK(HOOK_COLLECTING_PICKUP);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnCollectingPickup(a_Player, a_Pickup))
+		if (Plugins[i]->OnCollectingPickup(a_Player, a_Pickup))
 		{
 			return true;
 		}
@@ -455,9 +464,9 @@ bool cPluginManager::CallHookCraftingNoRecipe(cPlayer & a_Player, cCraftingGrid
 	FIND_HOOK(HOOK_CRAFTING_NO_RECIPE);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnCraftingNoRecipe(a_Player, a_Grid, a_Recipe))
+		if (Plugins[i]->OnCraftingNoRecipe(a_Player, a_Grid, a_Recipe))
 		{
 			return true;
 		}
@@ -474,9 +483,9 @@ bool cPluginManager::CallHookDisconnect(cClientHandle & a_Client, const AString
 	FIND_HOOK(HOOK_DISCONNECT);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnDisconnect(a_Client, a_Reason))
+		if (Plugins[i]->OnDisconnect(a_Client, a_Reason))
 		{
 			return true;
 		}
@@ -493,9 +502,9 @@ bool cPluginManager::CallHookEntityAddEffect(cEntity & a_Entity, int a_EffectTyp
 	FIND_HOOK(HOOK_ENTITY_ADD_EFFECT);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnEntityAddEffect(a_Entity, a_EffectType, a_EffectDurationTicks, a_EffectIntensity, a_DistanceModifier))
+		if (Plugins[i]->OnEntityAddEffect(a_Entity, a_EffectType, a_EffectDurationTicks, a_EffectIntensity, a_DistanceModifier))
 		{
 			return true;
 		}
@@ -512,9 +521,9 @@ bool cPluginManager::CallHookEntityTeleport(cEntity & a_Entity, const Vector3d &
 	FIND_HOOK(HOOK_ENTITY_TELEPORT);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnEntityTeleport(a_Entity, a_OldPosition, a_NewPosition))
+		if (Plugins[i]->OnEntityTeleport(a_Entity, a_OldPosition, a_NewPosition))
 		{
 			return true;
 		}
@@ -530,9 +539,9 @@ bool cPluginManager::CallHookExecuteCommand(cPlayer * a_Player, const AStringVec
 	FIND_HOOK(HOOK_EXECUTE_COMMAND);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnExecuteCommand(a_Player, a_Split, a_EntireCommand, a_Result))
+		if (Plugins[i]->OnExecuteCommand(a_Player, a_Split, a_EntireCommand, a_Result))
 		{
 			return true;
 		}
@@ -549,9 +558,9 @@ bool cPluginManager::CallHookExploded(cWorld & a_World, double a_ExplosionSize,
 	FIND_HOOK(HOOK_EXPLODED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnExploded(a_World, a_ExplosionSize, a_CanCauseFire, a_X, a_Y, a_Z, a_Source, a_SourceData))
+		if (Plugins[i]->OnExploded(a_World, a_ExplosionSize, a_CanCauseFire, a_X, a_Y, a_Z, a_Source, a_SourceData))
 		{
 			return true;
 		}
@@ -568,9 +577,9 @@ bool cPluginManager::CallHookExploding(cWorld & a_World, double & a_ExplosionSiz
 	FIND_HOOK(HOOK_EXPLODING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnExploding(a_World, a_ExplosionSize, a_CanCauseFire, a_X, a_Y, a_Z, a_Source, a_SourceData))
+		if (Plugins[i]->OnExploding(a_World, a_ExplosionSize, a_CanCauseFire, a_X, a_Y, a_Z, a_Source, a_SourceData))
 		{
 			return true;
 		}
@@ -587,9 +596,9 @@ bool cPluginManager::CallHookHandshake(cClientHandle & a_ClientHandle, const ASt
 	FIND_HOOK(HOOK_HANDSHAKE);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnHandshake(a_ClientHandle, a_Username))
+		if (Plugins[i]->OnHandshake(a_ClientHandle, a_Username))
 		{
 			return true;
 		}
@@ -606,9 +615,9 @@ bool cPluginManager::CallHookHopperPullingItem(cWorld & a_World, cHopperEntity &
 	FIND_HOOK(HOOK_HOPPER_PULLING_ITEM);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnHopperPullingItem(a_World, a_Hopper, a_DstSlotNum, a_SrcEntity, a_SrcSlotNum))
+		if (Plugins[i]->OnHopperPullingItem(a_World, a_Hopper, a_DstSlotNum, a_SrcEntity, a_SrcSlotNum))
 		{
 			return true;
 		}
@@ -625,9 +634,9 @@ bool cPluginManager::CallHookHopperPushingItem(cWorld & a_World, cHopperEntity &
 	FIND_HOOK(HOOK_HOPPER_PUSHING_ITEM);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnHopperPushingItem(a_World, a_Hopper, a_SrcSlotNum, a_DstEntity, a_DstSlotNum))
+		if (Plugins[i]->OnHopperPushingItem(a_World, a_Hopper, a_SrcSlotNum, a_DstEntity, a_DstSlotNum))
 		{
 			return true;
 		}
@@ -644,9 +653,9 @@ bool cPluginManager::CallHookKilling(cEntity & a_Victim, cEntity * a_Killer, Tak
 	FIND_HOOK(HOOK_KILLING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnKilling(a_Victim, a_Killer, a_TDI))
+		if (Plugins[i]->OnKilling(a_Victim, a_Killer, a_TDI))
 		{
 			return true;
 		}
@@ -663,9 +672,9 @@ bool cPluginManager::CallHookLogin(cClientHandle & a_Client, int a_ProtocolVersi
 	FIND_HOOK(HOOK_LOGIN);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnLogin(a_Client, a_ProtocolVersion, a_Username))
+		if (Plugins[i]->OnLogin(a_Client, a_ProtocolVersion, a_Username))
 		{
 			return true;
 		}
@@ -682,9 +691,9 @@ bool cPluginManager::CallHookPlayerAnimation(cPlayer & a_Player, int a_Animation
 	FIND_HOOK(HOOK_PLAYER_ANIMATION);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerAnimation(a_Player, a_Animation))
+		if (Plugins[i]->OnPlayerAnimation(a_Player, a_Animation))
 		{
 			return true;
 		}
@@ -701,9 +710,9 @@ bool cPluginManager::CallHookPlayerBreakingBlock(cPlayer & a_Player, int a_Block
 	FIND_HOOK(HOOK_PLAYER_BREAKING_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerBreakingBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_BlockType, a_BlockMeta))
+		if (Plugins[i]->OnPlayerBreakingBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_BlockType, a_BlockMeta))
 		{
 			return true;
 		}
@@ -720,9 +729,9 @@ bool cPluginManager::CallHookPlayerBrokenBlock(cPlayer & a_Player, int a_BlockX,
 	FIND_HOOK(HOOK_PLAYER_BROKEN_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerBrokenBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_BlockType, a_BlockMeta))
+		if (Plugins[i]->OnPlayerBrokenBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_BlockType, a_BlockMeta))
 		{
 			return true;
 		}
@@ -739,9 +748,9 @@ bool cPluginManager::CallHookPlayerDestroyed(cPlayer & a_Player)
 	FIND_HOOK(HOOK_PLAYER_DESTROYED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerDestroyed(a_Player))
+		if (Plugins[i]->OnPlayerDestroyed(a_Player))
 		{
 			return true;
 		}
@@ -758,9 +767,9 @@ bool cPluginManager::CallHookPlayerEating(cPlayer & a_Player)
 	FIND_HOOK(HOOK_PLAYER_EATING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerEating(a_Player))
+		if (Plugins[i]->OnPlayerEating(a_Player))
 		{
 			return true;
 		}
@@ -777,9 +786,9 @@ bool cPluginManager::CallHookPlayerFoodLevelChange(cPlayer & a_Player, int a_New
 	FIND_HOOK(HOOK_PLAYER_FOOD_LEVEL_CHANGE);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerFoodLevelChange(a_Player, a_NewFoodLevel))
+		if (Plugins[i]->OnPlayerFoodLevelChange(a_Player, a_NewFoodLevel))
 		{
 			return true;
 		}
@@ -796,9 +805,9 @@ bool cPluginManager::CallHookPlayerFished(cPlayer & a_Player, const cItems & a_R
 	FIND_HOOK(HOOK_PLAYER_FISHED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerFished(a_Player, a_Reward))
+		if (Plugins[i]->OnPlayerFished(a_Player, a_Reward))
 		{
 			return true;
 		}
@@ -810,14 +819,14 @@ bool cPluginManager::CallHookPlayerFished(cPlayer & a_Player, const cItems & a_R
 
 
 
-bool cPluginManager::CallHookPlayerFishing(cPlayer & a_Player, cItems a_Reward)
+bool cPluginManager::CallHookPlayerFishing(cPlayer & a_Player, cItems & a_Reward)
 {
 	FIND_HOOK(HOOK_PLAYER_FISHING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerFishing(a_Player, a_Reward))
+		if (Plugins[i]->OnPlayerFishing(a_Player, a_Reward))
 		{
 			return true;
 		}
@@ -834,9 +843,9 @@ bool cPluginManager::CallHookPlayerJoined(cPlayer & a_Player)
 	FIND_HOOK(HOOK_PLAYER_JOINED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerJoined(a_Player))
+		if (Plugins[i]->OnPlayerJoined(a_Player))
 		{
 			return true;
 		}
@@ -853,9 +862,9 @@ bool cPluginManager::CallHookPlayerLeftClick(cPlayer & a_Player, int a_BlockX, i
 	FIND_HOOK(HOOK_PLAYER_LEFT_CLICK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerLeftClick(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_Status))
+		if (Plugins[i]->OnPlayerLeftClick(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_Status))
 		{
 			return true;
 		}
@@ -872,9 +881,28 @@ bool cPluginManager::CallHookPlayerMoving(cPlayer & a_Player, const Vector3d & a
 	FIND_HOOK(HOOK_PLAYER_MOVING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
+	{
+		if (Plugins[i]->OnPlayerMoving(a_Player, a_OldPosition, a_NewPosition))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+
+bool cPluginManager::CallHookPlayersMoved(cWorld & a_World, const cPlayerMoves & a_Moves)
+{
+	FIND_HOOK(HOOK_PLAYERS_MOVED);
+	VERIFY_HOOK;
+
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerMoving(a_Player, a_OldPosition, a_NewPosition))
+		if (Plugins[i]->OnPlayersMoved(a_World, a_Moves))
 		{
 			return true;
 		}
@@ -891,9 +919,9 @@ bool cPluginManager::CallHookPlayerPlacedBlock(cPlayer & a_Player, const sSetBlo
 	FIND_HOOK(HOOK_PLAYER_PLACED_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerPlacedBlock(a_Player, a_BlockChange))
+		if (Plugins[i]->OnPlayerPlacedBlock(a_Player, a_BlockChange))
 		{
 			return true;
 		}
@@ -910,9 +938,9 @@ bool cPluginManager::CallHookPlayerPlacingBlock(cPlayer & a_Player, const sSetBl
 	FIND_HOOK(HOOK_PLAYER_PLACING_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerPlacingBlock(a_Player, a_BlockChange))
+		if (Plugins[i]->OnPlayerPlacingBlock(a_Player, a_BlockChange))
 		{
 			return true;
 		}
@@ -929,9 +957,9 @@ bool cPluginManager::CallHookPlayerRightClick(cPlayer & a_Player, int a_BlockX,
 	FIND_HOOK(HOOK_PLAYER_RIGHT_CLICK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerRightClick(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ))
+		if (Plugins[i]->OnPlayerRightClick(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ))
 		{
 			return true;
 		}
@@ -948,9 +976,9 @@ bool cPluginManager::CallHookPlayerRightClickingEntity(cPlayer & a_Player, cEnti
 	FIND_HOOK(HOOK_PLAYER_RIGHT_CLICKING_ENTITY);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerRightClickingEntity(a_Player, a_Entity))
+		if (Plugins[i]->OnPlayerRightClickingEntity(a_Player, a_Entity))
 		{
 			return true;
 		}
@@ -967,9 +995,9 @@ bool cPluginManager::CallHookPlayerShooting(cPlayer & a_Player)
 	FIND_HOOK(HOOK_PLAYER_SHOOTING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerShooting(a_Player))
+		if (Plugins[i]->OnPlayerShooting(a_Player))
 		{
 			return true;
 		}
@@ -986,9 +1014,9 @@ bool cPluginManager::CallHookPlayerSpawned(cPlayer & a_Player)
 	FIND_HOOK(HOOK_PLAYER_SPAWNED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerSpawned(a_Player))
+		if (Plugins[i]->OnPlayerSpawned(a_Player))
 		{
 			return true;
 		}
@@ -1005,9 +1033,9 @@ bool cPluginManager::CallHookPlayerTossingItem(cPlayer & a_Player)
 	FIND_HOOK(HOOK_PLAYER_TOSSING_ITEM);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerTossingItem(a_Player))
+		if (Plugins[i]->OnPlayerTossingItem(a_Player))
 		{
 			return true;
 		}
@@ -1024,9 +1052,9 @@ bool cPluginManager::CallHookPlayerUsedBlock(cPlayer & a_Player, int a_BlockX, i
 	FIND_HOOK(HOOK_PLAYER_USED_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerUsedBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, a_BlockType, a_BlockMeta))
+		if (Plugins[i]->OnPlayerUsedBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, a_BlockType, a_BlockMeta))
 		{
 			return true;
 		}
@@ -1043,9 +1071,9 @@ bool cPluginManager::CallHookPlayerUsedItem(cPlayer & a_Player, int a_BlockX, in
 	FIND_HOOK(HOOK_PLAYER_USED_ITEM);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerUsedItem(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ))
+		if (Plugins[i]->OnPlayerUsedItem(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ))
 		{
 			return true;
 		}
@@ -1062,9 +1090,9 @@ bool cPluginManager::CallHookPlayerUsingBlock(cPlayer & a_Player, int a_BlockX,
 	FIND_HOOK(HOOK_PLAYER_USING_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerUsingBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, a_BlockType, a_BlockMeta))
+		if (Plugins[i]->OnPlayerUsingBlock(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, a_BlockType, a_BlockMeta))
 		{
 			return true;
 		}
@@ -1081,9 +1109,9 @@ bool cPluginManager::CallHookPlayerUsingItem(cPlayer & a_Player, int a_BlockX, i
 	FIND_HOOK(HOOK_PLAYER_USING_ITEM);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPlayerUsingItem(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ))
+		if (Plugins[i]->OnPlayerUsingItem(a_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ))
 		{
 			return true;
 		}
@@ -1100,9 +1128,9 @@ bool cPluginManager::CallHookPluginMessage(cClientHandle & a_Client, const AStri
 	FIND_HOOK(HOOK_PLUGIN_MESSAGE);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPluginMessage(a_Client, a_Channel, a_Message))
+		if (Plugins[i]->OnPluginMessage(a_Client, a_Channel, a_Message))
 		{
 			return true;
 		}
@@ -1120,9 +1148,9 @@ bool cPluginManager::CallHookPluginsLoaded(void)
 	VERIFY_HOOK;
 
 	bool res = false;
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		res = !(*itr)->OnPluginsLoaded() || res;
+		res = !Plugins[i]->OnPluginsLoaded() || res;
 	}
 	return res;
 }
@@ -1136,9 +1164,9 @@ bool cPluginManager::CallHookPostCrafting(cPlayer & a_Player, cCraftingGrid & a_
 	FIND_HOOK(HOOK_POST_CRAFTING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPostCrafting(a_Player, a_Grid, a_Recipe))
+		if (Plugins[i]->OnPostCrafting(a_Player, a_Grid, a_Recipe))
 		{
 			return true;
 		}
@@ -1155,9 +1183,9 @@ bool cPluginManager::CallHookPreCrafting(cPlayer & a_Player, cCraftingGrid & a_G
 	FIND_HOOK(HOOK_PRE_CRAFTING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnPreCrafting(a_Player, a_Grid, a_Recipe))
+		if (Plugins[i]->OnPreCrafting(a_Player, a_Grid, a_Recipe))
 		{
 			return true;
 		}
@@ -1174,9 +1202,9 @@ bool cPluginManager::CallHookProjectileHitBlock(cProjectileEntity & a_Projectile
 	FIND_HOOK(HOOK_PROJECTILE_HIT_BLOCK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnProjectileHitBlock(a_Projectile, a_BlockX, a_BlockY, a_BlockZ, a_Face, a_BlockHitPos))
+		if (Plugins[i]->OnProjectileHitBlock(a_Projectile, a_BlockX, a_BlockY, a_BlockZ, a_Face, a_BlockHitPos))
 		{
 			return true;
 		}
@@ -1193,9 +1221,9 @@ bool cPluginManager::CallHookProjectileHitEntity(cProjectileEntity & a_Projectil
 	FIND_HOOK(HOOK_PROJECTILE_HIT_ENTITY);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnProjectileHitEntity(a_Projectile, a_HitEntity))
+		if (Plugins[i]->OnProjectileHitEntity(a_Projectile, a_HitEntity))
 		{
 			return true;
 		}
@@ -1212,9 +1240,9 @@ bool cPluginManager::CallHookServerPing(cClientHandle & a_ClientHandle, AString
 	FIND_HOOK(HOOK_SERVER_PING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnServerPing(a_ClientHandle, a_ServerDescription, a_OnlinePlayersCount, a_MaxPlayersCount, a_Favicon))
+		if (Plugins[i]->OnServerPing(a_ClientHandle, a_ServerDescription, a_OnlinePlayersCount, a_MaxPlayersCount, a_Favicon))
 		{
 			return true;
 		}
@@ -1231,9 +1259,9 @@ bool cPluginManager::CallHookSpawnedEntity(cWorld & a_World, cEntity & a_Entity)
 	FIND_HOOK(HOOK_SPAWNED_ENTITY);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnSpawnedEntity(a_World, a_Entity))
+		if (Plugins[i]->OnSpawnedEntity(a_World, a_Entity))
 		{
 			return true;
 		}
@@ -1249,9 +1277,9 @@ bool cPluginManager::CallHookSpawnedMonster(cWorld & a_World, cMonster & a_Monst
 	FIND_HOOK(HOOK_SPAWNED_MONSTER);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnSpawnedMonster(a_World, a_Monster))
+		if (Plugins[i]->OnSpawnedMonster(a_World, a_Monster))
 		{
 			return true;
 		}
@@ -1267,9 +1295,9 @@ bool cPluginManager::CallHookSpawningEntity(cWorld & a_World, cEntity & a_Entity
 	FIND_HOOK(HOOK_SPAWNING_ENTITY);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnSpawningEntity(a_World, a_Entity))
+		if (Plugins[i]->OnSpawningEntity(a_World, a_Entity))
 		{
 			return true;
 		}
@@ -1286,9 +1314,9 @@ bool cPluginManager::CallHookSpawningMonster(cWorld & a_World, cMonster & a_Mons
 	FIND_HOOK(HOOK_SPAWNING_MONSTER);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnSpawningMonster(a_World, a_Monster))
+		if (Plugins[i]->OnSpawningMonster(a_World, a_Monster))
 		{
 			return true;
 		}
@@ -1305,9 +1333,9 @@ bool cPluginManager::CallHookTakeDamage(cEntity & a_Receiver, TakeDamageInfo & a
 	FIND_HOOK(HOOK_TAKE_DAMAGE);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnTakeDamage(a_Receiver, a_TDI))
+		if (Plugins[i]->OnTakeDamage(a_Receiver, a_TDI))
 		{
 			return true;
 		}
@@ -1324,9 +1352,9 @@ bool cPluginManager::CallHookUpdatingSign(cWorld & a_World, int a_BlockX, int a_
 	FIND_HOOK(HOOK_UPDATING_SIGN);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnUpdatingSign(a_World, a_BlockX, a_BlockY, a_BlockZ, a_Line1, a_Line2, a_Line3, a_Line4, a_Player))
+		if (Plugins[i]->OnUpdatingSign(a_World, a_BlockX, a_BlockY, a_BlockZ, a_Line1, a_Line2, a_Line3, a_Line4, a_Player))
 		{
 			return true;
 		}
@@ -1343,9 +1371,9 @@ bool cPluginManager::CallHookUpdatedSign(cWorld & a_World, int a_BlockX, int a_B
 	FIND_HOOK(HOOK_UPDATED_SIGN);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnUpdatedSign(a_World, a_BlockX, a_BlockY, a_BlockZ, a_Line1, a_Line2, a_Line3, a_Line4, a_Player))
+		if (Plugins[i]->OnUpdatedSign(a_World, a_BlockX, a_BlockY, a_BlockZ, a_Line1, a_Line2, a_Line3, a_Line4, a_Player))
 		{
 			return true;
 		}
@@ -1362,9 +1390,9 @@ bool cPluginManager::CallHookWeatherChanged(cWorld & a_World)
 	FIND_HOOK(HOOK_WEATHER_CHANGED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnWeatherChanged(a_World))
+		if (Plugins[i]->OnWeatherChanged(a_World))
 		{
 			return true;
 		}
@@ -1381,9 +1409,9 @@ bool cPluginManager::CallHookWeatherChanging(cWorld & a_World, eWeather & a_NewW
 	FIND_HOOK(HOOK_WEATHER_CHANGING);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnWeatherChanging(a_World, a_NewWeather))
+		if (Plugins[i]->OnWeatherChanging(a_World, a_NewWeather))
 		{
 			return true;
 		}
@@ -1400,9 +1428,9 @@ bool cPluginManager::CallHookWorldStarted(cWorld & a_World)
 	FIND_HOOK(HOOK_WORLD_STARTED);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnWorldStarted(a_World))
+		if (Plugins[i]->OnWorldStarted(a_World))
 		{
 			return true;
 		}
@@ -1419,9 +1447,9 @@ bool cPluginManager::CallHookWorldTick(cWorld & a_World, std::chrono::millisecon
 	FIND_HOOK(HOOK_WORLD_TICK);
 	VERIFY_HOOK;
 
-	for (PluginList::iterator itr = Plugins->second.begin(); itr != Plugins->second.end(); ++itr)
+	for (size_t i = 0; i < Plugins.size(); i++)
 	{
-		if ((*itr)->OnWorldTick(a_World, a_Dt, a_LastTickDurationMSec))
+		if (Plugins[i]->OnWorldTick(a_World, a_Dt, a_LastTickDurationMSec))
 		{
 			return true;
 		}
@@ -1486,7 +1514,10 @@ cPluginManager::CommandResult cPluginManager::HandleCommand(cPlayer & a_Player,
 void cPluginManager::UnloadPluginsNow()
 {
 	// Remove all bindings:
-	m_Hooks.clear();
+	for (auto & Hook: m_Hooks)
+	{
+		Hook.clear();
+	}
 	m_Commands.clear();
 	m_ConsoleCommands.clear();
 
@@ -1542,9 +1573,9 @@ bool cPluginManager::LoadPlugin(const AString & a_FolderName)
 
 void cPluginManager::RemoveHooks(cPlugin * a_Plugin)
 {
-	for (HookMap::iterator itr = m_Hooks.begin(), end = m_Hooks.end(); itr != end; ++itr)
+	for (auto & Hook: m_Hooks)
 	{
-		itr->second.remove(a_Plugin);
+		Hook.erase(std::remove(Hook.begin(), Hook.end(), a_Plugin), Hook.end());
 	}
 }
 
@@ -1845,6 +1876,61 @@ bool cPluginManager::ForEachPlugin(cPluginCallback & a_Callback)
 
 
 
+void cPluginManager::LogPluginStats(cCommandOutputCallback & a_Output)
+{
+	for (auto & plugin: m_Plugins)
+	{
+		if (!plugin->IsLoaded())
+		{
+			continue;
+		}
+		cPlugin::cCallStatsMap Calls;
+		size_t MemoryUsed;
+		plugin->GetStats(Calls, MemoryUsed);
+		a_Output.Out("Plugin %s: %u KiB of script memory", plugin->GetName().c_str(), static_cast<unsigned>(MemoryUsed / 1024));
+
+		// List the most expensive calls first:
+		std::vector<std::pair<AString, cPlugin::sCallStats>> SortedCalls(Calls.begin(), Calls.end());
+		std::stable_sort(SortedCalls.begin(), SortedCalls.end(),
+			[](const std::pair<AString, cPlugin::sCallStats> & a_First, const std::pair<AString, cPlugin::sCallStats> & a_Second)
+			{
+				return (a_First.second.m_TotalMicrosec > a_Second.second.m_TotalMicrosec);
+			}
+		);
+		for (const auto & Call: SortedCalls)
+		{
+			const cPlugin::sCallStats & Stats = Call.second;
+			AString Histogram;
+			for (int i = 0; i < cPlugin::sCallStats::NUM_BUCKETS; i++)
+			{
+				AppendPrintf(Histogram, " %s: %llu", cPlugin::sCallStats::GetBucketName(i), static_cast<unsigned long long>(Stats.m_Histogram[i]));
+			}
+			a_Output.Out("  %s: %llu calls, total %.03f ms, avg %llu us, max %llu us;%s",
+				Call.first.c_str(), static_cast<unsigned long long>(Stats.m_NumCalls),
+				static_cast<double>(Stats.m_TotalMicrosec) / 1000,
+				static_cast<unsigned long long>(Stats.m_TotalMicrosec / std::max<UInt64>(Stats.m_NumCalls, 1)),
+				static_cast<unsigned long long>(Stats.m_MaxMicrosec), Histogram.c_str()
+			);
+		}
+	}
+}
+
+
+
+
+
+void cPluginManager::ResetPluginStats(void)
+{
+	for (auto & plugin: m_Plugins)
+	{
+		plugin->ResetStats();
+	}
+}
+
+
+
+
+
 void cPluginManager::AddHook(cPlugin * a_Plugin, int a_Hook)
 {
 	if (a_Plugin == nullptr)
@@ -1852,6 +1938,11 @@ void cPluginManager::AddHook(cPlugin * a_Plugin, int a_Hook)
 		LOGWARN("Called cPluginManager::AddHook() with a_Plugin == nullptr");
 		return;
 	}
+	if ((a_Hook < 0) || (a_Hook >= HOOK_NUM_HOOKS))
+	{
+		LOGWARN("Called cPluginManager::AddHook() with an invalid hook type %d", a_Hook);
+		return;
+	}
 	PluginList & Plugins = m_Hooks[a_Hook];
 	if (std::find(Plugins.cbegin(), Plugins.cend(), a_Plugin) == Plugins.cend())
 	{
@@ -3,6 +3,7 @@
 
 
 #include "Defines.h"
+#include "../Vector3.h"
 
 
 
@@ -115,6 +116,7 @@ public:
 		HOOK_PLAYER_USED_ITEM,
 		HOOK_PLAYER_USING_BLOCK,
 		HOOK_PLAYER_USING_ITEM,
+		HOOK_PLAYERS_MOVED,
 		HOOK_PLUGIN_MESSAGE,
 		HOOK_PLUGINS_LOADED,
 		HOOK_POST_CRAFTING,
@@ -157,10 +159,29 @@ public:
 		virtual bool Command(const AString & a_Command, const cPlugin * a_Plugin, const AString & a_Permission, const AString & a_HelpString) = 0;
 	} ;
 	
+	/** A single player movement, delivered in a batch with all the other movements in the world's tick by HOOK_PLAYERS_MOVED. */
+	struct sPlayerMove
+	{
+		cPlayer * m_Player;
+		Vector3d m_OldPosition;
+		Vector3d m_NewPosition;
+
+		sPlayerMove(cPlayer * a_Player, const Vector3d & a_OldPosition, const Vector3d & a_NewPosition) :
+			m_Player(a_Player),
+			m_OldPosition(a_OldPosition),
+			m_NewPosition(a_NewPosition)
+		{
+		}
+	} ;
+
+	typedef std::vector<sPlayerMove> cPlayerMoves;
+
 	/** The interface used for enumerating and extern-calling plugins */
 	typedef cItemCallback<cPlugin> cPluginCallback;
 	
-	typedef std::list<cPlugin *> PluginList;
+	/** The plugins registered for a single hook, in the order of registration.
+	A vector, so that calling a hook is a quick pass over contiguous memory. */
+	typedef std::vector<cPlugin *> PluginList;
 
 
 	/** Called each tick, calls the plugins' OnTick hook, as well as processes plugin events (addition, removal) */
@@ -214,7 +235,7 @@ public:
 	bool CallHookPlayerDestroyed          (cPlayer & a_Player);
 	bool CallHookPlayerEating             (cPlayer & a_Player);
 	bool CallHookPlayerFished             (cPlayer & a_Player, const cItems & a_Reward);
-	bool CallHookPlayerFishing            (cPlayer & a_Player, cItems a_Reward);
+	bool CallHookPlayerFishing            (cPlayer & a_Player, cItems & a_Reward);
 	bool CallHookPlayerFoodLevelChange    (cPlayer & a_Player, int a_NewFoodLevel);
 	bool CallHookPlayerJoined             (cPlayer & a_Player);
 	bool CallHookPlayerLeftClick          (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, char a_Status);
@@ -230,6 +251,7 @@ public:
 	bool CallHookPlayerUsedItem           (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, int a_CursorX, int a_CursorY, int a_CursorZ);
 	bool CallHookPlayerUsingBlock         (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, int a_CursorX, int a_CursorY, int a_CursorZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
 	bool CallHookPlayerUsingItem          (cPlayer & a_Player, int a_BlockX, int a_BlockY, int a_BlockZ, char a_BlockFace, int a_CursorX, int a_CursorY, int a_CursorZ);
+	bool CallHookPlayersMoved             (cWorld & a_World, const cPlayerMoves & a_Moves);
 	bool CallHookPluginMessage            (cClientHandle & a_Client, const AString & a_Channel, const AString & a_Message);
 	bool CallHookPluginsLoaded            (void);
 	bool CallHookPostCrafting             (cPlayer & a_Player, cCraftingGrid & a_Grid, cCraftingRecipe & a_Recipe);
@@ -249,6 +271,10 @@ public:
 	bool CallHookWorldStarted             (cWorld & a_World);
 	bool CallHookWorldTick                (cWorld & a_World, std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDurationMSec);
 	
+	/** Returns true if any plugin has registered the specified hook.
+	Used for skipping the preparation of the hook's parameters when there's no one to call. */
+	bool HasHook(PluginHook a_Hook) const { return !m_Hooks[a_Hook].empty(); }
+
 	/** Queues the specified plugin to be unloaded in the next call to Tick().
 	Note that this function returns before the plugin is unloaded, to avoid deadlocks. */
 	void UnloadPlugin(const AString & a_PluginFolder);  // tolua_export
@@ -319,7 +345,22 @@ public:
 	/** Calls the specified callback for each plugin in m_Plugins.
 	Returns true if all plugins have been reported, false if the callback has aborted the enumeration by returning true. */
 	bool ForEachPlugin(cPluginCallback & a_Callback);
+
+	/** Outputs the time spent in each hook and command of each loaded plugin, and the plugins' scripting memory use. */
+	void LogPluginStats(cCommandOutputCallback & a_Output);
+
+	/** Clears the call stats of all the plugins. */
+	void ResetPluginStats(void);
 	
+	/** Returns the duration of a plugin callback, in milliseconds, after which a warning with the Lua stack trace is logged (0 = never). */
+	int GetWatchdogWarnMSec(void) const { return m_WatchdogWarnMSec; }
+
+	/** Returns the duration of a plugin callback, in milliseconds, after which the callback is aborted (0 = never). */
+	int GetWatchdogAbortMSec(void) const { return m_WatchdogAbortMSec; }
+
+	/** Returns the number of aborted callbacks after which the plugin is unloaded (0 = never). */
+	int GetWatchdogMaxAborts(void) const { return m_WatchdogMaxAborts; }
+
 	/** Returns the path where individual plugins' folders are expected.
 	The path doesn't end in a slash. */
 	static AString GetPluginsPath(void) { return FILE_IO_PREFIX + AString("Plugins"); }  // tolua_export
@@ -335,7 +376,6 @@ private:
 		AString   m_HelpString;
 	} ;
 	
-	typedef std::map<int, cPluginManager::PluginList> HookMap;
 	typedef std::map<AString, cCommandReg> CommandMap;
 
 
@@ -350,13 +390,19 @@ private:
 	/** All plugins that have been found in the Plugins folder. */
 	cPluginPtrs m_Plugins;
 
-	HookMap    m_Hooks;
+	/** The plugins registered for each hook, indexed by the hook type. Calling a hook that has no plugins only checks its list for emptiness. */
+	PluginList m_Hooks[HOOK_NUM_HOOKS];
 	CommandMap m_Commands;
 	CommandMap m_ConsoleCommands;
 
 	/** If set to true, all the plugins will be reloaded within the next call to Tick(). */
 	bool m_bReloadPlugins;
 
+	/** The plugin callback watchdog settings, read from settings.ini's [PluginWatchdog] section. See the getters. */
+	int m_WatchdogWarnMSec;
+	int m_WatchdogAbortMSec;
+	int m_WatchdogMaxAborts;
+
 
 	cPluginManager();
 	virtual ~cPluginManager();
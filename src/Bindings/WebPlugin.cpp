@@ -126,9 +126,9 @@ AString cWebPlugin::SafeString(const AString & a_String)
 
 
 
-void cWebPlugin::AddNewWebTab(const AString & a_Title, int a_UserData)
+void cWebPlugin::AddNewWebTab(const AString & a_Title, int a_UserData, int a_UploadUserData)
 {
-	auto Tab = std::make_shared<cTab>(a_Title, a_UserData);
+	auto Tab = std::make_shared<cTab>(a_Title, a_UserData, a_UploadUserData);
 	cCSLock Lock(m_CSTabs);
 	m_Tabs.push_back(Tab);
 }
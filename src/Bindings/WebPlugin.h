@@ -19,10 +19,14 @@ public:
 		AString m_SafeTitle;
 		int m_UserData;
 
-		cTab(const AString & a_Title, int a_UserData):
+		/** Plugin-specific data identifying the handler of the file uploads to this tab, 0 if the tab doesn't accept uploads. */
+		int m_UploadUserData;
+
+		cTab(const AString & a_Title, int a_UserData, int a_UploadUserData = 0):
 			m_Title(a_Title),
 			m_SafeTitle(cWebPlugin::SafeString(a_Title)),
-			m_UserData(a_UserData)
+			m_UserData(a_UserData),
+			m_UploadUserData(a_UploadUserData)
 		{
 		}
 	};
@@ -48,8 +52,20 @@ public:
 
 	virtual AString HandleWebRequest(const HTTPRequest & a_Request) = 0;
 
-	/** Adds a new web tab with the specified contents. */
-	void AddNewWebTab(const AString & a_Title, int a_UserData);
+	/** Called while a file is being uploaded to one of the plugin's tabs, with the consecutive pieces of the file as they arrive,
+	before the request itself is handled by HandleWebRequest(). a_IsLast is set for the final piece, which may be empty.
+	Returns true to receive the rest of the file, false to ignore it. The default implementation ignores all uploads. */
+	virtual bool HandleWebUpload(
+		const HTTPRequest & a_Request, const AString & a_FieldName, const AString & a_FileName,
+		const char * a_Data, size_t a_Size, bool a_IsLast
+	)
+	{
+		return false;
+	}
+
+	/** Adds a new web tab with the specified contents.
+	a_UploadUserData identifies the handler of the file uploads to the tab, 0 for a tab not accepting uploads. */
+	void AddNewWebTab(const AString & a_Title, int a_UserData, int a_UploadUserData = 0);
 
 	/** Removes all the tabs. */
 	void ClearTabs(void);
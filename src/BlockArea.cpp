@@ -73,6 +73,76 @@ void InternalMergeBlocks(
 
 
 
+/** Copies the blocktypes and blockmetas of the specified sizes and offsets, the same as InternalMergeBlocks() with the msOverwrite
+combinator would, but copies whole rows at once. */
+template <bool MetasValid>
+void InternalCopyBlocks(
+	BLOCKTYPE * a_DstTypes, const BLOCKTYPE * a_SrcTypes,
+	NIBBLETYPE * a_DstMetas, const NIBBLETYPE * a_SrcMetas,
+	int a_SizeX, int a_SizeY, int a_SizeZ,
+	int a_SrcOffX, int a_SrcOffY, int a_SrcOffZ,
+	int a_DstOffX, int a_DstOffY, int a_DstOffZ,
+	int a_SrcSizeX, int a_SrcSizeZ,
+	int a_DstSizeX, int a_DstSizeZ
+)
+{
+	if ((a_SizeX <= 0) || (a_SizeY <= 0) || (a_SizeZ <= 0))
+	{
+		return;
+	}
+
+	// If the rows span both areas' full width, each layer is a single contiguous run in both areas:
+	int RowSize = a_SizeX;
+	int NumRows = a_SizeZ;
+	if ((a_SizeX == a_SrcSizeX) && (a_SizeX == a_DstSizeX))
+	{
+		RowSize = a_SizeX * a_SizeZ;
+		NumRows = 1;
+	}
+	for (int y = 0; y < a_SizeY; y++)
+	{
+		int SrcBaseY = (y + a_SrcOffY) * a_SrcSizeX * a_SrcSizeZ;
+		int DstBaseY = (y + a_DstOffY) * a_DstSizeX * a_DstSizeZ;
+		for (int z = 0; z < NumRows; z++)
+		{
+			int SrcIdx = SrcBaseY + (z + a_SrcOffZ) * a_SrcSizeX + a_SrcOffX;
+			int DstIdx = DstBaseY + (z + a_DstOffZ) * a_DstSizeX + a_DstOffX;
+			memcpy(a_DstTypes + DstIdx, a_SrcTypes + SrcIdx, static_cast<size_t>(RowSize) * sizeof(BLOCKTYPE));
+			if (MetasValid)
+			{
+				memcpy(a_DstMetas + DstIdx, a_SrcMetas + SrcIdx, static_cast<size_t>(RowSize) * sizeof(NIBBLETYPE));
+			}
+		}  // for z
+	}  // for y
+}
+
+
+
+
+
+/** Fills the specified cuboid (inclusive coords) of a per-block array of an area of the specified size, a row at a time. */
+template <typename T>
+void InternalFillCuboid(T * a_Array, int a_SizeX, int a_SizeZ, int a_MinX, int a_MaxX, int a_MinY, int a_MaxY, int a_MinZ, int a_MaxZ, T a_Value)
+{
+	if (a_MaxX < a_MinX)
+	{
+		return;
+	}
+	size_t RowSize = static_cast<size_t>(a_MaxX - a_MinX + 1);
+	for (int y = a_MinY; y <= a_MaxY; y++)
+	{
+		for (int z = a_MinZ; z <= a_MaxZ; z++)
+		{
+			T * Row = a_Array + a_MinX + (z + y * a_SizeZ) * a_SizeX;
+			std::fill(Row, Row + RowSize, a_Value);
+		}  // for z
+	}  // for y
+}
+
+
+
+
+
 /// Combinator used for cBlockArea::msOverwrite merging
 template <bool MetaValid>
 void MergeCombinatorOverwrite(BLOCKTYPE & a_DstType, BLOCKTYPE a_SrcType, NIBBLETYPE & a_DstMeta, NIBBLETYPE a_SrcMeta)
@@ -474,16 +544,9 @@ bool cBlockArea::Read(cForEachChunkProvider * a_ForEachChunkProvider, int a_MinB
 		return false;
 	}
 	m_Origin.Set(a_MinBlockX, a_MinBlockY, a_MinBlockZ);
-	cChunkReader Reader(*this);
-	
-	// Convert block coords to chunks coords:
-	int MinChunkX, MaxChunkX;
-	int MinChunkZ, MaxChunkZ;
-	cChunkDef::AbsoluteToRelative(a_MinBlockX, a_MinBlockY, a_MinBlockZ, MinChunkX, MinChunkZ);
-	cChunkDef::AbsoluteToRelative(a_MaxBlockX, a_MaxBlockY, a_MaxBlockZ, MaxChunkX, MaxChunkZ);
 	
 	// Query block data:
-	if (!a_ForEachChunkProvider->ForEachChunkInRect(MinChunkX, MaxChunkX, MinChunkZ, MaxChunkZ, Reader))
+	if (!a_ForEachChunkProvider->ReadBlockArea(*this))
 	{
 		Clear();
 		return false;
@@ -814,33 +877,24 @@ void cBlockArea::FillRelCuboid(int a_MinRelX, int a_MaxRelX, int a_MinRelY, int
 		a_DataTypes = a_DataTypes & GetDataTypes();
 	}
 	
+	ASSERT((a_MinRelX >= 0) && (a_MaxRelX < m_Size.x));
+	ASSERT((a_MinRelY >= 0) && (a_MaxRelY < m_Size.y));
+	ASSERT((a_MinRelZ >= 0) && (a_MaxRelZ < m_Size.z));
 	if ((a_DataTypes & baTypes) != 0)
 	{
-		for (int y = a_MinRelY; y <= a_MaxRelY; y++) for (int z = a_MinRelZ; z <= a_MaxRelZ; z++) for (int x = a_MinRelX; x <= a_MaxRelX; x++)
-		{
-			m_BlockTypes[MakeIndex(x, y, z)] = a_BlockType;
-		}  // for x, z, y
+		InternalFillCuboid(m_BlockTypes, m_Size.x, m_Size.z, a_MinRelX, a_MaxRelX, a_MinRelY, a_MaxRelY, a_MinRelZ, a_MaxRelZ, a_BlockType);
 	}
 	if ((a_DataTypes & baMetas) != 0)
 	{
-		for (int y = a_MinRelY; y <= a_MaxRelY; y++) for (int z = a_MinRelZ; z <= a_MaxRelZ; z++) for (int x = a_MinRelX; x <= a_MaxRelX; x++)
-		{
-			m_BlockMetas[MakeIndex(x, y, z)] = a_BlockMeta;
-		}  // for x, z, y
+		InternalFillCuboid(m_BlockMetas, m_Size.x, m_Size.z, a_MinRelX, a_MaxRelX, a_MinRelY, a_MaxRelY, a_MinRelZ, a_MaxRelZ, a_BlockMeta);
 	}
 	if ((a_DataTypes & baLight) != 0)
 	{
-		for (int y = a_MinRelY; y <= a_MaxRelY; y++) for (int z = a_MinRelZ; z <= a_MaxRelZ; z++) for (int x = a_MinRelX; x <= a_MaxRelX; x++)
-		{
-			m_BlockLight[MakeIndex(x, y, z)] = a_BlockLight;
-		}  // for x, z, y
+		InternalFillCuboid(m_BlockLight, m_Size.x, m_Size.z, a_MinRelX, a_MaxRelX, a_MinRelY, a_MaxRelY, a_MinRelZ, a_MaxRelZ, a_BlockLight);
 	}
 	if ((a_DataTypes & baSkyLight) != 0)
 	{
-		for (int y = a_MinRelY; y <= a_MaxRelY; y++) for (int z = a_MinRelZ; z <= a_MaxRelZ; z++) for (int x = a_MinRelX; x <= a_MaxRelX; x++)
-		{
-			m_BlockSkyLight[MakeIndex(x, y, z)] = a_BlockSkyLight;
-		}  // for x, z, y
+		InternalFillCuboid(m_BlockSkyLight, m_Size.x, m_Size.z, a_MinRelX, a_MaxRelX, a_MinRelY, a_MaxRelY, a_MinRelZ, a_MaxRelZ, a_BlockSkyLight);
 	}
 }
 
@@ -2112,11 +2166,10 @@ void cBlockArea::CropBlockTypes(int a_AddMinX, int a_SubMaxX, int a_AddMinY, int
 	{
 		for (int z = 0; z < NewSizeZ; z++)
 		{
-			for (int x = 0; x < NewSizeX; x++)
-			{
-				int OldIndex = MakeIndex(x + a_AddMinX, y + a_AddMinY, z + a_AddMinZ);
-				NewBlockTypes[idx++] = m_BlockTypes[OldIndex];
-			}  // for x
+			// Copy the whole row at once:
+			int OldIndex = MakeIndex(a_AddMinX, y + a_AddMinY, z + a_AddMinZ);
+			memcpy(NewBlockTypes + idx, m_BlockTypes + OldIndex, static_cast<size_t>(NewSizeX) * sizeof(BLOCKTYPE));
+			idx += NewSizeX;
 		}  // for z
 	}  // for y
 	delete m_BlockTypes;
@@ -2138,10 +2191,9 @@ void cBlockArea::CropNibbles(NIBBLEARRAY & a_Array, int a_AddMinX, int a_SubMaxX
 	{
 		for (int z = 0; z < NewSizeZ; z++)
 		{
-			for (int x = 0; x < NewSizeX; x++)
-			{
-				NewNibbles[idx++] = a_Array[MakeIndex(x + a_AddMinX, y + a_AddMinY, z + a_AddMinZ)];
-			}  // for x
+			// Copy the whole row at once:
+			memcpy(NewNibbles + idx, a_Array + MakeIndex(a_AddMinX, y + a_AddMinY, z + a_AddMinZ), static_cast<size_t>(NewSizeX) * sizeof(NIBBLETYPE));
+			idx += NewSizeX;
 		}  // for z
 	}  // for y
 	delete a_Array;
@@ -2268,14 +2320,14 @@ void cBlockArea::MergeByStrategy(const cBlockArea & a_Src, int a_RelX, int a_Rel
 	{
 		case cBlockArea::msOverwrite:
 		{
-			InternalMergeBlocks<MetasValid, MergeCombinatorOverwrite<MetasValid> >(
+			InternalCopyBlocks<MetasValid>(
 				m_BlockTypes, a_Src.GetBlockTypes(),
 				DstMetas, SrcMetas,
 				SizeX, SizeY, SizeZ,
 				SrcOffX, SrcOffY, SrcOffZ,
 				DstOffX, DstOffY, DstOffZ,
-				a_Src.GetSizeX(), a_Src.GetSizeY(), a_Src.GetSizeZ(),
-				m_Size.x, m_Size.y, m_Size.z
+				a_Src.GetSizeX(), a_Src.GetSizeZ(),
+				m_Size.x, m_Size.z
 			);
 			return;
 		}  // case msOverwrite
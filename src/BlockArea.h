@@ -326,6 +326,7 @@ public:
 
 protected:
 	friend class cChunkDesc;
+	friend class cChunkMap;
 	friend class cSchematicFileSerializer;
 	
 	class cChunkReader :
@@ -47,7 +47,8 @@ protected:
 		m_RelX(a_BlockX - cChunkDef::Width * FAST_FLOOR_DIV(a_BlockX, cChunkDef::Width)),
 		m_RelZ(a_BlockZ - cChunkDef::Width * FAST_FLOOR_DIV(a_BlockZ, cChunkDef::Width)),
 		m_BlockType(a_BlockType),
-		m_World(a_World)
+		m_World(a_World),
+		m_IsSleeping(false)
 	{
 	}
 
@@ -67,6 +68,9 @@ public:
 	/// If a_World is valid, then the entity is created bound to that world
 	/// Returns nullptr for unknown block types
 	static cBlockEntity * CreateByBlockType(BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, int a_BlockX, int a_BlockY, int a_BlockZ, cWorld * a_World = nullptr);
+
+	/** Returns true if the block type has a block entity, i.e. CreateByBlockType() supports it. */
+	static bool IsBlockEntityBlockType(BLOCKTYPE a_BlockType);
 	
 	static const char * GetClassStatic(void)  // Needed for ManualBindings's ForEach templates
 	{
@@ -99,6 +103,13 @@ public:
 	int GetRelX(void) const { return m_RelX; }
 	int GetRelZ(void) const { return m_RelZ; }
 	
+	/** Returns true if the block entity is sleeping: it has nothing to do until something changes around it, so it isn't ticked. */
+	bool IsSleeping(void) const { return m_IsSleeping; }
+	
+	/** Wakes the block entity up, so that it is ticked again and re-checks its surroundings.
+	Called by the chunk when a neighbor block or the contents of a neighbor container change, and by the entity itself when its own contents change. */
+	void WakeUp(void) { m_IsSleeping = false; }
+	
 	// tolua_end
 	
 	/// Called when a player uses this entity; should open the UI window
@@ -109,10 +120,13 @@ public:
 	*/
 	virtual void SendTo(cClientHandle & a_Client) = 0;
 	
-	/// Ticks the entity; returns true if the chunk should be marked as dirty as a result of this ticking. By default does nothing.
+	/** Ticks the entity; returns true if the chunk should be marked as dirty as a result of this ticking.
+	Not called while the entity is sleeping. By default does nothing and goes to sleep. */
 	virtual bool Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 	{
 		UNUSED(a_Dt);
+		UNUSED(a_Chunk);
+		Sleep();
 		return false;
 	}
 
@@ -126,6 +140,14 @@ protected:
 	BLOCKTYPE m_BlockType;
 	
 	cWorld * m_World;
+	
+	/** Set while the entity is sleeping, see IsSleeping(). Only accessed under the chunkmap lock. */
+	bool m_IsSleeping;
+	
+	
+	/** Makes the entity sleep: it won't be ticked until WakeUp() is called. To be called from Tick() once there's nothing left to do
+	and only a change around the entity can give it more work. */
+	void Sleep(void) { m_IsSleeping = true; }
 } ;  // tolua_export
 
 
@@ -84,10 +84,15 @@ protected:
 		{
 			if (GetWindow() != nullptr)
 			{
-				GetWindow()->BroadcastWholeWindow();
+				// Sent once per tick by the viewers' ticks, a hopper or a plugin may change several slots in a row:
+				GetWindow()->QueueBroadcastWholeWindow();
 			}
 
 			m_World->MarkChunkDirty(GetChunkX(), GetChunkZ());
+
+			// Both this entity and the ones moving items into or out of it (hoppers) may have something to do now:
+			WakeUp();
+			m_World->WakeUpBlockEntitiesAround(m_PosX, m_PosY, m_PosZ);
 		}
 	}
 } ;  // tolua_export
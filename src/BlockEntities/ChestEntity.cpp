@@ -140,3 +140,34 @@ void cChestEntity::OpenNewWindow(void)
 
 
 
+
+void cChestEntity::OnSlotChanged(cItemGrid * a_Grid, int a_SlotNum)
+{
+	super::OnSlotChanged(a_Grid, a_SlotNum);
+	if (m_World == nullptr)
+	{
+		return;
+	}
+
+	// The hoppers next to the other half of a double chest use this half, too, wake them up:
+	static const int Neighbors[][2] =
+	{
+		{-1,  0},
+		{ 1,  0},
+		{ 0, -1},
+		{ 0,  1},
+	} ;
+	for (size_t i = 0; i < ARRAYCOUNT(Neighbors); i++)
+	{
+		int BlockX = m_PosX + Neighbors[i][0];
+		int BlockZ = m_PosZ + Neighbors[i][1];
+		if (m_World->GetBlock(BlockX, m_PosY, BlockZ) == m_BlockType)
+		{
+			m_World->WakeUpBlockEntitiesAround(BlockX, m_PosY, BlockZ);
+		}
+	}
+}
+
+
+
+
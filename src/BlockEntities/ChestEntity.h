@@ -53,6 +53,9 @@ private:
 
 	/** Number of players who currently have this chest open */
 	int m_NumActivePlayers;
+	
+	// cBlockEntityWithItems overrides:
+	virtual void OnSlotChanged(cItemGrid * a_Grid, int a_SlotNum) override;
 } ;  // tolua_export
 
 
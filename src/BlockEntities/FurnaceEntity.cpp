@@ -103,6 +103,12 @@ bool cFurnaceEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 		m_BlockType = E_BLOCK_FURNACE;
 		a_Chunk.FastSetBlock(GetRelX(), m_PosY, GetRelZ(), E_BLOCK_FURNACE, m_BlockMeta);
 		UpdateProgressBars();
+
+		// Once the progress is fully reversed, there's nothing to do until the contents change:
+		if (m_TimeCooked == 0)
+		{
+			Sleep();
+		}
 		return false;
 	}
 
@@ -20,8 +20,15 @@
 cHopperEntity::cHopperEntity(int a_BlockX, int a_BlockY, int a_BlockZ, cWorld * a_World) :
 	super(E_BLOCK_HOPPER, a_BlockX, a_BlockY, a_BlockZ, ContentsWidth, ContentsHeight, a_World),
 	m_LastMoveItemsInTick(0),
-	m_LastMoveItemsOutTick(0)
+	m_LastMoveItemsOutTick(0),
+	m_NextNeighborCacheEntry(0)
 {
+	for (size_t i = 0; i < NEIGHBOR_CACHE_SIZE; i++)
+	{
+		m_NeighborCache[i].m_Chunk = nullptr;
+		m_NeighborCache[i].m_Revision = 0;
+		m_NeighborCache[i].m_BlockEntity = nullptr;
+	}
 }
 
 
@@ -64,6 +71,17 @@ bool cHopperEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 	res = MoveItemsIn  (a_Chunk, CurrentTick) || res;
 	res = MovePickupsIn(a_Chunk, CurrentTick) || res;
 	res = MoveItemsOut (a_Chunk, CurrentTick) || res;
+
+	// If nothing could be moved even though no transfer is waiting for its cooldown, nothing will move until something changes around
+	// the hopper; the neighbor containers, the neighbor blocks and the pickups landing on the hopper wake it up:
+	if (
+		!res &&
+		(CurrentTick - m_LastMoveItemsInTick >= TICKS_PER_TRANSFER) &&
+		(CurrentTick - m_LastMoveItemsOutTick >= TICKS_PER_TRANSFER)
+	)
+	{
+		Sleep();
+	}
 	return res;
 }
 
@@ -126,6 +144,33 @@ void cHopperEntity::OpenNewWindow(void)
 
 
 /// Moves items from the container above it into this hopper. Returns true if the contents have changed.
+cBlockEntity * cHopperEntity::GetNeighborBlockEntity(cChunk & a_Chunk, int a_BlockX, int a_BlockY, int a_BlockZ)
+{
+	Vector3i Pos(a_BlockX, a_BlockY, a_BlockZ);
+	UInt32 Revision = a_Chunk.GetBlockEntitiesRevision();
+	for (size_t i = 0; i < NEIGHBOR_CACHE_SIZE; i++)
+	{
+		const sNeighborCacheEntry & Entry = m_NeighborCache[i];
+		if ((Entry.m_Chunk == &a_Chunk) && (Entry.m_Revision == Revision) && (Entry.m_Pos == Pos))
+		{
+			return Entry.m_BlockEntity;
+		}
+	}
+
+	// Not cached, look up and remember, replacing the oldest entry:
+	sNeighborCacheEntry & Entry = m_NeighborCache[m_NextNeighborCacheEntry];
+	m_NextNeighborCacheEntry = (m_NextNeighborCacheEntry + 1) % NEIGHBOR_CACHE_SIZE;
+	Entry.m_Pos = Pos;
+	Entry.m_Chunk = &a_Chunk;
+	Entry.m_Revision = Revision;
+	Entry.m_BlockEntity = a_Chunk.GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	return Entry.m_BlockEntity;
+}
+
+
+
+
+
 bool cHopperEntity::MoveItemsIn(cChunk & a_Chunk, Int64 a_CurrentTick)
 {
 	if (m_PosY >= cChunkDef::Height)
@@ -162,7 +207,7 @@ bool cHopperEntity::MoveItemsIn(cChunk & a_Chunk, Int64 a_CurrentTick)
 		case E_BLOCK_DROPPER:
 		case E_BLOCK_HOPPER:
 		{
-			res = MoveItemsFromGrid(*static_cast<cBlockEntityWithItems *>(a_Chunk.GetBlockEntity(m_PosX, m_PosY + 1, m_PosZ)));
+			res = MoveItemsFromGrid(*static_cast<cBlockEntityWithItems *>(GetNeighborBlockEntity(a_Chunk, m_PosX, m_PosY + 1, m_PosZ)));
 			break;
 		}
 	}
@@ -328,7 +373,7 @@ bool cHopperEntity::MoveItemsOut(cChunk & a_Chunk, Int64 a_CurrentTick)
 		case E_BLOCK_DROPPER:
 		case E_BLOCK_HOPPER:
 		{
-			cBlockEntityWithItems * BlockEntity = static_cast<cBlockEntityWithItems *>(DestChunk->GetBlockEntity(OutX, OutY, OutZ));
+			cBlockEntityWithItems * BlockEntity = static_cast<cBlockEntityWithItems *>(GetNeighborBlockEntity(*DestChunk, OutX, OutY, OutZ));
 			if (BlockEntity == nullptr)
 			{
 				LOGWARNING("%s: A block entity was not found where expected at {%d, %d, %d}", __FUNCTION__, OutX, OutY, OutZ);
@@ -355,7 +400,7 @@ bool cHopperEntity::MoveItemsOut(cChunk & a_Chunk, Int64 a_CurrentTick)
 /// Moves items from a chest (dblchest) above the hopper into this hopper. Returns true if contents have changed.
 bool cHopperEntity::MoveItemsFromChest(cChunk & a_Chunk)
 {
-	cChestEntity * MainChest = static_cast<cChestEntity *>(a_Chunk.GetBlockEntity(m_PosX, m_PosY + 1, m_PosZ));
+	cChestEntity * MainChest = static_cast<cChestEntity *>(GetNeighborBlockEntity(a_Chunk, m_PosX, m_PosY + 1, m_PosZ));
 	if (MainChest == nullptr)
 	{
 		LOGWARNING("%s: A chest entity was not found where expected, at {%d, %d, %d}", __FUNCTION__, m_PosX, m_PosY + 1, m_PosZ);
@@ -396,7 +441,7 @@ bool cHopperEntity::MoveItemsFromChest(cChunk & a_Chunk)
 			continue;
 		}
 
-		cChestEntity * SideChest = static_cast<cChestEntity *>(Neighbor->GetBlockEntity(m_PosX + Coords[i].x, m_PosY + 1, m_PosZ + Coords[i].z));
+		cChestEntity * SideChest = static_cast<cChestEntity *>(GetNeighborBlockEntity(*Neighbor, m_PosX + Coords[i].x, m_PosY + 1, m_PosZ + Coords[i].z));
 		if (SideChest == nullptr)
 		{
 			LOGWARNING("%s: A chest entity was not found where expected, at {%d, %d, %d}", __FUNCTION__, m_PosX + Coords[i].x, m_PosY + 1, m_PosZ + Coords[i].z);
@@ -422,7 +467,7 @@ bool cHopperEntity::MoveItemsFromChest(cChunk & a_Chunk)
 /// Moves items from a furnace above the hopper into this hopper. Returns true if contents have changed.
 bool cHopperEntity::MoveItemsFromFurnace(cChunk & a_Chunk)
 {
-	cFurnaceEntity * Furnace = static_cast<cFurnaceEntity *>(a_Chunk.GetBlockEntity(m_PosX, m_PosY + 1, m_PosZ));
+	cFurnaceEntity * Furnace = static_cast<cFurnaceEntity *>(GetNeighborBlockEntity(a_Chunk, m_PosX, m_PosY + 1, m_PosZ));
 	if (Furnace == nullptr)
 	{
 		LOGWARNING("%s: A furnace entity was not found where expected, at {%d, %d, %d}", __FUNCTION__, m_PosX, m_PosY + 1, m_PosZ);
@@ -525,7 +570,7 @@ bool cHopperEntity::MoveItemsFromSlot(cBlockEntityWithItems & a_Entity, int a_Sl
 bool cHopperEntity::MoveItemsToChest(cChunk & a_Chunk, int a_BlockX, int a_BlockY, int a_BlockZ)
 {
 	// Try the chest directly connected to the hopper:
-	cChestEntity * ConnectedChest = static_cast<cChestEntity *>(a_Chunk.GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ));
+	cChestEntity * ConnectedChest = static_cast<cChestEntity *>(GetNeighborBlockEntity(a_Chunk, a_BlockX, a_BlockY, a_BlockZ));
 	if (ConnectedChest == nullptr)
 	{
 		LOGWARNING("%s: A chest entity was not found where expected, at {%d, %d, %d}", __FUNCTION__, a_BlockX, a_BlockY, a_BlockZ);
@@ -568,7 +613,7 @@ bool cHopperEntity::MoveItemsToChest(cChunk & a_Chunk, int a_BlockX, int a_Block
 			continue;
 		}
 
-		cChestEntity * Chest = static_cast<cChestEntity *>(Neighbor->GetBlockEntity(a_BlockX + Coords[i].x, a_BlockY, a_BlockZ + Coords[i].z));
+		cChestEntity * Chest = static_cast<cChestEntity *>(GetNeighborBlockEntity(*Neighbor, a_BlockX + Coords[i].x, a_BlockY, a_BlockZ + Coords[i].z));
 		if (Chest == nullptr)
 		{
 			LOGWARNING("%s: A chest entity was not found where expected, at {%d, %d, %d} (%d, %d)", __FUNCTION__, a_BlockX + Coords[i].x, a_BlockY, a_BlockZ + Coords[i].z, x, z);
@@ -592,7 +637,7 @@ bool cHopperEntity::MoveItemsToChest(cChunk & a_Chunk, int a_BlockX, int a_Block
 /// Moves items to the furnace at the specified coords. Returns true if contents have changed
 bool cHopperEntity::MoveItemsToFurnace(cChunk & a_Chunk, int a_BlockX, int a_BlockY, int a_BlockZ, NIBBLETYPE a_HopperMeta)
 {
-	cFurnaceEntity * Furnace = static_cast<cFurnaceEntity *>(a_Chunk.GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ));
+	cFurnaceEntity * Furnace = static_cast<cFurnaceEntity *>(GetNeighborBlockEntity(a_Chunk, a_BlockX, a_BlockY, a_BlockZ));
 	if (a_HopperMeta == E_META_HOPPER_FACING_YM)
 	{
 		// Feed the input slot of the furnace
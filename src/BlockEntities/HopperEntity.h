@@ -44,9 +44,34 @@ public:
 	
 protected:
 
+	/** The number of the neighboring block entities remembered by the hopper; enough for the containers above and below,
+	and the other halves of their double-chests. */
+	static const size_t NEIGHBOR_CACHE_SIZE = 4;
+
+	/** A single neighboring block entity remembered by the hopper, see GetNeighborBlockEntity(). */
+	struct sNeighborCacheEntry
+	{
+		Vector3i m_Pos;
+
+		/** The chunk in which the block entity was looked up. Only compared, never dereferenced, because it may have been unloaded since. */
+		const cChunk * m_Chunk;
+
+		/** The chunk's block entities revision when the block entity was looked up. */
+		UInt32 m_Revision;
+
+		/** The block entity found, may be nullptr. */
+		cBlockEntity * m_BlockEntity;
+	} ;
+
 	Int64 m_LastMoveItemsInTick;
 	Int64 m_LastMoveItemsOutTick;
 
+	/** The neighboring block entities looked up recently, see GetNeighborBlockEntity(). */
+	sNeighborCacheEntry m_NeighborCache[NEIGHBOR_CACHE_SIZE];
+
+	/** The index into m_NeighborCache to be replaced by the next lookup that isn't cached. */
+	size_t m_NextNeighborCacheEntry;
+
 	// cBlockEntity overrides:
 	virtual bool Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk) override;
 	virtual void SendTo(cClientHandle & a_Client) override;
@@ -54,6 +79,11 @@ protected:
 	
 	/// Opens a new chest window for this chest. Scans for neighbors to open a double chest window, if appropriate.
 	void OpenNewWindow(void);
+	
+	/** Returns the block entity at the specified absolute coords in a_Chunk, same as cChunk::GetBlockEntity().
+	The hopper moves items between the same containers every few ticks, so the lookups are remembered for as long as
+	the chunk's block entities don't change (see cChunk::GetBlockEntitiesRevision()), sparing the scan of the chunk's block entities. */
+	cBlockEntity * GetNeighborBlockEntity(cChunk & a_Chunk, int a_BlockX, int a_BlockY, int a_BlockZ);
 
 	/// Moves items from the container above it into this hopper. Returns true if the contents have changed.
 	bool MoveItemsIn(cChunk & a_Chunk, Int64 a_CurrentTick);
@@ -3,6 +3,28 @@
 
 #include "BlockInfo.h"
 #include "Blocks/BlockHandler.h"
+#include "BlockEntities/BlockEntity.h"
+#include "ChunkData.h"
+
+
+
+UInt16     cBlockInfo::ms_Flags[256];
+NIBBLETYPE cBlockInfo::ms_LightValues[256];
+NIBBLETYPE cBlockInfo::ms_SpreadLightFalloffs[256];
+float      cBlockInfo::ms_BlastResistances[256];
+
+/** Initializes the block info during the static initialization, so that the packed tables are filled
+before any thread reads them through the accessors. */
+static class cBlockInfoInitializer
+{
+public:
+	cBlockInfoInitializer(void)
+	{
+		cBlockInfo::Get(E_BLOCK_AIR);
+	}
+} g_BlockInfoInitializer;
+
+
 
 
 
@@ -21,6 +43,11 @@ void cBlockInfo::Initialize(cBlockInfoArray & a_Info)
 		{
 			a_Info[i].m_Handler = cBlockHandler::CreateBlockHandler((BLOCKTYPE) i);
 		}
+		cBlockHandler * Handler = a_Info[i].m_Handler;
+		a_Info[i].m_IsUseable                = Handler->IsUseable();
+		a_Info[i].m_IsClickedThrough         = Handler->IsClickedThrough();
+		a_Info[i].m_DoesIgnoreBuildCollision = Handler->DoesIgnoreBuildCollision();
+		a_Info[i].m_DoesDropOnUnsuitable     = Handler->DoesDropOnUnsuitable();
 	}
 
 	// Emissive blocks
@@ -563,6 +590,31 @@ void cBlockInfo::Initialize(cBlockInfoArray & a_Info)
 	a_Info[E_BLOCK_WOOL                ].m_FullyOccupiesVoxel = true;
 
 
+	// Blocks whose handlers implement OnUpdate(); keep in sync with the handlers, the other blocks are skipped by the random ticking:
+	a_Info[E_BLOCK_CACTUS              ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_CARROTS             ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_CAULDRON            ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_COCOA_POD           ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_CROPS               ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_DIRT                ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_FARMLAND            ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_GRASS               ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_LAVA                ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_LEAVES              ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_MELON_STEM          ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_NETHER_PORTAL       ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_NETHER_WART         ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_NEW_LEAVES          ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_POTATOES            ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_PUMPKIN_STEM        ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_SAPLING             ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_STATIONARY_LAVA     ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_STATIONARY_WATER    ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_SUGARCANE           ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_VINES               ].m_IsRandomTicked = true;
+	a_Info[E_BLOCK_WATER               ].m_IsRandomTicked = true;
+
+
 	// Blocks that can be terraformed
 	a_Info[E_BLOCK_COAL_ORE            ].m_CanBeTerraformed = true;
 	a_Info[E_BLOCK_COBBLESTONE         ].m_CanBeTerraformed = true;
@@ -584,6 +636,174 @@ void cBlockInfo::Initialize(cBlockInfoArray & a_Info)
 	a_Info[E_BLOCK_STONE               ].m_CanBeTerraformed = true;
 
 
+	// Blast resistance of the blocks, as used by the explosions' rays (vanilla values); the blocks not listed have none:
+	a_Info[E_BLOCK_ACACIA_DOOR         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_ACACIA_FENCE        ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_ACACIA_FENCE_GATE   ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_ACACIA_WOOD_STAIRS  ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_ACTIVATOR_RAIL      ].m_BlastResistance = 0.7f;
+	a_Info[E_BLOCK_ANVIL               ].m_BlastResistance = 1200.0f;
+	a_Info[E_BLOCK_BARRIER             ].m_BlastResistance = 3600000.0f;
+	a_Info[E_BLOCK_BEACON              ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_BED                 ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_BEDROCK             ].m_BlastResistance = 3600000.0f;
+	a_Info[E_BLOCK_BIRCH_DOOR          ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_BIRCH_FENCE         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_BIRCH_FENCE_GATE    ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_BIRCH_WOOD_STAIRS   ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_BLOCK_OF_COAL       ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_BLOCK_OF_REDSTONE   ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_BOOKCASE            ].m_BlastResistance = 1.5f;
+	a_Info[E_BLOCK_BREWING_STAND       ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_BRICK               ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_BRICK_STAIRS        ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_BROWN_MUSHROOM      ].m_BlastResistance = 0.0f;
+	a_Info[E_BLOCK_CACTUS              ].m_BlastResistance = 0.4f;
+	a_Info[E_BLOCK_CAKE                ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_CARPET              ].m_BlastResistance = 0.1f;
+	a_Info[E_BLOCK_CAULDRON            ].m_BlastResistance = 2.0f;
+	a_Info[E_BLOCK_CHEST               ].m_BlastResistance = 2.5f;
+	a_Info[E_BLOCK_CLAY                ].m_BlastResistance = 0.6f;
+	a_Info[E_BLOCK_COAL_ORE            ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_COBBLESTONE         ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_COBBLESTONE_STAIRS  ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_COBBLESTONE_WALL    ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_COBWEB              ].m_BlastResistance = 4.0f;
+	a_Info[E_BLOCK_COCOA_POD           ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_COMMAND_BLOCK       ].m_BlastResistance = 3600000.0f;
+	a_Info[E_BLOCK_CRAFTING_TABLE      ].m_BlastResistance = 2.5f;
+	a_Info[E_BLOCK_DARK_OAK_DOOR       ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_DARK_OAK_FENCE      ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_DARK_OAK_FENCE_GATE ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_DARK_OAK_WOOD_STAIRS].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_DAYLIGHT_SENSOR     ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_DETECTOR_RAIL       ].m_BlastResistance = 0.7f;
+	a_Info[E_BLOCK_DIAMOND_BLOCK       ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_DIAMOND_ORE         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_DIRT                ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_DISPENSER           ].m_BlastResistance = 3.5f;
+	a_Info[E_BLOCK_DOUBLE_NEW_STONE_SLAB].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_DOUBLE_STONE_SLAB   ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_DOUBLE_WOODEN_SLAB  ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_DRAGON_EGG          ].m_BlastResistance = 9.0f;
+	a_Info[E_BLOCK_DROPPER             ].m_BlastResistance = 3.5f;
+	a_Info[E_BLOCK_EMERALD_BLOCK       ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_EMERALD_ORE         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_ENCHANTMENT_TABLE   ].m_BlastResistance = 1200.0f;
+	a_Info[E_BLOCK_END_PORTAL          ].m_BlastResistance = 3600000.0f;
+	a_Info[E_BLOCK_END_PORTAL_FRAME    ].m_BlastResistance = 3600000.0f;
+	a_Info[E_BLOCK_END_STONE           ].m_BlastResistance = 9.0f;
+	a_Info[E_BLOCK_ENDER_CHEST         ].m_BlastResistance = 600.0f;
+	a_Info[E_BLOCK_FARMLAND            ].m_BlastResistance = 0.6f;
+	a_Info[E_BLOCK_FENCE               ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_FENCE_GATE          ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_FURNACE             ].m_BlastResistance = 3.5f;
+	a_Info[E_BLOCK_GLASS               ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_GLASS_PANE          ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_GLOWSTONE           ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_GOLD_BLOCK          ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_GOLD_ORE            ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_GRASS               ].m_BlastResistance = 0.6f;
+	a_Info[E_BLOCK_GRAVEL              ].m_BlastResistance = 0.6f;
+	a_Info[E_BLOCK_HARDENED_CLAY       ].m_BlastResistance = 4.2f;
+	a_Info[E_BLOCK_HAY_BALE            ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_HEAD                ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_HEAVY_WEIGHTED_PRESSURE_PLATE].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_HOPPER              ].m_BlastResistance = 4.8f;
+	a_Info[E_BLOCK_HUGE_BROWN_MUSHROOM ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_HUGE_RED_MUSHROOM   ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_ICE                 ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_INVERTED_DAYLIGHT_SENSOR].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_IRON_BARS           ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_IRON_BLOCK          ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_IRON_DOOR           ].m_BlastResistance = 5.0f;
+	a_Info[E_BLOCK_IRON_ORE            ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_IRON_TRAPDOOR       ].m_BlastResistance = 5.0f;
+	a_Info[E_BLOCK_JACK_O_LANTERN      ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_JUKEBOX             ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_JUNGLE_DOOR         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_JUNGLE_FENCE        ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_JUNGLE_FENCE_GATE   ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_JUNGLE_WOOD_STAIRS  ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_LADDER              ].m_BlastResistance = 0.4f;
+	a_Info[E_BLOCK_LAPIS_BLOCK         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_LAPIS_ORE           ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_LAVA                ].m_BlastResistance = 100.0f;
+	a_Info[E_BLOCK_LEAVES              ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_LEVER               ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_LIGHT_WEIGHTED_PRESSURE_PLATE].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_LIT_FURNACE         ].m_BlastResistance = 3.5f;
+	a_Info[E_BLOCK_LOG                 ].m_BlastResistance = 2.0f;
+	a_Info[E_BLOCK_MELON               ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_MOB_SPAWNER         ].m_BlastResistance = 5.0f;
+	a_Info[E_BLOCK_MOSSY_COBBLESTONE   ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_MYCELIUM            ].m_BlastResistance = 0.6f;
+	a_Info[E_BLOCK_NETHER_BRICK        ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_NETHER_BRICK_FENCE  ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_NETHER_BRICK_STAIRS ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_NETHER_QUARTZ_ORE   ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_NETHERRACK          ].m_BlastResistance = 0.4f;
+	a_Info[E_BLOCK_NEW_LEAVES          ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_NEW_LOG             ].m_BlastResistance = 2.0f;
+	a_Info[E_BLOCK_NEW_STONE_SLAB      ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_NOTE_BLOCK          ].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_OBSIDIAN            ].m_BlastResistance = 1200.0f;
+	a_Info[E_BLOCK_PACKED_ICE          ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_PISTON              ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_PISTON_EXTENSION    ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_PLANKS              ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_POWERED_RAIL        ].m_BlastResistance = 0.7f;
+	a_Info[E_BLOCK_PRISMARINE_BLOCK    ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_PUMPKIN             ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_QUARTZ_BLOCK        ].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_QUARTZ_STAIRS       ].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_RAIL                ].m_BlastResistance = 0.7f;
+	a_Info[E_BLOCK_RED_SANDSTONE       ].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_RED_SANDSTONE_STAIRS].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_REDSTONE_LAMP_OFF   ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_REDSTONE_LAMP_ON    ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_REDSTONE_ORE        ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_REDSTONE_ORE_GLOWING].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_SAND                ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_SANDSTONE           ].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_SANDSTONE_STAIRS    ].m_BlastResistance = 0.8f;
+	a_Info[E_BLOCK_SEA_LANTERN         ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_SIGN_POST           ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_SILVERFISH_EGG      ].m_BlastResistance = 0.75f;
+	a_Info[E_BLOCK_SNOW                ].m_BlastResistance = 0.1f;
+	a_Info[E_BLOCK_SNOW_BLOCK          ].m_BlastResistance = 0.2f;
+	a_Info[E_BLOCK_SOULSAND            ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_SPONGE              ].m_BlastResistance = 0.6f;
+	a_Info[E_BLOCK_SPRUCE_DOOR         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_SPRUCE_FENCE        ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_SPRUCE_FENCE_GATE   ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_SPRUCE_WOOD_STAIRS  ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_STAINED_CLAY        ].m_BlastResistance = 4.2f;
+	a_Info[E_BLOCK_STAINED_GLASS       ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_STAINED_GLASS_PANE  ].m_BlastResistance = 0.3f;
+	a_Info[E_BLOCK_STANDING_BANNER     ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_STATIONARY_LAVA     ].m_BlastResistance = 100.0f;
+	a_Info[E_BLOCK_STATIONARY_WATER    ].m_BlastResistance = 100.0f;
+	a_Info[E_BLOCK_STICKY_PISTON       ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_STONE               ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_STONE_BRICK_STAIRS  ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_STONE_BRICKS        ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_STONE_BUTTON        ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_STONE_PRESSURE_PLATE].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_STONE_SLAB          ].m_BlastResistance = 6.0f;
+	a_Info[E_BLOCK_TRAPDOOR            ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_TRAPPED_CHEST       ].m_BlastResistance = 2.5f;
+	a_Info[E_BLOCK_WALL_BANNER         ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_WALLSIGN            ].m_BlastResistance = 1.0f;
+	a_Info[E_BLOCK_WATER               ].m_BlastResistance = 100.0f;
+	a_Info[E_BLOCK_WOODEN_BUTTON       ].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_WOODEN_DOOR         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_WOODEN_PRESSURE_PLATE].m_BlastResistance = 0.5f;
+	a_Info[E_BLOCK_WOODEN_SLAB         ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_WOODEN_STAIRS       ].m_BlastResistance = 3.0f;
+	a_Info[E_BLOCK_WOOL                ].m_BlastResistance = 0.8f;
+
+
 	// Block place sounds:
 	a_Info[E_BLOCK_STONE               ].m_PlaceSound = "dig.stone";
 	a_Info[E_BLOCK_GRASS               ].m_PlaceSound = "dig.grass";
@@ -773,6 +993,52 @@ void cBlockInfo::Initialize(cBlockInfoArray & a_Info)
 	a_Info[E_BLOCK_JUNGLE_DOOR         ].m_PlaceSound = "dig.wood";
 	a_Info[E_BLOCK_ACACIA_DOOR         ].m_PlaceSound = "dig.wood";
 	a_Info[E_BLOCK_DARK_OAK_DOOR       ].m_PlaceSound = "dig.wood";
+
+	// The categories counted by cChunkData in each chunk section:
+	for (unsigned int i = 0; i < 256; ++i)
+	{
+		BLOCKTYPE BlockType = static_cast<BLOCKTYPE>(i);
+		cChunkData::SetBlockTypeCategory(BlockType, bcLightSource,  (a_Info[i].m_LightValue > 0));
+		cChunkData::SetBlockTypeCategory(BlockType, bcFluid,        IsBlockLiquid(BlockType));
+		cChunkData::SetBlockTypeCategory(BlockType, bcRandomTicked, a_Info[i].m_IsRandomTicked);
+		cChunkData::SetBlockTypeCategory(BlockType, bcBlockEntity,  cBlockEntity::IsBlockEntityBlockType(BlockType));
+	}
+
+	// Pack the hot properties into the tables read by the accessors:
+	static const struct
+	{
+		bool cBlockInfo::* m_Member;
+		eFlag m_Flag;
+	} FlagMembers[] =
+	{
+		{ &cBlockInfo::m_Transparent,              bfTransparent },
+		{ &cBlockInfo::m_OneHitDig,                bfOneHitDig },
+		{ &cBlockInfo::m_PistonBreakable,          bfPistonBreakable },
+		{ &cBlockInfo::m_IsSnowable,               bfSnowable },
+		{ &cBlockInfo::m_IsSolid,                  bfSolid },
+		{ &cBlockInfo::m_FullyOccupiesVoxel,       bfFullyOccupiesVoxel },
+		{ &cBlockInfo::m_CanBeTerraformed,         bfCanBeTerraformed },
+		{ &cBlockInfo::m_IsRandomTicked,           bfRandomTicked },
+		{ &cBlockInfo::m_IsUseable,                bfUseable },
+		{ &cBlockInfo::m_IsClickedThrough,         bfClickedThrough },
+		{ &cBlockInfo::m_DoesIgnoreBuildCollision, bfIgnoreBuildCollision },
+		{ &cBlockInfo::m_DoesDropOnUnsuitable,     bfDropOnUnsuitable },
+	};
+	for (unsigned int i = 0; i < 256; ++i)
+	{
+		UInt16 Flags = 0;
+		for (size_t f = 0; f < ARRAYCOUNT(FlagMembers); f++)
+		{
+			if (a_Info[i].*(FlagMembers[f].m_Member))
+			{
+				Flags = static_cast<UInt16>(Flags | FlagMembers[f].m_Flag);
+			}
+		}
+		ms_Flags[i] = Flags;
+		ms_LightValues[i] = a_Info[i].m_LightValue;
+		ms_SpreadLightFalloffs[i] = a_Info[i].m_SpreadLightFalloff;
+		ms_BlastResistances[i] = a_Info[i].m_BlastResistance;
+	}
 }
 
 
@@ -61,6 +61,12 @@ public:
 	/** Can a finisher change it? */
 	bool m_CanBeTerraformed;
 
+	/** Does the block's handler do anything in OnUpdate() - does the chunk's random block ticking need to visit this block? */
+	bool m_IsRandomTicked;
+
+	/** How much does the block weaken the explosion rays passing through it? */
+	float m_BlastResistance;
+
 	/** Sound when placing this block */
 	AString m_PlaceSound;
 
@@ -69,18 +75,32 @@ public:
 	/** Associated block handler. */
 	cBlockHandler * m_Handler;
 
+	/** The handler's answers to the queries that don't depend on anything but the block type, precomputed in Initialize()
+	so that the hot paths needn't make the virtual calls through the handler. */
+	bool m_IsUseable;
+	bool m_IsClickedThrough;
+	bool m_DoesIgnoreBuildCollision;
+	bool m_DoesDropOnUnsuitable;
+
+	inline static bool IsUseable                  (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfUseable);                }
+	inline static bool IsClickedThrough           (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfClickedThrough);         }
+	inline static bool DoesIgnoreBuildCollision   (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfIgnoreBuildCollision);   }
+	inline static bool DoesDropOnUnsuitable       (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfDropOnUnsuitable);       }
+
 	// tolua_begin
 
-	inline static NIBBLETYPE GetLightValue        (BLOCKTYPE a_Type) { return Get(a_Type).m_LightValue;          }
-	inline static NIBBLETYPE GetSpreadLightFalloff(BLOCKTYPE a_Type) { return Get(a_Type).m_SpreadLightFalloff;  }
-	inline static bool IsTransparent              (BLOCKTYPE a_Type) { return Get(a_Type).m_Transparent;         }
-	inline static bool IsOneHitDig                (BLOCKTYPE a_Type) { return Get(a_Type).m_OneHitDig;           }
-	inline static bool IsPistonBreakable          (BLOCKTYPE a_Type) { return Get(a_Type).m_PistonBreakable;     }
-	inline static bool IsSnowable                 (BLOCKTYPE a_Type) { return Get(a_Type).m_IsSnowable;          }
-	inline static bool IsSolid                    (BLOCKTYPE a_Type) { return Get(a_Type).m_IsSolid;             }
-	inline static bool FullyOccupiesVoxel         (BLOCKTYPE a_Type) { return Get(a_Type).m_FullyOccupiesVoxel;  }
-	inline static bool CanBeTerraformed           (BLOCKTYPE a_Type) { return Get(a_Type).m_CanBeTerraformed;    }
-	inline static AString GetPlaceSound           (BLOCKTYPE a_Type) { return Get(a_Type).m_PlaceSound;          }
+	inline static NIBBLETYPE GetLightValue        (BLOCKTYPE a_Type) { return ms_LightValues[a_Type];                    }
+	inline static NIBBLETYPE GetSpreadLightFalloff(BLOCKTYPE a_Type) { return ms_SpreadLightFalloffs[a_Type];            }
+	inline static bool IsTransparent              (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfTransparent);            }
+	inline static bool IsOneHitDig                (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfOneHitDig);              }
+	inline static bool IsPistonBreakable          (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfPistonBreakable);        }
+	inline static bool IsSnowable                 (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfSnowable);               }
+	inline static bool IsSolid                    (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfSolid);                  }
+	inline static bool FullyOccupiesVoxel         (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfFullyOccupiesVoxel);     }
+	inline static bool CanBeTerraformed           (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfCanBeTerraformed);       }
+	inline static bool IsRandomTicked             (BLOCKTYPE a_Type) { return HasFlag(a_Type, bfRandomTicked);           }
+	inline static float GetBlastResistance        (BLOCKTYPE a_Type) { return ms_BlastResistances[a_Type];               }
+	inline static AString GetPlaceSound           (BLOCKTYPE a_Type) { return Get(a_Type).m_PlaceSound;                  }
 
 	// tolua_end
 
@@ -90,6 +110,33 @@ protected:
 	/** Storage for all the BlockInfo structures. */
 	typedef cBlockInfo cBlockInfoArray[256];
 
+	/** The bits in ms_Flags, one for each boolean property. */
+	enum eFlag
+	{
+		bfTransparent          = 0x0001,
+		bfOneHitDig            = 0x0002,
+		bfPistonBreakable      = 0x0004,
+		bfSnowable             = 0x0008,
+		bfSolid                = 0x0010,
+		bfFullyOccupiesVoxel   = 0x0020,
+		bfCanBeTerraformed     = 0x0040,
+		bfRandomTicked         = 0x0080,
+		bfUseable              = 0x0100,
+		bfClickedThrough       = 0x0200,
+		bfIgnoreBuildCollision = 0x0400,
+		bfDropOnUnsuitable     = 0x0800,
+	} ;
+
+	/** The properties queried in the hot loops (lighting, explosions, generators), packed into small plain tables
+	that the accessors read directly, instead of going through Get() and its init check into the large per-block structures.
+	Filled by Initialize() from the per-block structures, which stay the source of the values. */
+	static UInt16 ms_Flags[256];
+	static NIBBLETYPE ms_LightValues[256];
+	static NIBBLETYPE ms_SpreadLightFalloffs[256];
+	static float ms_BlastResistances[256];
+
+	inline static bool HasFlag(BLOCKTYPE a_Type, eFlag a_Flag) { return ((ms_Flags[a_Type] & a_Flag) != 0); }
+
 	/** Creates a default BlockInfo structure, initializes all values to their defaults */
 	cBlockInfo()
 		: m_LightValue(0x00)
@@ -101,8 +148,14 @@ protected:
 		, m_IsSolid(true)
 		, m_FullyOccupiesVoxel(false)
 		, m_CanBeTerraformed(false)
+		, m_IsRandomTicked(false)
+		, m_BlastResistance(0.0f)
 		, m_PlaceSound("")
 		, m_Handler(nullptr)
+		, m_IsUseable(false)
+		, m_IsClickedThrough(false)
+		, m_DoesIgnoreBuildCollision(false)
+		, m_DoesDropOnUnsuitable(true)
 	{}
 
 	/** Cleans up the stored values */
@@ -114,6 +114,14 @@ public:
 	}
 	
 protected:
+	/** Creates the BlockTracer parent without any callbacks, for the descendants that don't report through them. */
+	cBlockTracer(cWorld & a_World) :
+		m_World(&a_World),
+		m_Callbacks(nullptr)
+	{
+	}
+
+
 	/// The world upon which to operate
 	cWorld * m_World;
 	
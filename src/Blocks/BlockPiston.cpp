@@ -144,9 +144,9 @@ void cBlockPistonHandler::ExtendPiston(int a_BlockX, int a_BlockY, int a_BlockZ,
 	a_World->GetBlockTypeMeta(a_BlockX, a_BlockY, a_BlockZ, currBlock, currMeta);
 	if (currBlock != E_BLOCK_AIR)
 	{
-		cBlockHandler * Handler = BlockHandler(currBlock);
-		if (Handler->DoesDropOnUnsuitable())
+		if (cBlockInfo::DoesDropOnUnsuitable(currBlock))
 		{
+			cBlockHandler * Handler = BlockHandler(currBlock);
 			cChunkInterface ChunkInterface(a_World->GetChunkMap());
 			cBlockInServerPluginInterface PluginInterface(*a_World);
 			Handler->DropBlock(ChunkInterface, *a_World, PluginInterface, nullptr, a_BlockX, a_BlockY, a_BlockZ);
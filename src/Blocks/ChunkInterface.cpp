@@ -126,6 +126,15 @@ bool cChunkInterface::ForEachChunkInRect(int a_MinChunkX, int a_MaxChunkX, int a
 
 
 
+bool cChunkInterface::ReadBlockArea(cBlockArea & a_Area)
+{
+	return m_ChunkMap->ReadBlockArea(a_Area);
+}
+
+
+
+
+
 bool cChunkInterface::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes)
 {
 	return m_ChunkMap->WriteBlockArea(a_Area, a_MinBlockX, a_MinBlockY, a_MinBlockZ, a_DataTypes);
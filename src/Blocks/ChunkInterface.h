@@ -43,6 +43,8 @@ public:
 	
 	virtual bool ForEachChunkInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, cChunkDataCallback & a_Callback) override;
 	
+	virtual bool ReadBlockArea(cBlockArea & a_Area) override;
+
 	virtual bool WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes) override;
 	
 	bool DigBlock(cWorldInterface & a_WorldInterface, int a_X, int a_Y, int a_Z);
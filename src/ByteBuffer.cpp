@@ -321,9 +321,7 @@ bool cByteBuffer::ReadBEInt8(Int8 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(1);
-	ReadBuf(&a_Value, 1);
-	return true;
+	return ReadFast(&a_Value, 1);
 }
 
 
@@ -334,9 +332,7 @@ bool cByteBuffer::ReadBEUInt8(UInt8 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(1);
-	ReadBuf(&a_Value, 1);
-	return true;
+	return ReadFast(&a_Value, 1);
 }
 
 
@@ -347,9 +343,11 @@ bool cByteBuffer::ReadBEInt16(Int16 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(2);
 	UInt16 val;
-	ReadBuf(&val, 2);
+	if (!ReadFast(&val, 2))
+	{
+		return false;
+	}
 	val = ntohs(val);
 	memcpy(&a_Value, &val, 2);
 	return true;
@@ -363,8 +361,10 @@ bool cByteBuffer::ReadBEUInt16(UInt16 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(2);
-	ReadBuf(&a_Value, 2);
+	if (!ReadFast(&a_Value, 2))
+	{
+		return false;
+	}
 	a_Value = ntohs(a_Value);
 	return true;
 }
@@ -377,9 +377,11 @@ bool cByteBuffer::ReadBEInt32(Int32 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(4);
 	UInt32 val;
-	ReadBuf(&val, 4);
+	if (!ReadFast(&val, 4))
+	{
+		return false;
+	}
 	val = ntohl(val);
 	memcpy(&a_Value, &val, 4);
 	return true;
@@ -393,8 +395,10 @@ bool cByteBuffer::ReadBEUInt32(UInt32 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(4);
-	ReadBuf(&a_Value, 4);
+	if (!ReadFast(&a_Value, 4))
+	{
+		return false;
+	}
 	a_Value = ntohl(a_Value);
 	return true;
 }
@@ -407,8 +411,10 @@ bool cByteBuffer::ReadBEInt64(Int64 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(8);
-	ReadBuf(&a_Value, 8);
+	if (!ReadFast(&a_Value, 8))
+	{
+		return false;
+	}
 	a_Value = NetworkToHostLong8(&a_Value);
 	return true;
 }
@@ -421,8 +427,10 @@ bool cByteBuffer::ReadBEUInt64(UInt64 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(8);
-	ReadBuf(&a_Value, 8);
+	if (!ReadFast(&a_Value, 8))
+	{
+		return false;
+	}
 	a_Value = NetworkToHostULong8(&a_Value);
 	return true;
 }
@@ -435,8 +443,10 @@ bool cByteBuffer::ReadBEFloat(float & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(4);
-	ReadBuf(&a_Value, 4);
+	if (!ReadFast(&a_Value, 4))
+	{
+		return false;
+	}
 	a_Value = NetworkToHostFloat4(&a_Value);
 	return true;
 }
@@ -449,8 +459,10 @@ bool cByteBuffer::ReadBEDouble(double & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(8);
-	ReadBuf(&a_Value, 8);
+	if (!ReadFast(&a_Value, 8))
+	{
+		return false;
+	}
 	a_Value = NetworkToHostDouble8(&a_Value);
 	return true;
 }
@@ -463,9 +475,11 @@ bool cByteBuffer::ReadBool(bool & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	NEEDBYTES(1);
 	UInt8 Value = 0;
-	ReadBuf(&Value, 1);
+	if (!ReadFast(&Value, 1))
+	{
+		return false;
+	}
 	a_Value = (Value != 0);
 	return true;
 }
@@ -494,6 +508,15 @@ bool cByteBuffer::ReadVarInt32(UInt32 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
+	
+	// Decode straight from the buffer, unless the VarInt may wrap around the ringbuffer end or is incomplete:
+	size_t NumBytes = DecodeVarInt32(reinterpret_cast<const Byte *>(m_Buffer + m_ReadPos), GetContiguousReadableSpace(), a_Value);
+	if (NumBytes > 0)
+	{
+		m_ReadPos += NumBytes;
+		return true;
+	}
+	
 	UInt32 Value = 0;
 	int Shift = 0;
 	unsigned char b = 0;
@@ -516,6 +539,15 @@ bool cByteBuffer::ReadVarInt64(UInt64 & a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
+	
+	// Decode straight from the buffer, unless the VarInt may wrap around the ringbuffer end or is incomplete:
+	size_t NumBytes = DecodeVarInt64(reinterpret_cast<const Byte *>(m_Buffer + m_ReadPos), GetContiguousReadableSpace(), a_Value);
+	if (NumBytes > 0)
+	{
+		m_ReadPos += NumBytes;
+		return true;
+	}
+	
 	UInt64 Value = 0;
 	int Shift = 0;
 	unsigned char b = 0;
@@ -602,8 +634,7 @@ bool cByteBuffer::WriteBEInt8(Int8 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(1);
-	return WriteBuf(&a_Value, 1);
+	return WriteFast(&a_Value, 1);
 }
 
 
@@ -614,8 +645,7 @@ bool cByteBuffer::WriteBEUInt8(UInt8 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(1);
-	return WriteBuf(&a_Value, 1);
+	return WriteFast(&a_Value, 1);
 }
 
 
@@ -626,11 +656,10 @@ bool cByteBuffer::WriteBEInt16(Int16 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(2);
 	UInt16 val;
 	memcpy(&val, &a_Value, 2);
 	val = htons(val);
-	return WriteBuf(&val, 2);
+	return WriteFast(&val, 2);
 }
 
 
@@ -641,9 +670,8 @@ bool cByteBuffer::WriteBEUInt16(UInt16 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(2);
 	a_Value = htons(a_Value);
-	return WriteBuf(&a_Value, 2);
+	return WriteFast(&a_Value, 2);
 }
 
 
@@ -654,9 +682,8 @@ bool cByteBuffer::WriteBEInt32(Int32 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(4);
 	UInt32 Converted = HostToNetwork4(&a_Value);
-	return WriteBuf(&Converted, 4);
+	return WriteFast(&Converted, 4);
 }
 
 
@@ -667,9 +694,8 @@ bool cByteBuffer::WriteBEUInt32(UInt32 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(4);
 	UInt32 Converted = HostToNetwork4(&a_Value);
-	return WriteBuf(&Converted, 4);
+	return WriteFast(&Converted, 4);
 }
 
 
@@ -680,9 +706,8 @@ bool cByteBuffer::WriteBEInt64(Int64 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(8);
 	UInt64 Converted = HostToNetwork8(&a_Value);
-	return WriteBuf(&Converted, 8);
+	return WriteFast(&Converted, 8);
 }
 
 
@@ -693,9 +718,8 @@ bool cByteBuffer::WriteBEUInt64(UInt64 a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(8);
 	UInt64 Converted = HostToNetwork8(&a_Value);
-	return WriteBuf(&Converted, 8);
+	return WriteFast(&Converted, 8);
 }
 
 
@@ -706,9 +730,8 @@ bool cByteBuffer::WriteBEFloat(float a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(4);
 	UInt32 Converted = HostToNetwork4(&a_Value);
-	return WriteBuf(&Converted, 4);
+	return WriteFast(&Converted, 4);
 }
 
 
@@ -719,9 +742,8 @@ bool cByteBuffer::WriteBEDouble(double a_Value)
 {
 	CHECK_THREAD
 	CheckValid();
-	PUTBYTES(8);
 	UInt64 Converted = HostToNetwork8(&a_Value);
-	return WriteBuf(&Converted, 8);
+	return WriteFast(&Converted, 8);
 }
 
 
@@ -734,7 +756,7 @@ bool cByteBuffer::WriteBool(bool a_Value)
 	CHECK_THREAD
 	CheckValid();
 	UInt8 val = a_Value ? 1 : 0;
-	return Write(&val, 1);
+	return WriteFast(&val, 1);
 }
 
 
@@ -746,17 +768,15 @@ bool cByteBuffer::WriteVarInt32(UInt32 a_Value)
 	CHECK_THREAD
 	CheckValid();
 	
-	// A 32-bit integer can be encoded by at most 5 bytes:
-	unsigned char b[5];
-	size_t idx = 0;
-	do
+	// Encode straight into the buffer if the longest VarInt fits without wrapping around the ringbuffer end:
+	if (GetContiguousFreeSpace() >= MAX_VARINT32_SIZE)
 	{
-		b[idx] = (a_Value & 0x7f) | ((a_Value > 0x7f) ? 0x80 : 0x00);
-		a_Value = a_Value >> 7;
-		idx++;
-	} while (a_Value > 0);
-
-	return WriteBuf(b, idx);
+		m_WritePos += EncodeVarInt32(a_Value, reinterpret_cast<Byte *>(m_Buffer + m_WritePos));
+		return true;
+	}
+	
+	Byte b[MAX_VARINT32_SIZE];
+	return WriteBuf(b, EncodeVarInt32(a_Value, b));
 }
 
 
@@ -768,17 +788,15 @@ bool cByteBuffer::WriteVarInt64(UInt64 a_Value)
 	CHECK_THREAD
 	CheckValid();
 	
-	// A 64-bit integer can be encoded by at most 10 bytes:
-	unsigned char b[10];
-	size_t idx = 0;
-	do
+	// Encode straight into the buffer if the longest VarInt fits without wrapping around the ringbuffer end:
+	if (GetContiguousFreeSpace() >= MAX_VARINT64_SIZE)
 	{
-		b[idx] = (a_Value & 0x7f) | ((a_Value > 0x7f) ? 0x80 : 0x00);
-		a_Value = a_Value >> 7;
-		idx++;
-	} while (a_Value > 0);
-
-	return WriteBuf(b, idx);
+		m_WritePos += EncodeVarInt64(a_Value, reinterpret_cast<Byte *>(m_Buffer + m_WritePos));
+		return true;
+	}
+	
+	Byte b[MAX_VARINT64_SIZE];
+	return WriteBuf(b, EncodeVarInt64(a_Value, b));
 }
 
 
@@ -874,21 +892,22 @@ bool cByteBuffer::WriteBuf(const void * a_Buffer, size_t a_Count)
 	char * Src = (char *)a_Buffer;  // So that we can do byte math
 	ASSERT(m_BufferSize >= m_ReadPos);
 	size_t BytesToEndOfBuffer = m_BufferSize - m_WritePos;
-	if (BytesToEndOfBuffer <= a_Count)
+	if (BytesToEndOfBuffer > a_Count)
 	{
-		// Reading across the ringbuffer end, read the first part and adjust parameters:
-		memcpy(m_Buffer + m_WritePos, Src, BytesToEndOfBuffer);
-		Src += BytesToEndOfBuffer;
-		a_Count -= BytesToEndOfBuffer;
-		m_WritePos = 0;
+		// The whole data fits before the ringbuffer end:
+		memcpy(m_Buffer + m_WritePos, Src, a_Count);
+		m_WritePos += a_Count;
+		return true;
 	}
 	
-	// Read the rest of the bytes in a single read (guaranteed to fit):
-	if (a_Count > 0)
+	// Writing across the ringbuffer end, write the first part at the end and the rest at the start:
+	memcpy(m_Buffer + m_WritePos, Src, BytesToEndOfBuffer);
+	size_t Rest = a_Count - BytesToEndOfBuffer;
+	if (Rest > 0)
 	{
-		memcpy(m_Buffer + m_WritePos, Src, a_Count);
-		m_WritePos += a_Count;
+		memcpy(m_Buffer, Src + BytesToEndOfBuffer, Rest);
 	}
+	m_WritePos = Rest;
 	return true;
 }
 
@@ -1069,3 +1088,74 @@ void cByteBuffer::CheckValid(void) const
 
 
 
+size_t cByteBuffer::EncodeVarInt32(UInt32 a_Value, Byte * a_Out)
+{
+	size_t idx = 0;
+	do
+	{
+		a_Out[idx] = static_cast<Byte>((a_Value & 0x7f) | ((a_Value > 0x7f) ? 0x80 : 0x00));
+		a_Value = a_Value >> 7;
+		idx++;
+	} while (a_Value > 0);
+	return idx;
+}
+
+
+
+
+
+size_t cByteBuffer::EncodeVarInt64(UInt64 a_Value, Byte * a_Out)
+{
+	size_t idx = 0;
+	do
+	{
+		a_Out[idx] = static_cast<Byte>((a_Value & 0x7f) | ((a_Value > 0x7f) ? 0x80 : 0x00));
+		a_Value = a_Value >> 7;
+		idx++;
+	} while (a_Value > 0);
+	return idx;
+}
+
+
+
+
+
+size_t cByteBuffer::DecodeVarInt32(const Byte * a_Data, size_t a_Size, UInt32 & a_Value)
+{
+	size_t MaxBytes = std::min(a_Size, static_cast<size_t>(MAX_VARINT32_SIZE));  // The cast avoids ODR-using the constant, which has no definition
+	UInt32 Value = 0;
+	for (size_t i = 0; i < MaxBytes; i++)
+	{
+		Value |= static_cast<UInt32>(a_Data[i] & 0x7f) << (7 * i);
+		if ((a_Data[i] & 0x80) == 0)
+		{
+			a_Value = Value;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+
+
+
+
+size_t cByteBuffer::DecodeVarInt64(const Byte * a_Data, size_t a_Size, UInt64 & a_Value)
+{
+	size_t MaxBytes = std::min(a_Size, static_cast<size_t>(MAX_VARINT64_SIZE));
+	UInt64 Value = 0;
+	for (size_t i = 0; i < MaxBytes; i++)
+	{
+		Value |= static_cast<UInt64>(a_Data[i] & 0x7f) << (7 * i);
+		if ((a_Data[i] & 0x80) == 0)
+		{
+			a_Value = Value;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+
+
+
@@ -27,6 +27,10 @@ their own synchronization.
 class cByteBuffer
 {
 public:
+	/** The maximum number of bytes taken by a VarInt encoding a 32-bit / 64-bit value. */
+	static const size_t MAX_VARINT32_SIZE = 5;
+	static const size_t MAX_VARINT64_SIZE = 10;
+	
 	cByteBuffer(size_t a_BufferSize);
 	~cByteBuffer();
 	
@@ -132,6 +136,20 @@ public:
 	
 	/** Checks if the internal state is valid (read and write positions in the correct bounds) using ASSERTs */
 	void CheckValid(void) const;
+	
+	/** Encodes a_Value as a VarInt into a_Out, which must have room for MAX_VARINT32_SIZE bytes. Returns the number of bytes written. */
+	static size_t EncodeVarInt32(UInt32 a_Value, Byte * a_Out);
+	
+	/** Encodes a_Value as a VarInt into a_Out, which must have room for MAX_VARINT64_SIZE bytes. Returns the number of bytes written. */
+	static size_t EncodeVarInt64(UInt64 a_Value, Byte * a_Out);
+	
+	/** Decodes a VarInt from the a_Size bytes at a_Data into a_Value. Returns the number of bytes consumed,
+	or 0 if the data doesn't start with a complete VarInt of at most MAX_VARINT32_SIZE bytes (a_Value is left unchanged then). */
+	static size_t DecodeVarInt32(const Byte * a_Data, size_t a_Size, UInt32 & a_Value);
+	
+	/** Decodes a VarInt from the a_Size bytes at a_Data into a_Value. Returns the number of bytes consumed,
+	or 0 if the data doesn't start with a complete VarInt of at most MAX_VARINT64_SIZE bytes (a_Value is left unchanged then). */
+	static size_t DecodeVarInt64(const Byte * a_Data, size_t a_Size, UInt64 & a_Value);
 
 protected:
 	char * m_Buffer;
@@ -149,6 +167,44 @@ protected:
 	
 	/** Advances the m_ReadPos by a_Count bytes */
 	void AdvanceReadPos(size_t a_Count);
+	
+	/** Returns the number of bytes that can be read at m_ReadPos without wrapping around the ringbuffer end. */
+	size_t GetContiguousReadableSpace(void) const
+	{
+		return (m_ReadPos <= m_WritePos) ? (m_WritePos - m_ReadPos) : (m_BufferSize - m_ReadPos - 1);
+	}
+	
+	/** Returns the number of bytes that can be written at m_WritePos without wrapping around the ringbuffer end. */
+	size_t GetContiguousFreeSpace(void) const
+	{
+		return (m_WritePos >= m_DataStart) ? (m_BufferSize - m_WritePos - 1) : (m_DataStart - m_WritePos - 1);
+	}
+	
+	/** Reads a_Count bytes into a_Buffer. Copies them directly in the common case when they don't wrap around the ringbuffer end,
+	uses ReadBuf() otherwise. Returns true if successful. */
+	bool ReadFast(void * a_Buffer, size_t a_Count)
+	{
+		if (a_Count <= GetContiguousReadableSpace())
+		{
+			memcpy(a_Buffer, m_Buffer + m_ReadPos, a_Count);
+			m_ReadPos += a_Count;
+			return true;
+		}
+		return ReadBuf(a_Buffer, a_Count);
+	}
+	
+	/** Writes a_Count bytes from a_Buffer. Copies them directly in the common case when they don't wrap around the ringbuffer end,
+	uses WriteBuf() otherwise. Returns true if successful. */
+	bool WriteFast(const void * a_Buffer, size_t a_Count)
+	{
+		if (a_Count <= GetContiguousFreeSpace())
+		{
+			memcpy(m_Buffer + m_WritePos, a_Buffer, a_Count);
+			m_WritePos += a_Count;
+			return true;
+		}
+		return WriteBuf(a_Buffer, a_Count);
+	}
 } ;
 
 
@@ -7,6 +7,7 @@
 
 
 #include "Chunk.h"
+#include "ChunkSnapshot.h"
 #include "World.h"
 #include "ClientHandle.h"
 #include "Server.h"
@@ -42,6 +43,49 @@
 
 #include "json/json.h"
 
+#include <atomic>
+
+
+
+
+
+/** The source of the chunk revision numbers. Shared by all chunks in all worlds,
+so that a chunk reloaded from disk never reuses the revision of its previous instance. */
+static std::atomic<UInt32> g_NextChunkRevision(1);
+
+/** Size of the cells of the chunks' entity index, in blocks. */
+static const int ENTITY_INDEX_CELL_SIZE = 4;
+
+/** The largest entity half-width and height for which the entity index is queried by the entity position cell.
+Entities that are larger (dragons, ghasts, big slimes, ...) are all put into ENTITY_INDEX_LARGE_CELL, which is always queried. */
+static const double ENTITY_INDEX_MAX_HALF_WIDTH = 1;
+static const double ENTITY_INDEX_MAX_HEIGHT = 3;
+
+/** The entity index cell for the large entities. Cannot collide with the regular cells, those use only the lower 63 bits. */
+static const Int64 ENTITY_INDEX_LARGE_CELL = std::numeric_limits<Int64>::min();
+
+/** The interval between two checks of the entities' tracking ranges in each chunk, in ticks. */
+static const int ENTITY_TRACKING_INTERVAL = 10;
+
+/** The distance beyond the tracking range that an entity has to move before it is destroyed on a client,
+so that the entities moving along the edge of the range aren't spawned and destroyed repeatedly. */
+static const int ENTITY_TRACKING_HYSTERESIS = 4;
+
+
+
+
+
+/** Returns the entity index key of the specified cell coords. The coords wrap around beyond +- 2^20 cells,
+which only makes the far away cells share their keys, the queries check the entity bounding boxes anyway. */
+static inline Int64 PackEntityIndexCell(int a_CellX, int a_CellY, int a_CellZ)
+{
+	return static_cast<Int64>(
+		((static_cast<UInt64>(a_CellX) & 0x1fffff) << 42) |
+		((static_cast<UInt64>(a_CellZ) & 0x1fffff) << 21) |
+		(static_cast<UInt64>(a_CellY) & 0x1fffff)
+	);
+}
+
 
 
 
@@ -78,7 +122,12 @@ cChunk::cChunk(
 	m_IsDirty(false),
 	m_IsSaving(false),
 	m_HasLoadFailed(false),
+	m_DirtySince(-1),
+	m_Revision(NextRevision()),
+	m_BlockEntitiesRevision(NextRevision()),
+	m_NumPendingMovements(0),
 	m_StayCount(0),
+	m_UnloadCandidateID(0),
 	m_PosX(a_ChunkX),
 	m_PosZ(a_ChunkZ),
 	m_World(a_World),
@@ -95,7 +144,8 @@ cChunk::cChunk(
 	m_LavaSimulatorData (a_World->GetLavaSimulator ()->CreateChunkData()),
 	m_RedstoneSimulatorData(a_World->GetRedstoneSimulator()->CreateChunkData()),
 	m_IsRedstoneDirty(false),
-	m_AlwaysTicked(0)
+	m_AlwaysTicked(0),
+	m_TickCost(a_ChunkX, a_ChunkZ)
 {
 	if (a_NeighborXM != nullptr)
 	{
@@ -130,12 +180,19 @@ cChunk::~cChunk()
 		delete *itr;
 	}
 	m_BlockEntities.clear();
+	m_BlockEntityIndex.clear();
 
 	// Remove and destroy all entities that are not players:
-	cEntityList Entities;
+	cChunkEntityList Entities;
 	std::swap(Entities, m_Entities);  // Need another list because cEntity destructors check if they've been removed from chunk
-	for (cEntityList::const_iterator itr = Entities.begin(); itr != Entities.end(); ++itr)
+	m_EntityIndex.clear();
+	for (cChunkEntityList::const_iterator itr = Entities.begin(); itr != Entities.end(); ++itr)
 	{
+		if ((*itr)->m_IndexChunk == this)
+		{
+			(*itr)->m_IndexChunk = nullptr;
+		}
+		RemoveFromEntityChunks(**itr);
 		if (!(*itr)->IsPlayer())
 		{
 			(*itr)->Destroy(false);
@@ -171,6 +228,15 @@ cChunk::~cChunk()
 
 
 
+UInt32 cChunk::NextRevision(void)
+{
+	return g_NextChunkRevision++;
+}
+
+
+
+
+
 void cChunk::SetPresence(cChunk::ePresence a_Presence)
 {
 	m_Presence = a_Presence;
@@ -210,10 +276,20 @@ void cChunk::MarkRegenerating(void)
 
 
 bool cChunk::CanUnload(void)
+{
+	return
+		!m_IsDirty &&            // The chunk has been saved properly or hasn't been touched since the load / gen
+		CanUnloadAfterSave();
+}
+
+
+
+
+
+bool cChunk::CanUnloadAfterSave(void) const
 {
 	return
 		m_LoadedByClient.empty() &&  // The chunk is not used by any client
-		!m_IsDirty &&                // The chunk has been saved properly or hasn't been touched since the load / gen
 		(m_StayCount == 0) &&        // The chunk is not in a ChunkStay
 		(m_Presence != cpQueued) ;   // The chunk is not queued for loading / generating (otherwise multi-load / multi-gen could occur)
 }
@@ -222,6 +298,20 @@ bool cChunk::CanUnload(void)
 
 
 
+void cChunk::AddMemoryStats(cChunkMap::sMemoryStats & a_Stats) const
+{
+	a_Stats.m_NumChunks += 1;
+	m_ChunkData.AddMemoryStats(a_Stats.m_NumFlatSections, a_Stats.m_NumPaletteSections, a_Stats.m_ChunkDataHeapBytes);
+	a_Stats.m_NumEntities += m_Entities.size();
+	a_Stats.m_NumBlockEntities += m_BlockEntities.size();
+	cChunkMap::sMemoryStats::AddHeavyChunk(a_Stats.m_MostEntities, m_PosX, m_PosZ, m_Entities.size());
+	cChunkMap::sMemoryStats::AddHeavyChunk(a_Stats.m_MostBlockEntities, m_PosX, m_PosZ, m_BlockEntities.size());
+}
+
+
+
+
+
 void cChunk::MarkSaving(void)
 {
 	m_IsSaving = true;
@@ -238,6 +328,7 @@ void cChunk::MarkSaved(void)
 		return;
 	}
 	m_IsDirty = false;
+	m_DirtySince = -1;
 }
 
 
@@ -247,6 +338,7 @@ void cChunk::MarkSaved(void)
 void cChunk::MarkLoaded(void)
 {
 	m_IsDirty = false;
+	m_DirtySince = -1;
 	SetPresence(cpPresent);
 }
 
@@ -277,6 +369,7 @@ void cChunk::GetAllData(cChunkDataCallback & a_Callback)
 {
 	ASSERT(m_Presence == cpPresent);
 
+	a_Callback.Revision(m_Revision);
 	a_Callback.HeightMap(&m_HeightMap);
 	a_Callback.BiomeData(&m_BiomeMap);
 
@@ -284,7 +377,7 @@ void cChunk::GetAllData(cChunkDataCallback & a_Callback)
 
 	a_Callback.ChunkData(m_ChunkData);
 	
-	for (cEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
+	for (cChunkEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
 	{
 		a_Callback.Entity(*itr);
 	}
@@ -308,18 +401,9 @@ void cChunk::SetAllData(cSetChunkData & a_SetChunkData)
 	memcpy(m_BiomeMap, a_SetChunkData.GetBiomes(), sizeof(m_BiomeMap));
 	memcpy(m_HeightMap, a_SetChunkData.GetHeightMap(), sizeof(m_HeightMap));
 
-	m_ChunkData.SetBlockTypes(a_SetChunkData.GetBlockTypes());
-	m_ChunkData.SetMetas(a_SetChunkData.GetBlockMetas());
-	if (a_SetChunkData.IsLightValid())
-	{
-		m_ChunkData.SetBlockLight(a_SetChunkData.GetBlockLight());
-		m_ChunkData.SetSkyLight(a_SetChunkData.GetSkyLight());
-		m_IsLightValid = true;
-	}
-	else
-	{
-		m_IsLightValid = false;
-	}
+	// Take over the data prepared by the loader / generator, without copying:
+	m_ChunkData = std::move(a_SetChunkData.GetChunkData());
+	m_IsLightValid = a_SetChunkData.IsLightValid();
 
 	// Clear the block entities present - either the loader / saver has better, or we'll create empty ones:
 	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
@@ -328,6 +412,12 @@ void cChunk::SetAllData(cSetChunkData & a_SetChunkData)
 	}
 	m_BlockEntities.clear();
 	std::swap(a_SetChunkData.GetBlockEntities(), m_BlockEntities);
+	m_BlockEntitiesRevision = NextRevision();
+	m_BlockEntityIndex.clear();
+	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
+	{
+		m_BlockEntityIndex[GetBlockEntityIndexKey(**itr)] = *itr;
+	}
 
 	// Check that all block entities have a valid blocktype at their respective coords (DEBUG-mode only):
 	#ifdef _DEBUG
@@ -354,7 +444,18 @@ void cChunk::SetAllData(cSetChunkData & a_SetChunkData)
 	// Wake up all simulators for their respective blocks:
 	WakeUpSimulators();
 
+	// The block entities in the neighbors may have gone to sleep because this chunk wasn't available (hoppers outputting into it):
+	cChunk * Neighbors[] = { m_NeighborXM, m_NeighborXP, m_NeighborZM, m_NeighborZP };
+	for (size_t i = 0; i < ARRAYCOUNT(Neighbors); i++)
+	{
+		if ((Neighbors[i] != nullptr) && Neighbors[i]->IsValid())
+		{
+			Neighbors[i]->WakeUpAllBlockEntities();
+		}
+	}
+
 	m_HasLoadFailed = false;
+	m_Revision = NextRevision();
 }
 
 
@@ -374,6 +475,7 @@ void cChunk::SetLight(
 	m_ChunkData.SetSkyLight(a_SkyLight);
 
 	m_IsLightValid = true;
+	m_Revision = NextRevision();
 }
 
 
@@ -391,7 +493,9 @@ void cChunk::GetBlockTypes(BLOCKTYPE * a_BlockTypes)
 
 void cChunk::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes)
 {
-	if ((a_DataTypes & (cBlockArea::baTypes | cBlockArea::baMetas)) != (cBlockArea::baTypes | cBlockArea::baMetas))
+	// Types and metas can be written only together; lights can be written with or without them:
+	bool ShouldWriteBlocks = ((a_DataTypes & (cBlockArea::baTypes | cBlockArea::baMetas)) != 0);
+	if (ShouldWriteBlocks && ((a_DataTypes & (cBlockArea::baTypes | cBlockArea::baMetas)) != (cBlockArea::baTypes | cBlockArea::baMetas)))
 	{
 		LOGWARNING("cChunk::WriteBlockArea(): unsupported datatype request, can write only types + metas (0x%x), requested 0x%x. Ignoring.",
 			(cBlockArea::baTypes | cBlockArea::baMetas), a_DataTypes & (cBlockArea::baTypes | cBlockArea::baMetas)
@@ -413,26 +517,76 @@ void cChunk::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlock
 	int BaseZ = BlockStartZ - a_MinBlockZ;
 	int SizeY = a_Area.GetSizeY();
 
-	// TODO: Improve this by not calling FastSetBlock() and doing the processing here
-	// so that the heightmap is touched only once for each column.
-	BLOCKTYPE *  AreaBlockTypes = a_Area.GetBlockTypes();
-	NIBBLETYPE * AreaBlockMetas = a_Area.GetBlockMetas();
-	for (int y = 0; y < SizeY; y++)
+	if (ShouldWriteBlocks)
+	{
+		// TODO: Improve this by doing the processing here so that the heightmap is touched only once for each column.
+		// The light change of all the blocks is collected and queued once, after the whole area has been written:
+		sLightChange LightChange;
+		BLOCKTYPE *  AreaBlockTypes = a_Area.GetBlockTypes();
+		NIBBLETYPE * AreaBlockMetas = a_Area.GetBlockMetas();
+		for (int y = 0; y < SizeY; y++)
+		{
+			int ChunkY = a_MinBlockY + y;
+			int AreaY = y;
+			for (int z = 0; z < SizeZ; z++)
+			{
+				int ChunkZ = OffZ + z;
+				int AreaZ = BaseZ + z;
+				for (int x = 0; x < SizeX; x++)
+				{
+					int ChunkX = OffX + x;
+					int AreaX = BaseX + x;
+					int idx = a_Area.MakeIndex(AreaX, AreaY, AreaZ);
+					BLOCKTYPE BlockType = AreaBlockTypes[idx];
+					NIBBLETYPE BlockMeta = AreaBlockMetas[idx];
+					SetBlockData(ChunkX, ChunkY, ChunkZ, BlockType, BlockMeta, true, LightChange);
+				}  // for x
+			}  // for z
+		}  // for y
+		QueueLightChange(LightChange);
+	}
+
+	// Write the lights, if requested. The whole chunk's light is taken out, patched and put back, so that the uniform sections get re-detected:
+	if ((a_DataTypes & cBlockArea::baLight) != 0)
+	{
+		cChunkDef::BlockNibbles BlockLight;
+		m_ChunkData.CopyBlockLight(BlockLight);
+		WriteAreaLight(a_Area.GetBlockLight(), a_Area, BlockLight, a_MinBlockY, SizeX, SizeY, SizeZ, OffX, OffZ, BaseX, BaseZ);
+		m_ChunkData.SetBlockLight(BlockLight);
+		MarkDirty();
+	}
+	if ((a_DataTypes & cBlockArea::baSkyLight) != 0)
+	{
+		cChunkDef::BlockNibbles SkyLight;
+		m_ChunkData.CopySkyLight(SkyLight);
+		WriteAreaLight(a_Area.GetBlockSkyLight(), a_Area, SkyLight, a_MinBlockY, SizeX, SizeY, SizeZ, OffX, OffZ, BaseX, BaseZ);
+		m_ChunkData.SetSkyLight(SkyLight);
+		MarkDirty();
+	}
+}
+
+
+
+
+
+void cChunk::WriteAreaLight(
+	const NIBBLETYPE * a_AreaLight, const cBlockArea & a_Area, cChunkDef::BlockNibbles & a_ChunkLight,
+	int a_MinBlockY, int a_SizeX, int a_SizeY, int a_SizeZ, int a_OffX, int a_OffZ, int a_BaseX, int a_BaseZ
+)
+{
+	for (int y = 0; y < a_SizeY; y++)
 	{
 		int ChunkY = a_MinBlockY + y;
-		int AreaY = y;
-		for (int z = 0; z < SizeZ; z++)
+		for (int z = 0; z < a_SizeZ; z++)
 		{
-			int ChunkZ = OffZ + z;
-			int AreaZ = BaseZ + z;
-			for (int x = 0; x < SizeX; x++)
+			int ChunkZ = a_OffZ + z;
+			int AreaZ = a_BaseZ + z;
+			for (int x = 0; x < a_SizeX; x++)
 			{
-				int ChunkX = OffX + x;
-				int AreaX = BaseX + x;
-				int idx = a_Area.MakeIndex(AreaX, AreaY, AreaZ);
-				BLOCKTYPE BlockType = AreaBlockTypes[idx];
-				NIBBLETYPE BlockMeta = AreaBlockMetas[idx];
-				FastSetBlock(ChunkX, ChunkY, ChunkZ, BlockType, BlockMeta);
+				int ChunkIdx = MakeIndexNoCheck(a_OffX + x, ChunkY, ChunkZ);
+				int Shift = (ChunkIdx & 1) * 4;
+				NIBBLETYPE & Byte = a_ChunkLight[ChunkIdx / 2];
+				Byte = static_cast<NIBBLETYPE>((Byte & ~(0x0f << Shift)) | ((a_AreaLight[a_Area.MakeIndex(a_BaseX + x, y, AreaZ)] & 0x0f) << Shift));
 			}  // for x
 		}  // for z
 	}  // for y
@@ -445,18 +599,7 @@ void cChunk::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlock
 /// Returns true if there is a block entity at the coords specified
 bool cChunk::HasBlockEntityAt(int a_BlockX, int a_BlockY, int a_BlockZ)
 {
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
-	{
-		if (
-			((*itr)->GetPosX() == a_BlockX) &&
-			((*itr)->GetPosY() == a_BlockY) &&
-			((*itr)->GetPosZ() == a_BlockZ)
-		)
-		{
-			return true;
-		}
-	}  // for itr - m_BlockEntities[]
-	return false;
+	return (GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ) != nullptr);
 }
 
 
@@ -467,6 +610,12 @@ void cChunk::Stay(bool a_Stay)
 {
 	m_StayCount += (a_Stay ? 1 : -1);
 	ASSERT(m_StayCount >= 0);
+
+	// If this was the last reason to keep the chunk, consider it for unloading:
+	if (!a_Stay && CanUnloadAfterSave())
+	{
+		m_ChunkMap->AddUnloadCandidate(*this);
+	}
 }
 
 
@@ -475,26 +624,25 @@ void cChunk::Stay(bool a_Stay)
 void cChunk::CollectMobCensus(cMobCensus & toFill)
 {
 	toFill.CollectSpawnableChunk(*this);
-	std::list<const Vector3d *> playerPositions;
-	cPlayer * currentPlayer;
-	for (auto itr = m_LoadedByClient.begin(), end = m_LoadedByClient.end(); itr != end; ++itr)
+	if (m_LoadedByClient.empty())
 	{
-		currentPlayer = (*itr)->GetPlayer();
-		playerPositions.push_back(&(currentPlayer->GetPosition()));
+		return;
 	}
 
-	Vector3d currentPosition;
+	// Each mob is collected once, with its (squared) distance to the closest player:
+	cPlayerProximityIndex & Players = m_World->GetPlayerProximityIndex();
 	for (auto itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
 	{
 		// LOGD("Counting entity #%i (%s)", (*itr)->GetUniqueID(), (*itr)->GetClass());
 		if ((*itr)->IsMob())
 		{
 			auto & Monster = reinterpret_cast<cMonster &>(**itr);
-			currentPosition = Monster.GetPosition();
-			for (auto itr2 = playerPositions.cbegin(); itr2 != playerPositions.cend(); ++itr2)
+			double ClosestDistance = std::numeric_limits<double>::max();
+			if (Players.FindClosest(Monster.GetPosition(), std::numeric_limits<double>::max(), &ClosestDistance) != nullptr)
 			{
-				toFill.CollectMob(Monster, *this, (currentPosition - **itr2).SqrLength());
+				ClosestDistance *= ClosestDistance;
 			}
+			toFill.CollectMob(Monster, *this, ClosestDistance);
 		}
 	}  // for itr - m_Entitites[]
 }
@@ -608,57 +756,103 @@ void cChunk::Tick(std::chrono::milliseconds a_Dt)
 	// Set all blocks that have been queued for setting later:
 	ProcessQueuedSetBlocks();
 
+	// When profiling, each part's time is measured from the end of the previous one:
+	bool ShouldProfile = m_World->IsChunkTickProfilingEnabled();
+	std::chrono::steady_clock::time_point PartStart;
+	if (ShouldProfile)
+	{
+		PartStart = std::chrono::steady_clock::now();
+	}
+
 	CheckBlocks();
+	if (ShouldProfile)
+	{
+		PartStart = AddTickCost(cChunkMap::sChunkTickCost::catBlockTicks, PartStart);
+	}
 	
 	// Tick simulators:
 	m_World->GetSimulatorManager()->SimulateChunk(a_Dt, m_PosX, m_PosZ, this);
+	if (ShouldProfile)
+	{
+		PartStart = AddTickCost(cChunkMap::sChunkTickCost::catSimulators, PartStart);
+	}
 	
 	TickBlocks();
+	if (ShouldProfile)
+	{
+		PartStart = AddTickCost(cChunkMap::sChunkTickCost::catBlockTicks, PartStart);
+	}
 
-	// Tick all block entities in this chunk:
+	// Tick all block entities in this chunk, except for the sleeping ones:
 	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
 	{
-		m_IsDirty = (*itr)->Tick(a_Dt, *this) | m_IsDirty;
+		if (!(*itr)->IsSleeping() && (*itr)->Tick(a_Dt, *this))
+		{
+			// Keep the save in progress (if any) from marking the chunk as saved, same as MarkDirty() does:
+			m_IsDirty = true;
+			m_IsSaving = false;
+		}
+	}
+	if (ShouldProfile)
+	{
+		PartStart = AddTickCost(cChunkMap::sChunkTickCost::catBlockEntities, PartStart);
 	}
 	
-	for (cEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end();)
+	// Walked by index, the ticks may add entities to the vector; a removed entity is replaced by the last one, which is then processed in its place:
+	for (size_t i = 0; i < m_Entities.size();)
 	{
-		if (!((*itr)->IsMob()))  // Mobs are ticked inside cWorld::TickMobs() (as we don't have to tick them if they are far away from players)
+		cEntity * Entity = m_Entities[i];
+		if (!(Entity->IsMob()))  // Mobs are ticked inside cWorld::TickMobs() (as we don't have to tick them if they are far away from players)
 		{
 			// Tick all entities in this chunk (except mobs):
-			(*itr)->Tick(a_Dt, *this);
+			cTickProfiler::cTimer Timer(m_World->GetTickProfiler(), cTickProfiler::catEntity, Entity->GetClass());
+			Entity->Tick(a_Dt, *this);
 		}
 
-		if ((*itr)->IsDestroyed())  // Remove all entities that were scheduled for removal:
+		if (Entity->IsDestroyed())  // Remove all entities that were scheduled for removal:
 		{
-			LOGD("Destroying entity #%i (%s)", (*itr)->GetUniqueID(), (*itr)->GetClass());
+			LOGD("Destroying entity #%i (%s)", Entity->GetUniqueID(), Entity->GetClass());
 			MarkDirty();
-			cEntity * ToDelete = *itr;
-			itr = m_Entities.erase(itr);
-			delete ToDelete;
+			RemoveFromEntityIndex(Entity);
+			EraseEntityAt(i);
+			delete Entity;
 		}
-		else if ((*itr)->IsWorldTravellingFrom(m_World))
+		else if (Entity->IsWorldTravellingFrom(m_World))
 		{
 			// Remove all entities that are travelling to another world
+			SendPendingEntityUpdates();
 			MarkDirty();
-			(*itr)->SetWorldTravellingFrom(nullptr);
-			itr = m_Entities.erase(itr);
+			Entity->SetWorldTravellingFrom(nullptr);
+			RemoveFromEntityIndex(Entity);
+			EraseEntityAt(i);
 		}
 		else if (
-			((*itr)->GetChunkX() != m_PosX) ||
-			((*itr)->GetChunkZ() != m_PosZ)
+			(Entity->GetChunkX() != m_PosX) ||
+			(Entity->GetChunkZ() != m_PosZ)
 		)
 		{
-			// The entity moved out of the chunk, move it to the neighbor
+			// The entity moved out of the chunk, move it to the neighbor; its queued updates can only be verified here
+			SendPendingEntityUpdates();
 			MarkDirty();
-			MoveEntityToNewChunk(*itr);
-			itr = m_Entities.erase(itr);
+			RemoveFromEntityIndex(Entity);
+			MoveEntityToNewChunk(Entity);
+			EraseEntityAt(i);
 		}
 		else
 		{
-			++itr;
+			++i;
 		}
-	}  // for itr - m_Entitites[]
+	}  // for i - m_Entitites[]
+	if (ShouldProfile)
+	{
+		AddTickCost(cChunkMap::sChunkTickCost::catEntities, PartStart);
+	}
+
+	// Spawn and destroy the entities that have crossed their tracking range, staggered across the chunks:
+	if ((m_World->GetWorldAge() + m_PosX + m_PosZ) % ENTITY_TRACKING_INTERVAL == 0)
+	{
+		UpdateEntityTracking();
+	}
 	
 	ApplyWeatherToTop();
 }
@@ -667,6 +861,26 @@ void cChunk::Tick(std::chrono::milliseconds a_Dt)
 
 
 
+void cChunk::ResetTickCost(void)
+{
+	m_TickCost = cChunkMap::sChunkTickCost(m_PosX, m_PosZ);
+}
+
+
+
+
+
+std::chrono::steady_clock::time_point cChunk::AddTickCost(cChunkMap::sChunkTickCost::eCategory a_Category, std::chrono::steady_clock::time_point a_Start)
+{
+	auto Now = std::chrono::steady_clock::now();
+	m_TickCost.m_Time[a_Category] += Now - a_Start;
+	return Now;
+}
+
+
+
+
+
 void cChunk::TickBlock(int a_RelX, int a_RelY, int a_RelZ)
 {
 	cBlockHandler * Handler = BlockHandler(GetBlock(a_RelX, a_RelY, a_RelZ));
@@ -703,21 +917,26 @@ void cChunk::MoveEntityToNewChunk(cEntity * a_Entity)
 	{
 		virtual void Removed(cClientHandle * a_Client) override
 		{
-			a_Client->SendDestroyEntity(*m_Entity);
+			m_Chunk.DestroyEntityOnClient(*m_Entity, *a_Client);
 		}
 
 		virtual void Added(cClientHandle * a_Client) override
 		{
-			m_Entity->SpawnOn(*a_Client);
+			if (m_Chunk.IsInTrackingRange(*m_Entity, *a_Client, 0))
+			{
+				m_Chunk.SpawnEntityOnClient(*m_Entity, *a_Client);
+			}
 		}
 
+		cChunk & m_Chunk;
 		cEntity * m_Entity;
 
 	public:
-		cMover(cEntity * a_Entity) :
+		cMover(cChunk & a_Chunk, cEntity * a_Entity) :
+			m_Chunk(a_Chunk),
 			m_Entity(a_Entity)
 		{}
-	} Mover(a_Entity);
+	} Mover(*this, a_Entity);
 	
 	m_ChunkMap->CompareChunkClients(this, Neighbor, Mover);
 }
@@ -729,41 +948,32 @@ void cChunk::MoveEntityToNewChunk(cEntity * a_Entity)
 void cChunk::ProcessQueuedSetBlocks(void)
 {
 	Int64 CurrTick = m_World->GetWorldAge();
-	for (sSetBlockQueueVector::iterator itr = m_SetBlockQueue.begin(); itr != m_SetBlockQueue.end();)
+
+	// The queue is sorted by the target tick, only the due items at its front need to be processed:
+	while (!m_SetBlockQueue.empty() && (m_SetBlockQueue.begin()->first <= CurrTick))
 	{
-		if (itr->m_Tick <= CurrTick)
+		// Current world age is bigger than / equal to target world age - delay time reached
+		sSetBlockQueueItem Item = m_SetBlockQueue.begin()->second;
+		m_SetBlockQueue.erase(m_SetBlockQueue.begin());
+		if (Item.m_PreviousType != E_BLOCK_AIR)  // PreviousType defaults to 0 if not specified
 		{
-			if (itr->m_PreviousType != E_BLOCK_AIR)  // PreviousType defaults to 0 if not specified
+			if (GetBlock(Item.m_RelX, Item.m_RelY, Item.m_RelZ) == Item.m_PreviousType)
 			{
-				if (GetBlock(itr->m_RelX, itr->m_RelY, itr->m_RelZ) == itr->m_PreviousType)
-				{
-					// Current world age is bigger than / equal to target world age - delay time reached AND
-					// Previous block type was the same as current block type (to prevent duplication)
-					SetBlock(itr->m_RelX, itr->m_RelY, itr->m_RelZ, itr->m_BlockType, itr->m_BlockMeta);  // SetMeta doesn't send to client
-					itr = m_SetBlockQueue.erase(itr);
-					LOGD("Successfully set queued block - previous and current types matched");
-				}
-				else
-				{
-					itr = m_SetBlockQueue.erase(itr);
-					LOGD("Failure setting queued block - previous and current blocktypes didn't match");
-				}
+				// Previous block type was the same as current block type (to prevent duplication)
+				SetBlock(Item.m_RelX, Item.m_RelY, Item.m_RelZ, Item.m_BlockType, Item.m_BlockMeta);  // SetMeta doesn't send to client
+				LOGD("Successfully set queued block - previous and current types matched");
 			}
 			else
 			{
-				// Current world age is bigger than / equal to target world age - delay time reached
-				SetBlock(itr->m_RelX, itr->m_RelY, itr->m_RelZ, itr->m_BlockType, itr->m_BlockMeta);
-				itr = m_SetBlockQueue.erase(itr);
-				LOGD("Successfully set queued block - previous type ignored");
+				LOGD("Failure setting queued block - previous and current blocktypes didn't match");
 			}
 		}
 		else
 		{
-			// Not yet
-			++itr;
-			continue;
+			SetBlock(Item.m_RelX, Item.m_RelY, Item.m_RelZ, Item.m_BlockType, Item.m_BlockMeta);
+			LOGD("Successfully set queued block - previous type ignored");
 		}
-	}  // for itr - m_SetBlockQueue[]
+	}  // while (due items in m_SetBlockQueue)
 }
 
 
@@ -776,8 +986,22 @@ void cChunk::BroadcastPendingBlockChanges(void)
 	{
 		return;
 	}
+	if (m_LoadedByClient.empty())
+	{
+		m_PendingSendBlocks.clear();
+		return;
+	}
+
+	CoalescePendingBlockChanges();
 
-	if (m_PendingSendBlocks.size() >= 10240)
+	// Resend the full chunk if it is cheaper than the block changes. A block change costs about 5 bytes in the Multi Block Change
+	// packet, a full chunk costs about 3 bytes per block (type, meta and light) in each section up to the top block, before
+	// compression. The compression usually shrinks the chunk data to about a quarter, the block changes much less so:
+	static const size_t BlockChangeBytes = 5;
+	static const size_t ChunkSectionBytes = cChunkData::SectionBlockCount * 3 / 4;
+	HEIGHTTYPE MaxHeight = *std::max_element(m_HeightMap, m_HeightMap + ARRAYCOUNT(m_HeightMap));
+	size_t NumSentSections = static_cast<size_t>(MaxHeight) / cChunkData::SectionHeight + 1;
+	if (m_PendingSendBlocks.size() * BlockChangeBytes > NumSentSections * ChunkSectionBytes)
 	{
 		// Resend the full chunk
 		for (cClientHandleList::iterator itr = m_LoadedByClient.begin(), end = m_LoadedByClient.end(); itr != end; ++itr)
@@ -785,6 +1009,15 @@ void cChunk::BroadcastPendingBlockChanges(void)
 			m_World->ForceSendChunkTo(m_PosX, m_PosZ, cChunkSender::E_CHUNK_PRIORITY_MEDIUM, (*itr));
 		}
 	}
+	else if (m_PendingSendBlocks.size() == 1)
+	{
+		// A single block change has its own, smaller packet:
+		const sSetBlock & Change = m_PendingSendBlocks.front();
+		for (cClientHandleList::iterator itr = m_LoadedByClient.begin(), end = m_LoadedByClient.end(); itr != end; ++itr)
+		{
+			(*itr)->SendBlockChange(Change.GetX(), Change.GetY(), Change.GetZ(), Change.m_BlockType, Change.m_BlockMeta);
+		}
+	}
 	else
 	{
 		// Only send block changes
@@ -800,6 +1033,35 @@ void cChunk::BroadcastPendingBlockChanges(void)
 
 
 
+void cChunk::CoalescePendingBlockChanges(void)
+{
+	if (m_PendingSendBlocks.size() < 2)
+	{
+		return;
+	}
+
+	// Keep only the last change of each block; it has the block's current value.
+	// Reverse first, so that the stable sort keeps the last change of each block in front of the earlier ones:
+	std::reverse(m_PendingSendBlocks.begin(), m_PendingSendBlocks.end());
+	std::stable_sort(m_PendingSendBlocks.begin(), m_PendingSendBlocks.end(),
+		[](const sSetBlock & a_First, const sSetBlock & a_Second)
+		{
+			return (MakeIndexNoCheck(a_First.m_RelX, a_First.m_RelY, a_First.m_RelZ) < MakeIndexNoCheck(a_Second.m_RelX, a_Second.m_RelY, a_Second.m_RelZ));
+		}
+	);
+	auto NewEnd = std::unique(m_PendingSendBlocks.begin(), m_PendingSendBlocks.end(),
+		[](const sSetBlock & a_First, const sSetBlock & a_Second)
+		{
+			return ((a_First.m_RelX == a_Second.m_RelX) && (a_First.m_RelY == a_Second.m_RelY) && (a_First.m_RelZ == a_Second.m_RelZ));
+		}
+	);
+	m_PendingSendBlocks.erase(NewEnd, m_PendingSendBlocks.end());
+}
+
+
+
+
+
 void cChunk::CheckBlocks()
 {
 	if (m_ToTickBlocks.empty())
@@ -827,6 +1089,12 @@ void cChunk::CheckBlocks()
 
 void cChunk::TickBlocks(void)
 {
+	if (m_ChunkData.GetBlockCount(bcRandomTicked) == 0)
+	{
+		// There's nothing in the chunk that would react to a random tick
+		return;
+	}
+
 	// Tick dem blocks
 	// _X: We must limit the random number or else we get a nasty int overflow bug - http://forum.mc-server.org/showthread.php?tid=457
 	int RandomX = m_World->GetTickRandomNumber(0x00ffffff);
@@ -841,7 +1109,7 @@ void cChunk::TickBlocks(void)
 
 	// This for loop looks disgusting, but it actually does a simple thing - first processes m_BlockTick, then adds random to it
 	// This is so that SetNextBlockTick() works
-	for (int i = 0; i < 50; i++,
+	for (int i = 0, NumTicks = m_World->GetRandomTicksPerChunk(); i < NumTicks; i++,
 	
 		// This weird construct (*2, then /2) is needed,
 		// otherwise the blocktick distribution is too biased towards even coords!
@@ -859,6 +1127,10 @@ void cChunk::TickBlocks(void)
 		{
 			continue;  // It's all air up here
 		}
+		if (m_ChunkData.GetSectionBlockCount(static_cast<size_t>(m_BlockTickY) / cChunkData::SectionHeight, bcRandomTicked) == 0)
+		{
+			continue;  // Nothing in this section reacts to a random tick
+		}
 
 		cBlockHandler * Handler = BlockHandler(GetBlock(m_BlockTickX, m_BlockTickY, m_BlockTickZ));
 		ASSERT(Handler != nullptr);  // Happenned on server restart, FS #243
@@ -1328,46 +1600,39 @@ int cChunk::GetHeight(int a_X, int a_Z)
 
 void cChunk::CreateBlockEntities(void)
 {
-	for (int x = 0; x < Width; x++)
+	// Only the sections that have any block entity blocks need to be walked:
+	for (size_t Section = 0; Section < cChunkData::NumSections; Section++)
 	{
-		for (int z = 0; z < Width; z++)
+		if (m_ChunkData.GetSectionBlockCount(Section, bcBlockEntity) == 0)
+		{
+			continue;
+		}
+		int MinY = static_cast<int>(Section * cChunkData::SectionHeight);
+		int MaxY = MinY + static_cast<int>(cChunkData::SectionHeight);
+		for (int y = MinY; y < MaxY; y++)
 		{
-			for (int y = 0; y < Height; y++)
+			for (int z = 0; z < Width; z++)
 			{
-				BLOCKTYPE BlockType = GetBlock(x, y, z);
-				switch (BlockType)
+				for (int x = 0; x < Width; x++)
 				{
-					case E_BLOCK_BEACON:
-					case E_BLOCK_TRAPPED_CHEST:
-					case E_BLOCK_CHEST:
-					case E_BLOCK_COMMAND_BLOCK:
-					case E_BLOCK_DISPENSER:
-					case E_BLOCK_DROPPER:
-					case E_BLOCK_ENDER_CHEST:
-					case E_BLOCK_LIT_FURNACE:
-					case E_BLOCK_FURNACE:
-					case E_BLOCK_HOPPER:
-					case E_BLOCK_SIGN_POST:
-					case E_BLOCK_WALLSIGN:
-					case E_BLOCK_HEAD:
-					case E_BLOCK_NOTE_BLOCK:
-					case E_BLOCK_JUKEBOX:
-					case E_BLOCK_FLOWER_POT:
-					case E_BLOCK_MOB_SPAWNER:
+					BLOCKTYPE BlockType = GetBlock(x, y, z);
+					if (!cBlockEntity::IsBlockEntityBlockType(BlockType))
 					{
-						if (!HasBlockEntityAt(x + m_PosX * Width, y, z + m_PosZ * Width))
-						{
-							m_BlockEntities.push_back(cBlockEntity::CreateByBlockType(
-								BlockType, GetMeta(x, y, z),
-								x + m_PosX * Width, y, z + m_PosZ * Width, m_World
-							));
-						}
-						break;
+						continue;
 					}
-				}  // switch (BlockType)
-			}  // for y
-		}  // for z
-	}  // for x
+					if (!HasBlockEntityAt(x + m_PosX * Width, y, z + m_PosZ * Width))
+					{
+						cBlockEntity * BlockEntity = cBlockEntity::CreateByBlockType(
+							BlockType, GetMeta(x, y, z),
+							x + m_PosX * Width, y, z + m_PosZ * Width, m_World
+						);
+						m_BlockEntities.push_back(BlockEntity);
+						m_BlockEntityIndex[GetBlockEntityIndexKey(*BlockEntity)] = BlockEntity;
+					}
+				}  // for x
+			}  // for z
+		}  // for y
+	}  // for Section
 }
 
 
@@ -1454,7 +1719,55 @@ void cChunk::SetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType,
 	// Tick this block and its neighbors:
 	m_ToTickBlocks.push_back(Vector3i(a_RelX, a_RelY, a_RelZ));
 	QueueTickBlockNeighbors(a_RelX, a_RelY, a_RelZ);
+	WakeUpBlockEntitiesAround(a_RelX, a_RelY, a_RelZ);
+	ReplaceBlockEntity(a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta);
+}
+
+
+
+
+
+void cChunk::SetBlocks(sSetBlockVector::const_iterator a_Begin, sSetBlockVector::const_iterator a_End, bool a_ShouldSkipPhysics)
+{
+	ASSERT(IsValid());
+
+	// Write all the blocks first, so that the neighbor ticks and the block entities see the final state of the area:
+	sLightChange LightChange;
+	for (sSetBlockVector::const_iterator itr = a_Begin; itr != a_End; ++itr)
+	{
+		ASSERT((itr->m_ChunkX == m_PosX) && (itr->m_ChunkZ == m_PosZ));
+		if ((itr->m_RelY < 0) || (itr->m_RelY >= Height))
+		{
+			continue;
+		}
+		SetBlockData(itr->m_RelX, itr->m_RelY, itr->m_RelZ, itr->m_BlockType, itr->m_BlockMeta, true, LightChange);
+	}
+
+	for (sSetBlockVector::const_iterator itr = a_Begin; itr != a_End; ++itr)
+	{
+		if ((itr->m_RelY < 0) || (itr->m_RelY >= Height))
+		{
+			continue;
+		}
+		if (!a_ShouldSkipPhysics)
+		{
+			m_ToTickBlocks.push_back(Vector3i(itr->m_RelX, itr->m_RelY, itr->m_RelZ));
+			QueueTickBlockNeighbors(itr->m_RelX, itr->m_RelY, itr->m_RelZ);
+			WakeUpBlockEntitiesAround(itr->m_RelX, itr->m_RelY, itr->m_RelZ);
+		}
+		ReplaceBlockEntity(itr->m_RelX, itr->m_RelY, itr->m_RelZ, itr->m_BlockType, itr->m_BlockMeta);
+	}
+
+	// Relight the whole changed area at once:
+	QueueLightChange(LightChange);
+}
 
+
+
+
+
+void cChunk::ReplaceBlockEntity(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
 	// If there was a block entity, remove it:
 	Vector3i WorldPos = PositionToWorldPosition(a_RelX, a_RelY, a_RelZ);
 	cBlockEntity * BlockEntity = GetBlockEntity(WorldPos);
@@ -1467,30 +1780,10 @@ void cChunk::SetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType,
 	}
 	
 	// If the new block is a block entity, create the entity object:
-	switch (a_BlockType)
+	if (cBlockEntity::IsBlockEntityBlockType(a_BlockType))
 	{
-		case E_BLOCK_BEACON:
-		case E_BLOCK_TRAPPED_CHEST:
-		case E_BLOCK_CHEST:
-		case E_BLOCK_COMMAND_BLOCK:
-		case E_BLOCK_DISPENSER:
-		case E_BLOCK_DROPPER:
-		case E_BLOCK_ENDER_CHEST:
-		case E_BLOCK_LIT_FURNACE:
-		case E_BLOCK_FURNACE:
-		case E_BLOCK_HOPPER:
-		case E_BLOCK_SIGN_POST:
-		case E_BLOCK_WALLSIGN:
-		case E_BLOCK_HEAD:
-		case E_BLOCK_NOTE_BLOCK:
-		case E_BLOCK_JUKEBOX:
-		case E_BLOCK_FLOWER_POT:
-		case E_BLOCK_MOB_SPAWNER:
-		{
-			AddBlockEntity(cBlockEntity::CreateByBlockType(a_BlockType, a_BlockMeta, WorldPos.x, WorldPos.y, WorldPos.z, m_World));
-			break;
-		}
-	}  // switch (a_BlockType)
+		AddBlockEntity(cBlockEntity::CreateByBlockType(a_BlockType, a_BlockMeta, WorldPos.x, WorldPos.y, WorldPos.z, m_World));
+	}
 }
 
 
@@ -1499,7 +1792,7 @@ void cChunk::SetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType,
 
 void cChunk::QueueSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, Int64 a_Tick, BLOCKTYPE a_PreviousBlockType)
 {
-	m_SetBlockQueue.push_back(sSetBlockQueueItem(a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta, a_Tick, a_PreviousBlockType));
+	m_SetBlockQueue.insert(std::make_pair(a_Tick, sSetBlockQueueItem(a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta, a_PreviousBlockType)));
 }
 
 
@@ -1551,58 +1844,152 @@ void cChunk::QueueTickBlockNeighbors(int a_RelX, int a_RelY, int a_RelZ)
 
 
 
-void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, BLOCKTYPE a_BlockMeta, bool a_SendToClients)
+void cChunk::WakeUpBlockEntity(int a_RelX, int a_RelY, int a_RelZ)
 {
-	ASSERT(!((a_RelX < 0) || (a_RelX >= Width) || (a_RelY < 0) || (a_RelY >= Height) || (a_RelZ < 0) || (a_RelZ >= Width)));
-
-	ASSERT(IsValid());
-	
-	const BLOCKTYPE OldBlockType = GetBlock(a_RelX, a_RelY, a_RelZ);
-	const BLOCKTYPE OldBlockMeta = m_ChunkData.GetMeta(a_RelX, a_RelY, a_RelZ);
-	if ((OldBlockType == a_BlockType) && (OldBlockMeta == a_BlockMeta))
+	// Only look up the block entities that can sleep, the lookup isn't free:
+	switch (GetBlock(a_RelX, a_RelY, a_RelZ))
 	{
-		return;
+		case E_BLOCK_HOPPER:
+		case E_BLOCK_FURNACE:
+		case E_BLOCK_LIT_FURNACE:
+		{
+			cBlockEntity * BlockEntity = GetBlockEntity(PositionToWorldPosition(a_RelX, a_RelY, a_RelZ));
+			if (BlockEntity != nullptr)
+			{
+				BlockEntity->WakeUp();
+			}
+			break;
+		}
 	}
+}
 
-	MarkDirty();
-	m_IsRedstoneDirty = true;
 
-	m_ChunkData.SetBlock(a_RelX, a_RelY, a_RelZ, a_BlockType);
 
-	// Queue block to be sent only if ...
-	if (
-		a_SendToClients &&                  // ... we are told to do so AND ...
-		(
-			!(                                // ... the old and new blocktypes AREN'T leaves (because the client doesn't need meta updates)
-				((OldBlockType == E_BLOCK_LEAVES) && (a_BlockType == E_BLOCK_LEAVES)) ||
-				((OldBlockType == E_BLOCK_NEW_LEAVES) && (a_BlockType == E_BLOCK_NEW_LEAVES))
-			) &&                              // ... AND ...
-			(
-				(OldBlockMeta != a_BlockMeta) ||  // ... the meta value is different OR ...
-				!(                                // ... the old and new blocktypes AREN'T liquids (because client doesn't need to distinguish betwixt them):
-					((OldBlockType == E_BLOCK_STATIONARY_WATER) && (a_BlockType == E_BLOCK_WATER)) ||             // Replacing stationary water with water
-					((OldBlockType == E_BLOCK_WATER)            && (a_BlockType == E_BLOCK_STATIONARY_WATER)) ||  // Replacing water with stationary water
-					((OldBlockType == E_BLOCK_STATIONARY_LAVA)  && (a_BlockType == E_BLOCK_LAVA)) ||              // Replacing stationary water with water
-					((OldBlockType == E_BLOCK_LAVA)             && (a_BlockType == E_BLOCK_STATIONARY_LAVA))      // Replacing water with stationary water
-				)
-			)
-		)
-	)
+
+
+void cChunk::WakeUpAllBlockEntities(void)
+{
+	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), end = m_BlockEntities.end(); itr != end; ++itr)
 	{
-		m_PendingSendBlocks.push_back(sSetBlock(m_PosX, m_PosZ, a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta));
+		(*itr)->WakeUp();
 	}
-	
+}
+
+
+
+
+
+void cChunk::WakeUpBlockEntitiesAround(int a_RelX, int a_RelY, int a_RelZ)
+{
+	static const Vector3i Coords[] =
+	{
+		Vector3i( 1,  0,  0),
+		Vector3i(-1,  0,  0),
+		Vector3i( 0,  1,  0),
+		Vector3i( 0, -1,  0),
+		Vector3i( 0,  0,  1),
+		Vector3i( 0,  0, -1),
+	} ;
+	for (size_t i = 0; i < ARRAYCOUNT(Coords); i++)
+	{
+		int RelX = a_RelX + Coords[i].x;
+		int RelY = a_RelY + Coords[i].y;
+		int RelZ = a_RelZ + Coords[i].z;
+		if ((RelY < 0) || (RelY >= cChunkDef::Height))
+		{
+			continue;
+		}
+		cChunk * Chunk = GetRelNeighborChunkAdjustCoords(RelX, RelZ);
+		if ((Chunk != nullptr) && Chunk->IsValid())
+		{
+			Chunk->WakeUpBlockEntity(RelX, RelY, RelZ);
+		}
+	}  // for i - Coords[]
+}
+
+
+
+
+
+void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, BLOCKTYPE a_BlockMeta, bool a_SendToClients)
+{
+	sLightChange LightChange;
+	SetBlockData(a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta, a_SendToClients, LightChange);
+	QueueLightChange(LightChange);
+}
+
+
+
+
+
+void cChunk::FastSetBlocks(const sSetBlockList & a_Blocks)
+{
+	sLightChange LightChange;
+	for (sSetBlockList::const_iterator itr = a_Blocks.begin(), end = a_Blocks.end(); itr != end; ++itr)
+	{
+		ASSERT((itr->m_ChunkX == m_PosX) && (itr->m_ChunkZ == m_PosZ));
+		SetBlockData(itr->m_RelX, itr->m_RelY, itr->m_RelZ, itr->m_BlockType, itr->m_BlockMeta, true, LightChange);
+	}
+	QueueLightChange(LightChange);
+}
+
+
+
+
+
+void cChunk::SetBlockData(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, bool a_SendToClients, sLightChange & a_LightChange)
+{
+	ASSERT(!((a_RelX < 0) || (a_RelX >= Width) || (a_RelY < 0) || (a_RelY >= Height) || (a_RelZ < 0) || (a_RelZ >= Width)));
+
+	ASSERT(IsValid());
+	
+	const BLOCKTYPE OldBlockType = GetBlock(a_RelX, a_RelY, a_RelZ);
+	const BLOCKTYPE OldBlockMeta = m_ChunkData.GetMeta(a_RelX, a_RelY, a_RelZ);
+	if ((OldBlockType == a_BlockType) && (OldBlockMeta == a_BlockMeta))
+	{
+		return;
+	}
+
+	MarkDirty();
+	m_IsRedstoneDirty = true;
+
+	m_ChunkData.SetBlock(a_RelX, a_RelY, a_RelZ, a_BlockType);
+
+	// Queue block to be sent only if ...
+	if (
+		a_SendToClients &&                  // ... we are told to do so AND ...
+		(
+			!(                                // ... the old and new blocktypes AREN'T leaves (because the client doesn't need meta updates)
+				((OldBlockType == E_BLOCK_LEAVES) && (a_BlockType == E_BLOCK_LEAVES)) ||
+				((OldBlockType == E_BLOCK_NEW_LEAVES) && (a_BlockType == E_BLOCK_NEW_LEAVES))
+			) &&                              // ... AND ...
+			(
+				(OldBlockMeta != a_BlockMeta) ||  // ... the meta value is different OR ...
+				!(                                // ... the old and new blocktypes AREN'T liquids (because client doesn't need to distinguish betwixt them):
+					((OldBlockType == E_BLOCK_STATIONARY_WATER) && (a_BlockType == E_BLOCK_WATER)) ||             // Replacing stationary water with water
+					((OldBlockType == E_BLOCK_WATER)            && (a_BlockType == E_BLOCK_STATIONARY_WATER)) ||  // Replacing water with stationary water
+					((OldBlockType == E_BLOCK_STATIONARY_LAVA)  && (a_BlockType == E_BLOCK_LAVA)) ||              // Replacing stationary water with water
+					((OldBlockType == E_BLOCK_LAVA)             && (a_BlockType == E_BLOCK_STATIONARY_LAVA))      // Replacing water with stationary water
+				)
+			)
+		)
+	)
+	{
+		m_PendingSendBlocks.push_back(sSetBlock(m_PosX, m_PosZ, a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta));
+	}
+	
 	m_ChunkData.SetMeta(a_RelX, a_RelY, a_RelZ, a_BlockMeta);
 
 	// ONLY recalculate lighting if it's necessary!
-	if (
+	bool ShouldUpdateBlockLight = (
 		(cBlockInfo::GetLightValue        (OldBlockType) != cBlockInfo::GetLightValue        (a_BlockType)) ||
+		(cBlockInfo::GetSpreadLightFalloff(OldBlockType) != cBlockInfo::GetSpreadLightFalloff(a_BlockType))
+	);
+	bool ShouldUpdateSkyLight = (
 		(cBlockInfo::GetSpreadLightFalloff(OldBlockType) != cBlockInfo::GetSpreadLightFalloff(a_BlockType)) ||
 		(cBlockInfo::IsTransparent        (OldBlockType) != cBlockInfo::IsTransparent        (a_BlockType))
-	)
-	{
-		m_IsLightValid = false;
-	}
+	);
+	HEIGHTTYPE OldHeight = m_HeightMap[a_RelX + a_RelZ * Width];
 
 	// Update heightmap, if needed:
 	if (a_RelY >= m_HeightMap[a_RelX + a_RelZ * Width])
@@ -1623,6 +2010,44 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 			}  // for y - column in m_BlockData
 		}
 	}
+
+	// Collect the lighting change around the block; if the chunk isn't lit yet, it will be lit as a whole later on:
+	HEIGHTTYPE NewHeight = m_HeightMap[a_RelX + a_RelZ * Width];
+	ShouldUpdateSkyLight = ShouldUpdateSkyLight || (OldHeight != NewHeight);  // Skylight sources are the blocks above the heightmap
+	if (ShouldUpdateBlockLight || ShouldUpdateSkyLight)
+	{
+		a_LightChange.Add(
+			a_RelX + m_PosX * Width, a_RelZ + m_PosZ * Width,
+			std::min(a_RelY, static_cast<int>(std::min(OldHeight, NewHeight))),
+			ShouldUpdateBlockLight, ShouldUpdateSkyLight
+		);
+	}
+}
+
+
+
+
+
+void cChunk::QueueLightChange(const sLightChange & a_LightChange)
+{
+	// Update the lighting incrementally; if the chunk isn't lit yet, it will be lit as a whole later on:
+	if (!m_IsLightValid || a_LightChange.IsEmpty())
+	{
+		return;
+	}
+
+	// If the change spans most of the chunk, relighting the whole chunk is cheaper than the incremental update:
+	int NumColumns = (a_LightChange.m_MaxX - a_LightChange.m_MinX + 1) * (a_LightChange.m_MaxZ - a_LightChange.m_MinZ + 1);
+	if (NumColumns >= MAX_LIGHT_CHANGE_COLUMNS)
+	{
+		m_IsLightValid = false;
+		m_World->QueueLightChunk(m_PosX, m_PosZ);
+		return;
+	}
+	m_World->GetLightingThread().QueueAreaChange(
+		a_LightChange.m_MinX, a_LightChange.m_MaxX, a_LightChange.m_MinZ, a_LightChange.m_MaxZ, a_LightChange.m_MinY,
+		a_LightChange.m_ShouldUpdateBlockLight, a_LightChange.m_ShouldUpdateSkyLight
+	);
 }
 
 
@@ -1643,13 +2068,11 @@ void cChunk::SendBlockTo(int a_RelX, int a_RelY, int a_RelZ, cClientHandle * a_C
 	a_Client->SendBlockChange(wp.x, wp.y, wp.z, GetBlock(a_RelX, a_RelY, a_RelZ), GetMeta(a_RelX, a_RelY, a_RelZ));
 	
 	// FS #268 - if a BlockEntity digging is cancelled by a plugin, the entire block entity must be re-sent to the client:
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), end = m_BlockEntities.end(); itr != end; ++itr)
+	cBlockEntity * BlockEntity = GetBlockEntity(wp.x, wp.y, wp.z);
+	if (BlockEntity != nullptr)
 	{
-		if (((*itr)->GetPosX() == wp.x) && ((*itr)->GetPosY() == wp.y) && ((*itr)->GetPosZ() == wp.z))
-		{
-			(*itr)->SendTo(*a_Client);
-		}
-	}  // for itr - m_BlockEntities
+		BlockEntity->SendTo(*a_Client);
+	}
 }
 
 
@@ -1660,6 +2083,17 @@ void cChunk::AddBlockEntity(cBlockEntity * a_BlockEntity)
 {
 	MarkDirty();
 	m_BlockEntities.push_back(a_BlockEntity);
+	m_BlockEntityIndex[GetBlockEntityIndexKey(*a_BlockEntity)] = a_BlockEntity;
+	m_BlockEntitiesRevision = NextRevision();
+}
+
+
+
+
+
+int cChunk::GetBlockEntityIndexKey(const cBlockEntity & a_BlockEntity)
+{
+	return MakeIndexNoCheck(a_BlockEntity.GetRelX(), a_BlockEntity.GetPosY(), a_BlockEntity.GetRelZ());
 }
 
 
@@ -1674,19 +2108,21 @@ cBlockEntity * cChunk::GetBlockEntity(int a_BlockX, int a_BlockY, int a_BlockZ)
 	ASSERT(a_BlockZ >= m_PosZ * cChunkDef::Width);
 	ASSERT(a_BlockZ < m_PosZ * cChunkDef::Width + cChunkDef::Width);
 
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
+	if ((a_BlockY < 0) || (a_BlockY >= Height))
 	{
-		if (
-			((*itr)->GetPosX() == a_BlockX) &&
-			((*itr)->GetPosY() == a_BlockY) &&
-			((*itr)->GetPosZ() == a_BlockZ)
-		)
-		{
-			return *itr;
-		}
-	}  // for itr - m_BlockEntities[]
-	
-	return nullptr;
+		return nullptr;
+	}
+	auto itr = m_BlockEntityIndex.find(MakeIndexNoCheck(a_BlockX - m_PosX * Width, a_BlockY, a_BlockZ - m_PosZ * Width));
+	return (itr == m_BlockEntityIndex.end()) ? nullptr : itr->second;
+}
+
+
+
+
+
+cChunkSnapshot * cChunk::CreateSnapshot(void) const
+{
+	return new cChunkSnapshot(m_PosX, m_PosZ, m_Revision, m_ChunkData.Copy(), m_HeightMap, m_BiomeMap);
 }
 
 
@@ -1695,7 +2131,30 @@ cBlockEntity * cChunk::GetBlockEntity(int a_BlockX, int a_BlockY, int a_BlockZ)
 
 bool cChunk::ShouldBeTicked(void) const
 {
-	return (HasAnyClients() || (m_AlwaysTicked > 0));
+	if (m_AlwaysTicked > 0)
+	{
+		return true;
+	}
+	int SimulationDistance = m_World->GetSimulationDistance();
+	if (SimulationDistance <= 0)
+	{
+		return HasAnyClients();
+	}
+
+	// Only tick the chunk if a player that has it loaded is close enough to it:
+	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
+	{
+		const cPlayer * Player = (*itr)->GetPlayer();
+		if (
+			(Player != nullptr) &&
+			(Diff(Player->GetChunkX(), m_PosX) <= SimulationDistance) &&
+			(Diff(Player->GetChunkZ(), m_PosZ) <= SimulationDistance)
+		)
+		{
+			return true;
+		}
+	}
+	return false;
 }
 
 
@@ -1769,7 +2228,7 @@ void cChunk::CollectPickupsByPlayer(cPlayer & a_Player)
 	double PosY = a_Player.GetPosY();
 	double PosZ = a_Player.GetPosZ();
 	
-	for (cEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
+	for (cChunkEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
 	{
 		if ((!(*itr)->IsPickup()) && (!(*itr)->IsProjectile()))
 		{
@@ -1814,25 +2273,21 @@ void cChunk::CollectPickupsByPlayer(cPlayer & a_Player)
 bool cChunk::SetSignLines(int a_PosX, int a_PosY, int a_PosZ, const AString & a_Line1, const AString & a_Line2, const AString & a_Line3, const AString & a_Line4)
 {
 	// Also sends update packets to all clients in the chunk
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
-	{
-		if (
-			((*itr)->GetPosX() == a_PosX) &&
-			((*itr)->GetPosY() == a_PosY) &&
-			((*itr)->GetPosZ() == a_PosZ) &&
-			(
-				((*itr)->GetBlockType() == E_BLOCK_WALLSIGN) ||
-				((*itr)->GetBlockType() == E_BLOCK_SIGN_POST)
-			)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_PosX, a_PosY, a_PosZ);
+	if (
+		(BlockEntity == nullptr) ||
+		(
+			(BlockEntity->GetBlockType() != E_BLOCK_WALLSIGN) &&
+			(BlockEntity->GetBlockType() != E_BLOCK_SIGN_POST)
 		)
-		{
-			MarkDirty();
-			reinterpret_cast<cSignEntity *>(*itr)->SetLines(a_Line1, a_Line2, a_Line3, a_Line4);
-			m_World->BroadcastBlockEntity(a_PosX, a_PosY, a_PosZ);
-			return true;
-		}
-	}  // for itr - m_BlockEntities[]
-	return false;
+	)
+	{
+		return false;
+	}
+	MarkDirty();
+	reinterpret_cast<cSignEntity *>(BlockEntity)->SetLines(a_Line1, a_Line2, a_Line3, a_Line4);
+	m_World->BroadcastBlockEntity(a_PosX, a_PosY, a_PosZ);
+	return true;
 }
 
 
@@ -1843,6 +2298,12 @@ void cChunk::RemoveBlockEntity(cBlockEntity * a_BlockEntity)
 {
 	MarkDirty();
 	m_BlockEntities.remove(a_BlockEntity);
+	auto itr = m_BlockEntityIndex.find(GetBlockEntityIndexKey(*a_BlockEntity));
+	if ((itr != m_BlockEntityIndex.end()) && (itr->second == a_BlockEntity))
+	{
+		m_BlockEntityIndex.erase(itr);
+	}
+	m_BlockEntitiesRevision = NextRevision();
 }
 
 
@@ -1859,9 +2320,12 @@ bool cChunk::AddClient(cClientHandle * a_Client)
 			return false;
 		}
 	}
+	
+	// The queued movements predate the spawn packets the new client is about to receive, don't let it get them:
+	SendPendingEntityMovements();
 	m_LoadedByClient.push_back( a_Client);
 
-	for (cEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
+	for (cChunkEntityList::iterator itr = m_Entities.begin(); itr != m_Entities.end(); ++itr)
 	{
 		/*
 		// DEBUG:
@@ -1871,7 +2335,10 @@ bool cChunk::AddClient(cClientHandle * a_Client)
 			a_Client->GetUsername().c_str()
 		);
 		*/
-		(*itr)->SpawnOn(*a_Client);
+		if (IsInTrackingRange(**itr, *a_Client, 0))
+		{
+			SpawnEntityOnClient(**itr, *a_Client);
+		}
 	}
 	return true;
 }
@@ -1889,11 +2356,18 @@ void cChunk::RemoveClient(cClientHandle * a_Client)
 			continue;
 		}
 
+		SendPendingEntityMovements();
 		m_LoadedByClient.erase(itrC);
 
+		// If this was the last client, consider the chunk for unloading:
+		if (CanUnloadAfterSave())
+		{
+			m_ChunkMap->AddUnloadCandidate(*this);
+		}
+
 		if (!a_Client->IsDestroyed())
 		{
-			for (cEntityList::iterator itrE = m_Entities.begin(); itrE != m_Entities.end(); ++itrE)
+			for (cChunkEntityList::iterator itrE = m_Entities.begin(); itrE != m_Entities.end(); ++itrE)
 			{
 				/*
 				// DEBUG:
@@ -1902,7 +2376,7 @@ void cChunk::RemoveClient(cClientHandle * a_Client)
 					(*itr)->GetUniqueID(), a_Client->GetUsername().c_str()
 				);
 				*/
-				a_Client->SendDestroyEntity(*(*itrE));
+				DestroyEntityOnClient(**itrE, *a_Client);
 			}
 		}
 		return;
@@ -1948,6 +2422,16 @@ void cChunk::AddEntity(cEntity * a_Entity)
 	ASSERT(std::find(m_Entities.begin(), m_Entities.end(), a_Entity) == m_Entities.end());  // Not there already
 
 	m_Entities.push_back(a_Entity);
+	AddToEntityIndex(a_Entity);
+}
+
+
+
+
+
+void cChunk::EraseEntityAt(size_t a_Idx)
+{
+	m_Entities.EraseAt(a_Idx);
 }
 
 
@@ -1956,7 +2440,13 @@ void cChunk::AddEntity(cEntity * a_Entity)
 
 void cChunk::RemoveEntity(cEntity * a_Entity)
 {
-	m_Entities.remove(a_Entity);
+	SendPendingEntityUpdates();
+	cChunkEntityList::iterator itr = std::find(m_Entities.begin(), m_Entities.end(), a_Entity);
+	if (itr != m_Entities.end())
+	{
+		EraseEntityAt(static_cast<size_t>(itr - m_Entities.begin()));
+	}
+	RemoveFromEntityIndex(a_Entity);
 
 	// Mark as dirty if it was a server-generated entity:
 	if (!a_Entity->IsPlayer())
@@ -1969,115 +2459,280 @@ void cChunk::RemoveEntity(cEntity * a_Entity)
 
 
 
-bool cChunk::HasEntity(UInt32 a_EntityID)
+void cChunk::UpdateEntityIndex(cEntity & a_Entity)
 {
-	for (cEntityList::const_iterator itr = m_Entities.begin(), end = m_Entities.end(); itr != end; ++itr)
+	// Most of the moves stay within the same cell, check that without locking:
+	Int64 Cell = GetEntityIndexCell(a_Entity);
+	if (Cell == a_Entity.m_IndexCell)
 	{
-		if ((*itr)->GetUniqueID() == a_EntityID)
-		{
-			return true;
-		}
-	}  // for itr - m_Entities[]
-	return false;
+		return;
+	}
+
+	cCSLock Lock(m_ChunkMap->GetCS());
+	if (a_Entity.m_IndexChunk != this)
+	{
+		// The entity has been removed from this chunk in the meantime
+		return;
+	}
+	RemoveFromEntityIndexCell(&a_Entity, a_Entity.m_IndexCell);
+	m_EntityIndex[Cell].push_back(&a_Entity);
+	a_Entity.m_IndexCell = Cell;
 }
 
 
 
 
 
-bool cChunk::ForEachEntity(cEntityCallback & a_Callback)
+Int64 cChunk::GetEntityIndexCell(const cEntity & a_Entity)
 {
-	// The entity list is locked by the parent chunkmap's CS
-	for (cEntityList::iterator itr = m_Entities.begin(), itr2 = itr; itr != m_Entities.end(); itr = itr2)
+	if ((a_Entity.GetWidth() / 2 > ENTITY_INDEX_MAX_HALF_WIDTH) || (a_Entity.GetHeight() > ENTITY_INDEX_MAX_HEIGHT))
 	{
-		++itr2;
-		if (a_Callback.Item(*itr))
-		{
-			return false;
-		}
-	}  // for itr - m_Entitites[]
-	return true;
+		return ENTITY_INDEX_LARGE_CELL;
+	}
+	const Vector3d & Pos = a_Entity.GetPosition();
+	return PackEntityIndexCell(
+		FloorC(Pos.x / ENTITY_INDEX_CELL_SIZE),
+		FloorC(Pos.y / ENTITY_INDEX_CELL_SIZE),
+		FloorC(Pos.z / ENTITY_INDEX_CELL_SIZE)
+	);
 }
 
 
 
 
 
-bool cChunk::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback & a_Callback)
+void cChunk::AddToEntityIndex(cEntity * a_Entity)
 {
-	// The entity list is locked by the parent chunkmap's CS
-	for (cEntityList::iterator itr = m_Entities.begin(), itr2 = itr; itr != m_Entities.end(); itr = itr2)
-	{
-		++itr2;
-		cBoundingBox EntBox((*itr)->GetPosition(), (*itr)->GetWidth() / 2, (*itr)->GetHeight());
-		if (!EntBox.DoesIntersect(a_Box))
-		{
-			// The entity is not in the specified box
-			continue;
-		}
-		if (a_Callback.Item(*itr))
-		{
-			return false;
-		}
-	}  // for itr - m_Entitites[]
-	return true;
+	// If the entity is still indexed in another chunk (a world travel picked up by the new world before the old one's tick),
+	// the old chunk will find it by searching its whole index
+	Int64 Cell = GetEntityIndexCell(*a_Entity);
+	m_EntityIndex[Cell].push_back(a_Entity);
+	a_Entity->m_IndexChunk = this;
+	a_Entity->m_IndexCell = Cell;
+	m_ChunkMap->m_EntityChunks[a_Entity->GetUniqueID()] = this;
 }
 
 
 
 
 
-bool cChunk::DoWithEntityByID(UInt32 a_EntityID, cEntityCallback & a_Callback, bool & a_CallbackResult)
+void cChunk::RemoveFromEntityIndex(cEntity * a_Entity)
 {
-	// The entity list is locked by the parent chunkmap's CS
-	for (cEntityList::iterator itr = m_Entities.begin(), end = m_Entities.end(); itr != end; ++itr)
+	RemoveFromEntityChunks(*a_Entity);
+	if (a_Entity->m_IndexChunk == this)
 	{
-		if ((*itr)->GetUniqueID() == a_EntityID)
+		a_Entity->m_IndexChunk = nullptr;
+		RemoveFromEntityIndexCell(a_Entity, a_Entity->m_IndexCell);
+		return;
+	}
+
+	// The entity has been indexed by another chunk since it was added here, search the whole index:
+	for (auto itr = m_EntityIndex.begin(), end = m_EntityIndex.end(); itr != end; ++itr)
+	{
+		if (RemoveFromEntityIndexCell(a_Entity, itr->first))
 		{
-			a_CallbackResult = a_Callback.Item(*itr);
-			return true;
+			return;
 		}
-	}  // for itr - m_Entitites[]
-	return false;
+	}
 }
 
 
 
 
 
-bool cChunk::ForEachBlockEntity(cBlockEntityCallback & a_Callback)
+void cChunk::RemoveFromEntityChunks(const cEntity & a_Entity)
 {
-	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	// If the entity has already been added to another chunk of this world, the ID maps to that chunk and must stay:
+	auto & EntityChunks = m_ChunkMap->m_EntityChunks;
+	auto itr = EntityChunks.find(a_Entity.GetUniqueID());
+	if ((itr != EntityChunks.end()) && (itr->second == this))
 	{
-		++itr2;
-		if (a_Callback.Item(*itr))
-		{
-			return false;
-		}
-	}  // for itr - m_BlockEntitites[]
-	return true;
+		EntityChunks.erase(itr);
+	}
 }
 
 
 
 
 
-bool cChunk::ForEachChest(cChestCallback & a_Callback)
+bool cChunk::RemoveFromEntityIndexCell(cEntity * a_Entity, Int64 a_Cell)
 {
-	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	auto itrCell = m_EntityIndex.find(a_Cell);
+	if (itrCell == m_EntityIndex.end())
 	{
-		++itr2;
-		if ((*itr)->GetBlockType() != E_BLOCK_CHEST)
-		{
-			continue;
-		}
-		if (a_Callback.Item((cChestEntity *)*itr))
-		{
-			return false;
-		}
-	}  // for itr - m_BlockEntitites[]
+		return false;
+	}
+	auto & Entities = itrCell->second;
+	auto itr = std::find(Entities.begin(), Entities.end(), a_Entity);
+	if (itr == Entities.end())
+	{
+		return false;
+	}
+	*itr = Entities.back();
+	Entities.pop_back();
+	if (Entities.empty())
+	{
+		m_EntityIndex.erase(itrCell);
+	}
+	return true;
+}
+
+
+
+
+
+bool cChunk::HasEntity(UInt32 a_EntityID)
+{
+	for (cChunkEntityList::const_iterator itr = m_Entities.begin(), end = m_Entities.end(); itr != end; ++itr)
+	{
+		if ((*itr)->GetUniqueID() == a_EntityID)
+		{
+			return true;
+		}
+	}  // for itr - m_Entities[]
+	return false;
+}
+
+
+
+
+
+bool cChunk::ForEachEntity(cEntityCallback & a_Callback)
+{
+	// The entity list is locked by the parent chunkmap's CS
+	// The callback may add and remove any entities, the entities removed before their turn are skipped:
+	return m_Entities.ForEach([&a_Callback](cEntity * a_Entity)
+		{
+			return a_Callback.Item(a_Entity);
+		}
+	);
+}
+
+
+
+
+
+bool cChunk::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback & a_Callback)
+{
+	// The entity index is locked by the parent chunkmap's CS
+	if (m_EntityIndex.empty())
+	{
+		return true;
+	}
+
+	// The cells where the entities that may intersect the box are listed, based on the largest regular entity size:
+	double MinCellX = floor((a_Box.GetMinX() - ENTITY_INDEX_MAX_HALF_WIDTH) / ENTITY_INDEX_CELL_SIZE);
+	double MinCellY = floor((a_Box.GetMinY() - ENTITY_INDEX_MAX_HEIGHT)     / ENTITY_INDEX_CELL_SIZE);
+	double MinCellZ = floor((a_Box.GetMinZ() - ENTITY_INDEX_MAX_HALF_WIDTH) / ENTITY_INDEX_CELL_SIZE);
+	double MaxCellX = floor((a_Box.GetMaxX() + ENTITY_INDEX_MAX_HALF_WIDTH) / ENTITY_INDEX_CELL_SIZE);
+	double MaxCellY = floor(a_Box.GetMaxY()                                 / ENTITY_INDEX_CELL_SIZE);
+	double MaxCellZ = floor((a_Box.GetMaxZ() + ENTITY_INDEX_MAX_HALF_WIDTH) / ENTITY_INDEX_CELL_SIZE);
+	double NumCells = (MaxCellX - MinCellX + 1) * (MaxCellY - MinCellY + 1) * (MaxCellZ - MinCellZ + 1);
+
+	// Collect the candidates first, the callbacks may move the entities between the cells:
+	std::vector<cEntity *> Candidates;
+	if (NumCells + 1 > static_cast<double>(m_EntityIndex.size()))
+	{
+		// The box spans more cells than there are nonempty ones, use all of them:
+		for (auto itr = m_EntityIndex.cbegin(), end = m_EntityIndex.cend(); itr != end; ++itr)
+		{
+			Candidates.insert(Candidates.end(), itr->second.begin(), itr->second.end());
+		}
+	}
+	else
+	{
+		auto itrLarge = m_EntityIndex.find(ENTITY_INDEX_LARGE_CELL);
+		if (itrLarge != m_EntityIndex.end())
+		{
+			Candidates.insert(Candidates.end(), itrLarge->second.begin(), itrLarge->second.end());
+		}
+		for (int y = static_cast<int>(MinCellY); y <= static_cast<int>(MaxCellY); y++)
+		{
+			for (int z = static_cast<int>(MinCellZ); z <= static_cast<int>(MaxCellZ); z++)
+			{
+				for (int x = static_cast<int>(MinCellX); x <= static_cast<int>(MaxCellX); x++)
+				{
+					auto itrCell = m_EntityIndex.find(PackEntityIndexCell(x, y, z));
+					if (itrCell != m_EntityIndex.end())
+					{
+						Candidates.insert(Candidates.end(), itrCell->second.begin(), itrCell->second.end());
+					}
+				}  // for x
+			}  // for z
+		}  // for y
+	}
+
+	for (auto Entity : Candidates)
+	{
+		cBoundingBox EntBox(Entity->GetPosition(), Entity->GetWidth() / 2, Entity->GetHeight());
+		if (!EntBox.DoesIntersect(a_Box))
+		{
+			// The entity is not in the specified box
+			continue;
+		}
+		if (a_Callback.Item(Entity))
+		{
+			return false;
+		}
+	}  // for Entity - Candidates[]
+	return true;
+}
+
+
+
+
+
+bool cChunk::DoWithEntityByID(UInt32 a_EntityID, cEntityCallback & a_Callback, bool & a_CallbackResult)
+{
+	// The entity list is locked by the parent chunkmap's CS
+	for (cChunkEntityList::iterator itr = m_Entities.begin(), end = m_Entities.end(); itr != end; ++itr)
+	{
+		if ((*itr)->GetUniqueID() == a_EntityID)
+		{
+			a_CallbackResult = a_Callback.Item(*itr);
+			return true;
+		}
+	}  // for itr - m_Entitites[]
+	return false;
+}
+
+
+
+
+
+bool cChunk::ForEachBlockEntity(cBlockEntityCallback & a_Callback)
+{
+	// The blockentity list is locked by the parent chunkmap's CS
+	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	{
+		++itr2;
+		if (a_Callback.Item(*itr))
+		{
+			return false;
+		}
+	}  // for itr - m_BlockEntitites[]
+	return true;
+}
+
+
+
+
+
+bool cChunk::ForEachChest(cChestCallback & a_Callback)
+{
+	// The blockentity list is locked by the parent chunkmap's CS
+	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	{
+		++itr2;
+		if ((*itr)->GetBlockType() != E_BLOCK_CHEST)
+		{
+			continue;
+		}
+		if (a_Callback.Item((cChestEntity *)*itr))
+		{
+			return false;
+		}
+	}  // for itr - m_BlockEntitites[]
 	return true;
 }
 
@@ -2184,23 +2839,18 @@ bool cChunk::ForEachFurnace(cFurnaceCallback & a_Callback)
 bool cChunk::DoWithBlockEntityAt(int a_BlockX, int a_BlockY, int a_BlockZ, cBlockEntityCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		
-		if (a_Callback.Item(*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	if (a_Callback.Item(BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2210,37 +2860,32 @@ bool cChunk::DoWithBlockEntityAt(int a_BlockX, int a_BlockY, int a_BlockZ, cBloc
 bool cChunk::DoWithRedstonePoweredEntityAt(int a_BlockX, int a_BlockY, int a_BlockZ, cRedstonePoweredCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		switch ((*itr)->GetBlockType())
+		// Not found:
+		return false;
+	}
+	switch (BlockEntity->GetBlockType())
+	{
+		case E_BLOCK_DROPPER:
+		case E_BLOCK_DISPENSER:
+		case E_BLOCK_NOTE_BLOCK:
 		{
-			case E_BLOCK_DROPPER:
-			case E_BLOCK_DISPENSER:
-			case E_BLOCK_NOTE_BLOCK:
-			{
-				break;
-			}
-			default:
-			{
-				// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-				return false;
-			}
+			break;
 		}
-		
-		if (a_Callback.Item(dynamic_cast<cRedstonePoweredEntity *>(*itr)))  // Needs dynamic_cast due to multiple inheritance
+		default:
 		{
+			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
 			return false;
 		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+	}
 	
-	// Not found:
-	return false;
+	if (a_Callback.Item(dynamic_cast<cRedstonePoweredEntity *>(BlockEntity)))  // Needs dynamic_cast due to multiple inheritance
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2249,29 +2894,24 @@ bool cChunk::DoWithRedstonePoweredEntityAt(int a_BlockX, int a_BlockY, int a_Blo
 bool cChunk::DoWithBeaconAt(int a_BlockX, int a_BlockY, int a_BlockZ, cBeaconCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_BEACON)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cBeaconEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_BEACON)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cBeaconEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2281,29 +2921,24 @@ bool cChunk::DoWithBeaconAt(int a_BlockX, int a_BlockY, int a_BlockZ, cBeaconCal
 bool cChunk::DoWithChestAt(int a_BlockX, int a_BlockY, int a_BlockZ, cChestCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if (((*itr)->GetBlockType() != E_BLOCK_CHEST) && ((*itr)->GetBlockType() != E_BLOCK_TRAPPED_CHEST))  // Trapped chests use normal chests' handlers
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cChestEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if ((BlockEntity->GetBlockType() != E_BLOCK_CHEST) && (BlockEntity->GetBlockType() != E_BLOCK_TRAPPED_CHEST))  // Trapped chests use normal chests' handlers
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cChestEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2313,29 +2948,24 @@ bool cChunk::DoWithChestAt(int a_BlockX, int a_BlockY, int a_BlockZ, cChestCallb
 bool cChunk::DoWithDispenserAt(int a_BlockX, int a_BlockY, int a_BlockZ, cDispenserCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_DISPENSER)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cDispenserEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_DISPENSER)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cDispenserEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2345,29 +2975,24 @@ bool cChunk::DoWithDispenserAt(int a_BlockX, int a_BlockY, int a_BlockZ, cDispen
 bool cChunk::DoWithDropperAt(int a_BlockX, int a_BlockY, int a_BlockZ, cDropperCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_DROPPER)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cDropperEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_DROPPER)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cDropperEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2377,29 +3002,24 @@ bool cChunk::DoWithDropperAt(int a_BlockX, int a_BlockY, int a_BlockZ, cDropperC
 bool cChunk::DoWithDropSpenserAt(int a_BlockX, int a_BlockY, int a_BlockZ, cDropSpenserCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if (((*itr)->GetBlockType() != E_BLOCK_DISPENSER) && ((*itr)->GetBlockType() != E_BLOCK_DROPPER))
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cDropSpenserEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if ((BlockEntity->GetBlockType() != E_BLOCK_DISPENSER) && (BlockEntity->GetBlockType() != E_BLOCK_DROPPER))
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cDropSpenserEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2409,37 +3029,32 @@ bool cChunk::DoWithDropSpenserAt(int a_BlockX, int a_BlockY, int a_BlockZ, cDrop
 bool cChunk::DoWithFurnaceAt(int a_BlockX, int a_BlockY, int a_BlockZ, cFurnaceCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
+		// Not found:
+		return false;
+	}
+	switch (BlockEntity->GetBlockType())
+	{
+		case E_BLOCK_FURNACE:
+		case E_BLOCK_LIT_FURNACE:
 		{
-			continue;
+			break;
 		}
-		switch ((*itr)->GetBlockType())
-		{
-			case E_BLOCK_FURNACE:
-			case E_BLOCK_LIT_FURNACE:
-			{
-				break;
-			}
-			default:
-			{
-				// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-				return false;
-			}
-		}  // switch (BlockType)
-		
-		// The correct block entity is here,
-		if (a_Callback.Item((cFurnaceEntity *)*itr))
+		default:
 		{
+			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
 			return false;
 		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+	}  // switch (BlockType)
 	
-	// Not found:
-	return false;
+	// The correct block entity is here,
+	if (a_Callback.Item((cFurnaceEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2449,29 +3064,24 @@ bool cChunk::DoWithFurnaceAt(int a_BlockX, int a_BlockY, int a_BlockZ, cFurnaceC
 bool cChunk::DoWithNoteBlockAt(int a_BlockX, int a_BlockY, int a_BlockZ, cNoteBlockCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_NOTE_BLOCK)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cNoteEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_NOTE_BLOCK)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cNoteEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2481,29 +3091,24 @@ bool cChunk::DoWithNoteBlockAt(int a_BlockX, int a_BlockY, int a_BlockZ, cNoteBl
 bool cChunk::DoWithCommandBlockAt(int a_BlockX, int a_BlockY, int a_BlockZ, cCommandBlockCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_COMMAND_BLOCK)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here,
-		if (a_Callback.Item((cCommandBlockEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_COMMAND_BLOCK)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here,
+	if (a_Callback.Item((cCommandBlockEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2513,29 +3118,24 @@ bool cChunk::DoWithCommandBlockAt(int a_BlockX, int a_BlockY, int a_BlockZ, cCom
 bool cChunk::DoWithMobHeadAt(int a_BlockX, int a_BlockY, int a_BlockZ, cMobHeadCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_HEAD)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here,
-		if (a_Callback.Item((cMobHeadEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_HEAD)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here,
+	if (a_Callback.Item((cMobHeadEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2545,29 +3145,24 @@ bool cChunk::DoWithMobHeadAt(int a_BlockX, int a_BlockY, int a_BlockZ, cMobHeadC
 bool cChunk::DoWithFlowerPotAt(int a_BlockX, int a_BlockY, int a_BlockZ, cFlowerPotCallback & a_Callback)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(), itr2 = itr; itr != m_BlockEntities.end(); itr = itr2)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		++itr2;
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
-		{
-			continue;
-		}
-		if ((*itr)->GetBlockType() != E_BLOCK_FLOWER_POT)
-		{
-			// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-			return false;
-		}
-		
-		// The correct block entity is here
-		if (a_Callback.Item((cFlowerPotEntity *)*itr))
-		{
-			return false;
-		}
-		return true;
-	}  // for itr - m_BlockEntitites[]
+		// Not found:
+		return false;
+	}
+	if (BlockEntity->GetBlockType() != E_BLOCK_FLOWER_POT)
+	{
+		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
+		return false;
+	}
 	
-	// Not found:
-	return false;
+	// The correct block entity is here
+	if (a_Callback.Item((cFlowerPotEntity *)BlockEntity))
+	{
+		return false;
+	}
+	return true;
 }
 
 
@@ -2577,30 +3172,26 @@ bool cChunk::DoWithFlowerPotAt(int a_BlockX, int a_BlockY, int a_BlockZ, cFlower
 bool cChunk::GetSignLines(int a_BlockX, int a_BlockY, int a_BlockZ, AString & a_Line1, AString & a_Line2, AString & a_Line3, AString & a_Line4)
 {
 	// The blockentity list is locked by the parent chunkmap's CS
-	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end(); ++itr)
+	cBlockEntity * BlockEntity = GetBlockEntity(a_BlockX, a_BlockY, a_BlockZ);
+	if (BlockEntity == nullptr)
 	{
-		if (((*itr)->GetPosX() != a_BlockX) || ((*itr)->GetPosY() != a_BlockY) || ((*itr)->GetPosZ() != a_BlockZ))
+		// Not found:
+		return false;
+	}
+	switch (BlockEntity->GetBlockType())
+	{
+		case E_BLOCK_WALLSIGN:
+		case E_BLOCK_SIGN_POST:
 		{
-			continue;
+			a_Line1 = ((cSignEntity *)BlockEntity)->GetLine(0);
+			a_Line2 = ((cSignEntity *)BlockEntity)->GetLine(1);
+			a_Line3 = ((cSignEntity *)BlockEntity)->GetLine(2);
+			a_Line4 = ((cSignEntity *)BlockEntity)->GetLine(3);
+			return true;
 		}
-		switch ((*itr)->GetBlockType())
-		{
-			case E_BLOCK_WALLSIGN:
-			case E_BLOCK_SIGN_POST:
-			{
-				a_Line1 = ((cSignEntity *)*itr)->GetLine(0);
-				a_Line2 = ((cSignEntity *)*itr)->GetLine(1);
-				a_Line3 = ((cSignEntity *)*itr)->GetLine(2);
-				a_Line4 = ((cSignEntity *)*itr)->GetLine(3);
-				return true;
-			}
-		}  // switch (BlockType)
-		
-		// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
-		return false;
-	}  // for itr - m_BlockEntitites[]
+	}  // switch (BlockType)
 	
-	// Not found:
+	// There is a block entity here, but of different type. No other block entity can be here, so we can safely bail out
 	return false;
 }
 
@@ -2790,6 +3381,10 @@ void cChunk::BroadcastAttachEntity(const cEntity & a_Entity, const cEntity * a_V
 {
 	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
+		if (!(*itr)->IsTrackingEntity(a_Entity))
+		{
+			continue;
+		}
 		(*itr)->SendAttachEntity(a_Entity, a_Vehicle);
 	}  // for itr - LoadedByClient[]
 }
@@ -2872,7 +3467,7 @@ void cChunk::BroadcastCollectEntity(const cEntity & a_Entity, const cPlayer & a_
 {
 	for (cClientHandleList::iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
 		{
 			continue;
 		}
@@ -2892,7 +3487,7 @@ void cChunk::BroadcastDestroyEntity(const cEntity & a_Entity, const cClientHandl
 		{
 			continue;
 		}
-		(*itr)->SendDestroyEntity(a_Entity);
+		DestroyEntityOnClient(a_Entity, **itr);
 	}  // for itr - LoadedByClient[]
 }
 
@@ -2904,7 +3499,7 @@ void cChunk::BroadcastEntityEffect(const cEntity & a_Entity, int a_EffectID, int
 {
 	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
 		{
 			continue;
 		}
@@ -2918,14 +3513,8 @@ void cChunk::BroadcastEntityEffect(const cEntity & a_Entity, int a_EffectID, int
 
 void cChunk::BroadcastEntityEquipment(const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item, const cClientHandle * a_Exclude)
 {
-	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
-	{
-		if (*itr == a_Exclude)
-		{
-			continue;
-		}
-		(*itr)->SendEntityEquipment(a_Entity, a_SlotNum, a_Item);
-	}  // for itr - LoadedByClient[]
+	sPendingEntityUpdate Update = { &a_Entity, a_Entity.GetUniqueID(), a_Exclude, 0, a_SlotNum, a_Item };
+	QueueEntityUpdate(Update);
 }
 
 
@@ -2934,14 +3523,7 @@ void cChunk::BroadcastEntityEquipment(const cEntity & a_Entity, short a_SlotNum,
 
 void cChunk::BroadcastEntityHeadLook(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
-	{
-		if (*itr == a_Exclude)
-		{
-			continue;
-		}
-		(*itr)->SendEntityHeadLook(a_Entity);
-	}  // for itr - LoadedByClient[]
+	QueueEntityMovement(emHeadLook, a_Entity, 0, 0, 0, a_Exclude);
 }
 
 
@@ -2950,30 +3532,18 @@ void cChunk::BroadcastEntityHeadLook(const cEntity & a_Entity, const cClientHand
 
 void cChunk::BroadcastEntityLook(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
-	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
-	{
-		if (*itr == a_Exclude)
-		{
-			continue;
-		}
-		(*itr)->SendEntityLook(a_Entity);
-	}  // for itr - LoadedByClient[]
+	QueueEntityMovement(emLook, a_Entity, 0, 0, 0, a_Exclude);
 }
 
 
 
 
 
-void cChunk::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+void cChunk::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude, int a_Fields)
 {
-	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
-	{
-		if (*itr == a_Exclude)
-		{
-			continue;
-		}
-		(*itr)->SendEntityMetadata(a_Entity);
-	}  // for itr - LoadedByClient[]
+	ASSERT(a_Fields != 0);
+	sPendingEntityUpdate Update = { &a_Entity, a_Entity.GetUniqueID(), a_Exclude, a_Fields, -1, cItem() };
+	QueueEntityUpdate(Update);
 }
 
 
@@ -2982,14 +3552,7 @@ void cChunk::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHand
 
 void cChunk::BroadcastEntityRelMove(const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude)
 {
-	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
-	{
-		if (*itr == a_Exclude)
-		{
-			continue;
-		}
-		(*itr)->SendEntityRelMove(a_Entity, a_RelX, a_RelY, a_RelZ);
-	}  // for itr - LoadedByClient[]
+	QueueEntityMovement(emRelMove, a_Entity, a_RelX, a_RelY, a_RelZ, a_Exclude);
 }
 
 
@@ -2998,14 +3561,7 @@ void cChunk::BroadcastEntityRelMove(const cEntity & a_Entity, char a_RelX, char
 
 void cChunk::BroadcastEntityRelMoveLook(const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude)
 {
-	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
-	{
-		if (*itr == a_Exclude)
-		{
-			continue;
-		}
-		(*itr)->SendEntityRelMoveLook(a_Entity, a_RelX, a_RelY, a_RelZ);
-	}  // for itr - LoadedByClient[]
+	QueueEntityMovement(emRelMoveLook, a_Entity, a_RelX, a_RelY, a_RelZ, a_Exclude);
 }
 
 
@@ -3016,7 +3572,7 @@ void cChunk::BroadcastEntityStatus(const cEntity & a_Entity, char a_Status, cons
 {
 	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
 		{
 			continue;
 		}
@@ -3032,7 +3588,7 @@ void cChunk::BroadcastEntityVelocity(const cEntity & a_Entity, const cClientHand
 {
 	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
 		{
 			continue;
 		}
@@ -3048,7 +3604,7 @@ void cChunk::BroadcastEntityAnimation(const cEntity & a_Entity, char a_Animation
 {
 	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
 		{
 			continue;
 		}
@@ -3080,7 +3636,7 @@ void cChunk::BroadcastRemoveEntityEffect(const cEntity & a_Entity, int a_EffectI
 {
 	for (cClientHandleList::iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
 		{
 			continue;
 		}
@@ -3128,11 +3684,11 @@ void cChunk::BroadcastSpawnEntity(cEntity & a_Entity, const cClientHandle * a_Ex
 {
 	for (cClientHandleList::iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
-		if (*itr == a_Exclude)
+		if ((*itr == a_Exclude) || (!(*itr)->IsTrackingEntity(a_Entity) && !IsInTrackingRange(a_Entity, **itr, 0)))
 		{
 			continue;
 		}
-		a_Entity.SpawnOn(*(*itr));
+		SpawnEntityOnClient(a_Entity, **itr);
 	}  // for itr - LoadedByClient[]
 }
 
@@ -3140,6 +3696,297 @@ void cChunk::BroadcastSpawnEntity(cEntity & a_Entity, const cClientHandle * a_Ex
 
 
 
+void cChunk::SendPendingEntityMovements(void)
+{
+	SendPendingEntityUpdates();
+
+	if (m_NumPendingMovements == 0)
+	{
+		return;
+	}
+	
+	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
+	{
+		cPendingMovementsMap::const_iterator itrPending = m_PendingMovements.find((*itr)->GetProtocolVersion());
+		if (itrPending == m_PendingMovements.end())
+		{
+			continue;
+		}
+		const sPendingMovements & Pending = itrPending->second;
+		
+		// Send everything except for the parts excluded for this client:
+		size_t Start = 0;
+		for (std::vector<sExcludedMovement>::const_iterator itrEx = Pending.m_Excluded.begin(), end = Pending.m_Excluded.end(); itrEx != end; ++itrEx)
+		{
+			if (itrEx->m_Exclude != *itr)
+			{
+				continue;
+			}
+			if (itrEx->m_Start > Start)
+			{
+				(*itr)->SendCapturedData(Pending.m_Data.data() + Start, itrEx->m_Start - Start);
+			}
+			Start = itrEx->m_End;
+		}
+		if (Start < Pending.m_Data.size())
+		{
+			(*itr)->SendCapturedData(Pending.m_Data.data() + Start, Pending.m_Data.size() - Start);
+		}
+	}  // for itr - m_LoadedByClient[]
+	
+	// Reset the pending data, keeping the buffers allocated for the next tick:
+	for (cPendingMovementsMap::iterator itr = m_PendingMovements.begin(); itr != m_PendingMovements.end(); ++itr)
+	{
+		itr->second.m_Data.clear();
+		itr->second.m_Excluded.clear();
+		itr->second.m_LastMovement = 0;
+	}
+	m_NumPendingMovements = 0;
+}
+
+
+
+
+
+void cChunk::QueueEntityMovement(eEntityMovement a_Movement, const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude)
+{
+	size_t MovementNum = m_NumPendingMovements + 1;
+
+	// The clients not tracking the entity get the movement excluded, same as a_Exclude:
+	std::vector<const cClientHandle *> Excluded;
+	bool HasReceivers = false;
+	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
+	{
+		if ((*itr == a_Exclude) || !(*itr)->IsTrackingEntity(a_Entity))
+		{
+			Excluded.push_back(*itr);
+		}
+		else
+		{
+			HasReceivers = true;
+		}
+	}
+	if (!HasReceivers)
+	{
+		return;
+	}
+
+	for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
+	{
+		if (std::find(Excluded.begin(), Excluded.end(), *itr) != Excluded.end())
+		{
+			continue;
+		}
+		sPendingMovements & Pending = m_PendingMovements[(*itr)->GetProtocolVersion()];
+		if (Pending.m_LastMovement == MovementNum)
+		{
+			// Already serialized for this protocol version
+			continue;
+		}
+		
+		// Serialize the packet through this client's protocol:
+		size_t Start = Pending.m_Data.size();
+		(*itr)->StartCapture(Pending.m_Data);
+		switch (a_Movement)
+		{
+			case emRelMove:     (*itr)->SendEntityRelMove    (a_Entity, a_RelX, a_RelY, a_RelZ); break;
+			case emRelMoveLook: (*itr)->SendEntityRelMoveLook(a_Entity, a_RelX, a_RelY, a_RelZ); break;
+			case emLook:        (*itr)->SendEntityLook       (a_Entity); break;
+			case emHeadLook:    (*itr)->SendEntityHeadLook   (a_Entity); break;
+		}
+		(*itr)->StopCapture();
+		
+		for (auto Exclude: Excluded)
+		{
+			sExcludedMovement ExcludedMovement = { Start, Pending.m_Data.size(), Exclude };
+			Pending.m_Excluded.push_back(ExcludedMovement);
+		}
+		Pending.m_LastMovement = MovementNum;
+	}  // for itr - m_LoadedByClient[]
+	m_NumPendingMovements = MovementNum;
+}
+
+
+
+
+
+void cChunk::QueueEntityUpdate(const sPendingEntityUpdate & a_Update)
+{
+	// The pending updates can only be verified for the entities of this chunk, send any other update right away:
+	if (std::find(m_Entities.begin(), m_Entities.end(), a_Update.m_Entity) == m_Entities.end())
+	{
+		for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
+		{
+			if ((*itr != a_Update.m_Exclude) && (*itr)->IsTrackingEntity(*a_Update.m_Entity))
+			{
+				SendEntityUpdate(a_Update, *a_Update.m_Entity, **itr);
+			}
+		}
+		return;
+	}
+
+	// Merge with an earlier update of the same kind; the metadata is read only when sending, so it is always the latest:
+	for (auto & Pending: m_PendingEntityUpdates)
+	{
+		if (
+			(Pending.m_Entity != a_Update.m_Entity) ||
+			(Pending.m_Exclude != a_Update.m_Exclude) ||
+			((Pending.m_MetadataFields == 0) != (a_Update.m_MetadataFields == 0)) ||
+			(Pending.m_SlotNum != a_Update.m_SlotNum)
+		)
+		{
+			continue;
+		}
+		Pending.m_MetadataFields |= a_Update.m_MetadataFields;
+		Pending.m_Item = a_Update.m_Item;
+		return;
+	}
+	m_PendingEntityUpdates.push_back(a_Update);
+}
+
+
+
+
+
+void cChunk::SendPendingEntityUpdates(void)
+{
+	if (m_PendingEntityUpdates.empty())
+	{
+		return;
+	}
+
+	// Map of protocol version -> the update serialized for it; the buffers are kept allocated across the updates:
+	std::map<UInt32, AString> Serialized;
+	for (const auto & Update: m_PendingEntityUpdates)
+	{
+		// Skip the updates of the entities that have been destroyed since:
+		cChunkEntityList::const_iterator itrEntity = std::find(m_Entities.begin(), m_Entities.end(), Update.m_Entity);
+		if ((itrEntity == m_Entities.end()) || ((*itrEntity)->GetUniqueID() != Update.m_EntityID))
+		{
+			continue;
+		}
+		const cEntity & Entity = **itrEntity;
+
+		for (auto & Data: Serialized)
+		{
+			Data.second.clear();
+		}
+		for (cClientHandleList::const_iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
+		{
+			if ((*itr == Update.m_Exclude) || !(*itr)->IsTrackingEntity(Entity))
+			{
+				continue;
+			}
+
+			// Serialize the update once per protocol version (the packet is never empty), then send the same data to all:
+			AString & Data = Serialized[(*itr)->GetProtocolVersion()];
+			if (Data.empty())
+			{
+				(*itr)->StartCapture(Data);
+				SendEntityUpdate(Update, Entity, **itr);
+				(*itr)->StopCapture();
+			}
+			(*itr)->SendCapturedData(Data.data(), Data.size());
+		}  // for itr - m_LoadedByClient[]
+	}  // for Update - m_PendingEntityUpdates[]
+	m_PendingEntityUpdates.clear();
+}
+
+
+
+
+
+void cChunk::SendEntityUpdate(const sPendingEntityUpdate & a_Update, const cEntity & a_Entity, cClientHandle & a_Client)
+{
+	if (a_Update.m_MetadataFields != 0)
+	{
+		a_Client.SendEntityMetadata(a_Entity, a_Update.m_MetadataFields);
+	}
+	else
+	{
+		a_Client.SendEntityEquipment(a_Entity, a_Update.m_SlotNum, a_Update.m_Item);
+	}
+}
+
+
+
+
+
+bool cChunk::IsInTrackingRange(const cEntity & a_Entity, cClientHandle & a_Client, int a_Hysteresis)
+{
+	int Range = m_World->GetEntityTrackingRange(a_Entity);
+	const cPlayer * Player = a_Client.GetPlayer();
+	if ((Range <= 0) || (Player == nullptr) || (Player == &a_Entity))
+	{
+		return true;
+	}
+	const Vector3d & EntityPos = a_Entity.GetPosition();
+	const Vector3d & PlayerPos = Player->GetPosition();
+	double Limit = Range + a_Hysteresis;
+	return ((std::abs(EntityPos.x - PlayerPos.x) <= Limit) && (std::abs(EntityPos.z - PlayerPos.z) <= Limit));
+}
+
+
+
+
+
+void cChunk::SpawnEntityOnClient(cEntity & a_Entity, cClientHandle & a_Client)
+{
+	a_Entity.SpawnOn(a_Client);
+	a_Client.SetTrackingEntity(a_Entity, true);
+}
+
+
+
+
+
+void cChunk::DestroyEntityOnClient(const cEntity & a_Entity, cClientHandle & a_Client)
+{
+	if (!a_Client.IsTrackingEntity(a_Entity))
+	{
+		return;
+	}
+	a_Client.SendDestroyEntity(a_Entity);
+	a_Client.SetTrackingEntity(a_Entity, false);
+}
+
+
+
+
+
+void cChunk::UpdateEntityTracking(void)
+{
+	if (m_LoadedByClient.empty())
+	{
+		return;
+	}
+	for (auto Entity: m_Entities)
+	{
+		if (m_World->GetEntityTrackingRange(*Entity) <= 0)
+		{
+			// Tracked by the chunk membership only, which the spawning and destroying already handles
+			continue;
+		}
+		for (auto Client: m_LoadedByClient)
+		{
+			bool IsTracking = Client->IsTrackingEntity(*Entity);
+			if (!IsTracking && IsInTrackingRange(*Entity, *Client, 0))
+			{
+				// The new client mustn't receive the movements queued before the spawn; these exclude it already, it wasn't tracking the entity
+				SpawnEntityOnClient(*Entity, *Client);
+			}
+			else if (IsTracking && !IsInTrackingRange(*Entity, *Client, ENTITY_TRACKING_HYSTERESIS))
+			{
+				DestroyEntityOnClient(*Entity, *Client);
+			}
+		}
+	}
+}
+
+
+
+
+
 void cChunk::BroadcastThunderbolt(int a_BlockX, int a_BlockY, int a_BlockZ, const cClientHandle * a_Exclude)
 {
 	for (cClientHandleList::iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
@@ -3160,6 +4007,10 @@ void cChunk::BroadcastUseBed(const cEntity & a_Entity, int a_BlockX, int a_Block
 {
 	for (cClientHandleList::iterator itr = m_LoadedByClient.begin(); itr != m_LoadedByClient.end(); ++itr)
 	{
+		if (!(*itr)->IsTrackingEntity(a_Entity))
+		{
+			continue;
+		}
 		(*itr)->SendUseBed(a_Entity, a_BlockX, a_BlockY, a_BlockZ);
 	}  // for itr - LoadedByClient[]
 }
@@ -12,6 +12,9 @@
 #include "Blocks/GetHandlerCompileTimeTemplate.h"
 
 #include "ChunkMap.h"
+#include "SwapRemoveVector.h"
+
+#include <unordered_map>
 
 
 
@@ -34,6 +37,7 @@ class cBeaconEntity;
 class cBoundingBox;
 class cChestEntity;
 class cChunkDataCallback;
+class cChunkSnapshot;
 class cCommandBlockEntity;
 class cDispenserEntity;
 class cFurnaceEntity;
@@ -52,6 +56,11 @@ class cRedstonePoweredEntity;
 class cSetChunkData;
 
 typedef std::list<cClientHandle *>         cClientHandleList;
+
+/** The entities of a chunk, kept contiguous so that the frequent walks over them don't chase pointers.
+An entity is removed by moving the last one into its place, so the order is not kept. */
+typedef cSwapRemoveVector<cEntity>         cChunkEntityList;
+
 typedef cItemCallback<cEntity>             cEntityCallback;
 typedef cItemCallback<cBeaconEntity>       cBeaconCallback;
 typedef cItemCallback<cChestEntity>        cChestCallback;
@@ -109,6 +118,12 @@ public:
 	bool IsDirty(void) const {return m_IsDirty; }
 
 	bool CanUnload(void);
+
+	/** Adds the chunk's memory usage and its entity and block entity counts to a_Stats. */
+	void AddMemoryStats(cChunkMap::sMemoryStats & a_Stats) const;
+
+	/** Returns true if the chunk could be unloaded once it is saved (no clients, no chunkstays, not queued). */
+	bool CanUnloadAfterSave(void) const;
 	
 	bool IsLightValid(void) const {return m_IsLightValid; }
 	
@@ -123,6 +138,16 @@ public:
 	void MarkSaved(void);  // Marks the chunk as saved, if it didn't change from the last call to MarkSaving()
 	void MarkLoaded(void);  // Marks the chunk as freshly loaded. Fails if the chunk is already valid
 
+	/** Returns true if the chunk's data has been taken for saving and the chunk hasn't changed since. */
+	bool IsSaving(void) const { return m_IsSaving; }
+
+	/** Returns the world age (in ticks) at which the chunk was first seen dirty by the write-behind saver,
+	or -1 if it hasn't been seen dirty since the last save. */
+	Int64 GetDirtySince(void) const { return m_DirtySince; }
+
+	/** Sets the world age at which the chunk is considered to have become dirty. Used by the write-behind saver. */
+	void SetDirtySince(Int64 a_DirtySince) { m_DirtySince = a_DirtySince; }
+
 	/** Marks the chunk as failed to load.
 	If m_ShouldGenerateIfLoadFailed is set, queues the chunk for generating. */
 	void MarkLoadFailed(void);
@@ -143,7 +168,8 @@ public:
 	/** Copies m_BlockData into a_BlockTypes, only the block types */
 	void GetBlockTypes(BLOCKTYPE  * a_BlockTypes);
 	
-	/** Writes the specified cBlockArea at the coords specified. Note that the coords may extend beyond the chunk! */
+	/** Writes the specified cBlockArea at the coords specified. Note that the coords may extend beyond the chunk!
+	Types and metas can only be written together; block light and skylight can be written with or without them. */
 	void WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes);
 
 	/** Returns true if there is a block entity at the coords specified */
@@ -182,8 +208,28 @@ public:
 	
 	/** Queues all 6 neighbors of the specified block for ticking (m_ToTickQueue). If any are outside the chunk, relays the checking to the proper neighboring chunk */
 	void QueueTickBlockNeighbors(int a_RelX, int a_RelY, int a_RelZ);
+	
+	/** Wakes up the block entity at the specified coords, if it is of a type that sleeps (see cBlockEntity::IsSleeping()). */
+	void WakeUpBlockEntity(int a_RelX, int a_RelY, int a_RelZ);
+	
+	/** Wakes up the block entities at all 6 neighbors of the specified block. If any are outside the chunk, relays to the proper neighboring chunk */
+	void WakeUpBlockEntitiesAround(int a_RelX, int a_RelY, int a_RelZ);
+	
+	/** Wakes up all the block entities in the chunk */
+	void WakeUpAllBlockEntities(void);
 
 	void FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, BLOCKTYPE a_BlockMeta, bool a_SendToClients = true);  // Doesn't force block updates on neighbors, use for simple changes such as grass growing etc.
+
+	/** Sets all the blocks in the range, which all must belong to this chunk, as a single transaction: the blocks are
+	written first, then the light of the whole changed area is queued for an update once. Blocks outside the valid Y range are skipped.
+	Unless a_ShouldSkipPhysics is set, the blocks and their neighbors are queued for ticking and the block entities around are woken up,
+	the same as SetBlock() does; the simulators are woken up by the caller, cChunkMap::SetBlocks().
+	With a_ShouldSkipPhysics set, nothing reacts to the change, only the block entities are replaced; used for pasting schematics. */
+	void SetBlocks(sSetBlockVector::const_iterator a_Begin, sSetBlockVector::const_iterator a_End, bool a_ShouldSkipPhysics);
+
+	/** Same as FastSetBlock() for each of the blocks, which all must belong to this chunk, but the light of the whole changed
+	area is queued for an update only once. */
+	void FastSetBlocks(const sSetBlockList & a_Blocks);
 	BLOCKTYPE GetBlock(int a_RelX, int a_RelY, int a_RelZ) const;
 	BLOCKTYPE GetBlock(const Vector3i & a_RelCoords) const { return GetBlock(a_RelCoords.x, a_RelCoords.y, a_RelCoords.z); }
 	void      GetBlockTypeMeta(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta) const;
@@ -225,6 +271,12 @@ public:
 
 	int  GetHeight( int a_X, int a_Z);
 
+	/** Returns the number of blocks of the category in the section, see cChunkData::GetSectionBlockCount(). */
+	int GetSectionBlockCount(size_t a_SectionIdx, eBlockCategory a_Category) const { return m_ChunkData.GetSectionBlockCount(a_SectionIdx, a_Category); }
+
+	/** Returns the number of blocks of the category in the whole chunk. */
+	int GetBlockCount(eBlockCategory a_Category) const { return m_ChunkData.GetBlockCount(a_Category); }
+
 	void SendBlockTo(int a_RelX, int a_RelY, int a_RelZ, cClientHandle * a_Client);
 
 	/** Adds a client to the chunk; returns true if added, false if already there */
@@ -242,6 +294,10 @@ public:
 	void AddEntity(cEntity * a_Entity);
 	void RemoveEntity(cEntity * a_Entity);
 	bool HasEntity(UInt32 a_EntityID);
+
+	/** Moves the entity to another cell of the entity index, if its new position or size requires so.
+	Called by the entity whenever its position or size changes, from any thread. */
+	void UpdateEntityIndex(cEntity & a_Entity);
 	
 	/** Calls the callback for each entity; returns true if all entities processed, false if the callback aborted by returning true */
 	bool ForEachEntity(cEntityCallback & a_Callback);  // Lua-accessible
@@ -326,7 +382,7 @@ public:
 	void BroadcastEntityEquipment    (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityHeadLook     (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityLook         (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
-	void BroadcastEntityMetadata     (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
+	void BroadcastEntityMetadata     (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr, int a_Fields = emfAll);
 	void BroadcastEntityRelMove      (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityRelMoveLook  (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityStatus       (const cEntity & a_Entity, char a_Status, const cClientHandle * a_Exclude = nullptr);
@@ -337,6 +393,11 @@ public:
 	void BroadcastSoundEffect        (const AString & a_SoundName, double a_X, double a_Y, double a_Z, float a_Volume, float a_Pitch, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastSoundParticleEffect(int a_EffectID, int a_SrcX, int a_SrcY, int a_SrcZ, int a_Data, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastSpawnEntity        (cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
+	
+	/** Sends the entity updates queued by BroadcastEntityMetadata() and BroadcastEntityEquipment(), and then the entity movements
+	queued by BroadcastEntityRelMove() and friends since the last call to the clients.
+	Called by cChunkMap after ticking the chunk. */
+	void SendPendingEntityMovements(void);
 	void BroadcastThunderbolt        (int a_BlockX, int a_BlockY, int a_BlockZ, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastUseBed             (const cEntity & a_Entity, int a_BlockX, int a_BlockY, int a_BlockZ);
 	
@@ -354,8 +415,20 @@ public:
 	{
 		m_IsDirty = true;
 		m_IsSaving = false;
+		m_Revision = NextRevision();
 	}
 	
+	/** Returns the revision of the chunk's contents. It changes whenever the blocks or light change,
+	so that data derived from the chunk (such as serialized packets) can be checked for staleness. */
+	UInt32 GetRevision(void) const { return m_Revision; }
+	
+	/** Returns a new read-only copy of the chunk's blocks, light, heightmap and biomes. */
+	cChunkSnapshot * CreateSnapshot(void) const;
+	
+	/** Returns the revision of the chunk's list of block entities. It changes whenever a block entity is added or removed,
+	so that pointers to the chunk's block entities cached elsewhere (such as by the hoppers) can be checked for validity. */
+	UInt32 GetBlockEntitiesRevision(void) const { return m_BlockEntitiesRevision; }
+	
 	/** Sets the blockticking to start at the specified block. Only one blocktick may be set, second call overwrites the first call */
 	inline void SetNextBlockTick(int a_RelX, int a_RelY, int a_RelZ)
 	{
@@ -429,7 +502,7 @@ public:
 	cBlockEntity * GetBlockEntity(const Vector3i & a_BlockPos) { return GetBlockEntity(a_BlockPos.x, a_BlockPos.y, a_BlockPos.z); }
 	
 	/** Returns true if the chunk should be ticked in the tick-thread.
-	Checks if there are any clients and if the always-tick flag is set */
+	Checks if the always-tick flag is set and if any client's player is within the world's simulation distance. */
 	bool ShouldBeTicked(void) const;
 	
 	/** Increments (a_AlwaysTicked == true) or decrements (false) the m_AlwaysTicked counter.
@@ -439,6 +512,16 @@ public:
 	as at least one requests is active the chunk will be ticked). */
 	void SetAlwaysTicked(bool a_AlwaysTicked);
 
+	/** Returns the tick time accumulated while the world's chunk tick profiling is on. */
+	const cChunkMap::sChunkTickCost & GetTickCost(void) const { return m_TickCost; }
+
+	/** Zeroes the accumulated tick time. */
+	void ResetTickCost(void);
+
+	/** Adds the time since a_Start to the category of the accumulated tick time.
+	Returns the current time, so that the consecutive parts of the tick can be measured in a chain. */
+	std::chrono::steady_clock::time_point AddTickCost(cChunkMap::sChunkTickCost::eCategory a_Category, std::chrono::steady_clock::time_point a_Start);
+
 	// Makes a copy of the list
 	cClientHandleList GetAllClients(void) const {return m_LoadedByClient; }
 
@@ -446,21 +529,122 @@ private:
 
 	friend class cChunkMap;
 	
+	/** Returns a new chunk revision number, never returned before, see GetRevision(). */
+	static UInt32 NextRevision(void);
+	
 	struct sSetBlockQueueItem
 	{
-		Int64 m_Tick;
 		int m_RelX, m_RelY, m_RelZ;
 		BLOCKTYPE m_BlockType;
 		NIBBLETYPE m_BlockMeta;
 		BLOCKTYPE m_PreviousType;
 		
-		sSetBlockQueueItem(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, Int64 a_Tick, BLOCKTYPE a_PreviousBlockType) :
-			m_Tick(a_Tick), m_RelX(a_RelX), m_RelY(a_RelY), m_RelZ(a_RelZ), m_BlockType(a_BlockType), m_BlockMeta(a_BlockMeta), m_PreviousType(a_PreviousBlockType)
+		sSetBlockQueueItem(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, BLOCKTYPE a_PreviousBlockType) :
+			m_RelX(a_RelX), m_RelY(a_RelY), m_RelZ(a_RelZ), m_BlockType(a_BlockType), m_BlockMeta(a_BlockMeta), m_PreviousType(a_PreviousBlockType)
+		{
+		}
+	} ;
+
+	/** The number of columns of a light change box above which the whole chunk is relit instead, see QueueLightChange(). */
+	static const int MAX_LIGHT_CHANGE_COLUMNS = cChunkDef::Width * cChunkDef::Width / 2;
+
+	/** A box of changed blocks whose light needs an incremental update, in absolute coords, inclusive.
+	Collects the changes of a single SetBlock(), SetBlocks(), FastSetBlocks() or WriteBlockArea() call, so that they are queued into the lighting thread as one. */
+	struct sLightChange
+	{
+		int m_MinX, m_MaxX;
+		int m_MinZ, m_MaxZ;
+		int m_MinY;
+		bool m_ShouldUpdateBlockLight;
+		bool m_ShouldUpdateSkyLight;
+
+		sLightChange(void) :
+			m_MinX(0), m_MaxX(-1),
+			m_MinZ(0), m_MaxZ(-1),
+			m_MinY(cChunkDef::Height),
+			m_ShouldUpdateBlockLight(false),
+			m_ShouldUpdateSkyLight(false)
+		{
+		}
+
+		/** Returns true if no block has been added. */
+		bool IsEmpty(void) const { return (m_MaxX < m_MinX); }
+
+		/** Extends the box to include the specified block, a_MinY being the lowest block whose light sources may have changed. */
+		void Add(int a_BlockX, int a_BlockZ, int a_MinY, bool a_ShouldUpdateBlockLight, bool a_ShouldUpdateSkyLight)
 		{
+			if (IsEmpty())
+			{
+				m_MinX = m_MaxX = a_BlockX;
+				m_MinZ = m_MaxZ = a_BlockZ;
+			}
+			else
+			{
+				m_MinX = std::min(m_MinX, a_BlockX);
+				m_MaxX = std::max(m_MaxX, a_BlockX);
+				m_MinZ = std::min(m_MinZ, a_BlockZ);
+				m_MaxZ = std::max(m_MaxZ, a_BlockZ);
+			}
+			m_MinY = std::min(m_MinY, a_MinY);
+			m_ShouldUpdateBlockLight = m_ShouldUpdateBlockLight || a_ShouldUpdateBlockLight;
+			m_ShouldUpdateSkyLight   = m_ShouldUpdateSkyLight   || a_ShouldUpdateSkyLight;
 		}
 	} ;
 
-	typedef std::vector<sSetBlockQueueItem> sSetBlockQueueVector;
+	/** The queued block changes, keyed by the world age at which they are to be applied.
+	Changes queued for the same tick are kept in the order in which they were queued. */
+	typedef std::multimap<Int64, sSetBlockQueueItem> sSetBlockQueueMap;
+	
+	/** The entity movement packets that are serialized once and sent in batches, see QueueEntityMovement() */
+	enum eEntityMovement
+	{
+		emRelMove,
+		emRelMoveLook,
+		emLook,
+		emHeadLook,
+	} ;
+	
+	/** A range of the pending movement data that is not to be sent to a specific client */
+	struct sExcludedMovement
+	{
+		size_t m_Start;
+		size_t m_End;
+		const cClientHandle * m_Exclude;
+	} ;
+	
+	/** The entity movements queued since the last SendPendingEntityMovements(), serialized for a single protocol version */
+	struct sPendingMovements
+	{
+		/** The serialized packets of all the movements, concatenated in the order of broadcasting */
+		AString m_Data;
+		
+		/** Parts of m_Data that are not to be sent to specific clients, in ascending order */
+		std::vector<sExcludedMovement> m_Excluded;
+		
+		/** Number of the last movement serialized into m_Data (1-based, 0 = none), so that a movement is serialized only once per version */
+		size_t m_LastMovement;
+		
+		sPendingMovements(void) : m_LastMovement(0) {}
+	} ;
+	
+	/** Map of protocol version -> movements serialized for it */
+	typedef std::map<UInt32, sPendingMovements> cPendingMovementsMap;
+	
+	/** An entity metadata or equipment update waiting to be sent, see QueueEntityUpdate() */
+	struct sPendingEntityUpdate
+	{
+		/** The entity; only dereferenced after checking that it is still in m_Entities and still has m_EntityID */
+		const cEntity * m_Entity;
+		UInt32 m_EntityID;
+		const cClientHandle * m_Exclude;
+		
+		/** The metadata fields to send (eEntityMetadataFields bitmask), or 0 for an equipment update */
+		int m_MetadataFields;
+		
+		/** The equipment slot and item, for an equipment update */
+		short m_SlotNum;
+		cItem m_Item;
+	} ;
 	
 
 	/** Holds the presence status of the chunk - if it is present, or in the loader / generator queue, or unloaded */
@@ -473,20 +657,51 @@ private:
 	bool m_IsDirty;        // True if the chunk has changed since it was last saved
 	bool m_IsSaving;       // True if the chunk is being saved
 	bool m_HasLoadFailed;  // True if chunk failed to load and hasn't been generated yet since then
+
+	/** World age (in ticks) at which the write-behind saver first saw the chunk dirty; -1 if not seen dirty since the last save */
+	Int64 m_DirtySince;
+	
+	/** Revision of the chunk contents, see GetRevision(). Unique across all chunks and reloads. */
+	UInt32 m_Revision;
+	
+	/** Revision of the block entity list, see GetBlockEntitiesRevision(). Unique across all chunks and reloads. */
+	UInt32 m_BlockEntitiesRevision;
 	
 	std::vector<Vector3i> m_ToTickBlocks;
 	sSetBlockVector       m_PendingSendBlocks;  ///< Blocks that have changed and need to be sent to all clients
 	
-	sSetBlockQueueVector m_SetBlockQueue;  ///< Block changes that are queued to a specific tick
+	sSetBlockQueueMap m_SetBlockQueue;  ///< Block changes that are queued to a specific tick
+	
+	/** Entity movements waiting to be sent to the clients, see QueueEntityMovement() */
+	cPendingMovementsMap m_PendingMovements;
+	
+	/** Number of entity movements queued since the last SendPendingEntityMovements() */
+	size_t m_NumPendingMovements;
+	
+	/** Entity metadata and equipment updates waiting to be sent to the clients, in the order of broadcasting, see QueueEntityUpdate() */
+	std::vector<sPendingEntityUpdate> m_PendingEntityUpdates;
 	
 	// A critical section is not needed, because all chunk access is protected by its parent ChunkMap's csLayers
 	cClientHandleList  m_LoadedByClient;
-	cEntityList        m_Entities;
+	cChunkEntityList   m_Entities;
 	cBlockEntityList   m_BlockEntities;
+
+	/** Index of m_BlockEntities by their relative coords (cChunkDef::MakeIndexNoCheck()), for the lookups at specific coords */
+	std::unordered_map<int, cBlockEntity *> m_BlockEntityIndex;
+
+	/** Spatial index of m_Entities for ForEachEntityInBox(), maps the index cells to the entities positioned in them.
+	The cells are in absolute coords, so that the entities that have left the chunk but haven't been moved to their new chunk
+	yet stay indexed. Empty cells are removed. See GetEntityIndexCell() for the cell assignment. */
+	std::unordered_map<Int64, std::vector<cEntity *>> m_EntityIndex;
 	
 	/** Number of times the chunk has been requested to stay (by various cChunkStay objects); if zero, the chunk can be unloaded */
 	int m_StayCount;
 
+	/** The ID of the chunk's entry in its chunkmap's unload candidates, 0 if the chunk isn't queued, see cChunkMap::AddUnloadCandidate().
+	The IDs are unique within the chunkmap, so that the entries left over from the chunk's earlier candidacy, or from an unloaded
+	chunk at the same coords, are recognized as stale. */
+	UInt32 m_UnloadCandidateID;
+
 	int m_PosX, m_PosZ;
 	cWorld *    m_World;
 	cChunkMap * m_ChunkMap;
@@ -497,6 +712,7 @@ private:
 	cChunkDef::BiomeMap  m_BiomeMap;
 
 	int m_BlockTickX, m_BlockTickY, m_BlockTickZ;
+
 	
 	cChunk * m_NeighborXM;  // Neighbor at [X - 1, Z]
 	cChunk * m_NeighborXP;  // Neighbor at [X + 1, Z]
@@ -519,6 +735,9 @@ private:
 	Manipulated by the SetAlwaysTicked() function, allows for nested calls of the function.
 	This is the support for plugin-accessible chunk tick forcing. */
 	int m_AlwaysTicked;
+
+	/** The tick time accumulated while the world's chunk tick profiling is on. */
+	cChunkMap::sChunkTickCost m_TickCost;
 	
 
 	// Pick up a random block of this chunk
@@ -528,21 +747,63 @@ private:
 	void RemoveBlockEntity(cBlockEntity * a_BlockEntity);
 	void AddBlockEntity   (cBlockEntity * a_BlockEntity);
 
+	/** Returns the entity index cell where the entity belongs, based on its position and size. */
+	static Int64 GetEntityIndexCell(const cEntity & a_Entity);
+
+	/** Adds the entity to the entity index; it mustn't be indexed in this chunk already. */
+	void AddToEntityIndex(cEntity * a_Entity);
+
+	/** Removes the entity at the specified index from m_Entities by moving the last entity into its place. */
+	void EraseEntityAt(size_t a_Idx);
+
+	/** Removes the entity from the entity index, if it is there. */
+	void RemoveFromEntityIndex(cEntity * a_Entity);
+
+	/** Removes the entity from the specified entity index cell, if it is there. Returns true if it was found. */
+	bool RemoveFromEntityIndexCell(cEntity * a_Entity, Int64 a_Cell);
+
+	/** Removes the entity's ID from the chunkmap's ID lookup, unless the ID already maps to another chunk. */
+	void RemoveFromEntityChunks(const cEntity & a_Entity);
+
 	/** Creates a block entity for each block that needs a block entity and doesn't have one in the list */
 	void CreateBlockEntities(void);
+
+	/** Returns the key of the block entity in m_BlockEntityIndex, based on its position. */
+	static int GetBlockEntityIndexKey(const cBlockEntity & a_BlockEntity);
+
+	/** Removes the block entity at the specified coords, if any, and creates a new one if the new block type needs it. */
+	void ReplaceBlockEntity(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
+
+	/** Writes the block into the chunk data, queues it for sending to the clients, if requested, and updates the heightmap.
+	The light changes are only collected into a_LightChange, the caller queues them using QueueLightChange(). */
+	void SetBlockData(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, bool a_SendToClients, sLightChange & a_LightChange);
+
+	/** Queues the collected light change into the lighting thread, if there's any and the chunk is already lit.
+	If the change spans at least MAX_LIGHT_CHANGE_COLUMNS columns, the chunk's light is invalidated and the whole chunk is queued for relighting instead. */
+	void QueueLightChange(const sLightChange & a_LightChange);
+
+	/** Copies one of the light arrays of a_Area into the chunk's light, used by WriteBlockArea().
+	The Size, Off and Base parameters specify the intersection of the area and the chunk, as calculated by WriteBlockArea(). */
+	void WriteAreaLight(
+		const NIBBLETYPE * a_AreaLight, const cBlockArea & a_Area, cChunkDef::BlockNibbles & a_ChunkLight,
+		int a_MinBlockY, int a_SizeX, int a_SizeY, int a_SizeZ, int a_OffX, int a_OffZ, int a_BaseX, int a_BaseZ
+	);
 	
 	/** Wakes up each simulator for its specific blocks; through all the blocks in the chunk */
 	void WakeUpSimulators(void);
 
-	/** Sends m_PendingSendBlocks to all clients */
+	/** Sends m_PendingSendBlocks to all clients, either as block changes or as the whole chunk, whichever is cheaper */
 	void BroadcastPendingBlockChanges(void);
+
+	/** Removes the superseded changes from m_PendingSendBlocks, so that each block is sent only once, with its latest value */
+	void CoalescePendingBlockChanges(void);
 	
 	/** Checks the block scheduled for checking in m_ToTickBlocks[] */
 	void CheckBlocks();
 	
 	/** Ticks several random blocks in the chunk */
 	void TickBlocks(void);
-	
+
 	/** Adds snow to the top of snowy biomes and hydrates farmland / fills cauldrons in rainy biomes */
 	void ApplyWeatherToTop(void);
 	
@@ -555,8 +816,36 @@ private:
 	/** Grows a melon or a pumpkin next to the block specified (assumed to be the stem) */
 	void GrowMelonPumpkin(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, MTRand & a_Random);
 	
+	/** Serializes the entity movement packet once for each protocol version used by the chunk's clients
+	and queues it for sending in a batch, by SendPendingEntityMovements(). */
+	void QueueEntityMovement(eEntityMovement a_Movement, const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude);
+	
+	/** Queues the entity metadata or equipment update for sending by SendPendingEntityUpdates(). An earlier update still queued
+	for the same entity, kind (metadata / the same equipment slot) and a_Exclude is merged with this one instead, so that the entity's
+	repeated updates within a tick are sent only once. Updates for entities not in this chunk are sent right away. */
+	void QueueEntityUpdate(const sPendingEntityUpdate & a_Update);
+	
+	/** Serializes each queued entity update once per protocol version and sends it to all the clients tracking the entity. */
+	void SendPendingEntityUpdates(void);
+	
+	/** Sends the entity update to the specified client, through its protocol. */
+	static void SendEntityUpdate(const sPendingEntityUpdate & a_Update, const cEntity & a_Entity, cClientHandle & a_Client);
+	
 	/** Called by Tick() when an entity moves out of this chunk into a neighbor; moves the entity and sends spawn / despawn packet to clients */
 	void MoveEntityToNewChunk(cEntity * a_Entity);
+
+	/** Returns true if the entity is within its tracking range of the client's player, extended by a_Hysteresis blocks.
+	See cWorld::GetEntityTrackingRange(). */
+	bool IsInTrackingRange(const cEntity & a_Entity, cClientHandle & a_Client, int a_Hysteresis);
+
+	/** Spawns the entity on the client and marks it as tracked by the client. */
+	void SpawnEntityOnClient(cEntity & a_Entity, cClientHandle & a_Client);
+
+	/** Destroys the entity on the client, if the client is tracking it. */
+	void DestroyEntityOnClient(const cEntity & a_Entity, cClientHandle & a_Client);
+
+	/** Spawns the entities that have come within their tracking range of the chunk's clients, and destroys those that have left it. */
+	void UpdateEntityTracking(void);
 	
 	/** Processes all blocks that have been scheduled for replacement by the QueueSetBlock() function */
 	void ProcessQueuedSetBlocks(void);
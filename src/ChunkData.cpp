@@ -5,6 +5,7 @@
 
 #include "Globals.h"
 #include "ChunkData.h"
+#include <atomic>
 
 
 
@@ -27,6 +28,15 @@ template <typename T> inline bool IsAllValue(const T * a_Array, size_t a_NumElem
 
 
 
+UInt8 cChunkData::ms_BlockCategories[256];
+
+/** The next revision to be assigned by cChunkData::GetSectionRevision(). */
+static std::atomic<UInt32> g_NextSectionRevision(1);
+
+
+
+
+
 cChunkData::cChunkData(cAllocationPool<cChunkData::sChunkSection> & a_Pool) :
 #if __cplusplus < 201103L
 	// auto_ptr style interface for memory management
@@ -37,7 +47,14 @@ cChunkData::cChunkData(cAllocationPool<cChunkData::sChunkSection> & a_Pool) :
 	for (size_t i = 0; i < NumSections; i++)
 	{
 		m_Sections[i] = nullptr;
+		m_PaletteSections[i] = nullptr;
+		m_BlockLight[i] = nullptr;
+		m_SkyLight[i] = nullptr;
+		m_UniformBlockLight[i] = 0x00;
+		m_UniformSkyLight[i] = 0x0f;
 	}
+	memset(m_BlockCounts, 0, sizeof(m_BlockCounts));
+	memset(m_SectionRevisions, 0, sizeof(m_SectionRevisions));
 }
 
 
@@ -57,6 +74,12 @@ cChunkData::~cChunkData()
 	{
 		Free(m_Sections[i]);
 		m_Sections[i] = nullptr;
+		FreePalette(m_PaletteSections[i]);
+		m_PaletteSections[i] = nullptr;
+		delete[] m_BlockLight[i];
+		m_BlockLight[i] = nullptr;
+		delete[] m_SkyLight[i];
+		m_SkyLight[i] = nullptr;
 	}
 }
 
@@ -74,7 +97,14 @@ cChunkData::~cChunkData()
 		for (size_t i = 0; i < NumSections; i++)
 		{
 			m_Sections[i] = a_Other.m_Sections[i];
+			m_PaletteSections[i] = a_Other.m_PaletteSections[i];
+			m_BlockLight[i] = a_Other.m_BlockLight[i];
+			m_SkyLight[i] = a_Other.m_SkyLight[i];
+			m_UniformBlockLight[i] = a_Other.m_UniformBlockLight[i];
+			m_UniformSkyLight[i] = a_Other.m_UniformSkyLight[i];
 		}
+		memcpy(m_BlockCounts, a_Other.m_BlockCounts, sizeof(m_BlockCounts));
+		memcpy(m_SectionRevisions, a_Other.m_SectionRevisions, sizeof(m_SectionRevisions));
 		a_Other.m_IsOwner = false;
 	}
 
@@ -97,6 +127,12 @@ cChunkData::~cChunkData()
 			{
 				Free(m_Sections[i]);
 				m_Sections[i] = nullptr;
+				FreePalette(m_PaletteSections[i]);
+				m_PaletteSections[i] = nullptr;
+				delete[] m_BlockLight[i];
+				m_BlockLight[i] = nullptr;
+				delete[] m_SkyLight[i];
+				m_SkyLight[i] = nullptr;
 			}
 		}
 
@@ -105,7 +141,14 @@ cChunkData::~cChunkData()
 		for (size_t i = 0; i < NumSections; i++)
 		{
 			m_Sections[i] = a_Other.m_Sections[i];
+			m_PaletteSections[i] = a_Other.m_PaletteSections[i];
+			m_BlockLight[i] = a_Other.m_BlockLight[i];
+			m_SkyLight[i] = a_Other.m_SkyLight[i];
+			m_UniformBlockLight[i] = a_Other.m_UniformBlockLight[i];
+			m_UniformSkyLight[i] = a_Other.m_UniformSkyLight[i];
 		}
+		memcpy(m_BlockCounts, a_Other.m_BlockCounts, sizeof(m_BlockCounts));
+		memcpy(m_SectionRevisions, a_Other.m_SectionRevisions, sizeof(m_SectionRevisions));
 		a_Other.m_IsOwner = false;
 		ASSERT(&m_Pool == &a_Other.m_Pool);
 		return *this;
@@ -121,7 +164,17 @@ cChunkData::~cChunkData()
 		{
 			m_Sections[i] = other.m_Sections[i];
 			other.m_Sections[i] = nullptr;
+			m_PaletteSections[i] = other.m_PaletteSections[i];
+			other.m_PaletteSections[i] = nullptr;
+			m_BlockLight[i] = other.m_BlockLight[i];
+			other.m_BlockLight[i] = nullptr;
+			m_SkyLight[i] = other.m_SkyLight[i];
+			other.m_SkyLight[i] = nullptr;
+			m_UniformBlockLight[i] = other.m_UniformBlockLight[i];
+			m_UniformSkyLight[i] = other.m_UniformSkyLight[i];
 		}
+		memcpy(m_BlockCounts, other.m_BlockCounts, sizeof(m_BlockCounts));
+		memcpy(m_SectionRevisions, other.m_SectionRevisions, sizeof(m_SectionRevisions));
 	}
 	
 	
@@ -138,7 +191,20 @@ cChunkData::~cChunkData()
 				Free(m_Sections[i]);
 				m_Sections[i] = other.m_Sections[i];
 				other.m_Sections[i] = nullptr;
+				FreePalette(m_PaletteSections[i]);
+				m_PaletteSections[i] = other.m_PaletteSections[i];
+				other.m_PaletteSections[i] = nullptr;
+				delete[] m_BlockLight[i];
+				m_BlockLight[i] = other.m_BlockLight[i];
+				other.m_BlockLight[i] = nullptr;
+				delete[] m_SkyLight[i];
+				m_SkyLight[i] = other.m_SkyLight[i];
+				other.m_SkyLight[i] = nullptr;
+				m_UniformBlockLight[i] = other.m_UniformBlockLight[i];
+				m_UniformSkyLight[i] = other.m_UniformSkyLight[i];
 			}
+			memcpy(m_BlockCounts, other.m_BlockCounts, sizeof(m_BlockCounts));
+			memcpy(m_SectionRevisions, other.m_SectionRevisions, sizeof(m_SectionRevisions));
 		}
 		return *this;
 	}
@@ -154,11 +220,15 @@ BLOCKTYPE cChunkData::GetBlock(int a_X, int a_Y, int a_Z) const
 	ASSERT((a_Y >= 0) && (a_Y < cChunkDef::Height));
 	ASSERT((a_Z >= 0) && (a_Z < cChunkDef::Width));
 	int Section = a_Y / SectionHeight;
+	int Index = cChunkDef::MakeIndexNoCheck(a_X, a_Y - (Section * SectionHeight), a_Z);
 	if (m_Sections[Section] != nullptr)
 	{
-		int Index = cChunkDef::MakeIndexNoCheck(a_X, a_Y - (Section * SectionHeight), a_Z);
 		return m_Sections[Section]->m_BlockTypes[Index];
 	}
+	else if (m_PaletteSections[Section] != nullptr)
+	{
+		return static_cast<BLOCKTYPE>(GetPaletteBlock(*m_PaletteSections[Section], static_cast<size_t>(Index)) >> 4);
+	}
 	else
 	{
 		return 0;
@@ -182,22 +252,25 @@ void cChunkData::SetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_Block)
 	}
 
 	int Section = a_RelY / SectionHeight;
-	if (m_Sections[Section] == nullptr)
+	int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
+	m_SectionRevisions[Section] = 0;
+	if (m_Sections[Section] != nullptr)
+	{
+		UpdateBlockCounts(static_cast<size_t>(Section), m_Sections[Section]->m_BlockTypes[Index], a_Block);
+		m_Sections[Section]->m_BlockTypes[Index] = a_Block;
+		return;
+	}
+	if (m_PaletteSections[Section] == nullptr)
 	{
 		if (a_Block == 0x00)
 		{
 			return;
 		}
-		m_Sections[Section] = Allocate();
-		if (m_Sections[Section] == nullptr)
-		{
-			ASSERT(!"Failed to allocate a new section in Chunkbuffer");
-			return;
-		}
-		ZeroSection(m_Sections[Section]);
+		m_PaletteSections[Section] = AllocatePalette();
 	}
-	int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
-	m_Sections[Section]->m_BlockTypes[Index] = a_Block;
+	UInt16 OldValue = GetPaletteBlock(*m_PaletteSections[Section], static_cast<size_t>(Index));
+	UpdateBlockCounts(static_cast<size_t>(Section), static_cast<BLOCKTYPE>(OldValue >> 4), a_Block);
+	SetPaletteBlock(static_cast<size_t>(Section), static_cast<size_t>(Index), a_Block, static_cast<NIBBLETYPE>(OldValue & 0x0f));
 }
 
 
@@ -212,11 +285,15 @@ NIBBLETYPE cChunkData::GetMeta(int a_RelX, int a_RelY, int a_RelZ) const
 		(a_RelZ < cChunkDef::Width) && (a_RelZ > -1))
 	{
 		int Section = a_RelY / SectionHeight;
+		int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
 		if (m_Sections[Section] != nullptr)
 		{
-			int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
 			return (m_Sections[Section]->m_BlockMetas[Index / 2] >> ((Index & 1) * 4)) & 0x0f;
 		}
+		else if (m_PaletteSections[Section] != nullptr)
+		{
+			return static_cast<NIBBLETYPE>(GetPaletteBlock(*m_PaletteSections[Section], static_cast<size_t>(Index)) & 0x0f);
+		}
 		else
 		{
 			return 0;
@@ -243,27 +320,29 @@ bool cChunkData::SetMeta(int a_RelX, int a_RelY, int a_RelZ, NIBBLETYPE a_Nibble
 	}
 
 	int Section = a_RelY / SectionHeight;
-	if (m_Sections[Section] == nullptr)
+	int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
+	m_SectionRevisions[Section] = 0;
+	if (m_Sections[Section] != nullptr)
+	{
+		NIBBLETYPE oldval = m_Sections[Section]->m_BlockMetas[Index / 2] >> ((Index & 1) * 4) & 0xf;
+		m_Sections[Section]->m_BlockMetas[Index / 2] = static_cast<NIBBLETYPE>(
+			(m_Sections[Section]->m_BlockMetas[Index / 2] & (0xf0 >> ((Index & 1) * 4))) |  // The untouched nibble
+			((a_Nibble & 0x0f) << ((Index & 1) * 4))  // The nibble being set
+		);
+		return oldval != a_Nibble;
+	}
+
+	if (m_PaletteSections[Section] == nullptr)
 	{
 		if ((a_Nibble & 0xf) == 0x00)
 		{
 			return false;
 		}
-		m_Sections[Section] = Allocate();
-		if (m_Sections[Section] == nullptr)
-		{
-			ASSERT(!"Failed to allocate a new section in Chunkbuffer");
-			return false;
-		}
-		ZeroSection(m_Sections[Section]);
+		m_PaletteSections[Section] = AllocatePalette();
 	}
-	int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
-	NIBBLETYPE oldval = m_Sections[Section]->m_BlockMetas[Index / 2] >> ((Index & 1) * 4) & 0xf;
-	m_Sections[Section]->m_BlockMetas[Index / 2] = static_cast<NIBBLETYPE>(
-		(m_Sections[Section]->m_BlockMetas[Index / 2] & (0xf0 >> ((Index & 1) * 4))) |  // The untouched nibble
-		((a_Nibble & 0x0f) << ((Index & 1) * 4))  // The nibble being set
-	);
-	return oldval != a_Nibble;
+	UInt16 OldValue = GetPaletteBlock(*m_PaletteSections[Section], static_cast<size_t>(Index));
+	SetPaletteBlock(static_cast<size_t>(Section), static_cast<size_t>(Index), static_cast<BLOCKTYPE>(OldValue >> 4), a_Nibble & 0x0f);
+	return (OldValue & 0x0f) != a_Nibble;
 }
 
 
@@ -279,14 +358,14 @@ NIBBLETYPE cChunkData::GetBlockLight(int a_RelX, int a_RelY, int a_RelZ) const
 	)
 	{
 		int Section = a_RelY / SectionHeight;
-		if (m_Sections[Section] != nullptr)
+		if (m_BlockLight[Section] != nullptr)
 		{
 			int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
-			return (m_Sections[Section]->m_BlockLight[Index / 2] >> ((Index & 1) * 4)) & 0x0f;
+			return (m_BlockLight[Section][Index / 2] >> ((Index & 1) * 4)) & 0x0f;
 		}
 		else
 		{
-			return 0;
+			return m_UniformBlockLight[Section];
 		}
 	}
 	ASSERT(!"cChunkData::GetMeta(): coords out of chunk range!");
@@ -302,14 +381,14 @@ NIBBLETYPE cChunkData::GetSkyLight(int a_RelX, int a_RelY, int a_RelZ) const
 	if ((a_RelX < cChunkDef::Width) && (a_RelX > -1) && (a_RelY < cChunkDef::Height) && (a_RelY > -1) && (a_RelZ < cChunkDef::Width) && (a_RelZ > -1))
 	{
 		int Section = a_RelY / SectionHeight;
-		if (m_Sections[Section] != nullptr)
+		if (m_SkyLight[Section] != nullptr)
 		{
 			int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY - (Section * SectionHeight), a_RelZ);
-			return (m_Sections[Section]->m_BlockSkyLight[Index / 2] >> ((Index & 1) * 4)) & 0x0f;
+			return (m_SkyLight[Section][Index / 2] >> ((Index & 1) * 4)) & 0x0f;
 		}
 		else
 		{
-			return 0xF;
+			return m_UniformSkyLight[Section];
 		}
 	}
 	ASSERT(!"cChunkData::GetMeta(): coords out of chunk range!");
@@ -330,7 +409,17 @@ cChunkData cChunkData::Copy(void) const
 			copy.m_Sections[i] = copy.Allocate();
 			*copy.m_Sections[i] = *m_Sections[i];
 		}
+		else if (m_PaletteSections[i] != nullptr)
+		{
+			copy.m_PaletteSections[i] = new sPaletteSection(*m_PaletteSections[i]);
+		}
+		copy.m_BlockLight[i] = CloneSectionLight(m_BlockLight[i]);
+		copy.m_SkyLight[i] = CloneSectionLight(m_SkyLight[i]);
+		copy.m_UniformBlockLight[i] = m_UniformBlockLight[i];
+		copy.m_UniformSkyLight[i] = m_UniformSkyLight[i];
 	}
+	memcpy(copy.m_BlockCounts, m_BlockCounts, sizeof(m_BlockCounts));
+	memcpy(copy.m_SectionRevisions, m_SectionRevisions, sizeof(m_SectionRevisions));
 	return copy;
 }
 
@@ -354,14 +443,30 @@ void cChunkData::CopyBlockTypes(BLOCKTYPE * a_Dest, size_t a_Idx, size_t a_Lengt
 		{
 			size_t ToCopy = std::min(+SectionBlockCount - StartPos, a_Length);
 			a_Length -= ToCopy;
+			BLOCKTYPE * Dest = &a_Dest[(i * SectionBlockCount) + StartPos - a_Idx];
 			if (m_Sections[i] != nullptr)
 			{
 				BLOCKTYPE * blockbuffer = m_Sections[i]->m_BlockTypes;
-				memcpy(&a_Dest[(i * SectionBlockCount) + StartPos - a_Idx], blockbuffer + StartPos, sizeof(BLOCKTYPE) * ToCopy);
+				memcpy(Dest, blockbuffer + StartPos, sizeof(BLOCKTYPE) * ToCopy);
+			}
+			else if (m_PaletteSections[i] != nullptr)
+			{
+				const sPaletteSection & Section = *m_PaletteSections[i];
+				if (Section.m_BitsPerBlock == 0)
+				{
+					memset(Dest, Section.m_Palette[0] >> 4, sizeof(BLOCKTYPE) * ToCopy);
+				}
+				else
+				{
+					for (size_t j = 0; j < ToCopy; j++)
+					{
+						Dest[j] = static_cast<BLOCKTYPE>(GetPaletteBlock(Section, StartPos + j) >> 4);
+					}
+				}
 			}
 			else
 			{
-				memset(&a_Dest[(i * SectionBlockCount) + StartPos - a_Idx], 0, sizeof(BLOCKTYPE) * ToCopy);
+				memset(Dest, 0, sizeof(BLOCKTYPE) * ToCopy);
 			}
 		}
 	}
@@ -379,9 +484,21 @@ void cChunkData::CopyMetas(NIBBLETYPE * a_Dest) const
 		{
 			memcpy(&a_Dest[i * SectionBlockCount / 2], &m_Sections[i]->m_BlockMetas, sizeof(m_Sections[i]->m_BlockMetas));
 		}
+		else if (m_PaletteSections[i] != nullptr)
+		{
+			const sPaletteSection & Section = *m_PaletteSections[i];
+			NIBBLETYPE * Dest = &a_Dest[i * SectionBlockCount / 2];
+			for (size_t j = 0; j < SectionBlockCount; j += 2)
+			{
+				Dest[j / 2] = static_cast<NIBBLETYPE>(
+					(GetPaletteBlock(Section, j) & 0x0f) |
+					((GetPaletteBlock(Section, j + 1) & 0x0f) << 4)
+				);
+			}
+		}
 		else
 		{
-			memset(&a_Dest[i * SectionBlockCount / 2], 0, sizeof(m_Sections[i]->m_BlockMetas));
+			memset(&a_Dest[i * SectionBlockCount / 2], 0, SectionBlockCount / 2);
 		}
 	}
 }
@@ -394,14 +511,7 @@ void cChunkData::CopyBlockLight(NIBBLETYPE * a_Dest) const
 {
 	for (size_t i = 0; i < NumSections; i++)
 	{
-		if (m_Sections[i] != nullptr)
-		{
-			memcpy(&a_Dest[i * SectionBlockCount / 2], &m_Sections[i]->m_BlockLight, sizeof(m_Sections[i]->m_BlockLight));
-		}
-		else
-		{
-			memset(&a_Dest[i * SectionBlockCount / 2], 0, sizeof(m_Sections[i]->m_BlockLight));
-		}
+		CopySectionLight(m_BlockLight[i], m_UniformBlockLight[i], &a_Dest[i * SectionBlockCount / 2]);
 	}
 }
 
@@ -413,14 +523,7 @@ void cChunkData::CopySkyLight(NIBBLETYPE * a_Dest) const
 {
 	for (size_t i = 0; i < NumSections; i++)
 	{
-		if (m_Sections[i] != nullptr)
-		{
-			memcpy(&a_Dest[i * SectionBlockCount / 2], &m_Sections[i]->m_BlockSkyLight, sizeof(m_Sections[i]->m_BlockSkyLight));
-		}
-		else
-		{
-			memset(&a_Dest[i * SectionBlockCount / 2], 0xff, sizeof(m_Sections[i]->m_BlockSkyLight));
-		}
+		CopySectionLight(m_SkyLight[i], m_UniformSkyLight[i], &a_Dest[i * SectionBlockCount / 2]);
 	}
 }
 
@@ -434,26 +537,32 @@ void cChunkData::SetBlockTypes(const BLOCKTYPE * a_Src)
 	
 	for (size_t i = 0; i < NumSections; i++)
 	{
-		// If the section is already allocated, copy the data into it:
+		m_SectionRevisions[i] = 0;
+
+		// If the section is already allocated in the flat layout, copy the data into it:
 		if (m_Sections[i] != nullptr)
 		{
 			memcpy(m_Sections[i]->m_BlockTypes, &a_Src[i * SectionBlockCount], sizeof(m_Sections[i]->m_BlockTypes));
+			CountSectionBlocks(i, &a_Src[i * SectionBlockCount]);
 			continue;
 		}
 
 		// The section doesn't exist, find out if it is needed:
-		if (IsAllValue(a_Src + i * SectionBlockCount, SectionBlockCount, (const BLOCKTYPE)0))
+		if (
+			(m_PaletteSections[i] == nullptr) &&
+			IsAllValue(a_Src + i * SectionBlockCount, SectionBlockCount, (const BLOCKTYPE)0)
+		)
 		{
 			// No need for the section, the data is all-air
 			continue;
 		}
 		
-		// Allocate the section and copy the data into it:
-		m_Sections[i] = Allocate();
-		memcpy(m_Sections[i]->m_BlockTypes, &a_Src[i * SectionBlockCount], sizeof(m_Sections[i]->m_BlockTypes));
-		memset(m_Sections[i]->m_BlockMetas,    0x00, sizeof(m_Sections[i]->m_BlockMetas));
-		memset(m_Sections[i]->m_BlockLight,    0x00, sizeof(m_Sections[i]->m_BlockLight));
-		memset(m_Sections[i]->m_BlockSkyLight, 0xff, sizeof(m_Sections[i]->m_BlockSkyLight));
+		// Store the data, together with the current metas, in the best-fitting layout:
+		BLOCKTYPE  OldTypes[SectionBlockCount];
+		NIBBLETYPE Metas[SectionBlockCount / 2];
+		ReadSectionBlocks(i, OldTypes, Metas);
+		StoreSectionBlocks(i, &a_Src[i * SectionBlockCount], Metas);
+		CountSectionBlocks(i, &a_Src[i * SectionBlockCount]);
 	}  // for i - m_Sections[]
 }
 
@@ -466,7 +575,9 @@ void cChunkData::SetMetas(const NIBBLETYPE * a_Src)
 	
 	for (size_t i = 0; i < NumSections; i++)
 	{
-		// If the section is already allocated, copy the data into it:
+		m_SectionRevisions[i] = 0;
+
+		// If the section is already allocated in the flat layout, copy the data into it:
 		if (m_Sections[i] != nullptr)
 		{
 			memcpy(m_Sections[i]->m_BlockMetas, &a_Src[i * SectionBlockCount / 2], sizeof(m_Sections[i]->m_BlockMetas));
@@ -474,18 +585,20 @@ void cChunkData::SetMetas(const NIBBLETYPE * a_Src)
 		}
 		
 		// The section doesn't exist, find out if it is needed:
-		if (IsAllValue(a_Src + i * SectionBlockCount / 2, SectionBlockCount / 2, (NIBBLETYPE)0))
+		if (
+			(m_PaletteSections[i] == nullptr) &&
+			IsAllValue(a_Src + i * SectionBlockCount / 2, SectionBlockCount / 2, (NIBBLETYPE)0)
+		)
 		{
 			// No need for the section, the data is all zeroes
 			continue;
 		}
 		
-		// Allocate the section and copy the data into it:
-		m_Sections[i] = Allocate();
-		memcpy(m_Sections[i]->m_BlockMetas, &a_Src[i * SectionBlockCount / 2], sizeof(m_Sections[i]->m_BlockMetas));
-		memset(m_Sections[i]->m_BlockTypes,    0x00, sizeof(m_Sections[i]->m_BlockTypes));
-		memset(m_Sections[i]->m_BlockLight,    0x00, sizeof(m_Sections[i]->m_BlockLight));
-		memset(m_Sections[i]->m_BlockSkyLight, 0xff, sizeof(m_Sections[i]->m_BlockSkyLight));
+		// Store the data, together with the current blocktypes, in the best-fitting layout:
+		BLOCKTYPE  Types[SectionBlockCount];
+		NIBBLETYPE OldMetas[SectionBlockCount / 2];
+		ReadSectionBlocks(i, Types, OldMetas);
+		StoreSectionBlocks(i, Types, &a_Src[i * SectionBlockCount / 2]);
 	}  // for i - m_Sections[]
 }
 
@@ -502,27 +615,9 @@ void cChunkData::SetBlockLight(const NIBBLETYPE * a_Src)
 	
 	for (size_t i = 0; i < NumSections; i++)
 	{
-		// If the section is already allocated, copy the data into it:
-		if (m_Sections[i] != nullptr)
-		{
-			memcpy(m_Sections[i]->m_BlockLight, &a_Src[i * SectionBlockCount / 2], sizeof(m_Sections[i]->m_BlockLight));
-			continue;
-		}
-		
-		// The section doesn't exist, find out if it is needed:
-		if (IsAllValue(a_Src + i * SectionBlockCount / 2, SectionBlockCount / 2, (NIBBLETYPE)0))
-		{
-			// No need for the section, the data is all zeroes
-			continue;
-		}
-		
-		// Allocate the section and copy the data into it:
-		m_Sections[i] = Allocate();
-		memcpy(m_Sections[i]->m_BlockLight, &a_Src[i * SectionBlockCount / 2], sizeof(m_Sections[i]->m_BlockLight));
-		memset(m_Sections[i]->m_BlockTypes,    0x00, sizeof(m_Sections[i]->m_BlockTypes));
-		memset(m_Sections[i]->m_BlockMetas,    0x00, sizeof(m_Sections[i]->m_BlockMetas));
-		memset(m_Sections[i]->m_BlockSkyLight, 0xff, sizeof(m_Sections[i]->m_BlockSkyLight));
-	}  // for i - m_Sections[]
+		SetSectionLight(m_BlockLight[i], m_UniformBlockLight[i], &a_Src[i * SectionBlockCount / 2]);
+		m_SectionRevisions[i] = 0;
+	}
 }
 
 
@@ -537,27 +632,174 @@ void cChunkData::SetSkyLight(const NIBBLETYPE * a_Src)
 	
 	for (size_t i = 0; i < NumSections; i++)
 	{
-		// If the section is already allocated, copy the data into it:
-		if (m_Sections[i] != nullptr)
+		SetSectionLight(m_SkyLight[i], m_UniformSkyLight[i], &a_Src[i * SectionBlockCount / 2]);
+		m_SectionRevisions[i] = 0;
+	}
+}
+
+
+
+
+
+void cChunkData::SetSection(
+	size_t a_SectionIdx,
+	const BLOCKTYPE * a_BlockTypes, const NIBBLETYPE * a_BlockMetas,
+	const NIBBLETYPE * a_BlockLight, const NIBBLETYPE * a_SkyLight
+)
+{
+	ASSERT(a_SectionIdx < NumSections);
+	ASSERT(a_BlockTypes != nullptr);
+	m_SectionRevisions[a_SectionIdx] = 0;
+
+	NIBBLETYPE ZeroMetas[SectionBlockCount / 2];
+	if (a_BlockMetas == nullptr)
+	{
+		memset(ZeroMetas, 0, sizeof(ZeroMetas));
+		a_BlockMetas = ZeroMetas;
+	}
+
+	if (
+		IsAllValue(a_BlockTypes, SectionBlockCount, static_cast<BLOCKTYPE>(0)) &&
+		IsAllValue(a_BlockMetas, SectionBlockCount / 2, static_cast<NIBBLETYPE>(0))
+	)
+	{
+		// All air, no section needed:
+		Free(m_Sections[a_SectionIdx]);
+		m_Sections[a_SectionIdx] = nullptr;
+		FreePalette(m_PaletteSections[a_SectionIdx]);
+		m_PaletteSections[a_SectionIdx] = nullptr;
+		CountSectionBlocks(a_SectionIdx, nullptr);
+	}
+	else
+	{
+		StoreSectionBlocks(a_SectionIdx, a_BlockTypes, a_BlockMetas);
+		CountSectionBlocks(a_SectionIdx, a_BlockTypes);
+	}
+
+	if (a_BlockLight != nullptr)
+	{
+		SetSectionLight(m_BlockLight[a_SectionIdx], m_UniformBlockLight[a_SectionIdx], a_BlockLight);
+	}
+	if (a_SkyLight != nullptr)
+	{
+		SetSectionLight(m_SkyLight[a_SectionIdx], m_UniformSkyLight[a_SectionIdx], a_SkyLight);
+	}
+}
+
+
+
+
+
+size_t cChunkData::GetNumNonAirSections(void) const
+{
+	// A section may be allocated but contain only air (and possibly the metas of the air blocks), such sections are skipped:
+	for (size_t i = NumSections; i > 0; i--)
+	{
+		if (m_BlockCounts[i - 1][bcNonAir] > 0)
 		{
-			memcpy(m_Sections[i]->m_BlockSkyLight, &a_Src[i * SectionBlockCount / 2], sizeof(m_Sections[i]->m_BlockSkyLight));
-			continue;
+			return i;
 		}
+	}
+	return 0;
+}
 
-		// The section doesn't exist, find out if it is needed:
-		if (IsAllValue(a_Src + i * SectionBlockCount / 2, SectionBlockCount / 2, (NIBBLETYPE)0xff))
+
+
+
+
+size_t cChunkData::GetNumNonEmptySections(void) const
+{
+	for (size_t i = NumSections; i > 0; i--)
+	{
+		if (
+			(m_BlockCounts[i - 1][bcNonAir] > 0) ||
+			(m_BlockLight[i - 1] != nullptr) || (m_UniformBlockLight[i - 1] != 0) ||
+			(m_SkyLight[i - 1] != nullptr) || (m_UniformSkyLight[i - 1] != 0x0f)
+		)
 		{
-			// No need for the section, the data is all zeroes
-			continue;
+			return i;
 		}
-		
-		// Allocate the section and copy the data into it:
-		m_Sections[i] = Allocate();
-		memcpy(m_Sections[i]->m_BlockSkyLight, &a_Src[i * SectionBlockCount / 2], sizeof(m_Sections[i]->m_BlockSkyLight));
-		memset(m_Sections[i]->m_BlockTypes, 0x00, sizeof(m_Sections[i]->m_BlockTypes));
-		memset(m_Sections[i]->m_BlockMetas, 0x00, sizeof(m_Sections[i]->m_BlockMetas));
-		memset(m_Sections[i]->m_BlockLight, 0x00, sizeof(m_Sections[i]->m_BlockLight));
-	}  // for i - m_Sections[]
+	}
+	return 0;
+}
+
+
+
+
+
+UInt32 cChunkData::GetSectionRevision(size_t a_SectionIdx) const
+{
+	ASSERT(a_SectionIdx < NumSections);
+	if (m_SectionRevisions[a_SectionIdx] == 0)
+	{
+		UInt32 Revision;
+		do
+		{
+			Revision = g_NextSectionRevision++;
+		} while (Revision == 0);  // Skip the "changed" marker on wraparound
+		m_SectionRevisions[a_SectionIdx] = Revision;
+	}
+	return m_SectionRevisions[a_SectionIdx];
+}
+
+
+
+
+
+int cChunkData::GetBlockCount(eBlockCategory a_Category) const
+{
+	ASSERT((a_Category >= 0) && (a_Category < bcCount));
+	int res = 0;
+	for (size_t i = 0; i < NumSections; i++)
+	{
+		res += m_BlockCounts[i][a_Category];
+	}
+	return res;
+}
+
+
+
+
+
+void cChunkData::SetBlockTypeCategory(BLOCKTYPE a_BlockType, eBlockCategory a_Category, bool a_IsInCategory)
+{
+	ASSERT((a_Category > bcNonAir) && (a_Category < bcCount));
+	if (a_IsInCategory)
+	{
+		ms_BlockCategories[a_BlockType] |= static_cast<UInt8>(1 << a_Category);
+	}
+	else
+	{
+		ms_BlockCategories[a_BlockType] &= static_cast<UInt8>(~(1 << a_Category));
+	}
+}
+
+
+
+
+
+void cChunkData::AddMemoryStats(size_t & a_NumFlatSections, size_t & a_NumPaletteSections, size_t & a_NumHeapBytes) const
+{
+	for (size_t i = 0; i < NumSections; i++)
+	{
+		if (m_Sections[i] != nullptr)
+		{
+			a_NumFlatSections += 1;
+		}
+		if (m_PaletteSections[i] != nullptr)
+		{
+			a_NumPaletteSections += 1;
+			a_NumHeapBytes += sizeof(sPaletteSection) + m_PaletteSections[i]->m_Indices.capacity();
+		}
+		if (m_BlockLight[i] != nullptr)
+		{
+			a_NumHeapBytes += SectionBlockCount / 2;
+		}
+		if (m_SkyLight[i] != nullptr)
+		{
+			a_NumHeapBytes += SectionBlockCount / 2;
+		}
+	}
 }
 
 
@@ -586,8 +828,464 @@ void cChunkData::ZeroSection(cChunkData::sChunkSection * a_Section) const
 {
 	memset(a_Section->m_BlockTypes,    0x00, sizeof(a_Section->m_BlockTypes));
 	memset(a_Section->m_BlockMetas,    0x00, sizeof(a_Section->m_BlockMetas));
-	memset(a_Section->m_BlockLight,    0x00, sizeof(a_Section->m_BlockLight));
-	memset(a_Section->m_BlockSkyLight, 0xff, sizeof(a_Section->m_BlockSkyLight));
+}
+
+
+
+
+
+cChunkData::sPaletteSection * cChunkData::AllocatePalette(void)
+{
+	sPaletteSection * Section = new sPaletteSection;
+	Section->m_Palette[0] = 0;
+	Section->m_PaletteSize = 1;
+	Section->m_BitsPerBlock = 0;
+	return Section;
+}
+
+
+
+
+
+void cChunkData::FreePalette(cChunkData::sPaletteSection * a_Section)
+{
+	delete a_Section;
+}
+
+
+
+
+
+UInt16 cChunkData::GetPaletteBlock(const cChunkData::sPaletteSection & a_Section, size_t a_Index)
+{
+	ASSERT(a_Index < SectionBlockCount);
+	if (a_Section.m_BitsPerBlock == 0)
+	{
+		return a_Section.m_Palette[0];
+	}
+	size_t BitPos = a_Index * a_Section.m_BitsPerBlock;
+	size_t Mask = (1u << a_Section.m_BitsPerBlock) - 1;
+	size_t PaletteIdx = (a_Section.m_Indices[BitPos / 8] >> (BitPos % 8)) & Mask;
+	ASSERT(PaletteIdx < a_Section.m_PaletteSize);
+	return a_Section.m_Palette[PaletteIdx];
+}
+
+
+
+
+
+void cChunkData::SetPaletteBlock(size_t a_SectionIdx, size_t a_Index, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+	ASSERT(m_PaletteSections[a_SectionIdx] != nullptr);
+	sPaletteSection & Section = *m_PaletteSections[a_SectionIdx];
+	UInt16 Value = static_cast<UInt16>((a_BlockType << 4) | (a_BlockMeta & 0x0f));
+	size_t PaletteIdx = FindOrAddPaletteEntry(Section, Value);
+	if (PaletteIdx >= MaxPaletteSize)
+	{
+		// The palette is full, switch to the flat layout:
+		PromoteSection(a_SectionIdx);
+		sChunkSection & Flat = *m_Sections[a_SectionIdx];
+		Flat.m_BlockTypes[a_Index] = a_BlockType;
+		Flat.m_BlockMetas[a_Index / 2] = static_cast<NIBBLETYPE>(
+			(Flat.m_BlockMetas[a_Index / 2] & (0xf0 >> ((a_Index & 1) * 4))) |  // The untouched nibble
+			((a_BlockMeta & 0x0f) << ((a_Index & 1) * 4))  // The nibble being set
+		);
+		return;
+	}
+	if (Section.m_BitsPerBlock == 0)
+	{
+		// All blocks are the single palette entry, the index must be 0:
+		ASSERT(PaletteIdx == 0);
+		return;
+	}
+	size_t BitPos = a_Index * Section.m_BitsPerBlock;
+	UInt8 Mask = static_cast<UInt8>(((1u << Section.m_BitsPerBlock) - 1) << (BitPos % 8));
+	UInt8 & Byte = Section.m_Indices[BitPos / 8];
+	Byte = static_cast<UInt8>((Byte & ~Mask) | ((PaletteIdx << (BitPos % 8)) & Mask));
+}
+
+
+
+
+
+size_t cChunkData::FindOrAddPaletteEntry(cChunkData::sPaletteSection & a_Section, UInt16 a_Value)
+{
+	for (size_t i = 0; i < a_Section.m_PaletteSize; i++)
+	{
+		if (a_Section.m_Palette[i] == a_Value)
+		{
+			return i;
+		}
+	}
+
+	// Not found, add a new entry, making room for it if needed:
+	if (a_Section.m_PaletteSize >= MaxPaletteSize)
+	{
+		CompactPalette(a_Section);
+		if (a_Section.m_PaletteSize >= MaxPaletteSize)
+		{
+			return MaxPaletteSize;
+		}
+	}
+	size_t NewIdx = a_Section.m_PaletteSize;
+	a_Section.m_Palette[NewIdx] = a_Value;
+	a_Section.m_PaletteSize += 1;
+
+	// Widen the indices, if needed:
+	size_t NeededBits = a_Section.m_BitsPerBlock;
+	while ((1u << NeededBits) < a_Section.m_PaletteSize)
+	{
+		NeededBits = (NeededBits == 0) ? 1 : NeededBits * 2;
+	}
+	if (NeededBits != a_Section.m_BitsPerBlock)
+	{
+		RepackPalette(a_Section, NeededBits);
+	}
+	return NewIdx;
+}
+
+
+
+
+
+void cChunkData::RepackPalette(cChunkData::sPaletteSection & a_Section, size_t a_NewBitsPerBlock)
+{
+	ASSERT((a_NewBitsPerBlock == 0) || (a_NewBitsPerBlock == 1) || (a_NewBitsPerBlock == 2) || (a_NewBitsPerBlock == 4));
+	std::vector<UInt8> NewIndices(SectionBlockCount * a_NewBitsPerBlock / 8, 0);
+	if ((a_NewBitsPerBlock > 0) && (a_Section.m_BitsPerBlock > 0))
+	{
+		size_t OldMask = (1u << a_Section.m_BitsPerBlock) - 1;
+		for (size_t i = 0; i < SectionBlockCount; i++)
+		{
+			size_t OldBitPos = i * a_Section.m_BitsPerBlock;
+			size_t PaletteIdx = (a_Section.m_Indices[OldBitPos / 8] >> (OldBitPos % 8)) & OldMask;
+			size_t NewBitPos = i * a_NewBitsPerBlock;
+			NewIndices[NewBitPos / 8] |= static_cast<UInt8>(PaletteIdx << (NewBitPos % 8));
+		}
+	}
+	// Else: either the old indices were all zero, or the new ones are (and the caller guarantees there's only one entry)
+	a_Section.m_Indices.swap(NewIndices);
+	a_Section.m_BitsPerBlock = a_NewBitsPerBlock;
+}
+
+
+
+
+
+void cChunkData::CompactPalette(cChunkData::sPaletteSection & a_Section)
+{
+	if (a_Section.m_BitsPerBlock == 0)
+	{
+		// Nothing to compact, the single entry is used by all blocks
+		return;
+	}
+
+	// Find the used entries and assign them new indices:
+	size_t Mask = (1u << a_Section.m_BitsPerBlock) - 1;
+	bool IsUsed[MaxPaletteSize] = {false};
+	for (size_t i = 0; i < SectionBlockCount; i++)
+	{
+		size_t BitPos = i * a_Section.m_BitsPerBlock;
+		IsUsed[(a_Section.m_Indices[BitPos / 8] >> (BitPos % 8)) & Mask] = true;
+	}
+	size_t Remap[MaxPaletteSize];
+	size_t NewSize = 0;
+	for (size_t i = 0; i < a_Section.m_PaletteSize; i++)
+	{
+		if (IsUsed[i])
+		{
+			Remap[i] = NewSize;
+			a_Section.m_Palette[NewSize] = a_Section.m_Palette[i];
+			NewSize += 1;
+		}
+	}
+	if (NewSize == a_Section.m_PaletteSize)
+	{
+		// All entries are in use
+		return;
+	}
+
+	// Rewrite the indices using the new palette numbering and the fewest bits possible:
+	size_t NewBits = 0;
+	while ((1u << NewBits) < NewSize)
+	{
+		NewBits = (NewBits == 0) ? 1 : NewBits * 2;
+	}
+	std::vector<UInt8> NewIndices(SectionBlockCount * NewBits / 8, 0);
+	if (NewBits > 0)
+	{
+		for (size_t i = 0; i < SectionBlockCount; i++)
+		{
+			size_t OldBitPos = i * a_Section.m_BitsPerBlock;
+			size_t PaletteIdx = Remap[(a_Section.m_Indices[OldBitPos / 8] >> (OldBitPos % 8)) & Mask];
+			size_t NewBitPos = i * NewBits;
+			NewIndices[NewBitPos / 8] |= static_cast<UInt8>(PaletteIdx << (NewBitPos % 8));
+		}
+	}
+	a_Section.m_Indices.swap(NewIndices);
+	a_Section.m_BitsPerBlock = NewBits;
+	a_Section.m_PaletteSize = NewSize;
+}
+
+
+
+
+
+void cChunkData::PromoteSection(size_t a_SectionIdx)
+{
+	ASSERT(m_Sections[a_SectionIdx] == nullptr);
+	ASSERT(m_PaletteSections[a_SectionIdx] != nullptr);
+	sChunkSection * Flat = Allocate();
+	if (Flat == nullptr)
+	{
+		ASSERT(!"Failed to allocate a new section in Chunkbuffer");
+		return;
+	}
+	ReadSectionBlocks(a_SectionIdx, Flat->m_BlockTypes, Flat->m_BlockMetas);
+	FreePalette(m_PaletteSections[a_SectionIdx]);
+	m_PaletteSections[a_SectionIdx] = nullptr;
+	m_Sections[a_SectionIdx] = Flat;
+}
+
+
+
+
+
+void cChunkData::StoreSectionBlocks(size_t a_SectionIdx, const BLOCKTYPE * a_BlockTypes, const NIBBLETYPE * a_BlockMetas)
+{
+	// Collect the palette, bail out as soon as it overflows.
+	// PaletteIdx[] maps each (BlockType << 4) | BlockMeta value to its palette index + 1, 0 meaning not in the palette yet:
+	UInt8 PaletteIdx[256 * 16];
+	memset(PaletteIdx, 0, sizeof(PaletteIdx));
+	UInt16 Palette[MaxPaletteSize];
+	size_t PaletteSize = 0;
+	for (size_t i = 0; i < SectionBlockCount; i++)
+	{
+		UInt16 Value = static_cast<UInt16>((a_BlockTypes[i] << 4) | ((a_BlockMetas[i / 2] >> ((i & 1) * 4)) & 0x0f));
+		if (PaletteIdx[Value] != 0)
+		{
+			continue;
+		}
+		if (PaletteSize >= MaxPaletteSize)
+		{
+			PaletteSize = MaxPaletteSize + 1;
+			break;
+		}
+		Palette[PaletteSize] = Value;
+		PaletteSize += 1;
+		PaletteIdx[Value] = static_cast<UInt8>(PaletteSize);
+	}
+
+	if (PaletteSize > MaxPaletteSize)
+	{
+		// Too many distinct blocks, use the flat layout:
+		if (m_Sections[a_SectionIdx] == nullptr)
+		{
+			if (m_PaletteSections[a_SectionIdx] != nullptr)
+			{
+				PromoteSection(a_SectionIdx);
+			}
+			else
+			{
+				m_Sections[a_SectionIdx] = Allocate();
+				if (m_Sections[a_SectionIdx] == nullptr)
+				{
+					ASSERT(!"Failed to allocate a new section in Chunkbuffer");
+					return;
+				}
+				ZeroSection(m_Sections[a_SectionIdx]);
+			}
+		}
+		memcpy(m_Sections[a_SectionIdx]->m_BlockTypes, a_BlockTypes, sizeof(m_Sections[a_SectionIdx]->m_BlockTypes));
+		memcpy(m_Sections[a_SectionIdx]->m_BlockMetas, a_BlockMetas, sizeof(m_Sections[a_SectionIdx]->m_BlockMetas));
+		return;
+	}
+
+	// The data fits into a palette, make sure the section uses the palette layout:
+	if (m_PaletteSections[a_SectionIdx] == nullptr)
+	{
+		m_PaletteSections[a_SectionIdx] = AllocatePalette();
+		Free(m_Sections[a_SectionIdx]);
+		m_Sections[a_SectionIdx] = nullptr;
+	}
+	sPaletteSection & Section = *m_PaletteSections[a_SectionIdx];
+	memcpy(Section.m_Palette, Palette, PaletteSize * sizeof(Palette[0]));
+	Section.m_PaletteSize = PaletteSize;
+	size_t Bits = 0;
+	while ((1u << Bits) < PaletteSize)
+	{
+		Bits = (Bits == 0) ? 1 : Bits * 2;
+	}
+	Section.m_BitsPerBlock = Bits;
+	Section.m_Indices.assign(SectionBlockCount * Bits / 8, 0);
+	if (Bits == 0)
+	{
+		return;
+	}
+	for (size_t i = 0; i < SectionBlockCount; i++)
+	{
+		UInt16 Value = static_cast<UInt16>((a_BlockTypes[i] << 4) | ((a_BlockMetas[i / 2] >> ((i & 1) * 4)) & 0x0f));
+		size_t BitPos = i * Bits;
+		Section.m_Indices[BitPos / 8] |= static_cast<UInt8>((PaletteIdx[Value] - 1) << (BitPos % 8));
+	}
+}
+
+
+
+
+
+void cChunkData::ReadSectionBlocks(size_t a_SectionIdx, BLOCKTYPE * a_BlockTypes, NIBBLETYPE * a_BlockMetas) const
+{
+	if (m_Sections[a_SectionIdx] != nullptr)
+	{
+		memcpy(a_BlockTypes, m_Sections[a_SectionIdx]->m_BlockTypes, sizeof(m_Sections[a_SectionIdx]->m_BlockTypes));
+		memcpy(a_BlockMetas, m_Sections[a_SectionIdx]->m_BlockMetas, sizeof(m_Sections[a_SectionIdx]->m_BlockMetas));
+		return;
+	}
+	if (m_PaletteSections[a_SectionIdx] == nullptr)
+	{
+		memset(a_BlockTypes, 0, SectionBlockCount);
+		memset(a_BlockMetas, 0, SectionBlockCount / 2);
+		return;
+	}
+	const sPaletteSection & Section = *m_PaletteSections[a_SectionIdx];
+	for (size_t i = 0; i < SectionBlockCount; i += 2)
+	{
+		UInt16 Lo = GetPaletteBlock(Section, i);
+		UInt16 Hi = GetPaletteBlock(Section, i + 1);
+		a_BlockTypes[i]     = static_cast<BLOCKTYPE>(Lo >> 4);
+		a_BlockTypes[i + 1] = static_cast<BLOCKTYPE>(Hi >> 4);
+		a_BlockMetas[i / 2] = static_cast<NIBBLETYPE>((Lo & 0x0f) | ((Hi & 0x0f) << 4));
+	}
+}
+
+
+
+
+
+void cChunkData::SetSectionLight(NIBBLETYPE *& a_Array, NIBBLETYPE & a_UniformValue, const NIBBLETYPE * a_Src)
+{
+	// If both nibbles of the first byte are the same and the entire section repeats the byte, the light is uniform:
+	NIBBLETYPE First = a_Src[0];
+	if (((First >> 4) == (First & 0x0f)) && IsAllValue(a_Src, SectionBlockCount / 2, First))
+	{
+		delete[] a_Array;
+		a_Array = nullptr;
+		a_UniformValue = First & 0x0f;
+		return;
+	}
+
+	if (a_Array == nullptr)
+	{
+		a_Array = new NIBBLETYPE[SectionBlockCount / 2];
+	}
+	memcpy(a_Array, a_Src, SectionBlockCount / 2);
+}
+
+
+
+
+
+void cChunkData::CopySectionLight(const NIBBLETYPE * a_Array, NIBBLETYPE a_UniformValue, NIBBLETYPE * a_Dest)
+{
+	if (a_Array != nullptr)
+	{
+		memcpy(a_Dest, a_Array, SectionBlockCount / 2);
+	}
+	else
+	{
+		memset(a_Dest, a_UniformValue * 0x11, SectionBlockCount / 2);
+	}
+}
+
+
+
+
+
+NIBBLETYPE * cChunkData::CloneSectionLight(const NIBBLETYPE * a_Array)
+{
+	if (a_Array == nullptr)
+	{
+		return nullptr;
+	}
+	NIBBLETYPE * Res = new NIBBLETYPE[SectionBlockCount / 2];
+	memcpy(Res, a_Array, SectionBlockCount / 2);
+	return Res;
+}
+
+
+
+
+
+void cChunkData::UpdateBlockCounts(size_t a_SectionIdx, BLOCKTYPE a_OldBlockType, BLOCKTYPE a_NewBlockType)
+{
+	if (a_OldBlockType == a_NewBlockType)
+	{
+		return;
+	}
+	UInt16 * Counts = m_BlockCounts[a_SectionIdx];
+	if (a_OldBlockType == 0x00)
+	{
+		Counts[bcNonAir] = static_cast<UInt16>(Counts[bcNonAir] + 1);
+	}
+	else if (a_NewBlockType == 0x00)
+	{
+		Counts[bcNonAir] = static_cast<UInt16>(Counts[bcNonAir] - 1);
+	}
+	UInt8 OldCategories = ms_BlockCategories[a_OldBlockType];
+	UInt8 NewCategories = ms_BlockCategories[a_NewBlockType];
+	if (OldCategories == NewCategories)
+	{
+		return;
+	}
+	for (int i = bcNonAir + 1; i < bcCount; i++)
+	{
+		bool WasIn = ((OldCategories >> i) & 1) != 0;
+		bool IsIn  = ((NewCategories >> i) & 1) != 0;
+		if (WasIn != IsIn)
+		{
+			ASSERT(WasIn ? (Counts[i] > 0) : (Counts[i] < SectionBlockCount));
+			Counts[i] = static_cast<UInt16>(IsIn ? (Counts[i] + 1) : (Counts[i] - 1));
+		}
+	}
+}
+
+
+
+
+
+void cChunkData::CountSectionBlocks(size_t a_SectionIdx, const BLOCKTYPE * a_BlockTypes)
+{
+	UInt16 * Counts = m_BlockCounts[a_SectionIdx];
+	memset(Counts, 0, sizeof(m_BlockCounts[a_SectionIdx]));
+	if (a_BlockTypes == nullptr)
+	{
+		return;
+	}
+
+	// Count the blocks per type first, then distribute the counts into the categories:
+	UInt16 NumPerType[256];
+	memset(NumPerType, 0, sizeof(NumPerType));
+	for (size_t i = 0; i < SectionBlockCount; i++)
+	{
+		NumPerType[a_BlockTypes[i]] = static_cast<UInt16>(NumPerType[a_BlockTypes[i]] + 1);
+	}
+	Counts[bcNonAir] = static_cast<UInt16>(SectionBlockCount - NumPerType[0]);
+	for (size_t BlockType = 0; BlockType < ARRAYCOUNT(NumPerType); BlockType++)
+	{
+		UInt8 Categories = ms_BlockCategories[BlockType];
+		if ((NumPerType[BlockType] == 0) || (Categories == 0))
+		{
+			continue;
+		}
+		for (int i = bcNonAir + 1; i < bcCount; i++)
+		{
+			if (((Categories >> i) & 1) != 0)
+			{
+				Counts[i] = static_cast<UInt16>(Counts[i] + NumPerType[BlockType]);
+			}
+		}
+	}
 }
 
 
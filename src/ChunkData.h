@@ -11,6 +11,7 @@
 
 
 #include <cstring>
+#include <vector>
 
 
 #include "ChunkDef.h"
@@ -27,15 +28,23 @@
 
 class cChunkData
 {
-private:
+public:
 
+	/** The chunk data is stored in sections of SectionHeight full layers, each allocated only when needed. */
 	static const size_t SectionHeight = 16;
 	static const size_t NumSections = (cChunkDef::Height / SectionHeight);
 	static const size_t SectionBlockCount = SectionHeight * cChunkDef::Width * cChunkDef::Width;
 
+private:
+
+	/** Maximum number of distinct blocks (type + meta combinations) a palette section can hold
+	before it is promoted to the flat sChunkSection layout. */
+	static const size_t MaxPaletteSize = 16;
+
 public:
 
 	struct sChunkSection;
+	struct sPaletteSection;
 
 	cChunkData(cAllocationPool<cChunkData::sChunkSection> & a_Pool);
 	~cChunkData();
@@ -70,10 +79,12 @@ public:
 	/** Copies the metadata into the specified flat array. */
 	void CopyMetas(NIBBLETYPE * a_Dest) const;
 
-	/** Copies the block light data into the specified flat array. */
+	/** Copies the block light data into the specified flat array.
+	Sections with uniform light are filled in directly, without any stored array. */
 	void CopyBlockLight(NIBBLETYPE * a_Dest) const;
 
-	/** Copies the skylight data into the specified flat array. */
+	/** Copies the skylight data into the specified flat array.
+	Sections with uniform light are filled in directly, without any stored array. */
 	void CopySkyLight  (NIBBLETYPE * a_Dest) const;
 	
 	/** Copies the blocktype data from the specified flat array into the internal representation.
@@ -87,21 +98,81 @@ public:
 	void SetMetas(const NIBBLETYPE * a_Src);
 
 	/** Copies the blocklight data from the specified flat array into the internal representation.
-	Allocates sectios that are needed for the operation.
+	Sections whose light values are all the same are stored as a single uniform value.
 	Allows a_Src to be nullptr, in which case it doesn't do anything. */
 	void SetBlockLight(const NIBBLETYPE * a_Src);
 
 	/** Copies the skylight data from the specified flat array into the internal representation.
-	Allocates sectios that are needed for the operation.
+	Sections whose light values are all the same are stored as a single uniform value.
 	Allows a_Src to be nullptr, in which case it doesn't do anything. */
 	void SetSkyLight(const NIBBLETYPE * a_Src);
 
+	/** Sets the whole section a_SectionIdx from the specified per-section arrays, storing it in the best-fitting layout.
+	Used by the loaders to fill the data section by section, without going through the full-chunk flat arrays.
+	a_BlockTypes must be valid; a nullptr a_BlockMetas means all zero metas.
+	A nullptr a_BlockLight or a_SkyLight leaves the respective light of the section unchanged. */
+	void SetSection(
+		size_t a_SectionIdx,
+		const BLOCKTYPE * a_BlockTypes, const NIBBLETYPE * a_BlockMetas,
+		const NIBBLETYPE * a_BlockLight, const NIBBLETYPE * a_SkyLight
+	);
+
+	/** Returns the number of sections from the bottom up to and including the topmost section that has any non-air block.
+	All the sections above it are air, so the processing of the blocks can stop there. */
+	size_t GetNumNonAirSections(void) const;
+
+	/** Returns the number of sections from the bottom up to and including the topmost section that isn't empty.
+	All the sections above it are air with no blocklight and full skylight, so they can be left out of the serialized data. */
+	size_t GetNumNonEmptySections(void) const;
+
+	/** Returns the revision of the specified section's contents - the blocks, metas and both lights.
+	The revision changes whenever the section does and is unique across all the chunks, so that data derived from a section,
+	such as its serialized form, can be reused for as long as the section's revision stays the same. */
+	UInt32 GetSectionRevision(size_t a_SectionIdx) const;
+
+	/** Returns the number of blocks of the specified category in the section. Maintained on each change of the block types,
+	so that the queries don't need to walk the blocks. */
+	int GetSectionBlockCount(size_t a_SectionIdx, eBlockCategory a_Category) const
+	{
+		ASSERT(a_SectionIdx < NumSections);
+		ASSERT((a_Category >= 0) && (a_Category < bcCount));
+		return m_BlockCounts[a_SectionIdx][a_Category];
+	}
+
+	/** Returns the number of blocks of the specified category in the whole chunk. */
+	int GetBlockCount(eBlockCategory a_Category) const;
+
+	/** Sets whether the block type belongs to the specified category (other than bcNonAir, which is given by the block type).
+	The categories are shared by all instances and must be set up before any cChunkData is filled; cBlockInfo does so
+	when it is initialized. */
+	static void SetBlockTypeCategory(BLOCKTYPE a_BlockType, eBlockCategory a_Category, bool a_IsInCategory);
+
+	/** Adds the number of the flat (pool-allocated) and palette sections to the counters, and the heap memory used by
+	the palette sections and the light arrays to a_NumHeapBytes. */
+	void AddMemoryStats(size_t & a_NumFlatSections, size_t & a_NumPaletteSections, size_t & a_NumHeapBytes) const;
+
 	struct sChunkSection
 	{
 		BLOCKTYPE  m_BlockTypes   [SectionHeight * 16 * 16]    ;
 		NIBBLETYPE m_BlockMetas   [SectionHeight * 16 * 16 / 2];
-		NIBBLETYPE m_BlockLight   [SectionHeight * 16 * 16 / 2];
-		NIBBLETYPE m_BlockSkyLight[SectionHeight * 16 * 16 / 2];
+	};
+
+	/** Compact section layout used while the section holds at most MaxPaletteSize distinct blocks.
+	Each block is stored as an index into m_Palette, using m_BitsPerBlock bits (0, 1, 2 or 4).
+	With 0 bits per block, the whole section consists of m_Palette[0] and m_Indices is empty. */
+	struct sPaletteSection
+	{
+		/** The distinct blocks in the section, each stored as (BlockType << 4) | BlockMeta. */
+		UInt16 m_Palette[MaxPaletteSize];
+
+		/** Number of valid entries in m_Palette. */
+		size_t m_PaletteSize;
+
+		/** Number of bits used for each block's index into m_Palette. */
+		size_t m_BitsPerBlock;
+
+		/** The packed palette indices, SectionBlockCount * m_BitsPerBlock / 8 bytes. */
+		std::vector<UInt8> m_Indices;
 	};
 	
 private:
@@ -110,8 +181,36 @@ private:
 	mutable bool m_IsOwner;
 	#endif
 
+	/** The sections stored in the flat layout. For each index, at most one of m_Sections[] and m_PaletteSections[] is non-null. */
 	sChunkSection * m_Sections[NumSections];
 
+	/** The sections stored in the palette-compressed layout. */
+	sPaletteSection * m_PaletteSections[NumSections];
+
+	/** The blocklight of each section, independent of the section's block storage.
+	nullptr means that the whole section has the light value stored in m_UniformBlockLight[]. */
+	NIBBLETYPE * m_BlockLight[NumSections];
+
+	/** The skylight of each section, independent of the section's block storage.
+	nullptr means that the whole section has the light value stored in m_UniformSkyLight[]. */
+	NIBBLETYPE * m_SkyLight[NumSections];
+
+	/** The light value of the sections whose m_BlockLight[] is nullptr. */
+	NIBBLETYPE m_UniformBlockLight[NumSections];
+
+	/** The light value of the sections whose m_SkyLight[] is nullptr. */
+	NIBBLETYPE m_UniformSkyLight[NumSections];
+
+	/** The number of blocks of each category in each section, see GetSectionBlockCount(). */
+	UInt16 m_BlockCounts[NumSections][bcCount];
+
+	/** The revision of each section, see GetSectionRevision(). 0 means the section has changed since its revision was last
+	asked for; the new revision is only assigned then, so that the changes themselves only need to clear it. */
+	mutable UInt32 m_SectionRevisions[NumSections];
+
+	/** The categories of each block type, as a bitmask of (1 << eBlockCategory), see SetBlockTypeCategory(). */
+	static UInt8 ms_BlockCategories[256];
+
 	cAllocationPool<cChunkData::sChunkSection> & m_Pool;
 	
 	/** Allocates a new section. Entry-point to custom allocators. */
@@ -124,6 +223,57 @@ private:
 	/** Sets the data in the specified section to their default values. */
 	void ZeroSection(sChunkSection * a_Section) const;
 
+	/** Allocates a new palette section, filled with air. */
+	sPaletteSection * AllocatePalette(void);
+
+	/** Frees the specified palette section, previously allocated using AllocatePalette().
+	Note that a_Section may be nullptr. */
+	void FreePalette(sPaletteSection * a_Section);
+
+	/** Returns the (BlockType << 4) | BlockMeta value stored in the palette section for the specified block index. */
+	static UInt16 GetPaletteBlock(const sPaletteSection & a_Section, size_t a_Index);
+
+	/** Sets the specified block in the palette section a_SectionIdx to the specified type and meta.
+	If the palette overflows, the section is promoted to the flat layout and the block is set there. */
+	void SetPaletteBlock(size_t a_SectionIdx, size_t a_Index, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
+
+	/** Returns the palette index for the specified block value, adding it to the palette if not present.
+	Returns MaxPaletteSize if the palette is full even after removing unused entries. */
+	static size_t FindOrAddPaletteEntry(sPaletteSection & a_Section, UInt16 a_Value);
+
+	/** Re-packs the palette indices using the specified number of bits per block. */
+	static void RepackPalette(sPaletteSection & a_Section, size_t a_NewBitsPerBlock);
+
+	/** Removes palette entries that aren't used by any block, and re-packs the indices to the fewest bits possible. */
+	static void CompactPalette(sPaletteSection & a_Section);
+
+	/** Converts the palette section at the specified index into a flat section. */
+	void PromoteSection(size_t a_SectionIdx);
+
+	/** Stores the specified blocktypes and (packed) metas into section a_SectionIdx, choosing the palette
+	layout if the data fits into the palette, and the flat layout otherwise. */
+	void StoreSectionBlocks(size_t a_SectionIdx, const BLOCKTYPE * a_BlockTypes, const NIBBLETYPE * a_BlockMetas);
+
+	/** Copies the blocktypes and (packed) metas of the section into the specified arrays.
+	Works for both section layouts and for non-existent sections. */
+	void ReadSectionBlocks(size_t a_SectionIdx, BLOCKTYPE * a_BlockTypes, NIBBLETYPE * a_BlockMetas) const;
+
+	/** Stores the specified light data for a single section into a_Array, or marks it as uniform in a_UniformValue
+	(freeing a_Array) if all the values in a_Src are the same. */
+	static void SetSectionLight(NIBBLETYPE *& a_Array, NIBBLETYPE & a_UniformValue, const NIBBLETYPE * a_Src);
+
+	/** Copies the light data of a single section into a_Dest; fills in the uniform value if a_Array is nullptr. */
+	static void CopySectionLight(const NIBBLETYPE * a_Array, NIBBLETYPE a_UniformValue, NIBBLETYPE * a_Dest);
+
+	/** Returns a heap copy of the section light array, or nullptr if a_Array is nullptr. */
+	static NIBBLETYPE * CloneSectionLight(const NIBBLETYPE * a_Array);
+
+	/** Updates the section's block counts for a single block changing its type from a_OldBlockType to a_NewBlockType. */
+	void UpdateBlockCounts(size_t a_SectionIdx, BLOCKTYPE a_OldBlockType, BLOCKTYPE a_NewBlockType);
+
+	/** Recounts the section's block counts from the specified block types of the whole section; nullptr means all air. */
+	void CountSectionBlocks(size_t a_SectionIdx, const BLOCKTYPE * a_BlockTypes);
+
 };
 
 
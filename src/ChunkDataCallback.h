@@ -31,6 +31,9 @@ public:
 	*/
 	virtual bool Coords(int a_ChunkX, int a_ChunkZ) { UNUSED(a_ChunkX); UNUSED(a_ChunkZ); return true; }
 	
+	/// Called once to provide the revision of the chunk contents (see cChunk::GetRevision())
+	virtual void Revision(UInt32 a_Revision) { UNUSED(a_Revision); }
+	
 	/// Called once to provide heightmap data
 	virtual void HeightMap(const cChunkDef::HeightMap * a_HeightMap) { UNUSED(a_HeightMap); }
 	
@@ -111,10 +114,20 @@ public:
 	cChunkDef::BlockNibbles m_BlockLight;
 	cChunkDef::BlockNibbles m_BlockSkyLight;
 
+	/** Number of the sections, from the bottom up, that aren't empty (cChunkData::GetNumNonEmptySections()).
+	The data above them is all air with no blocklight and full skylight. */
+	size_t m_NumSections;
+
+	cChunkDataSeparateCollector(void) :
+		m_NumSections(cChunkData::NumSections)
+	{
+	}
+
 protected:
 
 	virtual void ChunkData(const cChunkData & a_ChunkBuffer) override
 	{
+		m_NumSections = a_ChunkBuffer.GetNumNonEmptySections();
 		a_ChunkBuffer.CopyBlockTypes(m_BlockTypes);
 		a_ChunkBuffer.CopyMetas(m_BlockMetas);
 		a_ChunkBuffer.CopyBlockLight(m_BlockLight);
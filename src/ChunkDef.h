@@ -48,6 +48,17 @@ typedef unsigned char NIBBLETYPE;
 /// The type used by the heightmap
 typedef unsigned char HEIGHTTYPE;
 
+/** The categories of blocks that cChunkData counts in each chunk section, see cWorld::GetChunkBlockCount(). */
+enum eBlockCategory
+{
+	bcNonAir,        ///< Any block other than air
+	bcLightSource,   ///< Blocks emitting light on their own (cBlockInfo::GetLightValue() > 0)
+	bcFluid,         ///< Water and lava, both flowing and stationary
+	bcRandomTicked,  ///< Blocks that react to the random ticks (cBlockInfo::IsRandomTicked())
+	bcBlockEntity,   ///< Blocks that have a block entity (cBlockEntity::IsBlockEntityBlockType())
+	bcCount,
+} ;
+
 // tolua_end
 
 
@@ -8,6 +8,7 @@
 #include "Item.h"
 #include "Entities/Pickup.h"
 #include "Chunk.h"
+#include "ChunkSnapshot.h"
 #include "Generating/Trees.h"  // used in cChunkMap::ReplaceTreeBlocks() for tree block discrimination
 #include "BlockArea.h"
 #include "Bindings/PluginManager.h"
@@ -17,7 +18,9 @@
 #include "MobSpawner.h"
 #include "BoundingBox.h"
 #include "SetChunkData.h"
+#include "ClientHandle.h"
 #include "Blocks/ChunkInterface.h"
+#include "FastRandom.h"
 #include "Entities/Pickup.h"
 
 #ifndef _WIN32
@@ -31,20 +34,81 @@
 
 
 
+/** Source of the globally unique cChunkMap::m_LayersGeneration values. */
+static std::atomic<UInt32> g_NextLayersGeneration(1);
+
+/** The layer last found by cChunkMap::FindLayer() in the current thread.
+The cached pointer is valid only if both the chunkmap and its m_LayersGeneration match. */
+struct sLastLayerCache
+{
+	const cChunkMap * m_ChunkMap;
+	UInt32 m_Generation;
+	int m_LayerX;
+	int m_LayerZ;
+	void * m_Layer;
+};
+
+#ifdef _WIN32
+	static __declspec(thread) sLastLayerCache g_LastLayer;
+#else
+	static thread_local sLastLayerCache g_LastLayer;
+#endif
+
+/** The number of the explosion rays' end points along each edge of the cube that they point to. */
+static const int EXPLOSION_RAYS_PER_AXIS = 16;
+
+/** The distance between two points sampled along an explosion ray, in blocks; the blocks' blast resistance is scaled by it as well. */
+static const double EXPLOSION_RAY_STEP = 0.3;
+
+/** How much an explosion ray weakens with each step, regardless of the blocks it passes. */
+static const double EXPLOSION_RAY_DECAY = 0.225;
+
+/** Returns true if the explosions turn the block into air; keep in sync with the switch in cChunkMap::DoExplosionAt(). */
+static bool IsDestroyedByExplosion(BLOCKTYPE a_BlockType)
+{
+	switch (a_BlockType)
+	{
+		case E_BLOCK_AIR:
+		case E_BLOCK_OBSIDIAN:
+		case E_BLOCK_BEACON:
+		case E_BLOCK_BEDROCK:
+		case E_BLOCK_BARRIER:
+		case E_BLOCK_WATER:
+		case E_BLOCK_LAVA:
+		case E_BLOCK_STATIONARY_WATER:
+		case E_BLOCK_STATIONARY_LAVA:
+		{
+			return false;
+		}
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cChunkMap:
 
-cChunkMap::cChunkMap(cWorld * a_World) :
+cChunkMap::cChunkMap(cWorld * a_World, eSlabPages a_SectionPages, bool a_ShouldAllocateInTickThread) :
+	m_LayersGeneration(g_NextLayersGeneration++),
 	m_World(a_World),
+	m_NextUnloadCandidateID(1),
 	m_Pool(
-		new cListAllocationPool<cChunkData::sChunkSection, 1600>(
-			std::auto_ptr<cAllocationPool<cChunkData::sChunkSection>::cStarvationCallbacks>(
+		new cSectionPool(
+			std::unique_ptr<cAllocationPool<cChunkData::sChunkSection>::cStarvationCallbacks>(
 				new cStarvationCallbacks()
-			)
+			),
+			a_SectionPages
 		)
-	)
+	),
+	m_ShouldAllocateInTickThread(a_ShouldAllocateInTickThread)
 {
-
+	m_CSLayers.SetName("cChunkMap::m_CSLayers");
 }
 
 
@@ -56,8 +120,12 @@ cChunkMap::~cChunkMap()
 	cCSLock Lock(m_CSLayers);
 	while (!m_Layers.empty())
 	{
+		int LayerX = m_Layers.back()->GetX();
+		int LayerZ = m_Layers.back()->GetZ();
 		delete m_Layers.back();
 		m_Layers.pop_back();  // Must pop, because further chunk deletions query the chunkmap for entities and that would touch deleted data
+		m_LayerIndex.Remove(LayerX, LayerZ);
+		m_LayersGeneration = g_NextLayersGeneration++;
 	}
 }
 
@@ -69,6 +137,8 @@ void cChunkMap::RemoveLayer(cChunkLayer * a_Layer)
 {
 	cCSLock Lock(m_CSLayers);
 	m_Layers.remove(a_Layer);
+	m_LayerIndex.Remove(a_Layer->GetX(), a_Layer->GetZ());
+	m_LayersGeneration = g_NextLayersGeneration++;
 }
 
 
@@ -78,12 +148,10 @@ void cChunkMap::RemoveLayer(cChunkLayer * a_Layer)
 cChunkMap::cChunkLayer * cChunkMap::GetLayer(int a_LayerX, int a_LayerZ)
 {
 	cCSLock Lock(m_CSLayers);
-	for (cChunkLayerList::const_iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	cChunkLayer * Found = FindLayer(a_LayerX, a_LayerZ);
+	if (Found != nullptr)
 	{
-		if (((*itr)->GetX() == a_LayerX) && ((*itr)->GetZ() == a_LayerZ))
-		{
-			return *itr;
-		}
+		return Found;
 	}
 	
 	// Not found, create new:
@@ -94,6 +162,7 @@ cChunkMap::cChunkLayer * cChunkMap::GetLayer(int a_LayerX, int a_LayerZ)
 		return nullptr;
 	}
 	m_Layers.push_back(Layer);
+	m_LayerIndex.Add(Layer);
 	return Layer;
 }
 
@@ -101,6 +170,21 @@ cChunkMap::cChunkLayer * cChunkMap::GetLayer(int a_LayerX, int a_LayerZ)
 
 
 
+bool cChunkMap::YieldLayersLock(cCSLock & a_Lock)
+{
+	UInt32 Generation = m_LayersGeneration;
+	{
+		cCSUnlock Unlock(a_Lock);
+		// Without the yield the mutex would most likely be re-acquired by this thread before any waiter wakes up:
+		std::this_thread::yield();
+	}
+	return (Generation == m_LayersGeneration);
+}
+
+
+
+
+
 cChunkMap::cChunkLayer * cChunkMap::FindLayerForChunk(int a_ChunkX, int a_ChunkZ)
 {
 	const int LayerX = FAST_FLOOR_DIV(a_ChunkX, LAYER_SIZE);
@@ -116,16 +200,26 @@ cChunkMap::cChunkLayer * cChunkMap::FindLayer(int a_LayerX, int a_LayerZ)
 {
 	ASSERT(m_CSLayers.IsLockedByCurrentThread());
 
-	for (cChunkLayerList::const_iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	// Most lookups from a single thread hit the same layer as the previous one:
+	sLastLayerCache & Cache = g_LastLayer;
+	if (
+		(Cache.m_ChunkMap == this) && (Cache.m_Generation == m_LayersGeneration) &&
+		(Cache.m_LayerX == a_LayerX) && (Cache.m_LayerZ == a_LayerZ)
+	)
 	{
-		if (((*itr)->GetX() == a_LayerX) && ((*itr)->GetZ() == a_LayerZ))
-		{
-			return *itr;
-		}
-	}  // for itr - m_Layers[]
-	
-	// Not found
-	return nullptr;
+		return static_cast<cChunkLayer *>(Cache.m_Layer);
+	}
+
+	cChunkLayer * Layer = m_LayerIndex.Find(a_LayerX, a_LayerZ);
+	if (Layer != nullptr)
+	{
+		Cache.m_ChunkMap = this;
+		Cache.m_Generation = m_LayersGeneration;
+		Cache.m_LayerX = a_LayerX;
+		Cache.m_LayerZ = a_LayerZ;
+		Cache.m_Layer = Layer;
+	}
+	return Layer;
 }
 
 
@@ -521,7 +615,7 @@ void cChunkMap::BroadcastEntityLook(const cEntity & a_Entity, const cClientHandl
 
 
 
-void cChunkMap::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+void cChunkMap::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude, int a_Fields)
 {
 	cCSLock Lock(m_CSLayers);
 	cChunkPtr Chunk = GetChunkNoGen(a_Entity.GetChunkX(), a_Entity.GetChunkZ());
@@ -530,7 +624,7 @@ void cChunkMap::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientH
 		return;
 	}
 	// It's perfectly legal to broadcast packets even to invalid chunks!
-	Chunk->BroadcastEntityMetadata(a_Entity, a_Exclude);
+	Chunk->BroadcastEntityMetadata(a_Entity, a_Exclude, a_Fields);
 }
 
 
@@ -569,6 +663,21 @@ void cChunkMap::BroadcastEntityRelMoveLook(const cEntity & a_Entity, char a_RelX
 
 
 
+void cChunkMap::SendPendingEntityMovements(int a_ChunkX, int a_ChunkZ)
+{
+	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = GetChunkNoLoad(a_ChunkX, a_ChunkZ);
+	if (Chunk == nullptr)
+	{
+		return;
+	}
+	Chunk->SendPendingEntityMovements();
+}
+
+
+
+
+
 void cChunkMap::BroadcastEntityStatus(const cEntity & a_Entity, char a_Status, const cClientHandle * a_Exclude)
 {
 	cCSLock Lock(m_CSLayers);
@@ -833,6 +942,24 @@ void cChunkMap::WakeUpSimulators(int a_BlockX, int a_BlockY, int a_BlockZ)
 
 
 
+void cChunkMap::WakeUpBlockEntitiesAround(int a_BlockX, int a_BlockY, int a_BlockZ)
+{
+	int ChunkX, ChunkZ, X = a_BlockX, Y = a_BlockY, Z = a_BlockZ;
+	cChunkDef::AbsoluteToRelative(X, Y, Z, ChunkX, ChunkZ);
+
+	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = GetChunkNoGen(ChunkX, ChunkZ);
+	if ((Chunk == nullptr) || !Chunk->IsValid())
+	{
+		return;
+	}
+	Chunk->WakeUpBlockEntitiesAround(X, Y, Z);
+}
+
+
+
+
+
 /// Wakes up the simulators for the specified area of blocks
 void cChunkMap::WakeUpSimulatorsInArea(int a_MinBlockX, int a_MaxBlockX, int a_MinBlockY, int a_MaxBlockY, int a_MinBlockZ, int a_MaxBlockZ)
 {
@@ -952,22 +1079,33 @@ void cChunkMap::SetChunkData(cSetChunkData & a_SetChunkData)
 			return;
 		}
 		Chunk->SetAllData(a_SetChunkData);
+		m_World->GetColumnSummaries().SetChunk(ChunkX, ChunkZ, a_SetChunkData.GetHeightMap(), a_SetChunkData.GetBiomes());
 		
 		if (a_SetChunkData.ShouldMarkDirty())
 		{
 			Chunk->MarkDirty();
 		}
 		
-		// Notify relevant ChunkStays:
+		// Notify the ChunkStays waiting for this chunk. The callbacks may enable or disable ChunkStays, so walk a copy:
 		cChunkStays ToBeDisabled;
-		for (cChunkStays::iterator itr = m_ChunkStays.begin(), end = m_ChunkStays.end(); itr != end; ++itr)
+		auto Waiting = m_ChunkStaysByChunk.find(GetChunkStayKey(ChunkX, ChunkZ));
+		if (Waiting != m_ChunkStaysByChunk.end())
 		{
-			if ((*itr)->ChunkAvailable(ChunkX, ChunkZ))
+			cChunkStays Stays(Waiting->second);
+			for (cChunkStays::iterator itr = Stays.begin(), end = Stays.end(); itr != end; ++itr)
 			{
-				// The chunkstay wants to be disabled, add it to a list of to-be-disabled chunkstays for later processing:
-				ToBeDisabled.push_back(*itr);
-			}
-		}  // for itr - m_ChunkStays[]
+				if (m_ChunkStays.find(*itr) == m_ChunkStays.end())
+				{
+					// Disabled by one of the previous callbacks
+					continue;
+				}
+				if ((*itr)->ChunkAvailable(ChunkX, ChunkZ))
+				{
+					// The chunkstay wants to be disabled, add it to a list of to-be-disabled chunkstays for later processing:
+					ToBeDisabled.push_back(*itr);
+				}
+			}  // for itr - Stays[]
+		}
 		
 		// Disable (and possibly remove) the chunkstays that chose to get disabled:
 		for (cChunkStays::iterator itr = ToBeDisabled.begin(), end = ToBeDisabled.end(); itr != end; ++itr)
@@ -1069,8 +1207,50 @@ bool cChunkMap::HasChunkAnyClients(int a_ChunkX, int a_ChunkZ)
 
 
 
+int cChunkMap::GetChunkGenerationPriority(int a_ChunkX, int a_ChunkZ)
+{
+	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = GetChunkNoLoad(a_ChunkX, a_ChunkZ);
+	if (Chunk == nullptr)
+	{
+		return -1;
+	}
+	if (Chunk->m_StayCount > 0)
+	{
+		return 0;
+	}
+	int res = -1;
+	for (const auto & Client : Chunk->m_LoadedByClient)
+	{
+		int ClientChunkX = Client->GetLastStreamedChunkX();
+		int ClientChunkZ = Client->GetLastStreamedChunkZ();
+		if (ClientChunkX == 0x7fffffff)
+		{
+			// The client hasn't been streamed anything yet, it's waiting for its first chunks:
+			return 0;
+		}
+		int Distance = std::max(std::abs(ClientChunkX - a_ChunkX), std::abs(ClientChunkZ - a_ChunkZ));
+		if ((res < 0) || (Distance < res))
+		{
+			res = Distance;
+		}
+	}
+	return res;
+}
+
+
+
+
+
 int  cChunkMap::GetHeight(int a_BlockX, int a_BlockZ)
 {
+	// If the chunk isn't loaded, try its column summary first, so that it needn't be loaded or generated:
+	int Height;
+	if (!IsChunkValidForColumn(a_BlockX, a_BlockZ) && m_World->GetColumnSummaries().GetHeight(a_BlockX, a_BlockZ, Height))
+	{
+		return Height;
+	}
+
 	for (;;)
 	{
 		cCSLock Lock(m_CSLayers);
@@ -1106,7 +1286,8 @@ bool cChunkMap::TryGetHeight(int a_BlockX, int a_BlockZ, int & a_Height)
 	cChunkPtr Chunk = GetChunkNoLoad(ChunkX, ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
 	{
-		return false;
+		// Not loaded, use the column summary, if there's any:
+		return m_World->GetColumnSummaries().GetHeight(a_BlockX + ChunkX * cChunkDef::Width, a_BlockZ + ChunkZ * cChunkDef::Width, a_Height);
 	}
 	a_Height = Chunk->GetHeight(a_BlockX, a_BlockZ);
 	return true;
@@ -1116,6 +1297,42 @@ bool cChunkMap::TryGetHeight(int a_BlockX, int a_BlockZ, int & a_Height)
 
 
 
+bool cChunkMap::IsChunkValidForColumn(int a_BlockX, int a_BlockZ)
+{
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(a_BlockX, a_BlockZ, ChunkX, ChunkZ);
+	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = GetChunkNoLoad(ChunkX, ChunkZ);
+	return ((Chunk != nullptr) && Chunk->IsValid());
+}
+
+
+
+
+
+int cChunkMap::GetChunkBlockCount(int a_ChunkX, int a_ChunkZ, int a_SectionIdx, eBlockCategory a_Category)
+{
+	if ((a_Category < 0) || (a_Category >= bcCount) || (a_SectionIdx >= static_cast<int>(cChunkData::NumSections)))
+	{
+		return -1;
+	}
+	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = GetChunkNoLoad(a_ChunkX, a_ChunkZ);
+	if ((Chunk == nullptr) || !Chunk->IsValid())
+	{
+		return -1;
+	}
+	if (a_SectionIdx < 0)
+	{
+		return Chunk->GetBlockCount(a_Category);
+	}
+	return Chunk->GetSectionBlockCount(static_cast<size_t>(a_SectionIdx), a_Category);
+}
+
+
+
+
+
 void cChunkMap::FastSetBlocks(sSetBlockList & a_BlockList)
 {
 	sSetBlockList Failed;
@@ -1129,18 +1346,21 @@ void cChunkMap::FastSetBlocks(sSetBlockList & a_BlockList)
 		cChunkPtr Chunk = GetChunkNoGen(ChunkX, ChunkZ);
 		if ((Chunk != nullptr) && Chunk->IsValid())
 		{
+			// Move all the blocks within this chunk into a separate list and set them at once, so that the light is updated only once:
+			sSetBlockList ChunkBlocks;
 			for (sSetBlockList::iterator itr = a_BlockList.begin(); itr != a_BlockList.end();)
 			{
 				if ((itr->m_ChunkX == ChunkX) && (itr->m_ChunkZ == ChunkZ))
 				{
-					Chunk->FastSetBlock(itr->m_RelX, itr->m_RelY, itr->m_RelZ, itr->m_BlockType, itr->m_BlockMeta);
-					itr = a_BlockList.erase(itr);
+					sSetBlockList::iterator Cur = itr++;
+					ChunkBlocks.splice(ChunkBlocks.end(), a_BlockList, Cur);
 				}
 				else
 				{
 					++itr;
 				}
 			}  // for itr - a_BlockList[]
+			Chunk->FastSetBlocks(ChunkBlocks);
 		}
 		else
 		{
@@ -1168,28 +1388,51 @@ void cChunkMap::FastSetBlocks(sSetBlockList & a_BlockList)
 
 
 
-void cChunkMap::SetBlocks(const sSetBlockVector & a_Blocks)
+void cChunkMap::SetBlocks(const sSetBlockVector & a_Blocks, bool a_ShouldSkipPhysics)
 {
+	// Group the changes by their chunks, keeping the order of the changes within each chunk, so that the last one wins:
+	sSetBlockVector Blocks(a_Blocks);
+	std::stable_sort(Blocks.begin(), Blocks.end(), [](const sSetBlock & a_First, const sSetBlock & a_Second)
+		{
+			return (a_First.m_ChunkX < a_Second.m_ChunkX) || ((a_First.m_ChunkX == a_Second.m_ChunkX) && (a_First.m_ChunkZ < a_Second.m_ChunkZ));
+		}
+	);
+
 	cCSLock lock(m_CSLayers);
-	cChunkPtr chunk = nullptr;
-	int lastChunkX = 0x7fffffff;  // Bogus coords so that chunk is updated on first pass
-	int lastChunkZ = 0x7fffffff;
-	for (auto block: a_Blocks)
+	cSimulatorManager * SimMgr = m_World->GetSimulatorManager();
+	for (sSetBlockVector::const_iterator itr = Blocks.begin(), end = Blocks.end(); itr != end;)
 	{
-		// Update the chunk, if different from last time:
-		if ((block.m_ChunkX != lastChunkX) || (block.m_ChunkZ != lastChunkZ))
+		sSetBlockVector::const_iterator ChunkEnd = itr;
+		while ((ChunkEnd != end) && (ChunkEnd->m_ChunkX == itr->m_ChunkX) && (ChunkEnd->m_ChunkZ == itr->m_ChunkZ))
 		{
-			lastChunkX = block.m_ChunkX;
-			lastChunkZ = block.m_ChunkZ;
-			chunk = GetChunk(lastChunkX, lastChunkZ);
+			++ChunkEnd;
 		}
 
-		// If the chunk is valid, set the block:
-		if (chunk != nullptr)
+		// If the chunk is valid, set all its blocks at once:
+		cChunkPtr Chunk = GetChunkNoGen(itr->m_ChunkX, itr->m_ChunkZ);
+		if ((Chunk != nullptr) && Chunk->IsValid())
 		{
-			chunk->SetBlock(block.m_RelX, block.m_RelY, block.m_RelZ, block.m_BlockType, block.m_BlockMeta);
+			Chunk->SetBlocks(itr, ChunkEnd, a_ShouldSkipPhysics);
+
+			// Wake up the simulators, each changed block only once:
+			if (!a_ShouldSkipPhysics)
+			{
+				std::set<int> WokenUp;
+				for (sSetBlockVector::const_iterator blk = itr; blk != ChunkEnd; ++blk)
+				{
+					if ((blk->m_RelY < 0) || (blk->m_RelY >= cChunkDef::Height))
+					{
+						continue;
+					}
+					if (WokenUp.insert(cChunkDef::MakeIndexNoCheck(blk->m_RelX, blk->m_RelY, blk->m_RelZ)).second)
+					{
+						SimMgr->WakeUp(blk->GetX(), blk->GetY(), blk->GetZ(), Chunk);
+					}
+				}
+			}
 		}
-	}  // for block - a_Blocks[]
+		itr = ChunkEnd;
+	}  // for itr - Blocks[]
 }
 
 
@@ -1442,9 +1685,20 @@ void cChunkMap::ReplaceBlocks(const sSetBlockVector & a_Blocks, BLOCKTYPE a_Filt
 void cChunkMap::ReplaceTreeBlocks(const sSetBlockVector & a_Blocks)
 {
 	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = nullptr;
 	for (sSetBlockVector::const_iterator itr = a_Blocks.begin(); itr != a_Blocks.end(); ++itr)
 	{
-		cChunkPtr Chunk = GetChunk(itr->m_ChunkX, itr->m_ChunkZ);
+		if ((itr->m_RelY < 0) || (itr->m_RelY >= cChunkDef::Height))
+		{
+			// Tall trees may reach above the world, cut them off
+			continue;
+		}
+
+		// The tree images are mostly inside a single chunk, look the chunk up only when it changes:
+		if ((Chunk == nullptr) || (Chunk->GetPosX() != itr->m_ChunkX) || (Chunk->GetPosZ() != itr->m_ChunkZ))
+		{
+			Chunk = GetChunk(itr->m_ChunkX, itr->m_ChunkZ);
+		}
 		if ((Chunk == nullptr) || !Chunk->IsValid())
 		{
 			continue;
@@ -1479,15 +1733,20 @@ EMCSBiome cChunkMap::GetBiomeAt (int a_BlockX, int a_BlockZ)
 	cChunkDef::AbsoluteToRelative(X, Y, Z, ChunkX, ChunkZ);
 
 	cCSLock Lock(m_CSLayers);
-	cChunkPtr Chunk = GetChunk(ChunkX, ChunkZ);
+	cChunkPtr Chunk = GetChunkNoLoad(ChunkX, ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
 		return Chunk->GetBiomeAt(X, Z);
 	}
-	else
+
+	// Not loaded, use the column summary, if there's any, so that the chunk needn't be loaded:
+	EMCSBiome Biome;
+	if (m_World->GetColumnSummaries().GetBiome(a_BlockX, a_BlockZ, Biome))
 	{
-		return m_World->GetGenerator().GetBiomeAt(a_BlockX, a_BlockZ);
+		return Biome;
 	}
+	GetChunk(ChunkX, ChunkZ);  // Queue the chunk for loading / generating, as before
+	return m_World->GetGenerator().GetBiomeAt(a_BlockX, a_BlockZ);
 }
 
 
@@ -1724,6 +1983,9 @@ void cChunkMap::RemoveClientFromChunks(cClientHandle * a_Client)
 	{
 		(*itr)->RemoveClient(a_Client);
 	}  // for itr - m_Layers[]
+
+	// The entities have been destroyed on the client with their chunks, forget any leftovers:
+	a_Client->ClearTrackedEntities();
 }
 
 
@@ -1778,14 +2040,8 @@ void cChunkMap::AddEntityIfNotPresent(cEntity * a_Entity)
 bool cChunkMap::HasEntity(UInt32 a_UniqueID)
 {
 	cCSLock Lock(m_CSLayers);
-	for (cChunkLayerList::const_iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
-	{
-		if ((*itr)->HasEntity(a_UniqueID))
-		{
-			return true;
-		}
-	}
-	return false;
+	auto itr = m_EntityChunks.find(a_UniqueID);
+	return ((itr != m_EntityChunks.end()) && itr->second->IsValid());
 }
 
 
@@ -1873,8 +2129,10 @@ bool cChunkMap::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback &
 
 
 
-void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_BlockY, double a_BlockZ, cVector3iArray & a_BlocksAffected)
+void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_BlockY, double a_BlockZ, cVector3iArray & a_BlocksAffected, int a_NumExplosions)
 {
+	ASSERT(a_NumExplosions > 0);
+
 	// Don't explode if outside of Y range (prevents the following test running into unallocated memory):
 	if ((a_BlockY < 0) || (a_BlockY > cChunkDef::Height - 1))
 	{
@@ -1890,54 +2148,65 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 	}
 
 	int ExplosionSizeInt = (int)ceil(a_ExplosionSize);
-	int ExplosionSizeSq = ExplosionSizeInt * ExplosionSizeInt;
 
 	int bx = (int)floor(a_BlockX);
 	int by = (int)floor(a_BlockY);
 	int bz = (int)floor(a_BlockZ);
 
-	int MinY = std::max((int)floor(a_BlockY - ExplosionSizeInt), 0);
-	int MaxY = std::min((int)ceil(a_BlockY + ExplosionSizeInt), cChunkDef::Height - 1);
+	// The farthest a ray can get: the strongest ray loses at least EXPLOSION_RAY_DECAY + EXPLOSION_RAY_STEP * 0.3 per step (in air):
+	int Reach = (int)ceil(a_ExplosionSize * 1.3 / (EXPLOSION_RAY_DECAY + EXPLOSION_RAY_STEP * 0.3) * EXPLOSION_RAY_STEP) + 1;
+	int MinX = bx - Reach;
+	int MinY = std::max(by - Reach, 0);
+	int MinZ = bz - Reach;
 
 	if (ShouldDestroyBlocks)
 	{
+		// Read a snapshot of the affected area, and cast the rays through it:
 		cBlockArea area;
-		a_BlocksAffected.reserve(8 * ExplosionSizeInt * ExplosionSizeInt * ExplosionSizeInt);
-		if (!area.Read(m_World, bx - ExplosionSizeInt, (int)ceil(a_BlockX + ExplosionSizeInt), MinY, MaxY, bz - ExplosionSizeInt, (int)ceil(a_BlockZ + ExplosionSizeInt)))
+		if (!area.Read(m_World, MinX, bx + Reach, MinY, std::min(by + Reach, cChunkDef::Height - 1), MinZ, bz + Reach))
 		{
 			return;
 		}
-		
-		for (int x = -ExplosionSizeInt; x < ExplosionSizeInt; x++)
+		std::vector<int> AffectedBy(area.GetBlockCount(), 0);
+		for (int i = 1; i <= a_NumExplosions; i++)
 		{
-			for (int y = -ExplosionSizeInt; y < ExplosionSizeInt; y++)
+			if (CastExplosionRays(area, a_ExplosionSize, Vector3d(a_BlockX, a_BlockY, a_BlockZ), i, AffectedBy) == 0)
 			{
-				if ((by + y >= cChunkDef::Height) || (by + y < 0))
-				{
-					// Outside of the world
-					continue;
-				}
-				for (int z = -ExplosionSizeInt; z < ExplosionSizeInt; z++)
+				// The rest of the explosions would find the same blocks, no need to evaluate them
+				break;
+			}
+		}
+
+		// Process the affected blocks, collect the changes to be written all at once:
+		sSetBlockVector BlocksToSet;
+		for (int y = 0; y < area.GetSizeY(); y++)
+		{
+			for (int z = 0; z < area.GetSizeZ(); z++)
+			{
+				for (int x = 0; x < area.GetSizeX(); x++)
 				{
-					if ((x * x + y * y + z * z) > ExplosionSizeSq)
+					if (AffectedBy[static_cast<size_t>(area.MakeIndex(x, y, z))] == 0)
 					{
-						// Too far away
 						continue;
 					}
-
-					BLOCKTYPE Block = area.GetBlockType(bx + x, by + y, bz + z);
+					int BlockX = MinX + x;
+					int BlockY = MinY + y;
+					int BlockZ = MinZ + z;
+					BLOCKTYPE Block;
+					NIBBLETYPE Meta;
+					area.GetRelBlockTypeMeta(x, y, z, Block, Meta);
 					switch (Block)
 					{
 						case E_BLOCK_TNT:
 						{
 							// Activate the TNT, with a random fuse between 10 to 30 game ticks
 							int FuseTime = 10 + m_World->GetTickRandomNumber(20);
-							m_World->SpawnPrimedTNT(a_BlockX + x + 0.5, a_BlockY + y + 0.5, a_BlockZ + z + 0.5, FuseTime);
-							area.SetBlockTypeMeta(bx + x, by + y, bz + z, E_BLOCK_AIR, 0);
-							a_BlocksAffected.push_back(Vector3i(bx + x, by + y, bz + z));
+							m_World->SpawnPrimedTNT(BlockX + 0.5, BlockY + 0.5, BlockZ + 0.5, FuseTime);
+							BlocksToSet.emplace_back(BlockX, BlockY, BlockZ, E_BLOCK_AIR, 0);
+							a_BlocksAffected.push_back(Vector3i(BlockX, BlockY, BlockZ));
 							break;
 						}
-						
+
 						case E_BLOCK_OBSIDIAN:
 						case E_BLOCK_BEACON:
 						case E_BLOCK_BEDROCK:
@@ -1952,14 +2221,14 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 						case E_BLOCK_STATIONARY_WATER:
 						{
 							// Turn into simulated water:
-							area.SetBlockType(bx + x, by + y, bz + z, E_BLOCK_WATER);
+							BlocksToSet.emplace_back(BlockX, BlockY, BlockZ, E_BLOCK_WATER, Meta);
 							break;
 						}
 
 						case E_BLOCK_STATIONARY_LAVA:
 						{
 							// Turn into simulated lava:
-							area.SetBlockType(bx + x, by + y, bz + z, E_BLOCK_LAVA);
+							BlocksToSet.emplace_back(BlockX, BlockY, BlockZ, E_BLOCK_LAVA, Meta);
 							break;
 						}
 
@@ -1976,8 +2245,8 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 								cItems Drops;
 								cBlockHandler * Handler = BlockHandler(Block);
 
-								Handler->ConvertToPickups(Drops, area.GetBlockMeta(bx + x, by + y, bz + z));  // Stone becomes cobblestone, coal ore becomes coal, etc.
-								m_World->SpawnItemPickups(Drops, bx + x, by + y, bz + z);
+								Handler->ConvertToPickups(Drops, Meta);  // Stone becomes cobblestone, coal ore becomes coal, etc.
+								m_World->SpawnItemPickups(Drops, BlockX, BlockY, BlockZ);
 							}
 							else if ((m_World->GetTNTShrapnelLevel() > slNone) && (m_World->GetTickRandomNumber(100) < 20))  // 20% chance of flinging stuff around
 							{
@@ -1987,29 +2256,33 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 									((m_World->GetTNTShrapnelLevel() == slGravityAffectedOnly) && ((Block == E_BLOCK_SAND) || (Block == E_BLOCK_GRAVEL)))
 								)
 								{
-									m_World->SpawnFallingBlock(bx + x, by + y + 5, bz + z, Block, area.GetBlockMeta(bx + x, by + y, bz + z));
+									m_World->SpawnFallingBlock(BlockX, BlockY + 5, BlockZ, Block, Meta);
 								}
 							}
 
-							area.SetBlockTypeMeta(bx + x, by + y, bz + z, E_BLOCK_AIR, 0);
-							a_BlocksAffected.push_back(Vector3i(bx + x, by + y, bz + z));
+							BlocksToSet.emplace_back(BlockX, BlockY, BlockZ, E_BLOCK_AIR, 0);
+							a_BlocksAffected.push_back(Vector3i(BlockX, BlockY, BlockZ));
 							break;
 						}
 					}  // switch (BlockType)
-				}  // for z
-			}  // for y
-		}  // for x
-		area.Write(m_World, bx - ExplosionSizeInt, MinY, bz - ExplosionSizeInt);
+				}  // for x
+			}  // for z
+		}  // for y
+
+		// Write the changes all at once; this also wakes up the simulators around the blasted blocks, so that water and lava
+		// flows and sand falls into the holes (FS #391):
+		SetBlocks(BlocksToSet);
 	}
 
 	class cTNTDamageCallback :
 		public cEntityCallback
 	{
 	public:
-		cTNTDamageCallback(cBoundingBox & a_bbTNT, Vector3d a_ExplosionPos, int a_ExplosionSize) :
+		cTNTDamageCallback(cBoundingBox & a_bbTNT, Vector3d a_ExplosionPos, int a_ExplosionSize, int a_NumExplosions) :
 			m_bbTNT(a_bbTNT),
 			m_ExplosionPos(a_ExplosionPos),
-			m_ExplosionSize(a_ExplosionSize)
+			m_ExplosionSize(a_ExplosionSize),
+			m_NumExplosions(a_NumExplosions)
 		{
 		}
 
@@ -2037,8 +2310,9 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 			}
 
 			// Apply force to entities around the explosion - code modified from World.cpp DoExplosionAt()
+			// The damage is dealt only once for all the simultaneous explosions, but each of them pushes the entity:
 			DistanceFromExplosion.Normalize();
-			DistanceFromExplosion *= m_ExplosionSize * m_ExplosionSize;
+			DistanceFromExplosion *= m_ExplosionSize * m_ExplosionSize * m_NumExplosions;
 			a_Entity->AddSpeed(DistanceFromExplosion);
 			
 			return false;
@@ -2048,21 +2322,85 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 		cBoundingBox & m_bbTNT;
 		Vector3d m_ExplosionPos;
 		int m_ExplosionSize;
+		int m_NumExplosions;
 	};
 
 	cBoundingBox bbTNT(Vector3d(a_BlockX, a_BlockY, a_BlockZ), 0.5, 1);
 	bbTNT.Expand(ExplosionSizeInt * 2, ExplosionSizeInt * 2, ExplosionSizeInt * 2);
 
 
-	cTNTDamageCallback TNTDamageCallback(bbTNT, Vector3d(a_BlockX, a_BlockY, a_BlockZ), ExplosionSizeInt);
-	ForEachEntity(TNTDamageCallback);
+	// Only the entities in the box are affected, there's no need to visit the rest of the world:
+	cTNTDamageCallback TNTDamageCallback(bbTNT, Vector3d(a_BlockX, a_BlockY, a_BlockZ), ExplosionSizeInt, a_NumExplosions);
+	ForEachEntityInBox(bbTNT, TNTDamageCallback);
+}
 
-	// Wake up all simulators for the area, so that water and lava flows and sand falls into the blasted holes (FS #391):
-	WakeUpSimulatorsInArea(
-		bx - ExplosionSizeInt - 1, bx + ExplosionSizeInt + 1,
-		MinY, MaxY,
-		bz - ExplosionSizeInt - 1, bz + ExplosionSizeInt + 1
-	);
+
+
+
+
+int cChunkMap::CastExplosionRays(const cBlockArea & a_Area, double a_ExplosionSize, const Vector3d & a_Center, int a_ExplosionNum, std::vector<int> & a_AffectedBy)
+{
+	int NumAffected = 0;
+	cFastRandom Random;
+	int SizeX = a_Area.GetSizeX();
+	int SizeY = a_Area.GetSizeY();
+	int SizeZ = a_Area.GetSizeZ();
+	Vector3d Origin(a_Area.GetOriginX(), a_Area.GetOriginY(), a_Area.GetOriginZ());
+
+	// The rays go from the center towards the surface points of a 16 x 16 x 16 cube:
+	const int GridMax = EXPLOSION_RAYS_PER_AXIS - 1;
+	for (int i = 0; i <= GridMax; i++)
+	{
+		for (int j = 0; j <= GridMax; j++)
+		{
+			for (int k = 0; k <= GridMax; k++)
+			{
+				if ((i != 0) && (i != GridMax) && (j != 0) && (j != GridMax) && (k != 0) && (k != GridMax))
+				{
+					// Not on the surface
+					continue;
+				}
+				Vector3d Step(
+					static_cast<double>(i) / GridMax * 2 - 1,
+					static_cast<double>(j) / GridMax * 2 - 1,
+					static_cast<double>(k) / GridMax * 2 - 1
+				);
+				Step.Normalize();
+				Step *= EXPLOSION_RAY_STEP;
+
+				// Each block along the ray weakens it, until it has no more power to destroy blocks:
+				double Intensity = a_ExplosionSize * (0.7 + Random.NextFloat(0.6f));
+				Vector3d Pos = a_Center - Origin;
+				for (; Intensity > 0; Intensity -= EXPLOSION_RAY_DECAY)
+				{
+					int x = FloorC(Pos.x);
+					int y = FloorC(Pos.y);
+					int z = FloorC(Pos.z);
+					if ((x < 0) || (x >= SizeX) || (y < 0) || (y >= SizeY) || (z < 0) || (z >= SizeZ))
+					{
+						// Outside of the area (the world)
+						break;
+					}
+					size_t Idx = static_cast<size_t>(a_Area.MakeIndex(x, y, z));
+					BLOCKTYPE Block = a_Area.GetBlockTypes()[Idx];
+					int AffectedBy = a_AffectedBy[Idx];
+					if ((AffectedBy != 0) && (AffectedBy < a_ExplosionNum) && IsDestroyedByExplosion(Block))
+					{
+						// Already destroyed by a previous explosion
+						Block = E_BLOCK_AIR;
+					}
+					Intensity -= (cBlockInfo::GetBlastResistance(Block) + 0.3) * EXPLOSION_RAY_STEP;
+					if ((Intensity > 0) && (Block != E_BLOCK_AIR) && (AffectedBy == 0))
+					{
+						a_AffectedBy[Idx] = a_ExplosionNum;
+						NumAffected++;
+					}
+					Pos += Step;
+				}
+			}  // for k
+		}  // for j
+	}  // for i
+	return NumAffected;
 }
 
 
@@ -2072,15 +2410,14 @@ void cChunkMap::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_
 bool cChunkMap::DoWithEntityByID(UInt32 a_UniqueID, cEntityCallback & a_Callback)
 {
 	cCSLock Lock(m_CSLayers);
-	bool res = false;
-	for (cChunkLayerList::const_iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	auto itr = m_EntityChunks.find(a_UniqueID);
+	if ((itr == m_EntityChunks.end()) || !itr->second->IsValid())
 	{
-		if ((*itr)->DoWithEntityByID(a_UniqueID, a_Callback, res))
-		{
-			return res;
-		}
+		return false;
 	}
-	return false;
+	bool res = false;
+	itr->second->DoWithEntityByID(a_UniqueID, a_Callback, res);
+	return res;
 }
 
 
@@ -2515,6 +2852,27 @@ void cChunkMap::ChunkLoadFailed(int a_ChunkX, int a_ChunkZ)
 
 
 
+void cChunkMap::ChunkGenerationSkipped(int a_ChunkX, int a_ChunkZ)
+{
+	cCSLock Lock(m_CSLayers);
+	cChunkPtr Chunk = GetChunkNoLoad(a_ChunkX, a_ChunkZ);
+	if ((Chunk == nullptr) || !Chunk->IsQueued())
+	{
+		return;
+	}
+	if (Chunk->HasAnyClients() || (Chunk->m_StayCount > 0))
+	{
+		// Someone wants the chunk again, requeue it:
+		m_World->GetGenerator().QueueGenerateChunk(a_ChunkX, a_ChunkZ, false);
+		return;
+	}
+	Chunk->SetPresence(cChunk::cpInvalid);
+}
+
+
+
+
+
 bool cChunkMap::SetSignLines(int a_BlockX, int a_BlockY, int a_BlockZ, const AString & a_Line1, const AString & a_Line2, const AString & a_Line3, const AString & a_Line4)
 {
 	cCSLock Lock(m_CSLayers);
@@ -2607,23 +2965,16 @@ bool cChunkMap::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBl
 	cChunkDef::AbsoluteToRelative(MinBlockX, MinBlockY, MinBlockZ, MinChunkX, MinChunkZ);
 	cChunkDef::AbsoluteToRelative(MaxBlockX, MaxBlockY, MaxBlockZ, MaxChunkX, MaxChunkZ);
 	
-	// Iterate over chunks, write data into each:
-	bool Result = true;
+	// Write the data into each chunk.
+	// This must be done on this thread, the chunk code relies on m_CSLayers being held by the current thread
+	// (it queues the light changes, replaces block entities and calls into the world):
 	cCSLock Lock(m_CSLayers);
-	for (int z = MinChunkZ; z <= MaxChunkZ; z++)
+	std::vector<cChunkPtr> Chunks;
+	bool Result = GetValidChunksInRect(MinChunkX, MaxChunkX, MinChunkZ, MaxChunkZ, Chunks);
+	for (auto Chunk: Chunks)
 	{
-		for (int x = MinChunkX; x <= MaxChunkX; x++)
-		{
-			cChunkPtr Chunk = GetChunkNoLoad(x, z);
-			if ((Chunk == nullptr) || (!Chunk->IsValid()))
-			{
-				// Not present / not valid
-				Result = false;
-				continue;
-			}
-			Chunk->WriteBlockArea(a_Area, a_MinBlockX, a_MinBlockY, a_MinBlockZ, a_DataTypes);
-		}  // for x
-	}  // for z
+		Chunk->WriteBlockArea(a_Area, a_MinBlockX, a_MinBlockY, a_MinBlockZ, a_DataTypes);
+	}
 	return Result;
 }
 
@@ -2631,15 +2982,66 @@ bool cChunkMap::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBl
 
 
 
-void cChunkMap::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty)
+bool cChunkMap::ReadBlockArea(cBlockArea & a_Area)
 {
-	a_NumChunksValid = 0;
-	a_NumChunksDirty = 0;
+	int MinChunkX, MaxChunkX;
+	int MinChunkZ, MaxChunkZ;
+	cChunkDef::BlockToChunk(a_Area.GetOriginX(), a_Area.GetOriginZ(), MinChunkX, MinChunkZ);
+	cChunkDef::BlockToChunk(a_Area.GetOriginX() + a_Area.GetSizeX() - 1, a_Area.GetOriginZ() + a_Area.GetSizeZ() - 1, MaxChunkX, MaxChunkZ);
+
+	// Copy each chunk into its part of the area, on this thread, because the chunks may only be accessed while holding m_CSLayers:
 	cCSLock Lock(m_CSLayers);
-	for (cChunkLayerList::const_iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	std::vector<cChunkPtr> Chunks;
+	bool Result = GetValidChunksInRect(MinChunkX, MaxChunkX, MinChunkZ, MaxChunkZ, Chunks);
+	cBlockArea::cChunkReader Reader(a_Area);
+	cChunkDataCallback & Callback = Reader;
+	for (auto Chunk: Chunks)
 	{
-		int NumValid = 0, NumDirty = 0;
-		(*itr)->GetChunkStats(NumValid, NumDirty);
+		if (Callback.Coords(Chunk->GetPosX(), Chunk->GetPosZ()))
+		{
+			Chunk->GetAllData(Callback);
+		}
+	}
+	return Result;
+}
+
+
+
+
+
+bool cChunkMap::GetValidChunksInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, std::vector<cChunkPtr> & a_Chunks)
+{
+	bool Result = true;
+	for (int z = a_MinChunkZ; z <= a_MaxChunkZ; z++)
+	{
+		for (int x = a_MinChunkX; x <= a_MaxChunkX; x++)
+		{
+			cChunkPtr Chunk = GetChunkNoLoad(x, z);
+			if ((Chunk == nullptr) || (!Chunk->IsValid()))
+			{
+				// Not present / not valid
+				Result = false;
+				continue;
+			}
+			a_Chunks.push_back(Chunk);
+		}  // for x
+	}  // for z
+	return Result;
+}
+
+
+
+
+
+void cChunkMap::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty)
+{
+	a_NumChunksValid = 0;
+	a_NumChunksDirty = 0;
+	cCSLock Lock(m_CSLayers);
+	for (cChunkLayerList::const_iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	{
+		int NumValid = 0, NumDirty = 0;
+		(*itr)->GetChunkStats(NumValid, NumDirty);
 		a_NumChunksValid += NumValid;
 		a_NumChunksDirty += NumDirty;
 	}  // for itr - m_Layers[]
@@ -2649,6 +3051,70 @@ void cChunkMap::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty)
 
 
 
+void cChunkMap::GetMemoryStats(sMemoryStats & a_Stats)
+{
+	cCSLock Lock(m_CSLayers);
+	for (const auto & Layer: m_Layers)
+	{
+		Layer->AddMemoryStats(a_Stats);
+	}
+}
+
+
+
+
+
+void cChunkMap::GetTopChunkTickCosts(size_t a_Count, std::vector<sChunkTickCost> & a_Costs)
+{
+	a_Costs.clear();
+	cCSLock Lock(m_CSLayers);
+	for (const auto & Layer: m_Layers)
+	{
+		Layer->AddTopChunkTickCosts(a_Count, a_Costs);
+	}
+}
+
+
+
+
+
+void cChunkMap::ResetChunkTickCosts(void)
+{
+	cCSLock Lock(m_CSLayers);
+	for (const auto & Layer: m_Layers)
+	{
+		Layer->ResetChunkTickCosts();
+	}
+}
+
+
+
+
+
+void cChunkMap::CreateSnapshot(const cWorldSnapshot * a_Previous, cWorldSnapshot & a_Snapshot)
+{
+	cCSLock Lock(m_CSLayers);
+	for (const auto & Layer: m_Layers)
+	{
+		Layer->CreateSnapshot(a_Previous, a_Snapshot);
+	}
+}
+
+
+
+
+
+void cChunkMap::GetSectionPoolStats(size_t & a_NumAllocated, size_t & a_NumFree, size_t & a_NumReserveInUse)
+{
+	a_NumAllocated = m_Pool->GetNumAllocated();
+	a_NumFree = m_Pool->GetNumFree();
+	a_NumReserveInUse = m_Pool->GetNumReserveInUse();
+}
+
+
+
+
+
 void cChunkMap::GrowMelonPumpkin(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE a_BlockType, MTRand & a_Rand)
 {
 	int ChunkX, ChunkZ;
@@ -2733,9 +3199,13 @@ void cChunkMap::CollectMobCensus(cMobCensus & a_ToFill)
 void cChunkMap::SpawnMobs(cMobSpawner & a_MobSpawner)
 {
 	cCSLock Lock(m_CSLayers);
-	for (auto && layer: m_Layers)
+	for (cChunkLayerList::iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
 	{
-		layer->SpawnMobs(a_MobSpawner);
+		(*itr)->SpawnMobs(a_MobSpawner);
+		if (!YieldLayersLock(Lock))
+		{
+			break;
+		}
 	}  // for itr - m_Layers
 }
 
@@ -2745,10 +3215,21 @@ void cChunkMap::SpawnMobs(cMobSpawner & a_MobSpawner)
 
 void cChunkMap::Tick(std::chrono::milliseconds a_Dt)
 {
+	if (m_ShouldAllocateInTickThread)
+	{
+		// Keep a slab's worth of sections ready, so that the other threads rarely need to allocate new memory:
+		m_Pool->ReplenishSpare();
+	}
+
 	cCSLock Lock(m_CSLayers);
 	for (cChunkLayerList::iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
 	{
 		(*itr)->Tick(a_Dt);
+		if (!YieldLayersLock(Lock))
+		{
+			// The remaining layers will be ticked in the next tick
+			break;
+		}
 	}  // for itr - m_Layers
 }
 
@@ -2776,9 +3257,21 @@ void cChunkMap::TickBlock(int a_BlockX, int a_BlockY, int a_BlockZ)
 void cChunkMap::UnloadUnusedChunks(void)
 {
 	cCSLock Lock(m_CSLayers);
+
+	// The full pass supersedes the unload candidates; the chunks kept by it are queued again by the next CollectUnloadCandidates():
+	m_UnloadCandidates.clear();
+	for (cChunkLayerList::iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	{
+		(*itr)->ResetUnloadCandidates();
+	}  // for itr - m_Layers
+
 	for (cChunkLayerList::iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
 	{
 		(*itr)->UnloadUnusedChunks();
+		if (!YieldLayersLock(Lock))
+		{
+			break;
+		}
 	}  // for itr - m_Layers
 }
 
@@ -2786,6 +3279,94 @@ void cChunkMap::UnloadUnusedChunks(void)
 
 
 
+size_t cChunkMap::UnloadCandidateChunks(Int64 a_WorldAge, Int64 a_MinUnusedAge, size_t a_MaxChunks)
+{
+	cCSLock Lock(m_CSLayers);
+	size_t NumUnloaded = 0;
+	size_t NumToCheck = m_UnloadCandidates.size();  // The dirty candidates are re-queued, check each one only once
+	while ((NumUnloaded < a_MaxChunks) && (NumToCheck > 0))
+	{
+		sUnloadCandidate Candidate = m_UnloadCandidates.front();
+		if (a_WorldAge - Candidate.m_Since < a_MinUnusedAge)
+		{
+			// Unused for too short a time, and so are (mostly) the rest of the queue:
+			break;
+		}
+		m_UnloadCandidates.pop_front();
+		NumToCheck--;
+
+		// Skip the stale entries, of the chunks that have been unloaded in the meantime, or re-queued since
+		// (including the chunks re-created since, which must wait out the delay from their own entry):
+		cChunk * Chunk = FindChunk(Candidate.m_ChunkX, Candidate.m_ChunkZ);
+		if ((Chunk == nullptr) || (Chunk->m_UnloadCandidateID != Candidate.m_ID))
+		{
+			continue;
+		}
+
+		// Drop the chunks that are used again, they become candidates again once their last user leaves:
+		if (!Chunk->CanUnloadAfterSave())
+		{
+			Chunk->m_UnloadCandidateID = 0;
+			continue;
+		}
+
+		// Keep the dirty chunks until they're saved; the write-behind saver prefers them:
+		if (Chunk->IsDirty())
+		{
+			m_UnloadCandidates.push_back(Candidate);
+			continue;
+		}
+
+		Chunk->m_UnloadCandidateID = 0;
+		if (cPluginManager::Get()->CallHookChunkUnloading(*m_World, Candidate.m_ChunkX, Candidate.m_ChunkZ))
+		{
+			// A plugin wants the chunk kept; the next CollectUnloadCandidates() will ask again
+			continue;
+		}
+		cChunkLayer * Layer = FindLayerForChunk(Candidate.m_ChunkX, Candidate.m_ChunkZ);
+		ASSERT(Layer != nullptr);  // FindChunk() has found the chunk in it
+		Layer->UnloadChunk(Candidate.m_ChunkX, Candidate.m_ChunkZ);
+		NumUnloaded++;
+	}
+	return NumUnloaded;
+}
+
+
+
+
+
+void cChunkMap::CollectUnloadCandidates(void)
+{
+	cCSLock Lock(m_CSLayers);
+	for (cChunkLayerList::iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	{
+		(*itr)->CollectUnloadCandidates();
+	}  // for itr - m_Layers
+}
+
+
+
+
+
+void cChunkMap::AddUnloadCandidate(cChunk & a_Chunk)
+{
+	if (a_Chunk.m_UnloadCandidateID != 0)
+	{
+		return;
+	}
+	a_Chunk.m_UnloadCandidateID = m_NextUnloadCandidateID++;
+	if (m_NextUnloadCandidateID == 0)
+	{
+		// Wrapped around, skip the value reserved for the chunks that aren't queued:
+		m_NextUnloadCandidateID = 1;
+	}
+	m_UnloadCandidates.push_back({a_Chunk.GetPosX(), a_Chunk.GetPosZ(), m_World->GetWorldAge(), a_Chunk.m_UnloadCandidateID});
+}
+
+
+
+
+
 void cChunkMap::SaveAllChunks(void)
 {
 	cCSLock Lock(m_CSLayers);
@@ -2799,6 +3380,62 @@ void cChunkMap::SaveAllChunks(void)
 
 
 
+size_t cChunkMap::SaveDirtyChunks(Int64 a_WorldAge, Int64 a_MinDirtyAge, Int64 a_MaxDirtyAge, size_t a_MaxChunks, int & a_NumDirty, Int64 & a_OldestDirtyAge)
+{
+	cCSLock Lock(m_CSLayers);
+	sDirtyChunks Dirty;
+	for (cChunkLayerList::iterator itr = m_Layers.begin(); itr != m_Layers.end(); ++itr)
+	{
+		(*itr)->CollectDirtyChunks(a_WorldAge, Dirty);
+	}  // for itr - m_Layers[]
+
+	a_NumDirty = static_cast<int>(Dirty.size());
+	a_OldestDirtyAge = 0;
+	for (const auto & Chunk: Dirty)
+	{
+		a_OldestDirtyAge = std::max(a_OldestDirtyAge, Chunk.m_Age);
+	}
+
+	// Unloadable chunks first, then the oldest:
+	std::sort(Dirty.begin(), Dirty.end(), [](const sDirtyChunk & a_First, const sDirtyChunk & a_Second)
+		{
+			if (a_First.m_CanUnload != a_Second.m_CanUnload)
+			{
+				return a_First.m_CanUnload;
+			}
+			return (a_First.m_Age > a_Second.m_Age);
+		}
+	);
+
+	cWorldStorage & Storage = m_World->GetStorage();
+	size_t NumQueued = 0;
+	for (const auto & Chunk: Dirty)
+	{
+		if (Chunk.m_Age >= a_MaxDirtyAge)
+		{
+			// Overdue, save regardless of the budget. Restart the age, so that a failed save is retried only after another full interval:
+			Storage.QueueSaveChunk(Chunk.m_Chunk->GetPosX(), Chunk.m_Chunk->GetPosZ());
+			Chunk.m_Chunk->SetDirtySince(a_WorldAge);
+			continue;
+		}
+		if (
+			(NumQueued >= a_MaxChunks) ||
+			Chunk.m_Chunk->IsSaving() ||  // The storage already has the chunk's current data
+			(!Chunk.m_CanUnload && (Chunk.m_Age < a_MinDirtyAge))
+		)
+		{
+			continue;
+		}
+		Storage.QueueSaveChunk(Chunk.m_Chunk->GetPosX(), Chunk.m_Chunk->GetPosZ());
+		NumQueued++;
+	}
+	return NumQueued;
+}
+
+
+
+
+
 int cChunkMap::GetNumChunks(void)
 {
 	cCSLock Lock(m_CSLayers);
@@ -2855,6 +3492,257 @@ void cChunkMap::SetChunkAlwaysTicked(int a_ChunkX, int a_ChunkZ, bool a_AlwaysTi
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cChunkMap::cChunkLayerIndex:
+
+// The tombstone only needs a unique address that's never a valid layer:
+static char g_LayerIndexTombstone;
+cChunkMap::cChunkLayer * const cChunkMap::cChunkLayerIndex::m_Tombstone = reinterpret_cast<cChunkMap::cChunkLayer *>(&g_LayerIndexTombstone);
+
+
+
+
+
+cChunkMap::cChunkLayerIndex::cChunkLayerIndex(void) :
+	m_Slots(64, nullptr),
+	m_NumUsed(0),
+	m_NumTaken(0)
+{
+}
+
+
+
+
+
+cChunkMap::cChunkLayer * cChunkMap::cChunkLayerIndex::Find(int a_LayerX, int a_LayerZ) const
+{
+	size_t Mask = m_Slots.size() - 1;
+	for (size_t Slot = GetStartSlot(a_LayerX, a_LayerZ);; Slot = (Slot + 1) & Mask)
+	{
+		cChunkLayer * Layer = m_Slots[Slot];
+		if (Layer == nullptr)
+		{
+			return nullptr;
+		}
+		if ((Layer != m_Tombstone) && (Layer->GetX() == a_LayerX) && (Layer->GetZ() == a_LayerZ))
+		{
+			return Layer;
+		}
+	}
+}
+
+
+
+
+
+void cChunkMap::cChunkLayerIndex::Add(cChunkLayer * a_Layer)
+{
+	ASSERT(Find(a_Layer->GetX(), a_Layer->GetZ()) == nullptr);
+
+	// Keep the load (including tombstones) under 50 %, so that the probe sequences stay short:
+	if (2 * (m_NumTaken + 1) > m_Slots.size())
+	{
+		Rehash((2 * (m_NumUsed + 1) > m_Slots.size() / 2) ? 2 * m_Slots.size() : m_Slots.size());
+	}
+
+	size_t Mask = m_Slots.size() - 1;
+	for (size_t Slot = GetStartSlot(a_Layer->GetX(), a_Layer->GetZ());; Slot = (Slot + 1) & Mask)
+	{
+		if (m_Slots[Slot] == nullptr)
+		{
+			m_Slots[Slot] = a_Layer;
+			m_NumTaken += 1;
+			break;
+		}
+		if (m_Slots[Slot] == m_Tombstone)
+		{
+			m_Slots[Slot] = a_Layer;
+			break;
+		}
+	}
+	m_NumUsed += 1;
+}
+
+
+
+
+
+void cChunkMap::cChunkLayerIndex::Remove(int a_LayerX, int a_LayerZ)
+{
+	size_t Mask = m_Slots.size() - 1;
+	for (size_t Slot = GetStartSlot(a_LayerX, a_LayerZ);; Slot = (Slot + 1) & Mask)
+	{
+		cChunkLayer * Layer = m_Slots[Slot];
+		if (Layer == nullptr)
+		{
+			// Not present
+			return;
+		}
+		if ((Layer != m_Tombstone) && (Layer->GetX() == a_LayerX) && (Layer->GetZ() == a_LayerZ))
+		{
+			m_Slots[Slot] = m_Tombstone;
+			m_NumUsed -= 1;
+			return;
+		}
+	}
+}
+
+
+
+
+
+size_t cChunkMap::cChunkLayerIndex::GetStartSlot(int a_LayerX, int a_LayerZ) const
+{
+	UInt32 Hash = static_cast<UInt32>(a_LayerX) * 0x9e3779b1u;
+	Hash ^= static_cast<UInt32>(a_LayerZ) * 0x85ebca77u;
+	Hash ^= Hash >> 15;
+	return static_cast<size_t>(Hash) & (m_Slots.size() - 1);
+}
+
+
+
+
+
+void cChunkMap::cChunkLayerIndex::Rehash(size_t a_NumSlots)
+{
+	ASSERT((a_NumSlots & (a_NumSlots - 1)) == 0);  // Must be a power of 2
+	std::vector<cChunkLayer *> OldSlots(a_NumSlots, nullptr);
+	std::swap(OldSlots, m_Slots);
+	m_NumUsed = 0;
+	m_NumTaken = 0;
+	size_t Mask = m_Slots.size() - 1;
+	for (std::vector<cChunkLayer *>::const_iterator itr = OldSlots.begin(), end = OldSlots.end(); itr != end; ++itr)
+	{
+		if ((*itr == nullptr) || (*itr == m_Tombstone))
+		{
+			continue;
+		}
+		size_t Slot = GetStartSlot((*itr)->GetX(), (*itr)->GetZ());
+		while (m_Slots[Slot] != nullptr)
+		{
+			Slot = (Slot + 1) & Mask;
+		}
+		m_Slots[Slot] = *itr;
+		m_NumUsed += 1;
+		m_NumTaken += 1;
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkMap::sChunkTickCost:
+
+cChunkMap::sChunkTickCost::sChunkTickCost(int a_ChunkX, int a_ChunkZ) :
+	m_ChunkX(a_ChunkX),
+	m_ChunkZ(a_ChunkZ)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_Time); i++)
+	{
+		m_Time[i] = std::chrono::steady_clock::duration::zero();
+	}
+}
+
+
+
+
+
+std::chrono::steady_clock::duration cChunkMap::sChunkTickCost::GetTotal(void) const
+{
+	std::chrono::steady_clock::duration res = std::chrono::steady_clock::duration::zero();
+	for (size_t i = 0; i < ARRAYCOUNT(m_Time); i++)
+	{
+		res += m_Time[i];
+	}
+	return res;
+}
+
+
+
+
+
+const char * cChunkMap::sChunkTickCost::GetCategoryName(eCategory a_Category)
+{
+	switch (a_Category)
+	{
+		case catEntities:      return "entities";
+		case catBlockEntities: return "block entities";
+		case catSimulators:    return "simulators";
+		case catBlockTicks:    return "block ticks";
+		case catCount:         break;
+	}
+	ASSERT(!"Unknown chunk tick cost category");
+	return "unknown";
+}
+
+
+
+
+
+void cChunkMap::sChunkTickCost::AddTopChunk(std::vector<sChunkTickCost> & a_List, size_t a_Count, const sChunkTickCost & a_Cost)
+{
+	auto Total = a_Cost.GetTotal();
+	if ((Total == std::chrono::steady_clock::duration::zero()) || ((a_List.size() >= a_Count) && (a_List.back().GetTotal() >= Total)))
+	{
+		return;
+	}
+	auto itr = std::find_if(a_List.begin(), a_List.end(), [Total](const sChunkTickCost & a_Chunk)
+		{
+			return (a_Chunk.GetTotal() < Total);
+		}
+	);
+	a_List.insert(itr, a_Cost);
+	if (a_List.size() > a_Count)
+	{
+		a_List.pop_back();
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkMap::sMemoryStats:
+
+cChunkMap::sMemoryStats::sMemoryStats(void) :
+	m_NumChunks(0),
+	m_NumFlatSections(0),
+	m_NumPaletteSections(0),
+	m_ChunkDataHeapBytes(0),
+	m_NumEntities(0),
+	m_NumBlockEntities(0)
+{
+}
+
+
+
+
+
+void cChunkMap::sMemoryStats::AddHeavyChunk(std::vector<sHeavyChunk> & a_List, int a_ChunkX, int a_ChunkZ, size_t a_Count)
+{
+	if ((a_Count == 0) || ((a_List.size() >= NUM_HEAVY_CHUNKS) && (a_List.back().m_Count >= a_Count)))
+	{
+		return;
+	}
+	auto itr = std::find_if(a_List.begin(), a_List.end(), [a_Count](const sHeavyChunk & a_Chunk)
+		{
+			return (a_Chunk.m_Count < a_Count);
+		}
+	);
+	a_List.insert(itr, {a_ChunkX, a_ChunkZ, a_Count});
+	if (a_List.size() > NUM_HEAVY_CHUNKS)
+	{
+		a_List.pop_back();
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cChunkMap::cChunkLayer:
 
@@ -2975,11 +3863,19 @@ void cChunkMap::cChunkLayer::Tick(std::chrono::milliseconds a_Dt)
 {
 	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); i++)
 	{
+		if (m_Chunks[i] == nullptr)
+		{
+			continue;
+		}
+		
 		// Only tick chunks that are valid and should be ticked:
-		if ((m_Chunks[i] != nullptr) && m_Chunks[i]->IsValid() && m_Chunks[i]->ShouldBeTicked())
+		if (m_Chunks[i]->IsValid() && m_Chunks[i]->ShouldBeTicked())
 		{
 			m_Chunks[i]->Tick(a_Dt);
 		}
+		
+		// Send the entity movements broadcast during the tick, batched:
+		m_Chunks[i]->SendPendingEntityMovements();
 	}  // for i - m_Chunks[]
 }
 
@@ -3022,80 +3918,112 @@ bool cChunkMap::cChunkLayer::ForEachEntity(cEntityCallback & a_Callback)
 
 
 
-bool cChunkMap::cChunkLayer::DoWithEntityByID(UInt32 a_EntityID, cEntityCallback & a_Callback, bool & a_CallbackReturn)
+int cChunkMap::cChunkLayer::GetNumChunksLoaded(void) const
 {
-	// Calls the callback if the entity with the specified ID is found, with the entity object as the callback param. Returns true if entity found.
-	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); i++)
+	int NumChunks = 0;
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
 	{
-		if ((m_Chunks[i] != nullptr) && m_Chunks[i]->IsValid())
+		if (m_Chunks[i] != nullptr)
 		{
-			if (m_Chunks[i]->DoWithEntityByID(a_EntityID, a_Callback, a_CallbackReturn))
-			{
-				return true;
-			}
+			NumChunks++;
 		}
-	}
-	return false;
+	}  // for i - m_Chunks[]
+	return NumChunks;
 }
 
 
 
 
 
-bool cChunkMap::cChunkLayer::HasEntity(UInt32 a_EntityID)
+void cChunkMap::cChunkLayer::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty) const
 {
-	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); i++)
+	int NumValid = 0;
+	int NumDirty = 0;
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
 	{
-		if ((m_Chunks[i] != nullptr) && m_Chunks[i]->IsValid())
+		if (m_Chunks[i] == nullptr)
 		{
-			if (m_Chunks[i]->HasEntity(a_EntityID))
+			continue;
+		}
+		NumValid++;
+		if (m_Chunks[i]->IsDirty())
+		{
+			NumDirty++;
+		}
+	}  // for i - m_Chunks[]
+	a_NumChunksValid = NumValid;
+	a_NumChunksDirty = NumDirty;
+}
+
+
+
+
+
+void cChunkMap::cChunkLayer::CreateSnapshot(const cWorldSnapshot * a_Previous, cWorldSnapshot & a_Snapshot) const
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
+	{
+		const cChunk * Chunk = m_Chunks[i];
+		if ((Chunk == nullptr) || !Chunk->IsValid())
+		{
+			continue;
+		}
+		if (a_Previous != nullptr)
+		{
+			cChunkSnapshotPtr Previous = a_Previous->GetChunk(Chunk->GetPosX(), Chunk->GetPosZ());
+			if ((Previous != nullptr) && (Previous->GetRevision() == Chunk->GetRevision()))
 			{
-				return true;
+				a_Snapshot.AddChunk(Previous);
+				continue;
 			}
 		}
-	}
-	return false;
+		a_Snapshot.AddChunk(cChunkSnapshotPtr(Chunk->CreateSnapshot()));
+	}  // for i - m_Chunks[]
 }
 
 
 
 
 
-int cChunkMap::cChunkLayer::GetNumChunksLoaded(void) const
+void cChunkMap::cChunkLayer::AddMemoryStats(sMemoryStats & a_Stats) const
 {
-	int NumChunks = 0;
 	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
 	{
 		if (m_Chunks[i] != nullptr)
 		{
-			NumChunks++;
+			m_Chunks[i]->AddMemoryStats(a_Stats);
 		}
 	}  // for i - m_Chunks[]
-	return NumChunks;
 }
 
 
 
 
 
-void cChunkMap::cChunkLayer::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty) const
+void cChunkMap::cChunkLayer::AddTopChunkTickCosts(size_t a_Count, std::vector<sChunkTickCost> & a_Costs) const
 {
-	int NumValid = 0;
-	int NumDirty = 0;
 	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
 	{
-		if (m_Chunks[i] == nullptr)
+		if (m_Chunks[i] != nullptr)
 		{
-			continue;
+			sChunkTickCost::AddTopChunk(a_Costs, a_Count, m_Chunks[i]->GetTickCost());
 		}
-		NumValid++;
-		if (m_Chunks[i]->IsDirty())
+	}  // for i - m_Chunks[]
+}
+
+
+
+
+
+void cChunkMap::cChunkLayer::ResetChunkTickCosts(void)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
+	{
+		if (m_Chunks[i] != nullptr)
 		{
-			NumDirty++;
+			m_Chunks[i]->ResetTickCost();
 		}
 	}  // for i - m_Chunks[]
-	a_NumChunksValid = NumValid;
-	a_NumChunksDirty = NumDirty;
 }
 
 
@@ -3118,6 +4046,27 @@ void cChunkMap::cChunkLayer::Save(void)
 
 
 
+void cChunkMap::cChunkLayer::CollectDirtyChunks(Int64 a_WorldAge, sDirtyChunks & a_Dirty)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); ++i)
+	{
+		cChunk * Chunk = m_Chunks[i];
+		if ((Chunk == nullptr) || !Chunk->IsValid() || !Chunk->IsDirty())
+		{
+			continue;
+		}
+		if (Chunk->GetDirtySince() < 0)
+		{
+			Chunk->SetDirtySince(a_WorldAge);
+		}
+		a_Dirty.push_back({Chunk, a_WorldAge - Chunk->GetDirtySince(), Chunk->CanUnloadAfterSave()});
+	}  // for i - m_Chunks[]
+}
+
+
+
+
+
 void cChunkMap::cChunkLayer::UnloadUnusedChunks(void)
 {
 	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); i++)
@@ -3141,6 +4090,56 @@ void cChunkMap::cChunkLayer::UnloadUnusedChunks(void)
 
 
 
+void cChunkMap::cChunkLayer::UnloadChunk(int a_ChunkX, int a_ChunkZ)
+{
+	const int LocalX = a_ChunkX - m_LayerX * LAYER_SIZE;
+	const int LocalZ = a_ChunkZ - m_LayerZ * LAYER_SIZE;
+	if (!((LocalX < LAYER_SIZE) && (LocalZ < LAYER_SIZE) && (LocalX > -1) && (LocalZ > -1)))
+	{
+		ASSERT(!"Asking a cChunkLayer to unload a chunk that doesn't belong to it!");
+		return;
+	}
+
+	// The same as in UnloadUnusedChunks(), the chunk needs to be findable while its destructor runs:
+	int Index = LocalX + LocalZ * LAYER_SIZE;
+	delete m_Chunks[Index];
+	m_Chunks[Index] = nullptr;
+}
+
+
+
+
+
+void cChunkMap::cChunkLayer::CollectUnloadCandidates(void)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); i++)
+	{
+		if ((m_Chunks[i] != nullptr) && m_Chunks[i]->CanUnloadAfterSave())
+		{
+			m_Parent->AddUnloadCandidate(*m_Chunks[i]);
+		}
+	}  // for i - m_Chunks[]
+}
+
+
+
+
+
+void cChunkMap::cChunkLayer::ResetUnloadCandidates(void)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_Chunks); i++)
+	{
+		if (m_Chunks[i] != nullptr)
+		{
+			m_Chunks[i]->m_UnloadCandidateID = 0;
+		}
+	}  // for i - m_Chunks[]
+}
+
+
+
+
+
 void cChunkMap::FastSetBlock(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
 {
 	cCSLock Lock(m_CSFastSetBlock);
@@ -3177,12 +4176,19 @@ void cChunkMap::AddChunkStay(cChunkStay & a_ChunkStay)
 	cCSLock Lock(m_CSLayers);
 	
 	// Add it to the list:
-	ASSERT(std::find(m_ChunkStays.begin(), m_ChunkStays.end(), &a_ChunkStay) == m_ChunkStays.end());  // Has not yet been added
-	m_ChunkStays.push_back(&a_ChunkStay);
+	bool IsNew = m_ChunkStays.insert(&a_ChunkStay).second;
+	ASSERT(IsNew);  // Has not yet been added
+	UNUSED_VAR(IsNew);
 	
-	// Schedule all chunks to be loaded / generated, and mark each as locked:
+	// Index it by all its chunks, before any of them can be reported as available:
 	const cChunkCoordsVector & WantedChunks = a_ChunkStay.GetChunks();
 	for (cChunkCoordsVector::const_iterator itr = WantedChunks.begin(); itr != WantedChunks.end(); ++itr)
+	{
+		m_ChunkStaysByChunk[GetChunkStayKey(itr->m_ChunkX, itr->m_ChunkZ)].push_back(&a_ChunkStay);
+	}
+	
+	// Schedule all chunks to be loaded / generated, and mark each as locked:
+	for (cChunkCoordsVector::const_iterator itr = WantedChunks.begin(); itr != WantedChunks.end(); ++itr)
 	{
 		cChunkPtr Chunk = GetChunk(itr->m_ChunkX, itr->m_ChunkZ);
 		if (Chunk == nullptr)
@@ -3212,27 +4218,33 @@ void cChunkMap::DelChunkStay(cChunkStay & a_ChunkStay)
 	cCSLock Lock(m_CSLayers);
 	
 	// Remove from the list of active chunkstays:
-	bool HasFound = false;
-	for (cChunkStays::iterator itr = m_ChunkStays.begin(), end = m_ChunkStays.end(); itr != end; ++itr)
-	{
-		if (*itr == &a_ChunkStay)
-		{
-			m_ChunkStays.erase(itr);
-			HasFound = true;
-			break;
-		}
-	}  // for itr - m_ChunkStays[]
-	
-	if (!HasFound)
+	if (m_ChunkStays.erase(&a_ChunkStay) == 0)
 	{
 		ASSERT(!"Removing a cChunkStay that hasn't been added!");
 		return;
 	}
 	
-	// Unmark all contained chunks:
+	// Unindex and unmark all contained chunks:
 	const cChunkCoordsVector & Chunks = a_ChunkStay.GetChunks();
 	for (cChunkCoordsVector::const_iterator itr = Chunks.begin(), end = Chunks.end(); itr != end; ++itr)
 	{
+		auto Waiting = m_ChunkStaysByChunk.find(GetChunkStayKey(itr->m_ChunkX, itr->m_ChunkZ));
+		if (Waiting != m_ChunkStaysByChunk.end())
+		{
+			cChunkStays & Stays = Waiting->second;
+			cChunkStays::iterator Stay = std::find(Stays.begin(), Stays.end(), &a_ChunkStay);
+			if (Stay != Stays.end())
+			{
+				// The order of the waiters doesn't matter, swap-remove:
+				*Stay = Stays.back();
+				Stays.pop_back();
+			}
+			if (Stays.empty())
+			{
+				m_ChunkStaysByChunk.erase(Waiting);
+			}
+		}
+		
 		cChunkPtr Chunk = GetChunkNoLoad(itr->m_ChunkX, itr->m_ChunkZ);
 		if (Chunk == nullptr)
 		{
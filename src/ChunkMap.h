@@ -7,6 +7,9 @@
 
 
 #include "ChunkDataCallback.h"
+#include "Defines.h"
+#include <unordered_map>
+#include <unordered_set>
 
 
 
@@ -37,6 +40,7 @@ class cMobCensus;
 class cMobSpawner;
 class cSetChunkData;
 class cBoundingBox;
+class cWorldSnapshot;
 
 typedef std::list<cClientHandle *>         cClientHandleList;
 typedef cChunk *                           cChunkPtr;
@@ -64,7 +68,10 @@ public:
 
 	static const int LAYER_SIZE = 32;
 
-	cChunkMap(cWorld * a_World);
+	/** Creates the chunk map for the world, with the section pool's slabs backed by the specified pages.
+	If a_ShouldAllocateInTickThread is true, the new section memory is allocated ahead of the need in Tick(), so that
+	the OS places it on the NUMA node of the world's tick thread, rather than where the storage or generator happens to run. */
+	cChunkMap(cWorld * a_World, eSlabPages a_SectionPages = spNormal, bool a_ShouldAllocateInTickThread = false);
 	~cChunkMap();
 
 	// Broadcast respective packets to all clients of the chunk where the event is taking place
@@ -81,9 +88,13 @@ public:
 	void BroadcastEntityEquipment(const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityHeadLook(const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityLook(const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
-	void BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
+	void BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr, int a_Fields = emfAll);
 	void BroadcastEntityRelMove(const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityRelMoveLook(const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude = nullptr);
+	
+	/** Sends the entity movements queued in the specified chunk right away, instead of waiting for the end of the chunk's tick */
+	void SendPendingEntityMovements(int a_ChunkX, int a_ChunkZ);
+	
 	void BroadcastEntityStatus(const cEntity & a_Entity, char a_Status, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityVelocity(const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityAnimation(const cEntity & a_Entity, char a_Animation, const cClientHandle * a_Exclude = nullptr);
@@ -112,6 +123,9 @@ public:
 
 	/** Wakes up the simulators for the specified area of blocks */
 	void WakeUpSimulatorsInArea(int a_MinBlockX, int a_MaxBlockX, int a_MinBlockY, int a_MaxBlockY, int a_MinBlockZ, int a_MaxBlockZ);
+	
+	/** Wakes up the sleeping block entities neighboring the specified block */
+	void WakeUpBlockEntitiesAround(int a_BlockX, int a_BlockY, int a_BlockZ);
 
 	void MarkRedstoneDirty  (int a_ChunkX, int a_ChunkZ);
 	void MarkChunkDirty     (int a_ChunkX, int a_ChunkZ, bool a_MarkRedstoneDirty = false);
@@ -141,17 +155,28 @@ public:
 
 	bool      IsChunkValid       (int a_ChunkX, int a_ChunkZ);
 	bool      HasChunkAnyClients (int a_ChunkX, int a_ChunkZ);
+
+	/** Returns the priority of generating the chunk, for cChunkGenerator: 0 if the chunk is in a ChunkStay, otherwise
+	the distance, in chunks, to the nearest client that wants the chunk. Returns -1 if nobody needs the chunk. */
+	int GetChunkGenerationPriority(int a_ChunkX, int a_ChunkZ);
 	int       GetHeight          (int a_BlockX, int a_BlockZ);  // Waits for the chunk to get loaded / generated
-	bool      TryGetHeight       (int a_BlockX, int a_BlockZ, int & a_Height);  // Returns false if chunk not loaded / generated
+	bool      TryGetHeight       (int a_BlockX, int a_BlockZ, int & a_Height);  // Returns false if chunk not loaded / generated and there's no column summary
+
+	/** Returns the number of blocks of the category in the specified section of the chunk, or in the whole chunk if a_SectionIdx is negative.
+	Returns -1 if the chunk isn't valid or the section index is out of range. */
+	int GetChunkBlockCount(int a_ChunkX, int a_ChunkZ, int a_SectionIdx, eBlockCategory a_Category);
 	void FastSetBlock(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
 	
 	void FastSetQueuedBlocks();
 	void FastSetBlocks(sSetBlockList & a_BlockList);
 
 	/** Performs the specified single-block set operations simultaneously, as if SetBlock() was called for each item.
-	Is more efficient than calling SetBlock() multiple times.
+	Is more efficient than calling SetBlock() multiple times: each chunk writes all its blocks first, then relights
+	the changed area once, and the simulators are woken up once per changed block; the clients get the changes coalesced
+	with the chunk's next broadcast. If a_ShouldSkipPhysics is true, the blocks are not ticked and the simulators,
+	neighbors and block entities around are not woken up, used for pasting schematics.
 	If the chunk for any of the blocks is not loaded, the set operation is ignored silently. */
-	void SetBlocks(const sSetBlockVector & a_Blocks);
+	void SetBlocks(const sSetBlockVector & a_Blocks, bool a_ShouldSkipPhysics = false);
 
 	void      CollectPickupsByPlayer(cPlayer & a_Player);
 	
@@ -236,8 +261,11 @@ public:
 	If any chunk in the box is missing, ignores the entities in that chunk silently. */
 	bool ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback & a_Callback);  // Lua-accessible
 
-	/** Destroys and returns a list of blocks destroyed in the explosion at the specified coordinates */
-	void DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_BlockY, double a_BlockZ, cVector3iArray & a_BlockAffected);
+	/** Destroys and returns a list of blocks destroyed in the explosion at the specified coordinates.
+	a_NumExplosions is the number of identical explosions happening at once (merged primed TNT); they are evaluated one after another
+	over the same block snapshot, so that each one reaches through the blocks destroyed by the previous ones, and push the entities
+	a_NumExplosions times as hard. */
+	void DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_BlockY, double a_BlockZ, cVector3iArray & a_BlockAffected, int a_NumExplosions = 1);
 	
 	/** Calls the callback if the entity with the specified ID is found, with the entity object as the callback param.
 	Returns true if entity found and callback returned false. */
@@ -334,6 +362,10 @@ public:
 	
 	/** Marks the chunk as failed-to-load */
 	void ChunkLoadFailed(int a_ChunkX, int a_ChunkZ);
+
+	/** Marks the chunk as no longer queued, after the generator has skipped it because nobody needed it.
+	If a client has wanted the chunk in the meantime, the chunk is queued for generating again. */
+	void ChunkGenerationSkipped(int a_ChunkX, int a_ChunkZ);
 	
 	/** Sets the sign text. Returns true if sign text changed. */
 	bool SetSignLines(int a_BlockX, int a_BlockY, int a_BlockZ, const AString & a_Line1, const AString & a_Line2, const AString & a_Line3, const AString & a_Line4);
@@ -346,11 +378,102 @@ public:
 	/** Calls the callback for each chunk in the coords specified (all cords are inclusive). Returns true if all chunks have been processed successfully */
 	bool ForEachChunkInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, cChunkDataCallback & a_Callback);
 	
-	/** Writes the block area into the specified coords. Returns true if all chunks have been processed. Prefer cBlockArea::Write() instead. */
+	/** Reads the blocks into the block area, whose origin, size and datatypes have already been set.
+	Returns true if all chunks have been processed. Prefer cBlockArea::Read() instead. */
+	bool ReadBlockArea(cBlockArea & a_Area);
+
+	/** Writes the block area into the specified coords.
+	Returns true if all chunks have been processed. Prefer cBlockArea::Write() instead. */
 	bool WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes);
 
+	/** The memory used by the chunks in the chunkmap, see GetMemoryStats(). */
+	struct sMemoryStats
+	{
+		/** The maximum number of chunks in m_MostEntities and m_MostBlockEntities. */
+		static const size_t NUM_HEAVY_CHUNKS = 5;
+
+		/** A chunk with many entities or block entities. */
+		struct sHeavyChunk
+		{
+			int m_ChunkX;
+			int m_ChunkZ;
+			size_t m_Count;
+		} ;
+
+		size_t m_NumChunks;           ///< Number of the chunk objects in memory
+		size_t m_NumFlatSections;     ///< Number of the sections allocated from the section pool
+		size_t m_NumPaletteSections;  ///< Number of the palette-compressed sections
+		size_t m_ChunkDataHeapBytes;  ///< Heap memory used by the palette sections and the light arrays
+		size_t m_NumEntities;
+		size_t m_NumBlockEntities;
+
+		/** The chunks with the most entities, descending. */
+		std::vector<sHeavyChunk> m_MostEntities;
+
+		/** The chunks with the most block entities, descending. */
+		std::vector<sHeavyChunk> m_MostBlockEntities;
+
+		sMemoryStats(void);
+
+		/** Inserts the chunk into a_List, if it is among the NUM_HEAVY_CHUNKS chunks with the largest count. */
+		static void AddHeavyChunk(std::vector<sHeavyChunk> & a_List, int a_ChunkX, int a_ChunkZ, size_t a_Count);
+	} ;
+
+	/** The CPU time spent in ticking a single chunk, accumulated while the world's chunk tick profiling is on, see GetTopChunkTickCosts(). */
+	struct sChunkTickCost
+	{
+		/** The parts of the chunk's tick that are measured separately. */
+		enum eCategory
+		{
+			catEntities,       ///< The entities ticked by the chunk, and the mobs ticked by the world
+			catBlockEntities,  ///< The block entities' Tick()
+			catSimulators,     ///< The simulators' SimulateChunk()
+			catBlockTicks,     ///< The random block ticks and the queued block checks
+			catCount,
+		} ;
+
+		int m_ChunkX;
+		int m_ChunkZ;
+
+		/** The time spent in each category. */
+		std::chrono::steady_clock::duration m_Time[catCount];
+
+		sChunkTickCost(int a_ChunkX, int a_ChunkZ);
+
+		/** Returns the time spent in all the categories together. */
+		std::chrono::steady_clock::duration GetTotal(void) const;
+
+		/** Returns the human-readable name of the category. */
+		static const char * GetCategoryName(eCategory a_Category);
+
+		/** Inserts a_Cost into a_List, sorted by the total time descending, if it is among the a_Count most expensive ones. */
+		static void AddTopChunk(std::vector<sChunkTickCost> & a_List, size_t a_Count, const sChunkTickCost & a_Cost);
+	} ;
+
 	/** Returns the number of valid chunks and the number of dirty chunks */
 	void GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty);
+
+	/** Adds the memory stats of all the chunks to a_Stats. */
+	void GetMemoryStats(sMemoryStats & a_Stats);
+
+	/** Fills a_Costs with the a_Count loaded chunks that have accumulated the most tick time, the most expensive first. */
+	void GetTopChunkTickCosts(size_t a_Count, std::vector<sChunkTickCost> & a_Costs);
+
+	/** Zeroes the accumulated tick time of all the loaded chunks. */
+	void ResetChunkTickCosts(void);
+
+	/** Adds the snapshots of all the valid chunks to a_Snapshot. The chunks whose revision hasn't changed since a_Previous
+	reuse their snapshot from it, only the changed chunks are copied. a_Previous may be nullptr. */
+	void CreateSnapshot(const cWorldSnapshot * a_Previous, cWorldSnapshot & a_Snapshot);
+
+	/** Returns the pool from which the chunks' sections are allocated.
+	The loaders and the generator build their cSetChunkData from it, so that the data can be moved into the chunks.
+	The pool is thread-safe. */
+	cAllocationPool<cChunkData::sChunkSection> & GetSectionPool(void) { return *m_Pool; }
+
+	/** Returns the chunk section pool statistics: sections in use, sections allocated but unused,
+	and reserve sections handed out because the system ran out of memory. */
+	void GetSectionPoolStats(size_t & a_NumAllocated, size_t & a_NumFree, size_t & a_NumReserveInUse);
 	
 	/** Grows a melon or a pumpkin next to the block specified (assumed to be the stem) */
 	void GrowMelonPumpkin(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE a_BlockType, MTRand & a_Rand);
@@ -378,6 +501,27 @@ public:
 	void UnloadUnusedChunks(void);
 	void SaveAllChunks(void);
 
+	/** Unloads up to a_MaxChunks of the unload candidates that have been unused for at least a_MinUnusedAge ticks.
+	The chunks are added as candidates when their last client or ChunkStay leaves them (see AddUnloadCandidate()),
+	or by CollectUnloadCandidates(), so the unloading is spread over the ticks instead of done in a single pass over all chunks.
+	Candidates that are still dirty are kept until saved, those that have been taken up again are dropped.
+	Returns the number of chunks unloaded. */
+	size_t UnloadCandidateChunks(Int64 a_WorldAge, Int64 a_MinUnusedAge, size_t a_MaxChunks);
+
+	/** Adds all the chunks that could be unloaded, once saved, to the unload candidates.
+	Catches the chunks that have never had a client or a ChunkStay, such as those loaded by plugins. */
+	void CollectUnloadCandidates(void);
+
+	/** Queues some of the dirty chunks for saving, so that saving is spread over time instead of done in bursts.
+	Chunks that have been dirty for a_MaxDirtyAge ticks or longer are queued regardless of a_MaxChunks.
+	Of the rest, up to a_MaxChunks are queued: first those that could be unloaded once saved, then the ones dirty the longest;
+	chunks that could not be unloaded are only queued once they have been dirty for at least a_MinDirtyAge ticks,
+	so that chunks being modified aren't rewritten over and over.
+	Chunks whose data is already being saved are skipped, unless overdue.
+	Outputs the number of dirty chunks and the age of the oldest one, in ticks (0 if none).
+	Returns the number of chunks queued within the a_MaxChunks budget. */
+	size_t SaveDirtyChunks(Int64 a_WorldAge, Int64 a_MinDirtyAge, Int64 a_MaxDirtyAge, size_t a_MaxChunks, int & a_NumDirty, Int64 & a_OldestDirtyAge);
+
 	cWorld * GetWorld(void) { return m_World; }
 
 	int GetNumChunks(void);
@@ -406,6 +550,24 @@ private:
 	friend class cChunkStay;
 	
 
+	/** A dirty chunk considered for saving by SaveDirtyChunks() */
+	struct sDirtyChunk
+	{
+		cChunk * m_Chunk;
+		Int64 m_Age;  ///< Number of ticks the chunk has been dirty
+		bool m_CanUnload;  ///< True if the chunk could be unloaded once saved
+	};
+	typedef std::vector<sDirtyChunk> sDirtyChunks;
+
+	/** A chunk that may be unloaded, queued by AddUnloadCandidate() */
+	struct sUnloadCandidate
+	{
+		int m_ChunkX, m_ChunkZ;
+		Int64 m_Since;  ///< World age (in ticks) at which the chunk became unused
+		UInt32 m_ID;    ///< The entry's ID; the entry is stale unless the chunk's m_UnloadCandidateID matches it
+	};
+
+
 	class cChunkLayer
 	{
 	public:
@@ -428,9 +590,33 @@ private:
 		int GetNumChunksLoaded(void) const ;
 		
 		void GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty) const;
+
+		/** Adds the memory stats of all the chunks in the layer to a_Stats. */
+		void AddMemoryStats(sMemoryStats & a_Stats) const;
+
+		/** Adds the layer's chunks among the a_Count most expensive ones to a_Costs, see cChunkMap::GetTopChunkTickCosts(). */
+		void AddTopChunkTickCosts(size_t a_Count, std::vector<sChunkTickCost> & a_Costs) const;
+
+		/** Zeroes the accumulated tick time of all the chunks in the layer. */
+		void ResetChunkTickCosts(void);
+
+		/** Adds the snapshots of all the valid chunks in the layer to a_Snapshot, see cChunkMap::CreateSnapshot(). */
+		void CreateSnapshot(const cWorldSnapshot * a_Previous, cWorldSnapshot & a_Snapshot) const;
 		
 		void Save(void);
 		void UnloadUnusedChunks(void);
+
+		/** Deletes the specified chunk, if it exists in this layer. */
+		void UnloadChunk(int a_ChunkX, int a_ChunkZ);
+
+		/** Adds all the chunks in this layer that could be unloaded once saved to the parent's unload candidates. */
+		void CollectUnloadCandidates(void);
+
+		/** Marks all the chunks in this layer as not queued in the parent's unload candidates. */
+		void ResetUnloadCandidates(void);
+
+		/** Adds all valid dirty chunks in this layer to a_Dirty, stamping the newly dirty ones with a_WorldAge. */
+		void CollectDirtyChunks(Int64 a_WorldAge, sDirtyChunks & a_Dirty);
 		
 		/** Collect a mob census, of all mobs, their megatype, their chunk and their distance o closest player */
 		void CollectMobCensus(cMobCensus & a_ToFill);
@@ -445,12 +631,6 @@ private:
 		/** Calls the callback for each entity in the entire world; returns true if all entities processed, false if the callback aborted by returning true */
 		bool ForEachEntity(cEntityCallback & a_Callback);  // Lua-accessible
 
-		/** Calls the callback if the entity with the specified ID is found, with the entity object as the callback param. Returns true if entity found. */
-		bool DoWithEntityByID(UInt32 a_EntityID, cEntityCallback & a_Callback, bool & a_CallbackReturn);  // Lua-accessible
-
-		/** Returns true if there is an entity with the specified ID within this layer's chunks */
-		bool HasEntity(UInt32 a_EntityID);
-		
 	protected:
 	
 		cChunkPtr m_Chunks[LAYER_SIZE * LAYER_SIZE];
@@ -480,8 +660,43 @@ private:
 	};
 	
 	typedef std::list<cChunkLayer *> cChunkLayerList;
+
+	/** Open-addressing hash map of the layers, keyed by the layer coords, for O(1) lookup in FindLayer(). */
+	class cChunkLayerIndex
+	{
+	public:
+		cChunkLayerIndex(void);
+
+		/** Returns the layer with the specified coords, or nullptr if not present. */
+		cChunkLayer * Find(int a_LayerX, int a_LayerZ) const;
+
+		/** Adds the specified layer; the layer's coords must not be present yet. */
+		void Add(cChunkLayer * a_Layer);
+
+		/** Removes the layer with the specified coords, if present. */
+		void Remove(int a_LayerX, int a_LayerZ);
+
+	protected:
+		/** The slots, linearly probed. nullptr marks an empty slot, m_Tombstone marks a removed one. */
+		std::vector<cChunkLayer *> m_Slots;
+
+		/** Number of slots taken by layers. */
+		size_t m_NumUsed;
+
+		/** Number of slots taken by either layers or tombstones, used to decide when to rehash. */
+		size_t m_NumTaken;
+
+		/** Returns the slot index where the probing for the specified coords starts. */
+		size_t GetStartSlot(int a_LayerX, int a_LayerZ) const;
+
+		/** Rebuilds the table with the specified number of slots (power of 2), dropping all tombstones. */
+		void Rehash(size_t a_NumSlots);
+
+		/** Marker for removed slots, so that the probe sequences over them stay intact. */
+		static cChunkLayer * const m_Tombstone;
+	};
 	
-	typedef std::list<cChunkStay *> cChunkStays;
+	typedef std::vector<cChunkStay *> cChunkStays;
 
 	/** Finds the cChunkLayer object responsible for the specified chunk; returns nullptr if not found. Assumes m_CSLayers is locked. */
 	cChunkLayer * FindLayerForChunk(int a_ChunkX, int a_ChunkZ);
@@ -497,8 +712,23 @@ private:
 	
 	void RemoveLayer(cChunkLayer * a_Layer);
 
+	/** Returns true if the chunk containing the specified column is loaded and valid. */
+	bool IsChunkValidForColumn(int a_BlockX, int a_BlockZ);
+
+	/** Temporarily releases m_CSLayers, held by a_Lock, so that other threads waiting for the chunkmap can run.
+	Used between layers by the long all-layer operations, so that their lock hold time is bounded by a single layer.
+	Returns false if a layer has been removed meanwhile, in which case the caller's m_Layers iterators are invalid. */
+	bool YieldLayersLock(cCSLock & a_Lock);
+
 	cCriticalSection m_CSLayers;
 	cChunkLayerList  m_Layers;
+
+	/** Hashed index of m_Layers, protected by m_CSLayers. */
+	cChunkLayerIndex m_LayerIndex;
+
+	/** Identifies the current set of layers for the per-thread last-layer cache in FindLayer().
+	Assigned a new globally-unique value whenever a layer is removed, which invalidates all cached layer pointers. */
+	UInt32 m_LayersGeneration;
 	cEvent           m_evtChunkValid;  // Set whenever any chunk becomes valid, via ChunkValidated()
 
 	cWorld * m_World;
@@ -507,13 +737,36 @@ private:
 	sSetBlockList    m_FastSetBlockQueue;
 	
 	/** The cChunkStay descendants that are currently enabled in this chunkmap */
-	cChunkStays m_ChunkStays;
+	std::unordered_set<cChunkStay *> m_ChunkStays;
+
+	/** The enabled cChunkStay descendants containing each chunk, by the chunk key (see GetChunkStayKey()), so that a chunk
+	becoming available notifies only the ChunkStays waiting for it. Protected by m_CSLayers, same as m_ChunkStays. */
+	std::unordered_map<Int64, cChunkStays> m_ChunkStaysByChunk;
 
-	std::auto_ptr<cAllocationPool<cChunkData::sChunkSection> > m_Pool;
+	/** The chunks that may be unloadable, roughly in the order in which they became unused. Protected by m_CSLayers. */
+	std::deque<sUnloadCandidate> m_UnloadCandidates;
+
+	/** The ID to be given to the next entry in m_UnloadCandidates. Never 0, which marks the chunks that aren't queued. Protected by m_CSLayers. */
+	UInt32 m_NextUnloadCandidateID;
+
+	/** The chunk holding each entity, by the entity's UniqueID, so that the lookups by ID don't need to walk all the chunks.
+	Maintained by cChunk's entity index. Protected by m_CSLayers. */
+	std::unordered_map<UInt32, cChunk *> m_EntityChunks;
+
+	typedef cSlabAllocationPool<cChunkData::sChunkSection, 1600> cSectionPool;
+
+	std::unique_ptr<cSectionPool> m_Pool;
+
+	/** If true, Tick() keeps spare section memory allocated in the tick thread, see the constructor. */
+	bool m_ShouldAllocateInTickThread;
 
 	cChunkPtr GetChunk      (int a_ChunkX, int a_ChunkZ);  // Also queues the chunk for loading / generating if not valid
 	cChunkPtr GetChunkNoGen (int a_ChunkX, int a_ChunkZ);  // Also queues the chunk for loading if not valid; doesn't generate
 	cChunkPtr GetChunkNoLoad(int a_ChunkX, int a_ChunkZ);  // Doesn't load, doesn't generate
+
+	/** Adds the valid chunks in the specified rect (all coords inclusive) to a_Chunks. Returns false if any of the chunks isn't valid.
+	The caller is expected to hold m_CSLayers while using the chunks. */
+	bool GetValidChunksInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, std::vector<cChunkPtr> & a_Chunks);
 	
 	/** Gets a block in any chunk while in the cChunk's Tick() method; returns true if successful, false if chunk not loaded (doesn't queue load) */
 	bool LockedGetBlock(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta);
@@ -533,6 +786,10 @@ private:
 	/** Locates a chunk ptr in the chunkmap; doesn't create it when not found; assumes m_CSLayers is locked. To be called only from cChunkMap. */
 	cChunk * FindChunk(int a_ChunkX, int a_ChunkZ);
 
+	/** Queues the chunk for UnloadCandidateChunks(), unless already queued. Called by the chunk when it loses its last client
+	or ChunkStay; assumes m_CSLayers is locked. */
+	void AddUnloadCandidate(cChunk & a_Chunk);
+
 	/** Adds a new cChunkStay descendant to the internal list of ChunkStays; loads its chunks.
 	To be used only by cChunkStay; others should use cChunkStay::Enable() instead */
 	void AddChunkStay(cChunkStay & a_ChunkStay);
@@ -540,6 +797,19 @@ private:
 	/** Removes the specified cChunkStay descendant from the internal list of ChunkStays.
 	To be used only by cChunkStay; others should use cChunkStay::Disable() instead */
 	void DelChunkStay(cChunkStay & a_ChunkStay);
+
+	/** Returns the key of the specified chunk in m_ChunkStaysByChunk. */
+	static Int64 GetChunkStayKey(int a_ChunkX, int a_ChunkZ)
+	{
+		return (static_cast<Int64>(a_ChunkX) << 32) | static_cast<Int64>(static_cast<UInt32>(a_ChunkZ));
+	}
+
+	/** Casts the vanilla-style explosion rays from a_Center (absolute coords) through the blocks in a_Area, each ray weakened by the
+	blast resistance of the blocks it passes (cBlockInfo::GetBlastResistance()). Sets a_AffectedBy (indexed the same as the area's blocks)
+	to a_ExplosionNum for the non-air blocks reached by any of the rays with some power left, unless already set by a previous explosion;
+	the blocks destroyed by the previous explosions (lower non-zero a_AffectedBy) are passed as air.
+	Returns the number of the blocks newly affected. */
+	int CastExplosionRays(const cBlockArea & a_Area, double a_ExplosionSize, const Vector3d & a_Center, int a_ExplosionNum, std::vector<int> & a_AffectedBy);
 	
 };
 
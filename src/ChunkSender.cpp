@@ -11,13 +11,19 @@
 #include "ChunkSender.h"
 #include "World.h"
 #include "BlockEntities/BlockEntity.h"
-#include "Protocol/ChunkDataSerializer.h"
 #include "ClientHandle.h"
 
 
 
 
 
+/** Maximum number of bytes of serialized chunk data kept in the cache, per world */
+static const size_t MAX_SERIALIZATION_CACHE_SIZE = 32 * 1024 * 1024;
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cNotifyChunkSender:
 
@@ -30,6 +36,24 @@ void cNotifyChunkSender::Call(int a_ChunkX, int a_ChunkZ)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cChunkSender::sClientState:
+
+cChunkSender::sClientState::sClientState(double a_Tokens) :
+	m_Tokens(a_Tokens),
+	m_QueueDepth(0),
+	m_TotalBytes(0),
+	m_BytesPerSec(0),
+	m_MeasureBytes(0),
+	m_LastRefill(std::chrono::steady_clock::now()),
+	m_MeasureStart(m_LastRefill)
+{
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cChunkSender:
 
@@ -37,7 +61,10 @@ cChunkSender::cChunkSender(void) :
 	super("ChunkSender"),
 	m_World(nullptr),
 	m_RemoveCount(0),
-	m_Notify(nullptr)
+	m_MaxClientBytesPerSec(0),
+	m_Notify(nullptr),
+	m_SerializationCache(MAX_SERIALIZATION_CACHE_SIZE),
+	m_Revision(0)
 {
 	m_Notify.SetChunkSender(this);
 }
@@ -55,10 +82,11 @@ cChunkSender::~cChunkSender()
 
 
 
-bool cChunkSender::Start(cWorld * a_World)
+bool cChunkSender::Start(cWorld * a_World, int a_MaxClientBytesPerSec)
 {
 	m_ShouldTerminate = false;
 	m_World = a_World;
+	m_MaxClientBytesPerSec = std::max(a_MaxClientBytesPerSec, 0);
 	return super::Start();
 }
 
@@ -128,8 +156,16 @@ void cChunkSender::QueueSendChunkTo(int a_ChunkX, int a_ChunkZ, eChunkPriority a
 			default:
 			{
 				ASSERT(!"Unknown chunk priority!");
+				return;
 			}
 		}
+		
+		cClientStates::iterator itrState = m_ClientStates.find(a_Client);
+		if (itrState == m_ClientStates.end())
+		{
+			itrState = m_ClientStates.insert(std::make_pair(a_Client, sClientState(m_MaxClientBytesPerSec))).first;
+		}
+		itrState->second.m_QueueDepth += 1;
 	}
 	m_evtQueue.Set();
 }
@@ -169,6 +205,7 @@ void cChunkSender::RemoveClient(cClientHandle * a_Client)
 			}
 			++itr;
 		}  // for itr - m_SendChunksHighPriority[]
+		m_ClientStates.erase(a_Client);
 		m_RemoveCount++;
 	}
 	m_evtQueue.Set();
@@ -200,14 +237,13 @@ void cChunkSender::Execute(void)
 			}
 		}  // while (empty)
 
-		if (!m_SendChunksHighPriority.empty())
+		// High priority chunks (near the player) may borrow from the client's budget, so that they preempt the farther ones:
+		RefillBudgets();
+		sSendChunk Chunk(0, 0, nullptr);
+		if (TakeChunkWithinBudget(m_SendChunksHighPriority, true, Chunk))
 		{
-			// Take one from the queue:
-			sSendChunk Chunk(m_SendChunksHighPriority.front());
-			m_SendChunksHighPriority.pop_front();
 			Lock.Unlock();
-
-			SendChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Client);
+			ChargeClient(Chunk.m_Client, SendChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Client));
 		}
 		else if (!m_ChunksReady.empty())
 		{
@@ -218,23 +254,20 @@ void cChunkSender::Execute(void)
 			
 			SendChunk(Coords.m_ChunkX, Coords.m_ChunkZ, nullptr);
 		}
-		else if (!m_SendChunksMediumPriority.empty())
+		else if (
+			TakeChunkWithinBudget(m_SendChunksMediumPriority, false, Chunk) ||
+			TakeChunkWithinBudget(m_SendChunksLowPriority, false, Chunk)
+		)
 		{
-			// Take one from the queue:
-			sSendChunk Chunk(m_SendChunksMediumPriority.front());
-			m_SendChunksMediumPriority.pop_front();
 			Lock.Unlock();
-
-			SendChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Client);
+			ChargeClient(Chunk.m_Client, SendChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Client));
 		}
 		else
 		{
-			// Take one from the queue:
-			sSendChunk Chunk(m_SendChunksLowPriority.front());
-			m_SendChunksLowPriority.pop_front();
+			// All the queued chunks are for clients that have used up their budget, wait for the budgets to refill:
+			unsigned WaitTime = GetBudgetWaitTime();
 			Lock.Unlock();
-
-			SendChunk(Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Client);
+			m_evtQueue.Wait(WaitTime);
 		}
 		Lock.Lock();
 		int RemoveCount = m_RemoveCount;
@@ -251,41 +284,41 @@ void cChunkSender::Execute(void)
 
 
 
-void cChunkSender::SendChunk(int a_ChunkX, int a_ChunkZ, cClientHandle * a_Client)
+size_t cChunkSender::SendChunk(int a_ChunkX, int a_ChunkZ, cClientHandle * a_Client)
 {
 	ASSERT(m_World != nullptr);
 	
 	// Ask the client if it still wants the chunk:
 	if ((a_Client != nullptr) && !a_Client->WantsSendChunk(a_ChunkX, a_ChunkZ))
 	{
-		return;
+		return 0;
 	}
 
 	// If the chunk has no clients, no need to packetize it:
 	if (!m_World->HasChunkAnyClients(a_ChunkX, a_ChunkZ))
 	{
-		return;
+		return 0;
 	}
 
 	// If the chunk is not valid, do nothing - whoever needs it has queued it for loading / generating
 	if (!m_World->IsChunkValid(a_ChunkX, a_ChunkZ))
 	{
-		return;
+		return 0;
 	}
 
 	// If the chunk is not lighted, queue it for relighting and get notified when it's ready:
 	if (!m_World->IsChunkLighted(a_ChunkX, a_ChunkZ))
 	{
 		m_World->QueueLightChunk(a_ChunkX, a_ChunkZ, &m_Notify);
-		return;
+		return 0;
 	}
 
 	// Query and prepare chunk data:
 	if (!m_World->GetChunkData(a_ChunkX, a_ChunkZ, *this))
 	{
-		return;
+		return 0;
 	}
-	cChunkDataSerializer Data(m_BlockTypes, m_BlockMetas, m_BlockLight, m_BlockSkyLight, m_BiomeMap);
+	cChunkDataSerializer Data(m_BlockTypes, m_BlockMetas, m_BlockLight, m_BlockSkyLight, m_BiomeMap, m_NumSections, &m_SerializationCache, m_Revision);
 
 	// Send:
 	if (a_Client == nullptr)
@@ -312,6 +345,185 @@ void cChunkSender::SendChunk(int a_ChunkX, int a_ChunkZ, cClientHandle * a_Clien
 	m_BlockEntities.clear();
 
 	// TODO: Send entity spawn packets
+	
+	return Data.GetSerializedSize();
+}
+
+
+
+
+
+void cChunkSender::CancelSendChunksTo(const cChunkCoordsList & a_Chunks, cClientHandle * a_Client)
+{
+	cCSLock Lock(m_CS);
+	CancelChunksInList(m_SendChunksHighPriority,   a_Chunks, a_Client);
+	CancelChunksInList(m_SendChunksMediumPriority, a_Chunks, a_Client);
+	CancelChunksInList(m_SendChunksLowPriority,    a_Chunks, a_Client);
+}
+
+
+
+
+
+size_t cChunkSender::GetQueueLength(void)
+{
+	cCSLock Lock(m_CS);
+	return m_ChunksReady.size() + m_SendChunksLowPriority.size() + m_SendChunksMediumPriority.size() + m_SendChunksHighPriority.size();
+}
+
+
+
+
+
+bool cChunkSender::GetClientStats(const cClientHandle * a_Client, sClientStats & a_Stats)
+{
+	cCSLock Lock(m_CS);
+	cClientStates::const_iterator itr = m_ClientStates.find(a_Client);
+	if (itr == m_ClientStates.end())
+	{
+		return false;
+	}
+	a_Stats.m_QueueDepth = itr->second.m_QueueDepth;
+	a_Stats.m_TotalBytes = itr->second.m_TotalBytes;
+	a_Stats.m_BytesPerSec = itr->second.m_BytesPerSec;
+	
+	// If nothing has been sent for a while, the last measurement is stale, report the current window instead:
+	double Elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - itr->second.m_MeasureStart).count();
+	if (Elapsed >= 2)
+	{
+		a_Stats.m_BytesPerSec = itr->second.m_MeasureBytes / Elapsed;
+	}
+	return true;
+}
+
+
+
+
+
+void cChunkSender::RefillBudgets(void)
+{
+	if (m_MaxClientBytesPerSec == 0)
+	{
+		return;
+	}
+	auto Now = std::chrono::steady_clock::now();
+	for (cClientStates::iterator itr = m_ClientStates.begin(); itr != m_ClientStates.end(); ++itr)
+	{
+		double Elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(Now - itr->second.m_LastRefill).count();
+		itr->second.m_Tokens = std::min(itr->second.m_Tokens + Elapsed * m_MaxClientBytesPerSec, static_cast<double>(m_MaxClientBytesPerSec));
+		itr->second.m_LastRefill = Now;
+	}
+}
+
+
+
+
+
+bool cChunkSender::TakeChunkWithinBudget(sSendChunkList & a_List, bool a_MayBorrow, sSendChunk & a_Chunk)
+{
+	double MinTokens = a_MayBorrow ? -static_cast<double>(m_MaxClientBytesPerSec) : 0;
+	for (sSendChunkList::iterator itr = a_List.begin(); itr != a_List.end(); ++itr)
+	{
+		cClientStates::iterator itrState = m_ClientStates.find(itr->m_Client);
+		ASSERT(itrState != m_ClientStates.end());
+		if (itrState == m_ClientStates.end())
+		{
+			continue;
+		}
+		if ((m_MaxClientBytesPerSec != 0) && (itrState->second.m_Tokens <= MinTokens))
+		{
+			continue;
+		}
+		itrState->second.m_QueueDepth -= 1;
+		a_Chunk = *itr;
+		a_List.erase(itr);
+		return true;
+	}
+	return false;
+}
+
+
+
+
+
+void cChunkSender::CancelChunksInList(sSendChunkList & a_List, const cChunkCoordsList & a_Chunks, cClientHandle * a_Client)
+{
+	cClientStates::iterator itrState = m_ClientStates.find(a_Client);
+	for (sSendChunkList::iterator itr = a_List.begin(); itr != a_List.end();)
+	{
+		if (
+			(itr->m_Client == a_Client) &&
+			(std::find(a_Chunks.begin(), a_Chunks.end(), cChunkCoords(itr->m_ChunkX, itr->m_ChunkZ)) != a_Chunks.end())
+		)
+		{
+			if (itrState != m_ClientStates.end())
+			{
+				itrState->second.m_QueueDepth -= 1;
+			}
+			itr = a_List.erase(itr);
+			continue;
+		}
+		++itr;
+	}
+}
+
+
+
+
+
+void cChunkSender::ChargeClient(const cClientHandle * a_Client, size_t a_NumBytes)
+{
+	cCSLock Lock(m_CS);
+	cClientStates::iterator itr = m_ClientStates.find(a_Client);
+	if (itr == m_ClientStates.end())
+	{
+		// The client has been removed while its chunk was being sent
+		return;
+	}
+	sClientState & State = itr->second;
+	State.m_Tokens -= a_NumBytes;
+	State.m_TotalBytes += a_NumBytes;
+	State.m_MeasureBytes += a_NumBytes;
+	
+	// Update the rate measurement once per second:
+	auto Now = std::chrono::steady_clock::now();
+	double Elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(Now - State.m_MeasureStart).count();
+	if (Elapsed >= 1)
+	{
+		State.m_BytesPerSec = State.m_MeasureBytes / Elapsed;
+		State.m_MeasureBytes = 0;
+		State.m_MeasureStart = Now;
+	}
+}
+
+
+
+
+
+unsigned cChunkSender::GetBudgetWaitTime(void)
+{
+	double MaxTokens = -static_cast<double>(m_MaxClientBytesPerSec);
+	for (cClientStates::const_iterator itr = m_ClientStates.begin(); itr != m_ClientStates.end(); ++itr)
+	{
+		if (itr->second.m_QueueDepth > 0)
+		{
+			MaxTokens = std::max(MaxTokens, itr->second.m_Tokens);
+		}
+	}
+	if ((m_MaxClientBytesPerSec == 0) || (MaxTokens > 0))
+	{
+		return 1;
+	}
+	return static_cast<unsigned>(-MaxTokens * 1000 / m_MaxClientBytesPerSec) + 1;
+}
+
+
+
+
+
+void cChunkSender::Revision(UInt32 a_Revision)
+{
+	m_Revision = a_Revision;
 }
 
 
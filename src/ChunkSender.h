@@ -28,6 +28,7 @@ Note that it may be called by world's BroadcastToChunk() if the client is still
 #include "OSSupport/IsThread.h"
 #include "ChunkDef.h"
 #include "ChunkDataCallback.h"
+#include "Protocol/ChunkDataSerializer.h"
 
 
 
@@ -83,7 +84,17 @@ public:
 		E_CHUNK_PRIORITY_LOW    = 2,
 	};
 	
-	bool Start(cWorld * a_World);
+	/** Send statistics of a single client, as reported by GetClientStats() */
+	struct sClientStats
+	{
+		size_t m_QueueDepth;   ///< Number of chunks queued for the client
+		UInt64 m_TotalBytes;   ///< Total number of chunk data bytes sent to the client
+		double m_BytesPerSec;  ///< Chunk data rate measured over the last second
+	} ;
+	
+	/** Starts the sender thread.
+	a_MaxClientBytesPerSec limits the rate of chunk data sent to each client, 0 means unlimited. */
+	bool Start(cWorld * a_World, int a_MaxClientBytesPerSec);
 	
 	void Stop(void);
 	
@@ -96,6 +107,20 @@ public:
 	/// Removes the a_Client from all waiting chunk send operations
 	void RemoveClient(cClientHandle * a_Client);
 	
+	/** Removes the specified chunks from the queues of chunks waiting to be sent to a_Client.
+	Unlike RemoveClient(), doesn't wait for the chunk being currently sent. */
+	void CancelSendChunksTo(const cChunkCoordsList & a_Chunks, cClientHandle * a_Client);
+	
+	/** Fills a_Stats with the chunk send statistics of the specified client.
+	Returns false if the client has never had any chunks queued. */
+	bool GetClientStats(const cClientHandle * a_Client, sClientStats & a_Stats);
+
+	/** Returns the number of the chunks waiting to be sent, to all the clients together. */
+	size_t GetQueueLength(void);
+
+	/** Returns the number of the chunk serializations cached and their total size in bytes. */
+	void GetSerializationCacheStats(size_t & a_NumEntries, size_t & a_NumBytes) { m_SerializationCache.GetStats(a_NumEntries, a_NumBytes); }
+	
 protected:
 
 	/// Used for sending chunks to specific clients
@@ -139,6 +164,28 @@ protected:
 
 	typedef std::vector<sBlockCoord> sBlockCoords;
 	
+	/** The send-rate state of a single client: a token bucket of chunk data bytes, plus the statistics */
+	struct sClientState
+	{
+		/** Bytes that the client may still receive. Refilled at the configured rate, up to one second's worth.
+		May go negative, a chunk is sent whole even if it is larger than the remaining budget. */
+		double m_Tokens;
+		
+		size_t m_QueueDepth;
+		UInt64 m_TotalBytes;
+		double m_BytesPerSec;
+		
+		/** Bytes sent since m_MeasureStart, for the m_BytesPerSec measurement */
+		UInt64 m_MeasureBytes;
+		
+		std::chrono::steady_clock::time_point m_LastRefill;
+		std::chrono::steady_clock::time_point m_MeasureStart;
+		
+		sClientState(double a_Tokens);
+	} ;
+	
+	typedef std::map<const cClientHandle *, sClientState> cClientStates;
+	
 	cWorld * m_World;
 	
 	cCriticalSection  m_CS;
@@ -150,12 +197,22 @@ protected:
 	cEvent            m_evtRemoved;  // Set when removed clients are safe to be deleted
 	int               m_RemoveCount;  // Number of threads waiting for a client removal (m_evtRemoved needs to be set this many times)
 	
+	/** Maximum chunk data rate per client, in bytes per second. 0 means unlimited. */
+	int m_MaxClientBytesPerSec;
+	
+	/** Send-rate state of the clients that have chunks queued, protected by m_CS */
+	cClientStates m_ClientStates;
+	
 	cNotifyChunkSender m_Notify;  // Used for chunks that don't have a valid lighting - they will be re-queued after lightcalc
 	
+	/** Serialized chunk data, reused across clients and across sends of the same unchanged chunk */
+	cChunkDataSerializer::cCache m_SerializationCache;
+	
 	// Data about the chunk that is being sent:
 	// NOTE that m_BlockData[] is inherited from the cChunkDataCollector
 	unsigned char m_BiomeMap[cChunkDef::Width * cChunkDef::Width];
 	sBlockCoords  m_BlockEntities;  // Coords of the block entities to send
+	UInt32        m_Revision;       // Revision of the chunk contents, stamps the cached serializations
 	// TODO: sEntityIDs    m_Entities;       // Entity-IDs of the entities to send
 	
 	// cIsThread override:
@@ -163,12 +220,31 @@ protected:
 	
 	// cChunkDataCollector overrides:
 	// (Note that they are called while the ChunkMap's CS is locked - don't do heavy calculations here!)
+	virtual void Revision     (UInt32 a_Revision) override;
 	virtual void BiomeData    (const cChunkDef::BiomeMap * a_BiomeMap) override;
 	virtual void Entity       (cEntity *      a_Entity) override;
 	virtual void BlockEntity  (cBlockEntity * a_Entity) override;
 
-	/// Sends the specified chunk to a_Client, or to all chunk clients if a_Client == nullptr
-	void SendChunk(int a_ChunkX, int a_ChunkZ, cClientHandle * a_Client);
+	/** Sends the specified chunk to a_Client, or to all chunk clients if a_Client == nullptr.
+	Returns the number of bytes of chunk data serialized for the send, 0 if nothing was sent. */
+	size_t SendChunk(int a_ChunkX, int a_ChunkZ, cClientHandle * a_Client);
+	
+	/** Adds the tokens earned since the last refill to all the client buckets. Expects m_CS to be locked. */
+	void RefillBudgets(void);
+	
+	/** Takes the first chunk out of a_List whose client may receive data.
+	A client may receive data while it has a positive budget; if a_MayBorrow is true, until it is one full second's worth in debt.
+	Returns false if there's no such chunk. Expects m_CS to be locked. */
+	bool TakeChunkWithinBudget(sSendChunkList & a_List, bool a_MayBorrow, sSendChunk & a_Chunk);
+	
+	/** Removes the chunks in a_Chunks queued for a_Client from a_List. Expects m_CS to be locked. */
+	void CancelChunksInList(sSendChunkList & a_List, const cChunkCoordsList & a_Chunks, cClientHandle * a_Client);
+	
+	/** Charges the client for a_NumBytes sent to it. */
+	void ChargeClient(const cClientHandle * a_Client, size_t a_NumBytes);
+	
+	/** Returns the time, in msec, until the first of the clients with queued chunks can receive data again. Expects m_CS to be locked. */
+	unsigned GetBudgetWaitTime(void);
 } ;
 
 
@@ -0,0 +1,92 @@
+
+// ChunkSnapshot.cpp
+
+// Implements the cChunkSnapshot class representing a read-only copy of a chunk's blocks, and the cWorldSnapshot class representing a consistent set of them for a whole world
+
+#include "Globals.h"
+#include "ChunkSnapshot.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkSnapshot:
+
+cChunkSnapshot::cChunkSnapshot(
+	int a_ChunkX, int a_ChunkZ, UInt32 a_Revision,
+	cChunkData && a_Data,
+	const cChunkDef::HeightMap & a_HeightMap,
+	const cChunkDef::BiomeMap & a_BiomeMap
+) :
+	m_ChunkX(a_ChunkX),
+	m_ChunkZ(a_ChunkZ),
+	m_Revision(a_Revision),
+	m_Data(std::move(a_Data))
+{
+	memcpy(m_HeightMap, a_HeightMap, sizeof(m_HeightMap));
+	memcpy(m_BiomeMap, a_BiomeMap, sizeof(m_BiomeMap));
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cWorldSnapshot:
+
+cWorldSnapshot::cWorldSnapshot(UInt32 a_Number) :
+	m_Number(a_Number)
+{
+}
+
+
+
+
+
+cChunkSnapshotPtr cWorldSnapshot::GetChunk(int a_ChunkX, int a_ChunkZ) const
+{
+	cChunkSnapshots::const_iterator itr = m_Chunks.find(GetChunkKey(a_ChunkX, a_ChunkZ));
+	if (itr == m_Chunks.end())
+	{
+		return cChunkSnapshotPtr();
+	}
+	return itr->second;
+}
+
+
+
+
+
+bool cWorldSnapshot::GetBlockTypeMeta(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta) const
+{
+	if ((a_BlockY < 0) || (a_BlockY >= cChunkDef::Height))
+	{
+		return false;
+	}
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(a_BlockX, a_BlockZ, ChunkX, ChunkZ);
+	cChunkSnapshots::const_iterator itr = m_Chunks.find(GetChunkKey(ChunkX, ChunkZ));
+	if (itr == m_Chunks.end())
+	{
+		return false;
+	}
+	int RelX = a_BlockX - ChunkX * cChunkDef::Width;
+	int RelZ = a_BlockZ - ChunkZ * cChunkDef::Width;
+	a_BlockType = itr->second->GetBlock(RelX, a_BlockY, RelZ);
+	a_BlockMeta = itr->second->GetMeta(RelX, a_BlockY, RelZ);
+	return true;
+}
+
+
+
+
+
+void cWorldSnapshot::AddChunk(const cChunkSnapshotPtr & a_Chunk)
+{
+	m_Chunks[GetChunkKey(a_Chunk->GetChunkX(), a_Chunk->GetChunkZ())] = a_Chunk;
+}
+
+
+
+
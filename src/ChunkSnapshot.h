@@ -0,0 +1,110 @@
+
+// ChunkSnapshot.h
+
+// Declares the cChunkSnapshot class representing a read-only copy of a chunk's blocks, and the cWorldSnapshot class representing a consistent set of them for a whole world
+
+
+
+
+
+#pragma once
+
+#include <unordered_map>
+#include "ChunkData.h"
+
+
+
+
+
+/** A read-only copy of a single chunk's blocks, light, heightmap and biomes, as they were when the snapshot was taken.
+The snapshots are immutable, so they can be read from any thread without any locking.
+The block data is allocated from the chunkmap's section pool, so all the snapshots need to be released before the world is destroyed. */
+class cChunkSnapshot
+{
+public:
+	cChunkSnapshot(
+		int a_ChunkX, int a_ChunkZ, UInt32 a_Revision,
+		cChunkData && a_Data,
+		const cChunkDef::HeightMap & a_HeightMap,
+		const cChunkDef::BiomeMap & a_BiomeMap
+	);
+
+	int GetChunkX(void) const { return m_ChunkX; }
+	int GetChunkZ(void) const { return m_ChunkZ; }
+
+	/** Returns the cChunk::GetRevision() of the chunk at the time the snapshot was taken. */
+	UInt32 GetRevision(void) const { return m_Revision; }
+
+	BLOCKTYPE  GetBlock     (int a_RelX, int a_RelY, int a_RelZ) const { return m_Data.GetBlock(a_RelX, a_RelY, a_RelZ); }
+	NIBBLETYPE GetMeta      (int a_RelX, int a_RelY, int a_RelZ) const { return m_Data.GetMeta(a_RelX, a_RelY, a_RelZ); }
+	NIBBLETYPE GetBlockLight(int a_RelX, int a_RelY, int a_RelZ) const { return m_Data.GetBlockLight(a_RelX, a_RelY, a_RelZ); }
+	NIBBLETYPE GetSkyLight  (int a_RelX, int a_RelY, int a_RelZ) const { return m_Data.GetSkyLight(a_RelX, a_RelY, a_RelZ); }
+
+	/** Returns the height of the highest non-air block in the specified column. */
+	int GetHeight(int a_RelX, int a_RelZ) const { return cChunkDef::GetHeight(m_HeightMap, a_RelX, a_RelZ); }
+
+	EMCSBiome GetBiome(int a_RelX, int a_RelZ) const { return cChunkDef::GetBiome(m_BiomeMap, a_RelX, a_RelZ); }
+
+	/** Returns the whole block data, for the bulk copying functions of cChunkData. */
+	const cChunkData & GetData(void) const { return m_Data; }
+
+protected:
+	int m_ChunkX;
+	int m_ChunkZ;
+	UInt32 m_Revision;
+	cChunkData m_Data;
+	cChunkDef::HeightMap m_HeightMap;
+	cChunkDef::BiomeMap m_BiomeMap;
+} ;
+
+typedef std::shared_ptr<const cChunkSnapshot> cChunkSnapshotPtr;
+
+
+
+
+
+/** A consistent set of the snapshots of all the valid chunks in a world, published periodically by the world's tick thread.
+All the chunks in a single cWorldSnapshot were copied in the same tick. The chunks that haven't changed since the
+previous snapshot share their cChunkSnapshot with it, so publishing only copies the chunks that have changed.
+Once published, the object is never modified; readers keep it alive by holding the cWorldSnapshotPtr. */
+class cWorldSnapshot
+{
+public:
+	typedef std::unordered_map<Int64, cChunkSnapshotPtr> cChunkSnapshots;
+
+	cWorldSnapshot(UInt32 a_Number);
+
+	/** Returns the sequence number of the snapshot; each snapshot has a higher number than the one it was built upon. */
+	UInt32 GetNumber(void) const { return m_Number; }
+
+	/** Returns the snapshot of the specified chunk, or an empty pointer if the chunk wasn't valid when the snapshot was taken. */
+	cChunkSnapshotPtr GetChunk(int a_ChunkX, int a_ChunkZ) const;
+
+	/** Returns the block type and meta at the specified absolute coords.
+	Returns false if the chunk isn't in the snapshot or the coords are out of the world. */
+	bool GetBlockTypeMeta(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta) const;
+
+	/** Returns all the chunks in the snapshot. */
+	const cChunkSnapshots & GetChunks(void) const { return m_Chunks; }
+
+	size_t GetNumChunks(void) const { return m_Chunks.size(); }
+
+	/** Adds the chunk to the snapshot. Only to be used while the snapshot is being built, before it is published. */
+	void AddChunk(const cChunkSnapshotPtr & a_Chunk);
+
+	/** Returns the key of the specified chunk in GetChunks(). */
+	static Int64 GetChunkKey(int a_ChunkX, int a_ChunkZ)
+	{
+		return (static_cast<Int64>(a_ChunkX) << 32) | static_cast<Int64>(static_cast<UInt32>(a_ChunkZ));
+	}
+
+protected:
+	UInt32 m_Number;
+	cChunkSnapshots m_Chunks;
+} ;
+
+typedef std::shared_ptr<const cWorldSnapshot> cWorldSnapshotPtr;
+
+
+
+
@@ -46,6 +46,26 @@
 Vanilla sends one ping every 1 second. */
 static const std::chrono::milliseconds PING_TIME_MS = std::chrono::milliseconds(1000);
 
+/** The interval, in ticks, in which the player's movement is sampled for prefetching the chunks ahead of them */
+static const int PREFETCH_INTERVAL_TICKS = 20;
+
+/** Players moving slower than this (horizontally, in blocks per second) are kept up with by the regular streaming.
+Set just above the sprinting speed, so that minecarts, horses and flying get prefetching. */
+static const double PREFETCH_MIN_SPEED = 6;
+
+/** Players moving faster than this have been teleported rather than travelling, there's no path to predict */
+static const double PREFETCH_MAX_SPEED = 100;
+
+/** How far ahead along the predicted path the chunks are prefetched, in seconds of travel */
+static const double PREFETCH_LOOKAHEAD_SECONDS = 5;
+
+/** The maximum number of chunks streamed to a single client per tick */
+static const int MAX_CHUNKS_STREAMED_PER_TICK = 4;
+
+/** A freshly joined client streams a single chunk per tick at first, and one more each this many ticks, up to MAX_CHUNKS_STREAMED_PER_TICK.
+Keeps a mass join from flooding the chunk sender at the expense of the players already playing. */
+static const int CHUNK_STREAM_RAMP_TICKS = 40;
+
 
 
 
@@ -64,11 +84,18 @@ cClientHandle::cClientHandle(const AString & a_IPString, int a_ViewDistance) :
 	m_CurrentViewDistance(a_ViewDistance),
 	m_RequestedViewDistance(a_ViewDistance),
 	m_IPString(a_IPString),
+	m_DecodeOnNetworkThread(false),
+	m_NetworkStats(std::make_shared<cClientNetworkStats>()),
 	m_Player(nullptr),
 	m_HasSentDC(false),
 	m_LastStreamedChunkX(0x7fffffff),  // bogus chunk coords to force streaming upon login
 	m_LastStreamedChunkZ(0x7fffffff),
+	m_LastStreamedDirection(-1),
+	m_LastStreamedViewDistance(0),
+	m_NextStreamIdx(0),
+	m_LastPrefetchPos(0, 0, 0),
 	m_TicksSinceLastPacket(0),
+	m_TicksSinceJoin(0),
 	m_Ping(1000),
 	m_PingID(1),
 	m_BlockDigAnimStage(-1),
@@ -90,7 +117,9 @@ cClientHandle::cClientHandle(const AString & a_IPString, int a_ViewDistance) :
 	m_LastPlacedSign(0, -1, 0),
 	m_ProtocolVersion(0)
 {
-	m_Protocol = new cProtocolRecognizer(this);
+	m_CSOutgoingData.SetName("cClientHandle::m_CSOutgoingData");
+	m_ProtocolRecognizer = new cProtocolRecognizer(this);
+	m_Protocol = m_ProtocolRecognizer;
 	
 	s_ClientCount++;  // Not protected by CS because clients are always constructed from the same thread
 	m_UniqueID = s_ClientCount;
@@ -138,8 +167,9 @@ cClientHandle::~cClientHandle()
 		SendDisconnect("Server shut down? Kthnxbai");
 	}
 	
-	delete m_Protocol;
 	m_Protocol = nullptr;
+	delete m_ProtocolRecognizer;
+	m_ProtocolRecognizer = nullptr;
 	
 	LOGD("ClientHandle at %p deleted", this);
 }
@@ -325,6 +355,12 @@ void cClientHandle::Authenticate(const AString & a_Name, const AString & a_UUID,
 	{
 		m_UUID = a_UUID;
 	}
+	else
+	{
+		// The proxy has verified the profile, store it in the MojangAPI caches the same way the authenticator does,
+		// so that the later name and UUID lookups for this player don't need to ask the Mojang servers:
+		cRoot::Get()->GetMojangAPI().AddPlayerProfile(m_Username, m_UUID, m_Properties);
+	}
 	if (m_Properties.empty())
 	{
 		m_Properties = a_Properties;
@@ -371,7 +407,7 @@ void cClientHandle::Authenticate(const AString & a_Name, const AString & a_UUID,
 	m_Protocol->SendTimeUpdate(World->GetWorldAge(), World->GetTimeOfDay(), World->IsDaylightCycleEnabled());
 
 	// Send contents of the inventory window
-	m_Protocol->SendWholeInventory(*m_Player->GetWindow());
+	m_Player->GetWindow()->SendWholeWindow(*this);
 
 	// Send health
 	m_Player->SendHealth();
@@ -417,101 +453,178 @@ bool cClientHandle::StreamNextChunk(void)
 
 	int ChunkPosX = m_Player->GetChunkX();
 	int ChunkPosZ = m_Player->GetChunkZ();
-	if ((m_LastStreamedChunkX == ChunkPosX) && (m_LastStreamedChunkZ == ChunkPosZ))
+
+	// Get the horizontal look direction, quantized into 45-degree sectors so that small head movements don't reorder the streaming:
+	Vector3d LookVector = m_Player->GetLookVector();
+	double LookLength = sqrt(LookVector.x * LookVector.x + LookVector.z * LookVector.z);
+	int Direction = -1;
+	if (LookLength > 0.01)
 	{
-		// All chunks are already loaded. Abort loading.
-		return true;
+		Direction = (FloorC(atan2(LookVector.z, LookVector.x) * 4 / M_PI + 0.5) + 8) % 8;
 	}
 
-	// Get the look vector and normalize it.
-	Vector3d Position = m_Player->GetEyePosition();
-	Vector3d LookVector = m_Player->GetLookVector();
-	LookVector.Normalize();
+	bool HasMovedFar = false;
+	{
+		cCSLock Lock(m_CSChunkLists);
+		if (
+			(m_LastStreamedChunkX != ChunkPosX) ||
+			(m_LastStreamedChunkZ != ChunkPosZ) ||
+			(m_LastStreamedDirection != Direction) ||
+			(m_LastStreamedViewDistance != m_CurrentViewDistance)
+		)
+		{
+			// Moving into an adjacent chunk is left for the periodic unload; anything further (teleport, fast flying) unloads right away:
+			HasMovedFar = (
+				(m_LastStreamedChunkX != 0x7fffffff) &&
+				((Diff(m_LastStreamedChunkX, ChunkPosX) > 1) || (Diff(m_LastStreamedChunkZ, ChunkPosZ) > 1))
+			);
+			if (Direction < 0)
+			{
+				BuildStreamOrder(ChunkPosX, ChunkPosZ, 0, 0);
+			}
+			else
+			{
+				BuildStreamOrder(ChunkPosX, ChunkPosZ, LookVector.x / LookLength, LookVector.z / LookLength);
+			}
+			m_LastStreamedChunkX = ChunkPosX;
+			m_LastStreamedChunkZ = ChunkPosZ;
+			m_LastStreamedDirection = Direction;
+			m_LastStreamedViewDistance = m_CurrentViewDistance;
+		}
+	}
+	if (HasMovedFar)
+	{
+		UnloadOutOfRangeChunks();
+	}
 
-	// Lock the list
+	// Stream the first chunk in the order that isn't loaded / loading yet:
 	cCSLock Lock(m_CSChunkLists);
-
-	// High priority: Load the chunks that are in the view-direction of the player (with a radius of 3)
-	for (int Range = 0; Range < m_CurrentViewDistance; Range++)
+	while (m_NextStreamIdx < m_StreamOrder.size())
 	{
-		Vector3d Vector = Position + LookVector * cChunkDef::Width * Range;
+		const sChunkToStream & Chunk = m_StreamOrder[m_NextStreamIdx];
+		m_NextStreamIdx += 1;
+		cChunkCoords Coords(Chunk.m_ChunkX, Chunk.m_ChunkZ);
+		if (
+			(std::find(m_ChunksToSend.begin(), m_ChunksToSend.end(), Coords) != m_ChunksToSend.end()) ||
+			(std::find(m_LoadedChunks.begin(), m_LoadedChunks.end(), Coords) != m_LoadedChunks.end())
+		)
+		{
+			continue;
+		}
 
-		// Get the chunk from the x / z coords.
-		int RangeX, RangeZ = 0;
-		cChunkDef::BlockToChunk(FloorC(Vector.x), FloorC(Vector.z), RangeX, RangeZ);
+		// Unloaded chunk found -> Send it to the client.
+		cChunkSender::eChunkPriority Priority = Chunk.m_Priority;
+		Lock.Unlock();
+		StreamChunk(Coords.m_ChunkX, Coords.m_ChunkZ, Priority);
+		return false;
+	}
 
-		for (size_t X = 0; X < 7; X++)
-		{
-			for (size_t Z = 0; Z < 7; Z++)
-			{
-				int ChunkX = RangeX + ((X >= 4) ? (3 - X) : X);
-				int ChunkZ = RangeZ + ((Z >= 4) ? (3 - Z) : Z);
-				cChunkCoords Coords(ChunkX, ChunkZ);
+	// All chunks are loaded
+	return true;
+}
 
-				// Checks if the chunk is in distance
-				if ((Diff(ChunkX, ChunkPosX) > m_CurrentViewDistance) || (Diff(ChunkZ, ChunkPosZ) > m_CurrentViewDistance))
-				{
-					continue;
-				}
 
-				// If the chunk already loading / loaded -> skip
-				if (
-					(std::find(m_ChunksToSend.begin(), m_ChunksToSend.end(), Coords) != m_ChunksToSend.end()) ||
-					(std::find(m_LoadedChunks.begin(), m_LoadedChunks.end(), Coords) != m_LoadedChunks.end())
-				)
-				{
-					continue;
-				}
 
-				// Unloaded chunk found -> Send it to the client.
-				Lock.Unlock();
-				StreamChunk(ChunkX, ChunkZ, ((Range <= 2) ? cChunkSender::E_CHUNK_PRIORITY_HIGH : cChunkSender::E_CHUNK_PRIORITY_MEDIUM));
-				return false;
-			}
-		}
-	}
 
-	// Low priority: Add all chunks that are in range. (From the center out to the edge)
-	for (int d = 0; d <= m_CurrentViewDistance; ++d)  // cycle through (square) distance, from nearest to furthest
+
+void cClientHandle::BuildStreamOrder(int a_ChunkPosX, int a_ChunkPosZ, double a_LookX, double a_LookZ)
+{
+	// Chunks in the look direction are weighted as if they were up to this fraction nearer, and those behind as this much farther:
+	const double LookWeight = 0.4;
+
+	typedef std::pair<double, sChunkToStream> cScoredChunk;
+	std::vector<cScoredChunk> Chunks;
+	int ViewDistance = m_CurrentViewDistance;
+	Chunks.reserve(static_cast<size_t>((2 * ViewDistance + 1) * (2 * ViewDistance + 1)));
+	for (int z = -ViewDistance; z <= ViewDistance; z++)
 	{
-		// For each distance add chunks in a hollow square centered around current position:
-		cChunkCoordsList CurcleChunks;
-		for (int i = -d; i <= d; ++i)
+		for (int x = -ViewDistance; x <= ViewDistance; x++)
 		{
-			CurcleChunks.push_back(cChunkCoords(ChunkPosX + d, ChunkPosZ + i));
-			CurcleChunks.push_back(cChunkCoords(ChunkPosX - d, ChunkPosZ + i));
+			double Dist = sqrt(static_cast<double>(x * x + z * z));
+			double Dot = (Dist > 0) ? ((x * a_LookX + z * a_LookZ) / Dist) : 0;
+			cChunkSender::eChunkPriority Priority;
+			double Score;
+			if (Dist <= 2)
+			{
+				// The immediate surroundings go first regardless of the look direction:
+				Priority = cChunkSender::E_CHUNK_PRIORITY_HIGH;
+				Score = Dist;
+			}
+			else
+			{
+				Priority = (Dot > 0.5) ? cChunkSender::E_CHUNK_PRIORITY_MEDIUM : cChunkSender::E_CHUNK_PRIORITY_LOW;
+				Score = Dist * (1 - LookWeight * Dot);
+			}
+			Chunks.push_back(cScoredChunk(Score, sChunkToStream(a_ChunkPosX + x, a_ChunkPosZ + z, Priority)));
 		}
-		for (int i = -d + 1; i < d; ++i)
+	}
+	std::stable_sort(Chunks.begin(), Chunks.end(),
+		[](const cScoredChunk & a_First, const cScoredChunk & a_Second)
 		{
-			CurcleChunks.push_back(cChunkCoords(ChunkPosX + i, ChunkPosZ + d));
-			CurcleChunks.push_back(cChunkCoords(ChunkPosX + i, ChunkPosZ - d));
+			return (a_First.first < a_Second.first);
 		}
+	);
 
-		// For each the CurcleChunks list and send the first unloaded chunk:
-		for (cChunkCoordsList::iterator itr = CurcleChunks.begin(), end = CurcleChunks.end(); itr != end; ++itr)
-		{
-			cChunkCoords Coords = *itr;
+	m_StreamOrder.clear();
+	m_StreamOrder.reserve(Chunks.size());
+	for (std::vector<cScoredChunk>::const_iterator itr = Chunks.begin(), end = Chunks.end(); itr != end; ++itr)
+	{
+		m_StreamOrder.push_back(itr->second);
+	}
+	m_NextStreamIdx = 0;
+}
+
+
+
+
+
+void cClientHandle::PrefetchChunksAhead(void)
+{
+	ASSERT(m_Player != nullptr);
+
+	// Estimate the horizontal velocity, in blocks per second:
+	Vector3d Pos = m_Player->GetPosition();
+	const double Seconds = PREFETCH_INTERVAL_TICKS / 20.0;
+	double VelocityX = (Pos.x - m_LastPrefetchPos.x) / Seconds;
+	double VelocityZ = (Pos.z - m_LastPrefetchPos.z) / Seconds;
+	m_LastPrefetchPos = Pos;
+	double Speed = sqrt(VelocityX * VelocityX + VelocityZ * VelocityZ);
+	if ((Speed < PREFETCH_MIN_SPEED) || (Speed > PREFETCH_MAX_SPEED))
+	{
+		return;
+	}
 
-			// If the chunk already loading / loaded -> skip
-			if (
-				(std::find(m_ChunksToSend.begin(), m_ChunksToSend.end(), Coords) != m_ChunksToSend.end()) ||
-				(std::find(m_LoadedChunks.begin(), m_LoadedChunks.end(), Coords) != m_LoadedChunks.end())
-			)
+	// Walk the predicted path in chunk-sized steps, collecting the chunks that each step brings into the view distance.
+	// Each step moves the view square by at most one chunk on each axis, so it only adds the chunks along its leading edges:
+	int ViewDistance = m_CurrentViewDistance;
+	int NumSteps = CeilC(Speed * PREFETCH_LOOKAHEAD_SECONDS / cChunkDef::Width);
+	double StepX = VelocityX / Speed * cChunkDef::Width;
+	double StepZ = VelocityZ / Speed * cChunkDef::Width;
+	int LastCenterX = m_Player->GetChunkX();
+	int LastCenterZ = m_Player->GetChunkZ();
+	cChunkCoordsVector Chunks;
+	for (int Step = 1; Step <= NumSteps; Step++)
+	{
+		int CenterX = FloorC((Pos.x + StepX * Step) / cChunkDef::Width);
+		int CenterZ = FloorC((Pos.z + StepZ * Step) / cChunkDef::Width);
+		if ((CenterX == LastCenterX) && (CenterZ == LastCenterZ))
+		{
+			continue;
+		}
+		for (int z = CenterZ - ViewDistance; z <= CenterZ + ViewDistance; z++)
+		{
+			for (int x = CenterX - ViewDistance; x <= CenterX + ViewDistance; x++)
 			{
-				continue;
+				if ((Diff(x, LastCenterX) > ViewDistance) || (Diff(z, LastCenterZ) > ViewDistance))
+				{
+					Chunks.push_back(cChunkCoords(x, z));
+				}
 			}
-
-			// Unloaded chunk found -> Send it to the client.
-			Lock.Unlock();
-			StreamChunk(Coords.m_ChunkX, Coords.m_ChunkZ, cChunkSender::E_CHUNK_PRIORITY_LOW);
-			return false;
 		}
+		LastCenterX = CenterX;
+		LastCenterZ = CenterZ;
 	}
-
-	// All chunks are loaded -> Sets the last loaded chunk coordinates to current coordinates
-	m_LastStreamedChunkX = ChunkPosX;
-	m_LastStreamedChunkZ = ChunkPosZ;
-	return true;
+	m_Player->GetWorld()->PrefetchChunks(Chunks);
 }
 
 
@@ -524,6 +637,7 @@ void cClientHandle::UnloadOutOfRangeChunks(void)
 	int ChunkPosZ = FAST_FLOOR_DIV((int)m_Player->GetPosZ(), cChunkDef::Width);
 
 	cChunkCoordsList ChunksToRemove;
+	cChunkCoordsList ChunksToCancel;
 	{
 		cCSLock Lock(m_CSChunkLists);
 		for (cChunkCoordsList::iterator itr = m_LoadedChunks.begin(); itr != m_LoadedChunks.end();)
@@ -547,6 +661,7 @@ void cClientHandle::UnloadOutOfRangeChunks(void)
 			int DiffZ = Diff((*itr).m_ChunkZ, ChunkPosZ);
 			if ((DiffX > m_CurrentViewDistance) || (DiffZ > m_CurrentViewDistance))
 			{
+				ChunksToCancel.push_back(*itr);
 				itr = m_ChunksToSend.erase(itr);
 			}
 			else
@@ -556,6 +671,12 @@ void cClientHandle::UnloadOutOfRangeChunks(void)
 		}
 	}
 
+	// Drop the chunks that are still queued in the chunk sender, they would only be refused later on:
+	if (!ChunksToCancel.empty())
+	{
+		m_Player->GetWorld()->CancelSendChunksTo(ChunksToCancel, this);
+	}
+
 	for (cChunkCoordsList::iterator itr = ChunksToRemove.begin(); itr != ChunksToRemove.end(); ++itr)
 	{
 		m_Player->GetWorld()->RemoveChunkClient(itr->m_ChunkX, itr->m_ChunkZ, this);
@@ -1013,7 +1134,7 @@ void cClientHandle::HandleLeftClick(int a_BlockX, int a_BlockY, int a_BlockZ, eB
 			return;
 		}
 
-		if (cBlockInfo::GetHandler(m_Player->GetWorld()->GetBlock(BlockX, BlockY, BlockZ))->IsClickedThrough())
+		if (cBlockInfo::IsClickedThrough(m_Player->GetWorld()->GetBlock(BlockX, BlockY, BlockZ)))
 		{
 			a_BlockX = BlockX;
 			a_BlockY = BlockY;
@@ -1390,7 +1511,7 @@ void cClientHandle::HandleRightClick(int a_BlockX, int a_BlockY, int a_BlockZ, e
 		World->GetBlockTypeMeta(a_BlockX, a_BlockY, a_BlockZ, BlockType, BlockMeta);
 		cBlockHandler * BlockHandler = cBlockInfo::GetHandler(BlockType);
 
-		if (BlockHandler->IsUseable() && !m_Player->IsCrouched())
+		if (cBlockInfo::IsUseable(BlockType) && !m_Player->IsCrouched())
 		{
 			if (PlgMgr->CallHookPlayerUsingBlock(*m_Player, a_BlockX, a_BlockY, a_BlockZ, a_BlockFace, a_CursorX, a_CursorY, a_CursorZ, BlockType, BlockMeta))
 			{
@@ -1821,6 +1942,10 @@ void cClientHandle::SendData(const char * a_Data, size_t a_Size)
 	}
 
 	cCSLock Lock(m_CSOutgoingData);
+	if (m_OutgoingData.empty())
+	{
+		m_OutgoingDataTime = std::chrono::steady_clock::now();
+	}
 	m_OutgoingData.append(a_Data, a_Size);
 }
 
@@ -1828,6 +1953,85 @@ void cClientHandle::SendData(const char * a_Data, size_t a_Size)
 
 
 
+size_t cClientHandle::GetOutgoingDataSize(void)
+{
+	cCSLock Lock(m_CSOutgoingData);
+	return m_OutgoingData.size();
+}
+
+
+
+
+
+bool cClientHandle::IsTrackingEntity(const cEntity & a_Entity)
+{
+	if (&a_Entity == m_Player)
+	{
+		return true;
+	}
+	cCSLock Lock(m_CSTrackedEntities);
+	return (m_TrackedEntities.find(a_Entity.GetUniqueID()) != m_TrackedEntities.end());
+}
+
+
+
+
+
+void cClientHandle::SetTrackingEntity(const cEntity & a_Entity, bool a_IsTracking)
+{
+	cCSLock Lock(m_CSTrackedEntities);
+	if (a_IsTracking)
+	{
+		m_TrackedEntities.insert(a_Entity.GetUniqueID());
+	}
+	else
+	{
+		m_TrackedEntities.erase(a_Entity.GetUniqueID());
+	}
+}
+
+
+
+
+
+void cClientHandle::ClearTrackedEntities(void)
+{
+	cCSLock Lock(m_CSTrackedEntities);
+	m_TrackedEntities.clear();
+}
+
+
+
+
+
+void cClientHandle::StartCapture(AString & a_Data)
+{
+	m_Protocol->StartCapture(a_Data);
+}
+
+
+
+
+
+void cClientHandle::StopCapture(void)
+{
+	m_Protocol->StopCapture();
+}
+
+
+
+
+
+void cClientHandle::SendCapturedData(const char * a_Data, size_t a_Size)
+{
+	m_NetworkStats->BroadcastDataSent(a_Size);
+	m_Protocol->SendCapturedData(a_Data, a_Size);
+}
+
+
+
+
+
 void cClientHandle::RemoveFromWorld(void)
 {
 	// Remove all associated chunks:
@@ -1870,9 +2074,14 @@ bool cClientHandle::CheckBlockInteractionsRate(void)
 
 
 
-void cClientHandle::Tick(float a_Dt)
+void cClientHandle::ProcessReceivedData(void)
 {
-	// Process received network data:
+	if (m_DecodeOnNetworkThread)
+	{
+		m_Protocol->HandleDecodedPackets();
+		return;
+	}
+
 	AString IncomingData;
 	{
 		cCSLock Lock(m_CSIncomingData);
@@ -1883,20 +2092,69 @@ void cClientHandle::Tick(float a_Dt)
 		m_Protocol->DataReceived(IncomingData.data(), IncomingData.size());
 	}
 
-	// Send any queued outgoing data:
+	// Once the version is known, talk to the recognized protocol directly:
+	if (m_Protocol == m_ProtocolRecognizer)
+	{
+		cProtocol * Recognized = m_ProtocolRecognizer->GetRecognizedProtocol();
+		if (Recognized != nullptr)
+		{
+			m_Protocol = Recognized;
+		}
+	}
+
+	// If the protocol allows, switch to splitting the packets in the network thread:
+	if (m_Protocol->CanDecodeOnNetworkThread())
+	{
+		cCSLock Lock(m_CSIncomingData);
+		if (m_IncomingData.empty())
+		{
+			// No raw data is waiting, so the protocol sees the incoming data in the right order
+			m_DecodeOnNetworkThread = true;
+		}
+	}
+}
+
+
+
+
+
+void cClientHandle::SendOutgoingData(void)
+{
 	AString OutgoingData;
+	std::chrono::steady_clock::time_point OutgoingDataTime;
+	cTCPLinkPtr Link;
 	{
 		cCSLock Lock(m_CSOutgoingData);
 		std::swap(OutgoingData, m_OutgoingData);
+		OutgoingDataTime = m_OutgoingDataTime;
+		Link = m_Link;  // Grab a copy of the link in a multithread-safe way
 	}
-	if (!OutgoingData.empty())
+	if (OutgoingData.empty() || (Link == nullptr))
 	{
-		cTCPLinkPtr Link(m_Link);  // Grab a copy of the link in a multithread-safe way
-		if ((Link != nullptr))
-		{
-			Link->Send(OutgoingData.data(), OutgoingData.size());
-		}
+		return;
 	}
+
+	// The callback keeps the stats alive, the link may write the data out after this object is gone:
+	size_t NumBytes = OutgoingData.size();
+	cClientNetworkStatsPtr Stats(m_NetworkStats);
+	Stats->DataQueued(NumBytes);
+	if (!Link->SendOwned(std::move(OutgoingData), [Stats, NumBytes, OutgoingDataTime]() { Stats->DataWritten(NumBytes, OutgoingDataTime); }))
+	{
+		Stats->DataDropped(NumBytes);
+	}
+}
+
+
+
+
+
+void cClientHandle::Tick(float a_Dt)
+{
+	// Process received network data:
+	ProcessReceivedData();
+
+	// Send any queued outgoing data:
+	SendOutgoingData();
 	
 	m_TicksSinceLastPacket += 1;
 	if (m_TicksSinceLastPacket > 600)  // 30 seconds time-out
@@ -1930,8 +2188,13 @@ void cClientHandle::Tick(float a_Dt)
 
 	if ((m_State >= csAuthenticated) && (m_State < csDestroying))
 	{
-		// Stream 4 chunks per tick
-		for (int i = 0; i < 4; i++)
+		// Stream the chunks, ramping up the rate after joining:
+		int NumChunksToStream = std::min(MAX_CHUNKS_STREAMED_PER_TICK, 1 + m_TicksSinceJoin / CHUNK_STREAM_RAMP_TICKS);
+		if (m_TicksSinceJoin < MAX_CHUNKS_STREAMED_PER_TICK * CHUNK_STREAM_RAMP_TICKS)
+		{
+			m_TicksSinceJoin += 1;
+		}
+		for (int i = 0; i < NumChunksToStream; i++)
 		{
 			// Stream the next chunk
 			if (StreamNextChunk())
@@ -1946,6 +2209,11 @@ void cClientHandle::Tick(float a_Dt)
 		{
 			UnloadOutOfRangeChunks();
 		}
+
+		if ((m_Player->GetWorld()->GetWorldAge() % PREFETCH_INTERVAL_TICKS) == 0)
+		{
+			PrefetchChunksAhead();
+		}
 	}
 
 	// Handle block break animation:
@@ -1975,26 +2243,10 @@ void cClientHandle::Tick(float a_Dt)
 void cClientHandle::ServerTick(float a_Dt)
 {
 	// Process received network data:
-	AString IncomingData;
-	{
-		cCSLock Lock(m_CSIncomingData);
-		std::swap(IncomingData, m_IncomingData);
-	}
-	if (!IncomingData.empty())
-	{
-		m_Protocol->DataReceived(IncomingData.data(), IncomingData.size());
-	}
+	ProcessReceivedData();
 	
 	// Send any queued outgoing data:
-	AString OutgoingData;
-	{
-		cCSLock Lock(m_CSOutgoingData);
-		std::swap(OutgoingData, m_OutgoingData);
-	}
-	if ((m_Link != nullptr) && !OutgoingData.empty())
-	{
-		m_Link->Send(OutgoingData.data(), OutgoingData.size());
-	}
+	SendOutgoingData();
 	
 	if (m_State == csAuthenticated)
 	{
@@ -2244,9 +2496,9 @@ void cClientHandle::SendEntityLook(const cEntity & a_Entity)
 
 
 
-void cClientHandle::SendEntityMetadata(const cEntity & a_Entity)
+void cClientHandle::SendEntityMetadata(const cEntity & a_Entity, int a_Fields)
 {
-	m_Protocol->SendEntityMetadata(a_Entity);
+	m_Protocol->SendEntityMetadata(a_Entity, a_Fields);
 }
 
 
@@ -2798,12 +3050,25 @@ void cClientHandle::SetViewDistance(int a_ViewDistance)
 {
 	m_RequestedViewDistance = a_ViewDistance;
 	LOGD("%s is requesting ViewDistance of %d!", GetUsername().c_str(), m_RequestedViewDistance);
+	UpdateViewDistance();
+}
+
+
+
+
+
+void cClientHandle::UpdateViewDistance(void)
+{
+	if (m_Player == nullptr)
+	{
+		return;
+	}
 
-	// Set the current view distance based on the requested VD and world max VD:
+	// Set the current view distance based on the requested VD and the world's limit for the player:
 	cWorld * world = m_Player->GetWorld();
 	if (world != nullptr)
 	{
-		m_CurrentViewDistance = Clamp(a_ViewDistance, cClientHandle::MIN_VIEW_DISTANCE, world->GetMaxViewDistance());
+		m_CurrentViewDistance = Clamp(m_RequestedViewDistance, cClientHandle::MIN_VIEW_DISTANCE, world->GetPlayerMaxViewDistance(*m_Player));
 	}
 }
 
@@ -2932,8 +3197,22 @@ void cClientHandle::OnReceivedData(const char * a_Data, size_t a_Length)
 	// Reset the timeout:
 	m_TicksSinceLastPacket = 0;
 
+	// Once the protocol has been switched over, decode the data right here, the tick thread only handles the packets:
+	if (m_DecodeOnNetworkThread)
+	{
+		m_Protocol->DecodeReceivedData(a_Data, a_Length);
+		return;
+	}
+
 	// Queue the incoming data to be processed in the tick thread:
 	cCSLock Lock(m_CSIncomingData);
+	if (m_DecodeOnNetworkThread)
+	{
+		// The tick thread has switched the protocol over while we were waiting for the lock
+		Lock.Unlock();
+		m_Protocol->DecodeReceivedData(a_Data, a_Length);
+		return;
+	}
 	m_IncomingData.append(a_Data, a_Length);
 }
 
@@ -2943,6 +3222,11 @@ void cClientHandle::OnReceivedData(const char * a_Data, size_t a_Length)
 
 void cClientHandle::OnRemoteClosed(void)
 {
+	cTickRecorder & Recorder = cRoot::Get()->GetTickRecorder();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordDisconnect(m_UniqueID);
+	}
 	{
 		cCSLock Lock(m_CSOutgoingData);
 		m_Link.reset();
@@ -2959,6 +3243,11 @@ void cClientHandle::OnError(int a_ErrorCode, const AString & a_ErrorMsg)
 	LOGD("An error has occurred on client link for %s @ %s: %d (%s). Client disconnected.",
 		m_Username.c_str(), m_IPString.c_str(), a_ErrorCode, a_ErrorMsg.c_str()
 	);
+	cTickRecorder & Recorder = cRoot::Get()->GetTickRecorder();
+	if (Recorder.IsRecording())
+	{
+		Recorder.RecordDisconnect(m_UniqueID);
+	}
 	{
 		cCSLock Lock(m_CSOutgoingData);
 		m_Link.reset();
@@ -20,9 +20,11 @@
 #include "UI/SlotArea.h"
 #include "json/json.h"
 #include "ChunkSender.h"
+#include "ClientNetworkStats.h"
 
 
 #include <array>
+#include <unordered_set>
 
 
 
@@ -36,6 +38,7 @@ class cPainting;
 class cPickup;
 class cPlayer;
 class cProtocol;
+class cProtocolRecognizer;
 class cWindow;
 class cFallingBlock;
 class cItemHandler;
@@ -123,6 +126,11 @@ public:  // tolua_export
 
 	/** Remove all loaded chunks that are no longer in range */
 	void UnloadOutOfRangeChunks(void);
+
+	/** Estimates the player's velocity from the movement since the last call and, if they're moving fast,
+	has the storage prefetch the chunks that will come into the view distance along the predicted path.
+	Called periodically from Tick(). */
+	void PrefetchChunksAhead(void);
 	
 	// Removes the client from all chunks. Used when switching worlds or destroying the player
 	void RemoveFromAllChunks(void);
@@ -161,7 +169,7 @@ public:  // tolua_export
 	void SendEntityEquipment            (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item);
 	void SendEntityHeadLook             (const cEntity & a_Entity);
 	void SendEntityLook                 (const cEntity & a_Entity);
-	void SendEntityMetadata             (const cEntity & a_Entity);
+	void SendEntityMetadata             (const cEntity & a_Entity, int a_Fields = emfAll);  // a_Fields is an eEntityMetadataFields bitmask
 	void SendEntityProperties           (const cEntity & a_Entity);
 	void SendEntityRelMove              (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ);
 	void SendEntityRelMoveLook          (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ);
@@ -225,9 +233,17 @@ public:  // tolua_export
 	/** Sets the maximal view distance. */
 	void SetViewDistance(int a_ViewDistance);
 
+	/** Re-applies the requested view distance, after the world's limits for the player have changed. */
+	void UpdateViewDistance(void);
+
 	/** Returns the view distance that the player currently have. */
 	int GetViewDistance(void) const { return m_CurrentViewDistance; }
 
+	/** Returns the coords of the chunk around which the chunks were last streamed to the client.
+	Both are 0x7fffffff if the streaming hasn't started in the current world yet. */
+	int GetLastStreamedChunkX(void) const { return m_LastStreamedChunkX; }
+	int GetLastStreamedChunkZ(void) const { return m_LastStreamedChunkZ; }
+
 	/** Returns the view distance that the player request, not the used view distance. */
 	int GetRequestedViewDistance(void) const { return m_RequestedViewDistance; }
 
@@ -235,6 +251,22 @@ public:  // tolua_export
 	AString GetLocale(void) const { return m_Locale; }
 
 	int GetUniqueID(void) const { return m_UniqueID; }
+
+	/** Returns the number of bytes queued for sending to the client, not yet handed over to the network link. */
+	size_t GetOutgoingDataSize(void);
+
+	/** Returns the stats of the client's connection - the send queueing delays, bytes per packet type etc. */
+	cClientNetworkStats & GetNetworkStats(void) { return *m_NetworkStats; }
+
+	/** Returns true if the entity has been spawned on this client by the chunks' entity tracking, so that the entity's
+	packets are to be sent to this client. The client's own player is always tracked. */
+	bool IsTrackingEntity(const cEntity & a_Entity);
+
+	/** Marks the entity as spawned on (a_IsTracking == true) or destroyed on (false) this client, see IsTrackingEntity(). */
+	void SetTrackingEntity(const cEntity & a_Entity, bool a_IsTracking);
+
+	/** Forgets all the tracked entities, used when the client is removed from all its world's chunks. */
+	void ClearTrackedEntities(void);
 	
 	bool HasPluginChannel(const AString & a_PluginChannel);
 	
@@ -336,6 +368,16 @@ public:  // tolua_export
 	
 	void SendData(const char * a_Data, size_t a_Size);
 	
+	/** Starts capturing the packets sent to this client into a_Data instead of sending them, see cProtocol::StartCapture().
+	The data can then be sent to any client with the same protocol version using SendCapturedData(). */
+	void StartCapture(AString & a_Data);
+	
+	/** Stops capturing the packets started by StartCapture(). */
+	void StopCapture(void);
+	
+	/** Sends the packet data captured by StartCapture() on a client with the same protocol version. */
+	void SendCapturedData(const char * a_Data, size_t a_Size);
+	
 	/** Called when the player moves into a different world.
 	Sends an UnloadChunk packet for each loaded chunk and resets the streamed chunks. */
 	void RemoveFromWorld(void);
@@ -349,11 +391,27 @@ public:  // tolua_export
 private:
 
 	friend class cServer;  // Needs access to SetSelf()
+	friend class cTickReplayer;  // Feeds the replayed data through the cTCPLink::cCallbacks overrides
 
 
 	/** The type used for storing the names of registered plugin channels. */
 	typedef std::set<AString> cChannels;
 
+	/** A chunk scheduled for streaming, together with the priority with which to queue it in the chunk sender */
+	struct sChunkToStream
+	{
+		int m_ChunkX;
+		int m_ChunkZ;
+		cChunkSender::eChunkPriority m_Priority;
+
+		sChunkToStream(int a_ChunkX, int a_ChunkZ, cChunkSender::eChunkPriority a_Priority) :
+			m_ChunkX(a_ChunkX),
+			m_ChunkZ(a_ChunkZ),
+			m_Priority(a_Priority)
+		{
+		}
+	} ;
+
 	/** The actual view distance used, the minimum of client's requested view distance and world's max view distance. */
 	int m_CurrentViewDistance;
 
@@ -371,6 +429,13 @@ private:
 	cChunkCoordsList m_ChunksToSend;  // Chunks that need to be sent to the player (queued because they weren't generated yet or there's not enough time to send them)
 	cChunkCoordsList m_SentChunks;    // Chunks that are currently sent to the client
 
+	/** The recognizer that reads the initial handshake and creates the actual protocol. Owned by this object; it owns the
+	recognized protocol in turn. */
+	cProtocolRecognizer * m_ProtocolRecognizer;
+
+	/** The protocol that all the calls go to. Points to m_ProtocolRecognizer until the protocol version is recognized, then
+	it is switched to the recognized protocol, so that the packets don't go through the recognizer's forwarding.
+	Switched in ProcessReceivedData(), before the network thread is allowed to use the protocol. */
 	cProtocol * m_Protocol;
 
 	/** Protects m_IncomingData against multithreaded access. */
@@ -380,6 +445,10 @@ private:
 	Protected by m_CSIncomingData. */
 	AString m_IncomingData;
 
+	/** If true, the protocol splits the incoming data into packets directly in the network thread and only the packet
+	handling is left for Tick(). Set in the tick thread, under m_CSIncomingData, when the protocol allows it; never reset. */
+	std::atomic<bool> m_DecodeOnNetworkThread;
+
 	/** Protects m_OutgoingData against multithreaded access. */
 	cCriticalSection m_CSOutgoingData;
 
@@ -387,6 +456,20 @@ private:
 	Protected by m_CSOutgoingData. */
 	AString m_OutgoingData;
 
+	/** The time when the oldest packet in m_OutgoingData was queued, for the send queueing delay stats.
+	Protected by m_CSOutgoingData. */
+	std::chrono::steady_clock::time_point m_OutgoingDataTime;
+
+	/** The stats of the connection. Shared with the link's write-completion callbacks, which may come after this object is gone. */
+	cClientNetworkStatsPtr m_NetworkStats;
+
+	/** Protects m_TrackedEntities. Normally accessed only under the world's chunkmap lock, but the client may be
+	moving between two worlds. */
+	cCriticalSection m_CSTrackedEntities;
+
+	/** The unique IDs of the entities spawned on this client, see IsTrackingEntity(). */
+	std::unordered_set<UInt32> m_TrackedEntities;
+
 	Vector3d m_ConfirmPosition;
 
 	cPlayer * m_Player;
@@ -397,8 +480,26 @@ private:
 	int m_LastStreamedChunkX;
 	int m_LastStreamedChunkZ;
 
+	/** The look direction (in 45-degree sectors, -1 for looking straight up / down) and view distance
+	for which m_StreamOrder was built; a change in either rebuilds it. */
+	int m_LastStreamedDirection;
+	int m_LastStreamedViewDistance;
+
+	/** Chunks around the player, in the order in which they are to be streamed (see BuildStreamOrder()).
+	Protected by m_CSChunkLists. */
+	std::vector<sChunkToStream> m_StreamOrder;
+
+	/** Index into m_StreamOrder of the next chunk to consider for streaming. Protected by m_CSChunkLists. */
+	size_t m_NextStreamIdx;
+
+	/** The player's position at the last PrefetchChunksAhead() call, for estimating their velocity. */
+	Vector3d m_LastPrefetchPos;
+
 	/** Number of ticks since the last network packet was received (increased in Tick(), reset in OnReceivedData()) */
 	int m_TicksSinceLastPacket;
+
+	/** Number of ticks since the client has joined a world, for ramping up the chunk streaming (saturates once the ramp is done) */
+	int m_TicksSinceJoin;
 	
 	/** Duration of the last completed client ping. */
 	std::chrono::steady_clock::duration m_Ping;
@@ -484,11 +585,24 @@ private:
 	cClientHandlePtr m_Self;
 
 
+	/** Passes the data received since the last call to the protocol, or has the protocol handle the packets that
+	it has already split out in the network thread. Called from Tick() and ServerTick(). */
+	void ProcessReceivedData(void);
+
+	/** Hands the data queued in m_OutgoingData over to the link, tracking its delivery in m_NetworkStats.
+	Called from Tick() and ServerTick(). */
+	void SendOutgoingData(void);
+
 	/** Returns true if the rate block interactions is within a reasonable limit (bot protection) */
 	bool CheckBlockInteractionsRate(void);
 	
 	/** Adds a single chunk to be streamed to the client; used by StreamChunks() */
 	void StreamChunk(int a_ChunkX, int a_ChunkZ, cChunkSender::eChunkPriority a_Priority);
+
+	/** Fills m_StreamOrder with all the chunks within the view distance around the specified chunk,
+	ordered by distance, with the chunks in the horizontal look direction weighted as nearer.
+	Expects m_CSChunkLists to be locked. */
+	void BuildStreamOrder(int a_ChunkPosX, int a_ChunkPosZ, double a_LookX, double a_LookZ);
 	
 	/** Handles the DIG_STARTED dig packet: */
 	void HandleBlockDigStarted (int a_BlockX, int a_BlockY, int a_BlockZ, eBlockFace a_BlockFace, BLOCKTYPE a_OldBlock, NIBBLETYPE a_OldMeta);
@@ -0,0 +1,177 @@
+
+// ClientNetworkStats.cpp
+
+// Implements the cClientNetworkStats class representing the network latency and queueing statistics of a single client connection
+
+#include "Globals.h"
+#include "ClientNetworkStats.h"
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cClientNetworkStats::sHistogram:
+
+cClientNetworkStats::sHistogram::sHistogram(void) :
+	m_Count(0),
+	m_TotalUSec(0)
+{
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		m_BucketCounts[i] = 0;
+	}
+}
+
+
+
+
+
+Int64 cClientNetworkStats::sHistogram::GetBucketBound(int a_Bucket)
+{
+	static const Int64 Bounds[NUM_BUCKETS] = {10, 50, 100, 500, 1000, 5000, 10000, 25000, 50000, 100000, 250000, 1000000};
+	ASSERT((a_Bucket >= 0) && (a_Bucket < NUM_BUCKETS));
+	return Bounds[a_Bucket];
+}
+
+
+
+
+
+void cClientNetworkStats::sHistogram::Add(Int64 a_USec)
+{
+	m_Count += 1;
+	m_TotalUSec += static_cast<UInt64>(std::max<Int64>(a_USec, 0));
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		if (a_USec <= GetBucketBound(i))
+		{
+			m_BucketCounts[i] += 1;
+		}
+	}
+}
+
+
+
+
+
+Int64 cClientNetworkStats::sHistogram::GetQuantileBound(double a_Quantile) const
+{
+	if (m_Count == 0)
+	{
+		return 0;
+	}
+	double Wanted = a_Quantile * static_cast<double>(m_Count);
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		if (static_cast<double>(m_BucketCounts[i]) >= Wanted)
+		{
+			return GetBucketBound(i);
+		}
+	}
+	return -1;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cClientNetworkStats::sStats:
+
+cClientNetworkStats::sStats::sStats(void) :
+	m_BroadcastBytesSent(0),
+	m_LinkBacklog(0),
+	m_MaxLinkBacklog(0)
+{
+	for (UInt32 i = 0; i < NUM_PACKET_TYPES; i++)
+	{
+		m_PacketsSent[i] = 0;
+		m_BytesSent[i] = 0;
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cClientNetworkStats:
+
+void cClientNetworkStats::PacketSent(UInt32 a_PacketType, size_t a_NumBytes)
+{
+	UInt32 Idx = std::min(a_PacketType, NUM_PACKET_TYPES - 1);
+	cCSLock Lock(m_CS);
+	m_Stats.m_PacketsSent[Idx] += 1;
+	m_Stats.m_BytesSent[Idx] += a_NumBytes;
+}
+
+
+
+
+
+void cClientNetworkStats::BroadcastDataSent(size_t a_NumBytes)
+{
+	cCSLock Lock(m_CS);
+	m_Stats.m_BroadcastBytesSent += a_NumBytes;
+}
+
+
+
+
+
+void cClientNetworkStats::PacketHandled(std::chrono::steady_clock::duration a_Duration)
+{
+	Int64 USec = std::chrono::duration_cast<std::chrono::microseconds>(a_Duration).count();
+	cCSLock Lock(m_CS);
+	m_Stats.m_PacketHandleTime.Add(USec);
+}
+
+
+
+
+
+void cClientNetworkStats::DataQueued(size_t a_NumBytes)
+{
+	cCSLock Lock(m_CS);
+	m_Stats.m_LinkBacklog += a_NumBytes;
+	m_Stats.m_MaxLinkBacklog = std::max(m_Stats.m_MaxLinkBacklog, m_Stats.m_LinkBacklog);
+}
+
+
+
+
+
+void cClientNetworkStats::DataDropped(size_t a_NumBytes)
+{
+	cCSLock Lock(m_CS);
+	ASSERT(m_Stats.m_LinkBacklog >= a_NumBytes);
+	m_Stats.m_LinkBacklog -= std::min(a_NumBytes, m_Stats.m_LinkBacklog);
+}
+
+
+
+
+
+void cClientNetworkStats::DataWritten(size_t a_NumBytes, std::chrono::steady_clock::time_point a_OldestPacketTime)
+{
+	Int64 USec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - a_OldestPacketTime).count();
+	cCSLock Lock(m_CS);
+	ASSERT(m_Stats.m_LinkBacklog >= a_NumBytes);
+	m_Stats.m_LinkBacklog -= std::min(a_NumBytes, m_Stats.m_LinkBacklog);
+	m_Stats.m_SendQueueDelay.Add(USec);
+}
+
+
+
+
+
+void cClientNetworkStats::GetStats(sStats & a_Stats)
+{
+	cCSLock Lock(m_CS);
+	a_Stats = m_Stats;
+}
+
+
+
+
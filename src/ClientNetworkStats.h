@@ -0,0 +1,109 @@
+
+// ClientNetworkStats.h
+
+// Declares the cClientNetworkStats class representing the network latency and queueing statistics of a single client connection
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** Collects the statistics of a single client's connection: how long the outgoing packets wait before being written
+into the OS's TCP stack, how many bytes are sent in each packet type, how long the incoming packets take to handle
+and how much data is waiting in the link's send buffer. Used by the webadmin's metrics and the "netstat" console command
+to tell the server-side stalls apart from the player connection problems.
+Shared by the client handle and the link's write-completion callbacks, which may outlive the client handle.
+Thread-safe, all the members are protected by a single lock. */
+class cClientNetworkStats
+{
+public:
+	/** A histogram of durations, in microseconds; the buckets are cumulative, same as in the Prometheus format. */
+	struct sHistogram
+	{
+		static const int NUM_BUCKETS = 12;
+
+		/** Returns the upper bound of the specified bucket, in microseconds. */
+		static Int64 GetBucketBound(int a_Bucket);
+
+		/** The number of samples that took at most GetBucketBound(i) usec, for each bucket i; larger buckets include the smaller ones. */
+		UInt64 m_BucketCounts[NUM_BUCKETS];
+
+		/** The total number of samples and their total duration. */
+		UInt64 m_Count;
+		UInt64 m_TotalUSec;
+
+		sHistogram(void);
+
+		/** Adds a single sample of the specified duration. */
+		void Add(Int64 a_USec);
+
+		/** Returns the upper bound of the bucket that contains the specified quantile (0 .. 1) of the samples, in usec.
+		Returns 0 if there are no samples, -1 if the quantile lies above the largest bucket. */
+		Int64 GetQuantileBound(double a_Quantile) const;
+	} ;
+
+	/** Number of the outgoing packet types counted individually; the higher types are all counted in the last one. */
+	static const UInt32 NUM_PACKET_TYPES = 128;
+
+	/** All the collected stats, as returned by GetStats(). */
+	struct sStats
+	{
+		/** Time from the outgoing packet's creation to its data being written into the OS's TCP stack. */
+		sHistogram m_SendQueueDelay;
+
+		/** Time taken to parse and handle a single incoming packet. */
+		sHistogram m_PacketHandleTime;
+
+		/** The number of packets, and their bytes including the framing, sent in each packet type. */
+		UInt64 m_PacketsSent[NUM_PACKET_TYPES];
+		UInt64 m_BytesSent[NUM_PACKET_TYPES];
+
+		/** The bytes of the broadcast packets, serialized once and sent to multiple clients, which aren't split by the packet type. */
+		UInt64 m_BroadcastBytesSent;
+
+		/** The number of bytes given to the link and not written into the OS's TCP stack yet, and the maximum of it seen. */
+		size_t m_LinkBacklog;
+		size_t m_MaxLinkBacklog;
+
+		sStats(void);
+	} ;
+
+
+	/** Adds a packet of the specified type and size (including the framing) sent to the client. */
+	void PacketSent(UInt32 a_PacketType, size_t a_NumBytes);
+
+	/** Adds the broadcast packet data sent to the client. */
+	void BroadcastDataSent(size_t a_NumBytes);
+
+	/** Adds the time taken to handle a single incoming packet. */
+	void PacketHandled(std::chrono::steady_clock::duration a_Duration);
+
+	/** Adds the data given to the link for sending. */
+	void DataQueued(size_t a_NumBytes);
+
+	/** Removes the data given to the link that the link has refused. */
+	void DataDropped(size_t a_NumBytes);
+
+	/** Adds the data written by the link into the OS's TCP stack; a_OldestPacketTime is the creation time
+	of the oldest packet in the data. */
+	void DataWritten(size_t a_NumBytes, std::chrono::steady_clock::time_point a_OldestPacketTime);
+
+	/** Returns a copy of all the collected stats. */
+	void GetStats(sStats & a_Stats);
+
+protected:
+	cCriticalSection m_CS;
+
+	sStats m_Stats;
+} ;
+
+typedef SharedPtr<cClientNetworkStats> cClientNetworkStatsPtr;
+
+
+
+
@@ -7,6 +7,7 @@
 #include "CraftingRecipes.h"
 #include "Root.h"
 #include "Bindings/PluginManager.h"
+#include "Entities/Player.h"
 
 
 
@@ -289,19 +290,19 @@ void cCraftingRecipes::GetRecipe(cPlayer & a_Player, cCraftingGrid & a_CraftingG
 	}
 	
 	// Built-in recipes:
-	std::unique_ptr<cRecipe> Recipe(FindRecipe(a_CraftingGrid.GetItems(), a_CraftingGrid.GetWidth(), a_CraftingGrid.GetHeight()));
+	cRecipe Recipe;
 	a_Recipe.Clear();
-	if (Recipe.get() == nullptr)
+	if (!FindRecipe(a_Player.GetUniqueID(), a_CraftingGrid.GetItems(), a_CraftingGrid.GetWidth(), a_CraftingGrid.GetHeight(), Recipe))
 	{
 		// Allow plugins to intercept a no-recipe-found situation:
 		cRoot::Get()->GetPluginManager()->CallHookCraftingNoRecipe(a_Player, a_CraftingGrid, a_Recipe);
 		return;
 	}
-	for (cRecipeSlots::const_iterator itr = Recipe->m_Ingredients.begin(); itr != Recipe->m_Ingredients.end(); ++itr)
+	for (cRecipeSlots::const_iterator itr = Recipe.m_Ingredients.begin(); itr != Recipe.m_Ingredients.end(); ++itr)
 	{
 		a_Recipe.SetIngredient(itr->x, itr->y, itr->m_Item);
 	}  // for itr
-	a_Recipe.SetResult(Recipe->m_Result);
+	a_Recipe.SetResult(Recipe.m_Result);
 	
 	// Allow plugins to intercept recipes after they are processed:
 	cRoot::Get()->GetPluginManager()->CallHookPostCrafting(a_Player, a_CraftingGrid, a_Recipe);
@@ -358,6 +359,10 @@ void cCraftingRecipes::ClearRecipes(void)
 		delete *itr;
 	}
 	m_Recipes.clear();
+	m_RecipeIndex.clear();
+	
+	cCSLock Lock(m_CSLastMatches);
+	m_LastMatches.clear();
 }
 
 
@@ -423,6 +428,7 @@ void cCraftingRecipes::AddRecipeLine(int a_LineNum, const AString & a_RecipeLine
 	
 	NormalizeIngredients(Recipe.get());
 	
+	m_RecipeIndex[CalcRecipeSignature(*Recipe)].push_back(m_Recipes.size());
 	m_Recipes.push_back(Recipe.release());
 }
 
@@ -580,7 +586,64 @@ void cCraftingRecipes::NormalizeIngredients(cCraftingRecipes::cRecipe * a_Recipe
 
 
 
-cCraftingRecipes::cRecipe * cCraftingRecipes::FindRecipe(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight)
+bool cCraftingRecipes::sGridKey::operator == (const sGridKey & a_Other) const
+{
+	if ((m_Width != a_Other.m_Width) || (m_Height != a_Other.m_Height))
+	{
+		return false;
+	}
+	int NumCells = m_Width * m_Height;
+	for (int i = 0; i < NumCells; i++)
+	{
+		if ((m_ItemTypes[i] != a_Other.m_ItemTypes[i]) || (m_ItemDamages[i] != a_Other.m_ItemDamages[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+UInt64 cCraftingRecipes::CalcSignature(short * a_ItemTypes, size_t a_NumItemTypes)
+{
+	std::sort(a_ItemTypes, a_ItemTypes + a_NumItemTypes);
+	
+	// FNV-1a over the distinct non-empty types:
+	UInt64 Signature = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < a_NumItemTypes; i++)
+	{
+		if ((a_ItemTypes[i] <= 0) || ((i > 0) && (a_ItemTypes[i] == a_ItemTypes[i - 1])))
+		{
+			continue;
+		}
+		Signature = (Signature ^ static_cast<UInt16>(a_ItemTypes[i])) * 0x100000001b3ULL;
+	}
+	return Signature;
+}
+
+
+
+
+
+UInt64 cCraftingRecipes::CalcRecipeSignature(const cRecipe & a_Recipe)
+{
+	std::vector<short> ItemTypes;
+	ItemTypes.reserve(a_Recipe.m_Ingredients.size());
+	for (cRecipeSlots::const_iterator itr = a_Recipe.m_Ingredients.begin(); itr != a_Recipe.m_Ingredients.end(); ++itr)
+	{
+		ItemTypes.push_back(itr->m_Item.m_ItemType);
+	}
+	return CalcSignature(ItemTypes.data(), ItemTypes.size());
+}
+
+
+
+
+
+bool cCraftingRecipes::FindRecipe(UInt32 a_PlayerID, const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, cRecipe & a_Recipe)
 {
 	ASSERT(a_GridWidth <= MAX_GRID_WIDTH);
 	ASSERT(a_GridHeight <= MAX_GRID_HEIGHT);
@@ -600,32 +663,100 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::FindRecipe(const cItem * a_Craftin
 	}
 	int GridWidth = GridRight - GridLeft + 1;
 	int GridHeight = GridBottom - GridTop + 1;
+	if ((GridWidth <= 0) || (GridHeight <= 0))
+	{
+		// Empty grid
+		return false;
+	}
 	
 	// Search in the possibly minimized grid, but keep the stride:
 	const cItem * Grid = a_CraftingGrid + GridLeft + (a_GridWidth * GridTop);
-	cRecipe * Recipe = FindRecipeCropped(Grid, GridWidth, GridHeight, a_GridWidth);
-	if (Recipe == nullptr)
+	
+	// If the player's grid hasn't changed since the last lookup, the same recipe matches again:
+	sLastMatch Match;
+	Match.m_Grid.m_Width = GridWidth;
+	Match.m_Grid.m_Height = GridHeight;
+	for (int y = 0; y < GridHeight; y++) for (int x = 0; x < GridWidth; x++)
+	{
+		const cItem & Item = Grid[x + y * a_GridWidth];
+		bool IsEmpty = Item.IsEmpty();
+		Match.m_Grid.m_ItemTypes[x + y * GridWidth] = IsEmpty ? static_cast<short>(E_ITEM_EMPTY) : Item.m_ItemType;
+		Match.m_Grid.m_ItemDamages[x + y * GridWidth] = IsEmpty ? 0 : Item.m_ItemDamage;
+	}
+	bool HasCachedMatch = false;
 	{
-		return nullptr;
+		cCSLock Lock(m_CSLastMatches);
+		auto itr = m_LastMatches.find(a_PlayerID);
+		if ((itr != m_LastMatches.end()) && (itr->second.m_Grid == Match.m_Grid))
+		{
+			Match = itr->second;
+			HasCachedMatch = true;
+		}
+	}
+	
+	bool HasMatched;
+	if (HasCachedMatch)
+	{
+		// The match is still run, so that the result gets the data of this grid's items (fireworks):
+		HasMatched = (
+			(Match.m_RecipeIdx != NO_RECIPE) &&
+			MatchRecipe(Grid, GridWidth, GridHeight, a_GridWidth, *m_Recipes[Match.m_RecipeIdx], Match.m_OffsetX, Match.m_OffsetY, a_Recipe)
+		);
+		ASSERT(HasMatched == (Match.m_RecipeIdx != NO_RECIPE));
+	}
+	else
+	{
+		HasMatched = FindRecipeCropped(Grid, GridWidth, GridHeight, a_GridWidth, a_Recipe, Match.m_RecipeIdx, Match.m_OffsetX, Match.m_OffsetY);
+		if (!HasMatched)
+		{
+			Match.m_RecipeIdx = NO_RECIPE;
+		}
+		cCSLock Lock(m_CSLastMatches);
+		if (m_LastMatches.size() >= MAX_LAST_MATCHES)
+		{
+			m_LastMatches.clear();
+		}
+		m_LastMatches[a_PlayerID] = Match;
+	}
+	if (!HasMatched)
+	{
+		return false;
 	}
 	
 	// A recipe has been found, move it to correspond to the original crafting grid:
-	for (cRecipeSlots::iterator itrS = Recipe->m_Ingredients.begin(); itrS != Recipe->m_Ingredients.end(); ++itrS)
+	for (cRecipeSlots::iterator itrS = a_Recipe.m_Ingredients.begin(); itrS != a_Recipe.m_Ingredients.end(); ++itrS)
 	{
 		itrS->x += GridLeft;
 		itrS->y += GridTop;
-	}  // for itrS - Recipe->m_Ingredients[]
+	}  // for itrS - a_Recipe.m_Ingredients[]
 	
-	return Recipe;
+	return true;
 }
 
 
 
 
 
-cCraftingRecipes::cRecipe * cCraftingRecipes::FindRecipeCropped(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride)
+bool cCraftingRecipes::FindRecipeCropped(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride, cRecipe & a_Recipe, size_t & a_RecipeIdx, int & a_OffsetX, int & a_OffsetY)
 {
-	for (cRecipes::const_iterator itr = m_Recipes.begin(); itr != m_Recipes.end(); ++itr)
+	// Only the recipes with the same ingredient signature as the grid can match:
+	short ItemTypes[MAX_GRID_WIDTH * MAX_GRID_HEIGHT];
+	size_t NumItemTypes = 0;
+	for (int y = 0; y < a_GridHeight; y++) for (int x = 0; x < a_GridWidth; x++)
+	{
+		const cItem & Item = a_CraftingGrid[x + y * a_GridStride];
+		if (!Item.IsEmpty())
+		{
+			ItemTypes[NumItemTypes++] = Item.m_ItemType;
+		}
+	}
+	auto Candidates = m_RecipeIndex.find(CalcSignature(ItemTypes, NumItemTypes));
+	if (Candidates == m_RecipeIndex.end())
+	{
+		return false;
+	}
+	
+	for (auto itr = Candidates->second.begin(), end = Candidates->second.end(); itr != end; ++itr)
 	{
 		// Both the crafting grid and the recipes are normalized. The only variable possible is the "anywhere" items.
 		// This still means that the "anywhere" item may be the one that is offsetting the grid contents to the right or downwards, so we need to check all possible positions.
@@ -633,32 +764,35 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::FindRecipeCropped(const cItem * a_
 		// Calculate the maximum offsets for this recipe relative to the grid size, and iterate through all combinations of offsets.
 		// Also, this calculation automatically filters out recipes that are too large for the current grid - the loop won't be entered at all.
 		
-		int MaxOfsX = a_GridWidth  - (*itr)->m_Width;
-		int MaxOfsY = a_GridHeight - (*itr)->m_Height;
+		const cRecipe & Recipe = *m_Recipes[*itr];
+		int MaxOfsX = a_GridWidth  - Recipe.m_Width;
+		int MaxOfsY = a_GridHeight - Recipe.m_Height;
 		for (int x = 0; x <= MaxOfsX; x++) for (int y = 0; y <= MaxOfsY; y++)
 		{
-			cRecipe * Recipe = MatchRecipe(a_CraftingGrid, a_GridWidth, a_GridHeight, a_GridStride, *itr, x, y);
-			if (Recipe != nullptr)
+			if (MatchRecipe(a_CraftingGrid, a_GridWidth, a_GridHeight, a_GridStride, Recipe, x, y, a_Recipe))
 			{
-				return Recipe;
+				a_RecipeIdx = *itr;
+				a_OffsetX = x;
+				a_OffsetY = y;
+				return true;
 			}
 		}  // for y, for x
-	}  // for itr - m_Recipes[]
+	}  // for itr - Candidates[]
 	
 	// No matching recipe found
-	return nullptr;
+	return false;
 }
 
 
 
 
 
-cCraftingRecipes::cRecipe * cCraftingRecipes::MatchRecipe(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride, const cRecipe * a_Recipe, int a_OffsetX, int a_OffsetY)
+bool cCraftingRecipes::MatchRecipe(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride, const cRecipe & a_Recipe, int a_OffsetX, int a_OffsetY, cRecipe & a_MatchedRecipe)
 {
 	// Check the regular items first:
 	bool HasMatched[MAX_GRID_WIDTH][MAX_GRID_HEIGHT];
 	memset(HasMatched, 0, sizeof(HasMatched));
-	for (cRecipeSlots::const_iterator itrS = a_Recipe->m_Ingredients.begin(); itrS != a_Recipe->m_Ingredients.end(); ++itrS)
+	for (cRecipeSlots::const_iterator itrS = a_Recipe.m_Ingredients.begin(); itrS != a_Recipe.m_Ingredients.end(); ++itrS)
 	{
 		if ((itrS->x < 0) || (itrS->y < 0))
 		{
@@ -682,7 +816,7 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::MatchRecipe(const cItem * a_Crafti
 		)
 		{
 			// Doesn't match
-			return nullptr;
+			return false;
 		}
 		HasMatched[itrS->x + a_OffsetX][itrS->y + a_OffsetY] = true;
 	}  // for itrS - Recipe->m_Ingredients[]
@@ -691,7 +825,7 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::MatchRecipe(const cItem * a_Crafti
 	// The "anywhere" items are processed on a first-come-first-served basis.
 	// Do not use a recipe with one horizontal and one vertical "anywhere" ("*:1, 1:*") as it may not match properly!
 	cRecipeSlots MatchedSlots;  // Stores the slots of "anywhere" items that have matched, with the match coords
-	for (cRecipeSlots::const_iterator itrS = a_Recipe->m_Ingredients.begin(); itrS != a_Recipe->m_Ingredients.end(); ++itrS)
+	for (cRecipeSlots::const_iterator itrS = a_Recipe.m_Ingredients.begin(); itrS != a_Recipe.m_Ingredients.end(); ++itrS)
 	{
 		if ((itrS->x >= 0) && (itrS->y >= 0))
 		{
@@ -722,6 +856,7 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::MatchRecipe(const cItem * a_Crafti
 				}
 				int GridIdx = x + a_GridStride * y;
 				if (
+					!a_CraftingGrid[GridIdx].IsEmpty() &&
 					(a_CraftingGrid[GridIdx].m_ItemType == itrS->m_Item.m_ItemType) &&
 					(
 						(itrS->m_Item.m_ItemDamage < 0) ||  // doesn't want damage comparison
@@ -744,9 +879,9 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::MatchRecipe(const cItem * a_Crafti
 		}  // for x
 		if (!Found)
 		{
-			return nullptr;
+			return false;
 		}
-	}  // for itrS - a_Recipe->m_Ingredients[]
+	}  // for itrS - a_Recipe.m_Ingredients[]
 	
 	// Check if the whole grid has matched:
 	for (int x = 0; x < a_GridWidth; x++) for (int y = 0; y < a_GridHeight; y++)
@@ -754,30 +889,30 @@ cCraftingRecipes::cRecipe * cCraftingRecipes::MatchRecipe(const cItem * a_Crafti
 		if (!HasMatched[x][y] && !a_CraftingGrid[x + a_GridStride * y].IsEmpty())
 		{
 			// There's an unmatched item in the grid
-			return nullptr;
+			return false;
 		}
 	}  // for y, for x
 	
-	// The recipe has matched. Create a copy of the recipe and set its coords to match the crafting grid:
-	std::unique_ptr<cRecipe> Recipe(new cRecipe);
-	Recipe->m_Result = a_Recipe->m_Result;
-	Recipe->m_Width  = a_Recipe->m_Width;
-	Recipe->m_Height = a_Recipe->m_Height;
-	for (cRecipeSlots::const_iterator itrS = a_Recipe->m_Ingredients.begin(); itrS != a_Recipe->m_Ingredients.end(); ++itrS)
+	// The recipe has matched. Copy the recipe and set its coords to match the crafting grid:
+	a_MatchedRecipe.m_Result = a_Recipe.m_Result;
+	a_MatchedRecipe.m_Width  = a_Recipe.m_Width;
+	a_MatchedRecipe.m_Height = a_Recipe.m_Height;
+	a_MatchedRecipe.m_Ingredients.clear();
+	for (cRecipeSlots::const_iterator itrS = a_Recipe.m_Ingredients.begin(); itrS != a_Recipe.m_Ingredients.end(); ++itrS)
 	{
 		if ((itrS->x < 0) || (itrS->y < 0))
 		{
 			// "Anywhere" item, process later
 			continue;
 		}
-		Recipe->m_Ingredients.push_back(*itrS);
+		a_MatchedRecipe.m_Ingredients.push_back(*itrS);
 	}
-	Recipe->m_Ingredients.insert(Recipe->m_Ingredients.end(), MatchedSlots.begin(), MatchedSlots.end());
+	a_MatchedRecipe.m_Ingredients.insert(a_MatchedRecipe.m_Ingredients.end(), MatchedSlots.begin(), MatchedSlots.end());
 
-	// We use Recipe instead of a_Recipe because we want the wildcard ingredients' slot numbers as well, which was just added previously
-	HandleFireworks(a_CraftingGrid, Recipe.get(), a_GridStride, a_OffsetX, a_OffsetY);
+	// We use a_MatchedRecipe instead of a_Recipe because we want the wildcard ingredients' slot numbers as well, which was just added previously
+	HandleFireworks(a_CraftingGrid, &a_MatchedRecipe, a_GridStride, a_OffsetX, a_OffsetY);
 
-	return Recipe.release();
+	return true;
 }
 
 
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <unordered_map>
 #include "Item.h"
 
 
@@ -140,8 +141,52 @@ protected:
 	} ;
 	typedef std::vector<cRecipe *> cRecipes;
 	
+	/** The contents of a cropped crafting grid that decide which recipe it matches: its size and the types and damages of its cells.
+	The empty cells are stored as E_ITEM_EMPTY with zero damage, the item counts don't matter since each ingredient needs a single item. */
+	struct sGridKey
+	{
+		int m_Width;
+		int m_Height;
+		short m_ItemTypes[MAX_GRID_WIDTH * MAX_GRID_HEIGHT];
+		short m_ItemDamages[MAX_GRID_WIDTH * MAX_GRID_HEIGHT];
+		
+		bool operator == (const sGridKey & a_Other) const;
+	} ;
+	
+	/** The result of the last lookup done for a single player. */
+	struct sLastMatch
+	{
+		sGridKey m_Grid;
+		
+		/** The index into m_Recipes of the matched recipe, or NO_RECIPE if none matched. */
+		size_t m_RecipeIdx;
+		
+		/** The offsets at which the recipe has matched the cropped grid. */
+		int m_OffsetX;
+		int m_OffsetY;
+	} ;
+	
+	/** The m_RecipeIdx value of a lookup that hasn't matched any recipe. */
+	static const size_t NO_RECIPE = static_cast<size_t>(-1);
+	
+	/** The maximum number of players kept in m_LastMatches. The cache is only an optimization, so it is simply cleared when full. */
+	static const size_t MAX_LAST_MATCHES = 1024;
+	
+	
 	cRecipes m_Recipes;
 	
+	/** The indices into m_Recipes of the recipes that can match a grid, by the ingredient signature (see CalcSignature()).
+	Each list is in the m_Recipes order, so that the recipe listed first in crafting.txt still wins. Read-only after loading. */
+	std::unordered_map<UInt64, std::vector<size_t>> m_RecipeIndex;
+	
+	/** The last lookup for each player, by the player's UniqueID. The crafting grid often doesn't change between lookups,
+	such as while shift-crafting, in which case the matching recipe is known right away. Protected by m_CSLastMatches. */
+	std::unordered_map<UInt32, sLastMatch> m_LastMatches;
+	
+	/** Protects m_LastMatches against multithreaded access, the lookups come from all the world threads. */
+	cCriticalSection m_CSLastMatches;
+	
+	
 	void LoadRecipes(void);
 	void ClearRecipes(void);
 	
@@ -157,14 +202,23 @@ protected:
 	/// Moves the recipe to top-left corner, sets its MinWidth / MinHeight
 	void NormalizeIngredients(cRecipe * a_Recipe);
 	
-	/// Finds a recipe matching the crafting grid. Returns a newly allocated recipe (with all its coords set) or nullptr if not found. Caller must delete return value!
-	cRecipe * FindRecipe(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight);
+	/** Returns the signature of a set of ingredients, given their item types. Only the distinct non-empty types count, regardless of their order.
+	A grid can only match a recipe with the same signature. Reorders a_ItemTypes. */
+	static UInt64 CalcSignature(short * a_ItemTypes, size_t a_NumItemTypes);
+	
+	/** Returns the signature of the recipe's ingredients, see CalcSignature(). */
+	static UInt64 CalcRecipeSignature(const cRecipe & a_Recipe);
+	
+	/** Finds a recipe matching the crafting grid of the specified player. Fills a_Recipe (with all its coords set) and returns true if found. */
+	bool FindRecipe(UInt32 a_PlayerID, const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, cRecipe & a_Recipe);
 	
-	/// Same as FindRecipe, but the grid is guaranteed to be of minimal dimensions needed
-	cRecipe * FindRecipeCropped(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride);
+	/** Same as FindRecipe, but the grid is guaranteed to be of minimal dimensions needed.
+	Also returns the index of the matched recipe and the offsets at which it has matched. */
+	bool FindRecipeCropped(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride, cRecipe & a_Recipe, size_t & a_RecipeIdx, int & a_OffsetX, int & a_OffsetY);
 	
-	/// Checks if the grid matches the specified recipe, offset by the specified offsets. Returns a matched cRecipe * if so, or nullptr if not matching. Caller must delete the return value!
-	cRecipe * MatchRecipe(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride, const cRecipe * a_Recipe, int a_OffsetX, int a_OffsetY);
+	/** Checks if the grid matches the specified recipe, offset by the specified offsets.
+	If so, fills a_MatchedRecipe with the recipe with all its coords set to match the grid, and returns true. */
+	bool MatchRecipe(const cItem * a_CraftingGrid, int a_GridWidth, int a_GridHeight, int a_GridStride, const cRecipe & a_Recipe, int a_OffsetX, int a_OffsetY, cRecipe & a_MatchedRecipe);
 
 	/** Searches for anything firework related, and does the data setting if appropriate */
 	void HandleFireworks(const cItem * a_CraftingGrid, cCraftingRecipes::cRecipe * a_Recipe, int a_GridStride, int a_OffsetX, int a_OffsetY);
@@ -7,6 +7,7 @@
 #include "DeadlockDetect.h"
 #include "Root.h"
 #include "World.h"
+#include "OSSupport/SamplingProfiler.h"
 #include <cstdlib>
 
 
@@ -16,13 +17,18 @@
 /** Number of milliseconds per cycle */
 const int CYCLE_MILLISECONDS = 100;
 
+/** The minimum time between two stall reports, so that a long-lasting overload doesn't flood the log. */
+static const std::chrono::seconds MIN_STALL_REPORT_INTERVAL(60);
+
 
 
 
 
 cDeadlockDetect::cDeadlockDetect(void) :
 	super("DeadlockDetect"),
-	m_IntervalSec(1000)
+	m_IntervalSec(1000),
+	m_StallReportMSec(0),
+	m_LastStallReport(std::chrono::steady_clock::now() - MIN_STALL_REPORT_INTERVAL)
 {
 }
 
@@ -30,9 +36,10 @@ cDeadlockDetect::cDeadlockDetect(void) :
 
 
 
-bool cDeadlockDetect::Start(int a_IntervalSec)
+bool cDeadlockDetect::Start(int a_IntervalSec, int a_StallReportMSec)
 {
 	m_IntervalSec = a_IntervalSec;
+	m_StallReportMSec = std::max(a_StallReportMSec, 0);
 	
 	// Read the initial world data:
 	class cFillIn :
@@ -99,6 +106,7 @@ void cDeadlockDetect::SetWorldAge(const AString & a_WorldName, Int64 a_Age)
 {
 	m_WorldAges[a_WorldName].m_Age = a_Age;
 	m_WorldAges[a_WorldName].m_NumCyclesSame = 0;
+	m_WorldAges[a_WorldName].m_IsStallReported = false;
 }
 
 
@@ -121,13 +129,64 @@ void cDeadlockDetect::CheckWorldAge(const AString & a_WorldName, Int64 a_Age)
 		WorldAge.m_NumCyclesSame += 1;
 		if (WorldAge.m_NumCyclesSame > (m_IntervalSec * 1000) / CYCLE_MILLISECONDS)
 		{
-			DeadlockDetected();
+			DeadlockDetected(a_WorldName);
+		}
+		int StallMSec = WorldAge.m_NumCyclesSame * CYCLE_MILLISECONDS;
+		if ((m_StallReportMSec > 0) && (StallMSec >= m_StallReportMSec) && !WorldAge.m_IsStallReported)
+		{
+			WorldAge.m_IsStallReported = true;
+			StallDetected(a_WorldName, StallMSec);
 		}
 	}
 	else
 	{
 		WorldAge.m_Age = a_Age;
 		WorldAge.m_NumCyclesSame = 0;
+		WorldAge.m_IsStallReported = false;
+	}
+}
+
+
+
+
+
+void cDeadlockDetect::StallDetected(const AString & a_WorldName, int a_StallMSec)
+{
+	auto Now = std::chrono::steady_clock::now();
+	if (Now - m_LastStallReport < MIN_STALL_REPORT_INTERVAL)
+	{
+		LOGWARNING("World %s: the tick has been stalled for %d msec (report skipped, another one was logged recently)", a_WorldName.c_str(), a_StallMSec);
+		return;
+	}
+	m_LastStallReport = Now;
+	LOGWARNING("World %s: the tick has been stalled for %d msec, the server threads' state follows:", a_WorldName.c_str(), a_StallMSec);
+	LogThreadsState();
+}
+
+
+
+
+
+void cDeadlockDetect::LogThreadsState(void)
+{
+	AStringVector Owners;
+	cCriticalSection::GetOwnersReport(Owners);
+	LOGWARNING("Critical sections held:%s", Owners.empty() ? " none" : "");
+	for (const auto & Line: Owners)
+	{
+		LOGWARNING("%s", Line.c_str());
+	}
+
+	AStringVector Stacks;
+	AString Error;
+	if (!cSamplingProfiler::Get().DumpStacks(Stacks, Error))
+	{
+		LOGWARNING("Cannot capture the thread stacks: %s", Error.c_str());
+		return;
+	}
+	for (const auto & Line: Stacks)
+	{
+		LOGWARNING("%s", Line.c_str());
 	}
 }
 
@@ -135,8 +194,10 @@ void cDeadlockDetect::CheckWorldAge(const AString & a_WorldName, Int64 a_Age)
 
 
 
-void cDeadlockDetect::DeadlockDetected(void)
+void cDeadlockDetect::DeadlockDetected(const AString & a_WorldName)
 {
+	LOGERROR("Deadlock detected in world %s, the server threads' state follows:", a_WorldName.c_str());
+	LogThreadsState();
 	LOGERROR("Deadlock detected, aborting the server");
 	ASSERT(!"Deadlock detected");
 	abort();
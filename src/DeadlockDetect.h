@@ -5,9 +5,12 @@
 
 /*
 This class simply monitors each world's m_WorldAge, which is expected to grow on each tick.
+If the world age doesn't grow for longer than the stall threshold (500 msec by default), the tick is stalled;
+a stall report is logged, with the stacks of all the server threads and the owners of the named critical sections,
+and the server keeps running.
 If the world age doesn't grow for several seconds, it's either because the server is super-overloaded,
-or because the world tick thread hangs in a deadlock. We presume the latter and therefore kill the server.
-Once we learn to write crashdumps programmatically, we should do so just before killing, to enable debugging.
+or because the world tick thread hangs in a deadlock. We presume the latter and therefore kill the server,
+after logging the same report.
 */
 
 
@@ -28,8 +31,10 @@ class cDeadlockDetect :
 public:
 	cDeadlockDetect(void);
 	
-	/** Starts the detection. Hides cIsThread's Start, because we need some initialization */
-	bool Start(int a_IntervalSec);
+	/** Starts the detection. Hides cIsThread's Start, because we need some initialization.
+	a_IntervalSec is the time after which a stalled world aborts the server, a_StallReportMSec is the time after which
+	a stall report is logged (0 to disable the reports). */
+	bool Start(int a_IntervalSec, int a_StallReportMSec);
 	
 protected:
 	struct sWorldAge
@@ -39,6 +44,9 @@ protected:
 		
 		/// Number of cycles for which the age has been the same
 		int m_NumCyclesSame;
+
+		/** True if the current stall has already been reported. */
+		bool m_IsStallReported;
 	} ;
 	
 	/// Maps world name -> sWorldAge
@@ -48,6 +56,12 @@ protected:
 	
 	/// Number of secods for which the ages must be the same for the detection to trigger
 	int m_IntervalSec;
+
+	/** Number of milliseconds for which the ages must be the same for a stall report, 0 if disabled. */
+	int m_StallReportMSec;
+
+	/** The time of the last stall report, so that a stall of several worlds at once isn't reported for each of them. */
+	std::chrono::steady_clock::time_point m_LastStallReport;
 	
 	
 	// cIsThread overrides:
@@ -59,8 +73,14 @@ protected:
 	/// Checks if the world's age has changed, updates the world's stats; calls DeadlockDetected() if deadlock detected
 	void CheckWorldAge(const AString & a_WorldName, Int64 a_Age);
 	
+	/** Called when the world's tick has been stalled for longer than m_StallReportMSec. Logs the stall report. */
+	void StallDetected(const AString & a_WorldName, int a_StallMSec);
+
+	/** Logs the stacks of all the server threads and the owners of the named critical sections. */
+	void LogThreadsState(void);
+
 	/// Called when a deadlock is detected. Aborts the server.
-	NORETURN void DeadlockDetected(void);
+	NORETURN void DeadlockDetected(const AString & a_WorldName);
 } ;
 
 
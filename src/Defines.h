@@ -187,6 +187,18 @@ enum eMobHeadRotation
 
 
 
+/** The groups of an entity's metadata fields, used as a bitmask so that a change to some of the fields doesn't resend all of them. */
+enum eEntityMetadataFields
+{
+	emfFlags    = 0x01,  ///< The flags common to all entities: burning, crouched, sprinting, eating / using an item, invisible
+	emfSpecific = 0x02,  ///< The fields specific to the entity type, such as the sheep's colour or the item frame's item
+	emfAll      = emfFlags | emfSpecific,
+} ;
+
+
+
+
+
 inline const char * ClickActionToString(eClickAction a_ClickAction)
 {
 	switch (a_ClickAction)
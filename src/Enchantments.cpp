@@ -111,8 +111,8 @@ AString cEnchantments::ToString(void) const
 int cEnchantments::GetLevel(int a_EnchantmentID) const
 {
 	// Return the level for the specified enchantment; 0 if not stored
-	cMap::const_iterator itr = m_Enchantments.find(a_EnchantmentID);
-	if (itr != m_Enchantments.end())
+	cMap::const_iterator itr = FindEntry(a_EnchantmentID);
+	if ((itr != m_Enchantments.end()) && (itr->first == a_EnchantmentID))
 	{
 		return itr->second;
 	}
@@ -131,16 +131,24 @@ void cEnchantments::SetLevel(int a_EnchantmentID, int a_Level)
 	if (a_Level == 0)
 	{
 		// Delete enchantment, if present:
-		cMap::iterator itr = m_Enchantments.find(a_EnchantmentID);
-		if (itr != m_Enchantments.end())
+		cMap::iterator itr = FindEntry(a_EnchantmentID);
+		if ((itr != m_Enchantments.end()) && (itr->first == a_EnchantmentID))
 		{
 			m_Enchantments.erase(itr);
 		}
 	}
 	else
 	{
-		// Add / overwrite enchantment
-		m_Enchantments[a_EnchantmentID] = a_Level;
+		// Add / overwrite enchantment, keeping the entries sorted:
+		cMap::iterator itr = FindEntry(a_EnchantmentID);
+		if ((itr != m_Enchantments.end()) && (itr->first == a_EnchantmentID))
+		{
+			itr->second = a_Level;
+		}
+		else
+		{
+			m_Enchantments.insert(itr, cEntry(a_EnchantmentID, a_Level));
+		}
 	}
 }
 
@@ -148,6 +156,28 @@ void cEnchantments::SetLevel(int a_EnchantmentID, int a_Level)
 
 
 
+cEnchantments::cMap::iterator cEnchantments::FindEntry(int a_EnchantmentID)
+{
+	return std::lower_bound(m_Enchantments.begin(), m_Enchantments.end(), cEntry(a_EnchantmentID, 0),
+		[](const cEntry & a_First, const cEntry & a_Second) { return (a_First.first < a_Second.first); }
+	);
+}
+
+
+
+
+
+cEnchantments::cMap::const_iterator cEnchantments::FindEntry(int a_EnchantmentID) const
+{
+	return std::lower_bound(m_Enchantments.begin(), m_Enchantments.end(), cEntry(a_EnchantmentID, 0),
+		[](const cEntry & a_First, const cEntry & a_Second) { return (a_First.first < a_Second.first); }
+	);
+}
+
+
+
+
+
 
 void cEnchantments::Clear(void)
 {
@@ -1040,7 +1070,7 @@ cEnchantments cEnchantments::SelectEnchantmentFromVector(const cWeightedEnchantm
 {
 	// Sum up all the enchantments' weights:
 	int AllWeights = 0;
-	for (const auto Enchantment : a_Enchantments)
+	for (const auto & Enchantment : a_Enchantments)
 	{
 		AllWeights += Enchantment.m_Weight;
 	}
@@ -1054,7 +1084,7 @@ cEnchantments cEnchantments::SelectEnchantmentFromVector(const cWeightedEnchantm
 	// Pick a random enchantment:
 	cNoise Noise(a_Seed);
 	int RandomNumber = Noise.IntNoise1DInt(AllWeights) / 7 % AllWeights;
-	for (const auto Enchantment : a_Enchantments)
+	for (const auto & Enchantment : a_Enchantments)
 	{
 		RandomNumber -= Enchantment.m_Weight;
 		if (RandomNumber <= 0)
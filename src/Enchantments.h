@@ -144,11 +144,20 @@ public:
 	friend void EnchantmentSerializer::ParseFromNBT(cEnchantments & a_Enchantments, const cParsedNBT & a_NBT, int a_EnchListTagIdx);
 
 protected:
-	/** Maps enchantment ID -> enchantment level */
-	typedef std::map<int, int> cMap;
+	/** A single enchantment, the pair of its ID and level */
+	typedef std::pair<int, int> cEntry;
+
+	/** The enchantments, sorted by their ID. Items rarely have more than a few, so a sorted vector is both smaller and
+	faster to search and compare than a map, and an empty one doesn't allocate. */
+	typedef std::vector<cEntry> cMap;
 	
-	/** Currently stored enchantments */
+	/** Currently stored enchantments, sorted by ID, no zero levels */
 	cMap m_Enchantments;
+
+
+	/** Returns the iterator to the entry of the enchantment, or to the position where it would be inserted. */
+	cMap::iterator FindEntry(int a_EnchantmentID);
+	cMap::const_iterator FindEntry(int a_EnchantmentID) const;
 } ;  // tolua_export
 
 
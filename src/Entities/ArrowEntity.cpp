@@ -174,7 +174,12 @@ void cArrowEntity::CollectedBy(cPlayer & a_Dest)
 
 void cArrowEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
-	super::Tick(a_Dt, a_Chunk);
+	// An arrow that has settled in a block doesn't move, so it sleeps - only the timers and its block are checked,
+	// until the block is removed. Burning arrows keep ticking fully so that the fire burns out:
+	if (!m_IsInGround || !m_HasTeleported || IsOnFire())
+	{
+		super::Tick(a_Dt, a_Chunk);
+	}
 	m_Timer += a_Dt;
 	
 	if (m_bIsCollected)
@@ -60,7 +60,9 @@ cEntity::cEntity(eEntityType a_EntityType, double a_X, double a_Y, double a_Z, d
 	m_Mass (0.001),  // Default 1g
 	m_Width(a_Width),
 	m_Height(a_Height),
-	m_InvulnerableTicks(0)
+	m_InvulnerableTicks(0),
+	m_IndexChunk(nullptr),
+	m_IndexCell(0)
 {
 	// Assign a proper ID:
 	cCSLock Lock(m_CSCount);
@@ -397,10 +399,10 @@ bool cEntity::DoTakeDamage(TakeDamageInfo & a_TDI)
 		}
 
 		int ThornsLevel = 0;
-		const cItem ArmorItems[] = { GetEquippedHelmet(), GetEquippedChestplate(), GetEquippedLeggings(), GetEquippedBoots() };
+		const cItem * ArmorItems[] = { &GetEquippedHelmet(), &GetEquippedChestplate(), &GetEquippedLeggings(), &GetEquippedBoots() };
 		for (size_t i = 0; i < ARRAYCOUNT(ArmorItems); i++)
 		{
-			const cItem & Item = ArmorItems[i];
+			const cItem & Item = *ArmorItems[i];
 			ThornsLevel = std::max(ThornsLevel, Item.m_Enchantments.GetLevel(cEnchantments::enchThorns));
 		}
 		
@@ -438,10 +440,10 @@ bool cEntity::DoTakeDamage(TakeDamageInfo & a_TDI)
 		double EPFProjectileProtection = 0.00;
 		double EPFFeatherFalling = 0.00;
 
-		const cItem ArmorItems[] = { GetEquippedHelmet(), GetEquippedChestplate(), GetEquippedLeggings(), GetEquippedBoots() };
+		const cItem * ArmorItems[] = { &GetEquippedHelmet(), &GetEquippedChestplate(), &GetEquippedLeggings(), &GetEquippedBoots() };
 		for (size_t i = 0; i < ARRAYCOUNT(ArmorItems); i++)
 		{
-			const cItem & Item = ArmorItems[i];
+			const cItem & Item = *ArmorItems[i];
 			int Level = Item.m_Enchantments.GetLevel(cEnchantments::enchProtection);
 			if (Level > 0)
 			{
@@ -661,6 +663,18 @@ bool cEntity::ArmorCoversAgainst(eDamageType a_DamageType)
 
 
 
+/** The empty item returned as the equipment of the entities that don't have any. */
+static const cItem g_NoEquipment;
+
+const cItem & cEntity::GetNoEquipment(void)
+{
+	return g_NoEquipment;
+}
+
+
+
+
+
 int cEntity::GetArmorCoverAgainst(const cEntity * a_Attacker, eDamageType a_DamageType, int a_Damage)
 {
 	// Returns the hitpoints out of a_RawDamage that the currently equipped armor would cover
@@ -830,7 +844,7 @@ void cEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 			HandleAir();
 		}
 		
-		if (!DetectPortal())  // Our chunk is invalid if we have moved to another world
+		if (!DetectPortal(*NextChunk))  // Our chunk is invalid if we have moved to another world
 		{
 			// None of the above functions changed position, we remain in the chunk of NextChunk
 			HandlePhysics(a_Dt, *NextChunk);
@@ -961,7 +975,7 @@ void cEntity::HandlePhysics(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 	}
 
 	// Get water direction
-	Direction WaterDir = m_World->GetWaterSimulator()->GetFlowingDirection(BlockX, BlockY, BlockZ);
+	Direction WaterDir = m_World->GetWaterSimulator()->GetFlowingDirection(*NextChunk, RelBlockX, BlockY, RelBlockZ);
 
 	m_WaterSpeed *= 0.9f;  // Reduce speed each tick
 
@@ -1261,8 +1275,23 @@ void cEntity::DetectCacti(void)
 
 
 
-bool cEntity::DetectPortal()
+bool cEntity::DetectPortal(cChunk & a_Chunk)
 {
+	// Most entities aren't in a portal, check the block through the entity's own chunk first, without any world lookups:
+	int X = POSX_TOINT, Y = POSY_TOINT, Z = POSZ_TOINT;
+	BLOCKTYPE BlockType = E_BLOCK_AIR;
+	if ((Y > 0) && (Y < cChunkDef::Height))
+	{
+		BlockType = a_Chunk.GetBlock(X - a_Chunk.GetPosX() * cChunkDef::Width, Y, Z - a_Chunk.GetPosZ() * cChunkDef::Width);
+	}
+	if ((BlockType != E_BLOCK_NETHER_PORTAL) && (BlockType != E_BLOCK_END_PORTAL))
+	{
+		// Allow portals to work again
+		m_PortalCooldownData.m_ShouldPreventTeleportation = false;
+		m_PortalCooldownData.m_TicksDelayed = 0;
+		return false;
+	}
+
 	if (GetWorld()->GetDimension() == dimOverworld)
 	{
 		if (GetWorld()->GetLinkedNetherWorldName().empty() && GetWorld()->GetLinkedEndWorldName().empty())
@@ -1277,109 +1306,105 @@ bool cEntity::DetectPortal()
 		return false;
 	}
 
-	int X = POSX_TOINT, Y = POSY_TOINT, Z = POSZ_TOINT;
-	if ((Y > 0) && (Y < cChunkDef::Height))
+	switch (BlockType)
 	{
-		switch (GetWorld()->GetBlock(X, Y, Z))
+		case E_BLOCK_NETHER_PORTAL:
 		{
-			case E_BLOCK_NETHER_PORTAL:
+			if (m_PortalCooldownData.m_ShouldPreventTeleportation)
 			{
-				if (m_PortalCooldownData.m_ShouldPreventTeleportation)
-				{
-					// Just exited a portal, don't teleport again
-					return false;
-				}
+				// Just exited a portal, don't teleport again
+				return false;
+			}
 
-				if (IsPlayer() && !((cPlayer *)this)->IsGameModeCreative() && (m_PortalCooldownData.m_TicksDelayed != 80))
+			if (IsPlayer() && !((cPlayer *)this)->IsGameModeCreative() && (m_PortalCooldownData.m_TicksDelayed != 80))
+			{
+				// Delay teleportation for four seconds if the entity is a non-creative player
+				m_PortalCooldownData.m_TicksDelayed++;
+				return false;
+			}
+			m_PortalCooldownData.m_TicksDelayed = 0;
+
+			if (GetWorld()->GetDimension() == dimNether)
+			{
+				if (GetWorld()->GetLinkedOverworldName().empty())
 				{
-					// Delay teleportation for four seconds if the entity is a non-creative player
-					m_PortalCooldownData.m_TicksDelayed++;
 					return false;
 				}
-				m_PortalCooldownData.m_TicksDelayed = 0;
 
-				if (GetWorld()->GetDimension() == dimNether)
-				{
-					if (GetWorld()->GetLinkedOverworldName().empty())
-					{
-						return false;
-					}
-
-					m_PortalCooldownData.m_ShouldPreventTeleportation = true;  // Stop portals from working on respawn
+				m_PortalCooldownData.m_ShouldPreventTeleportation = true;  // Stop portals from working on respawn
 
-					if (IsPlayer())
-					{
-						// Send a respawn packet before world is loaded / generated so the client isn't left in limbo
-						((cPlayer *)this)->GetClientHandle()->SendRespawn(dimOverworld);
-					}
-					
-					return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedOverworldName()), false);
-				}
-				else
+				if (IsPlayer())
 				{
-					if (GetWorld()->GetLinkedNetherWorldName().empty())
-					{
-						return false;
-					}
-
-					m_PortalCooldownData.m_ShouldPreventTeleportation = true;
-
-					if (IsPlayer())
-					{
-						((cPlayer *)this)->AwardAchievement(achEnterPortal);
-						((cPlayer *)this)->GetClientHandle()->SendRespawn(dimNether);
-					}
-					
-					return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedNetherWorldName(), dimNether, GetWorld()->GetName()), false);
+					// Send a respawn packet before world is loaded / generated so the client isn't left in limbo
+					((cPlayer *)this)->GetClientHandle()->SendRespawn(dimOverworld);
 				}
+				
+				return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedOverworldName()), false);
 			}
-			case E_BLOCK_END_PORTAL:
+			else
 			{
-				if (m_PortalCooldownData.m_ShouldPreventTeleportation)
+				if (GetWorld()->GetLinkedNetherWorldName().empty())
 				{
 					return false;
 				}
 
-				if (GetWorld()->GetDimension() == dimEnd)
+				m_PortalCooldownData.m_ShouldPreventTeleportation = true;
+
+				if (IsPlayer())
 				{
-					
-					if (GetWorld()->GetLinkedOverworldName().empty())
-					{
-						return false;
-					}
+					((cPlayer *)this)->AwardAchievement(achEnterPortal);
+					((cPlayer *)this)->GetClientHandle()->SendRespawn(dimNether);
+				}
+				
+				return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedNetherWorldName(), dimNether, GetWorld()->GetName()), false);
+			}
+		}
+		case E_BLOCK_END_PORTAL:
+		{
+			if (m_PortalCooldownData.m_ShouldPreventTeleportation)
+			{
+				return false;
+			}
 
-					m_PortalCooldownData.m_ShouldPreventTeleportation = true;
+			if (GetWorld()->GetDimension() == dimEnd)
+			{
+				
+				if (GetWorld()->GetLinkedOverworldName().empty())
+				{
+					return false;
+				}
 
-					if (IsPlayer())
-					{
-						cPlayer * Player = (cPlayer *)this;
-						Player->TeleportToCoords(Player->GetLastBedPos().x, Player->GetLastBedPos().y, Player->GetLastBedPos().z);
-						Player->GetClientHandle()->SendRespawn(dimOverworld);
-					}
+				m_PortalCooldownData.m_ShouldPreventTeleportation = true;
 
-					return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedOverworldName()), false);
-				}
-				else
+				if (IsPlayer())
 				{
-					if (GetWorld()->GetLinkedEndWorldName().empty())
-					{
-						return false;
-					}
+					cPlayer * Player = (cPlayer *)this;
+					Player->TeleportToCoords(Player->GetLastBedPos().x, Player->GetLastBedPos().y, Player->GetLastBedPos().z);
+					Player->GetClientHandle()->SendRespawn(dimOverworld);
+				}
 
-					m_PortalCooldownData.m_ShouldPreventTeleportation = true;
+				return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedOverworldName()), false);
+			}
+			else
+			{
+				if (GetWorld()->GetLinkedEndWorldName().empty())
+				{
+					return false;
+				}
 
-					if (IsPlayer())
-					{
-						((cPlayer *)this)->AwardAchievement(achEnterTheEnd);
-						((cPlayer *)this)->GetClientHandle()->SendRespawn(dimEnd);
-					}
+				m_PortalCooldownData.m_ShouldPreventTeleportation = true;
 
-					return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedEndWorldName(), dimEnd, GetWorld()->GetName()), false);
+				if (IsPlayer())
+				{
+					((cPlayer *)this)->AwardAchievement(achEnterTheEnd);
+					((cPlayer *)this)->GetClientHandle()->SendRespawn(dimEnd);
 				}
-				
+
+				return MoveToWorld(cRoot::Get()->CreateAndInitializeWorld(GetWorld()->GetLinkedEndWorldName(), dimEnd, GetWorld()->GetName()), false);
 			}
-			default: break;
+			
 		}
+		default: break;
 	}
 
 	// Allow portals to work again
@@ -1545,7 +1570,7 @@ void cEntity::HandleAir(void)
 void cEntity::OnStartedBurning(void)
 {
 	// Broadcast the change:
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfFlags);
 }
 
 
@@ -1556,7 +1581,7 @@ void cEntity::OnStartedBurning(void)
 void cEntity::OnFinishedBurning(void)
 {
 	// Broadcast the change:
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfFlags);
 }
 
 
@@ -1792,6 +1817,7 @@ void cEntity::SetHeadYaw(double a_HeadYaw)
 void cEntity::SetHeight(double a_Height)
 {
 	m_Height = a_Height;
+	UpdateIndexCell();
 }
 
 
@@ -1878,6 +1904,7 @@ void cEntity::SetSpeedZ(double a_SpeedZ)
 void cEntity::SetWidth(double a_Width)
 {
 	m_Width = a_Width;
+	UpdateIndexCell();
 }
 
 
@@ -1887,6 +1914,7 @@ void cEntity::SetWidth(double a_Width)
 void cEntity::AddPosX(double a_AddPosX)
 {
 	m_Pos.x += a_AddPosX;
+	UpdateIndexCell();
 }
 
 
@@ -1895,6 +1923,7 @@ void cEntity::AddPosX(double a_AddPosX)
 void cEntity::AddPosY(double a_AddPosY)
 {
 	m_Pos.y += a_AddPosY;
+	UpdateIndexCell();
 }
 
 
@@ -1903,6 +1932,7 @@ void cEntity::AddPosY(double a_AddPosY)
 void cEntity::AddPosZ(double a_AddPosZ)
 {
 	m_Pos.z += a_AddPosZ;
+	UpdateIndexCell();
 }
 
 
@@ -1913,6 +1943,7 @@ void cEntity::AddPosition(double a_AddPosX, double a_AddPosY, double a_AddPosZ)
 	m_Pos.x += a_AddPosX;
 	m_Pos.y += a_AddPosY;
 	m_Pos.z += a_AddPosZ;
+	UpdateIndexCell();
 }
 
 
@@ -2002,6 +2033,7 @@ Vector3d cEntity::GetLookVector(void) const
 void cEntity::SetPosition(double a_PosX, double a_PosY, double a_PosZ)
 {
 	m_Pos.Set(a_PosX, a_PosY, a_PosZ);
+	UpdateIndexCell();
 }
 
 
@@ -2011,6 +2043,7 @@ void cEntity::SetPosition(double a_PosX, double a_PosY, double a_PosZ)
 void cEntity::SetPosX(double a_PosX)
 {
 	m_Pos.x = a_PosX;
+	UpdateIndexCell();
 }
 
 
@@ -2020,6 +2053,7 @@ void cEntity::SetPosX(double a_PosX)
 void cEntity::SetPosY(double a_PosY)
 {
 	m_Pos.y = a_PosY;
+	UpdateIndexCell();
 }
 
 
@@ -2029,6 +2063,19 @@ void cEntity::SetPosY(double a_PosY)
 void cEntity::SetPosZ(double a_PosZ)
 {
 	m_Pos.z = a_PosZ;
+	UpdateIndexCell();
+}
+
+
+
+
+
+void cEntity::UpdateIndexCell(void)
+{
+	if (m_IndexChunk != nullptr)
+	{
+		m_IndexChunk->UpdateEntityIndex(*this);
+	}
 }
 
 
@@ -302,20 +302,23 @@ public:
 	/// Returns the knockback amount that the currently equipped items would cause to a_Receiver on a hit
 	virtual double GetKnockbackAmountAgainst(const cEntity & a_Receiver);
 	
+	/// Returns the empty item that the entities without the equipment return from the GetEquipped*() functions
+	static const cItem & GetNoEquipment(void);
+	
 	/// Returns the curently equipped weapon; empty item if none
-	virtual cItem GetEquippedWeapon(void) const { return cItem(); }
+	virtual const cItem & GetEquippedWeapon(void) const { return GetNoEquipment(); }
 	
 	/// Returns the currently equipped helmet; empty item if none
-	virtual cItem GetEquippedHelmet(void) const { return cItem(); }
+	virtual const cItem & GetEquippedHelmet(void) const { return GetNoEquipment(); }
 	
 	/// Returns the currently equipped chestplate; empty item if none
-	virtual cItem GetEquippedChestplate(void) const { return cItem(); }
+	virtual const cItem & GetEquippedChestplate(void) const { return GetNoEquipment(); }
 
 	/// Returns the currently equipped leggings; empty item if none
-	virtual cItem GetEquippedLeggings(void) const { return cItem(); }
+	virtual const cItem & GetEquippedLeggings(void) const { return GetNoEquipment(); }
 	
 	/// Returns the currently equipped boots; empty item if none
-	virtual cItem GetEquippedBoots(void) const { return cItem(); }
+	virtual const cItem & GetEquippedBoots(void) const { return GetNoEquipment(); }
 
 	/// Called when the health drops below zero. a_Killer may be nullptr (environmental damage)
 	virtual void KilledBy(TakeDamageInfo & a_TDI);
@@ -346,9 +349,10 @@ public:
 	virtual void DetectCacti(void);
 
 	/** Detects whether we are in a portal block and begins teleportation procedures if so
+	a_Chunk is the chunk that the entity is in, the portal block is read through it.
 	Returns true if MoveToWorld() was called, false if not
 	*/
-	virtual bool DetectPortal(void);
+	virtual bool DetectPortal(cChunk & a_Chunk);
 	
 	/// Handles when the entity is in the void
 	virtual void TickInVoid(cChunk & a_Chunk);
@@ -617,6 +621,18 @@ private:
 	/** If a player hit a entity, the entity receive a invulnerable of 10 ticks.
 	While this ticks, a player can't hit this entity. */
 	int m_InvulnerableTicks;
+
+	/** The chunk whose entity index lists this entity, nullptr if none. Managed by cChunk. */
+	cChunk * m_IndexChunk;
+
+	/** The cell of m_IndexChunk's entity index under which this entity is listed. Managed by cChunk. */
+	Int64 m_IndexCell;
+
+
+	/** Lets the entity index of m_IndexChunk know that the position or size has changed. */
+	void UpdateIndexCell(void);
+
+	friend class cChunk;
 } ;  // tolua_export
 
 typedef std::list<cEntity *> cEntityList;
@@ -133,6 +133,7 @@ bool cEntityEffect::IsPotionDrinkable(short a_ItemDamage)
 
 
 cEntityEffect::cEntityEffect():
+	m_Type(effNoEffect),
 	m_Ticks(0),
 	m_Duration(0),
 	m_Intensity(0),
@@ -145,7 +146,8 @@ cEntityEffect::cEntityEffect():
 
 
 
-cEntityEffect::cEntityEffect(int a_Duration, short a_Intensity, double a_DistanceModifier):
+cEntityEffect::cEntityEffect(eType a_EffectType, int a_Duration, short a_Intensity, double a_DistanceModifier):
+	m_Type(a_EffectType),
 	m_Ticks(0),
 	m_Duration(a_Duration),
 	m_Intensity(a_Intensity),
@@ -159,6 +161,7 @@ cEntityEffect::cEntityEffect(int a_Duration, short a_Intensity, double a_Distanc
 
 
 cEntityEffect::cEntityEffect(const cEntityEffect & a_OtherEffect):
+	m_Type(a_OtherEffect.m_Type),
 	m_Ticks(a_OtherEffect.m_Ticks),
 	m_Duration(a_OtherEffect.m_Duration),
 	m_Intensity(a_OtherEffect.m_Intensity),
@@ -173,6 +176,7 @@ cEntityEffect::cEntityEffect(const cEntityEffect & a_OtherEffect):
 
 cEntityEffect & cEntityEffect::operator =(cEntityEffect a_OtherEffect)
 {
+	std::swap(m_Type, a_OtherEffect.m_Type);
 	std::swap(m_Ticks, a_OtherEffect.m_Ticks);
 	std::swap(m_Duration, a_OtherEffect.m_Duration);
 	std::swap(m_Intensity, a_OtherEffect.m_Intensity);
@@ -184,71 +188,40 @@ cEntityEffect & cEntityEffect::operator =(cEntityEffect a_OtherEffect)
 
 
 
-cEntityEffect * cEntityEffect::CreateEntityEffect(cEntityEffect::eType a_EffectType, int a_Duration, short a_Intensity, double a_DistanceModifier)
+void cEntityEffect::OnTick(cPawn & a_Target)
 {
-	switch (a_EffectType)
+	switch (m_Type)
 	{
-		case cEntityEffect::effNoEffect:       return new cEntityEffect              (a_Duration, a_Intensity, a_DistanceModifier);
-		
-		case cEntityEffect::effAbsorption:     return new cEntityEffectAbsorption    (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effBlindness:      return new cEntityEffectBlindness     (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effFireResistance: return new cEntityEffectFireResistance(a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effHaste:          return new cEntityEffectHaste         (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effHealthBoost:    return new cEntityEffectHealthBoost   (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effHunger:         return new cEntityEffectHunger        (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effInstantDamage:  return new cEntityEffectInstantDamage (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effInstantHealth:  return new cEntityEffectInstantHealth (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effInvisibility:   return new cEntityEffectInvisibility  (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effJumpBoost:      return new cEntityEffectJumpBoost     (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effMiningFatigue:  return new cEntityEffectMiningFatigue (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effNausea:         return new cEntityEffectNausea        (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effNightVision:    return new cEntityEffectNightVision   (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effPoison:         return new cEntityEffectPoison        (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effRegeneration:   return new cEntityEffectRegeneration  (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effResistance:     return new cEntityEffectResistance    (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effSaturation:     return new cEntityEffectSaturation    (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effSlowness:       return new cEntityEffectSlowness      (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effSpeed:          return new cEntityEffectSpeed         (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effStrength:       return new cEntityEffectStrength      (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effWaterBreathing: return new cEntityEffectWaterBreathing(a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effWeakness:       return new cEntityEffectWeakness      (a_Duration, a_Intensity, a_DistanceModifier);
-		case cEntityEffect::effWither:         return new cEntityEffectWither        (a_Duration, a_Intensity, a_DistanceModifier);
+		case effRegeneration: TickRegeneration(a_Target); return;
+		case effHunger:       TickHunger      (a_Target); return;
+		case effPoison:       TickPoison      (a_Target); return;
+		case effWither:       TickWither      (a_Target); return;
+		case effSaturation:   TickSaturation  (a_Target); return;
+		default:
+		{
+			// The effects that only need their duration counted:
+			++m_Ticks;
+			return;
+		}
 	}
-	
-	ASSERT(!"Unhandled entity effect type!");
-	return nullptr;
-}
-
-
-
-
-
-void cEntityEffect::OnTick(cPawn & a_Target)
-{
-	// Reduce the effect's duration
-	++m_Ticks;
 }
 
 
 
 
 
-////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectSpeed:
-
-void cEntityEffectSpeed::OnActivate(cPawn & a_Target)
+void cEntityEffect::OnActivate(cPawn & a_Target)
 {
-	if (a_Target.IsMob())
-	{
-		cMonster * Mob = (cMonster*) &a_Target;
-		Mob->SetRelativeWalkSpeed(Mob->GetRelativeWalkSpeed() + 0.2 * m_Intensity);
-	}
-	else if (a_Target.IsPlayer())
+	switch (m_Type)
 	{
-		cPlayer * Player = (cPlayer*) &a_Target;
-		Player->SetNormalMaxSpeed(Player->GetNormalMaxSpeed() + 0.2 * m_Intensity);
-		Player->SetSprintingMaxSpeed(Player->GetSprintingMaxSpeed() + 0.26 * m_Intensity);
-		Player->SetFlyingMaxSpeed(Player->GetFlyingMaxSpeed() + 0.2 * m_Intensity);
+		case effSpeed:         ModifySpeed(a_Target, 0.2 * m_Intensity);   return;
+		case effSlowness:      ModifySpeed(a_Target, -0.15 * m_Intensity); return;
+		case effInstantHealth: ApplyInstantHealth(a_Target, true);         return;
+		case effInstantDamage: ApplyInstantHealth(a_Target, false);        return;
+		default:
+		{
+			return;
+		}
 	}
 }
 
@@ -256,19 +229,16 @@ void cEntityEffectSpeed::OnActivate(cPawn & a_Target)
 
 
 
-void cEntityEffectSpeed::OnDeactivate(cPawn & a_Target)
+void cEntityEffect::OnDeactivate(cPawn & a_Target)
 {
-	if (a_Target.IsMob())
+	switch (m_Type)
 	{
-		cMonster * Mob = (cMonster*) &a_Target;
-		Mob->SetRelativeWalkSpeed(Mob->GetRelativeWalkSpeed() - 0.2 * m_Intensity);
-	}
-	else if (a_Target.IsPlayer())
-	{
-		cPlayer * Player = (cPlayer*) &a_Target;
-		Player->SetNormalMaxSpeed(Player->GetNormalMaxSpeed() - 0.2 * m_Intensity);
-		Player->SetSprintingMaxSpeed(Player->GetSprintingMaxSpeed() - 0.26 * m_Intensity);
-		Player->SetFlyingMaxSpeed(Player->GetFlyingMaxSpeed() - 0.2 * m_Intensity);
+		case effSpeed:    ModifySpeed(a_Target, -0.2 * m_Intensity); return;
+		case effSlowness: ModifySpeed(a_Target, 0.15 * m_Intensity); return;
+		default:
+		{
+			return;
+		}
 	}
 }
 
@@ -277,41 +247,21 @@ void cEntityEffectSpeed::OnDeactivate(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectSlowness:
+// Speed and slowness:
 
-void cEntityEffectSlowness::OnActivate(cPawn & a_Target)
+void cEntityEffect::ModifySpeed(cPawn & a_Target, double a_Modifier)
 {
 	if (a_Target.IsMob())
 	{
 		cMonster * Mob = (cMonster*) &a_Target;
-		Mob->SetRelativeWalkSpeed(Mob->GetRelativeWalkSpeed() - 0.15 * m_Intensity);
+		Mob->SetRelativeWalkSpeed(Mob->GetRelativeWalkSpeed() + a_Modifier);
 	}
 	else if (a_Target.IsPlayer())
 	{
 		cPlayer * Player = (cPlayer*) &a_Target;
-		Player->SetNormalMaxSpeed(Player->GetNormalMaxSpeed() - 0.15 * m_Intensity);
-		Player->SetSprintingMaxSpeed(Player->GetSprintingMaxSpeed() - 0.195 * m_Intensity);
-		Player->SetFlyingMaxSpeed(Player->GetFlyingMaxSpeed() - 0.15 * m_Intensity);
-	}
-}
-
-
-
-
-
-void cEntityEffectSlowness::OnDeactivate(cPawn & a_Target)
-{
-	if (a_Target.IsMob())
-	{
-		cMonster * Mob = (cMonster*) &a_Target;
-		Mob->SetRelativeWalkSpeed(Mob->GetRelativeWalkSpeed() + 0.15 * m_Intensity);
-	}
-	else if (a_Target.IsPlayer())
-	{
-		cPlayer * Player = (cPlayer*) &a_Target;
-		Player->SetNormalMaxSpeed(Player->GetNormalMaxSpeed() + 0.15 * m_Intensity);
-		Player->SetSprintingMaxSpeed(Player->GetSprintingMaxSpeed() + 0.195 * m_Intensity);
-		Player->SetFlyingMaxSpeed(Player->GetFlyingMaxSpeed() + 0.15 * m_Intensity);
+		Player->SetNormalMaxSpeed(Player->GetNormalMaxSpeed() + a_Modifier);
+		Player->SetSprintingMaxSpeed(Player->GetSprintingMaxSpeed() + 1.3 * a_Modifier);
+		Player->SetFlyingMaxSpeed(Player->GetFlyingMaxSpeed() + a_Modifier);
 	}
 }
 
@@ -320,39 +270,26 @@ void cEntityEffectSlowness::OnDeactivate(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectInstantHealth:
+// Instant health and instant damage:
 
-void cEntityEffectInstantHealth::OnActivate(cPawn & a_Target)
+void cEntityEffect::ApplyInstantHealth(cPawn & a_Target, bool a_IsHealing)
 {
 	// Base amount = 6, doubles for every increase in intensity
 	int amount = (int)(6 * (1 << m_Intensity) * m_DistanceModifier);
 	
+	// The undead mobs are healed by the instant damage and harmed by the instant health:
 	if (a_Target.IsMob() && ((cMonster &) a_Target).IsUndead())
 	{
-		a_Target.TakeDamage(dtPotionOfHarming, nullptr, amount, 0);  // TODO: Store attacker in a pointer-safe way, pass to TakeDamage
-		return;
+		a_IsHealing = !a_IsHealing;
 	}
-	a_Target.Heal(amount);
-}
-
-
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectInstantDamage:
-
-void cEntityEffectInstantDamage::OnActivate(cPawn & a_Target)
-{
-	// Base amount = 6, doubles for every increase in intensity
-	int amount = (int)(6 * (1 << m_Intensity) * m_DistanceModifier);
-	
-	if (a_Target.IsMob() && ((cMonster &) a_Target).IsUndead())
+	if (a_IsHealing)
 	{
 		a_Target.Heal(amount);
-		return;
 	}
-	a_Target.TakeDamage(dtPotionOfHarming, nullptr, amount, 0);  // TODO: Store attacker in a pointer-safe way, pass to TakeDamage
+	else
+	{
+		a_Target.TakeDamage(dtPotionOfHarming, nullptr, amount, 0);  // TODO: Store attacker in a pointer-safe way, pass to TakeDamage
+	}
 }
 
 
@@ -360,12 +297,11 @@ void cEntityEffectInstantDamage::OnActivate(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectRegeneration:
+// Regeneration:
 
-void cEntityEffectRegeneration::OnTick(cPawn & a_Target)
+void cEntityEffect::TickRegeneration(cPawn & a_Target)
 {
-	super::OnTick(a_Target);
-
+	++m_Ticks;
 	if (a_Target.IsMob() && ((cMonster &) a_Target).IsUndead())
 	{
 		return;
@@ -378,7 +314,6 @@ void cEntityEffectRegeneration::OnTick(cPawn & a_Target)
 	{
 		return;
 	}
-
 	a_Target.Heal(1);
 }
 
@@ -387,11 +322,11 @@ void cEntityEffectRegeneration::OnTick(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectHunger:
+// Hunger:
 
-void cEntityEffectHunger::OnTick(cPawn & a_Target)
+void cEntityEffect::TickHunger(cPawn & a_Target)
 {
-	super::OnTick(a_Target);
+	++m_Ticks;
 	
 	if (a_Target.IsPlayer())
 	{
@@ -405,29 +340,11 @@ void cEntityEffectHunger::OnTick(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectWeakness:
+// Poison:
 
-void cEntityEffectWeakness::OnTick(cPawn & a_Target)
+void cEntityEffect::TickPoison(cPawn & a_Target)
 {
-	super::OnTick(a_Target);
-	
-	// Damage reduction = 0.5 damage, multiplied by potion level (Weakness II = 1 damage)
-	// double dmg_reduc = 0.5 * (a_Effect.GetIntensity() + 1);
-	
-	// TODO: Implement me!
-	// TODO: Weakened villager zombies can be turned back to villagers with the god apple
-}
-
-
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectPoison:
-
-void cEntityEffectPoison::OnTick(cPawn & a_Target)
-{
-	super::OnTick(a_Target);
+	++m_Ticks;
 	
 	if (a_Target.IsMob())
 	{
@@ -462,15 +379,14 @@ void cEntityEffectPoison::OnTick(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectWither:
+// Wither:
 
-void cEntityEffectWither::OnTick(cPawn & a_Target)
+void cEntityEffect::TickWither(cPawn & a_Target)
 {
-	super::OnTick(a_Target);
+	++m_Ticks;
 	
 	// Damage frequency = 40 ticks, divided by effect level (Wither II = 20 ticks)
 	int frequency = (int) std::floor(25.0 / (double)(m_Intensity + 1));
-
 	if ((m_Ticks % frequency) == 0)
 	{
 		a_Target.TakeDamage(dtWither, nullptr, 1, 0);
@@ -482,9 +398,9 @@ void cEntityEffectWither::OnTick(cPawn & a_Target)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// cEntityEffectSaturation:
+// Saturation:
 
-void cEntityEffectSaturation::OnTick(cPawn & a_Target)
+void cEntityEffect::TickSaturation(cPawn & a_Target)
 {
 	if (a_Target.IsPlayer())
 	{
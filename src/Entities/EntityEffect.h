@@ -60,10 +60,11 @@ public:
 	cEntityEffect(void);
 	
 	/** Creates an entity effect of the specified type
+	@param a_EffectType       The type of the effect, which determines what it does to the pawn
 	@param a_Duration         How long this effect will last, in ticks
 	@param a_Intensity        How strong the effect will be applied
 	@param a_DistanceModifier The distance modifier for affecting potency, defaults to 1 */
-	cEntityEffect(int a_Duration, short a_Intensity, double a_DistanceModifier = 1);
+	cEntityEffect(eType a_EffectType, int a_Duration, short a_Intensity, double a_DistanceModifier = 1);
 	
 	/** Creates an entity effect by copying another
 	@param a_OtherEffect      The other effect to copy */
@@ -73,15 +74,8 @@ public:
 	@param a_OtherEffect      The other effect to copy */
 	cEntityEffect & operator =(cEntityEffect a_OtherEffect);
 	
-	virtual ~cEntityEffect(void) {}
-	
-	/** Creates a pointer to the proper entity effect from the effect type
-	@warning This function creates raw pointers that must be manually managed.
-	@param a_EffectType       The effect type to create the effect from
-	@param a_Duration         How long this effect will last, in ticks
-	@param a_Intensity        How strong the effect will be applied
-	@param a_DistanceModifier The distance modifier for affecting potency, defaults to 1 */
-	static cEntityEffect * CreateEntityEffect(cEntityEffect::eType a_EffectType, int a_Duration, short a_Intensity, double a_DistanceModifier);
+	/** Returns the type of the effect */
+	eType GetType(void) const { return m_Type; }
 	
 	/** Returns how many ticks this effect has been active for */
 	int GetTicks(void) const { return m_Ticks; }
@@ -101,16 +95,19 @@ public:
 	void SetDistanceModifier(double a_DistanceModifier) { m_DistanceModifier = a_DistanceModifier; }
 	
 	/** Called on each tick.
-	By default increases the m_Ticks, descendants may override to provide additional processing. */
-	virtual void OnTick(cPawn & a_Target);
+	Increases the m_Ticks and does the type-specific processing. */
+	void OnTick(cPawn & a_Target);
 	
 	/** Called when the effect is first added to an entity */
-	virtual void OnActivate(cPawn & a_Target) { }
+	void OnActivate(cPawn & a_Target);
 	
 	/** Called when the effect is removed from an entity */
-	virtual void OnDeactivate(cPawn & a_Target) { }
+	void OnDeactivate(cPawn & a_Target);
 	
 protected:
+	/** The type of the effect. The effects are plain values, what each type does is dispatched on this in the On*() functions. */
+	eType m_Type;
+
 	/** How many ticks this effect has been active for */
 	int m_Ticks;
 	
@@ -122,380 +119,21 @@ protected:
 	
 	/** The distance modifier for affecting potency */
 	double m_DistanceModifier;
-};  // tolua_export
-
-
-
-
-
-class cEntityEffectSpeed:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectSpeed(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-
-	virtual void OnActivate(cPawn & a_Target) override;
-
-	virtual void OnDeactivate(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectSlowness:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectSlowness(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-
-	virtual void OnActivate(cPawn & a_Target) override;
-
-	virtual void OnDeactivate(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectHaste:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectHaste(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectMiningFatigue:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectMiningFatigue(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectStrength:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectStrength(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectInstantHealth:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectInstantHealth(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
 	
-	virtual void OnActivate(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectInstantDamage:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectInstantDamage(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
 	
-	virtual void OnActivate(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectJumpBoost:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectJumpBoost(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectNausea:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectNausea(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectRegeneration:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectRegeneration(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
+	/** Adds the speed modifier to the pawn's walking (and for players, also sprinting and flying) speed.
+	Used by the speed and slowness effects, with the sprinting modifier being 1.3 times the walking one. */
+	static void ModifySpeed(cPawn & a_Target, double a_Modifier);
 	
-	virtual void OnTick(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectResistance:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectResistance(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectFireResistance:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectFireResistance(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectWaterBreathing:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectWaterBreathing(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectInvisibility:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectInvisibility(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectBlindness:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectBlindness(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectNightVision:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectNightVision(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectHunger:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectHunger(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
+	/** Applies the instant health or damage; the undead mobs are affected the other way around. */
+	void ApplyInstantHealth(cPawn & a_Target, bool a_IsHealing);
 	
-	// cEntityEffect overrides:
-	virtual void OnTick(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectWeakness:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectWeakness(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-	
-	// cEntityEffect overrides:
-	virtual void OnTick(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectPoison:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectPoison(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-	
-	// cEntityEffect overrides:
-	virtual void OnTick(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectWither:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectWither(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-	
-	// cEntityEffect overrides:
-	virtual void OnTick(cPawn & a_Target) override;
-};
-
-
-
-
-
-class cEntityEffectHealthBoost:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectHealthBoost(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectAbsorption:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectAbsorption(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-};
-
-
-
-
-
-class cEntityEffectSaturation:
-	public cEntityEffect
-{
-	typedef cEntityEffect super;
-public:
-	cEntityEffectSaturation(int a_Duration, short a_Intensity, double a_DistanceModifier = 1):
-		super(a_Duration, a_Intensity, a_DistanceModifier)
-	{
-	}
-	
-	virtual void OnTick(cPawn & a_Target) override;
-};
+	void TickRegeneration(cPawn & a_Target);
+	void TickHunger(cPawn & a_Target);
+	void TickPoison(cPawn & a_Target);
+	void TickWither(cPawn & a_Target);
+	void TickSaturation(cPawn & a_Target);
+};  // tolua_export
 
 
 
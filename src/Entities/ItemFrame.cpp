@@ -45,7 +45,7 @@ void cItemFrame::OnRightClicked(cPlayer & a_Player)
 		}
 	}
 
-	GetWorld()->BroadcastEntityMetadata(*this);  // Update clients
+	GetWorld()->BroadcastEntityMetadata(*this, nullptr, emfSpecific);  // Update clients
 }
 
 
@@ -74,7 +74,7 @@ void cItemFrame::KilledBy(TakeDamageInfo & a_TDI)
 	m_Item.Empty();
 	m_ItemRotation = 0;
 	SetInvulnerableTicks(0);
-	GetWorld()->BroadcastEntityMetadata(*this);
+	GetWorld()->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 }
 
 
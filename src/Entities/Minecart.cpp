@@ -168,12 +168,12 @@ void cMinecart::HandlePhysics(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 
 		switch (InsideType)
 		{
-			case E_BLOCK_RAIL: HandleRailPhysics(InsideMeta, a_Dt); break;
+			case E_BLOCK_RAIL: HandleRailPhysics(InsideMeta, a_Dt, *Chunk); break;
 			case E_BLOCK_ACTIVATOR_RAIL: break;
-			case E_BLOCK_POWERED_RAIL: HandlePoweredRailPhysics(InsideMeta); break;
+			case E_BLOCK_POWERED_RAIL: HandlePoweredRailPhysics(InsideMeta, *Chunk); break;
 			case E_BLOCK_DETECTOR_RAIL:
 			{
-				HandleDetectorRailPhysics(InsideMeta, a_Dt);
+				HandleDetectorRailPhysics(InsideMeta, a_Dt, *Chunk);
 				WasDetectorRail = true;
 				break;
 			}
@@ -208,7 +208,7 @@ void cMinecart::HandlePhysics(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 
 
 
-void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt)
+void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	/*
 	NOTE: Please bear in mind that taking away from negatives make them even more negative,
@@ -225,7 +225,7 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 			SetSpeedX(0);  // Correct diagonal movement from curved rails
 
 			// Execute both the entity and block collision checks
-			bool BlckCol = TestBlockCollision(a_RailMeta), EntCol = TestEntityCollision(a_RailMeta);
+			bool BlckCol = TestBlockCollision(a_RailMeta, a_Chunk), EntCol = TestEntityCollision(a_RailMeta, a_Chunk);
 			if (EntCol || BlckCol)
 			{
 				return;
@@ -253,7 +253,7 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 			SetSpeedY(NO_SPEED);
 			SetSpeedZ(NO_SPEED);
 
-			bool BlckCol = TestBlockCollision(a_RailMeta), EntCol = TestEntityCollision(a_RailMeta);
+			bool BlckCol = TestBlockCollision(a_RailMeta, a_Chunk), EntCol = TestEntityCollision(a_RailMeta, a_Chunk);
 			if (EntCol || BlckCol)
 			{
 				return;
@@ -362,8 +362,8 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 			SetPosY(floor(GetPosY()) + 0.55);  // Levitate dat cart
 			SetSpeedY(0);
 
-			TestBlockCollision(a_RailMeta);
-			TestEntityCollision(a_RailMeta);
+			TestBlockCollision(a_RailMeta, a_Chunk);
+			TestEntityCollision(a_RailMeta, a_Chunk);
 
 			// SnapToRail handles turning
 
@@ -375,8 +375,8 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 			SetPosY(floor(GetPosY()) + 0.55);
 			SetSpeedY(0);
 
-			TestBlockCollision(a_RailMeta);
-			TestEntityCollision(a_RailMeta);
+			TestBlockCollision(a_RailMeta, a_Chunk);
+			TestEntityCollision(a_RailMeta, a_Chunk);
 
 			break;
 		}
@@ -386,8 +386,8 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 			SetPosY(floor(GetPosY()) + 0.55);
 			SetSpeedY(0);
 
-			TestBlockCollision(a_RailMeta);
-			TestEntityCollision(a_RailMeta);
+			TestBlockCollision(a_RailMeta, a_Chunk);
+			TestEntityCollision(a_RailMeta, a_Chunk);
 
 			break;
 		}
@@ -397,8 +397,8 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 			SetPosY(floor(GetPosY()) + 0.55);
 			SetSpeedY(0);
 
-			TestBlockCollision(a_RailMeta);
-			TestEntityCollision(a_RailMeta);
+			TestBlockCollision(a_RailMeta, a_Chunk);
+			TestEntityCollision(a_RailMeta, a_Chunk);
 
 			break;
 		}
@@ -413,7 +413,7 @@ void cMinecart::HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::millisecon
 
 
 
-void cMinecart::HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta)
+void cMinecart::HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta, cChunk & a_Chunk)
 {
 	// Initialise to 'slow down' values
 	int AccelDecelSpeed = -2;
@@ -435,7 +435,7 @@ void cMinecart::HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta)
 			SetSpeedY(0);
 			SetSpeedX(0);
 
-			bool BlckCol = TestBlockCollision(a_RailMeta), EntCol = TestEntityCollision(a_RailMeta);
+			bool BlckCol = TestBlockCollision(a_RailMeta, a_Chunk), EntCol = TestEntityCollision(a_RailMeta, a_Chunk);
 			if (EntCol || BlckCol)
 			{
 				return;
@@ -461,7 +461,7 @@ void cMinecart::HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta)
 			SetSpeedY(NO_SPEED);
 			SetSpeedZ(NO_SPEED);
 
-			bool BlckCol = TestBlockCollision(a_RailMeta), EntCol = TestEntityCollision(a_RailMeta);
+			bool BlckCol = TestBlockCollision(a_RailMeta, a_Chunk), EntCol = TestEntityCollision(a_RailMeta, a_Chunk);
 			if (EntCol || BlckCol)
 			{
 				return;
@@ -568,20 +568,20 @@ void cMinecart::HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta)
 
 
 
-void cMinecart::HandleDetectorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt)
+void cMinecart::HandleDetectorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	m_World->SetBlockMeta(m_DetectorRailPosition, a_RailMeta | 0x08);
 
 	// No special handling
-	HandleRailPhysics(a_RailMeta & 0x07, a_Dt);
+	HandleRailPhysics(a_RailMeta & 0x07, a_Dt, a_Chunk);
 }
 
 
 
 
-void cMinecart::HandleActivatorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt)
+void cMinecart::HandleActivatorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
-	HandleRailPhysics(a_RailMeta & 0x07, a_Dt);
+	HandleRailPhysics(a_RailMeta & 0x07, a_Dt, a_Chunk);
 }
 
 
@@ -717,7 +717,7 @@ void cMinecart::SnapToRail(NIBBLETYPE a_RailMeta)
 
 
 
-bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
+bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta, cChunk & a_Chunk)
 {
 	switch (a_RailMeta)
 	{
@@ -725,7 +725,7 @@ bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
 		{
 			if (GetSpeedZ() > 0)
 			{
-				BLOCKTYPE Block = m_World->GetBlock(POSX_TOINT, POSY_TOINT, (int)ceil(GetPosZ()));
+				BLOCKTYPE Block = GetBlockNear(a_Chunk, POSX_TOINT, POSY_TOINT, (int)ceil(GetPosZ()));
 				if (!IsBlockRail(Block) && cBlockInfo::IsSolid(Block))
 				{
 					// We could try to detect a block in front based purely on coordinates, but xoft made a bounding box system - why not use? :P
@@ -742,7 +742,7 @@ bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
 			}
 			else if (GetSpeedZ() < 0)
 			{
-				BLOCKTYPE Block = m_World->GetBlock(POSX_TOINT, POSY_TOINT, POSZ_TOINT - 1);
+				BLOCKTYPE Block = GetBlockNear(a_Chunk, POSX_TOINT, POSY_TOINT, POSZ_TOINT - 1);
 				if (!IsBlockRail(Block) && cBlockInfo::IsSolid(Block))
 				{
 					cBoundingBox bbBlock(Vector3d(POSX_TOINT, POSY_TOINT, POSZ_TOINT - 1), 0.5, 1);
@@ -762,7 +762,7 @@ bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
 		{
 			if (GetSpeedX() > 0)
 			{
-				BLOCKTYPE Block = m_World->GetBlock((int)ceil(GetPosX()), POSY_TOINT, POSZ_TOINT);
+				BLOCKTYPE Block = GetBlockNear(a_Chunk, (int)ceil(GetPosX()), POSY_TOINT, POSZ_TOINT);
 				if (!IsBlockRail(Block) && cBlockInfo::IsSolid(Block))
 				{
 					cBoundingBox bbBlock(Vector3d((int)ceil(GetPosX()), POSY_TOINT, POSZ_TOINT), 0.5, 1);
@@ -778,7 +778,7 @@ bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
 			}
 			else if (GetSpeedX() < 0)
 			{
-				BLOCKTYPE Block = m_World->GetBlock(POSX_TOINT - 1, POSY_TOINT, POSZ_TOINT);
+				BLOCKTYPE Block = GetBlockNear(a_Chunk, POSX_TOINT - 1, POSY_TOINT, POSZ_TOINT);
 				if (!IsBlockRail(Block) && cBlockInfo::IsSolid(Block))
 				{
 					cBoundingBox bbBlock(Vector3d(POSX_TOINT - 1, POSY_TOINT, POSZ_TOINT), 0.5, 1);
@@ -799,10 +799,10 @@ bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
 		case E_META_RAIL_CURVED_ZP_XM:
 		case E_META_RAIL_CURVED_ZP_XP:
 		{
-			BLOCKTYPE BlockXM = m_World->GetBlock(POSX_TOINT - 1, POSY_TOINT, POSZ_TOINT);
-			BLOCKTYPE BlockXP = m_World->GetBlock(POSX_TOINT + 1, POSY_TOINT, POSZ_TOINT);
-			BLOCKTYPE BlockZM = m_World->GetBlock(POSX_TOINT, POSY_TOINT, POSZ_TOINT - 1);
-			BLOCKTYPE BlockZP = m_World->GetBlock(POSX_TOINT, POSY_TOINT, POSZ_TOINT + 1);
+			BLOCKTYPE BlockXM = GetBlockNear(a_Chunk, POSX_TOINT - 1, POSY_TOINT, POSZ_TOINT);
+			BLOCKTYPE BlockXP = GetBlockNear(a_Chunk, POSX_TOINT + 1, POSY_TOINT, POSZ_TOINT);
+			BLOCKTYPE BlockZM = GetBlockNear(a_Chunk, POSX_TOINT, POSY_TOINT, POSZ_TOINT - 1);
+			BLOCKTYPE BlockZP = GetBlockNear(a_Chunk, POSX_TOINT, POSY_TOINT, POSZ_TOINT + 1);
 			if (
 				(!IsBlockRail(BlockXM) && cBlockInfo::IsSolid(BlockXM)) ||
 				(!IsBlockRail(BlockXP) && cBlockInfo::IsSolid(BlockXP)) ||
@@ -824,15 +824,40 @@ bool cMinecart::TestBlockCollision(NIBBLETYPE a_RailMeta)
 
 
 
-bool cMinecart::TestEntityCollision(NIBBLETYPE a_RailMeta)
+BLOCKTYPE cMinecart::GetBlockNear(cChunk & a_Chunk, int a_BlockX, int a_BlockY, int a_BlockZ)
+{
+	if ((a_BlockY < 0) || (a_BlockY >= cChunkDef::Height))
+	{
+		return E_BLOCK_AIR;
+	}
+	BLOCKTYPE BlockType;
+	int RelX = a_BlockX - a_Chunk.GetPosX() * cChunkDef::Width;
+	int RelZ = a_BlockZ - a_Chunk.GetPosZ() * cChunkDef::Width;
+	if (!a_Chunk.UnboundedRelGetBlockType(RelX, a_BlockY, RelZ, BlockType))
+	{
+		return E_BLOCK_AIR;
+	}
+	return BlockType;
+}
+
+
+
+
+
+bool cMinecart::TestEntityCollision(NIBBLETYPE a_RailMeta, cChunk & a_Chunk)
 {
 	cMinecartCollisionCallback MinecartCollisionCallback(
 		GetPosition(), GetHeight(), GetWidth(), GetUniqueID(),
 		((m_Attachee == nullptr) ? cEntity::INVALID_ID : m_Attachee->GetUniqueID())
 	);
-	int ChunkX, ChunkZ;
-	cChunkDef::BlockToChunk(POSX_TOINT, POSZ_TOINT, ChunkX, ChunkZ);
-	m_World->ForEachEntityInChunk(ChunkX, ChunkZ, MinecartCollisionCallback);
+	int RelX = POSX_TOINT - a_Chunk.GetPosX() * cChunkDef::Width;
+	int RelZ = POSZ_TOINT - a_Chunk.GetPosZ() * cChunkDef::Width;
+	cChunk * Chunk = a_Chunk.GetRelNeighborChunkAdjustCoords(RelX, RelZ);
+	if ((Chunk == nullptr) || !Chunk->IsValid())
+	{
+		return false;
+	}
+	Chunk->ForEachEntity(MinecartCollisionCallback);
 
 	if (!MinecartCollisionCallback.FoundIntersection())
 	{
@@ -1017,7 +1042,7 @@ bool cMinecart::DoTakeDamage(TakeDamageInfo & TDI)
 		return false;
 	}
 
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 
 	if (GetHealth() <= 0)
 	{
@@ -1211,7 +1236,7 @@ void cMinecartWithFurnace::OnRightClicked(cPlayer & a_Player)
 		}
 		m_IsFueled = true;
 		m_FueledTimeLeft = m_FueledTimeLeft + 600;  // The minecart will be active 600 more ticks.
-		m_World->BroadcastEntityMetadata(*this);
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 	}
 }
 
@@ -1229,7 +1254,7 @@ void cMinecartWithFurnace::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk
 		if (m_FueledTimeLeft < 0)
 		{
 			m_IsFueled = false;
-			m_World->BroadcastEntityMetadata(*this);
+			m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 			return;
 		}
 
@@ -55,28 +55,33 @@ protected:
 
 	/** Handles physics on normal rails
 	For each tick, slow down on flat rails, speed up or slow down on ascending / descending rails (depending on direction), and turn on curved rails. */
-	void HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt);
+	void HandleRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt, cChunk & a_Chunk);
 
 	/** Handles powered rail physics
 		Each tick, speed up or slow down cart, depending on metadata of rail (powered or not)
 	*/
-	void HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta);
+	void HandlePoweredRailPhysics(NIBBLETYPE a_RailMeta, cChunk & a_Chunk);
 
 	/** Handles detector rail activation
 		Activates detector rails when a minecart is on them. Calls HandleRailPhysics() for physics simulations
 	*/
-	void HandleDetectorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt);
+	void HandleDetectorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt, cChunk & a_Chunk);
 
 	/** Handles activator rails - placeholder for future implementation */
-	void HandleActivatorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt);
+	void HandleActivatorRailPhysics(NIBBLETYPE a_RailMeta, std::chrono::milliseconds a_Dt, cChunk & a_Chunk);
 
 	/** Snaps a mincecart to a rail's axis, resetting its speed
 		For curved rails, it changes the cart's direction as well as snapping it to axis */
 	void SnapToRail(NIBBLETYPE a_RailMeta);
 	/** Tests if a solid block is in front of a cart, and stops the cart (and returns true) if so; returns false if no obstruction */
-	bool TestBlockCollision(NIBBLETYPE a_RailMeta);
+	bool TestBlockCollision(NIBBLETYPE a_RailMeta, cChunk & a_Chunk);
 	/** Tests if this mincecart's bounding box is intersecting another entity's bounding box (collision) and pushes mincecart away */
-	bool TestEntityCollision(NIBBLETYPE a_RailMeta);
+	bool TestEntityCollision(NIBBLETYPE a_RailMeta, cChunk & a_Chunk);
+	
+	/** Returns the block type at the specified absolute coords, read through a_Chunk (the chunk the cart is in) and its neighbors,
+	so that the rail physics, run in the chunk's tick, needn't go through the world and the chunkmap lookups.
+	Returns air if the block is not available. */
+	static BLOCKTYPE GetBlockNear(cChunk & a_Chunk, int a_BlockX, int a_BlockY, int a_BlockZ);
 
 } ;
 
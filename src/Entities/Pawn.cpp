@@ -11,7 +11,7 @@
 
 cPawn::cPawn(eEntityType a_EntityType, double a_Width, double a_Height) :
 	super(a_EntityType, 0, 0, 0, a_Width, a_Height)
-	, m_EntityEffects(tEffectMap())
+	, m_NumEntityEffects(0)
 {
 	SetGravity(-32.0f);
 	SetAirDrag(0.02f);
@@ -24,22 +24,23 @@ cPawn::cPawn(eEntityType a_EntityType, double a_Width, double a_Height) :
 void cPawn::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	// Iterate through this entity's applied effects
-	for (tEffectMap::iterator iter = m_EntityEffects.begin(); iter != m_EntityEffects.end();)
+	// The effects may change the list while ticking (e.g. killing the pawn clears it), so the count is re-checked each time
+	for (size_t i = 0; i < m_NumEntityEffects;)
 	{
-		// Copies values to prevent pesky wrong accesses and erasures
-		cEntityEffect::eType EffectType = iter->first;
-		cEntityEffect * Effect = iter->second;
+		cEntityEffect::eType EffectType = m_EntityEffects[i].GetType();
+		m_EntityEffects[i].OnTick(*this);
 		
-		Effect->OnTick(*this);
-		
-		// Iterates (must be called before any possible erasure)
-		++iter;
-		
-		// Remove effect if duration has elapsed
-		if (Effect->GetDuration() - Effect->GetTicks() <= 0)
+		// Remove effect if duration has elapsed; the removal moves another effect into this slot:
+		if (
+			(i < m_NumEntityEffects) &&
+			(m_EntityEffects[i].GetType() == EffectType) &&
+			(m_EntityEffects[i].GetDuration() - m_EntityEffects[i].GetTicks() <= 0)
+		)
 		{
 			RemoveEntityEffect(EffectType);
+			continue;
 		}
+		++i;
 		
 		// TODO: Check for discrepancies between client and server effect values
 	}
@@ -77,9 +78,17 @@ void cPawn::AddEntityEffect(cEntityEffect::eType a_EffectType, int a_Duration, s
 	}
 	a_Duration = (int)(a_Duration * a_DistanceModifier);
 	
-	m_EntityEffects[a_EffectType] = cEntityEffect::CreateEntityEffect(a_EffectType, a_Duration, a_Intensity, a_DistanceModifier);
+	// Replace the effect of the same type, if already applied:
+	size_t Idx = FindEntityEffect(a_EffectType);
+	if (Idx == MAX_ENTITY_EFFECTS)
+	{
+		ASSERT(m_NumEntityEffects < MAX_ENTITY_EFFECTS);
+		Idx = m_NumEntityEffects;
+		m_NumEntityEffects += 1;
+	}
+	m_EntityEffects[Idx] = cEntityEffect(a_EffectType, a_Duration, a_Intensity, a_DistanceModifier);
 	m_World->BroadcastEntityEffect(*this, a_EffectType, a_Intensity, a_Duration);
-	m_EntityEffects[a_EffectType]->OnActivate(*this);
+	m_EntityEffects[Idx].OnActivate(*this);
 }
 
 
@@ -88,10 +97,19 @@ void cPawn::AddEntityEffect(cEntityEffect::eType a_EffectType, int a_Duration, s
 
 void cPawn::RemoveEntityEffect(cEntityEffect::eType a_EffectType)
 {
+	size_t Idx = FindEntityEffect(a_EffectType);
+	if (Idx == MAX_ENTITY_EFFECTS)
+	{
+		// Not applied
+		return;
+	}
+
+	// Take the effect out of the list before deactivating it, the deactivation may change the list:
+	cEntityEffect Effect(m_EntityEffects[Idx]);
+	m_NumEntityEffects -= 1;
+	m_EntityEffects[Idx] = m_EntityEffects[m_NumEntityEffects];
 	m_World->BroadcastRemoveEntityEffect(*this, a_EffectType);
-	m_EntityEffects[a_EffectType]->OnDeactivate(*this);
-	delete m_EntityEffects[a_EffectType];
-	m_EntityEffects.erase(a_EffectType);
+	Effect.OnDeactivate(*this);
 }
 
 
@@ -100,18 +118,27 @@ void cPawn::RemoveEntityEffect(cEntityEffect::eType a_EffectType)
 
 void cPawn::ClearEntityEffects()
 {
-	// Iterate through this entity's applied effects
-	for (tEffectMap::iterator iter = m_EntityEffects.begin(); iter != m_EntityEffects.end();)
+	// Remove the effects from the back, each removal takes out the last one:
+	while (m_NumEntityEffects > 0)
 	{
-		// Copy values to prevent pesky wrong erasures
-		cEntityEffect::eType EffectType = iter->first;
-		
-		// Iterates (must be called before any possible erasure)
-		++iter;
-		
-		// Remove effect
-		RemoveEntityEffect(EffectType);
+		RemoveEntityEffect(m_EntityEffects[m_NumEntityEffects - 1].GetType());
+	}
+}
+
+
+
+
+
+size_t cPawn::FindEntityEffect(cEntityEffect::eType a_EffectType) const
+{
+	for (size_t i = 0; i < m_NumEntityEffects; i++)
+	{
+		if (m_EntityEffects[i].GetType() == a_EffectType)
+		{
+			return i;
+		}
 	}
+	return MAX_ENTITY_EFFECTS;
 }
 
 
@@ -45,8 +45,16 @@ public:
 	// tolua_end
 
 protected:
-	typedef std::map<cEntityEffect::eType, cEntityEffect *> tEffectMap;
-	tEffectMap m_EntityEffects;
+	/** The number of effect types; each type is applied at most once, so this is also the most effects that can be applied at a time. */
+	static const size_t MAX_ENTITY_EFFECTS = cEntityEffect::effSaturation;
+
+	/** The currently applied effects, in the first m_NumEntityEffects items, in no particular order.
+	Kept inline as values, so that adding and removing effects doesn't allocate and the pawns without effects skip them cheaply. */
+	cEntityEffect m_EntityEffects[MAX_ENTITY_EFFECTS];
+	size_t m_NumEntityEffects;
+
+	/** Returns the index of the applied effect of the specified type in m_EntityEffects, or MAX_ENTITY_EFFECTS if not applied. */
+	size_t FindEntityEffect(cEntityEffect::eType a_EffectType) const;
 } ;  // tolua_export
 
 
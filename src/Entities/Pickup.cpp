@@ -13,6 +13,19 @@
 #include "../Bindings/PluginManager.h"
 #include "../Root.h"
 #include "../Chunk.h"
+#include "../BoundingBox.h"
+
+
+
+
+
+/** Number of ticks between two attempts of a pickup to combine with the pickups around it.
+The attempts of the individual pickups are spread over the interval by their IDs. */
+static const int PICKUP_COMBINE_INTERVAL = 10;
+
+/** The maximum distance between two pickups that combine. */
+static const double PICKUP_COMBINE_DISTANCE = 1.2;
+
 
 
 
@@ -39,7 +52,7 @@ public:
 		double Distance = (EntityPos - m_Position).Length();
 
 		cItem & Item = ((cPickup *)a_Entity)->GetItem();
-		if ((Distance < 1.2) && Item.IsEqual(m_Pickup->GetItem()))
+		if ((Distance < PICKUP_COMBINE_DISTANCE) && Item.IsEqual(m_Pickup->GetItem()))
 		{
 			short CombineCount = Item.m_ItemCount;
 			if ((CombineCount + m_Pickup->GetItem().m_ItemCount) > Item.GetMaxStackSize())
@@ -90,6 +103,7 @@ cPickup::cPickup(double a_PosX, double a_PosY, double a_PosZ, const cItem & a_It
 	, m_Item(a_Item)
 	, m_bCollected(false)
 	, m_bIsPlayerCreated(IsPlayerCreated)
+	, m_LastTickPos(a_PosX, a_PosY - 1, a_PosZ)
 {
 	SetGravity(-16.0f);
 	SetAirDrag(0.02f);
@@ -136,6 +150,16 @@ void cPickup::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 			BLOCKTYPE BlockBelow = (BlockY > 0) ? CurrentChunk->GetBlock(RelBlockX, BlockY - 1, RelBlockZ) : E_BLOCK_AIR;
 			BLOCKTYPE BlockIn = CurrentChunk->GetBlock(RelBlockX, BlockY, RelBlockZ);
 
+			// If the pickup is moving over a hopper, wake the hopper up so that it sucks the pickup in once it's close enough:
+			if (GetPosition() != m_LastTickPos)
+			{
+				m_LastTickPos = GetPosition();
+				if (BlockBelow == E_BLOCK_HOPPER)
+				{
+					CurrentChunk->WakeUpBlockEntity(RelBlockX, BlockY - 1, RelBlockZ);
+				}
+			}
+
 			if (
 				IsBlockLava(BlockBelow) || (BlockBelow == E_BLOCK_FIRE) ||
 				IsBlockLava(BlockIn) || (BlockIn == E_BLOCK_FIRE)
@@ -151,14 +175,19 @@ void cPickup::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 				}
 			}
 
-			// Try to combine the pickup with adjacent same-item pickups:
-			if (!IsDestroyed() && (m_Item.m_ItemCount < m_Item.GetMaxStackSize()))  // Don't combine if already full
+			// Try to combine the pickup with adjacent same-item pickups, once in a while:
+			if (
+				!IsDestroyed() &&
+				(m_Item.m_ItemCount < m_Item.GetMaxStackSize()) &&  // Don't combine if already full
+				(((m_TicksAlive + static_cast<long>(GetUniqueID())) % PICKUP_COMBINE_INTERVAL) == 0)
+			)
 			{
-				// By using a_Chunk's ForEachEntity() instead of cWorld's, pickups don't combine across chunk boundaries.
+				// By using a_Chunk's ForEachEntityInBox() instead of cWorld's, pickups don't combine across chunk boundaries.
 				// That is a small price to pay for not having to traverse the entire world for each entity.
-				// The speedup in the tick thread is quite considerable.
+				// The box query only visits the entities in the chunk's entity index cells nearby, not the whole chunk.
 				cPickupCombiningCallback PickupCombiningCallback(GetPosition(), this);
-				a_Chunk.ForEachEntity(PickupCombiningCallback);
+				Vector3d CombineRange(PICKUP_COMBINE_DISTANCE, PICKUP_COMBINE_DISTANCE, PICKUP_COMBINE_DISTANCE);
+				a_Chunk.ForEachEntityInBox(cBoundingBox(GetPosition() - CombineRange, GetPosition() + CombineRange), PickupCombiningCallback);
 				if (PickupCombiningCallback.FoundMatchingPickup())
 				{
 					m_World->BroadcastEntityMetadata(*this);
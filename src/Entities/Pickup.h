@@ -58,4 +58,7 @@ private:
 	bool m_bCollected;
 
 	bool m_bIsPlayerCreated;
+
+	/** The position of the pickup during the last tick. A hopper below is woken up only while the pickup moves, not while it rests on the hopper. */
+	Vector3d m_LastTickPos;
 };  // tolua_export
@@ -49,6 +49,7 @@ const int cPlayer::EATING_TICKS = 30;
 
 cPlayer::cPlayer(cClientHandlePtr a_Client, const AString & a_PlayerName) :
 	super(etPlayer, 0.6, 1.8),
+	m_RankDataVersion(0),
 	m_bVisible(true),
 	m_FoodLevel(MAX_FOOD_LEVEL),
 	m_FoodSaturationLevel(5.0),
@@ -230,18 +231,30 @@ void cPlayer::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 	{
 		SendExperience();
 	}
+	
+	// Send the changes of the window's contents queued since the last tick (by whichever of the window's viewers ticks first):
+	if (m_CurrentWindow != nullptr)
+	{
+		m_CurrentWindow->SendPendingChanges();
+	}
 
 	bool CanMove = true;
 	if (!GetPosition().EqualsEps(m_LastPos, 0.02))  // Non negligible change in position from last tick? 0.02 tp prevent continous calling while floating sometimes.
 	{
 		// Apply food exhaustion from movement:
 		ApplyFoodExhaustionFromMovement();
+		m_World->GetPlayerProximityIndex().Update(*this, GetPosition());
 		
-		if (cRoot::Get()->GetPluginManager()->CallHookPlayerMoving(*this, m_LastPos, GetPosition()))
+		cPluginManager * PluginManager = cRoot::Get()->GetPluginManager();
+		if (PluginManager->CallHookPlayerMoving(*this, m_LastPos, GetPosition()))
 		{
 			CanMove = false;
 			TeleportToCoords(m_LastPos.x, m_LastPos.y, m_LastPos.z);
 		}
+		else if (PluginManager->HasHook(cPluginManager::HOOK_PLAYERS_MOVED))
+		{
+			m_World->QueuePlayerMove(*this, m_LastPos, GetPosition());
+		}
 	}
 
 	if (CanMove)
@@ -420,7 +433,7 @@ void cPlayer::StartChargingBow(void)
 	LOGD("Player \"%s\" started charging their bow", GetName().c_str());
 	m_IsChargingBow = true;
 	m_BowCharge = 0;
-	m_World->BroadcastEntityMetadata(*this, m_ClientHandle.get());
+	m_World->BroadcastEntityMetadata(*this, m_ClientHandle.get(), emfFlags);
 }
 
 
@@ -433,7 +446,7 @@ int cPlayer::FinishChargingBow(void)
 	int res = m_BowCharge;
 	m_IsChargingBow = false;
 	m_BowCharge = 0;
-	m_World->BroadcastEntityMetadata(*this, m_ClientHandle.get());
+	m_World->BroadcastEntityMetadata(*this, m_ClientHandle.get(), emfFlags);
 
 	return res;
 }
@@ -447,7 +460,7 @@ void cPlayer::CancelChargingBow(void)
 	LOGD("Player \"%s\" cancelled charging their bow at a charge of %d", GetName().c_str(), m_BowCharge);
 	m_IsChargingBow = false;
 	m_BowCharge = 0;
-	m_World->BroadcastEntityMetadata(*this, m_ClientHandle.get());
+	m_World->BroadcastEntityMetadata(*this, m_ClientHandle.get(), emfFlags);
 }
 
 
@@ -612,7 +625,7 @@ void cPlayer::StartEating(void)
 	
 	// Send the packets:
 	m_World->BroadcastEntityAnimation(*this, 3);
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfFlags);
 }
 
 
@@ -626,7 +639,7 @@ void cPlayer::FinishEating(void)
 	
 	// Send the packets:
 	m_ClientHandle->SendEntityStatus(*this, esPlayerEatingAccepted);
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfFlags);
 
 	// consume the item:
 	cItem Item(GetEquippedItem());
@@ -646,7 +659,7 @@ void cPlayer::FinishEating(void)
 void cPlayer::AbortEating(void)
 {
 	m_EatingFinishTick = -1;
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfFlags);
 }
 
 
@@ -776,7 +789,7 @@ void cPlayer::SetCrouch(bool a_IsCrouched)
 		return;
 	}
 	m_IsCrouched = a_IsCrouched;
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfFlags);
 }
 
 
@@ -1412,28 +1425,15 @@ bool cPlayer::HasPermission(const AString & a_Permission)
 		return true;
 	}
 	
-	AStringVector Split = StringSplit(a_Permission, ".");
-
-	// Iterate over all restrictions; if any matches, then return failure:
-	for (auto & Restriction: m_SplitRestrictions)
-	{
-		if (PermissionMatches(Split, Restriction))
-		{
-			return false;
-		}
-	}  // for Restriction - m_SplitRestrictions[]
+	// Make sure the rank's edits since the last load apply:
+	LoadRankIfChanged();
 
-	// Iterate over all granted permissions; if any matches, then return success:
-	for (auto & Permission: m_SplitPermissions)
+	// If any restriction matches, then return failure, otherwise any granted permission needs to match:
+	if (m_RestrictionTrie.Matches(a_Permission))
 	{
-		if (PermissionMatches(Split, Permission))
-		{
-			return true;
-		}
-	}  // for Permission - m_SplitPermissions[]
-
-	// No granted permission matches
-	return false;
+		return false;
+	}
+	return m_PermissionTrie.Matches(a_Permission);
 }
 
 
@@ -1670,10 +1670,14 @@ bool cPlayer::LoadFromDisk(cWorldPtr & a_World)
 		AString OldStyleFileName = Printf("players/%s.json", GetName().c_str());
 		if (LoadFromFile(OldStyleFileName, a_World))
 		{
-			// Save in new format and remove the old file
+			// Save in new format and remove the old file, once the new one has been written
 			if (SaveToDisk())
 			{
-				cFile::Delete(OldStyleFileName);
+				cRoot::Get()->GetFileWriter().Flush();
+				if (cFile::IsFile(GetUUIDFileName(m_UUID)))
+				{
+					cFile::Delete(OldStyleFileName);
+				}
 			}
 			return true;
 		}
@@ -1697,6 +1701,9 @@ bool cPlayer::LoadFromDisk(cWorldPtr & a_World)
 
 bool cPlayer::LoadFromFile(const AString & a_FileName, cWorldPtr & a_World)
 {
+	// The player may have been saved only recently, such as when reconnecting, make sure the file has been written:
+	cRoot::Get()->GetFileWriter().Flush();
+
 	// Load the data from the file:
 	cFile f;
 	if (!f.Open(a_FileName, cFile::fmRead))
@@ -1788,9 +1795,6 @@ bool cPlayer::LoadFromFile(const AString & a_FileName, cWorldPtr & a_World)
 
 bool cPlayer::SaveToDisk()
 {
-	cFile::CreateFolder(FILE_IO_PREFIX + AString("players/"));  // Create the "players" folder, if it doesn't exist yet (#1268)
-	cFile::CreateFolder(FILE_IO_PREFIX + AString("players/") + m_UUID.substr(0, 2));
-
 	// create the JSON data
 	Json::Value JSON_PlayerPosition;
 	JSON_PlayerPosition.append(Json::Value(GetPosX()));
@@ -1846,36 +1850,26 @@ bool cPlayer::SaveToDisk()
 		root["gamemode"] = static_cast<int>(eGameMode_NotSet);
 	}
 
-	Json::StyledWriter writer;
-	std::string JsonData = writer.write(root);
+	Json::FastWriter writer;
+	AString JsonData = writer.write(root);
 
-	AString SourceFile = GetUUIDFileName(m_UUID);
+	// Serialize the player stats.
+	// We use the default world name (like bukkit) because stats are shared between dimensions / worlds.
+	cStatSerializer StatSerializer(cRoot::Get()->GetDefaultWorld()->GetName(), GetName(), &m_Stats);
+	AString StatsData = StatSerializer.SaveToString();
 
-	cFile f;
-	if (!f.Open(SourceFile, cFile::fmWrite))
+	// Queue both files for the background writer, but only those that have changed since the last save:
+	cAsyncFileWriter & Writer = cRoot::Get()->GetFileWriter();
+	if (JsonData != m_LastSavedData)
 	{
-		LOGWARNING("Error writing player \"%s\" to file \"%s\" - cannot open file. Player will lose their progress.",
-			GetName().c_str(), SourceFile.c_str()
-		);
-		return false;
+		m_LastSavedData = JsonData;
+		Writer.Write(GetUUIDFileName(m_UUID), std::move(JsonData));
 	}
-	if (f.Write(JsonData.c_str(), JsonData.size()) != static_cast<int>(JsonData.size()))
+	if (StatsData != m_LastSavedStats)
 	{
-		LOGWARNING("Error writing player \"%s\" to file \"%s\" - cannot save data. Player will lose their progress. ",
-			GetName().c_str(), SourceFile.c_str()
-		);
-		return false;
-	}
-
-	// Save the player stats.
-	// We use the default world name (like bukkit) because stats are shared between dimensions / worlds.
-	cStatSerializer StatSerializer(cRoot::Get()->GetDefaultWorld()->GetName(), GetName(), &m_Stats);
-	if (!StatSerializer.Save())
-	{
-		LOGWARNING("Could not save stats for player %s", GetName().c_str());
-		return false;
+		m_LastSavedStats = StatsData;
+		Writer.Write(StatSerializer.GetFileName(), std::move(StatsData));
 	}
-
 	return true;
 }
 
@@ -2165,8 +2159,9 @@ void cPlayer::ApplyFoodExhaustionFromMovement()
 
 void cPlayer::LoadRank(void)
 {
-	// Load the values from cRankManager:
+	// Load the values from cRankManager; the version is read first, so that any change during the load means another load:
 	cRankManager * RankMgr = cRoot::Get()->GetRankManager();
+	m_RankDataVersion = RankMgr->GetDataVersion();
 	m_Rank = RankMgr->GetPlayerRankName(m_UUID);
 	if (m_Rank.empty())
 	{
@@ -2181,21 +2176,29 @@ void cPlayer::LoadRank(void)
 	m_Restrictions = RankMgr->GetPlayerRestrictions(m_UUID);
 	RankMgr->GetRankVisuals(m_Rank, m_MsgPrefix, m_MsgSuffix, m_MsgNameColorCode);
 
-	// Break up the individual permissions on each dot, into m_SplitPermissions:
-	m_SplitPermissions.clear();
-	m_SplitPermissions.reserve(m_Permissions.size());
-	for (auto & Permission: m_Permissions)
+	// Resolve the permissions and restrictions for the HasPermission() lookups:
+	m_PermissionTrie.Clear();
+	m_PermissionTrie.Add(m_Permissions);
+	m_RestrictionTrie.Clear();
+	m_RestrictionTrie.Add(m_Restrictions);
+
+	// The rank may have a different minimum view distance:
+	if (m_ClientHandle != nullptr)
 	{
-		m_SplitPermissions.push_back(StringSplit(Permission, "."));
-	}  // for Permission - m_Permissions[]
+		m_ClientHandle->UpdateViewDistance();
+	}
+}
+
 
-	// Break up the individual restrictions on each dot, into m_SplitRestrictions:
-	m_SplitRestrictions.clear();
-	m_SplitRestrictions.reserve(m_Restrictions.size());
-	for (auto & Restriction: m_Restrictions)
+
+
+
+void cPlayer::LoadRankIfChanged(void)
+{
+	if (m_RankDataVersion != cRoot::Get()->GetRankManager()->GetDataVersion())
 	{
-		m_SplitRestrictions.push_back(StringSplit(Restriction, "."));
-	}  // for itr - m_Restrictions[]
+		LoadRank();
+	}
 }
 
 
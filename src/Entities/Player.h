@@ -8,6 +8,7 @@
 #include "../ClientHandle.h"
 
 #include "../Statistics.h"
+#include "../PermissionTrie.h"
 
 
 
@@ -51,19 +52,19 @@ public:
 	virtual void HandlePhysics(std::chrono::milliseconds a_Dt, cChunk &) override { UNUSED(a_Dt); }
 
 	/** Returns the curently equipped weapon; empty item if none */
-	virtual cItem GetEquippedWeapon(void) const override { return m_Inventory.GetEquippedItem(); }
+	virtual const cItem & GetEquippedWeapon(void) const override { return m_Inventory.GetEquippedItem(); }
 	
 	/** Returns the currently equipped helmet; empty item if none */
-	virtual cItem GetEquippedHelmet(void) const override { return m_Inventory.GetEquippedHelmet(); }
+	virtual const cItem & GetEquippedHelmet(void) const override { return m_Inventory.GetEquippedHelmet(); }
 	
 	/** Returns the currently equipped chestplate; empty item if none */
-	virtual cItem GetEquippedChestplate(void) const override { return m_Inventory.GetEquippedChestplate(); }
+	virtual const cItem & GetEquippedChestplate(void) const override { return m_Inventory.GetEquippedChestplate(); }
 
 	/** Returns the currently equipped leggings; empty item if none */
-	virtual cItem GetEquippedLeggings(void) const override { return m_Inventory.GetEquippedLeggings(); }
+	virtual const cItem & GetEquippedLeggings(void) const override { return m_Inventory.GetEquippedLeggings(); }
 	
 	/** Returns the currently equipped boots; empty item if none */
-	virtual cItem GetEquippedBoots(void) const override { return m_Inventory.GetEquippedBoots(); }
+	virtual const cItem & GetEquippedBoots(void) const override { return m_Inventory.GetEquippedBoots(); }
 
 
 	// tolua_begin
@@ -254,6 +255,9 @@ public:
 	static bool PermissionMatches(const AStringVector & a_Permission, const AStringVector & a_Template);  // Exported in ManualBindings with AString params
 
 	/** Returns all the permissions that the player has assigned to them. */
+	/** Returns the name of the player's rank, as loaded from the cRankManager. */
+	const AString & GetRank(void) const { return m_Rank; }
+
 	const AStringVector & GetPermissions(void) const { return m_Permissions; }  // Exported in ManualBindings.cpp
 
 	/** Returns all the restrictions that the player has assigned to them. */
@@ -352,7 +356,8 @@ public:
 	Returns true if successful, false on failure (world not found). */
 	virtual bool DoMoveToWorld(cWorld * a_World, bool a_ShouldSendRespawn) override;
 
-	/** Saves all player data, such as inventory, to JSON */
+	/** Saves all player data, such as inventory, and the stats to JSON.
+	The files are written by the background writer (cRoot::GetFileWriter()), and only if they have changed since the last save. */
 	bool SaveToDisk(void);
 
 	typedef cWorld * cWorldPtr;
@@ -461,6 +466,9 @@ public:
 	Loads the m_Rank, m_Permissions, m_MsgPrefix, m_MsgSuffix and m_MsgNameColorCode members. */
 	void LoadRank(void);
 
+	/** Reloads the rank, if any rank, group or permission has changed in the cRankManager since the rank was loaded. */
+	void LoadRankIfChanged(void);
+
 	/** Calls the block-placement hook and places the block in the world, unless refused by the hook.
 	If the hook prevents the placement, sends the current block at the specified coords back to the client.
 	Assumes that the block is in a currently loaded chunk.
@@ -495,8 +503,6 @@ public:
 	
 protected:
 
-	typedef std::vector<std::vector<AString> > AStringVectorVector;
-
 	/** The name of the rank assigned to this player. */
 	AString m_Rank;
 
@@ -506,13 +512,15 @@ protected:
 	/** All the restrictions that this player has, based on their rank. */
 	AStringVector m_Restrictions;
 
-	/** All the permissions that this player has, based on their rank, split into individual dot-delimited parts.
-	This is used mainly by the HasPermission() function to optimize the lookup. */
-	AStringVectorVector m_SplitPermissions;
+	/** All the permissions that this player has, based on their rank, resolved for the HasPermission() lookups. */
+	cPermissionTrie m_PermissionTrie;
 
-	/** All the restrictions that this player has, based on their rank, split into individual dot-delimited parts.
-	This is used mainly by the HasPermission() function to optimize the lookup. */
-	AStringVectorVector m_SplitRestrictions;
+	/** All the restrictions that this player has, based on their rank, resolved for the HasPermission() lookups. */
+	cPermissionTrie m_RestrictionTrie;
+
+	/** The cRankManager::GetDataVersion() value that the rank has been loaded for.
+	The rank is reloaded once the rank manager's data changes. */
+	UInt32 m_RankDataVersion;
 
 
 	// Message visuals:
@@ -625,6 +633,10 @@ protected:
 	Default save interval is #defined in PLAYER_INVENTORY_SAVE_INTERVAL */
 	unsigned int m_TicksUntilNextSave;
 
+	/** The player data and the stats, as they were last queued for writing by SaveToDisk(), so that unchanged data isn't rewritten. */
+	AString m_LastSavedData;
+	AString m_LastSavedStats;
+
 	/** Flag used by food handling system to determine whether a teleport has just happened
 	Will not apply food penalties if found to be true; will set to false after processing
 	*/
@@ -359,9 +359,16 @@ void cProjectileEntity::HandlePhysics(std::chrono::milliseconds a_Dt, cChunk & a
 	const Vector3d Pos = GetPosition();
 	const Vector3d NextPos = Pos + DeltaSpeed;
 
-	// Test for entity collisions:
+	// Test for entity collisions, only the entities near the tick's worth of movement can be hit:
+	// The callback expands the entities' boxes by the projectile's size, so the swept box is expanded the same way
+	cBoundingBox SweptBox(
+		std::min(Pos.x, NextPos.x), std::max(Pos.x, NextPos.x),
+		std::min(Pos.y, NextPos.y), std::max(Pos.y, NextPos.y),
+		std::min(Pos.z, NextPos.z), std::max(Pos.z, NextPos.z)
+	);
+	SweptBox.Expand(GetWidth() / 2, GetHeight() / 2, GetWidth() / 2);
 	cProjectileEntityCollisionCallback EntityCollisionCallback(this, Pos, NextPos);
-	a_Chunk.ForEachEntity(EntityCollisionCallback);
+	m_World->ForEachEntityInBox(SweptBox, EntityCollisionCallback);
 	if (EntityCollisionCallback.HasHit())
 	{
 		// An entity was hit:
@@ -378,7 +385,6 @@ void cProjectileEntity::HandlePhysics(std::chrono::milliseconds a_Dt, cChunk & a
 
 		OnHitEntity(*(EntityCollisionCallback.GetHitEntity()), HitPos);
 	}
-	// TODO: Test the entities in the neighboring chunks, too
 	
 	// Trace the tick's worth of movement as a line:
 	cProjectileTracerCallback TracerCallback(this);
@@ -3,6 +3,15 @@
 #include "TNTEntity.h"
 #include "../World.h"
 #include "../ClientHandle.h"
+#include "../Chunk.h"
+#include "../BoundingBox.h"
+
+
+
+
+
+/** The maximum distance and speed difference of two primed TNTs to be merged. */
+static const double TNT_MERGE_EPS = 0.01;
 
 
 
@@ -10,7 +19,8 @@
 
 cTNTEntity::cTNTEntity(double a_X, double a_Y, double a_Z, int a_FuseTicks) :
 	super(etTNT, a_X, a_Y, a_Z, 0.98, 0.98),
-	m_FuseTicks(a_FuseTicks)
+	m_FuseTicks(a_FuseTicks),
+	m_Count(1)
 {
 	SetGravity(-16.0f);
 	SetAirDrag(0.02f);
@@ -22,7 +32,8 @@ cTNTEntity::cTNTEntity(double a_X, double a_Y, double a_Z, int a_FuseTicks) :
 
 cTNTEntity::cTNTEntity(const Vector3d & a_Pos, int a_FuseTicks) :
 	super(etTNT, a_Pos.x, a_Pos.y, a_Pos.z, 0.98, 0.98),
-	m_FuseTicks(a_FuseTicks)
+	m_FuseTicks(a_FuseTicks),
+	m_Count(1)
 {
 	SetGravity(-16.0f);
 	SetAirDrag(0.4f);
@@ -56,6 +67,14 @@ void cTNTEntity::Explode(void)
 
 void cTNTEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
+	if (IsDestroyed())
+	{
+		// Merged into another TNT entity earlier in this tick
+		return;
+	}
+	
+	MergeWithNeighbors(a_Chunk);
+	
 	super::Tick(a_Dt, a_Chunk);
 	BroadcastMovementUpdate();
 	
@@ -69,3 +88,48 @@ void cTNTEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 
 
 
+
+void cTNTEntity::MergeWithNeighbors(cChunk & a_Chunk)
+{
+	class cMergeCallback :
+		public cEntityCallback
+	{
+	public:
+		cMergeCallback(cTNTEntity & a_TNT) :
+			m_TNT(a_TNT)
+		{
+		}
+		
+		virtual bool Item(cEntity * a_Entity) override
+		{
+			if ((a_Entity == &m_TNT) || !a_Entity->IsTNT() || a_Entity->IsDestroyed())
+			{
+				return false;
+			}
+			cTNTEntity * Other = static_cast<cTNTEntity *>(a_Entity);
+			if (
+				(Other->m_FuseTicks != m_TNT.m_FuseTicks) ||
+				!Other->GetPosition().EqualsEps(m_TNT.GetPosition(), TNT_MERGE_EPS) ||
+				!Other->GetSpeed().EqualsEps(m_TNT.GetSpeed(), TNT_MERGE_EPS)
+			)
+			{
+				return false;
+			}
+			m_TNT.m_Count += Other->m_Count;
+			Other->m_Count = 0;
+			Other->Destroy(true);
+			return false;
+		}
+		
+	protected:
+		cTNTEntity & m_TNT;
+	} Callback(*this);
+	
+	Vector3d Eps(TNT_MERGE_EPS, TNT_MERGE_EPS, TNT_MERGE_EPS);
+	cBoundingBox Box(GetPosition() - Eps, GetPosition() + Eps);
+	a_Chunk.ForEachEntityInBox(Box, Callback);
+}
+
+
+
+
@@ -34,10 +34,21 @@ public:
 	/** Set the fuse ticks until the tnt will explode */
 	void SetFuseTicks(int a_FuseTicks) { m_FuseTicks = a_FuseTicks; }
 	
+	/** Returns the number of primed TNTs that this entity represents; co-located TNTs with the same fuse and speed are merged into a single entity. */
+	int GetCount(void) const { return m_Count; }
+	
 	// tolua_end
 	
 protected:
 	int m_FuseTicks;      ///< How much ticks is left, while the tnt will explode
+	
+	/** The number of primed TNTs merged into this entity, see GetCount(). */
+	int m_Count;
+	
+	/** Absorbs the other primed TNT entities in a_Chunk that are at the same position, with the same speed and the same fuse.
+	They would follow the same path and explode at the same time anyway, as a single entity they are simulated and sent
+	to the clients only once, and explode as one (see cWorld::DoExplosionAt()). */
+	void MergeWithNeighbors(cChunk & a_Chunk);
 };  // tolua_export
 
 
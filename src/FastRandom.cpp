@@ -132,6 +132,24 @@ int cFastRandom::GenerateRandomInteger(int a_Begin, int a_End)
 
 
 
+UInt32 cFastRandom::GetSeedCounter(void)
+{
+	return m_Counter;
+}
+
+
+
+
+
+void cFastRandom::SetSeedCounter(UInt32 a_Counter)
+{
+	m_Counter = a_Counter;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // MTRand:
 
@@ -46,6 +46,13 @@ public:
 	/** Returns a random int in the range [a_Begin .. a_End] */
 	int GenerateRandomInteger(int a_Begin, int a_End);
 
+	/** Returns the calling thread's counter that seeds the new cFastRandom and MTRand instances. */
+	static UInt32 GetSeedCounter(void);
+
+	/** Sets the calling thread's counter that seeds the new cFastRandom and MTRand instances.
+	Used by the tick replay so that the random numbers in the replayed ticks are the same as in the recorded ones. */
+	static void SetSeedCounter(UInt32 a_Counter);
+
 private:
 
 	std::minstd_rand m_LinearRand;
@@ -70,6 +77,9 @@ public:
 	/** Returns a random floating point number in the range [0 .. a_Range]. */
 	double rand(double a_Range);
 
+	/** Restarts the sequence from the specified seed. */
+	void Seed(UInt32 a_Seed) { m_MersenneRand.seed(a_Seed); }
+
 private:
 
 	std::mt19937 m_MersenneRand;
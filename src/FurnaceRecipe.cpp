@@ -5,6 +5,7 @@
 #include "Item.h"
 
 #include <fstream>
+#include <unordered_map>
 
 #define FURNACE_RECIPE_FILE "furnace.txt"
 
@@ -15,6 +16,10 @@
 typedef std::list<cFurnaceRecipe::cRecipe> RecipeList;
 typedef std::list<cFurnaceRecipe::cFuel> FuelList;
 
+/** Maps an input item type to all the recipes / fuels for that type, in the order in which they were loaded. */
+typedef std::unordered_map<short, std::vector<const cFurnaceRecipe::cRecipe *>> RecipeIndex;
+typedef std::unordered_map<short, std::vector<const cFurnaceRecipe::cFuel *>> FuelIndex;
+
 
 
 
@@ -23,6 +28,11 @@ struct cFurnaceRecipe::sFurnaceRecipeState
 {
 	RecipeList Recipes;
 	FuelList Fuel;
+
+	/** The recipes and fuels by their input item type, so that the lookups don't need to walk the whole lists.
+	Built when the recipes are loaded; the item damage doesn't take part in the matching. */
+	RecipeIndex RecipesByType;
+	FuelIndex FuelByType;
 };
 
 
@@ -102,6 +112,16 @@ void cFurnaceRecipe::ReloadRecipes(void)
 		}  // switch (ParsingLine[0])
 	}  // while (getline(ParsingLine))
 
+	// Index the recipes and fuels by the input item type:
+	for (const auto & Recipe: m_pState->Recipes)
+	{
+		m_pState->RecipesByType[Recipe.In->m_ItemType].push_back(&Recipe);
+	}
+	for (const auto & Fuel: m_pState->Fuel)
+	{
+		m_pState->FuelByType[Fuel.In->m_ItemType].push_back(&Fuel);
+	}
+
 	LOG("Loaded " SIZE_T_FMT " furnace recipes and " SIZE_T_FMT " fuels", m_pState->Recipes.size(), m_pState->Fuel.size());
 }
 
@@ -260,6 +280,8 @@ void cFurnaceRecipe::ClearRecipes(void)
 		Fuel.In = nullptr;
 	}
 	m_pState->Fuel.clear();
+	m_pState->RecipesByType.clear();
+	m_pState->FuelByType.clear();
 }
 
 
@@ -268,11 +290,16 @@ void cFurnaceRecipe::ClearRecipes(void)
 
 const cFurnaceRecipe::cRecipe * cFurnaceRecipe::GetRecipeFrom(const cItem & a_Ingredient) const
 {
+	auto itrType = m_pState->RecipesByType.find(a_Ingredient.m_ItemType);
+	if (itrType == m_pState->RecipesByType.end())
+	{
+		return nullptr;
+	}
 	const cRecipe * BestRecipe = 0;
-	for (RecipeList::const_iterator itr = m_pState->Recipes.begin(); itr != m_pState->Recipes.end(); ++itr)
+	for (auto itr = itrType->second.begin(); itr != itrType->second.end(); ++itr)
 	{
-		const cRecipe & Recipe = *itr;
-		if ((Recipe.In->m_ItemType == a_Ingredient.m_ItemType) && (Recipe.In->m_ItemCount <= a_Ingredient.m_ItemCount))
+		const cRecipe & Recipe = **itr;
+		if (Recipe.In->m_ItemCount <= a_Ingredient.m_ItemCount)
 		{
 			if (BestRecipe && (BestRecipe->In->m_ItemCount > Recipe.In->m_ItemCount))
 			{
@@ -293,9 +320,14 @@ const cFurnaceRecipe::cRecipe * cFurnaceRecipe::GetRecipeFrom(const cItem & a_In
 
 bool cFurnaceRecipe::IsFuel(const cItem & a_Item) const
 {
-	for (auto & Fuel : m_pState->Fuel)
+	auto itrType = m_pState->FuelByType.find(a_Item.m_ItemType);
+	if (itrType == m_pState->FuelByType.end())
 	{
-		if ((Fuel.In->m_ItemType == a_Item.m_ItemType) && (Fuel.In->m_ItemCount <= a_Item.m_ItemCount))
+		return false;
+	}
+	for (const auto & Fuel : itrType->second)
+	{
+		if (Fuel->In->m_ItemCount <= a_Item.m_ItemCount)
 		{
 			return true;
 		}
@@ -309,11 +341,16 @@ bool cFurnaceRecipe::IsFuel(const cItem & a_Item) const
 
 int cFurnaceRecipe::GetBurnTime(const cItem & a_Fuel) const
 {
+	auto itrType = m_pState->FuelByType.find(a_Fuel.m_ItemType);
+	if (itrType == m_pState->FuelByType.end())
+	{
+		return 0;
+	}
 	int BestFuel = 0;
-	for (FuelList::const_iterator itr = m_pState->Fuel.begin(); itr != m_pState->Fuel.end(); ++itr)
+	for (auto itr = itrType->second.begin(); itr != itrType->second.end(); ++itr)
 	{
-		const cFuel & Fuel = *itr;
-		if ((Fuel.In->m_ItemType == a_Fuel.m_ItemType) && (Fuel.In->m_ItemCount <= a_Fuel.m_ItemCount))
+		const cFuel & Fuel = **itr;
+		if (Fuel.In->m_ItemCount <= a_Fuel.m_ItemCount)
 		{
 			if (BestFuel > 0 && (BestFuel > Fuel.BurnTime))
 			{
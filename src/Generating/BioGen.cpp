@@ -52,17 +52,17 @@ void cBioGenConstant::InitializeBiomeGen(cIniFile & a_IniFile)
 cBioGenCache::cBioGenCache(cBiomeGenPtr a_BioGenToCache, int a_CacheSize) :
 	m_BioGenToCache(a_BioGenToCache),
 	m_CacheSize(a_CacheSize),
-	m_CacheOrder(new int[a_CacheSize]),
 	m_CacheData(new sCacheData[a_CacheSize]),
+	m_ClockHand(0),
 	m_NumHits(0),
 	m_NumMisses(0),
 	m_TotalChain(0)
 {
 	for (int i = 0; i < m_CacheSize; i++)
 	{
-		m_CacheOrder[i] = i;
 		m_CacheData[i].m_ChunkX = 0x7fffffff;
 		m_CacheData[i].m_ChunkZ = 0x7fffffff;
+		m_CacheData[i].m_IsReferenced = false;
 	}
 }
 
@@ -74,8 +74,18 @@ cBioGenCache::~cBioGenCache()
 {
 	delete[] m_CacheData;
 	m_CacheData = nullptr;
-	delete[] m_CacheOrder;
-	m_CacheOrder = nullptr;
+}
+
+
+
+
+
+bool cBioGenCache::AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const
+{
+	a_NumHits += static_cast<UInt64>(m_NumHits);
+	a_NumMisses += static_cast<UInt64>(m_NumMisses);
+	a_NumBytes += static_cast<UInt64>(m_CacheSize) * sizeof(sCacheData);
+	return true;
 }
 
 
@@ -92,45 +102,47 @@ void cBioGenCache::GenBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef::BiomeMap & a
 
 	for (int i = 0; i < m_CacheSize; i++)
 	{
-		if (
-			(m_CacheData[m_CacheOrder[i]].m_ChunkX != a_ChunkX) ||
-			(m_CacheData[m_CacheOrder[i]].m_ChunkZ != a_ChunkZ)
-		)
+		if ((m_CacheData[i].m_ChunkX != a_ChunkX) || (m_CacheData[i].m_ChunkZ != a_ChunkZ))
 		{
 			continue;
 		}
-		// Found it in the cache
-		int Idx = m_CacheOrder[i];
-		
-		// Move to front:
-		for (int j = i; j > 0; j--)
-		{
-			m_CacheOrder[j] = m_CacheOrder[j - 1];
-		}
-		m_CacheOrder[0] = Idx;
-		
-		// Use the cached data:
-		memcpy(a_BiomeMap, m_CacheData[Idx].m_BiomeMap, sizeof(a_BiomeMap));
-		
+		// Found it in the cache, use the cached data:
+		m_CacheData[i].m_IsReferenced = true;
+		memcpy(a_BiomeMap, m_CacheData[i].m_BiomeMap, sizeof(a_BiomeMap));
 		m_NumHits++;
 		m_TotalChain += i;
 		return;
 	}  // for i - cache
-	
-	// Not in the cache:
 	m_NumMisses++;
+	
+	// Not in the cache, generate:
 	m_BioGenToCache->GenBiomes(a_ChunkX, a_ChunkZ, a_BiomeMap);
 	
-	// Insert it as the first item in the MRU order:
-	int Idx = m_CacheOrder[m_CacheSize - 1];
-	for (int i = m_CacheSize - 1; i > 0; i--)
-	{
-		m_CacheOrder[i] = m_CacheOrder[i - 1];
-	}  // for i - m_CacheOrder[]
-	m_CacheOrder[0] = Idx;
+	// Replace an item not referenced recently:
+	int Idx = GetReplacementIdx();
 	memcpy(m_CacheData[Idx].m_BiomeMap, a_BiomeMap, sizeof(a_BiomeMap));
 	m_CacheData[Idx].m_ChunkX = a_ChunkX;
 	m_CacheData[Idx].m_ChunkZ = a_ChunkZ;
+	m_CacheData[Idx].m_IsReferenced = false;
+}
+
+
+
+
+
+int cBioGenCache::GetReplacementIdx(void)
+{
+	// Give each referenced item a second chance; terminates at the latest after a full round of clearing the flags:
+	for (;;)
+	{
+		int Idx = m_ClockHand;
+		m_ClockHand = (m_ClockHand + 1) % m_CacheSize;
+		if (!m_CacheData[Idx].m_IsReferenced)
+		{
+			return Idx;
+		}
+		m_CacheData[Idx].m_IsReferenced = false;
+	}
 }
 
 
@@ -175,6 +187,19 @@ void cBioGenMulticache::GenBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef::BiomeMa
 
 
 
+bool cBioGenMulticache::AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const
+{
+	for (const auto & Cache: m_Caches)
+	{
+		Cache->AddCacheStats(a_NumHits, a_NumMisses, a_NumBytes);
+	}
+	return true;
+}
+
+
+
+
+
 void cBioGenMulticache::InitializeBiomeGen(cIniFile & a_IniFile)
 {
 	for (auto itr : m_Caches)
@@ -41,7 +41,11 @@ protected:
 
 
 
-/// A simple cache that stores N most recently generated chunks' biomes; N being settable upon creation
+/** A simple cache that stores N recently generated chunks' biomes; N being settable upon creation.
+The items to replace are chosen using the CLOCK algorithm, so that a hit only sets a flag instead of reordering the cache.
+The cache is not thread-safe and needs no locking: each generator worker owns its own cGenerator and therefore its own caches,
+and the cChunkGenerator serializes the access to its shared generator instance (see cChunkGenerator::m_CSSharedGenerator).
+The only caches shared between the workers are cSharedStructureCache and cStructureLayoutCache, which have their own locks. */
 class cBioGenCache :
 	public cBiomeGen
 {
@@ -51,6 +55,9 @@ public:
 	cBioGenCache(cBiomeGenPtr a_BioGenToCache, int a_CacheSize);
 	virtual ~cBioGenCache();
 	
+	// cBiomeGen override:
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const override;
+	
 protected:
 
 	cBiomeGenPtr m_BioGenToCache;
@@ -59,19 +66,24 @@ protected:
 	{
 		int m_ChunkX;
 		int m_ChunkZ;
+		bool m_IsReferenced;  // Set on each hit, cleared when the clock hand passes the item; items not referenced get replaced
 		cChunkDef::BiomeMap m_BiomeMap;
 	} ;
 	
-	// To avoid moving large amounts of data for the MRU behavior, we MRU-ize indices to an array of the actual data
 	int          m_CacheSize;
-	int *        m_CacheOrder;  // MRU-ized order, indices into m_CacheData array
-	sCacheData * m_CacheData;   // m_CacheData[m_CacheOrder[0]] is the most recently used
+	sCacheData * m_CacheData;
+	
+	/** The index of the next item to be considered for replacement. */
+	int          m_ClockHand;
 	
 	// Cache statistics
 	int m_NumHits;
 	int m_NumMisses;
 	int m_TotalChain;  // Number of cache items walked to get to a hit (only added for hits)
 	
+	/** Returns the index of the item to be replaced by a new one, and advances the clock hand past it. */
+	int GetReplacementIdx(void);
+	
 	virtual void GenBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef::BiomeMap & a_BiomeMap) override;
 	virtual void InitializeBiomeGen(cIniFile & a_IniFile) override;
 } ;
@@ -89,10 +101,14 @@ class cBioGenMulticache :
 public:
 	/* Creates a new multicache - a cache that divides the caching into several sub-caches based on the chunk coords.
 	This allows us to use shorter cache depths with faster lookups for more covered area. (#381)
+	Like cBioGenCache, the multicache is used by a single thread at a time and needs no locking.
 	a_SubCacheSize defines the size of each sub-cache
 	a_NumSubCaches defines how many sub-caches are used for the multicache. */
 	cBioGenMulticache(cBiomeGenPtr a_BioGenToCache, size_t a_SubCacheSize, size_t a_NumSubCaches);
 
+	// cBiomeGen override:
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const override;
+
 protected:
 	typedef std::vector<cBiomeGenPtr> cBiomeGenPtrs;
 
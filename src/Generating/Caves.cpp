@@ -15,7 +15,8 @@ For each nest, first the schematic structure is generated (tunnel from ... to ..
 Then each tunnel is randomized by inserting points in between its ends.
 Finally each tunnel is smoothed and Bresenham-3D-ed so that it is a collection of spheres with their centers next to each other.
 When the tunnels are ready, they are simply carved into the chunk, one by one.
-To optimize, each tunnel keeps track of its bounding box, so that it can be skipped for chunks that don't intersect it.
+To optimize, each tunnel keeps track of its bounding box, so that it can be skipped for chunks that don't intersect it,
+and each sphere only visits the columns within its reach. The nests are shared by all the generator threads (cSharedStructureCache).
 
 MarbleCaves generator:
 For each voxel a 3D noise function is evaluated, if the value crosses a boundary, the voxel is dug out, otherwise it is kept.
@@ -102,7 +103,7 @@ public:
 		cChunkDef::BlockTypes & a_BlockTypes,
 		cChunkDesc::BlockNibbleBytes & a_BlockMetas,
 		cChunkDef::HeightMap & a_HeightMap
-	);
+	) const;
 
 	#ifdef _DEBUG
 	AString ExportAsSVG(int a_Color, int a_OffsetX, int a_OffsetZ) const;
@@ -458,7 +459,7 @@ void cCaveTunnel::ProcessChunk(
 	cChunkDef::BlockTypes & a_BlockTypes,
 	cChunkDesc::BlockNibbleBytes & a_BlockMetas,
 	cChunkDef::HeightMap & a_HeightMap
-)
+) const
 {
 	int BaseX = a_ChunkX * cChunkDef::Width;
 	int BaseZ = a_ChunkZ * cChunkDef::Width;
@@ -493,13 +494,26 @@ void cCaveTunnel::ProcessChunk(
 		int DifY = itr->m_BlockY;
 		int DifZ = itr->m_BlockZ - BlockStartZ;  // substitution for faster calc
 		int Bottom = std::max(itr->m_BlockY - 3 * itr->m_Radius / 7, 1);
-		int Top    = std::min(itr->m_BlockY + 3 * itr->m_Radius / 7, (int)(cChunkDef::Height));
+		int Top    = std::min(itr->m_BlockY + 3 * itr->m_Radius / 7, cChunkDef::Height - 1);
 		int SqRad  = itr->m_Radius * itr->m_Radius;
-		for (int z = 0; z < cChunkDef::Width; z++) for (int x = 0; x < cChunkDef::Width; x++)
+
+		// Only the columns within the sandstone shell's reach (sqrt(2) * radius) can be affected, visit only those:
+		int Reach = itr->m_Radius + itr->m_Radius / 2 + 1;
+		int MinX = std::max(DifX - Reach, 0);
+		int MaxX = std::min(DifX + Reach, cChunkDef::Width - 1);
+		int MinZ = std::max(DifZ - Reach, 0);
+		int MaxZ = std::min(DifZ + Reach, cChunkDef::Width - 1);
+		for (int z = MinZ; z <= MaxZ; z++) for (int x = MinX; x <= MaxX; x++)
 		{
+			int SqDistXZ = (DifX - x) * (DifX - x) + (DifZ - z) * (DifZ - z);
+			if (SqDistXZ > SqRad * 2)
+			{
+				// The whole column is outside the shell
+				continue;
+			}
 			for (int y = Bottom; y <= Top; y++)
 			{
-				int SqDist = (DifX - x) * (DifX - x) + (DifY - y) * (DifY - y) + (DifZ - z) * (DifZ - z);
+				int SqDist = SqDistXZ + (DifY - y) * (DifY - y);
 				if (4 * SqDist <= SqRad)
 				{
 					if (cBlockInfo::CanBeTerraformed(cChunkDef::GetBlock(a_BlockTypes, x, y, z)))
@@ -701,6 +715,17 @@ cGridStructGen::cStructurePtr cStructGenWormNestCaves::CreateStructure(int a_Gri
 
 
 
+UInt32 cStructGenWormNestCaves::GetLayoutSignature(void) const
+{
+	UInt32 Signature = super::GetLayoutSignature();
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_Size);
+	return Signature;
+}
+
+
+
+
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // cStructGenMarbleCaves:
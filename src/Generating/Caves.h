@@ -74,6 +74,8 @@ public:
 		m_MaxOffset(a_MaxOffset),
 		m_Grid(a_Grid)
 	{
+		// The cave systems are only read while carving, so all the generator threads can share them:
+		UseSharedCache("WormNestCaves");
 	}
 	
 protected:
@@ -84,8 +86,9 @@ protected:
 	int          m_MaxOffset;  // maximum offset of the cave nest origin from the grid cell the nest belongs to
 	int          m_Grid;  // average spacing of the nests
 
-	// cGridStructGen override:
+	// cGridStructGen overrides:
 	virtual cStructurePtr CreateStructure(int a_GridX, int a_GridZ, int a_OriginX, int a_OriginZ) override;
+	virtual UInt32 GetLayoutSignature(void) const override;
 } ;
 
 
@@ -51,22 +51,36 @@ public:
 	int GetChunkZ(void) const { return m_ChunkZ; }
 	
 	void       FillBlocks(BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
-	void       SetBlockTypeMeta(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
-	void       GetBlockTypeMeta(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta);
 
-	void       SetBlockType(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType);
-	BLOCKTYPE  GetBlockType(int a_RelX, int a_RelY, int a_RelZ);
+	// The per-block accessors are called by the finishers for nearly every block, so they are inline and access the arrays directly.
+	// The coords are checked only by ASSERTs, same as in cBlockArea.
+	void       SetBlockTypeMeta(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+	{
+		int Index = MakeIndex(a_RelX, a_RelY, a_RelZ);
+		GetBlockTypes()[Index] = a_BlockType;
+		GetBlockMetasUncompressed()[Index] = a_BlockMeta;
+	}
+
+	void       GetBlockTypeMeta(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta)
+	{
+		int Index = MakeIndex(a_RelX, a_RelY, a_RelZ);
+		a_BlockType = GetBlockTypes()[Index];
+		a_BlockMeta = GetBlockMetasUncompressed()[Index];
+	}
+
+	void       SetBlockType(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType) { GetBlockTypes()[MakeIndex(a_RelX, a_RelY, a_RelZ)] = a_BlockType; }
+	BLOCKTYPE  GetBlockType(int a_RelX, int a_RelY, int a_RelZ) { return GetBlockTypes()[MakeIndex(a_RelX, a_RelY, a_RelZ)]; }
 	
-	void       SetBlockMeta(int a_RelX, int a_RelY, int a_RelZ, NIBBLETYPE a_BlockMeta);
-	NIBBLETYPE GetBlockMeta(int a_RelX, int a_RelY, int a_RelZ);
+	void       SetBlockMeta(int a_RelX, int a_RelY, int a_RelZ, NIBBLETYPE a_BlockMeta) { GetBlockMetasUncompressed()[MakeIndex(a_RelX, a_RelY, a_RelZ)] = a_BlockMeta; }
+	NIBBLETYPE GetBlockMeta(int a_RelX, int a_RelY, int a_RelZ) { return GetBlockMetasUncompressed()[MakeIndex(a_RelX, a_RelY, a_RelZ)]; }
 
-	void       SetBiome(int a_RelX, int a_RelZ, EMCSBiome a_BiomeID);
-	EMCSBiome  GetBiome(int a_RelX, int a_RelZ);
+	void       SetBiome(int a_RelX, int a_RelZ, EMCSBiome a_BiomeID) { cChunkDef::SetBiome(m_BiomeMap, a_RelX, a_RelZ, a_BiomeID); }
+	EMCSBiome  GetBiome(int a_RelX, int a_RelZ) { return cChunkDef::GetBiome(m_BiomeMap, a_RelX, a_RelZ); }
 
 	// These operate on the heightmap, so they could get out of sync with the data
 	// Use UpdateHeightmap() to re-calculate heightmap from the block data
-	void       SetHeight(int a_RelX, int a_RelZ, int a_Height);
-	int        GetHeight(int a_RelX, int a_RelZ);
+	void       SetHeight(int a_RelX, int a_RelZ, int a_Height) { cChunkDef::SetHeight(m_HeightMap, a_RelX, a_RelZ, static_cast<HEIGHTTYPE>(a_Height)); }
+	int        GetHeight(int a_RelX, int a_RelZ) { return cChunkDef::GetHeight(m_HeightMap, a_RelX, a_RelZ); }
 
 	// tolua_end
 
@@ -221,6 +235,15 @@ public:
 	#endif  // _DEBUG
 	
 private:
+	/** Returns the index into the block arrays for the specified relative coords, checked only by ASSERTs. */
+	static int MakeIndex(int a_RelX, int a_RelY, int a_RelZ)
+	{
+		ASSERT((a_RelX >= 0) && (a_RelX < cChunkDef::Width));
+		ASSERT((a_RelY >= 0) && (a_RelY < cChunkDef::Height));
+		ASSERT((a_RelZ >= 0) && (a_RelZ < cChunkDef::Width));
+		return cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY, a_RelZ);
+	}
+
 	int m_ChunkX;
 	int m_ChunkZ;
 	
@@ -18,6 +18,19 @@ const unsigned int QUEUE_WARNING_LIMIT = 1000;
 /// If the generation queue size exceeds this number, chunks with no clients will be skipped
 const unsigned int QUEUE_SKIP_LIMIT = 500;
 
+/// How often the priorities of the queued chunks are refreshed, since the players move
+static const std::chrono::milliseconds PRIORITIES_UPDATE_INTERVAL(500);
+
+
+
+
+
+/** Returns the key of the chunk in cChunkGenerator's queue index. */
+static Int64 MakeQueueKey(int a_ChunkX, int a_ChunkZ)
+{
+	return (static_cast<Int64>(a_ChunkX) << 32) | static_cast<UInt32>(a_ChunkZ);
+}
+
 
 
 
@@ -26,9 +39,12 @@ const unsigned int QUEUE_SKIP_LIMIT = 500;
 // cChunkGenerator:
 
 cChunkGenerator::cChunkGenerator(void) :
-	super("cChunkGenerator"),
 	m_Seed(0),  // Will be overwritten by the actual generator
+	m_NextSequenceNum(0),
+	m_IsUpdatingPriorities(false),
+	m_ShouldTerminate(false),
 	m_Generator(nullptr),
+	m_NumChunksGenerated(0),
 	m_PluginInterface(nullptr),
 	m_ChunkSink(nullptr)
 {
@@ -66,29 +82,45 @@ bool cChunkGenerator::Start(cPluginInterface & a_PluginInterface, cChunkSink & a
 	}
 	
 	// Get the generator engine based on the INI file settings:
-	AString GeneratorName = a_IniFile.GetValueSet("Generator", "Generator", "Composable");
-	if (NoCaseCompare(GeneratorName, "Noise3D") == 0)
+	m_GeneratorName = a_IniFile.GetValueSet("Generator", "Generator", "Composable");
+	if ((NoCaseCompare(m_GeneratorName, "Noise3D") != 0) && (NoCaseCompare(m_GeneratorName, "composable") != 0))
 	{
-		m_Generator = new cNoise3DGenerator(*this);
+		LOGWARN("[Generator]::Generator value \"%s\" not recognized, using \"Composable\".", m_GeneratorName.c_str());
+		m_GeneratorName = "Composable";
 	}
-	else
-	{
-		if (NoCaseCompare(GeneratorName, "composable") != 0)
-		{
-			LOGWARN("[Generator]::Generator value \"%s\" not recognized, using \"Composable\".", GeneratorName.c_str());
-		}
-		m_Generator = new cComposableGenerator(*this);
-	}
-
+	m_Generator = CreateGenerator(a_IniFile);
 	if (m_Generator == nullptr)
 	{
 		LOGERROR("Generator could not start, aborting the server");
 		return false;
 	}
 
-	m_Generator->Initialize(a_IniFile);
-
-	return super::Start();
+	// Create the worker threads, each with its own generator instance:
+	int NumThreads = a_IniFile.GetValueSetI("Generator", "NumThreads", 0);
+	if (NumThreads <= 0)
+	{
+		NumThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+	m_ShouldTerminate = false;
+	for (int i = 0; i < NumThreads; i++)
+	{
+		cGenerator * Generator = CreateGenerator(a_IniFile);
+		if (Generator == nullptr)
+		{
+			LOGERROR("Generator could not start, aborting the server");
+			return false;
+		}
+		m_Workers.push_back(std::unique_ptr<cWorker>(new cWorker(*this, Generator)));
+	}
+	for (auto & Worker : m_Workers)
+	{
+		if (!Worker->Start())
+		{
+			return false;
+		}
+	}
+	LOGD("Chunk generator started with %d worker threads", NumThreads);
+	return true;
 }
 
 
@@ -97,10 +129,17 @@ bool cChunkGenerator::Start(cPluginInterface & a_PluginInterface, cChunkSink & a
 
 void cChunkGenerator::Stop(void)
 {
-	m_ShouldTerminate = true;
-	m_Event.Set();
+	{
+		cCSLock Lock(m_CS);
+		m_ShouldTerminate = true;
+	}
+	for (auto & Worker : m_Workers)
+	{
+		Worker->SignalTerminate();
+	}
+	m_Event.Set();  // Each worker passes the wakeup on to the next one when terminating
 	m_evtRemoved.Set();  // Wake up anybody waiting for empty queue
-	Wait();
+	m_Workers.clear();  // Waits for the threads to finish
 
 	delete m_Generator;
 	m_Generator = nullptr;
@@ -114,15 +153,48 @@ void cChunkGenerator::QueueGenerateChunk(int a_ChunkX, int a_ChunkZ, bool a_Forc
 {
 	ASSERT(m_ChunkSink->IsChunkQueued(a_ChunkX, a_ChunkZ));
 
+	// Ask for the priority before locking, the chunksink mustn't be called with m_CS held:
+	int Priority = m_ChunkSink->GetChunkPriority(a_ChunkX, a_ChunkZ);
+
 	{
 		cCSLock Lock(m_CS);
 
-		// Add to queue, issue a warning if too many:
-		if (m_Queue.size() >= QUEUE_WARNING_LIMIT)
+		// If a worker is already processing the chunk, merge the requests into it:
+		auto InProgress = m_InProgress.find(MakeQueueKey(a_ChunkX, a_ChunkZ));
+		if (InProgress != m_InProgress.end())
+		{
+			InProgress->second.m_ForceGenerate = InProgress->second.m_ForceGenerate || a_ForceGenerate;
+			if (a_Callback != nullptr)
+			{
+				InProgress->second.m_Callbacks.push_back(a_Callback);
+			}
+			return;
+		}
+
+		// If the chunk is already queued, merge the requests:
+		auto itr = m_QueueIndex.find(MakeQueueKey(a_ChunkX, a_ChunkZ));
+		if (itr != m_QueueIndex.end())
+		{
+			cQueueItem & Item = m_Queue[itr->second];
+			Item.m_ForceGenerate = Item.m_ForceGenerate || a_ForceGenerate;
+			if (a_Callback != nullptr)
+			{
+				Item.m_Callbacks.push_back(a_Callback);
+			}
+			Item.m_Priority = Priority;
+			return;
+		}
+
+		cQueueItem Item;
+		Item.m_ChunkX = a_ChunkX;
+		Item.m_ChunkZ = a_ChunkZ;
+		Item.m_ForceGenerate = a_ForceGenerate;
+		if (a_Callback != nullptr)
 		{
-			LOGWARN("WARNING: Adding chunk [%i, %i] to generation queue; Queue is too big! (" SIZE_T_FMT ")", a_ChunkX, a_ChunkZ, m_Queue.size());
+			Item.m_Callbacks.push_back(a_Callback);
 		}
-		m_Queue.push_back(cQueueItem{a_ChunkX, a_ChunkZ, a_ForceGenerate, a_Callback});
+		Item.m_Priority = Priority;
+		AddToQueue(std::move(Item));
 	}
 
 	m_Event.Set();
@@ -132,10 +204,38 @@ void cChunkGenerator::QueueGenerateChunk(int a_ChunkX, int a_ChunkZ, bool a_Forc
 
 
 
+void cChunkGenerator::AddToQueue(cQueueItem && a_Item)
+{
+	ASSERT(m_QueueIndex.find(MakeQueueKey(a_Item.m_ChunkX, a_Item.m_ChunkZ)) == m_QueueIndex.end());
+	ASSERT(m_InProgress.find(MakeQueueKey(a_Item.m_ChunkX, a_Item.m_ChunkZ)) == m_InProgress.end());
+
+	// Issue a warning if too many:
+	if (m_Queue.size() >= QUEUE_WARNING_LIMIT)
+	{
+		LOGWARN("WARNING: Adding chunk [%i, %i] to generation queue; Queue is too big! (" SIZE_T_FMT ")", a_Item.m_ChunkX, a_Item.m_ChunkZ, m_Queue.size());
+	}
+
+	// If the queue starts filling up, restart the performance measurement, so that waiting for the queue is not counted into the total time:
+	if (m_Queue.empty() && m_InProgress.empty())
+	{
+		m_NumChunksGenerated = 0;
+		m_GenerationStart = std::chrono::steady_clock::now();
+		m_LastReportTime = m_GenerationStart;
+	}
+	a_Item.m_SequenceNum = m_NextSequenceNum++;
+	m_QueueIndex[MakeQueueKey(a_Item.m_ChunkX, a_Item.m_ChunkZ)] = m_Queue.size();
+	m_Queue.push_back(std::move(a_Item));
+}
+
+
+
+
+
 void cChunkGenerator::GenerateBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef::BiomeMap & a_BiomeMap)
 {
 	if (m_Generator != nullptr)
 	{
+		cCSLock Lock(m_CSSharedGenerator);
 		m_Generator->GenerateBiomes(a_ChunkX, a_ChunkZ, a_BiomeMap);
 	}
 }
@@ -171,6 +271,7 @@ int cChunkGenerator::GetQueueLength(void)
 EMCSBiome cChunkGenerator::GetBiomeAt(int a_BlockX, int a_BlockZ)
 {
 	ASSERT(m_Generator != nullptr);
+	cCSLock Lock(m_CSSharedGenerator);
 	return m_Generator->GetBiomeAt(a_BlockX, a_BlockZ);
 }
 
@@ -178,6 +279,18 @@ EMCSBiome cChunkGenerator::GetBiomeAt(int a_BlockX, int a_BlockZ)
 
 
 
+void cChunkGenerator::GetStats(cStats & a_Stats)
+{
+	for (auto & Worker : m_Workers)
+	{
+		Worker->GetGenerator().AddStats(a_Stats);
+	}
+}
+
+
+
+
+
 BLOCKTYPE cChunkGenerator::GetIniBlock(cIniFile & a_IniFile, const AString & a_SectionName, const AString & a_ValueName, const AString & a_Default)
 {
 	AString BlockType = a_IniFile.GetValueSet(a_SectionName, a_ValueName, a_Default);
@@ -194,97 +307,263 @@ BLOCKTYPE cChunkGenerator::GetIniBlock(cIniFile & a_IniFile, const AString & a_S
 
 
 
-void cChunkGenerator::Execute(void)
+cChunkGenerator::cGenerator * cChunkGenerator::CreateGenerator(cIniFile & a_IniFile)
 {
-	// To be able to display performance information, the generator counts the chunks generated.
-	// When the queue gets empty, the count is reset, so that waiting for the queue is not counted into the total time.
-	int NumChunksGenerated = 0;  // Number of chunks generated since the queue was last empty
-	clock_t GenerationStart = clock();  // Clock tick when the queue started to fill
-	clock_t LastReportTick = clock();  // Clock tick of the last report made (so that performance isn't reported too often)
+	cGenerator * res;
+	if (NoCaseCompare(m_GeneratorName, "Noise3D") == 0)
+	{
+		res = new cNoise3DGenerator(*this);
+	}
+	else
+	{
+		res = new cComposableGenerator(*this);
+	}
+	res->Initialize(a_IniFile);
+	return res;
+}
 
-	while (!m_ShouldTerminate)
+
+
+
+
+void cChunkGenerator::ProcessQueue(cGenerator & a_Generator)
+{
+	for (;;)
 	{
 		cCSLock Lock(m_CS);
-		while (m_Queue.empty())
+		while (m_Queue.empty() && !m_ShouldTerminate)
 		{
-			if ((NumChunksGenerated > 16) && (clock() - LastReportTick > CLOCKS_PER_SEC))
+			if ((m_NumChunksGenerated > 16) && (std::chrono::steady_clock::now() - m_LastReportTime > std::chrono::seconds(1)))
 			{
-				LOG("Chunk generator performance: %.2f ch / sec (%d ch total)",
-					(double)NumChunksGenerated * CLOCKS_PER_SEC/ (clock() - GenerationStart),
-					NumChunksGenerated
-				);
+				ReportPerformance();
 			}
 			cCSUnlock Unlock(Lock);
 			m_Event.Wait();
-			if (m_ShouldTerminate)
-			{
-				return;
-			}
-			NumChunksGenerated = 0;
-			GenerationStart = clock();
-			LastReportTick = clock();
+		}
+		if (m_ShouldTerminate)
+		{
+			Lock.Unlock();
+			m_Event.Set();  // Wake up the next worker so that it terminates, too
+			return;
 		}
 
-		if (m_Queue.empty())
+		// The players may have moved since the priorities were last asked for:
+		if (
+			!m_IsUpdatingPriorities &&
+			(m_Queue.size() > 1) &&
+			(std::chrono::steady_clock::now() - m_LastPrioritiesUpdate > PRIORITIES_UPDATE_INTERVAL)
+		)
 		{
-			// Sometimes the queue remains empty
-			// If so, we can't do any front() operations on it!
-			continue;
+			UpdatePriorities(Lock);
+			if (m_Queue.empty() || m_ShouldTerminate)
+			{
+				// Other workers have processed the queue in the meantime, start over
+				continue;
+			}
 		}
 
-		cQueueItem item = m_Queue.front();  // Get next chunk from the queue
+		cQueueItem item;
 		bool SkipEnabled = (m_Queue.size() > QUEUE_SKIP_LIMIT);
-		m_Queue.erase(m_Queue.begin());  // Remove the item from the queue
-		Lock.Unlock();  // Unlock ASAP
-		m_evtRemoved.Set();
+		PopBestItem(item);  // Get next chunk from the queue
+		m_InProgress[MakeQueueKey(item.m_ChunkX, item.m_ChunkZ)] = cInProgressItem();
+		bool HasMoreItems = !m_Queue.empty();
 
 		// Display perf info once in a while:
-		if ((NumChunksGenerated > 16) && (clock() - LastReportTick > 2 * CLOCKS_PER_SEC))
+		if ((m_NumChunksGenerated > 16) && (std::chrono::steady_clock::now() - m_LastReportTime > std::chrono::seconds(2)))
+		{
+			ReportPerformance();
+		}
+		Lock.Unlock();  // Unlock ASAP
+		m_evtRemoved.Set();
+		if (HasMoreItems)
 		{
-			LOG("Chunk generator performance: %.2f ch / sec (%d ch total)",
-				(double)NumChunksGenerated * CLOCKS_PER_SEC / (clock() - GenerationStart),
-				NumChunksGenerated
-			);
-			LastReportTick = clock();
+			// Wake up another worker to process the rest of the queue:
+			m_Event.Set();
 		}
 
 		// Skip the chunk if it's already generated and regeneration is not forced:
 		if (!item.m_ForceGenerate && m_ChunkSink->IsChunkValid(item.m_ChunkX, item.m_ChunkZ))
 		{
 			LOGD("Chunk [%d, %d] already generated, skipping generation", item.m_ChunkX, item.m_ChunkZ);
-			if (item.m_Callback != nullptr)
-			{
-				item.m_Callback->Call(item.m_ChunkX, item.m_ChunkZ);
-			}
+			FinishItem(item, irAlreadyValid);
 			continue;
 		}
 
-		// Skip the chunk if the generator is overloaded:
-		if (SkipEnabled && !m_ChunkSink->HasChunkAnyClients(item.m_ChunkX, item.m_ChunkZ))
+		// Skip the chunk if the generator is overloaded and nobody needs the chunk anymore:
+		if (SkipEnabled && (m_ChunkSink->GetChunkPriority(item.m_ChunkX, item.m_ChunkZ) < 0))
 		{
 			LOGWARNING("Chunk generator overloaded, skipping chunk [%d, %d]", item.m_ChunkX, item.m_ChunkZ);
-			if (item.m_Callback != nullptr)
-			{
-				item.m_Callback->Call(item.m_ChunkX, item.m_ChunkZ);
-			}
+			m_ChunkSink->OnChunkSkipped(item.m_ChunkX, item.m_ChunkZ);
+			FinishItem(item, irSkipped);
 			continue;
 		}
 
 		// Generate the chunk:
 		LOGD("Generating chunk [%d, %d]", item.m_ChunkX, item.m_ChunkZ);
-		DoGenerate(item.m_ChunkX, item.m_ChunkZ);
-		if (item.m_Callback != nullptr)
+		DoGenerate(a_Generator, item.m_ChunkX, item.m_ChunkZ);
+		FinishItem(item, irGenerated);
+	}  // for (;;)
+}
+
+
+
+
+
+void cChunkGenerator::UpdatePriorities(cCSLock & a_Lock)
+{
+	m_IsUpdatingPriorities = true;
+	m_LastPrioritiesUpdate = std::chrono::steady_clock::now();
+	cChunkCoordsVector Chunks;
+	Chunks.reserve(m_Queue.size());
+	for (const auto & Item : m_Queue)
+	{
+		Chunks.emplace_back(Item.m_ChunkX, Item.m_ChunkZ);
+	}
+
+	// Ask the chunksink without the lock, so that the other workers and the world can use the queue meanwhile:
+	std::vector<int> Priorities;
+	Priorities.reserve(Chunks.size());
+	{
+		cCSUnlock Unlock(a_Lock);
+		for (const auto & Chunk : Chunks)
+		{
+			Priorities.push_back(m_ChunkSink->GetChunkPriority(Chunk.m_ChunkX, Chunk.m_ChunkZ));
+		}
+	}
+
+	// Store the priorities in the items that are still queued:
+	for (size_t i = 0; i < Chunks.size(); i++)
+	{
+		auto itr = m_QueueIndex.find(MakeQueueKey(Chunks[i].m_ChunkX, Chunks[i].m_ChunkZ));
+		if (itr != m_QueueIndex.end())
 		{
-			item.m_Callback->Call(item.m_ChunkX, item.m_ChunkZ);
+			m_Queue[itr->second].m_Priority = Priorities[i];
 		}
-		NumChunksGenerated++;
-	}  // while (!bStop)
+	}
+	m_IsUpdatingPriorities = false;
 }
 
 
 
 
-void cChunkGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ)
+
+void cChunkGenerator::PopBestItem(cQueueItem & a_Item)
+{
+	ASSERT(!m_Queue.empty());
+
+	// The chunks that nobody needs go last, otherwise lower priority first, then FIFO:
+	size_t Best = 0;
+	for (size_t i = 1; i < m_Queue.size(); i++)
+	{
+		const cQueueItem & Item = m_Queue[i];
+		const cQueueItem & BestItem = m_Queue[Best];
+		bool IsNeeded = (Item.m_Priority >= 0);
+		bool IsBestNeeded = (BestItem.m_Priority >= 0);
+		if (IsNeeded != IsBestNeeded)
+		{
+			if (IsNeeded)
+			{
+				Best = i;
+			}
+			continue;
+		}
+		if (
+			(Item.m_Priority < BestItem.m_Priority) ||
+			((Item.m_Priority == BestItem.m_Priority) && (Item.m_SequenceNum < BestItem.m_SequenceNum))
+		)
+		{
+			Best = i;
+		}
+	}
+
+	// Remove the item by moving the last item into its place:
+	a_Item = std::move(m_Queue[Best]);
+	m_QueueIndex.erase(MakeQueueKey(a_Item.m_ChunkX, a_Item.m_ChunkZ));
+	if (Best != m_Queue.size() - 1)
+	{
+		m_Queue[Best] = std::move(m_Queue.back());
+		m_QueueIndex[MakeQueueKey(m_Queue[Best].m_ChunkX, m_Queue[Best].m_ChunkZ)] = Best;
+	}
+	m_Queue.pop_back();
+}
+
+
+
+
+
+void cChunkGenerator::FinishItem(const cQueueItem & a_Item, eItemResult a_Result)
+{
+	CallCallbacks(a_Item);
+
+	cQueueItem Merged;
+	Merged.m_ChunkX = a_Item.m_ChunkX;
+	Merged.m_ChunkZ = a_Item.m_ChunkZ;
+	bool ShouldRequeue;
+	{
+		cCSLock Lock(m_CS);
+		auto itr = m_InProgress.find(MakeQueueKey(a_Item.m_ChunkX, a_Item.m_ChunkZ));
+		ASSERT(itr != m_InProgress.end());
+		Merged.m_ForceGenerate = itr->second.m_ForceGenerate;
+		Merged.m_Callbacks = std::move(itr->second.m_Callbacks);
+		m_InProgress.erase(itr);
+		if (a_Result == irGenerated)
+		{
+			m_NumChunksGenerated++;
+		}
+
+		// A forced regeneration requested after the worker had found the chunk already valid still needs to be done.
+		// A skipped chunk is no longer queued in the chunksink, so it is never re-queued:
+		ShouldRequeue = (Merged.m_ForceGenerate && (a_Result == irAlreadyValid));
+		if (ShouldRequeue)
+		{
+			Merged.m_Priority = a_Item.m_Priority;
+			AddToQueue(std::move(Merged));
+		}
+	}
+
+	if (ShouldRequeue)
+	{
+		m_Event.Set();
+	}
+	else
+	{
+		CallCallbacks(Merged);
+	}
+}
+
+
+
+
+
+void cChunkGenerator::CallCallbacks(const cQueueItem & a_Item)
+{
+	for (auto Callback : a_Item.m_Callbacks)
+	{
+		Callback->Call(a_Item.m_ChunkX, a_Item.m_ChunkZ);
+	}
+}
+
+
+
+
+
+void cChunkGenerator::ReportPerformance(void)
+{
+	auto Now = std::chrono::steady_clock::now();
+	double Elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(Now - m_GenerationStart).count();
+	LOG("Chunk generator performance: %.2f ch / sec (%d ch total, %u threads)",
+		(Elapsed > 0) ? (static_cast<double>(m_NumChunksGenerated) / Elapsed) : 0.0,
+		m_NumChunksGenerated,
+		static_cast<unsigned>(m_Workers.size())
+	);
+	m_LastReportTime = Now;
+}
+
+
+
+
+
+void cChunkGenerator::DoGenerate(cGenerator & a_Generator, int a_ChunkX, int a_ChunkZ)
 {
 	ASSERT(m_PluginInterface != nullptr);
 	ASSERT(m_ChunkSink != nullptr);
@@ -292,7 +571,7 @@ void cChunkGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ)
 
 	cChunkDesc ChunkDesc(a_ChunkX, a_ChunkZ);
 	m_PluginInterface->CallHookChunkGenerating(ChunkDesc);
-	m_Generator->DoGenerate(a_ChunkX, a_ChunkZ, ChunkDesc);
+	a_Generator.DoGenerate(a_ChunkX, a_ChunkZ, ChunkDesc);
 	m_PluginInterface->CallHookChunkGenerated(ChunkDesc);
 
 	#ifdef _DEBUG
@@ -307,6 +586,41 @@ void cChunkGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cChunkGenerator::cWorker:
+
+cChunkGenerator::cWorker::cWorker(cChunkGenerator & a_ChunkGenerator, cGenerator * a_Generator) :
+	super("cChunkGenerator::cWorker"),
+	m_ChunkGenerator(a_ChunkGenerator),
+	m_Generator(a_Generator)
+{
+}
+
+
+
+
+
+cChunkGenerator::cWorker::~cWorker()
+{
+	// The parent has already signalled termination and woken up the workers:
+	Wait();
+	delete m_Generator;
+	m_Generator = nullptr;
+}
+
+
+
+
+
+void cChunkGenerator::cWorker::Execute(void)
+{
+	m_ChunkGenerator.ProcessQueue(*m_Generator);
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cChunkGenerator::cGenerator:
 
@@ -341,3 +655,106 @@ EMCSBiome cChunkGenerator::cGenerator::GetBiomeAt(int a_BlockX, int a_BlockZ)
 
 
 
+
+void cChunkGenerator::cGenerator::AddStats(cStats & a_Stats)
+{
+	UNUSED(a_Stats);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkGenerator::cStats:
+
+void cChunkGenerator::cStats::AddStage(const AString & a_Name, UInt64 a_NumCalls, UInt64 a_TotalMicrosec)
+{
+	for (auto & Stage : m_Stages)
+	{
+		if (Stage.m_Name == a_Name)
+		{
+			Stage.m_NumCalls += a_NumCalls;
+			Stage.m_TotalMicrosec += a_TotalMicrosec;
+			return;
+		}
+	}
+	m_Stages.push_back({a_Name, a_NumCalls, a_TotalMicrosec});
+}
+
+
+
+
+
+void cChunkGenerator::cStats::AddCache(const AString & a_Name, UInt64 a_NumHits, UInt64 a_NumMisses, UInt64 a_NumBytes)
+{
+	for (auto & Cache : m_Caches)
+	{
+		if (Cache.m_Name == a_Name)
+		{
+			Cache.m_NumHits += a_NumHits;
+			Cache.m_NumMisses += a_NumMisses;
+			Cache.m_NumBytes += a_NumBytes;
+			return;
+		}
+	}
+	m_Caches.push_back({a_Name, a_NumHits, a_NumMisses, a_NumBytes});
+}
+
+
+
+
+
+void cChunkGenerator::cStats::GetReport(AStringVector & a_Lines) const
+{
+	if (m_Stages.empty() && m_Caches.empty())
+	{
+		a_Lines.push_back("No generator stats available");
+		return;
+	}
+
+	UInt64 TotalMicrosec = 0;
+	for (const auto & Stage : m_Stages)
+	{
+		TotalMicrosec += Stage.m_TotalMicrosec;
+	}
+	for (const auto & Stage : m_Stages)
+	{
+		a_Lines.push_back(Printf("  %s: %llu calls, %.03f sec total (%.01f%%), %.03f msec per call",
+			Stage.m_Name.c_str(),
+			static_cast<unsigned long long>(Stage.m_NumCalls),
+			static_cast<double>(Stage.m_TotalMicrosec) / 1000000,
+			(TotalMicrosec > 0) ? 100.0 * Stage.m_TotalMicrosec / TotalMicrosec : 0.0,
+			(Stage.m_NumCalls > 0) ? static_cast<double>(Stage.m_TotalMicrosec) / 1000 / Stage.m_NumCalls : 0.0
+		));
+	}
+	for (const auto & Cache : m_Caches)
+	{
+		UInt64 NumQueries = Cache.m_NumHits + Cache.m_NumMisses;
+		a_Lines.push_back(Printf("  %s: %llu hits, %llu misses, %.02f%% hit rate, %.01f KiB",
+			Cache.m_Name.c_str(),
+			static_cast<unsigned long long>(Cache.m_NumHits),
+			static_cast<unsigned long long>(Cache.m_NumMisses),
+			(NumQueries > 0) ? 100.0 * Cache.m_NumHits / NumQueries : 0.0,
+			static_cast<double>(Cache.m_NumBytes) / 1024
+		));
+	}
+}
+
+
+
+
+
+UInt64 cChunkGenerator::cStats::GetCacheMemory(void) const
+{
+	UInt64 Res = 0;
+	for (const auto & Cache : m_Caches)
+	{
+		Res += Cache.m_NumBytes;
+	}
+	return Res;
+}
+
+
+
+
@@ -4,12 +4,17 @@
 // Interfaces to the cChunkGenerator class representing the thread that generates chunks
 
 /*
-The object takes requests for generating chunks and processes them in a separate thread one by one.
-The requests are not added to the queue if there is already a request with the same coords
-Before generating, the thread checks if the chunk hasn't been already generated.
-It is theoretically possible to have multiple generator threads by having multiple instances of this object,
-but then it MAY happen that the chunk is generated twice.
-If the generator queue is overloaded, the generator skips chunks with no clients in them
+The object takes requests for generating chunks and processes them in one or more worker threads.
+The requests are not added to the queue if there is already a request with the same coords, they are merged into it instead.
+The same goes for the chunks that a worker is currently processing, so that no two workers generate the same chunk.
+The queue is ordered by the chunks' priority, which is the distance to the nearest client that wants the chunk, as reported
+by the chunksink; the priorities are refreshed once in a while, since the players move.
+Before generating, the worker checks if the chunk hasn't been already generated.
+Each worker thread has its own instance of the generator engine (including all its caches), so the workers
+don't need to synchronize with each other while generating. Since the generator engines are pure functions
+of the seed and the chunk coords, the output is the same regardless of the number of workers.
+The number of workers is set by the [Generator] NumThreads value in world.ini (0 = one per CPU core).
+If the generator queue is overloaded, the generator skips chunks that nobody needs anymore
 */
 
 
@@ -20,6 +25,7 @@ If the generator queue is overloaded, the generator skips chunks with no clients
 
 #include "../OSSupport/IsThread.h"
 #include "../ChunkDef.h"
+#include <unordered_map>
 
 
 
@@ -33,12 +39,47 @@ class cChunkDesc;
 
 
 
-class cChunkGenerator :
-	cIsThread
+class cChunkGenerator
 {
-	typedef cIsThread super;
-	
 public:
+	/** Cumulative statistics of the generator engines - time spent in the individual stages and the cache hit rates.
+	Each engine adds its own stats, the stages and caches of the same name are summed up over all the worker threads. */
+	class cStats
+	{
+	public:
+		/** Adds the number of calls and the time spent in the named stage. The stages are reported in the order first added. */
+		void AddStage(const AString & a_Name, UInt64 a_NumCalls, UInt64 a_TotalMicrosec);
+
+		/** Adds the number of hits and misses, and the memory used, of the named cache. */
+		void AddCache(const AString & a_Name, UInt64 a_NumHits, UInt64 a_NumMisses, UInt64 a_NumBytes);
+
+		/** Appends the human-readable report lines, one per stage and per cache, to a_Lines. */
+		void GetReport(AStringVector & a_Lines) const;
+
+		/** Returns the total memory used by all the caches, in bytes. */
+		UInt64 GetCacheMemory(void) const;
+
+	protected:
+		struct sStage
+		{
+			AString m_Name;
+			UInt64 m_NumCalls;
+			UInt64 m_TotalMicrosec;
+		};
+
+		struct sCache
+		{
+			AString m_Name;
+			UInt64 m_NumHits;
+			UInt64 m_NumMisses;
+			UInt64 m_NumBytes;
+		};
+
+		std::vector<sStage> m_Stages;
+		std::vector<sCache> m_Caches;
+	} ;
+
+
 	/** The interface that a class has to implement to become a generator */
 	class cGenerator
 	{
@@ -57,6 +98,10 @@ public:
 
 		/// Called in a separate thread to do the actual chunk generation. Generator should generate into a_ChunkDesc.
 		virtual void DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a_ChunkDesc) = 0;
+
+		/** Adds the generator's cumulative stage timings and cache stats to a_Stats.
+		Called from any thread, while the generator may be generating. The default implementation has no stats to add. */
+		virtual void AddStats(cStats & a_Stats);
 		
 	protected:
 		cChunkGenerator & m_ChunkGenerator;
@@ -102,10 +147,14 @@ public:
 		*/
 		virtual bool IsChunkValid(int a_ChunkX, int a_ChunkZ) = 0;
 		
-		/** Called when the generator is overloaded to skip chunks that are no longer needed.
-		If this callback returns false, the chunk is not generated.
-		*/
-		virtual bool HasChunkAnyClients(int a_ChunkX, int a_ChunkZ) = 0;
+		/** Returns the priority of generating the chunk; the chunks with lower values are generated first.
+		Returns a negative number if nobody needs the chunk anymore; such chunks are generated last and are skipped
+		when the generator is overloaded. Called without any generator locks held. */
+		virtual int GetChunkPriority(int a_ChunkX, int a_ChunkZ) = 0;
+
+		/** Called when the generator has skipped the chunk because nobody needed it.
+		The chunk is no longer queued in the generator. */
+		virtual void OnChunkSkipped(int a_ChunkX, int a_ChunkZ) = 0;
 
 		/** Called to check whether the specified chunk is in the queued state.
 		Currently used only in Debug-mode asserts. */
@@ -132,17 +181,52 @@ public:
 	void WaitForQueueEmpty(void);
 	
 	int GetQueueLength(void);
+
+	/** Returns the number of worker threads generating the chunks in parallel. */
+	size_t GetNumWorkers(void) const { return m_Workers.size(); }
 	
 	int GetSeed(void) const { return m_Seed; }
 	
 	/** Returns the biome at the specified coords. Used by ChunkMap if an invalid chunk is queried for biome */
 	EMCSBiome GetBiomeAt(int a_BlockX, int a_BlockZ);
 
+	/** Adds the stats of all the workers' generator engines to a_Stats. */
+	void GetStats(cStats & a_Stats);
+
 	/** Reads a block type from the ini file; returns the blocktype on success, emits a warning and returns a_Default's representation on failure. */
 	static BLOCKTYPE GetIniBlock(cIniFile & a_IniFile, const AString & a_SectionName, const AString & a_ValueName, const AString & a_Default);
 	
 private:
 
+	/** A single generator thread, owning its own instance of the generator engine. */
+	class cWorker :
+		public cIsThread
+	{
+		typedef cIsThread super;
+
+	public:
+		cWorker(cChunkGenerator & a_ChunkGenerator, cGenerator * a_Generator);
+		virtual ~cWorker();
+
+		/** Sets the termination flag, without waiting for the thread to finish. */
+		void SignalTerminate(void) { m_ShouldTerminate = true; }
+
+		/** Returns the generator engine used by this worker. */
+		cGenerator & GetGenerator(void) { return *m_Generator; }
+
+	protected:
+		cChunkGenerator & m_ChunkGenerator;
+
+		/** The generator engine used exclusively by this worker. Owned by the worker. */
+		cGenerator * m_Generator;
+
+		// cIsThread override:
+		virtual void Execute(void) override;
+	} ;
+
+	typedef std::vector<std::unique_ptr<cWorker>> cWorkers;
+
+
 	struct cQueueItem
 	{
 		/** The chunk coords */
@@ -151,11 +235,36 @@ private:
 		/** Force the regeneration of an already existing chunk */
 		bool m_ForceGenerate;
 
-		/** Callback to call after generating.*/
-		cChunkCoordCallback * m_Callback;
+		/** Callbacks to call after generating, one for each merged request that specified one. */
+		std::vector<cChunkCoordCallback *> m_Callbacks;
+
+		/** The priority, as last reported by the chunksink. Negative if nobody needs the chunk. */
+		int m_Priority;
+
+		/** The order in which the chunks were queued, used for keeping the chunks with the same priority FIFO. */
+		UInt64 m_SequenceNum;
+	};
+
+	/** The queue items, unordered; the worker picks the one with the best priority. */
+	typedef std::vector<cQueueItem> cGenQueue;
+
+	/** Maps the chunk coords (as returned by MakeQueueKey()) to the index of their item within m_Queue. */
+	typedef std::unordered_map<Int64, size_t> cGenQueueIndex;
+
+	/** The requests merged into a chunk while a worker was processing it. */
+	struct cInProgressItem
+	{
+		/** Set if any of the merged requests forced the regeneration. */
+		bool m_ForceGenerate;
+
+		/** Callbacks of the merged requests, to be called once the worker is done with the chunk. */
+		std::vector<cChunkCoordCallback *> m_Callbacks;
+
+		cInProgressItem(void) : m_ForceGenerate(false) {}
 	};
 
-	typedef std::list<cQueueItem> cGenQueue;
+	/** Maps the chunk coords (as returned by MakeQueueKey()) of the chunks being processed by the workers to the requests merged into them. */
+	typedef std::unordered_map<Int64, cInProgressItem> cInProgressMap;
 
 
 	/** Seed used for the generator. */
@@ -167,14 +276,53 @@ private:
 	/** Queue of the chunks to be generated. Protected against multithreaded access by m_CS. */
 	cGenQueue m_Queue;
 
-	/** Set when an item is added to the queue or the thread should terminate. */
+	/** Index of m_Queue by the chunk coords, for merging the duplicate requests. Protected by m_CS. */
+	cGenQueueIndex m_QueueIndex;
+
+	/** The chunks that the workers have taken out of m_Queue and are processing. Protected by m_CS. */
+	cInProgressMap m_InProgress;
+
+	/** The sequence number to be given to the next queued item. Protected by m_CS. */
+	UInt64 m_NextSequenceNum;
+
+	/** Time when the priorities of the queued items were last refreshed. Protected by m_CS. */
+	std::chrono::steady_clock::time_point m_LastPrioritiesUpdate;
+
+	/** Set while a worker is refreshing the priorities, so that the other workers don't do the same. Protected by m_CS. */
+	bool m_IsUpdatingPriorities;
+
+	/** Set when the workers should terminate. Protected by m_CS. */
+	bool m_ShouldTerminate;
+
+	/** Set when an item is added to the queue or the workers should terminate.
+	Wakes up a single worker; a worker that leaves items in the queue (or terminates) sets it again to wake up the next one. */
 	cEvent m_Event;
 
 	/** Set when an item is removed from the queue. */
 	cEvent m_evtRemoved;
 	
-	/** The actual generator engine used to generate chunks. */
+	/** The generator engine used for the direct (non-queued) requests, such as GenerateBiomes() and GetBiomeAt().
+	The workers each use their own instance, so that this one is never accessed from the worker threads.
+	Its caches aren't thread-safe, so the access is serialized by m_CSSharedGenerator. */
 	cGenerator * m_Generator;
+
+	/** Serializes the access to m_Generator, which is called from any thread. */
+	cCriticalSection m_CSSharedGenerator;
+
+	/** Name of the generator engine, as read from the ini file; used for creating the engine instances. */
+	AString m_GeneratorName;
+
+	/** The worker threads processing m_Queue. */
+	cWorkers m_Workers;
+
+	/** Number of chunks generated since the queue was last empty. Used for the performance reports. Protected by m_CS. */
+	int m_NumChunksGenerated;
+
+	/** Time when the queue started to fill. Protected by m_CS. */
+	std::chrono::steady_clock::time_point m_GenerationStart;
+
+	/** Time of the last performance report made (so that performance isn't reported too often). Protected by m_CS. */
+	std::chrono::steady_clock::time_point m_LastReportTime;
 	
 	/** The plugin interface that may modify the generated chunks */
 	cPluginInterface * m_PluginInterface;
@@ -183,11 +331,43 @@ private:
 	cChunkSink * m_ChunkSink;
 	
 
-	// cIsThread override:
-	virtual void Execute(void) override;
+	/** Creates and initializes a new instance of the generator engine specified by m_GeneratorName. */
+	cGenerator * CreateGenerator(cIniFile & a_IniFile);
+
+	/** The worker thread body: processes the queue using the specified generator engine until terminated. */
+	void ProcessQueue(cGenerator & a_Generator);
+
+	/** Asks the chunksink for the current priorities of all the queued chunks and stores them in the queue.
+	Expects m_CS to be locked by a_Lock; unlocks it while asking the chunksink. */
+	void UpdatePriorities(cCSLock & a_Lock);
+
+	/** Removes the item with the best priority from the queue and returns it in a_Item. Expects m_CS to be locked and the queue non-empty. */
+	void PopBestItem(cQueueItem & a_Item);
+
+	/** Adds the item to the queue. Expects m_CS to be locked and the chunk to be neither queued nor in progress. */
+	void AddToQueue(cQueueItem && a_Item);
+
+	/** The outcomes of a worker processing a queue item. */
+	enum eItemResult
+	{
+		irGenerated,     ///< The chunk was generated
+		irAlreadyValid,  ///< The chunk was already valid and its regeneration wasn't forced
+		irSkipped,       ///< The generator was overloaded and nobody needed the chunk
+	} ;
+
+	/** Called by a worker when done processing the item, with m_CS unlocked.
+	Calls the item's callbacks and removes it from m_InProgress. The requests merged into the item meanwhile have their
+	callbacks called as well, unless one of them forced the regeneration of an already valid chunk, in which case they are queued again. */
+	void FinishItem(const cQueueItem & a_Item, eItemResult a_Result);
+
+	/** Calls all the callbacks of the item. */
+	static void CallCallbacks(const cQueueItem & a_Item);
+
+	/** Logs the generator performance since the queue started to fill. Expects m_CS to be locked. */
+	void ReportPerformance(void);
 
-	/** Generates the specified chunk and sets it into the chunksink. */
-	void DoGenerate(int a_ChunkX, int a_ChunkZ);
+	/** Generates the specified chunk using the specified generator engine and sets it into the chunksink. */
+	void DoGenerate(cGenerator & a_Generator, int a_ChunkX, int a_ChunkZ);
 };
 
 
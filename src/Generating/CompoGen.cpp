@@ -371,6 +371,18 @@ cCompoGenCache::~cCompoGenCache()
 
 
 
+bool cCompoGenCache::AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const
+{
+	a_NumHits += static_cast<UInt64>(m_NumHits);
+	a_NumMisses += static_cast<UInt64>(m_NumMisses);
+	a_NumBytes += static_cast<UInt64>(m_CacheSize) * (sizeof(sCacheData) + sizeof(int));
+	return true;
+}
+
+
+
+
+
 void cCompoGenCache::ComposeTerrain(cChunkDesc & a_ChunkDesc, const cChunkDesc::Shape & a_Shape)
 {
 	#ifdef _DEBUG
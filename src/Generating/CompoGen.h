@@ -121,6 +121,7 @@ public:
 	// cTerrainCompositionGen override:
 	virtual void ComposeTerrain(cChunkDesc & a_ChunkDesc, const cChunkDesc::Shape & a_Shape) override;
 	virtual void InitializeCompoGen(cIniFile & a_IniFile) override;
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const override;
 	
 protected:
 
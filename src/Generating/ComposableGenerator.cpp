@@ -40,6 +40,19 @@
 
 
 
+/** Returns the number of microseconds elapsed since a_Start and resets a_Start to now, for timing consecutive stages. */
+static UInt64 MicrosecSince(std::chrono::steady_clock::time_point & a_Start)
+{
+	auto Now = std::chrono::steady_clock::now();
+	auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Now - a_Start).count();
+	a_Start = Now;
+	return static_cast<UInt64>(Elapsed);
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cTerrainCompositionGen:
 
@@ -118,7 +131,10 @@ cComposableGenerator::cComposableGenerator(cChunkGenerator & a_ChunkGenerator) :
 	super(a_ChunkGenerator),
 	m_BiomeGen(),
 	m_ShapeGen(),
-	m_CompositionGen()
+	m_CompositionGen(),
+	m_BiomeStats("BiomeGen"),
+	m_ShapeStats("ShapeGen"),
+	m_CompositionStats("CompositionGen")
 {
 }
 
@@ -154,16 +170,24 @@ void cComposableGenerator::GenerateBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef:
 
 void cComposableGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a_ChunkDesc)
 {
+	// The stage times are collected locally and added to the stats all at once at the end, to lock m_CSStats only once per chunk:
+	auto StageStart = std::chrono::steady_clock::now();
+	UInt64 BiomeMicrosec = 0, ShapeMicrosec = 0, CompositionMicrosec = 0;
+	std::vector<UInt64> FinishGenMicrosec;
+
 	if (a_ChunkDesc.IsUsingDefaultBiomes())
 	{
 		m_BiomeGen->GenBiomes(a_ChunkX, a_ChunkZ, a_ChunkDesc.GetBiomeMap());
+		BiomeMicrosec = MicrosecSince(StageStart);
 	}
 	
 	cChunkDesc::Shape shape;
 	if (a_ChunkDesc.IsUsingDefaultHeight())
 	{
+		StageStart = std::chrono::steady_clock::now();
 		m_ShapeGen->GenShape(a_ChunkX, a_ChunkZ, shape);
 		a_ChunkDesc.SetHeightFromShape(shape);
+		ShapeMicrosec = MicrosecSince(StageStart);
 	}
 	else
 	{
@@ -174,14 +198,19 @@ void cComposableGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a
 	bool ShouldUpdateHeightmap = false;
 	if (a_ChunkDesc.IsUsingDefaultComposition())
 	{
+		StageStart = std::chrono::steady_clock::now();
 		m_CompositionGen->ComposeTerrain(a_ChunkDesc, shape);
+		CompositionMicrosec = MicrosecSince(StageStart);
 	}
 
 	if (a_ChunkDesc.IsUsingDefaultFinish())
 	{
+		FinishGenMicrosec.reserve(m_FinishGens.size());
+		StageStart = std::chrono::steady_clock::now();
 		for (cFinishGenList::iterator itr = m_FinishGens.begin(); itr != m_FinishGens.end(); ++itr)
 		{
 			(*itr)->GenFinish(a_ChunkDesc);
+			FinishGenMicrosec.push_back(MicrosecSince(StageStart));
 		}  // for itr - m_FinishGens[]
 		ShouldUpdateHeightmap = true;
 	}
@@ -190,6 +219,64 @@ void cComposableGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a
 	{
 		a_ChunkDesc.UpdateHeightmap();
 	}
+
+	// Update the stats:
+	cCSLock Lock(m_CSStats);
+	if (a_ChunkDesc.IsUsingDefaultBiomes())
+	{
+		m_BiomeStats.m_NumCalls += 1;
+		m_BiomeStats.m_TotalMicrosec += BiomeMicrosec;
+	}
+	if (a_ChunkDesc.IsUsingDefaultHeight())
+	{
+		m_ShapeStats.m_NumCalls += 1;
+		m_ShapeStats.m_TotalMicrosec += ShapeMicrosec;
+	}
+	if (a_ChunkDesc.IsUsingDefaultComposition())
+	{
+		m_CompositionStats.m_NumCalls += 1;
+		m_CompositionStats.m_TotalMicrosec += CompositionMicrosec;
+	}
+	ASSERT(FinishGenMicrosec.size() <= m_FinishGenStats.size());
+	for (size_t i = 0; i < FinishGenMicrosec.size(); i++)
+	{
+		m_FinishGenStats[i].m_NumCalls += 1;
+		m_FinishGenStats[i].m_TotalMicrosec += FinishGenMicrosec[i];
+	}
+	m_BiomeCacheStats = sCacheStats();
+	m_BiomeCacheStats.m_IsCache = m_BiomeGen->AddCacheStats(m_BiomeCacheStats.m_NumHits, m_BiomeCacheStats.m_NumMisses, m_BiomeCacheStats.m_NumBytes);
+	m_CompositionCacheStats = sCacheStats();
+	m_CompositionCacheStats.m_IsCache = m_CompositionGen->AddCacheStats(m_CompositionCacheStats.m_NumHits, m_CompositionCacheStats.m_NumMisses, m_CompositionCacheStats.m_NumBytes);
+	m_CompositedHeightCacheStats = sCacheStats();
+	m_CompositedHeightCacheStats.m_IsCache = m_CompositedHeightCache->AddCacheStats(m_CompositedHeightCacheStats.m_NumHits, m_CompositedHeightCacheStats.m_NumMisses, m_CompositedHeightCacheStats.m_NumBytes);
+}
+
+
+
+
+
+void cComposableGenerator::AddStats(cChunkGenerator::cStats & a_Stats)
+{
+	cCSLock Lock(m_CSStats);
+	a_Stats.AddStage(m_BiomeStats.m_Name, m_BiomeStats.m_NumCalls, m_BiomeStats.m_TotalMicrosec);
+	a_Stats.AddStage(m_ShapeStats.m_Name, m_ShapeStats.m_NumCalls, m_ShapeStats.m_TotalMicrosec);
+	a_Stats.AddStage(m_CompositionStats.m_Name, m_CompositionStats.m_NumCalls, m_CompositionStats.m_TotalMicrosec);
+	for (const auto & Stats : m_FinishGenStats)
+	{
+		a_Stats.AddStage(Stats.m_Name, Stats.m_NumCalls, Stats.m_TotalMicrosec);
+	}
+	if (m_BiomeCacheStats.m_IsCache)
+	{
+		a_Stats.AddCache("BiomeGen cache", m_BiomeCacheStats.m_NumHits, m_BiomeCacheStats.m_NumMisses, m_BiomeCacheStats.m_NumBytes);
+	}
+	if (m_CompositionCacheStats.m_IsCache)
+	{
+		a_Stats.AddCache("CompositionGen cache", m_CompositionCacheStats.m_NumHits, m_CompositionCacheStats.m_NumMisses, m_CompositionCacheStats.m_NumBytes);
+	}
+	if (m_CompositedHeightCacheStats.m_IsCache)
+	{
+		a_Stats.AddCache("Composited height cache", m_CompositedHeightCacheStats.m_NumHits, m_CompositedHeightCacheStats.m_NumMisses, m_CompositedHeightCacheStats.m_NumBytes);
+	}
 }
 
 
@@ -289,6 +376,14 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 
 	AString Finishers = a_IniFile.GetValueSet("Generator", "Finishers", "");
 
+	// The folder for the on-disk cache of the layouts generated by the structure generators; empty disables the cache:
+	AString LayoutCacheFolder = a_IniFile.GetValue("Generator", "StructureCacheFolder", "");
+	if (!LayoutCacheFolder.empty() && !cFile::IsFolder(LayoutCacheFolder) && !cFile::CreateFolder(LayoutCacheFolder) && !cFile::IsFolder(LayoutCacheFolder))
+	{
+		LOGWARNING("Cannot create the structure cache folder %s, the structure layouts will not be cached.", LayoutCacheFolder.c_str());
+		LayoutCacheFolder.clear();
+	}
+
 	// Create all requested finishers:
 	AStringVector Str = StringSplitAndTrim(Finishers, ",");
 	for (AStringVector::const_iterator itr = Str.begin(); itr != Str.end(); ++itr)
@@ -453,7 +548,12 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			int GridSize  = a_IniFile.GetValueSetI("Generator", "NetherFortsGridSize", 512);
 			int MaxOffset = a_IniFile.GetValueSetI("Generator", "NetherFortsMaxOffset", 128);
 			int MaxDepth  = a_IniFile.GetValueSetI("Generator", "NetherFortsMaxDepth", 12);
-			m_FinishGens.push_back(cFinishGenPtr(new cNetherFortGen(Seed, GridSize, MaxOffset, MaxDepth)));
+			auto NetherFortGen = std::make_shared<cNetherFortGen>(Seed, GridSize, MaxOffset, MaxDepth);
+			if (!LayoutCacheFolder.empty())
+			{
+				NetherFortGen->SetLayoutCacheFile(LayoutCacheFolder + "/NetherForts.dat");
+			}
+			m_FinishGens.push_back(NetherFortGen);
 		}
 		else if (NoCaseCompare(*itr, "NetherOreNests") == 0)
 		{
@@ -543,7 +643,12 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			int MaxOffset = a_IniFile.GetValueSetI("Generator", "RainbowRoadsMaxOffset", 128);
 			int MaxDepth  = a_IniFile.GetValueSetI("Generator", "RainbowRoadsMaxDepth",   30);
 			int MaxSize   = a_IniFile.GetValueSetI("Generator", "RainbowRoadsMaxSize",   260);
-			m_FinishGens.push_back(cFinishGenPtr(new cRainbowRoadsGen(Seed, GridSize, MaxOffset, MaxDepth, MaxSize)));
+			auto RainbowRoadsGen = std::make_shared<cRainbowRoadsGen>(Seed, GridSize, MaxOffset, MaxDepth, MaxSize);
+			if (!LayoutCacheFolder.empty())
+			{
+				RainbowRoadsGen->SetLayoutCacheFile(LayoutCacheFolder + "/RainbowRoads.dat");
+			}
+			m_FinishGens.push_back(RainbowRoadsGen);
 		}
 		else if (NoCaseCompare(*itr, "Ravines") == 0)
 		{
@@ -608,7 +713,12 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			int MaxOffset = a_IniFile.GetValueSetI("Generator", "UnderwaterBaseMaxOffset", 128);
 			int MaxDepth  = a_IniFile.GetValueSetI("Generator", "UnderwaterBaseMaxDepth",    7);
 			int MaxSize   = a_IniFile.GetValueSetI("Generator", "UnderwaterBaseMaxSize",   128);
-			m_FinishGens.push_back(std::make_shared<cUnderwaterBaseGen>(Seed, GridSize, MaxOffset, MaxDepth, MaxSize, m_BiomeGen));
+			auto UnderwaterBaseGen = std::make_shared<cUnderwaterBaseGen>(Seed, GridSize, MaxOffset, MaxDepth, MaxSize, m_BiomeGen);
+			if (!LayoutCacheFolder.empty())
+			{
+				UnderwaterBaseGen->SetLayoutCacheFile(LayoutCacheFolder + "/UnderwaterBases.dat");
+			}
+			m_FinishGens.push_back(UnderwaterBaseGen);
 		}
 		else if (NoCaseCompare(*itr, "Villages") == 0)
 		{
@@ -618,7 +728,12 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			int MaxSize    = a_IniFile.GetValueSetI("Generator", "VillageMaxSize",   128);
 			int MinDensity = a_IniFile.GetValueSetI("Generator", "VillageMinDensity", 50);
 			int MaxDensity = a_IniFile.GetValueSetI("Generator", "VillageMaxDensity", 80);
-			m_FinishGens.push_back(std::make_shared<cVillageGen>(Seed, GridSize, MaxOffset, MaxDepth, MaxSize, MinDensity, MaxDensity, m_BiomeGen, m_CompositedHeightCache));
+			auto VillageGen = std::make_shared<cVillageGen>(Seed, GridSize, MaxOffset, MaxDepth, MaxSize, MinDensity, MaxDensity, m_BiomeGen, m_CompositedHeightCache);
+			if (!LayoutCacheFolder.empty())
+			{
+				VillageGen->SetLayoutCacheFile(LayoutCacheFolder + "/Villages.dat");
+			}
+			m_FinishGens.push_back(VillageGen);
 		}
 		else if (NoCaseCompare(*itr, "Vines") == 0)
 		{
@@ -645,6 +760,12 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 		{
 			LOGWARNING("Unknown Finisher in the [Generator] section: \"%s\". Ignoring.", itr->c_str());
 		}
+
+		// Name the stats of the finishers added for this item; an item may add several finishers, or none at all:
+		while (m_FinishGenStats.size() < m_FinishGens.size())
+		{
+			m_FinishGenStats.push_back(sStageStats(*itr));
+		}
 	}  // for itr - Str[]
 }
 
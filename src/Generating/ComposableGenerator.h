@@ -55,6 +55,10 @@ public:
 	/** Reads parameters from the ini file, prepares generator for use. */
 	virtual void InitializeBiomeGen(cIniFile & a_IniFile) {}
 
+	/** If this generator is a cache, adds its hit and miss counts to a_NumHits and a_NumMisses, the memory used by the cached data
+	to a_NumBytes, and returns true. The default implementation, for the generators that aren't caches, returns false. */
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const { return false; }
+
 	/** Creates the correct BiomeGen descendant based on the ini file settings and the seed provided.
 	a_CacheOffByDefault gets set to whether the cache should be disabled by default.
 	Used in BiomeVisualiser, too.
@@ -113,6 +117,10 @@ public:
 	/** Initializes the generator, reading its parameters from the INI file. */
 	virtual void InitializeHeightGen(cIniFile & a_IniFile) {}
 
+	/** If this generator is a cache, adds its hit and miss counts to a_NumHits and a_NumMisses, the memory used by the cached data
+	to a_NumBytes, and returns true. The default implementation, for the generators that aren't caches, returns false. */
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const { return false; }
+
 	/** Creates a cTerrainHeightGen descendant based on the INI file settings. */
 	static cTerrainHeightGenPtr CreateHeightGen(cIniFile & a_IniFile, cBiomeGenPtr a_BiomeGen, int a_Seed, bool & a_CacheOffByDefault);
 } ;
@@ -137,6 +145,10 @@ public:
 	
 	/** Reads parameters from the ini file, prepares generator for use. */
 	virtual void InitializeCompoGen(cIniFile & a_IniFile) {}
+
+	/** If this generator is a cache, adds its hit and miss counts to a_NumHits and a_NumMisses, the memory used by the cached data
+	to a_NumBytes, and returns true. The default implementation, for the generators that aren't caches, returns false. */
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const { return false; }
 	
 	/** Creates the correct TerrainCompositionGen descendant based on the ini file settings and the seed provided.
 	a_BiomeGen is the underlying biome generator, some composition generators may depend on it providing additional biomes around the chunk
@@ -182,8 +194,31 @@ public:
 	virtual void Initialize(cIniFile & a_IniFile) override;
 	virtual void GenerateBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef::BiomeMap & a_BiomeMap) override;
 	virtual void DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a_ChunkDesc) override;
+	virtual void AddStats(cChunkGenerator::cStats & a_Stats) override;
 
 protected:
+	/** Cumulative timing of a single generation stage. */
+	struct sStageStats
+	{
+		AString m_Name;
+		UInt64 m_NumCalls;
+		UInt64 m_TotalMicrosec;
+
+		sStageStats(const AString & a_Name) : m_Name(a_Name), m_NumCalls(0), m_TotalMicrosec(0) {}
+	} ;
+
+	/** Snapshot of a cache's hit and miss counts and memory usage. */
+	struct sCacheStats
+	{
+		bool m_IsCache;
+		UInt64 m_NumHits;
+		UInt64 m_NumMisses;
+		UInt64 m_NumBytes;
+
+		sCacheStats(void) : m_IsCache(false), m_NumHits(0), m_NumMisses(0), m_NumBytes(0) {}
+	} ;
+
+
 	// The generator's composition:
 	/** The biome generator. */
 	cBiomeGenPtr m_BiomeGen;
@@ -199,6 +234,22 @@ protected:
 
 	/** The finisher generators, in the order in which they are applied. */
 	cFinishGenList m_FinishGens;
+
+	/** Protects the stats below. DoGenerate() updates them in the generator thread, AddStats() reads them from any thread. */
+	cCriticalSection m_CSStats;
+
+	/** The timing of the fixed stages. */
+	sStageStats m_BiomeStats;
+	sStageStats m_ShapeStats;
+	sStageStats m_CompositionStats;
+
+	/** The timing of the individual finishers, in the same order as m_FinishGens. */
+	std::vector<sStageStats> m_FinishGenStats;
+
+	/** The cache stats, snapshotted after each chunk, because the caches themselves are only safe to read in the generator thread. */
+	sCacheStats m_BiomeCacheStats;
+	sCacheStats m_CompositionCacheStats;
+	sCacheStats m_CompositedHeightCacheStats;
 	
 	
 	/** Reads the BiomeGen settings from the ini and initializes m_BiomeGen accordingly */
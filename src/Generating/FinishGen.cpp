@@ -296,16 +296,24 @@ void cFinishGenGlowStone::TryPlaceGlowstone(cChunkDesc & a_ChunkDesc, int a_RelX
 
 void cFinishGenTallGrass::GenFinish(cChunkDesc & a_ChunkDesc)
 {
+	// The placement noise is offset by a per-row and a per-column value, precompute them for the whole chunk:
+	int OffsetZ[cChunkDef::Width];
+	for (int z = 0; z < cChunkDef::Width; z++)
+	{
+		OffsetZ[z] = m_Noise.IntNoise1DInt(z + a_ChunkDesc.GetChunkZ() * cChunkDef::Width);
+	}
+
 	for (int x = 0; x < cChunkDef::Width; x++)
 	{
 		int xx = x + a_ChunkDesc.GetChunkX() * cChunkDef::Width;
+		int OffsetX = m_Noise.IntNoise1DInt(xx);
 		for (int z = 0; z < cChunkDef::Width; z++)
 		{
 			int zz = z + a_ChunkDesc.GetChunkZ() * cChunkDef::Width;
 			int BiomeDensity = GetBiomeDensity(a_ChunkDesc.GetBiome(x, z));
 
 			// Choose if we want to place long grass here. If not then bail out:
-			if ((m_Noise.IntNoise2DInt(xx + m_Noise.IntNoise1DInt(xx), zz + m_Noise.IntNoise1DInt(zz)) / 7 % 100) > BiomeDensity)
+			if ((m_Noise.IntNoise2DInt(xx + OffsetX, zz + OffsetZ[z]) / 7 % 100) > BiomeDensity)
 			{
 				continue;
 			}
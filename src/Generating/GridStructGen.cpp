@@ -5,6 +5,14 @@
 
 #include "Globals.h"
 #include "GridStructGen.h"
+#include "SharedStructureCache.h"
+
+
+
+
+/** The shared structure cache holds this many times the cost limit of a single generator's cache. */
+static const size_t SHARED_CACHE_SIZE_MULTIPLIER = 4;
+
 
 
 
@@ -79,6 +87,41 @@ cGridStructGen::cGridStructGen(
 
 
 
+void cGridStructGen::SetLayoutCacheFile(const AString & a_FileName)
+{
+	m_LayoutCache = cStructureLayoutCache::Get(a_FileName, GetLayoutSignature());
+}
+
+
+
+
+
+void cGridStructGen::UseSharedCache(const AString & a_Name)
+{
+	// The shared cache serves all the generator threads, each working on a different area, so it needs to be larger:
+	m_SharedCache = cSharedStructureCache::Get(a_Name, GetLayoutSignature(), m_MaxCacheSize * SHARED_CACHE_SIZE_MULTIPLIER);
+}
+
+
+
+
+
+cGridStructGen::cStructurePtr cGridStructGen::CreateStructureForCell(int a_GridX, int a_GridZ)
+{
+	int OriginX = a_GridX + ((m_Noise.IntNoise2DInt(a_GridX + 3, a_GridZ + 5) / 7) % (m_MaxOffsetX * 2)) - m_MaxOffsetX;
+	int OriginZ = a_GridZ + ((m_Noise.IntNoise2DInt(a_GridX + 5, a_GridZ + 3) / 7) % (m_MaxOffsetZ * 2)) - m_MaxOffsetZ;
+	cStructurePtr Structure = CreateStructure(a_GridX, a_GridZ, OriginX, OriginZ);
+	if (Structure.get() == nullptr)
+	{
+		Structure.reset(new cEmptyStructure(a_GridX, a_GridZ, OriginX, OriginZ));
+	}
+	return Structure;
+}
+
+
+
+
+
 void cGridStructGen::GetStructuresForChunk(int a_ChunkX, int a_ChunkZ, cStructurePtrs & a_Structures)
 {
 	// Calculate the min and max grid coords of the structures to be returned:
@@ -95,6 +138,27 @@ void cGridStructGen::GetStructuresForChunk(int a_ChunkX, int a_ChunkZ, cStructur
 	int MinZ = MinGridZ * m_GridSizeZ;
 	int MaxZ = MaxGridZ * m_GridSizeZ;
 
+	// With the shared cache, each structure is either found there or created and added for the other threads:
+	if (m_SharedCache != nullptr)
+	{
+		for (int x = MinGridX; x < MaxGridX; x++)
+		{
+			int GridX = x * m_GridSizeX;
+			for (int z = MinGridZ; z < MaxGridZ; z++)
+			{
+				int GridZ = z * m_GridSizeZ;
+				cStructurePtr Structure = m_SharedCache->Find(GridX, GridZ);
+				if (Structure == nullptr)
+				{
+					// Created outside of the cache's lock, so that the threads don't wait for each other's structures:
+					Structure = m_SharedCache->Add(CreateStructureForCell(GridX, GridZ));
+				}
+				a_Structures.push_back(Structure);
+			}  // for z
+		}  // for x
+		return;
+	}
+
 	// Walk the cache, move each structure that we want into a_Structures:
 	for (cStructurePtrs::iterator itr = m_Cache.begin(), end = m_Cache.end(); itr != end;)
 	{
@@ -132,14 +196,7 @@ void cGridStructGen::GetStructuresForChunk(int a_ChunkX, int a_ChunkZ, cStructur
 			}  // for itr - a_Structures[]
 			if (!Found)
 			{
-				int OriginX = GridX + ((m_Noise.IntNoise2DInt(GridX + 3, GridZ + 5) / 7) % (m_MaxOffsetX * 2)) - m_MaxOffsetX;
-				int OriginZ = GridZ + ((m_Noise.IntNoise2DInt(GridX + 5, GridZ + 3) / 7) % (m_MaxOffsetZ * 2)) - m_MaxOffsetZ;
-				cStructurePtr Structure = CreateStructure(GridX, GridZ, OriginX, OriginZ);
-				if (Structure.get() == nullptr)
-				{
-					Structure.reset(new cEmptyStructure(GridX, GridZ, OriginX, OriginZ));
-				}
-				a_Structures.push_back(Structure);
+				a_Structures.push_back(CreateStructureForCell(GridX, GridZ));
 			}
 		}  // for z
 	}  // for x
@@ -182,3 +239,17 @@ void cGridStructGen::GenFinish(cChunkDesc & a_ChunkDesc)
 
 
 
+UInt32 cGridStructGen::GetLayoutSignature(void) const
+{
+	UInt32 Signature = 2166136261U;
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_Seed);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_GridSizeX);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_GridSizeZ);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxOffsetX);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxOffsetZ);
+	return Signature;
+}
+
+
+
+
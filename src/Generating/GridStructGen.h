@@ -10,12 +10,21 @@
 #pragma once
 
 #include "ComposableGenerator.h"
+#include "StructureLayoutCache.h"
 #include "../Noise/Noise.h"
 
 
 
 
 
+// fwd:
+class cSharedStructureCache;
+typedef SharedPtr<cSharedStructureCache> cSharedStructureCachePtr;
+
+
+
+
+
 /** Generates structures in a semi-random grid.
 Defines a grid in the XZ space with predefined cell size in each direction. Each cell then receives exactly
 one structure (provided by the descendant class). The structure is placed within the cell, but doesn't need
@@ -85,6 +94,11 @@ public:
 		int a_MaxStructureSizeX, int a_MaxStructureSizeZ,
 		size_t a_MaxCacheSize
 	);
+
+	/** Makes the generator store the piece layouts of the structures it generates in the specified file, and reuse
+	the layouts stored there earlier, even by the previous server runs, instead of generating them again.
+	Only the descendants that generate their structures using the piece generator make use of this. */
+	void SetLayoutCacheFile(const AString & a_FileName);
 	
 protected:
 	/** Seed for generating grid offsets and also available for descendants. */
@@ -121,10 +135,26 @@ protected:
 	
 	/** Cache for the most recently generated structures, ordered by the recentness. */
 	cStructurePtrs m_Cache;
+
+	/** The on-disk cache of the generated piece layouts, nullptr if not used. Set by SetLayoutCacheFile(). */
+	cStructureLayoutCachePtr m_LayoutCache;
+
+	/** The cache of the structures shared with the other instances of the same generator, nullptr if not used.
+	If used, it replaces m_Cache. Set by UseSharedCache(). */
+	cSharedStructureCachePtr m_SharedCache;
 	
 	
 	/** Clears everything from the cache */
 	void ClearCache(void);
+
+	/** Makes the generator share its structure cache with all the other instances of the same name and parameters
+	(GetLayoutSignature()), so that the generator threads don't each generate the same structures again.
+	Only for the descendants whose structures aren't modified by DrawIntoChunk(), since it is called from several threads at once. */
+	void UseSharedCache(const AString & a_Name);
+
+	/** Creates the structure for the specified grid cell, at its randomly offset origin.
+	Returns a cEmptyStructure if the descendant doesn't create any. */
+	cStructurePtr CreateStructureForCell(int a_GridX, int a_GridZ);
 	
 	/** Returns all structures that may intersect the given chunk.
 	The structures are considered as intersecting iff their bounding box (defined by m_MaxStructureSize)
@@ -137,6 +167,10 @@ protected:
 	// Functions for the descendants to override:
 	/** Create a new structure at the specified gridpoint */
 	virtual cStructurePtr CreateStructure(int a_GridX, int a_GridZ, int a_OriginX, int a_OriginZ) = 0;
+
+	/** Returns the signature of the generator's parameters that the generated layouts depend on, for m_LayoutCache and m_SharedCache.
+	The base class covers the seed and the grid; the descendants using either cache add their own parameters. */
+	virtual UInt32 GetLayoutSignature(void) const;
 } ;
 
 
@@ -105,17 +105,17 @@ void cHeiGenFlat::InitializeHeightGen(cIniFile & a_IniFile)
 cHeiGenCache::cHeiGenCache(cTerrainHeightGenPtr a_HeiGenToCache, int a_CacheSize) :
 	m_HeiGenToCache(a_HeiGenToCache),
 	m_CacheSize(a_CacheSize),
-	m_CacheOrder(new int[a_CacheSize]),
 	m_CacheData(new sCacheData[a_CacheSize]),
+	m_ClockHand(0),
 	m_NumHits(0),
 	m_NumMisses(0),
 	m_TotalChain(0)
 {
 	for (int i = 0; i < m_CacheSize; i++)
 	{
-		m_CacheOrder[i] = i;
 		m_CacheData[i].m_ChunkX = 0x7fffffff;
 		m_CacheData[i].m_ChunkZ = 0x7fffffff;
+		m_CacheData[i].m_IsReferenced = false;
 	}
 }
 
@@ -127,8 +127,18 @@ cHeiGenCache::~cHeiGenCache()
 {
 	delete[] m_CacheData;
 	m_CacheData = nullptr;
-	delete[] m_CacheOrder;
-	m_CacheOrder = nullptr;
+}
+
+
+
+
+
+bool cHeiGenCache::AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const
+{
+	a_NumHits += static_cast<UInt64>(m_NumHits);
+	a_NumMisses += static_cast<UInt64>(m_NumMisses);
+	a_NumBytes += static_cast<UInt64>(m_CacheSize) * sizeof(sCacheData);
+	return true;
 }
 
 
@@ -147,45 +157,28 @@ void cHeiGenCache::GenHeightMap(int a_ChunkX, int a_ChunkZ, cChunkDef::HeightMap
 	
 	for (int i = 0; i < m_CacheSize; i++)
 	{
-		if (
-			(m_CacheData[m_CacheOrder[i]].m_ChunkX != a_ChunkX) ||
-			(m_CacheData[m_CacheOrder[i]].m_ChunkZ != a_ChunkZ)
-		)
+		if ((m_CacheData[i].m_ChunkX != a_ChunkX) || (m_CacheData[i].m_ChunkZ != a_ChunkZ))
 		{
 			continue;
 		}
-		// Found it in the cache
-		int Idx = m_CacheOrder[i];
-		
-		// Move to front:
-		for (int j = i; j > 0; j--)
-		{
-			m_CacheOrder[j] = m_CacheOrder[j - 1];
-		}
-		m_CacheOrder[0] = Idx;
-		
-		// Use the cached data:
-		memcpy(a_HeightMap, m_CacheData[Idx].m_HeightMap, sizeof(a_HeightMap));
-		
+		// Found it in the cache, use the cached data:
+		m_CacheData[i].m_IsReferenced = true;
+		memcpy(a_HeightMap, m_CacheData[i].m_HeightMap, sizeof(a_HeightMap));
 		m_NumHits++;
 		m_TotalChain += i;
 		return;
 	}  // for i - cache
-	
-	// Not in the cache:
 	m_NumMisses++;
+	
+	// Not in the cache, generate:
 	m_HeiGenToCache->GenHeightMap(a_ChunkX, a_ChunkZ, a_HeightMap);
 	
-	// Insert it as the first item in the MRU order:
-	int Idx = m_CacheOrder[m_CacheSize - 1];
-	for (int i = m_CacheSize - 1; i > 0; i--)
-	{
-		m_CacheOrder[i] = m_CacheOrder[i - 1];
-	}  // for i - m_CacheOrder[]
-	m_CacheOrder[0] = Idx;
+	// Replace an item not referenced recently:
+	int Idx = GetReplacementIdx();
 	memcpy(m_CacheData[Idx].m_HeightMap, a_HeightMap, sizeof(a_HeightMap));
 	m_CacheData[Idx].m_ChunkX = a_ChunkX;
 	m_CacheData[Idx].m_ChunkZ = a_ChunkZ;
+	m_CacheData[Idx].m_IsReferenced = false;
 }
 
 
@@ -198,6 +191,7 @@ bool cHeiGenCache::GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_Rel
 	{
 		if ((m_CacheData[i].m_ChunkX == a_ChunkX) && (m_CacheData[i].m_ChunkZ == a_ChunkZ))
 		{
+			m_CacheData[i].m_IsReferenced = true;
 			a_Height = cChunkDef::GetHeight(m_CacheData[i].m_HeightMap, a_RelX, a_RelZ);
 			return true;
 		}
@@ -209,6 +203,25 @@ bool cHeiGenCache::GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_Rel
 
 
 
+int cHeiGenCache::GetReplacementIdx(void)
+{
+	// Give each referenced item a second chance; terminates at the latest after a full round of clearing the flags:
+	for (;;)
+	{
+		int Idx = m_ClockHand;
+		m_ClockHand = (m_ClockHand + 1) % m_CacheSize;
+		if (!m_CacheData[Idx].m_IsReferenced)
+		{
+			return Idx;
+		}
+		m_CacheData[Idx].m_IsReferenced = false;
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cHeiGenMultiCache:
 
@@ -240,6 +253,19 @@ void cHeiGenMultiCache::GenHeightMap(int a_ChunkX, int a_ChunkZ, cChunkDef::Heig
 
 
 
+bool cHeiGenMultiCache::AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const
+{
+	for (const auto & Cache: m_SubCaches)
+	{
+		Cache->AddCacheStats(a_NumHits, a_NumMisses, a_NumBytes);
+	}
+	return true;
+}
+
+
+
+
+
 bool cHeiGenMultiCache::GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height)
 {
 	// Get the subcache responsible for this chunk:
@@ -516,19 +542,99 @@ void cHeiGenBiomal::GenHeightMap(int a_ChunkX, int a_ChunkZ, cChunkDef::HeightMa
 	resulting in speed DEcrease.
 	*/
 	
-	//*
-	// Linearly interpolate 4x4 blocks of heightmap:
+	// The heights are sampled each 4 blocks and linearly interpolated in between:
 	// Must be done on a floating point datatype, else the results are ugly!
 	const int STEPZ = 4;  // Must be a divisor of 16
 	const int STEPX = 4;  // Must be a divisor of 16
+	const int NUM_SAMPLES_X = 16 / STEPX + 1;
+	
+	// Each sample's height is blended from the biomes in its 17x17 neighborhood, weighted by (9 - |dx|) + (9 - |dz|).
+	// The weight is a sum of an X and a Z part, so the neighborhood is counted in two passes: first each row of the
+	// neighborhoods is counted for each sample X (both the plain count and the X-weighted count of each biome in the row),
+	// then each sample adds up its 17 rows, weighting the rows' plain counts by the Z part.
+	const int RADIUS = 8;
+	const int GRID_SIZE = 16 + 2 * RADIUS + 1;  // The rows and columns covered by the neighborhoods, from -RADIUS to 16 + RADIUS
+	struct sRowCounts
+	{
+		int m_NumBiomes;
+		int m_Biomes[2 * RADIUS + 1];
+		int m_Counts[2 * RADIUS + 1];          // Number of the biome's columns in the row
+		int m_WeightedCounts[2 * RADIUS + 1];  // Sum of the (9 - |dx|) weights of the biome's columns in the row
+	} ;
+	sRowCounts RowCounts[GRID_SIZE][NUM_SAMPLES_X];
+	for (int Row = 0; Row < GRID_SIZE; Row++)
+	{
+		int FinalZ = Row - RADIUS + cChunkDef::Width;
+		int IdxZ = FinalZ / cChunkDef::Width;
+		int ModZ = FinalZ % cChunkDef::Width;
+		for (int SampleX = 0; SampleX < NUM_SAMPLES_X; SampleX++)
+		{
+			sRowCounts & Counts = RowCounts[Row][SampleX];
+			Counts.m_NumBiomes = 0;
+			for (int x = -RADIUS; x <= RADIUS; x++)
+			{
+				int FinalX = SampleX * STEPX + x + cChunkDef::Width;
+				int Biome = cChunkDef::GetBiome(Biomes[FinalX / cChunkDef::Width][IdxZ], FinalX % cChunkDef::Width, ModZ);
+				int Idx = 0;
+				while ((Idx < Counts.m_NumBiomes) && (Counts.m_Biomes[Idx] != Biome))
+				{
+					Idx++;
+				}
+				if (Idx == Counts.m_NumBiomes)
+				{
+					Counts.m_Biomes[Idx] = Biome;
+					Counts.m_Counts[Idx] = 0;
+					Counts.m_WeightedCounts[Idx] = 0;
+					Counts.m_NumBiomes += 1;
+				}
+				Counts.m_Counts[Idx] += 1;
+				Counts.m_WeightedCounts[Idx] += RADIUS + 1 - abs(x);
+			}  // for x
+		}  // for SampleX
+	}  // for Row
+	
+	// Sum up the rows of each sample's neighborhood and calculate the sample's height:
 	NOISE_DATATYPE Height[17 * 17];
+	int BiomeWeights[256];
+	memset(BiomeWeights, 0, sizeof(BiomeWeights));
+	sBiomeWeight Weights[256];
 	for (int z = 0; z < 17; z += STEPZ)
 	{
 		for (int x = 0; x < 17; x += STEPX)
 		{
-			Height[x + 17 * z] = GetHeightAt(x, z, a_ChunkX, a_ChunkZ, Biomes);
-		}
-	}
+			size_t NumWeights = 0;
+			int Sum = 0;
+			for (int dz = -RADIUS; dz <= RADIUS; dz++)
+			{
+				const sRowCounts & Counts = RowCounts[z + dz + RADIUS][x / STEPX];
+				int WeightZ = RADIUS + 1 - abs(dz);
+				for (int i = 0; i < Counts.m_NumBiomes; i++)
+				{
+					int Biome = Counts.m_Biomes[i];
+					if (BiomeWeights[Biome] == 0)
+					{
+						Weights[NumWeights++].m_Biome = Biome;
+					}
+					int Weight = Counts.m_WeightedCounts[i] + WeightZ * Counts.m_Counts[i];
+					BiomeWeights[Biome] += Weight;
+					Sum += Weight;
+				}
+			}  // for dz
+			
+			// Blend in the biome order, so that the floating-point sum doesn't depend on the order of the neighbors:
+			std::sort(Weights, Weights + NumWeights, [](const sBiomeWeight & a_First, const sBiomeWeight & a_Second)
+				{
+					return (a_First.m_Biome < a_Second.m_Biome);
+				}
+			);
+			for (size_t i = 0; i < NumWeights; i++)
+			{
+				Weights[i].m_Weight = BiomeWeights[Weights[i].m_Biome];
+				BiomeWeights[Weights[i].m_Biome] = 0;
+			}
+			Height[x + 17 * z] = GetHeightAt(a_ChunkX * cChunkDef::Width + x, a_ChunkZ * cChunkDef::Width + z, Weights, NumWeights, Sum);
+		}  // for x
+	}  // for z
 	LinearUpscale2DArrayInPlace<17, 17, STEPX, STEPZ>(Height);
 	
 	// Copy into the heightmap
@@ -539,18 +645,6 @@ void cHeiGenBiomal::GenHeightMap(int a_ChunkX, int a_ChunkZ, cChunkDef::HeightMa
 			cChunkDef::SetHeight(a_HeightMap, x, z, (int)Height[x + 17 * z]);
 		}
 	}
-	//*/
-	
-	/*
-	// For each height, go through neighboring biomes and add up their idea of height:
-	for (int z = 0; z < cChunkDef::Width; z++)
-	{
-		for (int x = 0; x < cChunkDef::Width; x++)
-		{
-			cChunkDef::SetHeight(a_HeightMap, x, z, GetHeightAt(x, z, a_ChunkX, a_ChunkZ, Biomes));
-		}  // for x
-	}
-	//*/
 }
 
 
@@ -566,42 +660,17 @@ void cHeiGenBiomal::InitializeHeightGen(cIniFile & a_IniFile)
 
 
 
-NOISE_DATATYPE cHeiGenBiomal::GetHeightAt(int a_RelX, int a_RelZ, int a_ChunkX, int a_ChunkZ, const cHeiGenBiomal::BiomeNeighbors & a_BiomeNeighbors)
+NOISE_DATATYPE cHeiGenBiomal::GetHeightAt(int a_BlockX, int a_BlockZ, const sBiomeWeight * a_Weights, size_t a_NumWeights, int a_Sum)
 {
-	// Sum up how many biomes of each type there are in the neighborhood:
-	int BiomeCounts[256];
-	memset(BiomeCounts, 0, sizeof(BiomeCounts));
-	int Sum = 0;
-	for (int z = -8; z <= 8; z++)
-	{
-		int FinalZ = a_RelZ + z + cChunkDef::Width;
-		int IdxZ = FinalZ / cChunkDef::Width;
-		int ModZ = FinalZ % cChunkDef::Width;
-		int WeightZ = 9 - abs(z);
-		for (int x = -8; x <= 8; x++)
-		{
-			int FinalX = a_RelX + x + cChunkDef::Width;
-			int IdxX = FinalX / cChunkDef::Width;
-			int ModX = FinalX % cChunkDef::Width;
-			EMCSBiome Biome = cChunkDef::GetBiome(a_BiomeNeighbors[IdxX][IdxZ], ModX, ModZ);
-			int WeightX = 9 - abs(x);
-			BiomeCounts[Biome] += WeightX + WeightZ;
-			Sum += WeightX + WeightZ;
-		}  // for x
-	}  // for z
-	
-	// For each biome type that has a nonzero count, calc its height and add it:
-	if (Sum > 0)
+	// For each biome type in the neighborhood, calc its height and add it:
+	if (a_Sum > 0)
 	{
 		NOISE_DATATYPE Height = 0;
-		int BlockX = a_ChunkX * cChunkDef::Width + a_RelX;
-		int BlockZ = a_ChunkZ * cChunkDef::Width + a_RelZ;
-		for (size_t i = 0; i < ARRAYCOUNT(BiomeCounts); i++)
+		int BlockX = a_BlockX;
+		int BlockZ = a_BlockZ;
+		for (size_t w = 0; w < a_NumWeights; w++)
 		{
-			if (BiomeCounts[i] == 0)
-			{
-				continue;
-			}
+			int i = a_Weights[w].m_Biome;
 			
 			/*
 			// Sanity checks for biome parameters, enable them to check the biome param table in runtime (slow):
@@ -616,9 +685,9 @@ NOISE_DATATYPE cHeiGenBiomal::GetHeightAt(int a_RelX, int a_RelZ, int a_ChunkX,
 			NOISE_DATATYPE oct1 = m_Noise.CubicNoise2D(BlockX * m_GenParam[i].m_HeightFreq1, BlockZ * m_GenParam[i].m_HeightFreq1) * m_GenParam[i].m_HeightAmp1;
 			NOISE_DATATYPE oct2 = m_Noise.CubicNoise2D(BlockX * m_GenParam[i].m_HeightFreq2, BlockZ * m_GenParam[i].m_HeightFreq2) * m_GenParam[i].m_HeightAmp2;
 			NOISE_DATATYPE oct3 = m_Noise.CubicNoise2D(BlockX * m_GenParam[i].m_HeightFreq3, BlockZ * m_GenParam[i].m_HeightFreq3) * m_GenParam[i].m_HeightAmp3;
-			Height += BiomeCounts[i] * (m_GenParam[i].m_BaseHeight + oct1 + oct2 + oct3);
+			Height += a_Weights[w].m_Weight * (m_GenParam[i].m_BaseHeight + oct1 + oct2 + oct3);
 		}
-		NOISE_DATATYPE res = Height / Sum;
+		NOISE_DATATYPE res = Height / a_Sum;
 		return std::min((NOISE_DATATYPE)250, std::max(res, (NOISE_DATATYPE)5));
 	}
 	
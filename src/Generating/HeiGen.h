@@ -23,7 +23,11 @@ Also implements the heightmap cache
 
 
 
-/** A simple cache that stores N most recently generated chunks' heightmaps; N being settable upon creation */
+/** A simple cache that stores N recently generated chunks' heightmaps; N being settable upon creation.
+The items to replace are chosen using the CLOCK algorithm, so that a hit only sets a flag instead of reordering the cache.
+The cache is not thread-safe and needs no locking: each generator worker owns its own cGenerator and therefore its own caches,
+and the cChunkGenerator serializes the access to its shared generator instance (see cChunkGenerator::m_CSSharedGenerator).
+The only caches shared between the workers are cSharedStructureCache and cStructureLayoutCache, which have their own locks. */
 class cHeiGenCache :
 	public cTerrainHeightGen
 {
@@ -33,6 +37,7 @@ public:
 	
 	// cTerrainHeightGen overrides:
 	virtual void GenHeightMap(int a_ChunkX, int a_ChunkZ, cChunkDef::HeightMap & a_HeightMap) override;
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const override;
 	
 	/** Retrieves height at the specified point in the cache, returns true if found, false if not found */
 	bool GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height);
@@ -42,28 +47,34 @@ protected:
 	{
 		int m_ChunkX;
 		int m_ChunkZ;
+		bool m_IsReferenced;  // Set on each hit, cleared when the clock hand passes the item; items not referenced get replaced
 		cChunkDef::HeightMap m_HeightMap;
 	} ;
 	
 	/** The terrain height generator that is being cached. */
 	cTerrainHeightGenPtr m_HeiGenToCache;
 	
-	// To avoid moving large amounts of data for the MRU behavior, we MRU-ize indices to an array of the actual data
 	int          m_CacheSize;
-	int *        m_CacheOrder;  // MRU-ized order, indices into m_CacheData array
-	sCacheData * m_CacheData;   // m_CacheData[m_CacheOrder[0]] is the most recently used
+	sCacheData * m_CacheData;
+	
+	/** The index of the next item to be considered for replacement. */
+	int          m_ClockHand;
 	
 	// Cache statistics
 	int m_NumHits;
 	int m_NumMisses;
 	int m_TotalChain;  // Number of cache items walked to get to a hit (only added for hits)
+	
+	/** Returns the index of the item to be replaced by a new one, and advances the clock hand past it. */
+	int GetReplacementIdx(void);
 } ;
 
 
 
 
 
-/** Caches heightmaps in multiple underlying caches to improve the distribution and lower the chain length. */
+/** Caches heightmaps in multiple underlying caches to improve the distribution and lower the chain length.
+Like cHeiGenCache, the multicache is used by a single thread at a time and needs no locking. */
 class cHeiGenMultiCache:
 	public cTerrainHeightGen
 {
@@ -72,6 +83,7 @@ public:
 
 	// cTerrainHeightGen overrides:
 	virtual void GenHeightMap(int a_ChunkX, int a_ChunkZ, cChunkDef::HeightMap & a_HeightMap) override;
+	virtual bool AddCacheStats(UInt64 & a_NumHits, UInt64 & a_NumMisses, UInt64 & a_NumBytes) const override;
 	
 	/** Retrieves height at the specified point in the cache, returns true if found, false if not found */
 	bool GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height);
@@ -192,8 +204,17 @@ protected:
 	} ;
 	static const sGenParam m_GenParam[256];
 
+	/** The weight of a single biome in a sample's neighborhood. */
+	struct sBiomeWeight
+	{
+		int m_Biome;
+		int m_Weight;
+	} ;
+
 
-	NOISE_DATATYPE GetHeightAt(int a_RelX, int a_RelZ, int a_ChunkX, int a_ChunkZ, const BiomeNeighbors & a_BiomeNeighbors);
+	/** Returns the height at the specified block, blended from the biomes' heights by their weights in the neighborhood.
+	a_Weights are sorted by the biome, a_Sum is the sum of all the weights. */
+	NOISE_DATATYPE GetHeightAt(int a_BlockX, int a_BlockZ, const sBiomeWeight * a_Weights, size_t a_NumWeights, int a_Sum);
 } ;
 
 
@@ -283,38 +283,39 @@ public:
 		int lowerMinZ = a_MinZ >> 1;
 		int lowerData[m_LowerSizeX * m_LowerSizeZ];
 		m_UnderlyingGen->GetInts(lowerMinX, lowerMinZ, lowerData);
-		const int lowStepX = (m_LowerSizeX - 1) * 2;
-		const int lowStepZ = (m_LowerSizeZ - 1) * 2;
-		int cache[lowStepX * lowStepZ];
 
-		// Discreet-interpolate the values into twice the size:
-		for (int z = 0; z < m_LowerSizeZ - 1; ++z)
-		{
-			int idx = (z * 2) * lowStepX;
-			int PrevZ0 = lowerData[z * m_LowerSizeX];
-			int PrevZ1 = lowerData[(z + 1) * m_LowerSizeX];
-
-			for (int x = 0; x < m_LowerSizeX - 1; ++x)
-			{
-				int ValX1Z0 = lowerData[x + 1 + z * m_LowerSizeX];
-				int ValX1Z1 = lowerData[x + 1 + (z + 1) * m_LowerSizeX];
-				int RndX = (x + lowerMinX) * 2;
-				int RndZ = (z + lowerMinZ) * 2;
-				cache[idx] = PrevZ0;
-				cache[idx + lowStepX] = super::ChooseRandomOne(RndX, RndZ + 1, PrevZ0, PrevZ1);
-				cache[idx + 1]        = super::ChooseRandomOne(RndX, RndZ - 1, PrevZ0, ValX1Z0);
-				cache[idx + 1 + lowStepX] = super::ChooseRandomOne(RndX, RndZ, PrevZ0, ValX1Z0, PrevZ1, ValX1Z1);
-				idx += 2;
-				PrevZ0 = ValX1Z0;
-				PrevZ1 = ValX1Z1;
-			}
-		}
-
-		// Copy from Cache into a_Values; take into account the even / odd offsets in a_Min:
+		// Discreet-interpolate the values into twice the size, directly into a_Values.
+		// Only the values inside the requested area are calculated; take into account the even / odd offsets in a_Min:
+		const int OffsetX = a_MinX & 1;
+		const int OffsetZ = a_MinZ & 1;
 		for (int z = 0; z < SizeZ; ++z)
 		{
-			memcpy(a_Values + z * SizeX, cache + (z + (a_MinZ & 1)) * lowStepX + (a_MinX & 1), SizeX * sizeof(int));
-		}
+			int ZoomedZ = z + OffsetZ;
+			int LowerZ = ZoomedZ >> 1;
+			int RndZ = (LowerZ + lowerMinZ) * 2;
+			const int * LowerRow0 = lowerData + LowerZ * m_LowerSizeX;
+			const int * LowerRow1 = LowerRow0 + m_LowerSizeX;
+			int * Dest = a_Values + z * SizeX;
+			for (int x = 0; x < SizeX; ++x)
+			{
+				int ZoomedX = x + OffsetX;
+				int LowerX = ZoomedX >> 1;
+				int RndX = (LowerX + lowerMinX) * 2;
+				int Val = LowerRow0[LowerX];
+				if ((ZoomedZ & 1) == 0)
+				{
+					Dest[x] = ((ZoomedX & 1) == 0) ? Val : super::ChooseRandomOne(RndX, RndZ - 1, Val, LowerRow0[LowerX + 1]);
+				}
+				else if ((ZoomedX & 1) == 0)
+				{
+					Dest[x] = super::ChooseRandomOne(RndX, RndZ + 1, Val, LowerRow1[LowerX]);
+				}
+				else
+				{
+					Dest[x] = super::ChooseRandomOne(RndX, RndZ, Val, LowerRow0[LowerX + 1], LowerRow1[LowerX], LowerRow1[LowerX + 1]);
+				}
+			}  // for x
+		}  // for z
 	}
 
 protected:
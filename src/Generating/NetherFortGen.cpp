@@ -26,7 +26,7 @@ public:
 	cPlacedPieces m_Pieces;
 
 
-	cNetherFort(cNetherFortGen & a_ParentGen, int a_GridX, int a_GridZ, int a_OriginX, int a_OriginZ, int a_GridSize, int a_MaxDepth, int a_Seed) :
+	cNetherFort(cNetherFortGen & a_ParentGen, int a_GridX, int a_GridZ, int a_OriginX, int a_OriginZ, int a_GridSize, int a_MaxDepth, int a_Seed, cStructureLayoutCache * a_LayoutCache) :
 		super(a_GridX, a_GridZ, a_OriginX, a_OriginZ),
 		m_ParentGen(a_ParentGen),
 		m_GridSize(a_GridSize),
@@ -35,12 +35,20 @@ public:
 		// TODO: Proper Y-coord placement
 		int BlockY = 64;
 		
-		// Generate pieces:
+		// Generate pieces, unless they have been generated before:
+		if ((a_LayoutCache != nullptr) && a_LayoutCache->LoadLayout(a_GridX, a_GridZ, cNetherFortGen::m_PiecePool, m_Pieces))
+		{
+			return;
+		}
 		for (int i = 0; m_Pieces.size() < (size_t)(a_MaxDepth * a_MaxDepth / 8 + a_MaxDepth); i++)
 		{
 			cBFSPieceGenerator pg(cNetherFortGen::m_PiecePool, a_Seed + i);
 			pg.PlacePieces(a_OriginX, BlockY, a_OriginZ, a_MaxDepth, m_Pieces);
 		}
+		if (a_LayoutCache != nullptr)
+		{
+			a_LayoutCache->StoreLayout(a_GridX, a_GridZ, cNetherFortGen::m_PiecePool, m_Pieces);
+		}
 	}
 
 	
@@ -126,7 +134,18 @@ cNetherFortGen::cNetherFortGen(int a_Seed, int a_GridSize, int a_MaxOffset, int
 
 cGridStructGen::cStructurePtr cNetherFortGen::CreateStructure(int a_GridX, int a_GridZ, int a_OriginX, int a_OriginZ)
 {
-	return cStructurePtr(new cNetherFort(*this, a_GridX, a_GridZ, a_OriginX, a_OriginZ, m_GridSizeX, m_MaxDepth, m_Seed));
+	return cStructurePtr(new cNetherFort(*this, a_GridX, a_GridZ, a_OriginX, a_OriginZ, m_GridSizeX, m_MaxDepth, m_Seed, m_LayoutCache.get()));
+}
+
+
+
+
+
+UInt32 cNetherFortGen::GetLayoutSignature(void) const
+{
+	UInt32 Signature = super::GetLayoutSignature();
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxDepth);
+	return Signature;
 }
 
 
@@ -146,6 +146,25 @@ public:
 
 
 
+/** Upscales the 33 x 5 x 5 density lattice [y + 33 * x + 33 * 5 * z] of the composable 3D noise shape generators
+into the chunk's shape, air (0) where the density is above a_AirThreshold and solid (1) elsewhere. */
+static void UpscaleIntoShape(const NOISE_DATATYPE * a_Lattice, NOISE_DATATYPE a_AirThreshold, cChunkDesc::Shape & a_Shape)
+{
+	Byte Shape[257 * 17 * 17];  // y + 257 * x + 257 * 17 * z
+	LinearUpscale3DArrayThreshold<NOISE_DATATYPE, Byte>(a_Lattice, 33, 5, 5, Shape, 8, 4, 4, a_AirThreshold, 0, 1);
+	for (int z = 0; z < cChunkDef::Width; z++)
+	{
+		for (int x = 0; x < cChunkDef::Width; x++)
+		{
+			memcpy(a_Shape + x * 256 + z * 256 * 16, Shape + 257 * x + 257 * 17 * z, cChunkDef::Height);
+		}
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cNoise3DGenerator:
 
@@ -210,8 +229,8 @@ void cNoise3DGenerator::GenerateBiomes(int a_ChunkX, int a_ChunkZ, cChunkDef::Bi
 
 void cNoise3DGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a_ChunkDesc)
 {
-	NOISE_DATATYPE Noise[17 * 257 * 17];
-	GenerateNoiseArray(a_ChunkX, a_ChunkZ, Noise);
+	Byte IsAir[17 * 257 * 17];
+	GenerateNoiseArray(a_ChunkX, a_ChunkZ, IsAir);
 
 	// Output noise into chunk:
 	for (int z = 0; z < cChunkDef::Width; z++)
@@ -221,9 +240,8 @@ void cNoise3DGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a_Ch
 			int idx = z * 17 * 257 + y * 17;
 			for (int x = 0; x < cChunkDef::Width; x++)
 			{
-				NOISE_DATATYPE n = Noise[idx++];
 				BLOCKTYPE BlockType;
-				if (n > m_AirThreshold)
+				if (IsAir[idx++] != 0)
 				{
 					BlockType = (y > m_SeaLevel) ? E_BLOCK_AIR : E_BLOCK_STATIONARY_WATER;
 				}
@@ -244,7 +262,7 @@ void cNoise3DGenerator::DoGenerate(int a_ChunkX, int a_ChunkZ, cChunkDesc & a_Ch
 
 
 
-void cNoise3DGenerator::GenerateNoiseArray(int a_ChunkX, int a_ChunkZ, NOISE_DATATYPE * a_OutNoise)
+void cNoise3DGenerator::GenerateNoiseArray(int a_ChunkX, int a_ChunkZ, Byte * a_IsAir)
 {
 	NOISE_DATATYPE NoiseO[DIM_X * DIM_Y * DIM_Z];  // Output for the Perlin noise
 	NOISE_DATATYPE NoiseW[DIM_X * DIM_Y * DIM_Z];  // Workspace that the noise calculation can use and trash
@@ -286,13 +304,12 @@ void cNoise3DGenerator::GenerateNoiseArray(int a_ChunkX, int a_ChunkZ, NOISE_DAT
 
 	// DEBUG: Debug3DNoise(NoiseO, DIM_X, DIM_Y, DIM_Z, Printf("Chunk_%d_%d_hei", a_ChunkX, a_ChunkZ));
 
-	// Upscale the Perlin noise into full-blown chunk dimensions:
-	LinearUpscale3DArray(
+	// Upscale the Perlin noise into full-blown chunk dimensions, interpolating only near the surface:
+	LinearUpscale3DArrayThreshold<NOISE_DATATYPE, Byte>(
 		NoiseO, DIM_X, DIM_Y, DIM_Z,
-		a_OutNoise, UPSCALE_X, UPSCALE_Y, UPSCALE_Z
+		a_IsAir, UPSCALE_X, UPSCALE_Y, UPSCALE_Z,
+		m_AirThreshold, 1, 0
 	);
-
-	// DEBUG: Debug3DNoise(a_OutNoise, 17, 257, 17, Printf("Chunk_%d_%d_lerp", a_ChunkX, a_ChunkZ));
 }
 
 
@@ -457,7 +474,7 @@ void cNoise3DComposable::GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_ChunkZ)
 {
 	if ((a_ChunkX == m_LastChunkX) && (a_ChunkZ == m_LastChunkZ))
 	{
-		// The noise for this chunk is already generated in m_NoiseArray
+		// The shape for this chunk is already generated in m_Shape
 		return;
 	}
 	m_LastChunkX = a_ChunkX;
@@ -505,7 +522,7 @@ void cNoise3DComposable::GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_ChunkZ)
 			}
 		}
 	}
-	LinearUpscale3DArray<NOISE_DATATYPE>(Workspace, 33, 5, 5, m_NoiseArray, 8, 4, 4);
+	UpscaleIntoShape(Workspace, m_AirThreshold, m_Shape);
 }
 
 
@@ -515,18 +532,7 @@ void cNoise3DComposable::GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_ChunkZ)
 void cNoise3DComposable::GenShape(int a_ChunkX, int a_ChunkZ, cChunkDesc::Shape & a_Shape)
 {
 	GenerateNoiseArrayIfNeeded(a_ChunkX, a_ChunkZ);
-
-	// Translate the noise array into Shape:
-	for (int z = 0; z < cChunkDef::Width; z++)
-	{
-		for (int x = 0; x < cChunkDef::Width; x++)
-		{
-			for (int y = 0; y < cChunkDef::Height; y++)
-			{
-				a_Shape[y + x * 256 + z * 256 * 16] = (m_NoiseArray[y + 257 * x + 257 * 17 * z] > m_AirThreshold) ? 0 : 1;
-			}
-		}  // for x
-	}  // for z
+	memcpy(a_Shape, m_Shape, sizeof(a_Shape));
 }
 
 
@@ -617,7 +623,7 @@ void cBiomalNoise3DComposable::GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_Ch
 {
 	if ((a_ChunkX == m_LastChunkX) && (a_ChunkZ == m_LastChunkZ))
 	{
-		// The noise for this chunk is already generated in m_NoiseArray
+		// The shape for this chunk is already generated in m_Shape
 		return;
 	}
 	m_LastChunkX = a_ChunkX;
@@ -671,7 +677,7 @@ void cBiomalNoise3DComposable::GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_Ch
 			}
 		}
 	}
-	LinearUpscale3DArray<NOISE_DATATYPE>(Workspace, 33, 5, 5, m_NoiseArray, 8, 4, 4);
+	UpscaleIntoShape(Workspace, m_AirThreshold, m_Shape);
 }
 
 
@@ -806,18 +812,7 @@ void cBiomalNoise3DComposable::GetBiomeParams(EMCSBiome a_Biome, NOISE_DATATYPE
 void cBiomalNoise3DComposable::GenShape(int a_ChunkX, int a_ChunkZ, cChunkDesc::Shape & a_Shape)
 {
 	GenerateNoiseArrayIfNeeded(a_ChunkX, a_ChunkZ);
-
-	// Translate the noise array into Shape:
-	for (int z = 0; z < cChunkDef::Width; z++)
-	{
-		for (int x = 0; x < cChunkDef::Width; x++)
-		{
-			for (int y = 0; y < cChunkDef::Height; y++)
-			{
-				a_Shape[y + x * 256 + z * 256 * 16] = (m_NoiseArray[y + 257 * x + 257 * 17 * z] > m_AirThreshold) ? 0 : 1;
-			}
-		}  // for x
-	}  // for z
+	memcpy(a_Shape, m_Shape, sizeof(a_Shape));
 }
 
 
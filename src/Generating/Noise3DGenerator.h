@@ -58,8 +58,9 @@ protected:
 	NOISE_DATATYPE m_FrequencyZ;
 	NOISE_DATATYPE m_AirThreshold;
 	
-	/// Generates the 3D noise array used for terrain generation; a_Noise is of ChunkData-size
-	void GenerateNoiseArray(int a_ChunkX, int a_ChunkZ, NOISE_DATATYPE * a_Noise);
+	/** Generates the 3D noise array used for terrain generation and thresholds it into a_IsAir, 1 for air and 0 for solid.
+	a_IsAir is [x + 17 * y + 17 * 257 * z], only the blocks near the surface are interpolated from the noise. */
+	void GenerateNoiseArray(int a_ChunkX, int a_ChunkZ, Byte * a_IsAir);
 	
 	/// Updates heightmap based on the chunk's contents
 	void UpdateHeightmap(cChunkDesc & a_ChunkDesc);
@@ -120,10 +121,10 @@ protected:
 	// Cache for the last calculated chunk (reused between heightmap and composition queries):
 	int m_LastChunkX;
 	int m_LastChunkZ;
-	NOISE_DATATYPE m_NoiseArray[17 * 17 * 257];  // x + 17 * z + 17 * 17 * y
+	cChunkDesc::Shape m_Shape;  // y + 256 * x + 256 * 16 * z
 	
 	
-	/** Generates the 3D noise array used for terrain generation (m_NoiseArray), unless the LastChunk coords are equal to coords given */
+	/** Generates the 3D noise array used for terrain generation and thresholds it into m_Shape, unless the LastChunk coords are equal to coords given */
 	void GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_ChunkZ);
 	
 	// cTerrainHeightGen overrides:
@@ -189,7 +190,7 @@ protected:
 	// Cache for the last calculated chunk (reused between heightmap and composition queries):
 	int m_LastChunkX;
 	int m_LastChunkZ;
-	NOISE_DATATYPE m_NoiseArray[17 * 17 * 257];  // 257 * x + y + 257 * 17 * z
+	cChunkDesc::Shape m_Shape;  // y + 256 * x + 256 * 16 * z
 
 	/** Weights for summing up neighboring biomes. */
 	NOISE_DATATYPE m_Weight[AVERAGING_SIZE * 2 + 1][AVERAGING_SIZE * 2 + 1];
@@ -198,7 +199,7 @@ protected:
 	NOISE_DATATYPE m_WeightSum;
 	
 	
-	/** Generates the 3D noise array used for terrain generation (m_NoiseArray), unless the LastChunk coords are equal to coords given */
+	/** Generates the 3D noise array used for terrain generation and thresholds it into m_Shape, unless the LastChunk coords are equal to coords given */
 	void GenerateNoiseArrayIfNeeded(int a_ChunkX, int a_ChunkZ);
 
 	/** Calculates the biome-related parameters for the chunk. */
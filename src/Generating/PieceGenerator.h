@@ -136,6 +136,13 @@ public:
 	/** Called when the pool has finished the current structure and should reset any piece-counters it has
 	for a new structure. */
 	virtual void Reset(void) = 0;
+
+	/** Returns the index that identifies a_Piece within the pool, so that its placement can be stored (cStructureLayoutCache).
+	Returns -1 if the piece is not from this pool. Pools that don't support storing the placements return -1 always (default). */
+	virtual int GetPieceIndex(const cPiece & a_Piece) const { return -1; }
+
+	/** Returns the piece that has the specified index, as returned by GetPieceIndex(), or nullptr if there's no such piece. */
+	virtual cPiece * GetPieceAtIndex(int a_Index) const { return nullptr; }
 };
 
 
@@ -156,3 +156,50 @@ void cPrefabPiecePool::Reset(void)
 
 
 
+
+int cPrefabPiecePool::GetPieceIndex(const cPiece & a_Piece) const
+{
+	// The starting pieces are indexed first, then all the other pieces:
+	for (size_t i = 0; i < m_StartingPieces.size(); i++)
+	{
+		if (m_StartingPieces[i] == &a_Piece)
+		{
+			return static_cast<int>(i);
+		}
+	}
+	for (size_t i = 0; i < m_AllPieces.size(); i++)
+	{
+		if (m_AllPieces[i] == &a_Piece)
+		{
+			return static_cast<int>(m_StartingPieces.size() + i);
+		}
+	}
+	return -1;
+}
+
+
+
+
+
+cPiece * cPrefabPiecePool::GetPieceAtIndex(int a_Index) const
+{
+	if (a_Index < 0)
+	{
+		return nullptr;
+	}
+	size_t Index = static_cast<size_t>(a_Index);
+	if (Index < m_StartingPieces.size())
+	{
+		return m_StartingPieces[Index];
+	}
+	Index -= m_StartingPieces.size();
+	if (Index < m_AllPieces.size())
+	{
+		return m_AllPieces[Index];
+	}
+	return nullptr;
+}
+
+
+
+
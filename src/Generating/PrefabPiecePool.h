@@ -78,6 +78,8 @@ protected:
 	virtual int GetStartingPieceWeight(const cPiece & a_NewPiece) override;
 	virtual void PiecePlaced(const cPiece & a_Piece) override;
 	virtual void Reset(void) override;
+	virtual int GetPieceIndex(const cPiece & a_Piece) const override;
+	virtual cPiece * GetPieceAtIndex(int a_Index) const override;
 } ;
 
 
@@ -40,6 +40,7 @@ protected:
 
 	// cGridStructGen overrides:
 	virtual cStructurePtr CreateStructure(int a_GridX, int a_GridZ, int a_OriginX, int a_OriginZ) override;
+	virtual UInt32 GetLayoutSignature(void) const override;
 } ;
 
 
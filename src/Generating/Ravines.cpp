@@ -85,6 +85,8 @@ cStructGenRavines::cStructGenRavines(int a_Seed, int a_Size) :
 	m_Noise(a_Seed),
 	m_Size(a_Size)
 {
+	// The ravines are only read while carving, so all the generator threads can share them:
+	UseSharedCache("Ravines");
 }
 
 
@@ -100,6 +102,17 @@ cGridStructGen::cStructurePtr cStructGenRavines::CreateStructure(int a_GridX, in
 
 
 
+UInt32 cStructGenRavines::GetLayoutSignature(void) const
+{
+	UInt32 Signature = super::GetLayoutSignature();
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_Size);
+	return Signature;
+}
+
+
+
+
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // cStructGenRavines::cRavine
@@ -349,7 +362,15 @@ void cStructGenRavines::cRavine::DrawIntoChunk(cChunkDesc & a_ChunkDesc)
 		int RadiusSq = itr->m_Radius * itr->m_Radius;  // instead of doing sqrt for each distance, we do sqr of the radius
 		int DifX = BlockStartX - itr->m_BlockX;  // substitution for faster calc
 		int DifZ = BlockStartZ - itr->m_BlockZ;  // substitution for faster calc
-		for (int x = 0; x < cChunkDef::Width; x++) for (int z = 0; z < cChunkDef::Width; z++)
+		int Top = std::min(itr->m_Top, cChunkDef::Height - 1);
+		int Bottom = std::max(itr->m_Bottom, 1);
+
+		// Visit only the columns within the radius' bounding box:
+		int MinX = std::max(-DifX - itr->m_Radius, 0);
+		int MaxX = std::min(-DifX + itr->m_Radius, cChunkDef::Width - 1);
+		int MinZ = std::max(-DifZ - itr->m_Radius, 0);
+		int MaxZ = std::min(-DifZ + itr->m_Radius, cChunkDef::Width - 1);
+		for (int x = MinX; x <= MaxX; x++) for (int z = MinZ; z <= MaxZ; z++)
 		{
 			#ifdef _DEBUG
 			// DEBUG: Make the ravine shapepoints visible on a single layer (so that we can see with Minutor what's going on)
@@ -362,8 +383,7 @@ void cStructGenRavines::cRavine::DrawIntoChunk(cChunkDesc & a_ChunkDesc)
 			int DistSq = (DifX + x) * (DifX + x) + (DifZ + z) * (DifZ + z);
 			if (DistSq <= RadiusSq)
 			{
-				int Top = std::min(itr->m_Top, (int)(cChunkDef::Height));  // Stupid gcc needs int cast
-				for (int y = std::max(itr->m_Bottom, 1); y <= Top; y++)
+				for (int y = Bottom; y <= Top; y++)
 				{
 					switch (a_ChunkDesc.GetBlockType(x, y, z))
 					{
@@ -177,7 +177,15 @@ protected:
 			float RadiusSq = (itr->m_Radius + 2) * (itr->m_Radius + 2);
 			float DifX = BlockStartX - itr->m_X;  // substitution for faster calc
 			float DifZ = BlockStartZ - itr->m_Z;  // substitution for faster calc
-			for (int x = 0; x < cChunkDef::Width; x++) for (int z = 0; z < cChunkDef::Width; z++)
+			int Top = std::min((int)ceilf(itr->m_Top), cChunkDef::Height - 1);
+			int Bottom = std::max((int)floorf(itr->m_Bottom), 1);
+
+			// Visit only the columns within the enlarged radius' bounding box:
+			int MinX = std::max((int)floorf(itr->m_X - itr->m_Radius - 2) - BlockStartX, 0);
+			int MaxX = std::min((int)ceilf (itr->m_X + itr->m_Radius + 2) - BlockStartX, cChunkDef::Width - 1);
+			int MinZ = std::max((int)floorf(itr->m_Z - itr->m_Radius - 2) - BlockStartZ, 0);
+			int MaxZ = std::min((int)ceilf (itr->m_Z + itr->m_Radius + 2) - BlockStartZ, cChunkDef::Width - 1);
+			for (int x = MinX; x <= MaxX; x++) for (int z = MinZ; z <= MaxZ; z++)
 			{
 				#ifdef _DEBUG
 				// DEBUG: Make the roughravine shapepoints visible on a single layer (so that we can see with Minutor what's going on)
@@ -194,8 +202,7 @@ protected:
 					continue;
 				}
 				
-				int Top = std::min((int)ceilf(itr->m_Top), +cChunkDef::Height);
-				for (int y = std::max((int)floorf(itr->m_Bottom), 1); y <= Top; y++)
+				for (int y = Bottom; y <= Top; y++)
 				{
 					if ((itr->m_Radius + m_PerHeightRadius[y]) * (itr->m_Radius + m_PerHeightRadius[y]) < DistSq)
 					{
@@ -266,6 +273,9 @@ cRoughRavines::cRoughRavines(
 	{
 		m_MaxSize = m_MinSize + 1;
 	}
+
+	// The ravines are only read while carving, so all the generator threads can share them:
+	UseSharedCache("RoughRavines");
 }
 
 
@@ -298,3 +308,32 @@ cGridStructGen::cStructurePtr cRoughRavines::CreateStructure(int a_GridX, int a_
 
 
 
+
+UInt32 cRoughRavines::GetLayoutSignature(void) const
+{
+	UInt32 Signature = super::GetLayoutSignature();
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxSize);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MinSize);
+	const float Params[] =
+	{
+		m_MaxCenterWidth,         m_MinCenterWidth,
+		m_MaxRoughness,           m_MinRoughness,
+		m_MaxFloorHeightEdge,     m_MinFloorHeightEdge,
+		m_MaxFloorHeightCenter,   m_MinFloorHeightCenter,
+		m_MaxCeilingHeightEdge,   m_MinCeilingHeightEdge,
+		m_MaxCeilingHeightCenter, m_MinCeilingHeightCenter,
+	};
+	for (size_t i = 0; i < ARRAYCOUNT(Params); i++)
+	{
+		// Use the float's bits, so that even a small difference makes a different signature:
+		Int32 Bits;
+		static_assert(sizeof(Bits) == sizeof(Params[i]), "The float needs to fit the signature value");
+		memcpy(&Bits, &Params[i], sizeof(Bits));
+		Signature = cStructureLayoutCache::AddToSignature(Signature, Bits);
+	}
+	return Signature;
+}
+
+
+
+
@@ -0,0 +1,120 @@
+
+// SharedStructureCache.cpp
+
+// Implements the cSharedStructureCache class representing a cache of the grid structures shared by all the generator threads
+
+#include "Globals.h"
+#include "SharedStructureCache.h"
+
+
+
+
+
+/** All the caches currently in use, by their generator name and signature. Protected by g_CSCaches. */
+static std::map<std::pair<AString, UInt32>, WeakPtr<cSharedStructureCache>> g_Caches;
+
+/** Protects g_Caches against multithreaded access. */
+static cCriticalSection g_CSCaches;
+
+
+
+
+
+cSharedStructureCache::cSharedStructureCache(size_t a_MaxCost) :
+	m_Cost(0),
+	m_MaxCost(a_MaxCost)
+{
+}
+
+
+
+
+
+cSharedStructureCachePtr cSharedStructureCache::Get(const AString & a_Name, UInt32 a_Signature, size_t a_MaxCost)
+{
+	cCSLock Lock(g_CSCaches);
+	WeakPtr<cSharedStructureCache> & Weak = g_Caches[std::make_pair(a_Name, a_Signature)];
+	cSharedStructureCachePtr Cache = Weak.lock();
+	if (Cache != nullptr)
+	{
+		cCSLock CacheLock(Cache->m_CS);
+		Cache->m_MaxCost = std::max(Cache->m_MaxCost, a_MaxCost);
+		return Cache;
+	}
+
+	Cache.reset(new cSharedStructureCache(a_MaxCost));
+	Weak = Cache;
+	return Cache;
+}
+
+
+
+
+
+cSharedStructureCache::cStructurePtr cSharedStructureCache::Find(int a_GridX, int a_GridZ)
+{
+	cCSLock Lock(m_CS);
+	cEntries::iterator itr = m_Entries.find(cGridCoords(a_GridX, a_GridZ));
+	if (itr == m_Entries.end())
+	{
+		return cStructurePtr();
+	}
+	m_LRU.splice(m_LRU.begin(), m_LRU, itr->second.m_LRUPos);
+	return itr->second.m_Structure;
+}
+
+
+
+
+
+cSharedStructureCache::cStructurePtr cSharedStructureCache::Add(const cStructurePtr & a_Structure)
+{
+	cCSLock Lock(m_CS);
+	cGridCoords Coords(a_Structure->m_GridX, a_Structure->m_GridZ);
+	cEntries::iterator itr = m_Entries.find(Coords);
+	if (itr != m_Entries.end())
+	{
+		// Another thread has generated the same structure in the meantime, use that one:
+		m_LRU.splice(m_LRU.begin(), m_LRU, itr->second.m_LRUPos);
+		return itr->second.m_Structure;
+	}
+
+	m_LRU.push_front(Coords);
+	sEntry & Entry = m_Entries[Coords];
+	Entry.m_Structure = a_Structure;
+	Entry.m_LRUPos = m_LRU.begin();
+	m_Cost += a_Structure->GetCacheCost();
+	Trim();
+	return a_Structure;
+}
+
+
+
+
+
+size_t cSharedStructureCache::GetNumStructures(void)
+{
+	cCSLock Lock(m_CS);
+	return m_Entries.size();
+}
+
+
+
+
+
+void cSharedStructureCache::Trim(void)
+{
+	// Never drop the most recently used entry, the caller is about to draw it:
+	while ((m_Cost > m_MaxCost) && (m_LRU.size() > 1))
+	{
+		cEntries::iterator itr = m_Entries.find(m_LRU.back());
+		ASSERT(itr != m_Entries.end());
+		m_Cost -= itr->second.m_Structure->GetCacheCost();
+		m_Entries.erase(itr);
+		m_LRU.pop_back();
+	}
+}
+
+
+
+
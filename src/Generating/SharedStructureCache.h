@@ -0,0 +1,82 @@
+
+// SharedStructureCache.h
+
+// Declares the cSharedStructureCache class representing a cache of the grid structures shared by all the generator threads
+
+
+
+
+
+#pragma once
+
+#include "GridStructGen.h"
+
+
+
+
+
+/** A bounded cache of the structures generated by a cGridStructGen descendant, keyed by their grid cell.
+A single instance is shared by all the generator instances with the same parameters (one per generator thread), so that
+each structure is generated only once for all the threads, instead of once per thread. Since the threads draw the same
+structure concurrently, only the structures whose DrawIntoChunk() doesn't modify them may be cached this way.
+When the sum of the cached structures' costs exceeds the limit, the least recently used ones are dropped.
+All the functions are thread-safe. */
+class cSharedStructureCache
+{
+public:
+	typedef cGridStructGen::cStructurePtr cStructurePtr;
+
+	/** Returns the cache for the generator of the specified name and parameters, shared with all its other instances.
+	a_Signature identifies the generator parameters that the structures depend on (cGridStructGen::GetLayoutSignature()).
+	If the cache already exists with a lower cost limit, the limit is raised to a_MaxCost. */
+	static cSharedStructureCachePtr Get(const AString & a_Name, UInt32 a_Signature, size_t a_MaxCost);
+
+	/** Returns the structure cached for the specified grid cell and marks it as the most recently used.
+	Returns an empty pointer if the cell's structure is not cached. */
+	cStructurePtr Find(int a_GridX, int a_GridZ);
+
+	/** Adds the structure to the cache, unless another thread has added one for the same grid cell in the meantime.
+	Returns the structure that is cached for the cell afterwards, which the caller should use instead of a_Structure. */
+	cStructurePtr Add(const cStructurePtr & a_Structure);
+
+	/** Returns the number of the cached structures. */
+	size_t GetNumStructures(void);
+
+protected:
+	typedef std::pair<int, int> cGridCoords;
+
+	typedef std::list<cGridCoords> cLRU;
+
+	struct sEntry
+	{
+		cStructurePtr m_Structure;
+		cLRU::iterator m_LRUPos;  ///< Position of this entry's coords in m_LRU
+	} ;
+
+	typedef std::map<cGridCoords, sEntry> cEntries;
+
+
+	/** Protects all the members against multithreaded access. */
+	cCriticalSection m_CS;
+
+	cEntries m_Entries;
+
+	/** Coords of all the entries, the most recently used first. */
+	cLRU m_LRU;
+
+	/** Sum of the cache costs of all the entries. */
+	size_t m_Cost;
+
+	/** The maximum allowed m_Cost. */
+	size_t m_MaxCost;
+
+
+	cSharedStructureCache(size_t a_MaxCost);
+
+	/** Drops the least recently used entries until the cost is within the limit. Expects m_CS to be locked. */
+	void Trim(void);
+} ;
+
+
+
+
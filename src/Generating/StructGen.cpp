@@ -12,6 +12,22 @@
 
 
 
+/** Appends the blocks of a_Image that are in the specified chunk to a_Dest. */
+static void AppendChunkBlocks(const sSetBlockVector & a_Image, int a_ChunkX, int a_ChunkZ, sSetBlockVector & a_Dest)
+{
+	for (sSetBlockVector::const_iterator itr = a_Image.begin(), end = a_Image.end(); itr != end; ++itr)
+	{
+		if ((itr->m_ChunkX == a_ChunkX) && (itr->m_ChunkZ == a_ChunkZ))
+		{
+			a_Dest.push_back(*itr);
+		}
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cStructGenTrees:
 
@@ -52,18 +68,15 @@ void cStructGenTrees::GenFinish(cChunkDesc & a_ChunkDesc)
 
 			int NumTrees = GetNumTrees(BaseX, BaseZ, Dest->GetBiomeMap());
 
-			sSetBlockVector OutsideLogs, OutsideOther;
+			m_OutsideLogs.clear();
+			m_OutsideOther.clear();
 			for (int i = 0; i < NumTrees; i++)
 			{
-				GenerateSingleTree(BaseX, BaseZ, i, *Dest, OutsideLogs, OutsideOther);
+				GenerateSingleTree(BaseX, BaseZ, i, *Dest, ChunkX, ChunkZ, m_OutsideLogs, m_OutsideOther);
 			}
 
-			sSetBlockVector IgnoredOverflow;
-			IgnoredOverflow.reserve(OutsideOther.size());
-			ApplyTreeImage(ChunkX, ChunkZ, a_ChunkDesc, OutsideOther, IgnoredOverflow);
-			IgnoredOverflow.clear();
-			IgnoredOverflow.reserve(OutsideLogs.size());
-			ApplyTreeImage(ChunkX, ChunkZ, a_ChunkDesc, OutsideLogs, IgnoredOverflow);
+			ApplyTreeImage(ChunkX, ChunkZ, a_ChunkDesc, m_OutsideOther);
+			ApplyTreeImage(ChunkX, ChunkZ, a_ChunkDesc, m_OutsideLogs);
 		}  // for z
 	}  // for x
 	
@@ -91,6 +104,7 @@ void cStructGenTrees::GenFinish(cChunkDesc & a_ChunkDesc)
 void cStructGenTrees::GenerateSingleTree(
 	int a_ChunkX, int a_ChunkZ, int a_Seq,
 	cChunkDesc & a_ChunkDesc,
+	int a_DestChunkX, int a_DestChunkZ,
 	sSetBlockVector & a_OutsideLogs,
 	sSetBlockVector & a_OutsideOther
 )
@@ -112,16 +126,17 @@ void cStructGenTrees::GenerateSingleTree(
 		return;
 	}
 	
-	sSetBlockVector TreeLogs, TreeOther;
+	m_TreeLogs.clear();
+	m_TreeOther.clear();
 	GetTreeImageByBiome(
 		a_ChunkX * cChunkDef::Width + x, Height + 1, a_ChunkZ * cChunkDef::Width + z,
 		m_Noise, a_Seq,
 		a_ChunkDesc.GetBiome(x, z),
-		TreeLogs, TreeOther
+		m_TreeLogs, m_TreeOther
 	);
 
 	// Check if the generated image fits the terrain. Only the logs are checked:
-	for (sSetBlockVector::const_iterator itr = TreeLogs.begin(); itr != TreeLogs.end(); ++itr)
+	for (sSetBlockVector::const_iterator itr = m_TreeLogs.begin(); itr != m_TreeLogs.end(); ++itr)
 	{
 		if ((itr->m_ChunkX != a_ChunkX) || (itr->m_ChunkZ != a_ChunkZ))
 		{
@@ -149,8 +164,16 @@ void cStructGenTrees::GenerateSingleTree(
 		}
 	}
 	
-	ApplyTreeImage(a_ChunkX, a_ChunkZ, a_ChunkDesc, TreeOther, a_OutsideOther);
-	ApplyTreeImage(a_ChunkX, a_ChunkZ, a_ChunkDesc, TreeLogs,  a_OutsideLogs);
+	ApplyTreeImage(a_ChunkX, a_ChunkZ, a_ChunkDesc, m_TreeOther);
+	ApplyTreeImage(a_ChunkX, a_ChunkZ, a_ChunkDesc, m_TreeLogs);
+
+	// Keep the parts that reach into the generated chunk, for it to apply later.
+	// Don't check if already present there, by separating logs and others we don't need the checks anymore:
+	if ((a_ChunkX != a_DestChunkX) || (a_ChunkZ != a_DestChunkZ))
+	{
+		AppendChunkBlocks(m_TreeOther, a_DestChunkX, a_DestChunkZ, a_OutsideOther);
+		AppendChunkBlocks(m_TreeLogs,  a_DestChunkX, a_DestChunkZ, a_OutsideLogs);
+	}
 }
 
 
@@ -160,11 +183,10 @@ void cStructGenTrees::GenerateSingleTree(
 void cStructGenTrees::ApplyTreeImage(
 	int a_ChunkX, int a_ChunkZ,
 	cChunkDesc & a_ChunkDesc,
-	const sSetBlockVector & a_Image,
-	sSetBlockVector & a_Overflow
+	const sSetBlockVector & a_Image
 )
 {
-	// Put the generated image into a_BlockTypes, push things outside this chunk into a_Blocks
+	// Put the parts of the generated image inside this chunk into a_ChunkDesc
 	for (sSetBlockVector::const_iterator itr = a_Image.begin(), end = a_Image.end(); itr != end; ++itr)
 	{
 		if ((itr->m_ChunkX == a_ChunkX) && (itr->m_ChunkZ == a_ChunkZ) && (itr->m_RelY < cChunkDef::Height))
@@ -187,12 +209,7 @@ void cStructGenTrees::ApplyTreeImage(
 				}
 				
 			}  // switch (GetBlock())
-			continue;
 		}
-		
-		// Outside the chunk, push into a_Overflow.
-		// Don't check if already present there, by separating logs and others we don't need the checks anymore:
-		a_Overflow.push_back(*itr);
 	}
 }
 
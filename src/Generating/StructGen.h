@@ -39,24 +39,30 @@ protected:
 	cBiomeGenPtr              m_BiomeGen;
 	cTerrainShapeGenPtr       m_ShapeGen;
 	cTerrainCompositionGenPtr m_CompositionGen;
-	
+
+	/* Buffers reused for all the trees, so that generating a tree doesn't allocate once they've grown large enough.
+	Each generator thread has its own instance of the finisher, so these need no locking. */
+	sSetBlockVector m_TreeLogs, m_TreeOther;        ///< The image of the tree currently being generated
+	sSetBlockVector m_OutsideLogs, m_OutsideOther;  ///< Parts of the neighbors' trees that fall into the generated chunk
+
 	/** Generates and applies an image of a single tree.
 	Parts of the tree inside the chunk are applied to a_ChunkDesc.
-	Parts of the tree outside the chunk are stored in a_OutsideXYZ
+	Parts of the tree in the a_DestChunkX, a_DestChunkZ chunk (the one being generated) are appended to a_OutsideXYZ,
+	parts in any other chunk are dropped, since nothing would use them.
 	*/
 	void GenerateSingleTree(
 		int a_ChunkX, int a_ChunkZ, int a_Seq,
 		cChunkDesc & a_ChunkDesc,
+		int a_DestChunkX, int a_DestChunkZ,
 		sSetBlockVector & a_OutsideLogs,
 		sSetBlockVector & a_OutsideOther
 	) ;
-	
-	/** Applies an image into chunk blockdata; all blocks outside the chunk will be appended to a_Overflow. */
+
+	/** Applies the parts of an image that are inside the chunk into chunk blockdata; the rest of the image is ignored. */
 	void ApplyTreeImage(
 		int a_ChunkX, int a_ChunkZ,
 		cChunkDesc & a_ChunkDesc,
-		const sSetBlockVector & a_Image,
-		sSetBlockVector & a_Overflow
+		const sSetBlockVector & a_Image
 	);
 
 	int GetNumTrees(
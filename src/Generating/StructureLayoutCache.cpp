@@ -0,0 +1,265 @@
+
+// StructureLayoutCache.cpp
+
+// Implements the cStructureLayoutCache class representing the on-disk cache of the piece layouts generated by the structure generators
+
+#include "Globals.h"
+#include "StructureLayoutCache.h"
+
+
+
+
+
+/** The first value in the file header, identifies the file type. */
+static const Int32 LAYOUT_FILE_MAGIC = 0x4c53434d;  // "MCSL"
+
+/** The second value in the file header, the version of the file format. */
+static const Int32 LAYOUT_FILE_VERSION = 1;
+
+/** Number of Int32 values stored for each piece. */
+static const int NUM_VALUES_PER_PIECE = 6;
+
+/** The maximum number of pieces in a single layout. Anything more means the file is damaged. */
+static const Int32 MAX_PIECES_PER_LAYOUT = 65536;
+
+/** All the caches currently in use, by their filename. Protected by g_CSCaches. */
+static std::map<AString, WeakPtr<cStructureLayoutCache>> g_Caches;
+
+/** Protects g_Caches against multithreaded access. */
+static cCriticalSection g_CSCaches;
+
+
+
+
+
+cStructureLayoutCache::cStructureLayoutCache(const AString & a_FileName, UInt32 a_Signature) :
+	m_FileName(a_FileName),
+	m_Signature(a_Signature),
+	m_FileSize(0)
+{
+}
+
+
+
+
+
+cStructureLayoutCachePtr cStructureLayoutCache::Get(const AString & a_FileName, UInt32 a_Signature)
+{
+	cCSLock Lock(g_CSCaches);
+	WeakPtr<cStructureLayoutCache> & Weak = g_Caches[a_FileName];
+	cStructureLayoutCachePtr Cache = Weak.lock();
+	if (Cache != nullptr)
+	{
+		if (Cache->m_Signature != a_Signature)
+		{
+			LOGWARNING("Structure layout cache %s is already in use with different generator settings, not using it.", a_FileName.c_str());
+			return nullptr;
+		}
+		return Cache;
+	}
+
+	Cache.reset(new cStructureLayoutCache(a_FileName, a_Signature));
+	if (!Cache->Open())
+	{
+		return nullptr;
+	}
+	Weak = Cache;
+	return Cache;
+}
+
+
+
+
+
+UInt32 cStructureLayoutCache::AddToSignature(UInt32 a_Signature, int a_Value)
+{
+	// FNV-1a over the value's bytes:
+	UInt32 Value = static_cast<UInt32>(a_Value);
+	for (int i = 0; i < 4; i++)
+	{
+		a_Signature = (a_Signature ^ (Value & 0xff)) * 16777619;
+		Value >>= 8;
+	}
+	return a_Signature;
+}
+
+
+
+
+
+bool cStructureLayoutCache::LoadLayout(int a_GridX, int a_GridZ, const cPiecePool & a_Pool, cPlacedPieces & a_Pieces, int a_Variant)
+{
+	// Read the record from the file:
+	std::vector<Int32> Values;
+	{
+		cCSLock Lock(m_CS);
+		cRecords::const_iterator itr = m_Records.find(std::make_pair(a_GridX, a_GridZ));
+		if ((itr == m_Records.end()) || (itr->second.m_Variant != a_Variant))
+		{
+			return false;
+		}
+		Int32 RecordHeader[4];
+		if ((m_File.Seek(itr->second.m_Offset) < 0) || (m_File.Read(RecordHeader, sizeof(RecordHeader)) != sizeof(RecordHeader)))
+		{
+			return false;
+		}
+		Values.resize(static_cast<size_t>(RecordHeader[3] * NUM_VALUES_PER_PIECE));
+		if (!Values.empty() && (m_File.Read(Values.data(), Values.size() * sizeof(Int32)) != static_cast<int>(Values.size() * sizeof(Int32))))
+		{
+			return false;
+		}
+	}
+
+	// Re-create the pieces; the parents always precede their children:
+	cPlacedPieces Pieces;
+	for (size_t i = 0; i < Values.size(); i += NUM_VALUES_PER_PIECE)
+	{
+		cPiece * Piece = a_Pool.GetPieceAtIndex(Values[i]);
+		Int32 ParentIdx = Values[i + 1];
+		if ((Piece == nullptr) || (ParentIdx < -1) || (ParentIdx >= static_cast<Int32>(Pieces.size())))
+		{
+			// The layout doesn't fit the pool, the prefabs must have changed since it was stored:
+			cPieceGenerator::FreePieces(Pieces);
+			return false;
+		}
+		const cPlacedPiece * Parent = (ParentIdx < 0) ? nullptr : Pieces[static_cast<size_t>(ParentIdx)];
+		Pieces.push_back(new cPlacedPiece(Parent, *Piece, Vector3i(Values[i + 2], Values[i + 3], Values[i + 4]), Values[i + 5]));
+	}
+	a_Pieces.insert(a_Pieces.end(), Pieces.begin(), Pieces.end());
+	return true;
+}
+
+
+
+
+
+void cStructureLayoutCache::StoreLayout(int a_GridX, int a_GridZ, const cPiecePool & a_Pool, const cPlacedPieces & a_Pieces, int a_Variant)
+{
+	// Serialize the layout:
+	std::vector<Int32> Values;
+	Values.reserve(4 + a_Pieces.size() * NUM_VALUES_PER_PIECE);
+	Values.push_back(a_GridX);
+	Values.push_back(a_GridZ);
+	Values.push_back(a_Variant);
+	Values.push_back(static_cast<Int32>(a_Pieces.size()));
+	std::map<const cPlacedPiece *, Int32> Indices;
+	for (cPlacedPieces::const_iterator itr = a_Pieces.begin(), end = a_Pieces.end(); itr != end; ++itr)
+	{
+		int PieceIdx = a_Pool.GetPieceIndex((*itr)->GetPiece());
+		if (PieceIdx < 0)
+		{
+			// The pool cannot identify its pieces, the layout cannot be stored
+			return;
+		}
+		Int32 ParentIdx = -1;
+		if ((*itr)->GetParent() != nullptr)
+		{
+			std::map<const cPlacedPiece *, Int32>::const_iterator Parent = Indices.find((*itr)->GetParent());
+			if (Parent == Indices.end())
+			{
+				ASSERT(!"The parent piece is not a part of the layout or is placed after its child");
+				return;
+			}
+			ParentIdx = Parent->second;
+		}
+		Indices[*itr] = static_cast<Int32>(Indices.size());
+		const Vector3i & Coords = (*itr)->GetCoords();
+		Values.push_back(PieceIdx);
+		Values.push_back(ParentIdx);
+		Values.push_back(Coords.x);
+		Values.push_back(Coords.y);
+		Values.push_back(Coords.z);
+		Values.push_back((*itr)->GetNumCCWRotations());
+	}
+
+	// Append the record to the file:
+	cCSLock Lock(m_CS);
+	std::pair<int, int> Cell(a_GridX, a_GridZ);
+	cRecords::const_iterator itr = m_Records.find(Cell);
+	if ((itr != m_Records.end()) && (itr->second.m_Variant == a_Variant))
+	{
+		// Another generator thread has stored the same layout meanwhile
+		return;
+	}
+	int NumBytes = static_cast<int>(Values.size() * sizeof(Int32));
+	if ((m_File.Seek(m_FileSize) < 0) || (m_File.Write(Values.data(), static_cast<size_t>(NumBytes)) != NumBytes))
+	{
+		// Not stored, the next record will overwrite whatever has been written
+		return;
+	}
+	sRecord & Record = m_Records[Cell];
+	Record.m_Offset = m_FileSize;
+	Record.m_Variant = a_Variant;
+	m_FileSize += NumBytes;
+}
+
+
+
+
+
+bool cStructureLayoutCache::Open(void)
+{
+	// Index the records in the file, if it has been created with the same signature:
+	AString Contents = cFile::ReadWholeFile(m_FileName);
+	Int32 FileHeader[3] = { LAYOUT_FILE_MAGIC, LAYOUT_FILE_VERSION, static_cast<Int32>(m_Signature) };
+	size_t ValidSize = 0;
+	if ((Contents.size() >= sizeof(FileHeader)) && (memcmp(Contents.data(), FileHeader, sizeof(FileHeader)) == 0))
+	{
+		ValidSize = sizeof(FileHeader);
+		Int32 RecordHeader[4];
+		while (ValidSize + sizeof(RecordHeader) <= Contents.size())
+		{
+			memcpy(RecordHeader, Contents.data() + ValidSize, sizeof(RecordHeader));
+			if ((RecordHeader[3] < 0) || (RecordHeader[3] > MAX_PIECES_PER_LAYOUT))
+			{
+				break;
+			}
+			size_t RecordSize = sizeof(RecordHeader) + static_cast<size_t>(RecordHeader[3] * NUM_VALUES_PER_PIECE) * sizeof(Int32);
+			if (ValidSize + RecordSize > Contents.size())
+			{
+				break;
+			}
+
+			// A later record of the same cell replaces the earlier one:
+			sRecord & Record = m_Records[std::make_pair(RecordHeader[0], RecordHeader[1])];
+			Record.m_Offset = static_cast<int>(ValidSize);
+			Record.m_Variant = RecordHeader[2];
+			ValidSize += RecordSize;
+		}
+	}
+	else if (!Contents.empty())
+	{
+		LOGINFO("Structure layout cache %s has been created with different generator settings, discarding its contents.", m_FileName.c_str());
+	}
+
+	// Rewrite the file if anything is to be discarded (the contents of a mismatched file, a record cut short by a crash):
+	if ((ValidSize == 0) || (ValidSize != Contents.size()))
+	{
+		if (ValidSize == 0)
+		{
+			Contents.assign(reinterpret_cast<const char *>(FileHeader), sizeof(FileHeader));
+		}
+		else
+		{
+			Contents.resize(ValidSize);
+		}
+		cFile File;
+		if (!File.Open(m_FileName, cFile::fmWrite) || (File.Write(Contents.data(), Contents.size()) != static_cast<int>(Contents.size())))
+		{
+			LOGWARNING("Cannot write the structure layout cache %s, the layouts will not be cached.", m_FileName.c_str());
+			return false;
+		}
+	}
+	m_FileSize = static_cast<int>(Contents.size());
+
+	if (!m_File.Open(m_FileName, cFile::fmReadWrite))
+	{
+		LOGWARNING("Cannot open the structure layout cache %s, the layouts will not be cached.", m_FileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+
+
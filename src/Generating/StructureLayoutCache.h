@@ -0,0 +1,94 @@
+
+// StructureLayoutCache.h
+
+// Declares the cStructureLayoutCache class representing the on-disk cache of the piece layouts generated by the structure generators
+
+
+
+
+
+#pragma once
+
+#include "PieceGenerator.h"
+#include "../OSSupport/File.h"
+
+
+
+
+
+// fwd:
+class cStructureLayoutCache;
+typedef SharedPtr<cStructureLayoutCache> cStructureLayoutCachePtr;
+
+
+
+
+
+/** Stores the piece layouts generated by a cGridStructGen descendant in a file, keyed by the grid cell, so that
+the (expensive) piece generator needn't be run again for the same cell, not even after a server restart.
+The file is append-only: a header with the generator parameters' signature, followed by a record for each cell:
+{GridX, GridZ, Variant, NumPieces, NumPieces * {PieceIdx, ParentIdx, X, Y, Z, NumCCWRotations}}, all Int32 in the native byte order.
+The variant distinguishes the layouts that a cell may have generated from different pools, such as the village types.
+Only an index of the records is kept in memory, the layouts are read from the file when needed.
+A single instance is shared by all the generator instances using the same file (one per generator thread), so all
+its functions are thread-safe. */
+class cStructureLayoutCache
+{
+public:
+	/** Returns the cache stored in the specified file, shared with all the other users of the file.
+	a_Signature identifies the generator parameters that the layouts depend on; if the file has been created with a different
+	signature (or a different file format), its contents are discarded.
+	Returns nullptr if the file cannot be opened or created. */
+	static cStructureLayoutCachePtr Get(const AString & a_FileName, UInt32 a_Signature);
+
+	/** Combines a_Value into a_Signature. Used by the generators to compute the signature of their parameters. */
+	static UInt32 AddToSignature(UInt32 a_Signature, int a_Value);
+
+	/** If a layout of the specified grid cell and variant is stored, re-creates its pieces out of a_Pool into a_Pieces and
+	returns true. Returns false if there's no such layout or if it doesn't fit a_Pool. The caller owns the created pieces. */
+	bool LoadLayout(int a_GridX, int a_GridZ, const cPiecePool & a_Pool, cPlacedPieces & a_Pieces, int a_Variant = 0);
+
+	/** Stores the layout of the specified grid cell and variant, made of the pieces from a_Pool, replacing a layout of
+	a different variant. Ignored if the layout is already stored, or if a_Pool cannot identify its pieces. */
+	void StoreLayout(int a_GridX, int a_GridZ, const cPiecePool & a_Pool, const cPlacedPieces & a_Pieces, int a_Variant = 0);
+
+protected:
+	/** Position of a single layout record in the file. */
+	struct sRecord
+	{
+		int m_Offset;
+		int m_Variant;
+	} ;
+
+	/** The layout records in the file, by their grid cell. */
+	typedef std::map<std::pair<int, int>, sRecord> cRecords;
+
+
+	/** Protects the file and the index against multithreaded access. */
+	cCriticalSection m_CS;
+
+	AString m_FileName;
+
+	/** The signature of the generator parameters, as written in the file header. */
+	UInt32 m_Signature;
+
+	/** The file, open for reading and writing while the cache is in use. */
+	cFile m_File;
+
+	/** The index of the layouts stored in m_File. */
+	cRecords m_Records;
+
+	/** The size of the valid data in m_File; new records are appended here. */
+	int m_FileSize;
+
+
+	cStructureLayoutCache(const AString & a_FileName, UInt32 a_Signature);
+
+	/** Reads the index of the stored layouts from the file, or creates the file anew if its signature doesn't match.
+	Returns false if the file cannot be used at all. */
+	bool Open(void);
+} ;
+
+
+
+
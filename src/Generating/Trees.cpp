@@ -404,7 +404,7 @@ void GetLargeAppleTreeImage(int a_BlockX, int a_BlockY, int a_BlockZ, cNoise & a
 	}
 
 	// Place leaves around each log block
-	for (auto itr : a_LogBlocks)
+	for (const auto & itr : a_LogBlocks)
 	{
 		// Get the log's X and Z coordinates
 		int X = itr.GetX();
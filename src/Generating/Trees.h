@@ -9,6 +9,9 @@ Note that all of these functions must generate the same tree image for the same
 To generate a random image for the (x, y, z) coords, pass an arbitrary value as (seq).
 Each function returns two arrays of blocks, "logs" and "other". The point is that logs are of higher priority,
 logs can overwrite others(leaves), but others shouldn't overwrite logs. This is an optimization for the generator.
+The functions only append to the two arrays and some of them expect the arrays to contain only their own blocks, so the
+arrays need to be empty on input. Callers generating many trees should clear() and reuse the same arrays, so that their
+storage is allocated only once.
 */
 
 
@@ -32,7 +32,8 @@ public:
 		int a_GridX, int a_GridZ,
 		int a_OriginX, int a_OriginZ,
 		int a_MaxDepth,
-		int a_MaxSize
+		int a_MaxSize,
+		cStructureLayoutCache * a_LayoutCache
 	) :
 		super(a_GridX, a_GridZ, a_OriginX, a_OriginZ),
 		m_Seed(a_Seed),
@@ -40,9 +41,16 @@ public:
 		m_MaxSize(a_MaxSize),
 		m_Borders(a_OriginX - a_MaxSize, 0, a_OriginZ - a_MaxSize, a_OriginX + a_MaxSize, 255, a_OriginZ + a_MaxSize)
 	{
-		// Generate the pieces for this base:
-		cBFSPieceGenerator pg(g_UnderwaterBase, a_Seed);
-		pg.PlacePieces(a_OriginX, 50, a_OriginZ, a_MaxDepth, m_Pieces);
+		// Generate the pieces for this base, unless they have been generated before:
+		if ((a_LayoutCache == nullptr) || !a_LayoutCache->LoadLayout(a_GridX, a_GridZ, g_UnderwaterBase, m_Pieces))
+		{
+			cBFSPieceGenerator pg(g_UnderwaterBase, a_Seed);
+			pg.PlacePieces(a_OriginX, 50, a_OriginZ, a_MaxDepth, m_Pieces);
+			if (a_LayoutCache != nullptr)
+			{
+				a_LayoutCache->StoreLayout(a_GridX, a_GridZ, g_UnderwaterBase, m_Pieces);
+			}
+		}
 		if (m_Pieces.empty())
 		{
 			return;
@@ -135,7 +143,19 @@ cGridStructGen::cStructurePtr cUnderwaterBaseGen::CreateStructure(int a_GridX, i
 	}  // for i - Biomes[]
 
 	// Create a base based on the chosen prefabs:
-	return cStructurePtr(new cUnderwaterBase(m_Seed, a_GridX, a_GridZ, a_OriginX, a_OriginZ, m_MaxDepth, m_MaxSize));
+	return cStructurePtr(new cUnderwaterBase(m_Seed, a_GridX, a_GridZ, a_OriginX, a_OriginZ, m_MaxDepth, m_MaxSize, m_LayoutCache.get()));
+}
+
+
+
+
+
+UInt32 cUnderwaterBaseGen::GetLayoutSignature(void) const
+{
+	UInt32 Signature = super::GetLayoutSignature();
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxDepth);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxSize);
+	return Signature;
 }
 
 
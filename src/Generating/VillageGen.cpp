@@ -118,7 +118,9 @@ public:
 		cPiecePool & a_Prefabs,
 		cTerrainHeightGenPtr a_HeightGen,
 		BLOCKTYPE a_RoadBlock,
-		BLOCKTYPE a_WaterRoadBlock
+		BLOCKTYPE a_WaterRoadBlock,
+		cStructureLayoutCache * a_LayoutCache,
+		int a_LayoutVariant
 	) :
 		super(a_GridX, a_GridZ, a_OriginX, a_OriginZ),
 		m_Seed(a_Seed),
@@ -131,9 +133,18 @@ public:
 		m_RoadBlock(a_RoadBlock),
 		m_WaterRoadBlock(a_WaterRoadBlock)
 	{
-		// Generate the pieces for this village; don't care about the Y coord:
-		cBFSPieceGenerator pg(*this, a_Seed);
-		pg.PlacePieces(a_OriginX, 0, a_OriginZ, a_MaxRoadDepth + 1, m_Pieces);
+		// Generate the pieces for this village, unless they have been generated before; don't care about the Y coord:
+		if ((a_LayoutCache == nullptr) || !a_LayoutCache->LoadLayout(a_GridX, a_GridZ, *this, m_Pieces, a_LayoutVariant))
+		{
+			cBFSPieceGenerator pg(*this, a_Seed);
+			pg.PlacePieces(a_OriginX, 0, a_OriginZ, a_MaxRoadDepth + 1, m_Pieces);
+
+			// Store the layout before it gets moved to the ground, so that it doesn't depend on the terrain:
+			if (a_LayoutCache != nullptr)
+			{
+				a_LayoutCache->StoreLayout(a_GridX, a_GridZ, *this, m_Pieces, a_LayoutVariant);
+			}
+		}
 		if (m_Pieces.empty())
 		{
 			return;
@@ -311,6 +322,18 @@ protected:
 	}
 	
 	
+	virtual int GetPieceIndex(const cPiece & a_Piece) const override
+	{
+		return m_Prefabs.GetPieceIndex(a_Piece);
+	}
+	
+	
+	virtual cPiece * GetPieceAtIndex(int a_Index) const override
+	{
+		return m_Prefabs.GetPieceAtIndex(a_Index);
+	}
+	
+	
 	void MoveAllDescendants(cPlacedPieces & a_PlacedPieces, size_t a_Pivot, int a_HeightDifference)
 	{
 		size_t num = a_PlacedPieces.size();
@@ -436,7 +459,25 @@ cGridStructGen::cStructurePtr cVillageGen::CreateStructure(int a_GridX, int a_Gr
 	{
 		return cStructurePtr();
 	}
-	return cStructurePtr(new cVillage(m_Seed, a_GridX, a_GridZ, a_OriginX, a_OriginZ, m_MaxDepth, m_MaxSize, Density, *VillagePrefabs, m_HeightGen, RoadBlock, WaterRoadBlock));
+	int LayoutVariant = (VillagePrefabs == DesertVillage) ? 1 : 0;  // The village type depends on the biomes, so the cached layout must match it
+	return cStructurePtr(new cVillage(
+		m_Seed, a_GridX, a_GridZ, a_OriginX, a_OriginZ, m_MaxDepth, m_MaxSize, Density, *VillagePrefabs, m_HeightGen, RoadBlock, WaterRoadBlock,
+		m_LayoutCache.get(), LayoutVariant
+	));
+}
+
+
+
+
+
+UInt32 cVillageGen::GetLayoutSignature(void) const
+{
+	UInt32 Signature = super::GetLayoutSignature();
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxDepth);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxSize);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MinDensity);
+	Signature = cStructureLayoutCache::AddToSignature(Signature, m_MaxDensity);
+	return Signature;
 }
 
 
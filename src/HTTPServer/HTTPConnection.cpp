@@ -58,6 +58,22 @@ void cHTTPConnection::SendNeedAuth(const AString & a_Realm)
 
 
 
+void cHTTPConnection::SendNotModified(const AString & a_ETag, const AString & a_CacheControl)
+{
+	AString Data = Printf("HTTP/1.1 304 Not Modified\r\nETag: %s\r\n", a_ETag.c_str());
+	if (!a_CacheControl.empty())
+	{
+		Data.append(Printf("Cache-Control: %s\r\n", a_CacheControl.c_str()));
+	}
+	Data.append("\r\n");
+	SendData(Data);
+	m_State = wcsRecvHeaders;
+}
+
+
+
+
+
 void cHTTPConnection::Send(const cHTTPResponse & a_Response)
 {
 	ASSERT(m_State == wcsRecvIdle);
@@ -89,6 +105,7 @@ void cHTTPConnection::FinishResponse(void)
 	ASSERT(m_State == wcsSendingResp);
 	SendData("0\r\n\r\n");
 	m_State = wcsRecvHeaders;
+	ProcessPipelinedData();
 }
 
 
@@ -211,9 +228,9 @@ void cHTTPConnection::OnReceivedData(const char * a_Data, size_t a_Size)
 		case wcsRecvBody:
 		{
 			ASSERT(m_CurrentRequest != nullptr);
-			if (m_CurrentRequestBodyRemaining > 0)
+			size_t BytesToConsume = std::min(m_CurrentRequestBodyRemaining, a_Size);
+			if (BytesToConsume > 0)
 			{
-				size_t BytesToConsume = std::min(m_CurrentRequestBodyRemaining, (size_t)a_Size);
 				m_HTTPServer.RequestBody(*this, *m_CurrentRequest, a_Data, BytesToConsume);
 				m_CurrentRequestBodyRemaining -= BytesToConsume;
 			}
@@ -230,13 +247,28 @@ void cHTTPConnection::OnReceivedData(const char * a_Data, size_t a_Size)
 				}
 				delete m_CurrentRequest;
 				m_CurrentRequest = nullptr;
+
+				// The client may have pipelined further requests after this one:
+				if (a_Size > BytesToConsume)
+				{
+					m_PipelinedData.append(a_Data + BytesToConsume, a_Size - BytesToConsume);
+				}
+				ProcessPipelinedData();
 			}
 			break;
 		}
 
+		case wcsRecvIdle:
+		case wcsSendingResp:
+		{
+			// A pipelined request is arriving while the response to the previous one is still being produced, keep it for later:
+			m_PipelinedData.append(a_Data, a_Size);
+			break;
+		}
+
 		default:
 		{
-			// TODO: Should we be receiving data in this state?
+			// The connection is closing, ignore any further data
 			break;
 		}
 	}
@@ -246,6 +278,23 @@ void cHTTPConnection::OnReceivedData(const char * a_Data, size_t a_Size)
 
 
 
+void cHTTPConnection::ProcessPipelinedData(void)
+{
+	// Only process the data once the previous request has been fully finished and its response sent.
+	// While the request is still set, we're being called from within its RequestFinished() and the caller processes the data afterwards.
+	if (m_PipelinedData.empty() || (m_State != wcsRecvHeaders) || (m_CurrentRequest != nullptr) || (m_Link == nullptr))
+	{
+		return;
+	}
+	AString Data;
+	std::swap(Data, m_PipelinedData);
+	OnReceivedData(Data.data(), Data.size());
+}
+
+
+
+
+
 void cHTTPConnection::OnRemoteClosed(void)
 {
 	if (m_CurrentRequest != nullptr)
@@ -47,6 +47,10 @@ public:
 	
 	/** Sends the "401 unauthorized" reply together with instructions on authorizing, using the specified realm */
 	void SendNeedAuth(const AString & a_Realm);
+
+	/** Sends the "304 Not Modified" reply to a conditional request, with the specified entity tag and cache control.
+	An empty a_CacheControl omits the header. */
+	void SendNotModified(const AString & a_ETag, const AString & a_CacheControl);
 	
 	/** Sends the headers contained in a_Response */
 	void Send(const cHTTPResponse & a_Response);
@@ -89,8 +93,16 @@ protected:
 
 	/** The network link attached to this connection. */
 	cTCPLinkPtr m_Link;
+
+	/** Data of the pipelined requests that has been received while the response to the previous request was being produced.
+	Processed once the response is finished. */
+	AString m_PipelinedData;
 	
 	
+	/** Processes the data in m_PipelinedData, if the connection is ready to receive the next request. */
+	void ProcessPipelinedData(void);
+
+
 	// cTCPLink::cCallbacks overrides:
 	/** The link instance has been created, remember it. */
 	virtual void OnLinkCreated(cTCPLinkPtr a_Link) override;
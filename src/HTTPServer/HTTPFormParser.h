@@ -66,6 +66,10 @@ public:
 	
 	/// Returns true if the headers suggest the request has form data parseable by this class
 	static bool HasFormData(const cHTTPRequest & a_Request);
+
+	/** Returns the name of the form field of the currently parsed part in multipart data.
+	Used by the file callbacks to tell the file fields apart. */
+	const AString & GetCurrentPartName(void) const { return m_CurrentPartName; }
 	
 protected:
 	
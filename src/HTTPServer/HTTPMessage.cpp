@@ -66,6 +66,20 @@ void cHTTPMessage::AddHeader(const AString & a_Key, const AString & a_Value)
 
 
 
+AString cHTTPMessage::GetHeader(const AString & a_Key) const
+{
+	cNameValueMap::const_iterator itr = m_Headers.find(StrToLower(a_Key));
+	if (itr == m_Headers.end())
+	{
+		return AString();
+	}
+	return itr->second;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cHTTPRequest:
 
@@ -210,6 +224,9 @@ size_t cHTTPRequest::ParseRequestLine(const char * a_Data, size_t a_Size)
 				}
 				m_Method = m_IncomingHeaderData.substr(LineStart, MethodEnd - LineStart);
 				m_URL = m_IncomingHeaderData.substr(MethodEnd + 1, URLEnd - MethodEnd - 1);
+
+				// HTTP/1.1 connections are persistent by default, the Connection header may override this:
+				m_AllowKeepAlive = (m_IncomingHeaderData[URLEnd + 8] != '0');
 				return i + 1;
 			}
 		}  // switch (m_IncomingHeaderData[i])
@@ -239,9 +256,16 @@ void cHTTPRequest::OnHeaderLine(const AString & a_Key, const AString & a_Value)
 			m_HasAuth = true;
 		}
 	}
-	if ((a_Key == "Connection") && (NoCaseCompare(a_Value, "keep-alive") == 0))
+	if (NoCaseCompare(a_Key, "Connection") == 0)
 	{
-		m_AllowKeepAlive = true;
+		if (NoCaseCompare(a_Value, "keep-alive") == 0)
+		{
+			m_AllowKeepAlive = true;
+		}
+		else if (NoCaseCompare(a_Value, "close") == 0)
+		{
+			m_AllowKeepAlive = false;
+		}
 	}
 	AddHeader(a_Key, a_Value);
 }
@@ -269,7 +293,7 @@ void cHTTPResponse::AppendToData(AString & a_DataStream) const
 	a_DataStream.append("\r\n");
 	for (cNameValueMap::const_iterator itr = m_Headers.begin(), end = m_Headers.end(); itr != end; ++itr)
 	{
-		if ((itr->first == "Content-Type") || (itr->first == "Content-Length"))
+		if ((itr->first == "content-type") || (itr->first == "content-length"))
 		{
 			continue;
 		}
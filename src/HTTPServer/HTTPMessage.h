@@ -44,6 +44,10 @@ public:
 	const AString & GetContentType  (void) const { return m_ContentType; }
 	size_t          GetContentLength(void) const { return m_ContentLength; }
 
+	/** Returns the value of the specified header (case-insensitive), or an empty string if the header isn't present.
+	Multiple headers of the same name are combined into a comma-separated list. */
+	AString GetHeader(const AString & a_Key) const;
+
 protected:
 	typedef std::map<AString, AString> cNameValueMap;
 	
@@ -109,6 +113,9 @@ public:
 	/** Returns the password that the request presented. Only valid if HasAuth() is true */
 	const AString & GetAuthPassword(void) const { return m_AuthPassword; }
 	
+	/** Returns true if the connection may be kept open for another request after this one is finished.
+	HTTP/1.1 connections are persistent unless the client sends "Connection: close",
+	HTTP/1.0 connections only with an explicit "Connection: keep-alive". */
 	bool DoesAllowKeepAlive(void) const { return m_AllowKeepAlive; }
 	
 protected:
@@ -139,7 +146,7 @@ protected:
 	/** The password used for auth */
 	AString m_AuthPassword;
 	
-	/** Set to true if the request indicated that it supports keepalives.
+	/** Set to true if the request indicated that it supports keepalives, either by its HTTP version or by its Connection header.
 	If false, the server will close the connection once the request is finished */
 	bool m_AllowKeepAlive;
 	
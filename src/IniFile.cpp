@@ -39,7 +39,8 @@ using namespace std;
 
 
 cIniFile::cIniFile(void) :
-	m_IsCaseInsensitive(true)
+	m_IsCaseInsensitive(true),
+	m_Generation(0)
 {
 }
 
@@ -234,15 +235,8 @@ bool cIniFile::WriteFile(const AString & a_FileName) const
 
 int cIniFile::FindKey(const AString & a_KeyName) const
 {
-	AString CaseKeyName = CheckCase(a_KeyName);
-	for (size_t keyID = 0; keyID < names.size(); ++keyID)
-	{
-		if (CheckCase(names[keyID]) == CaseKeyName)
-		{
-			return (int)keyID;
-		}
-	}
-	return noID;
+	auto itr = m_KeyIndex.find(CheckCase(a_KeyName));
+	return (itr == m_KeyIndex.end()) ? noID : itr->second;
 }
 
 
@@ -251,20 +245,14 @@ int cIniFile::FindKey(const AString & a_KeyName) const
 
 int cIniFile::FindValue(const int keyID, const AString & a_ValueName) const
 {
-	if (!keys.size() || (keyID >= (int)keys.size()))
+	if ((keyID < 0) || (keyID >= (int)keys.size()))
 	{
 		return noID;
 	}
 
-	AString CaseValueName = CheckCase(a_ValueName);
-	for (size_t valueID = 0; valueID < keys[keyID].names.size(); ++valueID)
-	{
-		if (CheckCase(keys[keyID].names[valueID]) == CaseValueName)
-		{
-			return int(valueID);
-		}
-	}
-	return noID;
+	const cNameIndex & Index = keys[keyID].index;
+	auto itr = Index.find(CheckCase(a_ValueName));
+	return (itr == Index.end()) ? noID : itr->second;
 }
 
 
@@ -275,7 +263,12 @@ int cIniFile::AddKeyName(const AString & keyname)
 {
 	names.resize(names.size() + 1, keyname);
 	keys.resize(keys.size() + 1);
-	return (int)names.size() - 1;
+	int keyID = (int)names.size() - 1;
+
+	// A duplicate key name keeps resolving to the first key of that name:
+	m_KeyIndex.insert(std::make_pair(CheckCase(keyname), keyID));
+	m_Generation += 1;
+	return keyID;
 }
 
 
@@ -362,6 +355,8 @@ void cIniFile::AddValue(const AString & a_KeyName, const AString & a_ValueName,
 
 	keys[keyID].names.push_back(a_ValueName);
 	keys[keyID].values.push_back(a_Value);
+	keys[keyID].index.insert(std::make_pair(CheckCase(a_ValueName), (int)keys[keyID].names.size() - 1));
+	m_Generation += 1;
 }
 
 
@@ -393,6 +388,7 @@ bool cIniFile::SetValue(const int keyID, const int valueID, const AString & valu
 		return false;
 	}
 	keys[keyID].values[valueID] = value;
+	m_Generation += 1;
 	return true;
 }
 
@@ -421,11 +417,13 @@ bool cIniFile::SetValue(const AString & a_KeyName, const AString & a_ValueName,
 		}
 		keys[keyID].names.push_back(a_ValueName);
 		keys[keyID].values.push_back(a_Value);
+		keys[keyID].index.insert(std::make_pair(CheckCase(a_ValueName), (int)keys[keyID].names.size() - 1));
 	}
 	else
 	{
 		keys[keyID].values[valueID] = a_Value;
 	}
+	m_Generation += 1;
 
 	return true;
 }
@@ -589,6 +587,8 @@ bool cIniFile::DeleteValueByID(const int keyID, const int valueID)
 		vector<AString>::iterator vpos = keys[keyID].values.begin() + valueID;
 		keys[keyID].names.erase(npos, npos + 1);
 		keys[keyID].values.erase(vpos, vpos + 1);
+		RebuildValueIndex(keys[keyID]);
+		m_Generation += 1;
 		return true;
 	}
 	return false;
@@ -631,6 +631,7 @@ bool cIniFile::DeleteKey(const AString & keyname)
 	vector<key>::iterator    kpos = keys.begin() + keyID;
 	names.erase(npos, npos + 1);
 	keys.erase(kpos, kpos + 1);
+	RebuildIndex();
 
 	return true;
 }
@@ -644,6 +645,8 @@ void cIniFile::Clear(void)
 	names.clear();
 	keys.clear();
 	comments.clear();
+	m_KeyIndex.clear();
+	m_Generation += 1;
 }
 
 
@@ -864,6 +867,37 @@ AString cIniFile::CheckCase(const AString & s) const
 
 
 
+void cIniFile::RebuildIndex(void)
+{
+	m_KeyIndex.clear();
+	for (size_t keyID = 0; keyID < names.size(); ++keyID)
+	{
+		m_KeyIndex.insert(std::make_pair(CheckCase(names[keyID]), (int)keyID));
+	}
+	for (auto & Key : keys)
+	{
+		RebuildValueIndex(Key);
+	}
+	m_Generation += 1;
+}
+
+
+
+
+
+void cIniFile::RebuildValueIndex(key & a_Key)
+{
+	a_Key.index.clear();
+	for (size_t valueID = 0; valueID < a_Key.names.size(); ++valueID)
+	{
+		a_Key.index.insert(std::make_pair(CheckCase(a_Key.names[valueID]), (int)valueID));
+	}
+}
+
+
+
+
+
 void cIniFile::RemoveBom(AString & a_line) const
 {
 	// The BOM sequence for UTF-8 is 0xEF, 0xBB, 0xBF
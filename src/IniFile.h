@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <unordered_map>
+
 
 
 
@@ -35,20 +37,38 @@ class cIniFile
 private:
 	bool m_IsCaseInsensitive;
 	
+	/** Maps the CheckCase()-d names to the index of the first item of that name. */
+	typedef std::unordered_map<AString, int> cNameIndex;
+
 	struct key
 	{
 		std::vector<AString> names;
 		std::vector<AString> values;
 		std::vector<AString> comments;
+
+		/** Index into names, so that FindValue() needn't search linearly. */
+		cNameIndex index;
 	} ;
 	
 	std::vector<key>     keys;
 	std::vector<AString> names;
 	std::vector<AString> comments;
+
+	/** Index into names, so that FindKey() needn't search linearly. */
+	cNameIndex m_KeyIndex;
+
+	/** Incremented on each change of the keys or values, see GetGeneration(). */
+	int m_Generation;
 	
 	/// If the object is case-insensitive, returns s as lowercase; otherwise returns s as-is
 	AString CheckCase(const AString & s) const;
 
+	/** Rebuilds the key index and all the value indices, after the key IDs have changed or the case sensitivity has been switched. */
+	void RebuildIndex(void);
+
+	/** Rebuilds the value index of the specified key. */
+	void RebuildValueIndex(key & a_Key);
+
 	/// Removes the UTF-8 BOMs (Byte order makers), if present.
 	void RemoveBom(AString & a_line) const;
 	
@@ -64,8 +84,8 @@ public:
 
 	// Sets whether or not keynames and valuenames should be case sensitive.
 	// The default is case insensitive.
-	void CaseSensitive  (void) { m_IsCaseInsensitive = false; }
-	void CaseInsensitive(void) { m_IsCaseInsensitive = true; }
+	void CaseSensitive  (void) { m_IsCaseInsensitive = false; RebuildIndex(); }
+	void CaseInsensitive(void) { m_IsCaseInsensitive = true;  RebuildIndex(); }
 
 	/** Reads the contents of the specified ini file
 	If the file doesn't exist and a_AllowExampleRedirect is true, tries to read <basename>.example.ini, and
@@ -209,6 +229,20 @@ public:
 	// Delete all comments for a key.
 	bool DeleteKeyComments(const int keyID);
 	bool DeleteKeyComments(const AString & keyname);
+
+	// tolua_end
+
+	/** Returns a number that changes whenever any key or value is added, changed or removed, including by re-reading the file.
+	Used by the cIniSetting handles to tell when their cached value is stale. */
+	int GetGeneration(void) const { return m_Generation; }
+
+	/** Parse the value's text the same way as the respective GetValue() variants. */
+	static void ParseValue(const AString & a_Text, AString & a_Value) { a_Value = a_Text; }
+	static void ParseValue(const AString & a_Text, int & a_Value)     { a_Value = atoi(a_Text.c_str()); }
+	static void ParseValue(const AString & a_Text, double & a_Value)  { a_Value = atof(a_Text.c_str()); }
+	static void ParseValue(const AString & a_Text, bool & a_Value)    { a_Value = (atoi(a_Text.c_str()) != 0); }
+
+	// tolua_begin
 };
 
 // tolua_end
@@ -217,6 +251,76 @@ public:
 
 
 
+/** A handle to a single setting in a cIniFile, parsed into type T (AString, int, double or bool), for the code that reads
+the same setting repeatedly, such as on each event. The value is looked up and parsed on the first Get() and then only
+again after the ini file has changed, so the handle stays valid, and picks up the new value, when the file is re-read.
+The ini file must outlive the handle. Not thread-safe, same as cIniFile itself. */
+template <typename T>
+class cIniSetting
+{
+public:
+	cIniSetting(const cIniFile & a_IniFile, const AString & a_KeyName, const AString & a_ValueName, const T & a_Default) :
+		m_IniFile(a_IniFile),
+		m_KeyName(a_KeyName),
+		m_ValueName(a_ValueName),
+		m_Default(a_Default),
+		m_Value(a_Default),
+		m_IsPresent(false),
+		m_IsResolved(false),
+		m_Generation(0)
+	{
+	}
+
+	/** Returns the setting's value, or the default if the ini file doesn't have it. */
+	const T & Get(void)
+	{
+		if (!m_IsResolved || (m_Generation != m_IniFile.GetGeneration()))
+		{
+			Resolve();
+		}
+		return m_Value;
+	}
+
+	/** Returns true if the ini file has the setting. */
+	bool IsPresent(void)
+	{
+		Get();
+		return m_IsPresent;
+	}
+
+protected:
+	const cIniFile & m_IniFile;
+	AString m_KeyName;
+	AString m_ValueName;
+	T m_Default;
+
+	/** The parsed value, valid if m_IsResolved and m_Generation matches the ini file's generation. */
+	T m_Value;
+	bool m_IsPresent;
+	bool m_IsResolved;
+	int m_Generation;
+
+	/** Looks the value up in the ini file and parses it into m_Value. */
+	void Resolve(void)
+	{
+		m_IsResolved = true;
+		m_Generation = m_IniFile.GetGeneration();
+		int KeyID = m_IniFile.FindKey(m_KeyName);
+		int ValueID = (KeyID == cIniFile::noID) ? static_cast<int>(cIniFile::noID) : m_IniFile.FindValue(KeyID, m_ValueName);
+		m_IsPresent = (ValueID != cIniFile::noID);
+		if (!m_IsPresent)
+		{
+			m_Value = m_Default;
+			return;
+		}
+		cIniFile::ParseValue(m_IniFile.GetValue(KeyID, ValueID), m_Value);
+	}
+} ;
+
+
+
+
+
 /** Reads the list of ports from the INI file, possibly upgrading from IPv4 / IPv6-specific values into new version-agnostic value.
 Reads the list of ports from a_PortsValueName. If that value doesn't exist or is empty, the list is combined from values
 in a_OldIPv4ValueName and a_OldIPv6ValueName; in this case the old values are removed from the INI file.
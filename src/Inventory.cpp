@@ -439,6 +439,13 @@ void cInventory::SendSlot(int a_SlotNum)
 		Item.Empty();
 	}
 	m_Owner.GetClientHandle()->SendInventorySlot(0, a_SlotNum + 5, Item);  // Slots in the client are numbered "+ 5" because of crafting grid and result
+
+	// The slot has been sent outside the open window, which needs to resend it whole rather than rely on what it sent itself:
+	cWindow * Window = m_Owner.GetWindow();
+	if (Window != nullptr)
+	{
+		Window->ForgetSentSlots(m_Owner);
+	}
 }
 
 
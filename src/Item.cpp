@@ -328,7 +328,7 @@ bool cItem::EnchantByXPLevels(int a_NumXPLevels)
 	}
 
 	cEnchantments Enchantment1 = cEnchantments::GetRandomEnchantmentFromVector(Enchantments);
-	m_Enchantments.AddFromString(Enchantment1.ToString());
+	m_Enchantments.Add(Enchantment1);
 	cEnchantments::RemoveEnchantmentWeightFromVector(Enchantments, Enchantment1);
 
 	// Checking for conflicting enchantments
@@ -345,7 +345,7 @@ bool cItem::EnchantByXPLevels(int a_NumXPLevels)
 	}
 
 	cEnchantments Enchantment2 = cEnchantments::GetRandomEnchantmentFromVector(Enchantments);
-	m_Enchantments.AddFromString(Enchantment2.ToString());
+	m_Enchantments.Add(Enchantment2);
 	cEnchantments::RemoveEnchantmentWeightFromVector(Enchantments, Enchantment2);
 
 	// Checking for conflicting enchantments
@@ -360,7 +360,7 @@ bool cItem::EnchantByXPLevels(int a_NumXPLevels)
 	}
 
 	cEnchantments Enchantment3 = cEnchantments::GetRandomEnchantmentFromVector(Enchantments);
-	m_Enchantments.AddFromString(Enchantment3.ToString());
+	m_Enchantments.Add(Enchantment3);
 	cEnchantments::RemoveEnchantmentWeightFromVector(Enchantments, Enchantment3);
 
 	// Checking for conflicting enchantments
@@ -374,7 +374,7 @@ bool cItem::EnchantByXPLevels(int a_NumXPLevels)
 		return true;
 	}
 	cEnchantments Enchantment4 = cEnchantments::GetRandomEnchantmentFromVector(Enchantments);
-	m_Enchantments.AddFromString(Enchantment4.ToString());
+	m_Enchantments.Add(Enchantment4);
 
 	return true;
 }
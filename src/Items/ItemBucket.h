@@ -152,9 +152,9 @@ public:
 				return false;
 			}
 
-			cBlockHandler * Handler = BlockHandler(CurrentBlockType);
-			if (Handler->DoesDropOnUnsuitable())
+			if (cBlockInfo::DoesDropOnUnsuitable(CurrentBlockType))
 			{
+				cBlockHandler * Handler = BlockHandler(CurrentBlockType);
 				cChunkInterface ChunkInterface(a_World->GetChunkMap());
 				Handler->DropBlock(ChunkInterface, *a_World, a_PluginInterface, a_Player, BlockPos.x, BlockPos.y, BlockPos.z);
 			}
@@ -50,7 +50,7 @@ public:
 		NIBBLETYPE ClickedBlockMeta;
 		a_World.GetBlockTypeMeta(a_BlockX, a_BlockY, a_BlockZ, ClickedBlock, ClickedBlockMeta);
 		if (
-			BlockHandler(ClickedBlock)->DoesIgnoreBuildCollision() ||
+			cBlockInfo::DoesIgnoreBuildCollision(ClickedBlock) ||
 			BlockHandler(ClickedBlock)->DoesIgnoreBuildCollision(&a_Player, ClickedBlockMeta)
 		)
 		{
@@ -74,7 +74,7 @@ public:
 			// Clicked on side of block, make sure that placement won't be cancelled if there is a slab able to be double slabbed.
 			// No need to do combinability (dblslab) checks, client will do that here.
 			if (
-				!BlockHandler(PlaceBlock)->DoesIgnoreBuildCollision() &&
+				!cBlockInfo::DoesIgnoreBuildCollision(PlaceBlock) &&
 				!BlockHandler(PlaceBlock)->DoesIgnoreBuildCollision(&a_Player, PlaceMeta)
 			)
 			{
@@ -334,7 +334,7 @@ bool cItemHandler::OnPlayerPlace(
 
 	// Check if the block ignores build collision (water, grass etc.):
 	if (
-		BlockHandler(ClickedBlock)->DoesIgnoreBuildCollision() ||
+		cBlockInfo::DoesIgnoreBuildCollision(ClickedBlock) ||
 		BlockHandler(ClickedBlock)->DoesIgnoreBuildCollision(&a_Player, ClickedBlockMeta)
 	)
 	{
@@ -358,7 +358,7 @@ bool cItemHandler::OnPlayerPlace(
 		// Clicked on side of block, make sure that placement won't be cancelled if there is a slab able to be double slabbed.
 		// No need to do combinability (dblslab) checks, client will do that here.
 		if (
-			!BlockHandler(PlaceBlock)->DoesIgnoreBuildCollision() &&
+			!cBlockInfo::DoesIgnoreBuildCollision(PlaceBlock) &&
 			!BlockHandler(PlaceBlock)->DoesIgnoreBuildCollision(&a_Player, PlaceMeta)
 			)
 		{
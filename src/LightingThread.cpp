@@ -8,6 +8,11 @@
 #include "ChunkMap.h"
 #include "ChunkStay.h"
 #include "World.h"
+#include "BlockArea.h"
+
+#ifdef LIGHTING_USE_SSE2
+	#include <emmintrin.h>
+#endif
 
 
 
@@ -36,6 +41,12 @@ class cReader :
 			// We've already walked cChunkDef::Width * 3 in the "for z" cycle, that makes cChunkDef::Width * 6 rows left to skip
 			OutputIdx += cChunkDef::Width * 6;
 		}  // for y
+
+		// Remember which sections have any light sources, so that the blocklight seeding can skip the others:
+		for (size_t i = 0; i < cChunkData::NumSections; i++)
+		{
+			m_HasLightSources[i] = m_HasLightSources[i] || (a_ChunkBuffer.GetSectionBlockCount(i, bcLightSource) > 0);
+		}
 	}  // BlockTypes()
 	
 	
@@ -71,14 +82,17 @@ public:
 	HEIGHTTYPE m_MaxHeight;  // Maximum value in this chunk's heightmap
 	BLOCKTYPE * m_BlockTypes;  // 3x3 chunks of block types, organized as a single XZY blob of data (instead of 3x3 XZY blobs)
 	HEIGHTTYPE * m_HeightMap;  // 3x3 chunks of height map,  organized as a single XZY blob of data (instead of 3x3 XZY blobs)
+	bool * m_HasLightSources;  // For each section, whether any of the 3x3 chunks has a light source in it
 	
-	cReader(BLOCKTYPE * a_BlockTypes, HEIGHTTYPE * a_HeightMap) :
+	cReader(BLOCKTYPE * a_BlockTypes, HEIGHTTYPE * a_HeightMap, bool * a_HasLightSources) :
 		m_ReadingChunkX(0),
 		m_ReadingChunkZ(0),
 		m_MaxHeight(0),
 		m_BlockTypes(a_BlockTypes),
-		m_HeightMap(a_HeightMap)
+		m_HeightMap(a_HeightMap),
+		m_HasLightSources(a_HasLightSources)
 	{
+		std::fill(m_HasLightSources, m_HasLightSources + cChunkData::NumSections, false);
 	}
 } ;
 
@@ -90,10 +104,9 @@ public:
 // cLightingThread:
 
 cLightingThread::cLightingThread(void) :
-	super("cLightingThread"),
 	m_World(nullptr),
-	m_MaxHeight(0),
-	m_NumSeeds(0)
+	m_IsUpdatingBlockChanges(false),
+	m_ShouldTerminate(false)
 {
 }
 
@@ -110,12 +123,28 @@ cLightingThread::~cLightingThread()
 
 
 
-bool cLightingThread::Start(cWorld * a_World)
+bool cLightingThread::Start(cWorld * a_World, int a_NumThreads)
 {
 	ASSERT(m_World == nullptr);  // Not started yet
 	m_World = a_World;
 	
-	return super::Start();
+	if (a_NumThreads <= 0)
+	{
+		a_NumThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+	m_ShouldTerminate = false;
+	for (int i = 0; i < a_NumThreads; i++)
+	{
+		m_Workers.push_back(std::unique_ptr<cWorker>(new cWorker(*this)));
+	}
+	for (auto & Worker : m_Workers)
+	{
+		if (!Worker->Start())
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
 
@@ -126,6 +155,7 @@ void cLightingThread::Stop(void)
 {
 	{
 		cCSLock Lock(m_CS);
+		m_ShouldTerminate = true;
 		for (cChunkStays::iterator itr = m_PendingQueue.begin(), end = m_PendingQueue.end(); itr != end; ++itr)
 		{
 			(*itr)->Disable();
@@ -138,11 +168,16 @@ void cLightingThread::Stop(void)
 			delete *itr;
 		}
 		m_Queue.clear();
+		m_BlockChanges.clear();
 	}
-	m_ShouldTerminate = true;
-	m_evtItemAdded.Set();
+	for (auto & Worker : m_Workers)
+	{
+		Worker->SignalTerminate();
+	}
+	m_evtItemAdded.Set();  // Each worker passes the wakeup on to the next one when terminating
+	m_evtQueueEmpty.Set();  // Wake up anybody waiting for empty queue
 	
-	Wait();
+	m_Workers.clear();  // Waits for the threads to finish
 }
 
 
@@ -167,6 +202,32 @@ void cLightingThread::QueueChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallback
 
 
 
+void cLightingThread::QueueBlockChange(int a_BlockX, int a_BlockY, int a_BlockZ, int a_MinBlockY, bool a_ShouldUpdateBlockLight, bool a_ShouldUpdateSkyLight)
+{
+	UNUSED(a_BlockY);
+	QueueAreaChange(a_BlockX, a_BlockX, a_BlockZ, a_BlockZ, a_MinBlockY, a_ShouldUpdateBlockLight, a_ShouldUpdateSkyLight);
+}
+
+
+
+
+
+void cLightingThread::QueueAreaChange(int a_MinBlockX, int a_MaxBlockX, int a_MinBlockZ, int a_MaxBlockZ, int a_MinBlockY, bool a_ShouldUpdateBlockLight, bool a_ShouldUpdateSkyLight)
+{
+	ASSERT(a_MinBlockX <= a_MaxBlockX);
+	ASSERT(a_MinBlockZ <= a_MaxBlockZ);
+	sBlockChange Change = {a_MinBlockX, a_MaxBlockX, a_MinBlockZ, a_MaxBlockZ, a_MinBlockY, a_ShouldUpdateBlockLight, a_ShouldUpdateSkyLight};
+	{
+		cCSLock Lock(m_CS);
+		m_BlockChanges.push_back(Change);
+	}
+	m_evtItemAdded.Set();
+}
+
+
+
+
+
 void cLightingThread::WaitForQueueEmpty(void)
 {
 	cCSLock Lock(m_CS);
@@ -191,43 +252,71 @@ size_t cLightingThread::GetQueueLength(void)
 
 
 
-void cLightingThread::Execute(void)
+bool cLightingThread::TakeNextItem(cLightingChunkStay *& a_ChunkStay, cBlockChanges & a_BlockChanges)
 {
+	a_ChunkStay = nullptr;
+	cCSLock Lock(m_CS);
 	for (;;)
 	{
+		if (m_ShouldTerminate)
 		{
-			cCSLock Lock(m_CS);
-			if (m_Queue.empty())
-			{
-				cCSUnlock Unlock(Lock);
-				m_evtItemAdded.Wait();
-			}
+			Lock.Unlock();
+			m_evtItemAdded.Set();  // Wake up the next worker so that it terminates, too
+			return false;
 		}
-		
-		if (m_ShouldTerminate)
+
+		// Block changes go first, they are cheap and visible to the players:
+		if (!m_BlockChanges.empty() && !m_IsUpdatingBlockChanges)
 		{
-			return;
+			std::swap(a_BlockChanges, m_BlockChanges);
+			m_IsUpdatingBlockChanges = true;
+			bool HasMoreItems = !m_Queue.empty();
+			Lock.Unlock();
+			if (HasMoreItems)
+			{
+				m_evtItemAdded.Set();
+			}
+			return true;
 		}
-		
-		// Process one items from the queue:
-		cLightingChunkStay * Item;
+
+		// Find the first item whose 3x3 neighborhood doesn't contain any chunk being lit by other workers:
+		for (cChunkStays::iterator itr = m_Queue.begin(), end = m_Queue.end(); itr != end; ++itr)
 		{
-			cCSLock Lock(m_CS);
-			if (m_Queue.empty())
+			cLightingChunkStay * Item = static_cast<cLightingChunkStay *>(*itr);
+			bool IsOverlapping = false;
+			for (auto InProgress : m_InProgress)
+			{
+				if ((std::abs(InProgress->m_ChunkX - Item->m_ChunkX) <= 1) && (std::abs(InProgress->m_ChunkZ - Item->m_ChunkZ) <= 1))
+				{
+					IsOverlapping = true;
+					break;
+				}
+			}
+			if (IsOverlapping)
 			{
 				continue;
 			}
-			Item = (cLightingChunkStay *)m_Queue.front();
-			m_Queue.pop_front();
+
+			m_Queue.erase(itr);
+			m_InProgress.push_back(Item);
+			bool HasMoreItems = !m_Queue.empty() || (!m_BlockChanges.empty() && !m_IsUpdatingBlockChanges);
 			if (m_Queue.empty())
 			{
 				m_evtQueueEmpty.Set();
 			}
-		}  // CSLock(m_CS)
-		
-		LightChunk(*Item);
-		Item->Disable();
-		delete Item;
+			Lock.Unlock();
+			if (HasMoreItems)
+			{
+				// Wake up another worker to process the rest of the queue:
+				m_evtItemAdded.Set();
+			}
+			a_ChunkStay = Item;
+			return true;
+		}
+
+		// No suitable item, wait for more items to be queued or for an item in progress to finish:
+		cCSUnlock Unlock(Lock);
+		m_evtItemAdded.Wait();
 	}
 }
 
@@ -235,8 +324,106 @@ void cLightingThread::Execute(void)
 
 
 
+void cLightingThread::FinishBlockChanges(void)
+{
+	bool HasMoreItems;
+	{
+		cCSLock Lock(m_CS);
+		m_IsUpdatingBlockChanges = false;
+		HasMoreItems = !m_BlockChanges.empty() || !m_Queue.empty();
+	}
+	if (HasMoreItems)
+	{
+		m_evtItemAdded.Set();
+	}
+}
+
+
+
+
 
-void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
+void cLightingThread::FinishItem(cLightingChunkStay * a_Item)
+{
+	a_Item->Disable();
+	bool HasMoreItems;
+	{
+		cCSLock Lock(m_CS);
+		m_InProgress.erase(std::remove(m_InProgress.begin(), m_InProgress.end(), a_Item), m_InProgress.end());
+		HasMoreItems = !m_Queue.empty();
+	}
+	delete a_Item;
+
+	if (HasMoreItems)
+	{
+		// Items that overlapped this one may be available for processing now:
+		m_evtItemAdded.Set();
+	}
+}
+
+
+
+
+
+void cLightingThread::QueueChunkStay(cLightingChunkStay & a_ChunkStay)
+{
+	// Move the ChunkStay from the Pending queue to the lighting queue.
+	{
+		cCSLock Lock(m_CS);
+		m_PendingQueue.remove(&a_ChunkStay);
+		m_Queue.push_back(&a_ChunkStay);
+	}
+	m_evtItemAdded.Set();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cLightingThread::cWorker:
+
+cLightingThread::cWorker::cWorker(cLightingThread & a_LightingThread) :
+	super("cLightingThread::cWorker"),
+	m_LightingThread(a_LightingThread),
+	m_World(a_LightingThread.m_World),
+	m_MaxHeight(0),
+	m_NumSeeds(0)
+{
+}
+
+
+
+
+
+void cLightingThread::cWorker::Execute(void)
+{
+	cBlockChanges BlockChanges;
+	for (;;)
+	{
+		cLightingChunkStay * Item;
+		if (!m_LightingThread.TakeNextItem(Item, BlockChanges))
+		{
+			return;
+		}
+		if (Item != nullptr)
+		{
+			LightChunk(*Item);
+			m_LightingThread.FinishItem(Item);
+		}
+		else
+		{
+			UpdateBlockChanges(BlockChanges);
+			BlockChanges.clear();
+			m_LightingThread.FinishBlockChanges();
+		}
+	}
+}
+
+
+
+
+
+void cLightingThread::cWorker::LightChunk(cLightingChunkStay & a_Item)
 {
 	// If the chunk is already lit, skip it:
 	if (m_World->IsChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ))
@@ -332,9 +519,192 @@ void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
 
 
 
-void cLightingThread::ReadChunks(int a_ChunkX, int a_ChunkZ)
+/// Maximum size of the changed-blocks box, in the X and Z directions, that nearby block changes are merged into
+static const int MAX_BLOCK_CHANGE_MERGE_SIZE = 32;
+
+void cLightingThread::cWorker::UpdateBlockChanges(cBlockChanges & a_Changes)
 {
-	cReader Reader(m_BlockTypes, m_HeightMap);
+	while (!a_Changes.empty())
+	{
+		sBlockChange Box = a_Changes.back();
+		a_Changes.pop_back();
+
+		// Merge all the other changes that fit, so that the overlapping areas are read, recalculated and written only once:
+		for (size_t i = a_Changes.size(); i > 0; i--)
+		{
+			const sBlockChange & Change = a_Changes[i - 1];
+			int MinX = std::min(Box.m_MinX, Change.m_MinX);
+			int MaxX = std::max(Box.m_MaxX, Change.m_MaxX);
+			int MinZ = std::min(Box.m_MinZ, Change.m_MinZ);
+			int MaxZ = std::max(Box.m_MaxZ, Change.m_MaxZ);
+			if ((MaxX - MinX >= MAX_BLOCK_CHANGE_MERGE_SIZE) || (MaxZ - MinZ >= MAX_BLOCK_CHANGE_MERGE_SIZE))
+			{
+				continue;
+			}
+			Box.m_MinX = MinX;
+			Box.m_MaxX = MaxX;
+			Box.m_MinZ = MinZ;
+			Box.m_MaxZ = MaxZ;
+			Box.m_MinY = std::min(Box.m_MinY, Change.m_MinY);
+			Box.m_ShouldUpdateBlockLight = Box.m_ShouldUpdateBlockLight || Change.m_ShouldUpdateBlockLight;
+			Box.m_ShouldUpdateSkyLight   = Box.m_ShouldUpdateSkyLight   || Change.m_ShouldUpdateSkyLight;
+			a_Changes[i - 1] = a_Changes.back();
+			a_Changes.pop_back();
+		}
+
+		UpdateBlockChange(Box);
+	}
+}
+
+
+
+
+
+void cLightingThread::cWorker::UpdateBlockChange(const sBlockChange & a_Change)
+{
+	// Each step loses at least one light level, so only the blocks up to 15 blocks away from the change can be affected.
+	// Read one more block on each side (except the top, which is the sky), that layer keeps its light and acts as the light coming from outside:
+	int MinX = a_Change.m_MinX - 16;
+	int MaxX = a_Change.m_MaxX + 16;
+	int MinZ = a_Change.m_MinZ - 16;
+	int MaxZ = a_Change.m_MaxZ + 16;
+	int MinY = std::max(0, a_Change.m_MinY - 16);
+	int MaxY = cChunkDef::Height - 1;
+	int LightTypes = (a_Change.m_ShouldUpdateBlockLight ? cBlockArea::baLight : 0) | (a_Change.m_ShouldUpdateSkyLight ? cBlockArea::baSkyLight : 0);
+
+	cBlockArea Area;
+	if (!Area.Read(m_World, MinX, MaxX, MinY, MaxY, MinZ, MaxZ, cBlockArea::baTypes | LightTypes))
+	{
+		// Some of the chunks are not available, the light will stay as it is:
+		LOGD("Cannot update the light around blocks {%d - %d, %d - %d}, the chunks are not available", a_Change.m_MinX, a_Change.m_MaxX, a_Change.m_MinZ, a_Change.m_MaxZ);
+		return;
+	}
+
+	// Reset the inner blocks to only their own light, skylight for the blocks above the heightmap:
+	int SizeX = Area.GetSizeX();
+	int SizeY = Area.GetSizeY();
+	int SizeZ = Area.GetSizeZ();
+	int MinInnerY = (MinY == 0) ? 0 : 1;
+	const BLOCKTYPE * BlockTypes = Area.GetBlockTypes();
+	NIBBLETYPE * BlockLight = Area.GetBlockLight();
+	NIBBLETYPE * SkyLight = Area.GetBlockSkyLight();
+	for (int z = 1; z < SizeZ - 1; z++)
+	{
+		for (int x = 1; x < SizeX - 1; x++)
+		{
+			bool IsSky = true;
+			for (int y = SizeY - 1; y >= MinInnerY; y--)
+			{
+				int Idx = Area.MakeIndex(x, y, z);
+				IsSky = IsSky && (BlockTypes[Idx] == E_BLOCK_AIR);
+				if (SkyLight != nullptr)
+				{
+					SkyLight[Idx] = IsSky ? 15 : 0;
+				}
+				if (BlockLight != nullptr)
+				{
+					BlockLight[Idx] = cBlockInfo::GetLightValue(BlockTypes[Idx]);
+				}
+			}  // for y
+		}  // for x
+	}  // for z
+
+	if (BlockLight != nullptr)
+	{
+		SpreadAreaLight(Area, BlockLight, MinInnerY);
+	}
+	if (SkyLight != nullptr)
+	{
+		SpreadAreaLight(Area, SkyLight, MinInnerY);
+	}
+
+	// The clients calculate the light on their own after a block change, so the light is only written into the world:
+	Area.Write(m_World, MinX, MinY, MinZ, LightTypes);
+}
+
+
+
+
+
+void cLightingThread::cWorker::SpreadAreaLight(const cBlockArea & a_Area, NIBBLETYPE * a_Light, int a_MinInnerY)
+{
+	int SizeX = a_Area.GetSizeX();
+	int SizeY = a_Area.GetSizeY();
+	int SizeZ = a_Area.GetSizeZ();
+	int StrideZ = SizeX;
+	int StrideY = SizeX * SizeZ;
+	const BLOCKTYPE * BlockTypes = a_Area.GetBlockTypes();
+
+	// Start with all the blocks that can spread any light; a block is re-added each time its light increases:
+	std::vector<int> Queue;
+	int NumBlocks = StrideY * SizeY;
+	for (int i = 0; i < NumBlocks; i++)
+	{
+		if (a_Light[i] > 1)
+		{
+			Queue.push_back(i);
+		}
+	}
+
+	for (size_t q = 0; q < Queue.size(); q++)
+	{
+		int Idx = Queue[q];
+		int X = Idx % SizeX;
+		int Z = (Idx / StrideZ) % SizeZ;
+		int Y = Idx / StrideY;
+		int Light = a_Light[Idx];
+
+		// Offer the light to the neighbors that are in the inner part of the area:
+		int Neighbors[6][2] =
+		{
+			{X - 1,  -1},
+			{X + 1,   1},
+			{Z - 1,  -StrideZ},
+			{Z + 1,   StrideZ},
+			{Y - 1,  -StrideY},
+			{Y + 1,   StrideY},
+		};
+		for (int n = 0; n < 6; n++)
+		{
+			int Coord = Neighbors[n][0];
+			bool IsInner;
+			if (n < 2)
+			{
+				IsInner = (Coord > 0) && (Coord < SizeX - 1);
+			}
+			else if (n < 4)
+			{
+				IsInner = (Coord > 0) && (Coord < SizeZ - 1);
+			}
+			else
+			{
+				IsInner = (Coord >= a_MinInnerY) && (Coord < SizeY);
+			}
+			if (!IsInner)
+			{
+				continue;
+			}
+			int NeighborIdx = Idx + Neighbors[n][1];
+			int Offered = Light - cBlockInfo::GetSpreadLightFalloff(BlockTypes[NeighborIdx]);
+			if (Offered > a_Light[NeighborIdx])
+			{
+				a_Light[NeighborIdx] = static_cast<NIBBLETYPE>(Offered);
+				if (Offered > 1)
+				{
+					Queue.push_back(NeighborIdx);
+				}
+			}
+		}  // for n - Neighbors[]
+	}  // for q - Queue[]
+}
+
+
+
+
+
+void cLightingThread::cWorker::ReadChunks(int a_ChunkX, int a_ChunkZ)
+{
+	cReader Reader(m_BlockTypes, m_HeightMap, m_HasLightSources);
 	
 	for (int z = 0; z < 3; z++)
 	{
@@ -349,17 +719,27 @@ void cLightingThread::ReadChunks(int a_ChunkX, int a_ChunkZ)
 	memset(m_BlockLight, 0, sizeof(m_BlockLight));
 	memset(m_SkyLight,   0, sizeof(m_SkyLight));
 	m_MaxHeight = Reader.m_MaxHeight;
+
+	#ifdef LIGHTING_USE_SSE2
+		PrepareSpreadFalloff();
+	#endif
 }
 
 
 
 
 
-void cLightingThread::PrepareSkyLight(void)
+void cLightingThread::cWorker::PrepareSkyLight(void)
 {
-	// Clear seeds:
-	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
+	// Clear seeds (not needed by the SSE2 kernel):
+	#ifndef LIGHTING_USE_SSE2
+		memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
+	#endif
 	m_NumSeeds = 0;
+
+	// Everything above the highest block is lit fully, fill those layers in bulk:
+	int FullLightStart = std::min(+cChunkDef::Height, m_MaxHeight + 1);
+	memset(m_SkyLight + FullLightStart * BlocksPerYLayer, 15, static_cast<size_t>((cChunkDef::Height - FullLightStart) * BlocksPerYLayer));
 	
 	// Walk every column that has all XZ neighbors
 	for (int z = 1; z < cChunkDef::Width * 3 - 1; z++)
@@ -375,8 +755,8 @@ void cLightingThread::PrepareSkyLight(void)
 			int Neighbor4 = m_HeightMap[idx - cChunkDef::Width * 3] + 1;  // Z - 1
 			int MaxNeighbor = std::max(std::max(Neighbor1, Neighbor2), std::max(Neighbor3, Neighbor4));  // Maximum of the four neighbors
 			
-			// Fill the column from the top down to Current with all-light:
-			for (int y = cChunkDef::Height - 1, Index = idx + y * BlocksPerYLayer; y >= Current; y--, Index -= BlocksPerYLayer)
+			// Fill the column from the highest block down to Current with all-light:
+			for (int y = FullLightStart - 1, Index = idx + y * BlocksPerYLayer; y >= Current; y--, Index -= BlocksPerYLayer)
 			{
 				m_SkyLight[Index] = 15;
 			}
@@ -403,11 +783,13 @@ void cLightingThread::PrepareSkyLight(void)
 
 
 
-void cLightingThread::PrepareBlockLight(void)
+void cLightingThread::cWorker::PrepareBlockLight(void)
 {
-	// Clear seeds:
-	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
-	memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
+	// Clear seeds (not needed by the SSE2 kernel):
+	#ifndef LIGHTING_USE_SSE2
+		memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
+		memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
+	#endif
 	m_NumSeeds = 0;
 
 	// Walk every column that has all XZ neighbors, make a seed for each light-emitting block:
@@ -419,6 +801,14 @@ void cLightingThread::PrepareBlockLight(void)
 			int idx = BaseZ + x;
 			for (int y = m_HeightMap[idx], Index = idx + y * BlocksPerYLayer; y >= 0; y--, Index -= BlocksPerYLayer)
 			{
+				if (!m_HasLightSources[static_cast<size_t>(y) / cChunkData::SectionHeight])
+				{
+					// No light sources in this section, continue with the top of the section below:
+					int Skip = y % static_cast<int>(cChunkData::SectionHeight);
+					y -= Skip;
+					Index -= Skip * BlocksPerYLayer;
+					continue;
+				}
 				if (cBlockInfo::GetLightValue(m_BlockTypes[Index]) == 0)
 				{
 					continue;
@@ -439,16 +829,23 @@ void cLightingThread::PrepareBlockLight(void)
 
 
 
-void cLightingThread::PrepareBlockLight2(void)
+void cLightingThread::cWorker::PrepareBlockLight2(void)
 {
-	// Clear seeds:
-	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
-	memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
+	// Clear seeds (not needed by the SSE2 kernel):
+	#ifndef LIGHTING_USE_SSE2
+		memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
+		memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
+	#endif
 	m_NumSeeds = 0;
 	
 	// Add each emissive block into the seeds:
 	for (int y = 0; y < m_MaxHeight; y++)
 	{
+		if (!m_HasLightSources[static_cast<size_t>(y) / cChunkData::SectionHeight])
+		{
+			// No light sources in this section
+			continue;
+		}
 		int BaseY = y * BlocksPerYLayer;  // Partial offset into m_BlockTypes for the Y coord
 		for (int z = 1; z < cChunkDef::Width * 3 - 1; z++)
 		{
@@ -483,7 +880,20 @@ void cLightingThread::PrepareBlockLight2(void)
 
 
 
-void cLightingThread::CalcLight(NIBBLETYPE * a_Light)
+void cLightingThread::cWorker::CalcLight(NIBBLETYPE * a_Light)
+{
+	#ifdef LIGHTING_USE_SSE2
+		CalcLightLayers(a_Light);
+	#else
+		CalcLightSeeds(a_Light);
+	#endif
+}
+
+
+
+
+
+void cLightingThread::cWorker::CalcLightSeeds(NIBBLETYPE * a_Light)
 {
 	int NumSeeds2 = 0;
 	while (m_NumSeeds > 0)
@@ -508,7 +918,139 @@ void cLightingThread::CalcLight(NIBBLETYPE * a_Light)
 
 
 
-void cLightingThread::CalcLightStep(
+#ifdef LIGHTING_USE_SSE2
+
+void cLightingThread::cWorker::PrepareSpreadFalloff(void)
+{
+	// Everything above the highest block is air; ReadChunks() doesn't even fill the block types that high up:
+	int NumBlocks = std::min(+cChunkDef::Height, m_MaxHeight + 1) * BlocksPerYLayer;
+	for (int i = 0; i < NumBlocks; i++)
+	{
+		m_SpreadFalloff[i] = cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[i]);
+	}
+	memset(m_SpreadFalloff + NumBlocks, cBlockInfo::GetSpreadLightFalloff(E_BLOCK_AIR), sizeof(m_SpreadFalloff) - static_cast<size_t>(NumBlocks));
+}
+
+
+
+
+
+void cLightingThread::cWorker::CalcLightLayers(NIBBLETYPE * a_Light)
+{
+	// Each layer remembers when it was last processed and when it last changed (in "layers processed so far" units).
+	// A layer needs processing if it or any of its Y neighbors changed after the layer was last processed.
+	// LastChanged is indexed by Y + 1, with a never-changing sentinel on each end.
+	// The layers 15 and more blocks above the highest block can't change: they're out of the blocklight's reach
+	// and already have full skylight (PrepareSkyLight()), so the sweeps end below them:
+	int NumLayers = std::min(+cChunkDef::Height, m_MaxHeight + 16);
+	int LastChanged[cChunkDef::Height + 2];
+	int LastProcessed[cChunkDef::Height];
+	int Time = 1;
+	LastChanged[0] = 0;
+	LastChanged[NumLayers + 1] = 0;
+	for (int y = 0; y < NumLayers; y++)
+	{
+		// Only the layers that have any light in them need to be processed initially:
+		const __m128i * Layer = reinterpret_cast<const __m128i *>(a_Light + y * BlocksPerYLayer);
+		__m128i Any = _mm_setzero_si128();
+		for (int i = 0; i < BlocksPerYLayer / 16; i++)
+		{
+			Any = _mm_or_si128(Any, _mm_loadu_si128(Layer + i));
+		}
+		LastChanged[y + 1] = (_mm_movemask_epi8(_mm_cmpeq_epi8(Any, _mm_setzero_si128())) == 0xffff) ? 0 : Time;
+		LastProcessed[y] = 0;
+	}
+
+	// Sweep the layers alternately upwards and downwards, until a whole sweep has nothing to process:
+	bool IsUpwards = true;
+	bool HasProcessedAny;
+	do
+	{
+		HasProcessedAny = false;
+		for (int i = 0; i < NumLayers; i++)
+		{
+			int y = IsUpwards ? i : (NumLayers - 1 - i);
+			bool HasSelfChanged = (LastChanged[y + 1] != 0) && (LastChanged[y + 1] >= LastProcessed[y]);
+			if (!HasSelfChanged && (LastChanged[y] <= LastProcessed[y]) && (LastChanged[y + 2] <= LastProcessed[y]))
+			{
+				continue;
+			}
+			Time++;
+			LastProcessed[y] = Time;
+			if (CalcLightLayer(a_Light, y))
+			{
+				LastChanged[y + 1] = Time;
+			}
+			HasProcessedAny = true;
+		}
+		IsUpwards = !IsUpwards;
+	} while (HasProcessedAny);
+}
+
+
+
+
+
+bool cLightingThread::cWorker::CalcLightLayer(NIBBLETYPE * a_Light, int a_Y)
+{
+	static const int RowLength = cChunkDef::Width * 3;
+	static_assert(RowLength == 3 * 16, "The kernel expects each row to be exactly 3 SSE2 vectors");
+
+	const __m128i Zero = _mm_setzero_si128();
+	__m128i Increase = Zero;  // OR of all the light increases in the layer
+	int LayerStart = a_Y * BlocksPerYLayer;
+	for (int z = 0; z < RowLength; z++)
+	{
+		NIBBLETYPE * Row = a_Light + LayerStart + z * RowLength;
+		const NIBBLETYPE * RowFalloff = m_SpreadFalloff + LayerStart + z * RowLength;
+		__m128i Prev = Zero;  // The (already updated) previous 16 blocks in the row, zero before the row start
+		__m128i Cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Row));
+		for (int i = 0; i < RowLength; i += 16)
+		{
+			__m128i Next = (i + 16 < RowLength) ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(Row + i + 16)) : Zero;
+
+			// Max of the X neighbors, shifted in from the adjacent vectors:
+			__m128i Max = _mm_or_si128(_mm_slli_si128(Cur, 1), _mm_srli_si128(Prev, 15));
+			Max = _mm_max_epu8(Max, _mm_or_si128(_mm_srli_si128(Cur, 1), _mm_slli_si128(Next, 15)));
+
+			// Z and Y neighbors, where they exist:
+			if (z > 0)
+			{
+				Max = _mm_max_epu8(Max, _mm_loadu_si128(reinterpret_cast<const __m128i *>(Row + i - RowLength)));
+			}
+			if (z < RowLength - 1)
+			{
+				Max = _mm_max_epu8(Max, _mm_loadu_si128(reinterpret_cast<const __m128i *>(Row + i + RowLength)));
+			}
+			if (a_Y > 0)
+			{
+				Max = _mm_max_epu8(Max, _mm_loadu_si128(reinterpret_cast<const __m128i *>(Row + i - BlocksPerYLayer)));
+			}
+			if (a_Y < cChunkDef::Height - 1)
+			{
+				Max = _mm_max_epu8(Max, _mm_loadu_si128(reinterpret_cast<const __m128i *>(Row + i + BlocksPerYLayer)));
+			}
+
+			// Offered light is the neighbor max minus own falloff, saturated at zero; keep whichever is higher:
+			__m128i Offered = _mm_subs_epu8(Max, _mm_loadu_si128(reinterpret_cast<const __m128i *>(RowFalloff + i)));
+			Increase = _mm_or_si128(Increase, _mm_subs_epu8(Offered, Cur));
+			__m128i New = _mm_max_epu8(Cur, Offered);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(Row + i), New);
+
+			Prev = New;
+			Cur = Next;
+		}
+	}
+	return (_mm_movemask_epi8(_mm_cmpeq_epi8(Increase, Zero)) != 0xffff);
+}
+
+#endif  // LIGHTING_USE_SSE2
+
+
+
+
+
+void cLightingThread::cWorker::CalcLightStep(
 	NIBBLETYPE * a_Light,
 	int a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
 	int & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
@@ -556,7 +1098,7 @@ void cLightingThread::CalcLightStep(
 
 
 
-void cLightingThread::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight)
+void cLightingThread::cWorker::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight)
 {
 	int InIdx = cChunkDef::Width * 49;  // Index to the first nibble of the middle chunk in the a_LightArray
 	int OutIdx = 0;
@@ -581,21 +1123,6 @@ void cLightingThread::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_Ch
 
 
 
-void cLightingThread::QueueChunkStay(cLightingChunkStay & a_ChunkStay)
-{
-	// Move the ChunkStay from the Pending queue to the lighting queue.
-	{
-		cCSLock Lock(m_CS);
-		m_PendingQueue.remove(&a_ChunkStay);
-		m_Queue.push_back(&a_ChunkStay);
-	}
-	m_evtItemAdded.Set();
-}
-
-
-
-
-
 ////////////////////////////////////////////////////////////////////////////////
 // cLightingThread::cLightingChunkStay:
 
@@ -21,10 +21,21 @@ the other is an array of seed coords, encoded as a single int.
 Step 2 needs two separate storages for old seeds and new seeds, so there are two actual storages for that purpose,
 their content is swapped after each full step-2-cycle.
 
-The thread has two queues of chunks that are to be lighted.
-The first queue, m_Queue, is the only one that is publicly visible, chunks get queued there by external requests.
-The second one, m_PostponedQueue, is for chunks that have been taken out of m_Queue and didn't have neighbors ready.
-Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors get valid, using the ChunkReady callback.
+The object has two queues of chunks that are to be lighted.
+The first queue, m_PendingQueue, holds the ChunkStays that are waiting for their 3x3 neighborhood to load.
+The second one, m_Queue, holds the ChunkStays that are fully loaded and are ready to be lit.
+Chunks from m_PendingQueue are moved into m_Queue by the ChunkStay's OnAllChunksAvailable() callback.
+
+The lighting is done by several worker threads, each with its own lighting context - the 3x3 buffers and the seeds.
+A worker only takes a chunk from m_Queue if none of the chunks in its 3x3 neighborhood is being lit by another worker,
+so overlapping ChunkStays (and duplicate requests for the same chunk) are always processed one after another.
+The number of workers is set by the [Lighting] NumThreads value in world.ini (0 = one per CPU core).
+
+Single block changes in chunks that are already lit are handled incrementally, without relighting the whole chunk.
+Since the light stemming from a block can reach at most 15 blocks, only the light in a box extending 16 blocks
+around the changed block (and from above it up to the sky) needs to be recalculated, with the light at the box's
+outer layer serving as the fixed light from outside. The changes are queued in m_BlockChanges, nearby changes
+get merged into a single box, and one worker at a time processes them, before any queued chunks.
 */
 
 
@@ -33,8 +44,14 @@ Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors ge
 
 #include "OSSupport/IsThread.h"
 #include "ChunkDef.h"
+#include "ChunkData.h"
 #include "ChunkStay.h"
 
+// Use the SSE2 light propagation kernel where available; other platforms use the scalar seed-based propagation:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define LIGHTING_USE_SSE2
+#endif
+
 
 
 
@@ -42,31 +59,44 @@ Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors ge
 // fwd: "cWorld.h"
 class cWorld;
 
+// fwd: "BlockArea.h"
+class cBlockArea;
 
 
 
 
-class cLightingThread :
-	public cIsThread
+
+class cLightingThread
 {
-	typedef cIsThread super;
-	
 public:
 	
 	cLightingThread(void);
 	~cLightingThread();
 	
-	bool Start(cWorld * a_World);
+	/** Starts the specified number of worker threads (0 = one per CPU core). */
+	bool Start(cWorld * a_World, int a_NumThreads);
 	
 	void Stop(void);
 	
 	/** Queues the entire chunk for lighting */
 	void QueueChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallback * a_CallbackAfter = nullptr);
+
+	/** Queues an incremental light update around a single changed block in an already lit chunk.
+	a_MinBlockY is the lowest block whose light sources may have changed (the heightmap, for skylight).
+	a_ShouldUpdateBlockLight and a_ShouldUpdateSkyLight specify which of the lights need updating. */
+	void QueueBlockChange(int a_BlockX, int a_BlockY, int a_BlockZ, int a_MinBlockY, bool a_ShouldUpdateBlockLight, bool a_ShouldUpdateSkyLight);
+
+	/** Queues an incremental light update around a box of changed blocks {a_MinBlockX - a_MaxBlockX, a_MinBlockZ - a_MaxBlockZ}
+	(inclusive), spanning all the blocks from a_MinBlockY up. Used by the bulk block changes, so that the whole area is relit at once. */
+	void QueueAreaChange(int a_MinBlockX, int a_MaxBlockX, int a_MinBlockZ, int a_MaxBlockZ, int a_MinBlockY, bool a_ShouldUpdateBlockLight, bool a_ShouldUpdateSkyLight);
 	
 	/** Blocks until the queue is empty or the thread is terminated */
 	void WaitForQueueEmpty(void);
 	
 	size_t GetQueueLength(void);
+
+	/** Returns the number of worker threads lighting the chunks in parallel. */
+	size_t GetNumWorkers(void) const { return m_Workers.size(); }
 	
 protected:
 
@@ -92,11 +122,162 @@ protected:
 	} ;
 	
 	typedef std::list<cChunkStay *> cChunkStays;
+
+	/** A box of changed blocks whose light needs an incremental update. Coords are inclusive. */
+	struct sBlockChange
+	{
+		int m_MinX, m_MaxX;
+		int m_MinZ, m_MaxZ;
+		int m_MinY;
+		bool m_ShouldUpdateBlockLight;
+		bool m_ShouldUpdateSkyLight;
+	};
+
+	typedef std::vector<sBlockChange> cBlockChanges;
+
+	/** A single lighting thread, with its own lighting context (the 3x3 chunk buffers and the seeds). */
+	class cWorker :
+		public cIsThread
+	{
+		typedef cIsThread super;
+
+	public:
+		cWorker(cLightingThread & a_LightingThread);
+
+		/** Sets the termination flag, without waiting for the thread to finish. */
+		void SignalTerminate(void) { m_ShouldTerminate = true; }
+
+	protected:
+		cLightingThread & m_LightingThread;
+
+		cWorld * m_World;
+
+		/** The highest block in the current 3x3 chunk data */
+		HEIGHTTYPE m_MaxHeight;
+	
+	
+		// Buffers for the 3x3 chunk data
+		// These buffers alone are 1.7 MiB in size, therefore they cannot be located on the stack safely - some architectures may have only 1 MiB for stack, or even less
+		// Each worker has its own set of buffers, so that the workers can light chunks in parallel
+		// The blobs are XZY organized as a whole, instead of 3x3 XZY-organized subarrays ->
+		//  -> This means data has to be scatterred when reading and gathered when writing!
+		static const int BlocksPerYLayer = cChunkDef::Width * cChunkDef::Width * 3 * 3;
+		BLOCKTYPE  m_BlockTypes[BlocksPerYLayer * cChunkDef::Height];
+		NIBBLETYPE m_BlockLight[BlocksPerYLayer * cChunkDef::Height];
+		NIBBLETYPE m_SkyLight  [BlocksPerYLayer * cChunkDef::Height];
+		HEIGHTTYPE m_HeightMap [BlocksPerYLayer];
+
+		/** For each section, whether any of the 3x3 chunks has a light source in it; the blocklight seeding skips the others. */
+		bool m_HasLightSources[cChunkData::NumSections];
+	
+		// Seed management (5.7 MiB)
+		// Two buffers, in each calc step one is set as input and the other as output, then in the next step they're swapped
+		// Each seed is represented twice in this structure - both as a "list" and as a "position".
+		// "list" allows fast traversal from seed to seed
+		// "position" allows fast checking if a coord is already a seed
+		unsigned char m_IsSeed1 [BlocksPerYLayer * cChunkDef::Height];
+		unsigned int  m_SeedIdx1[BlocksPerYLayer * cChunkDef::Height];
+		unsigned char m_IsSeed2 [BlocksPerYLayer * cChunkDef::Height];
+		unsigned int  m_SeedIdx2[BlocksPerYLayer * cChunkDef::Height];
+		int m_NumSeeds;
+
+		#ifdef LIGHTING_USE_SSE2
+			/** The spread light falloff for each block in m_BlockTypes, in the same layout, so that whole rows can be loaded at once. */
+			NIBBLETYPE m_SpreadFalloff[BlocksPerYLayer * cChunkDef::Height];
+		#endif
+
+		// cIsThread override:
+		virtual void Execute(void) override;
+
+		/** Lights the entire chunk. All the neighbor chunks are expected to be loaded by the ChunkStay. */
+		void LightChunk(cLightingChunkStay & a_Item);
+
+		/** Merges nearby block changes into larger boxes and updates the light in each of them. */
+		void UpdateBlockChanges(cBlockChanges & a_Changes);
+
+		/** Recalculates the light around the specified box of changed blocks, directly in the world. */
+		void UpdateBlockChange(const sBlockChange & a_Change);
+
+		/** Spreads the light in a_Light over the inner part of the area (all but the outermost layer on the sides
+		and the bottom, unless the area starts at Y = 0), starting from every block that has light. */
+		void SpreadAreaLight(const cBlockArea & a_Area, NIBBLETYPE * a_Light, int a_MinInnerY);
+	
+		/** Prepares m_BlockTypes and m_HeightMap data; zeroes out the light arrays */
+		void ReadChunks(int a_ChunkX, int a_ChunkZ);
+	
+		/** Uses m_HeightMap to initialize the m_SkyLight[] data; fills in seeds for the skylight */
+		void PrepareSkyLight(void);
+	
+		/** Uses m_BlockTypes to initialize the m_BlockLight[] data; fills in seeds for the blocklight */
+		void PrepareBlockLight(void);
+	
+		/** Same as PrepareBlockLight(), but uses a different traversal scheme; possibly better perf cache-wise.
+		To be compared in perf benchmarks. */
+		void PrepareBlockLight2(void);
+	
+		/** Calculates light in the light array specified, using the fastest kernel available on this platform */
+		void CalcLight(NIBBLETYPE * a_Light);
+
+		/** Calculates light in the light array specified, using stored seeds */
+		void CalcLightSeeds(NIBBLETYPE * a_Light);
+
+		#ifdef LIGHTING_USE_SSE2
+			/** Fills m_SpreadFalloff from m_BlockTypes. */
+			void PrepareSpreadFalloff(void);
+
+			/** Calculates light in the light array specified by repeatedly relaxing whole Y layers, until no value changes.
+			Only layers whose neighborhood has changed since they were last processed are relaxed again.
+			The result in the middle chunk is the same as from CalcLight(); it differs only in the outermost border of the 3x3 area.
+			Doesn't use the seeds. */
+			void CalcLightLayers(NIBBLETYPE * a_Light);
+
+			/** Relaxes a single Y layer in-place: each block gets the max of its six neighbors' light minus its falloff, if higher.
+			Uses SSE2, processing 16 blocks of a row at once. Returns true if any light value in the layer has changed. */
+			bool CalcLightLayer(NIBBLETYPE * a_Light, int a_Y);
+		#endif
+	
+		/** Does one step in the light calculation - one seed propagation and seed recalculation */
+		void CalcLightStep(
+			NIBBLETYPE * a_Light,
+			int a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
+			int & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+		);
+	
+		/** Compresses from 1-block-per-byte (faster calc) into 2-blocks-per-byte (MC storage): */
+		void CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight);
+	
+		inline void PropagateLight(
+			NIBBLETYPE * a_Light,
+			unsigned int a_SrcIdx, unsigned int a_DstIdx,
+			int & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+		)
+		{
+			ASSERT(a_SrcIdx < ARRAYCOUNT(m_SkyLight));
+			ASSERT(a_DstIdx < ARRAYCOUNT(m_BlockTypes));
+		
+			if (a_Light[a_SrcIdx] <= a_Light[a_DstIdx] + cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]))
+			{
+				// We're not offering more light than the dest block already has
+				return;
+			}
+
+			a_Light[a_DstIdx] = a_Light[a_SrcIdx] - cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]);
+			if (!a_IsSeedOut[a_DstIdx])
+			{
+				a_IsSeedOut[a_DstIdx] = true;
+				a_SeedIdxOut[a_NumSeedsOut++] = a_DstIdx;
+			}
+		}
+	} ;
+
+	typedef std::vector<std::unique_ptr<cWorker>> cWorkers;
+
+
 	
 	
 	cWorld * m_World;
 	
-	/** The mutex to protect m_Queue and m_PendingQueue */
+	/** The mutex to protect m_Queue, m_PendingQueue, m_InProgress and m_ShouldTerminate */
 	cCriticalSection m_CS;
 	
 	/** The ChunkStays that are loaded and are waiting to be lit. */
@@ -105,89 +286,40 @@ protected:
 	/** The ChunkStays that are waiting for load. Used for stopping the thread. */
 	cChunkStays m_PendingQueue;
 
-	cEvent m_evtItemAdded;    // Set when queue is appended, or to stop the thread
+	/** The ChunkStays that are currently being lit by the workers. */
+	std::vector<cLightingChunkStay *> m_InProgress;
+
+	/** The block changes waiting for an incremental light update. */
+	cBlockChanges m_BlockChanges;
+
+	/** Set while a worker is processing block changes, so that the updates of overlapping boxes don't race. */
+	bool m_IsUpdatingBlockChanges;
+
+	/** Set when the workers should terminate. */
+	bool m_ShouldTerminate;
+
+	/** Set when queue is appended, when an item is finished, or to stop the workers.
+	Wakes up a single worker; the worker passes the wakeup on if there's more work left. */
+	cEvent m_evtItemAdded;
+
 	cEvent m_evtQueueEmpty;   // Set when the queue gets empty
-	
-	/** The highest block in the current 3x3 chunk data */
-	HEIGHTTYPE m_MaxHeight;
-	
-	
-	// Buffers for the 3x3 chunk data
-	// These buffers alone are 1.7 MiB in size, therefore they cannot be located on the stack safely - some architectures may have only 1 MiB for stack, or even less
-	// Placing the buffers into the object means that this object can light chunks only in one thread!
-	// The blobs are XZY organized as a whole, instead of 3x3 XZY-organized subarrays ->
-	//  -> This means data has to be scatterred when reading and gathered when writing!
-	static const int BlocksPerYLayer = cChunkDef::Width * cChunkDef::Width * 3 * 3;
-	BLOCKTYPE  m_BlockTypes[BlocksPerYLayer * cChunkDef::Height];
-	NIBBLETYPE m_BlockLight[BlocksPerYLayer * cChunkDef::Height];
-	NIBBLETYPE m_SkyLight  [BlocksPerYLayer * cChunkDef::Height];
-	HEIGHTTYPE m_HeightMap [BlocksPerYLayer];
-	
-	// Seed management (5.7 MiB)
-	// Two buffers, in each calc step one is set as input and the other as output, then in the next step they're swapped
-	// Each seed is represented twice in this structure - both as a "list" and as a "position".
-	// "list" allows fast traversal from seed to seed
-	// "position" allows fast checking if a coord is already a seed
-	unsigned char m_IsSeed1 [BlocksPerYLayer * cChunkDef::Height];
-	unsigned int  m_SeedIdx1[BlocksPerYLayer * cChunkDef::Height];
-	unsigned char m_IsSeed2 [BlocksPerYLayer * cChunkDef::Height];
-	unsigned int  m_SeedIdx2[BlocksPerYLayer * cChunkDef::Height];
-	int m_NumSeeds;
-
-	virtual void Execute(void) override;
-
-	/** Lights the entire chunk. If neighbor chunks don't exist, touches them and re-queues the chunk */
-	void LightChunk(cLightingChunkStay & a_Item);
-	
-	/** Prepares m_BlockTypes and m_HeightMap data; zeroes out the light arrays */
-	void ReadChunks(int a_ChunkX, int a_ChunkZ);
-	
-	/** Uses m_HeightMap to initialize the m_SkyLight[] data; fills in seeds for the skylight */
-	void PrepareSkyLight(void);
-	
-	/** Uses m_BlockTypes to initialize the m_BlockLight[] data; fills in seeds for the blocklight */
-	void PrepareBlockLight(void);
-	
-	/** Same as PrepareBlockLight(), but uses a different traversal scheme; possibly better perf cache-wise.
-	To be compared in perf benchmarks. */
-	void PrepareBlockLight2(void);
-	
-	/** Calculates light in the light array specified, using stored seeds */
-	void CalcLight(NIBBLETYPE * a_Light);
-	
-	/** Does one step in the light calculation - one seed propagation and seed recalculation */
-	void CalcLightStep(
-		NIBBLETYPE * a_Light,
-		int a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
-		int & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-	);
-	
-	/** Compresses from 1-block-per-byte (faster calc) into 2-blocks-per-byte (MC storage): */
-	void CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight);
-	
-	inline void PropagateLight(
-		NIBBLETYPE * a_Light,
-		unsigned int a_SrcIdx, unsigned int a_DstIdx,
-		int & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-	)
-	{
-		ASSERT(a_SrcIdx < ARRAYCOUNT(m_SkyLight));
-		ASSERT(a_DstIdx < ARRAYCOUNT(m_BlockTypes));
-		
-		if (a_Light[a_SrcIdx] <= a_Light[a_DstIdx] + cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]))
-		{
-			// We're not offering more light than the dest block already has
-			return;
-		}
 
-		a_Light[a_DstIdx] = a_Light[a_SrcIdx] - cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]);
-		if (!a_IsSeedOut[a_DstIdx])
-		{
-			a_IsSeedOut[a_DstIdx] = true;
-			a_SeedIdxOut[a_NumSeedsOut++] = a_DstIdx;
-		}
-	}
-	
+	/** The worker threads doing the actual lighting. */
+	cWorkers m_Workers;
+
+	/** Takes the next work item for a worker, blocking until there's one.
+	If there are block changes and no other worker is processing them, they are moved into a_BlockChanges.
+	Otherwise a_ChunkStay is set to the next ChunkStay from m_Queue that doesn't overlap any ChunkStay in progress,
+	and the ChunkStay is marked as in progress.
+	Returns false if the workers should terminate. */
+	bool TakeNextItem(cLightingChunkStay *& a_ChunkStay, cBlockChanges & a_BlockChanges);
+
+	/** Marks the block changes as processed. Called by the workers after processing the block changes taken by TakeNextItem(). */
+	void FinishBlockChanges(void);
+
+	/** Removes the item from the in-progress list and deletes it. Called by the workers after lighting an item. */
+	void FinishItem(cLightingChunkStay * a_Item);
+
 	/** Queues a chunkstay that has all of its chunks loaded.
 	Called by cLightingChunkStay when all of its chunks are loaded. */
 	void QueueChunkStay(cLightingChunkStay & a_ChunkStay);
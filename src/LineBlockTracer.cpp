@@ -8,6 +8,65 @@
 #include "Vector3.h"
 #include "World.h"
 #include "Chunk.h"
+#include "BlockInfo.h"
+
+
+
+
+
+/** The handler for cLineBlockTracer::TraceInChunk() used by the line of sight traces, stops at the first solid block.
+It is not a cBlockTracer::cCallbacks descendant, so that its calls get inlined into the tracing loop. */
+class cLineOfSightHandler
+{
+public:
+	cLineOfSightHandler(void) :
+		m_IsBlocked(false)
+	{
+	}
+
+	bool OnNextBlock(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, char a_EntryFace)
+	{
+		UNUSED(a_BlockX);
+		UNUSED(a_BlockY);
+		UNUSED(a_BlockZ);
+		UNUSED(a_BlockMeta);
+		UNUSED(a_EntryFace);
+		if (cBlockInfo::IsSolid(a_BlockType))
+		{
+			m_IsBlocked = true;
+			return true;
+		}
+		return false;
+	}
+
+	bool OnNextBlockNoData(int a_BlockX, int a_BlockY, int a_BlockZ, char a_EntryFace)
+	{
+		UNUSED(a_BlockX);
+		UNUSED(a_BlockY);
+		UNUSED(a_BlockZ);
+		UNUSED(a_EntryFace);
+		m_IsBlocked = true;
+		return true;
+	}
+
+	bool OnOutOfWorld(double a_BlockX, double a_BlockY, double a_BlockZ)
+	{
+		UNUSED(a_BlockX);
+		UNUSED(a_BlockY);
+		UNUSED(a_BlockZ);
+		return false;
+	}
+
+	void OnNoMoreHits(void) {}
+
+	void OnNoChunk(void)
+	{
+		m_IsBlocked = true;
+	}
+
+	/** Set when the trace has found something blocking the sight. */
+	bool m_IsBlocked;
+} ;
 
 
 
@@ -39,6 +98,31 @@ cLineBlockTracer::cLineBlockTracer(cWorld & a_World, cCallbacks & a_Callbacks) :
 
 
 
+cLineBlockTracer::cLineBlockTracer(cWorld & a_World) :
+	super(a_World),
+	m_StartX(0.0),
+	m_StartY(0.0),
+	m_StartZ(0.0),
+	m_EndX(0.0),
+	m_EndY(0.0),
+	m_EndZ(0.0),
+	m_DiffX(0.0),
+	m_DiffY(0.0),
+	m_DiffZ(0.0),
+	m_DirX(0),
+	m_DirY(0),
+	m_DirZ(0),
+	m_CurrentX(0),
+	m_CurrentY(0),
+	m_CurrentZ(0),
+	m_CurrentFace(0)
+{
+}
+
+
+
+
+
 bool cLineBlockTracer::Trace(cWorld & a_World, cBlockTracer::cCallbacks & a_Callbacks, const Vector3d & a_Start, const Vector3d & a_End)
 {
 	cLineBlockTracer Tracer(a_World, a_Callbacks);
@@ -59,7 +143,98 @@ bool cLineBlockTracer::Trace(cWorld & a_World, cBlockTracer::cCallbacks &a_Callb
 
 
 
+bool cLineBlockTracer::LineOfSightTrace(cWorld & a_World, const Vector3d & a_Start, const Vector3d & a_End)
+{
+	cLineBlockTracer Tracer(a_World);
+	bool CanSee = false;
+	a_World.DoWithChunkAt(a_Start.Floor(), [&](cChunk & a_Chunk)
+		{
+			CanSee = Tracer.TraceLineOfSight(a_Chunk, a_Start, a_End);
+			return true;
+		}
+	);
+	return CanSee;
+}
+
+
+
+
+
+size_t cLineBlockTracer::LineOfSightTraces(cWorld & a_World, const Vector3d & a_Start, const std::vector<Vector3d> & a_Ends, std::vector<bool> & a_CanSee)
+{
+	a_CanSee.assign(a_Ends.size(), false);
+	if (a_Ends.empty())
+	{
+		return 0;
+	}
+
+	// All the traces start in the same chunk, so they are all done with the chunkmap locked only once:
+	cLineBlockTracer Tracer(a_World);
+	size_t NumCanSee = 0;
+	a_World.DoWithChunkAt(a_Start.Floor(), [&](cChunk & a_Chunk)
+		{
+			for (size_t i = 0; i < a_Ends.size(); i++)
+			{
+				if (Tracer.TraceLineOfSight(a_Chunk, a_Start, a_Ends[i]))
+				{
+					a_CanSee[i] = true;
+					NumCanSee += 1;
+				}
+			}
+			return true;
+		}
+	);
+	return NumCanSee;
+}
+
+
+
+
+
 bool cLineBlockTracer::Trace(double a_StartX, double a_StartY, double a_StartZ, double a_EndX, double a_EndY, double a_EndZ)
+{
+	bool IsIntoWorld;
+	if (!SetLine(a_StartX, a_StartY, a_StartZ, a_EndX, a_EndY, a_EndZ, IsIntoWorld))
+	{
+		// Nothing to trace
+		m_Callbacks->OnNoMoreHits();
+		return true;
+	}
+	if (IsIntoWorld)
+	{
+		m_Callbacks->OnIntoWorld(m_StartX, m_StartY, m_StartZ);
+	}
+	
+	// The actual trace is handled with ChunkMapCS locked by calling our Item() for the specified chunk
+	int BlockX = (int)floor(m_StartX);
+	int BlockZ = (int)floor(m_StartZ);
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(BlockX, BlockZ, ChunkX, ChunkZ);
+	return m_World->DoWithChunk(ChunkX, ChunkZ, *this);
+}
+
+
+
+
+
+bool cLineBlockTracer::TraceLineOfSight(cChunk & a_Chunk, const Vector3d & a_Start, const Vector3d & a_End)
+{
+	bool IsIntoWorld;
+	if (!SetLine(a_Start.x, a_Start.y, a_Start.z, a_End.x, a_End.y, a_End.z, IsIntoWorld))
+	{
+		// The entire line is outside the world, there's nothing in the way
+		return true;
+	}
+	cLineOfSightHandler Handler;
+	TraceInChunk(&a_Chunk, Handler);
+	return !Handler.m_IsBlocked;
+}
+
+
+
+
+
+bool cLineBlockTracer::SetLine(double a_StartX, double a_StartY, double a_StartZ, double a_EndX, double a_EndY, double a_EndZ, bool & a_IsIntoWorld)
 {
 	// Initialize the member veriables:
 	m_StartX = a_StartX;
@@ -72,28 +247,26 @@ bool cLineBlockTracer::Trace(double a_StartX, double a_StartY, double a_StartZ,
 	m_DirY = (m_StartY < m_EndY) ? 1 : -1;
 	m_DirZ = (m_StartZ < m_EndZ) ? 1 : -1;
 	m_CurrentFace = BLOCK_FACE_NONE;
+	a_IsIntoWorld = false;
 	
 	// Check the start coords, adjust into the world:
 	if (m_StartY < 0)
 	{
 		if (m_EndY < 0)
 		{
-			// Nothing to trace
-			m_Callbacks->OnNoMoreHits();
-			return true;
+			return false;
 		}
 		FixStartBelowWorld();
-		m_Callbacks->OnIntoWorld(m_StartX, m_StartY, m_StartZ);
+		a_IsIntoWorld = true;
 	}
 	else if (m_StartY >= cChunkDef::Height)
 	{
 		if (m_EndY >= cChunkDef::Height)
 		{
-			m_Callbacks->OnNoMoreHits();
-			return true;
+			return false;
 		}
 		FixStartAboveWorld();
-		m_Callbacks->OnIntoWorld(m_StartX, m_StartY, m_StartZ);
+		a_IsIntoWorld = true;
 	}
 
 	m_CurrentX = (int)floor(m_StartX);
@@ -103,13 +276,7 @@ bool cLineBlockTracer::Trace(double a_StartX, double a_StartY, double a_StartZ,
 	m_DiffX = m_EndX - m_StartX;
 	m_DiffY = m_EndY - m_StartY;
 	m_DiffZ = m_EndZ - m_StartZ;
-	
-	// The actual trace is handled with ChunkMapCS locked by calling our Item() for the specified chunk
-	int BlockX = (int)floor(m_StartX);
-	int BlockZ = (int)floor(m_StartZ);
-	int ChunkX, ChunkZ;
-	cChunkDef::BlockToChunk(BlockX, BlockZ, ChunkX, ChunkZ);
-	return m_World->DoWithChunk(ChunkX, ChunkZ, *this);
+	return true;
 }
 
 
@@ -207,24 +374,37 @@ bool cLineBlockTracer::MoveToNextBlock(void)
 
 
 bool cLineBlockTracer::Item(cChunk * a_Chunk)
+{
+	return TraceInChunk(a_Chunk, *m_Callbacks);
+}
+
+
+
+
+
+template <class Handler>
+bool cLineBlockTracer::TraceInChunk(cChunk * a_Chunk, Handler & a_Handler)
 {
 	ASSERT((m_CurrentY >= 0) && (m_CurrentY < cChunkDef::Height));  // This should be provided by FixStartAboveWorld() / FixStartBelowWorld()
 	
+	if (a_Chunk == nullptr)
+	{
+		a_Handler.OnNoChunk();
+		return false;
+	}
+
+	// The coords of the current chunk's first block, the chunk is only looked up again once the line leaves it:
+	int ChunkBaseX = a_Chunk->GetPosX() * cChunkDef::Width;
+	int ChunkBaseZ = a_Chunk->GetPosZ() * cChunkDef::Width;
+
 	// This is the actual line tracing loop.
 	for (;;)
 	{
-		// Report the current block through the callbacks:
-		if (a_Chunk == nullptr)
-		{
-			m_Callbacks->OnNoChunk();
-			return false;
-		}
-
 		// Move to next block
 		if (!MoveToNextBlock())
 		{
 			// We've reached the end
-			m_Callbacks->OnNoMoreHits();
+			a_Handler.OnNoMoreHits();
 			return true;
 		}
 
@@ -233,37 +413,45 @@ bool cLineBlockTracer::Item(cChunk * a_Chunk)
 			// We've gone out of the world, that's the end of this trace
 			double IntersectX, IntersectZ;
 			CalcXZIntersection(m_CurrentY, IntersectX, IntersectZ);
-			if (m_Callbacks->OnOutOfWorld(IntersectX, m_CurrentY, IntersectZ))
+			if (a_Handler.OnOutOfWorld(IntersectX, m_CurrentY, IntersectZ))
 			{
 				// The callback terminated the trace
 				return false;
 			}
-			m_Callbacks->OnNoMoreHits();
+			a_Handler.OnNoMoreHits();
 			return true;
 		}
 
-		// Update the current chunk
-		a_Chunk = a_Chunk->GetNeighborChunk(m_CurrentX, m_CurrentZ);
-		if (a_Chunk == nullptr)
+		// Update the current chunk, if the line has left it:
+		int RelX = m_CurrentX - ChunkBaseX;
+		int RelZ = m_CurrentZ - ChunkBaseZ;
+		if ((RelX < 0) || (RelX >= cChunkDef::Width) || (RelZ < 0) || (RelZ >= cChunkDef::Width))
 		{
-			m_Callbacks->OnNoChunk();
-			return false;
+			a_Chunk = a_Chunk->GetRelNeighborChunk(RelX, RelZ);
+			if (a_Chunk == nullptr)
+			{
+				a_Handler.OnNoChunk();
+				return false;
+			}
+			ChunkBaseX = a_Chunk->GetPosX() * cChunkDef::Width;
+			ChunkBaseZ = a_Chunk->GetPosZ() * cChunkDef::Width;
+			RelX = m_CurrentX - ChunkBaseX;
+			RelZ = m_CurrentZ - ChunkBaseZ;
 		}
 
+		// Report the current block:
 		if (a_Chunk->IsValid())
 		{
 			BLOCKTYPE BlockType;
 			NIBBLETYPE BlockMeta;
-			int RelX = m_CurrentX - a_Chunk->GetPosX() * cChunkDef::Width;
-			int RelZ = m_CurrentZ - a_Chunk->GetPosZ() * cChunkDef::Width;
 			a_Chunk->GetBlockTypeMeta(RelX, m_CurrentY, RelZ, BlockType, BlockMeta);
-			if (m_Callbacks->OnNextBlock(m_CurrentX, m_CurrentY, m_CurrentZ, BlockType, BlockMeta, m_CurrentFace))
+			if (a_Handler.OnNextBlock(m_CurrentX, m_CurrentY, m_CurrentZ, BlockType, BlockMeta, m_CurrentFace))
 			{
 				// The callback terminated the trace
 				return false;
 			}
 		}
-		else if (m_Callbacks->OnNextBlockNoData(m_CurrentX, m_CurrentY, m_CurrentZ, m_CurrentFace))
+		else if (a_Handler.OnNextBlockNoData(m_CurrentX, m_CurrentY, m_CurrentZ, m_CurrentFace))
 		{
 			// The callback terminated the trace
 			return false;
@@ -274,3 +462,4 @@ bool cLineBlockTracer::Item(cChunk * a_Chunk)
 
 
 
+
@@ -44,6 +44,15 @@ public:
 
 	/// Traces one line between Start and End; returns true if the entire line was traced (until OnNoMoreHits())
 	static bool Trace(cWorld & a_World, cCallbacks & a_Callbacks, const Vector3d & a_Start, const Vector3d & a_End);
+
+	/** Returns true if there's no solid block (cBlockInfo::IsSolid()) on the line between Start and End, not counting the start block.
+	Unloaded chunks and chunks without data along the line block the sight.
+	Much cheaper than Trace() with the callbacks, there are no virtual calls per block; meant for the line of sight checks. */
+	static bool LineOfSightTrace(cWorld & a_World, const Vector3d & a_Start, const Vector3d & a_End);
+
+	/** Traces the lines of sight (see LineOfSightTrace()) from a_Start to each of a_Ends, all of them within a single chunkmap lock.
+	a_CanSee receives the result for each end, in the same order. Returns the number of the ends that can be seen. */
+	static size_t LineOfSightTraces(cWorld & a_World, const Vector3d & a_Start, const std::vector<Vector3d> & a_Ends, std::vector<bool> & a_CanSee);
 	
 protected:
 	// The start point of the trace
@@ -64,6 +73,25 @@ protected:
 	// The face through which the current block has been entered
 	char m_CurrentFace;
 
+
+	/** Creates a tracer that doesn't report through the callbacks, used by the line of sight traces. */
+	cLineBlockTracer(cWorld & a_World);
+
+	/** Sets up the line between Start and End to be traced, moving its start into the world if it is above or below it.
+	Returns false if the entire line is outside the world, so there's nothing to trace.
+	a_IsIntoWorld is set to true if the start has been moved into the world. */
+	bool SetLine(double a_StartX, double a_StartY, double a_StartZ, double a_EndX, double a_EndY, double a_EndZ, bool & a_IsIntoWorld);
+
+	/** The line tracing loop, reports the blocks along the line set by SetLine() to a_Handler, starting in a_Chunk.
+	The chunk is only looked up again when the line leaves it, through the neighbor links.
+	a_Handler needs the same functions as cCallbacks, but needn't be one, so that the LOS handler's calls are not virtual.
+	Defined in the .cpp, only used there. Must be called with the chunkmap locked. */
+	template <class Handler>
+	bool TraceInChunk(cChunk * a_Chunk, Handler & a_Handler);
+
+	/** Traces the line of sight between Start and End, starting in a_Chunk. Returns true if there's no solid block on the line.
+	Must be called with the chunkmap locked. */
+	bool TraceLineOfSight(cChunk & a_Chunk, const Vector3d & a_Start, const Vector3d & a_End);
 	
 	/// Adjusts the start point above the world to just at the world's top
 	void FixStartAboveWorld(void);
@@ -79,17 +79,18 @@ void LinearUpscale2DArrayInPlace(TYPE * a_Array)
 
 
 
-/**
-Linearly interpolates values in the array between the equidistant anchor points (upscales).
-Works on two arrays, input is packed and output is to be completely constructed.
-*/
-template <typename TYPE> void LinearUpscale2DArray(
+/** Implements LinearUpscale2DArray(). If FixedUpscaleX is nonzero, it is the X upscale factor known at compile time,
+so that the compiler can unroll and vectorize the innermost loops, which run along the contiguous X axis. */
+template <int FixedUpscaleX, typename TYPE> void LinearUpscale2DArrayImpl(
 	TYPE * a_Src,                    ///< Source array of size a_SrcSizeX x a_SrcSizeY
 	int a_SrcSizeX, int a_SrcSizeY,  ///< Dimensions of the src array
 	TYPE * a_Dst,                    ///< Dest array, of size (a_SrcSizeX * a_UpscaleX + 1) x (a_SrcSizeY * a_UpscaleY + 1)
 	int a_UpscaleX, int a_UpscaleY   ///< Upscale factor for each direction
 )
 {
+	ASSERT((FixedUpscaleX == 0) || (FixedUpscaleX == a_UpscaleX));
+	const int UpscaleX = (FixedUpscaleX > 0) ? FixedUpscaleX : a_UpscaleX;
+
 	// For optimization reasons, we're storing the upscaling ratios in a fixed-size arrays of these sizes
 	// Feel free to enlarge them if needed, but keep in mind that they're on the stack
 	const int MAX_UPSCALE_X = 128;
@@ -99,17 +100,17 @@ template <typename TYPE> void LinearUpscale2DArray(
 	ASSERT(a_Dst != nullptr);
 	ASSERT(a_SrcSizeX > 0);
 	ASSERT(a_SrcSizeY > 0);
-	ASSERT(a_UpscaleX > 0);
+	ASSERT(UpscaleX > 0);
 	ASSERT(a_UpscaleY > 0);
-	ASSERT(a_UpscaleX <= MAX_UPSCALE_X);
+	ASSERT(UpscaleX <= MAX_UPSCALE_X);
 	ASSERT(a_UpscaleY <= MAX_UPSCALE_Y);
 
 	// Pre-calculate the upscaling ratios:
 	TYPE RatioX[MAX_UPSCALE_X];
 	TYPE RatioY[MAX_UPSCALE_Y];
-	for (int x = 0; x <= a_UpscaleX; x++)
+	for (int x = 0; x <= UpscaleX; x++)
 	{
-		RatioX[x] = (TYPE)x / a_UpscaleX;
+		RatioX[x] = (TYPE)x / UpscaleX;
 	}
 	for (int y = 0; y <= a_UpscaleY; y++)
 	{
@@ -117,7 +118,7 @@ template <typename TYPE> void LinearUpscale2DArray(
 	}
 
 	// Interpolate each XY cell:
-	int DstSizeX = (a_SrcSizeX - 1) * a_UpscaleX + 1;
+	int DstSizeX = (a_SrcSizeX - 1) * UpscaleX + 1;
 	int DstSizeY = (a_SrcSizeY - 1) * a_UpscaleY + 1;
 	for (int y = 0; y < (a_SrcSizeY - 1); y++)
 	{
@@ -125,7 +126,7 @@ template <typename TYPE> void LinearUpscale2DArray(
 		int idx = y * a_SrcSizeX;
 		for (int x = 0; x < (a_SrcSizeX - 1); x++, idx++)
 		{
-			int DstX = x * a_UpscaleX;
+			int DstX = x * UpscaleX;
 			TYPE LoXLoY = a_Src[idx];
 			TYPE LoXHiY = a_Src[idx + a_SrcSizeX];
 			TYPE HiXLoY = a_Src[idx + 1];
@@ -133,10 +134,10 @@ template <typename TYPE> void LinearUpscale2DArray(
 			for (int CellY = 0; CellY <= a_UpscaleY; CellY++)
 			{
 				int DestIdx = (DstY + CellY) * DstSizeX + DstX;
-				ASSERT(DestIdx + a_UpscaleX < DstSizeX * DstSizeY);
+				ASSERT(DestIdx + UpscaleX < DstSizeX * DstSizeY);
 				TYPE LoXInY = LoXLoY + (LoXHiY - LoXLoY) * RatioY[CellY];
 				TYPE HiXInY = HiXLoY + (HiXHiY - HiXLoY) * RatioY[CellY];
-				for (int CellX = 0; CellX <= a_UpscaleX; CellX++, DestIdx++)
+				for (int CellX = 0; CellX <= UpscaleX; CellX++, DestIdx++)
 				{
 					a_Dst[DestIdx] = LoXInY + (HiXInY - LoXInY) * RatioX[CellX];
 				}
@@ -153,13 +154,39 @@ template <typename TYPE> void LinearUpscale2DArray(
 Linearly interpolates values in the array between the equidistant anchor points (upscales).
 Works on two arrays, input is packed and output is to be completely constructed.
 */
-template <typename TYPE> void LinearUpscale3DArray(
+template <typename TYPE> void LinearUpscale2DArray(
+	TYPE * a_Src,                    ///< Source array of size a_SrcSizeX x a_SrcSizeY
+	int a_SrcSizeX, int a_SrcSizeY,  ///< Dimensions of the src array
+	TYPE * a_Dst,                    ///< Dest array, of size (a_SrcSizeX * a_UpscaleX + 1) x (a_SrcSizeY * a_UpscaleY + 1)
+	int a_UpscaleX, int a_UpscaleY   ///< Upscale factor for each direction
+)
+{
+	// Use the compile-time variants for the common X upscale factors, the generic code for the rest.
+	// For 8, GCC vectorizes the generic loop better than the unrolled one (measured), so it goes the generic way:
+	switch (a_UpscaleX)
+	{
+		case 4: LinearUpscale2DArrayImpl<4, TYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_Dst, a_UpscaleX, a_UpscaleY); return;
+		case 16: LinearUpscale2DArrayImpl<16, TYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_Dst, a_UpscaleX, a_UpscaleY); return;
+		default: LinearUpscale2DArrayImpl<0, TYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_Dst, a_UpscaleX, a_UpscaleY); return;
+	}
+}
+
+
+
+
+
+/** Implements LinearUpscale3DArray(). If FixedUpscaleX is nonzero, it is the X upscale factor known at compile time,
+so that the compiler can unroll and vectorize the innermost loops, which run along the contiguous X axis. */
+template <int FixedUpscaleX, typename TYPE> void LinearUpscale3DArrayImpl(
 	TYPE * a_Src,                                    ///< Source array of size a_SrcSizeX x a_SrcSizeY x a_SrcSizeZ
 	int a_SrcSizeX, int a_SrcSizeY, int a_SrcSizeZ,  ///< Dimensions of the src array
 	TYPE * a_Dst,                                    ///< Dest array, of size (a_SrcSizeX * a_UpscaleX + 1) x (a_SrcSizeY * a_UpscaleY + 1) x (a_SrcSizeZ * a_UpscaleZ + 1)
 	int a_UpscaleX, int a_UpscaleY, int a_UpscaleZ   ///< Upscale factor for each direction
 )
 {
+	ASSERT((FixedUpscaleX == 0) || (FixedUpscaleX == a_UpscaleX));
+	const int UpscaleX = (FixedUpscaleX > 0) ? FixedUpscaleX : a_UpscaleX;
+
 	// For optimization reasons, we're storing the upscaling ratios in a fixed-size arrays of these sizes
 	// Feel free to enlarge them if needed, but keep in mind that they're on the stack
 	const int MAX_UPSCALE_X = 128;
@@ -171,10 +198,10 @@ template <typename TYPE> void LinearUpscale3DArray(
 	ASSERT(a_SrcSizeX > 0);
 	ASSERT(a_SrcSizeY > 0);
 	ASSERT(a_SrcSizeZ > 0);
-	ASSERT(a_UpscaleX > 0);
+	ASSERT(UpscaleX > 0);
 	ASSERT(a_UpscaleY > 0);
 	ASSERT(a_UpscaleZ > 0);
-	ASSERT(a_UpscaleX <= MAX_UPSCALE_X);
+	ASSERT(UpscaleX <= MAX_UPSCALE_X);
 	ASSERT(a_UpscaleY <= MAX_UPSCALE_Y);
 	ASSERT(a_UpscaleZ <= MAX_UPSCALE_Z);
 
@@ -182,9 +209,9 @@ template <typename TYPE> void LinearUpscale3DArray(
 	TYPE RatioX[MAX_UPSCALE_X];
 	TYPE RatioY[MAX_UPSCALE_Y];
 	TYPE RatioZ[MAX_UPSCALE_Z];
-	for (int x = 0; x <= a_UpscaleX; x++)
+	for (int x = 0; x <= UpscaleX; x++)
 	{
-		RatioX[x] = (TYPE)x / a_UpscaleX;
+		RatioX[x] = (TYPE)x / UpscaleX;
 	}
 	for (int y = 0; y <= a_UpscaleY; y++)
 	{
@@ -196,7 +223,7 @@ template <typename TYPE> void LinearUpscale3DArray(
 	}
 
 	// Interpolate each XYZ cell:
-	int DstSizeX = (a_SrcSizeX - 1) * a_UpscaleX + 1;
+	int DstSizeX = (a_SrcSizeX - 1) * UpscaleX + 1;
 	int DstSizeY = (a_SrcSizeY - 1) * a_UpscaleY + 1;
 	int DstSizeZ = (a_SrcSizeZ - 1) * a_UpscaleZ + 1;
 	for (int z = 0; z < (a_SrcSizeZ - 1); z++)
@@ -208,7 +235,7 @@ template <typename TYPE> void LinearUpscale3DArray(
 			int idx = y * a_SrcSizeX + z * a_SrcSizeX * a_SrcSizeY;
 			for (int x = 0; x < (a_SrcSizeX - 1); x++, idx++)
 			{
-				int DstX = x * a_UpscaleX;
+				int DstX = x * UpscaleX;
 				TYPE LoXLoYLoZ = a_Src[idx];
 				TYPE LoXLoYHiZ = a_Src[idx + a_SrcSizeX * a_SrcSizeY];
 				TYPE LoXHiYLoZ = a_Src[idx + a_SrcSizeX];
@@ -226,10 +253,10 @@ template <typename TYPE> void LinearUpscale3DArray(
 					for (int CellY = 0; CellY <= a_UpscaleY; CellY++)
 					{
 						int DestIdx = (DstZ + CellZ) * DstSizeX * DstSizeY + (DstY + CellY) * DstSizeX + DstX;
-						ASSERT(DestIdx + a_UpscaleX < DstSizeX * DstSizeY * DstSizeZ);
+						ASSERT(DestIdx + UpscaleX < DstSizeX * DstSizeY * DstSizeZ);
 						TYPE LoXInY = LoXLoYInZ + (LoXHiYInZ - LoXLoYInZ) * RatioY[CellY];
 						TYPE HiXInY = HiXLoYInZ + (HiXHiYInZ - HiXLoYInZ) * RatioY[CellY];
-						for (int CellX = 0; CellX <= a_UpscaleX; CellX++, DestIdx++)
+						for (int CellX = 0; CellX <= UpscaleX; CellX++, DestIdx++)
 						{
 							a_Dst[DestIdx] = LoXInY + (HiXInY - LoXInY) * RatioX[CellX];
 						}
@@ -244,3 +271,177 @@ template <typename TYPE> void LinearUpscale3DArray(
 
 
 
+/**
+Linearly interpolates values in the array between the equidistant anchor points (upscales).
+Works on two arrays, input is packed and output is to be completely constructed.
+*/
+template <typename TYPE> void LinearUpscale3DArray(
+	TYPE * a_Src,                                    ///< Source array of size a_SrcSizeX x a_SrcSizeY x a_SrcSizeZ
+	int a_SrcSizeX, int a_SrcSizeY, int a_SrcSizeZ,  ///< Dimensions of the src array
+	TYPE * a_Dst,                                    ///< Dest array, of size (a_SrcSizeX * a_UpscaleX + 1) x (a_SrcSizeY * a_UpscaleY + 1) x (a_SrcSizeZ * a_UpscaleZ + 1)
+	int a_UpscaleX, int a_UpscaleY, int a_UpscaleZ   ///< Upscale factor for each direction
+)
+{
+	// Use the compile-time variants for the common X upscale factors, the generic code for the rest.
+	// For 8, GCC vectorizes the generic loop better than the unrolled one (measured), so it goes the generic way:
+	switch (a_UpscaleX)
+	{
+		case 4: LinearUpscale3DArrayImpl<4, TYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ); return;
+		case 16: LinearUpscale3DArrayImpl<16, TYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ); return;
+		default: LinearUpscale3DArrayImpl<0, TYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ); return;
+	}
+}
+
+
+
+
+
+/** Implements LinearUpscale3DArrayThreshold(). If FixedUpscaleX is nonzero, it is the X upscale factor known at compile time,
+so that the compiler can unroll and vectorize the innermost loops, which run along the contiguous X axis. */
+template <int FixedUpscaleX, typename TYPE, typename DSTTYPE> void LinearUpscale3DArrayThresholdImpl(
+	const TYPE * a_Src,                              ///< Source array of size a_SrcSizeX x a_SrcSizeY x a_SrcSizeZ
+	int a_SrcSizeX, int a_SrcSizeY, int a_SrcSizeZ,  ///< Dimensions of the src array
+	DSTTYPE * a_Dst,                                 ///< Dest array, of size (a_SrcSizeX * a_UpscaleX + 1) x (a_SrcSizeY * a_UpscaleY + 1) x (a_SrcSizeZ * a_UpscaleZ + 1)
+	int a_UpscaleX, int a_UpscaleY, int a_UpscaleZ,  ///< Upscale factor for each direction
+	TYPE a_Threshold,                                ///< The value that the upscaled values are compared against
+	DSTTYPE a_ValueAbove, DSTTYPE a_ValueBelow       ///< The values to output for the upscaled values above and not above the threshold
+)
+{
+	ASSERT((FixedUpscaleX == 0) || (FixedUpscaleX == a_UpscaleX));
+	const int UpscaleX = (FixedUpscaleX > 0) ? FixedUpscaleX : a_UpscaleX;
+
+	// For optimization reasons, we're storing the upscaling ratios in a fixed-size arrays of these sizes
+	// Feel free to enlarge them if needed, but keep in mind that they're on the stack
+	const int MAX_UPSCALE_X = 128;
+	const int MAX_UPSCALE_Y = 128;
+	const int MAX_UPSCALE_Z = 128;
+
+	ASSERT(a_Src != nullptr);
+	ASSERT(a_Dst != nullptr);
+	ASSERT(a_SrcSizeX > 0);
+	ASSERT(a_SrcSizeY > 0);
+	ASSERT(a_SrcSizeZ > 0);
+	ASSERT(UpscaleX > 0);
+	ASSERT(a_UpscaleY > 0);
+	ASSERT(a_UpscaleZ > 0);
+	ASSERT(UpscaleX <= MAX_UPSCALE_X);
+	ASSERT(a_UpscaleY <= MAX_UPSCALE_Y);
+	ASSERT(a_UpscaleZ <= MAX_UPSCALE_Z);
+
+	// Pre-calculate the upscaling ratios:
+	TYPE RatioX[MAX_UPSCALE_X];
+	TYPE RatioY[MAX_UPSCALE_Y];
+	TYPE RatioZ[MAX_UPSCALE_Z];
+	for (int x = 0; x <= UpscaleX; x++)
+	{
+		RatioX[x] = (TYPE)x / UpscaleX;
+	}
+	for (int y = 0; y <= a_UpscaleY; y++)
+	{
+		RatioY[y] = (TYPE)y / a_UpscaleY;
+	}
+	for (int z = 0; z <= a_UpscaleZ; z++)
+	{
+		RatioZ[z] = (TYPE)z / a_UpscaleZ;
+	}
+
+	// Threshold or interpolate each XYZ cell:
+	int DstSizeX = (a_SrcSizeX - 1) * UpscaleX + 1;
+	int DstSizeY = (a_SrcSizeY - 1) * a_UpscaleY + 1;
+	for (int z = 0; z < (a_SrcSizeZ - 1); z++)
+	{
+		int DstZ = z * a_UpscaleZ;
+		for (int y = 0; y < (a_SrcSizeY - 1); y++)
+		{
+			int DstY = y * a_UpscaleY;
+			int idx = y * a_SrcSizeX + z * a_SrcSizeX * a_SrcSizeY;
+			for (int x = 0; x < (a_SrcSizeX - 1); x++, idx++)
+			{
+				int DstX = x * UpscaleX;
+				TYPE LoXLoYLoZ = a_Src[idx];
+				TYPE LoXLoYHiZ = a_Src[idx + a_SrcSizeX * a_SrcSizeY];
+				TYPE LoXHiYLoZ = a_Src[idx + a_SrcSizeX];
+				TYPE LoXHiYHiZ = a_Src[idx + a_SrcSizeX + a_SrcSizeX * a_SrcSizeY];
+				TYPE HiXLoYLoZ = a_Src[idx + 1];
+				TYPE HiXLoYHiZ = a_Src[idx + 1 + a_SrcSizeX * a_SrcSizeY];
+				TYPE HiXHiYLoZ = a_Src[idx + 1 + a_SrcSizeX];
+				TYPE HiXHiYHiZ = a_Src[idx + 1 + a_SrcSizeX + a_SrcSizeX * a_SrcSizeY];
+
+				// If all the corners are clearly on the same side of the threshold, so is the whole cell:
+				TYPE Min = std::min(std::min(std::min(LoXLoYLoZ, LoXLoYHiZ), std::min(LoXHiYLoZ, LoXHiYHiZ)), std::min(std::min(HiXLoYLoZ, HiXLoYHiZ), std::min(HiXHiYLoZ, HiXHiYHiZ)));
+				TYPE Max = std::max(std::max(std::max(LoXLoYLoZ, LoXLoYHiZ), std::max(LoXHiYLoZ, LoXHiYHiZ)), std::max(std::max(HiXLoYLoZ, HiXLoYHiZ), std::max(HiXHiYLoZ, HiXHiYHiZ)));
+				TYPE Margin = (std::max(std::abs(Min), std::abs(Max)) + std::abs(a_Threshold)) / 4096;
+				if ((Min > a_Threshold + Margin) || (Max < a_Threshold - Margin))
+				{
+					DSTTYPE Value = (Min > a_Threshold + Margin) ? a_ValueAbove : a_ValueBelow;
+					for (int CellZ = 0; CellZ <= a_UpscaleZ; CellZ++)
+					{
+						for (int CellY = 0; CellY <= a_UpscaleY; CellY++)
+						{
+							int DestIdx = (DstZ + CellZ) * DstSizeX * DstSizeY + (DstY + CellY) * DstSizeX + DstX;
+							for (int CellX = 0; CellX <= UpscaleX; CellX++, DestIdx++)
+							{
+								a_Dst[DestIdx] = Value;
+							}
+						}  // for CellY
+					}  // for CellZ
+					continue;
+				}
+
+				// The threshold passes through the cell, interpolate:
+				for (int CellZ = 0; CellZ <= a_UpscaleZ; CellZ++)
+				{
+					TYPE LoXLoYInZ = LoXLoYLoZ + (LoXLoYHiZ - LoXLoYLoZ) * RatioZ[CellZ];
+					TYPE LoXHiYInZ = LoXHiYLoZ + (LoXHiYHiZ - LoXHiYLoZ) * RatioZ[CellZ];
+					TYPE HiXLoYInZ = HiXLoYLoZ + (HiXLoYHiZ - HiXLoYLoZ) * RatioZ[CellZ];
+					TYPE HiXHiYInZ = HiXHiYLoZ + (HiXHiYHiZ - HiXHiYLoZ) * RatioZ[CellZ];
+					for (int CellY = 0; CellY <= a_UpscaleY; CellY++)
+					{
+						int DestIdx = (DstZ + CellZ) * DstSizeX * DstSizeY + (DstY + CellY) * DstSizeX + DstX;
+						TYPE LoXInY = LoXLoYInZ + (LoXHiYInZ - LoXLoYInZ) * RatioY[CellY];
+						TYPE HiXInY = HiXLoYInZ + (HiXHiYInZ - HiXLoYInZ) * RatioY[CellY];
+						for (int CellX = 0; CellX <= UpscaleX; CellX++, DestIdx++)
+						{
+							a_Dst[DestIdx] = ((LoXInY + (HiXInY - LoXInY) * RatioX[CellX]) > a_Threshold) ? a_ValueAbove : a_ValueBelow;
+						}
+					}  // for CellY
+				}  // for CellZ
+			}  // for x
+		}  // for y
+	}  // for z
+}
+
+
+
+
+
+/** Upscales the 3D array the same way as LinearUpscale3DArray(), but only to compare the upscaled values against a_Threshold:
+a_Dst receives a_ValueAbove for each upscaled value greater than a_Threshold, and a_ValueBelow for the rest.
+The src cells whose corners are all clearly on the same side of the threshold are filled without interpolating,
+only the cells that the threshold passes through (such as near the terrain surface) are interpolated.
+The interpolation uses the same arithmetic as LinearUpscale3DArray(), and "clearly" leaves a margin far larger than
+the interpolation's rounding errors, so the output is identical to thresholding the output of LinearUpscale3DArray().
+Meant for floating-point TYPEs. */
+template <typename TYPE, typename DSTTYPE> void LinearUpscale3DArrayThreshold(
+	const TYPE * a_Src,                              ///< Source array of size a_SrcSizeX x a_SrcSizeY x a_SrcSizeZ
+	int a_SrcSizeX, int a_SrcSizeY, int a_SrcSizeZ,  ///< Dimensions of the src array
+	DSTTYPE * a_Dst,                                 ///< Dest array, of size (a_SrcSizeX * a_UpscaleX + 1) x (a_SrcSizeY * a_UpscaleY + 1) x (a_SrcSizeZ * a_UpscaleZ + 1)
+	int a_UpscaleX, int a_UpscaleY, int a_UpscaleZ,  ///< Upscale factor for each direction
+	TYPE a_Threshold,                                ///< The value that the upscaled values are compared against
+	DSTTYPE a_ValueAbove, DSTTYPE a_ValueBelow       ///< The values to output for the upscaled values above and not above the threshold
+)
+{
+	// Use the compile-time variants for the common X upscale factors, the generic code for the rest:
+	switch (a_UpscaleX)
+	{
+		case 4: LinearUpscale3DArrayThresholdImpl<4, TYPE, DSTTYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ, a_Threshold, a_ValueAbove, a_ValueBelow); return;
+		case 8: LinearUpscale3DArrayThresholdImpl<8, TYPE, DSTTYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ, a_Threshold, a_ValueAbove, a_ValueBelow); return;
+		case 16: LinearUpscale3DArrayThresholdImpl<16, TYPE, DSTTYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ, a_Threshold, a_ValueAbove, a_ValueBelow); return;
+		default: LinearUpscale3DArrayThresholdImpl<0, TYPE, DSTTYPE>(a_Src, a_SrcSizeX, a_SrcSizeY, a_SrcSizeZ, a_Dst, a_UpscaleX, a_UpscaleY, a_UpscaleZ, a_Threshold, a_ValueAbove, a_ValueBelow); return;
+	}
+}
+
+
+
+
+
@@ -10,6 +10,91 @@
 
 
 
+/** Maximum number of messages waiting for the writer thread. Any further messages are dropped, rather than making the logging threads wait. */
+static const size_t MAX_QUEUED_MESSAGES = 50000;
+
+/** How often the summary of the suppressed repeated messages is written, while the repeats keep coming, in seconds. */
+static const int REPEATS_SUMMARY_INTERVAL = 10;
+
+/** How long the writer thread waits for new messages before writing out the pending repeats summary, in msec. */
+static const unsigned WRITER_IDLE_MSEC = 1000;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cLogger::cWriterThread:
+
+/** The background thread that writes the queued messages. */
+class cLogger::cWriterThread :
+	public cIsThread
+{
+	typedef cIsThread super;
+
+public:
+	cWriterThread(cLogger & a_Logger) :
+		super("cLogger::cWriterThread"),
+		m_Logger(a_Logger)
+	{
+	}
+
+	void Stop(void)
+	{
+		m_ShouldTerminate = true;
+		m_Logger.m_evtQueued.Set();
+		Wait();
+	}
+
+protected:
+	cLogger & m_Logger;
+
+	virtual void Execute(void) override
+	{
+		while (!m_ShouldTerminate)
+		{
+			bool HasTimedOut = !m_Logger.m_evtQueued.Wait(WRITER_IDLE_MSEC);
+			m_Logger.WriteQueued();
+			if (HasTimedOut)
+			{
+				// No new messages for a while, don't keep the repeats of the last one hidden any longer:
+				m_Logger.WritePendingRepeats();
+			}
+		}
+	}
+} ;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cLogger:
+
+cLogger::cLogger(void) :
+	m_NumDropped(0),
+	m_IsAsync(false),
+	m_NumRepeats(0),
+	m_RepeatsStart(0)
+{
+	m_LastEntry.m_LogLevel = llRegular;
+	m_LastEntry.m_Time = 0;
+	m_LastEntry.m_ThreadID = 0;
+}
+
+
+
+
+
+cLogger::~cLogger()
+{
+	StopAsyncWriter();
+}
+
+
+
+
+
 cLogger & cLogger::GetInstance(void)
 {
 	static cLogger Instance;
@@ -31,31 +116,236 @@ void cLogger::InitiateMultithreading()
 
 void cLogger::LogSimple(AString a_Message, eLogLevel a_LogLevel)
 {
-	time_t rawtime;
-	time(&rawtime);
+	sLogEntry Entry;
+	std::swap(Entry.m_Message, a_Message);
+	Entry.m_LogLevel = a_LogLevel;
+	Entry.m_Time = time(nullptr);
+	Entry.m_ThreadID = static_cast<UInt64>(std::hash<std::thread::id>()(std::this_thread::get_id()));
 
+	bool IsAsync;
+	{
+		cCSLock Lock(m_CSQueue);
+		IsAsync = m_IsAsync;
+		if (IsAsync)
+		{
+			if (m_Queue.size() < MAX_QUEUED_MESSAGES)
+			{
+				m_Queue.push_back(std::move(Entry));
+			}
+			else
+			{
+				m_NumDropped += 1;
+			}
+		}
+	}
+
+	if (!IsAsync)
+	{
+		// No writer thread, write the message right away:
+		WriteEntries(std::vector<sLogEntry>(1, Entry));
+		return;
+	}
+
+	if (a_LogLevel == llError)
+	{
+		// Write out the error now, together with everything queued before it:
+		WriteQueued();
+	}
+	else
+	{
+		m_evtQueued.Set();
+	}
+}
+
+
+
+
+
+AString cLogger::FormatLine(const sLogEntry & a_Entry)
+{
 	struct tm * timeinfo;
 	#ifdef _MSC_VER
 		struct tm timeinforeal;
 		timeinfo = &timeinforeal;
-		localtime_s(timeinfo, &rawtime);
+		localtime_s(timeinfo, &a_Entry.m_Time);
 	#else
-		timeinfo = localtime(&rawtime);
+		struct tm timeinforeal;
+		timeinfo = localtime_r(&a_Entry.m_Time, &timeinforeal);
 	#endif
 
 	AString Line;
 	#ifdef _DEBUG
-		Printf(Line, "[%04llx|%02d:%02d:%02d] %s\n", static_cast<UInt64>(std::hash<std::thread::id>()(std::this_thread::get_id())), timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, a_Message.c_str());
+		Printf(Line, "[%04llx|%02d:%02d:%02d] %s\n", static_cast<unsigned long long>(a_Entry.m_ThreadID), timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, a_Entry.m_Message.c_str());
 	#else
-		Printf(Line, "[%02d:%02d:%02d] %s\n", timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, a_Message.c_str());
+		Printf(Line, "[%02d:%02d:%02d] %s\n", timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, a_Entry.m_Message.c_str());
 	#endif
+	return Line;
+}
+
+
+
 
 
+void cLogger::StartAsyncWriter(void)
+{
+	{
+		cCSLock Lock(m_CSQueue);
+		if (m_IsAsync)
+		{
+			return;
+		}
+		m_WriterThread.reset(new cWriterThread(*this));
+		m_IsAsync = true;
+	}
+	if (!m_WriterThread->Start())
+	{
+		// Keep writing synchronously:
+		{
+			cCSLock Lock(m_CSQueue);
+			m_IsAsync = false;
+		}
+		m_WriterThread.reset();
+		WriteQueued();
+	}
+}
+
+
+
+
+
+void cLogger::StopAsyncWriter(void)
+{
+	std::unique_ptr<cWriterThread> WriterThread;
+	{
+		cCSLock Lock(m_CSQueue);
+		if (!m_IsAsync)
+		{
+			return;
+		}
+		std::swap(WriterThread, m_WriterThread);
+	}
+	WriterThread->Stop();
+
+	// Switch back to the synchronous writes, then write out whatever has been queued in the meantime:
+	{
+		cCSLock Lock(m_CSQueue);
+		m_IsAsync = false;
+	}
+	WriteQueued();
+	WritePendingRepeats();
+}
+
+
+
+
+
+void cLogger::WriteQueued(void)
+{
+	// Hold the listeners' lock while swapping out the queue, so that the batches are written in the order they were queued:
+	cCSLock Lock(m_CriticalSection);
+	std::vector<sLogEntry> Entries;
+	size_t NumDropped;
+	{
+		cCSLock QueueLock(m_CSQueue);
+		std::swap(Entries, m_Queue);
+		NumDropped = m_NumDropped;
+		m_NumDropped = 0;
+	}
+	if (NumDropped > 0)
+	{
+		sLogEntry Dropped;
+		Printf(Dropped.m_Message, "The log writer couldn't keep up, " SIZE_T_FMT " messages have been dropped", NumDropped);
+		Dropped.m_LogLevel = llWarning;
+		Dropped.m_Time = time(nullptr);
+		Dropped.m_ThreadID = 0;
+		Entries.push_back(std::move(Dropped));
+	}
+	if (!Entries.empty())
+	{
+		WriteEntries(Entries);
+	}
+}
+
+
+
+
+
+void cLogger::WriteEntries(const std::vector<sLogEntry> & a_Entries)
+{
 	cCSLock Lock(m_CriticalSection);
-	for (size_t i = 0; i < m_LogListeners.size(); i++)
+	for (const auto & Entry: a_Entries)
+	{
+		// Suppress the consecutive repeats of the same message, writing only a periodic summary of them:
+		if ((Entry.m_LogLevel == m_LastEntry.m_LogLevel) && (Entry.m_Message == m_LastEntry.m_Message))
+		{
+			if (m_NumRepeats == 0)
+			{
+				m_RepeatsStart = Entry.m_Time;
+			}
+			m_NumRepeats += 1;
+			if (Entry.m_Time - m_RepeatsStart >= REPEATS_SUMMARY_INTERVAL)
+			{
+				WriteRepeats();
+			}
+			continue;
+		}
+		WriteRepeats();
+		DispatchEntry(Entry);
+		m_LastEntry = Entry;
+	}
+	for (auto Listener: m_LogListeners)
+	{
+		Listener->Flush();
+	}
+}
+
+
+
+
+
+void cLogger::WritePendingRepeats(void)
+{
+	cCSLock Lock(m_CriticalSection);
+	if (m_NumRepeats == 0)
+	{
+		return;
+	}
+	WriteRepeats();
+	for (auto Listener: m_LogListeners)
+	{
+		Listener->Flush();
+	}
+}
+
+
+
+
+
+void cLogger::DispatchEntry(const sLogEntry & a_Entry)
+{
+	for (auto Listener: m_LogListeners)
+	{
+		Listener->LogEntry(a_Entry);
+	}
+}
+
+
+
+
+
+void cLogger::WriteRepeats(void)
+{
+	if (m_NumRepeats == 0)
 	{
-		m_LogListeners[i]->Log(Line, a_LogLevel);
+		return;
 	}
+	sLogEntry Summary;
+	Printf(Summary.m_Message, "(the previous message has been repeated %d more times)", m_NumRepeats);
+	Summary.m_LogLevel = m_LastEntry.m_LogLevel;
+	Summary.m_Time = time(nullptr);
+	Summary.m_ThreadID = m_LastEntry.m_ThreadID;
+	m_NumRepeats = 0;
+	DispatchEntry(Summary);
 }
 
 
@@ -15,13 +15,33 @@ public:
 	};
 
 
+	/** A single logged message, as passed to the listeners. */
+	struct sLogEntry
+	{
+		AString   m_Message;   ///< The message itself, without the timestamp
+		eLogLevel m_LogLevel;
+		time_t    m_Time;      ///< When the message was logged
+		UInt64    m_ThreadID;  ///< Hash of the ID of the thread that logged the message
+	};
+
+
 	class cListener
 	{
 		public:
 		virtual void Log(AString a_Message, eLogLevel a_LogLevel) = 0;
 
+		/** Called for each logged message. The default implementation formats the message into a timestamped line and passes it to Log().
+		Listeners that want the individual fields of the message override this instead. */
+		virtual void LogEntry(const sLogEntry & a_Entry) { Log(FormatLine(a_Entry), a_Entry.m_LogLevel); }
+
+		/** Called after each batch of messages, so that the listener can flush its buffered output. */
+		virtual void Flush(void) {}
+
 		virtual ~cListener(){}
 	};
+	
+	cLogger(void);
+	~cLogger();
 
 	void Log  (const char * a_Format, eLogLevel a_LogLevel, va_list a_ArgList) FORMATSTRING(2, 0);
 
@@ -34,11 +54,68 @@ public:
 	static cLogger & GetInstance(void);
 	// Must be called before calling GetInstance in a multithreaded context
 	static void InitiateMultithreading();
+
+	/** Returns the message formatted into a single timestamped line, including the trailing newline. */
+	static AString FormatLine(const sLogEntry & a_Entry);
+
+	/** Starts the background writer thread. From then on, the logging threads only queue the messages and the writer thread
+	passes them to the listeners in batches. The errors are still written out immediately, together with all the messages
+	queued before them, so that they are not lost if the server terminates right afterwards. */
+	void StartAsyncWriter(void);
+
+	/** Writes out all the queued messages and stops the writer thread; the messages are written synchronously again afterwards. */
+	void StopAsyncWriter(void);
+
 private:
 
+	class cWriterThread;
+
+	/** Protects m_LogListeners and the duplicate suppression state; held while the listeners are being called. */
 	cCriticalSection m_CriticalSection;
 	std::vector<cListener *> m_LogListeners;
 
+	/** Protects m_Queue, m_NumDropped and m_IsAsync. Only held for queueing or swapping out the messages, never while writing them. */
+	cCriticalSection m_CSQueue;
+
+	/** The messages waiting for the writer thread. */
+	std::vector<sLogEntry> m_Queue;
+
+	/** Number of the messages dropped because the queue was full since the last batch was written. */
+	size_t m_NumDropped;
+
+	/** True while the writer thread is running and the messages are being queued. */
+	bool m_IsAsync;
+
+	/** Signalled when a message is queued. */
+	cEvent m_evtQueued;
+
+	/** The writer thread, valid while m_IsAsync. */
+	std::unique_ptr<cWriterThread> m_WriterThread;
+
+	/** The last message written to the listeners, for the duplicate suppression. */
+	sLogEntry m_LastEntry;
+
+	/** Number of the repeats of m_LastEntry that have been suppressed so far. */
+	int m_NumRepeats;
+
+	/** The time of the first suppressed repeat of m_LastEntry. */
+	time_t m_RepeatsStart;
+
+
+	/** Writes out all the messages queued so far. */
+	void WriteQueued(void);
+
+	/** Passes the messages to the listeners, suppressing the repeated ones, then flushes the listeners. */
+	void WriteEntries(const std::vector<sLogEntry> & a_Entries);
+
+	/** Writes the summary of the suppressed repeats of the last message, if there are any, and flushes the listeners. */
+	void WritePendingRepeats(void);
+
+	/** Passes a single message to the listeners. Assumes m_CriticalSection is held. */
+	void DispatchEntry(const sLogEntry & a_Entry);
+
+	/** Writes the summary of the suppressed repeats of m_LastEntry, if there are any. Assumes m_CriticalSection is held. */
+	void WriteRepeats(void);
 };
 
 
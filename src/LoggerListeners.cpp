@@ -28,6 +28,11 @@
 			fputs(a_Message.c_str(), stdout);
 			SetDefaultLogColour();
 		}
+
+		virtual void Flush(void) override
+		{
+			fflush(stdout);
+		}
 	};
 #endif
 
@@ -230,6 +235,11 @@ public:
 		}
 		printf("%s: %s", LogLevelString.c_str(), a_Message.c_str());
 	}
+
+	virtual void Flush(void) override
+	{
+		fflush(stdout);
+	}
 };
 
 
@@ -320,3 +330,99 @@ void cFileListener::Log(AString a_Message, cLogger::eLogLevel a_LogLevel)
 
 
 
+
+void cFileListener::Flush(void)
+{
+	m_File.Flush();
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cJsonFileListener:
+
+cJsonFileListener::cJsonFileListener(void)
+{
+	cFile::CreateFolder(FILE_IO_PREFIX + AString("logs"));
+	AString FileName = Printf("%s%sLOG_%d.jsonl", FILE_IO_PREFIX, "logs/", static_cast<int>(time(nullptr)));
+	m_File.Open(FileName, cFile::fmAppend);
+}
+
+
+
+
+
+void cJsonFileListener::Log(AString a_Message, cLogger::eLogLevel a_LogLevel)
+{
+	// Not used, all the messages come through LogEntry()
+	UNUSED(a_Message);
+	UNUSED(a_LogLevel);
+}
+
+
+
+
+
+void cJsonFileListener::LogEntry(const cLogger::sLogEntry & a_Entry)
+{
+	const char * LogLevelName = "unknown";
+	switch (a_Entry.m_LogLevel)
+	{
+		case cLogger::llRegular: LogLevelName = "regular"; break;
+		case cLogger::llInfo:    LogLevelName = "info";    break;
+		case cLogger::llWarning: LogLevelName = "warning"; break;
+		case cLogger::llError:   LogLevelName = "error";   break;
+	}
+
+	// Escape the message as a JSON string; the message may end with a newline, which is dropped:
+	AString Message;
+	Message.reserve(a_Entry.m_Message.size() + 16);
+	size_t Len = a_Entry.m_Message.size();
+	while ((Len > 0) && (a_Entry.m_Message[Len - 1] == '\n'))
+	{
+		Len -= 1;
+	}
+	for (size_t i = 0; i < Len; i++)
+	{
+		unsigned char c = static_cast<unsigned char>(a_Entry.m_Message[i]);
+		switch (c)
+		{
+			case '"':  Message.append("\\\""); break;
+			case '\\': Message.append("\\\\"); break;
+			case '\n': Message.append("\\n");  break;
+			case '\r': Message.append("\\r");  break;
+			case '\t': Message.append("\\t");  break;
+			default:
+			{
+				if (c < 0x20)
+				{
+					AppendPrintf(Message, "\\u%04x", c);
+				}
+				else
+				{
+					Message.push_back(static_cast<char>(c));
+				}
+				break;
+			}
+		}
+	}
+
+	m_File.Printf("{\"time\": %lld, \"level\": \"%s\", \"thread\": \"%04llx\", \"message\": \"%s\"}\n",
+		static_cast<long long>(a_Entry.m_Time), LogLevelName, static_cast<unsigned long long>(a_Entry.m_ThreadID), Message.c_str()
+	);
+}
+
+
+
+
+
+void cJsonFileListener::Flush(void)
+{
+	m_File.Flush();
+}
+
+
+
+
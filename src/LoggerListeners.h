@@ -15,6 +15,29 @@ public:
 	cFileListener(AString a_Filename);
 
 	virtual void Log(AString a_Message, cLogger::eLogLevel a_LogLevel) override;
+	virtual void Flush(void) override;
+	
+private:
+
+	cFile m_File;
+};
+
+
+
+
+
+/** Writes the messages into a logs/LOG_<time>.jsonl file, as one JSON object per line, for the log processing tools:
+{"time": <unix time>, "level": "info", "thread": "<thread id hash>", "message": "..."} */
+class cJsonFileListener
+	: public cLogger::cListener
+{
+public:
+
+	cJsonFileListener(void);
+
+	virtual void Log(AString a_Message, cLogger::eLogLevel a_LogLevel) override;
+	virtual void LogEntry(const cLogger::sLogEntry & a_Entry) override;
+	virtual void Flush(void) override;
 	
 private:
 
@@ -148,26 +148,63 @@ cMap::cMap(unsigned int a_ID, int a_CenterX, int a_CenterZ, cWorld * a_World, un
 
 
 
-void cMap::UpdateRadius(int a_PixelX, int a_PixelZ, unsigned int a_Radius)
+/** Returns a_Num / a_Den rounded towards positive infinity; a_Den must be positive. */
+static int CeilDiv(int a_Num, int a_Den)
 {
-	int PixelRadius = a_Radius / GetPixelWidth();
+	ASSERT(a_Den > 0);
+	return (a_Num >= 0) ? ((a_Num + a_Den - 1) / a_Den) : -((-a_Num) / a_Den);
+}
+
+
 
-	unsigned int StartX = Clamp(a_PixelX - PixelRadius, 0, (int)m_Width);
-	unsigned int StartZ = Clamp(a_PixelZ - PixelRadius, 0, (int)m_Height);
 
-	unsigned int EndX   = Clamp(a_PixelX + PixelRadius, 0, (int)m_Width);
-	unsigned int EndZ   = Clamp(a_PixelZ + PixelRadius, 0, (int)m_Height);
 
-	for (unsigned int X = StartX; X < EndX; ++X)
+void cMap::UpdateRadius(int a_PixelX, int a_PixelZ, unsigned int a_Radius)
+{
+	int PixelWidth = static_cast<int>(GetPixelWidth());
+	int Radius = static_cast<int>(a_Radius);
+
+	// The center and the area covered by the map, in blocks:
+	int MapMinX = m_CenterX - static_cast<int>(m_Width  / 2) * PixelWidth;
+	int MapMinZ = m_CenterZ - static_cast<int>(m_Height / 2) * PixelWidth;
+	int BlockX = MapMinX + a_PixelX * PixelWidth;
+	int BlockZ = MapMinZ + a_PixelZ * PixelWidth;
+
+	int MinX = std::max(BlockX - Radius, MapMinX);
+	int MinZ = std::max(BlockZ - Radius, MapMinZ);
+	int MaxX = std::min(BlockX + Radius, MapMinX + static_cast<int>(m_Width)  * PixelWidth - 1);
+	int MaxZ = std::min(BlockZ + Radius, MapMinZ + static_cast<int>(m_Height) * PixelWidth - 1);
+	if ((MinX > MaxX) || (MinZ > MaxZ))
 	{
-		for (unsigned int Z = StartZ; Z < EndZ; ++Z)
+		// The circle is outside the map
+		return;
+	}
+
+	int MinChunkX, MinChunkZ, MaxChunkX, MaxChunkZ;
+	cChunkDef::BlockToChunk(MinX, MinZ, MinChunkX, MinChunkZ);
+	cChunkDef::BlockToChunk(MaxX, MaxZ, MaxChunkX, MaxChunkZ);
+
+	int NumRendered = 0;
+	for (int ChunkZ = MinChunkZ; ChunkZ <= MaxChunkZ; ++ChunkZ)
+	{
+		for (int ChunkX = MinChunkX; ChunkX <= MaxChunkX; ++ChunkX)
 		{
-			int dX = X - a_PixelX;
-			int dZ = Z - a_PixelZ;
+			// Skip the chunks whose closest block is outside the circle:
+			int dX = Clamp(BlockX, ChunkX * cChunkDef::Width, ChunkX * cChunkDef::Width + cChunkDef::Width - 1) - BlockX;
+			int dZ = Clamp(BlockZ, ChunkZ * cChunkDef::Width, ChunkZ * cChunkDef::Width + cChunkDef::Width - 1) - BlockZ;
+			if ((dX * dX) + (dZ * dZ) >= (Radius * Radius))
+			{
+				continue;
+			}
 
-			if ((dX * dX) + (dZ * dZ) < (PixelRadius * PixelRadius))
+			if (RenderChunk(ChunkX, ChunkZ))
 			{
-				UpdatePixel(X, Z);
+				++NumRendered;
+				if (NumRendered >= MAX_CHUNKS_PER_UPDATE)
+				{
+					// Leave the rest for the next update
+					return;
+				}
 			}
 		}
 	}
@@ -191,147 +228,177 @@ void cMap::UpdateRadius(cPlayer & a_Player, unsigned int a_Radius)
 
 
 
-bool cMap::UpdatePixel(unsigned int a_X, unsigned int a_Z)
+bool cMap::RenderChunk(int a_ChunkX, int a_ChunkZ)
 {
-	unsigned int PixelWidth = GetPixelWidth();
-
-	int BlockX = m_CenterX + ((a_X - (m_Width  / 2)) * PixelWidth);
-	int BlockZ = m_CenterZ + ((a_Z - (m_Height / 2)) * PixelWidth);
-
-	int ChunkX, ChunkZ;
-	cChunkDef::BlockToChunk(BlockX, BlockZ, ChunkX, ChunkZ);
-
-	int RelX = BlockX - (ChunkX * cChunkDef::Width);
-	int RelZ = BlockZ - (ChunkZ * cChunkDef::Width);
-
-	class cCalculatePixelCb :
+	class cRenderChunkCb :
 		public cChunkCallback
 	{
-		cMap * m_Map;
-
-		int m_RelX, m_RelZ;
-
-		ColorID m_PixelData;
+		cMap & m_Map;
 
 	public:
-		cCalculatePixelCb(cMap * a_Map, int a_RelX, int a_RelZ)
-			: m_Map(a_Map), m_RelX(a_RelX), m_RelZ(a_RelZ), m_PixelData(E_BASE_COLOR_TRANSPARENT) {}
+		bool m_IsRendered;
+
+		cRenderChunkCb(cMap & a_Map) :
+			m_Map(a_Map),
+			m_IsRendered(false)
+		{
+		}
 
 		virtual bool Item(cChunk * a_Chunk) override
 		{
-			if (a_Chunk == nullptr)
+			if ((a_Chunk == nullptr) || !a_Chunk->IsValid())
 			{
+				// Keep the pixels until the chunk is loaded again
 				return false;
 			}
+			m_IsRendered = m_Map.RenderChunk(*a_Chunk);
+			return false;
+		}
+	} RenderChunkCb(*this);
 
-			unsigned int PixelWidth = m_Map->GetPixelWidth();
+	ASSERT(m_World != nullptr);
+	m_World->DoWithChunk(a_ChunkX, a_ChunkZ, RenderChunkCb);
+	return RenderChunkCb.m_IsRendered;
+}
 
-			if (m_Map->GetDimension() == dimNether)
-			{
-				// TODO 2014-02-22 xdot: Nether maps
 
-				return false;
-			}
 
-			typedef std::map<ColorID, unsigned int> ColorCountMap;
-			ColorCountMap ColorCounts;
 
-			// Count surface blocks
-			for (unsigned int X = m_RelX; X < m_RelX + PixelWidth; ++X)
+
+bool cMap::RenderChunk(cChunk & a_Chunk)
+{
+	// Skip the chunk if it hasn't changed since it was last rendered:
+	UInt32 Revision = a_Chunk.GetRevision();
+	Int64 Key = GetChunkKey(a_Chunk.GetPosX(), a_Chunk.GetPosZ());
+	auto itr = m_ChunkRevisions.find(Key);
+	if ((itr != m_ChunkRevisions.end()) && (itr->second == Revision))
+	{
+		return false;
+	}
+	m_ChunkRevisions[Key] = Revision;
+
+	// Render the pixels whose first block lies in this chunk:
+	int PixelWidth = static_cast<int>(GetPixelWidth());
+	int ChunkBlockX = a_Chunk.GetPosX() * cChunkDef::Width;
+	int ChunkBlockZ = a_Chunk.GetPosZ() * cChunkDef::Width;
+	int MapMinX = m_CenterX - static_cast<int>(m_Width  / 2) * PixelWidth;
+	int MapMinZ = m_CenterZ - static_cast<int>(m_Height / 2) * PixelWidth;
+	int StartX = Clamp(CeilDiv(ChunkBlockX - MapMinX, PixelWidth), 0, static_cast<int>(m_Width));
+	int StartZ = Clamp(CeilDiv(ChunkBlockZ - MapMinZ, PixelWidth), 0, static_cast<int>(m_Height));
+	int EndX = Clamp(CeilDiv(ChunkBlockX + cChunkDef::Width - MapMinX, PixelWidth), 0, static_cast<int>(m_Width));
+	int EndZ = Clamp(CeilDiv(ChunkBlockZ + cChunkDef::Width - MapMinZ, PixelWidth), 0, static_cast<int>(m_Height));
+	for (int X = StartX; X < EndX; ++X)
+	{
+		// A pixel may extend into the neighboring chunks, only the part in this chunk is sampled:
+		int RelX = MapMinX + X * PixelWidth - ChunkBlockX;
+		int EndRelX = std::min(RelX + PixelWidth, static_cast<int>(cChunkDef::Width));
+		for (int Z = StartZ; Z < EndZ; ++Z)
+		{
+			int RelZ = MapMinZ + Z * PixelWidth - ChunkBlockZ;
+			int EndRelZ = std::min(RelZ + PixelWidth, static_cast<int>(cChunkDef::Width));
+			SetPixel(static_cast<unsigned>(X), static_cast<unsigned>(Z), CalcPixelColor(a_Chunk, RelX, RelZ, EndRelX, EndRelZ));
+		}
+	}
+	return true;
+}
+
+
+
+
+
+cMap::ColorID cMap::CalcPixelColor(cChunk & a_Chunk, int a_RelX, int a_RelZ, int a_EndRelX, int a_EndRelZ)
+{
+	if (GetDimension() == dimNether)
+	{
+		// TODO 2014-02-22 xdot: Nether maps
+
+		return E_BASE_COLOR_TRANSPARENT;
+	}
+
+	typedef std::map<ColorID, unsigned int> ColorCountMap;
+	ColorCountMap ColorCounts;
+
+	// Count surface blocks
+	for (int X = a_RelX; X < a_EndRelX; ++X)
+	{
+		for (int Z = a_RelZ; Z < a_EndRelZ; ++Z)
+		{
+			// unsigned int WaterDepth = 0;
+
+			BLOCKTYPE TargetBlock = E_BLOCK_AIR;
+			NIBBLETYPE TargetMeta = 0;
+
+			int Height = a_Chunk.GetHeight(X, Z);
+
+			while (Height > 0)
 			{
-				for (unsigned int Z = m_RelZ; Z < m_RelZ + PixelWidth; ++Z)
+				a_Chunk.GetBlockTypeMeta(X, Height, Z, TargetBlock, TargetMeta);
+
+				// TODO 2014-02-22 xdot: Check if block color is transparent
+				if (TargetBlock == E_BLOCK_AIR)
 				{
-					// unsigned int WaterDepth = 0;
-
-					BLOCKTYPE TargetBlock = E_BLOCK_AIR;
-					NIBBLETYPE TargetMeta = 0;
-
-					int Height = a_Chunk->GetHeight(X, Z);
-
-					while (Height > 0)
-					{
-						a_Chunk->GetBlockTypeMeta(X, Height, Z, TargetBlock, TargetMeta);
-
-						// TODO 2014-02-22 xdot: Check if block color is transparent
-						if (TargetBlock == E_BLOCK_AIR)
-						{
-							--Height;
-							continue;
-						}
-						// TODO 2014-02-22 xdot: Check if block is liquid
-						/*
-						else if (false)
-						{
-							--Height;
-							++WaterDepth;
-							continue;
-						}
-						*/
-
-						break;
-					}
-
-					// TODO 2014-02-22 xdot: Query block color
-					ColorID Color = E_BASE_COLOR_BROWN;
-
-					// Debug - Temporary
-					switch (TargetBlock)
-					{
-						case E_BLOCK_GRASS:
-						{
-							Color = E_BASE_COLOR_LIGHT_GREEN; break;
-						}
-						case E_BLOCK_STATIONARY_WATER:
-						case E_BLOCK_WATER:
-						{
-							Color = E_BASE_COLOR_BLUE; break;
-						}
-					}
-
-					++ColorCounts[Color];
+					--Height;
+					continue;
 				}
-			}
+				// TODO 2014-02-22 xdot: Check if block is liquid
+				/*
+				else if (false)
+				{
+					--Height;
+					++WaterDepth;
+					continue;
+				}
+				*/
 
-			// Find dominant color
-			ColorID PixelColor = E_BASE_COLOR_TRANSPARENT;
+				break;
+			}
 
-			unsigned int MaxCount = 0;
+			// TODO 2014-02-22 xdot: Query block color
+			ColorID Color = E_BASE_COLOR_BROWN;
 
-			for (ColorCountMap::iterator it = ColorCounts.begin(); it != ColorCounts.end(); ++it)
+			// Debug - Temporary
+			switch (TargetBlock)
 			{
-				if (it->second > MaxCount)
+				case E_BLOCK_GRASS:
+				{
+					Color = E_BASE_COLOR_LIGHT_GREEN; break;
+				}
+				case E_BLOCK_STATIONARY_WATER:
+				case E_BLOCK_WATER:
 				{
-					PixelColor = it->first;
-					MaxCount = it->second;
+					Color = E_BASE_COLOR_BLUE; break;
 				}
 			}
 
-			// TODO 2014-02-22 xdot: Adjust brightness
-			unsigned int dColor = 1;
+			++ColorCounts[Color];
+		}
+	}
 
-			m_PixelData = PixelColor + dColor;
+	// Find dominant color
+	ColorID PixelColor = E_BASE_COLOR_TRANSPARENT;
 
-			return false;
-		}
+	unsigned int MaxCount = 0;
 
-		ColorID GetPixelData(void) const
+	for (ColorCountMap::iterator it = ColorCounts.begin(); it != ColorCounts.end(); ++it)
+	{
+		if (it->second > MaxCount)
 		{
-			return m_PixelData;
+			PixelColor = it->first;
+			MaxCount = it->second;
 		}
-	} CalculatePixelCb(this, RelX, RelZ);
-
-	ASSERT(m_World != nullptr);
-	m_World->DoWithChunk(ChunkX, ChunkZ, CalculatePixelCb);
+	}
 
-	SetPixel(a_X, a_Z, CalculatePixelCb.GetPixelData());
+	// TODO 2014-02-22 xdot: Adjust brightness
+	unsigned int dColor = 1;
 
-	return true;
+	return PixelColor + dColor;
 }
 
 
 
 
 
+
 void cMap::UpdateDecorators(void)
 {
 	for (cMapDecoratorList::iterator it = m_Decorators.begin(); it != m_Decorators.end(); ++it)
@@ -357,8 +424,9 @@ void cMap::AddPlayer(cPlayer * a_Player, Int64 a_WorldAge)
 	MapClient.m_LastUpdate = a_WorldAge;
 	MapClient.m_SendInfo   = true;
 	MapClient.m_Handle     = Handle;
-	MapClient.m_DataUpdate = 0;
+	MapClient.m_NextColumn = 0;
 	MapClient.m_NextDecoratorUpdate = 0;
+	MarkClientDirty(MapClient);
 
 	m_Clients.push_back(MapClient);
 
@@ -436,13 +504,31 @@ void cMap::StreamNext(cMapClient & a_Client)
 	}
 	else
 	{
-		++a_Client.m_DataUpdate;
+		if (a_Client.m_DirtyColumns.size() != m_Width)
+		{
+			MarkClientDirty(a_Client);
+		}
 
-		unsigned int Y = (a_Client.m_DataUpdate * 11) % m_Width;
+		// Send the changed parts of the next few changed columns:
+		unsigned int NumSent = 0;
+		for (unsigned int i = 0; (i < m_Width) && (NumSent < MAX_COLUMNS_PER_UPDATE); ++i)
+		{
+			unsigned int X = (a_Client.m_NextColumn + i) % m_Width;
+			sDirtyRange & Dirty = a_Client.m_DirtyColumns[X];
+			if (Dirty.m_Start >= Dirty.m_End)
+			{
+				continue;
+			}
 
-		const Byte * Colors = &m_Data[Y * m_Height];
+			const Byte * Colors = &m_Data[X * m_Height + Dirty.m_Start];
 
-		Handle->SendMapColumn(m_ID, Y, 0, Colors, m_Height, m_Scale);
+			Handle->SendMapColumn(m_ID, X, Dirty.m_Start, Colors, Dirty.m_End - Dirty.m_Start, m_Scale);
+
+			Dirty.m_Start = m_Height;
+			Dirty.m_End = 0;
+			a_Client.m_NextColumn = X + 1;
+			++NumSent;
+		}
 	}
 }
 
@@ -450,6 +536,30 @@ void cMap::StreamNext(cMapClient & a_Client)
 
 
 
+void cMap::MarkAllClientsDirty(void)
+{
+	for (cMapClientList::iterator it = m_Clients.begin(); it != m_Clients.end(); ++it)
+	{
+		MarkClientDirty(*it);
+	}
+}
+
+
+
+
+
+void cMap::MarkClientDirty(cMapClient & a_Client)
+{
+	sDirtyRange All;
+	All.m_Start = 0;
+	All.m_End = m_Height;
+	a_Client.m_DirtyColumns.assign(m_Width, All);
+}
+
+
+
+
+
 void cMap::UpdateClient(cPlayer * a_Player)
 {
 	ASSERT(a_Player != nullptr);
@@ -488,6 +598,8 @@ void cMap::UpdateClient(cPlayer * a_Player)
 void cMap::EraseData(void)
 {
 	m_Data.assign(m_Width * m_Height, 0);
+	m_ChunkRevisions.clear();
+	MarkAllClientsDirty();
 }
 
 
@@ -516,6 +628,8 @@ void cMap::Resize(unsigned int a_Width, unsigned int a_Height)
 	m_Height = a_Height;
 
 	m_Data.assign(m_Width * m_Height, 0);
+	m_ChunkRevisions.clear();
+	MarkAllClientsDirty();
 }
 
 
@@ -524,8 +638,16 @@ void cMap::Resize(unsigned int a_Width, unsigned int a_Height)
 
 void cMap::SetPosition(int a_CenterX, int a_CenterZ)
 {
+	if ((m_CenterX == a_CenterX) && (m_CenterZ == a_CenterZ))
+	{
+		return;
+	}
+
 	m_CenterX = a_CenterX;
 	m_CenterZ = a_CenterZ;
+
+	// The pixels now show different blocks, render them all again:
+	m_ChunkRevisions.clear();
 }
 
 
@@ -540,6 +662,7 @@ void cMap::SetScale(unsigned int a_Scale)
 	}
 
 	m_Scale = a_Scale;
+	m_ChunkRevisions.clear();
 
 	for (cMapClientList::iterator it = m_Clients.begin(); it != m_Clients.end(); ++it)
 	{
@@ -555,7 +678,24 @@ bool cMap::SetPixel(unsigned int a_X, unsigned int a_Z, cMap::ColorID a_Data)
 {
 	if ((a_X < m_Width) && (a_Z < m_Height))
 	{
-		m_Data[a_Z + (a_X * m_Height)] = a_Data;
+		ColorID & Pixel = m_Data[a_Z + (a_X * m_Height)];
+		if (Pixel == a_Data)
+		{
+			return true;
+		}
+		Pixel = a_Data;
+
+		// Mark the pixel to be sent to all clients:
+		for (cMapClientList::iterator it = m_Clients.begin(); it != m_Clients.end(); ++it)
+		{
+			if (it->m_DirtyColumns.size() != m_Width)
+			{
+				continue;  // Will be sent whole
+			}
+			sDirtyRange & Dirty = it->m_DirtyColumns[a_X];
+			Dirty.m_Start = std::min(Dirty.m_Start, a_Z);
+			Dirty.m_End = std::max(Dirty.m_End, a_Z + 1);
+		}
 
 		return true;
 	}
@@ -13,6 +13,7 @@
 
 
 
+#include <unordered_map>
 #include "BlockID.h"
 
 
@@ -20,6 +21,7 @@
 
 
 class cClientHandle;
+class cChunk;
 class cWorld;
 class cPlayer;
 class cMap;
@@ -134,13 +136,16 @@ public:
 	/** Send this map to the specified client. WARNING: Slow */
 	void SendTo(cClientHandle & a_Client);
 
-	/** Update a circular region with the specified radius and center (in pixels). */
+	/** Update a circular region with the specified radius (in blocks) and center (in pixels).
+	Only the chunks that have changed since they were last rendered are rendered again, at most MAX_CHUNKS_PER_UPDATE of them;
+	the rest is left for the next updates. */
 	void UpdateRadius(int a_PixelX, int a_PixelZ, unsigned int a_Radius);
 
 	/** Update a circular region around the specified player. */
 	void UpdateRadius(cPlayer & a_Player, unsigned int a_Radius);
 
-	/** Send next update packet to the specified player and remove invalid decorators / clients. */
+	/** Send next update packet to the specified player and remove invalid decorators / clients.
+	Only the parts of the columns that have changed since they were last sent to the player are sent. */
 	void UpdateClient(cPlayer * a_Player);
 
 	// tolua_begin
@@ -197,6 +202,20 @@ public:
 
 protected:
 
+	/** The maximum number of chunks rendered by a single UpdateRadius() call. */
+	static const int MAX_CHUNKS_PER_UPDATE = 8;
+
+	/** The maximum number of columns sent to a client by a single UpdateClient() call. */
+	static const unsigned int MAX_COLUMNS_PER_UPDATE = 4;
+
+	/** The range of rows of a single column that have changed since the column was last sent to a client.
+	The column is up to date if m_Start >= m_End. */
+	struct sDirtyRange
+	{
+		unsigned int m_Start;
+		unsigned int m_End;
+	};
+
 	/** Encapsulates the state of a map client.
 	In order to enhance performace, maps are streamed column-by-column to each client.
 	This structure stores the state of the stream.
@@ -211,8 +230,11 @@ protected:
 		/** Ticks since last decorator update. */
 		unsigned int m_NextDecoratorUpdate;
 
-		/** Number of pixel data updates. */
-		Int64 m_DataUpdate;
+		/** The rows of each column that the client doesn't have yet. */
+		std::vector<sDirtyRange> m_DirtyColumns;
+
+		/** The column where to start looking for the dirty columns in the next update, so that all the columns get their turn. */
+		unsigned int m_NextColumn;
 
 		Int64 m_LastUpdate;
 	};
@@ -225,8 +247,27 @@ private:
 	/** Update the associated decorators. */
 	void UpdateDecorators(void);
 
-	/** Update the specified pixel. */
-	bool UpdatePixel(unsigned int a_X, unsigned int a_Z);
+	/** Renders the pixels of the specified chunk, unless the chunk hasn't changed since it was last rendered.
+	Returns true if the pixels were rendered, false if the chunk was up to date or not loaded. */
+	bool RenderChunk(int a_ChunkX, int a_ChunkZ);
+
+	/** Renders the pixels of the specified loaded chunk, unless the chunk hasn't changed since it was last rendered (see RenderChunk()). */
+	bool RenderChunk(cChunk & a_Chunk);
+
+	/** Returns the color of a pixel showing the specified area of the chunk, in relative coords, the end being exclusive. */
+	ColorID CalcPixelColor(cChunk & a_Chunk, int a_RelX, int a_RelZ, int a_EndRelX, int a_EndRelZ);
+
+	/** Marks all the pixels of all the clients as not sent. */
+	void MarkAllClientsDirty(void);
+
+	/** Marks all the pixels as not sent to the specified client. */
+	void MarkClientDirty(cMapClient & a_Client);
+
+	/** Returns the key of the specified chunk, for m_ChunkRevisions. */
+	static Int64 GetChunkKey(int a_ChunkX, int a_ChunkZ)
+	{
+		return (static_cast<Int64>(a_ChunkX) << 32) | static_cast<Int64>(static_cast<UInt32>(a_ChunkZ));
+	}
 
 	/** Add a new map client. */
 	void AddPlayer(cPlayer * a_Player, Int64 a_WorldAge);
@@ -251,6 +292,10 @@ private:
 	/** Column-major array of colours */
 	cColorList m_Data;
 
+	/** The revision (see cChunk::GetRevision()) of each chunk at the time its pixels were last rendered, by the chunk key (see GetChunkKey()).
+	Cleared when the pixels no longer correspond to the same blocks (position, scale or size change). */
+	std::unordered_map<Int64, UInt32> m_ChunkRevisions;
+
 	cWorld * m_World;
 
 	cMapDecoratorList m_Decorators;
@@ -7,6 +7,15 @@
 
 
 
+cMobCensus::cMobCensus(void) :
+	m_NumEligibleForSpawnChunks(0)
+{
+}
+
+
+
+
+
 void cMobCensus::CollectMob(cMonster & a_Monster, cChunk & a_Chunk, double a_Distance)
 {
 	m_ProximityCounter.CollectMob(a_Monster, a_Chunk, a_Distance);
@@ -55,7 +64,8 @@ int cMobCensus::GetCapMultiplier(cMonster::eFamily a_MobFamily)
 
 void cMobCensus::CollectSpawnableChunk(cChunk & a_Chunk)
 {
-	m_EligibleForSpawnChunks.insert(&a_Chunk);
+	UNUSED(a_Chunk);
+	m_NumEligibleForSpawnChunks += 1;
 }
 
 
@@ -64,7 +74,7 @@ void cMobCensus::CollectSpawnableChunk(cChunk & a_Chunk)
 
 int cMobCensus::GetNumChunks(void)
 {
-	return (int)m_EligibleForSpawnChunks.size();
+	return m_NumEligibleForSpawnChunks;
 }
 
 
@@ -25,6 +25,8 @@ as side effect 2 : it also know the caps for mobs number and can compare census
 class cMobCensus
 {
 public:
+	cMobCensus(void);
+
 	/// Returns the nested proximity counter
 	cMobProximityCounter & GetProximityCounter(void);
 
@@ -45,7 +47,8 @@ protected :
 	cMobProximityCounter m_ProximityCounter;
 	cMobFamilyCollecter m_MobFamilyCollecter;
 
-	std::set<cChunk *> m_EligibleForSpawnChunks;
+	/** Number of the chunks collected by CollectSpawnableChunk(); each chunk is collected only once. */
+	int m_NumEligibleForSpawnChunks;
 
 	/// Returns the number of chunks that are elligible for spawning (for now, the loaded, valid chunks)
 	int GetNumChunks();
@@ -6,10 +6,22 @@
 
 
 
+cMobFamilyCollecter::cMobFamilyCollecter(void)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_NumMobs); i++)
+	{
+		m_NumMobs[i] = 0;
+	}
+}
+
+
+
+
+
 void cMobFamilyCollecter::CollectMob(cMonster & a_Monster)
 {
 	cMonster::eFamily MobFamily = a_Monster.GetMobFamily();
-	m_Mobs[MobFamily].insert(&a_Monster);
+	m_NumMobs[MobFamily] += 1;
 }
 
 
@@ -18,7 +30,7 @@ void cMobFamilyCollecter::CollectMob(cMonster & a_Monster)
 
 int cMobFamilyCollecter::GetNumberOfCollectedMobs(cMonster::eFamily a_Family)
 {
-	return (int)m_Mobs[a_Family].size();
+	return m_NumMobs[a_Family];
 }
 
 
@@ -23,14 +23,16 @@ class cMobFamilyCollecter
 public :
 	typedef const std::set<cMonster::eFamily> tMobFamilyList;
 
-	// collect a mob
+	cMobFamilyCollecter(void);
+
+	// collect a mob; each mob is to be collected only once
 	void CollectMob(cMonster & a_Monster);
 
 	// return the number of mobs for this family
 	int GetNumberOfCollectedMobs(cMonster::eFamily a_Family);
 
 protected :
-	std::map<cMonster::eFamily, std::set<cMonster *> > m_Mobs;
+	int m_NumMobs[cMonster::mfUnhandled + 1];
 
 } ;
 
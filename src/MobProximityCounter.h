@@ -1,7 +1,7 @@
 
 #pragma once
 
-#include <set>
+#include <map>
 
 class cChunk;
 class cEntity;
@@ -13,13 +13,6 @@ class cEntity;
 class cMobProximityCounter
 {
 protected :
-	// structs used for later maps (see m_MonsterToDistance and m_DistanceToMonster)
-	struct sDistanceAndChunk
-	{
-		sDistanceAndChunk(double a_Distance, cChunk & a_Chunk) : m_Distance(a_Distance), m_Chunk(&a_Chunk) {}
-		double m_Distance;
-		cChunk * m_Chunk;
-	};
 	struct sMonsterAndChunk
 	{
 		sMonsterAndChunk(cEntity & a_Monster, cChunk & a_Chunk) : m_Monster(a_Monster), m_Chunk(a_Chunk) {}
@@ -28,28 +21,15 @@ protected :
 	};
 
 public :
-	typedef std::map<cEntity *, sDistanceAndChunk> tMonsterToDistance;
 	typedef std::multimap<double, sMonsterAndChunk> tDistanceToMonster;
 
 protected :
-	// this map is filled during collection phase, it will be later transformed into DistanceToMonster
-	tMonsterToDistance m_MonsterToDistance;
-
-	// this map is generated after collection phase, in order to access monster by distance to player
+	// the collected mobs, by their (squared) distance to the closest player
 	tDistanceToMonster m_DistanceToMonster;
 
-	// this are the collected chunks. Used to determinate the number of elligible chunk for spawning.
-	std::set<cChunk*> m_EligibleForSpawnChunks;
-
-protected :
-	// transform monsterToDistance map (that was usefull for collecting) into distanceToMonster
-	// that will be usefull for picking up.
-	void convertMaps();
-
 public :
-	// count a mob on a specified chunk with specified distance to an unkown player
-	// if the distance is shortest than the one collected, this become the new closest
-	// distance and the chunk become the "hosting" chunk (that is the one that will perform the action)
+	// count a mob on a specified chunk with specified (squared) distance to the closest player
+	// each mob is to be collected only once, by its hosting chunk (that is the one that will perform the action)
 	void CollectMob(cEntity & a_Monster, cChunk & a_Chunk, double a_Distance);
 
 	// return the mobs that are within the range of distance of the closest player they are
@@ -5,14 +5,29 @@
 
 #include "../World.h"
 #include "../Entities/Player.h"
-#include "../Tracer.h"
+#include "../LineBlockTracer.h"
+
+
+
+
+
+/** The interval between the searches for a player to target, in ticks.
+The vanilla mobs look for a target with a 1 in 10 chance each tick, so this keeps the reaction times comparable. */
+static const int TARGET_SEARCH_INTERVAL = 10;
+
+/** The interval between the line of sight traces to the target while attacking, in ticks. */
+static const int SIGHT_CHECK_INTERVAL = 4;
 
 
 
 
 
 cAggressiveMonster::cAggressiveMonster(const AString & a_ConfigName, eMonsterType a_MobType, const AString & a_SoundHurt, const AString & a_SoundDeath, double a_Width, double a_Height) :
-	super(a_ConfigName, a_MobType, a_SoundHurt, a_SoundDeath, a_Width, a_Height)
+	super(a_ConfigName, a_MobType, a_SoundHurt, a_SoundDeath, a_Width, a_Height),
+	m_TicksToTargetSearch(static_cast<int>(GetUniqueID() % TARGET_SEARCH_INTERVAL)),
+	m_TicksToSightCheck(0),
+	m_CanSeeTarget(false),
+	m_SightCheckTarget(nullptr)
 {
 	m_EMPersonality = AGGRESSIVE;
 }
@@ -61,13 +76,22 @@ void cAggressiveMonster::EventSeePlayer(cEntity * a_Entity)
 void cAggressiveMonster::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	super::Tick(a_Dt, a_Chunk);
+	if (!IsActive())
+	{
+		return;
+	}
 
 	if (m_EMState == CHASING)
 	{
 		CheckEventLostPlayer();
 	}
+	else if (m_TicksToTargetSearch > 0)
+	{
+		m_TicksToTargetSearch -= 1;
+	}
 	else
 	{
+		m_TicksToTargetSearch = TARGET_SEARCH_INTERVAL - 1;
 		CheckEventSeePlayer();
 	}
 
@@ -76,10 +100,7 @@ void cAggressiveMonster::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 		return;
 	}
 
-	cTracer LineOfSight(GetWorld());
-	Vector3d AttackDirection(m_Target->GetPosition() - GetPosition());
-
-	if (ReachedFinalDestination() && !LineOfSight.Trace(GetPosition(), AttackDirection, (int)AttackDirection.Length()))
+	if (ReachedFinalDestination() && CanSeeTarget())
 	{
 		// Attack if reached destination, target isn't null, and have a clear line of sight to target (so won't attack through walls)
 		Attack(a_Dt);
@@ -106,6 +127,22 @@ void cAggressiveMonster::Attack(std::chrono::milliseconds a_Dt)
 
 
 
+bool cAggressiveMonster::CanSeeTarget(void)
+{
+	if ((m_Target != m_SightCheckTarget) || (m_TicksToSightCheck <= 0))
+	{
+		m_SightCheckTarget = m_Target;
+		m_TicksToSightCheck = SIGHT_CHECK_INTERVAL;
+		m_CanSeeTarget = cLineBlockTracer::LineOfSightTrace(*GetWorld(), GetPosition(), m_Target->GetPosition());
+	}
+	m_TicksToSightCheck -= 1;
+	return m_CanSeeTarget;
+}
+
+
+
+
+
 bool cAggressiveMonster::IsMovingToTargetPosition()
 {
 	// Difference between destination x and target x is negligible (to 10^-12 precision)
@@ -23,9 +23,26 @@ public:
 	virtual void Attack(std::chrono::milliseconds a_Dt);
 
 protected:
+	/** Number of ticks until the next search for a player to target, while not chasing.
+	Starts at a per-mob phase offset, so that the searches of the mobs spawned together are spread across the ticks. */
+	int m_TicksToTargetSearch;
+
+	/** Number of ticks until the line of sight to the target is traced again; until then m_CanSeeTarget is used. */
+	int m_TicksToSightCheck;
+
+	/** The result of the last line of sight trace to m_SightCheckTarget. */
+	bool m_CanSeeTarget;
+
+	/** The target to which m_CanSeeTarget applies; the cached result is dropped when the target changes. */
+	cEntity * m_SightCheckTarget;
+
+
 	/** Whether this mob's destination is the same as its target's position. */
 	bool IsMovingToTargetPosition();
 
+	/** Returns whether the mob has a clear line of sight to its target, tracing it at most once per a few ticks. */
+	bool CanSeeTarget(void);
+
 } ;
 
 
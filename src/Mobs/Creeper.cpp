@@ -30,8 +30,11 @@ void cCreeper::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 	if (!ReachedFinalDestination() && !m_BurnedWithFlintAndSteel)
 	{
 		m_ExplodingTimer = 0;
-		m_bIsBlowing = false;
-		m_World->BroadcastEntityMetadata(*this);
+		if (m_bIsBlowing)
+		{
+			m_bIsBlowing = false;
+			m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
+		}
 	}
 	else
 	{
@@ -110,7 +113,7 @@ bool cCreeper::DoTakeDamage(TakeDamageInfo & a_TDI)
 		m_bIsCharged = true;
 	}
 
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 	return true;
 }
 
@@ -126,7 +129,7 @@ void cCreeper::Attack(std::chrono::milliseconds a_Dt)
 	{
 		m_World->BroadcastSoundEffect("game.tnt.primed", GetPosX(), GetPosY(), GetPosZ(), 1.f, (float)(0.75 + ((float)((GetUniqueID() * 23) % 32)) / 64));
 		m_bIsBlowing = true;
-		m_World->BroadcastEntityMetadata(*this);
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 	}
 }
 
@@ -144,7 +147,7 @@ void cCreeper::OnRightClicked(cPlayer & a_Player)
 		}
 		m_World->BroadcastSoundEffect("game.tnt.primed", GetPosX(), GetPosY(), GetPosZ(), 1.f, (float)(0.75 + ((float)((GetUniqueID() * 23) % 32)) / 64));
 		m_bIsBlowing = true;
-		m_World->BroadcastEntityMetadata(*this);
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 		m_BurnedWithFlintAndSteel = true;
 	}
 }
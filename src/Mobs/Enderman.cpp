@@ -3,7 +3,8 @@
 
 #include "Enderman.h"
 #include "../Entities/Player.h"
-#include "../Tracer.h"
+#include "../LineBlockTracer.h"
+#include "../PlayerProximityIndex.h"
 
 
 
@@ -54,8 +55,7 @@ public:
 			return false;
 		}
 		
-		cTracer LineOfSight(a_Player->GetWorld());
-		if (LineOfSight.Trace(m_EndermanPos, Direction, (int)Direction.Length()))
+		if (!cLineBlockTracer::LineOfSightTrace(*a_Player->GetWorld(), m_EndermanPos, a_Player->GetPosition()))
 		{
 			// No direct line of sight
 			return false;
@@ -109,13 +109,21 @@ void cEnderman::CheckEventSeePlayer()
 		return;
 	}
 
+	// Only the players within the sight distance can be looking at the enderman, get them from the proximity index:
+	cPlayerProximityIndex::cPlayerDistances Players;
+	m_World->GetPlayerProximityIndex().GetPlayersInRadius(GetPosition(), m_SightDistance, Players);
 	cPlayerLookCheck Callback(GetPosition(), m_SightDistance);
-	if (m_World->ForEachPlayer(Callback))
+	for (const auto & Player: Players)
+	{
+		if (Callback.Item(Player.m_Player))
+		{
+			break;
+		}
+	}
+	if (Callback.GetPlayer() == nullptr)
 	{
 		return;
 	}
-	
-	ASSERT(Callback.GetPlayer() != nullptr);
 
 	if (!CheckLight())
 	{
@@ -129,7 +137,7 @@ void cEnderman::CheckEventSeePlayer()
 		super::EventSeePlayer(Callback.GetPlayer());
 		m_EMState = CHASING;
 		m_bIsScreaming = true;
-		GetWorld()->BroadcastEntityMetadata(*this);
+		GetWorld()->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 	}
 }
 
@@ -154,7 +162,7 @@ void cEnderman::EventLosePlayer()
 {
 	super::EventLosePlayer();
 	m_bIsScreaming = false;
-	GetWorld()->BroadcastEntityMetadata(*this);
+	GetWorld()->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 }
 
 
@@ -34,6 +34,10 @@ void cHorse::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	super::Tick(a_Dt, a_Chunk);
 
+	bool WasMouthOpen = m_bIsMouthOpen;
+	bool WasTame = m_bIsTame;
+	bool WasRearing = m_bIsRearing;
+
 	if (!m_bIsMouthOpen)
 	{
 		if (m_World->GetTickRandomNumber(50) == 25)
@@ -83,7 +87,11 @@ void cHorse::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 		}
 	}
 
-	m_World->BroadcastEntityMetadata(*this);
+	// Only send the metadata if the tick changed any of it:
+	if ((m_bIsMouthOpen != WasMouthOpen) || (m_bIsTame != WasTame) || (m_bIsRearing != WasRearing))
+	{
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
+	}
 }
 
 
@@ -102,7 +110,7 @@ void cHorse::OnRightClicked(cPlayer & a_Player)
 				a_Player.GetInventory().RemoveOneEquippedItem();
 			}
 			m_bIsSaddled = true;
-			m_World->BroadcastEntityMetadata(*this);
+			m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 		}
 		else if (!a_Player.GetEquippedItem().IsEmpty())
 		{
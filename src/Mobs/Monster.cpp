@@ -99,6 +99,7 @@ cMonster::cMonster(const AString & a_ConfigName, eMonsterType a_MobType, const A
 	, m_DropChanceBoots(0.085f)
 	, m_CanPickUpLoot(true)
 	, m_TicksSinceLastDamaged(100)
+	, m_IsActive(true)
 	, m_BurnsInDaylight(false)
 	, m_RelativeWalkSpeed(1)
 {
@@ -378,6 +379,15 @@ void cMonster::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 
 	// Process the undead burning in daylight.
 	HandleDaylightBurning(*Chunk, WouldBurnAt(GetPosition(), *Chunk));
+
+	if (!m_IsActive)
+	{
+		// Too far from all players to bother with the AI, only let the physics land the mob:
+		HandleFalling();
+		BroadcastMovementUpdate();
+		return;
+	}
+
 	if (TickPathFinding(*Chunk))
 	{
 		/* If I burn in daylight, and I won't burn where I'm standing, and I'll burn in my next position, and at least one of those is true:
@@ -158,6 +158,14 @@ public:
 	*/
 	static cMonster * NewMonsterFromType(eMonsterType a_MobType);
 
+	/** Sets whether the mob runs its AI (pathfinding, wandering, looking for targets) in its ticks.
+	The world deactivates the mobs that are farther from all players than their family's activation range.
+	An inactive mob still runs its physics and timers each tick, so it falls, burns and drops eggs as usual. */
+	void SetIsActive(bool a_IsActive) { m_IsActive = a_IsActive; }
+
+	/** Returns whether the mob runs its AI in its ticks, see SetIsActive(). */
+	bool IsActive(void) const { return m_IsActive; }
+
 protected:
 
 	/** A pointer to the entity this mobile is aiming to reach */
@@ -255,6 +263,9 @@ protected:
 	bool m_CanPickUpLoot;
 	int m_TicksSinceLastDamaged;  // How many ticks ago we were last damaged by a player?
 
+	/** Whether the mob runs its AI in its ticks, see SetIsActive(). */
+	bool m_IsActive;
+
 	void HandleDaylightBurning(cChunk & a_Chunk, bool WouldBurn);
 	bool WouldBurnAt(Vector3d a_Location, cChunk & a_Chunk);
 	bool m_BurnsInDaylight;
@@ -38,6 +38,10 @@ bool cPassiveMonster::DoTakeDamage(TakeDamageInfo & a_TDI)
 void cPassiveMonster::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 {
 	super::Tick(a_Dt, a_Chunk);
+	if (!IsActive())
+	{
+		return;
+	}
 
 	if (m_EMState == ESCAPING)
 	{
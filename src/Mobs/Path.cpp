@@ -5,22 +5,61 @@
 
 #include "Path.h"
 #include "../Chunk.h"
+#include "../World.h"
 
 #define DISTANCE_MANHATTAN 0  // 1: More speed, a bit less accuracy 0: Max accuracy, less speed.
 #define HEURISTICS_ONLY 0  // 1: Much more speed, much less accurate.
 #define CALCULATIONS_PER_STEP 5  // Higher means more CPU load but faster path calculations.
 // The only version which guarantees the shortest path is 0, 0.
 
-enum class eCellStatus {OPENLIST,  CLOSEDLIST,  NOLIST};
-struct cPathCell
+#define CELL_BLOCK_SIZE 256  // Number of cells allocated at once.
+#define INITIAL_CELL_HASH_SIZE 1024  // Must be a power of 2.
+
+#define PATH_CACHE_SIZE 64  // Number of the recently found paths that are offered for reuse.
+#define PATH_CACHE_MAX_AGE 40  // Number of ticks for which a found path is offered for reuse.
+
+
+
+
+
+/** A recently found path, offered to the other paths with the same source and destination in the same world,
+such as the mobs standing together and chasing the same player, or a mob repeatedly re-pathing while stuck. */
+struct sCachedPath
 {
-	Vector3i m_Location;   // Location of the cell in the world.
-	int m_F, m_G, m_H;  // F, G, H as defined in regular A*.
-	eCellStatus m_Status;  // Which list is the cell in? Either non, open, or closed.
-	cPathCell * m_Parent;  // Cell's parent, as defined in regular A*.
-	bool m_IsSolid;	   // Is the cell an air or a solid? Partial solids are currently considered solids.
+	const cWorld * m_World;
+	Vector3i m_Source;
+	Vector3i m_Destination;
+	Int64 m_WorldAge;
+	std::vector<Vector3i> m_PathPoints;
 };
 
+/** The recently found paths, indexed by the hash of their source and destination; newer paths replace older ones. */
+static sCachedPath g_PathCache[PATH_CACHE_SIZE];
+
+/** Protects g_PathCache, the worlds tick in their own threads. */
+static cCriticalSection g_CSPathCache;
+
+
+
+
+
+static inline size_t HashLocation(const Vector3i & a_Location)
+{
+	return
+		static_cast<size_t>(static_cast<UInt32>(a_Location.x) * 73856093U) ^
+		static_cast<size_t>(static_cast<UInt32>(a_Location.y) * 19349663U) ^
+		static_cast<size_t>(static_cast<UInt32>(a_Location.z) * 83492791U);
+}
+
+
+
+
+
+static inline size_t GetPathCacheIndex(const Vector3i & a_Source, const Vector3i & a_Destination)
+{
+	return (HashLocation(a_Source) * 31 + HashLocation(a_Destination)) % PATH_CACHE_SIZE;
+}
+
 
 
 
@@ -41,17 +80,28 @@ cPath::cPath(
 	double a_BoundingBoxWidth, double a_BoundingBoxHeight,
 	int a_MaxUp, int a_MaxDown
 ) :
+	m_NumCellsInLastBlock(CELL_BLOCK_SIZE),
+	m_NumCells(0),
 	m_Destination(a_EndingPoint.Floor()),
 	m_Source(a_StartingPoint.Floor()),
 	m_CurrentPoint(0),  // GetNextPoint increments this to 1, but that's fine, since the first cell is always a_StartingPoint
 	m_Chunk(&a_Chunk)
 {
+	// Reuse the path if another mob has just walked the same way:
+	if (LoadFromCache(a_Chunk))
+	{
+		m_Status = ePathFinderStatus::PATH_FOUND;
+		m_Chunk = nullptr;
+		return;
+	}
+
 	// TODO: if src not walkable OR dest not walkable, then abort.
 	// Borrow a new "isWalkable" from ProcessIfWalkable, make ProcessIfWalkable also call isWalkable
 
 	if (GetCell(m_Source)->m_IsSolid || GetCell(m_Destination)->m_IsSolid)
 	{
-		m_Status = ePathFinderStatus::PATH_NOT_FOUND;
+		FinishCalculation(ePathFinderStatus::PATH_NOT_FOUND);
+		m_Chunk = nullptr;
 		return;
 	}
 
@@ -173,6 +223,7 @@ bool cPath::Step_Internal()
 		} while (CurrentCell != nullptr);
 
 		FinishCalculation(ePathFinderStatus::PATH_FOUND);
+		StoreToCache(*m_Chunk);
 		return true;
 	}
 
@@ -215,12 +266,10 @@ bool cPath::Step_Internal()
 
 void cPath::FinishCalculation()
 {
-	for (auto && pair : m_Map)
-	{
-		delete pair.second;
-	}
-
-	m_Map.clear();
+	m_CellBlocks.clear();
+	m_NumCellsInLastBlock = CELL_BLOCK_SIZE;
+	std::vector<cPathCell *>().swap(m_CellHash);
+	m_NumCells = 0;
 	m_OpenList = std::priority_queue<cPathCell *, std::vector<cPathCell *>, compareHeuristics>{};
 }
 
@@ -343,13 +392,28 @@ void cPath::ProcessCell(cPathCell * a_Cell, cPathCell * a_Caller, int a_GDelta)
 cPathCell * cPath::GetCell(const Vector3i & a_Location)
 {
 	// Create the cell in the hash table if it's not already there.
-	cPathCell * Cell;
-	if (m_Map.count(a_Location) == 0)  // Case 1: Cell is not on any list. We've never checked this cell before.
+	if (m_CellHash.empty())
+	{
+		m_CellHash.resize(INITIAL_CELL_HASH_SIZE, nullptr);
+	}
+	size_t Mask = m_CellHash.size() - 1;
+	size_t Idx = HashLocation(a_Location) & Mask;
+	while ((m_CellHash[Idx] != nullptr) && !(m_CellHash[Idx]->m_Location == a_Location))
+	{
+		Idx = (Idx + 1) & Mask;
+	}
+	cPathCell * Cell = m_CellHash[Idx];
+	if (Cell == nullptr)  // Case 1: Cell is not on any list. We've never checked this cell before.
 	{
-		Cell = new cPathCell();
+		Cell = AllocateCell();
 		Cell->m_Location = a_Location;
-		m_Map[a_Location] = Cell;
-		Cell->m_IsSolid = IsSolid(a_Location);
+		m_CellHash[Idx] = Cell;
+		m_NumCells += 1;
+		if (2 * m_NumCells > m_CellHash.size())
+		{
+			GrowCellHash();
+		}
+		Cell->m_IsSolid = IsSolid(a_Location);  // May add more cells
 		Cell->m_Status = eCellStatus::NOLIST;
 		#ifdef COMPILING_PATHFIND_DEBUGGER
 			#ifdef COMPILING_PATHFIND_DEBUGGER_MARK_UNCHECKED
@@ -360,6 +424,87 @@ cPathCell * cPath::GetCell(const Vector3i & a_Location)
 	}
 	else
 	{
-		return m_Map[a_Location];
+		return Cell;
 	}
 }
+
+
+
+
+
+cPathCell * cPath::AllocateCell(void)
+{
+	if (m_NumCellsInLastBlock >= CELL_BLOCK_SIZE)
+	{
+		m_CellBlocks.emplace_back(new cPathCell[CELL_BLOCK_SIZE]());
+		m_NumCellsInLastBlock = 0;
+	}
+	return &m_CellBlocks.back()[m_NumCellsInLastBlock++];
+}
+
+
+
+
+
+void cPath::GrowCellHash(void)
+{
+	std::vector<cPathCell *> OldHash(m_CellHash.size() * 2, nullptr);
+	std::swap(OldHash, m_CellHash);
+	size_t Mask = m_CellHash.size() - 1;
+	for (auto Cell : OldHash)
+	{
+		if (Cell == nullptr)
+		{
+			continue;
+		}
+		size_t Idx = HashLocation(Cell->m_Location) & Mask;
+		while (m_CellHash[Idx] != nullptr)
+		{
+			Idx = (Idx + 1) & Mask;
+		}
+		m_CellHash[Idx] = Cell;
+	}
+}
+
+
+
+
+
+bool cPath::LoadFromCache(cChunk & a_Chunk)
+{
+	const cWorld * World = a_Chunk.GetWorld();
+	Int64 WorldAge = a_Chunk.GetWorld()->GetWorldAge();
+	cCSLock Lock(g_CSPathCache);
+	const sCachedPath & Cached = g_PathCache[GetPathCacheIndex(m_Source, m_Destination)];
+	if (
+		(Cached.m_World != World) ||
+		!(Cached.m_Source == m_Source) ||
+		!(Cached.m_Destination == m_Destination) ||
+		(WorldAge - Cached.m_WorldAge > PATH_CACHE_MAX_AGE) ||
+		(WorldAge < Cached.m_WorldAge)
+	)
+	{
+		return false;
+	}
+	m_PathPoints = Cached.m_PathPoints;
+	return true;
+}
+
+
+
+
+
+void cPath::StoreToCache(cChunk & a_Chunk)
+{
+	cCSLock Lock(g_CSPathCache);
+	sCachedPath & Cached = g_PathCache[GetPathCacheIndex(m_Source, m_Destination)];
+	Cached.m_World = a_Chunk.GetWorld();
+	Cached.m_Source = m_Source;
+	Cached.m_Destination = m_Destination;
+	Cached.m_WorldAge = a_Chunk.GetWorld()->GetWorldAge();
+	Cached.m_PathPoints = m_PathPoints;
+}
+
+
+
+
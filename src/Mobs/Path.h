@@ -17,14 +17,20 @@ Put this in your .cpp:
 	#include "PathFinderIrrlicht_Head.h"
 #endif
 
-#include <unordered_map>
-
 //fwd: ../Chunk.h
 class cChunk;
 
 /* Various little structs and classes */
 enum class ePathFinderStatus {CALCULATING,  PATH_FOUND,  PATH_NOT_FOUND};
-struct cPathCell;  // Defined inside Path.cpp
+enum class eCellStatus {OPENLIST,  CLOSEDLIST,  NOLIST};
+struct cPathCell
+{
+	Vector3i m_Location;   // Location of the cell in the world.
+	int m_F, m_G, m_H;  // F, G, H as defined in regular A*.
+	eCellStatus m_Status;  // Which list is the cell in? Either non, open, or closed.
+	cPathCell * m_Parent;  // Cell's parent, as defined in regular A*.
+	bool m_IsSolid;	   // Is the cell an air or a solid? Partial solids are currently considered solids.
+};
 class compareHeuristics
 {
 public:
@@ -97,21 +103,6 @@ public:
 		return m_PathPoints.size();
 	}
 
-	struct VectorHasher
-	{
-		std::size_t operator()(const Vector3i & a_Vector) const
-		{
-			// Guaranteed to have no hash collisions for any 128x128x128 area. Suitable for pathfinding.
-			int32_t t = 0;
-			t += (int8_t)a_Vector.x;
-			t = t << 8;
-			t += (int8_t)a_Vector.y;
-			t = t << 8;
-			t += (int8_t)a_Vector.z;
-			t = t << 8;
-			return (size_t)t;
-		}
-	};
 private:
 
 	/* General */
@@ -128,10 +119,26 @@ private:
 	/* Map management */
 	void ProcessCell(cPathCell * a_Cell,  cPathCell * a_Caller,  int a_GDelta);
 	cPathCell * GetCell(const Vector3i & a_location);
+	cPathCell * AllocateCell(void);  // Returns a new zeroed cell from m_CellBlocks.
+	void GrowCellHash(void);  // Doubles the size of m_CellHash, re-inserting the cells.
+
+	/* Path sharing, see Path.cpp */
+	bool LoadFromCache(cChunk & a_Chunk);  // Fills m_PathPoints with a recently found path with the same source and destination, returns true if found.
+	void StoreToCache(cChunk & a_Chunk);  // Offers the found m_PathPoints for reuse by other paths.
 
 	/* Pathfinding fields */
 	std::priority_queue<cPathCell *,  std::vector<cPathCell *>,  compareHeuristics> m_OpenList;
-	std::unordered_map<Vector3i,  cPathCell *, VectorHasher> m_Map;
+
+	/** The storage of the cells inspected so far, allocated in blocks so that the cell addresses stay valid
+	for the open list and the parent links while more cells are added. Released when the calculation finishes. */
+	std::vector<std::unique_ptr<cPathCell[]>> m_CellBlocks;
+	size_t m_NumCellsInLastBlock;
+
+	/** Open-addressing hash of the cells in m_CellBlocks by their location, with linear probing.
+	The size is a power of 2, the hash is kept at most half full. */
+	std::vector<cPathCell *> m_CellHash;
+	size_t m_NumCells;
+
 	Vector3i m_Destination;
 	Vector3i m_Source;
 	int m_StepsLeft;
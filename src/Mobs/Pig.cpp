@@ -72,7 +72,7 @@ void cPig::OnRightClicked(cPlayer & a_Player)
 
 		// Set saddle state & broadcast metadata
 		m_bIsSaddled = true;
-		m_World->BroadcastEntityMetadata(*this);
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 	}
 }
 
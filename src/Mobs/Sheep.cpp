@@ -60,7 +60,7 @@ void cSheep::OnRightClicked(cPlayer & a_Player)
 	if ((EquippedItem.m_ItemType == E_ITEM_SHEARS) && !IsSheared() && !IsBaby())
 	{
 		m_IsSheared = true;
-		m_World->BroadcastEntityMetadata(*this);
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 		a_Player.UseEquippedItem();
 
 		cItems Drops;
@@ -76,7 +76,7 @@ void cSheep::OnRightClicked(cPlayer & a_Player)
 		{
 			a_Player.GetInventory().RemoveOneEquippedItem();
 		}
-		m_World->BroadcastEntityMetadata(*this);
+		m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 	}
 }
 
@@ -109,7 +109,7 @@ void cSheep::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 				m_World->SetBlock(PosX, PosY, PosZ, E_BLOCK_DIRT, 0);
 				GetWorld()->BroadcastSoundParticleEffect(2001, PosX, PosY, PosX, E_BLOCK_GRASS);
 				m_IsSheared = false;
-				m_World->BroadcastEntityMetadata(*this);
+				m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 			}
 		}
 	}
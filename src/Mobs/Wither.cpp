@@ -87,7 +87,7 @@ void cWither::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 		}
 	}
 
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 }
 
 
@@ -37,7 +37,7 @@ bool cWolf::DoTakeDamage(TakeDamageInfo & a_TDI)
 	{
 		m_IsAngry = true;
 	}
-	m_World->BroadcastEntityMetadata(*this);  // Broadcast health and possibly angry face
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);  // Broadcast health and possibly angry face
 	return true;
 }
 
@@ -139,7 +139,7 @@ void cWolf::OnRightClicked(cPlayer & a_Player)
 		}
 	}
 
-	m_World->BroadcastEntityMetadata(*this);
+	m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 }
 
 
@@ -174,7 +174,7 @@ void cWolf::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 				if (!IsBegging())
 				{
 					SetIsBegging(true);
-					m_World->BroadcastEntityMetadata(*this);
+					m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 				}
 
 				m_FinalDestination = a_Closest_Player->GetPosition();  // So that we will look at a player holding food
@@ -192,7 +192,7 @@ void cWolf::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
 				if (IsBegging())
 				{
 					SetIsBegging(false);
-					m_World->BroadcastEntityMetadata(*this);
+					m_World->BroadcastEntityMetadata(*this, nullptr, emfSpecific);
 				}
 			}
 		}
@@ -2,9 +2,17 @@
 #include "Globals.h"  // NOTE: MSVC stupidness requires this to be the same across all modules
 
 #include "Noise.h"
+#include "../OSSupport/File.h"
 
 #define FAST_FLOOR(x) (((x) < 0) ? (((int)x) - 1) : ((int)x))
 
+// Use the SSE2 interpolation kernels where available; other platforms use the scalar cNoise::CubicInterpolate():
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define NOISE_USE_SSE2
+	#include <emmintrin.h>
+	static_assert(std::is_same<NOISE_DATATYPE, float>::value, "The SSE2 noise kernels need NOISE_DATATYPE to be float");
+#endif
+
 
 
 
@@ -190,6 +198,67 @@ void Debug2DNoise(const NOISE_DATATYPE * a_Noise, int a_SizeX, int a_SizeY, cons
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// Interpolation kernels:
+
+/** Cubic-interpolates each of the four rows of a_Values by a_Pct: a_Out[i] = CubicInterpolate(a_Values[i][0 .. 3], a_Pct). */
+static inline void CubicInterpolate4(const NOISE_DATATYPE (& a_Values)[4][4], NOISE_DATATYPE a_Pct, NOISE_DATATYPE (& a_Out)[4])
+{
+	#ifdef NOISE_USE_SSE2
+		// Transpose so that each register holds one of the parameters for all the four rows:
+		__m128 A = _mm_loadu_ps(a_Values[0]);
+		__m128 B = _mm_loadu_ps(a_Values[1]);
+		__m128 C = _mm_loadu_ps(a_Values[2]);
+		__m128 D = _mm_loadu_ps(a_Values[3]);
+		_MM_TRANSPOSE4_PS(A, B, C, D);
+		__m128 Pct = _mm_set1_ps(a_Pct);
+		__m128 AmB = _mm_sub_ps(A, B);
+		__m128 P = _mm_sub_ps(_mm_sub_ps(D, C), AmB);
+		__m128 Q = _mm_sub_ps(AmB, P);
+		__m128 R = _mm_sub_ps(C, A);
+		_mm_storeu_ps(a_Out, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(P, Pct), Q), Pct), R), Pct), B));
+	#else
+		for (int i = 0; i < 4; i++)
+		{
+			a_Out[i] = cNoise::CubicInterpolate(a_Values[i][0], a_Values[i][1], a_Values[i][2], a_Values[i][3], a_Pct);
+		}
+	#endif
+}
+
+
+
+
+
+/** Cubic-interpolates a_Values by each of the a_Count ratios in a_Pcts: a_Out[i] = CubicInterpolate(a_Values[0 .. 3], a_Pcts[i]). */
+static inline void CubicInterpolateRow(const NOISE_DATATYPE (& a_Values)[4], const NOISE_DATATYPE * a_Pcts, int a_Count, NOISE_DATATYPE * a_Out)
+{
+	// The polynomial coefficients are the same for the whole row:
+	NOISE_DATATYPE P = (a_Values[3] - a_Values[2]) - (a_Values[0] - a_Values[1]);
+	NOISE_DATATYPE Q = (a_Values[0] - a_Values[1]) - P;
+	NOISE_DATATYPE R = a_Values[2] - a_Values[0];
+	NOISE_DATATYPE S = a_Values[1];
+	int i = 0;
+	#ifdef NOISE_USE_SSE2
+		__m128 P4 = _mm_set1_ps(P);
+		__m128 Q4 = _mm_set1_ps(Q);
+		__m128 R4 = _mm_set1_ps(R);
+		__m128 S4 = _mm_set1_ps(S);
+		for (; i + 4 <= a_Count; i += 4)
+		{
+			__m128 Pct = _mm_loadu_ps(a_Pcts + i);
+			_mm_storeu_ps(a_Out + i, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(P4, Pct), Q4), Pct), R4), Pct), S4));
+		}
+	#endif
+	for (; i < a_Count; i++)
+	{
+		a_Out[i] = ((P * a_Pcts[i] + Q) * a_Pcts[i] + R) * a_Pcts[i] + S;
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cCubicCell2D:
 
@@ -268,16 +337,8 @@ void cCubicCell2D::Generate(
 	for (int y = a_FromY; y < a_ToY; y++)
 	{
 		NOISE_DATATYPE Interp[4];
-		NOISE_DATATYPE FracY = m_FracY[y];
-		Interp[0] = cNoise::CubicInterpolate((*m_WorkRnds)[0][0], (*m_WorkRnds)[0][1], (*m_WorkRnds)[0][2], (*m_WorkRnds)[0][3], FracY);
-		Interp[1] = cNoise::CubicInterpolate((*m_WorkRnds)[1][0], (*m_WorkRnds)[1][1], (*m_WorkRnds)[1][2], (*m_WorkRnds)[1][3], FracY);
-		Interp[2] = cNoise::CubicInterpolate((*m_WorkRnds)[2][0], (*m_WorkRnds)[2][1], (*m_WorkRnds)[2][2], (*m_WorkRnds)[2][3], FracY);
-		Interp[3] = cNoise::CubicInterpolate((*m_WorkRnds)[3][0], (*m_WorkRnds)[3][1], (*m_WorkRnds)[3][2], (*m_WorkRnds)[3][3], FracY);
-		int idx = y * m_SizeX + a_FromX;
-		for (int x = a_FromX; x < a_ToX; x++)
-		{
-			m_Array[idx++] = cNoise::CubicInterpolate(Interp[0], Interp[1], Interp[2], Interp[3], m_FracX[x]);
-		}  // for x
+		CubicInterpolate4(*m_WorkRnds, m_FracY[y], Interp);
+		CubicInterpolateRow(Interp, m_FracX + a_FromX, a_ToX - a_FromX, m_Array + y * m_SizeX + a_FromX);
 	}  // for y
 }
 
@@ -432,24 +493,13 @@ void cCubicCell3D::Generate(
 		NOISE_DATATYPE FracZ = m_FracZ[z];
 		for (int x = 0; x < 4; x++)
 		{
-			for (int y = 0; y < 4; y++)
-			{
-				Interp2[x][y] = cNoise::CubicInterpolate((*m_WorkRnds)[x][y][0], (*m_WorkRnds)[x][y][1], (*m_WorkRnds)[x][y][2], (*m_WorkRnds)[x][y][3], FracZ);
-			}
+			CubicInterpolate4((*m_WorkRnds)[x], FracZ, Interp2[x]);
 		}
 		for (int y = a_FromY; y < a_ToY; y++)
 		{
 			NOISE_DATATYPE Interp[4];
-			NOISE_DATATYPE FracY = m_FracY[y];
-			Interp[0] = cNoise::CubicInterpolate(Interp2[0][0], Interp2[0][1], Interp2[0][2], Interp2[0][3], FracY);
-			Interp[1] = cNoise::CubicInterpolate(Interp2[1][0], Interp2[1][1], Interp2[1][2], Interp2[1][3], FracY);
-			Interp[2] = cNoise::CubicInterpolate(Interp2[2][0], Interp2[2][1], Interp2[2][2], Interp2[2][3], FracY);
-			Interp[3] = cNoise::CubicInterpolate(Interp2[3][0], Interp2[3][1], Interp2[3][2], Interp2[3][3], FracY);
-			int idx = idxZ + y * m_SizeX + a_FromX;
-			for (int x = a_FromX; x < a_ToX; x++)
-			{
-				m_Array[idx++] = cNoise::CubicInterpolate(Interp[0], Interp[1], Interp[2], Interp[3], m_FracX[x]);
-			}  // for x
+			CubicInterpolate4(Interp2, m_FracY[y], Interp);
+			CubicInterpolateRow(Interp, m_FracX + a_FromX, a_ToX - a_FromX, m_Array + idxZ + y * m_SizeX + a_FromX);
 		}  // for y
 	}  // for z
 }
@@ -904,6 +954,11 @@ void cImprovedNoise::Generate2D(
 	NOISE_DATATYPE a_StartY, NOISE_DATATYPE a_EndY
 ) const
 {
+	std::vector<int> xCoords(static_cast<size_t>(a_SizeX));
+	std::vector<NOISE_DATATYPE> xFracs(static_cast<size_t>(a_SizeX));
+	std::vector<NOISE_DATATYPE> xFades(static_cast<size_t>(a_SizeX));
+	CalcAxis(a_SizeX, a_StartX, a_EndX, xCoords.data(), xFracs.data(), xFades.data());
+
 	size_t idx = 0;
 	for (int y = 0; y < a_SizeY; y++)
 	{
@@ -915,12 +970,9 @@ void cImprovedNoise::Generate2D(
 		NOISE_DATATYPE fadeY = Fade(noiseYFrac);
 		for (int x = 0; x < a_SizeX; x++)
 		{
-			NOISE_DATATYPE ratioX = static_cast<NOISE_DATATYPE>(x) / (a_SizeX - 1);
-			NOISE_DATATYPE noiseX = Lerp(a_StartX, a_EndX, ratioX);
-			int noiseXInt = FAST_FLOOR(noiseX);
-			int xCoord = noiseXInt & 255;
-			NOISE_DATATYPE noiseXFrac = noiseX - noiseXInt;
-			NOISE_DATATYPE fadeX = Fade(noiseXFrac);
+			int xCoord = xCoords[static_cast<size_t>(x)];
+			NOISE_DATATYPE noiseXFrac = xFracs[static_cast<size_t>(x)];
+			NOISE_DATATYPE fadeX = xFades[static_cast<size_t>(x)];
 
 			// Hash the coordinates:
 			int A  = m_Perm[xCoord] + yCoord;
@@ -952,6 +1004,11 @@ void cImprovedNoise::Generate3D(
 	NOISE_DATATYPE a_StartZ, NOISE_DATATYPE a_EndZ
 ) const
 {
+	std::vector<int> xCoords(static_cast<size_t>(a_SizeX));
+	std::vector<NOISE_DATATYPE> xFracs(static_cast<size_t>(a_SizeX));
+	std::vector<NOISE_DATATYPE> xFades(static_cast<size_t>(a_SizeX));
+	CalcAxis(a_SizeX, a_StartX, a_EndX, xCoords.data(), xFracs.data(), xFades.data());
+
 	size_t idx = 0;
 	for (int z = 0; z < a_SizeZ; z++)
 	{
@@ -971,12 +1028,9 @@ void cImprovedNoise::Generate3D(
 			NOISE_DATATYPE fadeY = Fade(noiseYFrac);
 			for (int x = 0; x < a_SizeX; x++)
 			{
-				NOISE_DATATYPE ratioX = static_cast<NOISE_DATATYPE>(x) / (a_SizeX - 1);
-				NOISE_DATATYPE noiseX = Lerp(a_StartX, a_EndX, ratioX);
-				int noiseXInt = FAST_FLOOR(noiseX);
-				int xCoord = noiseXInt & 255;
-				NOISE_DATATYPE noiseXFrac = noiseX - noiseXInt;
-				NOISE_DATATYPE fadeX = Fade(noiseXFrac);
+				int xCoord = xCoords[static_cast<size_t>(x)];
+				NOISE_DATATYPE noiseXFrac = xFracs[static_cast<size_t>(x)];
+				NOISE_DATATYPE fadeX = xFades[static_cast<size_t>(x)];
 
 				// Hash the coordinates:
 				int A  = m_Perm[xCoord] + yCoord;
@@ -1010,6 +1064,26 @@ void cImprovedNoise::Generate3D(
 
 
 
+void cImprovedNoise::CalcAxis(
+	int a_Size, NOISE_DATATYPE a_Start, NOISE_DATATYPE a_End,
+	int * a_Coords, NOISE_DATATYPE * a_Fracs, NOISE_DATATYPE * a_Fades
+)
+{
+	for (int i = 0; i < a_Size; i++)
+	{
+		NOISE_DATATYPE ratio = static_cast<NOISE_DATATYPE>(i) / (a_Size - 1);
+		NOISE_DATATYPE noise = Lerp(a_Start, a_End, ratio);
+		int noiseInt = FAST_FLOOR(noise);
+		a_Coords[i] = noiseInt & 255;
+		a_Fracs[i] = noise - noiseInt;
+		a_Fades[i] = Fade(a_Fracs[i]);
+	}
+}
+
+
+
+
+
 NOISE_DATATYPE cImprovedNoise::GetValueAt(int a_X, int a_Y, int a_Z)
 {
 	// Hash the coordinates:
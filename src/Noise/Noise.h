@@ -151,6 +151,14 @@ protected:
 	int m_Perm[512];
 
 
+	/** Calculates the per-coord values along one axis of a query array: the coord of the lattice cell (masked to the permutation
+	table size), the fractional position within the cell and its fade. These are the same for all the rows of the array,
+	so Generate2D() and Generate3D() calculate them only once per query for the X axis. */
+	static void CalcAxis(
+		int a_Size, NOISE_DATATYPE a_Start, NOISE_DATATYPE a_End,
+		int * a_Coords, NOISE_DATATYPE * a_Fracs, NOISE_DATATYPE * a_Fades
+	);
+
 	/** Calculates the fade curve, 6 * t^5 - 15 * t^4 + 10 * t^3. */
 	inline static NOISE_DATATYPE Fade(NOISE_DATATYPE a_T)
 	{
@@ -69,7 +69,7 @@ public:
 	) const
 	{
 		int ArrayCount = a_SizeX * a_SizeY * a_SizeZ;
-		m_Noise.Generate2D(
+		m_Noise.Generate3D(
 			a_Array, a_SizeX, a_SizeY, a_SizeZ,
 			a_StartX, a_EndX,
 			a_StartY, a_EndY,
@@ -0,0 +1,261 @@
+// AsyncFileWriter.cpp
+
+// Implements the cAsyncFileWriter class representing a background thread writing whole files, such as the player data
+
+#include "Globals.h"
+#include "AsyncFileWriter.h"
+#include "IsThread.h"
+
+
+
+
+
+/** How long the writer thread waits for new files before checking whether it should terminate, in msec. */
+static const unsigned WRITER_IDLE_MSEC = 1000;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAsyncFileWriter::cWriterThread:
+
+/** The background thread that writes the queued files. */
+class cAsyncFileWriter::cWriterThread :
+	public cIsThread
+{
+	typedef cIsThread super;
+
+public:
+	cWriterThread(cAsyncFileWriter & a_Parent) :
+		super("cAsyncFileWriter::cWriterThread"),
+		m_Parent(a_Parent)
+	{
+	}
+
+	void Stop(void)
+	{
+		m_ShouldTerminate = true;
+		m_Parent.m_evtQueued.Set();
+		Wait();
+	}
+
+protected:
+	cAsyncFileWriter & m_Parent;
+
+	virtual void Execute(void) override
+	{
+		while (!m_ShouldTerminate)
+		{
+			m_Parent.m_evtQueued.Wait(WRITER_IDLE_MSEC);
+			m_Parent.WriteQueued();
+		}
+	}
+} ;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAsyncFileWriter:
+
+cAsyncFileWriter::cAsyncFileWriter(void) :
+	m_NumWriting(0),
+	m_IsAsync(false)
+{
+}
+
+
+
+
+
+cAsyncFileWriter::~cAsyncFileWriter()
+{
+	Stop();
+}
+
+
+
+
+
+void cAsyncFileWriter::Start(void)
+{
+	{
+		cCSLock Lock(m_CS);
+		if (m_IsAsync)
+		{
+			return;
+		}
+		m_WriterThread.reset(new cWriterThread(*this));
+		m_IsAsync = true;
+	}
+	if (!m_WriterThread->Start())
+	{
+		// Keep writing synchronously:
+		LOGWARNING("cAsyncFileWriter: Cannot start the writer thread, files will be written synchronously");
+		{
+			cCSLock Lock(m_CS);
+			m_IsAsync = false;
+		}
+		m_WriterThread.reset();
+		WriteQueued();
+	}
+}
+
+
+
+
+
+void cAsyncFileWriter::Stop(void)
+{
+	std::unique_ptr<cWriterThread> WriterThread;
+	{
+		cCSLock Lock(m_CS);
+		if (!m_IsAsync)
+		{
+			return;
+		}
+		std::swap(WriterThread, m_WriterThread);
+	}
+	WriterThread->Stop();
+
+	// Switch back to the synchronous writes, then write out whatever has been queued in the meantime:
+	{
+		cCSLock Lock(m_CS);
+		m_IsAsync = false;
+	}
+	WriteQueued();
+}
+
+
+
+
+
+void cAsyncFileWriter::Write(const AString & a_FileName, AString && a_Data)
+{
+	{
+		cCSLock Lock(m_CS);
+		if (m_IsAsync)
+		{
+			std::swap(m_Queue[a_FileName], a_Data);
+			m_evtQueued.Set();
+			return;
+		}
+	}
+	if (!WriteFileSafely(a_FileName, a_Data))
+	{
+		LOGWARNING("Cannot write file \"%s\", the data is lost.", a_FileName.c_str());
+	}
+}
+
+
+
+
+
+void cAsyncFileWriter::Flush(void)
+{
+	for (;;)
+	{
+		{
+			cCSLock Lock(m_CS);
+			if (m_Queue.empty() && (m_NumWriting == 0))
+			{
+				return;
+			}
+			if (!m_IsAsync)
+			{
+				// The writer is being stopped and will write the rest synchronously (or has done so already):
+				break;
+			}
+		}
+		m_evtQueued.Set();
+		m_evtWritten.Wait(WRITER_IDLE_MSEC);
+	}
+	WriteQueued();
+}
+
+
+
+
+
+void cAsyncFileWriter::WriteQueued(void)
+{
+	std::map<AString, AString> Queue;
+	{
+		cCSLock Lock(m_CS);
+		std::swap(Queue, m_Queue);
+		m_NumWriting += Queue.size();
+	}
+	for (auto itr = Queue.cbegin(), end = Queue.cend(); itr != end; ++itr)
+	{
+		if (!WriteFileSafely(itr->first, itr->second))
+		{
+			LOGWARNING("Cannot write file \"%s\", the data is lost.", itr->first.c_str());
+		}
+	}
+	{
+		cCSLock Lock(m_CS);
+		m_NumWriting -= Queue.size();
+	}
+	m_evtWritten.Set();
+}
+
+
+
+
+
+bool cAsyncFileWriter::WriteFileSafely(const AString & a_FileName, const AString & a_Data)
+{
+	AString TempFileName = a_FileName + ".tmp";
+	{
+		cFile f;
+		if (!f.Open(TempFileName, cFile::fmWrite))
+		{
+			// The folders may be missing, create them and retry:
+			CreateParentFolders(a_FileName);
+			if (!f.Open(TempFileName, cFile::fmWrite))
+			{
+				return false;
+			}
+		}
+		if (f.Write(a_Data.data(), a_Data.size()) != static_cast<int>(a_Data.size()))
+		{
+			f.Close();
+			cFile::Delete(TempFileName);
+			return false;
+		}
+	}
+
+	// Replace the original file with the temporary one:
+	#ifdef _WIN32
+		bool IsRenamed = (MoveFileExA(TempFileName.c_str(), a_FileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0);
+	#else
+		bool IsRenamed = cFile::Rename(TempFileName, a_FileName);
+	#endif
+	if (!IsRenamed)
+	{
+		cFile::Delete(TempFileName);
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+void cAsyncFileWriter::CreateParentFolders(const AString & a_FileName)
+{
+	for (size_t i = 1; i < a_FileName.size(); i++)
+	{
+		if ((a_FileName[i] == '/') || (a_FileName[i] == '\\'))
+		{
+			cFile::CreateFolder(a_FileName.substr(0, i));
+		}
+	}
+}
+
+
+
+
@@ -0,0 +1,76 @@
+// AsyncFileWriter.h
+
+// Declares the cAsyncFileWriter class representing a background thread writing whole files, such as the player data
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** Writes whole files in a background thread, so that the tick thread doesn't wait for the disk.
+Each file is written into a temporary file first, which is then renamed over the original, so that a crash midway
+never leaves a truncated file behind. The missing folders on the file's path are created.
+If a file is queued again before its previous data has been written, only the newest data is written.
+While the writer is not running, the files are written directly on the calling thread. */
+class cAsyncFileWriter
+{
+public:
+	cAsyncFileWriter(void);
+	~cAsyncFileWriter();
+
+	/** Starts the writer thread; until then the files are written synchronously. */
+	void Start(void);
+
+	/** Writes out all the queued files and stops the writer thread; the files are written synchronously again afterwards. */
+	void Stop(void);
+
+	/** Queues the data to be written into the specified file, replacing any data queued for the same file earlier. */
+	void Write(const AString & a_FileName, AString && a_Data);
+
+	/** Waits until all the files queued so far have been written. Used before reading a file that may still be queued. */
+	void Flush(void);
+
+	/** Writes the data into the file through a temporary file, creating the missing folders.
+	Returns true on success; on failure the original file, if any, is left untouched. */
+	static bool WriteFileSafely(const AString & a_FileName, const AString & a_Data);
+
+protected:
+	class cWriterThread;
+
+	/** Protects all the members against multithreaded access. Not held while writing the files. */
+	cCriticalSection m_CS;
+
+	/** The data waiting to be written, by the file name. */
+	std::map<AString, AString> m_Queue;
+
+	/** Number of the files taken from m_Queue by the writer thread that haven't been written yet. */
+	size_t m_NumWriting;
+
+	/** True while the writer thread is running and the files are being queued. */
+	bool m_IsAsync;
+
+	/** Signalled when a file is queued. */
+	cEvent m_evtQueued;
+
+	/** Signalled whenever a batch of files has been written. */
+	cEvent m_evtWritten;
+
+	/** The writer thread, valid while m_IsAsync. */
+	std::unique_ptr<cWriterThread> m_WriterThread;
+
+
+	/** Writes all the files currently queued. */
+	void WriteQueued(void);
+
+	/** Creates all the folders on the path to the specified file. */
+	static void CreateParentFolders(const AString & a_FileName);
+} ;
+
+
+
+
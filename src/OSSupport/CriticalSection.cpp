@@ -6,15 +6,120 @@
 
 
 
+/** All the named CSes, so that their owners can be reported. The mutex and the set are never destroyed,
+because the CSes may be destroyed by other static objects' destructors. */
+static std::mutex & GetNamedMutex(void)
+{
+	static std::mutex * Mutex = new std::mutex;
+	return *Mutex;
+}
+
+static std::set<cCriticalSection *> & GetNamedCSes(void)
+{
+	static std::set<cCriticalSection *> * NamedCSes = new std::set<cCriticalSection *>;
+	return *NamedCSes;
+}
+
+
+
+
+
+#ifdef ENABLE_LOCK_STATS
+
+/** The stats of all the CSes of a single name. Updated by the lock owners without any locking, hence the atomics. */
+struct cCriticalSection::sStats
+{
+	const char * m_Name;
+	std::atomic<Int64> m_NumAcquisitions;  ///< Number of times the CS has been acquired (not counting recursive locking)
+	std::atomic<Int64> m_NumContended;     ///< Number of acquisitions that had to wait for another thread to release the CS
+	std::atomic<Int64> m_WaitNSec;         ///< Total time spent waiting for the CS
+	std::atomic<Int64> m_MaxWaitNSec;      ///< The longest single wait for the CS
+	std::atomic<Int64> m_HoldNSec;         ///< Total time the CS has been held
+	std::atomic<Int64> m_MaxHoldNSec;      ///< The longest single hold of the CS
+
+	sStats(const char * a_Name) :
+		m_Name(a_Name)
+	{
+		Reset();
+	}
+
+	void Reset(void)
+	{
+		m_NumAcquisitions = 0;
+		m_NumContended = 0;
+		m_WaitNSec = 0;
+		m_MaxWaitNSec = 0;
+		m_HoldNSec = 0;
+		m_MaxHoldNSec = 0;
+	}
+} ;
+
+
+
+
+
+/** The stats of all the names used so far. The mutex and the map are never destroyed, because the CSes may be used
+by other static objects' destructors. The stats objects are never freed for the same reason. */
+static std::mutex & GetStatsMutex(void)
+{
+	static std::mutex * Mutex = new std::mutex;
+	return *Mutex;
+}
+
+static std::map<AString, cCriticalSection::sStats *> & GetAllStats(void)
+{
+	static std::map<AString, cCriticalSection::sStats *> * AllStats = new std::map<AString, cCriticalSection::sStats *>;
+	return *AllStats;
+}
+
+
+
+
+
+/** Raises a_Max to a_Value, if a_Value is larger. */
+static void UpdateMax(std::atomic<Int64> & a_Max, Int64 a_Value)
+{
+	Int64 Current = a_Max;
+	while ((a_Value > Current) && !a_Max.compare_exchange_weak(Current, a_Value))
+	{
+		// Current has been updated by compare_exchange_weak(), retry
+	}
+}
+
+#endif  // ENABLE_LOCK_STATS
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cCriticalSection:
 
-#ifdef _DEBUG
-cCriticalSection::cCriticalSection()
+cCriticalSection::cCriticalSection() :
+	m_Name(nullptr),
+	m_OwnerID(std::thread::id()),
+	m_LockDepth(0)
 {
-	m_IsLocked = 0;
+	#ifdef _DEBUG
+		m_IsLocked = 0;
+	#endif  // _DEBUG
+	#ifdef ENABLE_LOCK_STATS
+		m_Stats = nullptr;
+	#endif  // ENABLE_LOCK_STATS
+}
+
+
+
+
+
+cCriticalSection::~cCriticalSection()
+{
+	if (m_Name != nullptr)
+	{
+		std::lock_guard<std::mutex> Lock(GetNamedMutex());
+		GetNamedCSes().erase(this);
+	}
 }
-#endif  // _DEBUG
 
 
 
@@ -22,7 +127,36 @@ cCriticalSection::cCriticalSection()
 
 void cCriticalSection::Lock()
 {
-	m_Mutex.lock();
+	#ifdef ENABLE_LOCK_STATS
+		if (m_Stats != nullptr)
+		{
+			if (!m_Mutex.try_lock())
+			{
+				auto WaitStart = std::chrono::steady_clock::now();
+				m_Mutex.lock();
+				Int64 WaitNSec = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - WaitStart).count();
+				m_Stats->m_NumContended += 1;
+				m_Stats->m_WaitNSec += WaitNSec;
+				UpdateMax(m_Stats->m_MaxWaitNSec, WaitNSec);
+			}
+			if (m_LockDepth == 0)
+			{
+				m_Stats->m_NumAcquisitions += 1;
+				m_LockStart = std::chrono::steady_clock::now();
+			}
+		}
+		else
+		{
+			m_Mutex.lock();
+		}
+	#else
+		m_Mutex.lock();
+	#endif  // else ENABLE_LOCK_STATS
+
+	if ((m_Name != nullptr) && (m_LockDepth++ == 0))
+	{
+		m_OwnerID.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	}
 	
 	#ifdef _DEBUG
 		m_IsLocked += 1;
@@ -41,6 +175,16 @@ void cCriticalSection::Unlock()
 		m_IsLocked -= 1;
 	#endif  // _DEBUG
 	
+	if ((m_Name != nullptr) && (--m_LockDepth == 0))
+	{
+		m_OwnerID.store(std::thread::id(), std::memory_order_relaxed);
+		#ifdef ENABLE_LOCK_STATS
+			Int64 HoldNSec = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_LockStart).count();
+			m_Stats->m_HoldNSec += HoldNSec;
+			UpdateMax(m_Stats->m_MaxHoldNSec, HoldNSec);
+		#endif  // ENABLE_LOCK_STATS
+	}
+
 	m_Mutex.unlock();
 }
 
@@ -48,6 +192,135 @@ void cCriticalSection::Unlock()
 
 
 
+void cCriticalSection::SetName(const char * a_Name)
+{
+	// Naming a CS that is currently held would mismatch its lock depth:
+	ASSERT(m_LockDepth == 0);
+	ASSERT(a_Name != nullptr);
+
+	{
+		std::lock_guard<std::mutex> Lock(GetNamedMutex());
+		m_Name = a_Name;
+		GetNamedCSes().insert(this);
+	}
+
+	#ifdef ENABLE_LOCK_STATS
+		std::lock_guard<std::mutex> Lock(GetStatsMutex());
+		auto & AllStats = GetAllStats();
+		auto itr = AllStats.find(a_Name);
+		if (itr == AllStats.end())
+		{
+			itr = AllStats.insert(std::make_pair(AString(a_Name), new sStats(a_Name))).first;
+		}
+		m_Stats = itr->second;
+	#endif  // ENABLE_LOCK_STATS
+}
+
+
+
+
+
+void cCriticalSection::GetOwnersReport(AStringVector & a_Lines)
+{
+	std::lock_guard<std::mutex> Lock(GetNamedMutex());
+	for (const auto CS: GetNamedCSes())
+	{
+		std::thread::id Owner = CS->m_OwnerID.load(std::memory_order_relaxed);
+		if (Owner != std::thread::id())
+		{
+			// Same thread ID as cSamplingProfiler::GetThreadID(), not called directly so that this file has no dependencies:
+			a_Lines.push_back(Printf("  %s (%p) is held by thread ID %llx",
+				CS->m_Name, static_cast<void *>(CS), static_cast<unsigned long long>(std::hash<std::thread::id>()(Owner))
+			));
+		}
+	}
+}
+
+
+
+
+
+#ifdef ENABLE_LOCK_STATS
+
+
+
+
+
+void cCriticalSection::GetStatsReport(AStringVector & a_Lines)
+{
+	/** A snapshot of the stats of a single name. */
+	struct sSnapshot
+	{
+		const char * m_Name;
+		Int64 m_NumAcquisitions, m_NumContended, m_WaitNSec, m_MaxWaitNSec, m_HoldNSec, m_MaxHoldNSec;
+	} ;
+	std::vector<sSnapshot> Snapshots;
+	{
+		std::lock_guard<std::mutex> Lock(GetStatsMutex());
+		for (const auto & Stats: GetAllStats())
+		{
+			const sStats & s = *Stats.second;
+			Snapshots.push_back({s.m_Name, s.m_NumAcquisitions, s.m_NumContended, s.m_WaitNSec, s.m_MaxWaitNSec, s.m_HoldNSec, s.m_MaxHoldNSec});
+		}
+	}
+	std::sort(Snapshots.begin(), Snapshots.end(), [](const sSnapshot & a_First, const sSnapshot & a_Second)
+		{
+			return (a_First.m_WaitNSec > a_Second.m_WaitNSec);
+		}
+	);
+
+	a_Lines.push_back(Printf("  %-40s %12s %9s %12s %10s %10s %10s",
+		"Lock", "acquired", "contended", "wait total", "wait max", "hold avg", "hold max"
+	));
+	a_Lines.push_back(Printf("  %-40s %12s %9s %12s %10s %10s %10s",
+		"", "", "%", "msec", "msec", "usec", "msec"
+	));
+	for (const auto & s: Snapshots)
+	{
+		double Contended = (s.m_NumAcquisitions > 0) ? (100.0 * s.m_NumContended / s.m_NumAcquisitions) : 0;
+		double HoldAvg = (s.m_NumAcquisitions > 0) ? (static_cast<double>(s.m_HoldNSec) / s.m_NumAcquisitions / 1000) : 0;
+		a_Lines.push_back(Printf("  %-40s %12lld %9.2f %12.3f %10.3f %10.3f %10.3f",
+			s.m_Name, static_cast<long long>(s.m_NumAcquisitions), Contended,
+			static_cast<double>(s.m_WaitNSec) / 1000000, static_cast<double>(s.m_MaxWaitNSec) / 1000000,
+			HoldAvg, static_cast<double>(s.m_MaxHoldNSec) / 1000000
+		));
+	}
+}
+
+
+
+
+
+void cCriticalSection::ResetStats(void)
+{
+	std::lock_guard<std::mutex> Lock(GetStatsMutex());
+	for (const auto & Stats: GetAllStats())
+	{
+		Stats.second->Reset();
+	}
+}
+
+#else  // ENABLE_LOCK_STATS
+
+void cCriticalSection::GetStatsReport(AStringVector & a_Lines)
+{
+	a_Lines.push_back("  The lock stats are not available, the server needs to be built with LOCK_STATS enabled (cmake -DLOCK_STATS=1)");
+}
+
+
+
+
+
+void cCriticalSection::ResetStats(void)
+{
+}
+
+#endif  // else ENABLE_LOCK_STATS
+
+
+
+
+
 #ifdef _DEBUG
 bool cCriticalSection::IsLocked(void)
 {
@@ -2,6 +2,11 @@
 #pragma once
 #include <mutex>
 #include <thread>
+#include <atomic>
+
+#ifdef ENABLE_LOCK_STATS
+	#include <chrono>
+#endif
 
 
 
@@ -13,10 +18,31 @@ public:
 	void Lock(void);
 	void Unlock(void);
 	
+	cCriticalSection(void);
+	~cCriticalSection();
+
+	/** Names the CS. The named CSes track their owning thread, reported by GetOwnersReport(), and are measured for the lock stats,
+	where all the CSes with the same name share their stats. a_Name must have static storage duration (a string literal). */
+	void SetName(const char * a_Name);
+
+	/** Appends a line for each named CS that is currently held, with the ID of its owning thread, to a_Lines.
+	The thread IDs are the same as in cSamplingProfiler::DumpStacks(). */
+	static void GetOwnersReport(AStringVector & a_Lines);
+
+	/** Appends the human-readable report of the lock stats to a_Lines, the locks with the largest total wait time first. */
+	static void GetStatsReport(AStringVector & a_Lines);
+
+	/** Resets the lock stats of all the named CSes. */
+	static void ResetStats(void);
+
+	#ifdef ENABLE_LOCK_STATS
+		/** The stats shared by all the CSes of the same name. */
+		struct sStats;
+	#endif
+
 	// IsLocked / IsLockedByCurrentThread are only used in ASSERT statements, but because of the changes with ASSERT they must always be defined
 	// The fake versions (in Release) will not effect the program in any way
 	#ifdef _DEBUG
-		cCriticalSection(void);
 		bool IsLocked(void);
 		bool IsLockedByCurrentThread(void);
 	#else
@@ -31,6 +57,23 @@ private:
 	std::thread::id m_OwningThreadID;
 	#endif  // _DEBUG
 	
+	/** The name of the CS, nullptr if not named; see SetName(). */
+	const char * m_Name;
+
+	/** The thread holding the CS; only tracked for the named CSes. Read without holding the CS by GetOwnersReport(). */
+	std::atomic<std::thread::id> m_OwnerID;
+
+	/** Number of times the CS is locked by its owning thread; only tracked for the named CSes. Only accessed while holding m_Mutex. */
+	int m_LockDepth;
+
+	#ifdef ENABLE_LOCK_STATS
+	/** The stats of this CS, nullptr if the CS has no name. */
+	sStats * m_Stats;
+
+	/** The time when the owning thread acquired the CS. Only accessed while holding m_Mutex. */
+	std::chrono::steady_clock::time_point m_LockStart;
+	#endif  // ENABLE_LOCK_STATS
+
 	std::recursive_mutex m_Mutex;
 } ALIGN_8;
 
@@ -9,6 +9,10 @@
 #include <fstream>
 #ifdef _WIN32
 	#include <share.h>  // for _SH_DENYWRITE
+	#include <io.h>     // for _chsize()
+#else
+	#include <fcntl.h>  // for posix_fadvise() / F_RDADVISE
+	#include <unistd.h>  // for ftruncate()
 #endif  // _WIN32
 
 
@@ -217,6 +221,56 @@ int cFile::Tell (void) const
 
 
 
+bool cFile::Prefetch(int a_Offset, int a_NumBytes)
+{
+	ASSERT(IsOpen());
+	
+	if (!IsOpen() || (a_Offset < 0) || (a_NumBytes <= 0))
+	{
+		return false;
+	}
+	
+	#if defined(__linux__)
+		return (posix_fadvise(fileno(m_File), a_Offset, a_NumBytes, POSIX_FADV_WILLNEED) == 0);
+	#elif defined(__APPLE__)
+		radvisory Advisory;
+		Advisory.ra_offset = a_Offset;
+		Advisory.ra_count = a_NumBytes;
+		return (fcntl(fileno(m_File), F_RDADVISE, &Advisory) != -1);
+	#else
+		return false;
+	#endif
+}
+
+
+
+
+
+bool cFile::Truncate(int a_Size)
+{
+	ASSERT(IsOpen());
+	
+	if (!IsOpen() || (a_Size < 0))
+	{
+		return false;
+	}
+	
+	// Write out the buffered data first, it might otherwise get written past the new end later on:
+	if (fflush(m_File) != 0)
+	{
+		return false;
+	}
+	#ifdef _WIN32
+		return (_chsize(_fileno(m_File), a_Size) == 0);
+	#else
+		return (ftruncate(fileno(m_File), a_Size) == 0);
+	#endif
+}
+
+
+
+
+
 int cFile::GetSize(void) const
 {
 	ASSERT(IsOpen());
@@ -95,6 +95,14 @@ public:
 	/** Returns the size of file, in bytes, or -1 for failure; asserts if not open */
 	int GetSize(void) const;
 	
+	/** Hints the OS that the specified part of the file is going to be read soon, so that it can start reading it
+	into its cache in the background. Doesn't wait for the read. Returns false if the hint couldn't be given
+	(such as on platforms that don't support it); asserts if not open */
+	bool Prefetch(int a_Offset, int a_NumBytes);
+	
+	/** Truncates the file to the specified size, in bytes. Returns true on success; asserts if not open */
+	bool Truncate(int a_Size);
+	
 	/** Reads the file from current position till EOF into an AString; returns the number of bytes read or -1 for error */
 	int ReadRestOfFile(AString & a_Contents);
 	
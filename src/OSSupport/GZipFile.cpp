@@ -88,6 +88,27 @@ int cGZipFile::ReadRestOfFile(AString & a_Contents)
 
 
 
+int cGZipFile::Read(void * a_Buffer, int a_Size)
+{
+	if (m_File == nullptr)
+	{
+		ASSERT(!"No file has been opened");
+		return -1;
+	}
+	
+	if (m_Mode != fmRead)
+	{
+		ASSERT(!"Bad file mode, cannot read");
+		return -1;
+	}
+	
+	return gzread(m_File, a_Buffer, static_cast<unsigned int>(a_Size));
+}
+
+
+
+
+
 bool cGZipFile::Write(const char * a_Contents, int a_Size)
 {
 	if (m_File == nullptr)
@@ -36,6 +36,9 @@ public:
 	/// Reads the rest of the file and decompresses it into a_Contents. Returns the number of decompressed bytes, <0 for error
 	int ReadRestOfFile(AString & a_Contents);
 	
+	/// Reads and decompresses up to a_Size bytes into a_Buffer. Returns the number of bytes read (0 at the end of the file), <0 for error
+	int Read(void * a_Buffer, int a_Size);
+	
 	/// Writes a_Contents into file, compressing it along the way. Returns true if successful. Multiple writes are supported.
 	bool Write(const AString & a_Contents) { return Write(a_Contents.data(), (int)(a_Contents.size())); }
 	
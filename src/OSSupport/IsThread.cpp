@@ -6,6 +6,14 @@
 
 #include "Globals.h"
 #include "IsThread.h"
+#include "SamplingProfiler.h"
+
+#if defined(__linux__)
+	#include <sched.h>
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
 
 
 
@@ -45,12 +53,108 @@
 
 
 
+/** The kinds of the threads that can be scheduled, recognized by the beginning of the thread names. */
+static const struct
+{
+	const char * m_NamePrefix;  ///< The beginning of the names of the threads of the kind
+	const char * m_Kind;        ///< The kind, as used in the settings
+	const char * m_OSName;      ///< The short name given to the OS, followed by the rest of the thread name (the OSes limit the names to 15 chars)
+} g_ThreadKinds[] =
+{
+	{"WorldTickThread",          "WorldTick",   "Tick"},
+	{"ServerTickThread",         "ServerTick",  "ServerTick"},
+	{"cChunkGenerator::cWorker", "Generator",   "Generator"},
+	{"Pregenerator",             "Generator",   "Pregen"},
+	{"cLightingThread::cWorker", "Lighting",    "Lighting"},
+	{"cWorldStorage",            "Storage",     "Storage"},
+	{"ChunkSender",              "ChunkSender", "ChunkSender"},
+	{"ThreadPool worker",        "ThreadPool",  "Pool"},
+} ;
+
+
+
+
+
+/** The scheduling of a single thread kind. */
+struct sKindScheduling
+{
+	AString m_CPUs;
+	int m_Nice;
+} ;
+
+
+
+
+
+/** Protects the map returned by GetKindSchedulings(). */
+static cCriticalSection & GetKindSchedulingsCS(void)
+{
+	static cCriticalSection CS;
+	return CS;
+}
+
+
+
+
+
+/** Returns the scheduling set for each thread kind, by SetKindScheduling(). */
+static std::map<AString, sKindScheduling> & GetKindSchedulings(void)
+{
+	static std::map<AString, sKindScheduling> Schedulings;
+	return Schedulings;
+}
+
+
+
+
+
+/** Parses the list of CPUs, such as "0,2,4-7", into a_CPUs. Returns false if the list is malformed. */
+static bool ParseCPUList(const AString & a_List, std::vector<int> & a_CPUs)
+{
+	AStringVector Items = StringSplitAndTrim(a_List, ",");
+	for (const auto & Item: Items)
+	{
+		if (Item.empty())
+		{
+			continue;
+		}
+		int First, Last;
+		AStringVector Range = StringSplitAndTrim(Item, "-");
+		if (Range.size() == 1)
+		{
+			if (!StringToInteger(Range[0], First))
+			{
+				return false;
+			}
+			Last = First;
+		}
+		else if ((Range.size() != 2) || !StringToInteger(Range[0], First) || !StringToInteger(Range[1], Last))
+		{
+			return false;
+		}
+		if ((First < 0) || (Last < First))
+		{
+			return false;
+		}
+		for (int CPU = First; CPU <= Last; CPU++)
+		{
+			a_CPUs.push_back(CPU);
+		}
+	}
+	return true;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cIsThread:
 
 cIsThread::cIsThread(const AString & a_ThreadName) :
 	m_ShouldTerminate(false),
-	m_ThreadName(a_ThreadName)
+	m_ThreadName(a_ThreadName),
+	m_HasOwnCPUs(false)
 {
 }
 
@@ -71,7 +175,168 @@ cIsThread::~cIsThread()
 void cIsThread::DoExecute(void)
 {
 	m_evtStart.Wait();
+	ApplyThreadSettings();
+	cSamplingProfiler::Get().RegisterCurrentThread(m_ThreadName);
 	Execute();
+	cSamplingProfiler::Get().UnregisterCurrentThread();
+}
+
+
+
+
+
+void cIsThread::ApplyThreadSettings(void)
+{
+	// Find the thread's kind:
+	const char * Kind = nullptr;
+	AString OSName = m_ThreadName;
+	for (const auto & ThreadKind: g_ThreadKinds)
+	{
+		size_t PrefixLength = strlen(ThreadKind.m_NamePrefix);
+		if (m_ThreadName.compare(0, PrefixLength, ThreadKind.m_NamePrefix) == 0)
+		{
+			Kind = ThreadKind.m_Kind;
+			AString Rest = TrimString(m_ThreadName.substr(PrefixLength));
+			if (!Rest.empty() && (Rest[0] == ':'))
+			{
+				Rest = TrimString(Rest.substr(1));
+			}
+			OSName = Rest.empty() ? AString(ThreadKind.m_OSName) : Printf("%s %s", ThreadKind.m_OSName, Rest.c_str());
+			break;
+		}
+	}
+
+	// Name the thread for the OS, the OSes limit the name to 15 characters:
+	OSName.resize(std::min<size_t>(OSName.size(), 15));
+	#if defined(__linux__)
+		pthread_setname_np(pthread_self(), OSName.c_str());
+	#elif defined(__APPLE__)
+		pthread_setname_np(OSName.c_str());
+	#endif
+
+	// Get the scheduling:
+	sKindScheduling Scheduling;
+	Scheduling.m_Nice = 0;
+	if (Kind != nullptr)
+	{
+		cCSLock Lock(GetKindSchedulingsCS());
+		auto itr = GetKindSchedulings().find(Kind);
+		if (itr != GetKindSchedulings().end())
+		{
+			Scheduling = itr->second;
+		}
+	}
+	if (m_HasOwnCPUs)
+	{
+		Scheduling.m_CPUs = m_CPUs;
+	}
+
+	// Pin the thread to the CPUs:
+	if (!Scheduling.m_CPUs.empty())
+	{
+		std::vector<int> CPUs;
+		if (!ParseCPUList(Scheduling.m_CPUs, CPUs))
+		{
+			LOGWARNING("Thread %s: Invalid list of CPUs: \"%s\". The thread is not pinned.", m_ThreadName.c_str(), Scheduling.m_CPUs.c_str());
+		}
+		else
+		{
+			#if defined(__linux__)
+				cpu_set_t Set;
+				CPU_ZERO(&Set);
+				for (auto CPU: CPUs)
+				{
+					if (CPU < CPU_SETSIZE)
+					{
+						CPU_SET(CPU, &Set);
+					}
+				}
+				int res = pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set);
+				if (res != 0)
+				{
+					LOGWARNING("Thread %s: Cannot pin to CPUs \"%s\": %d", m_ThreadName.c_str(), Scheduling.m_CPUs.c_str(), res);
+				}
+			#elif defined(_WIN32)
+				DWORD_PTR Mask = 0;
+				for (auto CPU: CPUs)
+				{
+					if (CPU < static_cast<int>(sizeof(Mask) * 8))
+					{
+						Mask |= static_cast<DWORD_PTR>(1) << CPU;
+					}
+				}
+				if (SetThreadAffinityMask(GetCurrentThread(), Mask) == 0)
+				{
+					LOGWARNING("Thread %s: Cannot pin to CPUs \"%s\": %u", m_ThreadName.c_str(), Scheduling.m_CPUs.c_str(), GetLastError());
+				}
+			#else
+				LOGWARNING("Thread %s: Pinning threads to CPUs is not supported on this OS.", m_ThreadName.c_str());
+			#endif
+		}
+	}
+
+	// Set the priority:
+	if (Scheduling.m_Nice != 0)
+	{
+		#if defined(__linux__)
+			// On Linux, the niceness is per thread, when set on the thread ID:
+			int TID = static_cast<int>(syscall(SYS_gettid));
+			if (setpriority(PRIO_PROCESS, static_cast<id_t>(TID), getpriority(PRIO_PROCESS, 0) + Scheduling.m_Nice) != 0)
+			{
+				LOGWARNING("Thread %s: Cannot change the niceness by %d: %d", m_ThreadName.c_str(), Scheduling.m_Nice, errno);
+			}
+		#elif defined(_WIN32)
+			int Priority = THREAD_PRIORITY_NORMAL;
+			if (Scheduling.m_Nice >= 10)
+			{
+				Priority = THREAD_PRIORITY_LOWEST;
+			}
+			else if (Scheduling.m_Nice > 0)
+			{
+				Priority = THREAD_PRIORITY_BELOW_NORMAL;
+			}
+			else if (Scheduling.m_Nice <= -10)
+			{
+				Priority = THREAD_PRIORITY_HIGHEST;
+			}
+			else
+			{
+				Priority = THREAD_PRIORITY_ABOVE_NORMAL;
+			}
+			SetThreadPriority(GetCurrentThread(), Priority);
+		#else
+			LOGWARNING("Thread %s: Changing the thread priority is not supported on this OS.", m_ThreadName.c_str());
+		#endif
+	}
+}
+
+
+
+
+
+AStringVector cIsThread::GetSchedulingKinds(void)
+{
+	AStringVector res;
+	for (const auto & ThreadKind: g_ThreadKinds)
+	{
+		if (std::find(res.begin(), res.end(), ThreadKind.m_Kind) == res.end())
+		{
+			res.push_back(ThreadKind.m_Kind);
+		}
+	}
+	return res;
+}
+
+
+
+
+
+void cIsThread::SetKindScheduling(const AString & a_Kind, const AString & a_CPUs, int a_Nice)
+{
+	cCSLock Lock(GetKindSchedulingsCS());
+	sKindScheduling & Scheduling = GetKindSchedulings()[a_Kind];
+	Scheduling.m_CPUs = a_CPUs;
+	Scheduling.m_Nice = a_Nice;
 }
 
 
@@ -17,6 +17,8 @@ In the descending class' constructor call the Start() method to start the thread
 
 #pragma once
 #include <thread>
+#include "CriticalSection.h"
+#include "Event.h"
 
 
 
@@ -36,6 +38,10 @@ private:
 	/** Wrapper for Execute() that waits for the initialization event, to prevent race conditions in thread initialization. */
 	void DoExecute(void);
 
+	/** Names the calling thread for the OS (so that the profilers and debuggers show it) and applies its scheduling settings.
+	Called in the new thread, before Execute(). */
+	void ApplyThreadSettings(void);
+
 public:
 	cIsThread(const AString & a_ThreadName);
 	virtual ~cIsThread();
@@ -52,10 +58,26 @@ public:
 	/** Returns true if the thread calling this function is the thread contained within this object. */
 	bool IsCurrentThread(void) const { return std::this_thread::get_id() == m_Thread.get_id(); }
 
+	/** Overrides the CPUs that the thread is pinned to, instead of those set for its kind by SetKindScheduling().
+	a_CPUs is a list such as "2,3" or "4-7"; empty to not pin the thread. Must be called before Start(). */
+	void SetCPUs(const AString & a_CPUs) { m_CPUs = a_CPUs; m_HasOwnCPUs = true; }
+
+	/** Returns the kinds of the threads that can be scheduled by SetKindScheduling(), such as "WorldTick" or "Generator". */
+	static AStringVector GetSchedulingKinds(void);
+
+	/** Sets the scheduling of the threads of the specified kind that are started from now on.
+	a_CPUs is the list of CPUs to pin the threads to, such as "2,3" or "4-7"; empty to not pin them.
+	a_Nice is the niceness of the threads, relative to the process: positive lowers their priority, 0 keeps it. */
+	static void SetKindScheduling(const AString & a_Kind, const AString & a_CPUs, int a_Nice);
+
 protected:
 	AString m_ThreadName;
 	std::thread m_Thread;
 
+	/** The CPUs set by SetCPUs(), used instead of the kind's ones if m_HasOwnCPUs is true. */
+	AString m_CPUs;
+	bool m_HasOwnCPUs;
+
 	/** The event that is used to wait with the thread's execution until the thread object is fully initialized.
 	This prevents the IsCurrentThread() call to fail because of a race-condition. */
 	cEvent m_evtStart;
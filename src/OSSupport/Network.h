@@ -54,6 +54,9 @@ public:
 	};
 	typedef SharedPtr<cCallbacks> cCallbacksPtr;
 
+	/** The callback that SendOwned() calls once the data has been written into the OS's TCP stack. */
+	typedef std::function<void(void)> cDataWrittenCallback;
+
 
 	// Force a virtual destructor for all descendants:
 	virtual ~cTCPLink() {}
@@ -69,6 +72,34 @@ public:
 		return Send(a_Data.data(), a_Data.size());
 	}
 
+	/** Queues the specified data for sending to the remote peer, taking over the string instead of copying its contents.
+	a_Data is left empty. Useful for large buffers that the caller has no further use for.
+	Returns true on success, false on failure. Note that this success or failure only reports the queue status, not the actual data delivery. */
+	virtual bool SendOwned(AString && a_Data)
+	{
+		AString Data;
+		std::swap(Data, a_Data);
+		return Send(Data.data(), Data.size());
+	}
+
+	/** Queues the specified data for sending to the remote peer, taking over the string, same as SendOwned() above.
+	a_OnWritten is called, from any thread, once the data has been written into the OS's TCP stack (or dropped with the link);
+	it is not called if the data couldn't be queued.
+	Returns true on success, false on failure. Note that this success or failure only reports the queue status, not the actual data delivery. */
+	virtual bool SendOwned(AString && a_Data, cDataWrittenCallback a_OnWritten)
+	{
+		// The generic implementation cannot tell when the data is written out, report it as soon as it's queued:
+		if (!SendOwned(std::move(a_Data)))
+		{
+			return false;
+		}
+		if (a_OnWritten != nullptr)
+		{
+			a_OnWritten();
+		}
+		return true;
+	}
+
 	/** Returns the IP address of the local endpoint of the connection. */
 	virtual AString GetLocalIP(void) const = 0;
 
@@ -321,6 +352,12 @@ public:
 
 	/** Returns all local IP addresses for network interfaces currently available. */
 	static AStringVector EnumLocalIPAddresses(void);
+
+	/** Sets the number of event loops, each running in its own thread, that TCP links are distributed over (round-robin).
+	One slow link then delays only the links sharing its loop. Listening sockets, UDP endpoints and lookups stay in the main loop.
+	Should be called on startup, before any links are created; the number can only grow.
+	Implemented in NetworkSingleton.cpp. */
+	static void SetNumLinkEventLoops(int a_NumLoops);
 };
 
 
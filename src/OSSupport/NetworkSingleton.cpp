@@ -19,7 +19,8 @@
 
 
 cNetworkSingleton::cNetworkSingleton(void):
-	m_HasTerminated(false)
+	m_HasTerminated(false),
+	m_NextLinkEventBase(0)
 {
 	// Windows: initialize networking:
 	#ifdef _WIN32
@@ -95,9 +96,17 @@ void cNetworkSingleton::Terminate(void)
 	ASSERT(!m_HasTerminated);
 	m_HasTerminated = true;
 
-	// Wait for the LibEvent event loop to terminate:
+	// Wait for the LibEvent event loops to terminate:
 	event_base_loopbreak(m_EventBase);
 	m_EventLoopThread.join();
+	for (auto EventBase: m_LinkEventBases)
+	{
+		event_base_loopbreak(EventBase);
+	}
+	for (auto & Thread: m_LinkEventLoopThreads)
+	{
+		Thread.join();
+	}
 
 	// Remove all objects:
 	{
@@ -110,6 +119,12 @@ void cNetworkSingleton::Terminate(void)
 
 	// Free the underlying LibEvent objects:
 	evdns_base_free(m_DNSBase, true);
+	for (auto EventBase: m_LinkEventBases)
+	{
+		event_base_free(EventBase);
+	}
+	m_LinkEventBases.clear();
+	m_LinkEventLoopThreads.clear();
 	event_base_free(m_EventBase);
 
 	libevent_global_shutdown();
@@ -119,6 +134,43 @@ void cNetworkSingleton::Terminate(void)
 
 
 
+event_base * cNetworkSingleton::GetLinkEventBase(void)
+{
+	cCSLock Lock(m_CS);
+	if (m_LinkEventBases.empty())
+	{
+		return m_EventBase;
+	}
+	size_t Idx = m_NextLinkEventBase;
+	m_NextLinkEventBase = (m_NextLinkEventBase + 1) % (m_LinkEventBases.size() + 1);
+	return (Idx == 0) ? m_EventBase : m_LinkEventBases[Idx - 1];
+}
+
+
+
+
+
+void cNetworkSingleton::SetNumLinkEventLoops(int a_NumLoops)
+{
+	ASSERT(!m_HasTerminated);
+	cCSLock Lock(m_CS);
+	while (static_cast<int>(m_LinkEventBases.size()) + 1 < a_NumLoops)
+	{
+		event_base * EventBase = event_base_new();
+		if (EventBase == nullptr)
+		{
+			LOGWARNING("Failed to create an additional network event loop, using %u loops only.", static_cast<unsigned>(m_LinkEventBases.size() + 1));
+			return;
+		}
+		m_LinkEventBases.push_back(EventBase);
+		m_LinkEventLoopThreads.push_back(std::thread(RunLinkEventLoop, EventBase));
+	}
+}
+
+
+
+
+
 void cNetworkSingleton::LogCallback(int a_Severity, const char * a_Msg)
 {
 	switch (a_Severity)
@@ -148,6 +200,15 @@ void cNetworkSingleton::RunEventLoop(cNetworkSingleton * a_Self)
 
 
 
+void cNetworkSingleton::RunLinkEventLoop(event_base * a_EventBase)
+{
+	event_base_loop(a_EventBase, EVLOOP_NO_EXIT_ON_EMPTY);
+}
+
+
+
+
+
 void cNetworkSingleton::AddHostnameLookup(cHostnameLookupPtr a_HostnameLookup)
 {
 	ASSERT(!m_HasTerminated);
@@ -263,3 +324,15 @@ void cNetworkSingleton::RemoveServer(const cServerHandleImpl * a_Server)
 
 
 
+
+////////////////////////////////////////////////////////////////////////////////
+// cNetwork API:
+
+void cNetwork::SetNumLinkEventLoops(int a_NumLoops)
+{
+	cNetworkSingleton::Get().SetNumLinkEventLoops(a_NumLoops);
+}
+
+
+
+
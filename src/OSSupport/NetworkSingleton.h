@@ -57,6 +57,15 @@ public:
 	/** Returns the main LibEvent handle for event registering. */
 	event_base * GetEventBase(void) { return m_EventBase; }
 
+	/** Returns the LibEvent handle that a new TCP link should register its events with.
+	The links are distributed round-robin among the main event loop and the additional link event loops. */
+	event_base * GetLinkEventBase(void);
+
+	/** Sets the total number of event loops, including the main one, that TCP links are distributed over.
+	Each additional loop runs in its own thread. The number of loops can only grow, existing loops are kept.
+	Should be called on startup, before any links are created. */
+	void SetNumLinkEventLoops(int a_NumLoops);
+
 	/** Returns the LibEvent handle for DNS lookups. */
 	evdns_base * GetDNSBase(void) { return m_DNSBase; }
 
@@ -122,6 +131,18 @@ protected:
 	/** The thread in which the main LibEvent loop runs. */
 	std::thread m_EventLoopThread;
 
+	/** The additional LibEvent containers that TCP links are distributed over, besides m_EventBase.
+	Protected by m_CS. */
+	std::vector<event_base *> m_LinkEventBases;
+
+	/** The threads in which the additional link event loops run, one per item in m_LinkEventBases.
+	Protected by m_CS. */
+	std::vector<std::thread> m_LinkEventLoopThreads;
+
+	/** Index of the event loop to which the next TCP link will be assigned by GetLinkEventBase().
+	Index 0 is the main loop, index N is m_LinkEventBases[N - 1]. Protected by m_CS. */
+	size_t m_NextLinkEventBase;
+
 
 	/** Initializes the LibEvent internals. */
 	cNetworkSingleton(void);
@@ -131,6 +152,9 @@ protected:
 
 	/** Implements the thread that runs LibEvent's event dispatcher loop. */
 	static void RunEventLoop(cNetworkSingleton * a_Self);
+
+	/** Implements the threads that run the additional link event loops. */
+	static void RunLinkEventLoop(event_base * a_EventBase);
 };
 
 
@@ -17,6 +17,10 @@ modify the behavior of the queue when deleting items and when adding items
 that are already in the queue by providing a second parameter, a class that
 implements the functions Delete() and Combine(). An example is given in
 cQueueFuncs and is used as the default behavior.
+
+cRingQueue is a bounded variant with the same interface, storing the items in a preallocated
+ring buffer, so that enqueueing doesn't allocate. EnqueueItem() blocks while the queue is full,
+TryEnqueueItem() fails instead.
 */
 
 /// This empty struct allows for the callback functions to be inlined
@@ -203,3 +207,256 @@ private:
 
 
 
+
+template <class ItemType, class Funcs = cQueueFuncs<ItemType> >
+class cRingQueue
+{
+public:
+	/** Creates a queue that can hold at most a_Capacity items. */
+	cRingQueue(size_t a_Capacity) :
+		m_Storage(new sSlot[a_Capacity]),
+		m_Capacity(a_Capacity),
+		m_Head(0),
+		m_Count(0)
+	{
+		ASSERT(a_Capacity > 0);
+	}
+
+	~cRingQueue()
+	{
+		cCSLock Lock(m_CS);
+		while (m_Count > 0)
+		{
+			PopFront();
+		}
+	}
+
+
+	/** Enqueues an item to the queue, blocking while the queue is full. */
+	void EnqueueItem(ItemType a_Item)
+	{
+		cCSLock Lock(m_CS);
+		while (m_Count >= m_Capacity)
+		{
+			cCSUnlock Unlock(Lock);
+			m_evtRemoved.Wait();
+		}
+		PushBack(std::move(a_Item));
+		m_evtAdded.Set();
+	}
+
+
+	/** Enqueues an item to the queue if there's room for it.
+	Returns true if successful, false if the queue is full. */
+	bool TryEnqueueItem(ItemType a_Item)
+	{
+		cCSLock Lock(m_CS);
+		if (m_Count >= m_Capacity)
+		{
+			return false;
+		}
+		PushBack(std::move(a_Item));
+		m_evtAdded.Set();
+		return true;
+	}
+
+
+	/** Enqueues an item in the queue if not already present (as determined by operator ==).
+	Doesn't block; returns false if the item is not present and the queue is full. */
+	bool EnqueueItemIfNotPresent(ItemType a_Item)
+	{
+		cCSLock Lock(m_CS);
+		for (size_t i = 0; i < m_Count; i++)
+		{
+			if (At(i) == a_Item)
+			{
+				Funcs::Combine(At(i), a_Item);
+				return true;
+			}
+		}
+		if (m_Count >= m_Capacity)
+		{
+			return false;
+		}
+		PushBack(std::move(a_Item));
+		m_evtAdded.Set();
+		return true;
+	}
+
+
+	/** Dequeues an item from the queue if any are present.
+	Returns true if successful. Value of item is undefined if dequeuing was unsuccessful. */
+	bool TryDequeueItem(ItemType & item)
+	{
+		cCSLock Lock(m_CS);
+		if (m_Count == 0)
+		{
+			return false;
+		}
+		item = std::move(At(0));
+		PopFront();
+		m_evtRemoved.Set();
+		return true;
+	}
+
+
+	/** Dequeues an item from the queue, blocking until an item is available. */
+	ItemType DequeueItem(void)
+	{
+		cCSLock Lock(m_CS);
+		while (m_Count == 0)
+		{
+			cCSUnlock Unlock(Lock);
+			m_evtAdded.Wait();
+		}
+		ItemType item(std::move(At(0)));
+		PopFront();
+		m_evtRemoved.Set();
+		return item;
+	}
+
+
+	/** Blocks until the queue is empty. */
+	void BlockTillEmpty(void)
+	{
+		cCSLock Lock(m_CS);
+		while (m_Count > 0)
+		{
+			cCSUnlock Unlock(Lock);
+			m_evtRemoved.Wait();
+		}
+	}
+
+
+	/** Removes all Items from the Queue, calling Delete on each of them. */
+	void Clear(void)
+	{
+		cCSLock Lock(m_CS);
+		while (m_Count > 0)
+		{
+			Funcs::Delete(At(0));
+			PopFront();
+		}
+		m_evtRemoved.Set();
+	}
+
+
+	/** Returns the size at time of being called.
+	Do not use to determine whether to call DequeueItem(), use TryDequeueItem() instead */
+	size_t Size(void)
+	{
+		cCSLock Lock(m_CS);
+		return m_Count;
+	}
+
+
+	/** Returns the maximum number of items the queue can hold. */
+	size_t GetCapacity(void) const { return m_Capacity; }
+
+
+	/** Removes the item from the queue. If there are multiple such items, only the first one is removed.
+	Returns true if the item has been removed, false if no such item found. */
+	bool Remove(ItemType a_Item)
+	{
+		bool IsFirst = true;
+		bool HasRemoved = false;
+		RemoveIf([&](ItemType & a_QueuedItem)
+			{
+				if (IsFirst && (a_QueuedItem == a_Item))
+				{
+					IsFirst = false;
+					HasRemoved = true;
+					return true;
+				}
+				return false;
+			}
+		);
+		return HasRemoved;
+	}
+
+
+	/** Removes all items for which the predicate returns true. */
+	template <class Predicate>
+	void RemoveIf(Predicate a_Predicate)
+	{
+		cCSLock Lock(m_CS);
+
+		// Compact the kept items towards the head, then destroy the leftovers at the tail:
+		size_t NumKept = 0;
+		for (size_t i = 0; i < m_Count; i++)
+		{
+			if (a_Predicate(At(i)))
+			{
+				continue;
+			}
+			if (NumKept != i)
+			{
+				At(NumKept) = std::move(At(i));
+			}
+			NumKept += 1;
+		}
+		if (NumKept == m_Count)
+		{
+			return;
+		}
+		for (size_t i = NumKept; i < m_Count; i++)
+		{
+			At(i).~ItemType();
+		}
+		m_Count = NumKept;
+		m_evtRemoved.Set();
+	}
+
+private:
+	/** Uninitialized storage for a single item; the items are constructed in place when enqueued. */
+	typedef typename std::aligned_storage<sizeof(ItemType), std::alignment_of<ItemType>::value>::type sSlot;
+
+	/** The ring buffer. The items are in m_Count slots starting at m_Head, wrapping around. */
+	std::unique_ptr<sSlot[]> m_Storage;
+
+	/** Number of slots in m_Storage. */
+	size_t m_Capacity;
+
+	/** Index of the slot holding the item at the front of the queue. */
+	size_t m_Head;
+
+	/** Number of the items in the queue. */
+	size_t m_Count;
+
+	/** Mutex that protects access to the queue contents */
+	cCriticalSection m_CS;
+
+	/** Event that is signalled when an item is added */
+	cEvent m_evtAdded;
+
+	/** Event that is signalled when an item is removed (both dequeued or erased) */
+	cEvent m_evtRemoved;
+
+
+	/** Returns the item at the specified position from the front of the queue. Assumes m_CS is locked. */
+	ItemType & At(size_t a_Idx)
+	{
+		return *reinterpret_cast<ItemType *>(&m_Storage[(m_Head + a_Idx) % m_Capacity]);
+	}
+
+	/** Constructs the item in the slot after the back of the queue. Assumes m_CS is locked and the queue isn't full. */
+	void PushBack(ItemType && a_Item)
+	{
+		ASSERT(m_Count < m_Capacity);
+		new (&m_Storage[(m_Head + m_Count) % m_Capacity]) ItemType(std::move(a_Item));
+		m_Count += 1;
+	}
+
+	/** Destroys the item at the front of the queue. Assumes m_CS is locked and the queue isn't empty. */
+	void PopFront(void)
+	{
+		ASSERT(m_Count > 0);
+		At(0).~ItemType();
+		m_Head = (m_Head + 1) % m_Capacity;
+		m_Count -= 1;
+	}
+};
+
+
+
+
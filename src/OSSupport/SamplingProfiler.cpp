@@ -0,0 +1,598 @@
+
+// SamplingProfiler.cpp
+
+// Implements the cSamplingProfiler class representing a timer-signal based sampling profiler of the server threads
+
+#include "Globals.h"
+#include "SamplingProfiler.h"
+#include "File.h"
+#include "Errors.h"
+
+#ifndef _WIN32
+	#include <signal.h>
+	#include <pthread.h>
+	#include <execinfo.h>
+	#include <cxxabi.h>
+#endif
+
+#ifdef _MSC_VER
+	// MSVC 2013 doesn't support thread_local, but it has an equivalent:
+	#define thread_local __declspec(thread)
+#endif
+
+
+
+
+
+/** How long the sampler waits for the sampled threads to capture their stacks, before giving up on them for this sample. */
+static const std::chrono::milliseconds SAMPLE_TIMEOUT(10);
+
+/** The number of frames at the top of each captured stack that belong to the signal handling itself. */
+static const int NUM_HANDLER_FRAMES = 2;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cSamplingProfiler::sThread:
+
+struct cSamplingProfiler::sThread
+{
+	/** The states of the sample exchange between the sampler thread and the signal handler. */
+	enum
+	{
+		stIdle,        ///< No sample requested
+		stRequested,   ///< The sampler has signalled the thread, the handler hasn't run yet
+		stFilling,     ///< The handler is capturing the sample
+		stFilled,      ///< The sample is ready to be picked up by the sampler
+	} ;
+
+	/** The name of the thread, as used in the folded stacks. */
+	AString m_Name;
+
+	/** The ID of the thread, see cSamplingProfiler::GetThreadID(). */
+	UInt64 m_ID;
+
+	/** The lowercased name of the thread, for the filter. */
+	AString m_LowerName;
+
+	#ifndef _WIN32
+		/** The handle used for signalling the thread. */
+		pthread_t m_Handle;
+	#endif
+
+	/** The state of the sample exchange, stXXX. */
+	std::atomic<int> m_State;
+
+	/** The Lua calls in progress in the thread, outermost first. Written only by the thread itself. */
+	char m_LuaFrames[MAX_LUA_FRAMES][LUA_FRAME_NAME_SIZE];
+
+	/** The nesting level of the Lua calls in progress, may be larger than MAX_LUA_FRAMES. Updated only by the thread itself. */
+	std::atomic<int> m_NumLuaFrames;
+
+	/** The native frames of the captured sample, innermost first. */
+	void * m_Frames[MAX_FRAMES];
+
+	/** The number of valid items in m_Frames. */
+	int m_NumFrames;
+
+	/** The Lua frames of the captured sample, outermost first. */
+	char m_SampledLuaFrames[MAX_LUA_FRAMES][LUA_FRAME_NAME_SIZE];
+
+	/** The number of valid items in m_SampledLuaFrames. */
+	int m_NumSampledLuaFrames;
+
+
+	sThread(const AString & a_Name) :
+		m_Name(a_Name),
+		m_ID(cSamplingProfiler::GetThreadID(std::this_thread::get_id())),
+		m_LowerName(StrToLower(a_Name)),
+		m_State(stIdle),
+		m_NumLuaFrames(0),
+		m_NumFrames(0),
+		m_NumSampledLuaFrames(0)
+	{
+		#ifndef _WIN32
+			m_Handle = pthread_self();
+		#endif
+	}
+} ;
+
+
+
+
+
+/** The slot of the current thread, nullptr if the thread isn't registered. */
+static thread_local cSamplingProfiler::sThread * t_CurrentThread = nullptr;
+
+std::atomic<bool> cSamplingProfiler::s_IsRunning(false);
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cSamplingProfiler::cLuaFrame:
+
+cSamplingProfiler::cLuaFrame::cLuaFrame(const AString & a_Name) :
+	m_IsPushed(false)
+{
+	sThread * Thread = t_CurrentThread;
+	if (!s_IsRunning || (Thread == nullptr))
+	{
+		return;
+	}
+	int Depth = Thread->m_NumLuaFrames;
+	if (Depth < MAX_LUA_FRAMES)
+	{
+		char * Dest = Thread->m_LuaFrames[Depth];
+		size_t Len = std::min(a_Name.size(), static_cast<size_t>(LUA_FRAME_NAME_SIZE - 1));
+		memcpy(Dest, a_Name.data(), Len);
+		Dest[Len] = 0;
+	}
+
+	// The signal handler runs in this very thread, so only the compiler needs to be kept from reordering the writes:
+	std::atomic_signal_fence(std::memory_order_release);
+	Thread->m_NumLuaFrames = Depth + 1;
+	m_IsPushed = true;
+}
+
+
+
+
+
+cSamplingProfiler::cLuaFrame::~cLuaFrame()
+{
+	if (m_IsPushed)
+	{
+		t_CurrentThread->m_NumLuaFrames -= 1;
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cSamplingProfiler:
+
+cSamplingProfiler::cSamplingProfiler(void) :
+	m_ShouldStop(false),
+	m_Interval(10000)
+{
+}
+
+
+
+
+
+cSamplingProfiler & cSamplingProfiler::Get(void)
+{
+	static cSamplingProfiler Instance;
+	return Instance;
+}
+
+
+
+
+
+void cSamplingProfiler::RegisterCurrentThread(const AString & a_Name)
+{
+	ASSERT(t_CurrentThread == nullptr);
+	sThreadPtr Thread = std::make_shared<sThread>(a_Name.empty() ? AString("unnamed thread") : a_Name);
+	cCSLock Lock(m_CSThreads);
+	m_Threads.push_back(Thread);
+	t_CurrentThread = Thread.get();
+}
+
+
+
+
+
+void cSamplingProfiler::UnregisterCurrentThread(void)
+{
+	// The sampler holds the lock while signalling, so once the thread is removed, it won't receive any more sampling signals:
+	cCSLock Lock(m_CSThreads);
+	for (auto itr = m_Threads.begin(), end = m_Threads.end(); itr != end; ++itr)
+	{
+		if (itr->get() == t_CurrentThread)
+		{
+			m_Threads.erase(itr);
+			break;
+		}
+	}
+	t_CurrentThread = nullptr;
+}
+
+
+
+
+
+#ifdef _WIN32
+
+bool cSamplingProfiler::Start(int a_Frequency, const AString & a_ThreadFilter, AString & a_Error)
+{
+	UNUSED(a_Frequency);
+	UNUSED(a_ThreadFilter);
+	a_Error = "The sampling profiler is not supported on this platform";
+	return false;
+}
+
+
+
+
+
+void cSamplingProfiler::SignalHandler(int a_Signal)
+{
+	UNUSED(a_Signal);
+}
+
+
+
+
+
+bool cSamplingProfiler::DumpStacks(AStringVector & a_Lines, AString & a_Error)
+{
+	UNUSED(a_Lines);
+	a_Error = "Capturing the thread stacks is not supported on this platform";
+	return false;
+}
+
+
+
+
+
+void cSamplingProfiler::TakeSample(void)
+{
+}
+
+#else  // _WIN32
+
+bool cSamplingProfiler::Start(int a_Frequency, const AString & a_ThreadFilter, AString & a_Error)
+{
+	if (s_IsRunning)
+	{
+		a_Error = "The sampling profiler is already running";
+		return false;
+	}
+	if ((a_Frequency < 1) || (a_Frequency > 1000))
+	{
+		a_Error = "The sampling frequency must be between 1 and 1000 Hz";
+		return false;
+	}
+
+	if (!InstallSignalHandler(a_Error))
+	{
+		return false;
+	}
+
+	m_Stacks.clear();
+	m_Interval = std::chrono::microseconds(1000000 / a_Frequency);
+	m_ThreadFilter = StrToLower(a_ThreadFilter);
+	m_ShouldStop = false;
+	s_IsRunning = true;
+	m_SamplerThread = std::thread(&cSamplingProfiler::SamplerThread, this);
+	return true;
+}
+
+
+
+
+
+bool cSamplingProfiler::DumpStacks(AStringVector & a_Lines, AString & a_Error)
+{
+	if (!InstallSignalHandler(a_Error))
+	{
+		return false;
+	}
+	std::vector<sSample> Samples;
+	CaptureStacks("", Samples);
+	for (const auto & Sample: Samples)
+	{
+		a_Lines.push_back(Printf("Thread \"%s\" (ID %llx):", Sample.m_ThreadName.c_str(), static_cast<unsigned long long>(Sample.m_ThreadID)));
+		for (const auto & Frame: Sample.m_Frames)
+		{
+			a_Lines.push_back(Printf("  %s", SymbolizeAddress(Frame).c_str()));
+		}
+		if (!Sample.m_LuaFrames.empty())
+		{
+			a_Lines.push_back("  Lua calls in progress, innermost first:");
+			for (auto itr = Sample.m_LuaFrames.rbegin(), end = Sample.m_LuaFrames.rend(); itr != end; ++itr)
+			{
+				a_Lines.push_back(Printf("  [lua] %s", itr->c_str()));
+			}
+		}
+	}
+	return true;
+}
+
+
+
+
+
+bool cSamplingProfiler::InstallSignalHandler(AString & a_Error)
+{
+	// The signal handler is never uninstalled, because a signal may still be pending when the profiler stops
+	// and the default action for SIGPROF is to terminate the process:
+	static std::mutex Mutex;
+	static bool IsHandlerInstalled = false;
+	std::lock_guard<std::mutex> Lock(Mutex);
+	if (IsHandlerInstalled)
+	{
+		return true;
+	}
+
+	// The first backtrace() call loads libgcc, which isn't safe to do inside the signal handler, so call it here in advance:
+	void * Dummy[1];
+	backtrace(Dummy, 1);
+
+	struct sigaction Action;
+	memset(&Action, 0, sizeof(Action));
+	Action.sa_handler = &SignalHandler;
+	Action.sa_flags = SA_RESTART;
+	sigemptyset(&Action.sa_mask);
+	if (sigaction(SIGPROF, &Action, nullptr) != 0)
+	{
+		a_Error = Printf("Cannot install the SIGPROF handler: %s", GetOSErrorString(errno).c_str());
+		return false;
+	}
+	IsHandlerInstalled = true;
+	return true;
+}
+
+
+
+
+
+void cSamplingProfiler::SignalHandler(int a_Signal)
+{
+	UNUSED(a_Signal);
+	int SavedErrno = errno;
+	sThread * Thread = t_CurrentThread;
+	int Expected = sThread::stRequested;
+	if ((Thread != nullptr) && Thread->m_State.compare_exchange_strong(Expected, sThread::stFilling))
+	{
+		Thread->m_NumFrames = backtrace(Thread->m_Frames, MAX_FRAMES);
+		int NumLuaFrames = std::min(static_cast<int>(Thread->m_NumLuaFrames), static_cast<int>(MAX_LUA_FRAMES));
+		memcpy(Thread->m_SampledLuaFrames, Thread->m_LuaFrames, static_cast<size_t>(NumLuaFrames) * LUA_FRAME_NAME_SIZE);
+		Thread->m_NumSampledLuaFrames = NumLuaFrames;
+		Thread->m_State = sThread::stFilled;
+	}
+	errno = SavedErrno;
+}
+
+
+
+
+
+void cSamplingProfiler::CaptureStacks(const AString & a_LowerFilter, std::vector<sSample> & a_Samples)
+{
+	// The lock also serializes the captures requested from different threads, so all the slots are idle here:
+	cCSLock Lock(m_CSThreads);
+
+	// Signal all the matching threads:
+	std::vector<sThread *> Signalled;
+	for (const auto & Thread: m_Threads)
+	{
+		if (!a_LowerFilter.empty() && (Thread->m_LowerName.find(a_LowerFilter) == AString::npos))
+		{
+			continue;
+		}
+		int Expected = sThread::stIdle;
+		if (!Thread->m_State.compare_exchange_strong(Expected, sThread::stRequested))
+		{
+			continue;
+		}
+		if (pthread_kill(Thread->m_Handle, SIGPROF) != 0)
+		{
+			Thread->m_State = sThread::stIdle;
+			continue;
+		}
+		Signalled.push_back(Thread.get());
+	}
+
+	// Collect the samples:
+	auto Deadline = std::chrono::steady_clock::now() + SAMPLE_TIMEOUT;
+	for (auto Thread: Signalled)
+	{
+		while ((Thread->m_State != sThread::stFilled) && (std::chrono::steady_clock::now() < Deadline))
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+
+		// If the handler hasn't started yet, cancel the request; if it is already capturing, it will finish shortly:
+		int Expected = sThread::stRequested;
+		if (Thread->m_State.compare_exchange_strong(Expected, sThread::stIdle))
+		{
+			continue;
+		}
+		while (Thread->m_State != sThread::stFilled)
+		{
+			std::this_thread::yield();
+		}
+
+		sSample Sample;
+		Sample.m_ThreadName = Thread->m_Name;
+		Sample.m_ThreadID = Thread->m_ID;
+		if (Thread->m_NumFrames > NUM_HANDLER_FRAMES)
+		{
+			Sample.m_Frames.assign(Thread->m_Frames + NUM_HANDLER_FRAMES, Thread->m_Frames + Thread->m_NumFrames);
+		}
+		for (int i = 0; i < Thread->m_NumSampledLuaFrames; i++)
+		{
+			Sample.m_LuaFrames.push_back(Thread->m_SampledLuaFrames[i]);
+		}
+		Thread->m_State = sThread::stIdle;
+		a_Samples.push_back(std::move(Sample));
+	}
+}
+
+
+
+
+
+void cSamplingProfiler::TakeSample(void)
+{
+	std::vector<sSample> Samples;
+	CaptureStacks(m_ThreadFilter, Samples);
+
+	// Aggregate the samples into folded stacks, "thread;outermost;...;innermost".
+	// The Lua frames are inserted after the native frames that called into Lua, or appended at the end if those cannot be recognized:
+	for (const auto & Sample: Samples)
+	{
+		AString Stack = Sample.m_ThreadName;
+		size_t NextLuaFrame = 0;
+		for (auto itr = Sample.m_Frames.rbegin(), end = Sample.m_Frames.rend(); itr != end; ++itr)
+		{
+			const AString & Name = Symbolize(*itr);
+			Stack.push_back(';');
+			Stack.append(Name);
+			if ((NextLuaFrame < Sample.m_LuaFrames.size()) && (Name.find("cLuaState::CallFunction") != AString::npos))
+			{
+				Stack.append(";[lua] ");
+				Stack.append(Sample.m_LuaFrames[NextLuaFrame++]);
+			}
+		}
+		for (; NextLuaFrame < Sample.m_LuaFrames.size(); NextLuaFrame++)
+		{
+			Stack.append(";[lua] ");
+			Stack.append(Sample.m_LuaFrames[NextLuaFrame]);
+		}
+		ReplaceString(Stack, "\n", " ");
+		m_Stacks[Stack] += 1;
+	}
+}
+
+
+
+
+
+const AString & cSamplingProfiler::Symbolize(void * a_Address)
+{
+	auto itr = m_Symbols.find(a_Address);
+	if (itr != m_Symbols.end())
+	{
+		return itr->second;
+	}
+
+	// The semicolons separate the frames in the folded stacks:
+	AString Name = SymbolizeAddress(a_Address);
+	ReplaceString(Name, ";", ":");
+	return m_Symbols[a_Address] = Name;
+}
+
+
+
+
+
+AString cSamplingProfiler::SymbolizeAddress(void * a_Address)
+{
+	// backtrace_symbols() returns "module(mangledname+offset) [address]" on Linux:
+	AString Name;
+	char ** Symbols = backtrace_symbols(&a_Address, 1);
+	if (Symbols != nullptr)
+	{
+		AString Line(Symbols[0]);
+		free(Symbols);
+		size_t Open = Line.find('(');
+		size_t Plus = Line.find('+', Open);
+		if ((Open != AString::npos) && (Plus != AString::npos) && (Plus > Open + 1))
+		{
+			AString Mangled = Line.substr(Open + 1, Plus - Open - 1);
+			int Status = 0;
+			char * Demangled = abi::__cxa_demangle(Mangled.c_str(), nullptr, nullptr, &Status);
+			if ((Status == 0) && (Demangled != nullptr))
+			{
+				Name = Demangled;
+			}
+			else
+			{
+				Name = Mangled;
+			}
+			free(Demangled);
+		}
+		else
+		{
+			// No symbol available, use the module name and offset:
+			size_t Space = Line.find(' ');
+			Name = Line.substr(0, Space);
+		}
+	}
+	if (Name.empty())
+	{
+		Printf(Name, "%p", a_Address);
+	}
+	return Name;
+}
+
+#endif  // else _WIN32
+
+
+
+
+
+UInt64 cSamplingProfiler::GetThreadID(std::thread::id a_ThreadID)
+{
+	return static_cast<UInt64>(std::hash<std::thread::id>()(a_ThreadID));
+}
+
+
+
+
+
+bool cSamplingProfiler::Stop(const AString & a_FileName, size_t & a_NumSamples, AString & a_Error)
+{
+	a_NumSamples = 0;
+	if (!s_IsRunning)
+	{
+		a_Error = "The sampling profiler is not running";
+		return false;
+	}
+	m_ShouldStop = true;
+	m_SamplerThread.join();
+	s_IsRunning = false;
+
+	cFile f;
+	if (!f.Open(a_FileName, cFile::fmWrite))
+	{
+		a_Error = Printf("Cannot open file \"%s\" for writing", a_FileName.c_str());
+		return false;
+	}
+	for (const auto & Stack: m_Stacks)
+	{
+		f.Printf("%s " SIZE_T_FMT "\n", Stack.first.c_str(), Stack.second);
+		a_NumSamples += Stack.second;
+	}
+	m_Stacks.clear();
+	m_Symbols.clear();
+	return true;
+}
+
+
+
+
+
+void cSamplingProfiler::SamplerThread(void)
+{
+	auto NextSample = std::chrono::steady_clock::now();
+	while (!m_ShouldStop)
+	{
+		NextSample += m_Interval;
+		auto Now = std::chrono::steady_clock::now();
+		if (NextSample > Now)
+		{
+			std::this_thread::sleep_for(NextSample - Now);
+		}
+		else
+		{
+			// Sampling takes longer than the interval, don't try to catch up:
+			NextSample = Now;
+		}
+		TakeSample();
+	}
+}
+
+
+
+
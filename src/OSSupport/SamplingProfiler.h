@@ -0,0 +1,157 @@
+
+// SamplingProfiler.h
+
+// Declares the cSamplingProfiler class representing a timer-signal based sampling profiler of the server threads
+
+
+
+
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "CriticalSection.h"
+
+
+
+
+
+/** Periodically samples the call stacks of the registered threads (all the cIsThread threads register themselves),
+and writes the aggregated samples as folded stacks, as consumed by flamegraph.pl.
+The sampler thread sends SIGPROF to each sampled thread, the signal handler captures the thread's stack using backtrace()
+and the Lua calls in progress in that thread (see cLuaFrame); the frames are symbolized later in the sampler thread.
+Only available on POSIX systems; elsewhere Start() fails.
+Enabled at runtime using the "sampleprofile" console command, there's no overhead when it isn't running, except for
+a single atomic check per Lua call.
+The same mechanism is used by DumpStacks() for a one-off snapshot of all the threads, such as for the stall reports. */
+class cSamplingProfiler
+{
+public:
+	/** The maximum number of native frames captured for a single sample. */
+	static const int MAX_FRAMES = 64;
+
+	/** The maximum nesting of the Lua calls captured for a single sample. */
+	static const int MAX_LUA_FRAMES = 8;
+
+	/** The maximum length of the name of a single Lua frame, including the terminating NUL. */
+	static const int LUA_FRAME_NAME_SIZE = 96;
+
+	/** The state of a single registered thread, shared between the thread's signal handler and the sampler thread. */
+	struct sThread;
+
+
+	/** Marks a call into Lua in progress in the current thread, so that the samples taken during the call include it.
+	The frame's name is copied, so it needn't outlive the object. Does nothing unless the profiler is running. */
+	class cLuaFrame
+	{
+	public:
+		cLuaFrame(const AString & a_Name);
+		~cLuaFrame();
+
+	protected:
+		/** True if the frame has been pushed onto the thread's Lua frame stack and needs to be popped. */
+		bool m_IsPushed;
+	} ;
+
+
+	/** Returns the single instance of the profiler. */
+	static cSamplingProfiler & Get(void);
+
+	/** Returns true if the profiler is currently running, so the Lua frames are to be recorded. */
+	static bool IsRunning(void) { return s_IsRunning; }
+
+	/** Registers the calling thread for sampling, under the specified name. */
+	void RegisterCurrentThread(const AString & a_Name);
+
+	/** Unregisters the calling thread; it must not be sampled anymore, since it is about to finish. */
+	void UnregisterCurrentThread(void);
+
+	/** Starts sampling, a_Frequency times per second, the threads whose names contain a_ThreadFilter (case-insensitive;
+	empty for all threads). Drops any samples collected earlier.
+	Returns false and sets a_Error if the profiler cannot be started. */
+	bool Start(int a_Frequency, const AString & a_ThreadFilter, AString & a_Error);
+
+	/** Stops sampling and writes the collected samples as folded stacks into the specified file.
+	Returns false and sets a_Error if the profiler isn't running or the file cannot be written. */
+	bool Stop(const AString & a_FileName, size_t & a_NumSamples, AString & a_Error);
+
+	/** Captures the current stacks of all the registered threads and appends them to a_Lines, one frame per line,
+	each thread headed by its name and ID (as returned by GetThreadID()). Works regardless of whether the profiler is running.
+	Returns false and sets a_Error if the stacks cannot be captured on this platform. */
+	bool DumpStacks(AStringVector & a_Lines, AString & a_Error);
+
+	/** Returns the ID of the specified thread, as used in the reports; matches the thread IDs written by the logger. */
+	static UInt64 GetThreadID(std::thread::id a_ThreadID);
+
+protected:
+	typedef SharedPtr<sThread> sThreadPtr;
+
+	/** A single stack captured from a thread, copied out of the thread's slot so that it can be symbolized without holding the lock. */
+	struct sSample
+	{
+		AString m_ThreadName;
+		UInt64 m_ThreadID;
+		std::vector<void *> m_Frames;
+		AStringVector m_LuaFrames;
+	} ;
+
+
+	/** Set while the profiler is running. */
+	static std::atomic<bool> s_IsRunning;
+
+	/** Protects m_Threads against multithreaded access. Held by the sampler thread for the whole duration of taking a sample,
+	so that the sampled threads cannot finish while being signalled. */
+	cCriticalSection m_CSThreads;
+
+	/** All the registered threads. */
+	std::vector<sThreadPtr> m_Threads;
+
+	/** The sampler thread, valid while the profiler is running. */
+	std::thread m_SamplerThread;
+
+	/** Set to make the sampler thread finish. */
+	std::atomic<bool> m_ShouldStop;
+
+	/** The interval between two samples. */
+	std::chrono::microseconds m_Interval;
+
+	/** The lowercased filter for the thread names. */
+	AString m_ThreadFilter;
+
+	/** The number of times each folded stack has been sampled. Only accessed by the sampler thread, or after it has finished. */
+	std::map<AString, size_t> m_Stacks;
+
+	/** The symbolized native frames, by address. Only accessed by the sampler thread. */
+	std::map<void *, AString> m_Symbols;
+
+
+	cSamplingProfiler(void);
+
+	/** The sampler thread's main loop. */
+	void SamplerThread(void);
+
+	/** Samples all the threads matching the filter once and adds the samples to m_Stacks. */
+	void TakeSample(void);
+
+	/** Captures a single stack of each registered thread whose lowercased name contains a_LowerFilter (empty for all threads).
+	The SIGPROF handler must be installed. */
+	void CaptureStacks(const AString & a_LowerFilter, std::vector<sSample> & a_Samples);
+
+	/** Returns the name of the function at the specified address, as used in the folded stacks. Caches the names in m_Symbols. */
+	const AString & Symbolize(void * a_Address);
+
+	/** Returns the name of the function at the specified address, without any caching. */
+	static AString SymbolizeAddress(void * a_Address);
+
+	/** Installs the SIGPROF handler, if not installed yet. Returns false and sets a_Error on failure. */
+	static bool InstallSignalHandler(AString & a_Error);
+
+	/** The SIGPROF handler, captures the stack of the thread that received the signal. */
+	static void SignalHandler(int a_Signal);
+} ;
+
+
+
+
@@ -18,7 +18,7 @@
 
 cTCPLinkImpl::cTCPLinkImpl(cTCPLink::cCallbacksPtr a_LinkCallbacks):
 	super(a_LinkCallbacks),
-	m_BufferEvent(bufferevent_socket_new(cNetworkSingleton::Get().GetEventBase(), -1, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE)),
+	m_BufferEvent(bufferevent_socket_new(cNetworkSingleton::Get().GetLinkEventBase(), -1, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE)),
 	m_LocalPort(0),
 	m_RemotePort(0),
 	m_ShouldShutdown(false)
@@ -31,7 +31,7 @@ cTCPLinkImpl::cTCPLinkImpl(cTCPLink::cCallbacksPtr a_LinkCallbacks):
 
 cTCPLinkImpl::cTCPLinkImpl(evutil_socket_t a_Socket, cTCPLink::cCallbacksPtr a_LinkCallbacks, cServerHandleImplPtr a_Server, const sockaddr * a_Address, socklen_t a_AddrLen):
 	super(a_LinkCallbacks),
-	m_BufferEvent(bufferevent_socket_new(cNetworkSingleton::Get().GetEventBase(), a_Socket, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE)),
+	m_BufferEvent(bufferevent_socket_new(cNetworkSingleton::Get().GetLinkEventBase(), a_Socket, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE)),
 	m_Server(a_Server),
 	m_LocalPort(0),
 	m_RemotePort(0),
@@ -136,6 +136,43 @@ bool cTCPLinkImpl::Send(const void * a_Data, size_t a_Length)
 
 
 
+bool cTCPLinkImpl::SendOwned(AString && a_Data)
+{
+	return SendOwned(std::move(a_Data), nullptr);
+}
+
+
+
+
+
+bool cTCPLinkImpl::SendOwned(AString && a_Data, cDataWrittenCallback a_OnWritten)
+{
+	if (m_ShouldShutdown)
+	{
+		LOGD("%s: Cannot send data, the link is already shut down.", __FUNCTION__);
+		return false;
+	}
+	if (a_Data.empty())
+	{
+		return true;
+	}
+
+	// Move the data into a heap-allocated string that LibEvent references until it is written out, then frees via the callback:
+	sOwnedData * Data = new sOwnedData;
+	std::swap(Data->m_Data, a_Data);
+	Data->m_OnWritten = std::move(a_OnWritten);
+	if (evbuffer_add_reference(bufferevent_get_output(m_BufferEvent), Data->m_Data.data(), Data->m_Data.size(), OwnedDataCleanupCallback, Data) != 0)
+	{
+		delete Data;
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
 void cTCPLinkImpl::Shutdown(void)
 {
 	// If there's no outgoing data, shutdown the socket directly:
@@ -284,6 +321,22 @@ void cTCPLinkImpl::EventCallback(bufferevent * a_BufferEvent, short a_What, void
 
 
 
+void cTCPLinkImpl::OwnedDataCleanupCallback(const void * a_Data, size_t a_DataLen, void * a_OwnedData)
+{
+	UNUSED(a_Data);
+	UNUSED(a_DataLen);
+	sOwnedData * Data = reinterpret_cast<sOwnedData *>(a_OwnedData);
+	if (Data->m_OnWritten != nullptr)
+	{
+		Data->m_OnWritten();
+	}
+	delete Data;
+}
+
+
+
+
+
 void cTCPLinkImpl::UpdateAddress(const sockaddr * a_Address, socklen_t a_AddrLen, AString & a_IP, UInt16 & a_Port)
 {
 	// Based on the family specified in the address, use the correct datastructure to convert to IP string:
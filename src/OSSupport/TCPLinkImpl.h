@@ -58,6 +58,8 @@ public:
 
 	// cTCPLink overrides:
 	virtual bool Send(const void * a_Data, size_t a_Length) override;
+	virtual bool SendOwned(AString && a_Data) override;
+	virtual bool SendOwned(AString && a_Data, cDataWrittenCallback a_OnWritten) override;
 	virtual AString GetLocalIP(void) const override { return m_LocalIP; }
 	virtual UInt16 GetLocalPort(void) const override { return m_LocalPort; }
 	virtual AString GetRemoteIP(void) const override { return m_RemoteIP; }
@@ -67,6 +69,16 @@ public:
 
 protected:
 
+	/** The data queued by SendOwned(), referenced by LibEvent until it is written out. */
+	struct sOwnedData
+	{
+		AString m_Data;
+
+		/** Called once the data has been written out; may be empty. */
+		cDataWrittenCallback m_OnWritten;
+	} ;
+
+
 	/** Callbacks to call when the connection is established.
 	May be NULL if not used. Only used for outgoing connections (cNetwork::Connect()). */
 	cNetwork::cConnectCallbacksPtr m_ConnectCallbacks;
@@ -115,6 +127,10 @@ protected:
 	/** Callback that LibEvent calls when there's a non-data-related event on the socket. */
 	static void EventCallback(bufferevent * a_BufferEvent, short a_What, void * a_Self);
 
+	/** Callback that LibEvent calls when it's done with the data referenced by SendOwned(); calls the data's written-callback,
+	if any, and frees the sOwnedData holding it. */
+	static void OwnedDataCleanupCallback(const void * a_Data, size_t a_DataLen, void * a_OwnedData);
+
 	/** Sets a_IP and a_Port to values read from a_Address, based on the correct address family. */
 	static void UpdateAddress(const sockaddr * a_Address, socklen_t a_AddrLen, AString & a_IP, UInt16 & a_Port);
 
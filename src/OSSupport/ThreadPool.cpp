@@ -0,0 +1,332 @@
+// ThreadPool.cpp
+
+// Implements the cThreadPool class representing a work-stealing pool of worker threads shared by the server subsystems
+
+#include "Globals.h"
+#include "ThreadPool.h"
+
+
+
+
+
+#ifdef _WIN32
+	#define thread_local __declspec(thread)
+#endif
+
+/** The worker running on the current thread, nullptr for non-worker threads. */
+static thread_local void * g_CurrentWorker = nullptr;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cThreadPool:
+
+cThreadPool::cThreadPool(void) :
+	m_NumQueued(0),
+	m_NextWorker(0),
+	m_ShouldStop(false),
+	m_IsRunning(false)
+{
+}
+
+
+
+
+
+cThreadPool::~cThreadPool()
+{
+	Stop();
+}
+
+
+
+
+
+bool cThreadPool::Start(int a_NumThreads)
+{
+	ASSERT(m_Workers.empty());
+	if (a_NumThreads <= 0)
+	{
+		a_NumThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+	m_ShouldStop = false;
+	for (int i = 0; i < a_NumThreads; i++)
+	{
+		m_Workers.push_back(std::unique_ptr<cWorker>(new cWorker(*this, m_Workers.size())));
+	}
+	// Start only after all the workers exist, so that the stealing code can access m_Workers safely:
+	size_t NumStarted = 0;
+	for (cWorkers::iterator itr = m_Workers.begin(), end = m_Workers.end(); itr != end; ++itr)
+	{
+		if ((*itr)->Start())
+		{
+			NumStarted += 1;
+		}
+	}
+	if (NumStarted == 0)
+	{
+		LOGWARNING("cThreadPool: Cannot start any worker thread, tasks will be executed synchronously");
+		m_Workers.clear();
+		return false;
+	}
+	m_IsRunning = true;
+	LOGD("cThreadPool: Started " SIZE_T_FMT " worker threads", NumStarted);
+	return true;
+}
+
+
+
+
+
+void cThreadPool::Stop(void)
+{
+	if (m_Workers.empty())
+	{
+		return;
+	}
+	{
+		std::unique_lock<std::mutex> Lock(m_IdleMutex);
+		m_ShouldStop = true;
+	}
+	m_IdleCondVar.notify_all();
+	for (cWorkers::iterator itr = m_Workers.begin(), end = m_Workers.end(); itr != end; ++itr)
+	{
+		(*itr)->Wait();
+	}
+	m_IsRunning = false;
+	m_Workers.clear();
+}
+
+
+
+
+
+void cThreadPool::Submit(cTask a_Task, ePriority a_Priority)
+{
+	ASSERT((a_Priority >= 0) && (a_Priority < tpNumPriorities));
+	if (!m_IsRunning || m_ShouldStop)
+	{
+		// No workers to run the task, run it right away:
+		a_Task();
+		return;
+	}
+
+	// Tasks submitted by a worker stay with that worker (most likely they work on the same data), other tasks are spread:
+	cWorker * Worker = GetCurrentWorker();
+	if (Worker == nullptr)
+	{
+		Worker = m_Workers[m_NextWorker++ % m_Workers.size()].get();
+	}
+
+	// Count the task before it becomes visible to the workers, so that a worker taking it never decrements the counter below zero:
+	m_NumQueued++;
+	Worker->Push(std::move(a_Task), a_Priority);
+
+	// Wake up an idle worker; the lock makes sure the wakeup isn't lost between an idle worker's check and its wait:
+	{
+		std::unique_lock<std::mutex> Lock(m_IdleMutex);
+	}
+	m_IdleCondVar.notify_one();
+}
+
+
+
+
+
+void cThreadPool::ParallelFor(size_t a_Count, const std::function<void(size_t)> & a_Task, ePriority a_Priority)
+{
+	if ((a_Count <= 1) || !m_IsRunning || IsWorkerThread())
+	{
+		for (size_t i = 0; i < a_Count; i++)
+		{
+			a_Task(i);
+		}
+		return;
+	}
+
+	// Each helper task, as well as this thread, keeps taking the next unprocessed item until there are none left.
+	// The state is shared with the helpers, so that this thread only needs to wait for the items being processed, not for
+	// the helpers that haven't even started yet - their workers may be blocked by a lock that the caller is holding.
+	// Helpers that start only after all the items have been taken finish right away, without touching a_Task:
+	struct sState
+	{
+		const std::function<void(size_t)> * m_Task;
+		size_t m_Count;
+		std::atomic<size_t> m_NextItem;
+		std::atomic<size_t> m_NumFinished;
+		std::mutex m_FinishedMutex;
+		std::condition_variable m_FinishedCondVar;
+	};
+	auto State = std::make_shared<sState>();
+	State->m_Task = &a_Task;
+	State->m_Count = a_Count;
+	State->m_NextItem = 0;
+	State->m_NumFinished = 0;
+	auto ProcessItems = [State]()
+	{
+		for (size_t i = State->m_NextItem++; i < State->m_Count; i = State->m_NextItem++)
+		{
+			(*State->m_Task)(i);
+			if (++State->m_NumFinished == State->m_Count)
+			{
+				std::unique_lock<std::mutex> Lock(State->m_FinishedMutex);
+				State->m_FinishedCondVar.notify_one();
+			}
+		}
+	};
+
+	size_t NumHelpers = std::min(a_Count, m_Workers.size() + 1) - 1;
+	for (size_t i = 0; i < NumHelpers; i++)
+	{
+		Submit(ProcessItems, a_Priority);
+	}
+	ProcessItems();
+
+	// a_Task references the caller's stack frame, wait for all the items to finish:
+	std::unique_lock<std::mutex> Lock(State->m_FinishedMutex);
+	State->m_FinishedCondVar.wait(Lock, [&]() { return (State->m_NumFinished == State->m_Count); });
+}
+
+
+
+
+
+bool cThreadPool::IsWorkerThread(void) const
+{
+	return (GetCurrentWorker() != nullptr);
+}
+
+
+
+
+
+cThreadPool::cWorker * cThreadPool::GetCurrentWorker(void) const
+{
+	cWorker * Worker = static_cast<cWorker *>(g_CurrentWorker);
+	if ((Worker == nullptr) || (&Worker->GetParent() != this))
+	{
+		return nullptr;
+	}
+	return Worker;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cThreadPool::cWorker:
+
+cThreadPool::cWorker::cWorker(cThreadPool & a_Parent, size_t a_Index) :
+	super(Printf("ThreadPool worker " SIZE_T_FMT, a_Index)),
+	m_Parent(a_Parent),
+	m_Index(a_Index)
+{
+}
+
+
+
+
+
+void cThreadPool::cWorker::Push(cTask && a_Task, ePriority a_Priority)
+{
+	cCSLock Lock(m_CS);
+	m_Tasks[a_Priority].push_back(std::move(a_Task));
+}
+
+
+
+
+
+bool cThreadPool::cWorker::PopNewest(cTask & a_Task, ePriority a_Priority)
+{
+	cCSLock Lock(m_CS);
+	if (m_Tasks[a_Priority].empty())
+	{
+		return false;
+	}
+	a_Task = std::move(m_Tasks[a_Priority].back());
+	m_Tasks[a_Priority].pop_back();
+	return true;
+}
+
+
+
+
+
+bool cThreadPool::cWorker::PopOldest(cTask & a_Task, ePriority a_Priority)
+{
+	cCSLock Lock(m_CS);
+	if (m_Tasks[a_Priority].empty())
+	{
+		return false;
+	}
+	a_Task = std::move(m_Tasks[a_Priority].front());
+	m_Tasks[a_Priority].pop_front();
+	return true;
+}
+
+
+
+
+
+void cThreadPool::cWorker::Execute(void)
+{
+	g_CurrentWorker = this;
+	for (;;)
+	{
+		cTask Task;
+		if (FindTask(Task))
+		{
+			m_Parent.m_NumQueued--;
+			Task();
+			continue;
+		}
+
+		// No task anywhere, wait for one to be submitted, or for the pool to stop:
+		std::unique_lock<std::mutex> Lock(m_Parent.m_IdleMutex);
+		if (m_Parent.m_NumQueued > 0)
+		{
+			// A task has been submitted since FindTask() looked
+			continue;
+		}
+		if (m_Parent.m_ShouldStop)
+		{
+			break;
+		}
+		m_Parent.m_IdleCondVar.wait(Lock);
+	}
+	g_CurrentWorker = nullptr;
+}
+
+
+
+
+
+bool cThreadPool::cWorker::FindTask(cTask & a_Task)
+{
+	const cWorkers & Workers = m_Parent.m_Workers;
+	size_t NumWorkers = Workers.size();
+	for (int Priority = 0; Priority < tpNumPriorities; Priority++)
+	{
+		ePriority Prio = static_cast<ePriority>(Priority);
+		if (PopNewest(a_Task, Prio))
+		{
+			return true;
+		}
+		for (size_t i = 1; i < NumWorkers; i++)
+		{
+			if (Workers[(m_Index + i) % NumWorkers]->PopOldest(a_Task, Prio))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+
+
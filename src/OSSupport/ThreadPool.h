@@ -0,0 +1,142 @@
+// ThreadPool.h
+
+// Declares the cThreadPool class representing a work-stealing pool of worker threads shared by the server subsystems
+
+
+
+
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include "IsThread.h"
+#include "CriticalSection.h"
+
+
+
+
+
+/** A pool of worker threads executing tasks submitted by any thread.
+Each worker has its own task queues, one per priority. Tasks submitted from within a worker go to that worker's
+queues, tasks submitted from other threads are distributed round-robin. An idle worker first takes the newest
+task from its own queues, then steals the oldest task from the other workers' queues; higher priorities are
+always considered first.
+If the pool is not running, submitted tasks are executed immediately on the submitting thread. */
+class cThreadPool
+{
+public:
+
+	/** The task priorities, in the order in which the workers consider them. */
+	enum ePriority
+	{
+		tpHigh = 0,    ///< Latency-sensitive work a player is waiting for, such as sending chunks
+		tpNormal,      ///< Lighting, loading
+		tpLow,         ///< Background work, such as generating and saving chunks
+		tpNumPriorities
+	};
+
+	typedef std::function<void(void)> cTask;
+
+
+	cThreadPool(void);
+	~cThreadPool();
+
+	/** Starts the specified number of worker threads; 0 means one thread per hardware thread.
+	Returns true if at least one worker has been started. */
+	bool Start(int a_NumThreads);
+
+	/** Lets the workers finish all the queued tasks, then stops them.
+	Tasks submitted after this call are executed directly on the submitting thread. */
+	void Stop(void);
+
+	/** Queues the task for execution by one of the workers. */
+	void Submit(cTask a_Task, ePriority a_Priority = tpNormal);
+
+	/** Calls a_Task(i) for each i in [0, a_Count), spread over the workers, and waits until all the calls have finished.
+	The calling thread processes the items as well. When called from a worker thread, all the items are processed
+	directly on that thread, so that the worker doesn't wait for tasks that it should be executing itself.
+	The items not taken by the workers are eventually processed by the calling thread, so this may be called while holding
+	a lock that the workers' other tasks are waiting for. */
+	void ParallelFor(size_t a_Count, const std::function<void(size_t)> & a_Task, ePriority a_Priority = tpNormal);
+
+	/** Returns the number of running worker threads. */
+	size_t GetNumThreads(void) const { return m_Workers.size(); }
+
+	/** Returns the number of tasks queued and not yet started. */
+	size_t GetQueueLength(void) const { return m_NumQueued; }
+
+	/** Returns true if the calling thread is one of this pool's workers. */
+	bool IsWorkerThread(void) const;
+
+protected:
+
+	class cWorker :
+		public cIsThread
+	{
+		typedef cIsThread super;
+
+	public:
+		cWorker(cThreadPool & a_Parent, size_t a_Index);
+
+		/** Adds the task to this worker's queue of the specified priority. */
+		void Push(cTask && a_Task, ePriority a_Priority);
+
+		/** Takes the newest task of the specified priority from this worker's queue. Returns false if there's none. */
+		bool PopNewest(cTask & a_Task, ePriority a_Priority);
+
+		/** Takes the oldest task of the specified priority from this worker's queue. Returns false if there's none. */
+		bool PopOldest(cTask & a_Task, ePriority a_Priority);
+
+		cThreadPool & GetParent(void) { return m_Parent; }
+
+	protected:
+		cThreadPool & m_Parent;
+
+		/** Index of this worker in m_Parent.m_Workers. */
+		size_t m_Index;
+
+		/** Protects m_Tasks against the owner and the stealing workers. */
+		cCriticalSection m_CS;
+
+		/** The queued tasks, one queue per priority. */
+		std::deque<cTask> m_Tasks[tpNumPriorities];
+
+		// cIsThread override:
+		virtual void Execute(void) override;
+
+		/** Finds the next task to execute, either own or stolen. Returns false if there's no task anywhere. */
+		bool FindTask(cTask & a_Task);
+	};
+
+	typedef std::vector<std::unique_ptr<cWorker>> cWorkers;
+
+
+	/** The worker threads. Only modified in Start() and Stop(), while no tasks are being submitted. */
+	cWorkers m_Workers;
+
+	/** Number of tasks in all the workers' queues. */
+	std::atomic<size_t> m_NumQueued;
+
+	/** The worker that receives the next task submitted from outside the pool. */
+	std::atomic<size_t> m_NextWorker;
+
+	/** Set when the workers should terminate once the queues are empty. */
+	std::atomic<bool> m_ShouldStop;
+
+	/** Set while the workers are running and accept tasks. */
+	std::atomic<bool> m_IsRunning;
+
+	/** Mutex and condition variable used by the idle workers for waiting for new tasks. */
+	std::mutex m_IdleMutex;
+	std::condition_variable m_IdleCondVar;
+
+
+	/** Returns the worker running on the calling thread, or nullptr if the calling thread is not this pool's worker. */
+	cWorker * GetCurrentWorker(void) const;
+} ;
+
+
+
+
@@ -0,0 +1,139 @@
+
+// PermissionTrie.cpp
+
+// Implements the cPermissionTrie class representing a set of permission templates organized for fast matching
+
+#include "Globals.h"
+#include "PermissionTrie.h"
+
+
+
+
+
+cPermissionTrie::cPermissionTrie(void)
+{
+	Clear();
+}
+
+
+
+
+
+void cPermissionTrie::Clear(void)
+{
+	m_Nodes.clear();
+	m_Nodes.push_back(sNode());
+}
+
+
+
+
+
+void cPermissionTrie::Add(const AString & a_Template)
+{
+	// Split the same way as cPlayer does for PermissionMatches(), so that the results are the same:
+	AStringVector Parts = StringSplit(a_Template, ".");
+	if (Parts.empty())
+	{
+		return;
+	}
+
+	size_t NodeIdx = 0;
+	for (const auto & Part: Parts)
+	{
+		if (Part == "*")
+		{
+			// The wildcard matches anything that follows, the rest of the template is irrelevant:
+			m_Nodes[NodeIdx].m_HasWildcard = true;
+			return;
+		}
+
+		// Find or insert the child for the part, keeping the children sorted:
+		auto & Children = m_Nodes[NodeIdx].m_Children;
+		auto itr = std::lower_bound(Children.begin(), Children.end(), Part,
+			[](const std::pair<AString, size_t> & a_Child, const AString & a_Part)
+			{
+				return (a_Child.first < a_Part);
+			}
+		);
+		if ((itr != Children.end()) && (itr->first == Part))
+		{
+			NodeIdx = itr->second;
+			continue;
+		}
+		size_t ChildIdx = m_Nodes.size();
+		Children.insert(itr, std::make_pair(Part, ChildIdx));
+		m_Nodes.push_back(sNode());  // Invalidates Children
+		NodeIdx = ChildIdx;
+	}
+	m_Nodes[NodeIdx].m_IsTerminal = true;
+}
+
+
+
+
+
+void cPermissionTrie::Add(const AStringVector & a_Templates)
+{
+	for (const auto & Template: a_Templates)
+	{
+		Add(Template);
+	}
+}
+
+
+
+
+
+bool cPermissionTrie::Matches(const AString & a_Permission) const
+{
+	// Walk the parts the same way StringSplit() splits them on the dots; a trailing empty part is not a part:
+	size_t NodeIdx = 0;
+	size_t Start = 0;
+	size_t Length = a_Permission.size();
+	while (Start < Length)
+	{
+		const sNode & Node = m_Nodes[NodeIdx];
+		if (Node.m_HasWildcard)
+		{
+			// A template matched so far and continues with a wildcard, which matches this and all the following parts:
+			return true;
+		}
+		size_t Dot = a_Permission.find('.', Start);
+		if (Dot == AString::npos)
+		{
+			Dot = Length;
+		}
+		NodeIdx = FindChild(NodeIdx, a_Permission.data() + Start, Dot - Start);
+		if (NodeIdx == 0)
+		{
+			return false;
+		}
+		Start = Dot + 1;
+	}
+	return m_Nodes[NodeIdx].m_IsTerminal;
+}
+
+
+
+
+
+size_t cPermissionTrie::FindChild(size_t a_NodeIdx, const char * a_Part, size_t a_PartLength) const
+{
+	const auto & Children = m_Nodes[a_NodeIdx].m_Children;
+	auto itr = std::lower_bound(Children.begin(), Children.end(), 0,
+		[a_Part, a_PartLength](const std::pair<AString, size_t> & a_Child, int)
+		{
+			return (a_Child.first.compare(0, AString::npos, a_Part, a_PartLength) < 0);
+		}
+	);
+	if ((itr == Children.end()) || (itr->first.compare(0, AString::npos, a_Part, a_PartLength) != 0))
+	{
+		return 0;
+	}
+	return itr->second;
+}
+
+
+
+
@@ -0,0 +1,69 @@
+
+// PermissionTrie.h
+
+// Declares the cPermissionTrie class representing a set of permission templates organized for fast matching
+
+
+
+
+
+#pragma once
+
+
+
+
+
+/** A set of permission templates, such as "core.*" or "core.give", stored as a trie of their dot-separated parts,
+so that a permission is matched against all the templates in a single pass over its parts, without any allocations.
+The matching is the same as cPlayer::PermissionMatches() against each of the templates: a template matches a permission
+if both have the same parts, or if they have the same parts up to a "*" part in the template and the permission continues
+past that point. */
+class cPermissionTrie
+{
+public:
+	cPermissionTrie(void);
+
+	/** Removes all the templates. */
+	void Clear(void);
+
+	/** Adds the permission template. */
+	void Add(const AString & a_Template);
+
+	/** Adds all the permission templates. */
+	void Add(const AStringVector & a_Templates);
+
+	/** Returns true if any of the templates matches the permission. */
+	bool Matches(const AString & a_Permission) const;
+
+protected:
+	/** A single node of the trie, representing a sequence of template parts. */
+	struct sNode
+	{
+		/** The nodes for the next part, sorted by the part. Pairs of the part and the index into m_Nodes. */
+		std::vector<std::pair<AString, size_t>> m_Children;
+
+		/** True if a template ends with the parts leading to this node. */
+		bool m_IsTerminal;
+
+		/** True if a template continues with a "*" part after the parts leading to this node. */
+		bool m_HasWildcard;
+
+		sNode(void) :
+			m_IsTerminal(false),
+			m_HasWildcard(false)
+		{
+		}
+	};
+
+	/** All the nodes, the root is at index 0. */
+	std::vector<sNode> m_Nodes;
+
+
+	/** Returns the index of the child of the specified node for the part, or 0 if there's no such child
+	(the root is never a child). a_Part points to a_PartLength bytes, not necessarily NUL-terminated. */
+	size_t FindChild(size_t a_NodeIdx, const char * a_Part, size_t a_PartLength) const;
+} ;
+
+
+
+
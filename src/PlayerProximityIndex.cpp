@@ -0,0 +1,263 @@
+
+// PlayerProximityIndex.cpp
+
+// Implements the cPlayerProximityIndex class representing a spatial grid of a world's players for the nearest-player and radius queries
+
+#include "Globals.h"
+#include "PlayerProximityIndex.h"
+
+
+
+
+
+void cPlayerProximityIndex::Add(cPlayer & a_Player, const Vector3d & a_Pos)
+{
+	int CellX, CellZ;
+	GetCellCoords(a_Pos, CellX, CellZ);
+	Int64 Key = GetCellKey(CellX, CellZ);
+
+	cCSLock Lock(m_CS);
+	if (!m_PlayerCells.insert(std::make_pair(&a_Player, Key)).second)
+	{
+		// Already indexed
+		return;
+	}
+	m_Cells[Key].push_back({&a_Player, a_Pos});
+}
+
+
+
+
+
+void cPlayerProximityIndex::Update(cPlayer & a_Player, const Vector3d & a_Pos)
+{
+	int CellX, CellZ;
+	GetCellCoords(a_Pos, CellX, CellZ);
+	Int64 Key = GetCellKey(CellX, CellZ);
+
+	cCSLock Lock(m_CS);
+	auto itrPlayer = m_PlayerCells.find(&a_Player);
+	if (itrPlayer == m_PlayerCells.end())
+	{
+		return;
+	}
+	auto itrCell = m_Cells.find(itrPlayer->second);
+	ASSERT(itrCell != m_Cells.end());
+	cEntries & Entries = itrCell->second;
+	for (auto itr = Entries.begin(), end = Entries.end(); itr != end; ++itr)
+	{
+		if (itr->m_Player != &a_Player)
+		{
+			continue;
+		}
+		if (itrPlayer->second == Key)
+		{
+			// Still in the same cell:
+			itr->m_Pos = a_Pos;
+			return;
+		}
+
+		// Moved to another cell:
+		*itr = Entries.back();
+		Entries.pop_back();
+		if (Entries.empty())
+		{
+			m_Cells.erase(itrCell);
+		}
+		itrPlayer->second = Key;
+		m_Cells[Key].push_back({&a_Player, a_Pos});
+		return;
+	}
+	ASSERT(!"Indexed player not found in its cell");
+}
+
+
+
+
+
+void cPlayerProximityIndex::Remove(cPlayer & a_Player)
+{
+	cCSLock Lock(m_CS);
+	auto itrPlayer = m_PlayerCells.find(&a_Player);
+	if (itrPlayer == m_PlayerCells.end())
+	{
+		return;
+	}
+	auto itrCell = m_Cells.find(itrPlayer->second);
+	m_PlayerCells.erase(itrPlayer);
+	if (itrCell == m_Cells.end())
+	{
+		ASSERT(!"Indexed player's cell not found");
+		return;
+	}
+	cEntries & Entries = itrCell->second;
+	Entries.erase(
+		std::remove_if(Entries.begin(), Entries.end(), [&a_Player](const sEntry & a_Entry) { return (a_Entry.m_Player == &a_Player); }),
+		Entries.end()
+	);
+	if (Entries.empty())
+	{
+		m_Cells.erase(itrCell);
+	}
+}
+
+
+
+
+
+cPlayer * cPlayerProximityIndex::FindClosest(const Vector3d & a_Pos, double a_MaxDistance, double * a_Distance)
+{
+	cPlayer * Closest = nullptr;
+	double ClosestDistance = a_MaxDistance;
+	int CellX, CellZ;
+	GetCellCoords(a_Pos, CellX, CellZ);
+	int MaxRing = static_cast<int>(std::min(std::ceil(a_MaxDistance / CELL_SIZE), 1e6));
+
+	cCSLock Lock(m_CS);
+
+	// Search the rings of cells around the center, until the rest cannot contain anything closer.
+	// Once the rings cover more cells than there are occupied ones, checking all the occupied ones is cheaper:
+	size_t NumCellsChecked = 0;
+	for (int Ring = 0; Ring <= MaxRing; Ring++)
+	{
+		NumCellsChecked += (Ring == 0) ? 1 : static_cast<size_t>(8 * Ring);
+		if (NumCellsChecked > m_Cells.size())
+		{
+			Closest = nullptr;
+			ClosestDistance = a_MaxDistance;
+			for (const auto & Cell: m_Cells)
+			{
+				CheckCellForClosest(Cell.first, a_Pos, Closest, ClosestDistance);
+			}
+			break;
+		}
+		for (int x = CellX - Ring; x <= CellX + Ring; x++)
+		{
+			CheckCellForClosest(GetCellKey(x, CellZ - Ring), a_Pos, Closest, ClosestDistance);
+			if (Ring > 0)
+			{
+				CheckCellForClosest(GetCellKey(x, CellZ + Ring), a_Pos, Closest, ClosestDistance);
+			}
+		}
+		for (int z = CellZ - Ring + 1; z < CellZ + Ring; z++)
+		{
+			CheckCellForClosest(GetCellKey(CellX - Ring, z), a_Pos, Closest, ClosestDistance);
+			CheckCellForClosest(GetCellKey(CellX + Ring, z), a_Pos, Closest, ClosestDistance);
+		}
+
+		// All the cells outside this ring are at least Ring * CELL_SIZE away:
+		if ((Closest != nullptr) && (ClosestDistance <= static_cast<double>(Ring) * CELL_SIZE))
+		{
+			break;
+		}
+	}
+
+	if ((Closest != nullptr) && (a_Distance != nullptr))
+	{
+		*a_Distance = ClosestDistance;
+	}
+	return Closest;
+}
+
+
+
+
+
+void cPlayerProximityIndex::GetPlayersInRadius(const Vector3d & a_Pos, double a_Radius, cPlayerDistances & a_Players)
+{
+	a_Players.clear();
+	int MinCellX, MinCellZ, MaxCellX, MaxCellZ;
+	GetCellCoords(a_Pos - Vector3d(a_Radius, 0, a_Radius), MinCellX, MinCellZ);
+	GetCellCoords(a_Pos + Vector3d(a_Radius, 0, a_Radius), MaxCellX, MaxCellZ);
+	double NumCellsInArea = (static_cast<double>(MaxCellX) - MinCellX + 1) * (static_cast<double>(MaxCellZ) - MinCellZ + 1);
+
+	auto AddCell = [&](const cEntries & a_Entries)
+	{
+		for (const auto & Entry: a_Entries)
+		{
+			double Distance = (Entry.m_Pos - a_Pos).Length();
+			if (Distance < a_Radius)
+			{
+				a_Players.push_back({Entry.m_Player, Entry.m_Pos, Distance});
+			}
+		}
+	};
+
+	{
+		cCSLock Lock(m_CS);
+		if (NumCellsInArea > static_cast<double>(m_Cells.size()))
+		{
+			// The area is larger than the occupied cells, check them all:
+			for (const auto & Cell: m_Cells)
+			{
+				AddCell(Cell.second);
+			}
+		}
+		else
+		{
+			for (int x = MinCellX; x <= MaxCellX; x++)
+			{
+				for (int z = MinCellZ; z <= MaxCellZ; z++)
+				{
+					auto itr = m_Cells.find(GetCellKey(x, z));
+					if (itr != m_Cells.end())
+					{
+						AddCell(itr->second);
+					}
+				}
+			}
+		}
+	}
+
+	std::sort(a_Players.begin(), a_Players.end(), [](const sPlayerDistance & a_First, const sPlayerDistance & a_Second)
+		{
+			return (a_First.m_Distance < a_Second.m_Distance);
+		}
+	);
+}
+
+
+
+
+
+size_t cPlayerProximityIndex::GetNumPlayers(void)
+{
+	cCSLock Lock(m_CS);
+	return m_PlayerCells.size();
+}
+
+
+
+
+
+void cPlayerProximityIndex::GetCellCoords(const Vector3d & a_Pos, int & a_CellX, int & a_CellZ)
+{
+	a_CellX = static_cast<int>(std::floor(a_Pos.x / CELL_SIZE));
+	a_CellZ = static_cast<int>(std::floor(a_Pos.z / CELL_SIZE));
+}
+
+
+
+
+
+void cPlayerProximityIndex::CheckCellForClosest(Int64 a_CellKey, const Vector3d & a_Pos, cPlayer *& a_Closest, double & a_ClosestDistance)
+{
+	auto itr = m_Cells.find(a_CellKey);
+	if (itr == m_Cells.end())
+	{
+		return;
+	}
+	for (const auto & Entry: itr->second)
+	{
+		double Distance = (Entry.m_Pos - a_Pos).Length();
+		if (Distance < a_ClosestDistance)
+		{
+			a_ClosestDistance = Distance;
+			a_Closest = Entry.m_Player;
+		}
+	}
+}
+
+
+
+
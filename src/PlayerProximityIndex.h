@@ -0,0 +1,102 @@
+
+// PlayerProximityIndex.h
+
+// Declares the cPlayerProximityIndex class representing a spatial grid of a world's players for the nearest-player and radius queries
+
+
+
+
+
+#pragma once
+
+#include <unordered_map>
+#include "Vector3.h"
+
+
+
+
+
+// fwd:
+class cPlayer;
+
+
+
+
+
+/** A spatial grid of the players in a single world, answering "the closest player" and "all the players in a radius"
+queries without scanning all the players. The world adds and removes its players and each player updates its own
+position when it moves, so the positions lag at most a single tick behind.
+The grid has its own lock, which is never held while calling out, so it can be queried under any other lock. */
+class cPlayerProximityIndex
+{
+public:
+	/** The size of a single grid cell, in blocks, along both X and Z. */
+	static const int CELL_SIZE = 32;
+
+	/** A player found by GetPlayersInRadius(). */
+	struct sPlayerDistance
+	{
+		cPlayer * m_Player;
+		Vector3d m_Pos;
+		double m_Distance;
+	} ;
+
+	typedef std::vector<sPlayerDistance> cPlayerDistances;
+
+
+	/** Adds the player at the specified position. Ignored if the player is already indexed. */
+	void Add(cPlayer & a_Player, const Vector3d & a_Pos);
+
+	/** Moves the player to the specified position. Ignored if the player isn't indexed (not added to the world yet, or already removed). */
+	void Update(cPlayer & a_Player, const Vector3d & a_Pos);
+
+	/** Removes the player from the index. Ignored if the player isn't indexed. */
+	void Remove(cPlayer & a_Player);
+
+	/** Returns the player closest to a_Pos that is closer than a_MaxDistance, or nullptr if there's none.
+	If a_Distance is given, it receives the distance of the returned player. */
+	cPlayer * FindClosest(const Vector3d & a_Pos, double a_MaxDistance, double * a_Distance = nullptr);
+
+	/** Fills a_Players with all the players closer than a_Radius to a_Pos, the closest first. */
+	void GetPlayersInRadius(const Vector3d & a_Pos, double a_Radius, cPlayerDistances & a_Players);
+
+	/** Returns the number of the indexed players. */
+	size_t GetNumPlayers(void);
+
+protected:
+	/** A single player in a cell. */
+	struct sEntry
+	{
+		cPlayer * m_Player;
+		Vector3d m_Pos;
+	} ;
+
+	typedef std::vector<sEntry> cEntries;
+
+
+	/** Protects all the members against multithreaded access. */
+	cCriticalSection m_CS;
+
+	/** The players in each non-empty cell, by the cell key (see GetCellKey()). */
+	std::unordered_map<Int64, cEntries> m_Cells;
+
+	/** The key of the cell of each indexed player. */
+	std::unordered_map<const cPlayer *, Int64> m_PlayerCells;
+
+
+	/** Returns the cell coords containing the specified position. */
+	static void GetCellCoords(const Vector3d & a_Pos, int & a_CellX, int & a_CellZ);
+
+	/** Returns the key of the cell with the specified coords, for m_Cells. */
+	static Int64 GetCellKey(int a_CellX, int a_CellZ)
+	{
+		return (static_cast<Int64>(a_CellX) << 32) | static_cast<Int64>(static_cast<UInt32>(a_CellZ));
+	}
+
+	/** Checks all the players in the specified cell against a_Pos, updates a_Closest and a_ClosestDistance if any is closer. */
+	void CheckCellForClosest(Int64 a_CellKey, const Vector3d & a_Pos, cPlayer *& a_Closest, double & a_ClosestDistance);
+} ;
+
+
+
+
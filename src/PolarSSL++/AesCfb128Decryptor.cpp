@@ -11,6 +11,7 @@
 
 
 cAesCfb128Decryptor::cAesCfb128Decryptor(void) :
+	m_UseAesNi(false),
 	m_IVOffset(0),
 	m_IsValid(false)
 {
@@ -24,6 +25,7 @@ cAesCfb128Decryptor::~cAesCfb128Decryptor()
 {
 	// Clear the leftover in-memory data, so that they can't be accessed by a backdoor
 	memset(&m_Aes, 0, sizeof(m_Aes));
+	m_AesNi.Clear();
 }
 
 
@@ -35,7 +37,15 @@ void cAesCfb128Decryptor::Init(const Byte a_Key[16], const Byte a_IV[16])
 	ASSERT(!IsValid());  // Cannot Init twice
 	
 	memcpy(m_IV, a_IV, 16);
-	aes_setkey_enc(&m_Aes, a_Key, 128);
+	m_UseAesNi = cAesNi::IsSupported();
+	if (m_UseAesNi)
+	{
+		m_AesNi.SetKey(a_Key);
+	}
+	else
+	{
+		aes_setkey_enc(&m_Aes, a_Key, 128);
+	}
 	m_IsValid = true;
 }
 
@@ -47,6 +57,12 @@ void cAesCfb128Decryptor::ProcessData(Byte * a_DecryptedOut, const Byte * a_Encr
 {
 	ASSERT(IsValid());  // Must Init() first
 	
+	if (m_UseAesNi)
+	{
+		m_AesNi.DecryptCfb8(m_IV, a_DecryptedOut, a_EncryptedIn, a_Length);
+		return;
+	}
+	
 	// PolarSSL doesn't support AES-CFB8, need to implement it manually:
 	for (size_t i = 0; i < a_Length; i++)
 	{
@@ -11,6 +11,7 @@
 
 
 cAesCfb128Encryptor::cAesCfb128Encryptor(void) :
+	m_UseAesNi(false),
 	m_IVOffset(0),
 	m_IsValid(false)
 {
@@ -24,6 +25,7 @@ cAesCfb128Encryptor::~cAesCfb128Encryptor()
 {
 	// Clear the leftover in-memory data, so that they can't be accessed by a backdoor
 	memset(&m_Aes, 0, sizeof(m_Aes));
+	m_AesNi.Clear();
 }
 
 
@@ -36,7 +38,15 @@ void cAesCfb128Encryptor::Init(const Byte a_Key[16], const Byte a_IV[16])
 	ASSERT(m_IVOffset == 0);
 	
 	memcpy(m_IV, a_IV, 16);
-	aes_setkey_enc(&m_Aes, a_Key, 128);
+	m_UseAesNi = cAesNi::IsSupported();
+	if (m_UseAesNi)
+	{
+		m_AesNi.SetKey(a_Key);
+	}
+	else
+	{
+		aes_setkey_enc(&m_Aes, a_Key, 128);
+	}
 	m_IsValid = true;
 }
 
@@ -48,6 +58,12 @@ void cAesCfb128Encryptor::ProcessData(Byte * a_EncryptedOut, const Byte * a_Plai
 {
 	ASSERT(IsValid());  // Must Init() first
 	
+	if (m_UseAesNi)
+	{
+		m_AesNi.EncryptCfb8(m_IV, a_EncryptedOut, a_PlainIn, a_Length);
+		return;
+	}
+	
 	// PolarSSL doesn't do AES-CFB8, so we need to implement it ourselves:
 	for (size_t i = 0; i < a_Length; i++)
 	{
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "polarssl/aes.h"
+#include "AesNi.h"
 
 
 
@@ -32,8 +33,15 @@ public:
 	bool IsValid(void) const { return m_IsValid; }
 	
 protected:
+	/** The software AES, used when the CPU doesn't support AES-NI */
 	aes_context m_Aes;
 	
+	/** The AES-NI implementation, used instead of m_Aes if m_UseAesNi */
+	cAesNi m_AesNi;
+	
+	/** True if the CPU supports AES-NI, so that m_AesNi is used */
+	bool m_UseAesNi;
+	
 	/** The InitialVector, used by the CFB mode encryption */
 	Byte m_IV[16];
 	
@@ -0,0 +1,263 @@
+
+// AesNi.cpp
+
+// Implements the cAesNi class implementing the AES-128 CFB-8 stream cipher using the x86 AES-NI instructions
+
+#include "Globals.h"
+#include "AesNi.h"
+
+#ifdef AES_USE_AESNI
+	#include <wmmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define AESNI_TARGET
+	#else
+		#include <cpuid.h>
+		#define AESNI_TARGET __attribute__((target("aes,sse2")))
+	#endif
+#endif
+
+
+
+
+
+/** The number of blocks that the decryption interleaves, to hide the latency of the AES instructions. */
+static const size_t DECRYPT_INTERLEAVE = 8;
+
+
+
+
+
+#ifdef AES_USE_AESNI
+
+/** Returns true if the CPU supports the AES-NI instructions. */
+static bool HasAesNiInstructions(void)
+{
+	#ifdef _MSC_VER
+		int Info[4];
+		__cpuid(Info, 1);
+		return ((Info[2] & (1 << 25)) != 0);
+	#else
+		unsigned int Eax, Ebx, Ecx, Edx;
+		if (__get_cpuid(1, &Eax, &Ebx, &Ecx, &Edx) == 0)
+		{
+			return false;
+		}
+		return ((Ecx & bit_AES) != 0);
+	#endif
+}
+
+
+
+
+
+/** Computes the next round key from the previous one and the result of _mm_aeskeygenassist_si128() on it. */
+AESNI_TARGET static inline __m128i ExpandKeyStep(__m128i a_Key, __m128i a_KeyGenAssist)
+{
+	a_KeyGenAssist = _mm_shuffle_epi32(a_KeyGenAssist, _MM_SHUFFLE(3, 3, 3, 3));
+	a_Key = _mm_xor_si128(a_Key, _mm_slli_si128(a_Key, 4));
+	a_Key = _mm_xor_si128(a_Key, _mm_slli_si128(a_Key, 4));
+	a_Key = _mm_xor_si128(a_Key, _mm_slli_si128(a_Key, 4));
+	return _mm_xor_si128(a_Key, a_KeyGenAssist);
+}
+
+
+
+
+
+/** Loads the round keys into a_Keys. */
+AESNI_TARGET static inline void LoadRoundKeys(const Byte (&a_RoundKeys)[11][16], __m128i (&a_Keys)[11])
+{
+	for (int i = 0; i < 11; i++)
+	{
+		a_Keys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_RoundKeys[i]));
+	}
+}
+
+
+
+
+
+/** Encrypts a single block using the loaded round keys. */
+AESNI_TARGET static inline __m128i EncryptBlock(__m128i a_Block, const __m128i (&a_Keys)[11])
+{
+	a_Block = _mm_xor_si128(a_Block, a_Keys[0]);
+	for (int i = 1; i < 10; i++)
+	{
+		a_Block = _mm_aesenc_si128(a_Block, a_Keys[i]);
+	}
+	return _mm_aesenclast_si128(a_Block, a_Keys[10]);
+}
+
+
+
+
+
+/** Returns the first byte of the block. */
+AESNI_TARGET static inline Byte FirstByte(__m128i a_Block)
+{
+	return static_cast<Byte>(_mm_cvtsi128_si32(a_Block) & 0xff);
+}
+
+#endif  // AES_USE_AESNI
+
+
+
+
+
+bool cAesNi::IsSupported(void)
+{
+	#ifdef AES_USE_AESNI
+		static const bool IsCpuSupported = HasAesNiInstructions();
+		return IsCpuSupported;
+	#else
+		return false;
+	#endif
+}
+
+
+
+
+
+#ifdef AES_USE_AESNI
+
+AESNI_TARGET void cAesNi::SetKey(const Byte a_Key[16])
+{
+	ASSERT(IsSupported());
+
+	// The round constants need to be immediate values, hence the macro:
+	#define EXPAND_KEY(Idx, RoundConstant) \
+		Key = ExpandKeyStep(Key, _mm_aeskeygenassist_si128(Key, RoundConstant)); \
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(m_RoundKeys[Idx]), Key);
+
+	__m128i Key = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Key));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(m_RoundKeys[0]), Key);
+	EXPAND_KEY(1, 0x01)
+	EXPAND_KEY(2, 0x02)
+	EXPAND_KEY(3, 0x04)
+	EXPAND_KEY(4, 0x08)
+	EXPAND_KEY(5, 0x10)
+	EXPAND_KEY(6, 0x20)
+	EXPAND_KEY(7, 0x40)
+	EXPAND_KEY(8, 0x80)
+	EXPAND_KEY(9, 0x1b)
+	EXPAND_KEY(10, 0x36)
+
+	#undef EXPAND_KEY
+}
+
+
+
+
+
+AESNI_TARGET void cAesNi::EncryptCfb8(Byte * a_IV, Byte * a_EncryptedOut, const Byte * a_PlainIn, size_t a_Length) const
+{
+	__m128i Keys[NUM_ROUND_KEYS];
+	LoadRoundKeys(m_RoundKeys, Keys);
+
+	// Each output byte is shifted into the IV for the next byte:
+	__m128i IV = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_IV));
+	for (size_t i = 0; i < a_Length; i++)
+	{
+		Byte Encrypted = a_PlainIn[i] ^ FirstByte(EncryptBlock(IV, Keys));
+		a_EncryptedOut[i] = Encrypted;
+		IV = _mm_or_si128(_mm_srli_si128(IV, 1), _mm_slli_si128(_mm_cvtsi32_si128(Encrypted), 15));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(a_IV), IV);
+}
+
+
+
+
+
+AESNI_TARGET void cAesNi::DecryptCfb8(Byte * a_IV, Byte * a_PlainOut, const Byte * a_EncryptedIn, size_t a_Length) const
+{
+	__m128i Keys[NUM_ROUND_KEYS];
+	LoadRoundKeys(m_RoundKeys, Keys);
+
+	// The IV for each byte is the 16 encrypted bytes preceding it. They are copied into Window before any output is written,
+	// so that the decryption works in place as well:
+	Byte Window[16 + DECRYPT_INTERLEAVE];
+	memcpy(Window, a_IV, 16);
+	size_t i = 0;
+	for (; i + DECRYPT_INTERLEAVE <= a_Length; i += DECRYPT_INTERLEAVE)
+	{
+		memcpy(Window + 16, a_EncryptedIn + i, DECRYPT_INTERLEAVE);
+		__m128i Blocks[DECRYPT_INTERLEAVE];
+		for (size_t j = 0; j < DECRYPT_INTERLEAVE; j++)
+		{
+			Blocks[j] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Window + j)), Keys[0]);
+		}
+		for (int Round = 1; Round < 10; Round++)
+		{
+			for (size_t j = 0; j < DECRYPT_INTERLEAVE; j++)
+			{
+				Blocks[j] = _mm_aesenc_si128(Blocks[j], Keys[Round]);
+			}
+		}
+		for (size_t j = 0; j < DECRYPT_INTERLEAVE; j++)
+		{
+			a_PlainOut[i + j] = Window[16 + j] ^ FirstByte(_mm_aesenclast_si128(Blocks[j], Keys[10]));
+		}
+		memmove(Window, Window + DECRYPT_INTERLEAVE, 16);
+	}
+
+	// The remaining bytes one at a time:
+	for (; i < a_Length; i++)
+	{
+		Byte Encrypted = a_EncryptedIn[i];
+		a_PlainOut[i] = Encrypted ^ FirstByte(EncryptBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Window)), Keys));
+		memmove(Window, Window + 1, 15);
+		Window[15] = Encrypted;
+	}
+	memcpy(a_IV, Window, 16);
+}
+
+#else  // AES_USE_AESNI
+
+void cAesNi::SetKey(const Byte a_Key[16])
+{
+	UNUSED(a_Key);
+	ASSERT(!"AES-NI is not available");
+}
+
+
+
+
+
+void cAesNi::EncryptCfb8(Byte * a_IV, Byte * a_EncryptedOut, const Byte * a_PlainIn, size_t a_Length) const
+{
+	UNUSED(a_IV);
+	UNUSED(a_EncryptedOut);
+	UNUSED(a_PlainIn);
+	UNUSED(a_Length);
+	ASSERT(!"AES-NI is not available");
+}
+
+
+
+
+
+void cAesNi::DecryptCfb8(Byte * a_IV, Byte * a_PlainOut, const Byte * a_EncryptedIn, size_t a_Length) const
+{
+	UNUSED(a_IV);
+	UNUSED(a_PlainOut);
+	UNUSED(a_EncryptedIn);
+	UNUSED(a_Length);
+	ASSERT(!"AES-NI is not available");
+}
+
+#endif  // else AES_USE_AESNI
+
+
+
+
+
+void cAesNi::Clear(void)
+{
+	memset(m_RoundKeys, 0, sizeof(m_RoundKeys));
+}
+
+
+
+
@@ -0,0 +1,61 @@
+
+// AesNi.h
+
+// Declares the cAesNi class implementing the AES-128 CFB-8 stream cipher using the x86 AES-NI instructions
+
+
+
+
+
+#pragma once
+
+
+
+
+
+// The AES-NI implementation is compiled in on x86 with the compilers that can target the AES instructions per function,
+// so that the binary still runs on CPUs without them; whether the CPU has them is checked at runtime, see cAesNi::IsSupported().
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#if defined(_MSC_VER) || defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))
+		#define AES_USE_AESNI
+	#endif
+#endif
+
+
+
+
+
+/** The AES-128 CFB-8 stream cipher, as used by the protocol encryption, implemented using the AES-NI instructions.
+Used by cAesCfb128Encryptor and cAesCfb128Decryptor when IsSupported(), they fall back to PolarSSL's software AES otherwise.
+Each CFB-8 byte needs a whole AES block operation. The encryption has to do them one after another, because each block's input
+includes the previous output byte; the decryption knows all the inputs beforehand and interleaves several blocks at a time.
+The cipher state (IV) is kept by the caller, so that it can switch between the implementations. */
+class cAesNi
+{
+public:
+	/** Returns true if the AES-NI implementation is compiled in and the CPU supports it. The CPU is checked only once. */
+	static bool IsSupported(void);
+
+	/** Expands the key into the round keys. Only valid if IsSupported(). */
+	void SetKey(const Byte a_Key[16]);
+
+	/** Encrypts a_Length bytes of a_PlainIn into a_EncryptedOut, updating the 16-byte a_IV. The buffers may be the same. */
+	void EncryptCfb8(Byte * a_IV, Byte * a_EncryptedOut, const Byte * a_PlainIn, size_t a_Length) const;
+
+	/** Decrypts a_Length bytes of a_EncryptedIn into a_PlainOut, updating the 16-byte a_IV. The buffers may be the same. */
+	void DecryptCfb8(Byte * a_IV, Byte * a_PlainOut, const Byte * a_EncryptedIn, size_t a_Length) const;
+
+	/** Clears the round keys, so that they don't linger in memory. */
+	void Clear(void);
+
+protected:
+	/** The number of the round keys of AES-128, including the initial whitening key. */
+	static const int NUM_ROUND_KEYS = 11;
+
+	/** The expanded key. */
+	Byte m_RoundKeys[NUM_ROUND_KEYS][16];
+} ;
+
+
+
+
@@ -0,0 +1,350 @@
+
+// Pregenerator.cpp
+
+// Implements the cPregenerator class that generates, lights and saves a rectangular area of a world in bulk
+
+#include "Globals.h"
+
+#include "Pregenerator.h"
+#include "World.h"
+#include "IniFile.h"
+
+
+
+
+
+/** Interval between the progress reports in the log. */
+static const std::chrono::seconds PROGRESS_REPORT_INTERVAL(5);
+
+/** Interval in which the finished chunks are unloaded from the world and the progress is stored. */
+static const std::chrono::seconds UNLOAD_INTERVAL(10);
+
+/** Number of chunks in process per generator and lighting worker, when the pipeline depth is chosen automatically.
+Each worker needs a few chunks queued so that it doesn't idle between the chunks, and the lighting needs the neighbors of each chunk. */
+static const int CHUNKS_IN_FLIGHT_PER_WORKER = 8;
+
+/** The minimum pipeline depth chosen automatically. */
+static const int MIN_AUTO_IN_FLIGHT = 16;
+
+
+
+
+
+cPregenerator::cPregenerator(cWorld & a_World) :
+	super(Printf("Pregenerator: %s", a_World.GetName().c_str())),
+	m_World(a_World),
+	m_PreparedCallback(*this),
+	m_SavedCallback(*this),
+	m_MinChunkX(0),
+	m_MinChunkZ(0),
+	m_MaxChunkX(0),
+	m_MaxChunkZ(0),
+	m_MaxInFlight(1),
+	m_NumChunks(0),
+	m_NextIdx(0),
+	m_NumFinished(0),
+	m_IsRunning(false),
+	m_ShouldResume(true),
+	m_ChunksPerSec(0)
+{
+}
+
+
+
+
+
+cPregenerator::~cPregenerator()
+{
+	StopJob();
+}
+
+
+
+
+
+bool cPregenerator::StartJob(int a_MinChunkX, int a_MinChunkZ, int a_MaxChunkX, int a_MaxChunkZ, int a_MaxInFlight)
+{
+	return StartJobAt(a_MinChunkX, a_MinChunkZ, a_MaxChunkX, a_MaxChunkZ, a_MaxInFlight, 0);
+}
+
+
+
+
+
+bool cPregenerator::ResumeJob(void)
+{
+	cIniFile IniFile;
+	if (!IniFile.ReadFile(GetProgressFileName(), false))
+	{
+		return false;
+	}
+	int ResumeIdx = IniFile.GetValueI("Pregeneration", "ResumeIdx", 0);
+	if (!StartJobAt(
+		IniFile.GetValueI("Pregeneration", "MinChunkX", 0),
+		IniFile.GetValueI("Pregeneration", "MinChunkZ", 0),
+		IniFile.GetValueI("Pregeneration", "MaxChunkX", -1),
+		IniFile.GetValueI("Pregeneration", "MaxChunkZ", -1),
+		IniFile.GetValueI("Pregeneration", "MaxInFlight", 1),
+		ResumeIdx
+	))
+	{
+		LOGWARNING("%s: Invalid pregeneration progress file %s, ignoring.", m_World.GetName().c_str(), GetProgressFileName().c_str());
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+void cPregenerator::StopJob(bool a_ShouldResume)
+{
+	m_ShouldResume = a_ShouldResume;
+	m_ShouldTerminate = true;
+	m_evtChunkFinished.Set();
+	super::Stop();
+}
+
+
+
+
+
+bool cPregenerator::StartJobAt(int a_MinChunkX, int a_MinChunkZ, int a_MaxChunkX, int a_MaxChunkZ, int a_MaxInFlight, int a_StartIdx)
+{
+	Int64 NumChunks = (static_cast<Int64>(a_MaxChunkX) - a_MinChunkX + 1) * (static_cast<Int64>(a_MaxChunkZ) - a_MinChunkZ + 1);
+	if ((a_MaxChunkX < a_MinChunkX) || (a_MaxChunkZ < a_MinChunkZ) || (NumChunks > std::numeric_limits<int>::max()))
+	{
+		return false;
+	}
+
+	// The generator and the lighting run several workers each, keep enough chunks in process to keep all of them busy:
+	if (a_MaxInFlight <= 0)
+	{
+		size_t NumWorkers = m_World.GetGenerator().GetNumWorkers() + m_World.GetLightingThread().GetNumWorkers();
+		a_MaxInFlight = std::max(MIN_AUTO_IN_FLIGHT, static_cast<int>(NumWorkers) * CHUNKS_IN_FLIGHT_PER_WORKER);
+	}
+
+	{
+		cCSLock Lock(m_CS);
+		if (m_IsRunning || !m_InFlight.empty())
+		{
+			return false;
+		}
+		m_MinChunkX = a_MinChunkX;
+		m_MinChunkZ = a_MinChunkZ;
+		m_MaxChunkX = a_MaxChunkX;
+		m_MaxChunkZ = a_MaxChunkZ;
+		m_MaxInFlight = a_MaxInFlight;
+		m_NumChunks = static_cast<int>(NumChunks);
+		m_NextIdx = Clamp(a_StartIdx, 0, m_NumChunks);
+		m_NumFinished = m_NextIdx;
+		m_ChunksPerSec = 0;
+		m_IsRunning = true;
+	}
+
+	// Join the thread of the previous job, if any, before starting anew:
+	super::Stop();
+	m_ShouldTerminate = false;
+	m_ShouldResume = true;
+	SaveProgress();
+	LOG("Pregenerating world %s, chunks [%d, %d] to [%d, %d], starting at chunk %d of %d",
+		m_World.GetName().c_str(), a_MinChunkX, a_MinChunkZ, a_MaxChunkX, a_MaxChunkZ, m_NextIdx, m_NumChunks
+	);
+	return super::Start();
+}
+
+
+
+
+
+AString cPregenerator::GetStatus(void)
+{
+	cCSLock Lock(m_CS);
+	if (!m_IsRunning)
+	{
+		return Printf("No pregeneration is running in world %s", m_World.GetName().c_str());
+	}
+	return Printf("Pregenerating world %s: %d of %d chunks (%.02f%%), %.02f chunks / sec, %u chunks in process",
+		m_World.GetName().c_str(), m_NumFinished, m_NumChunks, 100.0 * m_NumFinished / m_NumChunks, m_ChunksPerSec,
+		static_cast<unsigned>(m_InFlight.size())
+	);
+}
+
+
+
+
+
+AString cPregenerator::GetProgressFileName(void) const
+{
+	return Printf("%s%cpregen.ini", m_World.GetName().c_str(), cFile::PathSeparator);
+}
+
+
+
+
+
+void cPregenerator::SaveProgress(void)
+{
+	cIniFile IniFile;
+	{
+		cCSLock Lock(m_CS);
+		IniFile.SetValueI("Pregeneration", "MinChunkX",   m_MinChunkX);
+		IniFile.SetValueI("Pregeneration", "MinChunkZ",   m_MinChunkZ);
+		IniFile.SetValueI("Pregeneration", "MaxChunkX",   m_MaxChunkX);
+		IniFile.SetValueI("Pregeneration", "MaxChunkZ",   m_MaxChunkZ);
+		IniFile.SetValueI("Pregeneration", "MaxInFlight", m_MaxInFlight);
+
+		// Resume from the first chunk not finished yet; chunks past it that have finished will be processed again:
+		IniFile.SetValueI("Pregeneration", "ResumeIdx",   m_InFlight.empty() ? m_NextIdx : *m_InFlight.begin());
+	}
+	IniFile.WriteFile(GetProgressFileName());
+}
+
+
+
+
+
+void cPregenerator::IdxToChunk(int a_Idx, int & a_ChunkX, int & a_ChunkZ) const
+{
+	int Width = m_MaxChunkX - m_MinChunkX + 1;
+	a_ChunkX = m_MinChunkX + a_Idx % Width;
+	a_ChunkZ = m_MinChunkZ + a_Idx / Width;
+}
+
+
+
+
+
+int cPregenerator::ChunkToIdx(int a_ChunkX, int a_ChunkZ) const
+{
+	int Width = m_MaxChunkX - m_MinChunkX + 1;
+	return (a_ChunkZ - m_MinChunkZ) * Width + (a_ChunkX - m_MinChunkX);
+}
+
+
+
+
+
+void cPregenerator::OnChunkPrepared(int a_ChunkX, int a_ChunkZ)
+{
+	// The light isn't stored until the chunk is saved, and lighting doesn't mark the chunk dirty, so save it explicitly:
+	if (m_World.IsChunkValid(a_ChunkX, a_ChunkZ))
+	{
+		m_World.GetStorage().QueueSaveChunk(a_ChunkX, a_ChunkZ, &m_SavedCallback);
+	}
+	else
+	{
+		OnChunkFinished(a_ChunkX, a_ChunkZ);
+	}
+}
+
+
+
+
+
+void cPregenerator::OnChunkFinished(int a_ChunkX, int a_ChunkZ)
+{
+	{
+		cCSLock Lock(m_CS);
+		m_InFlight.erase(ChunkToIdx(a_ChunkX, a_ChunkZ));
+		m_NumFinished += 1;
+	}
+	m_evtChunkFinished.Set();
+}
+
+
+
+
+
+void cPregenerator::Execute(void)
+{
+	auto StartTime = std::chrono::steady_clock::now();
+	auto LastReportTime = StartTime;
+	auto LastUnloadTime = StartTime;
+	int NumFinished;
+	{
+		cCSLock Lock(m_CS);
+		NumFinished = m_NumFinished;
+	}
+	int LastReportNumFinished = NumFinished;
+	while (!m_ShouldTerminate)
+	{
+		// Fill the pipeline:
+		for (;;)
+		{
+			int ChunkX, ChunkZ;
+			{
+				cCSLock Lock(m_CS);
+				if ((m_NextIdx >= m_NumChunks) || (static_cast<int>(m_InFlight.size()) >= m_MaxInFlight))
+				{
+					break;
+				}
+				IdxToChunk(m_NextIdx, ChunkX, ChunkZ);
+				m_InFlight.insert(m_NextIdx);
+				m_NextIdx += 1;
+			}
+			m_World.PrepareChunk(ChunkX, ChunkZ, &m_PreparedCallback);
+		}
+
+		bool IsFinished;
+		{
+			cCSLock Lock(m_CS);
+			IsFinished = ((m_NextIdx >= m_NumChunks) && m_InFlight.empty());
+			NumFinished = m_NumFinished;
+		}
+		if (IsFinished)
+		{
+			break;
+		}
+		m_evtChunkFinished.Wait(1000);
+
+		// Report the progress:
+		auto Now = std::chrono::steady_clock::now();
+		if (Now - LastReportTime >= PROGRESS_REPORT_INTERVAL)
+		{
+			auto Millisec = std::chrono::duration_cast<std::chrono::milliseconds>(Now - LastReportTime).count();
+			{
+				cCSLock Lock(m_CS);
+				m_ChunksPerSec = static_cast<double>(NumFinished - LastReportNumFinished) * 1000 / std::max<Int64>(Millisec, 1);
+			}
+			LastReportNumFinished = NumFinished;
+			LastReportTime = Now;
+			LOG("%s", GetStatus().c_str());
+		}
+
+		// Let the world unload the finished chunks, so that they don't pile up in memory; store the progress:
+		if (Now - LastUnloadTime >= UNLOAD_INTERVAL)
+		{
+			LastUnloadTime = Now;
+			m_World.QueueUnloadUnusedChunks();
+			SaveProgress();
+		}
+	}
+
+	if (m_ShouldTerminate)
+	{
+		if (m_ShouldResume)
+		{
+			SaveProgress();
+			LOG("Pregeneration of world %s stopped, it will resume upon the next start.", m_World.GetName().c_str());
+		}
+		else
+		{
+			cFile::Delete(GetProgressFileName());
+			LOG("Pregeneration of world %s cancelled.", m_World.GetName().c_str());
+		}
+	}
+	else
+	{
+		cFile::Delete(GetProgressFileName());
+		m_World.QueueUnloadUnusedChunks();
+		auto Seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - StartTime).count();
+		LOG("Pregeneration of world %s finished, %d chunks in %d seconds.", m_World.GetName().c_str(), m_NumChunks, static_cast<int>(Seconds));
+	}
+	m_IsRunning = false;
+}
+
+
+
+
@@ -0,0 +1,161 @@
+
+// Pregenerator.h
+
+// Declares the cPregenerator class that generates, lights and saves a rectangular area of a world in bulk
+
+
+
+
+
+#pragma once
+
+#include "OSSupport/IsThread.h"
+#include "ChunkDef.h"
+#include <atomic>
+
+
+
+
+
+// fwd:
+class cWorld;
+
+
+
+
+
+/** Generates and lights all the chunks in a rectangular area of a world, such as within the world border, in the background.
+The chunks go through a pipeline - load or generate, light, save - with a limited number of chunks in process at once.
+The generator and the lighting both process the chunks on several worker threads, so the pipeline depth, rather than
+the job's single thread, determines how many of the workers are kept busy.
+The finished chunks are saved and left for the world to unload, so that the memory use stays bounded no matter the area size.
+The job's progress is stored in the world folder, an interrupted job is resumed by ResumeJob() when the world starts again.
+The job may be started and stopped from any thread. */
+class cPregenerator :
+	public cIsThread
+{
+	typedef cIsThread super;
+
+public:
+
+	cPregenerator(cWorld & a_World);
+
+	virtual ~cPregenerator();
+
+	/** Starts pregenerating the chunks in the specified rectangle (inclusive), with at most a_MaxInFlight chunks in process at once.
+	If a_MaxInFlight is 0 or less, the pipeline depth is chosen based on the number of generator and lighting workers.
+	Returns false if the area is invalid or a job is still running (or still finishing its chunks in process). */
+	bool StartJob(int a_MinChunkX, int a_MinChunkZ, int a_MaxChunkX, int a_MaxChunkZ, int a_MaxInFlight);
+
+	/** Resumes the job whose progress is stored in the world folder, if there's any. Returns true if a job was resumed. */
+	bool ResumeJob(void);
+
+	/** Stops the running job. If a_ShouldResume is true, its progress is kept so that it resumes when the world starts again,
+	otherwise the job is dropped. Doesn't wait for the chunks in process. */
+	void StopJob(bool a_ShouldResume = true);
+
+	/** Returns true if a job is running. */
+	bool IsRunning(void) const { return m_IsRunning; }
+
+	/** Returns a one-line human-readable description of the job's progress. */
+	AString GetStatus(void);
+
+protected:
+
+	/** Hands the chunks that have been prepared over to the storage for saving. */
+	class cPreparedCallback :
+		public cChunkCoordCallback
+	{
+	public:
+		cPreparedCallback(cPregenerator & a_Pregenerator) : m_Pregenerator(a_Pregenerator) {}
+
+		// cChunkCoordCallback override:
+		virtual void Call(int a_ChunkX, int a_ChunkZ) override { m_Pregenerator.OnChunkPrepared(a_ChunkX, a_ChunkZ); }
+
+	protected:
+		cPregenerator & m_Pregenerator;
+	};
+
+	/** Marks the chunks that have been saved as finished. */
+	class cSavedCallback :
+		public cChunkCoordCallback
+	{
+	public:
+		cSavedCallback(cPregenerator & a_Pregenerator) : m_Pregenerator(a_Pregenerator) {}
+
+		// cChunkCoordCallback override:
+		virtual void Call(int a_ChunkX, int a_ChunkZ) override { m_Pregenerator.OnChunkFinished(a_ChunkX, a_ChunkZ); }
+
+	protected:
+		cPregenerator & m_Pregenerator;
+	};
+
+
+	cWorld & m_World;
+
+	cPreparedCallback m_PreparedCallback;
+	cSavedCallback    m_SavedCallback;
+
+	/** Protects the job state below against multithreaded access. Never held while calling into the world. */
+	cCriticalSection m_CS;
+
+	/** The job's area, inclusive. */
+	int m_MinChunkX;
+	int m_MinChunkZ;
+	int m_MaxChunkX;
+	int m_MaxChunkZ;
+
+	/** The maximum number of chunks in the pipeline at once, shared by all the generator and lighting workers. */
+	int m_MaxInFlight;
+
+	/** Total number of chunks in the area. */
+	int m_NumChunks;
+
+	/** Index of the next chunk to be put into the pipeline. The chunks are processed row by row, by increasing X. */
+	int m_NextIdx;
+
+	/** Number of chunks that have gone through the whole pipeline, including those finished before a resume. */
+	int m_NumFinished;
+
+	/** Indices of the chunks currently in the pipeline. Their minimum is where the job resumes after an interruption. */
+	std::set<int> m_InFlight;
+
+	/** True while the job's thread is running. */
+	std::atomic<bool> m_IsRunning;
+
+	/** Whether the job's progress is to be kept for resuming when the job is stopped. */
+	std::atomic<bool> m_ShouldResume;
+
+	/** Number of chunks per second at the last progress report, for GetStatus(). */
+	double m_ChunksPerSec;
+
+	/** Set whenever a chunk leaves the pipeline, wakes up the job's thread. */
+	cEvent m_evtChunkFinished;
+
+
+	/** Starts the job in the specified area at the specified chunk index. Used by StartJob() and ResumeJob(). */
+	bool StartJobAt(int a_MinChunkX, int a_MinChunkZ, int a_MaxChunkX, int a_MaxChunkZ, int a_MaxInFlight, int a_StartIdx);
+
+	/** Returns the name of the file that stores the job's progress. */
+	AString GetProgressFileName(void) const;
+
+	/** Writes the job's area and resume point into the progress file. */
+	void SaveProgress(void);
+
+	/** Converts between the chunk coords and their index in the job. */
+	void IdxToChunk(int a_Idx, int & a_ChunkX, int & a_ChunkZ) const;
+	int ChunkToIdx(int a_ChunkX, int a_ChunkZ) const;
+
+	/** Called when the chunk has been loaded or generated, and lit. Queues it for saving. */
+	void OnChunkPrepared(int a_ChunkX, int a_ChunkZ);
+
+	/** Called when the chunk has left the pipeline (saved, or failed). */
+	void OnChunkFinished(int a_ChunkX, int a_ChunkZ);
+
+	// cIsThread override:
+	virtual void Execute(void) override;
+} ;
+
+
+
+
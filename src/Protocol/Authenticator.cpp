@@ -10,7 +10,9 @@
 #include "../IniFile.h"
 #include "json/json.h"
 
-#include "PolarSSL++/BlockingSslClientSocket.h"
+#include "../OSSupport/Network.h"
+#include "PolarSSL++/BufferedSslContext.h"
+#include "PolarSSL++/X509Cert.h"
 
 
 
@@ -18,12 +20,557 @@
 
 #define DEFAULT_AUTH_SERVER "sessionserver.mojang.com"
 #define DEFAULT_AUTH_ADDRESS "/session/minecraft/hasJoined?username=%USERNAME%&serverId=%SERVERID%"
+#define DEFAULT_MAX_CONCURRENT_REQUESTS 8
+
+/** The maximum size of a single response from the auth server; larger responses are considered an error. */
+static const size_t MAX_RESPONSE_SIZE = 1 MiB;
+
+
+
+
+
+/** Decodes the chunked HTTP body starting at a_Start in a_Data into a_Body.
+Returns false if the body hasn't been received completely yet. */
+static bool DecodeChunkedBody(const AString & a_Data, size_t a_Start, AString & a_Body)
+{
+	a_Body.clear();
+	size_t Pos = a_Start;
+	for (;;)
+	{
+		size_t LineEnd = a_Data.find("\r\n", Pos);
+		if (LineEnd == AString::npos)
+		{
+			return false;
+		}
+
+		// The chunk size is a hex number, optionally followed by chunk extensions:
+		size_t ChunkSize = 0;
+		for (size_t i = Pos; (i < LineEnd) && (i < Pos + 8); i++)
+		{
+			char c = a_Data[i];
+			if ((c >= '0') && (c <= '9'))
+			{
+				ChunkSize = ChunkSize * 16 + static_cast<size_t>(c - '0');
+			}
+			else if ((c >= 'a') && (c <= 'f'))
+			{
+				ChunkSize = ChunkSize * 16 + static_cast<size_t>(c - 'a' + 10);
+			}
+			else if ((c >= 'A') && (c <= 'F'))
+			{
+				ChunkSize = ChunkSize * 16 + static_cast<size_t>(c - 'A' + 10);
+			}
+			else
+			{
+				break;
+			}
+		}
+		Pos = LineEnd + 2;
+
+		if (ChunkSize == 0)
+		{
+			// The last chunk, followed by optional trailers and an empty line:
+			return ((a_Data.compare(Pos, 2, "\r\n") == 0) || (a_Data.find("\r\n\r\n", Pos) != AString::npos));
+		}
+		if (a_Data.size() < Pos + ChunkSize + 2)
+		{
+			return false;
+		}
+		a_Body.append(a_Data, Pos, ChunkSize);
+		Pos += ChunkSize + 2;  // Skip the CRLF after the chunk data
+	}
+}
+
+
+
+
+
+/** Parses the HTTP response received in a_Response. Returns false if the response hasn't been received completely yet.
+If a_IsRemoteClosed, the server has closed the connection after sending a_Response, which ends a response without a length.
+Returns the status code (0 for a malformed response), the body and whether the connection may be reused for another request. */
+static bool ParseHttpResponse(const AString & a_Response, bool a_IsRemoteClosed, int & a_StatusCode, AString & a_Body, bool & a_IsReusable)
+{
+	size_t HeadersEnd = a_Response.find("\r\n\r\n");
+	if (HeadersEnd == AString::npos)
+	{
+		return false;
+	}
+	a_StatusCode = 0;
+	a_Body.clear();
+	a_IsReusable = false;
+
+	// Check the HTTP status line, such as "HTTP/1.1 200 OK":
+	AStringVector Lines = StringSplit(a_Response.substr(0, HeadersEnd), "\n");
+	if (Lines.empty())
+	{
+		return true;
+	}
+	AStringVector StatusLine = StringSplit(TrimString(Lines[0]), " ");
+	int StatusCode = 0;
+	if ((StatusLine.size() < 2) || (StatusLine[0].compare(0, 5, "HTTP/") != 0) || !StringToInteger(StatusLine[1], StatusCode))
+	{
+		return true;
+	}
+
+	// Process the headers; HTTP/1.1 connections are persistent unless the server says otherwise:
+	bool IsReusable = (StatusLine[0] == "HTTP/1.1");
+	bool IsChunked = false;
+	bool HasContentLength = false;
+	size_t ContentLength = 0;
+	for (size_t i = 1; i < Lines.size(); i++)
+	{
+		size_t Colon = Lines[i].find(':');
+		if (Colon == AString::npos)
+		{
+			continue;
+		}
+		AString Name = StrToLower(TrimString(Lines[i].substr(0, Colon)));
+		AString Value = StrToLower(TrimString(Lines[i].substr(Colon + 1)));
+		if (Name == "content-length")
+		{
+			HasContentLength = StringToInteger(Value, ContentLength);
+		}
+		else if (Name == "transfer-encoding")
+		{
+			IsChunked = (Value.find("chunked") != AString::npos);
+		}
+		else if (Name == "connection")
+		{
+			if (Value.find("close") != AString::npos)
+			{
+				IsReusable = false;
+			}
+			else if (Value.find("keep-alive") != AString::npos)
+			{
+				IsReusable = true;
+			}
+		}
+	}
+
+	// Extract the body:
+	size_t BodyStart = HeadersEnd + 4;
+	if ((StatusCode == 204) || (StatusCode == 304))
+	{
+		// These responses never have a body
+	}
+	else if (IsChunked)
+	{
+		if (!DecodeChunkedBody(a_Response, BodyStart, a_Body))
+		{
+			return false;
+		}
+	}
+	else if (HasContentLength)
+	{
+		if (a_Response.size() < BodyStart + ContentLength)
+		{
+			return false;
+		}
+		a_Body.assign(a_Response, BodyStart, ContentLength);
+	}
+	else
+	{
+		// The body lasts until the server closes the connection:
+		if (!a_IsRemoteClosed)
+		{
+			return false;
+		}
+		a_Body.assign(a_Response, BodyStart, AString::npos);
+		IsReusable = false;
+	}
+
+	a_StatusCode = StatusCode;
+	a_IsReusable = IsReusable && !a_IsRemoteClosed;
+	return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAuthenticator::cConnection:
+
+class cAuthenticator::cConnection :
+	public cTCPLink::cCallbacks,
+	public std::enable_shared_from_this<cAuthenticator::cConnection>
+{
+public:
+	cConnection(cAuthenticator & a_Authenticator, const AString & a_Server, const cX509CertPtr & a_TrustedRootCerts) :
+		m_Authenticator(&a_Authenticator),
+		m_Server(a_Server),
+		m_TrustedRootCerts(a_TrustedRootCerts),
+		m_IsConnecting(false),
+		m_IsConnected(false),
+		m_IsClosed(false),
+		m_HasUser(false),
+		m_NumRequests(0)
+	{
+	}
+
+
+	/** Sends the request for the user, connecting to the server first if not connected yet.
+	Returns false if the connection has been closed in the meantime; the request isn't sent then.
+	Failures after the request has been accepted are reported through cAuthenticator::OnConnectionClosed(). */
+	bool StartRequest(const cUser & a_User, const AString & a_Request)
+	{
+		cCSLock Lock(m_CS);
+		if (m_IsClosed || (m_Authenticator == nullptr))
+		{
+			return false;
+		}
+		ASSERT(!m_HasUser);
+		m_User = a_User;
+		m_User.m_NumAttempts += 1;
+		m_HasUser = true;
+		m_NumRequests += 1;
+		m_Response.clear();
+		m_PendingRequest = a_Request;
+
+		if (m_IsConnected)
+		{
+			Flush();
+		}
+		else if (!m_IsConnecting && !Connect())
+		{
+			Close(false);
+		}
+		return true;
+	}
+
+
+	/** Disconnects the connection from the authenticator, which is being stopped, and closes it. */
+	void Detach(void)
+	{
+		cCSLock Lock(m_CS);
+		m_Authenticator = nullptr;
+		m_IsClosed = true;
+		if (m_Link != nullptr)
+		{
+			m_Link->Close();
+			m_Link.reset();
+		}
+	}
+
+protected:
+	/** The callbacks for the asynchronous connecting. */
+	class cConnectCallbacks :
+		public cNetwork::cConnectCallbacks
+	{
+	public:
+		cConnectCallbacks(const cConnectionPtr & a_Connection) :
+			m_Connection(a_Connection)
+		{
+		}
+
+	protected:
+		cConnectionPtr m_Connection;
+
+		virtual void OnConnected(cTCPLink & a_Link) override
+		{
+			UNUSED(a_Link);
+			m_Connection->OnConnected();
+		}
+
+		virtual void OnError(int a_ErrorCode, const AString & a_ErrorMsg) override
+		{
+			UNUSED(a_ErrorCode);
+			m_Connection->OnConnectError(a_ErrorMsg);
+		}
+	} ;
+
+
+	/** Protects all the members against multithreaded access.
+	Held while calling into the authenticator, so that Detach() waits for any such call to finish. */
+	cCriticalSection m_CS;
+
+	/** The authenticator that owns this connection; nullptr once detached. */
+	cAuthenticator * m_Authenticator;
+
+	/** The auth server to connect to. */
+	AString m_Server;
+
+	/** The trusted root certs that the server's cert is checked against. */
+	cX509CertPtr m_TrustedRootCerts;
+
+	/** The link to the server, valid once created while connecting. */
+	cTCPLinkPtr m_Link;
+
+	/** The SSL context encrypting the data on m_Link. */
+	cBufferedSslContext m_Ssl;
+
+	/** Set while the TCP connection is being established. */
+	bool m_IsConnecting;
+
+	/** Set once the TCP connection has been established. */
+	bool m_IsConnected;
+
+	/** Set once the connection has been closed; it cannot be used for any more requests. */
+	bool m_IsClosed;
+
+	/** Set while a request for m_User is in progress. */
+	bool m_HasUser;
+
+	/** The user whose request is in progress, valid if m_HasUser. */
+	cUser m_User;
+
+	/** The number of requests sent over this connection, including the one in progress. */
+	int m_NumRequests;
+
+	/** The plaintext of the request that hasn't been accepted by the SSL yet (waiting for the handshake). */
+	AString m_PendingRequest;
+
+	/** The decrypted response received so far. */
+	AString m_Response;
+
+
+	/** Initializes the SSL and starts connecting to the server. Returns false on failure. Expects m_CS to be held. */
+	bool Connect(void)
+	{
+		if (m_TrustedRootCerts == nullptr)
+		{
+			LOGWARNING("cAuthenticator: The trusted root certs are not available, cannot connect to %s", m_Server.c_str());
+			return false;
+		}
+		int res = m_Ssl.Initialize(true);
+		if (res != 0)
+		{
+			LOGWARNING("cAuthenticator: SSL initialization failed: -0x%x", -res);
+			return false;
+		}
+		m_Ssl.SetCACerts(m_TrustedRootCerts, m_Server);
+
+		m_IsConnecting = true;
+		cConnectionPtr Self = shared_from_this();
+		if (!cNetwork::Connect(m_Server, 443, std::make_shared<cConnectCallbacks>(Self), Self))
+		{
+			LOGWARNING("cAuthenticator: Cannot connect to %s", m_Server.c_str());
+			m_IsConnecting = false;
+			return false;
+		}
+		return true;
+	}
+
+
+	/** Called when the TCP connection has been established. Starts the SSL handshake by sending the pending request. */
+	void OnConnected(void)
+	{
+		cCSLock Lock(m_CS);
+		m_IsConnecting = false;
+		m_IsConnected = true;
+		Flush();
+	}
+
+
+	/** Called when the TCP connection couldn't be established. */
+	void OnConnectError(const AString & a_ErrorMsg)
+	{
+		cCSLock Lock(m_CS);
+		LOGWARNING("cAuthenticator: Cannot connect to %s: %s", m_Server.c_str(), a_ErrorMsg.c_str());
+		m_IsConnecting = false;
+		m_Link.reset();
+		Close(false);
+	}
+
+
+	/** Writes as much of m_PendingRequest into the SSL as possible and sends all of the SSL's outgoing data over the link.
+	Expects m_CS to be held. Closes the connection on an SSL error. */
+	void Flush(void)
+	{
+		for (;;)
+		{
+			int NumWritten = 0;
+			if (!m_PendingRequest.empty())
+			{
+				NumWritten = m_Ssl.WritePlain(m_PendingRequest.data(), m_PendingRequest.size());
+				if (NumWritten > 0)
+				{
+					m_PendingRequest.erase(0, static_cast<size_t>(NumWritten));
+				}
+				else if ((NumWritten != POLARSSL_ERR_NET_WANT_READ) && (NumWritten != POLARSSL_ERR_NET_WANT_WRITE))
+				{
+					LOGWARNING("cAuthenticator: SSL writing to %s failed: -0x%x", m_Server.c_str(), -NumWritten);
+					Close(false);
+					return;
+				}
+			}
+
+			char Buffer[16 KiB];
+			size_t NumBytes = m_Ssl.ReadOutgoing(Buffer, sizeof(Buffer));
+			if ((NumBytes > 0) && (m_Link != nullptr))
+			{
+				m_Link->Send(Buffer, NumBytes);
+			}
+
+			if ((NumWritten <= 0) && (NumBytes == 0))
+			{
+				return;
+			}
+		}
+	}
+
+
+	/** Reports the response to the authenticator, if it has been received completely. Expects m_CS to be held. */
+	void CheckResponse(bool a_IsRemoteClosed)
+	{
+		if (!m_HasUser || (m_Authenticator == nullptr))
+		{
+			m_Response.clear();
+			return;
+		}
+		int StatusCode;
+		AString Body;
+		bool IsReusable;
+		if (!ParseHttpResponse(m_Response, a_IsRemoteClosed, StatusCode, Body, IsReusable))
+		{
+			return;
+		}
+
+		// The connection is ready for the next request before the authenticator is notified, it may send one right away:
+		cUser User(m_User);
+		m_HasUser = false;
+		m_Response.clear();
+		m_Authenticator->OnResponse(*this, User, StatusCode, Body, IsReusable);
+		if (!IsReusable)
+		{
+			Close(false);
+		}
+	}
+
+
+	/** Returns true if the request in progress should be retried after the connection has been lost.
+	That is the case if the server closed a reused keep-alive connection before responding, for the first time for the user. */
+	bool ShouldRetry(void) const
+	{
+		return (m_HasUser && m_Response.empty() && (m_NumRequests > 1) && (m_User.m_NumAttempts < 2));
+	}
+
+
+	/** Closes the connection and notifies the authenticator, including the request in progress, if any.
+	Expects m_CS to be held. */
+	void Close(bool a_ShouldRetry)
+	{
+		if (m_IsClosed)
+		{
+			return;
+		}
+		m_IsClosed = true;
+		if (m_Link != nullptr)
+		{
+			m_Link->Close();
+			m_Link.reset();
+		}
+		bool HasUser = m_HasUser;
+		m_HasUser = false;
+		if (m_Authenticator != nullptr)
+		{
+			m_Authenticator->OnConnectionClosed(*this, HasUser, m_User, a_ShouldRetry);
+		}
+	}
+
+
+	// cTCPLink::cCallbacks overrides:
+	virtual void OnLinkCreated(cTCPLinkPtr a_Link) override
+	{
+		cCSLock Lock(m_CS);
+		m_Link = a_Link;
+	}
+
+
+	virtual void OnReceivedData(const char * a_Data, size_t a_Length) override
+	{
+		cCSLock Lock(m_CS);
+		if (m_IsClosed)
+		{
+			return;
+		}
+
+		// Push the data through the SSL, letting it answer during the handshake:
+		for (;;)
+		{
+			size_t NumWritten = 0;
+			if (a_Length > 0)
+			{
+				NumWritten = m_Ssl.WriteIncoming(a_Data, a_Length);
+				a_Data += NumWritten;
+				a_Length -= NumWritten;
+			}
+
+			char Buffer[16 KiB];
+			int NumRead = m_Ssl.ReadPlain(Buffer, sizeof(Buffer));
+			if (NumRead > 0)
+			{
+				m_Response.append(Buffer, static_cast<size_t>(NumRead));
+			}
+			else if (NumRead == POLARSSL_ERR_SSL_PEER_CLOSE_NOTIFY)
+			{
+				OnRemoteClosed();
+				return;
+			}
+			else if ((NumRead != POLARSSL_ERR_NET_WANT_READ) && (NumRead != POLARSSL_ERR_NET_WANT_WRITE) && (NumRead < 0))
+			{
+				LOGWARNING("cAuthenticator: SSL reading from %s failed: -0x%x", m_Server.c_str(), -NumRead);
+				Close(false);
+				return;
+			}
+
+			// The handshake may have progressed, send the SSL's answer and the pending request:
+			Flush();
+			if (m_IsClosed)
+			{
+				return;
+			}
+
+			if ((NumWritten == 0) && (NumRead <= 0))
+			{
+				break;
+			}
+		}
+
+		if (m_Response.size() > MAX_RESPONSE_SIZE)
+		{
+			LOGWARNING("cAuthenticator: The response from %s is too large, dropping the connection", m_Server.c_str());
+			Close(false);
+			return;
+		}
+		CheckResponse(false);
+	}
+
+
+	virtual void OnRemoteClosed(void) override
+	{
+		cCSLock Lock(m_CS);
+		m_Link.reset();
+		CheckResponse(true);
+		Close(ShouldRetry());
+	}
+
+
+	virtual void OnError(int a_ErrorCode, const AString & a_ErrorMsg) override
+	{
+		cCSLock Lock(m_CS);
+		if (m_HasUser)
+		{
+			LOGWARNING("cAuthenticator: The connection to %s failed: %d (%s)", m_Server.c_str(), a_ErrorCode, a_ErrorMsg.c_str());
+		}
+		m_Link.reset();
+		Close(ShouldRetry());
+	}
+} ;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAuthenticator:
 
 cAuthenticator::cAuthenticator(void) :
-	super("cAuthenticator"),
+	m_IsRunning(false),
 	m_Server(DEFAULT_AUTH_SERVER),
 	m_Address(DEFAULT_AUTH_ADDRESS),
-	m_ShouldAuthenticate(true)
+	m_ShouldAuthenticate(true),
+	m_MaxConcurrentRequests(DEFAULT_MAX_CONCURRENT_REQUESTS)
 {
 }
 
@@ -42,9 +589,11 @@ cAuthenticator::~cAuthenticator()
 
 void cAuthenticator::ReadINI(cIniFile & IniFile)
 {
+	cCSLock Lock(m_CS);
 	m_Server             = IniFile.GetValueSet ("Authentication", "Server", DEFAULT_AUTH_SERVER);
 	m_Address            = IniFile.GetValueSet ("Authentication", "Address", DEFAULT_AUTH_ADDRESS);
 	m_ShouldAuthenticate = IniFile.GetValueSetB("Authentication", "Authenticate", true);
+	m_MaxConcurrentRequests = static_cast<size_t>(std::max(1, IniFile.GetValueSetI("Authentication", "MaxConcurrentRequests", DEFAULT_MAX_CONCURRENT_REQUESTS)));
 }
 
 
@@ -60,9 +609,11 @@ void cAuthenticator::Authenticate(int a_ClientID, const AString & a_UserName, co
 		return;
 	}
 
-	cCSLock LOCK(m_CS);
-	m_Queue.push_back(cUser(a_ClientID, a_UserName, a_ServerHash));
-	m_QueueNonempty.Set();
+	{
+		cCSLock Lock(m_CS);
+		m_Queue.push_back(cUser(a_ClientID, a_UserName, a_ServerHash));
+	}
+	ProcessQueue();
 }
 
 
@@ -72,8 +623,23 @@ void cAuthenticator::Authenticate(int a_ClientID, const AString & a_UserName, co
 void cAuthenticator::Start(cIniFile & IniFile)
 {
 	ReadINI(IniFile);
-	m_ShouldTerminate = false;
-	super::Start();
+
+	// Parse the trusted root certs once for all the connections:
+	cX509CertPtr TrustedRootCerts = std::make_shared<cX509Cert>();
+	const AString & CertData = cMojangAPI::GetTrustedRootCerts();
+	int res = TrustedRootCerts->Parse(CertData.data(), CertData.size());
+	if (res < 0)
+	{
+		LOGWARNING("cAuthenticator: Cannot parse the trusted root certs: -0x%x", -res);
+		TrustedRootCerts.reset();
+	}
+
+	{
+		cCSLock Lock(m_CS);
+		m_TrustedRootCerts = TrustedRootCerts;
+		m_IsRunning = true;
+	}
+	ProcessQueue();
 }
 
 
@@ -82,107 +648,170 @@ void cAuthenticator::Start(cIniFile & IniFile)
 
 void cAuthenticator::Stop(void)
 {
-	m_ShouldTerminate = true;
-	m_QueueNonempty.Set();
-	Wait();
+	// Take the connections out of the lock, detaching waits for their calls into the authenticator to finish:
+	cConnectionPtrs Connections;
+	{
+		cCSLock Lock(m_CS);
+		m_IsRunning = false;
+		std::swap(Connections, m_Connections);
+		m_IdleConnections.clear();
+	}
+	for (auto & Connection: Connections)
+	{
+		Connection->Detach();
+	}
 }
 
 
 
 
 
-void cAuthenticator::Execute(void)
+void cAuthenticator::ProcessQueue(void)
 {
 	for (;;)
 	{
-		cCSLock Lock(m_CS);
-		while (!m_ShouldTerminate && (m_Queue.size() == 0))
+		// Pick the next user and a connection for them:
+		cConnectionPtr Connection;
+		cUser User;
+		AString Request;
 		{
-			cCSUnlock Unlock(Lock);
-			m_QueueNonempty.Wait();
+			cCSLock Lock(m_CS);
+			if (!m_IsRunning || m_Queue.empty())
+			{
+				return;
+			}
+			if (!m_IdleConnections.empty())
+			{
+				// Reuse the most recently used connection, it is the least likely to have been closed by the server:
+				Connection = m_IdleConnections.back();
+				m_IdleConnections.pop_back();
+			}
+			else if (m_Connections.size() < m_MaxConcurrentRequests)
+			{
+				Connection = std::make_shared<cConnection>(*this, m_Server, m_TrustedRootCerts);
+				m_Connections.push_back(Connection);
+			}
+			else
+			{
+				// All the connections are busy, the next finished request will continue with the queue
+				return;
+			}
+			User = m_Queue.front();
+			m_Queue.pop_front();
+			Request = CreateRequest(User);
 		}
-		if (m_ShouldTerminate)
+
+		// The connection calls back into the authenticator, so it must be used outside the lock:
+		if (!Connection->StartRequest(User, Request))
 		{
-			return;
+			// The connection has been closed in the meantime, put the user back into the queue:
+			cCSLock Lock(m_CS);
+			RemoveConnection(*Connection);
+			m_Queue.push_front(User);
 		}
-		ASSERT(!m_Queue.empty());
+	}
+}
+
+
+
+
+
+AString cAuthenticator::CreateRequest(const cUser & a_User)
+{
+	AString ActualAddress = m_Address;
+	ReplaceString(ActualAddress, "%USERNAME%", a_User.m_Name);
+	ReplaceString(ActualAddress, "%SERVERID%", a_User.m_ServerID);
+
+	AString Request;
+	Request += "GET " + ActualAddress + " HTTP/1.1\r\n";
+	Request += "Host: " + m_Server + "\r\n";
+	Request += "User-Agent: MCServer\r\n";
+	Request += "Connection: keep-alive\r\n";
+	Request += "\r\n";
+	return Request;
+}
+
 
-		cAuthenticator::cUser & User = m_Queue.front();
-		int ClientID = User.m_ClientID;
-		AString UserName = User.m_Name;
-		AString ServerID = User.m_ServerID;
-		m_Queue.pop_front();
-		Lock.Unlock();
 
-		AString NewUserName = UserName;
-		AString UUID;
-		Json::Value Properties;
-		if (AuthWithYggdrasil(NewUserName, ServerID, UUID, Properties))
+
+
+void cAuthenticator::OnResponse(cConnection & a_Connection, const cUser & a_User, int a_StatusCode, const AString & a_Body, bool a_IsReusable)
+{
+	ReportResult(a_User, a_StatusCode, a_Body);
+	{
+		cCSLock Lock(m_CS);
+		if (a_IsReusable && m_IsRunning)
 		{
-			LOGINFO("User %s authenticated with UUID %s", NewUserName.c_str(), UUID.c_str());
-			cRoot::Get()->AuthenticateUser(ClientID, NewUserName, UUID, Properties);
+			m_IdleConnections.push_back(a_Connection.shared_from_this());
 		}
 		else
 		{
-			cRoot::Get()->KickUser(ClientID, "Failed to authenticate account!");
+			RemoveConnection(a_Connection);
 		}
-	}  // for (-ever)
+	}
+	ProcessQueue();
 }
 
 
 
 
 
-bool cAuthenticator::AuthWithYggdrasil(AString & a_UserName, const AString & a_ServerId, AString & a_UUID, Json::Value & a_Properties)
+void cAuthenticator::OnConnectionClosed(cConnection & a_Connection, bool a_HasUser, const cUser & a_User, bool a_ShouldRetry)
 {
-	LOGD("Trying to authenticate user %s", a_UserName.c_str());
+	{
+		cCSLock Lock(m_CS);
+		RemoveConnection(a_Connection);
+		if (a_HasUser && a_ShouldRetry)
+		{
+			m_Queue.push_front(a_User);
+		}
+	}
+	if (a_HasUser && !a_ShouldRetry)
+	{
+		ReportResult(a_User, 0, AString());
+	}
+	ProcessQueue();
+}
 
-	// Create the GET request:
-	AString ActualAddress = m_Address;
-	ReplaceString(ActualAddress, "%USERNAME%", a_UserName);
-	ReplaceString(ActualAddress, "%SERVERID%", a_ServerId);
 
-	AString Request;
-	Request += "GET " + ActualAddress + " HTTP/1.0\r\n";
-	Request += "Host: " + m_Server + "\r\n";
-	Request += "User-Agent: MCServer\r\n";
-	Request += "Connection: close\r\n";
-	Request += "\r\n";
 
-	AString Response;
-	if (!cMojangAPI::SecureRequest(m_Server, Request, Response))
+
+
+void cAuthenticator::RemoveConnection(cConnection & a_Connection)
+{
+	auto IsConnection = [&a_Connection](const cConnectionPtr & a_Ptr)
 	{
-		return false;
-	}
+		return (a_Ptr.get() == &a_Connection);
+	};
+	m_Connections.erase(std::remove_if(m_Connections.begin(), m_Connections.end(), IsConnection), m_Connections.end());
+	m_IdleConnections.erase(std::remove_if(m_IdleConnections.begin(), m_IdleConnections.end(), IsConnection), m_IdleConnections.end());
+}
 
-	// Check the HTTP status line:
-	const AString Prefix("HTTP/1.1 200 OK");
-	AString HexDump;
-	if (Response.compare(0, Prefix.size(), Prefix))
+
+
+
+
+bool cAuthenticator::ParseAuthResponse(const cUser & a_User, int a_StatusCode, const AString & a_Body, AString & a_UserName, AString & a_UUID, Json::Value & a_Properties)
+{
+	if (a_StatusCode == 0)
 	{
-		LOGINFO("User %s failed to auth, bad HTTP status line received", a_UserName.c_str());
-		LOGD("Response: \n%s", CreateHexDump(HexDump, Response.data(), Response.size(), 16).c_str());
+		LOGINFO("User %s failed to authenticate, no valid response received from the auth server", a_User.m_Name.c_str());
 		return false;
 	}
-
-	// Erase the HTTP headers from the response:
-	size_t idxHeadersEnd = Response.find("\r\n\r\n");
-	if (idxHeadersEnd == AString::npos)
+	if (a_StatusCode != 200)
 	{
-		LOGINFO("User %s failed to authenticate, bad HTTP response header received", a_UserName.c_str());
-		LOGD("Response: \n%s", CreateHexDump(HexDump, Response.data(), Response.size(), 16).c_str());
+		LOGINFO("User %s failed to auth, bad HTTP status received: %d", a_User.m_Name.c_str(), a_StatusCode);
 		return false;
 	}
-	Response.erase(0, idxHeadersEnd + 4);
 
 	// Parse the Json response:
-	if (Response.empty())
+	if (a_Body.empty())
 	{
 		return false;
 	}
 	Json::Value root;
 	Json::Reader reader;
-	if (!reader.parse(Response, root, false))
+	if (!reader.parse(a_Body, root, false))
 	{
 		LOGWARNING("cAuthenticator: Cannot parse received data (authentication) to JSON!");
 		return false;
@@ -201,6 +830,33 @@ bool cAuthenticator::AuthWithYggdrasil(AString & a_UserName, const AString & a_S
 
 
 
+void cAuthenticator::ReportResult(const cUser & a_User, int a_StatusCode, const AString & a_Body)
+{
+	// Process the result in the thread pool, the network thread mustn't wait for the server's locks:
+	cUser User(a_User);
+	AString Body(a_Body);
+	cRoot::Get()->GetThreadPool().Submit([User, a_StatusCode, Body]()
+		{
+			AString UserName, UUID;
+			Json::Value Properties;
+			if (ParseAuthResponse(User, a_StatusCode, Body, UserName, UUID, Properties))
+			{
+				LOGINFO("User %s authenticated with UUID %s", UserName.c_str(), UUID.c_str());
+				cRoot::Get()->AuthenticateUser(User.m_ClientID, UserName, UUID, Properties);
+			}
+			else
+			{
+				cRoot::Get()->KickUser(User.m_ClientID, "Failed to authenticate account!");
+			}
+		},
+		cThreadPool::tpHigh
+	);
+}
+
+
+
+
+
 /* In case we want to export this function to the plugin API later - don't forget to add the relevant INI configuration lines for DEFAULT_PROPERTIES_ADDRESS
 
 #define DEFAULT_PROPERTIES_ADDRESS "/session/minecraft/profile/%UUID%"
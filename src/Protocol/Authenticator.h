@@ -4,7 +4,7 @@
 // Interfaces to the cAuthenticator class representing the thread that authenticates users against the official MC server
 // Authentication prevents "hackers" from joining with an arbitrary username (possibly impersonating the server admins)
 // For more info, see http://wiki.vg/Session#Server_operation
-// In MCS, authentication is implemented as a single thread that receives queued auth requests and dispatches them one by one.
+// In MCS, the auth requests are queued and sent asynchronously over a pool of keep-alive SSL connections to the session server.
 
 
 
@@ -12,15 +12,16 @@
 
 #pragma once
 
-#include "../OSSupport/IsThread.h"
-
-
-
-
-
 // fwd: "cRoot.h"
 class cRoot;
 
+// fwd: "IniFile.h"
+class cIniFile;
+
+// fwd: "PolarSSL++/X509Cert.h"
+class cX509Cert;
+typedef SharedPtr<cX509Cert> cX509CertPtr;
+
 namespace Json
 {
 	class Value;
@@ -30,11 +31,12 @@ namespace Json
 
 
 
-class cAuthenticator :
-	public cIsThread
+/** Authenticates the users against the session server.
+The requests are sent asynchronously on the network thread, over up to m_MaxConcurrentRequests SSL connections at once.
+The connections are kept alive and reused for the next requests, so that most logins don't need a new SSL handshake.
+The results are handed over to cRoot's thread pool, so that the network thread never waits for the server's locks. */
+class cAuthenticator
 {
-	typedef cIsThread super;
-
 public:
 	cAuthenticator(void);
 	~cAuthenticator();
@@ -45,10 +47,10 @@ public:
 	/** Queues a request for authenticating a user. If the auth fails, the user will be kicked */
 	void Authenticate(int a_ClientID, const AString & a_UserName, const AString & a_ServerHash);
 
-	/** Starts the authenticator thread. The thread may be started and stopped repeatedly */
+	/** Starts sending the queued requests. The authenticator may be started and stopped repeatedly */
 	void Start(cIniFile & IniFile);
 
-	/** Stops the authenticator thread. The thread may be started and stopped repeatedly */
+	/** Closes all the connections and drops the queued requests. The authenticator may be started and stopped repeatedly */
 	void Stop(void);
 	
 private:
@@ -60,19 +62,49 @@ private:
 		AString m_Name;
 		AString m_ServerID;
 
+		/** The number of times the request has been sent. Requests lost on a reused connection are retried once. */
+		int     m_NumAttempts;
+
+		cUser(void) :
+			m_ClientID(-1),
+			m_NumAttempts(0)
+		{
+		}
+
 		cUser(int a_ClientID, const AString & a_Name, const AString & a_ServerID) :
 			m_ClientID(a_ClientID),
 			m_Name(a_Name),
-			m_ServerID(a_ServerID)
+			m_ServerID(a_ServerID),
+			m_NumAttempts(0)
 		{
 		}
 	};
 
+	/** A single keep-alive SSL connection to the auth server, sending one request at a time. Defined in Authenticator.cpp. */
+	class cConnection;
+	friend class cConnection;
+
 	typedef std::deque<cUser> cUserList;
+	typedef SharedPtr<cConnection> cConnectionPtr;
+	typedef std::vector<cConnectionPtr> cConnectionPtrs;
 
+	/** Protects all the members against multithreaded access. Never held while calling into a connection. */
 	cCriticalSection m_CS;
+
+	/** The users waiting for a free connection. */
 	cUserList        m_Queue;
-	cEvent           m_QueueNonempty;
+
+	/** All the open connections, both busy and idle. */
+	cConnectionPtrs  m_Connections;
+
+	/** The open connections that aren't sending any request, ready to be reused. A subset of m_Connections. */
+	cConnectionPtrs  m_IdleConnections;
+
+	/** The trusted root certs for the auth server, parsed in Start(). */
+	cX509CertPtr     m_TrustedRootCerts;
+
+	/** Set between Start() and Stop(); the queued requests are only sent while running. */
+	bool             m_IsRunning;
 
 	/** The server that is to be contacted for auth / UUID conversions */
 	AString m_Server;
@@ -86,12 +118,33 @@ private:
 	AString m_PropertiesAddress;
 	bool    m_ShouldAuthenticate;
 
-	/** cIsThread override: */
-	virtual void Execute(void) override;
+	/** The maximum number of requests being sent at the same time, and so the maximum number of open connections. */
+	size_t  m_MaxConcurrentRequests;
+
 
-	/** Returns true if the user authenticated okay, false on error
+	/** Sends the queued requests over the idle connections, opening new connections up to m_MaxConcurrentRequests. */
+	void ProcessQueue(void);
+
+	/** Returns the HTTP request for authenticating the specified user. */
+	AString CreateRequest(const cUser & a_User);
+
+	/** Called by a connection when it has received the response for a_User. The connection is then ready for another request
+	if a_IsReusable, otherwise it is closed. */
+	void OnResponse(cConnection & a_Connection, const cUser & a_User, int a_StatusCode, const AString & a_Body, bool a_IsReusable);
+
+	/** Called by a connection when it has been closed, or it failed to connect.
+	If a_HasUser, the request for a_User has been lost; it is retried if a_ShouldRetry, failed otherwise. */
+	void OnConnectionClosed(cConnection & a_Connection, bool a_HasUser, const cUser & a_User, bool a_ShouldRetry);
+
+	/** Removes the connection from m_Connections and m_IdleConnections. Expects m_CS to be held. */
+	void RemoveConnection(cConnection & a_Connection);
+
+	/** Processes the auth server's response. Returns true if the user authenticated okay, false on error.
 	Returns the case-corrected username, UUID, and properties (eg. skin). */
-	bool AuthWithYggdrasil(AString & a_UserName, const AString & a_ServerId, AString & a_UUID, Json::Value & a_Properties);
+	static bool ParseAuthResponse(const cUser & a_User, int a_StatusCode, const AString & a_Body, AString & a_UserName, AString & a_UUID, Json::Value & a_Properties);
+
+	/** Reports the result of the authentication to cRoot, in cRoot's thread pool. */
+	static void ReportResult(const cUser & a_User, int a_StatusCode, const AString & a_Body);
 };
 
 
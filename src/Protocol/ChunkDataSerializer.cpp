@@ -7,6 +7,7 @@
 
 #include "Globals.h"
 #include "ChunkDataSerializer.h"
+#include "../ChunkData.h"
 #include "zlib/zlib.h"
 #include "ByteBuffer.h"
 #include "Protocol18x.h"
@@ -14,18 +15,116 @@
 
 
 
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkDataSerializer::cCache:
+
+cChunkDataSerializer::cCache::cCache(size_t a_MaxSize) :
+	m_Size(0),
+	m_MaxSize(a_MaxSize)
+{
+}
+
+
+
+
+
+bool cChunkDataSerializer::cCache::Get(int a_ChunkX, int a_ChunkZ, int a_Version, UInt32 a_Revision, AString & a_Data)
+{
+	sKey Key = {a_ChunkX, a_ChunkZ, a_Version};
+	cCSLock Lock(m_CS);
+	cEntries::iterator itr = m_Entries.find(Key);
+	if ((itr == m_Entries.end()) || (itr->second.m_Revision != a_Revision))
+	{
+		return false;
+	}
+	
+	// Move to the front of the LRU list:
+	m_LRU.splice(m_LRU.begin(), m_LRU, itr->second.m_LRUPos);
+	a_Data = itr->second.m_Data;
+	return true;
+}
+
+
+
+
+
+void cChunkDataSerializer::cCache::Put(int a_ChunkX, int a_ChunkZ, int a_Version, UInt32 a_Revision, const AString & a_Data)
+{
+	if (a_Data.size() > m_MaxSize)
+	{
+		return;
+	}
+	
+	sKey Key = {a_ChunkX, a_ChunkZ, a_Version};
+	cCSLock Lock(m_CS);
+	cEntries::iterator itr = m_Entries.find(Key);
+	if (itr != m_Entries.end())
+	{
+		// Replace the existing entry:
+		m_Size -= itr->second.m_Data.size();
+		itr->second.m_Revision = a_Revision;
+		itr->second.m_Data = a_Data;
+		m_LRU.splice(m_LRU.begin(), m_LRU, itr->second.m_LRUPos);
+	}
+	else
+	{
+		m_LRU.push_front(Key);
+		sEntry & Entry = m_Entries[Key];
+		Entry.m_Revision = a_Revision;
+		Entry.m_Data = a_Data;
+		Entry.m_LRUPos = m_LRU.begin();
+	}
+	m_Size += a_Data.size();
+	
+	// Drop the least recently used entries until the size fits the limit:
+	while (m_Size > m_MaxSize)
+	{
+		ASSERT(!m_LRU.empty());
+		cEntries::iterator itrOld = m_Entries.find(m_LRU.back());
+		ASSERT(itrOld != m_Entries.end());
+		m_Size -= itrOld->second.m_Data.size();
+		m_Entries.erase(itrOld);
+		m_LRU.pop_back();
+	}
+}
+
+
+
+
+
+void cChunkDataSerializer::cCache::GetStats(size_t & a_NumEntries, size_t & a_NumBytes)
+{
+	cCSLock Lock(m_CS);
+	a_NumEntries = m_Entries.size();
+	a_NumBytes = m_Size;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkDataSerializer:
+
 cChunkDataSerializer::cChunkDataSerializer(
 	const cChunkDef::BlockTypes   & a_BlockTypes,
 	const cChunkDef::BlockNibbles & a_BlockMetas,
 	const cChunkDef::BlockNibbles & a_BlockLight,
 	const cChunkDef::BlockNibbles & a_BlockSkyLight,
-	const unsigned char *           a_BiomeData
+	const unsigned char *           a_BiomeData,
+	size_t                          a_NumNonEmptySections,
+	cCache *                        a_Cache,
+	UInt32                          a_Revision
 ) :
 	m_BlockTypes(a_BlockTypes),
 	m_BlockMetas(a_BlockMetas),
 	m_BlockLight(a_BlockLight),
 	m_BlockSkyLight(a_BlockSkyLight),
-	m_BiomeData(a_BiomeData)
+	m_BiomeData(a_BiomeData),
+	m_NumSections(Clamp<size_t>(a_NumNonEmptySections, 1, cChunkData::NumSections)),  // A ground-up chunk with no sections would unload the chunk in the client
+	m_Cache(a_Cache),
+	m_Revision(a_Revision)
 {
 }
 
@@ -41,6 +140,13 @@ const AString & cChunkDataSerializer::Serialize(int a_Version, int a_ChunkX, int
 	}
 	
 	AString data;
+	if ((m_Cache != nullptr) && m_Cache->Get(a_ChunkX, a_ChunkZ, a_Version, m_Revision, data))
+	{
+		AString & Dest = m_Serializations[a_Version];
+		std::swap(Dest, data);
+		return Dest;
+	}
+	
 	switch (a_Version)
 	{
 		case RELEASE_1_2_5: Serialize29(data); break;
@@ -57,6 +163,10 @@ const AString & cChunkDataSerializer::Serialize(int a_Version, int a_ChunkX, int
 	}
 	if (!data.empty())
 	{
+		if (m_Cache != nullptr)
+		{
+			m_Cache->Put(a_ChunkX, a_ChunkZ, a_Version, m_Revision, data);
+		}
 		m_Serializations[a_Version] = data;
 	}
 	return m_Serializations[a_Version];
@@ -66,30 +176,48 @@ const AString & cChunkDataSerializer::Serialize(int a_Version, int a_ChunkX, int
 
 
 
+size_t cChunkDataSerializer::GetSerializedSize(void) const
+{
+	size_t res = 0;
+	for (Serializations::const_iterator itr = m_Serializations.begin(); itr != m_Serializations.end(); ++itr)
+	{
+		res += itr->second.size();
+	}
+	return res;
+}
+
+
+
+
+
 void cChunkDataSerializer::Serialize29(AString & a_Data)
 {
 	// TODO: Do not copy data and then compress it; rather, compress partial blocks of data (zlib can stream)
 
 	const int BiomeDataSize    = cChunkDef::Width * cChunkDef::Width;
-	const int MetadataOffset   = sizeof(m_BlockTypes);
-	const int BlockLightOffset = MetadataOffset   + sizeof(m_BlockMetas);
-	const int SkyLightOffset   = BlockLightOffset + sizeof(m_BlockLight);
-	const int BiomeOffset      = SkyLightOffset   + sizeof(m_BlockSkyLight);
+	const int MaxDataSize      = sizeof(m_BlockTypes) + sizeof(m_BlockMetas) + sizeof(m_BlockLight) + sizeof(m_BlockSkyLight) + BiomeDataSize;
+
+	// Only the non-empty sections are sent; since the arrays are ordered by Y, they are the beginning of each array:
+	const int NumSectionBlocks = static_cast<int>(m_NumSections * cChunkData::SectionBlockCount);
+	const int MetadataOffset   = NumSectionBlocks;
+	const int BlockLightOffset = MetadataOffset   + NumSectionBlocks / 2;
+	const int SkyLightOffset   = BlockLightOffset + NumSectionBlocks / 2;
+	const int BiomeOffset      = SkyLightOffset   + NumSectionBlocks / 2;
 	const int DataSize         = BiomeOffset      + BiomeDataSize;
 	
 	// Temporary buffer for the composed data:
-	char AllData [DataSize];
+	char AllData [MaxDataSize];
 
-	memcpy(AllData, m_BlockTypes, sizeof(m_BlockTypes));
-	memcpy(AllData + MetadataOffset,   m_BlockMetas,    sizeof(m_BlockMetas));
-	memcpy(AllData + BlockLightOffset, m_BlockLight,    sizeof(m_BlockLight));
-	memcpy(AllData + SkyLightOffset,   m_BlockSkyLight, sizeof(m_BlockSkyLight));
+	memcpy(AllData,                    m_BlockTypes,    static_cast<size_t>(NumSectionBlocks));
+	memcpy(AllData + MetadataOffset,   m_BlockMetas,    static_cast<size_t>(NumSectionBlocks / 2));
+	memcpy(AllData + BlockLightOffset, m_BlockLight,    static_cast<size_t>(NumSectionBlocks / 2));
+	memcpy(AllData + SkyLightOffset,   m_BlockSkyLight, static_cast<size_t>(NumSectionBlocks / 2));
 	memcpy(AllData + BiomeOffset,      m_BiomeData,     BiomeDataSize);
 
 	// Compress the data:
 	// In order not to use allocation, use a fixed-size buffer, with the size
 	// that uses the same calculation as compressBound():
-	const uLongf CompressedMaxSize = DataSize + (DataSize >> 12) + (DataSize >> 14) + (DataSize >> 25) + 16;
+	const uLongf CompressedMaxSize = MaxDataSize + (MaxDataSize >> 12) + (MaxDataSize >> 14) + (MaxDataSize >> 25) + 16;
 	char CompressedBlockData[CompressedMaxSize];
 
 	uLongf CompressedSize = compressBound(DataSize);
@@ -97,16 +225,15 @@ void cChunkDataSerializer::Serialize29(AString & a_Data)
 	// Run-time check that our compile-time guess about CompressedMaxSize was enough:
 	ASSERT(CompressedSize <= CompressedMaxSize);
 	
-	compress2((Bytef*)CompressedBlockData, &CompressedSize, (const Bytef*)AllData, sizeof(AllData), Z_DEFAULT_COMPRESSION);
+	compress2((Bytef*)CompressedBlockData, &CompressedSize, (const Bytef*)AllData, static_cast<uLong>(DataSize), Z_DEFAULT_COMPRESSION);
 
 	// Now put all those data into a_Data:
 	
 	// "Ground-up continuous", or rather, "biome data present" flag:
 	a_Data.push_back('\x01');
 	
-	// Two bitmaps; we're aways sending the full chunk with no additional data, so the bitmaps are 0xffff and 0, respectively
-	// Also, no endian flipping is needed because of the const values
-	unsigned short BitMap1 = 0xffff;
+	// Two bitmaps; we're sending the non-empty sections with no additional data, so the second bitmap is 0
+	unsigned short BitMap1 = htons(GetSectionBitmap());
 	unsigned short BitMap2 = 0;
 	a_Data.append((const char *)&BitMap1, sizeof(short));
 	a_Data.append((const char *)&BitMap2, sizeof(short));
@@ -129,25 +256,29 @@ void cChunkDataSerializer::Serialize39(AString & a_Data)
 	// TODO: Do not copy data and then compress it; rather, compress partial blocks of data (zlib can stream)
 
 	const int BiomeDataSize    = cChunkDef::Width * cChunkDef::Width;
-	const int MetadataOffset   = sizeof(m_BlockTypes);
-	const int BlockLightOffset = MetadataOffset   + sizeof(m_BlockMetas);
-	const int SkyLightOffset   = BlockLightOffset + sizeof(m_BlockLight);
-	const int BiomeOffset      = SkyLightOffset   + sizeof(m_BlockSkyLight);
+	const int MaxDataSize      = sizeof(m_BlockTypes) + sizeof(m_BlockMetas) + sizeof(m_BlockLight) + sizeof(m_BlockSkyLight) + BiomeDataSize;
+
+	// Only the non-empty sections are sent; since the arrays are ordered by Y, they are the beginning of each array:
+	const int NumSectionBlocks = static_cast<int>(m_NumSections * cChunkData::SectionBlockCount);
+	const int MetadataOffset   = NumSectionBlocks;
+	const int BlockLightOffset = MetadataOffset   + NumSectionBlocks / 2;
+	const int SkyLightOffset   = BlockLightOffset + NumSectionBlocks / 2;
+	const int BiomeOffset      = SkyLightOffset   + NumSectionBlocks / 2;
 	const int DataSize         = BiomeOffset      + BiomeDataSize;
 	
 	// Temporary buffer for the composed data:
-	char AllData [DataSize];
+	char AllData [MaxDataSize];
 
-	memcpy(AllData, m_BlockTypes, sizeof(m_BlockTypes));
-	memcpy(AllData + MetadataOffset,   m_BlockMetas,    sizeof(m_BlockMetas));
-	memcpy(AllData + BlockLightOffset, m_BlockLight,    sizeof(m_BlockLight));
-	memcpy(AllData + SkyLightOffset,   m_BlockSkyLight, sizeof(m_BlockSkyLight));
+	memcpy(AllData,                    m_BlockTypes,    static_cast<size_t>(NumSectionBlocks));
+	memcpy(AllData + MetadataOffset,   m_BlockMetas,    static_cast<size_t>(NumSectionBlocks / 2));
+	memcpy(AllData + BlockLightOffset, m_BlockLight,    static_cast<size_t>(NumSectionBlocks / 2));
+	memcpy(AllData + SkyLightOffset,   m_BlockSkyLight, static_cast<size_t>(NumSectionBlocks / 2));
 	memcpy(AllData + BiomeOffset,      m_BiomeData,     BiomeDataSize);
 
 	// Compress the data:
 	// In order not to use allocation, use a fixed-size buffer, with the size
 	// that uses the same calculation as compressBound():
-	const uLongf CompressedMaxSize = DataSize + (DataSize >> 12) + (DataSize >> 14) + (DataSize >> 25) + 16;
+	const uLongf CompressedMaxSize = MaxDataSize + (MaxDataSize >> 12) + (MaxDataSize >> 14) + (MaxDataSize >> 25) + 16;
 	char CompressedBlockData[CompressedMaxSize];
 
 	uLongf CompressedSize = compressBound(DataSize);
@@ -155,16 +286,15 @@ void cChunkDataSerializer::Serialize39(AString & a_Data)
 	// Run-time check that our compile-time guess about CompressedMaxSize was enough:
 	ASSERT(CompressedSize <= CompressedMaxSize);
 	
-	compress2((Bytef*)CompressedBlockData, &CompressedSize, (const Bytef*)AllData, sizeof(AllData), Z_DEFAULT_COMPRESSION);
+	compress2((Bytef*)CompressedBlockData, &CompressedSize, (const Bytef*)AllData, static_cast<uLong>(DataSize), Z_DEFAULT_COMPRESSION);
 
 	// Now put all those data into a_Data:
 	
 	// "Ground-up continuous", or rather, "biome data present" flag:
 	a_Data.push_back('\x01');
 	
-	// Two bitmaps; we're aways sending the full chunk with no additional data, so the bitmaps are 0xffff and 0, respectively
-	// Also, no endian flipping is needed because of the const values
-	unsigned short BitMap1 = 0xffff;
+	// Two bitmaps; we're sending the non-empty sections with no additional data, so the second bitmap is 0
+	unsigned short BitMap1 = htons(GetSectionBitmap());
 	unsigned short BitMap2 = 0;
 	a_Data.append((const char *)&BitMap1, sizeof(short));
 	a_Data.append((const char *)&BitMap2, sizeof(short));
@@ -185,41 +315,48 @@ void cChunkDataSerializer::Serialize47(AString & a_Data, int a_ChunkX, int a_Chu
 {
 	// This function returns the fully compressed packet (including packet size), not the raw packet!
 
-	// Create the packet:
-	cByteBuffer Packet(512 KiB);
+	// Create the packet header:
+	cByteBuffer Packet(32);
 	Packet.WriteVarInt32(0x21);  // Packet id (Chunk Data packet)
 	Packet.WriteBEInt32(a_ChunkX);
 	Packet.WriteBEInt32(a_ChunkZ);
 	Packet.WriteBool(true);        // "Ground-up continuous", or rather, "biome data present" flag
-	Packet.WriteBEUInt16(0xffff);  // We're aways sending the full chunk with no additional data, so the bitmap is 0xffff
+	Packet.WriteBEUInt16(GetSectionBitmap());  // We're sending only the non-empty sections, the empty ones above are left out
 
 	// Write the chunk size:
-	const int BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
-	UInt32 ChunkSize = (
-		(cChunkDef::NumBlocks * 2) +  // Block meta + type
-		sizeof(m_BlockLight) +        // Block light
-		sizeof(m_BlockSkyLight) +     // Block sky light
+	const size_t BiomeDataSize = cChunkDef::Width * cChunkDef::Width;
+	const size_t NumSectionBlocks = m_NumSections * cChunkData::SectionBlockCount;
+	UInt32 ChunkSize = static_cast<UInt32>(
+		(NumSectionBlocks * 2) +      // Block meta + type
+		NumSectionBlocks / 2 +        // Block light
+		NumSectionBlocks / 2 +        // Block sky light
 		BiomeDataSize                 // Biome data
 	);
 	Packet.WriteVarInt32(ChunkSize);
 
+	// The bulk of the packet is composed directly in the string that gets compressed, no intermediate buffer:
+	AString PacketData;
+	Packet.ReadAll(PacketData);
+	Packet.CommitRead();
+	size_t HeaderSize = PacketData.size();
+	PacketData.resize(HeaderSize + ChunkSize);
+
 	// Write the block types to the packet:
-	for (size_t Index = 0; Index < cChunkDef::NumBlocks; Index++)
+	char * Dst = &PacketData[HeaderSize];
+	for (size_t Index = 0; Index < NumSectionBlocks; Index++)
 	{
 		BLOCKTYPE BlockType = m_BlockTypes[Index] & 0xFF;
 		NIBBLETYPE BlockMeta = m_BlockMetas[Index / 2] >> ((Index & 1) * 4) & 0x0f;
-		Packet.WriteBEUInt8(static_cast<unsigned char>(BlockType << 4) | BlockMeta);
-		Packet.WriteBEUInt8(static_cast<unsigned char>(BlockType >> 4));
+		*Dst++ = static_cast<char>(static_cast<unsigned char>(BlockType << 4) | BlockMeta);
+		*Dst++ = static_cast<char>(BlockType >> 4);
 	}
 
 	// Write the rest:
-	Packet.WriteBuf(m_BlockLight,    sizeof(m_BlockLight));
-	Packet.WriteBuf(m_BlockSkyLight, sizeof(m_BlockSkyLight));
-	Packet.WriteBuf(m_BiomeData,     BiomeDataSize);
-
-	AString PacketData;
-	Packet.ReadAll(PacketData);
-	Packet.CommitRead();
+	memcpy(Dst, m_BlockLight, NumSectionBlocks / 2);
+	Dst += NumSectionBlocks / 2;
+	memcpy(Dst, m_BlockSkyLight, NumSectionBlocks / 2);
+	Dst += NumSectionBlocks / 2;
+	memcpy(Dst, m_BiomeData, BiomeDataSize);
 
 	cByteBuffer Buffer(20);
 	if (PacketData.size() >= 256)
@@ -234,7 +371,7 @@ void cChunkDataSerializer::Serialize47(AString & a_Data, int a_ChunkX, int a_Chu
 	else
 	{
 		AString PostData;
-		Buffer.WriteVarInt32(static_cast<UInt32>(Packet.GetUsedSpace() + 1));
+		Buffer.WriteVarInt32(static_cast<UInt32>(PacketData.size() + 1));
 		Buffer.WriteVarInt32(0);
 		Buffer.ReadAll(PostData);
 		Buffer.CommitRead();
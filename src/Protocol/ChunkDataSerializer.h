@@ -9,22 +9,107 @@
 
 
 
+#pragma once
+
+
+
+
+
 class cChunkDataSerializer
 {
+public:
+
+	/** A cache of serialized chunk data, shared across serializers.
+	Keyed by chunk coords and protocol version; an entry is only used if it was made from the same chunk revision,
+	so it gets invalidated implicitly by any change to the chunk.
+	The least recently used entries are dropped when the total size exceeds the limit. Thread-safe. */
+	class cCache
+	{
+	public:
+		cCache(size_t a_MaxSize);
+
+		/** Retrieves the serialization for the specified chunk, version and revision.
+		Returns false if there's no such serialization cached. */
+		bool Get(int a_ChunkX, int a_ChunkZ, int a_Version, UInt32 a_Revision, AString & a_Data);
+
+		/** Stores the serialization for the specified chunk, version and revision, replacing any older one. */
+		void Put(int a_ChunkX, int a_ChunkZ, int a_Version, UInt32 a_Revision, const AString & a_Data);
+
+		/** Returns the number of the cached serializations and their total size in bytes. */
+		void GetStats(size_t & a_NumEntries, size_t & a_NumBytes);
+
+	protected:
+		struct sKey
+		{
+			int m_ChunkX;
+			int m_ChunkZ;
+			int m_Version;
+
+			bool operator <(const sKey & a_Other) const
+			{
+				if (m_ChunkX != a_Other.m_ChunkX)
+				{
+					return (m_ChunkX < a_Other.m_ChunkX);
+				}
+				if (m_ChunkZ != a_Other.m_ChunkZ)
+				{
+					return (m_ChunkZ < a_Other.m_ChunkZ);
+				}
+				return (m_Version < a_Other.m_Version);
+			}
+		} ;
+
+		typedef std::list<sKey> cKeyList;
+
+		struct sEntry
+		{
+			UInt32 m_Revision;
+			AString m_Data;
+			cKeyList::iterator m_LRUPos;  ///< Position of this entry's key in m_LRU
+		} ;
+
+		typedef std::map<sKey, sEntry> cEntries;
+
+		cCriticalSection m_CS;
+		cEntries m_Entries;
+
+		/** Keys of all the entries, the most recently used first. */
+		cKeyList m_LRU;
+
+		/** Sum of the data sizes of all the entries. */
+		size_t m_Size;
+
+		/** The maximum allowed m_Size. */
+		size_t m_MaxSize;
+	} ;
+
 protected:
 	const cChunkDef::BlockTypes   & m_BlockTypes;
 	const cChunkDef::BlockNibbles & m_BlockMetas;
 	const cChunkDef::BlockNibbles & m_BlockLight;
 	const cChunkDef::BlockNibbles & m_BlockSkyLight;
 	const unsigned char * m_BiomeData;
+
+	/** Number of the sections, from the bottom up, that are serialized; the ones above are empty (air, no blocklight, full skylight)
+	and are left out of the data, the clients treat the missing sections as such. Always at least 1. */
+	size_t m_NumSections;
 	
 	typedef std::map<int, AString> Serializations;
 	
 	Serializations m_Serializations;
 	
+	/** The shared cache to consult before serializing, and to store new serializations into; may be nullptr. */
+	cCache * m_Cache;
+	
+	/** Revision of the chunk data, used as the m_Cache validity stamp. */
+	UInt32 m_Revision;
+	
 	void Serialize29(AString & a_Data);  // Release 1.2.4 and 1.2.5
 	void Serialize39(AString & a_Data);  // Release 1.3.1 to 1.7.10
 	void Serialize47(AString & a_Data, int a_ChunkX, int a_ChunkZ);  // Release 1.8
+
+	/** Returns the bitmap of the sections being sent, with a bit set for each of the m_NumSections lowest sections. */
+	UInt16 GetSectionBitmap(void) const { return static_cast<UInt16>((1 << m_NumSections) - 1); }
 	
 public:
 	enum
@@ -39,10 +124,16 @@ public:
 		const cChunkDef::BlockNibbles & a_BlockMetas,
 		const cChunkDef::BlockNibbles & a_BlockLight,
 		const cChunkDef::BlockNibbles & a_BlockSkyLight,
-		const unsigned char *           a_BiomeData
+		const unsigned char *           a_BiomeData,
+		size_t                          a_NumNonEmptySections,
+		cCache *                        a_Cache = nullptr,
+		UInt32                          a_Revision = 0
 	);
 
 	const AString & Serialize(int a_Version, int a_ChunkX, int a_ChunkZ);  // Returns one of the internal m_Serializations[]
+	
+	/** Returns the total size of all the serializations made so far, in bytes. */
+	size_t GetSerializedSize(void) const;
 } ;
 
 
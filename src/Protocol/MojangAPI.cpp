@@ -7,6 +7,7 @@
 #include "MojangAPI.h"
 #include "SQLiteCpp/Database.h"
 #include "SQLiteCpp/Statement.h"
+#include "SQLiteCpp/Transaction.h"
 #include "../IniFile.h"
 #include "json/json.h"
 #include "PolarSSL++/BlockingSslClientSocket.h"
@@ -114,7 +115,8 @@ cMojangAPI::sProfile::sProfile(
 	m_UUID(a_UUID),
 	m_Textures(),
 	m_TexturesSignature(),
-	m_DateTime(a_DateTime)
+	m_DateTime(a_DateTime),
+	m_IsDirty(true)
 {
 	/*
 	Example a_Profile contents:
@@ -163,10 +165,24 @@ class cMojangAPI::cUpdateThread :
 public:
 	cUpdateThread(cMojangAPI & a_MojangAPI) :
 		super("cMojangAPI::cUpdateThread"),
-		m_MojangAPI(a_MojangAPI)
+		m_MojangAPI(a_MojangAPI),
+		m_ShouldUpdate(false)
 	{
 	}
 
+	/** Starts the thread. If a_ShouldUpdate, the stale cache entries are re-queried periodically. */
+	void Start(bool a_ShouldUpdate)
+	{
+		m_ShouldUpdate = a_ShouldUpdate;
+		super::Start();
+	}
+
+	/** Wakes the thread up to process the queued asynchronous lookups. */
+	void Notify(void)
+	{
+		m_evtNotify.Set();
+	}
+
 	~cUpdateThread()
 	{
 		// Notify the thread that it should stop:
@@ -182,17 +198,36 @@ protected:
 	/** The cMojangAPI instance to update. */
 	cMojangAPI & m_MojangAPI;
 
-	/** The event used for notifying that the thread should terminate, as well as timing. */
+	/** The event used for notifying that the thread should terminate or that there are lookups queued, as well as timing. */
 	cEvent m_evtNotify;
 
+	/** If true, the stale cache entries are re-queried every hour. */
+	bool m_ShouldUpdate;
+
 
 	// cIsThread override:
 	virtual void Execute(void) override
 	{
-		do
+		const std::chrono::minutes UpdateInterval(60);
+		auto NextUpdate = std::chrono::steady_clock::now();
+		while (!m_ShouldTerminate)
 		{
-			m_MojangAPI.Update();
-		} while (!m_ShouldTerminate && !m_evtNotify.Wait(60 * 60 * 1000));  // Repeat every 60 minutes until termination request
+			m_MojangAPI.ProcessPendingLookups();
+			auto Now = std::chrono::steady_clock::now();
+			if (m_ShouldUpdate && (Now >= NextUpdate))
+			{
+				m_MojangAPI.Update();
+				NextUpdate = Now + UpdateInterval;
+			}
+
+			// Sleep until the next update, or until woken up by a lookup or the termination request:
+			auto Timeout = std::chrono::duration_cast<std::chrono::milliseconds>(NextUpdate - std::chrono::steady_clock::now());
+			if (!m_ShouldUpdate || (Timeout > UpdateInterval))
+			{
+				Timeout = UpdateInterval;
+			}
+			m_evtNotify.Wait(static_cast<unsigned>(std::max<std::chrono::milliseconds::rep>(Timeout.count(), 0)));
+		}
 	}
 } ;
 
@@ -232,11 +267,10 @@ void cMojangAPI::Start(cIniFile & a_SettingsIni, bool a_ShouldAuth)
 	m_NameToUUIDAddress    = a_SettingsIni.GetValueSet("MojangAPI", "NameToUUIDAddress",    DEFAULT_NAME_TO_UUID_ADDRESS);
 	m_UUIDToProfileServer  = a_SettingsIni.GetValueSet("MojangAPI", "UUIDToProfileServer",  DEFAULT_UUID_TO_PROFILE_SERVER);
 	m_UUIDToProfileAddress = a_SettingsIni.GetValueSet("MojangAPI", "UUIDToProfileAddress", DEFAULT_UUID_TO_PROFILE_ADDRESS);
-	LoadCachesFromDisk();
-	if (a_ShouldAuth)
-	{
-		m_UpdateThread->Start();
-	}
+	OpenDiskCache();
+
+	// The thread serves the asynchronous lookups even in offline mode, but only refreshes the cache in online mode:
+	m_UpdateThread->Start(a_ShouldAuth);
 }
 
 
@@ -257,14 +291,13 @@ AString cMojangAPI::GetUUIDFromPlayerName(const AString & a_PlayerName, bool a_U
 	}
 	
 	// Retrieve from cache:
-	cCSLock Lock(m_CSNameToUUID);
-	cProfileMap::const_iterator itr = m_NameToUUID.find(lcPlayerName);
-	if (itr == m_NameToUUID.end())
+	sProfile Profile;
+	if (!FindNameToUUID(lcPlayerName, Profile))
 	{
 		// No UUID found
 		return "";
 	}
-	return itr->second.m_UUID;
+	return Profile.m_UUID;
 }
 
 
@@ -277,21 +310,10 @@ AString cMojangAPI::GetPlayerNameFromUUID(const AString & a_UUID, bool a_UseOnly
 	AString UUID = MakeUUIDShort(a_UUID);
 	
 	// Retrieve from caches:
+	sProfile Profile;
+	if (FindUUIDToProfile(UUID, Profile) || FindUUIDToName(UUID, Profile))
 	{
-		cCSLock Lock(m_CSUUIDToProfile);
-		cProfileMap::const_iterator itr = m_UUIDToProfile.find(UUID);
-		if (itr != m_UUIDToProfile.end())
-		{
-			return itr->second.m_PlayerName;
-		}
-	}
-	{
-		cCSLock Lock(m_CSUUIDToName);
-		cProfileMap::const_iterator itr = m_UUIDToName.find(UUID);
-		if (itr != m_UUIDToName.end())
-		{
-			return itr->second.m_PlayerName;
-		}
+		return Profile.m_PlayerName;
 	}
 
 	// Name not yet cached, request cache and retry:
@@ -328,13 +350,12 @@ AStringVector cMojangAPI::GetUUIDsFromPlayerNames(const AStringVector & a_Player
 	size_t idx = 0;
 	AStringVector res;
 	res.resize(PlayerNames.size());
-	cCSLock Lock(m_CSNameToUUID);
 	for (AStringVector::const_iterator itr = PlayerNames.begin(), end = PlayerNames.end(); itr != end; ++itr, ++idx)
 	{
-		cProfileMap::const_iterator itrN = m_NameToUUID.find(*itr);
-		if (itrN != m_NameToUUID.end())
+		sProfile Profile;
+		if (FindNameToUUID(*itr, Profile))
 		{
-			res[idx] = itrN->second.m_UUID;
+			res[idx] = Profile.m_UUID;
 		}
 	}  // for itr - PlayerNames[]
 	return res;
@@ -342,6 +363,55 @@ AStringVector cMojangAPI::GetUUIDsFromPlayerNames(const AStringVector & a_Player
 
 
 
+
+
+void cMojangAPI::GetUUIDFromPlayerNameAsync(const AString & a_PlayerName, cUUIDCallback a_Callback)
+{
+	AString lcPlayerName = StrToLower(a_PlayerName);
+	sProfile Profile;
+	if (FindNameToUUID(lcPlayerName, Profile))
+	{
+		a_Callback(a_PlayerName, Profile.m_UUID);
+		return;
+	}
+
+	// Queue for the update thread:
+	{
+		cCSLock Lock(m_CSPendingLookups);
+		m_PendingNameLookups[lcPlayerName].push_back(std::make_pair(a_PlayerName, std::move(a_Callback)));
+	}
+	m_UpdateThread->Notify();
+}
+
+
+
+
+
+void cMojangAPI::GetPlayerNameFromUUIDAsync(const AString & a_UUID, cPlayerNameCallback a_Callback)
+{
+	AString UUID = MakeUUIDShort(a_UUID);
+	if (UUID.empty())
+	{
+		a_Callback(a_UUID, "");
+		return;
+	}
+	sProfile Profile;
+	if (FindUUIDToProfile(UUID, Profile) || FindUUIDToName(UUID, Profile))
+	{
+		a_Callback(a_UUID, Profile.m_PlayerName);
+		return;
+	}
+
+	// Queue for the update thread:
+	{
+		cCSLock Lock(m_CSPendingLookups);
+		m_PendingUUIDLookups[UUID].push_back(std::make_pair(a_UUID, std::move(a_Callback)));
+	}
+	m_UpdateThread->Notify();
+}
+
+
+
 	
 
 void cMojangAPI::AddPlayerNameToUUIDMapping(const AString & a_PlayerName, const AString & a_UUID)
@@ -442,6 +512,15 @@ bool cMojangAPI::SecureRequest(const AString & a_ServerName, const AString & a_R
 
 
 
+const AString & cMojangAPI::GetTrustedRootCerts(void)
+{
+	return StarfieldCACert();
+}
+
+
+
+
+
 AString cMojangAPI::MakeUUIDShort(const AString & a_UUID)
 {
 	// Note: we only check the string's length, not the actual content
@@ -510,45 +589,24 @@ AString cMojangAPI::MakeUUIDDashed(const AString & a_UUID)
 
 
 
-void cMojangAPI::LoadCachesFromDisk(void)
+void cMojangAPI::OpenDiskCache(void)
 {
+	cCSLock Lock(m_CSDB);
 	try
 	{
-		// Open up the SQLite DB:
-		SQLite::Database db("MojangAPI.sqlite", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
-		db.exec("CREATE TABLE IF NOT EXISTS PlayerNameToUUID (PlayerName, UUID, DateTime)");
-		db.exec("CREATE TABLE IF NOT EXISTS UUIDToProfile    (UUID, PlayerName, Textures, TexturesSignature, DateTime)");
-		
-		// Retrieve all entries:
-		{
-			SQLite::Statement stmt(db, "SELECT PlayerName, UUID, DateTime FROM PlayerNameToUUID");
-			while (stmt.executeStep())
-			{
-				AString PlayerName = stmt.getColumn(0);
-				AString UUID       = stmt.getColumn(1);
-				Int64 DateTime     = stmt.getColumn(2);
-				UUID = MakeUUIDShort(UUID);
-				m_NameToUUID[StrToLower(PlayerName)] = sProfile(PlayerName, UUID, "", "", DateTime);
-				m_UUIDToName[UUID] = sProfile(PlayerName, UUID, "", "", DateTime);
-			}
-		}
-		{
-			SQLite::Statement stmt(db, "SELECT PlayerName, UUID, Textures, TexturesSignature, DateTime FROM UUIDToProfile");
-			while (stmt.executeStep())
-			{
-				AString PlayerName        = stmt.getColumn(0);
-				AString UUID              = stmt.getColumn(1);
-				AString Textures          = stmt.getColumn(2);
-				AString TexturesSignature = stmt.getColumn(2);
-				Int64 DateTime            = stmt.getColumn(4);
-				UUID = MakeUUIDShort(UUID);
-				m_UUIDToProfile[UUID] = sProfile(PlayerName, UUID, Textures, TexturesSignature, DateTime);
-			}
-		}
+		m_DB.reset(new SQLite::Database("MojangAPI.sqlite", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE));
+		m_DB->exec("CREATE TABLE IF NOT EXISTS PlayerNameToUUID (PlayerName, UUID, DateTime)");
+		m_DB->exec("CREATE TABLE IF NOT EXISTS UUIDToProfile    (UUID, PlayerName, Textures, TexturesSignature, DateTime)");
+
+		// The entries are looked up one by one, as they are needed:
+		m_DB->exec("CREATE INDEX IF NOT EXISTS PlayerNameToUUID_PlayerName ON PlayerNameToUUID (PlayerName COLLATE NOCASE)");
+		m_DB->exec("CREATE INDEX IF NOT EXISTS PlayerNameToUUID_UUID ON PlayerNameToUUID (UUID)");
+		m_DB->exec("CREATE INDEX IF NOT EXISTS UUIDToProfile_UUID ON UUIDToProfile (UUID)");
 	}
 	catch (const SQLite::Exception & ex)
 	{
-		LOGINFO("Loading MojangAPI cache failed: %s", ex.what());
+		LOGINFO("Opening MojangAPI cache failed: %s", ex.what());
+		m_DB.reset();
 	}
 }
 
@@ -558,57 +616,79 @@ void cMojangAPI::LoadCachesFromDisk(void)
 
 void cMojangAPI::SaveCachesToDisk(void)
 {
+	cCSLock Lock(m_CSDB);
+	if (m_DB == nullptr)
+	{
+		return;
+	}
 	try
 	{
-		// Open up the SQLite DB:
-		SQLite::Database db("MojangAPI.sqlite", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
-		db.exec("CREATE TABLE IF NOT EXISTS PlayerNameToUUID (PlayerName, UUID, DateTime)");
-		db.exec("CREATE TABLE IF NOT EXISTS UUIDToProfile (UUID, PlayerName, Textures, TexturesSignature, DateTime)");
-		
-		// Remove all entries:
-		db.exec("DELETE FROM PlayerNameToUUID");
-		db.exec("DELETE FROM UUIDToProfile");
-		
-		// Save all cache entries - m_PlayerNameToUUID:
+		SQLite::Transaction Transaction(*m_DB);
+
+		// Remove the entries that are too old:
 		Int64 LimitDateTime = time(nullptr) - MAX_AGE;
 		{
-			SQLite::Statement stmt(db, "INSERT INTO PlayerNameToUUID(PlayerName, UUID, DateTime) VALUES (?, ?, ?)");
-			cCSLock Lock(m_CSNameToUUID);
-			for (cProfileMap::const_iterator itr = m_NameToUUID.begin(), end = m_NameToUUID.end(); itr != end; ++itr)
+			SQLite::Statement stmt(*m_DB, "DELETE FROM PlayerNameToUUID WHERE DateTime < ?");
+			stmt.bind(1, LimitDateTime);
+			stmt.exec();
+		}
+		{
+			SQLite::Statement stmt(*m_DB, "DELETE FROM UUIDToProfile WHERE DateTime < ?");
+			stmt.bind(1, LimitDateTime);
+			stmt.exec();
+		}
+
+		// Replace the changed entries - m_NameToUUID:
+		{
+			SQLite::Statement stmtDelete(*m_DB, "DELETE FROM PlayerNameToUUID WHERE PlayerName = ? COLLATE NOCASE");
+			SQLite::Statement stmtInsert(*m_DB, "INSERT INTO PlayerNameToUUID(PlayerName, UUID, DateTime) VALUES (?, ?, ?)");
+			cCSLock LockNames(m_CSNameToUUID);
+			for (cProfileMap::iterator itr = m_NameToUUID.begin(), end = m_NameToUUID.end(); itr != end; ++itr)
 			{
-				if (itr->second.m_DateTime < LimitDateTime)
+				if (!itr->second.m_IsDirty || (itr->second.m_DateTime < LimitDateTime))
 				{
-					// This item is too old, do not save
+					// This item hasn't changed, or is too old, do not save
 					continue;
 				}
-				stmt.bind(1, itr->second.m_PlayerName);
-				stmt.bind(2, itr->second.m_UUID);
-				stmt.bind(3, itr->second.m_DateTime);
-				stmt.exec();
-				stmt.reset();
+				stmtDelete.bind(1, itr->second.m_PlayerName);
+				stmtDelete.exec();
+				stmtDelete.reset();
+				stmtInsert.bind(1, itr->second.m_PlayerName);
+				stmtInsert.bind(2, itr->second.m_UUID);
+				stmtInsert.bind(3, itr->second.m_DateTime);
+				stmtInsert.exec();
+				stmtInsert.reset();
+				itr->second.m_IsDirty = false;
 			}
 		}
 
-		// Save all cache entries - m_UUIDToProfile:
+		// Replace the changed entries - m_UUIDToProfile:
 		{
-			SQLite::Statement stmt(db, "INSERT INTO UUIDToProfile(UUID, PlayerName, Textures, TexturesSignature, DateTime) VALUES (?, ?, ?, ?, ?)");
-			cCSLock Lock(m_CSUUIDToProfile);
-			for (cProfileMap::const_iterator itr = m_UUIDToProfile.begin(), end = m_UUIDToProfile.end(); itr != end; ++itr)
+			SQLite::Statement stmtDelete(*m_DB, "DELETE FROM UUIDToProfile WHERE UUID = ?");
+			SQLite::Statement stmtInsert(*m_DB, "INSERT INTO UUIDToProfile(UUID, PlayerName, Textures, TexturesSignature, DateTime) VALUES (?, ?, ?, ?, ?)");
+			cCSLock LockProfiles(m_CSUUIDToProfile);
+			for (cProfileMap::iterator itr = m_UUIDToProfile.begin(), end = m_UUIDToProfile.end(); itr != end; ++itr)
 			{
-				if (itr->second.m_DateTime < LimitDateTime)
+				if (!itr->second.m_IsDirty || (itr->second.m_DateTime < LimitDateTime))
 				{
-					// This item is too old, do not save
+					// This item hasn't changed, or is too old, do not save
 					continue;
 				}
-				stmt.bind(1, itr->second.m_UUID);
-				stmt.bind(2, itr->second.m_PlayerName);
-				stmt.bind(3, itr->second.m_Textures);
-				stmt.bind(4, itr->second.m_TexturesSignature);
-				stmt.bind(5, itr->second.m_DateTime);
-				stmt.exec();
-				stmt.reset();
+				stmtDelete.bind(1, itr->second.m_UUID);
+				stmtDelete.exec();
+				stmtDelete.reset();
+				stmtInsert.bind(1, itr->second.m_UUID);
+				stmtInsert.bind(2, itr->second.m_PlayerName);
+				stmtInsert.bind(3, itr->second.m_Textures);
+				stmtInsert.bind(4, itr->second.m_TexturesSignature);
+				stmtInsert.bind(5, itr->second.m_DateTime);
+				stmtInsert.exec();
+				stmtInsert.reset();
+				itr->second.m_IsDirty = false;
 			}
 		}
+
+		Transaction.commit();
 	}
 	catch (const SQLite::Exception & ex)
 	{
@@ -620,21 +700,147 @@ void cMojangAPI::SaveCachesToDisk(void)
 
 
 
+bool cMojangAPI::FindNameToUUID(const AString & a_LowerPlayerName, sProfile & a_Profile)
+{
+	{
+		cCSLock Lock(m_CSNameToUUID);
+		cProfileMap::const_iterator itr = m_NameToUUID.find(a_LowerPlayerName);
+		if (itr != m_NameToUUID.end())
+		{
+			a_Profile = itr->second;
+			return true;
+		}
+	}
+
+	// Not used since the start, try the disk cache:
+	if (!LoadProfileFromDisk(
+		"SELECT PlayerName, UUID, '', '', DateTime FROM PlayerNameToUUID WHERE PlayerName = ? COLLATE NOCASE ORDER BY DateTime DESC LIMIT 1",
+		a_LowerPlayerName, a_Profile
+	))
+	{
+		return false;
+	}
+
+	// Keep any value that has been added in the meantime, it is newer:
+	cCSLock Lock(m_CSNameToUUID);
+	a_Profile = m_NameToUUID.insert(std::make_pair(a_LowerPlayerName, a_Profile)).first->second;
+	return true;
+}
+
+
+
+
+
+bool cMojangAPI::FindUUIDToName(const AString & a_UUID, sProfile & a_Profile)
+{
+	{
+		cCSLock Lock(m_CSUUIDToName);
+		cProfileMap::const_iterator itr = m_UUIDToName.find(a_UUID);
+		if (itr != m_UUIDToName.end())
+		{
+			a_Profile = itr->second;
+			return true;
+		}
+	}
+
+	// Not used since the start, try the disk cache:
+	if (!LoadProfileFromDisk(
+		"SELECT PlayerName, UUID, '', '', DateTime FROM PlayerNameToUUID WHERE UUID = ? ORDER BY DateTime DESC LIMIT 1",
+		a_UUID, a_Profile
+	))
+	{
+		return false;
+	}
+
+	// Keep any value that has been added in the meantime, it is newer:
+	cCSLock Lock(m_CSUUIDToName);
+	a_Profile = m_UUIDToName.insert(std::make_pair(a_UUID, a_Profile)).first->second;
+	return true;
+}
+
+
+
+
+
+bool cMojangAPI::FindUUIDToProfile(const AString & a_UUID, sProfile & a_Profile)
+{
+	{
+		cCSLock Lock(m_CSUUIDToProfile);
+		cProfileMap::const_iterator itr = m_UUIDToProfile.find(a_UUID);
+		if (itr != m_UUIDToProfile.end())
+		{
+			a_Profile = itr->second;
+			return true;
+		}
+	}
+
+	// Not used since the start, try the disk cache:
+	if (!LoadProfileFromDisk(
+		"SELECT PlayerName, UUID, Textures, TexturesSignature, DateTime FROM UUIDToProfile WHERE UUID = ? ORDER BY DateTime DESC LIMIT 1",
+		a_UUID, a_Profile
+	))
+	{
+		return false;
+	}
+
+	// Keep any value that has been added in the meantime, it is newer:
+	cCSLock Lock(m_CSUUIDToProfile);
+	a_Profile = m_UUIDToProfile.insert(std::make_pair(a_UUID, a_Profile)).first->second;
+	return true;
+}
+
+
+
+
+
+bool cMojangAPI::LoadProfileFromDisk(const char * a_Select, const AString & a_Value, sProfile & a_Profile)
+{
+	cCSLock Lock(m_CSDB);
+	if (m_DB == nullptr)
+	{
+		return false;
+	}
+	try
+	{
+		SQLite::Statement stmt(*m_DB, a_Select);
+		stmt.bind(1, a_Value);
+		if (!stmt.executeStep())
+		{
+			return false;
+		}
+		AString PlayerName        = stmt.getColumn(0);
+		AString UUID              = stmt.getColumn(1);
+		AString Textures          = stmt.getColumn(2);
+		AString TexturesSignature = stmt.getColumn(3);
+		Int64 DateTime            = stmt.getColumn(4);
+		a_Profile = sProfile(PlayerName, MakeUUIDShort(UUID), Textures, TexturesSignature, DateTime);
+		a_Profile.m_IsDirty = false;
+		return true;
+	}
+	catch (const SQLite::Exception & ex)
+	{
+		LOGINFO("Reading MojangAPI cache failed: %s", ex.what());
+		return false;
+	}
+}
+
+
+
+
+
 void cMojangAPI::CacheNamesToUUIDs(const AStringVector & a_PlayerNames)
 {
 	// Create a list of names to query, by removing those that are already cached:
 	AStringVector NamesToQuery;
 	NamesToQuery.reserve(a_PlayerNames.size());
+	for (AStringVector::const_iterator itr = a_PlayerNames.begin(), end = a_PlayerNames.end(); itr != end; ++itr)
 	{
-		cCSLock Lock(m_CSNameToUUID);
-		for (AStringVector::const_iterator itr = a_PlayerNames.begin(), end = a_PlayerNames.end(); itr != end; ++itr)
+		sProfile Profile;
+		if (!FindNameToUUID(*itr, Profile))
 		{
-			if (m_NameToUUID.find(*itr) == m_NameToUUID.end())
-			{
-				NamesToQuery.push_back(*itr);
-			}
-		}  // for itr - a_PlayerNames[]
-	}  // Lock(m_CSNameToUUID)
+			NamesToQuery.push_back(*itr);
+		}
+	}  // for itr - a_PlayerNames[]
 	
 	QueryNamesToUUIDs(NamesToQuery);
 }
@@ -753,12 +959,10 @@ void cMojangAPI::CacheUUIDToProfile(const AString & a_UUID)
 	ASSERT(a_UUID.size() == 32);
 	
 	// Check if already present:
+	sProfile Profile;
+	if (FindUUIDToProfile(a_UUID, Profile))
 	{
-		cCSLock Lock(m_CSUUIDToProfile);
-		if (m_UUIDToProfile.find(a_UUID) != m_UUIDToProfile.end())
-		{
-			return;
-		}
+		return;
 	}
 	
 	QueryUUIDToProfile(a_UUID);
@@ -877,6 +1081,53 @@ void cMojangAPI::NotifyNameUUID(const AString & a_PlayerName, const AString & a_
 
 
 
+void cMojangAPI::ProcessPendingLookups(void)
+{
+	// Take all the queued lookups:
+	std::map<AString, cUUIDCallbacks> NameLookups;
+	std::map<AString, cPlayerNameCallbacks> UUIDLookups;
+	{
+		cCSLock Lock(m_CSPendingLookups);
+		std::swap(NameLookups, m_PendingNameLookups);
+		std::swap(UUIDLookups, m_PendingUUIDLookups);
+	}
+
+	// Query all the names together, using the bulk requests:
+	if (!NameLookups.empty())
+	{
+		AStringVector PlayerNames;
+		PlayerNames.reserve(NameLookups.size());
+		for (auto & Lookup: NameLookups)
+		{
+			PlayerNames.push_back(Lookup.first);
+		}
+		CacheNamesToUUIDs(PlayerNames);
+		for (auto & Lookup: NameLookups)
+		{
+			AString UUID = GetUUIDFromPlayerName(Lookup.first, true);
+			for (auto & Callback: Lookup.second)
+			{
+				Callback.second(Callback.first, UUID);
+			}
+		}
+	}
+
+	// The profiles can only be queried one by one:
+	for (auto & Lookup: UUIDLookups)
+	{
+		CacheUUIDToProfile(Lookup.first);
+		AString PlayerName = GetPlayerNameFromUUID(Lookup.first, true);
+		for (auto & Callback: Lookup.second)
+		{
+			Callback.second(Callback.first, PlayerName);
+		}
+	}
+}
+
+
+
+
+
 void cMojangAPI::Update(void)
 {
 	Int64 LimitDateTime = time(nullptr) - MAX_AGE;
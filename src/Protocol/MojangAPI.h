@@ -23,6 +23,11 @@ namespace Json
 	class Value;
 }
 
+namespace SQLite
+{
+	class Database;
+}
+
 
 
 
@@ -36,14 +41,26 @@ public:
 	cMojangAPI(void);
 	~cMojangAPI();
 	
+	/** The callback for the asynchronous name-to-UUID lookups.
+	Receives the player name as given to the lookup and the UUID (empty on error). */
+	typedef std::function<void(const AString & a_PlayerName, const AString & a_UUID)> cUUIDCallback;
+
+	/** The callback for the asynchronous UUID-to-name lookups.
+	Receives the UUID as given to the lookup and the player name (empty on error). */
+	typedef std::function<void(const AString & a_UUID, const AString & a_PlayerName)> cPlayerNameCallback;
+
+
 	/** Initializes the API; reads the settings from the specified ini file.
-	Loads cached results from disk. */
+	Opens the disk cache, the cached results are read from it as they are needed. */
 	void Start(cIniFile & a_SettingsIni, bool a_ShouldAuth);
 	
 	/** Connects to the specified server using SSL, sends the given request and receives the response.
 	Checks Mojang certificates using the hard-coded Starfield root CA certificate.
 	Returns true if all was successful, false on failure. */
 	static bool SecureRequest(const AString & a_ServerName, const AString & a_Request, AString & a_Response);
+
+	/** Returns the hard-coded root CA certificates (PEM) that the Mojang servers' certificates are checked against. */
+	static const AString & GetTrustedRootCerts(void);
 	
 	/** Normalizes the given UUID to its short form (32 bytes, no dashes, lowercase).
 	Logs a warning and returns empty string if not a UUID.
@@ -79,6 +96,18 @@ public:
 	If a_UseOnlyCached is false, the names not found in the cache are looked up online, which is a blocking
 	operation, do not use this in world-tick thread! */
 	AStringVector GetUUIDsFromPlayerNames(const AStringVector & a_PlayerName, bool a_UseOnlyCached = false);
+
+	/** Converts a player name into a UUID without blocking, calls a_Callback with the result.
+	If the name is cached, the callback is called right away, from the calling thread. Otherwise the name is looked up
+	in the update thread, together with all the other names queued in the meantime, using a single request for up
+	to MAX_PER_QUERY names; the callback is called from the update thread then. */
+	void GetUUIDFromPlayerNameAsync(const AString & a_PlayerName, cUUIDCallback a_Callback);
+
+	/** Converts a UUID into a player name without blocking, calls a_Callback with the result.
+	Both short and dashed UUID formats are accepted.
+	If the UUID is cached, the callback is called right away, from the calling thread. Otherwise the UUID is looked up
+	in the update thread and the callback is called from there; concurrent lookups of the same UUID share a single request. */
+	void GetPlayerNameFromUUIDAsync(const AString & a_UUID, cPlayerNameCallback a_Callback);
 	
 	/** Called by the Authenticator to add a PlayerName -> UUID mapping that it has received from
 	authenticating a user. This adds the cache item and "refreshes" it if existing, adjusting its datetime
@@ -105,6 +134,7 @@ protected:
 		AString m_Textures;           // The Textures field of the profile properties
 		AString m_TexturesSignature;  // The signature of the Textures field of the profile properties
 		Int64   m_DateTime;           // UNIXtime of the profile lookup
+		bool    m_IsDirty;            // True if the profile has changed since it was read from / written to the disk cache
 		
 		/** Default constructor for the container's sake. */
 		sProfile(void) :
@@ -112,7 +142,8 @@ protected:
 			m_UUID(),
 			m_Textures(),
 			m_TexturesSignature(),
-			m_DateTime(time(nullptr))
+			m_DateTime(time(nullptr)),
+			m_IsDirty(true)
 		{
 		}
 		
@@ -128,7 +159,8 @@ protected:
 			m_UUID(a_UUID),
 			m_Textures(a_Textures),
 			m_TexturesSignature(a_TexturesSignature),
-			m_DateTime(a_DateTime)
+			m_DateTime(a_DateTime),
+			m_IsDirty(true)
 		{
 		}
 		
@@ -142,6 +174,12 @@ protected:
 	};
 	typedef std::map<AString, sProfile> cProfileMap;
 
+	/** The callbacks waiting for a single name-to-UUID lookup, each with the player name as given to the lookup. */
+	typedef std::vector<std::pair<AString, cUUIDCallback>> cUUIDCallbacks;
+
+	/** The callbacks waiting for a single UUID-to-name lookup, each with the UUID as given to the lookup. */
+	typedef std::vector<std::pair<AString, cPlayerNameCallback>> cPlayerNameCallbacks;
+
 	
 	/** The server to connect to when converting player names to UUIDs. For example "api.mojang.com". */
 	AString m_NameToUUIDServer;
@@ -182,15 +220,51 @@ protected:
 	/** Protects m_RankMgr agains simultaneous multi-threaded access. */
 	cCriticalSection m_CSRankMgr;
 
+	/** The asynchronous name-to-UUID lookups waiting for the update thread, by lowercased player name.
+	Protected by m_CSPendingLookups. */
+	std::map<AString, cUUIDCallbacks> m_PendingNameLookups;
+
+	/** The asynchronous UUID-to-name lookups waiting for the update thread, by short lowercased UUID.
+	Protected by m_CSPendingLookups. */
+	std::map<AString, cPlayerNameCallbacks> m_PendingUUIDLookups;
+
+	/** Protects m_PendingNameLookups and m_PendingUUIDLookups against simultaneous multi-threaded access. */
+	cCriticalSection m_CSPendingLookups;
+
+	/** The disk cache. The in-memory caches only hold the values used since the start, the rest is read on demand.
+	nullptr if the disk cache cannot be opened. Protected by m_CSDB. */
+	UniquePtr<SQLite::Database> m_DB;
+
+	/** Protects m_DB against simultaneous multi-threaded access. Never held while waiting for the in-memory caches' locks,
+	except in SaveCachesToDisk(). */
+	cCriticalSection m_CSDB;
+
 	/** The thread that periodically updates the stale data in the DB from the Mojang servers. */
 	SharedPtr<cUpdateThread> m_UpdateThread;
 	
 	
-	/** Loads the caches from a disk storage. */
-	void LoadCachesFromDisk(void);
+	/** Opens the disk cache, creating it if it doesn't exist. */
+	void OpenDiskCache(void);
 	
-	/** Saves the caches to a disk storage. */
+	/** Writes the changed cache entries into the disk cache and removes the too old entries from it. */
 	void SaveCachesToDisk(void);
+
+	/** Finds the lowercased player name in m_NameToUUID, or in the disk cache if not there (and adds it to m_NameToUUID).
+	Returns false if not found in either. */
+	bool FindNameToUUID(const AString & a_LowerPlayerName, sProfile & a_Profile);
+
+	/** Finds the short UUID in m_UUIDToName, or in the disk cache if not there (and adds it to m_UUIDToName).
+	Returns false if not found in either. */
+	bool FindUUIDToName(const AString & a_UUID, sProfile & a_Profile);
+
+	/** Finds the short UUID in m_UUIDToProfile, or in the disk cache if not there (and adds it to m_UUIDToProfile).
+	Returns false if not found in either. */
+	bool FindUUIDToProfile(const AString & a_UUID, sProfile & a_Profile);
+
+	/** Runs the specified SELECT on the disk cache, with a_Value bound as its only parameter, and returns the first row
+	as a profile. The SELECT must return PlayerName, UUID, Textures, TexturesSignature and DateTime, in this order.
+	Returns false if there's no such row or the disk cache isn't available. */
+	bool LoadProfileFromDisk(const char * a_Select, const AString & a_Value, sProfile & a_Profile);
 	
 	/** Makes sure all specified names are in the m_PlayerNameToUUID cache. Downloads any missing ones from Mojang API servers.
 	Names that are not valid are not added into the cache.
@@ -217,6 +291,10 @@ protected:
 	If assigned, notifies the m_RankManager of the event. */
 	void NotifyNameUUID(const AString & a_PlayerName, const AString & a_PlayerUUID);
 
+	/** Performs the queued asynchronous lookups and calls their callbacks.
+	Called from the cUpdateThread, blocks on the HTTPS API calls. */
+	void ProcessPendingLookups(void);
+
 	/** Updates the stale values in the DB from the Mojang servers. Called from the cUpdateThread, blocks on the HTTPS API calls. */
 	void Update(void);
 } ;  // tolua_export
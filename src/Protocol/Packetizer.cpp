@@ -92,7 +92,7 @@ void cPacketizer::WriteUUID(const AString & a_UUID)
 	for (size_t i = 0; i < 32; i += 2)
 	{
 		auto val = static_cast<UInt8>(HexDigitValue(a_UUID[i]) << 4 | HexDigitValue(a_UUID[i + 1]));
-		VERIFY(m_Out.WriteBEUInt8(val));
+		WriteBEUInt8(val);
 	}
 }
 
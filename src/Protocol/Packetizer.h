@@ -12,24 +12,34 @@
 
 #include "Protocol.h"
 #include "../ByteBuffer.h"
+#include "../Endianness.h"
 
 
 
 
 
-/** Composes an individual packet in the protocol's m_OutPacketBuffer; sends it just before being destructed. */
+/** Composes an individual packet in the protocol's m_OutPacketData; sends it just before being destructed.
+The packet is encoded directly into the contiguous buffer, behind MAX_HEADER_SIZE bytes reserved for the protocol's framing,
+so that the protocol can put the length header right in front of the data and send the whole packet in one go.
+The buffer keeps its capacity between the packets, so composing a packet normally doesn't allocate. */
 class cPacketizer
 {
 public:
-	/** Starts serializing a new packet into the protocol's m_OutPacketBuffer.
+	/** The space reserved in front of the packet data for the framing header: up to two VarInts
+	(the packet length and, with compression enabled, the uncompressed length). */
+	static const size_t MAX_HEADER_SIZE = 2 * cByteBuffer::MAX_VARINT32_SIZE;
+
+
+	/** Starts serializing a new packet into the protocol's m_OutPacketData.
 	Locks the protocol's m_CSPacket to avoid multithreading issues. */
 	cPacketizer(cProtocol & a_Protocol, UInt32 a_PacketType) :
 		m_Protocol(a_Protocol),
-		m_Out(a_Protocol.m_OutPacketBuffer),
+		m_Out(a_Protocol.m_OutPacketData),
 		m_Lock(a_Protocol.m_CSPacket),
 		m_PacketType(a_PacketType)  // Used for logging purposes
 	{
-		m_Out.WriteVarInt32(a_PacketType);
+		m_Out.assign(MAX_HEADER_SIZE, '\0');
+		WriteVarInt32(a_PacketType);
 	}
 
 	/** Sends the packet via the contained protocol's SendPacket() function. */
@@ -37,91 +47,102 @@ public:
 
 	inline void WriteBool(bool a_Value)
 	{
-		VERIFY(m_Out.WriteBool(a_Value));
+		m_Out.push_back(a_Value ? 1 : 0);
 	}
 
 	inline void WriteBEUInt8(UInt8 a_Value)
 	{
-		VERIFY(m_Out.WriteBEUInt8(a_Value));
+		m_Out.push_back(static_cast<char>(a_Value));
 	}
 
 
 	inline void WriteBEInt8(Int8 a_Value)
 	{
-		VERIFY(m_Out.WriteBEInt8(a_Value));
+		m_Out.push_back(static_cast<char>(a_Value));
 	}
 
 
 	inline void WriteBEInt16(Int16 a_Value)
 	{
-		VERIFY(m_Out.WriteBEInt16(a_Value));
+		WriteBEUInt16(static_cast<UInt16>(a_Value));
 	}
 
 
-	inline void WriteBEUInt16(short a_Value)
+	inline void WriteBEUInt16(UInt16 a_Value)
 	{
-		VERIFY(m_Out.WriteBEUInt16(a_Value));
+		char Data[2] = { static_cast<char>(a_Value >> 8), static_cast<char>(a_Value) };
+		m_Out.append(Data, sizeof(Data));
 	}
 
 
 	inline void WriteBEInt32(Int32 a_Value)
 	{
-		VERIFY(m_Out.WriteBEInt32(a_Value));
+		WriteBEUInt32(static_cast<UInt32>(a_Value));
 	}
 
 
 	inline void WriteBEUInt32(UInt32 a_Value)
 	{
-		VERIFY(m_Out.WriteBEUInt32(a_Value));
+		UInt32 Converted = HostToNetwork4(&a_Value);
+		m_Out.append(reinterpret_cast<const char *>(&Converted), sizeof(Converted));
 	}
 
 
 	inline void WriteBEInt64(Int64 a_Value)
 	{
-		VERIFY(m_Out.WriteBEInt64(a_Value));
+		WriteBEUInt64(static_cast<UInt64>(a_Value));
 	}
 
 
 	inline void WriteBEUInt64(UInt64 a_Value)
 	{
-		VERIFY(m_Out.WriteBEUInt64(a_Value));
+		UInt64 Converted = HostToNetwork8(&a_Value);
+		m_Out.append(reinterpret_cast<const char *>(&Converted), sizeof(Converted));
 	}
 
 
 	inline void WriteBEFloat(float a_Value)
 	{
-		VERIFY(m_Out.WriteBEFloat(a_Value));
+		UInt32 Converted = HostToNetwork4(&a_Value);
+		m_Out.append(reinterpret_cast<const char *>(&Converted), sizeof(Converted));
 	}
 
 
 	inline void WriteBEDouble(double a_Value)
 	{
-		VERIFY(m_Out.WriteBEDouble(a_Value));
+		UInt64 Converted = HostToNetwork8(&a_Value);
+		m_Out.append(reinterpret_cast<const char *>(&Converted), sizeof(Converted));
 	}
 
 
 	inline void WriteVarInt32(UInt32 a_Value)
 	{
-		VERIFY(m_Out.WriteVarInt32(a_Value));
+		Byte Data[cByteBuffer::MAX_VARINT32_SIZE];
+		m_Out.append(reinterpret_cast<const char *>(Data), cByteBuffer::EncodeVarInt32(a_Value, Data));
 	}
 
 
 	inline void WriteString(const AString & a_Value)
 	{
-		VERIFY(m_Out.WriteVarUTF8String(a_Value));
+		WriteVarInt32(static_cast<UInt32>(a_Value.size()));
+		m_Out.append(a_Value);
 	}
 
 
 	inline void WriteBuf(const char * a_Data, size_t a_Size)
 	{
-		VERIFY(m_Out.Write(a_Data, a_Size));
+		m_Out.append(a_Data, a_Size);
 	}
 
 
 	/** Writes the specified block position as a single encoded 64-bit BigEndian integer. */
 	inline void WritePosition64(int a_BlockX, int a_BlockY, int a_BlockZ)
 	{
-		VERIFY(m_Out.WritePosition64(a_BlockX, a_BlockY, a_BlockZ));
+		WriteBEInt64(
+			(static_cast<Int64>(a_BlockX & 0x3FFFFFF) << 38) |
+			(static_cast<Int64>(a_BlockY & 0xFFF) << 26) |
+			(static_cast<Int64>(a_BlockZ & 0x3FFFFFF))
+		);
 	}
 
 	/** Writes the specified angle using a single byte. */
@@ -139,8 +160,8 @@ protected:
 	/** The protocol instance in which the packet is being constructed. */
 	cProtocol & m_Protocol;
 
-	/** The protocol's buffer for the constructed packet data. */
-	cByteBuffer & m_Out;
+	/** The protocol's buffer for the constructed packet data, including the space reserved for the header. */
+	AString & m_Out;
 
 	/** The RAII lock preventing multithreaded access to the protocol buffer while constructing the packet. */
 	cCSLock m_Lock;
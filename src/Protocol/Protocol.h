@@ -52,8 +52,7 @@ class cProtocol
 public:
 	cProtocol(cClientHandle * a_Client) :
 		m_Client(a_Client),
-		m_OutPacketBuffer(64 KiB),
-		m_OutPacketLenBuffer(20)  // 20 bytes is more than enough for one VarInt
+		m_CaptureData(nullptr)
 	{
 	}
 
@@ -61,6 +60,18 @@ public:
 	
 	/// Called when client sends some data
 	virtual void DataReceived(const char * a_Data, size_t a_Size) = 0;
+
+	/** Returns true if the further incoming data can be split into packets on the network thread, using DecodeReceivedData(),
+	instead of being passed to DataReceived() in the tick thread. Called in the tick thread. Once true, the client handle
+	never calls DataReceived() again. */
+	virtual bool CanDecodeOnNetworkThread(void) { return false; }
+
+	/** Called on the network thread with the incoming data once CanDecodeOnNetworkThread() has returned true.
+	Decrypts, decompresses and splits the data into packets, which are then queued for HandleDecodedPackets(). */
+	virtual void DecodeReceivedData(const char * a_Data, size_t a_Size) { UNUSED(a_Data); UNUSED(a_Size); }
+
+	/** Handles the packets queued by DecodeReceivedData(). Called in the tick thread. */
+	virtual void HandleDecodedPackets(void) {}
 	
 	// Sending stuff to clients (alphabetically sorted):
 	virtual void SendAttachEntity               (const cEntity & a_Entity, const cEntity * a_Vehicle) = 0;
@@ -79,7 +90,7 @@ public:
 	virtual void SendEntityEquipment            (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item) = 0;
 	virtual void SendEntityHeadLook             (const cEntity & a_Entity) = 0;
 	virtual void SendEntityLook                 (const cEntity & a_Entity) = 0;
-	virtual void SendEntityMetadata             (const cEntity & a_Entity) = 0;
+	virtual void SendEntityMetadata             (const cEntity & a_Entity, int a_Fields) = 0;
 	virtual void SendEntityProperties           (const cEntity & a_Entity) = 0;
 	virtual void SendEntityRelMove              (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) = 0;
 	virtual void SendEntityRelMoveLook          (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) = 0;
@@ -142,6 +153,31 @@ public:
 	/// Returns the ServerID used for authentication through session.minecraft.net
 	virtual AString GetAuthServerID(void) = 0;
 
+	/** Starts capturing the outgoing packet data into a_Data instead of sending it, until StopCapture() is called.
+	The protocol stays locked for other threads for the whole duration, so that their packets don't get mixed in.
+	Used for serializing a packet once and then sending the same data to all clients with the same protocol version. */
+	virtual void StartCapture(AString & a_Data)
+	{
+		m_CSPacket.Lock();
+		ASSERT(m_CaptureData == nullptr);
+		m_CaptureData = &a_Data;
+	}
+
+	/** Stops capturing the outgoing packet data started by StartCapture(). */
+	virtual void StopCapture(void)
+	{
+		ASSERT(m_CaptureData != nullptr);
+		m_CaptureData = nullptr;
+		m_CSPacket.Unlock();
+	}
+
+	/** Sends packet data captured by StartCapture() on a protocol of the same version. */
+	virtual void SendCapturedData(const char * a_Data, size_t a_Size)
+	{
+		cCSLock Lock(m_CSPacket);
+		SendData(a_Data, a_Size);
+	}
+
 protected:
 	friend class cPacketizer;
 
@@ -152,11 +188,13 @@ protected:
 	Automated via cPacketizer class. */
 	cCriticalSection m_CSPacket;
 
-	/** Buffer for composing the outgoing packets, through cPacketizer */
-	cByteBuffer m_OutPacketBuffer;
-	
-	/** Buffer for composing packet length (so that each cPacketizer instance doesn't allocate a new cPacketBuffer) */
-	cByteBuffer m_OutPacketLenBuffer;
+	/** Buffer for composing the outgoing packets, through cPacketizer.
+	The packet data starts after cPacketizer::MAX_HEADER_SIZE bytes reserved for the packet header, see SendPacket(). */
+	AString m_OutPacketData;
+
+	/** If not nullptr, the outgoing data is appended here instead of being sent, see StartCapture().
+	SendData() implementations need to honor this. */
+	AString * m_CaptureData;
 	
 	/** A generic data-sending routine, all outgoing packet data needs to be routed through this so that descendants may override it. */
 	virtual void SendData(const char * a_Data, size_t a_Size) = 0;
@@ -115,11 +115,21 @@ cProtocol172::cProtocol172(cClientHandle * a_Client, const AString & a_ServerAdd
 	AStringVector Params;
 	if (cRoot::Get()->GetServer()->ShouldAllowBungeeCord() && SplitZeroTerminatedStrings(a_ServerAddress, Params) && (Params.size() == 4))
 	{
-		LOGD("Player at %s connected via BungeeCord", Params[1].c_str());
-		m_ServerAddress = Params[0];
-		m_Client->SetIPString(Params[1]);
-		m_Client->SetUUID(cMojangAPI::MakeUUIDShort(Params[2]));
-		m_Client->SetProperties(Params[3]);
+		AString UUID = cMojangAPI::MakeUUIDShort(Params[2]);
+		Json::Value Properties;
+		Json::Reader Reader;
+		if ((UUID.size() == 32) && Reader.parse(Params[3], Properties, false))
+		{
+			LOGD("Player at %s connected via BungeeCord", Params[1].c_str());
+			m_ServerAddress = Params[0];
+			m_Client->SetIPString(Params[1]);
+			m_Client->SetUUID(UUID);
+			m_Client->SetProperties(Properties);
+		}
+		else
+		{
+			LOGWARNING("Received a malformed BungeeCord handshake, ignoring the forwarded data.");
+		}
 	}
 	
 	// Create the comm log file, if so requested:
@@ -414,13 +424,13 @@ void cProtocol172::SendEntityLook(const cEntity & a_Entity)
 
 
 
-void cProtocol172::SendEntityMetadata(const cEntity & a_Entity)
+void cProtocol172::SendEntityMetadata(const cEntity & a_Entity, int a_Fields)
 {
 	ASSERT(m_State == 3);  // In game mode?
 	
 	cPacketizer Pkt(*this, 0x1c);  // Entity Metadata packet
 	Pkt.WriteBEUInt32(a_Entity.GetUniqueID());
-	WriteEntityMetadata(Pkt, a_Entity);
+	WriteEntityMetadata(Pkt, a_Entity, a_Fields);
 	Pkt.WriteBEUInt8(0x7f);  // The termination byte
 }
 
@@ -1562,7 +1572,10 @@ void cProtocol172::AddReceivedData(const char * a_Data, size_t a_Size)
 			);
 		}
 
-		if (!HandlePacket(bb, PacketType))
+		auto HandleStart = std::chrono::steady_clock::now();
+		bool IsHandled = HandlePacket(bb, PacketType);
+		m_Client->GetNetworkStats().PacketHandled(std::chrono::steady_clock::now() - HandleStart);
+		if (!IsHandled)
 		{
 			// Unknown packet, already been reported, but without the length. Log the length here:
 			LOGWARNING("Unhandled packet: type 0x%x, state %d, length %u", PacketType, m_State, PacketLen);
@@ -1730,39 +1743,19 @@ void cProtocol172::HandlePacketStatusPing(cByteBuffer & a_ByteBuffer)
 void cProtocol172::HandlePacketStatusRequest(cByteBuffer & a_ByteBuffer)
 {
 	cServer * Server = cRoot::Get()->GetServer();
+	if (!Server->ShouldAnswerStatusPing(m_Client->GetIPString()))
+	{
+		// Pinging too often, drop the connection without building anything:
+		m_Client->Kick("Too many status pings");
+		return;
+	}
 	AString ServerDescription = Server->GetDescription();
 	int NumPlayers = Server->GetNumPlayers();
 	int MaxPlayers = Server->GetMaxPlayers();
 	AString Favicon = Server->GetFaviconData();
 	cRoot::Get()->GetPluginManager()->CallHookServerPing(*m_Client, ServerDescription, NumPlayers, MaxPlayers, Favicon);
 
-	// Version:
-	Json::Value Version;
-	Version["name"] = "MCServer 1.7.2";
-	Version["protocol"] = 4;
-
-	// Players:
-	Json::Value Players;
-	Players["online"] = NumPlayers;
-	Players["max"] = MaxPlayers;
-	// TODO: Add "sample"
-
-	// Description:
-	Json::Value Description;
-	Description["text"] = ServerDescription.c_str();
-
-	// Create the response:
-	Json::Value ResponseValue;
-	ResponseValue["version"] = Version;
-	ResponseValue["players"] = Players;
-	ResponseValue["description"] = Description;
-	if (!Favicon.empty())
-	{
-		ResponseValue["favicon"] = Printf("data:image/png;base64,%s", Favicon.c_str());
-	}
-
-	Json::StyledWriter Writer;
-	AString Response = Writer.write(ResponseValue);
+	AString Response = Server->GetStatusResponse(4, "MCServer 1.7.2", ServerDescription, NumPlayers, MaxPlayers, Favicon);
 
 	cPacketizer Pkt(*this, 0x00);  // Response packet
 	Pkt.WriteString(Response);
@@ -2371,6 +2364,13 @@ void cProtocol172::HandleVanillaPluginMessage(cByteBuffer & a_ByteBuffer, const
 
 void cProtocol172::SendData(const char * a_Data, size_t a_Size)
 {
+	if (m_CaptureData != nullptr)
+	{
+		// Capturing the data for sending to multiple clients, the encryption is done per client in SendCapturedData():
+		m_CaptureData->append(a_Data, a_Size);
+		return;
+	}
+
 	if (m_IsEncrypted)
 	{
 		Byte Encrypted[8192];  // Larger buffer, we may be sending lots of data (chunks)
@@ -2395,27 +2395,28 @@ void cProtocol172::SendData(const char * a_Data, size_t a_Size)
 
 void cProtocol172::SendPacket(cPacketizer & a_Packet)
 {
-	AString DataToSend;
+	// The packet data follows the space that cPacketizer reserved for the header:
+	const size_t MaxHeaderSize = cPacketizer::MAX_HEADER_SIZE;
+	ASSERT(m_OutPacketData.size() > MaxHeaderSize);
+	UInt32 PacketLen = static_cast<UInt32>(m_OutPacketData.size() - MaxHeaderSize);
 
-	// Send the packet length
-	UInt32 PacketLen = static_cast<UInt32>(m_OutPacketBuffer.GetUsedSpace());
-
-	m_OutPacketLenBuffer.WriteVarInt32(PacketLen);
-	m_OutPacketLenBuffer.ReadAll(DataToSend);
-	SendData(DataToSend.data(), DataToSend.size());
-	m_OutPacketLenBuffer.CommitRead();
-	
-	// Send the packet data:
-	m_OutPacketBuffer.ReadAll(DataToSend);
-	SendData(DataToSend.data(), DataToSend.size());
-	m_OutPacketBuffer.CommitRead();
+	// Put the packet length right in front of the data and send the whole packet at once:
+	Byte Header[cByteBuffer::MAX_VARINT32_SIZE];
+	size_t HeaderSize = cByteBuffer::EncodeVarInt32(PacketLen, Header);
+	char * PacketStart = &m_OutPacketData[MaxHeaderSize - HeaderSize];
+	memcpy(PacketStart, Header, HeaderSize);
+	SendData(PacketStart, HeaderSize + PacketLen);
+	if (m_CaptureData == nullptr)
+	{
+		// The captured packets are counted by each client they're sent to, as broadcast data
+		m_Client->GetNetworkStats().PacketSent(a_Packet.GetPacketType(), HeaderSize + PacketLen);
+	}
 	
 	// Log the comm into logfile:
 	if (g_ShouldLogCommOut)
 	{
 		AString Hex;
-		ASSERT(DataToSend.size() > 0);
-		CreateHexDump(Hex, DataToSend.data(), DataToSend.size(), 16);
+		CreateHexDump(Hex, m_OutPacketData.data() + MaxHeaderSize, PacketLen, 16);
 		m_CommLogFile.Printf("Outgoing packet: type %d (0x%x), length %u (0x%x), state %d. Payload (incl. type):\n%s\n",
 			a_Packet.GetPacketType(), a_Packet.GetPacketType(), PacketLen, PacketLen, m_State, Hex.c_str()
 		);
@@ -2759,33 +2760,41 @@ void cProtocol172::WriteBlockEntity(cPacketizer & a_Pkt, const cBlockEntity & a_
 
 
 
-void cProtocol172::WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity)
+void cProtocol172::WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity, int a_Fields)
 {
 	// Common metadata:
-	Byte Flags = 0;
-	if (a_Entity.IsOnFire())
-	{
-		Flags |= 0x01;
-	}
-	if (a_Entity.IsCrouched())
-	{
-		Flags |= 0x02;
-	}
-	if (a_Entity.IsSprinting())
-	{
-		Flags |= 0x08;
-	}
-	if (a_Entity.IsRclking())
+	if ((a_Fields & emfFlags) != 0)
 	{
-		Flags |= 0x10;
+		Byte Flags = 0;
+		if (a_Entity.IsOnFire())
+		{
+			Flags |= 0x01;
+		}
+		if (a_Entity.IsCrouched())
+		{
+			Flags |= 0x02;
+		}
+		if (a_Entity.IsSprinting())
+		{
+			Flags |= 0x08;
+		}
+		if (a_Entity.IsRclking())
+		{
+			Flags |= 0x10;
+		}
+		if (a_Entity.IsInvisible())
+		{
+			Flags |= 0x20;
+		}
+		a_Pkt.WriteBEUInt8(0);  // Byte(0) + index 0
+		a_Pkt.WriteBEUInt8(Flags);
 	}
-	if (a_Entity.IsInvisible())
+	
+	// Type-specific metadata:
+	if ((a_Fields & emfSpecific) == 0)
 	{
-		Flags |= 0x20;
+		return;
 	}
-	a_Pkt.WriteBEUInt8(0);  // Byte(0) + index 0
-	a_Pkt.WriteBEUInt8(Flags);
-	
 	switch (a_Entity.GetEntityType())
 	{
 		case cEntity::etPlayer: break;  // TODO?
@@ -3172,39 +3181,19 @@ void cProtocol176::SendPlayerSpawn(const cPlayer & a_Player)
 void cProtocol176::HandlePacketStatusRequest(cByteBuffer & a_ByteBuffer)
 {
 	cServer * Server = cRoot::Get()->GetServer();
+	if (!Server->ShouldAnswerStatusPing(m_Client->GetIPString()))
+	{
+		// Pinging too often, drop the connection without building anything:
+		m_Client->Kick("Too many status pings");
+		return;
+	}
 	AString Motd = Server->GetDescription();
 	int NumPlayers = Server->GetNumPlayers();
 	int MaxPlayers = Server->GetMaxPlayers();
 	AString Favicon = Server->GetFaviconData();
 	cRoot::Get()->GetPluginManager()->CallHookServerPing(*m_Client, Motd, NumPlayers, MaxPlayers, Favicon);
 
-	// Version:
-	Json::Value Version;
-	Version["name"] = "MCServer 1.7.6";
-	Version["protocol"] = 5;
-
-	// Players:
-	Json::Value Players;
-	Players["online"] = NumPlayers;
-	Players["max"] = MaxPlayers;
-	// TODO: Add "sample"
-
-	// Description:
-	Json::Value Description;
-	Description["text"] = Motd.c_str();
-
-	// Create the response:
-	Json::Value ResponseValue;
-	ResponseValue["version"] = Version;
-	ResponseValue["players"] = Players;
-	ResponseValue["description"] = Description;
-	if (!Favicon.empty())
-	{
-		ResponseValue["favicon"] = Printf("data:image/png;base64,%s", Favicon.c_str());
-	}
-
-	Json::StyledWriter Writer;
-	AString Response = Writer.write(ResponseValue);
+	AString Response = Server->GetStatusResponse(5, "MCServer 1.7.6", Motd, NumPlayers, MaxPlayers, Favicon);
 
 	cPacketizer Pkt(*this, 0x00);  // Response packet
 	Pkt.WriteString(Response);
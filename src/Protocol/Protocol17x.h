@@ -79,7 +79,7 @@ public:
 	virtual void SendEntityEquipment            (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item) override;
 	virtual void SendEntityHeadLook             (const cEntity & a_Entity) override;
 	virtual void SendEntityLook                 (const cEntity & a_Entity) override;
-	virtual void SendEntityMetadata             (const cEntity & a_Entity) override;
+	virtual void SendEntityMetadata             (const cEntity & a_Entity, int a_Fields) override;
 	virtual void SendEntityProperties           (const cEntity & a_Entity) override;
 	virtual void SendEntityRelMove              (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) override;
 	virtual void SendEntityRelMoveLook          (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) override;
@@ -235,7 +235,8 @@ protected:
 	void WriteItem(cPacketizer & a_Pkt, const cItem & a_Item);
 
 	/** Writes the metadata for the specified entity, not including the terminating 0x7f. */
-	void WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity);
+	/** Writes the specified groups of the entity's metadata fields (eEntityMetadataFields bitmask), without the terminating byte. */
+	void WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity, int a_Fields = emfAll);
 
 	/** Writes the mob-specific metadata for the specified mob */
 	void WriteMobMetadata(cPacketizer & a_Pkt, const cMonster & a_Mob);
@@ -97,6 +97,93 @@ extern bool g_ShouldLogCommIn, g_ShouldLogCommOut;
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cDeflatePool:
+
+/** A pool of deflate streams used by cProtocol180::CompressPacket().
+Setting up the deflate state is expensive compared to compressing a small packet, so the streams are kept
+and only reset between uses. The pool grows to the number of threads compressing at the same time. */
+class cDeflatePool
+{
+public:
+	cDeflatePool(void) :
+		m_Level(Z_DEFAULT_COMPRESSION),
+		m_Strategy(Z_DEFAULT_STRATEGY)
+	{
+	}
+
+	~cDeflatePool()
+	{
+		DestroyFreeStreams();
+	}
+
+	/** Returns a stream ready for compressing a new packet, or nullptr on failure. Give it back using Return(). */
+	z_stream * Take(void)
+	{
+		int Level, Strategy;
+		{
+			cCSLock Lock(m_CS);
+			if (!m_Free.empty())
+			{
+				z_stream * res = m_Free.back();
+				m_Free.pop_back();
+				return res;
+			}
+			Level = m_Level;
+			Strategy = m_Strategy;
+		}
+
+		z_stream * res = new z_stream;
+		memset(res, 0, sizeof(z_stream));
+		if (deflateInit2(res, Level, Z_DEFLATED, 15, 8, Strategy) != Z_OK)
+		{
+			LOGWARNING("%s: Cannot initialize the deflate stream", __FUNCTION__);
+			delete res;
+			return nullptr;
+		}
+		return res;
+	}
+
+	/** Returns a stream obtained by Take() into the pool. */
+	void Return(z_stream * a_Stream)
+	{
+		deflateReset(a_Stream);
+		cCSLock Lock(m_CS);
+		m_Free.push_back(a_Stream);
+	}
+
+	/** Sets the compression parameters used for the streams created from now on. */
+	void SetParams(int a_Level, int a_Strategy)
+	{
+		cCSLock Lock(m_CS);
+		m_Level = a_Level;
+		m_Strategy = a_Strategy;
+		DestroyFreeStreams();
+	}
+
+protected:
+	cCriticalSection m_CS;
+	std::vector<z_stream *> m_Free;
+	int m_Level;
+	int m_Strategy;
+
+	void DestroyFreeStreams(void)
+	{
+		for (std::vector<z_stream *>::iterator itr = m_Free.begin(), end = m_Free.end(); itr != end; ++itr)
+		{
+			deflateEnd(*itr);
+			delete *itr;
+		}
+		m_Free.clear();
+	}
+} ;
+
+static cDeflatePool g_DeflatePool;
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cProtocol180:
 
@@ -106,9 +193,33 @@ cProtocol180::cProtocol180(cClientHandle * a_Client, const AString & a_ServerAdd
 	m_ServerPort(a_ServerPort),
 	m_State(a_State),
 	m_ReceivedData(32 KiB),
+	m_DecodeResult(erOK),
 	m_IsEncrypted(false),
 	m_LastSentDimension(dimNotSet)
 {
+	// BungeeCord handling:
+	// If BC is setup with ip_forward == true, it sends additional data in the login packet's ServerAddress field:
+	// hostname\00ip-address\00uuid\00profile-properties-as-json
+	AStringVector Params;
+	if (cRoot::Get()->GetServer()->ShouldAllowBungeeCord() && SplitZeroTerminatedStrings(a_ServerAddress, Params) && (Params.size() == 4))
+	{
+		AString UUID = cMojangAPI::MakeUUIDShort(Params[2]);
+		Json::Value Properties;
+		Json::Reader Reader;
+		if ((UUID.size() == 32) && Reader.parse(Params[3], Properties, false))
+		{
+			LOGD("Player at %s connected via BungeeCord", Params[1].c_str());
+			m_ServerAddress = Params[0];
+			m_Client->SetIPString(Params[1]);
+			m_Client->SetUUID(UUID);
+			m_Client->SetProperties(Properties);
+		}
+		else
+		{
+			LOGWARNING("Received a malformed BungeeCord handshake, ignoring the forwarded data.");
+		}
+	}
+	
 	// Create the comm log file, if so requested:
 	if (g_ShouldLogCommIn || g_ShouldLogCommOut)
 	{
@@ -126,6 +237,13 @@ cProtocol180::cProtocol180(cClientHandle * a_Client, const AString & a_ServerAdd
 			LOG("Cannot log communication to file, the log file \"%s\" cannot be opened for writing.", FileName.c_str());
 		}
 	}
+
+	// Record the logins for the tick replay; the status pings don't affect the world:
+	cTickRecorder & Recorder = cRoot::Get()->GetTickRecorder();
+	if (Recorder.IsRecording() && (a_State == 2))
+	{
+		Recorder.RecordConnect(a_Client->GetUniqueID(), a_ServerAddress, a_ServerPort);
+	}
 }
 
 
@@ -156,6 +274,105 @@ void cProtocol180::DataReceived(const char * a_Data, size_t a_Size)
 
 
 
+bool cProtocol180::CanDecodeOnNetworkThread(void)
+{
+	// Once in the game state, neither the encryption nor the compression changes anymore,
+	// so the packets can be split out without knowing what the preceding ones contained:
+	return (m_State == 3);
+}
+
+
+
+
+
+void cProtocol180::DecodeReceivedData(const char * a_Data, size_t a_Size)
+{
+	{
+		cCSLock Lock(m_CSDecodedPackets);
+		if (m_DecodeResult != erOK)
+		{
+			// An error has already been found in the stream, ignore any further data
+			return;
+		}
+	}
+
+	// Decrypt and split the data into packets:
+	AStringVector Packets;
+	eExtractResult Result = erOK;
+	Byte Decrypted[512];
+	while ((a_Size > 0) && (Result == erOK))
+	{
+		size_t NumBytes = a_Size;
+		const char * Data = a_Data;
+		if (m_IsEncrypted)
+		{
+			NumBytes = std::min(a_Size, sizeof(Decrypted));
+			m_Decryptor.ProcessData(Decrypted, reinterpret_cast<const Byte *>(a_Data), NumBytes);
+			Data = reinterpret_cast<const char *>(Decrypted);
+		}
+		Result = BufferReceivedData(Data, NumBytes);
+		if (Result == erOK)
+		{
+			do
+			{
+				Packets.push_back(AString());
+				Result = ExtractPacket(Packets.back());
+			} while (Result == erOK);
+			Packets.pop_back();  // The last item didn't receive a packet
+			if (Result == erIncomplete)
+			{
+				Result = erOK;
+			}
+		}
+		a_Size -= NumBytes;
+		a_Data += NumBytes;
+	}
+
+	// Queue the packets for the tick thread:
+	cCSLock Lock(m_CSDecodedPackets);
+	if (m_DecodedPackets.empty())
+	{
+		std::swap(m_DecodedPackets, Packets);
+	}
+	else
+	{
+		for (auto & Packet: Packets)
+		{
+			m_DecodedPackets.push_back(std::move(Packet));
+		}
+	}
+	m_DecodeResult = Result;
+}
+
+
+
+
+
+void cProtocol180::HandleDecodedPackets(void)
+{
+	AStringVector Packets;
+	eExtractResult Result;
+	{
+		cCSLock Lock(m_CSDecodedPackets);
+		std::swap(Packets, m_DecodedPackets);
+		Result = m_DecodeResult;
+		if (Result != erOK)
+		{
+			// Report the error only once, DecodeReceivedData() keeps ignoring data afterwards:
+			m_DecodeResult = erIncomplete;
+		}
+	}
+	for (AStringVector::const_iterator itr = Packets.begin(), end = Packets.end(); itr != end; ++itr)
+	{
+		HandlePacketData(*itr);
+	}
+	ReportExtractError(Result);
+}
+
+
+
+
+
 void cProtocol180::SendAttachEntity(const cEntity & a_Entity, const cEntity * a_Vehicle)
 {
 	ASSERT(m_State == 3);  // In game mode?
@@ -399,13 +616,13 @@ void cProtocol180::SendEntityLook(const cEntity & a_Entity)
 
 
 
-void cProtocol180::SendEntityMetadata(const cEntity & a_Entity)
+void cProtocol180::SendEntityMetadata(const cEntity & a_Entity, int a_Fields)
 {
 	ASSERT(m_State == 3);  // In game mode?
 	
 	cPacketizer Pkt(*this, 0x1c);  // Entity Metadata packet
 	Pkt.WriteVarInt32(a_Entity.GetUniqueID());
-	WriteEntityMetadata(Pkt, a_Entity);
+	WriteEntityMetadata(Pkt, a_Entity, a_Fields);
 	Pkt.WriteBEUInt8(0x7f);  // The termination byte
 }
 
@@ -1572,41 +1789,86 @@ void cProtocol180::SendWindowProperty(const cWindow & a_Window, short a_Property
 
 bool cProtocol180::CompressPacket(const AString & a_Packet, AString & a_CompressedData)
 {
-	// Compress the data:
-	char CompressedData[MAX_COMPRESSED_PACKET_LEN];
+	return CompressPacket(a_Packet.data(), a_Packet.size(), a_CompressedData);
+}
 
-	uLongf CompressedSize = compressBound(a_Packet.size());
+
+
+
+
+bool cProtocol180::CompressPacket(const char * a_Data, size_t a_Size, AString & a_CompressedData)
+{
+	// The header consists of two VarInts, each at most 5 bytes long.
+	// The data is compressed directly into a_CompressedData, behind the space reserved for the header:
+	const size_t MaxHeaderSize = 2 * cByteBuffer::MAX_VARINT32_SIZE;
+
+	uLongf CompressedSize = compressBound(a_Size);
 	if (CompressedSize >= MAX_COMPRESSED_PACKET_LEN)
 	{
 		ASSERT(!"Too high packet size.");
 		return false;
 	}
 
-	int Status = compress2(
-		reinterpret_cast<Bytef *>(CompressedData), &CompressedSize,
-		reinterpret_cast<const Bytef *>(a_Packet.data()), a_Packet.size(), Z_DEFAULT_COMPRESSION
-	);
-	if (Status != Z_OK)
+	z_stream * Stream = g_DeflatePool.Take();
+	if (Stream == nullptr)
 	{
 		return false;
 	}
+	a_CompressedData.resize(MaxHeaderSize + CompressedSize);
+	Stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(a_Data));
+	Stream->avail_in = static_cast<uInt>(a_Size);
+	Stream->next_out = reinterpret_cast<Bytef *>(&a_CompressedData[MaxHeaderSize]);
+	Stream->avail_out = static_cast<uInt>(CompressedSize);
+	int Status = deflate(Stream, Z_FINISH);
+	CompressedSize = Stream->total_out;
+	g_DeflatePool.Return(Stream);
+	if (Status != Z_STREAM_END)
+	{
+		a_CompressedData.clear();
+		return false;
+	}
+	a_CompressedData.resize(MaxHeaderSize + CompressedSize);
+
+	// The header is the length of the rest of the packet, then the uncompressed length:
+	Byte DataLength[cByteBuffer::MAX_VARINT32_SIZE];
+	size_t DataLengthSize = cByteBuffer::EncodeVarInt32(static_cast<UInt32>(a_Size), DataLength);
+	Byte Header[MaxHeaderSize];
+	size_t HeaderSize = cByteBuffer::EncodeVarInt32(static_cast<UInt32>(CompressedSize + DataLengthSize), Header);
+	memcpy(Header + HeaderSize, DataLength, DataLengthSize);
+	HeaderSize += DataLengthSize;
+
+	// Put the header right in front of the compressed data and drop the unused part of the reserved space:
+	ASSERT(HeaderSize <= MaxHeaderSize);
+	size_t HeaderStart = MaxHeaderSize - HeaderSize;
+	memcpy(&a_CompressedData[HeaderStart], Header, HeaderSize);
+	a_CompressedData.erase(0, HeaderStart);
+	return true;
+}
 
-	AString LengthData;
-	cByteBuffer Buffer(20);
-	Buffer.WriteVarInt32(static_cast<UInt32>(a_Packet.size()));
-	Buffer.ReadAll(LengthData);
-	Buffer.CommitRead();
 
-	Buffer.WriteVarInt32(CompressedSize + LengthData.size());
-	Buffer.WriteVarInt32(static_cast<UInt32>(a_Packet.size()));
-	Buffer.ReadAll(LengthData);
-	Buffer.CommitRead();
 
-	a_CompressedData.clear();
-	a_CompressedData.reserve(LengthData.size() + CompressedSize);
-	a_CompressedData.append(LengthData.data(), LengthData.size());
-	a_CompressedData.append(CompressedData, CompressedSize);
-	return true;
+
+
+void cProtocol180::SetCompressionParams(int a_Level, const AString & a_Strategy)
+{
+	int Strategy = Z_DEFAULT_STRATEGY;
+	if (NoCaseCompare(a_Strategy, "Filtered") == 0)
+	{
+		Strategy = Z_FILTERED;
+	}
+	else if (NoCaseCompare(a_Strategy, "HuffmanOnly") == 0)
+	{
+		Strategy = Z_HUFFMAN_ONLY;
+	}
+	else if (NoCaseCompare(a_Strategy, "RLE") == 0)
+	{
+		Strategy = Z_RLE;
+	}
+	else if (NoCaseCompare(a_Strategy, "Default") != 0)
+	{
+		LOGWARNING("Unknown packet compression strategy \"%s\", using the default one.", a_Strategy.c_str());
+	}
+	g_DeflatePool.SetParams(Clamp(a_Level, -1, 9), Strategy);
 }
 
 
@@ -1715,6 +1977,26 @@ void cProtocol180::FixItemFramePositions(int a_ObjectData, double & a_PosX, doub
 
 
 void cProtocol180::AddReceivedData(const char * a_Data, size_t a_Size)
+{
+	// Handle the packets one by one, each packet may change the state and thus the format of the following ones:
+	eExtractResult Result = BufferReceivedData(a_Data, a_Size);
+	AString Packet;
+	while (Result == erOK)
+	{
+		Result = ExtractPacket(Packet);
+		if (Result == erOK)
+		{
+			HandlePacketData(Packet);
+		}
+	}
+	ReportExtractError(Result);
+}
+
+
+
+
+
+cProtocol180::eExtractResult cProtocol180::BufferReceivedData(const char * a_Data, size_t a_Size)
 {
 	// Write the incoming data into the comm log file:
 	if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
@@ -1744,38 +2026,30 @@ void cProtocol180::AddReceivedData(const char * a_Data, size_t a_Size)
 	if (!m_ReceivedData.Write(a_Data, a_Size))
 	{
 		// Too much data in the incoming queue, report to caller:
-		m_Client->PacketBufferFull();
-		return;
+		return erBufferFull;
 	}
+	return erOK;
+}
+
+
+
 
-	// Handle all complete packets:
-	for (;;)
+
+cProtocol180::eExtractResult cProtocol180::ExtractPacket(AString & a_Packet)
+{
+	a_Packet.clear();
+	UInt32 PacketLen;
+	if (m_ReceivedData.ReadVarInt(PacketLen) && m_ReceivedData.CanReadBytes(PacketLen))
 	{
-		UInt32 PacketLen;
-		if (!m_ReceivedData.ReadVarInt(PacketLen))
-		{
-			// Not enough data
-			m_ReceivedData.ResetRead();
-			break;
-		}
-		if (!m_ReceivedData.CanReadBytes(PacketLen))
-		{
-			// The full packet hasn't been received yet
-			m_ReceivedData.ResetRead();
-			break;
-		}
-		
 		// Check packet for compression:
 		UInt32 CompressedSize = 0;
-		AString UncompressedData;
 		if (m_State == 3)
 		{
 			UInt32 NumBytesRead = m_ReceivedData.GetReadableSpace();
 			m_ReceivedData.ReadVarInt(CompressedSize);
 			if (CompressedSize > PacketLen)
 			{
-				m_Client->Kick("Bad compression");
-				return;
+				return erBadCompression;
 			}
 			if (CompressedSize > 0)
 			{
@@ -1783,11 +2057,9 @@ void cProtocol180::AddReceivedData(const char * a_Data, size_t a_Size)
 				AString CompressedData;
 				if (!m_ReceivedData.ReadString(CompressedData, CompressedSize))
 				{
-					m_Client->Kick("Compression failure");
-					return;
+					return erCompressionFailure;
 				}
-				InflateString(CompressedData.data(), CompressedSize, UncompressedData);
-				PacketLen = UncompressedData.size();
+				InflateString(CompressedData.data(), CompressedSize, a_Packet);
 			}
 			else
 			{
@@ -1796,93 +2068,17 @@ void cProtocol180::AddReceivedData(const char * a_Data, size_t a_Size)
 				PacketLen -= NumBytesRead;
 			}
 		}
-		
-		// Move the packet payload to a separate cByteBuffer, bb:
-		cByteBuffer bb(PacketLen + 1);
 		if (CompressedSize == 0)
 		{
 			// No compression was used, move directly
-			VERIFY(m_ReceivedData.ReadToByteBuffer(bb, (int)PacketLen));
-		}
-		else
-		{
-			// Compression was used, move the uncompressed data:
-			VERIFY(bb.Write(UncompressedData.data(), UncompressedData.size()));
+			VERIFY(m_ReceivedData.ReadString(a_Packet, PacketLen));
 		}
 		m_ReceivedData.CommitRead();
+		return erOK;
+	}
 
-		UInt32 PacketType;
-		if (!bb.ReadVarInt(PacketType))
-		{
-			// Not enough data
-			break;
-		}
-
-		// Write one NUL extra, so that we can detect over-reads
-		bb.Write("\0", 1);
-		
-		// Log the packet info into the comm log file:
-		if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
-		{
-			AString PacketData;
-			bb.ReadAll(PacketData);
-			bb.ResetRead();
-			bb.ReadVarInt(PacketType);  // We have already read the packet type once, it will be there again
-			ASSERT(PacketData.size() > 0);  // We have written an extra NUL, so there had to be at least one byte read
-			PacketData.resize(PacketData.size() - 1);
-			AString PacketDataHex;
-			CreateHexDump(PacketDataHex, PacketData.data(), PacketData.size(), 16);
-			m_CommLogFile.Printf("Next incoming packet is type %u (0x%x), length %u (0x%x) at state %d. Payload:\n%s\n",
-				PacketType, PacketType, PacketLen, PacketLen, m_State, PacketDataHex.c_str()
-			);
-		}
-
-		if (!HandlePacket(bb, PacketType))
-		{
-			// Unknown packet, already been reported, but without the length. Log the length here:
-			LOGWARNING("Unhandled packet: type 0x%x, state %d, length %u", PacketType, m_State, PacketLen);
-			
-			#ifdef _DEBUG
-				// Dump the packet contents into the log:
-				bb.ResetRead();
-				AString Packet;
-				bb.ReadAll(Packet);
-				Packet.resize(Packet.size() - 1);  // Drop the final NUL pushed there for over-read detection
-				AString Out;
-				CreateHexDump(Out, Packet.data(), (int)Packet.size(), 24);
-				LOGD("Packet contents:\n%s", Out.c_str());
-			#endif  // _DEBUG
-			
-			// Put a message in the comm log:
-			if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
-			{
-				m_CommLogFile.Printf("^^^^^^ Unhandled packet ^^^^^^\n\n\n");
-			}
-			
-			return;
-		}
-
-		// The packet should have 1 byte left in the buffer - the NUL we had added
-		if (bb.GetReadableSpace() != 1)
-		{
-			// Read more or less than packet length, report as error
-			LOGWARNING("Protocol 1.8: Wrong number of bytes read for packet 0x%x, state %d. Read " SIZE_T_FMT " bytes, packet contained %u bytes",
-				PacketType, m_State, bb.GetUsedSpace() - bb.GetReadableSpace(), PacketLen
-			);
-
-			// Put a message in the comm log:
-			if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
-			{
-				m_CommLogFile.Printf("^^^^^^ Wrong number of bytes read for this packet (exp %d left, got " SIZE_T_FMT " left) ^^^^^^\n\n\n",
-					1, bb.GetReadableSpace()
-				);
-				m_CommLogFile.Flush();
-			}
-
-			ASSERT(!"Read wrong number of bytes!");
-			m_Client->PacketError(PacketType);
-		}
-	}  // for (ever)
+	// The full packet hasn't been received yet
+	m_ReceivedData.ResetRead();
 
 	// Log any leftover bytes into the logfile:
 	if (g_ShouldLogCommIn && (m_ReceivedData.GetReadableSpace() > 0) && m_CommLogFile.IsOpen())
@@ -1900,11 +2096,124 @@ void cProtocol180::AddReceivedData(const char * a_Data, size_t a_Size)
 		);
 		m_CommLogFile.Flush();
 	}
+	return erIncomplete;
+}
+
+
+
+
+
+void cProtocol180::ReportExtractError(eExtractResult a_Result)
+{
+	switch (a_Result)
+	{
+		case erOK:
+		case erIncomplete:         break;
+		case erBufferFull:         m_Client->PacketBufferFull(); break;
+		case erBadCompression:     m_Client->Kick("Bad compression"); break;
+		case erCompressionFailure: m_Client->Kick("Compression failure"); break;
+	}
+}
+
+
+
+
+
+void cProtocol180::HandlePacketData(const AString & a_Packet)
+{
+	UInt32 PacketLen = static_cast<UInt32>(a_Packet.size());
+
+	// Move the packet payload to a separate cByteBuffer, bb:
+	cByteBuffer bb(a_Packet.size() + 1);
+	VERIFY(bb.Write(a_Packet.data(), a_Packet.size()));
+
+	UInt32 PacketType;
+	if (!bb.ReadVarInt(PacketType))
+	{
+		// Not enough data
+		return;
+	}
+
+	// Write one NUL extra, so that we can detect over-reads
+	bb.Write("\0", 1);
+
+	// Record the packet for the tick replay:
+	cTickRecorder & Recorder = cRoot::Get()->GetTickRecorder();
+	if (Recorder.IsRecording() && (m_State >= 2))
+	{
+		Recorder.RecordPacket(m_Client->GetUniqueID(), m_State, a_Packet);
+	}
+	
+	// Log the packet info into the comm log file:
+	if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
+	{
+		AString PacketData;
+		bb.ReadAll(PacketData);
+		bb.ResetRead();
+		bb.ReadVarInt(PacketType);  // We have already read the packet type once, it will be there again
+		ASSERT(PacketData.size() > 0);  // We have written an extra NUL, so there had to be at least one byte read
+		PacketData.resize(PacketData.size() - 1);
+		AString PacketDataHex;
+		CreateHexDump(PacketDataHex, PacketData.data(), PacketData.size(), 16);
+		m_CommLogFile.Printf("Next incoming packet is type %u (0x%x), length %u (0x%x) at state %d. Payload:\n%s\n",
+			PacketType, PacketType, PacketLen, PacketLen, m_State, PacketDataHex.c_str()
+		);
+	}
+
+	auto HandleStart = std::chrono::steady_clock::now();
+	bool IsHandled = HandlePacket(bb, PacketType);
+	m_Client->GetNetworkStats().PacketHandled(std::chrono::steady_clock::now() - HandleStart);
+	if (!IsHandled)
+	{
+		// Unknown packet, already been reported, but without the length. Log the length here:
+		LOGWARNING("Unhandled packet: type 0x%x, state %d, length %u", PacketType, m_State, PacketLen);
+		
+		#ifdef _DEBUG
+			// Dump the packet contents into the log:
+			bb.ResetRead();
+			AString Packet;
+			bb.ReadAll(Packet);
+			Packet.resize(Packet.size() - 1);  // Drop the final NUL pushed there for over-read detection
+			AString Out;
+			CreateHexDump(Out, Packet.data(), (int)Packet.size(), 24);
+			LOGD("Packet contents:\n%s", Out.c_str());
+		#endif  // _DEBUG
+		
+		// Put a message in the comm log:
+		if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
+		{
+			m_CommLogFile.Printf("^^^^^^ Unhandled packet ^^^^^^\n\n\n");
+		}
+		
+		return;
+	}
+
+	// The packet should have 1 byte left in the buffer - the NUL we had added
+	if (bb.GetReadableSpace() != 1)
+	{
+		// Read more or less than packet length, report as error
+		LOGWARNING("Protocol 1.8: Wrong number of bytes read for packet 0x%x, state %d. Read " SIZE_T_FMT " bytes, packet contained %u bytes",
+			PacketType, m_State, bb.GetUsedSpace() - bb.GetReadableSpace(), PacketLen
+		);
+
+		// Put a message in the comm log:
+		if (g_ShouldLogCommIn && m_CommLogFile.IsOpen())
+		{
+			m_CommLogFile.Printf("^^^^^^ Wrong number of bytes read for this packet (exp %d left, got " SIZE_T_FMT " left) ^^^^^^\n\n\n",
+				1, bb.GetReadableSpace()
+			);
+			m_CommLogFile.Flush();
+		}
+
+		ASSERT(!"Read wrong number of bytes!");
+		m_Client->PacketError(PacketType);
+	}
 }
 
 
 
 
+
 bool cProtocol180::HandlePacket(cByteBuffer & a_ByteBuffer, UInt32 a_PacketType)
 {
 	switch (m_State)
@@ -2006,39 +2315,19 @@ void cProtocol180::HandlePacketStatusPing(cByteBuffer & a_ByteBuffer)
 void cProtocol180::HandlePacketStatusRequest(cByteBuffer & a_ByteBuffer)
 {
 	cServer * Server = cRoot::Get()->GetServer();
+	if (!Server->ShouldAnswerStatusPing(m_Client->GetIPString()))
+	{
+		// Pinging too often, drop the connection without building anything:
+		m_Client->Kick("Too many status pings");
+		return;
+	}
 	AString ServerDescription = Server->GetDescription();
 	int NumPlayers = Server->GetNumPlayers();
 	int MaxPlayers = Server->GetMaxPlayers();
 	AString Favicon = Server->GetFaviconData();
 	cRoot::Get()->GetPluginManager()->CallHookServerPing(*m_Client, ServerDescription, NumPlayers, MaxPlayers, Favicon);
 
-	// Version:
-	Json::Value Version;
-	Version["name"] = "MCServer 1.8";
-	Version["protocol"] = 47;
-
-	// Players:
-	Json::Value Players;
-	Players["online"] = NumPlayers;
-	Players["max"] = MaxPlayers;
-	// TODO: Add "sample"
-
-	// Description:
-	Json::Value Description;
-	Description["text"] = ServerDescription.c_str();
-
-	// Create the response:
-	Json::Value ResponseValue;
-	ResponseValue["version"] = Version;
-	ResponseValue["players"] = Players;
-	ResponseValue["description"] = Description;
-	if (!Favicon.empty())
-	{
-		ResponseValue["favicon"] = Printf("data:image/png;base64,%s", Favicon.c_str());
-	}
-
-	Json::StyledWriter Writer;
-	AString Response = Writer.write(ResponseValue);
+	AString Response = Server->GetStatusResponse(47, "MCServer 1.8", ServerDescription, NumPlayers, MaxPlayers, Favicon);
 
 	cPacketizer Pkt(*this, 0x00);  // Response packet
 	Pkt.WriteString(Response);
@@ -2655,6 +2944,13 @@ void cProtocol180::HandleVanillaPluginMessage(cByteBuffer & a_ByteBuffer, const
 
 void cProtocol180::SendData(const char * a_Data, size_t a_Size)
 {
+	if (m_CaptureData != nullptr)
+	{
+		// Capturing the data for sending to multiple clients, the encryption is done per client in SendCapturedData():
+		m_CaptureData->append(a_Data, a_Size);
+		return;
+	}
+
 	if (m_IsEncrypted)
 	{
 		Byte Encrypted[8192];  // Larger buffer, we may be sending lots of data (chunks)
@@ -2830,54 +3126,56 @@ eBlockFace cProtocol180::FaceIntToBlockFace(Int8 a_BlockFace)
 
 void cProtocol180::SendPacket(cPacketizer & a_Pkt)
 {
-	UInt32 PacketLen = static_cast<UInt32>(m_OutPacketBuffer.GetUsedSpace());
-	AString PacketData, CompressedPacket;
-	m_OutPacketBuffer.ReadAll(PacketData);
-	m_OutPacketBuffer.CommitRead();
+	// The packet data follows the space that cPacketizer reserved for the header:
+	const size_t MaxHeaderSize = cPacketizer::MAX_HEADER_SIZE;
+	ASSERT(m_OutPacketData.size() > MaxHeaderSize);
+	const char * PacketData = m_OutPacketData.data() + MaxHeaderSize;
+	UInt32 PacketLen = static_cast<UInt32>(m_OutPacketData.size() - MaxHeaderSize);
 
+	size_t NumBytesSent;
 	if ((m_State == 3) && (PacketLen >= 256))
 	{
-		// Compress the packet payload:
-		if (!cProtocol180::CompressPacket(PacketData, CompressedPacket))
+		// Compress the packet payload, the compressed data includes its header:
+		if (!cProtocol180::CompressPacket(PacketData, PacketLen, m_OutCompressedData))
 		{
 			return;
 		}
-	}
-	else if (m_State == 3)
-	{
-		// The packet is not compressed, indicate this in the packet header:
-		m_OutPacketLenBuffer.WriteVarInt32(PacketLen + 1);
-		m_OutPacketLenBuffer.WriteVarInt32(0);
-		AString LengthData;
-		m_OutPacketLenBuffer.ReadAll(LengthData);
-		SendData(LengthData.data(), LengthData.size());
+		SendData(m_OutCompressedData.data(), m_OutCompressedData.size());
+		NumBytesSent = m_OutCompressedData.size();
 	}
 	else
 	{
-		// Compression doesn't apply to this state, send raw data:
-		m_OutPacketLenBuffer.WriteVarInt32(PacketLen);
-		AString LengthData;
-		m_OutPacketLenBuffer.ReadAll(LengthData);
-		SendData(LengthData.data(), LengthData.size());
-	}
+		Byte Header[MaxHeaderSize];
+		size_t HeaderSize;
+		if (m_State == 3)
+		{
+			// The packet is not compressed, indicate this in the packet header:
+			HeaderSize = cByteBuffer::EncodeVarInt32(PacketLen + 1, Header);
+			HeaderSize += cByteBuffer::EncodeVarInt32(0, Header + HeaderSize);
+		}
+		else
+		{
+			// Compression doesn't apply to this state, send raw data:
+			HeaderSize = cByteBuffer::EncodeVarInt32(PacketLen, Header);
+		}
 
-	// Send the packet's payload, either direct or compressed:
-	if (CompressedPacket.empty())
-	{
-		m_OutPacketLenBuffer.CommitRead();
-		SendData(PacketData.data(), PacketData.size());
+		// Put the header right in front of the data and send the whole packet at once:
+		char * PacketStart = &m_OutPacketData[MaxHeaderSize - HeaderSize];
+		memcpy(PacketStart, Header, HeaderSize);
+		SendData(PacketStart, HeaderSize + PacketLen);
+		NumBytesSent = HeaderSize + PacketLen;
 	}
-	else
+	if (m_CaptureData == nullptr)
 	{
-		SendData(CompressedPacket.data(), CompressedPacket.size());
+		// The captured packets are counted by each client they're sent to, as broadcast data
+		m_Client->GetNetworkStats().PacketSent(a_Pkt.GetPacketType(), NumBytesSent);
 	}
 
 	// Log the comm into logfile:
 	if (g_ShouldLogCommOut && m_CommLogFile.IsOpen())
 	{
 		AString Hex;
-		ASSERT(PacketData.size() > 0);
-		CreateHexDump(Hex, PacketData.data(), PacketData.size(), 16);
+		CreateHexDump(Hex, PacketData, PacketLen, 16);
 		m_CommLogFile.Printf("Outgoing packet: type %d (0x%x), length %u (0x%x), state %d. Payload (incl. type):\n%s\n",
 			a_Pkt.GetPacketType(), a_Pkt.GetPacketType(), PacketLen, PacketLen, m_State, Hex.c_str()
 		);
@@ -3061,33 +3359,41 @@ void cProtocol180::WriteBlockEntity(cPacketizer & a_Pkt, const cBlockEntity & a_
 
 
 
-void cProtocol180::WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity)
+void cProtocol180::WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity, int a_Fields)
 {
 	// Common metadata:
-	Byte Flags = 0;
-	if (a_Entity.IsOnFire())
-	{
-		Flags |= 0x01;
-	}
-	if (a_Entity.IsCrouched())
-	{
-		Flags |= 0x02;
-	}
-	if (a_Entity.IsSprinting())
+	if ((a_Fields & emfFlags) != 0)
 	{
-		Flags |= 0x08;
-	}
-	if (a_Entity.IsRclking())
-	{
-		Flags |= 0x10;
+		Byte Flags = 0;
+		if (a_Entity.IsOnFire())
+		{
+			Flags |= 0x01;
+		}
+		if (a_Entity.IsCrouched())
+		{
+			Flags |= 0x02;
+		}
+		if (a_Entity.IsSprinting())
+		{
+			Flags |= 0x08;
+		}
+		if (a_Entity.IsRclking())
+		{
+			Flags |= 0x10;
+		}
+		if (a_Entity.IsInvisible())
+		{
+			Flags |= 0x20;
+		}
+		a_Pkt.WriteBEUInt8(0);  // Byte(0) + index 0
+		a_Pkt.WriteBEUInt8(Flags);
 	}
-	if (a_Entity.IsInvisible())
+	
+	// Type-specific metadata:
+	if ((a_Fields & emfSpecific) == 0)
 	{
-		Flags |= 0x20;
+		return;
 	}
-	a_Pkt.WriteBEUInt8(0);  // Byte(0) + index 0
-	a_Pkt.WriteBEUInt8(Flags);
-	
 	switch (a_Entity.GetEntityType())
 	{
 		case cEntity::etPlayer: break;  // TODO?
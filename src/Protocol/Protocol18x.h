@@ -59,6 +59,10 @@ public:
 	/** Called when client sends some data: */
 	virtual void DataReceived(const char * a_Data, size_t a_Size) override;
 
+	virtual bool CanDecodeOnNetworkThread(void) override;
+	virtual void DecodeReceivedData(const char * a_Data, size_t a_Size) override;
+	virtual void HandleDecodedPackets(void) override;
+
 	/** Sending stuff to clients (alphabetically sorted): */
 	virtual void SendAttachEntity               (const cEntity & a_Entity, const cEntity * a_Vehicle) override;
 	virtual void SendBlockAction                (int a_BlockX, int a_BlockY, int a_BlockZ, char a_Byte1, char a_Byte2, BLOCKTYPE a_BlockType) override;
@@ -76,7 +80,7 @@ public:
 	virtual void SendEntityEquipment            (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item) override;
 	virtual void SendEntityHeadLook             (const cEntity & a_Entity) override;
 	virtual void SendEntityLook                 (const cEntity & a_Entity) override;
-	virtual void SendEntityMetadata             (const cEntity & a_Entity) override;
+	virtual void SendEntityMetadata             (const cEntity & a_Entity, int a_Fields) override;
 	virtual void SendEntityProperties           (const cEntity & a_Entity) override;
 	virtual void SendEntityRelMove              (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) override;
 	virtual void SendEntityRelMoveLook          (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) override;
@@ -143,6 +147,13 @@ public:
 	If compression fails, the function returns false. */
 	static bool CompressPacket(const AString & a_Packet, AString & a_Compressed);
 
+	/** Compresses the a_Size bytes of packet data at a_Data, as CompressPacket() above. */
+	static bool CompressPacket(const char * a_Data, size_t a_Size, AString & a_Compressed);
+
+	/** Sets the zlib compression level (-1 for zlib's default, 0 - 9) and strategy ("Default", "Filtered", "HuffmanOnly" or "RLE")
+	used by CompressPacket() from now on. */
+	static void SetCompressionParams(int a_Level, const AString & a_Strategy);
+
 	/** The 1.8 protocol use a particle id instead of a string. This function converts the name to the id. If the name is incorrect, it returns 0. */
 	static int GetParticleID(const AString & a_ParticleName);
 
@@ -151,6 +162,16 @@ public:
 
 protected:
 
+	/** Result of splitting the received data into packets */
+	enum eExtractResult
+	{
+		erOK,                  ///< A packet has been extracted / the data has been buffered
+		erIncomplete,          ///< There's no complete packet in the buffer
+		erBufferFull,          ///< Too much data in the incoming buffer
+		erBadCompression,      ///< The compressed size in the packet header is invalid
+		erCompressionFailure,  ///< The compressed data cannot be read
+	} ;
+
 	AString m_ServerAddress;
 	
 	UInt16 m_ServerPort;
@@ -162,12 +183,27 @@ protected:
 
 	/** Buffer for the received data */
 	cByteBuffer m_ReceivedData;
+
+	/** Protects m_DecodedPackets and m_DecodeResult against multithreaded access. */
+	cCriticalSection m_CSDecodedPackets;
+
+	/** The packets split out by DecodeReceivedData() in the network thread, waiting for HandleDecodedPackets().
+	Each packet starts with its type VarInt. Protected by m_CSDecodedPackets. */
+	AStringVector m_DecodedPackets;
+
+	/** The result of the last DecodeReceivedData() call. Once it is an error, the further data is ignored;
+	HandleDecodedPackets() reports the error and changes the value to erIncomplete so that it is reported only once.
+	Protected by m_CSDecodedPackets. */
+	eExtractResult m_DecodeResult;
 	
 	bool m_IsEncrypted;
 	
 	cAesCfb128Decryptor m_Decryptor;
 	cAesCfb128Encryptor m_Encryptor;
 
+	/** Buffer for the compressed outgoing packets, kept so that its capacity is reused. Protected by m_CSPacket. */
+	AString m_OutCompressedData;
+
 	/** The logfile where the comm is logged, when g_ShouldLogComm is true */
 	cFile m_CommLogFile;
 	
@@ -179,6 +215,20 @@ protected:
 	/** Adds the received (unencrypted) data to m_ReceivedData, parses complete packets */
 	void AddReceivedData(const char * a_Data, size_t a_Size);
 
+	/** Adds the received (unencrypted) data to m_ReceivedData. Returns erOK or erBufferFull. */
+	eExtractResult BufferReceivedData(const char * a_Data, size_t a_Size);
+
+	/** Removes the next complete packet from m_ReceivedData and stores it, decompressed, into a_Packet.
+	The packet format depends on m_State, so the packets need to be extracted one by one while the state can change.
+	Returns erOK if a packet was extracted, erIncomplete if there's no complete packet, or an error. */
+	eExtractResult ExtractPacket(AString & a_Packet);
+
+	/** Reports an error returned by BufferReceivedData() or ExtractPacket() to the client handle. */
+	void ReportExtractError(eExtractResult a_Result);
+
+	/** Parses and handles a single packet extracted by ExtractPacket(). */
+	void HandlePacketData(const AString & a_Packet);
+
 	/** Reads and handles the packet. The packet length and type have already been read.
 	Returns true if the packet was understood, false if it was an unknown packet
 	*/
@@ -248,7 +298,8 @@ protected:
 	void WriteItem(cPacketizer & a_Pkt, const cItem & a_Item);
 
 	/** Writes the metadata for the specified entity, not including the terminating 0x7f. */
-	void WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity);
+	/** Writes the specified groups of the entity's metadata fields (eEntityMetadataFields bitmask), without the terminating byte. */
+	void WriteEntityMetadata(cPacketizer & a_Pkt, const cEntity & a_Entity, int a_Fields = emfAll);
 
 	/** Writes the mob-specific metadata for the specified mob */
 	void WriteMobMetadata(cPacketizer & a_Pkt, const cMonster & a_Mob);
@@ -88,6 +88,37 @@ void cProtocolRecognizer::DataReceived(const char * a_Data, size_t a_Size)
 
 
 
+bool cProtocolRecognizer::CanDecodeOnNetworkThread(void)
+{
+	return (m_Protocol != nullptr) && m_Protocol->CanDecodeOnNetworkThread();
+}
+
+
+
+
+
+void cProtocolRecognizer::DecodeReceivedData(const char * a_Data, size_t a_Size)
+{
+	ASSERT(m_Protocol != nullptr);
+	m_Protocol->DecodeReceivedData(a_Data, a_Size);
+}
+
+
+
+
+
+void cProtocolRecognizer::HandleDecodedPackets(void)
+{
+	if (m_Protocol != nullptr)
+	{
+		m_Protocol->HandleDecodedPackets();
+	}
+}
+
+
+
+
+
 void cProtocolRecognizer::SendAttachEntity(const cEntity & a_Entity, const cEntity * a_Vehicle)
 {
 	ASSERT(m_Protocol != nullptr);
@@ -260,10 +291,10 @@ void cProtocolRecognizer::SendEntityLook(const cEntity & a_Entity)
 
 
 
-void cProtocolRecognizer::SendEntityMetadata(const cEntity & a_Entity)
+void cProtocolRecognizer::SendEntityMetadata(const cEntity & a_Entity, int a_Fields)
 {
 	ASSERT(m_Protocol != nullptr);
-	m_Protocol->SendEntityMetadata(a_Entity);
+	m_Protocol->SendEntityMetadata(a_Entity, a_Fields);
 }
 
 
@@ -859,6 +890,36 @@ AString cProtocolRecognizer::GetAuthServerID(void)
 
 
 
+void cProtocolRecognizer::StartCapture(AString & a_Data)
+{
+	ASSERT(m_Protocol != nullptr);
+	m_Protocol->StartCapture(a_Data);
+}
+
+
+
+
+
+void cProtocolRecognizer::StopCapture(void)
+{
+	ASSERT(m_Protocol != nullptr);
+	m_Protocol->StopCapture();
+}
+
+
+
+
+
+void cProtocolRecognizer::SendCapturedData(const char * a_Data, size_t a_Size)
+{
+	ASSERT(m_Protocol != nullptr);
+	m_Protocol->SendCapturedData(a_Data, a_Size);
+}
+
+
+
+
+
 void cProtocolRecognizer::SendData(const char * a_Data, size_t a_Size)
 {
 	// This is used only when handling the server ping
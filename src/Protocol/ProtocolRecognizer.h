@@ -46,6 +46,10 @@ public:
 	
 	/// Called when client sends some data:
 	virtual void DataReceived(const char * a_Data, size_t a_Size) override;
+
+	virtual bool CanDecodeOnNetworkThread(void) override;
+	virtual void DecodeReceivedData(const char * a_Data, size_t a_Size) override;
+	virtual void HandleDecodedPackets(void) override;
 	
 	/// Sending stuff to clients (alphabetically sorted):
 	virtual void SendAttachEntity               (const cEntity & a_Entity, const cEntity * a_Vehicle) override;
@@ -64,7 +68,7 @@ public:
 	virtual void SendEntityEquipment            (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item) override;
 	virtual void SendEntityHeadLook             (const cEntity & a_Entity) override;
 	virtual void SendEntityLook                 (const cEntity & a_Entity) override;
-	virtual void SendEntityMetadata             (const cEntity & a_Entity) override;
+	virtual void SendEntityMetadata             (const cEntity & a_Entity, int a_Fields) override;
 	virtual void SendEntityProperties           (const cEntity & a_Entity) override;
 	virtual void SendEntityRelMove              (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) override;
 	virtual void SendEntityRelMoveLook          (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ) override;
@@ -126,8 +130,16 @@ public:
 	
 	virtual AString GetAuthServerID(void) override;
 
+	virtual void StartCapture(AString & a_Data) override;
+	virtual void StopCapture(void) override;
+	virtual void SendCapturedData(const char * a_Data, size_t a_Size) override;
+
 	virtual void SendData(const char * a_Data, size_t a_Size) override;
 
+	/** Returns the recognized protocol, or nullptr if the version hasn't been recognized yet.
+	The protocol stays owned by the recognizer; cClientHandle uses it to talk to the protocol directly, without the forwarding. */
+	cProtocol * GetRecognizedProtocol(void) { return m_Protocol; }
+
 protected:
 	cProtocol * m_Protocol;  ///< The recognized protocol
 	cByteBuffer m_Buffer;    ///< Buffer for the incoming data until we recognize the protocol
@@ -0,0 +1,342 @@
+
+// QueryServer.cpp
+
+// Implements the cQueryServer class representing the UDP server query (GameSpy4-style) responder
+
+#include "Globals.h"
+#include "QueryServer.h"
+#include "IniFile.h"
+#include "Root.h"
+#include "Server.h"
+#include "World.h"
+#include "Entities/Player.h"
+#include "Bindings/PluginManager.h"
+#include "Bindings/Plugin.h"
+#include "Protocol/ProtocolRecognizer.h"
+#include <random>
+
+
+
+
+
+enum
+{
+	// The packet types, both directions:
+	QUERY_PACKET_STAT      = 0,
+	QUERY_PACKET_HANDSHAKE = 9,
+} ;
+
+/** The magic that each query packet starts with. */
+static const Byte QUERY_MAGIC_1 = 0xfe;
+static const Byte QUERY_MAGIC_2 = 0xfd;
+
+/** Size of the query packet header: magic, type and the session ID. */
+static const size_t QUERY_HEADER_SIZE = 7;
+
+/** The number of seconds for which a challenge token is valid (for at least). */
+static const Int64 CHALLENGE_TOKEN_LIFETIME = 30;
+
+/** The interval at which the status snapshot is rebuilt, in msec. */
+static const float SNAPSHOT_INTERVAL = 1000;
+
+
+
+
+
+/** Appends the value as a null-terminated string. */
+static void AppendString(AString & a_Dest, const AString & a_Value)
+{
+	a_Dest.append(a_Value);
+	a_Dest.push_back('\0');
+}
+
+
+
+
+
+/** Appends the key-value pair of the full stat. */
+static void AppendKeyValue(AString & a_Dest, const char * a_Key, const AString & a_Value)
+{
+	AppendString(a_Dest, a_Key);
+	AppendString(a_Dest, a_Value);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cQueryServer:
+
+cQueryServer::cQueryServer(void) :
+	m_GamePort(0),
+	m_TimeSinceSnapshot(0),
+	m_ChallengeSecret(0)
+{
+}
+
+
+
+
+
+cQueryServer::~cQueryServer()
+{
+	Shutdown();
+}
+
+
+
+
+
+void cQueryServer::Initialize(cIniFile & a_IniFile, UInt16 a_GamePort)
+{
+	if (!a_IniFile.GetValueSetB("Query", "Enabled", false))
+	{
+		return;
+	}
+
+	int Port = a_IniFile.GetValueSetI("Query", "Port", 25565);
+	if ((Port <= 0) || (Port > 65535))
+	{
+		LOGWARNING("Invalid server query port: %d. The server query is now disabled.", Port);
+		return;
+	}
+	m_GamePort = a_GamePort;
+	m_ChallengeSecret = std::random_device()();  // Not MTRand, its seeds are predictable
+
+	// Build the first snapshot before answering anything:
+	UpdateSnapshot();
+
+	m_Endpoint = cNetwork::CreateUDPEndpoint(static_cast<UInt16>(Port), *this);
+	if (!m_Endpoint->IsOpen())
+	{
+		LOGWARNING("Cannot open the server query port %d. The server query is not accessible.", Port);
+		m_Endpoint.reset();
+		return;
+	}
+	LOGINFO("Answering the server queries on UDP port %d.", Port);
+}
+
+
+
+
+
+void cQueryServer::Shutdown(void)
+{
+	if (m_Endpoint != nullptr)
+	{
+		m_Endpoint->Close();
+		m_Endpoint.reset();
+	}
+}
+
+
+
+
+
+void cQueryServer::Tick(float a_Dt)
+{
+	if (m_Endpoint == nullptr)
+	{
+		return;
+	}
+	m_TimeSinceSnapshot += a_Dt;
+	if (m_TimeSinceSnapshot < SNAPSHOT_INTERVAL)
+	{
+		return;
+	}
+	m_TimeSinceSnapshot = 0;
+	UpdateSnapshot();
+}
+
+
+
+
+
+void cQueryServer::UpdateSnapshot(void)
+{
+	cServer * Server = cRoot::Get()->GetServer();
+	AString NumPlayers = Printf("%d", Server->GetNumPlayers());
+	AString MaxPlayers = Printf("%d", Server->GetMaxPlayers());
+	cWorld * DefaultWorld = cRoot::Get()->GetDefaultWorld();
+	AString Map = (DefaultWorld != nullptr) ? DefaultWorld->GetName() : AString();
+
+	// Basic stat:
+	AString BasicStat;
+	AppendString(BasicStat, Server->GetDescription());
+	AppendString(BasicStat, "SMP");
+	AppendString(BasicStat, Map);
+	AppendString(BasicStat, NumPlayers);
+	AppendString(BasicStat, MaxPlayers);
+	BasicStat.push_back(static_cast<char>(m_GamePort & 0xff));  // The port is little-endian
+	BasicStat.push_back(static_cast<char>(m_GamePort >> 8));
+	AppendString(BasicStat, "0.0.0.0");
+
+	// The plugin list, in the same format as the vanilla server's plugins (Bukkit's "Server: Plugin; Plugin" format):
+	class cPluginNames :
+		public cPluginManager::cPluginCallback
+	{
+	public:
+		AString m_Names;
+
+		virtual bool Item(cPlugin * a_Plugin) override
+		{
+			if (!a_Plugin->IsLoaded())
+			{
+				return false;
+			}
+			m_Names.append(m_Names.empty() ? ": " : "; ");
+			m_Names.append(a_Plugin->GetName());
+			return false;
+		}
+	} PluginNames;
+	cPluginManager::Get()->ForEachPlugin(PluginNames);
+
+	class cPlayerNames :
+		public cPlayerListCallback
+	{
+	public:
+		AString m_Names;
+
+		virtual bool Item(cPlayer * a_Player) override
+		{
+			AppendString(m_Names, a_Player->GetName());
+			return false;
+		}
+	} PlayerNames;
+	cRoot::Get()->ForEachPlayer(PlayerNames);
+
+	// Full stat:
+	AString FullStat("splitnum\0\x80\0", 11);
+	AppendKeyValue(FullStat, "hostname",   Server->GetDescription());
+	AppendKeyValue(FullStat, "gametype",   "SMP");
+	AppendKeyValue(FullStat, "game_id",    "MINECRAFT");
+	AppendKeyValue(FullStat, "version",    MCS_CLIENT_VERSIONS);
+	AppendKeyValue(FullStat, "plugins",    "MCServer" + PluginNames.m_Names);
+	AppendKeyValue(FullStat, "map",        Map);
+	AppendKeyValue(FullStat, "numplayers", NumPlayers);
+	AppendKeyValue(FullStat, "maxplayers", MaxPlayers);
+	AppendKeyValue(FullStat, "hostport",   Printf("%u", m_GamePort));
+	AppendKeyValue(FullStat, "hostip",     "0.0.0.0");
+	FullStat.push_back('\0');  // End of the key-value section
+	FullStat.append("\x01player_\0\0", 10);
+	FullStat.append(PlayerNames.m_Names);
+	FullStat.push_back('\0');  // End of the player list
+
+	cCSLock Lock(m_CS);
+	std::swap(m_BasicStat, BasicStat);
+	std::swap(m_FullStat, FullStat);
+}
+
+
+
+
+
+Int32 cQueryServer::GetChallengeToken(const AString & a_RemoteHost, Int64 a_TimeSlot) const
+{
+	size_t Hash = std::hash<AString>()(Printf("%u/%lld/%s", m_ChallengeSecret, a_TimeSlot, a_RemoteHost.c_str()));
+	return static_cast<Int32>(Hash & 0x7fffffff);  // The token is sent as a decimal string, keep it positive
+}
+
+
+
+
+
+Int64 cQueryServer::GetCurrentTimeSlot(void)
+{
+	auto Now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::seconds>(Now).count() / CHALLENGE_TOKEN_LIFETIME;
+}
+
+
+
+
+
+void cQueryServer::SendResponse(Byte a_Type, UInt32 a_SessionID, const AString & a_Payload, const AString & a_RemoteHost, UInt16 a_RemotePort)
+{
+	cUDPEndpointPtr Endpoint = m_Endpoint;
+	if (Endpoint == nullptr)
+	{
+		return;
+	}
+	AString Response;
+	Response.reserve(5 + a_Payload.size());
+	Response.push_back(static_cast<char>(a_Type));
+	Response.push_back(static_cast<char>(a_SessionID >> 24));
+	Response.push_back(static_cast<char>((a_SessionID >> 16) & 0xff));
+	Response.push_back(static_cast<char>((a_SessionID >> 8) & 0xff));
+	Response.push_back(static_cast<char>(a_SessionID & 0xff));
+	Response.append(a_Payload);
+	Endpoint->Send(Response, a_RemoteHost, a_RemotePort);
+}
+
+
+
+
+
+void cQueryServer::OnError(int a_ErrorCode, const AString & a_ErrorMsg)
+{
+	LOGWARNING("Server query error: %d (%s)", a_ErrorCode, a_ErrorMsg.c_str());
+}
+
+
+
+
+
+void cQueryServer::OnReceivedData(const char * a_Data, size_t a_Size, const AString & a_RemoteHost, UInt16 a_RemotePort)
+{
+	// Silently drop anything that isn't a query packet; the responses shouldn't help amplification attacks either,
+	// so the stats are only sent to those who have received a challenge token at their address:
+	const Byte * Data = reinterpret_cast<const Byte *>(a_Data);
+	if ((a_Size < QUERY_HEADER_SIZE) || (Data[0] != QUERY_MAGIC_1) || (Data[1] != QUERY_MAGIC_2))
+	{
+		return;
+	}
+	UInt32 SessionID = (
+		(static_cast<UInt32>(Data[3]) << 24) | (static_cast<UInt32>(Data[4]) << 16) |
+		(static_cast<UInt32>(Data[5]) << 8)  |  static_cast<UInt32>(Data[6])
+	) & 0x0f0f0f0f;  // The vanilla server masks the session ID the same way
+
+	switch (Data[2])
+	{
+		case QUERY_PACKET_HANDSHAKE:
+		{
+			AString Token;
+			AppendString(Token, Printf("%d", GetChallengeToken(a_RemoteHost, GetCurrentTimeSlot())));
+			SendResponse(QUERY_PACKET_HANDSHAKE, SessionID, Token, a_RemoteHost, a_RemotePort);
+			return;
+		}
+
+		case QUERY_PACKET_STAT:
+		{
+			if (a_Size < QUERY_HEADER_SIZE + 4)
+			{
+				return;
+			}
+			const Byte * TokenData = Data + QUERY_HEADER_SIZE;
+			Int32 Token = static_cast<Int32>(
+				(static_cast<UInt32>(TokenData[0]) << 24) | (static_cast<UInt32>(TokenData[1]) << 16) |
+				(static_cast<UInt32>(TokenData[2]) << 8)  |  static_cast<UInt32>(TokenData[3])
+			);
+			Int64 TimeSlot = GetCurrentTimeSlot();
+			if ((Token != GetChallengeToken(a_RemoteHost, TimeSlot)) && (Token != GetChallengeToken(a_RemoteHost, TimeSlot - 1)))
+			{
+				return;
+			}
+
+			// The full stat request is padded with 4 more bytes:
+			bool IsFullStat = (a_Size >= QUERY_HEADER_SIZE + 8);
+			AString Payload;
+			{
+				cCSLock Lock(m_CS);
+				Payload = IsFullStat ? m_FullStat : m_BasicStat;
+			}
+			SendResponse(QUERY_PACKET_STAT, SessionID, Payload, a_RemoteHost, a_RemotePort);
+			return;
+		}
+	}
+}
+
+
+
+
@@ -0,0 +1,88 @@
+
+// QueryServer.h
+
+// Declares the cQueryServer class representing the UDP server query (GameSpy4-style) responder
+
+
+
+
+
+#pragma once
+
+#include "OSSupport/Network.h"
+
+
+
+
+
+// fwd:
+class cIniFile;
+
+
+
+
+
+/** Answers the server list sites and the monitoring tools polling the server through the UDP query protocol
+(the GameSpy4-style protocol that the vanilla server enables with "enable-query"), so that the polling doesn't cost
+a TCP connection and a status handshake each time.
+The datagrams are answered in the network thread from a snapshot of the server status; the snapshot is rebuilt
+in the server's tick thread at most once per second, so the answers never touch the worlds or the plugins. */
+class cQueryServer :
+	public cUDPEndpoint::cCallbacks
+{
+public:
+	cQueryServer(void);
+	virtual ~cQueryServer();
+
+	/** Reads the settings and opens the endpoint, if the query is enabled. a_GamePort is the port reported to the clients. */
+	void Initialize(cIniFile & a_IniFile, UInt16 a_GamePort);
+
+	/** Closes the endpoint. */
+	void Shutdown(void);
+
+	/** Rebuilds the status snapshot, once per second. Called from the server's tick thread. */
+	void Tick(float a_Dt);
+
+protected:
+	/** Protects m_BasicStat and m_FullStat against multithreaded access. */
+	cCriticalSection m_CS;
+
+	/** The endpoint receiving the queries; nullptr if the query is disabled. */
+	cUDPEndpointPtr m_Endpoint;
+
+	/** The game port reported in the responses. */
+	UInt16 m_GamePort;
+
+	/** The payload of the basic stat response, following the response header. */
+	AString m_BasicStat;
+
+	/** The payload of the full stat response, following the response header. */
+	AString m_FullStat;
+
+	/** Time elapsed since the last snapshot rebuild, in msec. Only accessed from the tick thread. */
+	float m_TimeSinceSnapshot;
+
+	/** Random value mixed into the challenge tokens, so that they cannot be predicted. */
+	UInt32 m_ChallengeSecret;
+
+
+	/** Builds the status snapshot into m_BasicStat and m_FullStat. */
+	void UpdateSnapshot(void);
+
+	/** Returns the challenge token for the specified remote host, valid in the specified time slot. */
+	Int32 GetChallengeToken(const AString & a_RemoteHost, Int64 a_TimeSlot) const;
+
+	/** Returns the current challenge token time slot; a token is accepted in its slot and the one following it. */
+	static Int64 GetCurrentTimeSlot(void);
+
+	/** Sends the response of the specified type, with the specified payload, to the remote host. */
+	void SendResponse(Byte a_Type, UInt32 a_SessionID, const AString & a_Payload, const AString & a_RemoteHost, UInt16 a_RemotePort);
+
+	// cUDPEndpoint::cCallbacks overrides:
+	virtual void OnError(int a_ErrorCode, const AString & a_ErrorMsg) override;
+	virtual void OnReceivedData(const char * a_Data, size_t a_Size, const AString & a_RemoteHost, UInt16 a_RemotePort) override;
+} ;
+
+
+
+
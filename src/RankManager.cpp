@@ -384,6 +384,7 @@ protected:
 cRankManager::cRankManager(void) :
 	m_DB("Ranks.sqlite", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE),
 	m_IsInitialized(false),
+	m_DataVersion(1),
 	m_MojangAPI(nullptr)
 {
 }
@@ -912,6 +913,7 @@ void cRankManager::AddRank(
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -955,6 +957,7 @@ void cRankManager::AddGroup(const AString & a_GroupName)
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -995,6 +998,7 @@ void cRankManager::AddGroups(const AStringVector & a_GroupNames)
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1038,6 +1042,7 @@ bool cRankManager::AddGroupToRank(const AString & a_GroupName, const AString & a
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1116,6 +1121,7 @@ bool cRankManager::AddPermissionToGroup(const AString & a_Permission, const AStr
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1183,6 +1189,7 @@ bool cRankManager::AddRestrictionToGroup(const AString & a_Restriction, const AS
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1250,6 +1257,7 @@ bool cRankManager::AddPermissionsToGroup(const AStringVector & a_Permissions, co
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1320,6 +1328,7 @@ bool cRankManager::AddRestrictionsToGroup(const AStringVector & a_Restrictions,
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1390,6 +1399,7 @@ void cRankManager::RemoveRank(const AString & a_RankName, const AString & a_Repl
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 
 	// Check if the default rank is being removed with a proper replacement:
 	if ((a_RankName == m_DefaultRank) && !RankExists(a_ReplacementRankName))
@@ -1476,6 +1486,7 @@ void cRankManager::RemoveGroup(const AString & a_GroupName)
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1527,6 +1538,7 @@ void cRankManager::RemoveGroupFromRank(const AString & a_GroupName, const AStrin
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1579,6 +1591,7 @@ void cRankManager::RemovePermissionFromGroup(const AString & a_Permission, const
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1619,6 +1632,7 @@ void cRankManager::RemoveRestrictionFromGroup(const AString & a_Restriction, con
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1659,6 +1673,7 @@ bool cRankManager::RenameRank(const AString & a_OldName, const AString & a_NewNa
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1709,6 +1724,7 @@ bool cRankManager::RenameGroup(const AString & a_OldName, const AString & a_NewN
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1750,6 +1766,7 @@ void cRankManager::SetPlayerRank(const AString & a_PlayerUUID, const AString & a
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -1810,6 +1827,7 @@ void cRankManager::RemovePlayerRank(const AString & a_PlayerUUID)
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 
 	try
 	{
@@ -1838,6 +1856,7 @@ void cRankManager::SetRankVisuals(
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 	
 	try
 	{
@@ -2094,6 +2113,7 @@ bool cRankManager::SetDefaultRank(const AString & a_RankName)
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 
 	try
 	{
@@ -2145,6 +2165,7 @@ void cRankManager::ClearPlayerRanks(void)
 {
 	ASSERT(m_IsInitialized);
 	cCSLock Lock(m_CS);
+	m_DataVersion++;
 
 	try
 	{
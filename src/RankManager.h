@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <atomic>
 #include "SQLiteCpp/Database.h"
 #include "SQLiteCpp/Transaction.h"
 
@@ -259,6 +260,10 @@ public:
 	/** Updates the playername that is saved with this uuid. Returns false if a error occurred */
 	bool UpdatePlayerName(const AString & a_PlayerUUID, const AString & a_NewPlayerName);
 
+	/** Returns the version of the rank data, which changes whenever any of the ranks, groups, permissions or player ranks change.
+	Used by cPlayer to reload its cached permissions only when something has changed. */
+	UInt32 GetDataVersion(void) const { return m_DataVersion; }
+
 protected:
 
 	/** The database storage for all the data. Protected by m_CS. */
@@ -273,6 +278,10 @@ protected:
 	/** Set to true once the manager is initialized. */
 	bool m_IsInitialized;
 
+	/** Incremented by each change to the ranks, groups, permissions or player ranks, see GetDataVersion().
+	Starts at 1, so that 0 can be used by the users as "not loaded yet". */
+	std::atomic<UInt32> m_DataVersion;
+
 	/** The MojangAPI instance that is used for translating playernames to UUIDs.
 	Set in Initialize(), may be nullptr. */
 	cMojangAPI * m_MojangAPI;
@@ -8,6 +8,7 @@
 #include "FurnaceRecipe.h"
 #include "CraftingRecipes.h"
 #include "Bindings/PluginManager.h"
+#include "Bindings/Plugin.h"
 #include "MonsterConfig.h"
 #include "Entities/Player.h"
 #include "Blocks/BlockHandler.h"
@@ -35,6 +36,8 @@
 
 cRoot * cRoot::s_Root = nullptr;
 bool cRoot::m_ShouldStop = false;
+AString cRoot::m_TickRecordFileName;
+AString cRoot::m_TickReplayFileName;
 
 
 
@@ -108,6 +111,22 @@ void cRoot::Start(void)
 	cLogger::cListener * fileLogListener = new cFileListener();
 	cLogger::GetInstance().AttachListener(consoleLogListener);
 	cLogger::GetInstance().AttachListener(fileLogListener);
+
+	// The logging settings are needed before the server starts; only peek at them here, the main loop below stores the defaults:
+	cLogger::cListener * jsonLogListener = nullptr;
+	{
+		cIniFile LogIniFile;
+		LogIniFile.ReadFile("settings.ini");
+		if (LogIniFile.GetValueB("Logging", "JsonLog", false))
+		{
+			jsonLogListener = new cJsonFileListener();
+			cLogger::GetInstance().AttachListener(jsonLogListener);
+		}
+		if (LogIniFile.GetValueB("Logging", "AsyncWriter", true))
+		{
+			cLogger::GetInstance().StartAsyncWriter();
+		}
+	}
 	
 	LOG("--- Started Log ---\n");
 
@@ -141,7 +160,35 @@ void cRoot::Start(void)
 
 		LOG("Starting server...");
 		m_MojangAPI = new cMojangAPI;
+		// The logging settings are applied on the next start, see above:
+		IniFile.GetValueSetB("Logging", "AsyncWriter", true);
+		IniFile.GetValueSetB("Logging", "JsonLog", false);
+
+		// The scheduling of the subsystem threads, applied by each thread as it starts:
+		for (const auto & Kind: cIsThread::GetSchedulingKinds())
+		{
+			cIsThread::SetKindScheduling(
+				Kind,
+				IniFile.GetValueSet ("Threading", Kind + "CPUs", ""),
+				IniFile.GetValueSetI("Threading", Kind + "Nice", 0)
+			);
+		}
+
 		bool ShouldAuthenticate = IniFile.GetValueSetB("Authentication", "Authenticate", true);
+		if (!m_TickReplayFileName.empty())
+		{
+			m_TickReplayer.reset(new cTickReplayer);
+			if (!m_TickReplayer->Load(m_TickReplayFileName))
+			{
+				LOGWARNING("The ticks will not be replayed, running normally.");
+				m_TickReplayer.reset();
+			}
+			else
+			{
+				// The replayed clients cannot repeat the recorded encryption, they log in without it:
+				ShouldAuthenticate = false;
+			}
+		}
 		m_MojangAPI->Start(IniFile, ShouldAuthenticate);  // Mojang API needs to be started before plugins, so that plugins may use it for DB upgrades on server init
 		if (!m_Server->InitServer(IniFile, ShouldAuthenticate))
 		{
@@ -158,7 +205,16 @@ void cRoot::Start(void)
 		m_RankManager->Initialize(*m_MojangAPI);
 		m_CraftingRecipes = new cCraftingRecipes;
 		m_FurnaceRecipe   = new cFurnaceRecipe();
+
+		LOGD("Starting worker thread pool...");
+		m_ThreadPool.Start(IniFile.GetValueSetI("Threading", "WorkerThreads", 0));
+
+		LOGD("Starting file writer...");
+		m_FileWriter.Start();
 		
+		// Initialize the block info before the worlds' threads start filling the chunk data, which counts the blocks by their categories:
+		cBlockInfo::Get(E_BLOCK_AIR);
+
 		LOGD("Loading worlds...");
 		LoadWorlds(IniFile);
 
@@ -173,13 +229,21 @@ void cRoot::Start(void)
 		LOGD("Starting Authenticator...");
 		m_Authenticator.Start(IniFile);
 		
+		if (!m_TickRecordFileName.empty() && (m_TickReplayer == nullptr))
+		{
+			m_TickRecorder.Start(m_TickRecordFileName);
+		}
+
 		LOGD("Starting worlds...");
 		StartWorlds();
 		
 		if (IniFile.GetValueSetB("DeadlockDetect", "Enabled", true))
 		{
 			LOGD("Starting deadlock detector...");
-			dd.Start(IniFile.GetValueSetI("DeadlockDetect", "IntervalSec", 20));
+			dd.Start(
+				IniFile.GetValueSetI("DeadlockDetect", "IntervalSec", 20),
+				IniFile.GetValueSetI("DeadlockDetect", "StallReportMSec", 500)
+			);
 		}
 		
 		IniFile.WriteFile("settings.ini");
@@ -210,6 +274,7 @@ void cRoot::Start(void)
 			while (!m_ShouldStop && !m_bRestart && !m_TerminateEventRaised)  // These are modified by external threads
 			{
 				std::this_thread::sleep_for(std::chrono::seconds(1));
+				FinishStartingWorlds(false);
 			}
 
 			if (m_TerminateEventRaised)
@@ -234,7 +299,13 @@ void cRoot::Start(void)
 		dd.Stop();
 
 		LOGD("Stopping world threads...");
+		FinishStartingWorlds(true);
 		StopWorlds();
+		m_TickRecorder.Stop();
+		m_TickReplayer.reset();
+
+		LOGD("Stopping worker thread pool...");
+		m_ThreadPool.Stop();
 
 		LOGD("Stopping authenticator...");
 		m_Authenticator.Stop();
@@ -249,6 +320,9 @@ void cRoot::Start(void)
 
 		LOGD("Unloading worlds...");
 		UnloadWorlds();
+
+		LOGD("Stopping file writer...");
+		m_FileWriter.Stop();
 		
 		LOGD("Stopping plugin manager...");
 		delete m_PluginManager; m_PluginManager = nullptr;
@@ -263,6 +337,12 @@ void cRoot::Start(void)
 	
 	LOG("--- Stopped Log ---");
 	
+	cLogger::GetInstance().StopAsyncWriter();
+	if (jsonLogListener != nullptr)
+	{
+		cLogger::GetInstance().DetachListener(jsonLogListener);
+		delete jsonLogListener;
+	}
 	cLogger::GetInstance().DetachListener(consoleLogListener);
 	delete consoleLogListener;
 	cLogger::GetInstance().DetachListener(fileLogListener);
@@ -351,11 +431,42 @@ cWorld * cRoot::CreateAndInitializeWorld(const AString & a_WorldName, eDimension
 
 void cRoot::StartWorlds(void)
 {
+	// Start all the worlds first, then prepare their spawn areas, all in parallel:
 	for (WorldMap::iterator itr = m_WorldsByName.begin(); itr != m_WorldsByName.end(); ++itr)
 	{
 		itr->second->Start();
-		itr->second->InitializeSpawn();
-		m_PluginManager->CallHookWorldStarted(*itr->second);
+	}
+	for (WorldMap::iterator itr = m_WorldsByName.begin(); itr != m_WorldsByName.end(); ++itr)
+	{
+		itr->second->StartSpawnPreparation();
+		if (itr->second != m_pDefaultWorld)
+		{
+			m_StartingWorlds.push_back(itr->second);
+		}
+	}
+
+	// Only the default world needs to be ready for the server to be joined:
+	m_pDefaultWorld->FinishSpawnPreparation();
+	m_PluginManager->CallHookWorldStarted(*m_pDefaultWorld);
+	FinishStartingWorlds(false);
+}
+
+
+
+
+
+void cRoot::FinishStartingWorlds(bool a_ShouldWait)
+{
+	for (auto itr = m_StartingWorlds.begin(); itr != m_StartingWorlds.end();)
+	{
+		if (!a_ShouldWait && !(*itr)->IsSpawnPrepared())
+		{
+			++itr;
+			continue;
+		}
+		(*itr)->FinishSpawnPreparation();
+		m_PluginManager->CallHookWorldStarted(**itr);
+		itr = m_StartingWorlds.erase(itr);
 	}
 }
 
@@ -816,6 +927,40 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 		a_Output.Out("  Num chunks in generator queue: %d", NumInGenerator);
 		a_Output.Out("  Num chunks in storage load queue: %d", NumInLoadQueue);
 		a_Output.Out("  Num chunks in storage save queue: %d", NumInSaveQueue);
+		size_t NumSectionsAllocated = 0, NumSectionsFree = 0, NumSectionsReserveInUse = 0;
+		World->GetSectionPoolStats(NumSectionsAllocated, NumSectionsFree, NumSectionsReserveInUse);
+		a_Output.Out("  Num flat chunk sections in use: " SIZE_T_FMT, NumSectionsAllocated);
+		a_Output.Out("  Num flat chunk sections free in pool: " SIZE_T_FMT, NumSectionsFree);
+		a_Output.Out("  Num reserve chunk sections in use: " SIZE_T_FMT, NumSectionsReserveInUse);
+		
+		// Chunk sending stats of each player:
+		class cSendStatsCallback :
+			public cPlayerListCallback
+		{
+			cChunkSender & m_ChunkSender;
+			cCommandOutputCallback & m_Output;
+			
+			virtual bool Item(cPlayer * a_Player) override
+			{
+				cChunkSender::sClientStats Stats;
+				if (m_ChunkSender.GetClientStats(a_Player->GetClientHandle(), Stats))
+				{
+					m_Output.Out("  Chunks to %s: " SIZE_T_FMT " queued, %.1f KiB/s, " SIZE_T_FMT " KiB sent total",
+						a_Player->GetName().c_str(), Stats.m_QueueDepth, Stats.m_BytesPerSec / 1024, static_cast<size_t>(Stats.m_TotalBytes / 1024)
+					);
+				}
+				return false;
+			}
+			
+		public:
+			cSendStatsCallback(cChunkSender & a_ChunkSender, cCommandOutputCallback & a_Output) :
+				m_ChunkSender(a_ChunkSender),
+				m_Output(a_Output)
+			{
+			}
+		} SendStatsCallback(World->GetChunkSender(), a_Output);
+		World->ForEachPlayer(SendStatsCallback);
+		
 		int Mem = NumValid * sizeof(cChunk);
 		a_Output.Out("  Memory used by chunks: %d KiB (%d MiB)", (Mem + 1023) / 1024, (Mem + 1024 * 1024 - 1) / (1024 * 1024));
 		a_Output.Out("  Per-chunk memory size breakdown:");
@@ -842,6 +987,166 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 
 
 
+void cRoot::LogGeneratorStats(cCommandOutputCallback & a_Output)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		AStringVector Lines;
+		itr->second->GetGeneratorStats(Lines);
+		a_Output.Out("World %s:", itr->first.c_str());
+		for (const auto & Line : Lines)
+		{
+			a_Output.Out("%s", Line.c_str());
+		}
+	}
+}
+
+
+
+
+
+void cRoot::LogTickProfile(cCommandOutputCallback & a_Output)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		AStringVector Lines;
+		itr->second->GetTickProfiler().GetReport(Lines);
+		itr->second->GetTickProfiler().GetAllocationReport(Lines);
+		a_Output.Out("World %s:", itr->first.c_str());
+		for (const auto & Line : Lines)
+		{
+			a_Output.Out("%s", Line.c_str());
+		}
+	}
+}
+
+
+
+
+
+void cRoot::ResetTickProfile(void)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		itr->second->GetTickProfiler().Reset();
+	}
+}
+
+
+
+
+
+void cRoot::LogChunkTickCosts(cCommandOutputCallback & a_Output, size_t a_Count)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		std::vector<cChunkMap::sChunkTickCost> Costs;
+		itr->second->GetTopChunkTickCosts(a_Count, Costs);
+		a_Output.Out("World %s (chunk tick profiling %s):", itr->first.c_str(), itr->second->IsChunkTickProfilingEnabled() ? "on" : "off");
+		for (const auto & Cost: Costs)
+		{
+			AString Line;
+			Printf(Line, "  chunk [%d, %d] (blocks %d, %d): %.2f ms",
+				Cost.m_ChunkX, Cost.m_ChunkZ, Cost.m_ChunkX * cChunkDef::Width, Cost.m_ChunkZ * cChunkDef::Width,
+				std::chrono::duration<double, std::milli>(Cost.GetTotal()).count()
+			);
+			for (int i = 0; i < cChunkMap::sChunkTickCost::catCount; i++)
+			{
+				AppendPrintf(Line, ", %s %.2f ms",
+					cChunkMap::sChunkTickCost::GetCategoryName(static_cast<cChunkMap::sChunkTickCost::eCategory>(i)),
+					std::chrono::duration<double, std::milli>(Cost.m_Time[i]).count()
+				);
+			}
+			a_Output.Out("%s", Line.c_str());
+		}
+	}
+}
+
+
+
+
+
+void cRoot::SetChunkTickProfilingEnabled(bool a_IsEnabled)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		itr->second->SetChunkTickProfilingEnabled(a_IsEnabled);
+	}
+}
+
+
+
+
+
+void cRoot::ResetChunkTickCosts(void)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		itr->second->ResetChunkTickCosts();
+	}
+}
+
+
+
+
+
+void cRoot::LogMemoryStats(cCommandOutputCallback & a_Output)
+{
+	for (WorldMap::iterator itr = m_WorldsByName.begin(), end = m_WorldsByName.end(); itr != end; ++itr)
+	{
+		cWorld::sMemoryStats Stats;
+		itr->second->GetMemoryStats(Stats);
+		const cChunkMap::sMemoryStats & Chunks = Stats.m_Chunks;
+		size_t NumChunks = std::max<size_t>(Chunks.m_NumChunks, 1);
+		a_Output.Out("World %s:", itr->first.c_str());
+		a_Output.Out("  Chunks: " SIZE_T_FMT ", sections per chunk: %.02f flat, %.02f palette",
+			Chunks.m_NumChunks,
+			static_cast<double>(Chunks.m_NumFlatSections) / NumChunks,
+			static_cast<double>(Chunks.m_NumPaletteSections) / NumChunks
+		);
+		a_Output.Out("  Section pool: " SIZE_T_FMT " KiB", Stats.m_SectionPoolBytes / 1024);
+		a_Output.Out("  Palette sections and light: " SIZE_T_FMT " KiB", Chunks.m_ChunkDataHeapBytes / 1024);
+		a_Output.Out("  Entities: " SIZE_T_FMT ", block entities: " SIZE_T_FMT, Chunks.m_NumEntities, Chunks.m_NumBlockEntities);
+		for (const auto & Chunk: Chunks.m_MostEntities)
+		{
+			a_Output.Out("    Chunk [%d, %d]: " SIZE_T_FMT " entities", Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Count);
+		}
+		for (const auto & Chunk: Chunks.m_MostBlockEntities)
+		{
+			a_Output.Out("    Chunk [%d, %d]: " SIZE_T_FMT " block entities", Chunk.m_ChunkX, Chunk.m_ChunkZ, Chunk.m_Count);
+		}
+		a_Output.Out("  Chunk serialization cache: " SIZE_T_FMT " items, " SIZE_T_FMT " KiB",
+			Stats.m_SerializationCacheItems, Stats.m_SerializationCacheBytes / 1024
+		);
+		a_Output.Out("  Generator caches: %llu KiB", static_cast<unsigned long long>(Stats.m_GeneratorCacheBytes / 1024));
+		a_Output.Out("  Client send buffers: " SIZE_T_FMT " KiB", Stats.m_ClientBufferBytes / 1024);
+	}
+
+	class cPluginMemoryCallback :
+		public cPluginManager::cPluginCallback
+	{
+	public:
+		cCommandOutputCallback & m_Output;
+		cPluginMemoryCallback(cCommandOutputCallback & a_Output) : m_Output(a_Output) {}
+		virtual bool Item(cPlugin * a_Plugin) override
+		{
+			if (a_Plugin->IsLoaded())
+			{
+				cPlugin::cCallStatsMap Calls;
+				size_t MemoryUsed;
+				a_Plugin->GetStats(Calls, MemoryUsed);
+				m_Output.Out("Plugin %s: " SIZE_T_FMT " KiB of Lua heap", a_Plugin->GetName().c_str(), MemoryUsed / 1024);
+			}
+			return false;
+		}
+	} PluginCallback(a_Output);
+	m_PluginManager->ForEachPlugin(PluginCallback);
+}
+
+
+
+
+
 int cRoot::GetFurnaceFuelBurnTime(const cItem & a_Fuel)
 {
 	cFurnaceRecipe * FR = Get()->GetFurnaceRecipe();
@@ -6,6 +6,9 @@
 #include "HTTPServer/HTTPServer.h"
 #include "Defines.h"
 #include "RankManager.h"
+#include "OSSupport/ThreadPool.h"
+#include "OSSupport/AsyncFileWriter.h"
+#include "TickRecorder.h"
 #include <thread>
 
 
@@ -49,6 +52,12 @@ public:
 	static bool m_RunAsService;
 	static bool m_ShouldStop;
 
+	/** The file to record the ticks into, set by the "/recordticks <file>" command line argument. */
+	static AString m_TickRecordFileName;
+
+	/** The recording to replay instead of the regular ticking of the default world, set by the "/replayticks <file>" command line argument. */
+	static AString m_TickReplayFileName;
+
 
 	cRoot(void);
 	~cRoot();
@@ -76,6 +85,27 @@ public:
 	
 	/// Writes chunkstats, for each world and totals, to the output callback
 	void LogChunkStats(cCommandOutputCallback & a_Output);
+
+	/** Writes the generator stage timings and cache hit rates, for each world, to the output callback */
+	void LogGeneratorStats(cCommandOutputCallback & a_Output);
+
+	/** Writes the rolling percentiles of the tick phases' durations, for each world, to the output callback */
+	void LogTickProfile(cCommandOutputCallback & a_Output);
+
+	/** Drops the tick phases' durations collected so far in all worlds */
+	void ResetTickProfile(void);
+
+	/** Writes the a_Count chunks of each world that have accumulated the most tick time, with the time per category, to the output callback */
+	void LogChunkTickCosts(cCommandOutputCallback & a_Output, size_t a_Count);
+
+	/** Turns the accumulating of the chunks' tick time on or off in all worlds */
+	void SetChunkTickProfilingEnabled(bool a_IsEnabled);
+
+	/** Zeroes the accumulated tick time of the chunks in all worlds */
+	void ResetChunkTickCosts(void);
+
+	/** Writes the memory used by the chunks, caches and client buffers of each world, and by each plugin's Lua state, to the output callback */
+	void LogMemoryStats(cCommandOutputCallback & a_Output);
 	
 	cMonsterConfig * GetMonsterConfig(void) { return m_MonsterConfig; }
 
@@ -91,6 +121,18 @@ public:
 	cMojangAPI &       GetMojangAPI      (void) { return *m_MojangAPI; }
 	cRankManager *     GetRankManager    (void) { return m_RankManager.get(); }
 
+	/** Returns the worker thread pool shared by all the worlds' background subsystems. */
+	cThreadPool &      GetThreadPool     (void) { return m_ThreadPool; }
+
+	/** Returns the background writer used for saving the player data. */
+	cAsyncFileWriter & GetFileWriter     (void) { return m_FileWriter; }
+
+	/** Returns the recorder of the default world's ticks; it only records if the server was started with "/recordticks". */
+	cTickRecorder &    GetTickRecorder   (void) { return m_TickRecorder; }
+
+	/** Returns the replayer of the recorded ticks, or nullptr if the server is not running in the replay mode. */
+	cTickReplayer *    GetTickReplayer   (void) { return m_TickReplayer.get(); }
+
 	/** Queues a console command for execution through the cServer class.
 	The command will be executed in the tick thread
 	The command's output will be written to the a_Output callback
@@ -179,6 +221,9 @@ private:
 
 	cWorld * m_pDefaultWorld;
 	WorldMap m_WorldsByName;
+
+	/** The worlds started by StartWorlds() whose spawn areas are still being prepared. Only accessed by the main thread. */
+	std::vector<cWorld *> m_StartingWorlds;
 	
 	cCriticalSection m_CSPendingCommands;
 	cCommandQueue    m_PendingCommands;
@@ -199,6 +244,18 @@ private:
 
 	cHTTPServer        m_HTTPServer;
 
+	/** The worker threads shared by the worlds' subsystems; the thread count is set in settings.ini [Threading] WorkerThreads. */
+	cThreadPool        m_ThreadPool;
+
+	/** Writes the player data in the background; started before the worlds are loaded and stopped after they are unloaded,
+	so that the players saved when being destroyed still use it. */
+	cAsyncFileWriter   m_FileWriter;
+
+	cTickRecorder      m_TickRecorder;
+
+	/** Replays the recording instead of ticking the default world; only created in the replay mode. */
+	std::unique_ptr<cTickReplayer> m_TickReplayer;
+
 	bool m_bRestart;
 
 	void LoadGlobalSettings();
@@ -206,8 +263,13 @@ private:
 	/// Loads the worlds from settings.ini, creates the worldmap
 	void LoadWorlds(cIniFile & IniFile);
 	
-	/// Starts each world's life
+	/** Starts each world's life. The spawn areas of all the worlds are prepared in parallel, but only the default world's
+	preparation is waited for, so that the server can be joined as soon as possible; the others are finished by FinishStartingWorlds(). */
 	void StartWorlds(void);
+
+	/** Finishes the startup of the worlds whose spawn preparation started by StartWorlds() is complete, calling the HOOK_WORLD_STARTED.
+	If a_ShouldWait is true, waits for all of them to complete first. */
+	void FinishStartingWorlds(bool a_ShouldWait);
 	
 	/// Stops each world's threads, so that it's safe to unload them
 	void StopWorlds(void);
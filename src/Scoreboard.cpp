@@ -95,7 +95,7 @@ void cObjective::Reset(void)
 {
 	for (cScoreMap::iterator it = m_Scores.begin(); it != m_Scores.end(); ++it)
 	{
-		m_World->BroadcastScoreUpdate(m_Name, it->first, 0, 1);
+		m_DirtyScores.insert(it->first);
 	}
 
 	m_Scores.clear();
@@ -127,7 +127,7 @@ void cObjective::SetScore(const AString & a_Name, cObjective::Score a_Score)
 {
 	m_Scores[a_Name] = a_Score;
 
-	m_World->BroadcastScoreUpdate(m_Name, a_Name, a_Score, 0);
+	m_DirtyScores.insert(a_Name);
 }
 
 
@@ -136,9 +136,10 @@ void cObjective::SetScore(const AString & a_Name, cObjective::Score a_Score)
 
 void cObjective::ResetScore(const AString & a_Name)
 {
-	m_Scores.erase(a_Name);
-
-	m_World->BroadcastScoreUpdate(m_Name, a_Name, 0, 1);
+	if (m_Scores.erase(a_Name) > 0)
+	{
+		m_DirtyScores.insert(a_Name);
+	}
 }
 
 
@@ -147,12 +148,12 @@ void cObjective::ResetScore(const AString & a_Name)
 
 cObjective::Score cObjective::AddScore(const AString & a_Name, cObjective::Score a_Delta)
 {
-	// TODO 2014-01-19 xdot: Potential optimization - Reuse iterator
-	Score NewScore = m_Scores[a_Name] + a_Delta;
+	Score & PlayerScore = m_Scores[a_Name];
+	PlayerScore += a_Delta;
 
-	SetScore(a_Name, NewScore);
+	m_DirtyScores.insert(a_Name);
 
-	return NewScore;
+	return PlayerScore;
 }
 
 
@@ -161,12 +162,12 @@ cObjective::Score cObjective::AddScore(const AString & a_Name, cObjective::Score
 
 cObjective::Score cObjective::SubScore(const AString & a_Name, cObjective::Score a_Delta)
 {
-	// TODO 2014-01-19 xdot: Potential optimization - Reuse iterator
-	Score NewScore = m_Scores[a_Name] - a_Delta;
+	Score & PlayerScore = m_Scores[a_Name];
+	PlayerScore -= a_Delta;
 
-	SetScore(a_Name, NewScore);
+	m_DirtyScores.insert(a_Name);
 
-	return NewScore;
+	return PlayerScore;
 }
 
 
@@ -198,6 +199,27 @@ void cObjective::SendTo(cClientHandle & a_Client)
 
 
 
+void cObjective::FlushScoreUpdates(void)
+{
+	for (const auto & Name: m_DirtyScores)
+	{
+		cScoreMap::const_iterator it = m_Scores.find(Name);
+		if (it == m_Scores.end())
+		{
+			m_World->BroadcastScoreUpdate(m_Name, Name, 0, 1);
+		}
+		else
+		{
+			m_World->BroadcastScoreUpdate(m_Name, Name, it->second, 0);
+		}
+	}
+	m_DirtyScores.clear();
+}
+
+
+
+
+
 cTeam::cTeam(
 	const AString & a_Name, const AString & a_DisplayName,
 	const AString & a_Prefix, const AString & a_Suffix
@@ -573,6 +595,20 @@ void cScoreboard::SendTo(cClientHandle & a_Client)
 
 
 
+void cScoreboard::FlushScoreUpdates(void)
+{
+	cCSLock Lock(m_CSObjectives);
+
+	for (cObjectiveMap::iterator it = m_Objectives.begin(); it != m_Objectives.end(); ++it)
+	{
+		it->second.FlushScoreUpdates();
+	}
+}
+
+
+
+
+
 size_t cScoreboard::GetNumObjectives(void) const
 {
 	return m_Objectives.size();
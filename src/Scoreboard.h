@@ -9,6 +9,9 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <unordered_set>
+
 
 
 
@@ -94,6 +97,9 @@ public:
 	/** Send this objective to the specified client */
 	void SendTo(cClientHandle & a_Client);
 
+	/** Broadcasts the scores changed since the last call to all the clients of the world. */
+	void FlushScoreUpdates(void);
+
 	static const char * GetClassStatic(void)  // Needed for ManualBindings's ForEach templates
 	{
 		return "cObjective";
@@ -104,10 +110,13 @@ private:
 
 	typedef std::pair<AString, Score> cTrackedPlayer;
 
-	typedef std::map<AString, Score> cScoreMap;
+	typedef std::unordered_map<AString, Score> cScoreMap;
 
 	cScoreMap m_Scores;
 
+	/** The players whose scores have changed (or have been reset) since the last FlushScoreUpdates(). */
+	std::unordered_set<AString> m_DirtyScores;
+
 	AString m_DisplayName;
 	AString m_Name;
 
@@ -181,7 +190,7 @@ public:
 
 private:
 
-	typedef std::set<AString> cPlayerNameSet;
+	typedef std::unordered_set<AString> cPlayerNameSet;
 
 	bool m_AllowsFriendlyFire;
 	bool m_CanSeeFriendlyInvisible;
@@ -259,6 +268,10 @@ public:
 	/** Send this scoreboard to the specified client */
 	void SendTo(cClientHandle & a_Client);
 
+	/** Broadcasts the scores changed since the last call, in all the objectives.
+	Called by the world once per tick, so that the scores changed many times in a tick are only sent once. */
+	void FlushScoreUpdates(void);
+
 	cTeam * QueryPlayerTeam(const AString & a_Name);  // WARNING: O(n logn)
 
 	/** Execute callback for each objective with the specified type
@@ -282,7 +295,7 @@ private:
 	typedef std::pair<AString, cTeam>      cNamedTeam;
 
 	typedef std::map<AString, cObjective> cObjectiveMap;
-	typedef std::map<AString, cTeam>      cTeamMap;
+	typedef std::unordered_map<AString, cTeam> cTeamMap;
 
 	// TODO 2014-01-19 xdot: Potential optimization - Sort objectives based on type
 	cCriticalSection m_CSObjectives;
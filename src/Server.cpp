@@ -16,7 +16,9 @@
 #include "FurnaceRecipe.h"
 #include "WebAdmin.h"
 #include "Protocol/ProtocolRecognizer.h"
+#include "Protocol/Protocol18x.h"
 #include "CommandOutput.h"
+#include "OSSupport/SamplingProfiler.h"
 
 #include "IniFile.h"
 #include "Vector3.h"
@@ -132,6 +134,10 @@ void cServer::cTickThread::Execute(void)
 // cServer:
 
 cServer::cServer(void) :
+	m_MaxLoginsPerSecond(0),
+	m_MaxLoginQueueWait(0),
+	m_MaxStatusPingsPerMinute(0),
+	m_LoginAllowance(0),
 	m_PlayerCount(0),
 	m_PlayerCountDiff(0),
 	m_ClientViewDistance(0),
@@ -191,6 +197,9 @@ bool cServer::InitServer(cIniFile & a_SettingsIni, bool a_ShouldAuth)
 	m_MaxPlayers  = a_SettingsIni.GetValueSetI("Server", "MaxPlayers", 100);
 	m_bIsHardcore = a_SettingsIni.GetValueSetB("Server", "HardcoreEnabled", false);
 	m_bAllowMultiLogin = a_SettingsIni.GetValueSetB("Server", "AllowMultiLogin", false);
+	m_MaxLoginsPerSecond = std::max(a_SettingsIni.GetValueSetI("Server", "MaxLoginsPerSecond", 10), 0);
+	m_MaxLoginQueueWait  = std::max(a_SettingsIni.GetValueSetI("Server", "MaxLoginQueueWait", 20), 1);
+	m_MaxStatusPingsPerMinute = std::max(a_SettingsIni.GetValueSetI("Server", "MaxStatusPingsPerMinute", 60), 0);
 	m_PlayerCount = 0;
 	m_PlayerCountDiff = 0;
 
@@ -209,6 +218,17 @@ bool cServer::InitServer(cIniFile & a_SettingsIni, bool a_ShouldAuth)
 
 	m_RCONServer.Initialize(a_SettingsIni);
 
+	// The server query reports the first valid game port:
+	UInt16 GamePort = 0;
+	for (const auto & port: m_Ports)
+	{
+		if (StringToInteger(port, GamePort))
+		{
+			break;
+		}
+	}
+	m_QueryServer.Initialize(a_SettingsIni, GamePort);
+
 	m_bIsConnected = true;
 
 	m_ServerID = "-";
@@ -235,6 +255,13 @@ bool cServer::InitServer(cIniFile & a_SettingsIni, bool a_ShouldAuth)
 	m_ShouldLoadOfflinePlayerData = a_SettingsIni.GetValueSetB("PlayerData", "LoadOfflinePlayerData", false);
 	m_ShouldLoadNamedPlayerData   = a_SettingsIni.GetValueSetB("PlayerData", "LoadNamedPlayerData", true);
 
+	cProtocol180::SetCompressionParams(
+		a_SettingsIni.GetValueSetI("Server", "PacketCompressionLevel", -1),
+		a_SettingsIni.GetValueSet("Server", "PacketCompressionStrategy", "Default")
+	);
+
+	cNetwork::SetNumLinkEventLoops(a_SettingsIni.GetValueSetI("Server", "NetworkThreads", 1));
+
 	m_ClientViewDistance = a_SettingsIni.GetValueSetI("Server", "DefaultViewDistance", cClientHandle::DEFAULT_VIEW_DISTANCE);
 	if (m_ClientViewDistance < cClientHandle::MIN_VIEW_DISTANCE)
 	{
@@ -266,6 +293,105 @@ int cServer::GetNumPlayers(void) const
 
 
 
+AString cServer::GetStatusResponse(int a_ProtocolVersion, const AString & a_VersionName, const AString & a_Description, int a_NumPlayers, int a_MaxPlayers, const AString & a_Favicon)
+{
+	cCSLock Lock(m_CSStatusResponses);
+	sStatusResponse & Cached = m_StatusResponses[a_ProtocolVersion];
+	if (
+		!Cached.m_Response.empty() &&
+		(Cached.m_NumPlayers == a_NumPlayers) &&
+		(Cached.m_MaxPlayers == a_MaxPlayers) &&
+		(Cached.m_Description == a_Description) &&
+		(Cached.m_VersionName == a_VersionName) &&
+		(Cached.m_Favicon == a_Favicon)
+	)
+	{
+		return Cached.m_Response;
+	}
+
+	// Version:
+	Json::Value Version;
+	Version["name"] = a_VersionName;
+	Version["protocol"] = a_ProtocolVersion;
+
+	// Players:
+	Json::Value Players;
+	Players["online"] = a_NumPlayers;
+	Players["max"] = a_MaxPlayers;
+	// TODO: Add "sample"
+
+	// Description:
+	Json::Value Description;
+	Description["text"] = a_Description;
+
+	// Create the response:
+	Json::Value ResponseValue;
+	ResponseValue["version"] = Version;
+	ResponseValue["players"] = Players;
+	ResponseValue["description"] = Description;
+	if (!a_Favicon.empty())
+	{
+		ResponseValue["favicon"] = Printf("data:image/png;base64,%s", a_Favicon.c_str());
+	}
+
+	Json::FastWriter Writer;
+	Cached.m_VersionName = a_VersionName;
+	Cached.m_Description = a_Description;
+	Cached.m_NumPlayers = a_NumPlayers;
+	Cached.m_MaxPlayers = a_MaxPlayers;
+	Cached.m_Favicon = a_Favicon;
+	Cached.m_Response = Writer.write(ResponseValue);
+	return Cached.m_Response;
+}
+
+
+
+
+
+bool cServer::ShouldAnswerStatusPing(const AString & a_IPAddress)
+{
+	if (m_MaxStatusPingsPerMinute <= 0)
+	{
+		return true;
+	}
+	auto Now = std::chrono::steady_clock::now();
+	const auto WindowLength = std::chrono::minutes(1);
+
+	cCSLock Lock(m_CSStatusPings);
+
+	// Once in a while, forget the addresses that haven't pinged for the whole window:
+	if (Now - m_LastStatusPingCleanup > WindowLength)
+	{
+		m_LastStatusPingCleanup = Now;
+		for (auto itr = m_StatusPingWindows.begin(); itr != m_StatusPingWindows.end();)
+		{
+			if (Now - itr->second.m_Start > WindowLength)
+			{
+				itr = m_StatusPingWindows.erase(itr);
+			}
+			else
+			{
+				++itr;
+			}
+		}
+	}
+
+	auto itr = m_StatusPingWindows.find(a_IPAddress);
+	if ((itr == m_StatusPingWindows.end()) || (Now - itr->second.m_Start > WindowLength))
+	{
+		sStatusPingWindow & Window = m_StatusPingWindows[a_IPAddress];
+		Window.m_Start = Now;
+		Window.m_NumPings = 1;
+		return true;
+	}
+	itr->second.m_NumPings += 1;
+	return (itr->second.m_NumPings <= m_MaxStatusPingsPerMinute);
+}
+
+
+
+
+
 bool cServer::IsPlayerInQueue(AString a_Username)
 {
 	cCSLock Lock(m_CSClients);
@@ -330,6 +456,8 @@ bool cServer::Tick(float a_Dt)
 	// Tick all clients not yet assigned to a world:
 	TickClients(a_Dt);
 
+	m_QueryServer.Tick(a_Dt);
+
 	if (!m_bRestarting)
 	{
 		return true;
@@ -348,6 +476,8 @@ bool cServer::Tick(float a_Dt)
 
 void cServer::TickClients(float a_Dt)
 {
+	ProcessLoginQueue(a_Dt);
+
 	cClientHandlePtrs RemoveClients;
 	{
 		cCSLock Lock(m_CSClients);
@@ -522,6 +652,145 @@ void cServer::ExecuteConsoleCommand(const AString & a_Cmd, cCommandOutputCallbac
 		a_Output.Finished();
 		return;
 	}
+	else if (split[0].compare("genstats") == 0)
+	{
+		cRoot::Get()->LogGeneratorStats(a_Output);
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("tickprofile") == 0)
+	{
+		if ((split.size() > 1) && (split[1] == "reset"))
+		{
+			cRoot::Get()->ResetTickProfile();
+			a_Output.Out("Tick profile has been reset.");
+		}
+		else
+		{
+			cRoot::Get()->LogTickProfile(a_Output);
+		}
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("chunkcost") == 0)
+	{
+		int Count = 10;
+		if ((split.size() > 1) && (split[1] == "on"))
+		{
+			cRoot::Get()->SetChunkTickProfilingEnabled(true);
+			a_Output.Out("Chunk tick profiling has been turned on.");
+		}
+		else if ((split.size() > 1) && (split[1] == "off"))
+		{
+			cRoot::Get()->SetChunkTickProfilingEnabled(false);
+			a_Output.Out("Chunk tick profiling has been turned off.");
+		}
+		else if ((split.size() > 1) && (split[1] == "reset"))
+		{
+			cRoot::Get()->ResetChunkTickCosts();
+			a_Output.Out("Chunk tick costs have been reset.");
+		}
+		else if ((split.size() > 1) && (!StringToInteger(split[1], Count) || (Count <= 0)))
+		{
+			a_Output.Out("Usage: chunkcost [on|off|reset|<count>]");
+		}
+		else
+		{
+			cRoot::Get()->LogChunkTickCosts(a_Output, static_cast<size_t>(Count));
+		}
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("memstats") == 0)
+	{
+		cRoot::Get()->LogMemoryStats(a_Output);
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("lockstats") == 0)
+	{
+		if ((split.size() > 1) && (split[1] == "reset"))
+		{
+			cCriticalSection::ResetStats();
+			a_Output.Out("Lock stats have been reset.");
+		}
+		else
+		{
+			AStringVector Lines;
+			cCriticalSection::GetStatsReport(Lines);
+			for (const auto & Line: Lines)
+			{
+				a_Output.Out(Line);
+			}
+		}
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("sampleprofile") == 0)
+	{
+		AString Error;
+		if ((split.size() > 1) && (split[1] == "start"))
+		{
+			int Frequency = 100;
+			if ((split.size() > 2) && (!StringToInteger(split[2], Frequency)))
+			{
+				a_Output.Out("Invalid sampling frequency: %s", split[2].c_str());
+			}
+			else if (cSamplingProfiler::Get().Start(Frequency, (split.size() > 3) ? split[3] : "", Error))
+			{
+				a_Output.Out("Sampling profiler started at %d Hz.", Frequency);
+			}
+			else
+			{
+				a_Output.Out("Cannot start the sampling profiler: %s", Error.c_str());
+			}
+		}
+		else if ((split.size() > 1) && (split[1] == "stop"))
+		{
+			AString FileName = (split.size() > 2) ? split[2] : "profile.folded";
+			size_t NumSamples = 0;
+			if (cSamplingProfiler::Get().Stop(FileName, NumSamples, Error))
+			{
+				a_Output.Out("Sampling profiler stopped, " SIZE_T_FMT " samples written to %s.", NumSamples, FileName.c_str());
+			}
+			else
+			{
+				a_Output.Out("Cannot stop the sampling profiler: %s", Error.c_str());
+			}
+		}
+		else
+		{
+			a_Output.Out("Usage: sampleprofile start [<hz>] [<threadfilter>] | stop [<filename>]");
+		}
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("pluginstats") == 0)
+	{
+		if ((split.size() > 1) && (split[1] == "reset"))
+		{
+			cPluginManager::Get()->ResetPluginStats();
+			a_Output.Out("Plugin stats have been reset.");
+		}
+		else
+		{
+			cPluginManager::Get()->LogPluginStats(a_Output);
+		}
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("netstat") == 0)
+	{
+		ExecuteNetstatCommand(split, a_Output);
+		a_Output.Finished();
+		return;
+	}
+	else if (split[0].compare("pregen") == 0)
+	{
+		ExecutePregenCommand(split, a_Output);
+		a_Output.Finished();
+		return;
+	}
 	#if defined(_MSC_VER) && defined(_DEBUG) && defined(ENABLE_LEAK_FINDER)
 	else if (split[0].compare("dumpmem") == 0)
 	{
@@ -596,6 +865,159 @@ void cServer::PrintHelp(const AStringVector & a_Split, cCommandOutputCallback &
 
 
 
+void cServer::ExecutePregenCommand(const AStringVector & a_Split, cCommandOutputCallback & a_Output)
+{
+	if (a_Split.size() < 2)
+	{
+		a_Output.Out("Usage: pregen <world> [<minchunkx> <minchunkz> <maxchunkx> <maxchunkz> [<inflight>] | stop | cancel]");
+		return;
+	}
+	cWorld * World = cRoot::Get()->GetWorld(a_Split[1]);
+	if (World == nullptr)
+	{
+		a_Output.Out(Printf("There's no world \"%s\"", a_Split[1].c_str()));
+		return;
+	}
+
+	// Status:
+	if (a_Split.size() == 2)
+	{
+		a_Output.Out(World->GetPregenerationStatus());
+		return;
+	}
+
+	// Stop:
+	if ((a_Split[2] == "stop") || (a_Split[2] == "cancel"))
+	{
+		if (!World->IsPregenerating())
+		{
+			a_Output.Out(World->GetPregenerationStatus());
+			return;
+		}
+		bool ShouldResume = (a_Split[2] == "stop");
+		World->StopPregeneration(ShouldResume);
+		a_Output.Out(ShouldResume ? "Pregeneration stopped, it will resume upon the next start" : "Pregeneration cancelled");
+		return;
+	}
+
+	// Start:
+	int MinChunkX, MinChunkZ, MaxChunkX, MaxChunkZ;
+	int MaxInFlight = 0;  // Chosen by the pregenerator, based on the number of generator and lighting workers
+	if (
+		(a_Split.size() < 6) ||
+		!StringToInteger(a_Split[2], MinChunkX) ||
+		!StringToInteger(a_Split[3], MinChunkZ) ||
+		!StringToInteger(a_Split[4], MaxChunkX) ||
+		!StringToInteger(a_Split[5], MaxChunkZ) ||
+		((a_Split.size() > 6) && !StringToInteger(a_Split[6], MaxInFlight))
+	)
+	{
+		a_Output.Out("Usage: pregen <world> <minchunkx> <minchunkz> <maxchunkx> <maxchunkz> [<inflight>]");
+		return;
+	}
+	if (!World->StartPregeneration(MinChunkX, MinChunkZ, MaxChunkX, MaxChunkZ, MaxInFlight))
+	{
+		a_Output.Out("Cannot start the pregeneration, the area is invalid or a pregeneration is already running");
+		return;
+	}
+	a_Output.Out("Pregeneration started");
+}
+
+
+
+
+
+/** Returns the human-readable upper bound of the specified quantile of the network stats histogram. */
+static AString FormatNetworkQuantile(const cClientNetworkStats::sHistogram & a_Histogram, double a_Quantile)
+{
+	Int64 Bound = a_Histogram.GetQuantileBound(a_Quantile);
+	if (a_Histogram.m_Count == 0)
+	{
+		return "n/a";
+	}
+	if (Bound < 0)
+	{
+		return Printf("> %lld ms", static_cast<long long>(cClientNetworkStats::sHistogram::GetBucketBound(cClientNetworkStats::sHistogram::NUM_BUCKETS - 1) / 1000));
+	}
+	if (Bound >= 1000)
+	{
+		return Printf("<= %lld ms", static_cast<long long>(Bound / 1000));
+	}
+	return Printf("<= %lld us", static_cast<long long>(Bound));
+}
+
+
+
+
+
+void cServer::ExecuteNetstatCommand(const AStringVector & a_Split, cCommandOutputCallback & a_Output)
+{
+	class cPlayerStats :
+		public cPlayerListCallback
+	{
+	public:
+		const AString & m_PlayerName;
+		AStringVector m_Lines;
+
+		cPlayerStats(const AString & a_PlayerName) : m_PlayerName(a_PlayerName) {}
+
+		virtual bool Item(cPlayer * a_Player) override
+		{
+			cClientHandle * Client = a_Player->GetClientHandle();
+			if ((Client == nullptr) || (!m_PlayerName.empty() && (NoCaseCompare(a_Player->GetName(), m_PlayerName) != 0)))
+			{
+				return false;
+			}
+			cClientNetworkStats::sStats Stats;
+			Client->GetNetworkStats().GetStats(Stats);
+			m_Lines.push_back(Printf("%s: ping %d ms, send delay p50 %s / p99 %s, packet handling p99 %s",
+				a_Player->GetName().c_str(), Client->GetPing(),
+				FormatNetworkQuantile(Stats.m_SendQueueDelay, 0.5).c_str(), FormatNetworkQuantile(Stats.m_SendQueueDelay, 0.99).c_str(),
+				FormatNetworkQuantile(Stats.m_PacketHandleTime, 0.99).c_str()
+			));
+
+			// The packet types sending the most data:
+			UInt64 TotalBytes = Stats.m_BroadcastBytesSent;
+			std::vector<std::pair<UInt64, UInt32>> Types;
+			for (UInt32 Type = 0; Type < cClientNetworkStats::NUM_PACKET_TYPES; Type++)
+			{
+				TotalBytes += Stats.m_BytesSent[Type];
+				if (Stats.m_BytesSent[Type] > 0)
+				{
+					Types.push_back(std::make_pair(Stats.m_BytesSent[Type], Type));
+				}
+			}
+			std::sort(Types.begin(), Types.end(), std::greater<std::pair<UInt64, UInt32>>());
+			AString TopTypes;
+			for (size_t i = 0; i < std::min<size_t>(Types.size(), 5); i++)
+			{
+				AppendPrintf(TopTypes, "%s0x%02x %llu KiB", TopTypes.empty() ? "" : ", ", Types[i].second, static_cast<unsigned long long>(Types[i].first / 1024));
+			}
+			m_Lines.push_back(Printf("  queued " SIZE_T_FMT " KiB, link backlog " SIZE_T_FMT " KiB (max " SIZE_T_FMT " KiB), sent %llu KiB (broadcast %llu KiB%s%s)",
+				Client->GetOutgoingDataSize() / 1024, Stats.m_LinkBacklog / 1024, Stats.m_MaxLinkBacklog / 1024,
+				static_cast<unsigned long long>(TotalBytes / 1024), static_cast<unsigned long long>(Stats.m_BroadcastBytesSent / 1024),
+				TopTypes.empty() ? "" : "; ", TopTypes.c_str()
+			));
+			return false;
+		}
+	} PlayerStats((a_Split.size() > 1) ? a_Split[1] : AString());
+	cRoot::Get()->ForEachPlayer(PlayerStats);
+
+	if (PlayerStats.m_Lines.empty())
+	{
+		a_Output.Out((a_Split.size() > 1) ? Printf("There's no player \"%s\"", a_Split[1].c_str()) : AString("There are no players connected"));
+		return;
+	}
+	for (const auto & Line: PlayerStats.m_Lines)
+	{
+		a_Output.Out(Line);
+	}
+}
+
+
+
+
+
 void cServer::BindBuiltInConsoleCommands(void)
 {
 	cPluginManager * PlgMgr = cPluginManager::Get();
@@ -604,6 +1026,15 @@ void cServer::BindBuiltInConsoleCommands(void)
 	PlgMgr->BindConsoleCommand("restart", nullptr, " - Restarts the server cleanly");
 	PlgMgr->BindConsoleCommand("stop", nullptr, " - Stops the server cleanly");
 	PlgMgr->BindConsoleCommand("chunkstats", nullptr, " - Displays detailed chunk memory statistics");
+	PlgMgr->BindConsoleCommand("genstats", nullptr, " - Displays the time spent in each generator stage and the generator cache hit rates");
+	PlgMgr->BindConsoleCommand("tickprofile [reset]", nullptr, " - Displays the rolling percentiles of the time spent, and the heap allocations made (needs an ALLOC_STATS build), in each phase of the worlds' ticks, or resets them");
+	PlgMgr->BindConsoleCommand("chunkcost [on|off|reset|<count>]", nullptr, " - Displays the chunks that took the most time to tick, or controls the chunk tick profiling");
+	PlgMgr->BindConsoleCommand("memstats", nullptr, " - Displays the memory used by the chunks, caches, client buffers and plugins");
+	PlgMgr->BindConsoleCommand("lockstats [reset]", nullptr, " - Displays the wait and hold times of the server's main locks, or resets them (needs a LOCK_STATS build)");
+	PlgMgr->BindConsoleCommand("sampleprofile start [<hz>] [<threadfilter>] | stop [<filename>]", nullptr, " - Starts sampling the server threads' stacks, or stops and writes them as folded stacks for flamegraph.pl");
+	PlgMgr->BindConsoleCommand("pluginstats [reset]", nullptr, " - Displays the time spent in each plugin's hooks and commands and the plugins' memory use, or resets the stats");
+	PlgMgr->BindConsoleCommand("netstat [<player>]", nullptr, " - Displays the players' network latency, send queueing and bytes sent per packet type");
+	PlgMgr->BindConsoleCommand("pregen <world> [<minchunkx> <minchunkz> <maxchunkx> <maxchunkz> [<inflight>] | stop | cancel]", nullptr, " - Pregenerates an area of a world, or shows / stops the pregeneration");
 	PlgMgr->BindConsoleCommand("load <pluginname>", nullptr, " - Adds and enables the specified plugin");
 	PlgMgr->BindConsoleCommand("unload <pluginname>", nullptr, " - Disables the specified plugin");
 	PlgMgr->BindConsoleCommand("destroyentities", nullptr, " - Destroys all entities in all worlds");
@@ -625,6 +1056,7 @@ void cServer::Shutdown(void)
 		srv->Close();
 	}
 	m_ServerHandles.clear();
+	m_QueryServer.Shutdown();
 
 	// Notify the tick thread and wait for it to terminate:
 	m_bRestarting = true;
@@ -662,16 +1094,89 @@ void cServer::KickUser(int a_ClientID, const AString & a_Reason)
 
 
 void cServer::AuthenticateUser(int a_ClientID, const AString & a_Name, const AString & a_UUID, const Json::Value & a_Properties)
+{
+	sQueuedLogin Login;
+	Login.m_ClientID = a_ClientID;
+	Login.m_Name = a_Name;
+	Login.m_UUID = a_UUID;
+	Login.m_Properties = a_Properties;
+	if (m_MaxLoginsPerSecond <= 0)
+	{
+		AdmitLogin(Login);
+		return;
+	}
+
+	size_t QueuePosition;
+	{
+		cCSLock Lock(m_CSLoginQueue);
+		QueuePosition = m_LoginQueue.size() + 1;
+		if (QueuePosition <= static_cast<size_t>(m_MaxLoginsPerSecond * m_MaxLoginQueueWait))
+		{
+			m_LoginQueue.push_back(Login);
+			return;
+		}
+	}
+
+	// The client would time out before its turn, tell it where it stands instead:
+	LOGD("Login queue full, asking player %s to reconnect later (queue position " SIZE_T_FMT ")", a_Name.c_str(), QueuePosition);
+	KickUser(a_ClientID, Printf(
+		"Too many players are joining right now, you are number " SIZE_T_FMT " in the queue. Please reconnect in %d seconds.",
+		QueuePosition, static_cast<int>(QueuePosition / static_cast<size_t>(m_MaxLoginsPerSecond)) - m_MaxLoginQueueWait + 1
+	));
+}
+
+
+
+
+
+void cServer::ProcessLoginQueue(float a_Dt)
+{
+	if (m_MaxLoginsPerSecond <= 0)
+	{
+		return;
+	}
+	m_LoginAllowance = std::min(m_LoginAllowance + m_MaxLoginsPerSecond * a_Dt / 1000, static_cast<double>(m_MaxLoginsPerSecond));
+	while (m_LoginAllowance >= 1)
+	{
+		sQueuedLogin Login;
+		{
+			cCSLock Lock(m_CSLoginQueue);
+			if (m_LoginQueue.empty())
+			{
+				return;
+			}
+			std::swap(Login, m_LoginQueue.front());
+			m_LoginQueue.pop_front();
+		}
+
+		// Only the logins of the clients that are still connected count towards the limit:
+		if (AdmitLogin(Login))
+		{
+			m_LoginAllowance -= 1;
+		}
+	}
+}
+
+
+
+
+
+bool cServer::AdmitLogin(const sQueuedLogin & a_Login)
 {
 	cCSLock Lock(m_CSClients);
 	for (auto itr = m_Clients.begin(); itr != m_Clients.end(); ++itr)
 	{
-		if ((*itr)->GetUniqueID() == a_ClientID)
+		if ((*itr)->GetUniqueID() == a_Login.m_ClientID)
 		{
-			(*itr)->Authenticate(a_Name, a_UUID, a_Properties);
-			return;
+			if ((*itr)->IsDestroyed())
+			{
+				return false;
+			}
+			(*itr)->Authenticate(a_Login.m_Name, a_Login.m_UUID, a_Login.m_Properties);
+			return true;
 		}
 	}  // for itr - m_Clients[]
+	return false;
 }
 
 
@@ -10,8 +10,10 @@
 #pragma once
 
 #include "RCONServer.h"
+#include "QueryServer.h"
 #include "OSSupport/IsThread.h"
 #include "OSSupport/Network.h"
+#include "json/json.h"
 
 #ifdef _MSC_VER
 	#pragma warning(push)
@@ -42,12 +44,6 @@ class cIniFile;
 class cCommandOutputCallback;
 
 
-namespace Json
-{
-	class Value;
-}
-
-
 
 
 
@@ -92,6 +88,12 @@ public:
 	/** Lists all available console commands and their helpstrings */
 	void PrintHelp(const AStringVector & a_Split, cCommandOutputCallback & a_Output);
 
+	/** Executes the "pregen" console command - starts, stops or shows the pregeneration of a world */
+	void ExecutePregenCommand(const AStringVector & a_Split, cCommandOutputCallback & a_Output);
+
+	/** Executes the "netstat" console command - shows the network latency and queueing stats of all or only the specified players */
+	void ExecuteNetstatCommand(const AStringVector & a_Split, cCommandOutputCallback & a_Output);
+
 	/** Binds the built-in console commands with the plugin manager */
 	static void BindBuiltInConsoleCommands(void);
 	
@@ -99,7 +101,8 @@ public:
 
 	void KickUser(int a_ClientID, const AString & a_Reason);
 	
-	/** Authenticates the specified user, called by cAuthenticator */
+	/** Authenticates the specified user, called by cAuthenticator.
+	The login is queued and admitted from the tick thread, at most m_MaxLoginsPerSecond per second (see ProcessLoginQueue()). */
 	void AuthenticateUser(int a_ClientID, const AString & a_Name, const AString & a_UUID, const Json::Value & a_Properties);
 
 	const AString & GetServerID(void) const { return m_ServerID; }  // tolua_export
@@ -118,6 +121,14 @@ public:
 
 	/** Returns base64 encoded favicon data (obtained from favicon.png) */
 	const AString & GetFaviconData(void) const { return m_FaviconData; }
+
+	/** Returns the server list status response JSON of the specified protocol, for the values as adjusted by the HOOK_SERVER_PING.
+	The server list scanners ping a lot, so each protocol's response is cached and only rebuilt when any of the values change. */
+	AString GetStatusResponse(int a_ProtocolVersion, const AString & a_VersionName, const AString & a_Description, int a_NumPlayers, int a_MaxPlayers, const AString & a_Favicon);
+
+	/** Returns true if the status ping from the specified IP address should be answered,
+	false if the address has already sent m_MaxStatusPingsPerMinute pings in the current minute. */
+	bool ShouldAnswerStatusPing(const AString & a_IPAddress);
 	
 	cRsaPrivateKey & GetPrivateKey(void) { return m_PrivateKey; }
 	const AString & GetPublicKeyDER(void) const { return m_PublicKeyDER; }
@@ -143,6 +154,7 @@ private:
 
 	friend class cRoot;  // so cRoot can create and destroy cServer
 	friend class cServerListenCallbacks;  // Accessing OnConnectionAccepted()
+	friend class cTickReplayer;  // Creating the replayed clients through OnConnectionAccepted()
 	
 	/** The server tick thread takes care of the players who aren't yet spawned in a world */
 	class cTickThread :
@@ -172,6 +184,70 @@ private:
 
 	/** Clients that have just been moved into a world and are to be removed from m_Clients in the next Tick(). */
 	cClientHandles m_ClientsToRemove;
+
+	/** An authenticated login waiting in the login queue for its turn. */
+	struct sQueuedLogin
+	{
+		int m_ClientID;
+		AString m_Name;
+		AString m_UUID;
+		Json::Value m_Properties;
+	} ;
+
+	/** Protects m_LoginQueue against multithreaded access. */
+	cCriticalSection m_CSLoginQueue;
+
+	/** The authenticated logins waiting to be admitted, in the order of their authentication. */
+	std::deque<sQueuedLogin> m_LoginQueue;
+
+	/** The number of logins admitted per second, to keep a mass join (such as after a restart) from stalling the server; 0 for no limit.
+	Loaded from the settings.ini [Server].MaxLoginsPerSecond setting. */
+	int m_MaxLoginsPerSecond;
+
+	/** The longest a login may expect to wait in the queue, in seconds; the logins that would wait longer are asked to reconnect later,
+	because the clients time out while waiting. Loaded from the settings.ini [Server].MaxLoginQueueWait setting. */
+	int m_MaxLoginQueueWait;
+
+	/** A cached status response of a single protocol version, together with the values it was built from. */
+	struct sStatusResponse
+	{
+		AString m_VersionName;
+		AString m_Description;
+		int m_NumPlayers;
+		int m_MaxPlayers;
+		AString m_Favicon;
+		AString m_Response;
+	} ;
+
+	/** The window in which an IP address' status pings are counted. */
+	struct sStatusPingWindow
+	{
+		std::chrono::steady_clock::time_point m_Start;
+		int m_NumPings;
+	} ;
+
+	/** Protects m_StatusResponses against multithreaded access. */
+	cCriticalSection m_CSStatusResponses;
+
+	/** The cached status responses, mapped by the protocol version. */
+	std::map<int, sStatusResponse> m_StatusResponses;
+
+	/** Protects m_StatusPingWindows and m_LastStatusPingCleanup against multithreaded access. */
+	cCriticalSection m_CSStatusPings;
+
+	/** The current status ping window of each IP address that has pinged recently. */
+	std::map<AString, sStatusPingWindow> m_StatusPingWindows;
+
+	/** The last time the expired windows were removed from m_StatusPingWindows. */
+	std::chrono::steady_clock::time_point m_LastStatusPingCleanup;
+
+	/** The number of status pings answered per IP address per minute; 0 for no limit.
+	Loaded from the settings.ini [Server].MaxStatusPingsPerMinute setting. */
+	int m_MaxStatusPingsPerMinute;
+
+	/** The number of logins that may be admitted right now; refills at m_MaxLoginsPerSecond, up to a second's worth.
+	Only accessed from the tick thread. */
+	double m_LoginAllowance;
 	
 	/** Protects m_PlayerCount against multithreaded access. */
 	mutable cCriticalSection m_CSPlayerCount;
@@ -198,6 +274,9 @@ private:
 	AString m_PublicKeyDER;
 	
 	cRCONServer m_RCONServer;
+
+	/** Answers the UDP server queries, if enabled in the settings. */
+	cQueryServer m_QueryServer;
 	
 	AString m_Description;
 	AString m_FaviconData;
@@ -248,6 +327,12 @@ private:
 	
 	/** Ticks the clients in m_Clients, manages the list in respect to removing clients */
 	void TickClients(float a_Dt);
+
+	/** Admits as many of the queued logins as m_MaxLoginsPerSecond allows for the elapsed a_Dt msec. */
+	void ProcessLoginQueue(float a_Dt);
+
+	/** Finishes the login of the specified client (calls cClientHandle::Authenticate()). Returns false if the client is gone. */
+	bool AdmitLogin(const sQueuedLogin & a_Login);
 };  // tolua_export
 
 
@@ -11,14 +11,25 @@
 
 
 
-cSetChunkData::cSetChunkData(int a_ChunkX, int a_ChunkZ, bool a_ShouldMarkDirty) :
+cSetChunkData::cSetChunkData(
+	int a_ChunkX, int a_ChunkZ,
+	cChunkData && a_ChunkData,
+	bool a_IsLightValid,
+	const cChunkDef::HeightMap * a_HeightMap,
+	const cChunkDef::BiomeMap * a_Biomes,
+	cEntityList && a_Entities,
+	cBlockEntityList && a_BlockEntities,
+	bool a_ShouldMarkDirty
+) :
 	m_ChunkX(a_ChunkX),
 	m_ChunkZ(a_ChunkZ),
-	m_IsLightValid(false),
-	m_IsHeightMapValid(false),
-	m_AreBiomesValid(false),
+	m_ChunkData(std::move(a_ChunkData)),
+	m_Entities(std::move(a_Entities)),
+	m_BlockEntities(std::move(a_BlockEntities)),
+	m_IsLightValid(a_IsLightValid),
 	m_ShouldMarkDirty(a_ShouldMarkDirty)
 {
+	SetHeightMapAndBiomes(a_HeightMap, a_Biomes);
 }
 
 
@@ -27,6 +38,7 @@ cSetChunkData::cSetChunkData(int a_ChunkX, int a_ChunkZ, bool a_ShouldMarkDirty)
 
 cSetChunkData::cSetChunkData(
 	int a_ChunkX, int a_ChunkZ,
+	cAllocationPool<cChunkData::sChunkSection> & a_Pool,
 	const BLOCKTYPE * a_BlockTypes,
 	const NIBBLETYPE * a_BlockMetas,
 	const NIBBLETYPE * a_BlockLight,
@@ -39,53 +51,48 @@ cSetChunkData::cSetChunkData(
 ) :
 	m_ChunkX(a_ChunkX),
 	m_ChunkZ(a_ChunkZ),
+	m_ChunkData(a_Pool),
+	m_Entities(std::move(a_Entities)),
+	m_BlockEntities(std::move(a_BlockEntities)),
 	m_ShouldMarkDirty(a_ShouldMarkDirty)
 {
 	// Check the params' validity:
 	ASSERT(a_BlockTypes != nullptr);
 	ASSERT(a_BlockMetas != nullptr);
 
-	// Copy block types and metas:
-	memcpy(m_BlockTypes, a_BlockTypes, sizeof(cChunkDef::BlockTypes));
-	memcpy(m_BlockMetas, a_BlockMetas, sizeof(cChunkDef::BlockNibbles));
-	
-	// Copy lights, if both given:
-	if ((a_BlockLight != nullptr) && (a_SkyLight != nullptr))
-	{
-		memcpy(m_BlockLight, a_BlockLight, sizeof(m_BlockLight));
-		memcpy(m_SkyLight,   a_SkyLight,   sizeof(m_SkyLight));
-		m_IsLightValid = true;
-	}
-	else
-	{
-		m_IsLightValid = false;
-	}
-	
-	// Copy the heightmap, if available:
+	// Convert the block types and metas. With a heightmap, the sections above the highest block are known to be air
+	// and needn't even be scanned; most chunks are less than half full:
+	size_t NumSections = cChunkData::NumSections;
 	if (a_HeightMap != nullptr)
 	{
-		memcpy(m_HeightMap, a_HeightMap, sizeof(m_HeightMap));
-		m_IsHeightMapValid = true;
+		HEIGHTTYPE MaxHeight = *std::max_element(*a_HeightMap, *a_HeightMap + ARRAYCOUNT(*a_HeightMap));
+		NumSections = static_cast<size_t>(MaxHeight) / cChunkData::SectionHeight + 1;
+		#ifdef _DEBUG
+			for (size_t i = NumSections * cChunkData::SectionBlockCount; i < cChunkDef::NumBlocks; i++)
+			{
+				ASSERT(a_BlockTypes[i] == E_BLOCK_AIR);  // The heightmap is out of date
+			}
+		#endif
 	}
-	else
+	for (size_t i = 0; i < NumSections; i++)
 	{
-		m_IsHeightMapValid = false;
+		m_ChunkData.SetSection(
+			i,
+			a_BlockTypes + i * cChunkData::SectionBlockCount,
+			a_BlockMetas + i * cChunkData::SectionBlockCount / 2,
+			nullptr, nullptr
+		);
 	}
 	
-	// Copy biomes, if available:
-	if (a_Biomes != nullptr)
+	// Convert the lights, if both given:
+	m_IsLightValid = ((a_BlockLight != nullptr) && (a_SkyLight != nullptr));
+	if (m_IsLightValid)
 	{
-		memcpy(m_Biomes, a_Biomes, sizeof(m_Biomes));
-		m_AreBiomesValid = true;
-	}
-	else
-	{
-		m_AreBiomesValid = false;
+		m_ChunkData.SetBlockLight(a_BlockLight);
+		m_ChunkData.SetSkyLight(a_SkyLight);
 	}
 	
-	// Move entities and blockentities:
-	m_Entities = std::move(a_Entities);
-	m_BlockEntities = std::move(a_BlockEntities);
+	SetHeightMapAndBiomes(a_HeightMap, a_Biomes);
 }
 
 
@@ -94,21 +101,33 @@ cSetChunkData::cSetChunkData(
 
 void cSetChunkData::CalculateHeightMap(void)
 {
-	for (int x = 0; x < cChunkDef::Width; x++)
+	// Scan the sections from the top down, each column only until its topmost non-air block is found:
+	bool IsColumnDone[cChunkDef::Width * cChunkDef::Width];
+	memset(IsColumnDone, 0, sizeof(IsColumnDone));
+	memset(m_HeightMap, 0, sizeof(m_HeightMap));
+	size_t NumColumnsLeft = ARRAYCOUNT(IsColumnDone);
+	BLOCKTYPE SectionBlocks[cChunkData::SectionBlockCount];
+	for (size_t Section = m_ChunkData.GetNumNonAirSections(); (Section > 0) && (NumColumnsLeft > 0); Section--)
 	{
-		for (int z = 0; z < cChunkDef::Width; z++)
+		m_ChunkData.CopyBlockTypes(SectionBlocks, (Section - 1) * cChunkData::SectionBlockCount, cChunkData::SectionBlockCount);
+		for (size_t Column = 0; Column < ARRAYCOUNT(IsColumnDone); Column++)
 		{
-			for (int y = cChunkDef::Height - 1; y > -1; y--)
+			if (IsColumnDone[Column])
 			{
-				int index = cChunkDef::MakeIndexNoCheck(x, y, z);
-				if (m_BlockTypes[index] != E_BLOCK_AIR)
+				continue;
+			}
+			for (size_t y = cChunkData::SectionHeight; y > 0; y--)
+			{
+				if (SectionBlocks[(y - 1) * cChunkDef::Width * cChunkDef::Width + Column] != E_BLOCK_AIR)
 				{
-					m_HeightMap[x + z * cChunkDef::Width] = static_cast<HEIGHTTYPE>(y);
+					m_HeightMap[Column] = static_cast<HEIGHTTYPE>((Section - 1) * cChunkData::SectionHeight + y - 1);
+					IsColumnDone[Column] = true;
+					NumColumnsLeft -= 1;
 					break;
 				}
 			}  // for y
-		}  // for z
-	}  // for x
+		}  // for Column
+	}  // for Section
 	m_IsHeightMapValid = true;
 }
 
@@ -116,13 +135,41 @@ void cSetChunkData::CalculateHeightMap(void)
 
 
 
+void cSetChunkData::SetHeightMapAndBiomes(const cChunkDef::HeightMap * a_HeightMap, const cChunkDef::BiomeMap * a_Biomes)
+{
+	// Copy the heightmap, if available:
+	if (a_HeightMap != nullptr)
+	{
+		memcpy(m_HeightMap, a_HeightMap, sizeof(m_HeightMap));
+		m_IsHeightMapValid = true;
+	}
+	else
+	{
+		m_IsHeightMapValid = false;
+	}
+	
+	// Copy biomes, if available:
+	if (a_Biomes != nullptr)
+	{
+		memcpy(m_Biomes, a_Biomes, sizeof(m_Biomes));
+		m_AreBiomesValid = true;
+	}
+	else
+	{
+		m_AreBiomesValid = false;
+	}
+}
+
+
+
+
 
 void cSetChunkData::RemoveInvalidBlockEntities(void)
 {
 	for (cBlockEntityList::iterator itr = m_BlockEntities.begin(); itr != m_BlockEntities.end();)
 	{
 		BLOCKTYPE EntityBlockType = (*itr)->GetBlockType();
-		BLOCKTYPE WorldBlockType = cChunkDef::GetBlock(m_BlockTypes, (*itr)->GetRelX(), (*itr)->GetPosY(), (*itr)->GetRelZ());
+		BLOCKTYPE WorldBlockType = m_ChunkData.GetBlock((*itr)->GetRelX(), (*itr)->GetPosY(), (*itr)->GetRelZ());
 		if (EntityBlockType != WorldBlockType)
 		{
 			// Bad blocktype, remove the block entity:
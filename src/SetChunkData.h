@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include "ChunkData.h"
+
 
 
 
@@ -16,14 +18,24 @@
 class cSetChunkData
 {
 public:
-	/** Constructs a new instance with empty data.
-	Allocates new buffers for the block data.
-	Prefer to use this constructor, then fill the object with data and then send it to cWorld, as this will
-	reduce the copying required to queue the set operation. */
-	cSetChunkData(int a_ChunkX, int a_ChunkZ, bool a_ShouldMarkDirty);
-
-	/** Constructs a new instance based on data existing elsewhere, will copy all the memory. Prefer to use the
-	other constructor as much as possible.
+	/** Constructs a new instance that takes over the already section-based a_ChunkData, without copying the blocks.
+	Prefer to use this constructor: fill a cChunkData allocated from the world's section pool (cChunkMap::GetSectionPool())
+	and move it here; the data is then moved on into the chunk, so it is never copied on the way in.
+	a_IsLightValid specifies whether a_ChunkData contains valid light; if not, the chunk will be scheduled for re-lighting.
+	The heightmap, biomes, entities and block entities are handled the same as in the other constructor. */
+	cSetChunkData(
+		int a_ChunkX, int a_ChunkZ,
+		cChunkData && a_ChunkData,
+		bool a_IsLightValid,
+		const cChunkDef::HeightMap * a_HeightMap,
+		const cChunkDef::BiomeMap * a_Biomes,
+		cEntityList && a_Entities,
+		cBlockEntityList && a_BlockEntities,
+		bool a_ShouldMarkDirty
+	);
+
+	/** Constructs a new instance based on flat arrays existing elsewhere, converting them into the section-based
+	storage allocated from a_Pool (which must be the world's section pool, see cChunkMap::GetSectionPool()).
 	Will move the entity and blockentity lists into the internal storage, and invalidate a_Entities and
 	a_BlockEntities.
 	When passing an lvalue, a_Entities and a_BlockEntities must be explicitly converted to an rvalue beforehand
@@ -37,6 +49,7 @@ public:
 	the chunk data. */
 	cSetChunkData(
 		int a_ChunkX, int a_ChunkZ,
+		cAllocationPool<cChunkData::sChunkSection> & a_Pool,
 		const BLOCKTYPE * a_BlockTypes,
 		const NIBBLETYPE * a_BlockMetas,
 		const NIBBLETYPE * a_BlockLight,
@@ -51,17 +64,8 @@ public:
 	int GetChunkX(void) const { return m_ChunkX; }
 	int GetChunkZ(void) const { return m_ChunkZ; }
 	
-	/** Returns the internal storage of the block types, read-only. */
-	const cChunkDef::BlockTypes & GetBlockTypes(void) const { return m_BlockTypes; }
-	
-	/** Returns the internal storage of the block types, read-only. */
-	const cChunkDef::BlockNibbles & GetBlockMetas(void) const { return m_BlockMetas; }
-	
-	/** Returns the internal storage of the block light, read-only. */
-	const cChunkDef::BlockNibbles & GetBlockLight(void) const { return m_BlockLight; }
-	
-	/** Returns the internal storage of the block types, read-only. */
-	const cChunkDef::BlockNibbles & GetSkyLight(void) const { return m_SkyLight; }
+	/** Returns the internal storage of the blocks and light, read-write, so that the chunk can move the data out. */
+	cChunkData & GetChunkData(void) { return m_ChunkData; }
 	
 	/** Returns the internal storage for heightmap, read-only. */
 	const cChunkDef::HeightMap & GetHeightMap(void) const { return m_HeightMap; }
@@ -101,10 +105,7 @@ protected:
 	int m_ChunkX;
 	int m_ChunkZ;
 	
-	cChunkDef::BlockTypes m_BlockTypes;
-	cChunkDef::BlockNibbles m_BlockMetas;
-	cChunkDef::BlockNibbles m_BlockLight;
-	cChunkDef::BlockNibbles m_SkyLight;
+	cChunkData m_ChunkData;
 	cChunkDef::HeightMap m_HeightMap;
 	cChunkDef::BiomeMap m_Biomes;
 	cEntityList m_Entities;
@@ -114,6 +115,9 @@ protected:
 	bool m_IsHeightMapValid;
 	bool m_AreBiomesValid;
 	bool m_ShouldMarkDirty;
+
+	/** Copies the heightmap and the biomes, if given, and sets their validity flags accordingly. */
+	void SetHeightMapAndBiomes(const cChunkDef::HeightMap * a_HeightMap, const cChunkDef::BiomeMap * a_Biomes);
 };
 
 typedef SharedPtr<cSetChunkData> cSetChunkDataPtr;  // TODO: Change to unique_ptr once we go C++11
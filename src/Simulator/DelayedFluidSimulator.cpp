@@ -22,17 +22,21 @@ bool cDelayedFluidSimulatorChunkData::cSlot::Add(int a_RelX, int a_RelY, int a_R
 	ASSERT(a_RelZ >= 0);
 	ASSERT(a_RelZ < static_cast<int>(ARRAYCOUNT(m_Blocks)));
 	
-	cCoordWithIntVector & Blocks = m_Blocks[a_RelZ];
-	int Index = cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY, a_RelZ);
-	for (cCoordWithIntVector::const_iterator itr = Blocks.begin(), end = Blocks.end(); itr != end; ++itr)
+	ASSERT((a_RelY >= 0) && (a_RelY < cChunkDef::Height));
+	
+	std::unique_ptr<std::bitset<SectionBlockCount>> & IsQueued = m_IsQueued[a_RelY / SectionHeight];
+	if (IsQueued == nullptr)
 	{
-		if (itr->Data == Index)
-		{
-			// Already present
-			return false;
-		}
-	}  // for itr - Blocks[]
-	Blocks.push_back(cCoordWithInt(a_RelX, a_RelY, a_RelZ, Index));
+		IsQueued.reset(new std::bitset<SectionBlockCount>());
+	}
+	size_t SectionIndex = static_cast<size_t>(cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY % SectionHeight, a_RelZ));
+	if (IsQueued->test(SectionIndex))
+	{
+		// Already present
+		return false;
+	}
+	IsQueued->set(SectionIndex);
+	m_Blocks[a_RelZ].push_back(cCoordWithInt(a_RelX, a_RelY, a_RelZ, cChunkDef::MakeIndexNoCheck(a_RelX, a_RelY, a_RelZ)));
 	return true;
 }
 
@@ -151,6 +155,10 @@ void cDelayedFluidSimulator::SimulateChunk(std::chrono::milliseconds a_Dt, int a
 		m_TotalBlocks -= (int)Blocks.size();
 		Blocks.clear();
 	}
+	for (auto & IsQueued : Slot.m_IsQueued)
+	{
+		IsQueued.reset();
+	}
 }
 
 
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "FluidSimulator.h"
+#include <bitset>
 
 
 
@@ -22,6 +23,11 @@ public:
 	class cSlot
 	{
 	public:
+		/** The queued blocks are marked in bitmaps, each covering a section of the chunk this many blocks high. */
+		static const int SectionHeight = 16;
+		static const int NumSections = cChunkDef::Height / SectionHeight;
+		static const int SectionBlockCount = SectionHeight * cChunkDef::Width * cChunkDef::Width;
+
 		/// Returns true if the specified block is stored
 		bool HasBlock(int a_RelX, int a_RelY, int a_RelZ);
 		
@@ -32,6 +38,11 @@ public:
 		Int param is the block index (for faster duplicate comparison in Add())
 		*/
 		cCoordWithIntVector m_Blocks[16];
+
+		/** One bit for each block in a section, set for the blocks stored in m_Blocks[], so that Add() needn't search
+		the lists for duplicates; a flood adds thousands of blocks to a single slot.
+		Each section's bitmap is allocated by the first Add() into that section, all are released when the slot is simulated. */
+		std::unique_ptr<std::bitset<SectionBlockCount>> m_IsQueued[NumSections];
 	} ;
 	
 	cDelayedFluidSimulatorChunkData(int a_TickDelay);
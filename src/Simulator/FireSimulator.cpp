@@ -67,13 +67,18 @@ static const struct
 // cFireSimulator:
 
 cFireSimulator::cFireSimulator(cWorld & a_World, cIniFile & a_IniFile) :
-	cSimulator(a_World)
+	cSimulator(a_World),
+	m_NumFiresLastTick(0),
+	m_NumFiresThisTick(0),
+	m_SpreadsLeft(0)
 {
 	// Read params from the ini file:
 	m_BurnStepTimeFuel    = a_IniFile.GetValueSetI("FireSimulator", "BurnStepTimeFuel",     500);
 	m_BurnStepTimeNonfuel = a_IniFile.GetValueSetI("FireSimulator", "BurnStepTimeNonfuel",  100);
 	m_Flammability        = a_IniFile.GetValueSetI("FireSimulator", "Flammability",          50);
 	m_ReplaceFuelChance   = a_IniFile.GetValueSetI("FireSimulator", "ReplaceFuelChance",  50000);
+	m_MaxSpreadsPerTick   = a_IniFile.GetValueSetI("FireSimulator", "MaxSpreadsPerTick",   1000);
+	m_SpreadsLeft = m_MaxSpreadsPerTick;
 }
 
 
@@ -88,6 +93,20 @@ cFireSimulator::~cFireSimulator()
 
 
 
+void cFireSimulator::Simulate(float a_Dt)
+{
+	UNUSED(a_Dt);
+
+	// Start a new tick's spreading budget:
+	m_NumFiresLastTick = m_NumFiresThisTick;
+	m_NumFiresThisTick = 0;
+	m_SpreadsLeft = m_MaxSpreadsPerTick;
+}
+
+
+
+
+
 void cFireSimulator::SimulateChunk(std::chrono::milliseconds a_Dt, int a_ChunkX, int a_ChunkZ, cChunk * a_Chunk)
 {
 	cCoordWithIntList & Data = a_Chunk->GetFireSimulatorData();
@@ -110,8 +129,11 @@ void cFireSimulator::SimulateChunk(std::chrono::milliseconds a_Dt, int a_ChunkX,
 			continue;
 		}
 
-		// Try to spread the fire:
-		TrySpreadFire(a_Chunk, itr->x, itr->y, itr->z);
+		// Try to spread the fire, if the tick's budget allows:
+		if (ShouldTrySpreading())
+		{
+			TrySpreadFire(a_Chunk, itr->x, itr->y, itr->z);
+		}
 
 		itr->Data -= NumMSecs;
 		if (itr->Data >= 0)
@@ -298,6 +320,33 @@ int cFireSimulator::GetBurnStepTime(cChunk * a_Chunk, int a_RelX, int a_RelY, in
 
 
 
+bool cFireSimulator::ShouldTrySpreading(void)
+{
+	m_NumFiresThisTick += 1;
+	if (m_MaxSpreadsPerTick <= 0)
+	{
+		// Unlimited
+		return true;
+	}
+	if (m_SpreadsLeft <= 0)
+	{
+		return false;
+	}
+
+	// If there were more fires than the budget in the last tick, let only a random subset of them spread,
+	// so that the budget isn't used up by the chunks that happen to be simulated first:
+	if ((m_NumFiresLastTick > m_MaxSpreadsPerTick) && (m_World.GetTickRandomNumber(m_NumFiresLastTick - 1) >= m_MaxSpreadsPerTick))
+	{
+		return false;
+	}
+	m_SpreadsLeft -= 1;
+	return true;
+}
+
+
+
+
+
 void cFireSimulator::TrySpreadFire(cChunk * a_Chunk, int a_RelX, int a_RelY, int a_RelZ)
 {
 	/*
@@ -22,7 +22,7 @@ public:
 	cFireSimulator(cWorld & a_World, cIniFile & a_IniFile);
 	~cFireSimulator();
 
-	virtual void Simulate(float a_Dt) override { UNUSED(a_Dt);}  // not used
+	virtual void Simulate(float a_Dt) override;
 	virtual void SimulateChunk(std::chrono::milliseconds a_Dt, int a_ChunkX, int a_ChunkZ, cChunk * a_Chunk) override;
 
 	virtual bool IsAllowedBlock(BLOCKTYPE a_BlockType) override;
@@ -42,6 +42,20 @@ protected:
 	
 	/// Chance [0..100000] of a fuel burning out being replaced by a new fire block instead of an air block
 	int m_ReplaceFuelChance;
+
+	/** Maximum number of fire blocks in the world that may try spreading in a single tick, 0 = unlimited.
+	When there are more fire blocks, each of them tries with a lower chance, so that all the chunks get their share
+	and a large fire spreads slower instead of stretching the tick. */
+	int m_MaxSpreadsPerTick;
+
+	/** Number of fire blocks simulated in the previous tick; the chance of spreading in the current tick is based on it. */
+	int m_NumFiresLastTick;
+
+	/** Number of fire blocks simulated so far in the current tick. */
+	int m_NumFiresThisTick;
+
+	/** Number of spreading attempts left in the current tick's budget. */
+	int m_SpreadsLeft;
 	
 	
 	virtual void AddBlock(int a_BlockX, int a_BlockY, int a_BlockZ, cChunk * a_Chunk) override;
@@ -49,6 +63,10 @@ protected:
 	/// Returns the time [msec] after which the specified fire block is stepped again; based on surrounding fuels
 	int GetBurnStepTime(cChunk * a_Chunk, int a_RelX, int a_RelY, int a_RelZ);
 	
+	/** Returns true if the next fire block should try spreading, based on the current tick's budget.
+	Counts the fire block into m_NumFiresThisTick. */
+	bool ShouldTrySpreading(void);
+
 	/// Tries to spread fire to a neighborhood of the specified block
 	void TrySpreadFire(cChunk * a_Chunk, int a_RelX, int a_RelY, int a_RelZ);
 	
@@ -288,9 +288,9 @@ void cFloodyFluidSimulator::SpreadToNeighbor(cChunk * a_NearChunk, int a_RelX, i
 	// Wash away the block there, if possible:
 	if (CanWashAway(BlockType))
 	{
-		cBlockHandler * Handler = BlockHandler(BlockType);
-		if (Handler->DoesDropOnUnsuitable())
+		if (cBlockInfo::DoesDropOnUnsuitable(BlockType))
 		{
+			cBlockHandler * Handler = BlockHandler(BlockType);
 			cChunkInterface ChunkInterface(m_World.GetChunkMap());
 			cBlockInServerPluginInterface PluginInterface(m_World);
 			Handler->DropBlock(
@@ -2,6 +2,7 @@
 
 #include "FluidSimulator.h"
 #include "../World.h"
+#include "../Chunk.h"
 
 
 
@@ -214,3 +215,75 @@ Direction cFluidSimulator::GetFlowingDirection(int a_X, int a_Y, int a_Z, bool a
 
 
 
+
+Direction cFluidSimulator::GetFlowingDirection(cChunk & a_Chunk, int a_RelX, int a_RelY, int a_RelZ, bool a_Over)
+{
+	if ((a_RelY < 0) || (a_RelY >= cChunkDef::Height))
+	{
+		return NONE;
+	}
+	BLOCKTYPE BlockType;
+	NIBBLETYPE BlockMeta;
+	if (!a_Chunk.UnboundedRelGetBlock(a_RelX, a_RelY, a_RelZ, BlockType, BlockMeta) || !IsAllowedBlock(BlockType))
+	{
+		return NONE;
+	}
+
+	// Check for upper block to flow because this also affects the flowing direction:
+	if (a_Over && (a_RelY + 1 < cChunkDef::Height))
+	{
+		BLOCKTYPE UpperType;
+		NIBBLETYPE UpperMeta;
+		if (a_Chunk.UnboundedRelGetBlock(a_RelX, a_RelY + 1, a_RelZ, UpperType, UpperMeta) && IsAllowedBlock(UpperType))
+		{
+			return GetFlowingDirection(a_Chunk, a_RelX, a_RelY + 1, a_RelZ, false);
+		}
+	}
+
+	// Find the lowest point around, in the same order as the world-based variant:
+	static const struct
+	{
+		int x, z;
+		Direction Dir;
+	} Neighbors[] =
+	{
+		{-1,  0, X_MINUS},
+		{ 1,  0, X_PLUS},
+		{ 0,  1, Z_PLUS},
+		{ 0, -1, Z_MINUS},
+	} ;
+	NIBBLETYPE LowestPoint = BlockMeta;
+	Direction Res = NONE;
+	for (size_t i = 0; i < ARRAYCOUNT(Neighbors); i++)
+	{
+		BLOCKTYPE NeighborType;
+		NIBBLETYPE NeighborMeta;
+		if (!a_Chunk.UnboundedRelGetBlock(a_RelX + Neighbors[i].x, a_RelY, a_RelZ + Neighbors[i].z, NeighborType, NeighborMeta))
+		{
+			NeighborType = E_BLOCK_AIR;
+		}
+		if (IsAllowedBlock(NeighborType))
+		{
+			if (NeighborMeta > LowestPoint)
+			{
+				LowestPoint = NeighborMeta;
+				Res = Neighbors[i].Dir;
+			}
+		}
+		else if (NeighborType == E_BLOCK_AIR)
+		{
+			LowestPoint = 9;  // This always dominates
+			Res = Neighbors[i].Dir;
+		}
+	}  // for i - Neighbors[]
+
+	if (LowestPoint == BlockMeta)
+	{
+		return NONE;
+	}
+	return Res;
+}
+
+
+
+
@@ -49,6 +49,11 @@ public:
 	
 	/// Gets the flowing direction. If a_Over is true also the block over the current block affects the direction (standard)
 	virtual Direction GetFlowingDirection(int a_X, int a_Y, int a_Z, bool a_Over = true);
+
+	/** Same as GetFlowingDirection(), but reads the blocks directly from a_Chunk and its neighbors, using the coords relative to a_Chunk.
+	Much cheaper than going through the world, for the callers that have the chunk at hand, such as the entity physics.
+	The blocks in the chunks that aren't available are considered air, same as the world does. */
+	Direction GetFlowingDirection(cChunk & a_Chunk, int a_RelX, int a_RelY, int a_RelZ, bool a_Over = true);
 	
 	/// Creates a ChunkData object for the simulator to use. The simulator returns the correct object type.
 	virtual cFluidSimulatorData * CreateChunkData(void) { return nullptr; }
@@ -86,11 +86,10 @@ void cIncrementalRedstoneSimulator::RedstoneAddBlock(int a_BlockX, int a_BlockY,
 	}
 
 	auto & SimulatedPlayerToggleableBlocks = ((cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)a_Chunk->GetRedstoneSimulatorData())->m_SimulatedPlayerToggleableBlocks;
-	SimulatedPlayerToggleableBlocks.erase(std::remove_if(SimulatedPlayerToggleableBlocks.begin(), SimulatedPlayerToggleableBlocks.end(), [RelX, a_BlockY, RelZ, Block, this](const sSimulatedPlayerToggleableList & itr)
-		{
-			return itr.a_RelBlockPos.Equals(Vector3i(RelX, a_BlockY, RelZ)) && !IsAllowedBlock(Block);
-		}
-	), SimulatedPlayerToggleableBlocks.end());
+	if (!IsAllowedBlock(Block))
+	{
+		SimulatedPlayerToggleableBlocks.erase(Vector3i(RelX, a_BlockY, RelZ));
+	}
 
 	
 	auto & RepeatersDelayList = ((cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)a_Chunk->GetRedstoneSimulatorData())->m_RepeatersDelayList;
@@ -1452,14 +1451,8 @@ bool cIncrementalRedstoneSimulator::AreCoordsDirectlyPowered(int a_RelBlockX, in
 {
 	// Torches want to access neighbour's data when on a wall, hence the extra chunk parameter
 
-	for (const auto & itr : ((cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)a_Chunk->GetRedstoneSimulatorData())->m_PoweredBlocks)  // Check powered list
-	{
-		if (itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			return true;
-		}
-	}
-	return false;
+	const auto & Powered = ((cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)a_Chunk->GetRedstoneSimulatorData())->m_PoweredBlocks;
+	return (Powered.find(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)) != Powered.end());
 }
 
 
@@ -1468,14 +1461,7 @@ bool cIncrementalRedstoneSimulator::AreCoordsDirectlyPowered(int a_RelBlockX, in
 
 bool cIncrementalRedstoneSimulator::AreCoordsLinkedPowered(int a_RelBlockX, int a_RelBlockY, int a_RelBlockZ)
 {
-	for (const auto & itr : *m_LinkedPoweredBlocks)  // Check linked powered list
-	{
-		if (itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			return true;
-		}
-	}
-	return false;
+	return (m_LinkedPoweredBlocks->find(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)) != m_LinkedPoweredBlocks->end());
 }
 
 
@@ -1486,13 +1472,10 @@ bool cIncrementalRedstoneSimulator::IsRepeaterPowered(int a_RelBlockX, int a_Rel
 {
 	// Repeaters cannot be powered by any face except their back; verify that this is true for a source
 
-	for (const auto & itr : *m_PoweredBlocks)
+	auto PoweredRange = m_PoweredBlocks->equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	for (auto RangeItr = PoweredRange.first; RangeItr != PoweredRange.second; ++RangeItr)
 	{
-		if (!itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
-
+		const sPoweredBlocks & itr = RangeItr->second;
 		switch (a_Meta & 0x3)
 		{
 			case 0x0:
@@ -1531,13 +1514,10 @@ bool cIncrementalRedstoneSimulator::IsRepeaterPowered(int a_RelBlockX, int a_Rel
 		}
 	}  // for itr - m_PoweredBlocks[]
 
-	for (const auto & itr : *m_LinkedPoweredBlocks)
+	auto LinkedRange = m_LinkedPoweredBlocks->equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	for (auto RangeItr = LinkedRange.first; RangeItr != LinkedRange.second; ++RangeItr)
 	{
-		if (!itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
-
+		const sLinkedPoweredBlocks & itr = RangeItr->second;
 		switch (a_Meta & 0x3)
 		{
 			case 0x0:
@@ -1665,13 +1645,10 @@ bool cIncrementalRedstoneSimulator::IsPistonPowered(int a_RelBlockX, int a_RelBl
 
 	eBlockFace Face = GetHandlerCompileTime<E_BLOCK_PISTON>::type::MetaDataToDirection(a_Meta);
 
-	for (const auto & itr : *m_PoweredBlocks)
+	auto PoweredRange = m_PoweredBlocks->equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	for (auto RangeItr = PoweredRange.first; RangeItr != PoweredRange.second; ++RangeItr)
 	{
-		if (!itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
-
+		const sPoweredBlocks & itr = RangeItr->second;
 		int X = a_RelBlockX, Z = a_RelBlockZ;
 		AddFaceDirection(X, a_RelBlockY, Z, Face);
 
@@ -1681,13 +1658,10 @@ bool cIncrementalRedstoneSimulator::IsPistonPowered(int a_RelBlockX, int a_RelBl
 		}
 	}
 
-	for (const auto & itr : *m_LinkedPoweredBlocks)
+	auto LinkedRange = m_LinkedPoweredBlocks->equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	for (auto RangeItr = LinkedRange.first; RangeItr != LinkedRange.second; ++RangeItr)
 	{
-		if (!itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
-
+		const sLinkedPoweredBlocks & itr = RangeItr->second;
 		int X = a_RelBlockX, Z = a_RelBlockZ;
 		AddFaceDirection(X, a_RelBlockY, Z, Face);
 
@@ -1706,22 +1680,17 @@ bool cIncrementalRedstoneSimulator::IsWirePowered(int a_RelBlockX, int a_RelBloc
 {
 	a_PowerLevel = 0;
 
-	for (const auto & itr : *m_PoweredBlocks)  // Check powered list
+	auto PoweredRange = m_PoweredBlocks->equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));  // Check powered list
+	for (auto RangeItr = PoweredRange.first; RangeItr != PoweredRange.second; ++RangeItr)
 	{
-		if (!itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
+		const sPoweredBlocks & itr = RangeItr->second;
 		a_PowerLevel = std::max(itr.a_PowerLevel, a_PowerLevel);  // Get the highest power level (a_PowerLevel is initialised already and there CAN be multiple levels for one block)
 	}
 
-	for (const auto & itr : *m_LinkedPoweredBlocks)  // Check linked powered list
+	auto LinkedRange = m_LinkedPoweredBlocks->equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));  // Check linked powered list
+	for (auto RangeItr = LinkedRange.first; RangeItr != LinkedRange.second; ++RangeItr)
 	{
-		if (!itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
-
+		const sLinkedPoweredBlocks & itr = RangeItr->second;
 		BLOCKTYPE Type = E_BLOCK_AIR;
 		if (!m_Chunk->UnboundedRelGetBlockType(itr.a_SourcePos.x, itr.a_SourcePos.y, itr.a_SourcePos.z, Type) || (Type == E_BLOCK_REDSTONE_WIRE))
 		{
@@ -1739,21 +1708,19 @@ bool cIncrementalRedstoneSimulator::IsWirePowered(int a_RelBlockX, int a_RelBloc
 
 bool cIncrementalRedstoneSimulator::AreCoordsSimulated(int a_RelBlockX, int a_RelBlockY, int a_RelBlockZ, bool IsCurrentStatePowered)
 {
-	for (const auto & itr : *m_SimulatedPlayerToggleableBlocks)
+	auto itr = m_SimulatedPlayerToggleableBlocks->find(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	if (itr == m_SimulatedPlayerToggleableBlocks->end())
 	{
-		if (itr.a_RelBlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			if (itr.WasLastStatePowered != IsCurrentStatePowered)  // Was the last power state different to the current?
-			{
-				return false;  // It was, coordinates are no longer simulated
-			}
-			else
-			{
-				return true;  // It wasn't, don't resimulate block, and allow players to toggle
-			}
-		}
+		return false;  // Block wasn't even in the list, not simulated
+	}
+	if (itr->second.WasLastStatePowered != IsCurrentStatePowered)  // Was the last power state different to the current?
+	{
+		return false;  // It was, coordinates are no longer simulated
+	}
+	else
+	{
+		return true;  // It wasn't, don't resimulate block, and allow players to toggle
 	}
-	return false;  // Block wasn't even in the list, not simulated
 }
 
 
@@ -1901,25 +1868,23 @@ void cIncrementalRedstoneSimulator::SetBlockPowered(int a_RelBlockX, int a_RelBl
 	}
 
 	auto & Powered = ((cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)Neighbour->GetRedstoneSimulatorData())->m_PoweredBlocks;  // We need to insert the value into the chunk who owns the block position
-	for (auto itr = Powered.begin(); itr != Powered.end(); ++itr)
+	auto PoweredRange = Powered.equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	for (auto itr = PoweredRange.first; itr != PoweredRange.second; ++itr)
 	{
-		if (
-			itr->a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)) &&
-			itr->a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ))
-			)
+		if (itr->second.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ)))
 		{
 			// Check for duplicates, update power level, don't add a new listing
-			itr->a_PowerLevel = a_PowerLevel;
+			itr->second.a_PowerLevel = a_PowerLevel;
 			return;
 		}
 	}
 
 	// No need to get neighbouring chunk as we can guarantee that when something is powering us, the entry will be in our chunk
-	for (auto itr = m_PoweredBlocks->begin(); itr != m_PoweredBlocks->end(); ++itr)
+	auto SourceRange = m_PoweredBlocks->equal_range(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ));
+	for (auto itr = SourceRange.first; itr != SourceRange.second; ++itr)
 	{
 		if (
-			itr->a_BlockPos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ)) &&
-			itr->a_SourcePos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)) &&
+			itr->second.a_SourcePos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)) &&
 			(m_Chunk->GetBlock(a_RelSourceX, a_RelSourceY, a_RelSourceZ) == E_BLOCK_REDSTONE_WIRE)
 			)
 		{
@@ -1947,7 +1912,7 @@ void cIncrementalRedstoneSimulator::SetBlockPowered(int a_RelBlockX, int a_RelBl
 	RC.a_BlockPos = Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ);
 	RC.a_SourcePos = Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ);
 	RC.a_PowerLevel = a_PowerLevel;
-	Powered.emplace_back(RC);
+	Powered.emplace(RC.a_BlockPos, RC);
 	Neighbour->SetIsRedstoneDirty(true);
 	m_Chunk->SetIsRedstoneDirty(true);
 }
@@ -1976,16 +1941,16 @@ void cIncrementalRedstoneSimulator::SetBlockLinkedPowered(
 	}
 
 	auto & Linked = ((cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)Neighbour->GetRedstoneSimulatorData())->m_LinkedBlocks;
-	for (auto & itr : Linked)  // Check linked powered list
+	auto LinkedRange = Linked.equal_range(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	for (auto itr = LinkedRange.first; itr != LinkedRange.second; ++itr)  // Check linked powered list
 	{
 		if (
-			itr.a_BlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)) &&
-			itr.a_MiddlePos.Equals(Vector3i(a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ)) &&
-			itr.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ))
+			itr->second.a_MiddlePos.Equals(Vector3i(a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ)) &&
+			itr->second.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ))
 			)
 		{
 			// Check for duplicates, update power level, don't add a new listing
-			itr.a_PowerLevel = a_PowerLevel;
+			itr->second.a_PowerLevel = a_PowerLevel;
 			return;
 		}
 	}
@@ -1995,7 +1960,7 @@ void cIncrementalRedstoneSimulator::SetBlockLinkedPowered(
 	RC.a_MiddlePos = Vector3i(a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ);
 	RC.a_SourcePos = Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ);
 	RC.a_PowerLevel = a_PowerLevel;
-	Linked.emplace_back(RC);
+	Linked.emplace(RC.a_BlockPos, RC);
 	Neighbour->SetIsRedstoneDirty(true);
 	m_Chunk->SetIsRedstoneDirty(true);
 }
@@ -2006,31 +1971,19 @@ void cIncrementalRedstoneSimulator::SetBlockLinkedPowered(
 
 void cIncrementalRedstoneSimulator::SetPlayerToggleableBlockAsSimulated(int a_RelBlockX, int a_RelBlockY, int a_RelBlockZ, bool WasLastStatePowered)
 {
-	for (auto itr = m_SimulatedPlayerToggleableBlocks->begin(); itr != m_SimulatedPlayerToggleableBlocks->end(); ++itr)
+	auto itr = m_SimulatedPlayerToggleableBlocks->find(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ));
+	if (itr != m_SimulatedPlayerToggleableBlocks->end())
 	{
-		if (!itr->a_RelBlockPos.Equals(Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ)))
-		{
-			continue;
-		}
-
-		if (itr->WasLastStatePowered != WasLastStatePowered)
-		{
-			// If power states different, update listing
-			itr->WasLastStatePowered = WasLastStatePowered;
-			return;
-		}
-		else
-		{
-			// If states the same, just ignore
-			return;
-		}
+		// If power states different, update listing; if the same, just ignore
+		itr->second.WasLastStatePowered = WasLastStatePowered;
+		return;
 	}
 
 	// We have arrive here; no block must be in list - add one
 	sSimulatedPlayerToggleableList RC;
 	RC.a_RelBlockPos = Vector3i(a_RelBlockX, a_RelBlockY, a_RelBlockZ);
 	RC.WasLastStatePowered = WasLastStatePowered;
-	m_SimulatedPlayerToggleableBlocks->emplace_back(RC);
+	m_SimulatedPlayerToggleableBlocks->emplace(RC.a_RelBlockPos, RC);
 }
 
 
@@ -2087,29 +2040,33 @@ void cIncrementalRedstoneSimulator::SetSourceUnpowered(int a_RelSourceX, int a_R
 	std::vector<Vector3i> BlocksPotentiallyUnpowered;
 
 	auto Data = (cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)a_Chunk->GetRedstoneSimulatorData();
-	Data->m_PoweredBlocks.erase(std::remove_if(Data->m_PoweredBlocks.begin(), Data->m_PoweredBlocks.end(), [&BlocksPotentiallyUnpowered, a_Chunk, a_RelSourceX, a_RelSourceY, a_RelSourceZ](const sPoweredBlocks & itr)
+	for (auto itr = Data->m_PoweredBlocks.begin(); itr != Data->m_PoweredBlocks.end();)
+	{
+		if (itr->second.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ)))
 		{
-			if (itr.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ)))
-			{
-				BlocksPotentiallyUnpowered.emplace_back(itr.a_BlockPos);
-				a_Chunk->SetIsRedstoneDirty(true);
-				return true;
-			}
-			return false;
+			BlocksPotentiallyUnpowered.emplace_back(itr->first);
+			a_Chunk->SetIsRedstoneDirty(true);
+			itr = Data->m_PoweredBlocks.erase(itr);
+		}
+		else
+		{
+			++itr;
 		}
-	), Data->m_PoweredBlocks.end());
+	}
 
-	Data->m_LinkedBlocks.erase(std::remove_if(Data->m_LinkedBlocks.begin(), Data->m_LinkedBlocks.end(), [&BlocksPotentiallyUnpowered, a_Chunk, a_RelSourceX, a_RelSourceY, a_RelSourceZ](const sLinkedPoweredBlocks & itr)
+	for (auto itr = Data->m_LinkedBlocks.begin(); itr != Data->m_LinkedBlocks.end();)
+	{
+		if (itr->second.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ)))
 		{
-			if (itr.a_SourcePos.Equals(Vector3i(a_RelSourceX, a_RelSourceY, a_RelSourceZ)))
-			{
-				BlocksPotentiallyUnpowered.emplace_back(itr.a_BlockPos);
-				a_Chunk->SetIsRedstoneDirty(true);
-				return true;
-			}
-			return false;
+			BlocksPotentiallyUnpowered.emplace_back(itr->first);
+			a_Chunk->SetIsRedstoneDirty(true);
+			itr = Data->m_LinkedBlocks.erase(itr);
+		}
+		else
+		{
+			++itr;
 		}
-	), Data->m_LinkedBlocks.end());
+	}
 
 	if (a_IsFirstCall && AreCoordsOnChunkBoundary(a_RelSourceX, a_RelSourceY, a_RelSourceZ))
 	{
@@ -2148,17 +2105,19 @@ void cIncrementalRedstoneSimulator::SetInvalidMiddleBlock(int a_RelMiddleX, int
 	std::vector<Vector3i> BlocksPotentiallyUnpowered;
 	auto Data = (cIncrementalRedstoneSimulator::cIncrementalRedstoneSimulatorChunkData *)a_Chunk->GetRedstoneSimulatorData();
 
-	Data->m_LinkedBlocks.erase(std::remove_if(Data->m_LinkedBlocks.begin(), Data->m_LinkedBlocks.end(), [&BlocksPotentiallyUnpowered, a_Chunk, a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ](const sLinkedPoweredBlocks & itr)
+	for (auto itr = Data->m_LinkedBlocks.begin(); itr != Data->m_LinkedBlocks.end();)
+	{
+		if (itr->second.a_MiddlePos.Equals(Vector3i(a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ)))
 		{
-			if (itr.a_MiddlePos.Equals(Vector3i(a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ)))
-			{
-				BlocksPotentiallyUnpowered.emplace_back(itr.a_BlockPos);
-				a_Chunk->SetIsRedstoneDirty(true);
-				return true;
-			}
-			return false;
+			BlocksPotentiallyUnpowered.emplace_back(itr->first);
+			a_Chunk->SetIsRedstoneDirty(true);
+			itr = Data->m_LinkedBlocks.erase(itr);
 		}
-	), Data->m_LinkedBlocks.end());
+		else
+		{
+			++itr;
+		}
+	}
 
 	if (a_IsFirstCall && AreCoordsOnChunkBoundary(a_RelMiddleX, a_RelMiddleY, a_RelMiddleZ))
 	{
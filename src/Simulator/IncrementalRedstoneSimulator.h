@@ -3,6 +3,7 @@
 
 #include "RedstoneSimulator.h"
 #include "BlockEntities/RedstonePoweredEntity.h"
+#include <unordered_map>
 
 class cWorld;
 class cChunk;
@@ -65,12 +66,33 @@ private:
 		unsigned char a_PowerLevel;
 	};
 
+	/** Hashes the chunk-relative coords of the powered blocks, which don't reach far outside the chunk, so the low bits of each coord are enough. */
+	struct sRelPosHasher
+	{
+		size_t operator ()(const Vector3i & a_RelPos) const
+		{
+			return (
+				static_cast<size_t>(a_RelPos.x & 0xff) |
+				(static_cast<size_t>(a_RelPos.z & 0xff) << 8) |
+				(static_cast<size_t>(a_RelPos.y & 0xffff) << 16)
+			);
+		}
+	};
+
+	/** The powered blocks lists are keyed by the powered block's position (a_BlockPos), so that the queries for a single block's power,
+	which are made for every simulated block, needn't scan all the powered blocks in the chunk. */
+	typedef std::unordered_multimap<Vector3i, sPoweredBlocks, sRelPosHasher> PoweredBlocksList;
+	typedef std::unordered_multimap<Vector3i, sLinkedPoweredBlocks, sRelPosHasher> LinkedBlocksList;
+
 	struct sSimulatedPlayerToggleableList  // Define structure of the list containing simulate-on-update blocks (such as trapdoors that respond once to a block update, and can be toggled by a player)
 	{
 		Vector3i a_RelBlockPos;
 		bool WasLastStatePowered;  // Was the last state powered or not? Determines whether a source update has happened and if I should resimulate
 	};
 
+	/** The simulated player-toggleable blocks, keyed by their position (a_RelBlockPos); each block is listed once at most. */
+	typedef std::unordered_map<Vector3i, sSimulatedPlayerToggleableList, sRelPosHasher> SimulatedPlayerToggleableList;
+
 	struct sRepeatersDelayList  // Define structure of list containing repeaters' delay states
 	{
 		Vector3i a_RelBlockPos;
@@ -86,17 +108,14 @@ private:
 		/// Per-chunk data for the simulator, specified individual chunks to simulate
 		cCoordWithBlockAndBoolVector m_ChunkData;
 		cCoordWithBlockAndBoolVector m_QueuedChunkData;
-		std::vector<sPoweredBlocks> m_PoweredBlocks;
-		std::vector<sLinkedPoweredBlocks> m_LinkedBlocks;
-		std::vector<sSimulatedPlayerToggleableList> m_SimulatedPlayerToggleableBlocks;
+		PoweredBlocksList m_PoweredBlocks;
+		LinkedBlocksList m_LinkedBlocks;
+		SimulatedPlayerToggleableList m_SimulatedPlayerToggleableBlocks;
 		std::vector<sRepeatersDelayList> m_RepeatersDelayList;
 	};
 
 public:
 
-	typedef std::vector <sPoweredBlocks> PoweredBlocksList;
-	typedef std::vector <sLinkedPoweredBlocks> LinkedBlocksList;
-	typedef std::vector <sSimulatedPlayerToggleableList> SimulatedPlayerToggleableList;
 	typedef std::vector <sRepeatersDelayList> RepeatersDelayList;
 
 private:
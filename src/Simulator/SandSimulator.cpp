@@ -18,6 +18,7 @@ cSandSimulator::cSandSimulator(cWorld & a_World, cIniFile & a_IniFile) :
 	m_TotalBlocks(0)
 {
 	m_IsInstantFall = a_IniFile.GetValueSetB("Physics", "SandInstantFall", false);
+	m_InstantFallColumnHeight = a_IniFile.GetValueSetI("Physics", "SandInstantFallColumnHeight", 8);
 }
 
 
@@ -50,6 +51,19 @@ void cSandSimulator::SimulateChunk(std::chrono::milliseconds a_Dt, int a_ChunkX,
 				DoInstantFall(a_Chunk, itr->x, itr->y, itr->z);
 				continue;
 			}
+			if (m_InstantFallColumnHeight > 0)
+			{
+				int ColumnHeight = GetColumnHeight(a_Chunk, itr->x, itr->y, itr->z);
+				if (ColumnHeight >= m_InstantFallColumnHeight)
+				{
+					// A tall column, let it fall all at once, bottom-up, so that the blocks land in the same order as they would one by one:
+					for (int y = itr->y; y < itr->y + ColumnHeight; y++)
+					{
+						DoInstantFall(a_Chunk, itr->x, y, itr->z);
+					}
+					continue;
+				}
+			}
 			Vector3i Pos;
 			Pos.x = itr->x + BaseX;
 			Pos.y = itr->y;
@@ -315,3 +329,17 @@ void cSandSimulator::DoInstantFall(cChunk * a_Chunk, int a_RelX, int a_RelY, int
 
 
 
+
+int cSandSimulator::GetColumnHeight(cChunk * a_Chunk, int a_RelX, int a_RelY, int a_RelZ)
+{
+	int y = a_RelY;
+	while ((y < cChunkDef::Height) && IsAllowedBlock(a_Chunk->GetBlock(a_RelX, y, a_RelZ)))
+	{
+		y++;
+	}
+	return y - a_RelY;
+}
+
+
+
+
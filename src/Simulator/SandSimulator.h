@@ -45,6 +45,10 @@ public:
 
 protected:
 	bool m_IsInstantFall;  // If set to true, blocks don't fall using cFallingBlock entity, but instantly instead
+
+	/** Columns of at least this many falling-able blocks fall instantly as a whole, instead of creating a cFallingBlock entity
+	for each block, one after another. 0 = always use the entities (unless m_IsInstantFall is set). */
+	int m_InstantFallColumnHeight;
 	
 	int  m_TotalBlocks;    // Total number of blocks currently in the queue for simulating
 	
@@ -52,6 +56,9 @@ protected:
 	
 	/// Performs the instant fall of the block - removes it from top, Finishes it at the bottom
 	void DoInstantFall(cChunk * a_Chunk, int a_RelX, int a_RelY, int a_RelZ);
+
+	/** Returns the number of falling-able blocks in the column starting at the specified block and going up. */
+	int GetColumnHeight(cChunk * a_Chunk, int a_RelX, int a_RelY, int a_RelZ);
 };
 
 
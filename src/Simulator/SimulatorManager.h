@@ -37,14 +37,31 @@ public:
 	
 	void WakeUp(int a_BlockX, int a_BlockY, int a_BlockZ, cChunk * a_Chunk);
 
-	void RegisterSimulator(cSimulator * a_Simulator, int a_Rate);  // Takes ownership of the simulator object!
+	/** Registers the simulator to be run each a_Rate ticks. a_Name identifies the simulator in the tick profiler,
+	it must be a string with static storage duration (a literal). */
+	void RegisterSimulator(cSimulator * a_Simulator, int a_Rate, const char * a_Name);  // Takes ownership of the simulator object!
+
+	/** Stretches all the simulators' rates by the specified factor (1 for the registered rates), used by the world to run
+	the simulators less often while it is overloaded. */
+	void SetRateMultiplier(int a_RateMultiplier);
 
 protected:
-	typedef std::vector <std::pair<cSimulator *, int> > cSimulators;
+	/** A single registered simulator. */
+	struct sSimulator
+	{
+		cSimulator * m_Simulator;
+		int m_Rate;
+		const char * m_Name;
+	} ;
+
+	typedef std::vector<sSimulator> cSimulators;
 	
 	cWorld & m_World;
 	cSimulators m_Simulators;
 	long long   m_Ticks;
+
+	/** The factor applied to all the simulators' rates, see SetRateMultiplier(). */
+	int m_RateMultiplier;
 };
 
 
@@ -242,3 +242,82 @@ extern int InflateString(const char * a_Data, size_t a_Length, AString & a_Uncom
 
 
 
+
+bool StringToCompressionCodec(const AString & a_Name, eCompressionCodec & a_Codec)
+{
+	if (NoCaseCompare(a_Name, "gzip") == 0)
+	{
+		a_Codec = ccGZip;
+		return true;
+	}
+	if (NoCaseCompare(a_Name, "zlib") == 0)
+	{
+		a_Codec = ccZlib;
+		return true;
+	}
+	if (NoCaseCompare(a_Name, "none") == 0)
+	{
+		a_Codec = ccNone;
+		return true;
+	}
+	return false;
+}
+
+
+
+
+
+AString CompressionCodecToString(eCompressionCodec a_Codec)
+{
+	switch (a_Codec)
+	{
+		case ccGZip: return "gzip";
+		case ccZlib: return "zlib";
+		case ccNone: return "none";
+	}
+	ASSERT(!"Unknown compression codec");
+	return "";
+}
+
+
+
+
+
+int CompressStringWithCodec(eCompressionCodec a_Codec, const char * a_Data, size_t a_Length, AString & a_Compressed, int a_Level)
+{
+	switch (a_Codec)
+	{
+		case ccGZip: return CompressStringGZIP(a_Data, a_Length, a_Compressed);
+		case ccZlib: return CompressString(a_Data, a_Length, a_Compressed, a_Level);
+		case ccNone:
+		{
+			a_Compressed.assign(a_Data, a_Length);
+			return Z_OK;
+		}
+	}
+	ASSERT(!"Unknown compression codec");
+	return Z_STREAM_ERROR;
+}
+
+
+
+
+
+int UncompressStringWithCodec(eCompressionCodec a_Codec, const char * a_Data, size_t a_Length, AString & a_Uncompressed)
+{
+	switch (a_Codec)
+	{
+		case ccGZip: return UncompressStringGZIP(a_Data, a_Length, a_Uncompressed);
+		case ccZlib: return InflateString(a_Data, a_Length, a_Uncompressed);
+		case ccNone:
+		{
+			a_Uncompressed.assign(a_Data, a_Length);
+			return Z_OK;
+		}
+	}
+	return Z_DATA_ERROR;
+}
+
+
+
+
@@ -3,12 +3,27 @@
 
 // Interfaces to the wrapping functions for compression and decompression using AString as their data
 
+#pragma once
+
 #include "zlib/zlib.h"  // Needed for the Z_XXX return values
 
 
 
 
 
+/** The codecs that the stored data can be compressed with.
+The values are the compression types written into the Anvil chunk headers, so that tools that don't know a codec can skip the chunk. */
+enum eCompressionCodec
+{
+	ccGZip = 1,
+	ccZlib = 2,
+	ccNone = 3,
+} ;
+
+
+
+
+
 /// Compresses a_Data into a_Compressed using ZLIB; returns Z_XXX error constants same as zlib's compress2()
 extern int CompressString(const char * a_Data, size_t a_Length, AString & a_Compressed, int a_Factor);
 
@@ -24,4 +39,20 @@ extern int UncompressStringGZIP(const char * a_Data, size_t a_Length, AString &
 /** Uncompresses a_Data into a_Uncompressed using Inflate; returns Z_OK for success or Z_XXX error constants same as zlib */
 extern int InflateString(const char * a_Data, size_t a_Length, AString & a_Uncompressed);
 
+/** Parses the codec name ("gzip", "zlib" or "none", case-insensitive) into a_Codec; returns false and leaves a_Codec untouched if not recognized */
+extern bool StringToCompressionCodec(const AString & a_Name, eCompressionCodec & a_Codec);
+
+/** Returns the name of the codec, as recognized by StringToCompressionCodec() */
+extern AString CompressionCodecToString(eCompressionCodec a_Codec);
+
+/** Compresses a_Data into a_Compressed using the specified codec; a_Level is the compression level for the codecs that have one.
+Returns Z_OK for success or Z_XXX error constants same as zlib */
+extern int CompressStringWithCodec(eCompressionCodec a_Codec, const char * a_Data, size_t a_Length, AString & a_Compressed, int a_Level);
+
+/** Uncompresses a_Data, compressed using the specified codec, into a_Uncompressed.
+Returns Z_OK for success or Z_XXX error constants same as zlib; Z_DATA_ERROR for an unknown codec */
+extern int UncompressStringWithCodec(eCompressionCodec a_Codec, const char * a_Data, size_t a_Length, AString & a_Uncompressed);
+
+
+
 
@@ -0,0 +1,114 @@
+
+// SwapRemoveVector.h
+
+// Declares the cSwapRemoveVector class template representing an unordered vector of pointers with O(1) removal
+
+/*
+The items are kept contiguous, so that the frequent walks over them don't chase pointers. An item is removed
+by moving the last one into its place, so the order of the items is not kept.
+ForEach() calls a callback for each item and lets the callback add and remove any items, including the items
+other than the current one - a plain index walk would skip the last item whenever the callback removes an item
+that has already been visited, because the last item is moved into the visited part.
+
+The class is implemented as a template, so that it can hold any type. Therefore, there is no cpp file.
+*/
+
+
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+
+
+
+
+template <class T>
+class cSwapRemoveVector
+{
+public:
+	typedef typename std::vector<T *>::iterator iterator;
+	typedef typename std::vector<T *>::const_iterator const_iterator;
+
+
+	cSwapRemoveVector(void) :
+		m_NumRemovals(0)
+	{
+	}
+
+	iterator begin(void) { return m_Items.begin(); }
+	iterator end(void) { return m_Items.end(); }
+	const_iterator begin(void) const { return m_Items.begin(); }
+	const_iterator end(void) const { return m_Items.end(); }
+
+	size_t size(void) const { return m_Items.size(); }
+	bool empty(void) const { return m_Items.empty(); }
+
+	T * operator [] (size_t a_Idx) const { return m_Items[a_Idx]; }
+
+	void push_back(T * a_Item) { m_Items.push_back(a_Item); }
+
+	/** Removes the item at the specified index, by moving the last item into its place. */
+	void EraseAt(size_t a_Idx)
+	{
+		ASSERT(a_Idx < m_Items.size());
+		m_Items[a_Idx] = m_Items.back();
+		m_Items.pop_back();
+		m_NumRemovals += 1;
+	}
+
+	/** Removes the specified item, if present. Returns true if it was found. */
+	bool Remove(T * a_Item)
+	{
+		iterator itr = std::find(m_Items.begin(), m_Items.end(), a_Item);
+		if (itr == m_Items.end())
+		{
+			return false;
+		}
+		EraseAt(static_cast<size_t>(itr - m_Items.begin()));
+		return true;
+	}
+
+	/** Returns true if the specified item is in the vector. */
+	bool Contains(const T * a_Item) const
+	{
+		return (std::find(m_Items.begin(), m_Items.end(), a_Item) != m_Items.end());
+	}
+
+	/** Calls a_Callback(T *) for each item in the vector, until it returns true.
+	Returns false if the callback has aborted the enumeration, true otherwise.
+	The callback may add and remove any items. The items removed before their turn are not passed to the callback,
+	neither are the items added during the enumeration. */
+	template <class Callback>
+	bool ForEach(Callback a_Callback)
+	{
+		// Walk a snapshot of the items; once anything has been removed, check that each item is still present before its turn:
+		std::vector<T *> Snapshot(m_Items);
+		size_t NumRemovals = m_NumRemovals;
+		for (typename std::vector<T *>::const_iterator itr = Snapshot.begin(), end = Snapshot.end(); itr != end; ++itr)
+		{
+			if ((m_NumRemovals != NumRemovals) && !Contains(*itr))
+			{
+				continue;
+			}
+			if (a_Callback(*itr))
+			{
+				return false;
+			}
+		}  // for itr - Snapshot[]
+		return true;
+	}
+
+protected:
+	std::vector<T *> m_Items;
+
+	/** Incremented whenever an item is removed, so that ForEach() can tell when its snapshot may contain removed items. */
+	size_t m_NumRemovals;
+} ;
+
+
+
+
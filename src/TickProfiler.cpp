@@ -0,0 +1,256 @@
+
+// TickProfiler.cpp
+
+// Implements the cTickProfiler class that measures the time spent in the individual phases of a world's tick
+
+#include "Globals.h"
+#include "TickProfiler.h"
+
+
+
+
+
+/** Returns the displayed name of the phase of the specified category and name. */
+static AString GetPhaseDisplayName(cTickProfiler::eCategory a_Category, const char * a_Name)
+{
+	switch (a_Category)
+	{
+		case cTickProfiler::catWorld:     return a_Name;
+		case cTickProfiler::catSimulator: return Printf("Simulator %s", a_Name);
+		case cTickProfiler::catEntity:    return Printf("Entities %s", a_Name);
+	}
+	return a_Name;
+}
+
+
+
+
+
+cTickProfiler::cTickProfiler(void) :
+	m_NextSample(0),
+	m_NumSamples(0)
+{
+}
+
+
+
+
+
+size_t cTickProfiler::GetPhase(eCategory a_Category, const char * a_Name)
+{
+	auto Key = std::make_pair(static_cast<int>(a_Category), a_Name);
+	auto itr = m_PhaseIndices.find(Key);
+	if (itr != m_PhaseIndices.end())
+	{
+		return itr->second;
+	}
+
+	// A new phase, register it:
+	size_t Idx;
+	{
+		cCSLock Lock(m_CS);
+		Idx = m_Phases.size();
+		m_Phases.emplace_back(a_Category, a_Name);
+	}
+	m_PhaseIndices[Key] = Idx;
+	m_CurrentTick.push_back(std::chrono::steady_clock::duration::zero());
+	m_CurrentTickAllocations.push_back(cAllocationCounter::sCounts());
+	return Idx;
+}
+
+
+
+
+
+void cTickProfiler::EndTick(void)
+{
+	cCSLock Lock(m_CS);
+	size_t NumPhases = m_CurrentTick.size();
+	for (size_t i = 0; i < NumPhases; i++)
+	{
+		auto Microsec = std::chrono::duration_cast<std::chrono::microseconds>(m_CurrentTick[i]).count();
+		m_Phases[i].m_Samples[m_NextSample] = static_cast<UInt32>(Clamp<Int64>(Microsec, 0, 0xffffffff));
+		m_CurrentTick[i] = std::chrono::steady_clock::duration::zero();
+		if (cAllocationCounter::IsEnabled())
+		{
+			const auto & Allocations = m_CurrentTickAllocations[i];
+			m_Phases[i].m_AllocationSamples[m_NextSample] = static_cast<UInt32>(std::min<UInt64>(Allocations.m_NumAllocations, 0xffffffff));
+			m_Phases[i].m_AllocationBytesSamples[m_NextSample] = static_cast<UInt32>(std::min<UInt64>(Allocations.m_NumBytes, 0xffffffff));
+			m_CurrentTickAllocations[i] = cAllocationCounter::sCounts();
+		}
+	}
+	m_NextSample = (m_NextSample + 1) % NUM_TICKS;
+	m_NumSamples = std::min(m_NumSamples + 1, NUM_TICKS);
+}
+
+
+
+
+
+void cTickProfiler::GetReport(AStringVector & a_Lines)
+{
+	/** The computed stats of a single phase, in microseconds. */
+	struct sPhaseStats
+	{
+		AString m_Name;
+		int m_Category;
+		double m_Mean;
+		UInt32 m_P50, m_P95, m_P99, m_Max;
+	} ;
+	std::vector<sPhaseStats> Stats;
+	size_t NumSamples;
+	{
+		cCSLock Lock(m_CS);
+		NumSamples = m_NumSamples;
+		if (NumSamples == 0)
+		{
+			a_Lines.push_back("  No ticks measured yet");
+			return;
+		}
+		std::vector<UInt32> Samples;
+		for (const auto & Phase: m_Phases)
+		{
+			// The valid samples are the first NumSamples ones until the ring buffer wraps around, then all of them:
+			Samples.assign(Phase.m_Samples.begin(), Phase.m_Samples.begin() + static_cast<std::ptrdiff_t>(NumSamples));
+			sPhaseStats PhaseStats;
+			PhaseStats.m_Name = GetPhaseDisplayName(Phase.m_Category, Phase.m_Name);
+			PhaseStats.m_Category = Phase.m_Category;
+			UInt64 Sum = 0;
+			for (auto Sample: Samples)
+			{
+				Sum += Sample;
+			}
+			PhaseStats.m_Mean = static_cast<double>(Sum) / NumSamples;
+			std::sort(Samples.begin(), Samples.end());
+			PhaseStats.m_P50 = Samples[NumSamples * 50 / 100];
+			PhaseStats.m_P95 = Samples[NumSamples * 95 / 100];
+			PhaseStats.m_P99 = Samples[NumSamples * 99 / 100];
+			PhaseStats.m_Max = Samples.back();
+			Stats.push_back(PhaseStats);
+		}
+	}
+
+	// Sort by category, then by the mean time, descending:
+	std::stable_sort(Stats.begin(), Stats.end(), [](const sPhaseStats & a_First, const sPhaseStats & a_Second)
+		{
+			if (a_First.m_Category != a_Second.m_Category)
+			{
+				return (a_First.m_Category < a_Second.m_Category);
+			}
+			return (a_First.m_Mean > a_Second.m_Mean);
+		}
+	);
+
+	a_Lines.push_back(Printf("  Over the last " SIZE_T_FMT " ticks, in msec per tick:", NumSamples));
+	a_Lines.push_back(Printf("  %-32s %8s %8s %8s %8s %8s", "Phase", "mean", "p50", "p95", "p99", "max"));
+	for (const auto & PhaseStats: Stats)
+	{
+		a_Lines.push_back(Printf("  %-32s %8.3f %8.3f %8.3f %8.3f %8.3f",
+			PhaseStats.m_Name.c_str(), PhaseStats.m_Mean / 1000,
+			static_cast<double>(PhaseStats.m_P50) / 1000, static_cast<double>(PhaseStats.m_P95) / 1000,
+			static_cast<double>(PhaseStats.m_P99) / 1000, static_cast<double>(PhaseStats.m_Max) / 1000
+		));
+	}
+}
+
+
+
+
+
+void cTickProfiler::GetAllocationReport(AStringVector & a_Lines)
+{
+	if (!cAllocationCounter::IsEnabled())
+	{
+		return;
+	}
+
+	/** The computed allocation stats of a single phase, per tick. */
+	struct sPhaseStats
+	{
+		AString m_Name;
+		int m_Category;
+		double m_MeanCount, m_MeanBytes;
+		UInt32 m_P99Count, m_MaxCount, m_P99Bytes, m_MaxBytes;
+	} ;
+	std::vector<sPhaseStats> Stats;
+	size_t NumSamples;
+	{
+		cCSLock Lock(m_CS);
+		NumSamples = m_NumSamples;
+		if (NumSamples == 0)
+		{
+			return;
+		}
+		std::vector<UInt32> Counts, Bytes;
+		for (const auto & Phase: m_Phases)
+		{
+			Counts.assign(Phase.m_AllocationSamples.begin(), Phase.m_AllocationSamples.begin() + static_cast<std::ptrdiff_t>(NumSamples));
+			Bytes.assign(Phase.m_AllocationBytesSamples.begin(), Phase.m_AllocationBytesSamples.begin() + static_cast<std::ptrdiff_t>(NumSamples));
+			UInt64 SumCount = 0, SumBytes = 0;
+			for (size_t i = 0; i < NumSamples; i++)
+			{
+				SumCount += Counts[i];
+				SumBytes += Bytes[i];
+			}
+			if (SumCount == 0)
+			{
+				// No allocations in this phase, don't clutter the report
+				continue;
+			}
+			sPhaseStats PhaseStats;
+			PhaseStats.m_Name = GetPhaseDisplayName(Phase.m_Category, Phase.m_Name);
+			PhaseStats.m_Category = Phase.m_Category;
+			PhaseStats.m_MeanCount = static_cast<double>(SumCount) / NumSamples;
+			PhaseStats.m_MeanBytes = static_cast<double>(SumBytes) / NumSamples;
+			std::sort(Counts.begin(), Counts.end());
+			std::sort(Bytes.begin(), Bytes.end());
+			PhaseStats.m_P99Count = Counts[NumSamples * 99 / 100];
+			PhaseStats.m_MaxCount = Counts.back();
+			PhaseStats.m_P99Bytes = Bytes[NumSamples * 99 / 100];
+			PhaseStats.m_MaxBytes = Bytes.back();
+			Stats.push_back(PhaseStats);
+		}
+	}
+
+	// Sort by category, then by the mean allocation count, descending:
+	std::stable_sort(Stats.begin(), Stats.end(), [](const sPhaseStats & a_First, const sPhaseStats & a_Second)
+		{
+			if (a_First.m_Category != a_Second.m_Category)
+			{
+				return (a_First.m_Category < a_Second.m_Category);
+			}
+			return (a_First.m_MeanCount > a_Second.m_MeanCount);
+		}
+	);
+
+	a_Lines.push_back(Printf("  Heap allocations by the tick thread over the last " SIZE_T_FMT " ticks, per tick:", NumSamples));
+	a_Lines.push_back(Printf("  %-32s %10s %10s %10s %10s %10s %10s", "Phase", "mean #", "p99 #", "max #", "mean KiB", "p99 KiB", "max KiB"));
+	for (const auto & PhaseStats: Stats)
+	{
+		a_Lines.push_back(Printf("  %-32s %10.1f %10u %10u %10.1f %10.1f %10.1f",
+			PhaseStats.m_Name.c_str(), PhaseStats.m_MeanCount, PhaseStats.m_P99Count, PhaseStats.m_MaxCount,
+			PhaseStats.m_MeanBytes / 1024, static_cast<double>(PhaseStats.m_P99Bytes) / 1024, static_cast<double>(PhaseStats.m_MaxBytes) / 1024
+		));
+	}
+}
+
+
+
+
+
+void cTickProfiler::Reset(void)
+{
+	cCSLock Lock(m_CS);
+	for (auto & Phase: m_Phases)
+	{
+		std::fill(Phase.m_Samples.begin(), Phase.m_Samples.end(), 0);
+		std::fill(Phase.m_AllocationSamples.begin(), Phase.m_AllocationSamples.end(), 0);
+		std::fill(Phase.m_AllocationBytesSamples.begin(), Phase.m_AllocationBytesSamples.end(), 0);
+	}
+	m_NextSample = 0;
+	m_NumSamples = 0;
+}
+
+
+
+
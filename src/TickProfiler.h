@@ -0,0 +1,151 @@
+
+// TickProfiler.h
+
+// Declares the cTickProfiler class that measures the time spent in the individual phases of a world's tick
+
+
+
+
+
+#pragma once
+
+#include "AllocationCounter.h"
+
+
+
+
+
+/** Measures the time that a world's tick spends in each of its phases, such as ticking the chunks, clients, simulators,
+and the entities of each class. The samples of the last NUM_TICKS ticks are kept for each phase, so that rolling
+percentiles can be reported.
+The time is accumulated in the world's tick thread without any locking; EndTick() then stores the tick's totals under
+a lock, once per tick. The report can be requested from any thread.
+The phases are identified by their category and a name with static storage duration (string literals, GetClass()),
+so that the lookup is only a pointer comparison.
+In the ALLOC_STATS builds, the heap allocations made by the tick thread in each phase are sampled the same way. */
+class cTickProfiler
+{
+public:
+	/** The number of ticks over which the percentiles are computed (1 minute). */
+	static const size_t NUM_TICKS = 1200;
+
+	/** The category of a phase, used mainly for displaying the phase's name. */
+	enum eCategory
+	{
+		catWorld,      ///< A phase of cWorld::Tick()
+		catSimulator,  ///< A simulator, both its Simulate() and SimulateChunk() calls
+		catEntity,     ///< Ticking the entities of a single class
+	} ;
+
+
+	/** Measures the time spent, and the allocations made, in a scope and adds them to the specified phase. */
+	class cTimer
+	{
+	public:
+		cTimer(cTickProfiler & a_Profiler, eCategory a_Category, const char * a_Name) :
+			m_Profiler(a_Profiler),
+			m_Phase(a_Profiler.GetPhase(a_Category, a_Name)),
+			m_StartAllocations(cAllocationCounter::GetThreadCounts()),
+			m_Start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~cTimer()
+		{
+			m_Profiler.AddTime(m_Phase, std::chrono::steady_clock::now() - m_Start);
+			if (cAllocationCounter::IsEnabled())
+			{
+				m_Profiler.AddAllocations(m_Phase, cAllocationCounter::GetThreadCounts() - m_StartAllocations);
+			}
+		}
+
+	protected:
+		cTickProfiler & m_Profiler;
+		size_t m_Phase;
+		cAllocationCounter::sCounts m_StartAllocations;
+		std::chrono::steady_clock::time_point m_Start;
+	} ;
+
+
+	cTickProfiler(void);
+
+	/** Returns the index of the specified phase, registering it on its first use. Tick thread only. */
+	size_t GetPhase(eCategory a_Category, const char * a_Name);
+
+	/** Adds the specified time to the phase in the current tick. Tick thread only. */
+	void AddTime(size_t a_Phase, std::chrono::steady_clock::duration a_Duration)
+	{
+		m_CurrentTick[a_Phase] += a_Duration;
+	}
+
+	/** Adds the specified allocation counts to the phase in the current tick. Tick thread only. */
+	void AddAllocations(size_t a_Phase, const cAllocationCounter::sCounts & a_Counts)
+	{
+		m_CurrentTickAllocations[a_Phase].m_NumAllocations += a_Counts.m_NumAllocations;
+		m_CurrentTickAllocations[a_Phase].m_NumBytes += a_Counts.m_NumBytes;
+	}
+
+	/** Stores the times accumulated in the current tick into the rolling samples and starts a new tick. Tick thread only. */
+	void EndTick(void);
+
+	/** Appends the human-readable report of the phases' rolling percentiles to a_Lines. Thread-safe. */
+	void GetReport(AStringVector & a_Lines);
+
+	/** Appends the human-readable report of the allocations made in the phases to a_Lines; nothing unless the allocations are counted.
+	Thread-safe. */
+	void GetAllocationReport(AStringVector & a_Lines);
+
+	/** Drops all the samples collected so far. Thread-safe. */
+	void Reset(void);
+
+protected:
+	/** A single phase and its samples. */
+	struct sPhase
+	{
+		eCategory m_Category;
+		const char * m_Name;
+
+		/** The time spent in the phase in each of the last NUM_TICKS ticks, in microseconds, as a ring buffer indexed by m_NextSample. */
+		std::vector<UInt32> m_Samples;
+
+		/** The number of allocations and their bytes in the phase in each of the last NUM_TICKS ticks, indexed the same as m_Samples.
+		Empty unless the allocations are counted. */
+		std::vector<UInt32> m_AllocationSamples;
+		std::vector<UInt32> m_AllocationBytesSamples;
+
+		sPhase(eCategory a_Category, const char * a_Name) :
+			m_Category(a_Category),
+			m_Name(a_Name),
+			m_Samples(NUM_TICKS, 0),
+			m_AllocationSamples(cAllocationCounter::IsEnabled() ? NUM_TICKS : 0, 0),
+			m_AllocationBytesSamples(cAllocationCounter::IsEnabled() ? NUM_TICKS : 0, 0)
+		{
+		}
+	} ;
+
+
+	/** Protects m_Phases, m_NextSample and m_NumSamples; written in EndTick() and read in GetReport(). */
+	cCriticalSection m_CS;
+
+	/** All the phases used so far. */
+	std::vector<sPhase> m_Phases;
+
+	/** The index in the phases' m_Samples where the next tick's sample is written. */
+	size_t m_NextSample;
+
+	/** The number of valid samples in the phases' m_Samples, up to NUM_TICKS. */
+	size_t m_NumSamples;
+
+	/** The time accumulated for each phase in the current tick. Tick thread only. */
+	std::vector<std::chrono::steady_clock::duration> m_CurrentTick;
+
+	/** The allocations counted for each phase in the current tick. Tick thread only. */
+	std::vector<cAllocationCounter::sCounts> m_CurrentTickAllocations;
+
+	/** Maps the phase identifiers to the indices in m_Phases. Tick thread only. */
+	std::map<std::pair<int, const char *>, size_t> m_PhaseIndices;
+} ;
+
+
+
+
@@ -0,0 +1,474 @@
+
+// TickRecorder.cpp
+
+// Implements the cTickRecorder class that records the client packets and the default world's ticks into a file,
+// and the cTickReplayer class that replays such a recording as fast as possible, measuring each tick
+
+#include "Globals.h"
+#include "TickRecorder.h"
+#include "ByteBuffer.h"
+#include "ClientHandle.h"
+#include "Root.h"
+#include "Server.h"
+
+
+
+
+
+/** The protocol version sent in the replayed handshakes; the recording is made at the cProtocol180 boundary. */
+static const UInt32 REPLAY_PROTOCOL_VERSION = 47;
+
+
+
+
+
+/** Appends the raw bytes of a_Value to a_Record. */
+template <typename T>
+static void AppendValue(AString & a_Record, T a_Value)
+{
+	a_Record.append(reinterpret_cast<const char *>(&a_Value), sizeof(a_Value));
+}
+
+
+
+
+
+/** Appends the UInt32 length of a_String and its contents to a_Record. */
+static void AppendString(AString & a_Record, const AString & a_String)
+{
+	AppendValue(a_Record, static_cast<UInt32>(a_String.size()));
+	a_Record.append(a_String);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cTickRecorder:
+
+const char cTickRecorder::FILE_MAGIC[8] = {'M', 'C', 'S', 'T', 'I', 'C', 'K', 'S'};
+
+
+
+
+
+cTickRecorder::cTickRecorder(void) :
+	m_IsRecording(false)
+{
+}
+
+
+
+
+
+bool cTickRecorder::Start(const AString & a_FileName)
+{
+	cCSLock Lock(m_CS);
+	if (m_File.IsOpen())
+	{
+		LOGWARNING("The ticks are already being recorded, ignoring the request to record into \"%s\".", a_FileName.c_str());
+		return false;
+	}
+	if (!m_File.Open(a_FileName, cFile::fmWrite))
+	{
+		LOGERROR("Cannot record the ticks, the file \"%s\" cannot be opened for writing.", a_FileName.c_str());
+		return false;
+	}
+	AString Header(FILE_MAGIC, sizeof(FILE_MAGIC));
+	AppendValue(Header, FILE_VERSION);
+	m_File.Write(Header.data(), Header.size());
+	m_IsRecording = true;
+	LOG("Recording the client packets and the ticks of the default world into \"%s\".", a_FileName.c_str());
+	return true;
+}
+
+
+
+
+
+void cTickRecorder::Stop(void)
+{
+	cCSLock Lock(m_CS);
+	if (!m_File.IsOpen())
+	{
+		return;
+	}
+	m_IsRecording = false;
+	m_File.Close();
+	LOG("The tick recording has been stopped.");
+}
+
+
+
+
+
+void cTickRecorder::RecordTick(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDuration, UInt32 a_TickRandSeed, UInt32 a_FastRandomCounter)
+{
+	AString Record;
+	AppendValue(Record, static_cast<UInt8>(rtTick));
+	AppendValue(Record, static_cast<Int64>(a_Dt.count()));
+	AppendValue(Record, static_cast<Int64>(a_LastTickDuration.count()));
+	AppendValue(Record, a_TickRandSeed);
+	AppendValue(Record, a_FastRandomCounter);
+	Write(Record);
+}
+
+
+
+
+
+void cTickRecorder::RecordConnect(int a_ClientID, const AString & a_ServerAddress, UInt16 a_ServerPort)
+{
+	AString Record;
+	AppendValue(Record, static_cast<UInt8>(rtConnect));
+	AppendValue(Record, static_cast<UInt32>(a_ClientID));
+	AppendValue(Record, a_ServerPort);
+	AppendString(Record, a_ServerAddress);
+	Write(Record);
+}
+
+
+
+
+
+void cTickRecorder::RecordPacket(int a_ClientID, UInt32 a_State, const AString & a_Packet)
+{
+	AString Record;
+	Record.reserve(a_Packet.size() + 10);
+	AppendValue(Record, static_cast<UInt8>(rtPacket));
+	AppendValue(Record, static_cast<UInt32>(a_ClientID));
+	AppendValue(Record, static_cast<UInt8>(a_State));
+	AppendString(Record, a_Packet);
+	Write(Record);
+}
+
+
+
+
+
+void cTickRecorder::RecordDisconnect(int a_ClientID)
+{
+	AString Record;
+	AppendValue(Record, static_cast<UInt8>(rtDisconnect));
+	AppendValue(Record, static_cast<UInt32>(a_ClientID));
+	Write(Record);
+}
+
+
+
+
+
+void cTickRecorder::Write(const AString & a_Record)
+{
+	cCSLock Lock(m_CS);
+	if (m_File.IsOpen())
+	{
+		m_File.Write(a_Record.data(), a_Record.size());
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cTickReplayer:
+
+cTickReplayer::cTickReplayer(void) :
+	m_Pos(0)
+{
+}
+
+
+
+
+
+cTickReplayer::~cTickReplayer()
+{
+	// The clients are owned by the server, which destroys them on its own
+}
+
+
+
+
+
+bool cTickReplayer::Load(const AString & a_FileName)
+{
+	m_FileName = a_FileName;
+	m_Data = cFile::ReadWholeFile(a_FileName);
+	m_Pos = 0;
+	char Magic[sizeof(cTickRecorder::FILE_MAGIC)];
+	UInt32 Version;
+	if (!Read(Magic, sizeof(Magic)) || (memcmp(Magic, cTickRecorder::FILE_MAGIC, sizeof(Magic)) != 0) || !Read(&Version, sizeof(Version)))
+	{
+		LOGERROR("Cannot replay the ticks, \"%s\" is not a tick recording.", a_FileName.c_str());
+		return false;
+	}
+	if (Version != cTickRecorder::FILE_VERSION)
+	{
+		LOGERROR("Cannot replay the ticks, the recording \"%s\" has an unsupported version %u.", a_FileName.c_str(), Version);
+		return false;
+	}
+	LOG("Replaying the ticks of the default world from \"%s\" (" SIZE_T_FMT " KiB).", a_FileName.c_str(), m_Data.size() / 1024);
+	return true;
+}
+
+
+
+
+
+bool cTickReplayer::ReplayUntilTick(sTick & a_Tick)
+{
+	for (;;)
+	{
+		UInt8 Type;
+		if (!Read(&Type, sizeof(Type)))
+		{
+			return false;
+		}
+		switch (Type)
+		{
+			case cTickRecorder::rtTick:
+			{
+				Int64 Dt, LastTickDuration;
+				if (
+					!Read(&Dt, sizeof(Dt)) ||
+					!Read(&LastTickDuration, sizeof(LastTickDuration)) ||
+					!Read(&a_Tick.m_TickRandSeed, sizeof(a_Tick.m_TickRandSeed)) ||
+					!Read(&a_Tick.m_FastRandomCounter, sizeof(a_Tick.m_FastRandomCounter))
+				)
+				{
+					break;
+				}
+				a_Tick.m_Dt = std::chrono::milliseconds(Dt);
+				a_Tick.m_LastTickDuration = std::chrono::milliseconds(LastTickDuration);
+				if (!m_ReplayedUSec.empty())
+				{
+					// This is the duration of the previous tick:
+					m_RecordedMSec.push_back(LastTickDuration);
+				}
+				return true;
+			}
+
+			case cTickRecorder::rtConnect:
+			{
+				UInt32 ClientID;
+				UInt16 ServerPort;
+				AString ServerAddress;
+				if (!Read(&ClientID, sizeof(ClientID)) || !Read(&ServerPort, sizeof(ServerPort)) || !ReadString(ServerAddress))
+				{
+					break;
+				}
+				ReplayConnect(ClientID, ServerAddress, ServerPort);
+				continue;
+			}
+
+			case cTickRecorder::rtPacket:
+			{
+				UInt32 ClientID;
+				UInt8 State;
+				AString Packet;
+				if (!Read(&ClientID, sizeof(ClientID)) || !Read(&State, sizeof(State)) || !ReadString(Packet))
+				{
+					break;
+				}
+				ReplayPacket(ClientID, State, Packet);
+				continue;
+			}
+
+			case cTickRecorder::rtDisconnect:
+			{
+				UInt32 ClientID;
+				if (!Read(&ClientID, sizeof(ClientID)))
+				{
+					break;
+				}
+				ReplayDisconnect(ClientID);
+				continue;
+			}
+		}  // switch (Type)
+
+		LOGWARNING("The tick recording \"%s\" is damaged at offset " SIZE_T_FMT " (record type %u), stopping the replay.",
+			m_FileName.c_str(), m_Pos, static_cast<unsigned>(Type)
+		);
+		return false;
+	}
+}
+
+
+
+
+
+void cTickReplayer::AddTickDuration(std::chrono::steady_clock::duration a_Duration)
+{
+	m_ReplayedUSec.push_back(std::chrono::duration_cast<std::chrono::microseconds>(a_Duration).count());
+}
+
+
+
+
+
+void cTickReplayer::Finish(void)
+{
+	for (auto itr = m_Clients.begin(), end = m_Clients.end(); itr != end; ++itr)
+	{
+		itr->second->OnRemoteClosed();
+	}
+	m_Clients.clear();
+
+	WriteTimings();
+
+	if (!m_ReplayedUSec.empty())
+	{
+		std::vector<Int64> Sorted(m_ReplayedUSec);
+		std::sort(Sorted.begin(), Sorted.end());
+		Int64 Total = 0;
+		for (auto Duration: Sorted)
+		{
+			Total += Duration;
+		}
+		LOG("Replayed " SIZE_T_FMT " ticks in %.3f sec: average %.3f ms, median %.3f ms, 99th percentile %.3f ms, max %.3f ms per tick.",
+			Sorted.size(), static_cast<double>(Total) / 1000000,
+			static_cast<double>(Total) / Sorted.size() / 1000,
+			static_cast<double>(Sorted[Sorted.size() / 2]) / 1000,
+			static_cast<double>(Sorted[(Sorted.size() - 1) * 99 / 100]) / 1000,
+			static_cast<double>(Sorted.back()) / 1000
+		);
+	}
+	cRoot::Get()->QueueExecuteConsoleCommand("stop");
+}
+
+
+
+
+
+bool cTickReplayer::Read(void * a_Dest, size_t a_Size)
+{
+	if (m_Data.size() - m_Pos < a_Size)
+	{
+		return false;
+	}
+	memcpy(a_Dest, m_Data.data() + m_Pos, a_Size);
+	m_Pos += a_Size;
+	return true;
+}
+
+
+
+
+
+bool cTickReplayer::ReadString(AString & a_String)
+{
+	UInt32 Length;
+	if (!Read(&Length, sizeof(Length)) || (m_Data.size() - m_Pos < Length))
+	{
+		return false;
+	}
+	a_String.assign(m_Data, m_Pos, Length);
+	m_Pos += Length;
+	return true;
+}
+
+
+
+
+
+void cTickReplayer::ReplayConnect(UInt32 a_ClientID, const AString & a_ServerAddress, UInt16 a_ServerPort)
+{
+	cClientHandlePtr Client = std::static_pointer_cast<cClientHandle>(cRoot::Get()->GetServer()->OnConnectionAccepted("replay"));
+	m_Clients[a_ClientID] = Client;
+
+	// Send the handshake that the protocol recognizer expects, switching to the login state:
+	cByteBuffer Handshake(a_ServerAddress.size() + 32);
+	Handshake.WriteVarInt32(0);  // Packet type: handshake
+	Handshake.WriteVarInt32(REPLAY_PROTOCOL_VERSION);
+	Handshake.WriteVarUTF8String(a_ServerAddress);
+	Handshake.WriteBEUInt16(a_ServerPort);
+	Handshake.WriteVarInt32(2);  // Next state: login
+	AString Packet;
+	Handshake.ReadAll(Packet);
+	ReplayPacket(a_ClientID, 0, Packet);
+}
+
+
+
+
+
+void cTickReplayer::ReplayPacket(UInt32 a_ClientID, UInt32 a_State, const AString & a_Packet)
+{
+	auto itr = m_Clients.find(a_ClientID);
+	if ((itr == m_Clients.end()) || a_Packet.empty())
+	{
+		// The client has connected before the recording started, there's nothing to replay it on
+		return;
+	}
+	if ((a_State == 2) && (a_Packet[0] == 0x01))
+	{
+		// Encryption response; the replay runs without authentication, so the server never asks for it:
+		return;
+	}
+
+	// Frame the packet; in the game state, the client sends the packets in the compressed format, uncompressed:
+	cByteBuffer Frame(a_Packet.size() + 11);
+	if (a_State == 3)
+	{
+		Frame.WriteVarInt32(static_cast<UInt32>(a_Packet.size() + 1));
+		Frame.WriteVarInt32(0);  // Uncompressed size 0: the packet is not compressed
+	}
+	else
+	{
+		Frame.WriteVarInt32(static_cast<UInt32>(a_Packet.size()));
+	}
+	Frame.WriteBuf(a_Packet.data(), a_Packet.size());
+	AString Data;
+	Frame.ReadAll(Data);
+	itr->second->OnReceivedData(Data.data(), Data.size());
+}
+
+
+
+
+
+void cTickReplayer::ReplayDisconnect(UInt32 a_ClientID)
+{
+	auto itr = m_Clients.find(a_ClientID);
+	if (itr == m_Clients.end())
+	{
+		return;
+	}
+	itr->second->OnRemoteClosed();
+	m_Clients.erase(itr);
+}
+
+
+
+
+
+void cTickReplayer::WriteTimings(void)
+{
+	AString FileName = m_FileName + ".csv";
+	cFile f;
+	if (!f.Open(FileName, cFile::fmWrite))
+	{
+		LOGWARNING("Cannot write the replayed tick timings into \"%s\".", FileName.c_str());
+		return;
+	}
+	f.Printf("Tick,RecordedMSec,ReplayedMSec\n");
+	for (size_t i = 0; i < m_ReplayedUSec.size(); i++)
+	{
+		if (i < m_RecordedMSec.size())
+		{
+			f.Printf(SIZE_T_FMT ",%lld,%.3f\n", i, static_cast<long long>(m_RecordedMSec[i]), static_cast<double>(m_ReplayedUSec[i]) / 1000);
+		}
+		else
+		{
+			f.Printf(SIZE_T_FMT ",,%.3f\n", i, static_cast<double>(m_ReplayedUSec[i]) / 1000);
+		}
+	}
+	LOG("The replayed tick timings have been written into \"%s\".", FileName.c_str());
+}
+
+
+
+
@@ -0,0 +1,174 @@
+
+// TickRecorder.h
+
+// Declares the cTickRecorder class that records the client packets and the default world's ticks into a file,
+// and the cTickReplayer class that replays such a recording as fast as possible, measuring each tick
+
+
+
+
+
+#pragma once
+
+#include "OSSupport/File.h"
+#include <atomic>
+
+
+
+
+
+// fwd:
+class cClientHandle;
+typedef SharedPtr<cClientHandle> cClientHandlePtr;
+
+
+
+
+
+/** Records everything that the default world's ticks depend on, so that a laggy moment can be replayed later:
+the packets received from the clients (as handed over by cProtocol180, decrypted and decompressed), the connects and
+disconnects, and for each tick its timing and the seeds of the tick thread's random generators.
+The packets are received in the network threads and the ticks in the world's tick thread, so all the records are written
+under a lock. The recording is enabled by starting the server with "/recordticks <file>".
+The file uses the host's byte order; it is meant to be replayed on the same machine or a similar one. */
+class cTickRecorder
+{
+public:
+	/** The types of the records in the file. */
+	enum eRecordType
+	{
+		rtTick       = 1,  ///< Int64 Dt, Int64 LastTickDuration (msec), UInt32 TickRandSeed, UInt32 FastRandomCounter
+		rtConnect    = 2,  ///< UInt32 ClientID, UInt16 ServerPort, UInt32 Length, the server address
+		rtPacket     = 3,  ///< UInt32 ClientID, UInt8 ProtocolState, UInt32 Length, the packet (including the packet type)
+		rtDisconnect = 4,  ///< UInt32 ClientID
+	} ;
+
+	/** The magic at the start of the file, followed by the UInt32 version. */
+	static const char FILE_MAGIC[8];
+	static const UInt32 FILE_VERSION = 1;
+
+
+	cTickRecorder(void);
+
+	/** Starts recording into the specified file. Returns false and logs the reason if the file cannot be created. */
+	bool Start(const AString & a_FileName);
+
+	/** Stops the recording and closes the file. */
+	void Stop(void);
+
+	/** Returns true if the recording is active. The result may be stale by the time the caller acts on it,
+	the Record*() functions check again under the lock. */
+	bool IsRecording(void) const { return m_IsRecording; }
+
+	/** Records a tick of the default world, with a_TickRandSeed being the seed that the tick's m_TickRand is reseeded with.
+	Called from the default world's tick thread, before the tick is performed. */
+	void RecordTick(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDuration, UInt32 a_TickRandSeed, UInt32 a_FastRandomCounter);
+
+	/** Records a new connection that has switched to the login state. */
+	void RecordConnect(int a_ClientID, const AString & a_ServerAddress, UInt16 a_ServerPort);
+
+	/** Records a single received packet, a_Packet starting with the packet type. */
+	void RecordPacket(int a_ClientID, UInt32 a_State, const AString & a_Packet);
+
+	/** Records the client closing its connection. */
+	void RecordDisconnect(int a_ClientID);
+
+protected:
+	/** Protects m_File. */
+	cCriticalSection m_CS;
+
+	cFile m_File;
+
+	/** Set while the recording is active, so that the hooks can skip building the records when not recording. */
+	std::atomic<bool> m_IsRecording;
+
+
+	/** Writes the record into the file, if still recording. */
+	void Write(const AString & a_Record);
+} ;
+
+
+
+
+
+/** Replays a recording made by cTickRecorder against the current world data. The default world's tick thread calls
+ReplayUntilTick() instead of sleeping between the ticks, so the ticks follow each other as fast as possible; the recorded
+packets are fed to fake clients (cClientHandles without a network link) before the tick in which they were received.
+The logins are processed by the server thread as usual, so a player may join a few ticks off from the recording; the order
+of each client's packets is kept, though.
+The duration of each replayed tick is measured and written, together with the recorded one, into a "<file>.csv" when
+the replay finishes. The server is then stopped.
+The authentication is turned off in the replay mode, the recorded encryption responses are dropped. For the replay
+to match the recording, the world data should be a copy of the one the recording started on, and nobody else should
+connect to the server. The other worlds keep ticking in real time and are not replayed. */
+class cTickReplayer
+{
+public:
+	/** A single recorded tick. */
+	struct sTick
+	{
+		std::chrono::milliseconds m_Dt;
+		std::chrono::milliseconds m_LastTickDuration;
+		UInt32 m_TickRandSeed;
+		UInt32 m_FastRandomCounter;
+	} ;
+
+
+	cTickReplayer(void);
+	~cTickReplayer();
+
+	/** Reads the recording from the file. Returns false and logs the reason if the file is not a valid recording. */
+	bool Load(const AString & a_FileName);
+
+	/** Feeds the packets recorded before the next tick to the clients and returns the tick in a_Tick.
+	Returns false when the end of the recording is reached. Called from the default world's tick thread. */
+	bool ReplayUntilTick(sTick & a_Tick);
+
+	/** Stores the measured duration of the tick last returned by ReplayUntilTick(). */
+	void AddTickDuration(std::chrono::steady_clock::duration a_Duration);
+
+	/** Disconnects the remaining clients, writes the timings, logs the summary and queues the server stop. */
+	void Finish(void);
+
+protected:
+	AString m_FileName;
+
+	/** The whole recording, read by Load(). */
+	AString m_Data;
+
+	/** The position of the next record in m_Data. */
+	size_t m_Pos;
+
+	/** The replayed clients, mapped by their recorded IDs. */
+	std::map<UInt32, cClientHandlePtr> m_Clients;
+
+	/** The duration of each replayed tick, in microseconds. */
+	std::vector<Int64> m_ReplayedUSec;
+
+	/** The duration of each recorded tick, in milliseconds; the recording only stores it with the following tick, so
+	the last tick's duration is not known. */
+	std::vector<Int64> m_RecordedMSec;
+
+
+	/** Reads a_Size bytes from m_Data into a_Dest. Returns false if there's not enough data left. */
+	bool Read(void * a_Dest, size_t a_Size);
+
+	/** Reads a UInt32-length-prefixed string from m_Data. Returns false if there's not enough data left. */
+	bool ReadString(AString & a_String);
+
+	/** Creates a new fake client and sends it the handshake packet that made the recorded connection switch to the login state. */
+	void ReplayConnect(UInt32 a_ClientID, const AString & a_ServerAddress, UInt16 a_ServerPort);
+
+	/** Sends the packet to the client, framed the same way the client has sent it. */
+	void ReplayPacket(UInt32 a_ClientID, UInt32 a_State, const AString & a_Packet);
+
+	/** Closes the client's fake connection. */
+	void ReplayDisconnect(UInt32 a_ClientID);
+
+	/** Writes the per-tick timings into the CSV file next to the recording. */
+	void WriteTimings(void);
+} ;
+
+
+
+
@@ -560,6 +560,7 @@ void cSlotAreaCrafting::OnPlayerRemoved(cPlayer & a_Player)
 	TossItems(a_Player, 1, m_NumSlots);
 	
 	// Remove the current recipe from the player -> recipe map:
+	m_MatchedGrids.erase(a_Player.GetUniqueID());
 	for (cRecipeMap::iterator itr = m_Recipes.begin(), end = m_Recipes.end(); itr != end; ++itr)
 	{
 		if (itr->first == a_Player.GetUniqueID())
@@ -715,9 +716,28 @@ void cSlotAreaCrafting::DropClickedResult(cPlayer & a_Player)
 
 void cSlotAreaCrafting::UpdateRecipe(cPlayer & a_Player)
 {
-	cCraftingGrid   Grid(GetPlayerSlots(a_Player) + 1, m_GridSize, m_GridSize);
+	cItem * GridSlots = GetPlayerSlots(a_Player) + 1;
+	size_t NumGridSlots = static_cast<size_t>(m_GridSize * m_GridSize);
 	cCraftingRecipe & Recipe = GetRecipeForPlayer(a_Player);
-	cRoot::Get()->GetCraftingRecipes()->GetRecipe(a_Player, Grid, Recipe);
+
+	// Only match the recipe again if the grid has changed since the last match (most clicks don't touch the grid):
+	cItems & MatchedGrid = m_MatchedGrids[a_Player.GetUniqueID()];
+	bool HasGridChanged = (MatchedGrid.size() != NumGridSlots);
+	for (size_t i = 0; !HasGridChanged && (i < NumGridSlots); i++)
+	{
+		const cItem & Slot = GridSlots[i];
+		const cItem & Matched = MatchedGrid[i];
+		HasGridChanged = !(
+			(Slot.IsEmpty() && Matched.IsEmpty()) ||
+			(Slot.IsEqual(Matched) && (Slot.m_ItemCount == Matched.m_ItemCount))
+		);
+	}
+	if (HasGridChanged)
+	{
+		cCraftingGrid Grid(GridSlots, m_GridSize, m_GridSize);
+		cRoot::Get()->GetCraftingRecipes()->GetRecipe(a_Player, Grid, Recipe);
+		MatchedGrid.assign(GridSlots, GridSlots + NumGridSlots);
+	}
 	SetSlot(0, a_Player, Recipe.GetResult());
 	m_ParentWindow.SendSlot(a_Player, this, 0);
 }
@@ -1380,10 +1400,10 @@ void cSlotAreaBeacon::SetSlot(int a_SlotNum, cPlayer & a_Player, const cItem & a
 void cSlotAreaBeacon::OnSlotChanged(cItemGrid * a_ItemGrid, int a_SlotNum)
 {
 	UNUSED(a_SlotNum);
-	// Something has changed in the window, broadcast the entire window to all clients
+	// Something has changed in the window, queue the entire window to be sent to all clients
 	ASSERT(a_ItemGrid == &(m_Beacon->GetContents()));
 
-	m_ParentWindow.BroadcastWholeWindow();
+	m_ParentWindow.QueueBroadcastWholeWindow();
 }
 
 
@@ -1909,10 +1929,10 @@ void cSlotAreaFurnace::SetSlot(int a_SlotNum, cPlayer & a_Player, const cItem &
 void cSlotAreaFurnace::OnSlotChanged(cItemGrid * a_ItemGrid, int a_SlotNum)
 {
 	UNUSED(a_SlotNum);
-	// Something has changed in the window, broadcast the entire window to all clients
+	// Something has changed in the window, queue the entire window to be sent to all clients
 	ASSERT(a_ItemGrid == &(m_Furnace->GetContents()));
 
-	m_ParentWindow.BroadcastWholeWindow();
+	m_ParentWindow.QueueBroadcastWholeWindow();
 }
 
 
@@ -2210,7 +2230,7 @@ void cSlotAreaItemGrid::SetSlot(int a_SlotNum, cPlayer & a_Player, const cItem &
 void cSlotAreaItemGrid::OnSlotChanged(cItemGrid * a_ItemGrid, int a_SlotNum)
 {
 	ASSERT(a_ItemGrid == &m_ItemGrid);
-	m_ParentWindow.BroadcastSlot(this, a_SlotNum);
+	m_ParentWindow.QueueBroadcastSlot(this, a_SlotNum);
 }
 
 
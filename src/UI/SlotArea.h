@@ -255,6 +255,10 @@ protected:
 	int        m_GridSize;
 	cRecipeMap m_Recipes;
 	
+	/** Maps player's EntityID -> the crafting grid contents that the current recipe was matched against.
+	UpdateRecipe() only matches the recipe again when the grid has changed. */
+	std::map<UInt32, cItems> m_MatchedGrids;
+	
 	/** Handles a click in the result slot.
 	Crafts using the current recipe, if possible. */
 	void ClickedResult(cPlayer & a_Player);
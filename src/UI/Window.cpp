@@ -27,10 +27,25 @@ Byte cWindow::m_WindowIDCounter = 0;
 
 
 
+/** Returns true if the two slots would look the same to the client. */
+static bool AreSlotsEqual(const cItem & a_Slot1, const cItem & a_Slot2)
+{
+	if (a_Slot1.IsEmpty() || a_Slot2.IsEmpty())
+	{
+		return (a_Slot1.IsEmpty() && a_Slot2.IsEmpty());
+	}
+	return (a_Slot1.IsEqual(a_Slot2) && (a_Slot1.m_ItemCount == a_Slot2.m_ItemCount));
+}
+
+
+
+
+
 cWindow::cWindow(WindowType a_WindowType, const AString & a_WindowTitle) :
 	m_WindowID(static_cast<char>((++m_WindowIDCounter) % 127)),
 	m_WindowType(a_WindowType),
 	m_WindowTitle(a_WindowTitle),
+	m_IsWholeWindowPending(false),
 	m_IsDestroyed(false),
 	m_Owner(nullptr)
 {
@@ -209,6 +224,9 @@ void cWindow::Clicked(
 		return;
 	}
 
+	// The client has already applied the click to its own view, which may differ from ours:
+	ForgetSentSlots(a_Player);
+
 	switch (a_ClickAction)
 	{
 		case caLeftClickOutside:
@@ -290,6 +308,7 @@ void cWindow::OpenedByPlayer(cPlayer & a_Player)
 		m_OpenedBy.remove(&a_Player);
 		// Then add player
 		m_OpenedBy.push_back(&a_Player);
+		m_SentSlots.erase(&a_Player);
 		
 		for (cSlotAreas::iterator itr = m_SlotAreas.begin(), end = m_SlotAreas.end(); itr != end; ++itr)
 		{
@@ -328,6 +347,7 @@ bool cWindow::ClosedByPlayer(cPlayer & a_Player, bool a_CanRefuse)
 		}  // for itr - m_SlotAreas[]
 
 		m_OpenedBy.remove(&a_Player);
+		m_SentSlots.erase(&a_Player);
 		
 		if ((m_WindowType != wtInventory) && m_OpenedBy.empty())
 		{
@@ -483,9 +503,14 @@ void cWindow::SendSlot(cPlayer & a_Player, cSlotArea * a_SlotArea, int a_Relativ
 		return;
 	}
 	
-	a_Player.GetClientHandle()->SendInventorySlot(
-		m_WindowID, a_RelativeSlotNum + SlotBase, *(a_SlotArea->GetSlot(a_RelativeSlotNum, a_Player))
-	);
+	const cItem & Slot = *(a_SlotArea->GetSlot(a_RelativeSlotNum, a_Player));
+	cCSLock Lock(m_CS);
+	a_Player.GetClientHandle()->SendInventorySlot(m_WindowID, a_RelativeSlotNum + SlotBase, Slot);
+	auto itrSent = m_SentSlots.find(&a_Player);
+	if ((itrSent != m_SentSlots.end()) && (static_cast<size_t>(a_RelativeSlotNum + SlotBase) < itrSent->second.size()))
+	{
+		itrSent->second[static_cast<size_t>(a_RelativeSlotNum + SlotBase)] = Slot;
+	}
 }
 
 
@@ -711,7 +736,13 @@ void cWindow::BroadcastSlot(cSlotArea * a_Area, int a_LocalSlotNum)
 	cCSLock Lock(m_CS);
 	for (cPlayerList::iterator itr = m_OpenedBy.begin(); itr != m_OpenedBy.end(); ++itr)
 	{
-		(*itr)->GetClientHandle()->SendInventorySlot(m_WindowID, SlotNum, *a_Area->GetSlot(a_LocalSlotNum, **itr));
+		const cItem & Slot = *a_Area->GetSlot(a_LocalSlotNum, **itr);
+		(*itr)->GetClientHandle()->SendInventorySlot(m_WindowID, SlotNum, Slot);
+		auto itrSent = m_SentSlots.find(*itr);
+		if ((itrSent != m_SentSlots.end()) && (static_cast<size_t>(SlotNum) < itrSent->second.size()))
+		{
+			itrSent->second[static_cast<size_t>(SlotNum)] = Slot;
+		}
 	}  // for itr - m_OpenedBy[]
 }
 
@@ -719,9 +750,77 @@ void cWindow::BroadcastSlot(cSlotArea * a_Area, int a_LocalSlotNum)
 
 
 
+void cWindow::QueueBroadcastSlot(cSlotArea * a_Area, int a_LocalSlotNum)
+{
+	cCSLock Lock(m_CS);
+	if (m_OpenedBy.empty() || m_IsWholeWindowPending)
+	{
+		// Nobody to send to, or the slot will be sent with the whole window anyway
+		return;
+	}
+	std::pair<cSlotArea *, int> Slot(a_Area, a_LocalSlotNum);
+	if (std::find(m_PendingSlots.begin(), m_PendingSlots.end(), Slot) != m_PendingSlots.end())
+	{
+		return;
+	}
+	if (!m_PendingSlots.empty())
+	{
+		// More than a single slot changed, send the whole window instead:
+		m_PendingSlots.clear();
+		m_IsWholeWindowPending = true;
+		return;
+	}
+	m_PendingSlots.push_back(Slot);
+}
+
+
+
+
+
+void cWindow::QueueBroadcastWholeWindow(void)
+{
+	cCSLock Lock(m_CS);
+	if (m_OpenedBy.empty())
+	{
+		return;
+	}
+	m_PendingSlots.clear();
+	m_IsWholeWindowPending = true;
+}
+
+
+
+
+
+void cWindow::SendPendingChanges(void)
+{
+	cCSLock Lock(m_CS);
+	if (m_IsWholeWindowPending)
+	{
+		m_IsWholeWindowPending = false;
+		BroadcastWholeWindow();
+	}
+	else if (!m_PendingSlots.empty())
+	{
+		std::pair<cSlotArea *, int> Slot = m_PendingSlots.front();
+		m_PendingSlots.clear();
+		BroadcastSlot(Slot.first, Slot.second);
+	}
+}
+
+
+
+
+
 void cWindow::SendWholeWindow(cClientHandle & a_Client)
 {
+	cCSLock Lock(m_CS);
 	a_Client.SendWholeInventory(*this);
+	cPlayer * Player = a_Client.GetPlayer();
+	if (Player != nullptr)
+	{
+		GetSlots(*Player, m_SentSlots[Player]);
+	}
 }
 
 
@@ -731,9 +830,40 @@ void cWindow::SendWholeWindow(cClientHandle & a_Client)
 void cWindow::BroadcastWholeWindow(void)
 {
 	cCSLock Lock(m_CS);
+	cItems Slots;
+	std::vector<size_t> Changed;
 	for (cPlayerList::iterator itr = m_OpenedBy.begin(); itr != m_OpenedBy.end(); ++itr)
 	{
-		SendWholeWindow(*(*itr)->GetClientHandle());
+		cClientHandle & Client = *(*itr)->GetClientHandle();
+		auto itrSent = m_SentSlots.find(*itr);
+		GetSlots(**itr, Slots);
+		if ((itrSent == m_SentSlots.end()) || (itrSent->second.size() != Slots.size()))
+		{
+			// We don't know what the client has, send everything:
+			SendWholeWindow(Client);
+			continue;
+		}
+
+		// Send only the slots that have changed since they were last sent; if that's more than half the window, send it whole:
+		cItems & Sent = itrSent->second;
+		Changed.clear();
+		for (size_t i = 0; i < Slots.size(); i++)
+		{
+			if (!AreSlotsEqual(Slots[i], Sent[i]))
+			{
+				Changed.push_back(i);
+			}
+		}
+		if (Changed.size() * 2 > Slots.size())
+		{
+			SendWholeWindow(Client);
+			continue;
+		}
+		for (auto SlotNum: Changed)
+		{
+			Client.SendInventorySlot(m_WindowID, static_cast<short>(SlotNum), Slots[SlotNum]);
+			Sent[SlotNum] = Slots[SlotNum];
+		}
 	}  // for itr - m_OpenedBy[]
 }
 
@@ -741,6 +871,16 @@ void cWindow::BroadcastWholeWindow(void)
 
 
 
+void cWindow::ForgetSentSlots(cPlayer & a_Player)
+{
+	cCSLock Lock(m_CS);
+	m_SentSlots.erase(&a_Player);
+}
+
+
+
+
+
 void cWindow::SetProperty(short a_Property, short a_Value)
 {
 	cCSLock Lock(m_CS);
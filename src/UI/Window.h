@@ -127,8 +127,24 @@ public:
 	/// Sends the contents of the whole window to the specified client
 	void SendWholeWindow(cClientHandle & a_Client);
 	
-	/// Sends the contents of the whole window to all clients of this window.
+	/** Sends the contents of the whole window to all clients of this window.
+	Each client only receives the slots that changed since they were last sent to it, or the whole window if too many have changed. */
 	void BroadcastWholeWindow(void);
+	
+	/** Forgets the slots last sent to the player, so that the next broadcast sends the whole window to them.
+	Called whenever the client's view may differ from what this window has sent, such as after the player's own clicks, which the client predicts. */
+	void ForgetSentSlots(cPlayer & a_Player);
+	
+	/** Queues the specified slot to be sent to all clients of this window by SendPendingChanges(); the slot is specified as local in an area.
+	Used for the changes that come from the contents themselves (hoppers, furnaces, plugins), which can change many slots in a single tick. */
+	void QueueBroadcastSlot(cSlotArea * a_Area, int a_LocalSlotNum);
+	
+	/** Queues the contents of the whole window to be sent to all clients of this window by SendPendingChanges(). */
+	void QueueBroadcastWholeWindow(void);
+	
+	/** Sends the changes queued since the last call to all clients of this window: a single changed slot is sent alone, more changes send the whole window.
+	Called by each viewing player's tick, so that each client receives at most one window update per tick. */
+	void SendPendingChanges(void);
 
 	// tolua_begin
 	
@@ -181,6 +197,15 @@ protected:
 	cCriticalSection m_CS;
 	cPlayerList      m_OpenedBy;
 	
+	/** The slots queued by QueueBroadcastSlot() and not sent yet, as the area and the area-local slot number. Protected by m_CS. */
+	std::vector<std::pair<cSlotArea *, int>> m_PendingSlots;
+	
+	/** Set if the whole window is to be sent by SendPendingChanges(). Protected by m_CS. */
+	bool m_IsWholeWindowPending;
+	
+	/** The slots last sent to each player by this window, used by BroadcastWholeWindow() to send only the changed slots. Protected by m_CS. */
+	std::map<const cPlayer *, cItems> m_SentSlots;
+	
 	bool m_IsDestroyed;
 	
 	cWindowOwner * m_Owner;
@@ -109,7 +109,7 @@ int cVoronoiMap::GetValueAt(
 				NearestSeedY = SeedY;
 				MinDist2 = MinDist;
 				MinDist = Dist;
-				res = m_Noise3.IntNoise2DInt(x + CellX - 2, y + CellY - 2);
+				res = m_SeedValue[x][y];
 			}
 			else if (Dist < MinDist2)
 			{
@@ -201,6 +201,7 @@ void cVoronoiMap::UpdateCell(int a_CellX, int a_CellZ)
 			int OffsetZ = (m_Noise2.IntNoise2DInt(NoiseBaseX + x, NoiseBaseZ + z) / 8) % m_JitterSize;
 			m_SeedX[x][z] = BaseX + OffsetX;
 			m_SeedZ[x][z] = (NoiseBaseZ + z) * m_CellSize + OddRowOffset + OffsetZ;
+			m_SeedValue[x][z] = m_Noise3.IntNoise2DInt(NoiseBaseX + x, NoiseBaseZ + z);
 		}  // for z
 	}  // for x
 	m_CurrentCellX = a_CellX;
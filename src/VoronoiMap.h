@@ -80,12 +80,15 @@ protected:
 	/** The seeds of cells around m_CurrentCellX, m_CurrentCellZ, X-coords */
 	int m_SeedX[5][5];
 
-	/** The seeds of cells around m_CurrentCellX, m_CurrentCellZ, X-coords */
+	/** The seeds of cells around m_CurrentCellX, m_CurrentCellZ, Z-coords */
 	int m_SeedZ[5][5];
+
+	/** The values of cells around m_CurrentCellX, m_CurrentCellZ, as returned by GetValueAt() */
+	int m_SeedValue[5][5];
 	
 	
 	/** Updates the cached cell seeds to match the specified cell. Noop if cell pos already matches.
-	Updates m_SeedX and m_SeedZ. */
+	Updates m_SeedX, m_SeedZ and m_SeedValue. */
 	void UpdateCell(int a_CellX, int a_CellZ);
 } ;
 
@@ -9,11 +9,14 @@
 
 #include "World.h"
 #include "Entities/Player.h"
+#include "ClientHandle.h"
+#include "ChunkSender.h"
 #include "Server.h"
 #include "Root.h"
 
 #include "HTTPServer/HTTPMessage.h"
 #include "HTTPServer/HTTPConnection.h"
+#include "StringCompression.h"
 
 
 
@@ -21,6 +24,66 @@
 
 static const char DEFAULT_WEBADMIN_PORTS[] = "8080";
 
+/** The largest static file that is kept in memory; larger files are read from the disk on each request. */
+static const int MAX_CACHED_STATIC_FILE_SIZE = 1024 * 1024;
+
+/** The maximum total size of the static files kept in memory. */
+static const size_t MAX_STATIC_FILES_CACHE_SIZE = 16 * 1024 * 1024;
+
+/** The size of the pieces in which the uploaded files are passed to the plugins. */
+static const size_t UPLOAD_PIECE_SIZE = 64 * 1024;
+
+
+
+
+
+/** Escapes the string for use as a label value in the Prometheus text format. */
+static AString EscapeMetricLabel(const AString & a_Value)
+{
+	AString res;
+	res.reserve(a_Value.size());
+	for (auto ch: a_Value)
+	{
+		switch (ch)
+		{
+			case '\\': res.append("\\\\"); break;
+			case '"':  res.append("\\\""); break;
+			case '\n': res.append("\\n"); break;
+			default:   res.push_back(ch); break;
+		}
+	}
+	return res;
+}
+
+
+
+
+
+/** Appends the HELP and TYPE lines introducing the specified metric. */
+static void AppendMetricHeader(AString & a_Out, const char * a_Name, const char * a_Type, const char * a_Help)
+{
+	AppendPrintf(a_Out, "# HELP %s %s\n# TYPE %s %s\n", a_Name, a_Help, a_Name, a_Type);
+}
+
+
+
+
+
+/** Appends the samples of a client's network stats histogram; a_Labels are the formatted labels identifying the client. */
+static void AppendClientHistogram(AString & a_Out, const char * a_Name, const AString & a_Labels, const cClientNetworkStats::sHistogram & a_Histogram)
+{
+	for (int i = 0; i < cClientNetworkStats::sHistogram::NUM_BUCKETS; i++)
+	{
+		AppendPrintf(a_Out, "%s_bucket{%s,le=\"%lld\"} %llu\n",
+			a_Name, a_Labels.c_str(), static_cast<long long>(cClientNetworkStats::sHistogram::GetBucketBound(i)),
+			static_cast<unsigned long long>(a_Histogram.m_BucketCounts[i])
+		);
+	}
+	AppendPrintf(a_Out, "%s_bucket{%s,le=\"+Inf\"} %llu\n", a_Name, a_Labels.c_str(), static_cast<unsigned long long>(a_Histogram.m_Count));
+	AppendPrintf(a_Out, "%s_sum{%s} %llu\n", a_Name, a_Labels.c_str(), static_cast<unsigned long long>(a_Histogram.m_TotalUSec));
+	AppendPrintf(a_Out, "%s_count{%s} %llu\n", a_Name, a_Labels.c_str(), static_cast<unsigned long long>(a_Histogram.m_Count));
+}
+
 
 
 
@@ -55,7 +118,11 @@ public:
 cWebAdmin::cWebAdmin(void) :
 	m_IsInitialized(false),
 	m_IsRunning(false),
-	m_TemplateScript("<webadmin_template>")
+	m_TemplateScript("<webadmin_template>"),
+	m_StaticFilesSize(0),
+	m_StaticFilesMaxAge(600),
+	m_IsMetricsEnabled(true),
+	m_MapTilesMaxAge(60)
 {
 }
 
@@ -142,6 +209,9 @@ bool cWebAdmin::Init(void)
 	// Read the ports to be used:
 	// Note that historically the ports were stored in the "Port" and "PortsIPv6" values
 	m_Ports = ReadUpgradeIniPorts(m_IniFile, "WebAdmin", "Ports", "Port", "PortsIPv6", DEFAULT_WEBADMIN_PORTS);
+	m_StaticFilesMaxAge = std::max(m_IniFile.GetValueSetI("WebAdmin", "StaticFilesMaxAge", 600), 0);
+	m_IsMetricsEnabled = m_IniFile.GetValueSetB("WebAdmin", "MetricsEnabled", true);
+	m_MapTilesMaxAge = std::max(m_IniFile.GetValueSetI("WebAdmin", "MapTilesMaxAge", 60), 0);
 
 	if (!m_HTTPServer.Initialize())
 	{
@@ -221,8 +291,7 @@ void cWebAdmin::HandleWebadminRequest(cHTTPConnection & a_Connection, cHTTPReque
 	}
 
 	// Check auth:
-	AString UserPassword = m_IniFile.GetValue("User:" + a_Request.GetAuthUsername(), "Password", "");
-	if ((UserPassword == "") || (a_Request.GetAuthPassword() != UserPassword))
+	if (!IsAuthorized(a_Request))
 	{
 		a_Connection.SendNeedAuth("MCServer WebAdmin - bad username or password");
 		return;
@@ -304,6 +373,7 @@ void cWebAdmin::HandleWebadminRequest(cHTTPConnection & a_Connection, cHTTPReque
 			Menu += "<li><a href='" + BaseURL + WebPlugin->GetWebTitle().c_str() + "/" + (*Names).second + "'>" + (*Names).first + "</a></li>";
 		}
 	}
+	Menu += "<li><a href='" + BaseURL + "chunkcosts'>Chunk tick costs</a></li>";
 
 	sWebAdminPage Page = GetPage(TemplateRequest.Request);
 	AString Content = Page.Content;
@@ -349,6 +419,414 @@ void cWebAdmin::HandleWebadminRequest(cHTTPConnection & a_Connection, cHTTPReque
 
 
 
+bool cWebAdmin::IsAuthorized(const cHTTPRequest & a_Request)
+{
+	if (!a_Request.HasAuth())
+	{
+		return false;
+	}
+	AString UserPassword = m_IniFile.GetValue("User:" + a_Request.GetAuthUsername(), "Password", "");
+	return ((UserPassword != "") && (a_Request.GetAuthPassword() == UserPassword));
+}
+
+
+
+
+
+void cWebAdmin::HandleMetricsRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request)
+{
+	if (!m_IsMetricsEnabled)
+	{
+		a_Connection.SendStatusAndReason(404, "Not Found");
+		return;
+	}
+	if (!IsAuthorized(a_Request))
+	{
+		a_Connection.SendNeedAuth("MCServer WebAdmin");
+		return;
+	}
+
+	cHTTPResponse Resp;
+	Resp.SetContentType("text/plain; version=0.0.4");
+	a_Connection.Send(Resp);
+	a_Connection.Send(GetMetrics());
+	a_Connection.FinishResponse();
+}
+
+
+
+
+
+void cWebAdmin::HandleMapTileRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request)
+{
+	if (!IsAuthorized(a_Request))
+	{
+		a_Connection.SendNeedAuth("MCServer WebAdmin");
+		return;
+	}
+
+	// Parse the "/maptiles/<world>/<x>/<z>.png" URL:
+	AStringVector Split = StringSplit(a_Request.GetBareURL().substr(10), "/");
+	int TileX, TileZ;
+	cWorld * World = nullptr;
+	if (
+		(Split.size() == 3) &&
+		(Split[2].size() > 4) &&
+		(Split[2].compare(Split[2].size() - 4, 4, ".png") == 0) &&
+		StringToInteger(Split[1], TileX) &&
+		StringToInteger(Split[2].substr(0, Split[2].size() - 4), TileZ)
+	)
+	{
+		World = cRoot::Get()->GetWorld(URLDecode(Split[0]));
+	}
+	AString PNG, ETag;
+	if ((World == nullptr) || !World->GetMapTiles().GetTilePNG(TileX, TileZ, PNG, ETag))
+	{
+		a_Connection.SendStatusAndReason(404, "Not Found");
+		return;
+	}
+
+	// The tiles change as the chunks get saved, so they are only cached for a short while and then revalidated:
+	AString CacheControl = Printf("private, max-age=%d", m_MapTilesMaxAge);
+	AString IfNoneMatch = a_Request.GetHeader("If-None-Match");
+	if (!IfNoneMatch.empty() && ((IfNoneMatch == "*") || (IfNoneMatch.find(ETag) != AString::npos)))
+	{
+		a_Connection.SendNotModified(ETag, CacheControl);
+		return;
+	}
+
+	cHTTPResponse Resp;
+	Resp.SetContentType("image/png");
+	Resp.AddHeader("ETag", ETag);
+	Resp.AddHeader("Cache-Control", CacheControl);
+	a_Connection.Send(Resp);
+	a_Connection.Send(PNG);
+	a_Connection.FinishResponse();
+}
+
+
+
+
+
+AString cWebAdmin::GetMetrics(void)
+{
+	/** The metrics of a single world; collected first, so that each metric's samples can be output together. */
+	struct sWorldMetrics
+	{
+		AString m_Name;
+		cWorld::sTickDurationStats m_TickStats;
+		int m_NumValid, m_NumDirty, m_NumInLighting;
+		size_t m_GeneratorQueue, m_LightingQueue, m_LoadQueue, m_SaveQueue;
+		size_t m_SectionsAllocated, m_SectionsFree, m_SectionsReserveInUse;
+		int m_NumEntities;
+		cWorld::sMemoryStats m_Memory;
+	} ;
+
+	/** The metrics of a single connected player. */
+	struct sClientMetrics
+	{
+		AString m_Name;
+		AString m_WorldName;
+		size_t m_OutgoingDataSize;
+		size_t m_ChunkQueueDepth;
+		int m_Ping;
+		cClientNetworkStats::sStats m_NetworkStats;
+	} ;
+
+	class cWorldCallback :
+		public cWorldListCallback
+	{
+	public:
+		std::vector<sWorldMetrics> m_Worlds;
+		std::vector<sClientMetrics> m_Clients;
+
+	protected:
+		virtual bool Item(cWorld * a_World) override
+		{
+			class cEntityCounter :
+				public cEntityCallback
+			{
+			public:
+				int m_Count;
+				cEntityCounter(void) : m_Count(0) {}
+				virtual bool Item(cEntity * a_Entity) override
+				{
+					m_Count += 1;
+					return false;
+				}
+			} Counter;
+
+			class cPlayerCallback :
+				public cPlayerListCallback
+			{
+			public:
+				std::vector<sClientMetrics> & m_Clients;
+				cWorld & m_World;
+				cPlayerCallback(std::vector<sClientMetrics> & a_Clients, cWorld & a_World) : m_Clients(a_Clients), m_World(a_World) {}
+				virtual bool Item(cPlayer * a_Player) override
+				{
+					cClientHandle * Client = a_Player->GetClientHandle();
+					if (Client == nullptr)
+					{
+						return false;
+					}
+					sClientMetrics Metrics;
+					Metrics.m_Name = a_Player->GetName();
+					Metrics.m_WorldName = m_World.GetName();
+					Metrics.m_OutgoingDataSize = Client->GetOutgoingDataSize();
+					cChunkSender::sClientStats Stats;
+					Metrics.m_ChunkQueueDepth = m_World.GetChunkSender().GetClientStats(Client, Stats) ? Stats.m_QueueDepth : 0;
+					Metrics.m_Ping = Client->GetPing();
+					Client->GetNetworkStats().GetStats(Metrics.m_NetworkStats);
+					m_Clients.push_back(Metrics);
+					return false;
+				}
+			} Players(m_Clients, *a_World);
+
+			sWorldMetrics Metrics;
+			Metrics.m_Name = a_World->GetName();
+			a_World->GetTickDurationStats(Metrics.m_TickStats);
+			a_World->GetChunkStats(Metrics.m_NumValid, Metrics.m_NumDirty, Metrics.m_NumInLighting);
+			Metrics.m_GeneratorQueue = static_cast<size_t>(std::max(a_World->GetGeneratorQueueLength(), 0));
+			Metrics.m_LightingQueue = a_World->GetLightingQueueLength();
+			Metrics.m_LoadQueue = a_World->GetStorageLoadQueueLength();
+			Metrics.m_SaveQueue = a_World->GetStorageSaveQueueLength();
+			a_World->GetSectionPoolStats(Metrics.m_SectionsAllocated, Metrics.m_SectionsFree, Metrics.m_SectionsReserveInUse);
+			a_World->ForEachEntity(Counter);
+			Metrics.m_NumEntities = Counter.m_Count;
+			a_World->GetMemoryStats(Metrics.m_Memory);
+			a_World->ForEachPlayer(Players);
+			m_Worlds.push_back(Metrics);
+			return false;
+		}
+	} Callback;
+	cRoot::Get()->ForEachWorld(Callback);
+
+	AString res;
+
+	// Tick durations:
+	AppendMetricHeader(res, "mcserver_world_tick_duration_milliseconds", "histogram", "Duration of the world ticks.");
+	for (const auto & World: Callback.m_Worlds)
+	{
+		AString Label = EscapeMetricLabel(World.m_Name);
+		for (int i = 0; i < cWorld::sTickDurationStats::NUM_BUCKETS; i++)
+		{
+			AppendPrintf(res, "mcserver_world_tick_duration_milliseconds_bucket{world=\"%s\",le=\"%d\"} %llu\n",
+				Label.c_str(), cWorld::sTickDurationStats::GetBucketBound(i), static_cast<unsigned long long>(World.m_TickStats.m_BucketCounts[i])
+			);
+		}
+		AppendPrintf(res, "mcserver_world_tick_duration_milliseconds_bucket{world=\"%s\",le=\"+Inf\"} %llu\n",
+			Label.c_str(), static_cast<unsigned long long>(World.m_TickStats.m_NumTicks)
+		);
+		AppendPrintf(res, "mcserver_world_tick_duration_milliseconds_sum{world=\"%s\"} %llu\n",
+			Label.c_str(), static_cast<unsigned long long>(World.m_TickStats.m_TotalMSec)
+		);
+		AppendPrintf(res, "mcserver_world_tick_duration_milliseconds_count{world=\"%s\"} %llu\n",
+			Label.c_str(), static_cast<unsigned long long>(World.m_TickStats.m_NumTicks)
+		);
+	}
+
+	// The tick scheduler's counters:
+	struct sCounter
+	{
+		const char * m_Name;
+		const char * m_Help;
+		UInt64 cWorld::sTickDurationStats::* m_Member;
+	} ;
+	static const sCounter TickCounters[] =
+	{
+		{"mcserver_world_ticks_over_budget_total", "Number of the world ticks that took longer than the tick budget.",       &cWorld::sTickDurationStats::m_NumOverBudget},
+		{"mcserver_world_ticks_caught_up_total",   "Number of the world ticks run right after the previous one to catch up.", &cWorld::sTickDurationStats::m_NumCatchUpTicks},
+		{"mcserver_world_ticks_skipped_total",     "Number of the world ticks skipped because the world fell too far behind.", &cWorld::sTickDurationStats::m_NumSkippedTicks},
+	} ;
+	for (const auto & Counter: TickCounters)
+	{
+		AppendMetricHeader(res, Counter.m_Name, "counter", Counter.m_Help);
+		for (const auto & World: Callback.m_Worlds)
+		{
+			AppendPrintf(res, "%s{world=\"%s\"} %llu\n", Counter.m_Name, EscapeMetricLabel(World.m_Name).c_str(),
+				static_cast<unsigned long long>(World.m_TickStats.*(Counter.m_Member))
+			);
+		}
+	}
+
+	// The simple per-world gauges:
+	struct sGauge
+	{
+		const char * m_Name;
+		const char * m_Help;
+		size_t (*m_Get)(const sWorldMetrics &);
+	} ;
+	static const sGauge Gauges[] =
+	{
+		{"mcserver_world_tick_budget_milliseconds", "The duration that the world's ticks are expected to fit in.", [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_TickStats.m_BudgetMSec); }},
+		{"mcserver_world_tick_degradation_level",  "How much the world's non-essential subsystems are cut back because of the ticks over budget, 0 - 3.", [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_TickStats.m_DegradationLevel); }},
+		{"mcserver_world_chunks_loaded",           "Number of the loaded chunks.",                           [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_NumValid); }},
+		{"mcserver_world_chunks_dirty",            "Number of the loaded chunks not saved yet.",             [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_NumDirty); }},
+		{"mcserver_world_chunks_in_lighting",      "Number of the chunks being lit.",                        [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_NumInLighting); }},
+		{"mcserver_world_generator_queue_length",  "Number of the chunks queued for generating.",            [](const sWorldMetrics & a_M) { return a_M.m_GeneratorQueue; }},
+		{"mcserver_world_lighting_queue_length",   "Number of the chunks queued for lighting.",              [](const sWorldMetrics & a_M) { return a_M.m_LightingQueue; }},
+		{"mcserver_world_storage_load_queue_length", "Number of the chunks queued for loading.",             [](const sWorldMetrics & a_M) { return a_M.m_LoadQueue; }},
+		{"mcserver_world_storage_save_queue_length", "Number of the chunks queued for saving.",              [](const sWorldMetrics & a_M) { return a_M.m_SaveQueue; }},
+		{"mcserver_world_entities",                "Number of the entities in the loaded chunks.",           [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_NumEntities); }},
+		{"mcserver_world_section_pool_allocated",  "Number of the chunk sections allocated from the pool.",  [](const sWorldMetrics & a_M) { return a_M.m_SectionsAllocated; }},
+		{"mcserver_world_section_pool_free",       "Number of the unused chunk sections held by the pool.",  [](const sWorldMetrics & a_M) { return a_M.m_SectionsFree; }},
+		{"mcserver_world_section_pool_reserve_in_use", "Number of the pool's reserve chunk sections in use, non-zero when out of memory.", [](const sWorldMetrics & a_M) { return a_M.m_SectionsReserveInUse; }},
+		{"mcserver_world_section_pool_bytes",      "Memory held by the chunk section pool.",                 [](const sWorldMetrics & a_M) { return a_M.m_Memory.m_SectionPoolBytes; }},
+		{"mcserver_world_palette_sections",        "Number of the palette-compressed chunk sections.",       [](const sWorldMetrics & a_M) { return a_M.m_Memory.m_Chunks.m_NumPaletteSections; }},
+		{"mcserver_world_chunk_data_heap_bytes",   "Memory used by the palette sections and the light arrays.", [](const sWorldMetrics & a_M) { return a_M.m_Memory.m_Chunks.m_ChunkDataHeapBytes; }},
+		{"mcserver_world_block_entities",          "Number of the block entities in the loaded chunks.",     [](const sWorldMetrics & a_M) { return a_M.m_Memory.m_Chunks.m_NumBlockEntities; }},
+		{"mcserver_world_serialization_cache_bytes", "Memory used by the cached chunk serializations.",      [](const sWorldMetrics & a_M) { return a_M.m_Memory.m_SerializationCacheBytes; }},
+		{"mcserver_world_generator_cache_bytes",   "Memory used by the generator caches.",                   [](const sWorldMetrics & a_M) { return static_cast<size_t>(a_M.m_Memory.m_GeneratorCacheBytes); }},
+	} ;
+	for (const auto & Gauge: Gauges)
+	{
+		AppendMetricHeader(res, Gauge.m_Name, "gauge", Gauge.m_Help);
+		for (const auto & World: Callback.m_Worlds)
+		{
+			AppendPrintf(res, "%s{world=\"%s\"} " SIZE_T_FMT "\n", Gauge.m_Name, EscapeMetricLabel(World.m_Name).c_str(), Gauge.m_Get(World));
+		}
+	}
+
+	// Per-client:
+	AppendMetricHeader(res, "mcserver_client_send_buffer_bytes", "gauge", "Number of bytes queued for sending to the client.");
+	for (const auto & Client: Callback.m_Clients)
+	{
+		AppendPrintf(res, "mcserver_client_send_buffer_bytes{player=\"%s\",world=\"%s\"} " SIZE_T_FMT "\n",
+			EscapeMetricLabel(Client.m_Name).c_str(), EscapeMetricLabel(Client.m_WorldName).c_str(), Client.m_OutgoingDataSize
+		);
+	}
+	AppendMetricHeader(res, "mcserver_client_chunk_queue_length", "gauge", "Number of the chunks queued for sending to the client.");
+	for (const auto & Client: Callback.m_Clients)
+	{
+		AppendPrintf(res, "mcserver_client_chunk_queue_length{player=\"%s\",world=\"%s\"} " SIZE_T_FMT "\n",
+			EscapeMetricLabel(Client.m_Name).c_str(), EscapeMetricLabel(Client.m_WorldName).c_str(), Client.m_ChunkQueueDepth
+		);
+	}
+	std::vector<AString> ClientLabels;
+	for (const auto & Client: Callback.m_Clients)
+	{
+		ClientLabels.push_back(Printf("player=\"%s\",world=\"%s\"", EscapeMetricLabel(Client.m_Name).c_str(), EscapeMetricLabel(Client.m_WorldName).c_str()));
+	}
+	AppendMetricHeader(res, "mcserver_client_ping_milliseconds", "gauge", "The keep-alive round trip time of the client.");
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		AppendPrintf(res, "mcserver_client_ping_milliseconds{%s} %d\n", ClientLabels[i].c_str(), Callback.m_Clients[i].m_Ping);
+	}
+	AppendMetricHeader(res, "mcserver_client_link_backlog_bytes", "gauge", "Number of bytes given to the network link and not yet written to the OS.");
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		AppendPrintf(res, "mcserver_client_link_backlog_bytes{%s} " SIZE_T_FMT "\n", ClientLabels[i].c_str(), Callback.m_Clients[i].m_NetworkStats.m_LinkBacklog);
+	}
+	AppendMetricHeader(res, "mcserver_client_link_backlog_max_bytes", "gauge", "The largest network link backlog seen on the connection.");
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		AppendPrintf(res, "mcserver_client_link_backlog_max_bytes{%s} " SIZE_T_FMT "\n", ClientLabels[i].c_str(), Callback.m_Clients[i].m_NetworkStats.m_MaxLinkBacklog);
+	}
+	AppendMetricHeader(res, "mcserver_client_send_queue_delay_microseconds", "histogram",
+		"Time from the creation of the oldest packet in each sent batch to the batch being written to the OS."
+	);
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		AppendClientHistogram(res, "mcserver_client_send_queue_delay_microseconds", ClientLabels[i], Callback.m_Clients[i].m_NetworkStats.m_SendQueueDelay);
+	}
+	AppendMetricHeader(res, "mcserver_client_packet_handle_duration_microseconds", "histogram", "Time taken to parse and handle an incoming packet.");
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		AppendClientHistogram(res, "mcserver_client_packet_handle_duration_microseconds", ClientLabels[i], Callback.m_Clients[i].m_NetworkStats.m_PacketHandleTime);
+	}
+	AppendMetricHeader(res, "mcserver_client_sent_bytes_total", "counter", "Bytes sent to the client, by the packet type; the broadcast packets aren't split by type.");
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		const cClientNetworkStats::sStats & Stats = Callback.m_Clients[i].m_NetworkStats;
+		for (UInt32 Type = 0; Type < cClientNetworkStats::NUM_PACKET_TYPES; Type++)
+		{
+			if (Stats.m_PacketsSent[Type] > 0)
+			{
+				AppendPrintf(res, "mcserver_client_sent_bytes_total{%s,packet=\"0x%02x\"} %llu\n",
+					ClientLabels[i].c_str(), Type, static_cast<unsigned long long>(Stats.m_BytesSent[Type])
+				);
+			}
+		}
+		AppendPrintf(res, "mcserver_client_sent_bytes_total{%s,packet=\"broadcast\"} %llu\n",
+			ClientLabels[i].c_str(), static_cast<unsigned long long>(Stats.m_BroadcastBytesSent)
+		);
+	}
+	AppendMetricHeader(res, "mcserver_client_sent_packets_total", "counter", "Packets sent to the client, by the packet type.");
+	for (size_t i = 0; i < Callback.m_Clients.size(); i++)
+	{
+		const cClientNetworkStats::sStats & Stats = Callback.m_Clients[i].m_NetworkStats;
+		for (UInt32 Type = 0; Type < cClientNetworkStats::NUM_PACKET_TYPES; Type++)
+		{
+			if (Stats.m_PacketsSent[Type] > 0)
+			{
+				AppendPrintf(res, "mcserver_client_sent_packets_total{%s,packet=\"0x%02x\"} %llu\n",
+					ClientLabels[i].c_str(), Type, static_cast<unsigned long long>(Stats.m_PacketsSent[Type])
+				);
+			}
+		}
+	}
+
+	// Per-plugin:
+	class cPluginMemoryCallback :
+		public cPluginManager::cPluginCallback
+	{
+	public:
+		AString & m_Res;
+		cPluginMemoryCallback(AString & a_Res) : m_Res(a_Res) {}
+		virtual bool Item(cPlugin * a_Plugin) override
+		{
+			if (a_Plugin->IsLoaded())
+			{
+				cPlugin::cCallStatsMap Calls;
+				size_t MemoryUsed;
+				a_Plugin->GetStats(Calls, MemoryUsed);
+				AppendPrintf(m_Res, "mcserver_plugin_lua_memory_bytes{plugin=\"%s\"} " SIZE_T_FMT "\n", EscapeMetricLabel(a_Plugin->GetName()).c_str(), MemoryUsed);
+			}
+			return false;
+		}
+	} PluginCallback(res);
+	AppendMetricHeader(res, "mcserver_plugin_lua_memory_bytes", "gauge", "Memory used by the plugin's Lua state.");
+	cPluginManager::Get()->ForEachPlugin(PluginCallback);
+
+	// Server-wide:
+	AppendMetricHeader(res, "mcserver_thread_pool_queue_length", "gauge", "Number of the tasks waiting in the thread pool.");
+	AppendPrintf(res, "mcserver_thread_pool_queue_length " SIZE_T_FMT "\n", cRoot::Get()->GetThreadPool().GetQueueLength());
+	int PhysicalRAM = cRoot::GetPhysicalRAMUsage();
+	if (PhysicalRAM >= 0)
+	{
+		AppendMetricHeader(res, "mcserver_resident_memory_bytes", "gauge", "Physical memory used by the server process.");
+		AppendPrintf(res, "mcserver_resident_memory_bytes %lld\n", static_cast<long long>(PhysicalRAM) * 1024);
+	}
+	return res;
+}
+
+
+
+
+
+bool cWebAdmin::HandleUpload(const HTTPRequest & a_Request, const AString & a_FieldName, const AString & a_FileName, const char * a_Data, size_t a_Size, bool a_IsLast)
+{
+	// The plugin is looked up for each piece, so that a plugin unloading in the middle of an upload is handled:
+	AStringVector Split = StringSplit(a_Request.Path, "/");
+	if (Split.size() < 2)
+	{
+		return false;
+	}
+	for (PluginList::iterator itr = m_Plugins.begin(); itr != m_Plugins.end(); ++itr)
+	{
+		if ((*itr)->GetWebTitle() == Split[1])
+		{
+			return (*itr)->HandleWebUpload(a_Request, a_FieldName, a_FileName, a_Data, a_Size, a_IsLast);
+		}
+	}
+	return false;
+}
+
+
+
+
+
 void cWebAdmin::HandleRootRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request)
 {
 	UNUSED(a_Request);
@@ -382,34 +860,53 @@ void cWebAdmin::HandleFileRequest(cHTTPConnection & a_Connection, cHTTPRequest &
 	// Remove all "../" strings:
 	ReplaceString(FileURL, "../", "");
 
-	bool LoadedSuccessfull = false;
-	AString Content = "<h2>404 Not Found</h2>";
 	AString Path = Printf(FILE_IO_PREFIX "webadmin/files/%s", FileURL.c_str());
-	if (cFile::IsFile(Path))
+	cStaticFilePtr File = GetStaticFile(Path);
+	if (File == nullptr)
 	{
-		cFile File(Path, cFile::fmRead);
-		AString FileContent;
-		if (File.IsOpen() && (File.ReadRestOfFile(FileContent) != -1))
-		{
-			LoadedSuccessfull = true;
-			Content = FileContent;
-		}
+		cHTTPResponse Resp;
+		Resp.SetContentType("text/html");
+		a_Connection.Send(Resp);
+		a_Connection.Send("<h2>404 Not Found</h2>");
+		a_Connection.FinishResponse();
+		return;
 	}
 
-	// Find content type (The currently method is very bad. We should change it later)
-	AString ContentType = "text/html";
-	size_t LastPointPosition = Path.find_last_of('.');
-	if (LoadedSuccessfull && (LastPointPosition != AString::npos) && (LastPointPosition < Path.length()))
+	// Pick the gzipped variant, if the client supports it; each variant has its own entity tag:
+	bool ShouldGZip = (
+		!File->m_GZipContent.empty() &&
+		(StrToLower(a_Request.GetHeader("Accept-Encoding")).find("gzip") != AString::npos)
+	);
+	AString ETag = File->m_ETag;
+	if (ShouldGZip)
+	{
+		ETag.insert(ETag.size() - 1, "-gz");
+	}
+	AString CacheControl = Printf("max-age=%d", m_StaticFilesMaxAge);
+
+	// If the client has the same version already, only tell it so:
+	AString IfNoneMatch = a_Request.GetHeader("If-None-Match");
+	if (!IfNoneMatch.empty() && ((IfNoneMatch == "*") || (IfNoneMatch.find(ETag) != AString::npos)))
 	{
-		AString FileExtension = Path.substr(LastPointPosition + 1);
-		ContentType = GetContentTypeFromFileExt(FileExtension);
+		a_Connection.SendNotModified(ETag, CacheControl);
+		return;
 	}
 
 	// Send the response:
 	cHTTPResponse Resp;
-	Resp.SetContentType(ContentType);
+	Resp.SetContentType(File->m_ContentType);
+	Resp.AddHeader("ETag", ETag);
+	Resp.AddHeader("Cache-Control", CacheControl);
+	if (!File->m_GZipContent.empty())
+	{
+		Resp.AddHeader("Vary", "Accept-Encoding");
+	}
+	if (ShouldGZip)
+	{
+		Resp.AddHeader("Content-Encoding", "gzip");
+	}
 	a_Connection.Send(Resp);
-	a_Connection.Send(Content);
+	a_Connection.Send(ShouldGZip ? File->m_GZipContent : File->m_Content);
 	a_Connection.FinishResponse();
 }
 
@@ -417,6 +914,94 @@ void cWebAdmin::HandleFileRequest(cHTTPConnection & a_Connection, cHTTPRequest &
 
 
 
+cWebAdmin::cStaticFilePtr cWebAdmin::GetStaticFile(const AString & a_Path)
+{
+	unsigned ModificationTime = cFile::GetLastModificationTime(a_Path);
+	int Size = cFile::GetSize(a_Path);
+
+	// Serve from the cache, if the file hasn't changed since:
+	{
+		cCSLock Lock(m_CSStaticFiles);
+		cStaticFiles::iterator itr = m_StaticFiles.find(a_Path);
+		if (itr != m_StaticFiles.end())
+		{
+			if ((itr->second->m_ModificationTime == ModificationTime) && (itr->second->m_Size == Size))
+			{
+				return itr->second;
+			}
+			m_StaticFilesSize -= itr->second->m_Content.size() + itr->second->m_GZipContent.size();
+			m_StaticFiles.erase(itr);
+		}
+	}
+
+	// Read the file:
+	if (!cFile::IsFile(a_Path))
+	{
+		return nullptr;
+	}
+	SharedPtr<sStaticFile> File(new sStaticFile);
+	{
+		cFile f(a_Path, cFile::fmRead);
+		if (!f.IsOpen() || (f.ReadRestOfFile(File->m_Content) == -1))
+		{
+			return nullptr;
+		}
+	}
+	File->m_ModificationTime = ModificationTime;
+	File->m_Size = Size;
+	File->m_ETag = Printf("\"%x-%x\"", ModificationTime, static_cast<unsigned>(File->m_Content.size()));
+
+	// Find content type (The currently method is very bad. We should change it later)
+	File->m_ContentType = "text/html";
+	size_t LastPointPosition = a_Path.find_last_of('.');
+	if ((LastPointPosition != AString::npos) && (LastPointPosition < a_Path.length()))
+	{
+		AString FileExtension = a_Path.substr(LastPointPosition + 1);
+		File->m_ContentType = GetContentTypeFromFileExt(FileExtension);
+	}
+
+	// Compress the text files, the images are compressed already:
+	const AString & ContentType = File->m_ContentType;
+	if (
+		(ContentType.compare(0, 5, "text/") == 0) ||
+		(ContentType.find("javascript") != AString::npos) ||
+		(ContentType.find("json") != AString::npos) ||
+		(ContentType.find("xml") != AString::npos)
+	)
+	{
+		if (
+			(CompressStringGZIP(File->m_Content.data(), File->m_Content.size(), File->m_GZipContent) != Z_OK) ||
+			(File->m_GZipContent.size() >= File->m_Content.size())
+		)
+		{
+			File->m_GZipContent.clear();
+		}
+	}
+
+	// Cache the file, unless it is too large:
+	size_t TotalSize = File->m_Content.size() + File->m_GZipContent.size();
+	if (Size <= MAX_CACHED_STATIC_FILE_SIZE)
+	{
+		cCSLock Lock(m_CSStaticFiles);
+		if (m_StaticFilesSize + TotalSize <= MAX_STATIC_FILES_CACHE_SIZE)
+		{
+			cStaticFiles::iterator itr = m_StaticFiles.find(a_Path);
+			if (itr != m_StaticFiles.end())
+			{
+				// Another thread has read the file in the meantime
+				m_StaticFilesSize -= itr->second->m_Content.size() + itr->second->m_GZipContent.size();
+			}
+			m_StaticFiles[a_Path] = File;
+			m_StaticFilesSize += TotalSize;
+		}
+	}
+	return File;
+}
+
+
+
+
+
 AString cWebAdmin::GetContentTypeFromFileExt(const AString & a_FileExtension)
 {
 	static bool IsInitialized = false;
@@ -474,6 +1059,11 @@ sWebAdminPage cWebAdmin::GetPage(const HTTPRequest & a_Request)
 				break;
 			}
 		}
+		if (FoundPlugin.empty() && (Split[1] == "chunkcosts"))
+		{
+			Page.Content = GetChunkTickCostsPage(a_Request);
+			Page.PluginName = "Chunk tick costs";
+		}
 	}
 
 	// Return the page contents
@@ -484,6 +1074,82 @@ sWebAdminPage cWebAdmin::GetPage(const HTTPRequest & a_Request)
 
 
 
+AString cWebAdmin::GetChunkTickCostsPage(const HTTPRequest & a_Request)
+{
+	static const size_t NUM_CHUNKS = 20;
+
+	AString Content;
+	auto Profiling = a_Request.Params.find("profiling");
+	if (Profiling != a_Request.Params.end())
+	{
+		if (Profiling->second == "on")
+		{
+			cRoot::Get()->SetChunkTickProfilingEnabled(true);
+		}
+		else if (Profiling->second == "off")
+		{
+			cRoot::Get()->SetChunkTickProfilingEnabled(false);
+		}
+		else if (Profiling->second == "reset")
+		{
+			cRoot::Get()->ResetChunkTickCosts();
+		}
+	}
+	Content += "<p><a href='?profiling=on'>Turn profiling on</a> | <a href='?profiling=off'>Turn profiling off</a> | <a href='?profiling=reset'>Reset</a></p>";
+
+	class cWorldCallback :
+		public cWorldListCallback
+	{
+	public:
+		AString & m_Content;
+
+		cWorldCallback(AString & a_Content) :
+			m_Content(a_Content)
+		{
+		}
+
+		virtual bool Item(cWorld * a_World) override
+		{
+			std::vector<cChunkMap::sChunkTickCost> Costs;
+			a_World->GetTopChunkTickCosts(NUM_CHUNKS, Costs);
+			AppendPrintf(m_Content, "<h4>%s (profiling %s)</h4>",
+				GetHTMLEscapedString(a_World->GetName()).c_str(), a_World->IsChunkTickProfilingEnabled() ? "on" : "off"
+			);
+			if (Costs.empty())
+			{
+				m_Content += "<p>No chunk tick time has been accumulated.</p>";
+				return false;
+			}
+			m_Content += "<table><tr><th>Chunk</th><th>Blocks</th><th>Total [ms]</th>";
+			for (int i = 0; i < cChunkMap::sChunkTickCost::catCount; i++)
+			{
+				AppendPrintf(m_Content, "<th>%s [ms]</th>", cChunkMap::sChunkTickCost::GetCategoryName(static_cast<cChunkMap::sChunkTickCost::eCategory>(i)));
+			}
+			m_Content += "</tr>";
+			for (const auto & Cost: Costs)
+			{
+				AppendPrintf(m_Content, "<tr><td>%d, %d</td><td>%d, %d</td><td>%.2f</td>",
+					Cost.m_ChunkX, Cost.m_ChunkZ, Cost.m_ChunkX * cChunkDef::Width, Cost.m_ChunkZ * cChunkDef::Width,
+					std::chrono::duration<double, std::milli>(Cost.GetTotal()).count()
+				);
+				for (int i = 0; i < cChunkMap::sChunkTickCost::catCount; i++)
+				{
+					AppendPrintf(m_Content, "<td>%.2f</td>", std::chrono::duration<double, std::milli>(Cost.m_Time[i]).count());
+				}
+				m_Content += "</tr>";
+			}
+			m_Content += "</table>";
+			return false;
+		}
+	} Callback(Content);
+	cRoot::Get()->ForEachWorld(Callback);
+	return Content;
+}
+
+
+
+
+
 AString cWebAdmin::GetDefaultPage(void)
 {
 	AString Content;
@@ -506,7 +1172,22 @@ AString cWebAdmin::GetDefaultPage(void)
 		{
 			if (a_Plugin->IsLoaded())
 			{
-				AppendPrintf(m_Content, "<li>%s V.%i</li>", a_Plugin->GetName().c_str(), a_Plugin->GetVersion());
+				// Summarize the plugin's stats, the details are available through the "pluginstats" console command:
+				cPlugin::cCallStatsMap Calls;
+				size_t MemoryUsed;
+				a_Plugin->GetStats(Calls, MemoryUsed);
+				UInt64 NumCalls = 0, TotalMicrosec = 0, MaxMicrosec = 0;
+				for (const auto & Call: Calls)
+				{
+					NumCalls += Call.second.m_NumCalls;
+					TotalMicrosec += Call.second.m_TotalMicrosec;
+					MaxMicrosec = std::max(MaxMicrosec, Call.second.m_MaxMicrosec);
+				}
+				AppendPrintf(m_Content, "<li>%s V.%i - %llu calls, %.03f ms total, %.03f ms max, %u KiB of script memory</li>",
+					GetHTMLEscapedString(a_Plugin->GetName()).c_str(), a_Plugin->GetVersion(),
+					static_cast<unsigned long long>(NumCalls), static_cast<double>(TotalMicrosec) / 1000,
+					static_cast<double>(MaxMicrosec) / 1000, static_cast<unsigned>(MemoryUsed / 1024)
+				);
 			}
 			return false;
 		}
@@ -630,7 +1311,7 @@ void cWebAdmin::OnRequestBegun(cHTTPConnection & a_Connection, cHTTPRequest & a_
 		(strncmp(URL.c_str(), "/~webadmin", 10) == 0)
 	)
 	{
-		a_Request.SetUserData(new cWebadminRequestData(a_Request));
+		a_Request.SetUserData(new cWebadminRequestData(*this, a_Request));
 		return;
 	}
 	if (URL == "/")
@@ -675,6 +1356,14 @@ void cWebAdmin::OnRequestFinished(cHTTPConnection & a_Connection, cHTTPRequest &
 		// The root needs no body handler and is fully handled in the OnRequestFinished() call
 		HandleRootRequest(a_Connection, a_Request);
 	}
+	else if (a_Request.GetBareURL() == "/metrics")
+	{
+		HandleMetricsRequest(a_Connection, a_Request);
+	}
+	else if (strncmp(URL.c_str(), "/maptiles/", 10) == 0)
+	{
+		HandleMapTileRequest(a_Connection, a_Request);
+	}
 	else
 	{
 		HandleFileRequest(a_Connection, a_Request);
@@ -693,6 +1382,22 @@ void cWebAdmin::OnRequestFinished(cHTTPConnection & a_Connection, cHTTPRequest &
 ////////////////////////////////////////////////////////////////////////////////
 // cWebAdmin::cWebadminRequestData
 
+cWebAdmin::cWebadminRequestData::cWebadminRequestData(cWebAdmin & a_WebAdmin, cHTTPRequest & a_Request) :
+	m_Form(a_Request, *this),
+	m_WebAdmin(a_WebAdmin),
+	m_IsAuthorized(a_WebAdmin.IsAuthorized(a_Request)),
+	m_IsUploadAccepted(false)
+{
+	m_Request.URL = a_Request.GetURL();
+	m_Request.Method = a_Request.GetMethod();
+	m_Request.Path = a_Request.GetBareURL().substr(1);
+	m_Request.Username = a_Request.GetAuthUsername();
+}
+
+
+
+
+
 void cWebAdmin::cWebadminRequestData::OnBody(const char * a_Data, size_t a_Size)
 {
 	m_Form.Parse(a_Data, a_Size);
@@ -700,3 +1405,58 @@ void cWebAdmin::cWebadminRequestData::OnBody(const char * a_Data, size_t a_Size)
 
 
 
+
+
+void cWebAdmin::cWebadminRequestData::OnFileStart(cHTTPFormParser & a_Parser, const AString & a_FileName)
+{
+	m_FieldName = a_Parser.GetCurrentPartName();
+	m_FileName = a_FileName;
+	m_UploadBuffer.clear();
+	m_IsUploadAccepted = m_IsAuthorized;
+}
+
+
+
+
+
+void cWebAdmin::cWebadminRequestData::OnFileData(cHTTPFormParser & a_Parser, const char * a_Data, size_t a_Size)
+{
+	UNUSED(a_Parser);
+	if (!m_IsUploadAccepted)
+	{
+		return;
+	}
+	m_UploadBuffer.append(a_Data, a_Size);
+	if (m_UploadBuffer.size() >= UPLOAD_PIECE_SIZE)
+	{
+		FlushUpload(false);
+	}
+}
+
+
+
+
+
+void cWebAdmin::cWebadminRequestData::OnFileEnd(cHTTPFormParser & a_Parser)
+{
+	UNUSED(a_Parser);
+	if (m_IsUploadAccepted)
+	{
+		FlushUpload(true);
+	}
+	m_IsUploadAccepted = false;
+}
+
+
+
+
+
+void cWebAdmin::cWebadminRequestData::FlushUpload(bool a_IsLast)
+{
+	// The plugin is called directly from the network callback, so no more data is read from the link until it returns:
+	m_IsUploadAccepted = m_WebAdmin.HandleUpload(m_Request, m_FieldName, m_FileName, m_UploadBuffer.data(), m_UploadBuffer.size(), a_IsLast);
+	m_UploadBuffer.clear();
+}
+
+
+
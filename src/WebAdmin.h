@@ -171,6 +171,10 @@ public:
 	static AString GetContentTypeFromFileExt(const AString & a_FileExtension);
 
 protected:
+	/** Returns the contents of the built-in "chunkcosts" page - the chunks that have accumulated the most tick time in each world.
+	Handles the "profiling" URL parameter ("on", "off" or "reset") first. */
+	AString GetChunkTickCostsPage(const HTTPRequest & a_Request);
+
 	/** Common base class for request body data handlers */
 	class cRequestData
 	{
@@ -181,7 +185,8 @@ protected:
 		virtual void OnBody(const char * a_Data, size_t a_Size) = 0;
 	} ;
 
-	/** The body handler for requests in the "/webadmin" and "/~webadmin" paths */
+	/** The body handler for requests in the "/webadmin" and "/~webadmin" paths.
+	The uploaded files are streamed to the plugin owning the page, in pieces of bounded size, as they arrive. */
 	class cWebadminRequestData :
 		public cRequestData,
 		public cHTTPFormParser::cCallbacks
@@ -190,27 +195,62 @@ protected:
 		cHTTPFormParser m_Form;
 
 
-		cWebadminRequestData(cHTTPRequest & a_Request) :
-			m_Form(a_Request, *this)
-		{
-		}
+		cWebadminRequestData(cWebAdmin & a_WebAdmin, cHTTPRequest & a_Request);
 
 		// cRequestData overrides:
 		virtual void OnBody(const char * a_Data, size_t a_Size) override;
 
-		// cHTTPFormParser::cCallbacks overrides. Files are ignored:
-		virtual void OnFileStart(cHTTPFormParser &, const AString & a_FileName) override
-		{
-			UNUSED(a_FileName);
-		}
-		virtual void OnFileData(cHTTPFormParser &, const char * a_Data, size_t a_Size) override
-		{
-			UNUSED(a_Data);
-			UNUSED(a_Size);
-		}
-		virtual void OnFileEnd(cHTTPFormParser &) override {}
+		// cHTTPFormParser::cCallbacks overrides:
+		virtual void OnFileStart(cHTTPFormParser & a_Parser, const AString & a_FileName) override;
+		virtual void OnFileData(cHTTPFormParser & a_Parser, const char * a_Data, size_t a_Size) override;
+		virtual void OnFileEnd(cHTTPFormParser & a_Parser) override;
+
+	protected:
+		cWebAdmin & m_WebAdmin;
+
+		/** The request, as presented to the plugins receiving the uploaded files. Only the URL, method, path and user are known. */
+		HTTPRequest m_Request;
+
+		/** True if the request has valid credentials. The files of unauthorized requests are ignored. */
+		bool m_IsAuthorized;
+
+		/** The form field and the name of the file being uploaded. */
+		AString m_FieldName;
+		AString m_FileName;
+
+		/** True while the plugin wants more data of the file being uploaded. */
+		bool m_IsUploadAccepted;
+
+		/** The data of the file being uploaded not yet passed to the plugin. */
+		AString m_UploadBuffer;
+
+
+		/** Passes the buffered file data to the plugin, a_IsLast is set for the final piece of the file. */
+		void FlushUpload(bool a_IsLast);
 	} ;
 
+	/** A static file from the webadmin/files folder, kept in memory between the requests. */
+	struct sStaticFile
+	{
+		/** The file contents. */
+		AString m_Content;
+
+		/** The file contents compressed by gzip, empty if the file type doesn't compress well. */
+		AString m_GZipContent;
+
+		AString m_ContentType;
+
+		/** The entity tag identifying this version of the file, including the quotes. */
+		AString m_ETag;
+
+		/** The file's modification time and size when it was read, used for detecting changes to the file. */
+		unsigned m_ModificationTime;
+		int m_Size;
+	} ;
+
+	typedef SharedPtr<const sStaticFile> cStaticFilePtr;
+	typedef std::map<AString, cStaticFilePtr> cStaticFiles;
+
 
 	/** Set to true if Init() succeeds and the webadmin isn't to be disabled */
 	bool m_IsInitialized;
@@ -235,6 +275,24 @@ protected:
 	/** The HTTP server which provides the underlying HTTP parsing, serialization and events */
 	cHTTPServer m_HTTPServer;
 
+	/** Protects m_StaticFiles and m_StaticFilesSize against multithreaded access. */
+	cCriticalSection m_CSStaticFiles;
+
+	/** The static files served so far, by their path. */
+	cStaticFiles m_StaticFiles;
+
+	/** The total size of the contents in m_StaticFiles, in bytes. */
+	size_t m_StaticFilesSize;
+
+	/** The max-age of the static files' Cache-Control header, in seconds. */
+	int m_StaticFilesMaxAge;
+
+	/** If true, the "/metrics" URL is served to the webadmin users. */
+	bool m_IsMetricsEnabled;
+
+	/** The max-age of the map tiles' Cache-Control header, in seconds. */
+	int m_MapTilesMaxAge;
+
 	/** Handles requests coming to the "/webadmin" or "/~webadmin" URLs */
 	void HandleWebadminRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request);
 
@@ -244,6 +302,26 @@ protected:
 	/** Handles requests for a file */
 	void HandleFileRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request);
 
+	/** Returns true if the request presents the credentials of a webadmin user. */
+	bool IsAuthorized(const cHTTPRequest & a_Request);
+
+	/** Handles requests for the "/metrics" URL, exporting the server internals in the Prometheus text format */
+	void HandleMetricsRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request);
+
+	/** Handles requests for the "/maptiles/<world>/<x>/<z>.png" URLs, serving the world's top-down map tiles, see cMapTileCache. */
+	void HandleMapTileRequest(cHTTPConnection & a_Connection, cHTTPRequest & a_Request);
+
+	/** Returns the server internals' metrics in the Prometheus text exposition format. */
+	static AString GetMetrics(void);
+
+	/** Passes a piece of a file uploaded to a webadmin page to the plugin owning the page.
+	Returns false if the plugin doesn't want any more data of the file. */
+	bool HandleUpload(const HTTPRequest & a_Request, const AString & a_FieldName, const AString & a_FileName, const char * a_Data, size_t a_Size, bool a_IsLast);
+
+	/** Returns the static file at the specified path, either from the cache, or read from the disk if it isn't cached
+	or has changed since it has been cached. Returns nullptr if the file cannot be read. */
+	cStaticFilePtr GetStaticFile(const AString & a_Path);
+
 	// cHTTPServer::cCallbacks overrides:
 	virtual void OnRequestBegun   (cHTTPConnection & a_Connection, cHTTPRequest & a_Request) override;
 	virtual void OnRequestBody    (cHTTPConnection & a_Connection, cHTTPRequest & a_Request, const char * a_Data, size_t a_Size) override;
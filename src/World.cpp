@@ -48,15 +48,14 @@
 #include "Bindings/PluginManager.h"
 #include "Blocks/BlockHandler.h"
 
-#include "Tracer.h"
-
-// DEBUG: Test out the cLineBlockTracer class by tracing a few lines:
 #include "LineBlockTracer.h"
 
 #ifndef _WIN32
 	#include <stdlib.h>
 #endif
 
+#include <unordered_set>
+
 #include "Broadcaster.h"
 
 
@@ -67,6 +66,24 @@ const int TIME_NIGHT_END     = 22812;
 const int TIME_SUNRISE       = 23999;
 const int TIME_SPAWN_DIVISOR =   148;
 
+/** The number of ticks over which the load is averaged for each evaluation of the dynamic view distance. */
+static const int DYNAMIC_VIEW_DISTANCE_EVAL_TICKS = 20;
+
+/** The number of consecutive healthy evaluations needed before the dynamic view distance is raised by one. */
+static const int DYNAMIC_VIEW_DISTANCE_HEALTHY_EVALS = 5;
+
+/** The number of ticks over which the tick durations are averaged for each evaluation of the tick degradation level. */
+static const int TICK_DEGRADATION_EVAL_TICKS = 20;
+
+/** The number of consecutive evaluations within the budget needed before the tick degradation level is lowered by one. */
+static const int TICK_DEGRADATION_HEALTHY_EVALS = 5;
+
+/** The highest tick degradation level, see cWorld::GetTickDegradationLevel(). */
+static const int MAX_TICK_DEGRADATION_LEVEL = 3;
+
+/** The number of random block ticks per chunk per tick in a world that isn't degraded. */
+static const int RANDOM_TICKS_PER_CHUNK = 50;
+
 
 
 
@@ -74,7 +91,8 @@ const int TIME_SPAWN_DIVISOR =   148;
 ////////////////////////////////////////////////////////////////////////////////
 // cSpawnPrepare:
 
-/** Generates and lights the spawn area of the world. Runs as a separate thread. */
+/** Chooses the spawn point, then generates and lights the spawn area of the world. Runs as a separate thread,
+so that the worlds can prepare their spawn areas in parallel. */
 class cSpawnPrepare:
 	public cIsThread,
 	public cChunkCoordCallback
@@ -82,15 +100,17 @@ class cSpawnPrepare:
 	typedef cIsThread super;
 
 public:
-	cSpawnPrepare(cWorld & a_World, int a_SpawnChunkX, int a_SpawnChunkZ, int a_PrepareDistance):
+	cSpawnPrepare(cWorld & a_World):
 		super("SpawnPrepare"),
 		m_World(a_World),
-		m_SpawnChunkX(a_SpawnChunkX),
-		m_SpawnChunkZ(a_SpawnChunkZ),
-		m_PrepareDistance(a_PrepareDistance),
-		m_MaxIdx(a_PrepareDistance * a_PrepareDistance),
+		m_SpawnChunkX(0),
+		m_SpawnChunkZ(0),
+		m_PrepareDistance(0),
+		m_NextIdx(0),
+		m_MaxIdx(0),
 		m_NumPrepared(0),
-		m_LastReportChunkCount(0)
+		m_LastReportChunkCount(0),
+		m_IsFinished(false)
 	{
 		// Start the thread:
 		Start();
@@ -106,9 +126,25 @@ public:
 		// Confirm thread start:
 		m_EvtStarted.Set();
 
-		// Queue the initial chunks:
+		bool IsAreaPrepared;
+		m_World.InitializeSpawnPosition(m_SpawnChunkX, m_SpawnChunkZ, m_PrepareDistance, IsAreaPrepared);
 		m_MaxIdx = m_PrepareDistance * m_PrepareDistance;
-		int maxQueue = std::min(m_MaxIdx - 1, 100);  // Number of chunks to queue at once
+		if (m_MaxIdx <= 0)
+		{
+			m_IsFinished = true;
+			return;
+		}
+		if (IsAreaPrepared)
+		{
+			// A previous run has already generated and lit the area, it is stored; only load it in the background, nearest chunks first:
+			LOGD("Spawn area of world \"%s\" has been prepared before, loading it in the background", m_World.GetName().c_str());
+			QueueLazyLoad();
+			m_IsFinished = true;
+			return;
+		}
+
+		// Queue the initial chunks:
+		int maxQueue = std::min(m_MaxIdx, 100);  // Number of chunks to queue at once
 		m_NextIdx = maxQueue;
 		m_LastReportTime = std::chrono::steady_clock::now();
 		for (int i = 0; i < maxQueue; i++)
@@ -120,8 +156,16 @@ public:
 
 		// Wait for the lighting thread to prepare everything. Event is set in the Call() callback:
 		m_EvtFinished.Wait();
+
+		// Let the next start skip the waiting:
+		m_World.MarkSpawnAreaPrepared(m_SpawnChunkX, m_SpawnChunkZ, m_PrepareDistance);
+		m_IsFinished = true;
 	}
 
+
+	/** Returns true once the whole spawn area has been prepared; the thread is about to finish then. */
+	bool IsFinished(void) const { return m_IsFinished; }
+
 protected:
 	cWorld & m_World;
 	int m_SpawnChunkX;
@@ -149,6 +193,9 @@ protected:
 	/** Number of chunks prepared when the last progress report was emitted. */
 	int m_LastReportChunkCount;
 
+	/** Set by the thread when the preparation has finished. */
+	std::atomic<bool> m_IsFinished;
+
 	// cChunkCoordCallback override:
 	virtual void Call(int a_ChunkX, int a_ChunkZ)
 	{
@@ -185,6 +232,29 @@ protected:
 	}
 
 
+	/** Queues all the chunks of the area for loading without waiting for them, the ones closest to the spawn first. */
+	void QueueLazyLoad(void)
+	{
+		std::vector<std::pair<int, int>> Chunks;  // (distance, index) pairs
+		Chunks.reserve(static_cast<size_t>(m_MaxIdx));
+		for (int i = 0; i < m_MaxIdx; i++)
+		{
+			int ChunkX, ChunkZ;
+			DecodeChunkCoords(i, ChunkX, ChunkZ);
+			int DistX = ChunkX - m_SpawnChunkX;
+			int DistZ = ChunkZ - m_SpawnChunkZ;
+			Chunks.push_back(std::make_pair(DistX * DistX + DistZ * DistZ, i));
+		}
+		std::sort(Chunks.begin(), Chunks.end());
+		for (const auto & Chunk: Chunks)
+		{
+			int ChunkX, ChunkZ;
+			DecodeChunkCoords(Chunk.second, ChunkX, ChunkZ);
+			m_World.PrepareChunk(ChunkX, ChunkZ);
+		}
+	}
+
+
 	/** Decodes the index into chunk coords. Provides the specific chunk ordering. */
 	void DecodeChunkCoords(int a_Idx, int & a_ChunkX, int & a_ChunkZ)
 	{
@@ -232,23 +302,133 @@ cWorld::cTickThread::cTickThread(cWorld & a_World) :
 
 void cWorld::cTickThread::Execute(void)
 {
+	cTickReplayer * Replayer = cRoot::Get()->GetTickReplayer();
+	if ((Replayer != nullptr) && (&m_World == cRoot::Get()->GetDefaultWorld()))
+	{
+		ExecuteReplay(*Replayer);
+		return;
+	}
+
 	auto LastTime = std::chrono::steady_clock::now();
+	auto NextTickTime = LastTime;
 	auto TickTime = std::chrono::duration_cast<std::chrono::milliseconds>(cTickTime(1));
 
 	while (!m_ShouldTerminate)
 	{
 		auto NowTime = std::chrono::steady_clock::now();
 		auto WaitTime = std::chrono::duration_cast<std::chrono::milliseconds>(NowTime - LastTime);
+		if (m_World.m_TickPolicy == tpCatchUp)
+		{
+			// Each tick advances the world by exactly one tick, the late ticks are made up for by running them back-to-back:
+			WaitTime = std::chrono::duration_cast<std::chrono::milliseconds>(cTickTime(1));
+		}
 		m_World.Tick(WaitTime, TickTime);
-		TickTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - NowTime);
-		
-		if (TickTime < cTickTime(1))
+		auto EndTime = std::chrono::steady_clock::now();
+		TickTime = std::chrono::duration_cast<std::chrono::milliseconds>(EndTime - NowTime);
+		LastTime = NowTime;
+
+		if (m_World.m_TickPolicy != tpCatchUp)
 		{
-			// Stretch tick time until it's at least 1 tick
-			std::this_thread::sleep_for(cTickTime(1) - TickTime);
+			if (TickTime < cTickTime(1))
+			{
+				// Stretch tick time until it's at least 1 tick
+				std::this_thread::sleep_for(cTickTime(1) - TickTime);
+			}
+			continue;
 		}
 
-		LastTime = NowTime;
+		// Wait for the next scheduled tick; if it is already due, start it right away, unless the world is too far behind:
+		NextTickTime += cTickTime(1);
+		if (NextTickTime > EndTime)
+		{
+			std::this_thread::sleep_until(NextTickTime);
+			continue;
+		}
+		auto NumTicksBehind = static_cast<UInt64>((EndTime - NextTickTime) / cTickTime(1));
+		cCSLock Lock(m_World.m_CSTickDurationStats);
+		if (NumTicksBehind >= static_cast<UInt64>(m_World.m_MaxCatchUpTicks))
+		{
+			// Give up on the backlog, the world will run slower for a while:
+			NextTickTime = EndTime;
+			m_World.m_TickDurationStats.m_NumSkippedTicks += NumTicksBehind;
+		}
+		else
+		{
+			m_World.m_TickDurationStats.m_NumCatchUpTicks += 1;
+		}
+	}
+}
+
+
+
+
+
+void cWorld::cTickThread::ExecuteReplay(cTickReplayer & a_Replayer)
+{
+	cTickReplayer::sTick Tick;
+	while (!m_ShouldTerminate && a_Replayer.ReplayUntilTick(Tick))
+	{
+		m_World.m_TickRand.Seed(Tick.m_TickRandSeed);
+		cFastRandom::SetSeedCounter(Tick.m_FastRandomCounter);
+		auto Start = std::chrono::steady_clock::now();
+		m_World.Tick(Tick.m_Dt, Tick.m_LastTickDuration);
+		a_Replayer.AddTickDuration(std::chrono::steady_clock::now() - Start);
+	}
+	a_Replayer.Finish();
+
+	while (!m_ShouldTerminate)
+	{
+		std::this_thread::sleep_for(cTickTime(1));
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cWorld::sTickDurationStats:
+
+cWorld::sTickDurationStats::sTickDurationStats(void) :
+	m_NumTicks(0),
+	m_TotalMSec(0),
+	m_NumOverBudget(0),
+	m_NumCatchUpTicks(0),
+	m_NumSkippedTicks(0),
+	m_BudgetMSec(0),
+	m_DegradationLevel(0)
+{
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		m_BucketCounts[i] = 0;
+	}
+}
+
+
+
+
+
+int cWorld::sTickDurationStats::GetBucketBound(int a_Bucket)
+{
+	static const int Bounds[NUM_BUCKETS] = {10, 25, 50, 75, 100, 250, 500, 1000};
+	ASSERT((a_Bucket >= 0) && (a_Bucket < NUM_BUCKETS));
+	return Bounds[a_Bucket];
+}
+
+
+
+
+
+void cWorld::sTickDurationStats::Add(Int64 a_MSec)
+{
+	m_NumTicks += 1;
+	m_TotalMSec += static_cast<UInt64>(std::max<Int64>(a_MSec, 0));
+	for (int i = 0; i < NUM_BUCKETS; i++)
+	{
+		if (a_MSec <= GetBucketBound(i))
+		{
+			m_BucketCounts[i] += 1;
+		}
 	}
 }
 
@@ -269,6 +449,18 @@ cWorld::cWorld(const AString & a_WorldName, eDimension a_Dimension, const AStrin
 #else
 	m_StorageCompressionFactor(6),
 #endif
+	m_StorageCompression(ccZlib),
+	m_StorageMaxOpenRegionFiles(64),
+	m_StorageCompactionRate(256),
+	m_StorageChunkCacheSize(16),
+	m_StorageSectionCacheSize(16),
+	m_SaveInterval(300),
+	m_MaxSaveRate(4 * 1024 * 1024),
+	m_SaveBudget(0),
+	m_ChunkUnloadDelay(30),
+	m_MaxChunkUnloadsPerTick(4),
+	m_NumDirtyChunks(0),
+	m_OldestDirtyChunkAge(0),
 	m_Dimension(a_Dimension),
 	m_IsSpawnExplicitlySet(false),
 	m_SpawnX(0),
@@ -288,6 +480,7 @@ cWorld::cWorld(const AString & a_WorldName, eDimension a_Dimension, const AStrin
 	m_IsDeepSnowEnabled(false),
 	m_ShouldLavaSpawnFire(true),
 	m_VillagersShouldHarvestCrops(true),
+	m_BlockTickQueueTick(0),
 	m_SimulatorManager(),
 	m_SandSimulator(),
 	m_WaterSimulator(nullptr),
@@ -316,13 +509,42 @@ cWorld::cWorld(const AString & a_WorldName, eDimension a_Dimension, const AStrin
 	m_bUseChatPrefixes(false),
 	m_TNTShrapnelLevel(slNone),
 	m_MaxViewDistance(12),
+	m_SimulationDistance(8),
+	m_IsDynamicViewDistanceEnabled(true),
+	m_DynamicViewDistance(12),
+	m_MinDynamicViewDistance(4),
+	m_DynamicViewDistanceTargetTickMSec(40),
+	m_DynamicViewDistanceMaxSendBacklog(400),
+	m_DynamicViewDistanceTicks(0),
+	m_DynamicViewDistanceTotalMSec(0),
+	m_DynamicViewDistanceHealthyCount(0),
+	m_TickPolicy(tpStretch),
+	m_MaxCatchUpTicks(20),
+	m_TickBudgetMSec(50),
+	m_TickDegradationLevel(0),
+	m_MaxTickDegradationLevel(MAX_TICK_DEGRADATION_LEVEL),
+	m_TickDegradationTicks(0),
+	m_TickDegradationTotalMSec(0),
+	m_TickDegradationHealthyCount(0),
+	m_RandomTicksPerChunk(RANDOM_TICKS_PER_CHUNK),
+	m_WeatherDeferredTicks(0),
 	m_Scoreboard(this),
 	m_MapManager(this),
 	m_GeneratorCallbacks(*this),
-	m_TickThread(*this)
+	m_Pregenerator(*this),
+	m_TickThread(*this),
+	m_SnapshotInterval(0),
+	m_LastSnapshot(0),
+	m_IsChunkTickProfilingEnabled(false),
+	m_ColumnSummaries(a_WorldName + "/region", 4096),
+	m_MapTiles(a_WorldName + "/maptiles", 16)
 {
 	LOGD("cWorld::cWorld(\"%s\")", a_WorldName.c_str());
 
+	m_CSClients.SetName("cWorld::m_CSClients");
+	m_CSPlayers.SetName("cWorld::m_CSPlayers");
+	m_CSTasks.SetName("cWorld::m_CSTasks");
+
 	cFile::CreateFolder(FILE_IO_PREFIX + m_WorldName);
 
 	// Load the scoreboard
@@ -442,6 +664,35 @@ void cWorld::SetNextBlockTick(int a_BlockX, int a_BlockY, int a_BlockZ)
 
 
 void cWorld::InitializeSpawn(void)
+{
+	StartSpawnPreparation();
+	FinishSpawnPreparation();
+}
+
+
+
+
+
+void cWorld::StartSpawnPreparation(void)
+{
+	ASSERT(m_SpawnPrepare == nullptr);
+	m_SpawnPrepare.reset(new cSpawnPrepare(*this));
+}
+
+
+
+
+
+bool cWorld::IsSpawnPrepared(void) const
+{
+	return ((m_SpawnPrepare == nullptr) || m_SpawnPrepare->IsFinished());
+}
+
+
+
+
+
+void cWorld::InitializeSpawnPosition(int & a_SpawnChunkX, int & a_SpawnChunkZ, int & a_PrepareDistance, bool & a_IsAreaPrepared)
 {
 	if (!m_IsSpawnExplicitlySet)
 	{
@@ -455,8 +706,7 @@ void cWorld::InitializeSpawn(void)
 		IniFile.WriteFile(m_IniFileName);
 	}
 
-	int ChunkX = 0, ChunkZ = 0;
-	cChunkDef::BlockToChunk((int)m_SpawnX, (int)m_SpawnZ, ChunkX, ChunkZ);
+	cChunkDef::BlockToChunk((int)m_SpawnX, (int)m_SpawnZ, a_SpawnChunkX, a_SpawnChunkZ);
 	
 	// For the debugging builds, don't make the server build too much world upon start:
 	#if defined(_DEBUG) || defined(ANDROID_NDK)
@@ -466,11 +716,46 @@ void cWorld::InitializeSpawn(void)
 	#endif  // _DEBUG
 	cIniFile IniFile;
 	IniFile.ReadFile(m_IniFileName);
-	int ViewDist = IniFile.GetValueSetI("SpawnPosition", "PregenerateDistance", DefaultViewDist);
+	a_PrepareDistance = IniFile.GetValueSetI("SpawnPosition", "PregenerateDistance", DefaultViewDist);
 	IniFile.WriteFile(m_IniFileName);
 
-	cSpawnPrepare prep(*this, ChunkX, ChunkZ, ViewDist);
-	prep.Wait();
+	// The manifest written by MarkSpawnAreaPrepared() tells whether a previous run has prepared the very same area:
+	a_IsAreaPrepared = (
+		(a_PrepareDistance > 0) &&
+		(IniFile.GetValueI("SpawnPosition", "PreparedDistance", 0) == a_PrepareDistance) &&
+		(IniFile.GetValueI("SpawnPosition", "PreparedChunkX", 0) == a_SpawnChunkX) &&
+		(IniFile.GetValueI("SpawnPosition", "PreparedChunkZ", 0) == a_SpawnChunkZ)
+	);
+}
+
+
+
+
+
+void cWorld::MarkSpawnAreaPrepared(int a_SpawnChunkX, int a_SpawnChunkZ, int a_PrepareDistance)
+{
+	cIniFile IniFile;
+	IniFile.ReadFile(m_IniFileName);
+	IniFile.SetValueI("SpawnPosition", "PreparedChunkX", a_SpawnChunkX);
+	IniFile.SetValueI("SpawnPosition", "PreparedChunkZ", a_SpawnChunkZ);
+	IniFile.SetValueI("SpawnPosition", "PreparedDistance", a_PrepareDistance);
+	IniFile.WriteFile(m_IniFileName);
+}
+
+
+
+
+
+void cWorld::FinishSpawnPreparation(void)
+{
+	if (m_SpawnPrepare != nullptr)
+	{
+		m_SpawnPrepare->Wait();
+		m_SpawnPrepare.reset();
+	}
+
+	// Continue an interrupted pregeneration, if there was any:
+	m_Pregenerator.ResumeJob();
 	
 	#ifdef TEST_LINEBLOCKTRACER
 	// DEBUG: Test out the cLineBlockTracer class by tracing a few lines:
@@ -555,6 +840,50 @@ void cWorld::Start(void)
 	m_BroadcastAchievementMessages = IniFile.GetValueSetB("Broadcasting", "BroadcastAchievementMessages", true);
 
 	SetMaxViewDistance(IniFile.GetValueSetI("SpawnPosition", "MaxViewDistance", 12));
+	SetSimulationDistance(IniFile.GetValueSetI("SpawnPosition", "SimulationDistance", 8));
+	SetSnapshotInterval(IniFile.GetValueSetI("General", "SnapshotInterval", 0));
+	m_DynamicViewDistance = m_MaxViewDistance;
+	m_IsDynamicViewDistanceEnabled = IniFile.GetValueSetB("DynamicViewDistance", "Enabled", true);
+	m_MinDynamicViewDistance = Clamp(IniFile.GetValueSetI("DynamicViewDistance", "MinViewDistance", 4), cClientHandle::MIN_VIEW_DISTANCE, cClientHandle::MAX_VIEW_DISTANCE);
+	m_DynamicViewDistanceTargetTickMSec = std::max(IniFile.GetValueSetI("DynamicViewDistance", "TargetTickDurationMSec", 40), 1);
+	m_DynamicViewDistanceMaxSendBacklog = std::max(IniFile.GetValueSetI("DynamicViewDistance", "MaxChunkSendBacklog", 400), 1);
+	if (IniFile.FindKey("DynamicViewDistanceRankMinimums") < 0)
+	{
+		IniFile.AddKeyName("DynamicViewDistanceRankMinimums");
+		IniFile.AddKeyComment("DynamicViewDistanceRankMinimums", " The view distance that the players of each rank keep regardless of the load, as RankName=ViewDistance");
+	}
+	int RankMinKeyID = IniFile.FindKey("DynamicViewDistanceRankMinimums");
+	for (int i = 0, NumValues = IniFile.GetNumValues(RankMinKeyID); i < NumValues; i++)
+	{
+		int ViewDistance;
+		if (!StringToInteger(IniFile.GetValue(RankMinKeyID, i), ViewDistance))
+		{
+			LOGWARNING("%s: Invalid minimum view distance for rank \"%s\", ignoring.", m_IniFileName.c_str(), IniFile.GetValueName(RankMinKeyID, i).c_str());
+			continue;
+		}
+		m_RankMinViewDistances[IniFile.GetValueName(RankMinKeyID, i)] = Clamp(ViewDistance, cClientHandle::MIN_VIEW_DISTANCE, cClientHandle::MAX_VIEW_DISTANCE);
+	}
+
+	// The tick scheduling:
+	AString TickPolicy = IniFile.GetValueSet("TickScheduler", "Policy", "Stretch");
+	if (NoCaseCompare(TickPolicy, "CatchUp") == 0)
+	{
+		m_TickPolicy = tpCatchUp;
+	}
+	else if (NoCaseCompare(TickPolicy, "Stretch") != 0)
+	{
+		LOGWARNING("%s: Unknown tick scheduler policy \"%s\", using \"Stretch\" instead. Valid policies are \"Stretch\" and \"CatchUp\".",
+			m_IniFileName.c_str(), TickPolicy.c_str()
+		);
+		m_TickPolicy = tpStretch;
+	}
+	m_MaxCatchUpTicks = Clamp(IniFile.GetValueSetI("TickScheduler", "MaxCatchUpTicks", 20), 0, 1200);
+	m_TickBudgetMSec = std::max(IniFile.GetValueSetI("TickScheduler", "BudgetMSec", 50), 1);
+	m_MaxTickDegradationLevel = Clamp(IniFile.GetValueSetI("TickScheduler", "MaxDegradationLevel", MAX_TICK_DEGRADATION_LEVEL), 0, MAX_TICK_DEGRADATION_LEVEL);
+	{
+		cCSLock Lock(m_CSTickDurationStats);
+		m_TickDurationStats.m_BudgetMSec = m_TickBudgetMSec;
+	}
 
 	// Try to find the "SpawnPosition" key and coord values in the world configuration, set the flag if found
 	int KeyNum = IniFile.FindKey("SpawnPosition");
@@ -578,6 +907,18 @@ void cWorld::Start(void)
 
 	m_StorageSchema               = IniFile.GetValueSet ("Storage",       "Schema",                      m_StorageSchema);
 	m_StorageCompressionFactor    = IniFile.GetValueSetI("Storage",       "CompressionFactor",           m_StorageCompressionFactor);
+	AString StorageCompression    = IniFile.GetValueSet ("Storage",       "Compression",                 CompressionCodecToString(m_StorageCompression));
+	m_StorageMaxOpenRegionFiles   = IniFile.GetValueSetI("Storage",       "MaxOpenRegionFiles",          m_StorageMaxOpenRegionFiles);
+	m_StorageCompactionRate       = IniFile.GetValueSetI("Storage",       "CompactionRateKiBps",         m_StorageCompactionRate);
+	m_StorageChunkCacheSize       = IniFile.GetValueSetI("Storage",       "ChunkCacheMiB",               m_StorageChunkCacheSize);
+	m_StorageSectionCacheSize     = IniFile.GetValueSetI("Storage",       "SectionCacheMiB",             m_StorageSectionCacheSize);
+	m_SaveInterval                = IniFile.GetValueSetI("Storage",       "SaveInterval",                m_SaveInterval);
+	m_MaxSaveRate                 = IniFile.GetValueSetF("Storage",       "MaxSaveRateMBps",             m_MaxSaveRate / (1024 * 1024)) * 1024 * 1024;
+	m_ChunkUnloadDelay            = IniFile.GetValueSetI("Storage",       "ChunkUnloadDelay",            m_ChunkUnloadDelay);
+	m_MaxChunkUnloadsPerTick      = IniFile.GetValueSetI("Storage",       "MaxChunkUnloadsPerTick",      m_MaxChunkUnloadsPerTick);
+	int ColumnSummaryCacheSize    = IniFile.GetValueSetI("Storage",       "ColumnSummaryCacheChunks",    4096);
+	bool IsMapTilesEnabled        = IniFile.GetValueSetB("Storage",       "MapTilesEnabled",             true);
+	int MapTileCacheSize          = IniFile.GetValueSetI("Storage",       "MapTileCacheTiles",           16);
 	m_MaxCactusHeight             = IniFile.GetValueSetI("Plants",        "MaxCactusHeight",             3);
 	m_MaxSugarcaneHeight          = IniFile.GetValueSetI("Plants",        "MaxSugarcaneHeight",          3);
 	m_IsCactusBonemealable        = IniFile.GetValueSetB("Plants",        "IsCactusBonemealable",        false);
@@ -598,6 +939,19 @@ void cWorld::Start(void)
 	m_bEnabledPVP                 = IniFile.GetValueSetB("Mechanics",     "PVPEnabled",                  true);
 	m_bUseChatPrefixes            = IniFile.GetValueSetB("Mechanics",     "UseChatPrefixes",             true);
 	m_VillagersShouldHarvestCrops = IniFile.GetValueSetB("Monsters",      "VillagersShouldHarvestCrops", true);
+	for (size_t i = 0; i < ARRAYCOUNT(m_MobActivationRange); i++)
+	{
+		m_MobActivationRange[i] = 0;
+	}
+	m_MobActivationRange[cMonster::mfHostile] = IniFile.GetValueSetI("Monsters", "ActivationRangeHostile", 32);
+	m_MobActivationRange[cMonster::mfPassive] = IniFile.GetValueSetI("Monsters", "ActivationRangePassive", 32);
+	m_MobActivationRange[cMonster::mfAmbient] = IniFile.GetValueSetI("Monsters", "ActivationRangeAmbient", 16);
+	m_MobActivationRange[cMonster::mfWater]   = IniFile.GetValueSetI("Monsters", "ActivationRangeWater",   16);
+	m_EntityTrackingRange[etcPlayers]     = IniFile.GetValueSetI("EntityTracking", "PlayersRange",     0);
+	m_EntityTrackingRange[etcMobs]        = IniFile.GetValueSetI("EntityTracking", "MobsRange",        80);
+	m_EntityTrackingRange[etcItems]       = IniFile.GetValueSetI("EntityTracking", "ItemsRange",       64);
+	m_EntityTrackingRange[etcProjectiles] = IniFile.GetValueSetI("EntityTracking", "ProjectilesRange", 64);
+	m_EntityTrackingRange[etcOther]       = IniFile.GetValueSetI("EntityTracking", "OtherRange",       160);
 	m_IsDaylightCycleEnabled      = IniFile.GetValueSetB("General",       "IsDaylightCycleEnabled",      true);
 	int GameMode                  = IniFile.GetValueSetI("General",       "Gamemode",                    (int)m_GameMode);
 	int Weather                   = IniFile.GetValueSetI("General",       "Weather",                     (int)m_Weather);
@@ -616,16 +970,44 @@ void cWorld::Start(void)
 	m_GameMode         = (eGameMode)     Clamp(GameMode,         (int)gmSurvival, (int)gmSpectator);
 	m_TNTShrapnelLevel = (eShrapnelLevel)Clamp(TNTShrapnelLevel, (int)slNone,     (int)slAll);
 	m_Weather          = (eWeather)      Clamp(Weather,          (int)wSunny,     (int)wStorm);
+	m_SaveInterval     = std::max(m_SaveInterval, 1);
+	m_ChunkUnloadDelay = std::max(m_ChunkUnloadDelay, 0);
+	m_MaxChunkUnloadsPerTick = std::max(m_MaxChunkUnloadsPerTick, 1);
+	m_StorageMaxOpenRegionFiles = std::max(m_StorageMaxOpenRegionFiles, 1);
+	m_StorageCompactionRate = Clamp(m_StorageCompactionRate, 0, 1024 * 1024);
+	m_StorageChunkCacheSize = Clamp(m_StorageChunkCacheSize, 0, 4096);
+	m_StorageSectionCacheSize = Clamp(m_StorageSectionCacheSize, 0, 4096);
+	m_ColumnSummaries.SetMaxChunks(static_cast<size_t>(Clamp(ColumnSummaryCacheSize, 1, 1024 * 1024)));
+	m_MapTiles.SetEnabled(IsMapTilesEnabled);
+	m_MapTiles.SetMaxTiles(static_cast<size_t>(Clamp(MapTileCacheSize, 1, 1024)));
+	if (!StringToCompressionCodec(StorageCompression, m_StorageCompression))
+	{
+		LOGWARNING("%s: Unknown storage compression \"%s\", using \"%s\" instead.",
+			m_IniFileName.c_str(), StorageCompression.c_str(), CompressionCodecToString(m_StorageCompression).c_str()
+		);
+	}
 
 	InitialiseGeneratorDefaults(IniFile);
 	InitialiseAndLoadMobSpawningValues(IniFile);
 	SetTimeOfDay(IniFile.GetValueSetI("General", "TimeInTicks", GetTimeOfDay()));
 
-	m_ChunkMap = make_unique<cChunkMap>(this);
-	
-	// preallocate some memory for ticking blocks so we don't need to allocate that often
-	m_BlockTickQueue.reserve(1000);
-	m_BlockTickQueueCopy.reserve(1000);
+	// The chunk section memory:
+	AString SectionPages = IniFile.GetValueSet("ChunkMemory", "HugePages", "None");
+	eSlabPages SlabPages = spNormal;
+	if (NoCaseCompare(SectionPages, "Transparent") == 0)
+	{
+		SlabPages = spTransparentHuge;
+	}
+	else if (NoCaseCompare(SectionPages, "Explicit") == 0)
+	{
+		SlabPages = spExplicitHuge;
+	}
+	else if (NoCaseCompare(SectionPages, "None") != 0)
+	{
+		LOGWARNING("%s: Unknown [ChunkMemory].HugePages value \"%s\", using \"None\" instead.", m_IniFileName.c_str(), SectionPages.c_str());
+	}
+	bool ShouldAllocateSectionsInTickThread = IniFile.GetValueSetB("ChunkMemory", "AllocateInTickThread", false);
+	m_ChunkMap = make_unique<cChunkMap>(this, SlabPages, ShouldAllocateSectionsInTickThread);
 
 	// Simulators:
 	m_SimulatorManager  = make_unique<cSimulatorManager>(*this);
@@ -636,13 +1018,20 @@ void cWorld::Start(void)
 	m_RedstoneSimulator = InitializeRedstoneSimulator(IniFile);
 
 	// Water, Lava and Redstone simulators get registered in their initialize function.
-	m_SimulatorManager->RegisterSimulator(m_SandSimulator.get(), 1);
-	m_SimulatorManager->RegisterSimulator(m_FireSimulator.get(), 1);
+	m_SimulatorManager->RegisterSimulator(m_SandSimulator.get(), 1, "Sand");
+	m_SimulatorManager->RegisterSimulator(m_FireSimulator.get(), 1, "Fire");
 
-	m_Lighting.Start(this);
-	m_Storage.Start(this, m_StorageSchema, m_StorageCompressionFactor);
+	m_Lighting.Start(this, IniFile.GetValueSetI("Lighting", "NumThreads", 0));
+	m_Storage.Start(this, m_StorageSchema, m_StorageCompression, m_StorageCompressionFactor, static_cast<size_t>(m_StorageMaxOpenRegionFiles), m_StorageCompactionRate * 1024, static_cast<size_t>(m_StorageChunkCacheSize) * 1024 * 1024, static_cast<size_t>(m_StorageSectionCacheSize) * 1024 * 1024);
 	m_Generator.Start(m_GeneratorCallbacks, m_GeneratorCallbacks, IniFile);
-	m_ChunkSender.Start(this);
+	m_ChunkSender.Start(this, IniFile.GetValueSetI("ChunkSender", "MaxClientBytesPerSec", 1024 * 1024));
+
+	// Each world's tick thread may get its own CPUs, so that it doesn't compete with the other worlds or the background work:
+	AString TickThreadCPUs = IniFile.GetValueSet("Threading", "TickThreadCPUs", "");
+	if (!TickThreadCPUs.empty())
+	{
+		m_TickThread.SetCPUs(TickThreadCPUs);
+	}
 	m_TickThread.Start();
 
 	// Init of the spawn monster time (as they are supposed to have different spawn rate)
@@ -822,6 +1211,9 @@ void cWorld::InitialiseGeneratorDefaults(cIniFile & a_IniFile)
 			break;
 		}
 	}
+
+	// Keep the layouts generated by the structure generators in the world folder, so that they're not generated again after a restart:
+	a_IniFile.GetValueSet("Generator", "StructureCacheFolder", m_WorldName + "/structures");
 }
 
 
@@ -899,7 +1291,10 @@ void cWorld::Stop(void)
 		IniFile.SetValueI("General", "TimeInTicks", GetTimeOfDay());
 	IniFile.WriteFile(m_IniFileName);
 	
+	// The pregeneration needs all the other threads, stop it first:
+	m_Pregenerator.StopJob();
 	m_TickThread.Stop();
+	SetSnapshotInterval(0);
 	m_Lighting.Stop();
 	m_Generator.Stop();
 	m_ChunkSender.Stop();
@@ -911,9 +1306,43 @@ void cWorld::Stop(void)
 
 
 void cWorld::Tick(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDurationMSec)
+{
+	// Record the tick, reseeding the tick's random generators so that the replay can repeat them:
+	cTickRecorder & Recorder = cRoot::Get()->GetTickRecorder();
+	if (Recorder.IsRecording() && (this == cRoot::Get()->GetDefaultWorld()))
+	{
+		UInt32 Seed = static_cast<UInt32>(m_TickRand.randInt());
+		m_TickRand.Seed(Seed);
+		Recorder.RecordTick(a_Dt, a_LastTickDurationMSec, Seed, cFastRandom::GetSeedCounter());
+	}
+
+	{
+		cCSLock Lock(m_CSTickDurationStats);
+		m_TickDurationStats.Add(a_LastTickDurationMSec.count());
+		if (a_LastTickDurationMSec.count() > m_TickBudgetMSec)
+		{
+			m_TickDurationStats.m_NumOverBudget += 1;
+		}
+	}
+
+	{
+		cTickProfiler::cTimer TotalTimer(m_TickProfiler, cTickProfiler::catWorld, "Total");
+		TickPhases(a_Dt, a_LastTickDurationMSec);
+	}
+	m_TickProfiler.EndTick();
+}
+
+
+
+
+
+void cWorld::TickPhases(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDurationMSec)
 {
 	// Call the plugins
-	cPluginManager::Get()->CallHookWorldTick(*this, a_Dt, a_LastTickDurationMSec);
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Plugins");
+		cPluginManager::Get()->CallHookWorldTick(*this, a_Dt, a_LastTickDurationMSec);
+	}
 	
 	// Set any chunk data that has been queued for setting:
 	cSetChunkDataPtrs SetChunkDataQueue;
@@ -921,10 +1350,14 @@ void cWorld::Tick(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_La
 		cCSLock Lock(m_CSSetChunkDataQueue);
 		std::swap(SetChunkDataQueue, m_SetChunkDataQueue);
 	}
-	for (cSetChunkDataPtrs::iterator itr = SetChunkDataQueue.begin(), end = SetChunkDataQueue.end(); itr != end; ++itr)
+	if (!SetChunkDataQueue.empty())
 	{
-		SetChunkData(**itr);
-	}  // for itr - SetChunkDataQueue[]
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "SetChunkData");
+		for (cSetChunkDataPtrs::iterator itr = SetChunkDataQueue.begin(), end = SetChunkDataQueue.end(); itr != end; ++itr)
+		{
+			SetChunkData(**itr);
+		}  // for itr - SetChunkDataQueue[]
+	}
 
 	m_WorldAge += a_Dt;
 
@@ -961,42 +1394,302 @@ void cWorld::Tick(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_La
 		m_EntitiesToAdd.clear();
 	}
 
-	// Add players waiting in the queue to be added:
-	AddQueuedPlayers();
+	// Add players waiting in the queue to be added:
+	AddQueuedPlayers();
+
+	{
+		// Includes the chunks' entities (except mobs), block entities, block ticks and the simulators' per-chunk processing:
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "ChunkMap");
+		m_ChunkMap->Tick(a_Dt);
+	}
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "PlayerMoves");
+		CallQueuedPlayerMoves();
+	}
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Clients");
+		TickClients(static_cast<float>(a_Dt.count()));
+	}
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "QueuedBlocks");
+		TickQueuedBlocks();
+	}
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Tasks");
+		TickQueuedTasks();
+		TickScheduledTasks();
+	}
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Simulators");
+		GetSimulatorManager()->Simulate(static_cast<float>(a_Dt.count()));
+	}
+
+	// The weather is deferred while degraded, then ticked with all the deferred ticks at once:
+	m_WeatherDeferredTicks += 1;
+	if (m_WeatherDeferredTicks >= (1 << m_TickDegradationLevel))
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Weather");
+		TickWeather(m_WeatherDeferredTicks);
+		m_WeatherDeferredTicks = 0;
+	}
+	TickDynamicViewDistance(a_LastTickDurationMSec);
+	TickDegradation(a_LastTickDurationMSec);
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Snapshot");
+		TickSnapshot();
+	}
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "FastSetBlocks");
+		m_ChunkMap->FastSetQueuedBlocks();
+	}
+
+	if (m_WorldAge - m_LastSave >= std::chrono::seconds(1))  // Write-behind saving pass each second
+	{
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "SaveDirtyChunks");
+		SaveDirtyChunks();
+	}
+
+	{
+		// The chunks are queued for unloading as their last client or ChunkStay leaves; the rest are caught by a full pass every 5 minutes:
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "UnloadChunks");
+		if (m_WorldAge - m_LastUnload > std::chrono::minutes(5))
+		{
+			m_LastUnload = std::chrono::duration_cast<cTickTimeLong>(m_WorldAge);
+			m_ChunkMap->CollectUnloadCandidates();
+		}
+		m_ChunkMap->UnloadCandidateChunks(GetWorldAge(), static_cast<Int64>(m_ChunkUnloadDelay) * 20, static_cast<size_t>(m_MaxChunkUnloadsPerTick));
+	}
+
+	{
+		// Includes the mobs' ticking, also reported by the mobs' classes:
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Mobs");
+		TickMobs(a_Dt);
+	}
+
+	{
+		// The score changes are batched until the end of the tick:
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catWorld, "Scoreboard");
+		m_Scoreboard.FlushScoreUpdates();
+	}
+}
+
+
+
+
+
+void cWorld::TickSnapshot(void)
+{
+	cWorldSnapshotPtr Previous;
+	{
+		cCSLock Lock(m_CSSnapshot);
+		if ((m_SnapshotInterval <= 0) || (m_WorldAge - m_LastSnapshot < std::chrono::seconds(m_SnapshotInterval)))
+		{
+			return;
+		}
+		Previous = m_Snapshot;
+	}
+	m_LastSnapshot = std::chrono::duration_cast<cTickTimeLong>(m_WorldAge);
+
+	// Build the new snapshot without holding m_CSSnapshot, so that the readers can still get the previous one meanwhile:
+	std::shared_ptr<cWorldSnapshot> Snapshot = std::make_shared<cWorldSnapshot>((Previous == nullptr) ? 1 : Previous->GetNumber() + 1);
+	m_ChunkMap->CreateSnapshot(Previous.get(), *Snapshot);
+	Previous.reset();
+
+	cCSLock Lock(m_CSSnapshot);
+	if (m_SnapshotInterval > 0)
+	{
+		m_Snapshot = Snapshot;
+	}
+}
+
+
+
+
+
+cWorldSnapshotPtr cWorld::GetSnapshot(void)
+{
+	cCSLock Lock(m_CSSnapshot);
+	return m_Snapshot;
+}
+
+
+
+
+
+void cWorld::SetSnapshotInterval(int a_Seconds)
+{
+	cCSLock Lock(m_CSSnapshot);
+	m_SnapshotInterval = std::max(a_Seconds, 0);
+	if (m_SnapshotInterval == 0)
+	{
+		m_Snapshot.reset();
+	}
+}
+
+
+
+
+
+void cWorld::TickDynamicViewDistance(std::chrono::milliseconds a_LastTickDurationMSec)
+{
+	if (!m_IsDynamicViewDistanceEnabled)
+	{
+		return;
+	}
+
+	// Evaluate once per second's worth of ticks, using the average tick duration over that time:
+	m_DynamicViewDistanceTicks += 1;
+	m_DynamicViewDistanceTotalMSec += a_LastTickDurationMSec.count();
+	if (m_DynamicViewDistanceTicks < DYNAMIC_VIEW_DISTANCE_EVAL_TICKS)
+	{
+		return;
+	}
+	Int64 AvgTickMSec = m_DynamicViewDistanceTotalMSec / m_DynamicViewDistanceTicks;
+	m_DynamicViewDistanceTicks = 0;
+	m_DynamicViewDistanceTotalMSec = 0;
+	size_t SendBacklog = m_ChunkSender.GetQueueLength();
+
+	// Lower the view distance right away when overloaded, raise it only after the world has been well below the targets for a while:
+	int NewViewDistance = m_DynamicViewDistance;
+	if (
+		(AvgTickMSec > m_DynamicViewDistanceTargetTickMSec) ||
+		(SendBacklog > static_cast<size_t>(m_DynamicViewDistanceMaxSendBacklog))
+	)
+	{
+		m_DynamicViewDistanceHealthyCount = 0;
+		NewViewDistance = std::max(m_DynamicViewDistance - 1, m_MinDynamicViewDistance);
+	}
+	else if (
+		(AvgTickMSec * 4 < m_DynamicViewDistanceTargetTickMSec * 3) &&
+		(SendBacklog * 2 < static_cast<size_t>(m_DynamicViewDistanceMaxSendBacklog))
+	)
+	{
+		m_DynamicViewDistanceHealthyCount += 1;
+		if (m_DynamicViewDistanceHealthyCount >= DYNAMIC_VIEW_DISTANCE_HEALTHY_EVALS)
+		{
+			m_DynamicViewDistanceHealthyCount = 0;
+			NewViewDistance = std::min(m_DynamicViewDistance + 1, m_MaxViewDistance);
+		}
+	}
+	else
+	{
+		m_DynamicViewDistanceHealthyCount = 0;
+	}
+	if (NewViewDistance == m_DynamicViewDistance)
+	{
+		return;
+	}
+
+	LOGD("World \"%s\": %s the view distance to %d (average tick %lld msec, %u chunks waiting to be sent)",
+		m_WorldName.c_str(), (NewViewDistance < m_DynamicViewDistance) ? "Lowering" : "Raising", NewViewDistance,
+		static_cast<long long>(AvgTickMSec), static_cast<unsigned>(SendBacklog)
+	);
+	m_DynamicViewDistance = NewViewDistance;
+	cCSLock Lock(m_CSPlayers);
+	for (cPlayerList::iterator itr = m_Players.begin(); itr != m_Players.end(); ++itr)
+	{
+		cClientHandle * ch = (*itr)->GetClientHandle();
+		if ((ch == nullptr) || ch->IsDestroyed())
+		{
+			continue;
+		}
+		ch->UpdateViewDistance();
+	}
+}
+
+
+
+
+
+void cWorld::TickDegradation(std::chrono::milliseconds a_LastTickDurationMSec)
+{
+	if (m_MaxTickDegradationLevel == 0)
+	{
+		return;
+	}
+
+	// Evaluate once per second's worth of ticks, using the average tick duration over that time:
+	m_TickDegradationTicks += 1;
+	m_TickDegradationTotalMSec += a_LastTickDurationMSec.count();
+	if (m_TickDegradationTicks < TICK_DEGRADATION_EVAL_TICKS)
+	{
+		return;
+	}
+	Int64 AvgTickMSec = m_TickDegradationTotalMSec / m_TickDegradationTicks;
+	m_TickDegradationTicks = 0;
+	m_TickDegradationTotalMSec = 0;
+
+	// Degrade further right away when over the budget, recover only after the ticks have been well within the budget for a while:
+	int NewLevel = m_TickDegradationLevel;
+	if (AvgTickMSec > m_TickBudgetMSec)
+	{
+		m_TickDegradationHealthyCount = 0;
+		NewLevel = std::min(m_TickDegradationLevel + 1, m_MaxTickDegradationLevel);
+	}
+	else if (AvgTickMSec * 4 < m_TickBudgetMSec * 3)
+	{
+		m_TickDegradationHealthyCount += 1;
+		if (m_TickDegradationHealthyCount >= TICK_DEGRADATION_HEALTHY_EVALS)
+		{
+			m_TickDegradationHealthyCount = 0;
+			NewLevel = std::max(m_TickDegradationLevel - 1, 0);
+		}
+	}
+	else
+	{
+		m_TickDegradationHealthyCount = 0;
+	}
+	if (NewLevel == m_TickDegradationLevel)
+	{
+		return;
+	}
+
+	LOGD("World \"%s\": %s the tick degradation level to %d (average tick %lld msec, budget %d msec)",
+		m_WorldName.c_str(), (NewLevel > m_TickDegradationLevel) ? "Raising" : "Lowering", NewLevel,
+		static_cast<long long>(AvgTickMSec), m_TickBudgetMSec
+	);
+	SetTickDegradationLevel(NewLevel);
+}
 
-	m_ChunkMap->Tick(a_Dt);
 
-	TickClients(static_cast<float>(a_Dt.count()));
-	TickQueuedBlocks();
-	TickQueuedTasks();
-	TickScheduledTasks();
-	
-	GetSimulatorManager()->Simulate(static_cast<float>(a_Dt.count()));
 
-	TickWeather(static_cast<float>(a_Dt.count()));
 
-	m_ChunkMap->FastSetQueuedBlocks();
 
-	if (m_WorldAge - m_LastSave > std::chrono::minutes(5))  // Save each 5 minutes
-	{
-		SaveAllChunks();
-	}
+void cWorld::SetTickDegradationLevel(int a_Level)
+{
+	ASSERT((a_Level >= 0) && (a_Level <= MAX_TICK_DEGRADATION_LEVEL));
+	m_TickDegradationLevel = a_Level;
+
+	// The mob spawning and the weather check the level directly; levels 2 and up thin out the random ticks and the simulators:
+	int Divisor = 1 << std::max(a_Level - 1, 0);
+	m_RandomTicksPerChunk = RANDOM_TICKS_PER_CHUNK / Divisor;
+	m_SimulatorManager->SetRateMultiplier(Divisor);
+
+	cCSLock Lock(m_CSTickDurationStats);
+	m_TickDurationStats.m_DegradationLevel = a_Level;
+}
+
+
+
 
-	if (m_WorldAge - m_LastUnload > std::chrono::minutes(5))  // Unload every 10 seconds
+
+int cWorld::GetPlayerMaxViewDistance(const cPlayer & a_Player) const
+{
+	int ViewDistance = GetDynamicViewDistance();
+	std::map<AString, int>::const_iterator itr = m_RankMinViewDistances.find(a_Player.GetRank());
+	if (itr != m_RankMinViewDistances.end())
 	{
-		UnloadUnusedChunks();
+		ViewDistance = std::max(ViewDistance, std::min(itr->second, m_MaxViewDistance));
 	}
-
-	TickMobs(a_Dt);
+	return ViewDistance;
 }
 
 
 
 
 
-void cWorld::TickWeather(float a_Dt)
+void cWorld::TickWeather(int a_NumTicks)
 {
-	UNUSED(a_Dt);
 	// There are no weather changes anywhere but in the Overworld:
 	if (GetDimension() != dimOverworld)
 	{
@@ -1006,7 +1699,7 @@ void cWorld::TickWeather(float a_Dt)
 	if (m_WeatherInterval > 0)
 	{
 		// Not yet, wait for the weather period to end
-		m_WeatherInterval--;
+		m_WeatherInterval = std::max(m_WeatherInterval - a_NumTicks, 0);
 	}
 	else
 	{
@@ -1017,7 +1710,7 @@ void cWorld::TickWeather(float a_Dt)
 	if (m_Weather == eWeather_ThunderStorm)
 	{
 		// 0.5% chance per tick of thunderbolt
-		if (m_TickRand.randInt() % 199 == 0)
+		if (static_cast<int>(m_TickRand.randInt() % 199) < a_NumTicks)
 		{
 			CastThunderbolt(0, 0, 0);  // TODO: find random possitions near players to cast thunderbolts.
 		}
@@ -1036,9 +1729,9 @@ void cWorld::TickMobs(std::chrono::milliseconds a_Dt)
 	// before every Mob action, we have to count them depending on the distance to players, on their family ...
 	cMobCensus MobCensus;
 	m_ChunkMap->CollectMobCensus(MobCensus);
-	if (m_bAnimals)
+	if (m_bAnimals && (m_TickDegradationLevel == 0))
 	{
-		// Spawning is enabled, spawn now:
+		// Spawning is enabled and the world isn't overloaded, spawn now:
 		static const cMonster::eFamily AllFamilies[] =
 		{
 			cMonster::mfHostile,
@@ -1071,11 +1764,24 @@ void cWorld::TickMobs(std::chrono::milliseconds a_Dt)
 		}  // for i - AllFamilies[]
 	}  // if (Spawning enabled)
 
-	// move close mobs
+	// move close mobs; those beyond their family's activation range from all players only run their physics and timers
 	cMobProximityCounter::sIterablePair allCloseEnoughToMoveMobs = MobCensus.GetProximityCounter().getMobWithinThosesDistances(-1, 64 * 16);// MG TODO : deal with this magic number (the 16 is the size of a block)
 	for (cMobProximityCounter::tDistanceToMonster::const_iterator itr = allCloseEnoughToMoveMobs.m_Begin; itr != allCloseEnoughToMoveMobs.m_End; ++itr)
 	{
-		itr->second.m_Monster.Tick(a_Dt, itr->second.m_Chunk);
+		cMonster & Monster = static_cast<cMonster &>(itr->second.m_Monster);
+		double ActivationRange = m_MobActivationRange[Monster.GetMobFamily()];
+		Monster.SetIsActive((ActivationRange <= 0) || (itr->first <= ActivationRange * ActivationRange));  // The census distances are squared
+		cTickProfiler::cTimer Timer(m_TickProfiler, cTickProfiler::catEntity, Monster.GetClass());
+		if (m_IsChunkTickProfilingEnabled)
+		{
+			auto Start = std::chrono::steady_clock::now();
+			Monster.Tick(a_Dt, itr->second.m_Chunk);
+			itr->second.m_Chunk.AddTickCost(cChunkMap::sChunkTickCost::catEntities, Start);
+		}
+		else
+		{
+			Monster.Tick(a_Dt, itr->second.m_Chunk);
+		}
 	}
 
 	// remove too far mobs
@@ -1242,6 +1948,15 @@ void cWorld::WakeUpSimulatorsInArea(int a_MinBlockX, int a_MaxBlockX, int a_MinB
 
 
 
+void cWorld::WakeUpBlockEntitiesAround(int a_BlockX, int a_BlockY, int a_BlockZ)
+{
+	m_ChunkMap->WakeUpBlockEntitiesAround(a_BlockX, a_BlockY, a_BlockZ);
+}
+
+
+
+
+
 bool cWorld::ForEachBlockEntityInChunk(int a_ChunkX, int a_ChunkZ, cBlockEntityCallback & a_Callback)
 {
 	return m_ChunkMap->ForEachBlockEntityInChunk(a_ChunkX, a_ChunkZ, a_Callback);
@@ -1303,10 +2018,16 @@ void cWorld::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_Blo
 		return;
 	}
 	
-	// TODO: Implement block hardiness
+	// Merged primed TNTs (see cTNTEntity::GetCount()) explode all at once:
+	int NumExplosions = 1;
+	if ((a_Source == esPrimedTNT) && (a_SourceData != nullptr))
+	{
+		NumExplosions = std::max(static_cast<cTNTEntity *>(a_SourceData)->GetCount(), 1);
+	}
+	
 	Vector3d explosion_pos = Vector3d(a_BlockX, a_BlockY, a_BlockZ);
 	cVector3iArray BlocksAffected;
-	m_ChunkMap->DoExplosionAt(a_ExplosionSize, a_BlockX, a_BlockY, a_BlockZ, BlocksAffected);
+	m_ChunkMap->DoExplosionAt(a_ExplosionSize, a_BlockX, a_BlockY, a_BlockZ, BlocksAffected, NumExplosions);
 	BroadcastSoundEffect("random.explode", (double)a_BlockX, (double)a_BlockY, (double)a_BlockZ, 1.0f, 0.6f);
 
 	{
@@ -1500,9 +2221,8 @@ void cWorld::GrowTreeFromSapling(int a_X, int a_Y, int a_Z, NIBBLETYPE a_Sapling
 		case E_META_SAPLING_ACACIA:   GetAcaciaTreeImage (a_X, a_Y, a_Z, Noise, WorldAge, Logs, Other); break;
 		case E_META_SAPLING_DARK_OAK: GetDarkoakTreeImage(a_X, a_Y, a_Z, Noise, WorldAge, Logs, Other); break;
 	}
-	Other.insert(Other.begin(), Logs.begin(), Logs.end());
-	Logs.clear();
-	GrowTreeImage(Other);
+	Logs.insert(Logs.end(), Other.begin(), Other.end());
+	GrowTreeImage(Logs);
 }
 
 
@@ -1514,9 +2234,8 @@ void cWorld::GrowTreeByBiome(int a_X, int a_Y, int a_Z)
 	cNoise Noise(m_Generator.GetSeed());
 	sSetBlockVector Logs, Other;
 	GetTreeImageByBiome(a_X, a_Y, a_Z, Noise, (int)(std::chrono::duration_cast<cTickTimeLong>(m_WorldAge).count() & 0xffffffff), GetBiomeAt(a_X, a_Z), Logs, Other);
-	Other.insert(Other.begin(), Logs.begin(), Logs.end());
-	Logs.clear();
-	GrowTreeImage(Other);
+	Logs.insert(Logs.end(), Other.begin(), Other.end());
+	GrowTreeImage(Logs);
 }
 
 
@@ -1529,6 +2248,7 @@ void cWorld::GrowTreeImage(const sSetBlockVector & a_Blocks)
 	
 	// Make a copy of the log blocks:
 	sSetBlockVector b2;
+	b2.reserve(a_Blocks.size());
 	for (sSetBlockVector::const_iterator itr = a_Blocks.begin(); itr != a_Blocks.end(); ++itr)
 	{
 		if (itr->m_BlockType == E_BLOCK_LOG)
@@ -1872,6 +2592,15 @@ bool cWorld::GetBlockInfo(int a_BlockX, int a_BlockY, int a_BlockZ, BLOCKTYPE &
 
 
 
+bool cWorld::ReadBlockArea(cBlockArea & a_Area)
+{
+	return m_ChunkMap->ReadBlockArea(a_Area);
+}
+
+
+
+
+
 bool cWorld::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes)
 {
 	return m_ChunkMap->WriteBlockArea(a_Area, a_MinBlockX, a_MinBlockY, a_MinBlockZ, a_DataTypes);
@@ -1996,9 +2725,9 @@ UInt32 cWorld::SpawnPrimedTNT(double a_X, double a_Y, double a_Z, int a_FuseTick
 
 
 
-void cWorld::SetBlocks(const sSetBlockVector & a_Blocks)
+void cWorld::SetBlocks(const sSetBlockVector & a_Blocks, bool a_ShouldSkipPhysics)
 {
-	m_ChunkMap->SetBlocks(a_Blocks);
+	m_ChunkMap->SetBlocks(a_Blocks, a_ShouldSkipPhysics);
 }
 
 
@@ -2100,6 +2829,8 @@ void cWorld::BroadcastBlockEntity(int a_BlockX, int a_BlockY, int a_BlockZ, cons
 
 void cWorld::BroadcastChat(const AString & a_Message, const cClientHandle * a_Exclude, eMessageType a_ChatPrefix)
 {
+	// Map of protocol version -> the message serialized for it:
+	std::map<UInt32, AString> Serialized;
 	cCSLock Lock(m_CSPlayers);
 	for (cPlayerList::iterator itr = m_Players.begin(); itr != m_Players.end(); ++itr)
 	{
@@ -2108,7 +2839,16 @@ void cWorld::BroadcastChat(const AString & a_Message, const cClientHandle * a_Ex
 		{
 			continue;
 		}
-		ch->SendChat(a_Message, a_ChatPrefix);
+
+		// Serialize the message once per protocol version (the packet is never empty), then send the same data to all:
+		AString & Data = Serialized[ch->GetProtocolVersion()];
+		if (Data.empty())
+		{
+			ch->StartCapture(Data);
+			ch->SendChat(a_Message, a_ChatPrefix);
+			ch->StopCapture();
+		}
+		ch->SendCapturedData(Data.data(), Data.size());
 	}
 }
 
@@ -2118,6 +2858,8 @@ void cWorld::BroadcastChat(const AString & a_Message, const cClientHandle * a_Ex
 
 void cWorld::BroadcastChat(const cCompositeChat & a_Message, const cClientHandle * a_Exclude)
 {
+	// Map of protocol version -> the message serialized for it:
+	std::map<UInt32, AString> Serialized;
 	cCSLock Lock(m_CSPlayers);
 	for (cPlayerList::iterator itr = m_Players.begin(); itr != m_Players.end(); ++itr)
 	{
@@ -2126,7 +2868,16 @@ void cWorld::BroadcastChat(const cCompositeChat & a_Message, const cClientHandle
 		{
 			continue;
 		}
-		ch->SendChat(a_Message);
+
+		// Serialize the message once per protocol version (the packet is never empty), then send the same data to all:
+		AString & Data = Serialized[ch->GetProtocolVersion()];
+		if (Data.empty())
+		{
+			ch->StartCapture(Data);
+			ch->SendChat(a_Message);
+			ch->StopCapture();
+		}
+		ch->SendCapturedData(Data.data(), Data.size());
 	}
 }
 
@@ -2197,9 +2948,9 @@ void cWorld::BroadcastEntityLook(const cEntity & a_Entity, const cClientHandle *
 
 
 
-void cWorld::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+void cWorld::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude, int a_Fields)
 {
-	m_ChunkMap->BroadcastEntityMetadata(a_Entity, a_Exclude);
+	m_ChunkMap->BroadcastEntityMetadata(a_Entity, a_Exclude, a_Fields);
 }
 
 
@@ -2433,6 +3184,9 @@ void cWorld::BroadcastSpawnEntity(cEntity & a_Entity, const cClientHandle * a_Ex
 
 void cWorld::BroadcastTeleportEntity(const cEntity & a_Entity, const cClientHandle * a_Exclude)
 {
+	// The teleport must not overtake the entity's relative moves still queued in its chunk:
+	m_ChunkMap->SendPendingEntityMovements(a_Entity.GetChunkX(), a_Entity.GetChunkZ());
+
 	cCSLock Lock(m_CSPlayers);
 	for (cPlayerList::iterator itr = m_Players.begin(); itr != m_Players.end(); ++itr)
 	{
@@ -2659,6 +3413,28 @@ bool cWorld::IsChunkValid(int a_ChunkX, int a_ChunkZ) const
 
 
 
+int cWorld::GetChunkBlockCount(int a_ChunkX, int a_ChunkZ, eBlockCategory a_Category)
+{
+	return m_ChunkMap->GetChunkBlockCount(a_ChunkX, a_ChunkZ, -1, a_Category);
+}
+
+
+
+
+
+int cWorld::GetChunkSectionBlockCount(int a_ChunkX, int a_ChunkZ, int a_SectionIdx, eBlockCategory a_Category)
+{
+	if (a_SectionIdx < 0)
+	{
+		return -1;
+	}
+	return m_ChunkMap->GetChunkBlockCount(a_ChunkX, a_ChunkZ, a_SectionIdx, a_Category);
+}
+
+
+
+
+
 bool cWorld::HasChunkAnyClients(int a_ChunkX, int a_ChunkZ) const
 {
 	return m_ChunkMap->HasChunkAnyClients(a_ChunkX, a_ChunkZ);
@@ -2687,6 +3463,24 @@ void cWorld::QueueUnloadUnusedChunks(void)
 
 
 
+bool cWorld::StartPregeneration(int a_MinChunkX, int a_MinChunkZ, int a_MaxChunkX, int a_MaxChunkZ, int a_MaxInFlight)
+{
+	return m_Pregenerator.StartJob(a_MinChunkX, a_MinChunkZ, a_MaxChunkX, a_MaxChunkZ, a_MaxInFlight);
+}
+
+
+
+
+
+void cWorld::StopPregeneration(bool a_ShouldResume)
+{
+	m_Pregenerator.StopJob(a_ShouldResume);
+}
+
+
+
+
+
 void cWorld::CollectPickupsByPlayer(cPlayer & a_Player)
 {
 	m_ChunkMap->CollectPickupsByPlayer(a_Player);
@@ -2706,6 +3500,49 @@ void cWorld::AddPlayer(cPlayer * a_Player)
 
 
 
+void cWorld::QueuePlayerMove(cPlayer & a_Player, const Vector3d & a_OldPosition, const Vector3d & a_NewPosition)
+{
+	m_PlayerMoves.emplace_back(&a_Player, a_OldPosition, a_NewPosition);
+}
+
+
+
+
+
+void cWorld::CallQueuedPlayerMoves(void)
+{
+	if (m_PlayerMoves.empty())
+	{
+		return;
+	}
+
+	// A player may have been removed, or even deleted, while ticking the entities after its move has been queued.
+	// Only deliver the moves of the players still in the world:
+	{
+		cCSLock Lock(m_CSPlayers);
+		std::unordered_set<const cPlayer *> Players(m_Players.begin(), m_Players.end());
+		m_PlayerMoves.erase(
+			std::remove_if(m_PlayerMoves.begin(), m_PlayerMoves.end(),
+				[&](const cPluginManager::sPlayerMove & a_Move)
+				{
+					return (Players.find(a_Move.m_Player) == Players.end());
+				}
+			),
+			m_PlayerMoves.end()
+		);
+	}
+
+	if (!m_PlayerMoves.empty())
+	{
+		cPluginManager::Get()->CallHookPlayersMoved(*this, m_PlayerMoves);
+	}
+	m_PlayerMoves.clear();
+}
+
+
+
+
+
 void cWorld::RemovePlayer(cPlayer * a_Player, bool a_RemoveFromChunk)
 {
 	if (a_RemoveFromChunk)
@@ -2722,6 +3559,7 @@ void cWorld::RemovePlayer(cPlayer * a_Player, bool a_RemoveFromChunk)
 		cCSLock Lock(m_CSPlayers);
 		LOGD("Removing player %s from world \"%s\"", a_Player->GetName().c_str(), m_WorldName.c_str());
 		m_Players.remove(a_Player);
+		m_PlayerProximityIndex.Remove(*a_Player);
 	}
 	
 	// Remove the player's client from the list of clients to be ticked:
@@ -2829,35 +3667,37 @@ bool cWorld::DoWithPlayerByUUID(const AString & a_PlayerUUID, cPlayerListCallbac
 // TODO: This interface is dangerous!
 cPlayer * cWorld::FindClosestPlayer(const Vector3d & a_Pos, float a_SightLimit, bool a_CheckLineOfSight)
 {
-	cTracer LineOfSight(this);
-
-	double ClosestDistance = a_SightLimit;
-	cPlayer * ClosestPlayer = nullptr;
-
-	cCSLock Lock(m_CSPlayers);
-	for (cPlayerList::const_iterator itr = m_Players.begin(); itr != m_Players.end(); ++itr)
+	if (!a_CheckLineOfSight)
 	{
-		Vector3f Pos = (*itr)->GetPosition();
-		double Distance = (Pos - a_Pos).Length();
+		return m_PlayerProximityIndex.FindClosest(a_Pos, a_SightLimit);
+	}
 
-		if (Distance < ClosestDistance)
+	// Trace the line of sight to the players in the order of their distance, the first one visible is the closest:
+	cPlayerProximityIndex::cPlayerDistances Players;
+	m_PlayerProximityIndex.GetPlayersInRadius(a_Pos, a_SightLimit, Players);
+	if (Players.empty())
+	{
+		return nullptr;
+	}
+	std::vector<Vector3d> PlayerPositions;
+	PlayerPositions.reserve(Players.size());
+	for (const auto & Player: Players)
+	{
+		PlayerPositions.push_back(Player.m_Pos);
+	}
+	std::vector<bool> CanSee;
+	if (cLineBlockTracer::LineOfSightTraces(*this, a_Pos, PlayerPositions, CanSee) == 0)
+	{
+		return nullptr;
+	}
+	for (size_t i = 0; i < Players.size(); i++)
+	{
+		if (CanSee[i])
 		{
-			if (a_CheckLineOfSight)
-			{
-				if (!LineOfSight.Trace(a_Pos, (Pos - a_Pos), (int)(Pos - a_Pos).Length()))
-				{
-					ClosestDistance = Distance;
-					ClosestPlayer = *itr;
-				}
-			}
-			else
-			{
-				ClosestDistance = Distance;
-				ClosestPlayer = *itr;
-			}
+			return Players[i].m_Player;
 		}
 	}
-	return ClosestPlayer;
+	return nullptr;
 }
 
 
@@ -2996,6 +3836,15 @@ void cWorld::RemoveClientFromChunkSender(cClientHandle * a_Client)
 
 
 
+void cWorld::CancelSendChunksTo(const cChunkCoordsList & a_Chunks, cClientHandle * a_Client)
+{
+	m_ChunkSender.CancelSendChunksTo(a_Chunks, a_Client);
+}
+
+
+
+
+
 void cWorld::TouchChunk(int a_ChunkX, int a_ChunkZ)
 {
 	m_ChunkMap->TouchChunk(a_ChunkX, a_ChunkZ);
@@ -3005,6 +3854,15 @@ void cWorld::TouchChunk(int a_ChunkX, int a_ChunkZ)
 
 
 
+void cWorld::PrefetchChunks(const cChunkCoordsVector & a_Chunks)
+{
+	m_Storage.QueuePrefetchChunks(a_Chunks);
+}
+
+
+
+
+
 void cWorld::PrepareChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallback * a_CallAfter)
 {
 	m_ChunkMap->PrepareChunk(a_ChunkX, a_ChunkZ, a_CallAfter);
@@ -3168,6 +4026,45 @@ void cWorld::SaveAllChunks(void)
 
 
 
+void cWorld::SaveDirtyChunks(void)
+{
+	// The average chunk size to assume until the storage has saved some chunks:
+	static const size_t DEFAULT_CHUNK_SAVE_SIZE = 8 * 1024;
+
+	double Elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(m_WorldAge - m_LastSave).count();
+	m_LastSave = std::chrono::duration_cast<cTickTimeLong>(m_WorldAge);
+
+	// Refill the budget, letting at most a second's worth of it accumulate:
+	m_SaveBudget = std::min(m_SaveBudget + m_MaxSaveRate * Elapsed, m_MaxSaveRate);
+
+	// Work out how many chunks fit into the budget; don't queue any while the storage is still busy with the previous ones:
+	size_t MaxChunks = 0;
+	double ChunkSize = static_cast<double>(m_Storage.GetAverageChunkSaveSize(DEFAULT_CHUNK_SAVE_SIZE));
+	if (m_Storage.GetSaveQueueLength() == 0)
+	{
+		if (m_MaxSaveRate <= 0)
+		{
+			MaxChunks = std::numeric_limits<size_t>::max();
+		}
+		else if (m_SaveBudget > 0)
+		{
+			MaxChunks = static_cast<size_t>(std::ceil(m_SaveBudget / ChunkSize));
+		}
+	}
+
+	// Chunks modified in the last half of the interval are left to accumulate more changes, unless they can be unloaded:
+	Int64 Interval = static_cast<Int64>(m_SaveInterval) * 20;
+	size_t NumQueued = m_ChunkMap->SaveDirtyChunks(GetWorldAge(), Interval / 2, Interval, MaxChunks, m_NumDirtyChunks, m_OldestDirtyChunkAge);
+	if (m_MaxSaveRate > 0)
+	{
+		m_SaveBudget -= static_cast<double>(NumQueued) * ChunkSize;
+	}
+}
+
+
+
+
+
 void cWorld::QueueSaveAllChunks(void)
 {
 	QueueTask(std::make_shared<cWorld::cTaskSaveAllChunks>());
@@ -3276,30 +4173,148 @@ void cWorld::GetChunkStats(int & a_NumValid, int & a_NumDirty, int & a_NumInLigh
 
 
 
-void cWorld::TickQueuedBlocks(void)
+void cWorld::GetGeneratorStats(AStringVector & a_Lines)
+{
+	cChunkGenerator::cStats Stats;
+	m_Generator.GetStats(Stats);
+	Stats.GetReport(a_Lines);
+}
+
+
+
+
+
+AString cWorld::GetGeneratorStatsReport(void)
 {
-	if (m_BlockTickQueue.empty())
+	AStringVector Lines;
+	GetGeneratorStats(Lines);
+	AString res;
+	for (const auto & Line : Lines)
 	{
-		return;
+		res.append(Line);
+		res.push_back('\n');
 	}
-	m_BlockTickQueueCopy.clear();
-	m_BlockTickQueue.swap(m_BlockTickQueueCopy);
+	return res;
+}
+
+
+
+
 
-	for (std::vector<BlockTickQueueItem *>::iterator itr = m_BlockTickQueueCopy.begin(); itr != m_BlockTickQueueCopy.end(); ++itr)
+void cWorld::GetSectionPoolStats(size_t & a_NumAllocated, size_t & a_NumFree, size_t & a_NumReserveInUse)
+{
+	m_ChunkMap->GetSectionPoolStats(a_NumAllocated, a_NumFree, a_NumReserveInUse);
+}
+
+
+
+
+
+int cWorld::GetEntityTrackingRange(const cEntity & a_Entity) const
+{
+	if (a_Entity.IsPlayer())
 	{
-		BlockTickQueueItem * Block = (*itr);
-		Block->TicksToWait -= 1;
-		if (Block->TicksToWait <= 0)
-		{
-			// TODO: Handle the case when the chunk is already unloaded
-			m_ChunkMap->TickBlock(Block->X, Block->Y, Block->Z);
-			delete Block;  // We don't have to remove it from the vector, this will happen automatically on the next tick
-		}
-		else
-		{
-			m_BlockTickQueue.push_back(Block);  // Keep the block in the queue
-		}
-	}  // for itr - m_BlockTickQueueCopy[]
+		return m_EntityTrackingRange[etcPlayers];
+	}
+	if (a_Entity.IsMob())
+	{
+		return m_EntityTrackingRange[etcMobs];
+	}
+	if (a_Entity.IsPickup() || a_Entity.IsExpOrb())
+	{
+		return m_EntityTrackingRange[etcItems];
+	}
+	if (a_Entity.IsProjectile())
+	{
+		return m_EntityTrackingRange[etcProjectiles];
+	}
+	return m_EntityTrackingRange[etcOther];
+}
+
+
+
+
+
+cWorld::sMemoryStats::sMemoryStats(void) :
+	m_SectionPoolBytes(0),
+	m_SerializationCacheItems(0),
+	m_SerializationCacheBytes(0),
+	m_GeneratorCacheBytes(0),
+	m_ClientBufferBytes(0)
+{
+}
+
+
+
+
+
+void cWorld::GetMemoryStats(sMemoryStats & a_Stats)
+{
+	m_ChunkMap->GetMemoryStats(a_Stats.m_Chunks);
+
+	size_t NumAllocated, NumFree, NumReserveInUse;
+	m_ChunkMap->GetSectionPoolStats(NumAllocated, NumFree, NumReserveInUse);
+	a_Stats.m_SectionPoolBytes = (NumAllocated + NumFree) * sizeof(cChunkData::sChunkSection);
+
+	m_ChunkSender.GetSerializationCacheStats(a_Stats.m_SerializationCacheItems, a_Stats.m_SerializationCacheBytes);
+
+	cChunkGenerator::cStats GenStats;
+	m_Generator.GetStats(GenStats);
+	a_Stats.m_GeneratorCacheBytes = GenStats.GetCacheMemory();
+
+	a_Stats.m_ClientBufferBytes = 0;
+	cCSLock Lock(m_CSClients);
+	for (const auto & Client: m_Clients)
+	{
+		a_Stats.m_ClientBufferBytes += Client->GetOutgoingDataSize();
+	}
+}
+
+
+
+
+
+void cWorld::GetTopChunkTickCosts(size_t a_Count, std::vector<cChunkMap::sChunkTickCost> & a_Costs)
+{
+	m_ChunkMap->GetTopChunkTickCosts(a_Count, a_Costs);
+}
+
+
+
+
+
+void cWorld::ResetChunkTickCosts(void)
+{
+	m_ChunkMap->ResetChunkTickCosts();
+}
+
+
+
+
+
+void cWorld::GetTickDurationStats(sTickDurationStats & a_Stats)
+{
+	cCSLock Lock(m_CSTickDurationStats);
+	a_Stats = m_TickDurationStats;
+}
+
+
+
+
+
+void cWorld::TickQueuedBlocks(void)
+{
+	m_BlockTickQueueTick += 1;
+
+	// The blocks queued while ticking are due in a later tick at the soonest, so this loop always terminates:
+	while (!m_BlockTickQueue.empty() && (m_BlockTickQueue.top().TargetTick <= m_BlockTickQueueTick))
+	{
+		BlockTickQueueItem Block = m_BlockTickQueue.top();
+		m_BlockTickQueue.pop();
+
+		// TODO: Handle the case when the chunk is already unloaded
+		m_ChunkMap->TickBlock(Block.X, Block.Y, Block.Z);
+	}
 }
 
 
@@ -3308,13 +4323,13 @@ void cWorld::TickQueuedBlocks(void)
 
 void cWorld::QueueBlockForTick(int a_BlockX, int a_BlockY, int a_BlockZ, int a_TicksToWait)
 {
-	BlockTickQueueItem * Block = new BlockTickQueueItem;
-	Block->X = a_BlockX;
-	Block->Y = a_BlockY;
-	Block->Z = a_BlockZ;
-	Block->TicksToWait = a_TicksToWait;
+	BlockTickQueueItem Block;
+	Block.X = a_BlockX;
+	Block.Y = a_BlockY;
+	Block.Z = a_BlockZ;
+	Block.TargetTick = m_BlockTickQueueTick + std::max(a_TicksToWait, 1);  // Blocks are ticked in the next tick at the soonest
 	
-	m_BlockTickQueue.push_back(Block);
+	m_BlockTickQueue.push(Block);
 }
 
 
@@ -3488,7 +4503,7 @@ cRedstoneSimulator * cWorld::InitializeRedstoneSimulator(cIniFile & a_IniFile)
 		res = new cRedstoneNoopSimulator(*this);
 	}
 	
-	m_SimulatorManager->RegisterSimulator(res, 1);
+	m_SimulatorManager->RegisterSimulator(res, 1, "Redstone");
 	
 	return res;
 }
@@ -3557,7 +4572,7 @@ cFluidSimulator * cWorld::InitializeFluidSimulator(cIniFile & a_IniFile, const c
 		}
 	}
 	
-	m_SimulatorManager->RegisterSimulator(res, Rate);
+	m_SimulatorManager->RegisterSimulator(res, Rate, a_FluidName);
 
 	return res;
 }
@@ -3587,6 +4602,7 @@ void cWorld::AddQueuedPlayers(void)
 			LOGD("Adding player %s to world \"%s\".", (*itr)->GetName().c_str(), m_WorldName.c_str());
 
 			m_Players.push_back(*itr);
+			m_PlayerProximityIndex.Add(**itr, (*itr)->GetPosition());
 			(*itr)->SetWorld(this);
 
 			// Add to chunkmap, if not already there (Spawn vs MoveToWorld):
@@ -3615,7 +4631,7 @@ void cWorld::AddQueuedPlayers(void)
 		{
 			Client->SendPlayerMoveLook();
 			Client->SendHealth();
-			Client->SendWholeInventory(*(*itr)->GetWindow());
+			(*itr)->GetWindow()->SendWholeWindow(*Client);
 		}
 	}  // for itr - PlayersToAdd[]
 }
@@ -3708,8 +4724,10 @@ void cWorld::cChunkGeneratorCallbacks::OnChunkGenerated(cChunkDesc & a_ChunkDesc
 	cChunkDef::BlockNibbles BlockMetas;
 	a_ChunkDesc.CompressBlockMetas(BlockMetas);
 
+	// Convert the data into the chunk's section storage here in the generator thread, the tick thread then only moves it into the chunk:
 	cSetChunkDataPtr SetChunkData(new cSetChunkData(
 		a_ChunkDesc.GetChunkX(), a_ChunkDesc.GetChunkZ(),
+		m_World->GetChunkMap()->GetSectionPool(),
 		a_ChunkDesc.GetBlockTypes(), BlockMetas,
 		nullptr, nullptr,  // We don't have lighting, chunk will be lighted when needed
 		&a_ChunkDesc.GetHeightMap(), &a_ChunkDesc.GetBiomeMap(),
@@ -3742,9 +4760,18 @@ bool cWorld::cChunkGeneratorCallbacks::IsChunkQueued(int a_ChunkX, int a_ChunkZ)
 
 
 
-bool cWorld::cChunkGeneratorCallbacks::HasChunkAnyClients(int a_ChunkX, int a_ChunkZ)
+int cWorld::cChunkGeneratorCallbacks::GetChunkPriority(int a_ChunkX, int a_ChunkZ)
+{
+	return m_World->GetChunkMap()->GetChunkGenerationPriority(a_ChunkX, a_ChunkZ);
+}
+
+
+
+
+
+void cWorld::cChunkGeneratorCallbacks::OnChunkSkipped(int a_ChunkX, int a_ChunkZ)
 {
-	return m_World->HasChunkAnyClients(a_ChunkX, a_ChunkZ);
+	m_World->GetChunkMap()->ChunkGenerationSkipped(a_ChunkX, a_ChunkZ);
 }
 
 
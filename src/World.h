@@ -12,11 +12,14 @@
 #include "Simulator/SimulatorManager.h"
 #include "ChunkMap.h"
 #include "WorldStorage/WorldStorage.h"
+#include "WorldStorage/ColumnSummaryCache.h"
+#include "WorldStorage/MapTileCache.h"
 #include "Generating/ChunkGenerator.h"
 #include "Vector3.h"
 #include "ChunkSender.h"
 #include "Defines.h"
 #include "LightingThread.h"
+#include "Pregenerator.h"
 #include "Item.h"
 #include "Mobs/Monster.h"
 #include "Entities/ProjectileEntity.h"
@@ -27,6 +30,11 @@
 #include "Blocks/BroadcastInterface.h"
 #include "FastRandom.h"
 #include "ClientHandle.h"
+#include "Bindings/PluginManager.h"
+#include "TickProfiler.h"
+#include "PlayerProximityIndex.h"
+#include "ChunkSnapshot.h"
+#include <atomic>
 
 
 
@@ -44,6 +52,7 @@ typedef std::list<cClientHandle *> cClientHandles;
 class cEntity;
 class cBlockEntity;
 class cWorldGenerator;  // The generator that actually generates the chunks for a single world
+class cSpawnPrepare;
 class cChunkGenerator;  // The thread responsible for generating chunks
 class cBeaconEntity;
 class cChestEntity;
@@ -56,6 +65,7 @@ class cCompositeChat;
 class cCuboid;
 class cSetChunkData;
 class cBroadcaster;
+class cTickReplayer;
 
 
 typedef std::list< cPlayer * > cPlayerList;
@@ -238,7 +248,11 @@ public:
 	void BroadcastEntityEquipment            (const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityHeadLook             (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityLook                 (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
-	void BroadcastEntityMetadata             (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr);
+
+	/** Sends the entity's metadata to the clients tracking it. a_Fields is an eEntityMetadataFields bitmask of the changed fields,
+	only those get sent. Sent batched with the entity's chunk's other entity updates, repeated updates within a tick are sent only once. */
+	void BroadcastEntityMetadata             (const cEntity & a_Entity, const cClientHandle * a_Exclude = nullptr, int a_Fields = emfAll);
+
 	void BroadcastEntityRelMove              (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityRelMoveLook          (const cEntity & a_Entity, char a_RelX, char a_RelY, char a_RelZ, const cClientHandle * a_Exclude = nullptr);
 	void BroadcastEntityStatus               (const cEntity & a_Entity, char a_Status, const cClientHandle * a_Exclude = nullptr);
@@ -296,10 +310,37 @@ public:
 	/** Returns true iff the chunk is present and valid. */
 	bool IsChunkValid(int a_ChunkX, int a_ChunkZ) const;
 
+	/** Returns the number of blocks of the category (bcNonAir, bcLightSource, ...) in the chunk, without walking the blocks.
+	Returns -1 if the chunk isn't loaded. */
+	int GetChunkBlockCount(int a_ChunkX, int a_ChunkZ, eBlockCategory a_Category);  // tolua_export
+
+	/** Returns the number of blocks of the category in the specified 16-block-high section of the chunk, 0 being the bottom one.
+	Returns -1 if the chunk isn't loaded or the section index is out of range. */
+	int GetChunkSectionBlockCount(int a_ChunkX, int a_ChunkZ, int a_SectionIdx, eBlockCategory a_Category);  // tolua_export
+
 	bool HasChunkAnyClients(int a_ChunkX, int a_ChunkZ) const;
 	
 	/** Queues a task to unload unused chunks onto the tick thread. The prefferred way of unloading*/
 	void QueueUnloadUnusedChunks(void);  // tolua_export
+
+	/** Queues the player's movement to be delivered to the plugins via HOOK_PLAYERS_MOVED, together with all the other
+	movements in this tick, once all the entities have been ticked. Must be called from the tick thread. */
+	void QueuePlayerMove(cPlayer & a_Player, const Vector3d & a_OldPosition, const Vector3d & a_NewPosition);
+
+	/** Starts generating and lighting all the chunks in the specified area (inclusive) in the background,
+	with at most a_MaxInFlight chunks in process at once; 0 chooses the number based on the generator and lighting worker threads.
+	An interrupted job resumes when the world starts again.
+	Returns false if the area is invalid or a pregeneration is already running. */
+	bool StartPregeneration(int a_MinChunkX, int a_MinChunkZ, int a_MaxChunkX, int a_MaxChunkZ, int a_MaxInFlight);  // tolua_export
+
+	/** Stops the running pregeneration; if a_ShouldResume is true, it resumes when the world starts again. */
+	void StopPregeneration(bool a_ShouldResume);  // tolua_export
+
+	/** Returns true if a pregeneration is running */
+	bool IsPregenerating(void) const { return m_Pregenerator.IsRunning(); }  // tolua_export
+
+	/** Returns a one-line description of the pregeneration's progress */
+	AString GetPregenerationStatus(void) { return m_Pregenerator.GetStatus(); }  // tolua_export
 	
 	void CollectPickupsByPlayer(cPlayer & a_Player);
 
@@ -378,9 +419,16 @@ public:
 	/** Removes client from ChunkSender's queue of chunks to be sent */
 	void RemoveClientFromChunkSender(cClientHandle * a_Client);
 	
+	/** Removes the specified chunks from ChunkSender's queue of chunks to be sent to the client */
+	void CancelSendChunksTo(const cChunkCoordsList & a_Chunks, cClientHandle * a_Client);
+	
 	/** Touches the chunk, causing it to be loaded or generated */
 	void TouchChunk(int a_ChunkX, int a_ChunkZ);
 
+	/** Hints the storage that the chunks are likely to be needed soon, so that it reads them ahead in the background.
+	Doesn't load the chunks, only makes their later loading faster. */
+	void PrefetchChunks(const cChunkCoordsVector & a_Chunks);
+
 	/** Queues the chunk for preparing - making sure that it's generated and lit.
 	The specified chunk is queued to be loaded or generated, and lit if needed.
 	The specified callback is called after the chunk has been prepared. If there's no preparation to do, only the callback is called.
@@ -468,6 +516,11 @@ public:
 	void       SetBlockMeta(const Vector3i & a_Pos, NIBBLETYPE a_MetaData) { SetBlockMeta( a_Pos.x, a_Pos.y, a_Pos.z, a_MetaData); }
 	// tolua_end
 	
+	/** Reads the blocks into the block area, whose origin, size and datatypes have already been set.
+	Returns true if all chunks have been processed.
+	Prefer cBlockArea::Read() instead, this is the internal implementation; cBlockArea does error checking, too. */
+	virtual bool ReadBlockArea(cBlockArea & a_Area) override;
+
 	/** Writes the block area into the specified coords.
 	Returns true if all chunks have been processed.
 	Prefer cBlockArea::Write() instead, this is the internal implementation; cBlockArea does error checking, too.
@@ -503,9 +556,10 @@ public:
 	// tolua_end
 
 	/** Performs the specified single-block set operations simultaneously, as if SetBlock() was called for each item.
-	Is more efficient than calling SetBlock() multiple times.
+	Is more efficient than calling SetBlock() multiple times, the light and the simulators are updated once for the whole batch.
+	If a_ShouldSkipPhysics is true, nothing reacts to the changes (no block ticks, simulators or neighbor updates), used for pasting schematics.
 	If the chunk for any of the blocks is not loaded, the set operation is ignored silently. */
-	void SetBlocks(const sSetBlockVector & a_Blocks);
+	void SetBlocks(const sSetBlockVector & a_Blocks, bool a_ShouldSkipPhysics = false);
 
 	/** Replaces world blocks with a_Blocks, if they are of type a_FilterBlockType */
 	void ReplaceBlocks(const sSetBlockVector & a_Blocks, BLOCKTYPE a_FilterBlockType);
@@ -526,10 +580,40 @@ public:
 	
 	/** Wakes up the simulators for the specified area of blocks */
 	void WakeUpSimulatorsInArea(int a_MinBlockX, int a_MaxBlockX, int a_MinBlockY, int a_MaxBlockY, int a_MinBlockZ, int a_MaxBlockZ);
+	
+	/** Wakes up the sleeping block entities (see cBlockEntity::IsSleeping()) neighboring the specified block */
+	void WakeUpBlockEntitiesAround(int a_BlockX, int a_BlockY, int a_BlockZ);
 
 	// tolua_end
 
 	inline cSimulatorManager * GetSimulatorManager(void) { return m_SimulatorManager.get(); }
+
+	/** Returns the profiler measuring the phases of the world's tick. Only AddTime() and the timers may be used from the tick thread. */
+	cTickProfiler & GetTickProfiler(void) { return m_TickProfiler; }
+
+	/** Returns the spatial index of the world's players, for the nearest-player and radius queries. */
+	cPlayerProximityIndex & GetPlayerProximityIndex(void) { return m_PlayerProximityIndex; }
+
+	/** Returns the height and biome summaries of the world's chunks, kept up to date by the chunkmap and the storage. */
+	cColumnSummaryCache & GetColumnSummaries(void) { return m_ColumnSummaries; }
+
+	/** Returns the top-down map tiles of the world's saved chunks, rendered by the storage for the webadmin. */
+	cMapTileCache & GetMapTiles(void) { return m_MapTiles; }
+
+	/** The categories of the entities with separately configured tracking ranges, see GetEntityTrackingRange(). */
+	enum eEntityTrackingCategory
+	{
+		etcPlayers,
+		etcMobs,
+		etcItems,        ///< Pickups and experience orbs
+		etcProjectiles,
+		etcOther,        ///< Item frames, paintings, vehicles, falling blocks, TNT etc.
+		etcMax,
+	} ;
+
+	/** Returns the distance from a client's player (along X or Z) beyond which the entity isn't sent to the client;
+	0 means unlimited, the entity is sent to all the clients that have its chunk loaded. */
+	int GetEntityTrackingRange(const cEntity & a_Entity) const;
 	
 	inline cFluidSimulator * GetWaterSimulator(void) { return m_WaterSimulator; }
 	inline cFluidSimulator * GetLavaSimulator (void) { return m_LavaSimulator; }
@@ -678,6 +762,17 @@ public:
 		m_MaxViewDistance = Clamp(a_MaxViewDistance, cClientHandle::MIN_VIEW_DISTANCE, cClientHandle::MAX_VIEW_DISTANCE);
 	}
 
+	/** Returns the distance, in chunks, from the players within which the chunks loaded by the players are ticked.
+	The chunks further away are sent to the clients and kept loaded, but not ticked, unless set as always ticked. 0 means unlimited. */
+	int GetSimulationDistance(void) const { return m_SimulationDistance; }
+	void SetSimulationDistance(int a_SimulationDistance) { m_SimulationDistance = std::max(a_SimulationDistance, 0); }
+
+	/** Returns the view distance that the players currently get at most, lowered from GetMaxViewDistance() while the world is overloaded. */
+	int GetDynamicViewDistance(void) const { return std::min(m_DynamicViewDistance, m_MaxViewDistance); }
+
+	/** Returns the maximum view distance for the specified player: the dynamic view distance, but at least the minimum configured for the player's rank. */
+	int GetPlayerMaxViewDistance(const cPlayer & a_Player) const;
+
 	bool ShouldUseChatPrefixes(void) const { return m_bUseChatPrefixes; }
 	void SetShouldUseChatPrefixes(bool a_Flag) { m_bUseChatPrefixes = a_Flag; }
 
@@ -685,13 +780,13 @@ public:
 	bool ShouldBroadcastAchievementMessages(void) const { return m_BroadcastAchievementMessages; }
 
 
-	AString GetLinkedNetherWorldName(void) const { return m_LinkedNetherWorldName; }
+	const AString & GetLinkedNetherWorldName(void) const { return m_LinkedNetherWorldName; }
 	void SetLinkedNetherWorldName(const AString & a_Name) { m_LinkedNetherWorldName = a_Name; }
 
-	AString GetLinkedEndWorldName(void) const { return m_LinkedEndWorldName; }
+	const AString & GetLinkedEndWorldName(void) const { return m_LinkedEndWorldName; }
 	void SetLinkedEndWorldName(const AString & a_Name) { m_LinkedEndWorldName = a_Name; }
 
-	AString GetLinkedOverworldName(void) const { return m_LinkedOverworldName; }
+	const AString & GetLinkedOverworldName(void) const { return m_LinkedOverworldName; }
 	void SetLinkedOverworldName(const AString & a_Name) { m_LinkedOverworldName = a_Name; }
 	
 	// tolua_end
@@ -714,15 +809,137 @@ public:
 	/** Returns the number of chunks loaded and dirty, and in the lighting queue */
 	void GetChunkStats(int & a_NumValid, int & a_NumDirty, int & a_NumInLightingQueue);
 
+	/** Returns the chunk section pool statistics, see cChunkMap::GetSectionPoolStats() */
+	void GetSectionPoolStats(size_t & a_NumAllocated, size_t & a_NumFree, size_t & a_NumReserveInUse);
+
+	/** The memory used by the world's chunks, caches and client buffers, see GetMemoryStats(). */
+	struct sMemoryStats
+	{
+		cChunkMap::sMemoryStats m_Chunks;
+		size_t m_SectionPoolBytes;         ///< Memory held by the section pool, both the sections in use and the free ones
+		size_t m_SerializationCacheItems;  ///< Number of the chunk serializations cached by the chunk sender
+		size_t m_SerializationCacheBytes;
+		UInt64 m_GeneratorCacheBytes;      ///< Memory used by all the caches of the generator
+		size_t m_ClientBufferBytes;        ///< Data queued for sending to all the world's clients
+
+		sMemoryStats(void);
+	} ;
+
+	/** Fills a_Stats with the world's memory usage. Locks the chunkmap and the clients, so it shouldn't be called too often. */
+	void GetMemoryStats(sMemoryStats & a_Stats);
+
+	/** Returns true if the chunks should accumulate the time spent in their ticks. */
+	bool IsChunkTickProfilingEnabled(void) const { return m_IsChunkTickProfilingEnabled; }
+
+	/** Turns the accumulating of the chunks' tick time on or off. The already accumulated times are kept. */
+	void SetChunkTickProfilingEnabled(bool a_IsEnabled) { m_IsChunkTickProfilingEnabled = a_IsEnabled; }
+
+	/** Fills a_Costs with the a_Count chunks that have accumulated the most tick time, see cChunkMap::GetTopChunkTickCosts(). */
+	void GetTopChunkTickCosts(size_t a_Count, std::vector<cChunkMap::sChunkTickCost> & a_Costs);
+
+	/** Zeroes the accumulated tick time of all the loaded chunks. */
+	void ResetChunkTickCosts(void);
+
+	/** How the tick thread schedules the ticks when they take longer than the tick period. */
+	enum eTickPolicy
+	{
+		/** Each tick starts at least one tick period after the previous one started, an overloaded world simply runs slower. */
+		tpStretch,
+
+		/** The ticks are scheduled at fixed times; a late world runs the ticks back-to-back to catch up, up to a bounded backlog
+		of ticks, the ticks above it are skipped. */
+		tpCatchUp,
+	} ;
+
+	/** Histogram of the durations of the world's ticks since the world has started, and the tick scheduler's counters. */
+	struct sTickDurationStats
+	{
+		static const int NUM_BUCKETS = 8;
+
+		/** Returns the upper bound of the specified bucket, in milliseconds. */
+		static int GetBucketBound(int a_Bucket);
+
+		/** The number of ticks that took at most GetBucketBound(i) msec, for each bucket i; larger buckets include the smaller ones. */
+		UInt64 m_BucketCounts[NUM_BUCKETS];
+
+		/** The total number of ticks and their total duration. */
+		UInt64 m_NumTicks;
+		UInt64 m_TotalMSec;
+
+		/** The number of ticks that took longer than the world's tick budget. */
+		UInt64 m_NumOverBudget;
+
+		/** The number of ticks started right after the previous one, to catch up with the schedule, and the number of ticks
+		given up on because the world fell too far behind (tpCatchUp only). */
+		UInt64 m_NumCatchUpTicks;
+		UInt64 m_NumSkippedTicks;
+
+		/** The world's tick budget, in msec, and its current degradation level, see GetTickDegradationLevel(). */
+		int m_BudgetMSec;
+		int m_DegradationLevel;
+
+		sTickDurationStats(void);
+
+		/** Adds a single tick of the specified duration. */
+		void Add(Int64 a_MSec);
+	} ;
+
+	/** Returns the stats of the world's tick durations. */
+	void GetTickDurationStats(sTickDurationStats & a_Stats);
+
+	/** Returns how much the non-essential subsystems are currently cut back because the ticks take longer than the tick budget:
+	0 - nothing is cut back;
+	1 - no mob spawning, the weather is ticked every 2nd tick;
+	2 - as 1, and the weather every 4th tick, half of the random block ticks, the simulators run at half their rates;
+	3 - as 1, and the weather every 8th tick, a quarter of the random block ticks, the simulators at a quarter of their rates. */
+	int GetTickDegradationLevel(void) const { return m_TickDegradationLevel; }
+
+	/** Returns the number of random block ticks each ticked chunk gets per tick, lowered with the tick degradation level. */
+	int GetRandomTicksPerChunk(void) const { return m_RandomTicksPerChunk; }
+
+	/** Returns the latest read-only snapshot of the world's chunks, for the readers in other threads that shouldn't lock the chunkmap
+	(map renderers, statistics). Returns an empty pointer if no snapshot has been published (yet).
+	The snapshots aren't published unless the snapshot interval is set, see SetSnapshotInterval(). */
+	cWorldSnapshotPtr GetSnapshot(void);
+
+	/** Sets how often the snapshots of the world's chunks are published, in seconds; 0 stops publishing and releases the last snapshot.
+	Each snapshot only copies the chunks that have changed since the previous one. */
+	void SetSnapshotInterval(int a_Seconds);
+
+	/** Appends the human-readable generator stats - the time spent in each generator stage and the cache hit rates - to a_Lines */
+	void GetGeneratorStats(AStringVector & a_Lines);
+
+	/** Returns the generator stats as a multi-line string, for the webadmin */
+	AString GetGeneratorStatsReport(void);  // tolua_export
+
 	// Various queues length queries (cannot be const, they lock their CS):
 	inline int GetGeneratorQueueLength     (void) { return m_Generator.GetQueueLength();   }    // tolua_export
 	inline size_t GetLightingQueueLength   (void) { return m_Lighting.GetQueueLength();    }    // tolua_export
 	inline size_t GetStorageLoadQueueLength(void) { return m_Storage.GetLoadQueueLength(); }    // tolua_export
 	inline size_t GetStorageSaveQueueLength(void) { return m_Storage.GetSaveQueueLength(); }    // tolua_export
 
+	/** Returns the number of dirty chunks, as of the last write-behind saving pass */
+	int GetNumDirtyChunks(void) const { return m_NumDirtyChunks; }  // tolua_export
+
+	/** Returns the number of seconds the oldest dirty chunk has been waiting to be saved, as of the last write-behind saving pass */
+	int GetSaveLag(void) const { return static_cast<int>(m_OldestDirtyChunkAge / 20); }  // tolua_export
+
 	cLightingThread & GetLightingThread(void) { return m_Lighting; }
+	cChunkSender & GetChunkSender(void) { return m_ChunkSender; }
 
+	/** Prepares the spawn area and waits until it is ready. */
 	void InitializeSpawn(void);
+
+	/** Starts preparing the spawn area in a background thread, including choosing the spawn point if it isn't set explicitly,
+	so that several worlds can prepare their spawn areas in parallel (see cRoot::StartWorlds()). */
+	void StartSpawnPreparation(void);
+
+	/** Returns true if the spawn preparation started by StartSpawnPreparation() has finished, or none has been started. */
+	bool IsSpawnPrepared(void) const;
+
+	/** Waits for the spawn preparation started by StartSpawnPreparation() to finish,
+	then continues an interrupted pregeneration, if there was any. */
+	void FinishSpawnPreparation(void);
 	
 	/** Starts threads that belong to this world */
 	void Start(void);
@@ -738,7 +955,12 @@ public:
 		int X;
 		int Y;
 		int Z;
-		int TicksToWait;
+
+		/** The value of m_BlockTickQueueTick at which the block is to be ticked. */
+		Int64 TargetTick;
+
+		/** Orders the items so that the soonest due ends up on top of the queue. */
+		bool operator >(const BlockTickQueueItem & a_Other) const { return (TargetTick > a_Other.TargetTick); }
 	};
 
 	/** Queues the block to be ticked after the specified number of game ticks */
@@ -837,6 +1059,7 @@ public:
 private:
 
 	friend class cRoot;
+	friend class cSpawnPrepare;
 	
 	class cTickThread :
 		public cIsThread
@@ -850,6 +1073,9 @@ private:
 		
 		// cIsThread overrides:
 		virtual void Execute(void) override;
+
+		/** Performs the ticks of the recording as fast as possible instead of the regular ticking, then waits for the termination. */
+		void ExecuteReplay(cTickReplayer & a_Replayer);
 	} ;
 	
 	
@@ -863,7 +1089,8 @@ private:
 		// cChunkSink overrides:
 		virtual void OnChunkGenerated  (cChunkDesc & a_ChunkDesc) override;
 		virtual bool IsChunkValid      (int a_ChunkX, int a_ChunkZ) override;
-		virtual bool HasChunkAnyClients(int a_ChunkX, int a_ChunkZ) override;
+		virtual int  GetChunkPriority  (int a_ChunkX, int a_ChunkZ) override;
+		virtual void OnChunkSkipped    (int a_ChunkX, int a_ChunkZ) override;
 		virtual bool IsChunkQueued     (int a_ChunkX, int a_ChunkZ) override;
 		
 		// cPluginInterface overrides:
@@ -908,6 +1135,42 @@ private:
 	AString m_StorageSchema;
 	
 	int m_StorageCompressionFactor;
+
+	/** Codec used for compressing the saved chunks; chunks saved with any known codec can be loaded regardless */
+	eCompressionCodec m_StorageCompression;
+
+	/** Maximum number of region files each storage schema keeps open at once */
+	int m_StorageMaxOpenRegionFiles;
+
+	/** Number of KiB per second that the storage may move when defragmenting the region files in its idle time, 0 to disable */
+	int m_StorageCompactionRate;
+
+	/** Number of MiB of the recently loaded and saved chunks' data that the storage keeps in memory, so that the chunks
+	loaded again shortly after being unloaded don't need to be read from the disk. 0 to disable. */
+	int m_StorageChunkCacheSize;
+
+	/** Number of MiB of the compressed sections of the recently saved chunks that the storage keeps in memory, so that
+	the sections that haven't changed aren't compressed again when their chunk is saved next time. 0 to disable. */
+	int m_StorageSectionCacheSize;
+
+	/** Number of seconds within which each dirty chunk gets saved, regardless of m_MaxSaveRate */
+	int m_SaveInterval;
+
+	/** Rate, in bytes per second, at which the write-behind saver writes the chunks that aren't overdue yet. Zero or less means unlimited. */
+	double m_MaxSaveRate;
+
+	/** Number of bytes the write-behind saver may still queue for writing. Refilled by m_MaxSaveRate over time. */
+	double m_SaveBudget;
+
+	/** Number of seconds a chunk has to be unused (no clients, no ChunkStays) before it is unloaded */
+	int m_ChunkUnloadDelay;
+
+	/** Maximum number of chunks unloaded in a single tick, so that leaving an area doesn't cause a tick spike */
+	int m_MaxChunkUnloadsPerTick;
+
+	/** Number of dirty chunks and the age (in ticks) of the oldest one, as of the last write-behind saving pass */
+	int m_NumDirtyChunks;
+	Int64 m_OldestDirtyChunkAge;
 	
 	/** The dimension of the world, used by the client to provide correct lighting scheme */
 	eDimension m_Dimension;
@@ -929,8 +1192,14 @@ private:
 	std::chrono::milliseconds  m_TimeOfDay;
 	cTickTimeLong  m_LastTimeUpdate;    // The tick in which the last time update has been sent.
 	cTickTimeLong  m_LastUnload;        // The last WorldAge (in ticks) in which unloading was triggerred
-	cTickTimeLong  m_LastSave;          // The last WorldAge (in ticks) in which save-all was triggerred
-	std::map<cMonster::eFamily, cTickTimeLong> m_LastSpawnMonster;  // The last WorldAge (in ticks) in which a monster was spawned (for each megatype of monster)  // MG TODO : find a way to optimize without creating unmaintenability (if mob IDs are becoming unrowed)
+	cTickTimeLong  m_LastSave;          // The last WorldAge (in ticks) in which save-all or the write-behind saving pass was triggerred
+	std::map<cMonster::eFamily, cTickTimeLong> m_LastSpawnMonster;
+
+	/** The entity tracking range of each eEntityTrackingCategory, in blocks; 0 = unlimited. */
+	int m_EntityTrackingRange[etcMax];
+
+	/** The distance from the closest player, in blocks, beyond which the mobs of each family don't run their AI; 0 = unlimited. */
+	int m_MobActivationRange[cMonster::mfUnhandled + 1];  // The last WorldAge (in ticks) in which a monster was spawned (for each megatype of monster)  // MG TODO : find a way to optimize without creating unmaintenability (if mob IDs are becoming unrowed)
 
 	NIBBLETYPE m_SkyDarkness;
 
@@ -940,8 +1209,11 @@ private:
 	bool m_ShouldLavaSpawnFire;
 	bool m_VillagersShouldHarvestCrops;
 	
-	std::vector<BlockTickQueueItem *> m_BlockTickQueue;
-	std::vector<BlockTickQueueItem *> m_BlockTickQueueCopy;  // Second is for safely removing the objects from the queue
+	/** The blocks queued for ticking by QueueBlockForTick(), the soonest due on top, so that the due ones are popped without scanning the rest. */
+	std::priority_queue<BlockTickQueueItem, std::vector<BlockTickQueueItem>, std::greater<BlockTickQueueItem>> m_BlockTickQueue;
+
+	/** Number of TickQueuedBlocks() calls so far, the clock of m_BlockTickQueue. */
+	Int64 m_BlockTickQueueTick;
 
 	std::unique_ptr<cSimulatorManager>   m_SimulatorManager;
 	std::unique_ptr<cSandSimulator>      m_SandSimulator;
@@ -953,6 +1225,9 @@ private:
 	cCriticalSection m_CSPlayers;
 	cPlayerList      m_Players;
 
+	/** The player movements in the current tick, waiting for HOOK_PLAYERS_MOVED. Only accessed from the tick thread. */
+	cPluginManager::cPlayerMoves m_PlayerMoves;
+
 	cWorldStorage     m_Storage;
 	
 	unsigned int m_MaxPlayers;
@@ -993,6 +1268,61 @@ private:
 	/** The maximum view distance that a player can have in this world. */
 	int m_MaxViewDistance;
 
+	/** The distance, in chunks, from the players within which the chunks are ticked, see GetSimulationDistance(). */
+	int m_SimulationDistance;
+
+	/** If true, the view distance is lowered automatically while the ticks take too long or the chunk sender falls behind. */
+	bool m_IsDynamicViewDistanceEnabled;
+
+	/** The current view distance given to the players, between m_MinDynamicViewDistance and m_MaxViewDistance. Only changed in the tick thread. */
+	int m_DynamicViewDistance;
+
+	/** The dynamic view distance is never lowered below this. */
+	int m_MinDynamicViewDistance;
+
+	/** The average tick duration, in msec, above which the dynamic view distance is lowered. */
+	int m_DynamicViewDistanceTargetTickMSec;
+
+	/** The number of chunks waiting in the chunk sender above which the dynamic view distance is lowered. */
+	int m_DynamicViewDistanceMaxSendBacklog;
+
+	/** The view distance that the players of each rank keep regardless of the load, by the rank name. */
+	std::map<AString, int> m_RankMinViewDistances;
+
+	/** The number of ticks and their total duration, in msec, measured since the dynamic view distance was last evaluated. */
+	int m_DynamicViewDistanceTicks;
+	Int64 m_DynamicViewDistanceTotalMSec;
+
+	/** The number of consecutive evaluations that have found the world healthy, the view distance is raised after a few of them. */
+	int m_DynamicViewDistanceHealthyCount;
+
+	/** How the tick thread schedules the ticks when they run late. */
+	eTickPolicy m_TickPolicy;
+
+	/** The number of ticks that the tick thread may be behind the schedule and still catch up, in tpCatchUp. */
+	int m_MaxCatchUpTicks;
+
+	/** The duration, in msec, that a tick is expected to fit in; the subsystems are degraded while the ticks take longer. */
+	int m_TickBudgetMSec;
+
+	/** The current and the maximum tick degradation level, see GetTickDegradationLevel(). 0 as the maximum disables the degrading.
+	Only changed in the tick thread. */
+	int m_TickDegradationLevel;
+	int m_MaxTickDegradationLevel;
+
+	/** The number of ticks and their total duration, in msec, measured since the degradation level was last evaluated. */
+	int m_TickDegradationTicks;
+	Int64 m_TickDegradationTotalMSec;
+
+	/** The number of consecutive evaluations that have found the ticks well within the budget, the level is lowered after a few of them. */
+	int m_TickDegradationHealthyCount;
+
+	/** The number of random block ticks per chunk per tick, see GetRandomTicksPerChunk(). */
+	int m_RandomTicksPerChunk;
+
+	/** The number of ticks since the weather was last ticked, it is ticked less often while degraded. */
+	int m_WeatherDeferredTicks;
+
 	/** Name of the nether world - where Nether portals should teleport.
 	Only used when this world is an Overworld. */
 	AString m_LinkedNetherWorldName;
@@ -1012,6 +1342,13 @@ private:
 	
 	cChunkSender     m_ChunkSender;
 	cLightingThread  m_Lighting;
+
+	/** Generates whole areas of the world in bulk, on request */
+	cPregenerator    m_Pregenerator;
+
+	/** The spawn area preparation in progress, started by StartSpawnPreparation(); nullptr if none. */
+	std::unique_ptr<cSpawnPrepare> m_SpawnPrepare;
+
 	cTickThread      m_TickThread;
 	
 	/** Guards the m_Tasks */
@@ -1052,6 +1389,39 @@ private:
 	/** List of players that are scheduled for adding, waiting for the Tick thread to add them. */
 	cPlayerList m_PlayersToAdd;
 	
+	/** Measures the time spent in the phases of the world's tick. */
+	cTickProfiler m_TickProfiler;
+
+	/** The players in m_Players, indexed by their positions. */
+	cPlayerProximityIndex m_PlayerProximityIndex;
+
+	/** Protects m_TickDurationStats, updated in the tick thread and read from any thread. */
+	cCriticalSection m_CSTickDurationStats;
+
+	/** The stats of the tick durations, as measured by the tick thread. Protected by m_CSTickDurationStats. */
+	sTickDurationStats m_TickDurationStats;
+
+	/** Protects m_Snapshot and m_SnapshotInterval. */
+	cCriticalSection m_CSSnapshot;
+
+	/** The latest published snapshot of the chunks, see GetSnapshot(). Protected by m_CSSnapshot. */
+	cWorldSnapshotPtr m_Snapshot;
+
+	/** How often the snapshots are published, in seconds. 0 means never. Protected by m_CSSnapshot. */
+	int m_SnapshotInterval;
+
+	/** The WorldAge at which the last snapshot was published. Only accessed in the tick thread. */
+	cTickTimeLong m_LastSnapshot;
+
+	/** When set, the chunks accumulate the time spent in their ticks, see GetTopChunkTickCosts(). */
+	std::atomic<bool> m_IsChunkTickProfilingEnabled;
+
+	/** The height and biome summaries of the chunks, for answering the queries about the chunks that aren't loaded. */
+	cColumnSummaryCache m_ColumnSummaries;
+
+	/** The top-down map tiles of the saved chunks, served by the webadmin. */
+	cMapTileCache m_MapTiles;
+
 	/** CS protecting m_SetChunkDataQueue. */
 	cCriticalSection m_CSSetChunkDataQueue;
 	
@@ -1064,8 +1434,23 @@ private:
 
 	void Tick(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDurationMSec);
 
-	/** Handles the weather in each tick */
-	void TickWeather(float a_Dt);
+	/** Runs the individual phases of Tick(), measured by m_TickProfiler. */
+	void TickPhases(std::chrono::milliseconds a_Dt, std::chrono::milliseconds a_LastTickDurationMSec);
+
+	/** Handles the weather; a_NumTicks is the number of ticks since it was last called, more than 1 if it has been deferred. */
+	void TickWeather(int a_NumTicks);
+
+	/** Publishes a new snapshot of the chunks, if the snapshot interval has elapsed. */
+	void TickSnapshot(void);
+
+	/** Measures the load and lowers or raises the dynamic view distance, once per second's worth of ticks. */
+	void TickDynamicViewDistance(std::chrono::milliseconds a_LastTickDurationMSec);
+
+	/** Measures the tick durations against the tick budget and raises or lowers the tick degradation level, once per second's worth of ticks. */
+	void TickDegradation(std::chrono::milliseconds a_LastTickDurationMSec);
+
+	/** Applies the tick degradation level to the subsystems that it cuts back. */
+	void SetTickDegradationLevel(int a_Level);
 	
 	/** Handles the mob spawning / moving / destroying each tick */
 	void TickMobs(std::chrono::milliseconds a_Dt);
@@ -1082,11 +1467,24 @@ private:
 	/** Unloads all chunks immediately.*/
 	void UnloadUnusedChunks(void);
 
+	/** Queues some of the dirty chunks for saving, spreading the saving over m_SaveInterval at no more than m_MaxSaveRate.
+	Chunks that could be unloaded are saved first; chunks dirty for m_SaveInterval are saved regardless of the rate. */
+	void SaveDirtyChunks(void);
+
 	void UpdateSkyDarkness(void);
 
 	/** <summary>Generates a random spawnpoint on solid land by walking chunks and finding their biomes</summary> */
 	void GenerateRandomSpawn(void);
 
+	/** Chooses the spawn point, if it isn't set explicitly, and reads the size of the spawn area to prepare.
+	a_IsAreaPrepared is set if the world.ini manifest says that the same area has already been prepared by a previous run.
+	Called from the spawn preparation thread. */
+	void InitializeSpawnPosition(int & a_SpawnChunkX, int & a_SpawnChunkZ, int & a_PrepareDistance, bool & a_IsAreaPrepared);
+
+	/** Records the fully prepared spawn area into the world.ini manifest, so that the next start needn't wait for it.
+	Called from the spawn preparation thread. */
+	void MarkSpawnAreaPrepared(int a_SpawnChunkX, int a_SpawnChunkZ, int a_PrepareDistance);
+
 	/** Check if player starting point is acceptable **/
 	bool CheckPlayerSpawnPoint(int a_PosX, int a_PosY, int a_PosZ);
 
@@ -1103,6 +1501,9 @@ private:
 	Assumes it is called from the Tick thread. */
 	void AddQueuedPlayers(void);
 
+	/** Calls HOOK_PLAYERS_MOVED with the movements in m_PlayerMoves, skipping the players that have left the world since. */
+	void CallQueuedPlayerMoves(void);
+
 	/** Sets generator values to dimension specific defaults, if those values do not exist */
 	void InitialiseGeneratorDefaults(cIniFile & a_IniFile);
 
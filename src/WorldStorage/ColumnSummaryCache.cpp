@@ -0,0 +1,269 @@
+
+// ColumnSummaryCache.cpp
+
+// Implements the cColumnSummaryCache class representing the per-chunk height and biome summaries of a world's columns
+
+#include "Globals.h"
+#include "ColumnSummaryCache.h"
+
+
+
+
+
+/** Number of chunks along each side of a region, same as the region files. */
+static const int REGION_SIZE = 32;
+
+/** Number of chunks in a region, also the number of flags in the summary file's header. */
+static const size_t REGION_NUM_CHUNKS = REGION_SIZE * REGION_SIZE;
+
+/** The header flag value of a chunk whose summary is present in the file; also identifies the summary format. */
+static const Byte SUMMARY_PRESENT = 1;
+
+
+
+
+
+cColumnSummaryCache::cColumnSummaryCache(const AString & a_RegionFolder, size_t a_MaxChunks) :
+	m_RegionFolder(a_RegionFolder),
+	m_MaxChunks(std::max<size_t>(a_MaxChunks, 1))
+{
+}
+
+
+
+
+
+void cColumnSummaryCache::SetMaxChunks(size_t a_MaxChunks)
+{
+	cCSLock Lock(m_CS);
+	m_MaxChunks = std::max<size_t>(a_MaxChunks, 1);
+	while (m_Chunks.size() > m_MaxChunks)
+	{
+		m_ChunkIndex.erase(m_Chunks.back().m_Coords);
+		m_Chunks.pop_back();
+	}
+}
+
+
+
+
+
+void cColumnSummaryCache::SetChunk(int a_ChunkX, int a_ChunkZ, const HEIGHTTYPE * a_Heights, const Byte * a_Biomes, bool a_ShouldPersist)
+{
+	cCSLock Lock(m_CS);
+	sSummary & Summary = StoreSummary(cChunkCoords(a_ChunkX, a_ChunkZ));
+	memcpy(Summary.m_Heights, a_Heights, sizeof(Summary.m_Heights));
+	memcpy(Summary.m_Biomes, a_Biomes, sizeof(Summary.m_Biomes));
+	if (a_ShouldPersist)
+	{
+		WriteSummary(a_ChunkX, a_ChunkZ, Summary);
+	}
+}
+
+
+
+
+
+void cColumnSummaryCache::SetChunk(int a_ChunkX, int a_ChunkZ, const cChunkDef::HeightMap & a_HeightMap, const cChunkDef::BiomeMap & a_BiomeMap)
+{
+	// Both maps are indexed by (RelZ * 16 + RelX), same as the summary:
+	Byte Biomes[cChunkDef::Width * cChunkDef::Width];
+	for (size_t i = 0; i < ARRAYCOUNT(Biomes); i++)
+	{
+		Biomes[i] = static_cast<Byte>(a_BiomeMap[i]);
+	}
+	SetChunk(a_ChunkX, a_ChunkZ, a_HeightMap, Biomes, false);
+}
+
+
+
+
+
+bool cColumnSummaryCache::GetHeight(int a_BlockX, int a_BlockZ, int & a_Height)
+{
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(a_BlockX, a_BlockZ, ChunkX, ChunkZ);
+	cCSLock Lock(m_CS);
+	const sSummary * Summary = GetSummary(ChunkX, ChunkZ);
+	if (Summary == nullptr)
+	{
+		return false;
+	}
+	int RelX = a_BlockX - ChunkX * cChunkDef::Width;
+	int RelZ = a_BlockZ - ChunkZ * cChunkDef::Width;
+	a_Height = Summary->m_Heights[RelZ * cChunkDef::Width + RelX];
+	return true;
+}
+
+
+
+
+
+bool cColumnSummaryCache::GetBiome(int a_BlockX, int a_BlockZ, EMCSBiome & a_Biome)
+{
+	int ChunkX, ChunkZ;
+	cChunkDef::BlockToChunk(a_BlockX, a_BlockZ, ChunkX, ChunkZ);
+	cCSLock Lock(m_CS);
+	const sSummary * Summary = GetSummary(ChunkX, ChunkZ);
+	if (Summary == nullptr)
+	{
+		return false;
+	}
+	int RelX = a_BlockX - ChunkX * cChunkDef::Width;
+	int RelZ = a_BlockZ - ChunkZ * cChunkDef::Width;
+	a_Biome = static_cast<EMCSBiome>(Summary->m_Biomes[RelZ * cChunkDef::Width + RelX]);
+	return true;
+}
+
+
+
+
+
+const cColumnSummaryCache::sSummary * cColumnSummaryCache::GetSummary(int a_ChunkX, int a_ChunkZ)
+{
+	// Try the memory first; move the chunk to the front (splicing keeps the indexed iterator valid):
+	cChunkCoords Coords(a_ChunkX, a_ChunkZ);
+	auto itr = m_ChunkIndex.find(Coords);
+	if (itr != m_ChunkIndex.end())
+	{
+		m_Chunks.splice(m_Chunks.begin(), m_Chunks, itr->second);
+		return &(itr->second->m_Summary);
+	}
+
+	// Check the region's summary file header, so that the chunks without a summary don't hit the disk:
+	int RegionX = FAST_FLOOR_DIV(a_ChunkX, REGION_SIZE);
+	int RegionZ = FAST_FLOOR_DIV(a_ChunkZ, REGION_SIZE);
+	cRegionHeader & Header = GetRegionHeader(RegionX, RegionZ);
+	size_t Idx = static_cast<size_t>((a_ChunkZ - RegionZ * REGION_SIZE) * REGION_SIZE + (a_ChunkX - RegionX * REGION_SIZE));
+	if (Header.empty() || (Header[Idx] != SUMMARY_PRESENT))
+	{
+		return nullptr;
+	}
+
+	// Read the summary from the file:
+	sSummary Summary;
+	cFile f;
+	if (
+		!f.Open(GetFileName(RegionX, RegionZ), cFile::fmRead) ||
+		(f.Seek(static_cast<int>(REGION_NUM_CHUNKS + Idx * sizeof(sSummary))) < 0) ||
+		(f.Read(&Summary, sizeof(Summary)) != static_cast<int>(sizeof(Summary)))
+	)
+	{
+		Header[Idx] = 0;  // Don't try again
+		return nullptr;
+	}
+	sSummary & Stored = StoreSummary(Coords);
+	Stored = Summary;
+	return &Stored;
+}
+
+
+
+
+
+cColumnSummaryCache::sSummary & cColumnSummaryCache::StoreSummary(const cChunkCoords & a_Coords)
+{
+	auto itr = m_ChunkIndex.find(a_Coords);
+	if (itr != m_ChunkIndex.end())
+	{
+		m_Chunks.splice(m_Chunks.begin(), m_Chunks, itr->second);
+		return itr->second->m_Summary;
+	}
+
+	// Drop the least recently used chunks, if there are too many:
+	while (m_Chunks.size() >= m_MaxChunks)
+	{
+		m_ChunkIndex.erase(m_Chunks.back().m_Coords);
+		m_Chunks.pop_back();
+	}
+	m_Chunks.push_front(sCachedSummary(a_Coords));
+	m_ChunkIndex[a_Coords] = m_Chunks.begin();
+	return m_Chunks.front().m_Summary;
+}
+
+
+
+
+
+cColumnSummaryCache::cRegionHeader & cColumnSummaryCache::GetRegionHeader(int a_RegionX, int a_RegionZ)
+{
+	cChunkCoords Region(a_RegionX, a_RegionZ);
+	auto itr = m_RegionHeaders.find(Region);
+	if (itr != m_RegionHeaders.end())
+	{
+		return itr->second;
+	}
+
+	cRegionHeader & Header = m_RegionHeaders[Region];
+	cFile f;
+	if (!f.Open(GetFileName(a_RegionX, a_RegionZ), cFile::fmRead))
+	{
+		// No summaries for this region yet
+		return Header;
+	}
+	Header.resize(REGION_NUM_CHUNKS);
+	if (f.Read(Header.data(), REGION_NUM_CHUNKS) != static_cast<int>(REGION_NUM_CHUNKS))
+	{
+		LOGWARNING("Cannot read the column summary file header of region [%d, %d], ignoring the summaries.", a_RegionX, a_RegionZ);
+		Header.clear();
+	}
+	return Header;
+}
+
+
+
+
+
+AString cColumnSummaryCache::GetFileName(int a_RegionX, int a_RegionZ) const
+{
+	return Printf("%s%cr.%d.%d.mcsum", m_RegionFolder.c_str(), cFile::PathSeparator, a_RegionX, a_RegionZ);
+}
+
+
+
+
+
+void cColumnSummaryCache::WriteSummary(int a_ChunkX, int a_ChunkZ, const sSummary & a_Summary)
+{
+	int RegionX = FAST_FLOOR_DIV(a_ChunkX, REGION_SIZE);
+	int RegionZ = FAST_FLOOR_DIV(a_ChunkZ, REGION_SIZE);
+	size_t Idx = static_cast<size_t>((a_ChunkZ - RegionZ * REGION_SIZE) * REGION_SIZE + (a_ChunkX - RegionX * REGION_SIZE));
+	cRegionHeader & Header = GetRegionHeader(RegionX, RegionZ);
+
+	cFile f;
+	if (!f.Open(GetFileName(RegionX, RegionZ), cFile::fmReadWrite))
+	{
+		cFile::CreateFolder(FILE_IO_PREFIX + m_RegionFolder);
+		if (!f.Open(GetFileName(RegionX, RegionZ), cFile::fmReadWrite))
+		{
+			LOGWARNING("Cannot open the column summary file of region [%d, %d] for writing.", RegionX, RegionZ);
+			return;
+		}
+	}
+	if (Header.empty())
+	{
+		// A new file, write an empty header first:
+		Header.resize(REGION_NUM_CHUNKS, 0);
+		f.Write(Header.data(), REGION_NUM_CHUNKS);
+	}
+
+	// Write the data before the flag, so that a crash in between doesn't leave the flag pointing to garbage:
+	if (
+		(f.Seek(static_cast<int>(REGION_NUM_CHUNKS + Idx * sizeof(sSummary))) < 0) ||
+		(f.Write(&a_Summary, sizeof(a_Summary)) != static_cast<int>(sizeof(a_Summary)))
+	)
+	{
+		LOGWARNING("Cannot write the column summary of chunk [%d, %d].", a_ChunkX, a_ChunkZ);
+		return;
+	}
+	if (Header[Idx] != SUMMARY_PRESENT)
+	{
+		Header[Idx] = SUMMARY_PRESENT;
+		f.Seek(static_cast<int>(Idx));
+		f.Write(&SUMMARY_PRESENT, 1);
+	}
+}
+
+
+
+
@@ -0,0 +1,107 @@
+
+// ColumnSummaryCache.h
+
+// Declares the cColumnSummaryCache class representing the per-chunk height and biome summaries of a world's columns
+
+
+
+
+
+#pragma once
+
+#include "../ChunkDef.h"
+#include <unordered_map>
+
+
+
+
+
+/** Keeps a compact summary of each chunk's columns - the height map and the biome map, 512 bytes per chunk - so that
+the height and biome queries for the chunks that aren't loaded can be answered without loading, or even generating, them.
+The summaries are persisted next to the region files, one summary file per region, whenever a chunk is saved; the recently
+used ones are held in memory in a LRU cache. The summary files' headers are kept in memory as well, so that the queries for
+chunks without a summary don't touch the disk.
+Thread-safe, all the members are protected by a single lock. */
+class cColumnSummaryCache
+{
+public:
+	/** Creates the cache for the region files in the specified folder, holding up to the specified number of chunks in memory. */
+	cColumnSummaryCache(const AString & a_RegionFolder, size_t a_MaxChunks);
+
+	/** Sets the maximum number of chunks held in memory, dropping the least recently used ones above it. */
+	void SetMaxChunks(size_t a_MaxChunks);
+
+	/** Stores the summary of the specified chunk. The heights and biomes are indexed by (RelZ * 16 + RelX).
+	If a_ShouldPersist is true, the summary is written into the region's summary file as well. */
+	void SetChunk(int a_ChunkX, int a_ChunkZ, const HEIGHTTYPE * a_Heights, const Byte * a_Biomes, bool a_ShouldPersist);
+
+	/** Stores the summary of the specified chunk into memory, from the chunk's own maps. */
+	void SetChunk(int a_ChunkX, int a_ChunkZ, const cChunkDef::HeightMap & a_HeightMap, const cChunkDef::BiomeMap & a_BiomeMap);
+
+	/** Returns the height of the specified column in a_Height; returns false if there's no summary for its chunk. */
+	bool GetHeight(int a_BlockX, int a_BlockZ, int & a_Height);
+
+	/** Returns the biome of the specified column in a_Biome; returns false if there's no summary for its chunk. */
+	bool GetBiome(int a_BlockX, int a_BlockZ, EMCSBiome & a_Biome);
+
+protected:
+	/** The summary of a single chunk, exactly as stored in the summary file. */
+	struct sSummary
+	{
+		HEIGHTTYPE m_Heights[cChunkDef::Width * cChunkDef::Width];
+		Byte m_Biomes[cChunkDef::Width * cChunkDef::Width];
+	} ;
+
+	/** A cached chunk summary, in m_Chunks. */
+	struct sCachedSummary
+	{
+		cChunkCoords m_Coords;
+		sSummary m_Summary;
+
+		sCachedSummary(const cChunkCoords & a_Coords) : m_Coords(a_Coords) {}
+	} ;
+
+	typedef std::list<sCachedSummary> cCachedSummaries;
+
+	/** The header of a summary file, a flag for each chunk of the region, whether its summary is present. */
+	typedef std::vector<Byte> cRegionHeader;
+
+
+	cCriticalSection m_CS;
+
+	/** The folder with the region files, where the summary files are stored as well. */
+	AString m_RegionFolder;
+
+	/** The chunk summaries in memory, the most recently used first. */
+	cCachedSummaries m_Chunks;
+
+	/** Index into m_Chunks by the chunk coords. */
+	std::unordered_map<cChunkCoords, cCachedSummaries::iterator, cChunkCoordsHash> m_ChunkIndex;
+
+	/** The maximum number of chunks in m_Chunks. */
+	size_t m_MaxChunks;
+
+	/** The headers of the summary files that have been accessed, by the region coords.
+	A region without a summary file is stored with an empty header. */
+	std::unordered_map<cChunkCoords, cRegionHeader, cChunkCoordsHash> m_RegionHeaders;
+
+
+	/** Returns the summary of the specified chunk, from memory or from its summary file; nullptr if there's none. */
+	const sSummary * GetSummary(int a_ChunkX, int a_ChunkZ);
+
+	/** Inserts a new summary of the specified chunk into m_Chunks (or reuses the existing one) and returns it for filling. */
+	sSummary & StoreSummary(const cChunkCoords & a_Coords);
+
+	/** Returns the header of the specified region's summary file, reading it from the disk if not yet cached. */
+	cRegionHeader & GetRegionHeader(int a_RegionX, int a_RegionZ);
+
+	/** Returns the file name of the specified region's summary file. */
+	AString GetFileName(int a_RegionX, int a_RegionZ) const;
+
+	/** Writes the summary of the specified chunk into its region's summary file, creating the file if needed. */
+	void WriteSummary(int a_ChunkX, int a_ChunkZ, const sSummary & a_Summary);
+} ;
+
+
+
+
@@ -82,7 +82,7 @@ void EnchantmentSerializer::ParseFromNBT(cEnchantments & a_Enchantments, const c
 		}
 		
 		// Store the enchantment:
-		a_Enchantments.m_Enchantments[id] = lvl;
+		a_Enchantments.SetLevel(id, lvl);
 	}  // for tag - children of the ench list tag
 }
 
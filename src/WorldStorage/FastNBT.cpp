@@ -48,6 +48,7 @@ static const int MAX_LIST_ITEMS = 10000;
 cParsedNBT::cParsedNBT(const char * a_Data, size_t a_Length) :
 	m_Data(a_Data),
 	m_Length(a_Length),
+	m_Tags(m_OwnTags),
 	m_Pos(0)
 {
 	m_IsValid = Parse();
@@ -57,6 +58,20 @@ cParsedNBT::cParsedNBT(const char * a_Data, size_t a_Length) :
 
 
 
+cParsedNBT::cParsedNBT(const char * a_Data, size_t a_Length, cFastNBTTags & a_TagStorage) :
+	m_Data(a_Data),
+	m_Length(a_Length),
+	m_Tags(a_TagStorage),
+	m_Pos(0)
+{
+	m_Tags.clear();
+	m_IsValid = Parse();
+}
+
+
+
+
+
 bool cParsedNBT::Parse(void)
 {
 	if (m_Length < 3)
@@ -512,6 +527,18 @@ void cFastNBTWriter::AddByteArray(const AString & a_Name, const char * a_Value,
 
 
 
+void cFastNBTWriter::AddByteArray(const AString & a_Name, size_t a_NumElements, char a_Value)
+{
+	TagCommon(a_Name, TAG_ByteArray);
+	u_long len = htonl(static_cast<u_long>(a_NumElements));
+	m_Result.append(reinterpret_cast<const char *>(&len), 4);
+	m_Result.append(a_NumElements, a_Value);
+}
+
+
+
+
+
 void cFastNBTWriter::AddIntArray(const AString & a_Name, const int * a_Value, size_t a_NumElements)
 {
 	TagCommon(a_Name, TAG_IntArray);
@@ -107,6 +107,14 @@ public:
 
 
 
+/** The storage for the tags of a cParsedNBT.
+It can be supplied by the caller, so that its allocation is reused across many parses (see cParsedNBT). */
+typedef std::vector<cFastNBTTag> cFastNBTTags;
+
+
+
+
+
 /** Parses and contains the parsed data
 Also implements data accessor functions for tree traversal and value getters
 The data pointer passed in the constructor is assumed to be valid throughout the object's life. Care must be taken not to initialize from a temporary.
@@ -118,7 +126,16 @@ Each primitive tag also stores the length of the contained data, in bytes.
 class cParsedNBT
 {
 public:
+	/** Parses the data, storing the tags in the object's own storage. */
 	cParsedNBT(const char * a_Data, size_t a_Length);
+
+	/** Parses the data, storing the tags in a_TagStorage instead of allocating a new storage.
+	a_TagStorage is cleared first but keeps its capacity, so reusing it for bulk parsing avoids reallocations.
+	It must outlive this object and may be reused for another parse only after this object is no longer used. */
+	cParsedNBT(const char * a_Data, size_t a_Length, cFastNBTTags & a_TagStorage);
+
+	// Copying would leave m_Tags referencing the source object's storage:
+	cParsedNBT(const cParsedNBT &) = delete;
 	
 	bool IsValid(void) const {return m_IsValid; }
 	
@@ -256,7 +273,8 @@ public:
 protected:
 	const char *             m_Data;
 	size_t                   m_Length;
-	std::vector<cFastNBTTag> m_Tags;
+	cFastNBTTags             m_OwnTags;  // The tag storage used when the caller doesn't supply one
+	cFastNBTTags &           m_Tags;     // The tag storage actually used, either m_OwnTags or the caller-supplied one
 	bool                     m_IsValid;  // True if parsing succeeded
 
 	// Used while parsing:
@@ -298,6 +316,20 @@ public:
 	{
 		AddByteArray(a_Name, a_Value.data(), a_Value.size());
 	}
+
+	/** Adds a byte array consisting of a_NumElements copies of a_Value, without the need for a source array. */
+	void AddByteArray(const AString & a_Name, size_t a_NumElements, char a_Value);
+
+	/** Reserves space for the specified total size of the result, so that it doesn't need to be re-allocated while growing. */
+	void Reserve(size_t a_NumBytes) { m_Result.reserve(a_NumBytes); }
+
+	/** Counts one more item in the current list, without writing any data for it; the caller splices the item's data
+	into the stream at the current position of the result instead (used for reusing the already serialized items). */
+	void AddSplicedListItem(void)
+	{
+		ASSERT(!IsStackTopCompound());
+		m_Stack[m_CurrentStack].m_Count++;
+	}
 	
 	const AString & GetResult(void) const {return m_Result; }
 	
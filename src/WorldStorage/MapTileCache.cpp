@@ -0,0 +1,394 @@
+
+// MapTileCache.cpp
+
+// Implements the cMapTileCache class representing the top-down map tiles of a world, rendered for the webadmin
+
+#include "Globals.h"
+#include "MapTileCache.h"
+#include "../BlockInfo.h"
+#include "../Defines.h"
+#include "../StringCompression.h"
+#include "zlib/zlib.h"
+
+
+
+
+
+/** Number of bytes of a tile's pixels, also the size of the tile file. */
+static const size_t TILE_NUM_BYTES = cMapTileCache::TILE_SIZE * cMapTileCache::TILE_SIZE * 4;
+
+/** The colour of the fully occupying blocks that have no colour of their own in the table below. */
+static const UInt32 DEFAULT_BLOCK_COLOR = 0x808080;
+
+/** The map colours of the common surface blocks, as 0xRRGGBB, same as the vanilla maps use. */
+static const struct
+{
+	BLOCKTYPE m_BlockType;
+	UInt32 m_Color;
+} g_BlockColors[] =
+{
+	{E_BLOCK_STONE,            0x707070},
+	{E_BLOCK_GRASS,            0x7fb238},
+	{E_BLOCK_DIRT,             0x976d4d},
+	{E_BLOCK_COBBLESTONE,      0x707070},
+	{E_BLOCK_PLANKS,           0x8f7748},
+	{E_BLOCK_BEDROCK,          0x505050},
+	{E_BLOCK_WATER,            0x4040ff},
+	{E_BLOCK_STATIONARY_WATER, 0x4040ff},
+	{E_BLOCK_LAVA,             0xff0000},
+	{E_BLOCK_STATIONARY_LAVA,  0xff0000},
+	{E_BLOCK_SAND,             0xf7e9a3},
+	{E_BLOCK_GRAVEL,           0x8a8380},
+	{E_BLOCK_LOG,              0x8f7748},
+	{E_BLOCK_NEW_LOG,          0x8f7748},
+	{E_BLOCK_LEAVES,           0x007c00},
+	{E_BLOCK_NEW_LEAVES,       0x007c00},
+	{E_BLOCK_SANDSTONE,        0xf7e9a3},
+	{E_BLOCK_RED_SANDSTONE,    0xd87f33},
+	{E_BLOCK_WOOL,             0xc7c7c7},
+	{E_BLOCK_BRICK,            0x993333},
+	{E_BLOCK_OBSIDIAN,         0x191919},
+	{E_BLOCK_SNOW,             0xffffff},
+	{E_BLOCK_SNOW_BLOCK,       0xffffff},
+	{E_BLOCK_ICE,              0xa0a0ff},
+	{E_BLOCK_PACKED_ICE,       0xa0a0ff},
+	{E_BLOCK_CACTUS,           0x007c00},
+	{E_BLOCK_CLAY,             0xa4a8b8},
+	{E_BLOCK_HARDENED_CLAY,    0x974d3d},
+	{E_BLOCK_STAINED_CLAY,     0x974d3d},
+	{E_BLOCK_PUMPKIN,          0xd87f33},
+	{E_BLOCK_MELON,            0x7fcc19},
+	{E_BLOCK_NETHERRACK,       0x700200},
+	{E_BLOCK_SOULSAND,         0x664c33},
+	{E_BLOCK_GLOWSTONE,        0xf7e9a3},
+	{E_BLOCK_MYCELIUM,         0x7f3fb2},
+	{E_BLOCK_LILY_PAD,         0x007c00},
+	{E_BLOCK_FARMLAND,         0x976d4d},
+	{E_BLOCK_STONE_BRICKS,     0x707070},
+	{E_BLOCK_END_STONE,        0xf7e9a3},
+	{E_BLOCK_QUARTZ_BLOCK,     0xfffcf5},
+} ;
+
+
+
+
+
+/** Returns the colour with each component multiplied by a_Shade / 255. */
+static UInt32 ShadeColor(UInt32 a_Color, UInt32 a_Shade)
+{
+	UInt32 r = ((a_Color >> 16) & 0xff) * a_Shade / 255;
+	UInt32 g = ((a_Color >> 8)  & 0xff) * a_Shade / 255;
+	UInt32 b = (a_Color         & 0xff) * a_Shade / 255;
+	return (r << 16) | (g << 8) | b;
+}
+
+
+
+
+
+/** Appends a single PNG chunk of the specified type and data to a_PNG. */
+static void AppendPNGChunk(AString & a_PNG, const char * a_Type, const AString & a_Data)
+{
+	UInt32 Length = static_cast<UInt32>(a_Data.size());
+	Byte Header[8] =
+	{
+		static_cast<Byte>(Length >> 24), static_cast<Byte>(Length >> 16), static_cast<Byte>(Length >> 8), static_cast<Byte>(Length),
+		static_cast<Byte>(a_Type[0]), static_cast<Byte>(a_Type[1]), static_cast<Byte>(a_Type[2]), static_cast<Byte>(a_Type[3]),
+	};
+	a_PNG.append(reinterpret_cast<const char *>(Header), sizeof(Header));
+	a_PNG.append(a_Data);
+
+	// The CRC covers the type and the data:
+	uLong CRC = crc32(0, Header + 4, 4);
+	CRC = crc32(CRC, reinterpret_cast<const Bytef *>(a_Data.data()), static_cast<uInt>(a_Data.size()));
+	Byte Trailer[4] = {static_cast<Byte>(CRC >> 24), static_cast<Byte>(CRC >> 16), static_cast<Byte>(CRC >> 8), static_cast<Byte>(CRC)};
+	a_PNG.append(reinterpret_cast<const char *>(Trailer), sizeof(Trailer));
+}
+
+
+
+
+
+cMapTileCache::cMapTileCache(const AString & a_TileFolder, size_t a_MaxTiles) :
+	m_TileFolder(a_TileFolder),
+	m_MaxTiles(std::max<size_t>(a_MaxTiles, 1)),
+	m_IsEnabled(true)
+{
+	for (size_t i = 0; i < ARRAYCOUNT(m_BlockColors); i++)
+	{
+		m_BlockColors[i] = cBlockInfo::FullyOccupiesVoxel(static_cast<BLOCKTYPE>(i)) ? DEFAULT_BLOCK_COLOR : 0;
+	}
+	m_BlockColors[E_BLOCK_AIR] = 0;
+	for (size_t i = 0; i < ARRAYCOUNT(g_BlockColors); i++)
+	{
+		m_BlockColors[g_BlockColors[i].m_BlockType] = g_BlockColors[i].m_Color;
+	}
+}
+
+
+
+
+
+void cMapTileCache::SetMaxTiles(size_t a_MaxTiles)
+{
+	cCSLock Lock(m_CS);
+	m_MaxTiles = std::max<size_t>(a_MaxTiles, 1);
+	while (m_Tiles.size() > m_MaxTiles)
+	{
+		m_TileIndex.erase(m_Tiles.back().m_Coords);
+		m_Tiles.pop_back();
+	}
+}
+
+
+
+
+
+void cMapTileCache::SetEnabled(bool a_IsEnabled)
+{
+	cCSLock Lock(m_CS);
+	m_IsEnabled = a_IsEnabled;
+}
+
+
+
+
+
+bool cMapTileCache::IsEnabled(void)
+{
+	cCSLock Lock(m_CS);
+	return m_IsEnabled;
+}
+
+
+
+
+
+void cMapTileCache::UpdateChunk(int a_ChunkX, int a_ChunkZ, const cChunkDef::BlockTypes & a_BlockTypes, const int * a_HeightMap)
+{
+	// Render the chunk's pixels first, without holding the lock; each column is shaded by its height relative
+	// to its northern neighbour, same as the vanilla maps, so that the terrain's relief shows:
+	Byte Pixels[cChunkDef::Width * cChunkDef::Width * 4];
+	int PrevRowHeights[cChunkDef::Width];
+	for (int RelZ = 0; RelZ < cChunkDef::Width; RelZ++)
+	{
+		for (int RelX = 0; RelX < cChunkDef::Width; RelX++)
+		{
+			int Idx = RelZ * cChunkDef::Width + RelX;
+			int TopHeight;
+			UInt32 Color = GetColumnColor(a_BlockTypes, RelX, RelZ, a_HeightMap[Idx], TopHeight);
+			int NorthHeight = (RelZ > 0) ? PrevRowHeights[RelX] : TopHeight;
+			PrevRowHeights[RelX] = TopHeight;
+			Color = ShadeColor(Color, (TopHeight > NorthHeight) ? 255 : ((TopHeight < NorthHeight) ? 180 : 220));
+			Pixels[4 * Idx]     = static_cast<Byte>(Color >> 16);
+			Pixels[4 * Idx + 1] = static_cast<Byte>(Color >> 8);
+			Pixels[4 * Idx + 2] = static_cast<Byte>(Color);
+			Pixels[4 * Idx + 3] = 0xff;
+		}
+	}
+
+	int TileX = FAST_FLOOR_DIV(a_ChunkX, TILE_CHUNKS);
+	int TileZ = FAST_FLOOR_DIV(a_ChunkZ, TILE_CHUNKS);
+	int PixelX = (a_ChunkX - TileX * TILE_CHUNKS) * cChunkDef::Width;
+	int PixelZ = (a_ChunkZ - TileZ * TILE_CHUNKS) * cChunkDef::Width;
+	size_t RowBytes = cChunkDef::Width * 4;
+	cCSLock Lock(m_CS);
+	if (!m_IsEnabled)
+	{
+		return;
+	}
+	sTile * Tile = GetTile(TileX, TileZ, true);
+	bool IsNewFile = !cFile::IsFile(GetFileName(TileX, TileZ));
+	for (int RelZ = 0; RelZ < cChunkDef::Width; RelZ++)
+	{
+		size_t Ofs = (static_cast<size_t>(PixelZ + RelZ) * TILE_SIZE + static_cast<size_t>(PixelX)) * 4;
+		memcpy(Tile->m_Pixels.data() + Ofs, Pixels + static_cast<size_t>(RelZ) * RowBytes, RowBytes);
+	}
+	Tile->m_PNG.clear();
+	Tile->m_ETag.clear();
+
+	// Write the changed rows into the tile file; a new file is written whole:
+	cFile f;
+	if (!f.Open(GetFileName(TileX, TileZ), IsNewFile ? cFile::fmWrite : cFile::fmReadWrite))
+	{
+		cFile::CreateFolder(FILE_IO_PREFIX + m_TileFolder);
+		IsNewFile = true;
+		if (!f.Open(GetFileName(TileX, TileZ), cFile::fmWrite))
+		{
+			LOGWARNING("Cannot open the map tile file of tile [%d, %d] for writing.", TileX, TileZ);
+			return;
+		}
+	}
+	if (IsNewFile)
+	{
+		if (f.Write(Tile->m_Pixels.data(), TILE_NUM_BYTES) != static_cast<int>(TILE_NUM_BYTES))
+		{
+			LOGWARNING("Cannot write the map tile file of tile [%d, %d].", TileX, TileZ);
+		}
+		return;
+	}
+	for (int RelZ = 0; RelZ < cChunkDef::Width; RelZ++)
+	{
+		size_t Ofs = (static_cast<size_t>(PixelZ + RelZ) * TILE_SIZE + static_cast<size_t>(PixelX)) * 4;
+		if (
+			(f.Seek(static_cast<int>(Ofs)) < 0) ||
+			(f.Write(Tile->m_Pixels.data() + Ofs, RowBytes) != static_cast<int>(RowBytes))
+		)
+		{
+			LOGWARNING("Cannot write the map tile of chunk [%d, %d].", a_ChunkX, a_ChunkZ);
+			return;
+		}
+	}
+}
+
+
+
+
+
+bool cMapTileCache::GetTilePNG(int a_TileX, int a_TileZ, AString & a_PNG, AString & a_ETag)
+{
+	cCSLock Lock(m_CS);
+	if (!m_IsEnabled)
+	{
+		return false;
+	}
+	sTile * Tile = GetTile(a_TileX, a_TileZ, false);
+	if (Tile == nullptr)
+	{
+		return false;
+	}
+	if (Tile->m_PNG.empty())
+	{
+		// The tag is derived from the contents, so that it stays the same across server restarts:
+		EncodePNG(Tile->m_Pixels.data(), TILE_SIZE, Tile->m_PNG);
+		uLong CRC = crc32(0, reinterpret_cast<const Bytef *>(Tile->m_PNG.data()), static_cast<uInt>(Tile->m_PNG.size()));
+		Tile->m_ETag = Printf("\"%08lx-%x\"", CRC, static_cast<unsigned>(Tile->m_PNG.size()));
+	}
+	a_PNG = Tile->m_PNG;
+	a_ETag = Tile->m_ETag;
+	return true;
+}
+
+
+
+
+
+void cMapTileCache::EncodePNG(const Byte * a_Pixels, int a_Size, AString & a_PNG)
+{
+	static const char Signature[] = "\x89PNG\r\n\x1a\n";
+	a_PNG.assign(Signature, sizeof(Signature) - 1);
+
+	// IHDR: the size, 8 bits per component, RGBA, default compression, filtering and no interlacing:
+	UInt32 Size = static_cast<UInt32>(a_Size);
+	Byte IHDR[13] =
+	{
+		static_cast<Byte>(Size >> 24), static_cast<Byte>(Size >> 16), static_cast<Byte>(Size >> 8), static_cast<Byte>(Size),
+		static_cast<Byte>(Size >> 24), static_cast<Byte>(Size >> 16), static_cast<Byte>(Size >> 8), static_cast<Byte>(Size),
+		8, 6, 0, 0, 0
+	};
+	AppendPNGChunk(a_PNG, "IHDR", AString(reinterpret_cast<const char *>(IHDR), sizeof(IHDR)));
+
+	// IDAT: the zlib-compressed rows, each prefixed by the filter type, none used:
+	size_t RowBytes = static_cast<size_t>(a_Size) * 4;
+	AString Raw;
+	Raw.reserve((RowBytes + 1) * static_cast<size_t>(a_Size));
+	for (int y = 0; y < a_Size; y++)
+	{
+		Raw.push_back(0);
+		Raw.append(reinterpret_cast<const char *>(a_Pixels) + static_cast<size_t>(y) * RowBytes, RowBytes);
+	}
+	AString Compressed;
+	CompressString(Raw.data(), Raw.size(), Compressed, 6);
+	AppendPNGChunk(a_PNG, "IDAT", Compressed);
+
+	AppendPNGChunk(a_PNG, "IEND", AString());
+}
+
+
+
+
+
+cMapTileCache::sTile * cMapTileCache::GetTile(int a_TileX, int a_TileZ, bool a_ShouldCreate)
+{
+	// Try the memory first; move the tile to the front (splicing keeps the indexed iterator valid):
+	cChunkCoords Coords(a_TileX, a_TileZ);
+	auto itr = m_TileIndex.find(Coords);
+	if (itr != m_TileIndex.end())
+	{
+		m_Tiles.splice(m_Tiles.begin(), m_Tiles, itr->second);
+		return &*(itr->second);
+	}
+
+	// Read the tile file:
+	std::vector<Byte> Pixels;
+	cFile f;
+	if (f.Open(GetFileName(a_TileX, a_TileZ), cFile::fmRead))
+	{
+		Pixels.resize(TILE_NUM_BYTES);
+		if (f.Read(Pixels.data(), TILE_NUM_BYTES) != static_cast<int>(TILE_NUM_BYTES))
+		{
+			LOGWARNING("Cannot read the map tile file of tile [%d, %d], the tile will be re-rendered.", a_TileX, a_TileZ);
+			Pixels.clear();
+		}
+	}
+	if (Pixels.empty())
+	{
+		if (!a_ShouldCreate)
+		{
+			return nullptr;
+		}
+		Pixels.resize(TILE_NUM_BYTES, 0);
+	}
+
+	// Drop the least recently used tiles, if there are too many:
+	while (m_Tiles.size() >= m_MaxTiles)
+	{
+		m_TileIndex.erase(m_Tiles.back().m_Coords);
+		m_Tiles.pop_back();
+	}
+	m_Tiles.push_front(sTile(Coords));
+	m_Tiles.front().m_Pixels.swap(Pixels);
+	m_TileIndex[Coords] = m_Tiles.begin();
+	return &m_Tiles.front();
+}
+
+
+
+
+
+AString cMapTileCache::GetFileName(int a_TileX, int a_TileZ) const
+{
+	return Printf("%s%ct.%d.%d.mctile", m_TileFolder.c_str(), cFile::PathSeparator, a_TileX, a_TileZ);
+}
+
+
+
+
+
+UInt32 cMapTileCache::GetColumnColor(const cChunkDef::BlockTypes & a_BlockTypes, int a_RelX, int a_RelZ, int a_Height, int & a_TopHeight) const
+{
+	// Look through the blocks without a colour, such as flowers and torches:
+	int y = Clamp(a_Height, 0, cChunkDef::Height - 1);
+	while ((y > 0) && (m_BlockColors[cChunkDef::GetBlock(a_BlockTypes, a_RelX, y, a_RelZ)] == 0))
+	{
+		y--;
+	}
+	a_TopHeight = y;
+	BLOCKTYPE TopBlock = cChunkDef::GetBlock(a_BlockTypes, a_RelX, y, a_RelZ);
+	if (!IsBlockWater(TopBlock))
+	{
+		return m_BlockColors[TopBlock];
+	}
+
+	// Water gets darker with its depth, so that the shallows and the deep sea can be told apart:
+	int Depth = 0;
+	while ((y - Depth > 0) && IsBlockWater(cChunkDef::GetBlock(a_BlockTypes, a_RelX, y - Depth, a_RelZ)) && (Depth < 16))
+	{
+		Depth++;
+	}
+	return ShadeColor(m_BlockColors[TopBlock], static_cast<UInt32>(255 - Depth * 6));
+}
+
+
+
+
@@ -0,0 +1,105 @@
+
+// MapTileCache.h
+
+// Declares the cMapTileCache class representing the top-down map tiles of a world, rendered for the webadmin
+
+#pragma once
+
+#include "../ChunkDef.h"
+#include <unordered_map>
+
+
+
+
+
+/** Keeps a top-down map of the world's saved chunks, one pixel per column, split into square tiles of TILE_CHUNKS x TILE_CHUNKS
+chunks, so that the webadmin can show a map of the world without loading any chunks.
+The column colours are derived from the top block and the height map whenever a chunk is saved, and the tile's pixels are
+persisted in a tile file in the world folder, so the map is updated incrementally and survives restarts. The recently used
+tiles are held in memory in a LRU cache, together with their PNG encoding, which is re-encoded only when the tile changes.
+Thread-safe, all the members are protected by a single lock. */
+class cMapTileCache
+{
+public:
+	/** Number of chunks along each side of a tile. */
+	static const int TILE_CHUNKS = 16;
+
+	/** Number of pixels along each side of a tile. */
+	static const int TILE_SIZE = TILE_CHUNKS * cChunkDef::Width;
+
+
+	/** Creates the cache for the tile files in the specified folder, holding up to the specified number of tiles in memory. */
+	cMapTileCache(const AString & a_TileFolder, size_t a_MaxTiles);
+
+	/** Sets the maximum number of tiles held in memory, dropping the least recently used ones above it. */
+	void SetMaxTiles(size_t a_MaxTiles);
+
+	/** Enables or disables the map; while disabled, the chunks aren't rendered and no tiles are returned. */
+	void SetEnabled(bool a_IsEnabled);
+
+	bool IsEnabled(void);
+
+	/** Renders the specified chunk's columns into its tile and writes them into the tile file.
+	a_BlockTypes is the chunk's full block type array, a_HeightMap the height of the highest non-air block in each column,
+	indexed by (RelZ * 16 + RelX). Called from the storage thread when the chunk is saved. */
+	void UpdateChunk(int a_ChunkX, int a_ChunkZ, const cChunkDef::BlockTypes & a_BlockTypes, const int * a_HeightMap);
+
+	/** Returns the specified tile encoded as PNG in a_PNG, and its entity tag, changing whenever the tile changes, in a_ETag.
+	Returns false if the tile has no rendered chunks, or the map is disabled. */
+	bool GetTilePNG(int a_TileX, int a_TileZ, AString & a_PNG, AString & a_ETag);
+
+	/** Encodes the RGBA pixels of a square image of the specified size as PNG, into a_PNG. */
+	static void EncodePNG(const Byte * a_Pixels, int a_Size, AString & a_PNG);
+
+protected:
+	/** A tile in memory. */
+	struct sTile
+	{
+		cChunkCoords m_Coords;
+
+		/** The RGBA pixels, TILE_SIZE rows of TILE_SIZE pixels; the columns of the chunks that haven't been rendered are fully transparent. */
+		std::vector<Byte> m_Pixels;
+
+		/** The PNG encoding of m_Pixels and its entity tag; empty if the tile has changed since it was encoded. */
+		AString m_PNG;
+		AString m_ETag;
+
+		sTile(const cChunkCoords & a_Coords) : m_Coords(a_Coords) {}
+	} ;
+
+	typedef std::list<sTile> cTiles;
+
+	cCriticalSection m_CS;
+
+	/** The folder where the tile files are stored. */
+	AString m_TileFolder;
+
+	/** The tiles in memory, the most recently used first. */
+	cTiles m_Tiles;
+
+	/** Index into m_Tiles by the tile coords. */
+	std::unordered_map<cChunkCoords, cTiles::iterator, cChunkCoordsHash> m_TileIndex;
+
+	/** The maximum number of tiles in m_Tiles. */
+	size_t m_MaxTiles;
+
+	bool m_IsEnabled;
+
+	/** The map colour of each block type, as 0xRRGGBB; 0 for the blocks that are looked through, such as flowers or torches. */
+	UInt32 m_BlockColors[256];
+
+
+	/** Returns the specified tile, from memory or from its tile file. If the tile has no file, returns nullptr,
+	unless a_ShouldCreate is true, in which case a new fully transparent tile is returned. */
+	sTile * GetTile(int a_TileX, int a_TileZ, bool a_ShouldCreate);
+
+	/** Returns the file name of the specified tile's file. */
+	AString GetFileName(int a_TileX, int a_TileZ) const;
+
+	/** Returns the map colour of the specified column, as 0xRRGGBB, finding its top visible block below a_Height. */
+	UInt32 GetColumnColor(const cChunkDef::BlockTypes & a_BlockTypes, int a_RelX, int a_RelZ, int a_Height, int & a_TopHeight) const;
+} ;
+
+
+
+
@@ -52,6 +52,7 @@ cNBTChunkSerializer::cNBTChunkSerializer(cFastNBTWriter & a_Writer) :
 	m_HasHadBlockEntity(false),
 	m_IsLightValid(false)
 {
+	memset(m_SectionRevisions, 0, sizeof(m_SectionRevisions));
 }
 
 
@@ -65,7 +66,19 @@ void cNBTChunkSerializer::Finish(void)
 		m_Writer.EndList();
 	}
 	
-	// If light not valid, reset it to all zeroes:
+	// Expand the block data snapshot; if light not valid, reset it to all zeroes:
+	if (m_BlockDataSnapshot.get() != nullptr)
+	{
+		m_NumSections = m_BlockDataSnapshot->GetNumNonEmptySections();
+		m_BlockDataSnapshot->CopyBlockTypes(m_BlockTypes);
+		m_BlockDataSnapshot->CopyMetas(m_BlockMetas);
+		if (m_IsLightValid)
+		{
+			m_BlockDataSnapshot->CopyBlockLight(m_BlockLight);
+			m_BlockDataSnapshot->CopySkyLight(m_BlockSkyLight);
+		}
+		m_BlockDataSnapshot.reset();
+	}
 	if (!m_IsLightValid)
 	{
 		memset(m_BlockLight,    0, sizeof(m_BlockLight));
@@ -727,10 +740,14 @@ void cNBTChunkSerializer::AddHangingEntity(cHangingEntity * a_Hanging)
 
 void cNBTChunkSerializer::AddTNTEntity(cTNTEntity * a_TNT)
 {
-	m_Writer.BeginCompound("");
-		AddBasicEntity(a_TNT, "PrimedTnt");
-		m_Writer.AddByte("Fuse", (unsigned char)a_TNT->GetFuseTicks());
-	m_Writer.EndCompound();
+	// The merged TNTs are saved separately, they merge again once loaded:
+	for (int i = 0; i < a_TNT->GetCount(); i++)
+	{
+		m_Writer.BeginCompound("");
+			AddBasicEntity(a_TNT, "PrimedTnt");
+			m_Writer.AddByte("Fuse", (unsigned char)a_TNT->GetFuseTicks());
+		m_Writer.EndCompound();
+	}
 }
 
 
@@ -797,6 +814,20 @@ void cNBTChunkSerializer::AddMinecartChestContents(cMinecartWithChest * a_Mineca
 
 
 
+void cNBTChunkSerializer::ChunkData(const cChunkData & a_Data)
+{
+	// Only take a copy of the sections now, they're expanded in Finish() once the chunkmap is unlocked:
+	for (size_t i = 0; i < ARRAYCOUNT(m_SectionRevisions); i++)
+	{
+		m_SectionRevisions[i] = a_Data.GetSectionRevision(i);
+	}
+	m_BlockDataSnapshot.reset(new cChunkData(a_Data.Copy()));
+}
+
+
+
+
+
 void cNBTChunkSerializer::LightIsValid(bool a_IsLightValid)
 {
 	m_IsLightValid = a_IsLightValid;
@@ -64,10 +64,14 @@ public:
 	int m_VanillaHeightMap[cChunkDef::Width * cChunkDef::Width];
 	bool m_BiomesAreValid;
 
+	/** The revisions of the chunk's sections (see cChunkData::GetSectionRevision()), 0 if the block data wasn't received. */
+	UInt32 m_SectionRevisions[cChunkData::NumSections];
+
 
 	cNBTChunkSerializer(cFastNBTWriter & a_Writer);
 
-	/// Close NBT tags that we've opened
+	/** Close NBT tags that we've opened and expand the block data snapshot into the flat arrays.
+	Must be called after the chunk data has been retrieved, preferably with the chunkmap unlocked. */
 	void Finish(void);
 	
 	bool IsLightValid(void) const {return m_IsLightValid; }
@@ -79,6 +83,7 @@ protected:
 	- m_BlockMetas[]
 	- m_BlockLight[]
 	- m_BlockSkyLight[]
+	- m_NumSections
 	*/
 	
 	cFastNBTWriter & m_Writer;
@@ -88,6 +93,11 @@ protected:
 	bool m_HasHadBlockEntity;  // True if any BlockEntity has already been received and processed
 	bool m_IsLightValid;  // True if the chunk lighting is valid
 
+	/** Copy of the chunk's block data, taken in ChunkData() while the chunkmap is locked.
+	It only holds the sections that are present, so it is much cheaper to take than expanding into the flat arrays;
+	the expanding is done in Finish(), after the chunkmap has been unlocked. */
+	std::unique_ptr<cChunkData> m_BlockDataSnapshot;
+
 
 	/// Writes an item into the writer, if slot >= 0, adds the Slot tag. The compound is named as requested.
 	void AddItem(const cItem & a_Item, int a_Slot, const AString & a_CompoundName = "");
@@ -129,6 +139,7 @@ protected:
 	void AddMinecartChestContents(cMinecartWithChest * a_Minecart);
 	
 	// cChunkDataSeparateCollector overrides:
+	virtual void ChunkData(const cChunkData & a_Data) override;
 	virtual void LightIsValid(bool a_IsLightValid) override;
 	virtual void HeightMap(const cChunkDef::HeightMap * a_HeightMap) override;
 	virtual void BiomeData(const cChunkDef::BiomeMap * a_BiomeMap) override;
@@ -43,37 +43,201 @@ public:
 
 
 
+/** Reads the NBT primitives from a GZip file, inflating it in small pieces. */
+class cSchematicStreamReader
+{
+public:
+	cSchematicStreamReader(cGZipFile & a_File) :
+		m_File(a_File)
+	{
+	}
+
+
+	/** Reads exactly a_Size bytes into a_Dest. Returns false if the file ends sooner or cannot be read. */
+	bool ReadBytes(void * a_Dest, size_t a_Size)
+	{
+		char * Dest = reinterpret_cast<char *>(a_Dest);
+		while (a_Size > 0)
+		{
+			int ToRead = static_cast<int>(std::min<size_t>(a_Size, 1 MiB));
+			int NumRead = m_File.Read(Dest, ToRead);
+			if (NumRead <= 0)
+			{
+				return false;
+			}
+			Dest += NumRead;
+			a_Size -= static_cast<size_t>(NumRead);
+		}
+		return true;
+	}
+
+
+	/** Reads and throws away a_Size bytes. Returns false if the file ends sooner or cannot be read. */
+	bool SkipBytes(size_t a_Size)
+	{
+		char Buffer[16 KiB];
+		while (a_Size > 0)
+		{
+			size_t ToRead = std::min(a_Size, sizeof(Buffer));
+			if (!ReadBytes(Buffer, ToRead))
+			{
+				return false;
+			}
+			a_Size -= ToRead;
+		}
+		return true;
+	}
+
+
+	bool ReadByte(Byte & a_Value)
+	{
+		return ReadBytes(&a_Value, 1);
+	}
+
+
+	bool ReadShort(Int16 & a_Value)
+	{
+		char Data[2];
+		if (!ReadBytes(Data, sizeof(Data)))
+		{
+			return false;
+		}
+		a_Value = GetBEShort(Data);
+		return true;
+	}
+
+
+	bool ReadInt(Int32 & a_Value)
+	{
+		char Data[4];
+		if (!ReadBytes(Data, sizeof(Data)))
+		{
+			return false;
+		}
+		a_Value = GetBEInt(Data);
+		return true;
+	}
+
+
+	/** Reads a string prefixed with its UInt16 length, as used for the tag names and the TAG_String payload. */
+	bool ReadString(AString & a_Value)
+	{
+		Int16 Length;
+		if (!ReadShort(Length))
+		{
+			return false;
+		}
+		a_Value.resize(static_cast<UInt16>(Length));
+		return a_Value.empty() || ReadBytes(&a_Value[0], a_Value.size());
+	}
+
+
+	/** Reads and throws away the payload of a tag of the specified type, including all its children. */
+	bool SkipPayload(eTagType a_Type, int a_Depth = 0)
+	{
+		if (a_Depth > 512)
+		{
+			// Too deep, this is hardly a valid file
+			return false;
+		}
+		switch (a_Type)
+		{
+			case TAG_Byte:   return SkipBytes(1);
+			case TAG_Short:  return SkipBytes(2);
+			case TAG_Int:    return SkipBytes(4);
+			case TAG_Long:   return SkipBytes(8);
+			case TAG_Float:  return SkipBytes(4);
+			case TAG_Double: return SkipBytes(8);
+			case TAG_String:
+			{
+				AString Value;
+				return ReadString(Value);
+			}
+			case TAG_ByteArray:
+			case TAG_IntArray:
+			{
+				Int32 Length;
+				if (!ReadInt(Length) || (Length < 0))
+				{
+					return false;
+				}
+				return SkipBytes(static_cast<size_t>(Length) * ((a_Type == TAG_IntArray) ? 4 : 1));
+			}
+			case TAG_List:
+			{
+				Byte ItemType;
+				Int32 Count;
+				if (!ReadByte(ItemType) || !ReadInt(Count) || (Count < 0) || (ItemType > TAG_Max))
+				{
+					return false;
+				}
+				for (Int32 i = 0; i < Count; i++)
+				{
+					if (!SkipPayload(static_cast<eTagType>(ItemType), a_Depth + 1))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			case TAG_Compound:
+			{
+				for (;;)
+				{
+					Byte ChildType;
+					if (!ReadByte(ChildType) || (ChildType > TAG_Max))
+					{
+						return false;
+					}
+					if (ChildType == TAG_End)
+					{
+						return true;
+					}
+					AString Name;
+					if (!ReadString(Name) || !SkipPayload(static_cast<eTagType>(ChildType), a_Depth + 1))
+					{
+						return false;
+					}
+				}
+			}
+			case TAG_End:
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+protected:
+	cGZipFile & m_File;
+} ;
+
+
+
+
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // cSchematicFileSerializer:
 
 bool cSchematicFileSerializer::LoadFromSchematicFile(cBlockArea & a_BlockArea, const AString & a_FileName)
 {
-	// Un-GZip the contents:
-	AString Contents;
 	cGZipFile File;
 	if (!File.Open(a_FileName, cGZipFile::fmRead))
 	{
 		LOG("Cannot open the schematic file \"%s\".", a_FileName.c_str());
 		return false;
 	}
-	int NumBytesRead = File.ReadRestOfFile(Contents);
-	if (NumBytesRead < 0)
-	{
-		LOG("Cannot read GZipped data in the schematic file \"%s\", error %d", a_FileName.c_str(), NumBytesRead);
-		return false;
-	}
-	File.Close();
 	
-	// Parse the NBT:
-	cParsedNBT NBT(Contents.data(), Contents.size());
-	if (!NBT.IsValid())
+	// Inflate and parse the NBT at the same time, directly into the area:
+	cSchematicStreamReader Reader(File);
+	if (!LoadFromSchematicStream(a_BlockArea, Reader))
 	{
-		LOG("Cannot parse the NBT in the schematic file \"%s\".", a_FileName.c_str());
+		a_BlockArea.Clear();
+		LOG("Cannot load the schematic file \"%s\".", a_FileName.c_str());
 		return false;
 	}
-	
-	return LoadFromSchematicNBT(a_BlockArea, NBT);
+	return true;
 }
 
 
@@ -160,6 +324,204 @@ bool cSchematicFileSerializer::SaveToSchematicString(const cBlockArea & a_BlockA
 
 
 
+bool cSchematicFileSerializer::LoadFromSchematicStream(cBlockArea & a_BlockArea, cSchematicStreamReader & a_Reader)
+{
+	// The root tag is a compound, its children are the schematic's values:
+	Byte RootType;
+	AString RootName;
+	if (!a_Reader.ReadByte(RootType) || (RootType != TAG_Compound) || !a_Reader.ReadString(RootName))
+	{
+		LOG("The schematic's NBT doesn't start with a compound tag.");
+		return false;
+	}
+	
+	// The dimensions normally precede the block arrays; if they don't, the arrays are buffered until the end:
+	int SizeX = -1, SizeY = -1, SizeZ = -1;
+	int OffsetX = 0, OffsetY = 0, OffsetZ = 0;
+	int NumOffsets = 0;
+	bool IsAllocated = false;
+	bool HasTypes = false, HasMetas = false;
+	AString PendingTypes, PendingMetas;
+	a_BlockArea.Clear();
+	for (;;)
+	{
+		Byte TagType;
+		if (!a_Reader.ReadByte(TagType) || (TagType > TAG_Max))
+		{
+			LOG("Cannot parse the NBT in the schematic data.");
+			return false;
+		}
+		if (TagType == TAG_End)
+		{
+			break;
+		}
+		AString Name;
+		if (!a_Reader.ReadString(Name))
+		{
+			LOG("Cannot parse the NBT in the schematic data.");
+			return false;
+		}
+		
+		if ((TagType == TAG_Short) && ((Name == "Width") || (Name == "Height") || (Name == "Length")))
+		{
+			Int16 Value;
+			if (!a_Reader.ReadShort(Value))
+			{
+				return false;
+			}
+			int & Size = (Name == "Width") ? SizeX : ((Name == "Height") ? SizeY : SizeZ);
+			Size = Value;
+			continue;
+		}
+		if ((TagType == TAG_Int) && ((Name == "WEOffsetX") || (Name == "WEOffsetY") || (Name == "WEOffsetZ")))
+		{
+			Int32 Value;
+			if (!a_Reader.ReadInt(Value))
+			{
+				return false;
+			}
+			int & Offset = (Name == "WEOffsetX") ? OffsetX : ((Name == "WEOffsetY") ? OffsetY : OffsetZ);
+			Offset = Value;
+			NumOffsets += 1;
+			continue;
+		}
+		if ((TagType == TAG_String) && (Name == "Materials"))
+		{
+			AString Materials;
+			if (!a_Reader.ReadString(Materials))
+			{
+				return false;
+			}
+			if (Materials.compare("Alpha") != 0)
+			{
+				LOG("Materials tag is present and \"%s\" instead of \"Alpha\". Possibly a wrong-format schematic file.", Materials.c_str());
+				return false;
+			}
+			continue;
+		}
+		if ((TagType == TAG_ByteArray) && ((Name == "Blocks") || (Name == "Data")))
+		{
+			Int32 Length;
+			if (!a_Reader.ReadInt(Length) || (Length < 0))
+			{
+				return false;
+			}
+			bool IsTypes = (Name == "Blocks");
+			(IsTypes ? HasTypes : HasMetas) = true;
+			if (!IsAllocated && (SizeX > 0) && (SizeY > 0) && (SizeZ > 0))
+			{
+				if ((SizeY > 256) || !a_BlockArea.SetSize(SizeX, SizeY, SizeZ, 0))
+				{
+					LOG("Dimensions are invalid in the schematic file: %d, %d, %d", SizeX, SizeY, SizeZ);
+					return false;
+				}
+				IsAllocated = true;
+			}
+			if (!IsAllocated)
+			{
+				// The dimensions are not known yet, keep the array until they are:
+				AString & Pending = IsTypes ? PendingTypes : PendingMetas;
+				Pending.resize(static_cast<size_t>(Length));
+				if ((Length > 0) && !a_Reader.ReadBytes(&Pending[0], Pending.size()))
+				{
+					return false;
+				}
+				continue;
+			}
+			size_t NumBlocks = a_BlockArea.GetBlockCount();
+			Byte * Dest;
+			if (IsTypes)
+			{
+				delete[] a_BlockArea.m_BlockTypes;
+				a_BlockArea.m_BlockTypes = new BLOCKTYPE[NumBlocks];
+				Dest = a_BlockArea.m_BlockTypes;
+			}
+			else
+			{
+				delete[] a_BlockArea.m_BlockMetas;
+				a_BlockArea.m_BlockMetas = new NIBBLETYPE[NumBlocks];
+				Dest = a_BlockArea.m_BlockMetas;
+			}
+			if (!ReadBlockArray(a_Reader, Dest, NumBlocks, static_cast<size_t>(Length), Name.c_str()))
+			{
+				return false;
+			}
+			continue;
+		}
+		
+		// Not a value that the area needs (entities, block entities, ...):
+		if (!a_Reader.SkipPayload(static_cast<eTagType>(TagType)))
+		{
+			LOG("Cannot parse the NBT in the schematic data.");
+			return false;
+		}
+	}  // for (;;) - root tag's children
+	
+	if ((SizeX < 1) || (SizeY < 1) || (SizeY > 256) || (SizeZ < 1))
+	{
+		LOG("Dimensions are missing or invalid in the schematic file: %d, %d, %d", SizeX, SizeY, SizeZ);
+		a_BlockArea.Clear();
+		return false;
+	}
+	if (!HasTypes)
+	{
+		LOG("BlockTypes are missing in the schematic file");
+		a_BlockArea.Clear();
+		return false;
+	}
+	
+	// Apply the arrays that came before the dimensions:
+	if (!IsAllocated)
+	{
+		if (!a_BlockArea.SetSize(SizeX, SizeY, SizeZ, cBlockArea::baTypes | (HasMetas ? cBlockArea::baMetas : 0)))
+		{
+			return false;
+		}
+		size_t NumBlocks = a_BlockArea.GetBlockCount();
+		size_t NumTypes = std::min(NumBlocks, PendingTypes.size());
+		memcpy(a_BlockArea.m_BlockTypes, PendingTypes.data(), NumTypes);
+		memset(a_BlockArea.m_BlockTypes + NumTypes, 0, NumBlocks - NumTypes);
+		if (HasMetas)
+		{
+			size_t NumMetas = std::min(NumBlocks, PendingMetas.size());
+			memcpy(a_BlockArea.m_BlockMetas, PendingMetas.data(), NumMetas);
+			memset(a_BlockArea.m_BlockMetas + NumMetas, 0, NumBlocks - NumMetas);
+		}
+	}
+	
+	// Not every schematic file has an offset:
+	if (NumOffsets == 3)
+	{
+		a_BlockArea.SetWEOffset(OffsetX, OffsetY, OffsetZ);
+	}
+	else
+	{
+		a_BlockArea.SetWEOffset(0, 0, 0);
+	}
+	return true;
+}
+
+
+
+
+
+bool cSchematicFileSerializer::ReadBlockArray(cSchematicStreamReader & a_Reader, Byte * a_Dest, size_t a_NumBlocks, size_t a_Length, const char * a_ArrayName)
+{
+	if (a_Length < a_NumBlocks)
+	{
+		LOG("%s truncated in the schematic file (exp %d, got %d bytes). Loading partial.",
+			a_ArrayName, static_cast<int>(a_NumBlocks), static_cast<int>(a_Length)
+		);
+		memset(a_Dest + a_Length, 0, a_NumBlocks - a_Length);
+		return a_Reader.ReadBytes(a_Dest, a_Length);
+	}
+	return a_Reader.ReadBytes(a_Dest, a_NumBlocks) && a_Reader.SkipBytes(a_Length - a_NumBlocks);
+}
+
+
+
+
+
 bool cSchematicFileSerializer::LoadFromSchematicNBT(cBlockArea & a_BlockArea, cParsedNBT & a_NBT)
 {
 	int TMaterials = a_NBT.FindChildByName(a_NBT.GetRoot(), "Materials");
@@ -265,6 +627,9 @@ bool cSchematicFileSerializer::LoadFromSchematicNBT(cBlockArea & a_BlockArea, cP
 AString cSchematicFileSerializer::SaveToSchematicNBT(const cBlockArea & a_BlockArea)
 {
 	cFastNBTWriter Writer("Schematic");
+
+	// The two block arrays make up most of the data, reserve space for them upfront, with some room for the other tags:
+	Writer.Reserve(2 * a_BlockArea.GetBlockCount() + 1024);
 	Writer.AddShort("Width",  a_BlockArea.m_Size.x);
 	Writer.AddShort("Height", a_BlockArea.m_Size.y);
 	Writer.AddShort("Length", a_BlockArea.m_Size.z);
@@ -275,8 +640,7 @@ AString cSchematicFileSerializer::SaveToSchematicNBT(const cBlockArea & a_BlockA
 	}
 	else
 	{
-		AString Dummy(a_BlockArea.GetBlockCount(), 0);
-		Writer.AddByteArray("Blocks", Dummy.data(), Dummy.size());
+		Writer.AddByteArray("Blocks", a_BlockArea.GetBlockCount(), 0);
 	}
 	if (a_BlockArea.HasBlockMetas())
 	{
@@ -284,8 +648,7 @@ AString cSchematicFileSerializer::SaveToSchematicNBT(const cBlockArea & a_BlockA
 	}
 	else
 	{
-		AString Dummy(a_BlockArea.GetBlockCount(), 0);
-		Writer.AddByteArray("Data", Dummy.data(), Dummy.size());
+		Writer.AddByteArray("Data", a_BlockArea.GetBlockCount(), 0);
 	}
 	
 	Writer.AddInt("WEOffsetX", a_BlockArea.m_WEOffset.x);
@@ -18,6 +18,9 @@
 // fwd: FastNBT.h
 class cParsedNBT;
 
+// fwd: SchematicFileSerializer.cpp
+class cSchematicStreamReader;
+
 
 
 
@@ -40,6 +43,15 @@ public:
 	static bool SaveToSchematicString(const cBlockArea & a_BlockArea, AString & a_Out);
 	
 private:
+	/** Loads the area from the uncompressed NBT data read from the stream, one tag at a time. The block arrays are read
+	directly into the area, so the whole file is never kept in memory. Returns true if successful. */
+	static bool LoadFromSchematicStream(cBlockArea & a_BlockArea, cSchematicStreamReader & a_Reader);
+
+	/** Reads a Blocks or Data array of a_Length bytes from the stream into a_Dest, which has space for a_NumBlocks bytes.
+	The rest of a longer array is skipped, a shorter array is loaded partially and the rest is zeroed.
+	Returns true if successful. */
+	static bool ReadBlockArray(cSchematicStreamReader & a_Reader, Byte * a_Dest, size_t a_NumBlocks, size_t a_Length, const char * a_ArrayName);
+
 	/** Loads the area from a schematic file uncompressed and parsed into a NBT tree.
 	Returns true if successful. */
 	static bool LoadFromSchematicNBT(cBlockArea & a_BlockArea, cParsedNBT & a_NBT);
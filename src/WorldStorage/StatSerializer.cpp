@@ -6,6 +6,7 @@
 #include "StatSerializer.h"
 
 #include "../Statistics.h"
+#include "../OSSupport/AsyncFileWriter.h"
 
 
 
@@ -21,9 +22,6 @@ cStatSerializer::cStatSerializer(const AString & a_WorldName, const AString & a_
 	Printf(StatsPath, "%s%cstats", a_WorldName.c_str(), cFile::PathSeparator);
 
 	m_Path = StatsPath + "/" + a_PlayerName + ".json";
-
-	// Ensure that the directory exists.
-	cFile::CreateFolder(FILE_IO_PREFIX + StatsPath);
 }
 
 
@@ -55,22 +53,21 @@ bool cStatSerializer::Load(void)
 
 bool cStatSerializer::Save(void)
 {
-	Json::Value Root;
-	SaveStatToJSON(Root);
+	// The directory is created, if needed:
+	return cAsyncFileWriter::WriteFileSafely(GetFileName(), SaveToString());
+}
 
-	cFile File;
-	if (!File.Open(FILE_IO_PREFIX + m_Path, cFile::fmWrite))
-	{
-		return false;
-	}
 
-	Json::StyledWriter Writer;
-	AString JsonData = Writer.write(Root);
 
-	File.Write(JsonData.data(), JsonData.size());
-	File.Close();
 
-	return true;
+
+AString cStatSerializer::SaveToString(void)
+{
+	Json::Value Root;
+	SaveStatToJSON(Root);
+
+	Json::FastWriter Writer;
+	return Writer.write(Root);
 }
 
 
@@ -33,6 +33,12 @@ public:
 	/* Try to save the player statistics. Returns whether the operation was successful or not. */
 	bool Save(void);
 
+	/** Returns the player statistics serialized into JSON, as Save() writes them into the file. */
+	AString SaveToString(void);
+
+	/** Returns the name of the file where the player statistics are stored. */
+	AString GetFileName(void) const { return FILE_IO_PREFIX + m_Path; }
+
 
 protected:
 
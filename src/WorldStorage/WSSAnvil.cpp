@@ -64,11 +64,6 @@ thus making skylight visible in Minutor's Lighting mode
 */
 // #define DEBUG_SKYLIGHT
 
-/** Maximum number of MCA files that are cached in memory.
-Since only the header is actually in the memory, this number can be high, but still, each file means an OS FS handle.
-*/
-#define MAX_MCA_FILES 32
-
 #define LOAD_FAILED(CHX, CHZ) \
 	{ \
 		const int RegionX = FAST_FLOOR_DIV(CHX, 32); \
@@ -89,9 +84,68 @@ Since only the header is actually in the memory, this number can be high, but st
 ////////////////////////////////////////////////////////////////////////////////
 // cWSSAnvil:
 
-cWSSAnvil::cWSSAnvil(cWorld * a_World, int a_CompressionFactor) :
+/** Compresses the data into a raw deflate segment, appended to a_Out, using a_Stream (reset before use, so that the segment
+doesn't refer to any data before it). a_Flush is Z_SYNC_FLUSH for the segments followed by others, which ends the segment
+on a byte boundary, or Z_FINISH for the last segment of the stream. Returns true on success. */
+static bool DeflateSegment(z_stream & a_Stream, const Bytef * a_Data, size_t a_Size, int a_Flush, AString & a_Out)
+{
+	if (deflateReset(&a_Stream) != Z_OK)
+	{
+		return false;
+	}
+	a_Stream.next_in = const_cast<Bytef *>(a_Data);
+	a_Stream.avail_in = static_cast<uInt>(a_Size);
+	for (;;)
+	{
+		size_t OldSize = a_Out.size();
+		size_t Room = static_cast<size_t>(deflateBound(&a_Stream, a_Stream.avail_in)) + 16;  // Room for the flush marker, too
+		a_Out.resize(OldSize + Room);
+		a_Stream.next_out = reinterpret_cast<Bytef *>(&a_Out[OldSize]);
+		a_Stream.avail_out = static_cast<uInt>(Room);
+		int res = deflate(&a_Stream, a_Flush);
+		a_Out.resize(OldSize + Room - a_Stream.avail_out);
+		if ((res == Z_STREAM_ERROR) || ((res == Z_BUF_ERROR) && (a_Stream.avail_out == 0)))
+		{
+			return false;
+		}
+		if ((a_Flush == Z_FINISH) ? (res == Z_STREAM_END) : (a_Stream.avail_out > 0))
+		{
+			// All the data has been compressed and flushed
+			return true;
+		}
+	}
+}
+
+
+
+
+
+cWSSAnvil::cWSSAnvil(cWorld * a_World, eCompressionCodec a_Compression, int a_CompressionFactor, size_t a_MaxOpenFiles, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize) :
+	cWSSAnvil(a_World, a_Compression, a_CompressionFactor, a_MaxOpenFiles, a_ChunkDataCacheSize, a_SectionCacheSize, "region", "mca")
+{
+}
+
+
+
+
+
+cWSSAnvil::cWSSAnvil(cWorld * a_World, eCompressionCodec a_Compression, int a_CompressionFactor, size_t a_MaxOpenFiles, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize, const AString & a_RegionFolder, const AString & a_RegionFileExt) :
 	super(a_World),
-	m_CompressionFactor(a_CompressionFactor)
+	m_MaxOpenFiles(std::max<size_t>(a_MaxOpenFiles, 1)),
+	m_NumFileCacheHits(0),
+	m_NumFileCacheMisses(0),
+	m_NumFileCacheEvictions(0),
+	m_ChunkDataCacheSize(0),
+	m_MaxChunkDataCacheSize(a_ChunkDataCacheSize),
+	m_NumChunkDataCacheHits(0),
+	m_NumChunkDataCacheMisses(0),
+	m_SectionCacheSize(0),
+	m_MaxSectionCacheSize(a_SectionCacheSize),
+	m_Compression(a_Compression),
+	m_CompressionFactor(a_CompressionFactor),
+	m_RegionFolder(a_RegionFolder),
+	m_RegionFileExt(a_RegionFileExt),
+	m_NumBytesSaved(0)
 {
 	// Create a level.dat file for mapping tools, if it doesn't already exist:
 	AString fnam;
@@ -147,6 +201,22 @@ cWSSAnvil::~cWSSAnvil()
 	{
 		delete *itr;
 	}  // for itr - m_Files[]
+	if (m_NumFileCacheMisses > 0)
+	{
+		LOGD("%s \"%s\" region file cache: %llu hits, %llu misses, %llu evictions (%u files max)",
+			m_World->GetName().c_str(), m_RegionFolder.c_str(),
+			static_cast<unsigned long long>(m_NumFileCacheHits), static_cast<unsigned long long>(m_NumFileCacheMisses),
+			static_cast<unsigned long long>(m_NumFileCacheEvictions), static_cast<unsigned>(m_MaxOpenFiles)
+		);
+	}
+	if (m_NumChunkDataCacheMisses > 0)
+	{
+		LOGD("%s \"%s\" chunk data cache: %llu hits, %llu misses (%u KiB max)",
+			m_World->GetName().c_str(), m_RegionFolder.c_str(),
+			static_cast<unsigned long long>(m_NumChunkDataCacheHits), static_cast<unsigned long long>(m_NumChunkDataCacheMisses),
+			static_cast<unsigned>(m_MaxChunkDataCacheSize / 1024)
+		);
+	}
 }
 
 
@@ -156,13 +226,14 @@ cWSSAnvil::~cWSSAnvil()
 bool cWSSAnvil::LoadChunk(const cChunkCoords & a_Chunk)
 {
 	AString ChunkData;
-	if (!GetChunkData(a_Chunk, ChunkData))
+	eCompressionCodec Codec;
+	if (!GetChunkData(a_Chunk, ChunkData, Codec))
 	{
 		// The reason for failure is already printed in GetChunkData()
 		return false;
 	}
 	
-	return LoadChunkFromData(a_Chunk, ChunkData);
+	return LoadChunkFromData(a_Chunk, ChunkData, Codec);
 }
 
 
@@ -191,22 +262,222 @@ bool cWSSAnvil::SaveChunk(const cChunkCoords & a_Chunk)
 
 
 
-bool cWSSAnvil::GetChunkData(const cChunkCoords & a_Chunk, AString & a_Data)
+void cWSSAnvil::LoadChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results)
+{
+	size_t NumChunks = a_Chunks.size();
+
+	// Read the raw data; the file access is serialized anyway, so it's done in this thread:
+	std::vector<AString> Data(NumChunks);
+	std::vector<eCompressionCodec> Codecs(NumChunks, ccZlib);
+	a_Results.resize(NumChunks);
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		a_Results[i] = GetChunkData(a_Chunks[i], Data[i], Codecs[i]);
+	}
+
+	// Uncompress the data and parse the NBT in parallel; the parsed NBT references the uncompressed data:
+	std::vector<AString> Uncompressed(NumChunks);
+	std::vector<int> InflateResults(NumChunks, Z_OK);
+	std::vector<std::unique_ptr<cParsedNBT>> NBTs(NumChunks);
+	if (m_LoadTagStorage.size() < NumChunks)
+	{
+		m_LoadTagStorage.resize(NumChunks);
+	}
+	cRoot::Get()->GetThreadPool().ParallelFor(NumChunks, [&](size_t a_Idx)
+		{
+			if (!a_Results[a_Idx])
+			{
+				return;
+			}
+			InflateResults[a_Idx] = UncompressStringWithCodec(Codecs[a_Idx], Data[a_Idx].data(), Data[a_Idx].size(), Uncompressed[a_Idx]);
+			if (InflateResults[a_Idx] == Z_OK)
+			{
+				NBTs[a_Idx].reset(new cParsedNBT(Uncompressed[a_Idx].data(), Uncompressed[a_Idx].size(), m_LoadTagStorage[a_Idx]));
+			}
+		},
+		cThreadPool::tpNormal
+	);
+
+	// Load the chunks from the NBT, in the queue order; this creates the entities and hands the chunk to the world:
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		if (!a_Results[i])
+		{
+			// The reason for failure is already printed in GetChunkData()
+			continue;
+		}
+		if (InflateResults[i] != Z_OK)
+		{
+			LOGWARNING("Uncompressing chunk [%d, %d] failed: %d", a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ, InflateResults[i]);
+			LOAD_FAILED(a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			a_Results[i] = false;
+			continue;
+		}
+		if (!NBTs[i]->IsValid())
+		{
+			// NBT Parsing failed
+			LOAD_FAILED(a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			a_Results[i] = false;
+			continue;
+		}
+		a_Results[i] = LoadChunkFromNBT(a_Chunks[i], *NBTs[i]);
+	}
+}
+
+
+
+
+
+void cWSSAnvil::SaveChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results)
+{
+	size_t NumChunks = a_Chunks.size();
+
+	// Serialize the chunks into NBT; this reads the chunks from the world, so it's done in this thread:
+	std::vector<std::unique_ptr<cFastNBTWriter>> Writers(NumChunks);
+	std::vector<cNBTSections> Sections(NumChunks);
+	a_Results.resize(NumChunks);
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		Writers[i].reset(new cFastNBTWriter);
+		a_Results[i] = SaveChunkToNBT(a_Chunks[i], *Writers[i], &Sections[i]);
+		if (!a_Results[i])
+		{
+			LOGWARNING("Cannot save chunk [%d, %d] to NBT", a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			continue;
+		}
+		Writers[i]->Finish();
+	}
+
+	// Compress the data in parallel, releasing each NBT as soon as it's compressed:
+	std::vector<AString> Data(NumChunks);
+	std::vector<char> IsCompressed(NumChunks, 0);
+	cRoot::Get()->GetThreadPool().ParallelFor(NumChunks, [&](size_t a_Idx)
+		{
+			if (a_Results[a_Idx])
+			{
+				IsCompressed[a_Idx] = CompressChunkData(Writers[a_Idx]->GetResult(), Data[a_Idx], &Sections[a_Idx]) ? 1 : 0;
+				Writers[a_Idx].reset();
+			}
+		},
+		cThreadPool::tpLow
+	);
+
+	// Write the data into the files:
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		if (!a_Results[i])
+		{
+			continue;
+		}
+		if (!IsCompressed[i] || !SetChunkData(a_Chunks[i], Data[i]))
+		{
+			LOGWARNING("Cannot store chunk [%d, %d] data", a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			a_Results[i] = false;
+			continue;
+		}
+		CacheSections(a_Chunks[i], Sections[i]);
+	}
+}
+
+
+
+
+
+void cWSSAnvil::Flush(void)
+{
+	cCSLock Lock(m_CS);
+	for (cMCAFiles::iterator itr = m_Files.begin(); itr != m_Files.end(); ++itr)
+	{
+		(*itr)->Flush();
+	}  // for itr - m_Files[]
+}
+
+
+
+
+
+UInt64 cWSSAnvil::GetNumBytesSaved(void)
+{
+	cCSLock Lock(m_CS);
+	return m_NumBytesSaved;
+}
+
+
+
+
+
+size_t cWSSAnvil::CompactStep(void)
+{
+	// Only the open files get compacted, those are the ones in use. Start with the least recently used, its chunks
+	// are the least likely to be saved again soon:
+	cCSLock Lock(m_CS);
+	for (cMCAFiles::reverse_iterator itr = m_Files.rbegin(); itr != m_Files.rend(); ++itr)
+	{
+		size_t NumBytes = (*itr)->CompactStep();
+		if (NumBytes > 0)
+		{
+			return NumBytes;
+		}
+	}  // for itr - m_Files[]
+	return 0;
+}
+
+
+
+
+
+void cWSSAnvil::PrefetchChunks(const cChunkCoordsVector & a_Chunks)
 {
+	// The region headers get read (and cached) as part of opening the files, the chunk data is left for the OS:
 	cCSLock Lock(m_CS);
+	for (const auto & Chunk: a_Chunks)
+	{
+		cMCAFile * File = LoadMCAFile(Chunk);
+		if (File != nullptr)
+		{
+			File->PrefetchChunk(Chunk);
+		}
+	}
+}
+
+
+
+
+
+bool cWSSAnvil::GetChunkData(const cChunkCoords & a_Chunk, AString & a_Data, eCompressionCodec & a_Codec)
+{
+	cCSLock Lock(m_CS);
+
+	// Use the cached data, if available:
+	auto itr = m_ChunkDataCacheIndex.find(a_Chunk);
+	if (itr != m_ChunkDataCacheIndex.end())
+	{
+		m_NumChunkDataCacheHits++;
+		m_ChunkDataCache.splice(m_ChunkDataCache.begin(), m_ChunkDataCache, itr->second);
+		a_Data = itr->second->m_Data;
+		a_Codec = itr->second->m_Codec;
+		return true;
+	}
+	m_NumChunkDataCacheMisses++;
+
 	cMCAFile * File = LoadMCAFile(a_Chunk);
 	if (File == nullptr)
 	{
 		return false;
 	}
-	return File->GetChunkData(a_Chunk, a_Data);
+	if (!File->GetChunkData(a_Chunk, a_Data, a_Codec))
+	{
+		return false;
+	}
+	CacheChunkData(a_Chunk, a_Codec, a_Data);
+	return true;
 }
 
 
 
 
 
-bool cWSSAnvil::SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Data)
+bool cWSSAnvil::SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Sectors)
 {
 	cCSLock Lock(m_CS);
 	cMCAFile * File = LoadMCAFile(a_Chunk);
@@ -214,7 +485,57 @@ bool cWSSAnvil::SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Dat
 	{
 		return false;
 	}
-	return File->SetChunkData(a_Chunk, a_Data);
+	if (!File->SetChunkData(a_Chunk, a_Sectors))
+	{
+		return false;
+	}
+	m_NumBytesSaved += a_Sectors.size();
+
+	// Cache the data the same way cMCAFile::GetChunkData() would return it, without the chunk header and the padding:
+	if (m_MaxChunkDataCacheSize > 0)
+	{
+		ASSERT(a_Sectors.size() > MCA_CHUNK_HEADER_LENGTH);
+		size_t DataSize = static_cast<size_t>(GetBEInt(a_Sectors.data())) - 1;
+		ASSERT(MCA_CHUNK_HEADER_LENGTH + DataSize <= a_Sectors.size());
+		CacheChunkData(a_Chunk, static_cast<eCompressionCodec>(a_Sectors[4]), a_Sectors.substr(MCA_CHUNK_HEADER_LENGTH, DataSize));
+	}
+	return true;
+}
+
+
+
+
+
+void cWSSAnvil::CacheChunkData(const cChunkCoords & a_Chunk, eCompressionCodec a_Codec, const AString & a_Data)
+{
+	ASSERT(m_CS.IsLocked());
+	if (a_Data.size() > m_MaxChunkDataCacheSize)
+	{
+		// Disabled, or a chunk too large to be worth caching:
+		return;
+	}
+
+	// Replace the previous data, if any:
+	auto itr = m_ChunkDataCacheIndex.find(a_Chunk);
+	if (itr != m_ChunkDataCacheIndex.end())
+	{
+		m_ChunkDataCacheSize -= itr->second->m_Data.size();
+		m_ChunkDataCache.erase(itr->second);
+		m_ChunkDataCacheIndex.erase(itr);
+	}
+	sCachedChunkData Cached = {a_Chunk, a_Codec, a_Data};
+	m_ChunkDataCache.push_front(Cached);
+	m_ChunkDataCacheIndex[a_Chunk] = m_ChunkDataCache.begin();
+	m_ChunkDataCacheSize += a_Data.size();
+
+	// Drop the least recently used chunks over the limit:
+	while (m_ChunkDataCacheSize > m_MaxChunkDataCacheSize)
+	{
+		const sCachedChunkData & Oldest = m_ChunkDataCache.back();
+		m_ChunkDataCacheSize -= Oldest.m_Data.size();
+		m_ChunkDataCacheIndex.erase(Oldest.m_Chunk);
+		m_ChunkDataCache.pop_back();
+	}
 }
 
 
@@ -234,38 +555,38 @@ cWSSAnvil::cMCAFile * cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
 	ASSERT(a_Chunk.m_ChunkZ - RegionZ * 32 < 32);
 	
 	// Is it already cached?
-	for (cMCAFiles::iterator itr = m_Files.begin(); itr != m_Files.end(); ++itr)
+	const cChunkCoords Region(RegionX, RegionZ);
+	auto itr = m_FileIndex.find(Region);
+	if (itr != m_FileIndex.end())
 	{
-		if (((*itr) != nullptr) && ((*itr)->GetRegionX() == RegionX) && ((*itr)->GetRegionZ() == RegionZ))
-		{
-			// Move the file to front and return it:
-			cMCAFile * f = *itr;
-			if (itr != m_Files.begin())
-			{
-				m_Files.erase(itr);
-				m_Files.push_front(f);
-			}
-			return f;
-		}
+		// Move the file to front and return it (splicing keeps the indexed iterator valid):
+		m_NumFileCacheHits++;
+		m_Files.splice(m_Files.begin(), m_Files, itr->second);
+		return *(itr->second);
 	}
+	m_NumFileCacheMisses++;
 	
 	// Load it anew:
 	AString FileName;
-	Printf(FileName, "%s%cregion", m_World->GetName().c_str(), cFile::PathSeparator);
+	Printf(FileName, "%s%c%s", m_World->GetName().c_str(), cFile::PathSeparator, m_RegionFolder.c_str());
 	cFile::CreateFolder(FILE_IO_PREFIX + FileName);
-	AppendPrintf(FileName, "/r.%d.%d.mca", RegionX, RegionZ);
+	AppendPrintf(FileName, "/r.%d.%d.%s", RegionX, RegionZ, m_RegionFileExt.c_str());
 	cMCAFile * f = new cMCAFile(FileName, RegionX, RegionZ);
 	if (f == nullptr)
 	{
 		return nullptr;
 	}
 	m_Files.push_front(f);
+	m_FileIndex[Region] = m_Files.begin();
 	
-	// If there are too many MCA files cached, delete the last one used:
-	if (m_Files.size() > MAX_MCA_FILES)
+	// If there are too many MCA files cached, close the least recently used ones:
+	while (m_Files.size() > m_MaxOpenFiles)
 	{
-		delete m_Files.back();
+		cMCAFile * Oldest = m_Files.back();
+		m_FileIndex.erase(cChunkCoords(Oldest->GetRegionX(), Oldest->GetRegionZ()));
 		m_Files.pop_back();
+		delete Oldest;
+		m_NumFileCacheEvictions++;
 	}
 	return f;
 }
@@ -274,11 +595,11 @@ cWSSAnvil::cMCAFile * cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
 
 
 
-bool cWSSAnvil::LoadChunkFromData(const cChunkCoords & a_Chunk, const AString & a_Data)
+bool cWSSAnvil::LoadChunkFromData(const cChunkCoords & a_Chunk, const AString & a_Data, eCompressionCodec a_Codec)
 {
 	// Uncompress the data:
 	AString Uncompressed;
-	int res = InflateString(a_Data.data(), a_Data.size(), Uncompressed);
+	int res = UncompressStringWithCodec(a_Codec, a_Data.data(), a_Data.size(), Uncompressed);
 	if (res != Z_OK)
 	{
 		LOGWARNING("Uncompressing chunk [%d, %d] failed: %d", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, res);
@@ -303,17 +624,22 @@ bool cWSSAnvil::LoadChunkFromData(const cChunkCoords & a_Chunk, const AString &
 
 
 
-bool cWSSAnvil::SaveChunkToData(const cChunkCoords & a_Chunk, AString & a_Data)
+bool cWSSAnvil::SaveChunkToData(const cChunkCoords & a_Chunk, AString & a_Sectors)
 {
 	cFastNBTWriter Writer;
-	if (!SaveChunkToNBT(a_Chunk, Writer))
+	cNBTSections Sections;
+	if (!SaveChunkToNBT(a_Chunk, Writer, &Sections))
 	{
 		LOGWARNING("Cannot save chunk [%d, %d] to NBT", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
 		return false;
 	}
 	Writer.Finish();
 	
-	CompressString(Writer.GetResult().data(), Writer.GetResult().size(), a_Data, m_CompressionFactor);
+	if (!CompressChunkData(Writer.GetResult(), a_Sectors, &Sections))
+	{
+		return false;
+	}
+	CacheSections(a_Chunk, Sections);
 	return true;
 }
 
@@ -321,18 +647,219 @@ bool cWSSAnvil::SaveChunkToData(const cChunkCoords & a_Chunk, AString & a_Data)
 
 
 
+bool cWSSAnvil::CompressChunkData(const AString & a_Data, AString & a_Sectors, cNBTSections * a_Sections)
+{
+	size_t CompressedSize;
+	if ((m_Compression == ccZlib) && (a_Sections != nullptr) && !a_Sections->empty())
+	{
+		// Splice the cached sections into the stream, compress the rest:
+		a_Sectors.resize(MCA_CHUNK_HEADER_LENGTH);
+		if (!CompressChunkDataBySections(a_Data, a_Sectors, *a_Sections))
+		{
+			LOGWARNING("Compressing chunk data by sections failed");
+			a_Sectors.clear();
+			return false;
+		}
+		CompressedSize = a_Sectors.size() - MCA_CHUNK_HEADER_LENGTH;
+	}
+	else if (m_Compression == ccZlib)
+	{
+		// Compress directly behind the space reserved for the chunk header, so that the data needn't be copied afterwards:
+		// HACK: We're assuming that AString returns its internal buffer in its data() call and we're overwriting that buffer!
+		uLongf ZlibSize = compressBound(static_cast<uLong>(a_Data.size()));
+		a_Sectors.resize(MCA_CHUNK_HEADER_LENGTH + ZlibSize);
+		int res = compress2(
+			reinterpret_cast<Bytef *>(const_cast<char *>(a_Sectors.data())) + MCA_CHUNK_HEADER_LENGTH, &ZlibSize,
+			reinterpret_cast<const Bytef *>(a_Data.data()), static_cast<uLong>(a_Data.size()), m_CompressionFactor
+		);
+		if (res != Z_OK)
+		{
+			LOGWARNING("Compressing chunk data failed: %d", res);
+			a_Sectors.clear();
+			return false;
+		}
+		CompressedSize = static_cast<size_t>(ZlibSize);
+	}
+	else
+	{
+		AString Compressed;
+		int res = CompressStringWithCodec(m_Compression, a_Data.data(), a_Data.size(), Compressed, m_CompressionFactor);
+		if (res != Z_OK)
+		{
+			LOGWARNING("Compressing chunk data failed: %d", res);
+			a_Sectors.clear();
+			return false;
+		}
+		CompressedSize = Compressed.size();
+		a_Sectors.resize(MCA_CHUNK_HEADER_LENGTH);
+		a_Sectors.append(Compressed);
+	}
+
+	// Fill in the chunk header: the data length (including the compression type) and the compression type:
+	SetBEInt(const_cast<char *>(a_Sectors.data()), static_cast<Int32>(CompressedSize + 1));
+	a_Sectors[4] = static_cast<char>(m_Compression);
+
+	// Pad to whole sectors:
+	size_t NumBytes = MCA_CHUNK_HEADER_LENGTH + CompressedSize;
+	a_Sectors.resize((NumBytes + 4095) / 4096 * 4096, 0);
+	return true;
+}
+
+
+
+
+
+bool cWSSAnvil::CompressChunkDataBySections(const AString & a_Data, AString & a_Compressed, cNBTSections & a_Sections)
+{
+	// Each segment of the stream is compressed with a freshly reset deflater, so that it doesn't refer to the data before it,
+	// and is flushed to a byte boundary, so that the segments can be concatenated; this is how parallel gzip works, too.
+	z_stream Stream;
+	memset(&Stream, 0, sizeof(Stream));
+	if (deflateInit2(&Stream, m_CompressionFactor, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return false;
+	}
+
+	// The zlib header, with the same compression level hint as zlib's own:
+	int Level = (m_CompressionFactor < 0) ? 6 : m_CompressionFactor;
+	int LevelFlags = (Level < 2) ? 0 : ((Level < 6) ? 1 : ((Level == 6) ? 2 : 3));
+	int Header = (0x78 << 8) | (LevelFlags << 6);
+	Header += 31 - (Header % 31);
+	a_Compressed.push_back(static_cast<char>(Header >> 8));
+	a_Compressed.push_back(static_cast<char>(Header & 0xff));
+
+	const Bytef * Data = reinterpret_cast<const Bytef *>(a_Data.data());
+	uLong Adler = adler32(0, nullptr, 0);
+	size_t Pos = 0;
+	bool IsSuccess = true;
+	for (auto & Section: a_Sections)
+	{
+		// The NBT preceding the section:
+		ASSERT(Section.m_Pos >= Pos);
+		if (Section.m_Pos > Pos)
+		{
+			IsSuccess = DeflateSegment(Stream, Data + Pos, Section.m_Pos - Pos, Z_SYNC_FLUSH, a_Compressed);
+			if (!IsSuccess)
+			{
+				break;
+			}
+			Adler = adler32(Adler, Data + Pos, static_cast<uInt>(Section.m_Pos - Pos));
+		}
+		Pos = Section.m_Pos + Section.m_Size;
+
+		// A section written into the NBT is compressed on its own, so that it can be spliced into the next saves:
+		if (Section.m_Size > 0)
+		{
+			cCompressedSectionPtr Compressed = std::make_shared<sCompressedSection>();
+			Compressed->m_Revision = Section.m_Revision;
+			Compressed->m_IsLightValid = Section.m_IsLightValid;
+			IsSuccess = DeflateSegment(Stream, Data + Section.m_Pos, Section.m_Size, Z_SYNC_FLUSH, Compressed->m_Data);
+			if (!IsSuccess)
+			{
+				break;
+			}
+			Compressed->m_Adler32 = static_cast<UInt32>(adler32(adler32(0, nullptr, 0), Data + Section.m_Pos, static_cast<uInt>(Section.m_Size)));
+			Compressed->m_NBTSize = Section.m_Size;
+			Section.m_Compressed = Compressed;
+		}
+		ASSERT(Section.m_Compressed != nullptr);
+		a_Compressed.append(Section.m_Compressed->m_Data);
+		Adler = adler32_combine(Adler, Section.m_Compressed->m_Adler32, static_cast<z_off_t>(Section.m_Compressed->m_NBTSize));
+	}
+
+	// The rest of the NBT ends the stream:
+	if (IsSuccess)
+	{
+		IsSuccess = DeflateSegment(Stream, Data + Pos, a_Data.size() - Pos, Z_FINISH, a_Compressed);
+		Adler = adler32(Adler, Data + Pos, static_cast<uInt>(a_Data.size() - Pos));
+	}
+	deflateEnd(&Stream);
+	if (!IsSuccess)
+	{
+		return false;
+	}
+
+	// The zlib trailer, the checksum of all the uncompressed data:
+	char Trailer[4];
+	SetBEInt(Trailer, static_cast<Int32>(Adler));
+	a_Compressed.append(Trailer, sizeof(Trailer));
+	return true;
+}
+
+
+
+
+
+const cWSSAnvil::cNBTSections * cWSSAnvil::FindCachedSections(const cChunkCoords & a_Chunk)
+{
+	auto itr = m_SectionCacheIndex.find(a_Chunk);
+	if (itr == m_SectionCacheIndex.end())
+	{
+		return nullptr;
+	}
+
+	// Move the chunk to front (splicing keeps the indexed iterator valid):
+	m_SectionCache.splice(m_SectionCache.begin(), m_SectionCache, itr->second);
+	return &(itr->second->m_Sections);
+}
+
+
+
+
+
+void cWSSAnvil::CacheSections(const cChunkCoords & a_Chunk, const cNBTSections & a_Sections)
+{
+	if (m_MaxSectionCacheSize == 0)
+	{
+		return;
+	}
+
+	// Replace the previously cached sections, if any:
+	auto itr = m_SectionCacheIndex.find(a_Chunk);
+	if (itr != m_SectionCacheIndex.end())
+	{
+		m_SectionCacheSize -= itr->second->m_Size;
+		m_SectionCache.erase(itr->second);
+		m_SectionCacheIndex.erase(itr);
+	}
+
+	// The sections without a revision (their block data wasn't available) cannot be matched later, don't cache those:
+	sCachedSections Cached = {a_Chunk, cNBTSections(), 0};
+	for (const auto & Section: a_Sections)
+	{
+		if ((Section.m_Compressed != nullptr) && (Section.m_Revision != 0))
+		{
+			Cached.m_Sections.push_back(Section);
+			Cached.m_Size += Section.m_Compressed->m_Data.size();
+		}
+	}
+	if (Cached.m_Sections.empty() || (Cached.m_Size > m_MaxSectionCacheSize))
+	{
+		return;
+	}
+	m_SectionCacheSize += Cached.m_Size;
+	m_SectionCache.push_front(std::move(Cached));
+	m_SectionCacheIndex[a_Chunk] = m_SectionCache.begin();
+
+	// Drop the least recently used chunks over the limit:
+	while (m_SectionCacheSize > m_MaxSectionCacheSize)
+	{
+		const sCachedSections & Oldest = m_SectionCache.back();
+		m_SectionCacheSize -= Oldest.m_Size;
+		m_SectionCacheIndex.erase(Oldest.m_Chunk);
+		m_SectionCache.pop_back();
+	}
+}
+
+
+
+
+
 bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT & a_NBT)
 {
-	// The data arrays, in MCA-native y / z / x ordering (will be reordered for the final chunk data)
-	cChunkDef::BlockTypes   BlockTypes;
-	cChunkDef::BlockNibbles MetaData;
-	cChunkDef::BlockNibbles BlockLight;
-	cChunkDef::BlockNibbles SkyLight;
-	
-	memset(BlockTypes, E_BLOCK_AIR, sizeof(BlockTypes));
-	memset(MetaData,   0,           sizeof(MetaData));
-	memset(SkyLight,   0xff,        sizeof(SkyLight));  // By default, data not present in the NBT means air, which means full skylight
-	memset(BlockLight, 0x00,        sizeof(BlockLight));
+	// The blocks are loaded section by section directly into the chunk's storage, which is then moved into the chunk.
+	// The sections not present in the NBT are air, with full skylight:
+	cChunkData ChunkData(m_World->GetChunkMap()->GetSectionPool());
 	
 	// Load the blockdata, blocklight and skylight:
 	int Level = a_NBT.FindChildByName(0, "Level");
@@ -366,10 +893,18 @@ bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT
 		{
 			continue;
 		}
-		CopyNBTData(a_NBT, Child, "Blocks",     (char *)&(BlockTypes[y * 4096]), 4096);
-		CopyNBTData(a_NBT, Child, "Data",       (char *)&(MetaData[y   * 2048]), 2048);
-		CopyNBTData(a_NBT, Child, "SkyLight",   (char *)&(SkyLight[y   * 2048]), 2048);
-		CopyNBTData(a_NBT, Child, "BlockLight", (char *)&(BlockLight[y * 2048]), 2048);
+		const BLOCKTYPE * BlockTypes = reinterpret_cast<const BLOCKTYPE *>(GetNBTByteArray(a_NBT, Child, "Blocks", 4096));
+		if (BlockTypes == nullptr)
+		{
+			continue;
+		}
+		ChunkData.SetSection(
+			static_cast<size_t>(y),
+			BlockTypes,
+			reinterpret_cast<const NIBBLETYPE *>(GetNBTByteArray(a_NBT, Child, "Data",       2048)),
+			reinterpret_cast<const NIBBLETYPE *>(GetNBTByteArray(a_NBT, Child, "BlockLight", 2048)),
+			reinterpret_cast<const NIBBLETYPE *>(GetNBTByteArray(a_NBT, Child, "SkyLight",   2048))
+		);
 	}  // for itr - LevelSections[]
 	
 	// Load the biomes from NBT, if present and valid. First try MCS-style, then Vanilla-style:
@@ -385,7 +920,7 @@ bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT
 	cEntityList      Entities;
 	cBlockEntityList BlockEntities;
 	LoadEntitiesFromNBT     (Entities,      a_NBT, a_NBT.FindChildByName(Level, "Entities"));
-	LoadBlockEntitiesFromNBT(BlockEntities, a_NBT, a_NBT.FindChildByName(Level, "TileEntities"), BlockTypes, MetaData);
+	LoadBlockEntitiesFromNBT(BlockEntities, a_NBT, a_NBT.FindChildByName(Level, "TileEntities"), ChunkData);
 	
 	bool IsLightValid = (a_NBT.FindChildByName(Level, "MCSIsLightValid") > 0);
 	
@@ -427,9 +962,7 @@ bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT
 	
 	cSetChunkDataPtr SetChunkData(new cSetChunkData(
 		a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ,
-		BlockTypes, MetaData,
-		IsLightValid ? BlockLight : nullptr,
-		IsLightValid ? SkyLight : nullptr,
+		std::move(ChunkData), IsLightValid,
 		nullptr, Biomes,
 		std::move(Entities), std::move(BlockEntities),
 		false
@@ -441,20 +974,21 @@ bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT
 
 
 
-void cWSSAnvil::CopyNBTData(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, char * a_Destination, size_t a_Length)
+const char * cWSSAnvil::GetNBTByteArray(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, size_t a_Length)
 {
 	int Child = a_NBT.FindChildByName(a_Tag, a_ChildName);
 	if ((Child >= 0) && (a_NBT.GetType(Child) == TAG_ByteArray) && (a_NBT.GetDataLength(Child) == a_Length))
 	{
-		memcpy(a_Destination, a_NBT.GetData(Child), a_Length);
+		return a_NBT.GetData(Child);
 	}
+	return nullptr;
 }
 
 
 
 
 
-bool cWSSAnvil::SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_Writer)
+bool cWSSAnvil::SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_Writer, cNBTSections * a_Sections)
 {
 	a_Writer.BeginCompound("Level");
 	a_Writer.AddInt("xPos", a_Chunk.m_ChunkX);
@@ -478,6 +1012,23 @@ bool cWSSAnvil::SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_
 	// Save heightmap (Vanilla require this):
 	a_Writer.AddIntArray("HeightMap", (const int *)Serializer.m_VanillaHeightMap, ARRAYCOUNT(Serializer.m_VanillaHeightMap));
 
+	// Persist the column summary next to the region file, so that the height and biome queries needn't load the chunk:
+	if (Serializer.m_BiomesAreValid)
+	{
+		HEIGHTTYPE Heights[ARRAYCOUNT(Serializer.m_VanillaHeightMap)];
+		for (size_t i = 0; i < ARRAYCOUNT(Heights); i++)
+		{
+			Heights[i] = static_cast<HEIGHTTYPE>(Serializer.m_VanillaHeightMap[i]);
+		}
+		m_World->GetColumnSummaries().SetChunk(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, Heights, Serializer.m_VanillaBiomes, true);
+	}
+
+	// Render the chunk into the webadmin's map tile:
+	if (m_World->GetMapTiles().IsEnabled())
+	{
+		m_World->GetMapTiles().UpdateChunk(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, Serializer.m_BlockTypes, Serializer.m_VanillaHeightMap);
+	}
+
 	// Save blockdata:
 	a_Writer.BeginList("Sections", TAG_Compound);
 	size_t SliceSizeBlock  = cChunkDef::Width * cChunkDef::Width * 16;
@@ -490,8 +1041,37 @@ bool cWSSAnvil::SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_
 		const char * BlockLight  = (const char *)(Serializer.m_BlockLight);
 	#endif
 	const char * BlockSkyLight = (const char *)(Serializer.m_BlockSkyLight);
-	for (int Y = 0; Y < 16; Y++)
+
+	// The empty sections above the terrain are left out, same as vanilla does; they load as air with full skylight.
+	// The sections that haven't changed since the chunk was last saved are spliced in from the cache by CompressChunkData():
+	bool ShouldTrackSections = ((a_Sections != nullptr) && (m_Compression == ccZlib) && (m_MaxSectionCacheSize > 0));
+	const cNBTSections * CachedSections = ShouldTrackSections ? FindCachedSections(a_Chunk) : nullptr;
+	int NumSections = static_cast<int>(Serializer.m_NumSections);
+	for (int Y = 0; Y < NumSections; Y++)
 	{
+		sNBTSection Section = {Y, Serializer.m_SectionRevisions[Y], Serializer.IsLightValid(), a_Writer.GetResult().size(), 0, nullptr};
+		if ((CachedSections != nullptr) && (Section.m_Revision != 0))
+		{
+			for (const auto & Cached: *CachedSections)
+			{
+				if (
+					(Cached.m_SectionY == Y) &&
+					(Cached.m_Compressed->m_Revision == Section.m_Revision) &&
+					(Cached.m_Compressed->m_IsLightValid == Section.m_IsLightValid)
+				)
+				{
+					Section.m_Compressed = Cached.m_Compressed;
+					break;
+				}
+			}
+			if (Section.m_Compressed != nullptr)
+			{
+				a_Writer.AddSplicedListItem();
+				a_Sections->push_back(Section);
+				continue;
+			}
+		}
+
 		a_Writer.BeginCompound("");
 		a_Writer.AddByteArray("Blocks",     BlockTypes    + Y * SliceSizeBlock,  SliceSizeBlock);
 		a_Writer.AddByteArray("Data",       BlockMetas    + Y * SliceSizeNibble, SliceSizeNibble);
@@ -499,6 +1079,11 @@ bool cWSSAnvil::SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_
 		a_Writer.AddByteArray("BlockLight", BlockLight    + Y * SliceSizeNibble, SliceSizeNibble);
 		a_Writer.AddByte("Y", (unsigned char)Y);
 		a_Writer.EndCompound();
+		if (ShouldTrackSections)
+		{
+			Section.m_Size = a_Writer.GetResult().size() - Section.m_Pos;
+			a_Sections->push_back(Section);
+		}
 	}
 	a_Writer.EndList();  // "Sections"
 	
@@ -605,7 +1190,7 @@ void cWSSAnvil::LoadEntitiesFromNBT(cEntityList & a_Entities, const cParsedNBT &
 
 
 
-void cWSSAnvil::LoadBlockEntitiesFromNBT(cBlockEntityList & a_BlockEntities, const cParsedNBT & a_NBT, int a_TagIdx, BLOCKTYPE * a_BlockTypes, NIBBLETYPE * a_BlockMetas)
+void cWSSAnvil::LoadBlockEntitiesFromNBT(cBlockEntityList & a_BlockEntities, const cParsedNBT & a_NBT, int a_TagIdx, const cChunkData & a_ChunkData)
 {
 	if ((a_TagIdx < 0) || (a_NBT.GetType(a_TagIdx) != TAG_List))
 	{
@@ -630,8 +1215,8 @@ void cWSSAnvil::LoadBlockEntitiesFromNBT(cBlockEntityList & a_BlockEntities, con
 		cChunkDef::AbsoluteToRelative(RelX, RelY, RelZ, ChunkX, ChunkZ);
 
 		// Load the proper BlockEntity type based on the block type:
-		BLOCKTYPE BlockType = cChunkDef::GetBlock(a_BlockTypes, RelX, RelY, RelZ);
-		NIBBLETYPE BlockMeta = cChunkDef::GetNibble(a_BlockMetas, RelX, RelY, RelZ);
+		BLOCKTYPE BlockType = a_ChunkData.GetBlock(RelX, RelY, RelZ);
+		NIBBLETYPE BlockMeta = a_ChunkData.GetMeta(RelX, RelY, RelZ);
 		std::unique_ptr<cBlockEntity> be(LoadBlockEntityFromNBT(a_NBT, Child, x, y, z, BlockType, BlockMeta));
 		if (be.get() == nullptr)
 		{
@@ -2966,7 +3551,9 @@ bool cWSSAnvil::GetBlockEntityNBTPos(const cParsedNBT & a_NBT, int a_TagIdx, int
 cWSSAnvil::cMCAFile::cMCAFile(const AString & a_FileName, int a_RegionX, int a_RegionZ) :
 	m_RegionX(a_RegionX),
 	m_RegionZ(a_RegionZ),
-	m_FileName(a_FileName)
+	m_FileName(a_FileName),
+	m_IsHeaderDirty(false),
+	m_IsCompact(false)
 {
 }
 
@@ -2974,6 +3561,161 @@ cWSSAnvil::cMCAFile::cMCAFile(const AString & a_FileName, int a_RegionX, int a_R
 
 
 
+cWSSAnvil::cMCAFile::~cMCAFile()
+{
+	Flush();
+}
+
+
+
+
+
+bool cWSSAnvil::cMCAFile::Flush(void)
+{
+	if (!m_IsHeaderDirty)
+	{
+		return true;
+	}
+	if (
+		(m_File.Seek(0) < 0) ||
+		(m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header)) ||
+		(m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
+	)
+	{
+		LOGWARNING("Cannot write the MCA header to file \"%s\", the recently saved chunks in that file will be lost", m_FileName.c_str());
+		return false;
+	}
+	m_IsHeaderDirty = false;
+
+	// The file no longer references the released sectors, they can be reused:
+	for (auto & Range: m_SectorsToFree)
+	{
+		MarkSectors(Range.first, Range.second, false);
+		m_IsCompact = false;
+	}
+	m_SectorsToFree.clear();
+	return true;
+}
+
+
+
+
+
+size_t cWSSAnvil::cMCAFile::CompactStep(void)
+{
+	if (m_IsCompact || !OpenFile(true))
+	{
+		return 0;
+	}
+
+	// Find the chunk stored last in the file:
+	size_t LastIdx = ARRAYCOUNT(m_Header);
+	unsigned LastSector = 0;
+	unsigned LastLen = 0;
+	for (size_t i = 0; i < ARRAYCOUNT(m_Header); i++)
+	{
+		unsigned ChunkLocation = ntohl(m_Header[i]);
+		unsigned ChunkSector = ChunkLocation >> 8;
+		if ((ChunkSector >= 2) && (ChunkSector > LastSector) && ((ChunkLocation & 0xff) > 0))
+		{
+			LastIdx = i;
+			LastSector = ChunkSector;
+			LastLen = ChunkLocation & 0xff;
+		}
+	}
+	if (LastIdx == ARRAYCOUNT(m_Header))
+	{
+		// No chunks in the file
+		m_IsCompact = true;
+		return 0;
+	}
+
+	// Read the chunk and check that its data fits the sectors that the header says it occupies:
+	AString Data;
+	Data.resize(LastLen * 4096);
+	if (m_File.Seek(static_cast<int>(LastSector) * 4096) < 0)
+	{
+		m_IsCompact = true;
+		return 0;
+	}
+	// HACK: This depends on the internal knowledge that AString's data() function returns the internal buffer directly
+	int NumRead = m_File.Read(const_cast<char *>(Data.data()), Data.size());
+	if (NumRead < MCA_CHUNK_HEADER_LENGTH)
+	{
+		m_IsCompact = true;
+		return 0;
+	}
+	const Byte * ChunkHeader = reinterpret_cast<const Byte *>(Data.data());
+	size_t ChunkSize = (static_cast<size_t>(ChunkHeader[0]) << 24) | (static_cast<size_t>(ChunkHeader[1]) << 16) | (static_cast<size_t>(ChunkHeader[2]) << 8) | ChunkHeader[3];
+	if (ChunkSize + 4 > Data.size())
+	{
+		// The data overflows the chunk's sectors (written by a buggy tool); neither move it nor cut the file after it
+		m_IsCompact = true;
+		return 0;
+	}
+
+	// Find the first free range before the chunk that is large enough, so that the chunks are packed towards the file start:
+	unsigned NewSector = 0;
+	unsigned RangeStart = 2;
+	for (unsigned Sector = 2; Sector < LastSector; Sector++)
+	{
+		if (m_UsedSectors[Sector])
+		{
+			RangeStart = Sector + 1;
+			continue;
+		}
+		if (Sector + 1 - RangeStart >= LastLen)
+		{
+			NewSector = RangeStart;
+			break;
+		}
+	}
+	if (NewSector == 0)
+	{
+		// No gap can hold the chunk. Write the header, so that the old sectors of the moved chunks get released,
+		// and cut off the free sectors at the end of the file:
+		bool WasHeaderDirty = m_IsHeaderDirty;
+		if (!Flush())
+		{
+			m_IsCompact = true;
+			return 0;
+		}
+		unsigned NumSectors = LastSector + LastLen;
+		if (m_File.GetSize() > static_cast<int>(NumSectors) * 4096)
+		{
+			if (!m_File.Truncate(static_cast<int>(NumSectors) * 4096))
+			{
+				LOGWARNING("Cannot shrink the MCA file \"%s\"", m_FileName.c_str());
+			}
+		}
+		m_UsedSectors.resize(NumSectors);
+
+		// Writing the header may have released sectors in front of the last chunk, then the next step can move it:
+		m_IsCompact = !WasHeaderDirty;
+		return 0;
+	}
+
+	// Write the chunk into the gap; the header in the file points to the old sectors until Flush():
+	if (
+		(m_File.Seek(static_cast<int>(NewSector) * 4096) < 0) ||
+		(m_File.Write(Data.data(), Data.size()) != static_cast<int>(Data.size()))
+	)
+	{
+		LOGWARNING("Cannot move a chunk within the MCA file \"%s\"", m_FileName.c_str());
+		m_IsCompact = true;
+		return 0;
+	}
+	MarkSectors(NewSector, LastLen, true);
+	m_SectorsToFree.push_back(std::make_pair(LastSector, LastLen));
+	m_Header[LastIdx] = htonl((NewSector << 8) | LastLen);
+	m_IsHeaderDirty = true;
+	return Data.size();
+}
+
+
+
+
+
 bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
 {
 	bool writeOutNeeded = false;
@@ -3030,6 +3772,7 @@ bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
 			return false;
 		}
 	}
+	BuildSectorMap();
 	return true;
 }
 
@@ -3037,7 +3780,37 @@ bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
 
 
 
-bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, AString & a_Data)
+void cWSSAnvil::cMCAFile::PrefetchChunk(const cChunkCoords & a_Chunk)
+{
+	if (!OpenFile(true))
+	{
+		return;
+	}
+
+	int LocalX = a_Chunk.m_ChunkX % 32;
+	if (LocalX < 0)
+	{
+		LocalX = 32 + LocalX;
+	}
+	int LocalZ = a_Chunk.m_ChunkZ % 32;
+	if (LocalZ < 0)
+	{
+		LocalZ = 32 + LocalZ;
+	}
+	unsigned ChunkLocation = ntohl(m_Header[LocalX + 32 * LocalZ]);
+	unsigned ChunkOffset = ChunkLocation >> 8;
+	if (ChunkOffset < 2)
+	{
+		return;
+	}
+	m_File.Prefetch(static_cast<int>(ChunkOffset) * 4096, std::max<int>(ChunkLocation & 0xff, 1) * 4096);
+}
+
+
+
+
+
+bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, AString & a_Data, eCompressionCodec & a_Codec)
 {
 	if (!OpenFile(true))
 	{
@@ -3060,45 +3833,73 @@ bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, AString & a
 	{
 		return false;
 	}
-	
-	m_File.Seek((int)ChunkOffset * 4096);
-	
-	int ChunkSize = 0;
-	if (m_File.Read(&ChunkSize, 4) != 4)
+
+	// Read all the sectors that the header says the chunk occupies, in one go:
+	size_t NumBytes = std::max<size_t>(ChunkLocation & 0xff, 1) * 4096;
+	if (m_File.Seek((int)ChunkOffset * 4096) < 0)
 	{
 		LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
 		return false;
 	}
-	ChunkSize = ntohl((u_long)ChunkSize);
-	char CompressionType = 0;
-	if (m_File.Read(&CompressionType, 1) != 1)
+	// HACK: This depends on the internal knowledge that AString's data() function returns the internal buffer directly
+	a_Data.resize(NumBytes);
+	int NumRead = m_File.Read(const_cast<char *>(a_Data.data()), NumBytes);
+	if (NumRead < MCA_CHUNK_HEADER_LENGTH)
 	{
 		LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
 		return false;
 	}
-	if (CompressionType != 2)
+
+	// Parse the chunk header:
+	const Byte * Header = reinterpret_cast<const Byte *>(a_Data.data());
+	size_t ChunkSize = (static_cast<size_t>(Header[0]) << 24) | (static_cast<size_t>(Header[1]) << 16) | (static_cast<size_t>(Header[2]) << 8) | Header[3];
+	switch (Header[4])
+	{
+		case ccGZip:
+		case ccZlib:
+		case ccNone:
+		{
+			a_Codec = static_cast<eCompressionCodec>(Header[4]);
+			break;
+		}
+		default:
+		{
+			// Chunk is in an unknown compression
+			LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+			return false;
+		}
+	}
+	if ((ChunkSize == 0) || (ChunkSize > MCA_MAX_CHUNK_DATA_SIZE))
 	{
-		// Chunk is in an unknown compression
 		LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
 		return false;
 	}
 	ChunkSize--;
-	
-	// HACK: This depends on the internal knowledge that AString's data() function returns the internal buffer directly
-	a_Data.assign(ChunkSize, '\0');
-	if (m_File.Read((void *)a_Data.data(), ChunkSize) == ChunkSize)
+
+	// If the header's sector count was too low, read the rest of the data:
+	size_t DataEnd = ChunkSize + MCA_CHUNK_HEADER_LENGTH;
+	if (DataEnd > static_cast<size_t>(NumRead))
 	{
-		return true;
+		a_Data.resize(DataEnd);
+		size_t NumMissing = DataEnd - static_cast<size_t>(NumRead);
+		if (m_File.Read(const_cast<char *>(a_Data.data()) + NumRead, NumMissing) != static_cast<int>(NumMissing))
+		{
+			LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+			return false;
+		}
 	}
-	LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
-	return false;
+
+	// Strip the chunk header and the unused rest of the last sector:
+	a_Data.resize(DataEnd);
+	a_Data.erase(0, MCA_CHUNK_HEADER_LENGTH);
+	return true;
 }
 
 
 
 
 
-bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Data)
+bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Sectors)
 {
 	if (!OpenFile(false))
 	{
@@ -3117,68 +3918,39 @@ bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const AStri
 		LocalZ = 32 + LocalZ;
 	}
 	
-	unsigned ChunkSector = FindFreeLocation(LocalX, LocalZ, a_Data);
-
-	// Store the chunk data:
-	m_File.Seek(ChunkSector * 4096);
-	u_long ChunkSize = htonl((u_long)a_Data.size() + 1);
-	if (m_File.Write(&ChunkSize, 4) != 4)
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(1) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	char CompressionType = 2;
-	if (m_File.Write(&CompressionType, 1) != 1)
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(2) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	if (m_File.Write(a_Data.data(), a_Data.size()) != (int)(a_Data.size()))
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(3) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	
-	// Add padding to 4K boundary:
-	size_t BytesWritten = a_Data.size() + MCA_CHUNK_HEADER_LENGTH;
-	if (BytesWritten % 4096 != 0)
-	{
-		static const char Padding[4095] = {0};
-		m_File.Write(Padding, 4096 - (BytesWritten % 4096));
-	}
-	
-	// Store the header:
-	ChunkSize = ((u_long)a_Data.size() + MCA_CHUNK_HEADER_LENGTH + 4095) / 4096;  // Round data size up to nearest 4KB sector, make it a sector number
-	if (ChunkSize > 255)
+	// The data is already padded to whole 4 KiB sectors:
+	ASSERT((a_Sectors.size() % 4096) == 0);
+	size_t NumSectors = a_Sectors.size() / 4096;
+	if (NumSectors > 255)
 	{
 		LOGWARNING("Cannot save chunk [%d, %d], the data is too large (%u KiB, maximum is 1024 KiB). Remove some entities and retry.",
-			a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, (unsigned)(ChunkSize * 4)
+			a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, (unsigned)(NumSectors * 4)
 		);
 		return false;
 	}
-	
-	// Store the header info in the table
-	m_Header[LocalX + 32 * LocalZ] = htonl((ChunkSector << 8) | ChunkSize);
 
-	// Set the modification time
-	m_TimeStamps[LocalX + 32 * LocalZ] =  htonl(static_cast<u_long>(time(nullptr)));
+	unsigned ChunkSector = AllocateSectors(LocalX, LocalZ, static_cast<unsigned>(NumSectors));
 
-	if (m_File.Seek(0) < 0)
+	// Store the chunk data, in a single call:
+	if (m_File.Seek(ChunkSector * 4096) < 0)
 	{
 		LOGWARNING("Cannot save chunk [%d, %d], seeking in file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
 		return false;
 	}
-	if (m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header))
+	if (m_File.Write(a_Sectors.data(), a_Sectors.size()) != (int)(a_Sectors.size()))
 	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing header to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	if (m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing timestamps to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
+		LOGWARNING("Cannot save chunk [%d, %d], writing data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
 		return false;
 	}
 	
+	// Store the header info in the table, it gets written into the file in Flush():
+	m_Header[LocalX + 32 * LocalZ] = htonl((ChunkSector << 8) | static_cast<unsigned>(NumSectors));
+
+	// Set the modification time
+	m_TimeStamps[LocalX + 32 * LocalZ] =  htonl(static_cast<u_long>(time(nullptr)));
+	m_IsHeaderDirty = true;
+	m_IsCompact = false;
+	
 	return true;
 }
 
@@ -3186,28 +3958,93 @@ bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const AStri
 
 
 
-unsigned cWSSAnvil::cMCAFile::FindFreeLocation(int a_LocalX, int a_LocalZ, const AString & a_Data)
+unsigned cWSSAnvil::cMCAFile::AllocateSectors(int a_LocalX, int a_LocalZ, unsigned a_NumSectors)
 {
 	// See if it fits the current location:
 	unsigned ChunkLocation = ntohl(m_Header[a_LocalX + 32 * a_LocalZ]);
-	unsigned ChunkLen = ChunkLocation & 0xff;
-	if (a_Data.size() + MCA_CHUNK_HEADER_LENGTH <= (ChunkLen * 4096))
+	unsigned CurrentSector = ChunkLocation >> 8;
+	unsigned CurrentLen = ChunkLocation & 0xff;
+	if (CurrentSector >= 2)
 	{
-		return ChunkLocation >> 8;
+		if (a_NumSectors <= CurrentLen)
+		{
+			// Rewrite in place, release the sectors no longer needed:
+			if (a_NumSectors < CurrentLen)
+			{
+				m_SectorsToFree.push_back(std::make_pair(CurrentSector + a_NumSectors, CurrentLen - a_NumSectors));
+			}
+			return CurrentSector;
+		}
+		m_SectorsToFree.push_back(std::make_pair(CurrentSector, CurrentLen));
 	}
-	
-	// Doesn't fit, append to the end of file (we're wasting a lot of space, TODO: fix this later)
-	unsigned MaxLocation = 2 << 8;  // Minimum sector is #2 - after the headers
+
+	// Find the smallest free range that fits (best fit), the free range at the end of the file fits everything:
+	unsigned NumUsedSectors = static_cast<unsigned>(m_UsedSectors.size());
+	unsigned BestSector = NumUsedSectors;
+	unsigned BestLen = UINT_MAX;
+	unsigned Sector = 2;  // Minimum sector is #2 - after the headers
+	while (Sector < NumUsedSectors)
+	{
+		if (m_UsedSectors[Sector])
+		{
+			Sector += 1;
+			continue;
+		}
+		unsigned RangeStart = Sector;
+		while ((Sector < NumUsedSectors) && !m_UsedSectors[Sector])
+		{
+			Sector += 1;
+		}
+		unsigned RangeLen = (Sector < NumUsedSectors) ? (Sector - RangeStart) : (UINT_MAX - 1);
+		if ((RangeLen >= a_NumSectors) && (RangeLen < BestLen))
+		{
+			BestSector = RangeStart;
+			BestLen = RangeLen;
+			if (RangeLen == a_NumSectors)
+			{
+				// Exact fit, cannot get any better
+				break;
+			}
+		}
+	}
+
+	MarkSectors(BestSector, a_NumSectors, true);
+	return BestSector;
+}
+
+
+
+
+
+void cWSSAnvil::cMCAFile::BuildSectorMap(void)
+{
+	m_UsedSectors.assign(2, true);  // The headers
+	m_SectorsToFree.clear();
 	for (size_t i = 0; i < ARRAYCOUNT(m_Header); i++)
 	{
-		ChunkLocation = ntohl(m_Header[i]);
-		ChunkLocation = ChunkLocation + ((ChunkLocation & 0xff) << 8);  // Add the number of sectors used; don't care about the 4th byte
-		if (MaxLocation < ChunkLocation)
+		unsigned ChunkLocation = ntohl(m_Header[i]);
+		unsigned ChunkSector = ChunkLocation >> 8;
+		if (ChunkSector >= 2)
 		{
-			MaxLocation = ChunkLocation;
+			MarkSectors(ChunkSector, ChunkLocation & 0xff, true);
 		}
 	}  // for i - m_Header[]
-	return MaxLocation >> 8;
+}
+
+
+
+
+
+void cWSSAnvil::cMCAFile::MarkSectors(unsigned a_FirstSector, unsigned a_NumSectors, bool a_IsUsed)
+{
+	if (m_UsedSectors.size() < a_FirstSector + a_NumSectors)
+	{
+		m_UsedSectors.resize(a_FirstSector + a_NumSectors, false);
+	}
+	for (unsigned i = 0; i < a_NumSectors; i++)
+	{
+		m_UsedSectors[a_FirstSector + i] = a_IsUsed;
+	}
 }
 
 
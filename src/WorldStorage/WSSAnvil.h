@@ -10,7 +10,9 @@
 
 #include "WorldStorage.h"
 #include "FastNBT.h"
+#include "../StringCompression.h"
 #include "../Mobs/Monster.h"
+#include <unordered_map>
 
 
 
@@ -22,6 +24,7 @@ class cItemGrid;
 class cProjectileEntity;
 class cHangingEntity;
 class cWolf;
+class cChunkData;
 
 
 
@@ -37,6 +40,9 @@ enum
 	
 	/// There are 5 bytes of header in front of each chunk
 	MCA_CHUNK_HEADER_LENGTH = 5,
+
+	/// A chunk can take up at most 255 sectors of 4 KiB, including its header
+	MCA_MAX_CHUNK_DATA_SIZE = 255 * 4096,
 } ;
 
 
@@ -50,20 +56,44 @@ class cWSSAnvil :
 	
 public:
 
-	cWSSAnvil(cWorld * a_World, int a_CompressionFactor);
+	/** Creates the schema; a_MaxOpenFiles is the number of region files kept open (with their headers cached) at once,
+	a_ChunkDataCacheSize is the number of bytes of the recently loaded and saved chunks' data kept in memory (0 to disable),
+	a_SectionCacheSize is the number of bytes of the saved chunks' compressed sections kept for reuse in the next saves (0 to disable). */
+	cWSSAnvil(cWorld * a_World, eCompressionCodec a_Compression, int a_CompressionFactor, size_t a_MaxOpenFiles, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize);
 	virtual ~cWSSAnvil();
 	
 protected:
 
+	/** Creates the schema with its region files stored in the specified world subfolder, using the specified file extension.
+	Used by descendants that store their own chunk format in the same region file container. */
+	cWSSAnvil(cWorld * a_World, eCompressionCodec a_Compression, int a_CompressionFactor, size_t a_MaxOpenFiles, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize, const AString & a_RegionFolder, const AString & a_RegionFileExt);
+
 	class cMCAFile
 	{
 	public:
 	
 		cMCAFile(const AString & a_FileName, int a_RegionX, int a_RegionZ);
+
+		/** Writes the header, if changed, before closing the file. */
+		~cMCAFile();
 		
-		bool GetChunkData  (const cChunkCoords & a_Chunk, AString & a_Data);
-		bool SetChunkData  (const cChunkCoords & a_Chunk, const AString & a_Data);
+		/** Reads the chunk's data, still compressed, into a_Data and its compression codec into a_Codec. */
+		bool GetChunkData  (const cChunkCoords & a_Chunk, AString & a_Data, eCompressionCodec & a_Codec);
+		/** Stores the chunk's sectors, as prepared by cWSSAnvil::CompressChunkData(), into the file. */
+		bool SetChunkData  (const cChunkCoords & a_Chunk, const AString & a_Sectors);
 		bool EraseChunkData(const cChunkCoords & a_Chunk);
+
+		/** Asks the OS to start reading the chunk's sectors into its cache, if the chunk is in the file. */
+		void PrefetchChunk(const cChunkCoords & a_Chunk);
+
+		/** Writes the header into the file if it has changed since the last write. Returns true on success. */
+		bool Flush(void);
+
+		/** Moves the chunk stored last in the file into the first free gap before it that is large enough.
+		When there's no such gap, writes the header and cuts off the free sectors at the end of the file.
+		The moved chunk's old sectors are released only once the new header has been written, so the file stays
+		consistent at all times. Returns the number of bytes moved, 0 if the file is compact. */
+		size_t CompactStep(void);
 		
 		int             GetRegionX (void) const {return m_RegionX; }
 		int             GetRegionZ (void) const {return m_RegionZ; }
@@ -82,9 +112,34 @@ protected:
 		
 		// Chunk timestamps, following the chunk headers
 		unsigned m_TimeStamps[MCA_MAX_CHUNKS];
+
+		/** Set when m_Header or m_TimeStamps have been modified but not written to the file yet.
+		The header is written in Flush() instead of after each chunk, so that saving many chunks doesn't
+		rewrite the same 8 KiB over and over. Until it is written, the file still points to the old chunk data. */
+		bool m_IsHeaderDirty;
+
+		/** The usage map of the file's sectors, true for each sector used by the headers or a chunk.
+		Built from the header when the file is opened, updated as chunks are stored. */
+		std::vector<bool> m_UsedSectors;
+
+		/** Sector ranges (first sector, count) released since the last header write.
+		The header in the file still points to them, so they're not reused until Flush() has written the new header. */
+		std::vector<std::pair<unsigned, unsigned>> m_SectorsToFree;
+
+		/** Set when CompactStep() has found nothing to move; reset whenever the sectors' layout changes. */
+		bool m_IsCompact;
 		
-		/// Finds a free location large enough to hold a_Data. Gets a hint of the chunk coords, places the data there if it fits. Returns the sector number.
-		unsigned FindFreeLocation(int a_LocalX, int a_LocalZ, const AString & a_Data);
+		/** Allocates a_NumSectors sectors for the specified chunk and returns the first sector number.
+		Rewrites the chunk in place if it fits its current location, otherwise releases the current location
+		and picks the smallest free range that is large enough, appending to the file only if there is none.
+		Marks the returned sectors as used. */
+		unsigned AllocateSectors(int a_LocalX, int a_LocalZ, unsigned a_NumSectors);
+
+		/** Fills m_UsedSectors from m_Header. */
+		void BuildSectorMap(void);
+
+		/** Marks the specified sectors as used or free in m_UsedSectors, growing it as needed. */
+		void MarkSectors(unsigned a_FirstSector, unsigned a_NumSectors, bool a_IsUsed);
 		
 		/// Opens a MCA file either for a Read operation (fails if doesn't exist) or for a Write operation (creates new if not found)
 		bool OpenFile(bool a_IsForReading);
@@ -92,27 +147,149 @@ protected:
 	typedef std::list<cMCAFile *> cMCAFiles;
 	
 	cCriticalSection m_CS;
-	cMCAFiles        m_Files;  // a MRU cache of MCA files
+
+	/** The open MCA files, most recently used first. Protected by m_CS. */
+	cMCAFiles m_Files;
+
+	/** Index into m_Files by the region coords, so that the lookup doesn't need to walk the list. Protected by m_CS. */
+	std::unordered_map<cChunkCoords, cMCAFiles::iterator, cChunkCoordsHash> m_FileIndex;
+
+	/** The maximum number of files in m_Files; the least recently used ones are closed above it. */
+	size_t m_MaxOpenFiles;
+
+	/** Statistics of the m_Files cache, logged when the schema is destroyed. Protected by m_CS. */
+	UInt64 m_NumFileCacheHits;
+	UInt64 m_NumFileCacheMisses;
+	UInt64 m_NumFileCacheEvictions;
+
+	/** A chunk's stored data, as returned by cMCAFile::GetChunkData(), kept in m_ChunkDataCache. */
+	struct sCachedChunkData
+	{
+		cChunkCoords m_Chunk;
+		eCompressionCodec m_Codec;
+		AString m_Data;
+	} ;
+	typedef std::list<sCachedChunkData> cCachedChunkDataList;
+
+	/** The data of the most recently loaded and saved chunks, most recently used first. A chunk that is unloaded and loaded
+	again shortly after, such as when a player moves back and forth across the edge of their view distance, is then
+	loaded without reading its region file. Protected by m_CS. */
+	cCachedChunkDataList m_ChunkDataCache;
+
+	/** Index into m_ChunkDataCache by the chunk coords. Protected by m_CS. */
+	std::unordered_map<cChunkCoords, cCachedChunkDataList::iterator, cChunkCoordsHash> m_ChunkDataCacheIndex;
+
+	/** The total size of the data in m_ChunkDataCache, and the limit above which the least recently used chunks are dropped. */
+	size_t m_ChunkDataCacheSize;
+	size_t m_MaxChunkDataCacheSize;
+
+	/** Statistics of m_ChunkDataCache, logged when the schema is destroyed. Protected by m_CS. */
+	UInt64 m_NumChunkDataCacheHits;
+	UInt64 m_NumChunkDataCacheMisses;
 	
+	/** A chunk section's NBT, compressed on its own into a raw deflate segment that can be spliced into the compressed data
+	of the chunk's later saves, for as long as the section doesn't change. See CompressChunkData(). */
+	struct sCompressedSection
+	{
+		UInt32 m_Revision;     ///< The section revision (cChunkData::GetSectionRevision()) that the data was made from
+		bool m_IsLightValid;   ///< The NBT has zero light when the chunk's light isn't valid, so the data depends on it as well
+		AString m_Data;        ///< The raw deflate segment, flushed to a byte boundary
+		UInt32 m_Adler32;      ///< The Adler-32 checksum of the uncompressed NBT
+		size_t m_NBTSize;      ///< The size of the uncompressed NBT
+	} ;
+	typedef std::shared_ptr<sCompressedSection> cCompressedSectionPtr;
+
+	/** A section in a chunk's NBT, as recorded by SaveChunkToNBT() for CompressChunkData(). */
+	struct sNBTSection
+	{
+		int m_SectionY;
+		UInt32 m_Revision;
+		bool m_IsLightValid;
+
+		/** The position and size of the section's NBT in the writer's result.
+		The size is 0 if m_Compressed is a cached section to be spliced in at m_Pos, instead. */
+		size_t m_Pos;
+		size_t m_Size;
+
+		/** The compressed section: the cached one being reused, or the new one, as filled in by CompressChunkData(). */
+		cCompressedSectionPtr m_Compressed;
+	} ;
+	typedef std::vector<sNBTSection> cNBTSections;
+
+	/** The compressed sections of a single chunk, as last saved. */
+	struct sCachedSections
+	{
+		cChunkCoords m_Chunk;
+		cNBTSections m_Sections;
+		size_t m_Size;  ///< Total size of the compressed data of m_Sections
+	} ;
+	typedef std::list<sCachedSections> cCachedSectionsList;
+
+	/** The compressed sections of the recently saved chunks, most recently used first. A chunk that's saved again, after only
+	some of its sections have changed, only compresses the changed ones anew. Only used by the storage thread. */
+	cCachedSectionsList m_SectionCache;
+
+	/** Index into m_SectionCache by the chunk coords. Only used by the storage thread. */
+	std::unordered_map<cChunkCoords, cCachedSectionsList::iterator, cChunkCoordsHash> m_SectionCacheIndex;
+
+	/** The total size of the data in m_SectionCache, and the limit above which the least recently used chunks are dropped. */
+	size_t m_SectionCacheSize;
+	size_t m_MaxSectionCacheSize;
+
+	/** The codec used for compressing the saved chunks, and its compression level. Chunks are loaded using whichever codec they were saved with. */
+	eCompressionCodec m_Compression;
 	int m_CompressionFactor;
 
+	/** The world subfolder holding the region files, and the region files' extension */
+	AString m_RegionFolder;
+	AString m_RegionFileExt;
+
+	/** Total number of bytes of chunk data written into the MCA files, see GetNumBytesSaved(). Protected by m_CS. */
+	UInt64 m_NumBytesSaved;
+
+	/** The NBT tag storage reused by LoadChunks(), one per chunk in a batch, so that the bulk loading doesn't reallocate it for each chunk.
+	Only used by the storage thread (and the workers it waits for). */
+	std::vector<cFastNBTTags> m_LoadTagStorage;
+
 	/// Gets chunk data from the correct file; locks file CS as needed
-	bool GetChunkData(const cChunkCoords & a_Chunk, AString & a_Data);
+	bool GetChunkData(const cChunkCoords & a_Chunk, AString & a_Data, eCompressionCodec & a_Codec);
 
-	/// Sets chunk data into the correct file; locks file CS as needed
-	bool SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Data);
+	/// Sets chunk sectors (as prepared by CompressChunkData()) into the correct file; locks file CS as needed
+	bool SetChunkData(const cChunkCoords & a_Chunk, const AString & a_Sectors);
+
+	/** Stores the chunk's data into m_ChunkDataCache, replacing the previous one, and drops the least recently used chunks
+	over the size limit. Assumes m_CS is locked. */
+	void CacheChunkData(const cChunkCoords & a_Chunk, eCompressionCodec a_Codec, const AString & a_Data);
 
 	/// Loads the chunk from the data (no locking needed)
-	bool LoadChunkFromData(const cChunkCoords & a_Chunk, const AString & a_Data);
+	bool LoadChunkFromData(const cChunkCoords & a_Chunk, const AString & a_Data, eCompressionCodec a_Codec);
 	
-	/// Saves the chunk into datastream (no locking needed)
-	bool SaveChunkToData(const cChunkCoords & a_Chunk, AString & a_Data);
+	/// Saves the chunk into sectors ready for storing in the MCA file (no locking needed)
+	bool SaveChunkToData(const cChunkCoords & a_Chunk, AString & a_Sectors);
+
+	/** Compresses the chunk data using m_Compression into a_Sectors, behind the MCA chunk header and padded to whole 4 KiB sectors,
+	so that the result can be written into the MCA file as-is. Returns true on success.
+	If a_Sections is given (and not empty), the sections are compressed as separate segments of the zlib stream: the cached ones
+	are spliced in as they are and the new ones are compressed and stored in their m_Compressed, for CacheSections(). */
+	bool CompressChunkData(const AString & a_Data, AString & a_Sectors, cNBTSections * a_Sections = nullptr);
+
+	/** Compresses a_Data as a zlib stream made of separately compressed segments, see CompressChunkData(). */
+	bool CompressChunkDataBySections(const AString & a_Data, AString & a_Compressed, cNBTSections & a_Sections);
+
+	/** Returns the cached compressed sections of the chunk, or nullptr if there are none. Marks them as recently used. */
+	const cNBTSections * FindCachedSections(const cChunkCoords & a_Chunk);
+
+	/** Stores the chunk's compressed sections, as filled in by CompressChunkData(), into m_SectionCache, replacing the ones
+	previously cached for the chunk, and drops the least recently used chunks over the size limit. */
+	void CacheSections(const cChunkCoords & a_Chunk, const cNBTSections & a_Sections);
 	
 	/// Loads the chunk from NBT data (no locking needed)
 	bool LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT & a_NBT);
 	
-	/// Saves the chunk into NBT data using a_Writer; returns true on success
-	bool SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_Writer);
+	/** Saves the chunk into NBT data using a_Writer; returns true on success.
+	If a_Sections is given and the section cache is enabled, the positions of the sections in the NBT are recorded into it and
+	the unchanged sections aren't written at all, their cached compressed data is to be spliced in by CompressChunkData(). */
+	bool SaveChunkToNBT(const cChunkCoords & a_Chunk, cFastNBTWriter & a_Writer, cNBTSections * a_Sections = nullptr);
 	
 	/// Loads the chunk's biome map from vanilla-format; returns a_BiomeMap if biomes present and valid, nullptr otherwise
 	cChunkDef::BiomeMap * LoadVanillaBiomeMapFromNBT(cChunkDef::BiomeMap * a_BiomeMap, const cParsedNBT & a_NBT, int a_TagIdx);
@@ -124,7 +301,7 @@ protected:
 	void LoadEntitiesFromNBT(cEntityList & a_Entitites, const cParsedNBT & a_NBT, int a_Tag);
 	
 	/// Loads the chunk's BlockEntities from NBT data (a_Tag is the Level\\TileEntities list tag; may be -1)
-	void LoadBlockEntitiesFromNBT(cBlockEntityList & a_BlockEntitites, const cParsedNBT & a_NBT, int a_Tag, BLOCKTYPE * a_BlockTypes, NIBBLETYPE * a_BlockMetas);
+	void LoadBlockEntitiesFromNBT(cBlockEntityList & a_BlockEntitites, const cParsedNBT & a_NBT, int a_Tag, const cChunkData & a_ChunkData);
 	
 	/** Loads the data for a block entity from the specified NBT tag.
 	Returns the loaded block entity, or nullptr upon failure. */
@@ -238,13 +415,19 @@ protected:
 	/// Gets the correct MCA file either from cache or from disk, manages the m_MCAFiles cache; assumes m_CS is locked
 	cMCAFile * LoadMCAFile(const cChunkCoords & a_Chunk);
 	
-	/// Copies a_Length bytes of data from the specified NBT Tag's Child into the a_Destination buffer
-	void CopyNBTData(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, char * a_Destination, size_t a_Length);
+	/// Returns the data of the specified NBT Tag's byte array Child, or nullptr if it isn't present or isn't exactly a_Length bytes long
+	static const char * GetNBTByteArray(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, size_t a_Length);
 		
 	// cWSSchema overrides:
 	virtual bool LoadChunk(const cChunkCoords & a_Chunk) override;
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) override;
 	virtual const AString GetName(void) const override {return "anvil"; }
+	virtual void LoadChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results) override;
+	virtual void SaveChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results) override;
+	virtual void Flush(void) override;
+	virtual UInt64 GetNumBytesSaved(void) override;
+	virtual void PrefetchChunks(const cChunkCoordsVector & a_Chunks) override;
+	virtual size_t CompactStep(void) override;
 } ;
 
 
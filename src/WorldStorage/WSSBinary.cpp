@@ -0,0 +1,486 @@
+
+// WSSBinary.cpp
+
+// Implements the cWSSBinary class representing the MCServer-specific binary world storage schema
+
+/*
+Chunk payload layout (before compression), all multi-byte numbers are big-endian:
+	4 bytes: "MCSB" magic
+	1 byte:  layout version (BINARY_CHUNK_VERSION)
+	1 byte:  flags (BINARY_FLAG_*)
+	2 bytes: section mask, bit Y is set if section Y (blocks Y * 16 .. Y * 16 + 15) is stored
+	4 bytes: size of the entities NBT
+	256 bytes: biomes (EMCSBiome), only if BINARY_FLAG_BIOMES_VALID is set
+	For each stored section, in ascending Y order:
+		4096 bytes: block types
+		2048 bytes: block metas
+		2048 bytes: block light, only if BINARY_FLAG_LIGHT_VALID is set
+		2048 bytes: sky light, only if BINARY_FLAG_LIGHT_VALID is set
+	The entities NBT: a compound with the "Entities" and "TileEntities" lists, as written by cNBTChunkSerializer
+Sections that are not stored are all air with no metas, zero block light and full sky light.
+*/
+
+#include "Globals.h"
+#include "WSSBinary.h"
+#include "NBTChunkSerializer.h"
+#include "FastNBT.h"
+#include "zlib/zlib.h"
+#include "../World.h"
+#include "../StringCompression.h"
+#include "../SetChunkData.h"
+#include "../Root.h"
+
+
+
+
+
+enum
+{
+	BINARY_CHUNK_VERSION     = 1,
+	BINARY_CHUNK_HEADER_SIZE = 12,
+
+	BINARY_FLAG_LIGHT_VALID  = 0x01,
+	BINARY_FLAG_BIOMES_VALID = 0x02,
+
+	BINARY_NUM_SECTIONS = cChunkDef::Height / 16,
+	BINARY_SECTION_BLOCKS = 16 * cChunkDef::Width * cChunkDef::Width,
+} ;
+
+/** The magic bytes that each chunk payload starts with */
+static const char BINARY_CHUNK_MAGIC[] = "MCSB";
+
+
+/** Same as in cWSSAnvil: a chunk that fails to load would get regenerated and overwrite the stored data, so the server aborts instead. */
+#define LOAD_FAILED(CHX, CHZ) \
+	{ \
+		const int RegionX = FAST_FLOOR_DIV(CHX, 32); \
+		const int RegionZ = FAST_FLOOR_DIV(CHZ, 32); \
+		LOGERROR("%s (%d): Loading chunk [%d, %d] from file r.%d.%d.mcb failed. " \
+			"The server will now abort in order to avoid further data loss. " \
+			"Please add the reported file and this message to the issue report.", \
+			__FUNCTION__, __LINE__, CHX, CHZ, RegionX, RegionZ \
+		); \
+		*((volatile int *)0) = 0;  /* Crash intentionally */ \
+	}
+
+
+
+
+
+/** Returns true if all a_Size bytes at a_Data have the value a_Value */
+static bool AreAllBytes(const unsigned char * a_Data, size_t a_Size, unsigned char a_Value)
+{
+	for (size_t i = 0; i < a_Size; i++)
+	{
+		if (a_Data[i] != a_Value)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cWSSBinary:
+
+cWSSBinary::cWSSBinary(cWorld * a_World, eCompressionCodec a_Compression, int a_CompressionFactor, size_t a_MaxOpenFiles, size_t a_ChunkDataCacheSize) :
+	super(a_World, a_Compression, std::min(a_CompressionFactor, 1), a_MaxOpenFiles, a_ChunkDataCacheSize, 0, "binregion", "mcb")
+{
+}
+
+
+
+
+
+bool cWSSBinary::HasRegionFolder(void) const
+{
+	AString Folder;
+	Printf(Folder, "%s%c%s", m_World->GetName().c_str(), cFile::PathSeparator, m_RegionFolder.c_str());
+	return cFile::IsFolder(FILE_IO_PREFIX + Folder);
+}
+
+
+
+
+
+bool cWSSBinary::ParsePayloadLayout(const AString & a_Payload, sPayloadLayout & a_Layout)
+{
+	if (
+		(a_Payload.size() < BINARY_CHUNK_HEADER_SIZE) ||
+		(memcmp(a_Payload.data(), BINARY_CHUNK_MAGIC, 4) != 0) ||
+		(static_cast<Byte>(a_Payload[4]) != BINARY_CHUNK_VERSION)
+	)
+	{
+		return false;
+	}
+	Byte Flags = static_cast<Byte>(a_Payload[5]);
+	a_Layout.m_IsLightValid = ((Flags & BINARY_FLAG_LIGHT_VALID) != 0);
+	a_Layout.m_AreBiomesValid = ((Flags & BINARY_FLAG_BIOMES_VALID) != 0);
+	a_Layout.m_SectionMask = static_cast<UInt16>((static_cast<Byte>(a_Payload[6]) << 8) | static_cast<Byte>(a_Payload[7]));
+	int EntitiesSize = GetBEInt(a_Payload.data() + 8);
+	if (EntitiesSize < 0)
+	{
+		return false;
+	}
+
+	size_t NumSections = 0;
+	for (int y = 0; y < BINARY_NUM_SECTIONS; y++)
+	{
+		if ((a_Layout.m_SectionMask & (1 << y)) != 0)
+		{
+			NumSections++;
+		}
+	}
+	a_Layout.m_SectionSize = BINARY_SECTION_BLOCKS + BINARY_SECTION_BLOCKS / 2;
+	if (a_Layout.m_IsLightValid)
+	{
+		a_Layout.m_SectionSize += BINARY_SECTION_BLOCKS;
+	}
+	a_Layout.m_BiomesOffset = BINARY_CHUNK_HEADER_SIZE;
+	a_Layout.m_SectionsOffset = a_Layout.m_BiomesOffset + (a_Layout.m_AreBiomesValid ? sizeof(cChunkDef::BiomeMap) / sizeof(EMCSBiome) : 0);
+	a_Layout.m_EntitiesOffset = a_Layout.m_SectionsOffset + NumSections * a_Layout.m_SectionSize;
+	a_Layout.m_EntitiesSize = static_cast<size_t>(EntitiesSize);
+	return (a_Layout.m_EntitiesOffset + a_Layout.m_EntitiesSize == a_Payload.size());
+}
+
+
+
+
+
+bool cWSSBinary::SaveChunkToPayload(const cChunkCoords & a_Chunk, AString & a_Payload)
+{
+	// Get the chunk data; the serializer writes the entities and block entities as NBT and collects the blocks:
+	cFastNBTWriter Writer;
+	cNBTChunkSerializer Serializer(Writer);
+	if (!m_World->GetChunkData(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, Serializer))
+	{
+		LOGWARNING("Cannot get chunk [%d, %d] data for binary saving", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return false;
+	}
+	Serializer.Finish();
+	Writer.Finish();
+	const AString & Entities = Writer.GetResult();
+	bool IsLightValid = Serializer.IsLightValid();
+
+	// Store only the sections that differ from the default empty section:
+	UInt16 SectionMask = 0;
+	size_t NumSections = 0;
+	for (int y = 0; y < BINARY_NUM_SECTIONS; y++)
+	{
+		if (
+			!AreAllBytes(Serializer.m_BlockTypes + y * BINARY_SECTION_BLOCKS, BINARY_SECTION_BLOCKS, E_BLOCK_AIR) ||
+			!AreAllBytes(Serializer.m_BlockMetas + y * BINARY_SECTION_BLOCKS / 2, BINARY_SECTION_BLOCKS / 2, 0) ||
+			(
+				IsLightValid && (
+					!AreAllBytes(Serializer.m_BlockLight    + y * BINARY_SECTION_BLOCKS / 2, BINARY_SECTION_BLOCKS / 2, 0) ||
+					!AreAllBytes(Serializer.m_BlockSkyLight + y * BINARY_SECTION_BLOCKS / 2, BINARY_SECTION_BLOCKS / 2, 0xff)
+				)
+			)
+		)
+		{
+			SectionMask |= static_cast<UInt16>(1 << y);
+			NumSections++;
+		}
+	}
+
+	// Write the header:
+	size_t SectionSize = BINARY_SECTION_BLOCKS + BINARY_SECTION_BLOCKS / 2 + (IsLightValid ? BINARY_SECTION_BLOCKS : 0);
+	a_Payload.clear();
+	a_Payload.reserve(BINARY_CHUNK_HEADER_SIZE + ARRAYCOUNT(Serializer.m_Biomes) + NumSections * SectionSize + Entities.size());
+	char Header[BINARY_CHUNK_HEADER_SIZE];
+	memcpy(Header, BINARY_CHUNK_MAGIC, 4);
+	Header[4] = BINARY_CHUNK_VERSION;
+	Header[5] = static_cast<char>((IsLightValid ? BINARY_FLAG_LIGHT_VALID : 0) | (Serializer.m_BiomesAreValid ? BINARY_FLAG_BIOMES_VALID : 0));
+	Header[6] = static_cast<char>(SectionMask >> 8);
+	Header[7] = static_cast<char>(SectionMask & 0xff);
+	SetBEInt(Header + 8, static_cast<Int32>(Entities.size()));
+	a_Payload.append(Header, sizeof(Header));
+
+	// Write the biomes, all of them fit into a byte:
+	if (Serializer.m_BiomesAreValid)
+	{
+		for (size_t i = 0; i < ARRAYCOUNT(Serializer.m_Biomes); i++)
+		{
+			a_Payload.push_back(static_cast<char>(Serializer.m_Biomes[i]));
+		}
+	}
+
+	// Write the sections:
+	for (int y = 0; y < BINARY_NUM_SECTIONS; y++)
+	{
+		if ((SectionMask & (1 << y)) == 0)
+		{
+			continue;
+		}
+		a_Payload.append(reinterpret_cast<const char *>(Serializer.m_BlockTypes) + y * BINARY_SECTION_BLOCKS,     BINARY_SECTION_BLOCKS);
+		a_Payload.append(reinterpret_cast<const char *>(Serializer.m_BlockMetas) + y * BINARY_SECTION_BLOCKS / 2, BINARY_SECTION_BLOCKS / 2);
+		if (IsLightValid)
+		{
+			a_Payload.append(reinterpret_cast<const char *>(Serializer.m_BlockLight)    + y * BINARY_SECTION_BLOCKS / 2, BINARY_SECTION_BLOCKS / 2);
+			a_Payload.append(reinterpret_cast<const char *>(Serializer.m_BlockSkyLight) + y * BINARY_SECTION_BLOCKS / 2, BINARY_SECTION_BLOCKS / 2);
+		}
+	}
+
+	a_Payload.append(Entities);
+	return true;
+}
+
+
+
+
+
+bool cWSSBinary::LoadChunkFromPayload(const cChunkCoords & a_Chunk, const AString & a_Payload, const sPayloadLayout & a_Layout, const cParsedNBT & a_Entities)
+{
+	// The sections are set directly from the payload into the chunk's storage, which is then moved into the chunk.
+	// The sections not present in the payload are air, with full skylight:
+	cChunkData ChunkData(m_World->GetChunkMap()->GetSectionPool());
+	const char * Src = a_Payload.data() + a_Layout.m_SectionsOffset;
+	for (int y = 0; y < BINARY_NUM_SECTIONS; y++)
+	{
+		if ((a_Layout.m_SectionMask & (1 << y)) == 0)
+		{
+			continue;
+		}
+		const BLOCKTYPE * Types = reinterpret_cast<const BLOCKTYPE *>(Src);
+		Src += BINARY_SECTION_BLOCKS;
+		const NIBBLETYPE * Metas = reinterpret_cast<const NIBBLETYPE *>(Src);
+		Src += BINARY_SECTION_BLOCKS / 2;
+		const NIBBLETYPE * Light = nullptr;
+		const NIBBLETYPE * Sky = nullptr;
+		if (a_Layout.m_IsLightValid)
+		{
+			Light = reinterpret_cast<const NIBBLETYPE *>(Src);
+			Src += BINARY_SECTION_BLOCKS / 2;
+			Sky = reinterpret_cast<const NIBBLETYPE *>(Src);
+			Src += BINARY_SECTION_BLOCKS / 2;
+		}
+		ChunkData.SetSection(static_cast<size_t>(y), Types, Metas, Light, Sky);
+	}
+
+	cChunkDef::BiomeMap BiomeMap;
+	cChunkDef::BiomeMap * Biomes = nullptr;
+	if (a_Layout.m_AreBiomesValid)
+	{
+		const Byte * BiomeData = reinterpret_cast<const Byte *>(a_Payload.data() + a_Layout.m_BiomesOffset);
+		for (size_t i = 0; i < ARRAYCOUNT(BiomeMap); i++)
+		{
+			BiomeMap[i] = static_cast<EMCSBiome>(BiomeData[i]);
+		}
+		Biomes = &BiomeMap;
+	}
+
+	cEntityList      Entities;
+	cBlockEntityList BlockEntities;
+	LoadEntitiesFromNBT     (Entities,      a_Entities, a_Entities.FindChildByName(0, "Entities"));
+	LoadBlockEntitiesFromNBT(BlockEntities, a_Entities, a_Entities.FindChildByName(0, "TileEntities"), ChunkData);
+
+	cSetChunkDataPtr SetChunkData(new cSetChunkData(
+		a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ,
+		std::move(ChunkData), a_Layout.m_IsLightValid,
+		nullptr, Biomes,
+		std::move(Entities), std::move(BlockEntities),
+		false
+	));
+	m_World->QueueSetChunkData(SetChunkData);
+	return true;
+}
+
+
+
+
+
+bool cWSSBinary::LoadChunk(const cChunkCoords & a_Chunk)
+{
+	AString Data;
+	eCompressionCodec Codec;
+	if (!HasRegionFolder() || !GetChunkData(a_Chunk, Data, Codec))
+	{
+		// The reason for failure is already printed in GetChunkData()
+		return false;
+	}
+
+	AString Payload;
+	int res = UncompressStringWithCodec(Codec, Data.data(), Data.size(), Payload);
+	if (res != Z_OK)
+	{
+		LOGWARNING("Uncompressing chunk [%d, %d] failed: %d", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, res);
+		LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return false;
+	}
+	sPayloadLayout Layout;
+	if (!ParsePayloadLayout(Payload, Layout))
+	{
+		LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return false;
+	}
+	cParsedNBT NBT(Payload.data() + Layout.m_EntitiesOffset, Layout.m_EntitiesSize);
+	if (!NBT.IsValid())
+	{
+		LOAD_FAILED(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return false;
+	}
+	return LoadChunkFromPayload(a_Chunk, Payload, Layout, NBT);
+}
+
+
+
+
+
+bool cWSSBinary::SaveChunk(const cChunkCoords & a_Chunk)
+{
+	AString Payload, Sectors;
+	if (!SaveChunkToPayload(a_Chunk, Payload))
+	{
+		LOGWARNING("Cannot serialize chunk [%d, %d] into data", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return false;
+	}
+	if (!CompressChunkData(Payload, Sectors) || !SetChunkData(a_Chunk, Sectors))
+	{
+		LOGWARNING("Cannot store chunk [%d, %d] data", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+void cWSSBinary::LoadChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results)
+{
+	size_t NumChunks = a_Chunks.size();
+
+	// Read the raw data; the file access is serialized anyway, so it's done in this thread:
+	std::vector<AString> Data(NumChunks);
+	std::vector<eCompressionCodec> Codecs(NumChunks, ccZlib);
+	a_Results.assign(NumChunks, false);
+	if (!HasRegionFolder())
+	{
+		return;
+	}
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		a_Results[i] = GetChunkData(a_Chunks[i], Data[i], Codecs[i]);
+	}
+
+	// Uncompress the payloads and parse their entity NBT in parallel:
+	std::vector<AString> Payloads(NumChunks);
+	std::vector<int> InflateResults(NumChunks, Z_OK);
+	std::vector<sPayloadLayout> Layouts(NumChunks);
+	std::vector<std::unique_ptr<cParsedNBT>> NBTs(NumChunks);
+	if (m_LoadTagStorage.size() < NumChunks)
+	{
+		m_LoadTagStorage.resize(NumChunks);
+	}
+	cRoot::Get()->GetThreadPool().ParallelFor(NumChunks, [&](size_t a_Idx)
+		{
+			if (!a_Results[a_Idx])
+			{
+				return;
+			}
+			InflateResults[a_Idx] = UncompressStringWithCodec(Codecs[a_Idx], Data[a_Idx].data(), Data[a_Idx].size(), Payloads[a_Idx]);
+			if ((InflateResults[a_Idx] == Z_OK) && ParsePayloadLayout(Payloads[a_Idx], Layouts[a_Idx]))
+			{
+				const sPayloadLayout & Layout = Layouts[a_Idx];
+				NBTs[a_Idx].reset(new cParsedNBT(Payloads[a_Idx].data() + Layout.m_EntitiesOffset, Layout.m_EntitiesSize, m_LoadTagStorage[a_Idx]));
+			}
+		},
+		cThreadPool::tpNormal
+	);
+
+	// Load the chunks, in the queue order; this creates the entities and hands the chunk to the world:
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		if (!a_Results[i])
+		{
+			// The reason for failure is already printed in GetChunkData()
+			continue;
+		}
+		if (InflateResults[i] != Z_OK)
+		{
+			LOGWARNING("Uncompressing chunk [%d, %d] failed: %d", a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ, InflateResults[i]);
+			LOAD_FAILED(a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			a_Results[i] = false;
+			continue;
+		}
+		if ((NBTs[i] == nullptr) || !NBTs[i]->IsValid())
+		{
+			// Bad payload header or entity NBT
+			LOAD_FAILED(a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			a_Results[i] = false;
+			continue;
+		}
+		a_Results[i] = LoadChunkFromPayload(a_Chunks[i], Payloads[i], Layouts[i], *NBTs[i]);
+	}
+}
+
+
+
+
+
+void cWSSBinary::SaveChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results)
+{
+	size_t NumChunks = a_Chunks.size();
+
+	// Serialize the chunks; this reads the chunks from the world, so it's done in this thread:
+	std::vector<AString> Payloads(NumChunks);
+	a_Results.resize(NumChunks);
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		a_Results[i] = SaveChunkToPayload(a_Chunks[i], Payloads[i]);
+		if (!a_Results[i])
+		{
+			LOGWARNING("Cannot serialize chunk [%d, %d] into data", a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+		}
+	}
+
+	// Compress the data in parallel, releasing each payload as soon as it's compressed:
+	std::vector<AString> Data(NumChunks);
+	std::vector<char> IsCompressed(NumChunks, 0);
+	cRoot::Get()->GetThreadPool().ParallelFor(NumChunks, [&](size_t a_Idx)
+		{
+			if (a_Results[a_Idx])
+			{
+				IsCompressed[a_Idx] = CompressChunkData(Payloads[a_Idx], Data[a_Idx]) ? 1 : 0;
+				AString().swap(Payloads[a_Idx]);
+			}
+		},
+		cThreadPool::tpLow
+	);
+
+	// Write the data into the files:
+	for (size_t i = 0; i < NumChunks; i++)
+	{
+		if (!a_Results[i])
+		{
+			continue;
+		}
+		if (!IsCompressed[i] || !SetChunkData(a_Chunks[i], Data[i]))
+		{
+			LOGWARNING("Cannot store chunk [%d, %d] data", a_Chunks[i].m_ChunkX, a_Chunks[i].m_ChunkZ);
+			a_Results[i] = false;
+		}
+	}
+}
+
+
+
+
+
+
+void cWSSBinary::PrefetchChunks(const cChunkCoordsVector & a_Chunks)
+{
+	// Don't create the folder in worlds that don't use this schema:
+	if (HasRegionFolder())
+	{
+		super::PrefetchChunks(a_Chunks);
+	}
+}
+
+
+
+
@@ -0,0 +1,76 @@
+
+// WSSBinary.h
+
+// Interfaces to the cWSSBinary class representing the MCServer-specific binary world storage schema
+
+
+
+
+
+#pragma once
+
+#include "WSSAnvil.h"
+
+
+
+
+
+/** Storage schema that keeps chunks in the Anvil region file container, but in a layout designed for server-side speed
+rather than for compatibility with vanilla and the mapping tools:
+	- a fixed header followed by the raw data of only the non-empty sections, instead of NBT with all 16 sections
+	- the biomes stored once, as bytes
+	- the entities and block entities stored as NBT, using the same serializer and loaders as Anvil
+	- compression level 1 at most, as the speed matters more than the size here
+The region files are stored in the world's "binregion" folder, as "r.X.Z.mcb".
+Chunks that are not in the binary files are loaded from the Anvil files by the world storage, so switching a world
+to this schema imports its chunks as they get loaded; they are then saved only in the binary files. */
+class cWSSBinary :
+	public cWSSAnvil
+{
+	typedef cWSSAnvil super;
+
+public:
+
+	cWSSBinary(cWorld * a_World, eCompressionCodec a_Compression, int a_CompressionFactor, size_t a_MaxOpenFiles, size_t a_ChunkDataCacheSize);
+
+protected:
+
+	/** Offsets and sizes of the parts of a chunk payload, as read from its header */
+	struct sPayloadLayout
+	{
+		bool     m_IsLightValid;
+		bool     m_AreBiomesValid;
+		UInt16   m_SectionMask;   ///< Bit Y is set if section Y is stored
+		size_t   m_SectionSize;   ///< Size of each stored section's data
+		size_t   m_BiomesOffset;
+		size_t   m_SectionsOffset;
+		size_t   m_EntitiesOffset;
+		size_t   m_EntitiesSize;
+	};
+
+
+	/** Returns true if the world has the folder for the binary region files.
+	Used to skip loading altogether in worlds that have never used this schema, without creating the folder. */
+	bool HasRegionFolder(void) const;
+
+	/** Parses the payload header into a_Layout and checks that the payload size matches it. Returns true if valid. */
+	static bool ParsePayloadLayout(const AString & a_Payload, sPayloadLayout & a_Layout);
+
+	/** Serializes the chunk into the uncompressed payload. Reads the chunk from the world. Returns true on success. */
+	bool SaveChunkToPayload(const cChunkCoords & a_Chunk, AString & a_Payload);
+
+	/** Loads the chunk from its uncompressed payload, a_Entities is the payload's parsed entities NBT. Hands the chunk over to the world. */
+	bool LoadChunkFromPayload(const cChunkCoords & a_Chunk, const AString & a_Payload, const sPayloadLayout & a_Layout, const cParsedNBT & a_Entities);
+
+	// cWSSchema overrides:
+	virtual bool LoadChunk(const cChunkCoords & a_Chunk) override;
+	virtual bool SaveChunk(const cChunkCoords & a_Chunk) override;
+	virtual const AString GetName(void) const override {return "binary"; }
+	virtual void LoadChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results) override;
+	virtual void SaveChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results) override;
+	virtual void PrefetchChunks(const cChunkCoordsVector & a_Chunks) override;
+} ;
+
+
+
+
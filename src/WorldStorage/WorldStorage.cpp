@@ -8,6 +8,7 @@
 #include "Globals.h"
 #include "WorldStorage.h"
 #include "WSSAnvil.h"
+#include "WSSBinary.h"
 #include "../World.h"
 #include "../Generating/ChunkGenerator.h"
 #include "../Entities/Entity.h"
@@ -16,6 +17,26 @@
 
 
 
+/** Maximum number of chunks that are loaded or saved together.
+The schemas may process the chunks in a batch in parallel, but the callbacks are called only after the whole batch. */
+static const size_t MAX_BATCH_SIZE = 8;
+
+/** Maximum number of chunks passed to the schemas for prefetching at once. */
+static const size_t MAX_PREFETCH_BATCH_SIZE = 64;
+
+/** Maximum number of chunks waiting in the prefetch queue; further requests are dropped. */
+static const size_t MAX_PREFETCH_QUEUE_LENGTH = 2048;
+
+/** Number of prefetched chunks remembered for skipping repeated requests, see m_RecentlyPrefetched. */
+static const size_t MAX_RECENTLY_PREFETCHED = 8192;
+
+/** Number of milliseconds that the storage thread must be idle before it compacts the storage, and the interval of the compaction steps. */
+static const unsigned COMPACTION_IDLE_MSEC = 250;
+
+
+
+
+
 /// Example storage schema - forgets all chunks ;)
 class cWSSForgetful :
 	public cWSSchema
@@ -40,7 +61,12 @@ protected:
 cWorldStorage::cWorldStorage(void) :
 	super("cWorldStorage"),
 	m_World(nullptr),
-	m_SaveSchema(nullptr)
+	m_PrefetchQueue(MAX_PREFETCH_QUEUE_LENGTH),
+	m_NumChunksSaved(0),
+	m_NumBytesSaved(0),
+	m_SaveSchema(nullptr),
+	m_CompactionRate(0),
+	m_CompactionBudget(0)
 {
 }
 
@@ -60,11 +86,12 @@ cWorldStorage::~cWorldStorage()
 
 
 
-bool cWorldStorage::Start(cWorld * a_World, const AString & a_StorageSchemaName, int a_StorageCompressionFactor)
+bool cWorldStorage::Start(cWorld * a_World, const AString & a_StorageSchemaName, eCompressionCodec a_StorageCompression, int a_StorageCompressionFactor, size_t a_MaxOpenRegionFiles, int a_CompactionRate, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize)
 {
 	m_World = a_World;
 	m_StorageSchemaName = a_StorageSchemaName;
-	InitSchemas(a_StorageCompressionFactor);
+	m_CompactionRate = std::max(a_CompactionRate, 0);
+	InitSchemas(a_StorageCompression, a_StorageCompressionFactor, a_MaxOpenRegionFiles, a_ChunkDataCacheSize, a_SectionCacheSize);
 	
 	return super::Start();
 }
@@ -88,6 +115,7 @@ void cWorldStorage::WaitForFinish(void)
 	
 	{
 		m_LoadQueue.Clear();
+		m_PrefetchQueue.Clear();
 	}
 	
 	// Wait for the saving to finish:
@@ -140,6 +168,20 @@ size_t cWorldStorage::GetSaveQueueLength(void)
 
 
 
+size_t cWorldStorage::GetAverageChunkSaveSize(size_t a_Default) const
+{
+	UInt64 NumChunks = m_NumChunksSaved;
+	if (NumChunks == 0)
+	{
+		return a_Default;
+	}
+	return static_cast<size_t>(m_NumBytesSaved / NumChunks);
+}
+
+
+
+
+
 void cWorldStorage::QueueLoadChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallback * a_Callback)
 {
 	ASSERT(m_World->IsChunkQueued(a_ChunkX, a_ChunkZ));
@@ -164,6 +206,27 @@ void cWorldStorage::QueueSaveChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallba
 
 
 
+void cWorldStorage::QueuePrefetchChunks(const cChunkCoordsVector & a_Chunks)
+{
+	if (a_Chunks.empty())
+	{
+		return;
+	}
+	for (const auto & Chunk: a_Chunks)
+	{
+		if (!m_PrefetchQueue.TryEnqueueItem(Chunk))
+		{
+			// The queue is full, the storage thread is way behind; prefetching is only a hint, so drop the rest
+			break;
+		}
+	}
+	m_Event.Set();
+}
+
+
+
+
+
 void cWorldStorage::UnqueueLoad(int a_ChunkX, int a_ChunkZ)
 {
 	m_LoadQueue.RemoveIf([=](cChunkCoordsWithCallback & a_Item)
@@ -190,10 +253,11 @@ void cWorldStorage::UnqueueSave(const cChunkCoords & a_Chunk)
 
 
 
-void cWorldStorage::InitSchemas(int a_StorageCompressionFactor)
+void cWorldStorage::InitSchemas(eCompressionCodec a_StorageCompression, int a_StorageCompressionFactor, size_t a_MaxOpenRegionFiles, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize)
 {
 	// The first schema added is considered the default
-	m_Schemas.push_back(new cWSSAnvil    (m_World, a_StorageCompressionFactor));
+	m_Schemas.push_back(new cWSSAnvil    (m_World, a_StorageCompression, a_StorageCompressionFactor, a_MaxOpenRegionFiles, a_ChunkDataCacheSize, a_SectionCacheSize));
+	m_Schemas.push_back(new cWSSBinary   (m_World, a_StorageCompression, a_StorageCompressionFactor, a_MaxOpenRegionFiles, a_ChunkDataCacheSize));
 	m_Schemas.push_back(new cWSSForgetful(m_World));
 	// Add new schemas here
 	
@@ -230,7 +294,19 @@ void cWorldStorage::Execute(void)
 {
 	while (!m_ShouldTerminate)
 	{
-		m_Event.Wait();
+		if (m_CompactionRate > 0)
+		{
+			if (!m_Event.Wait(COMPACTION_IDLE_MSEC))
+			{
+				// Nothing has been queued for a while, use the idle time for compacting the storage:
+				CompactStorage();
+				continue;
+			}
+		}
+		else
+		{
+			m_Event.Wait();
+		}
 		// Process both queues until they are empty again:
 		bool Success;
 		do
@@ -240,8 +316,13 @@ void cWorldStorage::Execute(void)
 				return;
 			}
 			
-			Success = LoadOneChunk();
-			Success |= SaveOneChunk();
+			Success = LoadChunkBatch();
+			Success |= SaveChunkBatch();
+			if (!Success)
+			{
+				// Only prefetch when idle, the actual loads and saves are more important:
+				Success = PrefetchChunkBatch();
+			}
 		} while (Success);
 	}
 }
@@ -250,55 +331,105 @@ void cWorldStorage::Execute(void)
 
 
 
-bool cWorldStorage::LoadOneChunk(void)
+bool cWorldStorage::LoadChunkBatch(void)
 {
-	// Dequeue an item, bail out if there's none left:
-	cChunkCoordsWithCallback ToLoad(0, 0, nullptr);
-	bool ShouldLoad = m_LoadQueue.TryDequeueItem(ToLoad);
-	if (!ShouldLoad)
+	// Dequeue a batch of items, bail out if there's none left:
+	std::vector<cChunkCoordsWithCallback> ToLoad;
+	cChunkCoordsVector Coords;
+	cChunkCoordsWithCallback Item(0, 0, nullptr);
+	while ((ToLoad.size() < MAX_BATCH_SIZE) && m_LoadQueue.TryDequeueItem(Item))
+	{
+		ASSERT(m_World->IsChunkQueued(Item.m_ChunkX, Item.m_ChunkZ));
+		ToLoad.push_back(Item);
+		Coords.push_back(cChunkCoords(Item.m_ChunkX, Item.m_ChunkZ));
+	}
+	if (ToLoad.empty())
 	{
 		return false;
 	}
 
-	// Load the chunk:
-	bool res = LoadChunk(ToLoad.m_ChunkX, ToLoad.m_ChunkZ);
-
-	// Call the callback, if specified:
-	if (ToLoad.m_Callback != nullptr)
+	// First try the schema that is used for saving, then all the other schemas for the chunks it didn't have:
+	std::vector<bool> Results;
+	m_SaveSchema->LoadChunks(Coords, Results);
+	for (size_t i = 0; i < ToLoad.size(); i++)
 	{
-		ToLoad.m_Callback->Call(ToLoad.m_ChunkX, ToLoad.m_ChunkZ);
+		if (!Results[i])
+		{
+			LoadChunkFromOtherSchemas(Coords[i]);
+		}
+
+		// Call the callback, if specified:
+		if (ToLoad[i].m_Callback != nullptr)
+		{
+			ToLoad[i].m_Callback->Call(ToLoad[i].m_ChunkX, ToLoad[i].m_ChunkZ);
+		}
 	}
-	return res;
+	return true;
 }
 
 
 
 
 
-bool cWorldStorage::SaveOneChunk(void)
+bool cWorldStorage::SaveChunkBatch(void)
 {
-	// Dequeue one chunk to save:
-	cChunkCoordsWithCallback ToSave(0, 0, nullptr);
-	bool ShouldSave = m_SaveQueue.TryDequeueItem(ToSave);
-	if (!ShouldSave)
+	// Dequeue a batch of chunks to save:
+	std::vector<cChunkCoordsWithCallback> ToSave;
+	cChunkCoordsWithCallback Item(0, 0, nullptr);
+	while ((ToSave.size() < MAX_BATCH_SIZE) && m_SaveQueue.TryDequeueItem(Item))
+	{
+		ToSave.push_back(Item);
+	}
+	if (ToSave.empty())
 	{
 		return false;
 	}
 	
-	// Save the chunk, if it's valid:
-	if (m_World->IsChunkValid(ToSave.m_ChunkX, ToSave.m_ChunkZ))
+	// Save the chunks that are valid:
+	cChunkCoordsVector Coords;
+	for (auto & Chunk: ToSave)
+	{
+		if (m_World->IsChunkValid(Chunk.m_ChunkX, Chunk.m_ChunkZ))
+		{
+			m_World->MarkChunkSaving(Chunk.m_ChunkX, Chunk.m_ChunkZ);
+			Coords.push_back(cChunkCoords(Chunk.m_ChunkX, Chunk.m_ChunkZ));
+		}
+	}
+	if (!Coords.empty())
 	{
-		m_World->MarkChunkSaving(ToSave.m_ChunkX, ToSave.m_ChunkZ);
-		if (m_SaveSchema->SaveChunk(cChunkCoords(ToSave.m_ChunkX, ToSave.m_ChunkZ)))
+		std::vector<bool> Results;
+		UInt64 BytesBefore = m_SaveSchema->GetNumBytesSaved();
+		m_SaveSchema->SaveChunks(Coords, Results);
+		UInt64 NumSaved = 0;
+		for (size_t i = 0; i < Coords.size(); i++)
+		{
+			if (Results[i])
+			{
+				m_World->MarkChunkSaved(Coords[i].m_ChunkX, Coords[i].m_ChunkZ);
+				NumSaved++;
+			}
+		}
+		UInt64 BytesSaved = m_SaveSchema->GetNumBytesSaved() - BytesBefore;
+		if (BytesSaved > 0)
 		{
-			m_World->MarkChunkSaved(ToSave.m_ChunkX, ToSave.m_ChunkZ);
+			m_NumBytesSaved += BytesSaved;
+			m_NumChunksSaved += NumSaved;
 		}
 	}
 
-	// Call the callback, if specified:
-	if (ToSave.m_Callback != nullptr)
+	// Once all the queued chunks are written, let the schema write out what it keeps buffered:
+	if (m_SaveQueue.Size() == 0)
 	{
-		ToSave.m_Callback->Call(ToSave.m_ChunkX, ToSave.m_ChunkZ);
+		m_SaveSchema->Flush();
+	}
+
+	// Call the callbacks, if specified:
+	for (auto & Chunk: ToSave)
+	{
+		if (Chunk.m_Callback != nullptr)
+		{
+			Chunk.m_Callback->Call(Chunk.m_ChunkX, Chunk.m_ChunkZ);
+		}
 	}
 	return true;
 }
@@ -307,29 +438,78 @@ bool cWorldStorage::SaveOneChunk(void)
 
 
 
-bool cWorldStorage::LoadChunk(int a_ChunkX, int a_ChunkZ)
+bool cWorldStorage::PrefetchChunkBatch(void)
 {
-	ASSERT(m_World->IsChunkQueued(a_ChunkX, a_ChunkZ));
-	
-	cChunkCoords Coords(a_ChunkX, a_ChunkZ);
+	// Dequeue a batch, skipping the chunks that were prefetched recently or are already in memory:
+	cChunkCoordsVector Coords;
+	bool HasDequeued = false;
+	cChunkCoords Chunk(0, 0);
+	while ((Coords.size() < MAX_PREFETCH_BATCH_SIZE) && m_PrefetchQueue.TryDequeueItem(Chunk))
+	{
+		HasDequeued = true;
+		if (
+			!m_RecentlyPrefetched.insert(Chunk).second ||
+			m_World->IsChunkValid(Chunk.m_ChunkX, Chunk.m_ChunkZ) ||
+			m_World->IsChunkQueued(Chunk.m_ChunkX, Chunk.m_ChunkZ)
+		)
+		{
+			continue;
+		}
+		Coords.push_back(Chunk);
+	}
+	if (m_RecentlyPrefetched.size() > MAX_RECENTLY_PREFETCHED)
+	{
+		m_RecentlyPrefetched.clear();
+	}
+	if (Coords.empty())
+	{
+		return HasDequeued;
+	}
 
-	// First try the schema that is used for saving
-	if (m_SaveSchema->LoadChunk(Coords))
+	// The chunk may be in any of the schemas, let all of them prefetch it:
+	for (auto Schema: m_Schemas)
 	{
-		return true;
+		Schema->PrefetchChunks(Coords);
 	}
-	
-	// If it didn't have the chunk, try all the other schemas:
+	return true;
+}
+
+
+
+
+
+void cWorldStorage::CompactStorage(void)
+{
+	// Allow a burst of at most one second's worth of the rate:
+	m_CompactionBudget = std::min(m_CompactionBudget + m_CompactionRate * COMPACTION_IDLE_MSEC / 1000, m_CompactionRate);
+	while ((m_CompactionBudget > 0) && !m_ShouldTerminate)
+	{
+		size_t NumBytes = m_SaveSchema->CompactStep();
+		if (NumBytes == 0)
+		{
+			// Nothing (more) to compact
+			break;
+		}
+		m_CompactionBudget -= static_cast<Int64>(NumBytes);
+	}
+}
+
+
+
+
+
+bool cWorldStorage::LoadChunkFromOtherSchemas(const cChunkCoords & a_Chunk)
+{
 	for (cWSSchemaList::iterator itr = m_Schemas.begin(); itr != m_Schemas.end(); ++itr)
 	{
-		if (((*itr) != m_SaveSchema) && (*itr)->LoadChunk(Coords))
+		if (((*itr) != m_SaveSchema) && (*itr)->LoadChunk(a_Chunk))
 		{
 			return true;
 		}
 	}
 	
 	// Notify the chunk owner that the chunk failed to load (sets cChunk::m_HasLoadFailed to true):
-	m_World->ChunkLoadFailed(a_ChunkX, a_ChunkZ);
+	m_World->ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
 	
 	return false;
 }
@@ -337,4 +517,3 @@ bool cWorldStorage::LoadChunk(int a_ChunkX, int a_ChunkZ)
 
 
 
-
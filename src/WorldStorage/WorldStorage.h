@@ -17,6 +17,9 @@
 #include "../ChunkDef.h"
 #include "../OSSupport/IsThread.h"
 #include "../OSSupport/Queue.h"
+#include "../StringCompression.h"
+#include <atomic>
+#include <unordered_set>
 
 
 
@@ -41,6 +44,44 @@ public:
 	virtual bool LoadChunk(const cChunkCoords & a_Chunk) = 0;
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) = 0;
 	virtual const AString GetName(void) const = 0;
+
+	/** Loads the specified chunks, stores the success of each into a_Results, in the same order.
+	The default implementation loads them one by one; schemas may override it to process them in parallel. */
+	virtual void LoadChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results)
+	{
+		a_Results.resize(a_Chunks.size());
+		for (size_t i = 0; i < a_Chunks.size(); i++)
+		{
+			a_Results[i] = LoadChunk(a_Chunks[i]);
+		}
+	}
+
+	/** Saves the specified chunks, stores the success of each into a_Results, in the same order.
+	The default implementation saves them one by one; schemas may override it to process them in parallel. */
+	virtual void SaveChunks(const cChunkCoordsVector & a_Chunks, std::vector<bool> & a_Results)
+	{
+		a_Results.resize(a_Chunks.size());
+		for (size_t i = 0; i < a_Chunks.size(); i++)
+		{
+			a_Results[i] = SaveChunk(a_Chunks[i]);
+		}
+	}
+
+	/** Writes out any data that the schema keeps buffered in memory. Called when the save queue becomes empty. */
+	virtual void Flush(void) {}
+
+	/** Returns the total number of bytes of chunk data the schema has written so far, used for throttling the saving.
+	Schemas that cannot tell return 0. */
+	virtual UInt64 GetNumBytesSaved(void) { return 0; }
+
+	/** Hints the schema that the specified chunks are likely to be loaded soon, so that it can start reading them
+	in the background. Must not block on the actual reads. The default implementation does nothing. */
+	virtual void PrefetchChunks(const cChunkCoordsVector & a_Chunks) { UNUSED(a_Chunks); }
+
+	/** Relocates a small part of the stored data to make the storage more compact, such as moving a single chunk
+	towards the start of its region file. Called by the storage thread when it has been idle for a while.
+	Returns the number of bytes moved, or 0 if there's nothing more to compact. The default implementation does nothing. */
+	virtual size_t CompactStep(void) { return 0; }
 	
 protected:
 
@@ -66,11 +107,20 @@ public:
 	
 	void QueueLoadChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallback * a_Callback = nullptr);
 	void QueueSaveChunk(int a_ChunkX, int a_ChunkZ, cChunkCoordCallback * a_Callback = nullptr);
+
+	/** Queues the chunks for prefetching, which warms up the OS disk cache for loading them later.
+	Prefetching is dropped, rather than queued, when the storage is already behind with it. */
+	void QueuePrefetchChunks(const cChunkCoordsVector & a_Chunks);
 	
 	void UnqueueLoad(int a_ChunkX, int a_ChunkZ);
 	void UnqueueSave(const cChunkCoords & a_Chunk);
 	
-	bool Start(cWorld * a_World, const AString & a_StorageSchemaName, int a_StorageCompressionFactor);  // Hide the cIsThread's Start() method, we need to provide args
+	/** Starts the storage thread; a_CompactionRate is the number of bytes per second that the thread may move when compacting
+	the storage in its idle time (0 disables the compaction), a_ChunkDataCacheSize is the number of bytes of the recently used
+	chunks' data that each schema keeps in memory, a_SectionCacheSize is the number of bytes of the compressed chunk sections
+	that the Anvil schema keeps for splicing into the next saves of their chunks.
+	Hides the cIsThread's Start() method, we need to provide args. */
+	bool Start(cWorld * a_World, const AString & a_StorageSchemaName, eCompressionCodec a_StorageCompression, int a_StorageCompressionFactor, size_t a_MaxOpenRegionFiles, int a_CompactionRate, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize);
 	void Stop(void);  // Hide the cIsThread's Stop() method, we need to signal the event
 	void WaitForFinish(void);
 	void WaitForLoadQueueEmpty(void);
@@ -78,6 +128,10 @@ public:
 	
 	size_t GetLoadQueueLength(void);
 	size_t GetSaveQueueLength(void);
+
+	/** Returns the average size, in bytes, that the saved chunks take in the storage,
+	or a_Default if the save schema doesn't report it or nothing has been saved yet. Thread-safe. */
+	size_t GetAverageChunkSaveSize(size_t a_Default) const;
 	
 protected:
 
@@ -86,6 +140,18 @@ protected:
 
 	cChunkCoordsQueue  m_LoadQueue;
 	cChunkCoordsQueue m_SaveQueue;
+
+	/** Chunks to prefetch, processed when there's nothing to load or save.
+	Bounded, the chunks that don't fit are not prefetched. */
+	cRingQueue<cChunkCoords> m_PrefetchQueue;
+
+	/** Chunks prefetched recently, so that the overlapping requests from a moving player don't get prefetched repeatedly.
+	Cleared once it grows too large. Only accessed from the storage thread. */
+	std::unordered_set<cChunkCoords, cChunkCoordsHash> m_RecentlyPrefetched;
+
+	/** The number of chunks saved and the bytes they took, as reported by the save schema; for GetAverageChunkSaveSize() */
+	std::atomic<UInt64> m_NumChunksSaved;
+	std::atomic<UInt64> m_NumBytesSaved;
 	
 	/// All the storage schemas (all used for loading)
 	cWSSchemaList m_Schemas;
@@ -93,21 +159,36 @@ protected:
 	/// The one storage schema used for saving
 	cWSSchema *   m_SaveSchema;
 
+	/** The number of bytes per second that the compaction may move, 0 if the compaction is disabled. */
+	Int64 m_CompactionRate;
+
+	/** The number of bytes that the compaction may still move. Refilled by m_CompactionRate while idle, may go negative
+	when a step moves more than the budget allowed. Only accessed from the storage thread. */
+	Int64 m_CompactionBudget;
+
 	
-	/// Loads the chunk specified; returns true on success, false on failure
-	bool LoadChunk(int a_ChunkX, int a_ChunkZ);
+	/** Loads the specified chunk using the schemas other than m_SaveSchema; returns true on success.
+	If no schema has the chunk, notifies the world that the chunk failed to load. */
+	bool LoadChunkFromOtherSchemas(const cChunkCoords & a_Chunk);
 
-	void InitSchemas(int a_StorageCompressionFactor);
+	void InitSchemas(eCompressionCodec a_StorageCompression, int a_StorageCompressionFactor, size_t a_MaxOpenRegionFiles, size_t a_ChunkDataCacheSize, size_t a_SectionCacheSize);
 	
 	virtual void Execute(void) override;
 	
 	cEvent m_Event;       // Set when there's any addition to the queues
 
-	/// Loads one chunk from the queue (if any queued); returns true if there are more chunks in the load queue
-	bool LoadOneChunk(void);
+	/** Loads up to MAX_BATCH_SIZE chunks from the queue (if any queued); returns true if any chunk was dequeued */
+	bool LoadChunkBatch(void);
 	
-	/// Saves one chunk from the queue (if any queued); returns true if there are more chunks in the save queue
-	bool SaveOneChunk(void);
+	/** Saves up to MAX_BATCH_SIZE chunks from the queue (if any queued); returns true if any chunk was dequeued */
+	bool SaveChunkBatch(void);
+
+	/** Passes up to MAX_PREFETCH_BATCH_SIZE chunks from the prefetch queue to all the schemas, skipping the chunks
+	that are already loaded or queued for loading. Returns true if any chunk was dequeued. */
+	bool PrefetchChunkBatch(void);
+
+	/** Refills the compaction budget for the idle interval and lets the save schema compact the storage within it. */
+	void CompactStorage(void);
 } ;
 
 
@@ -461,6 +461,14 @@ int main( int argc, char **argv)
 		{
 			cRoot::m_RunAsService = true;
 		}
+		else if ((NoCaseCompare(Arg, "/recordticks") == 0) && (i + 1 < argc))
+		{
+			cRoot::m_TickRecordFileName = argv[++i];
+		}
+		else if ((NoCaseCompare(Arg, "/replayticks") == 0) && (i + 1 < argc))
+		{
+			cRoot::m_TickReplayFileName = argv[++i];
+		}
 	}  // for i - argv[]
 
 	#if defined(_WIN32)
@@ -0,0 +1,249 @@
+
+// Benchmark.cpp
+
+// Implements the benchmark of the cChunkData bulk operations, checking that each round-trip returns the original data
+
+/*
+Usage: chunkdata-benchmark-exe [NumIterations]
+Fills the flat arrays with a few synthetic chunks resembling the generated terrain (a single grass layer, lit plains,
+ore-speckled mountains), then times the Set* / Copy* / Copy() operations on each and reports the throughput and
+the number of section allocations from the pool. Each operation's result is compared to the source data, so the
+benchmark doubles as a regression test for the storage layouts.
+*/
+
+
+
+
+
+#include "Globals.h"
+#include "ChunkData.h"
+
+
+
+
+
+/** The pool that counts the sections it allocates, so that the benchmark can report them. */
+class cCountingAllocationPool :
+	public cAllocationPool<cChunkData::sChunkSection>
+{
+public:
+	cCountingAllocationPool(void) :
+		m_NumAllocations(0),
+		m_NumFrees(0)
+	{
+	}
+
+	virtual cChunkData::sChunkSection * Allocate() override
+	{
+		m_NumAllocations += 1;
+		return new cChunkData::sChunkSection();
+	}
+
+	virtual void Free(cChunkData::sChunkSection * a_Ptr) override
+	{
+		m_NumFrees += 1;
+		delete a_Ptr;
+	}
+
+	size_t m_NumAllocations;
+	size_t m_NumFrees;
+} ;
+
+
+
+
+
+/** The flat arrays of a single chunk, as used by the chunk loaders, the generator and the lighting thread. */
+struct sFlatChunk
+{
+	const char * m_Name;
+	BLOCKTYPE  m_BlockTypes[cChunkDef::NumBlocks];
+	NIBBLETYPE m_BlockMetas[cChunkDef::NumBlocks / 2];
+	NIBBLETYPE m_BlockLight[cChunkDef::NumBlocks / 2];
+	NIBBLETYPE m_SkyLight  [cChunkDef::NumBlocks / 2];
+} ;
+
+
+
+
+
+/** Fills a_Chunk with terrain up to a_Height: stone with ores speckled in whenever a_OreChance (in percent) allows, topped by
+three layers of dirt and one of grass. Sets the skylight above the terrain, and some blocklight if a_HasTorches is set. */
+static void FillTerrain(sFlatChunk & a_Chunk, const char * a_Name, int a_Height, int a_OreChance, bool a_HasTorches)
+{
+	a_Chunk.m_Name = a_Name;
+	memset(a_Chunk.m_BlockMetas, 0, sizeof(a_Chunk.m_BlockMetas));
+	memset(a_Chunk.m_BlockLight, 0, sizeof(a_Chunk.m_BlockLight));
+	unsigned Random = 0x12345678;
+	for (int y = 0; y < cChunkDef::Height; y++)
+	{
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				int Idx = cChunkDef::MakeIndexNoCheck(x, y, z);
+				Random = Random * 1103515245 + 12345;
+				BLOCKTYPE BlockType = E_BLOCK_AIR;
+				NIBBLETYPE SkyLight = 15;
+				if (y < a_Height - 4)
+				{
+					BlockType = (static_cast<int>((Random >> 16) % 100) < a_OreChance) ? static_cast<BLOCKTYPE>(E_BLOCK_GOLD_ORE + (Random >> 8) % 3) : E_BLOCK_STONE;
+					SkyLight = 0;
+				}
+				else if (y < a_Height - 1)
+				{
+					BlockType = E_BLOCK_DIRT;
+					SkyLight = 0;
+				}
+				else if (y < a_Height)
+				{
+					BlockType = E_BLOCK_GRASS;
+					SkyLight = 0;
+				}
+				a_Chunk.m_BlockTypes[Idx] = BlockType;
+				NIBBLETYPE Shift = static_cast<NIBBLETYPE>((Idx & 1) * 4);
+				a_Chunk.m_SkyLight[Idx / 2] = static_cast<NIBBLETYPE>((a_Chunk.m_SkyLight[Idx / 2] & ~(0x0f << Shift)) | (SkyLight << Shift));
+				if (a_HasTorches && (y == a_Height) && (((x + z) % 5) == 0))
+				{
+					a_Chunk.m_BlockTypes[Idx] = E_BLOCK_TORCH;
+					a_Chunk.m_BlockMetas[Idx / 2] |= static_cast<NIBBLETYPE>(5 << Shift);
+				}
+				if (a_HasTorches && (y >= a_Height) && (y < a_Height + 8))
+				{
+					a_Chunk.m_BlockLight[Idx / 2] |= static_cast<NIBBLETYPE>((14 - (y - a_Height)) << Shift);
+				}
+			}  // for x
+		}  // for z
+	}  // for y
+}
+
+
+
+
+
+/** Reports a single measured operation. */
+static void Report(const char * a_ChunkName, const char * a_Operation, std::chrono::steady_clock::duration a_Duration, int a_NumIterations, size_t a_NumAllocations)
+{
+	double Msec = std::chrono::duration_cast<std::chrono::microseconds>(a_Duration).count() / 1000.0;
+	double ChunksPerSec = (Msec > 0) ? (a_NumIterations * 1000.0 / Msec) : 0;
+	printf("%-10s %-16s %9.3f ms %12.0f chunks/s %8.2f pool allocs/chunk\n",
+		a_ChunkName, a_Operation, Msec, ChunksPerSec, static_cast<double>(a_NumAllocations) / a_NumIterations
+	);
+}
+
+
+
+
+
+/** Runs all the measured operations on a single chunk, checking each result against the source arrays. */
+static void BenchmarkChunk(const sFlatChunk & a_Chunk, int a_NumIterations)
+{
+	cCountingAllocationPool Pool;
+	std::unique_ptr<sFlatChunk> Dest(new sFlatChunk);
+
+	// SetBlockTypes() + SetMetas() + SetBlockLight() + SetSkyLight(), the way the generated and loaded chunks are stored:
+	size_t NumAllocations = Pool.m_NumAllocations;
+	auto Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		cChunkData Data(Pool);
+		Data.SetBlockTypes(a_Chunk.m_BlockTypes);
+		Data.SetMetas(a_Chunk.m_BlockMetas);
+		Data.SetBlockLight(a_Chunk.m_BlockLight);
+		Data.SetSkyLight(a_Chunk.m_SkyLight);
+	}
+	Report(a_Chunk.m_Name, "Set*", std::chrono::steady_clock::now() - Start, a_NumIterations, Pool.m_NumAllocations - NumAllocations);
+
+	// SetSection() for each section, the way the Anvil loader stores the chunks:
+	NumAllocations = Pool.m_NumAllocations;
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		cChunkData Data(Pool);
+		for (size_t s = 0; s < cChunkData::NumSections; s++)
+		{
+			Data.SetSection(s,
+				a_Chunk.m_BlockTypes + s * cChunkData::SectionBlockCount,
+				a_Chunk.m_BlockMetas + s * cChunkData::SectionBlockCount / 2,
+				a_Chunk.m_BlockLight + s * cChunkData::SectionBlockCount / 2,
+				a_Chunk.m_SkyLight   + s * cChunkData::SectionBlockCount / 2
+			);
+		}
+	}
+	Report(a_Chunk.m_Name, "SetSection", std::chrono::steady_clock::now() - Start, a_NumIterations, Pool.m_NumAllocations - NumAllocations);
+
+	cChunkData Data(Pool);
+	Data.SetBlockTypes(a_Chunk.m_BlockTypes);
+	Data.SetMetas(a_Chunk.m_BlockMetas);
+	Data.SetBlockLight(a_Chunk.m_BlockLight);
+	Data.SetSkyLight(a_Chunk.m_SkyLight);
+
+	// Copy*(), the way the chunks are serialized and saved:
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		Data.CopyBlockTypes(Dest->m_BlockTypes);
+		Data.CopyMetas(Dest->m_BlockMetas);
+		Data.CopyBlockLight(Dest->m_BlockLight);
+		Data.CopySkyLight(Dest->m_SkyLight);
+	}
+	Report(a_Chunk.m_Name, "Copy*", std::chrono::steady_clock::now() - Start, a_NumIterations, 0);
+	testassert(memcmp(Dest->m_BlockTypes, a_Chunk.m_BlockTypes, sizeof(a_Chunk.m_BlockTypes)) == 0);
+	testassert(memcmp(Dest->m_BlockMetas, a_Chunk.m_BlockMetas, sizeof(a_Chunk.m_BlockMetas)) == 0);
+	testassert(memcmp(Dest->m_BlockLight, a_Chunk.m_BlockLight, sizeof(a_Chunk.m_BlockLight)) == 0);
+	testassert(memcmp(Dest->m_SkyLight,   a_Chunk.m_SkyLight,   sizeof(a_Chunk.m_SkyLight))   == 0);
+
+	// Copy(), the way the chunk snapshots and the lighting thread copy the whole chunk:
+	NumAllocations = Pool.m_NumAllocations;
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		cChunkData Copy = Data.Copy();
+	}
+	Report(a_Chunk.m_Name, "Copy()", std::chrono::steady_clock::now() - Start, a_NumIterations, Pool.m_NumAllocations - NumAllocations);
+	cChunkData Copy = Data.Copy();
+	Copy.CopyBlockTypes(Dest->m_BlockTypes);
+	Copy.CopyMetas(Dest->m_BlockMetas);
+	Copy.CopyBlockLight(Dest->m_BlockLight);
+	Copy.CopySkyLight(Dest->m_SkyLight);
+	testassert(memcmp(Dest->m_BlockTypes, a_Chunk.m_BlockTypes, sizeof(a_Chunk.m_BlockTypes)) == 0);
+	testassert(memcmp(Dest->m_BlockMetas, a_Chunk.m_BlockMetas, sizeof(a_Chunk.m_BlockMetas)) == 0);
+	testassert(memcmp(Dest->m_BlockLight, a_Chunk.m_BlockLight, sizeof(a_Chunk.m_BlockLight)) == 0);
+	testassert(memcmp(Dest->m_SkyLight,   a_Chunk.m_SkyLight,   sizeof(a_Chunk.m_SkyLight))   == 0);
+	testassert(Copy.GetNumNonEmptySections() == Data.GetNumNonEmptySections());
+
+	// Report the memory used by the stored chunk:
+	size_t NumFlatSections = 0, NumPaletteSections = 0, NumHeapBytes = 0;
+	Data.AddMemoryStats(NumFlatSections, NumPaletteSections, NumHeapBytes);
+	printf("%-10s %u flat sections, %u palette sections, %u heap bytes, %u non-empty sections\n",
+		a_Chunk.m_Name,
+		static_cast<unsigned>(NumFlatSections), static_cast<unsigned>(NumPaletteSections),
+		static_cast<unsigned>(NumHeapBytes), static_cast<unsigned>(Data.GetNumNonEmptySections())
+	);
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	int NumIterations = 100;
+	if (argc > 1)
+	{
+		NumIterations = std::max(atoi(argv[1]), 1);
+	}
+
+	std::unique_ptr<sFlatChunk> Chunk(new sFlatChunk);
+	FillTerrain(*Chunk, "Flat", 1, 0, false);
+	BenchmarkChunk(*Chunk, NumIterations);
+	FillTerrain(*Chunk, "Plains", 64, 0, true);
+	BenchmarkChunk(*Chunk, NumIterations);
+	FillTerrain(*Chunk, "Mountains", 160, 5, true);
+	BenchmarkChunk(*Chunk, NumIterations);
+	return 0;
+}
+
+
+
+
@@ -0,0 +1,168 @@
+// BlockCounts.cpp
+
+// Implements the test for cChunkData's per-section block counts, across all the ways of changing the block types
+
+
+
+
+
+#include "Globals.h"
+#include "ChunkData.h"
+
+
+
+
+
+/** Walks the blocks of the section and counts those of the category, the slow way the counts replace. */
+static int CountSlow(const cChunkData & a_Data, size_t a_SectionIdx, const BLOCKTYPE * a_Types)
+{
+	int res = 0;
+	int MinY = static_cast<int>(a_SectionIdx * cChunkData::SectionHeight);
+	for (int y = MinY; y < MinY + static_cast<int>(cChunkData::SectionHeight); y++)
+	{
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				BLOCKTYPE BlockType = a_Data.GetBlock(x, y, z);
+				for (const BLOCKTYPE * Type = a_Types; *Type != 0; ++Type)
+				{
+					if (BlockType == *Type)
+					{
+						res += 1;
+					}
+				}
+			}
+		}
+	}
+	return res;
+}
+
+
+
+
+
+/** Checks all the sections' counts of the categories used by the test against walking the blocks. */
+static void VerifyCounts(const cChunkData & a_Data)
+{
+	static const BLOCKTYPE NonAir[] = {1, 2, 3, 8, 9, 10, 0};  // All the types used by the test
+	static const BLOCKTYPE Fluids[] = {8, 9, 10, 0};
+	static const BLOCKTYPE Lights[] = {10, 0};
+	int TotalFluids = 0;
+	for (size_t i = 0; i < cChunkData::NumSections; i++)
+	{
+		testassert(a_Data.GetSectionBlockCount(i, bcNonAir) == CountSlow(a_Data, i, NonAir));
+		testassert(a_Data.GetSectionBlockCount(i, bcFluid) == CountSlow(a_Data, i, Fluids));
+		testassert(a_Data.GetSectionBlockCount(i, bcLightSource) == CountSlow(a_Data, i, Lights));
+		testassert(a_Data.GetSectionBlockCount(i, bcRandomTicked) == 0);
+		TotalFluids += a_Data.GetSectionBlockCount(i, bcFluid);
+	}
+	testassert(a_Data.GetBlockCount(bcFluid) == TotalFluids);
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	class cMockAllocationPool
+		: public cAllocationPool<cChunkData::sChunkSection>
+	{
+		virtual cChunkData::sChunkSection * Allocate()
+		{
+			return new cChunkData::sChunkSection();
+		}
+
+		virtual void Free(cChunkData::sChunkSection * a_Ptr)
+		{
+			delete a_Ptr;
+		}
+	} Pool;
+
+	// Types 8 and 9 are fluids, 10 is a fluid and a light source:
+	cChunkData::SetBlockTypeCategory(8,  bcFluid, true);
+	cChunkData::SetBlockTypeCategory(9,  bcFluid, true);
+	cChunkData::SetBlockTypeCategory(10, bcFluid, true);
+	cChunkData::SetBlockTypeCategory(10, bcLightSource, true);
+
+	{
+		// Single block changes, in both the palette and the flat layout:
+		cChunkData buffer(Pool);
+		VerifyCounts(buffer);
+		testassert(buffer.GetNumNonAirSections() == 0);
+		buffer.SetBlock(0, 0, 0, 8);
+		buffer.SetBlock(1, 0, 0, 10);
+		buffer.SetBlock(2, 0, 0, 1);
+		VerifyCounts(buffer);
+		testassert(buffer.GetSectionBlockCount(0, bcNonAir) == 3);
+		testassert(buffer.GetSectionBlockCount(0, bcFluid) == 2);
+		testassert(buffer.GetSectionBlockCount(0, bcLightSource) == 1);
+
+		// Rewriting with the categories changing both ways:
+		buffer.SetBlock(1, 0, 0, 9);
+		buffer.SetBlock(2, 0, 0, 10);
+		buffer.SetBlock(0, 0, 0, 0);
+		VerifyCounts(buffer);
+		testassert(buffer.GetSectionBlockCount(0, bcNonAir) == 2);
+
+		// Enough distinct blocks to promote the section to the flat layout:
+		for (int i = 0; i < 100; i++)
+		{
+			buffer.SetBlock(i % 16, 20, i / 16, static_cast<BLOCKTYPE>(1 + (i % 3)));
+			buffer.SetMeta(i % 16, 20, i / 16, static_cast<NIBBLETYPE>(i & 0x0f));
+			buffer.SetBlock(i % 16, 21, i / 16, static_cast<BLOCKTYPE>(8 + (i % 3)));
+		}
+		VerifyCounts(buffer);
+		testassert(buffer.GetSectionBlockCount(1, bcNonAir) == 200);
+
+		// Metas don't change the counts:
+		buffer.SetMeta(5, 5, 5, 3);
+		buffer.SetMeta(5, 20, 5, 7);
+		VerifyCounts(buffer);
+
+		// Clearing a section makes it air, even though it stays allocated:
+		for (int i = 0; i < 100; i++)
+		{
+			buffer.SetBlock(i % 16, 20, i / 16, 0);
+			buffer.SetBlock(i % 16, 21, i / 16, 0);
+		}
+		VerifyCounts(buffer);
+		testassert(buffer.GetSectionBlockCount(1, bcNonAir) == 0);
+		testassert(buffer.GetNumNonAirSections() == 1);
+
+		// The copy and the move keep the counts:
+		cChunkData copy = buffer.Copy();
+		VerifyCounts(copy);
+		cChunkData moved(std::move(copy));
+		VerifyCounts(moved);
+		testassert(moved.GetSectionBlockCount(0, bcFluid) == 2);
+	}
+
+	{
+		// The whole-chunk and per-section setters:
+		cChunkData buffer(Pool);
+		BLOCKTYPE Types[16 * 16 * 256];
+		for (size_t i = 0; i < ARRAYCOUNT(Types); i++)
+		{
+			Types[i] = static_cast<BLOCKTYPE>((i % 7 == 0) ? 10 : ((i % 5 == 0) ? 8 : ((i < 4096 * 3) ? 3 : 0)));
+		}
+		buffer.SetBlockTypes(Types);
+		VerifyCounts(buffer);
+		buffer.SetBlockTypes(Types);  // Again, now into the existing sections
+		VerifyCounts(buffer);
+
+		BLOCKTYPE SectionTypes[cChunkData::SectionBlockCount];
+		memset(SectionTypes, 9, sizeof(SectionTypes));
+		buffer.SetSection(4, SectionTypes, nullptr, nullptr, nullptr);
+		VerifyCounts(buffer);
+		testassert(buffer.GetSectionBlockCount(4, bcFluid) == static_cast<int>(cChunkData::SectionBlockCount));
+		memset(SectionTypes, 0, sizeof(SectionTypes));
+		buffer.SetSection(4, SectionTypes, nullptr, nullptr, nullptr);
+		VerifyCounts(buffer);
+		testassert(buffer.GetSectionBlockCount(4, bcNonAir) == 0);
+	}
+
+	// All tests successful:
+	return 0;
+}
@@ -142,6 +142,31 @@ int main(int argc, char** argv)
 		testassert(memcmp(SrcNibbleBuffer, DstNibbleBuffer, (16 * 16 * 256 / 2) - 1) == 0);
 	}
 	
+	{
+		cChunkData buffer(Pool);
+		
+		// Uniform sections with non-default values, next to a non-uniform section:
+		NIBBLETYPE SrcNibbleBuffer[16 * 16 * 256 / 2];
+		memset(SrcNibbleBuffer, 0x77, 16 * 16 * 256 / 2);
+		SrcNibbleBuffer[5000] = 0x12;
+		buffer.SetBlockLight(SrcNibbleBuffer);
+		buffer.SetSkyLight(SrcNibbleBuffer);
+		NIBBLETYPE DstNibbleBuffer[16 * 16 * 256 / 2];
+		buffer.CopyBlockLight(DstNibbleBuffer);
+		testassert(memcmp(SrcNibbleBuffer, DstNibbleBuffer, 16 * 16 * 256 / 2) == 0);
+		buffer.CopySkyLight(DstNibbleBuffer);
+		testassert(memcmp(SrcNibbleBuffer, DstNibbleBuffer, 16 * 16 * 256 / 2) == 0);
+		testassert(buffer.GetBlockLight(0, 0, 0) == 0x07);
+		testassert(buffer.GetSkyLight(15, 255, 15) == 0x07);
+		testassert(buffer.GetBlockLight(0, 39, 1) == 0x02);
+		testassert(buffer.GetBlockLight(1, 39, 1) == 0x01);
+		
+		// Copying out must keep the uniform values:
+		cChunkData copy = buffer.Copy();
+		copy.CopySkyLight(DstNibbleBuffer);
+		testassert(memcmp(SrcNibbleBuffer, DstNibbleBuffer, 16 * 16 * 256 / 2) == 0);
+	}
+	
 	// All tests successful:
 	return 0;
 }
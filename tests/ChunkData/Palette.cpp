@@ -0,0 +1,128 @@
+// Palette.cpp
+
+// Implements the test for cChunkData's palette-compressed sections, their growth and promotion to the flat layout
+
+
+
+
+
+#include "Globals.h"
+#include "ChunkData.h"
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	class cMockAllocationPool
+		: public cAllocationPool<cChunkData::sChunkSection>
+	{
+		virtual cChunkData::sChunkSection * Allocate()
+		{
+			return new cChunkData::sChunkSection();
+		}
+
+		virtual void Free(cChunkData::sChunkSection * a_Ptr)
+		{
+			delete a_Ptr;
+		}
+	} Pool;
+
+	{
+		// Grow a palette section through all the index widths, until it overflows:
+		cChunkData buffer(Pool);
+		for (int i = 0; i < 40; i++)
+		{
+			buffer.SetBlock(i % 16, 3, i / 16, static_cast<BLOCKTYPE>(i + 1));
+			buffer.SetMeta(i % 16, 3, i / 16, static_cast<NIBBLETYPE>(i & 0x0f));
+			for (int j = 0; j <= i; j++)
+			{
+				testassert(buffer.GetBlock(j % 16, 3, j / 16) == static_cast<BLOCKTYPE>(j + 1));
+				testassert(buffer.GetMeta(j % 16, 3, j / 16) == static_cast<NIBBLETYPE>(j & 0x0f));
+			}
+			testassert(buffer.GetBlock(15, 15, 15) == 0);
+			testassert(buffer.GetMeta(15, 15, 15) == 0);
+		}
+
+		// Light values must survive the promotion:
+		testassert(buffer.GetSkyLight(0, 3, 0) == 0x0f);
+		testassert(buffer.GetBlockLight(0, 3, 0) == 0);
+	}
+
+	{
+		// Overwriting blocks with a few types must reuse the unused palette entries:
+		cChunkData buffer(Pool);
+		for (int i = 0; i < 200; i++)
+		{
+			buffer.SetBlock(0, 0, 0, static_cast<BLOCKTYPE>(i));
+			buffer.SetBlock(1, 0, 0, static_cast<BLOCKTYPE>(i + 1));
+			testassert(buffer.GetBlock(0, 0, 0) == static_cast<BLOCKTYPE>(i));
+			testassert(buffer.GetBlock(1, 0, 0) == static_cast<BLOCKTYPE>(i + 1));
+			testassert(buffer.GetBlock(2, 0, 0) == 0);
+		}
+	}
+
+	{
+		// Bulk set with few and with many distinct blocks, read back through the flat copies:
+		cChunkData buffer(Pool);
+		BLOCKTYPE  SrcBlockBuffer[16 * 16 * 256];
+		NIBBLETYPE SrcNibbleBuffer[16 * 16 * 256 / 2];
+		for (size_t i = 0; i < ARRAYCOUNT(SrcBlockBuffer); i++)
+		{
+			// The lower half of the chunk has only 3 distinct types, the upper half has many:
+			SrcBlockBuffer[i] = (i < ARRAYCOUNT(SrcBlockBuffer) / 2) ? static_cast<BLOCKTYPE>(i % 3) : static_cast<BLOCKTYPE>(i % 251);
+		}
+		for (size_t i = 0; i < ARRAYCOUNT(SrcNibbleBuffer); i++)
+		{
+			SrcNibbleBuffer[i] = (i < ARRAYCOUNT(SrcNibbleBuffer) / 4) ? 0x21 : static_cast<NIBBLETYPE>(i % 256);
+		}
+		buffer.SetBlockTypes(SrcBlockBuffer);
+		buffer.SetMetas(SrcNibbleBuffer);
+
+		BLOCKTYPE  DstBlockBuffer[16 * 16 * 256];
+		NIBBLETYPE DstNibbleBuffer[16 * 16 * 256 / 2];
+		buffer.CopyBlockTypes(DstBlockBuffer);
+		testassert(memcmp(SrcBlockBuffer, DstBlockBuffer, sizeof(DstBlockBuffer)) == 0);
+		buffer.CopyMetas(DstNibbleBuffer);
+		testassert(memcmp(SrcNibbleBuffer, DstNibbleBuffer, sizeof(DstNibbleBuffer)) == 0);
+
+		// Partial copies crossing the palette and flat sections:
+		memset(DstBlockBuffer, 0xcc, sizeof(DstBlockBuffer));
+		buffer.CopyBlockTypes(DstBlockBuffer, 30000, 10000);
+		testassert(memcmp(SrcBlockBuffer + 30000, DstBlockBuffer, 10000) == 0);
+		testassert(DstBlockBuffer[10000] == 0xcc);
+
+		// Single-block changes on top of the bulk data:
+		buffer.SetBlock(5, 5, 5, 0x7f);
+		testassert(buffer.GetBlock(5, 5, 5) == 0x7f);
+		buffer.SetBlock(5, 200, 5, 0x7e);
+		testassert(buffer.GetBlock(5, 200, 5) == 0x7e);
+
+		// The deep copy must preserve both layouts:
+		cChunkData copy = buffer.Copy();
+		copy.CopyBlockTypes(DstBlockBuffer);
+		buffer.CopyBlockTypes(SrcBlockBuffer);
+		testassert(memcmp(SrcBlockBuffer, DstBlockBuffer, sizeof(DstBlockBuffer)) == 0);
+	}
+
+	{
+		// A section created by light data alone must read as air:
+		cChunkData buffer(Pool);
+		NIBBLETYPE LightBuffer[16 * 16 * 256 / 2];
+		memset(LightBuffer, 0x00, sizeof(LightBuffer));
+		LightBuffer[100] = 0x5a;
+		buffer.SetBlockLight(LightBuffer);
+		testassert(buffer.GetBlockLight(8, 0, 12) == 0x0a);
+		testassert(buffer.GetBlockLight(9, 0, 12) == 0x05);
+		testassert(buffer.GetBlock(8, 0, 12) == 0);
+		testassert(buffer.GetSkyLight(8, 0, 12) == 0x0f);
+	}
+
+	// All tests successful:
+	return 0;
+}
+
+
+
+
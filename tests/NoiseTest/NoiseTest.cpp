@@ -1,101 +1,381 @@
 
 // NoiseTest.cpp
 
-// Implements the main app entrypoint
+// Implements the microbenchmark of the noise generators, checking the array generators against the single-value ones
+
+/*
+Usage: noise-benchmark-exe [NumIterations] [JsonFileName]
+Times the integral noise functions of cNoise and the array generators of cCubicNoise, cImprovedNoise, cPerlinNoise
+and cRidgedMultiNoise in the array sizes used by the terrain generators, and reports the time per generated sample.
+Before that, the cCubicNoise array generators (which use the SSE2 interpolation kernels where available) are compared
+to the scalar cNoise::CubicNoise2D() / CubicNoise3D(), failing the test if they differ.
+If the JsonFileName is given, the results are also written to that file ("-" for stdout), so that the runs can be
+compared by a script.
+*/
+
+
+
+
 
 #include "Globals.h"
-#include <time.h>
-#include "Noise.h"
+#include "Noise/Noise.h"
+
+
+
+
+
+/** The largest difference allowed between the array generators and the scalar reference.
+The interpolation is done in a different order and with a different rounding, so the values don't match bit-for-bit. */
+static const NOISE_DATATYPE MAX_DIFFERENCE = static_cast<NOISE_DATATYPE>(0.0001);
+
+/** The results are summed into this, so that the compiler cannot optimize the measured calls away. */
+static volatile NOISE_DATATYPE g_Sink;
+
+
+
+
 
+/** A single measurement, as reported in the JSON output. */
+struct sResult
+{
+	AString m_Name;
+	AString m_Size;
+	double m_NsPerSample;
+	double m_SamplesPerSec;
+} ;
+
+typedef std::vector<sResult> sResults;
 
 
 
 
-void SaveValues(NOISE_DATATYPE * a_Values, const AString & a_FileName)
+
+/** Fills a_Coords with the noise-space coords that cCubicNoise uses for an array of a_Size values from a_Start to a_End.
+The coords are accumulated the same way cCubicNoise::CalcFloorFrac() does, so that the floors match exactly. */
+static void CalcCoords(int a_Size, NOISE_DATATYPE a_Start, NOISE_DATATYPE a_End, std::vector<NOISE_DATATYPE> & a_Coords)
 {
-	cFile f;
-	if (!f.Open(a_FileName, cFile::fmWrite))
+	a_Coords.resize(static_cast<size_t>(a_Size));
+	NOISE_DATATYPE val = a_Start;
+	NOISE_DATATYPE dif = (a_End - a_Start) / (a_Size - 1);
+	for (int i = 0; i < a_Size; i++)
 	{
-		LOGWARNING("Cannot write file %s", a_FileName.c_str());
-		return;
+		a_Coords[static_cast<size_t>(i)] = val;
+		val += dif;
 	}
-	for (int y = 0; y < 256; y++)
+}
+
+
+
+
+
+/** Compares cCubicNoise::Generate2D() to cNoise::CubicNoise2D() over the specified area.
+Returns the largest difference found. */
+static NOISE_DATATYPE ValidateCubic2D(int a_SizeX, int a_SizeY, NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX, NOISE_DATATYPE a_StartY, NOISE_DATATYPE a_EndY)
+{
+	cCubicNoise Cubic(1);
+	cNoise Noise(1);
+	std::vector<NOISE_DATATYPE> Values(static_cast<size_t>(a_SizeX * a_SizeY));
+	Cubic.Generate2D(Values.data(), a_SizeX, a_SizeY, a_StartX, a_EndX, a_StartY, a_EndY);
+	std::vector<NOISE_DATATYPE> CoordsX, CoordsY;
+	CalcCoords(a_SizeX, a_StartX, a_EndX, CoordsX);
+	CalcCoords(a_SizeY, a_StartY, a_EndY, CoordsY);
+	NOISE_DATATYPE MaxDiff = 0;
+	for (int y = 0; y < a_SizeY; y++)
+	{
+		for (int x = 0; x < a_SizeX; x++)
+		{
+			NOISE_DATATYPE Expected = Noise.CubicNoise2D(CoordsX[static_cast<size_t>(x)], CoordsY[static_cast<size_t>(y)]);
+			MaxDiff = std::max(MaxDiff, std::abs(Values[static_cast<size_t>(x + a_SizeX * y)] - Expected));
+		}
+	}
+	return MaxDiff;
+}
+
+
+
+
+
+/** Compares cCubicNoise::Generate3D() to cNoise::CubicNoise3D() over the specified area.
+Returns the largest difference found. */
+static NOISE_DATATYPE ValidateCubic3D(
+	int a_SizeX, int a_SizeY, int a_SizeZ,
+	NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+	NOISE_DATATYPE a_StartY, NOISE_DATATYPE a_EndY,
+	NOISE_DATATYPE a_StartZ, NOISE_DATATYPE a_EndZ
+)
+{
+	cCubicNoise Cubic(1);
+	cNoise Noise(1);
+	std::vector<NOISE_DATATYPE> Values(static_cast<size_t>(a_SizeX * a_SizeY * a_SizeZ));
+	Cubic.Generate3D(Values.data(), a_SizeX, a_SizeY, a_SizeZ, a_StartX, a_EndX, a_StartY, a_EndY, a_StartZ, a_EndZ);
+	std::vector<NOISE_DATATYPE> CoordsX, CoordsY, CoordsZ;
+	CalcCoords(a_SizeX, a_StartX, a_EndX, CoordsX);
+	CalcCoords(a_SizeY, a_StartY, a_EndY, CoordsY);
+	CalcCoords(a_SizeZ, a_StartZ, a_EndZ, CoordsZ);
+	NOISE_DATATYPE MaxDiff = 0;
+	for (int z = 0; z < a_SizeZ; z++)
 	{
-		unsigned char val[256];
-		for (int x = 0; x < 256; x++)
+		for (int y = 0; y < a_SizeY; y++)
 		{
-			val[x] = std::min(255, std::max(0, (int)(256 * a_Values[x + 256 * y])));
+			for (int x = 0; x < a_SizeX; x++)
+			{
+				NOISE_DATATYPE Expected = Noise.CubicNoise3D(CoordsX[static_cast<size_t>(x)], CoordsY[static_cast<size_t>(y)], CoordsZ[static_cast<size_t>(z)]);
+				size_t idx = static_cast<size_t>(x + a_SizeX * y + a_SizeX * a_SizeY * z);
+				MaxDiff = std::max(MaxDiff, std::abs(Values[idx] - Expected));
+			}
 		}
-		f.Write(val, 256);
 	}
+	return MaxDiff;
+}
+
+
+
+
+
+/** Runs all the validations, printing their results. Returns false if any of them fails. */
+static bool Validate(void)
+{
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+		printf("Validating the SSE2 interpolation kernels against the scalar reference:\n");
+	#else
+		printf("Validating the scalar interpolation kernels against the scalar reference:\n");
+	#endif
+
+	struct
+	{
+		const char * m_Name;
+		NOISE_DATATYPE m_MaxDiff;
+	} Checks[] =
+	{
+		// The sizes are chosen so that the SSE2 row kernel runs both its 4-wide loop and its scalar remainder:
+		{ "cCubicNoise::Generate2D 16x16",      ValidateCubic2D(16, 16, 0, 3, 0, 3) },
+		{ "cCubicNoise::Generate2D 67x33",      ValidateCubic2D(67, 33, -10.5f, 7.25f, 100, 113) },
+		{ "cCubicNoise::Generate3D 17x9x17",    ValidateCubic3D(17, 9, 17, 0, 4, 0, 2, 0, 4) },
+		{ "cCubicNoise::Generate3D 5x33x7",     ValidateCubic3D(5, 33, 7, -3.5f, -1, 20, 33.75f, 1000, 1001.5f) },
+	};
+	bool res = true;
+	for (size_t i = 0; i < ARRAYCOUNT(Checks); i++)
+	{
+		bool IsOK = (Checks[i].m_MaxDiff <= MAX_DIFFERENCE);
+		printf("  %-36s max difference %.3g: %s\n", Checks[i].m_Name, static_cast<double>(Checks[i].m_MaxDiff), IsOK ? "OK" : "FAILED");
+		res = res && IsOK;
+	}
+	return res;
 }
 
 
 
 
 
-clock_t TestCubicNoise(void)
+/** Records the measurement into a_Results and prints it. */
+static void Report(sResults & a_Results, const char * a_Name, const AString & a_Size, std::chrono::steady_clock::duration a_Duration, double a_NumSamples)
 {
-	cCubicNoise Cubic(0);
-	NOISE_DATATYPE Values[256 * 256];
-	
-	// Do a speed test:
-	clock_t Begin = clock();
-	for (int i = 0; i < 1000; i++)
-	{
-		Cubic.Generate2D(Values, 256, 256, 0, (NOISE_DATATYPE)25.6, 0, (NOISE_DATATYPE)25.6);
-	}
-	clock_t Ticks = clock() - Begin;
-	LOG("cCubicNoise generating 1000 * 256x256 values took %d ticks (%.02f sec)", Ticks, (double)Ticks / CLOCKS_PER_SEC);
-	
-	// Save the results into a file for visual comparison:
-	SaveValues(Values, "NoiseCubic.raw");
-	
-	return Ticks;
+	double Ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(a_Duration).count());
+	sResult Result;
+	Result.m_Name = a_Name;
+	Result.m_Size = a_Size;
+	Result.m_NsPerSample = Ns / a_NumSamples;
+	Result.m_SamplesPerSec = (Ns > 0) ? (a_NumSamples * 1e9 / Ns) : 0;
+	printf("%-30s %-10s %9.3f ns/sample %14.0f samples/s\n", a_Name, a_Size.c_str(), Result.m_NsPerSample, Result.m_SamplesPerSec);
+	a_Results.push_back(Result);
 }
 
 
 
 
 
-clock_t TestOldNoise(void)
+/** Times the single-value integral noise functions of cNoise. */
+static void BenchmarkIntNoise(sResults & a_Results, int a_NumIterations)
 {
-	cNoise Noise(0);
-	NOISE_DATATYPE Values[256 * 256];
+	cNoise Noise(1);
+	const int NumSamples = a_NumIterations * 65536;
+	NOISE_DATATYPE Sum = 0;
+	unsigned IntSum = 0;
 
-	// Do a speed test:
-	clock_t Begin = clock();
-	for (int i = 0; i < 1000; i++)
+	auto Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumSamples; i++)
 	{
-		for (int y = 0; y < 256; y++)
-		{
-			float fy = (float)y / 10;
-			for (int x = 0; x < 256; x++)
-			{
-				Values[x + 256 * y] = Noise.CubicNoise2D((float)x / 10, fy);
-			}  // for x
-		}  // for y
-	}
-	clock_t Ticks = clock() - Begin;
-	LOG("cNoise generating 1000 * 256x256 values took %d ticks (%.02f sec)", Ticks, (double)Ticks / CLOCKS_PER_SEC);
-	
-	// Save the results into a file for visual comparison:
-	SaveValues(Values, "NoiseOld.raw");
-	
-	return Ticks;
+		Sum += Noise.IntNoise1D(i);
+	}
+	Report(a_Results, "cNoise::IntNoise1D", "1", std::chrono::steady_clock::now() - Start, NumSamples);
+
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumSamples; i++)
+	{
+		Sum += Noise.IntNoise2D(i, -i);
+	}
+	Report(a_Results, "cNoise::IntNoise2D", "1", std::chrono::steady_clock::now() - Start, NumSamples);
+
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumSamples; i++)
+	{
+		Sum += Noise.IntNoise3D(i, 0, -i);
+	}
+	Report(a_Results, "cNoise::IntNoise3D", "1", std::chrono::steady_clock::now() - Start, NumSamples);
+
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumSamples; i++)
+	{
+		IntSum += static_cast<unsigned>(Noise.IntNoise2DInt(i, -i));
+	}
+	Report(a_Results, "cNoise::IntNoise2DInt", "1", std::chrono::steady_clock::now() - Start, NumSamples);
+
+	Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumSamples; i++)
+	{
+		IntSum += static_cast<unsigned>(Noise.IntNoise3DInt(i, 0, -i));
+	}
+	Report(a_Results, "cNoise::IntNoise3DInt", "1", std::chrono::steady_clock::now() - Start, NumSamples);
+
+	g_Sink = Sum + static_cast<NOISE_DATATYPE>(IntSum);
+}
+
+
+
+
+
+/** Times a_Noise.Generate2D() of the specified size, over a different area in each iteration. */
+template <typename NoiseType>
+static void Benchmark2D(sResults & a_Results, const char * a_Name, const NoiseType & a_Noise, int a_SizeX, int a_SizeY, NOISE_DATATYPE a_Scale, int a_NumIterations)
+{
+	std::vector<NOISE_DATATYPE> Values(static_cast<size_t>(a_SizeX * a_SizeY));
+	NOISE_DATATYPE Sum = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		NOISE_DATATYPE StartX = static_cast<NOISE_DATATYPE>(i) * a_Scale;
+		a_Noise.Generate2D(Values.data(), a_SizeX, a_SizeY, StartX, StartX + a_Scale, 0, a_Scale);
+		Sum += Values[static_cast<size_t>(i % (a_SizeX * a_SizeY))];
+	}
+	auto Duration = std::chrono::steady_clock::now() - Start;
+	g_Sink = Sum;
+	Report(a_Results, a_Name, Printf("%dx%d", a_SizeX, a_SizeY), Duration, static_cast<double>(a_NumIterations) * a_SizeX * a_SizeY);
+}
+
+
+
+
+
+/** Times a_Noise.Generate3D() of the specified size, over a different area in each iteration. */
+template <typename NoiseType>
+static void Benchmark3D(sResults & a_Results, const char * a_Name, const NoiseType & a_Noise, int a_SizeX, int a_SizeY, int a_SizeZ, NOISE_DATATYPE a_Scale, int a_NumIterations)
+{
+	std::vector<NOISE_DATATYPE> Values(static_cast<size_t>(a_SizeX * a_SizeY * a_SizeZ));
+	NOISE_DATATYPE Sum = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < a_NumIterations; i++)
+	{
+		NOISE_DATATYPE StartX = static_cast<NOISE_DATATYPE>(i) * a_Scale;
+		a_Noise.Generate3D(Values.data(), a_SizeX, a_SizeY, a_SizeZ, StartX, StartX + a_Scale, 0, a_Scale, 0, a_Scale);
+		Sum += Values[static_cast<size_t>(i % (a_SizeX * a_SizeY * a_SizeZ))];
+	}
+	auto Duration = std::chrono::steady_clock::now() - Start;
+	g_Sink = Sum;
+	Report(a_Results, a_Name, Printf("%dx%dx%d", a_SizeX, a_SizeY, a_SizeZ), Duration, static_cast<double>(a_NumIterations) * a_SizeX * a_SizeY * a_SizeZ);
+}
+
+
+
+
+
+/** Times cImprovedNoise::GetValueAt(). */
+static void BenchmarkImprovedSingle(sResults & a_Results, int a_NumIterations)
+{
+	cImprovedNoise Noise(1);
+	const int NumSamples = a_NumIterations * 65536;
+	NOISE_DATATYPE Sum = 0;
+	auto Start = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumSamples; i++)
+	{
+		Sum += Noise.GetValueAt(i, 0, -i);
+	}
+	auto Duration = std::chrono::steady_clock::now() - Start;
+	g_Sink = Sum;
+	Report(a_Results, "cImprovedNoise::GetValueAt", "1", Duration, NumSamples);
+}
+
+
+
+
+
+/** Writes the results as a JSON document into the specified file, or stdout if the name is "-".
+Returns false if the file cannot be written. */
+static bool WriteJson(const sResults & a_Results, const AString & a_FileName, int a_NumIterations, bool a_IsValid)
+{
+	FILE * f = (a_FileName == "-") ? stdout : fopen(a_FileName.c_str(), "w");
+	if (f == nullptr)
+	{
+		LOGERROR("Cannot write the JSON results to file \"%s\".", a_FileName.c_str());
+		return false;
+	}
+	fprintf(f, "{\n\t\"iterations\": %d,\n\t\"valid\": %s,\n\t\"results\": [\n", a_NumIterations, a_IsValid ? "true" : "false");
+	for (sResults::const_iterator itr = a_Results.begin(), end = a_Results.end(); itr != end; ++itr)
+	{
+		fprintf(f, "\t\t{ \"name\": \"%s\", \"size\": \"%s\", \"ns_per_sample\": %.4f, \"samples_per_sec\": %.0f }%s\n",
+			itr->m_Name.c_str(), itr->m_Size.c_str(), itr->m_NsPerSample, itr->m_SamplesPerSec,
+			(itr + 1 == end) ? "" : ","
+		);
+	}
+	fprintf(f, "\t]\n}\n");
+	if (f != stdout)
+	{
+		fclose(f);
+	}
+	return true;
 }
 
 
 
 
 
-int main(int argc, char * argv[])
+int main(int argc, char ** argv)
 {
-	new cMCLogger();  // Create a logger (will set itself as the main instance
-	
-	clock_t NewTicks = TestCubicNoise();
-	clock_t OldTicks = TestOldNoise();
-	LOG("New method is %.02fx faster", (double)OldTicks / NewTicks);
-	LOG("Press Enter to quit program");
-	getchar();
+	int NumIterations = 100;
+	if (argc > 1)
+	{
+		NumIterations = std::max(atoi(argv[1]), 1);
+	}
+
+	bool IsValid = Validate();
+
+	sResults Results;
+	BenchmarkIntNoise(Results, NumIterations);
+
+	// The sizes used by the terrain generators: a chunk's heightmap, its decimated 3D density, and a whole chunk column:
+	cCubicNoise Cubic(1);
+	Benchmark2D(Results, "cCubicNoise::Generate2D", Cubic, 16, 16, 4, NumIterations * 64);
+	Benchmark2D(Results, "cCubicNoise::Generate2D", Cubic, 256, 256, 25.6f, NumIterations);
+	Benchmark3D(Results, "cCubicNoise::Generate3D", Cubic, 5, 33, 5, 4, NumIterations * 64);
+	Benchmark3D(Results, "cCubicNoise::Generate3D", Cubic, 16, 256, 16, 8, NumIterations);
+
+	BenchmarkImprovedSingle(Results, NumIterations);
+	cImprovedNoise Improved(1);
+	Benchmark2D(Results, "cImprovedNoise::Generate2D", Improved, 256, 256, 25.6f, NumIterations);
+	Benchmark3D(Results, "cImprovedNoise::Generate3D", Improved, 16, 256, 16, 8, NumIterations);
+
+	cPerlinNoise Perlin(1);
+	Perlin.AddOctave(1, 1);
+	Perlin.AddOctave(2, 0.5f);
+	Perlin.AddOctave(4, 0.25f);
+	Perlin.AddOctave(8, 0.125f);
+	Benchmark2D(Results, "cPerlinNoise::Generate2D", Perlin, 256, 256, 4, NumIterations);
+	Benchmark3D(Results, "cPerlinNoise::Generate3D", Perlin, 16, 256, 16, 2, NumIterations);
+
+	cRidgedMultiNoise Ridged(1);
+	Ridged.AddOctave(1, 1);
+	Ridged.AddOctave(2, 0.5f);
+	Ridged.AddOctave(4, 0.25f);
+	Ridged.AddOctave(8, 0.125f);
+	Benchmark2D(Results, "cRidgedMultiNoise::Generate2D", Ridged, 256, 256, 4, NumIterations);
+	Benchmark3D(Results, "cRidgedMultiNoise::Generate3D", Ridged, 16, 256, 16, 2, NumIterations);
+
+	if ((argc > 2) && !WriteJson(Results, argv[2], NumIterations, IsValid))
+	{
+		return 2;
+	}
+	return IsValid ? 0 : 1;
 }
+
+
+
+
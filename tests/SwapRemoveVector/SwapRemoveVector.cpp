@@ -0,0 +1,162 @@
+
+// SwapRemoveVector.cpp
+
+// Tests that cSwapRemoveVector::ForEach() visits each item exactly once when the callback removes items
+
+#include "Globals.h"
+#include "SwapRemoveVector.h"
+
+
+
+
+
+/** Number of items in the tested vectors. */
+static const int NUM_ITEMS = 8;
+
+
+
+
+
+/** Fills the vector with the items and clears their visit counters. */
+static void Fill(cSwapRemoveVector<int> & a_Vector, int * a_Items, int * a_NumVisits)
+{
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		a_Items[i] = i;
+		a_NumVisits[i] = 0;
+		a_Vector.push_back(&a_Items[i]);
+	}
+}
+
+
+
+
+
+/** The callback removes the item visited just before the current one, which moves the last item into the visited part. */
+static void TestRemovePrevious(void)
+{
+	int Items[NUM_ITEMS];
+	int NumVisits[NUM_ITEMS];
+	cSwapRemoveVector<int> Vector;
+	Fill(Vector, Items, NumVisits);
+	int * Previous = nullptr;
+	testassert(Vector.ForEach([&](int * a_Item)
+		{
+			NumVisits[*a_Item] += 1;
+			if (Previous != nullptr)
+			{
+				testassert(Vector.Remove(Previous));
+			}
+			Previous = a_Item;
+			return false;
+		}
+	));
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		testassert(NumVisits[i] == 1);
+	}
+	testassert(Vector.size() == 1);
+}
+
+
+
+
+
+/** The callback removes the current item. */
+static void TestRemoveCurrent(void)
+{
+	int Items[NUM_ITEMS];
+	int NumVisits[NUM_ITEMS];
+	cSwapRemoveVector<int> Vector;
+	Fill(Vector, Items, NumVisits);
+	testassert(Vector.ForEach([&](int * a_Item)
+		{
+			NumVisits[*a_Item] += 1;
+			testassert(Vector.Remove(a_Item));
+			return false;
+		}
+	));
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		testassert(NumVisits[i] == 1);
+	}
+	testassert(Vector.empty());
+}
+
+
+
+
+
+/** The first visited item removes all the items not visited yet, none of them may be visited. */
+static void TestRemoveFollowing(void)
+{
+	int Items[NUM_ITEMS];
+	int NumVisits[NUM_ITEMS];
+	cSwapRemoveVector<int> Vector;
+	Fill(Vector, Items, NumVisits);
+	bool IsFirst = true;
+	testassert(Vector.ForEach([&](int * a_Item)
+		{
+			NumVisits[*a_Item] += 1;
+			if (IsFirst)
+			{
+				IsFirst = false;
+				for (int i = 0; i < NUM_ITEMS; i++)
+				{
+					if (&Items[i] != a_Item)
+					{
+						testassert(Vector.Remove(&Items[i]));
+					}
+				}
+			}
+			return false;
+		}
+	));
+	int NumVisited = 0;
+	for (int i = 0; i < NUM_ITEMS; i++)
+	{
+		testassert(NumVisits[i] <= 1);
+		NumVisited += NumVisits[i];
+	}
+	testassert(NumVisited == 1);
+	testassert(Vector.size() == 1);
+}
+
+
+
+
+
+/** The callback aborts the enumeration. */
+static void TestAbort(void)
+{
+	int Items[NUM_ITEMS];
+	int NumVisits[NUM_ITEMS];
+	cSwapRemoveVector<int> Vector;
+	Fill(Vector, Items, NumVisits);
+	int NumCalls = 0;
+	testassert(!Vector.ForEach([&](int * a_Item)
+		{
+			NumCalls += 1;
+			return (NumCalls == 3);
+		}
+	));
+	testassert(NumCalls == 3);
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	TestRemovePrevious();
+	TestRemoveCurrent();
+	TestRemoveFollowing();
+	TestAbort();
+	LOG("SwapRemoveVector test finished");
+	return 0;
+}
+
+
+
+
@@ -0,0 +1,82 @@
+
+// QueueLength.cpp
+
+// Submits tasks from many threads at once and checks that the pool's queue length returns to zero
+
+#include "Globals.h"
+#include "OSSupport/ThreadPool.h"
+
+
+
+
+
+/** Number of threads submitting the tasks concurrently. */
+static const int NUM_SUBMITTERS = 16;
+
+/** Number of tasks submitted by each of the submitting threads. */
+static const int NUM_TASKS_PER_SUBMITTER = 10000;
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	cThreadPool Pool;
+	testassert(Pool.Start(4));
+
+	// Watch the queue length while the tasks are submitted and executed, it must never wrap around below zero:
+	static const size_t MaxQueueLength = static_cast<size_t>(NUM_SUBMITTERS * NUM_TASKS_PER_SUBMITTER);
+	std::atomic<bool> ShouldStopWatching(false);
+	std::atomic<bool> HasWrapped(false);
+	std::thread Watcher([&]()
+		{
+			while (!ShouldStopWatching)
+			{
+				if (Pool.GetQueueLength() > MaxQueueLength)
+				{
+					HasWrapped = true;
+				}
+			}
+		}
+	);
+
+	std::atomic<int> NumExecuted(0);
+	std::vector<std::thread> Submitters;
+	for (int i = 0; i < NUM_SUBMITTERS; i++)
+	{
+		Submitters.push_back(std::thread([&Pool, &NumExecuted]()
+			{
+				for (int t = 0; t < NUM_TASKS_PER_SUBMITTER; t++)
+				{
+					Pool.Submit([&NumExecuted]() { NumExecuted++; });
+				}
+			}
+		));
+	}
+	for (auto & Submitter: Submitters)
+	{
+		Submitter.join();
+	}
+
+	// Wait for the workers to finish all the tasks:
+	for (int i = 0; (NumExecuted < NUM_SUBMITTERS * NUM_TASKS_PER_SUBMITTER) && (i < 10000); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ShouldStopWatching = true;
+	Watcher.join();
+	testassert(!HasWrapped);
+	testassert(NumExecuted == NUM_SUBMITTERS * NUM_TASKS_PER_SUBMITTER);
+	testassert(Pool.GetQueueLength() == 0);
+
+	Pool.Stop();
+	testassert(Pool.GetQueueLength() == 0);
+
+	LOG("ThreadPool QueueLength test finished");
+	return 0;
+}
+
+
+
+